@@ -0,0 +1,286 @@
+#include "benchmark.hpp"
+
+#include "utils_cpp/avl_tree.hpp"
+#include "utils_cpp/bitvector.hpp"
+#include "utils_cpp/btree.hpp"
+#include "utils_cpp/disjointset.hpp"
+#include "utils_cpp/fenwick_tree.hpp"
+#include "utils_cpp/flat_hash_map.hpp"
+#include "utils_cpp/hash.hpp"
+#include "utils_cpp/interval_tree.hpp"
+#include "utils_cpp/R.hpp"
+#include "utils_cpp/matrix.hpp"
+#include "utils_cpp/numpy.hpp"
+#include "utils_cpp/roaring_bitmap.hpp"
+#include "utils_cpp/segment_tree.hpp"
+#include "utils_cpp/sparse_table.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <ranges>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+
+struct min_fn {
+  std::int64_t operator()(std::int64_t a, std::int64_t b) const {
+    return a < b ? a : b;
+  }
+};
+
+// Random values and query positions, so every benchmark call touches a
+// different part of the structure.
+struct inputs {
+  std::vector<std::int64_t> values;
+  std::vector<std::uint32_t> positions;
+  std::size_t next = 0;
+
+  inputs(std::size_t n, std::uint32_t range) {
+    std::mt19937 rng(5);
+    values.resize(n);
+    positions.resize(4096);
+    for (auto &v : values) {
+      v = static_cast<std::int64_t>(rng() % 1000);
+    }
+    for (auto &p : positions) {
+      p = static_cast<std::uint32_t>(rng() % range);
+    }
+  }
+
+  std::uint32_t position() noexcept {
+    next = (next + 1) & (positions.size() - 1);
+    return positions[next];
+  }
+
+  // A random half-open range [l, r).
+  std::pair<std::uint32_t, std::uint32_t> range() noexcept {
+    std::uint32_t a = position(), b = position();
+    return a < b ? std::pair{a, b + 1} : std::pair{b, a + 1};
+  }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  return bench::main(argc, argv, [](bench::Runner &runner) {
+    for (std::size_t n : {std::size_t{1} << 10, std::size_t{1} << 20}) {
+      std::string size = "/";
+      size += std::to_string(n);
+      inputs in(n, static_cast<std::uint32_t>(n));
+
+      FenwickTree<std::int64_t> fenwick(in.values);
+      runner.run("fenwick_tree/add+prefix" + size, [&] {
+        fenwick.add(in.position(), 1);
+        bench::do_not_optimize(fenwick.prefix(in.position() + 1));
+      });
+
+      SegmentTree<std::int64_t, std::plus<std::int64_t>> segment(in.values);
+      runner.run("segment_tree/modify+query" + size, [&] {
+        segment.modify(in.position(), 1);
+        auto [l, r] = in.range();
+        bench::do_not_optimize(segment.query(l, r));
+      });
+
+      SparseTable<std::int64_t, min_fn> sparse(in.values);
+      runner.run("sparse_table/query" + size, [&] {
+        auto [l, r] = in.range();
+        bench::do_not_optimize(sparse.query(l, r));
+      });
+
+      BitVector bits(n);
+      for (std::size_t i = 0; i < n; i += 3) {
+        bits.set(i);
+      }
+      RankSelect rank_select(bits);
+      runner.run("rank_select/rank" + size, [&] {
+        bench::do_not_optimize(rank_select.rank(in.position()));
+      });
+      runner.run("rank_select/select" + size, [&] {
+        bench::do_not_optimize(rank_select.select(in.position() / 3));
+      });
+
+      RoaringBitmap roaring(bits), other;
+      for (std::size_t i = 0; i < n; i += 5) {
+        other.add(static_cast<std::uint32_t>(i));
+      }
+      runner.run("roaring_bitmap/contains" + size, [&] {
+        bench::do_not_optimize(roaring.contains(in.position()));
+      });
+      runner.run("roaring_bitmap/and" + size, [&] {
+        auto both = roaring & other;
+        bench::do_not_optimize(both);
+      });
+
+      BTreeSet<std::uint32_t> btree;
+      AVLTree<std::uint32_t> avl;
+      IntervalTree<std::uint32_t> intervals;
+      for (std::size_t i = 0; i < n; ++i) {
+        auto key = static_cast<std::uint32_t>(in.values[i] * 7919 + i);
+        btree.insert(key);
+        avl.insert(key);
+        intervals.insert({key, key + 100});
+      }
+      runner.run("btree/contains" + size, [&] {
+        bench::do_not_optimize(btree.contains(in.position()));
+      });
+      runner.run("avl_tree/contains" + size, [&] {
+        bench::do_not_optimize(avl.contains(in.position()));
+      });
+      runner.run("interval_tree/find_overlapping" + size, [&] {
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> found;
+        auto low = in.position();
+        intervals.find_overlapping(low, low + 10, std::back_inserter(found));
+        bench::do_not_optimize(found);
+      });
+      runner.run("btree/build" + size, [&] {
+        BTreeSet<std::uint32_t> tree;
+        for (std::size_t i = 0; i < n; ++i) {
+          tree.insert(in.positions[i & (in.positions.size() - 1)] + i);
+        }
+        bench::do_not_optimize(tree);
+      });
+
+      runner.run("disjointset/unify" + size, [&] {
+        DisjointSet set(static_cast<int>(n));
+        for (std::size_t i = 0; i + 1 < n; i += 2) {
+          set.unify(static_cast<int>(i), static_cast<int>(in.position()));
+        }
+        bench::do_not_optimize(set.find(0));
+      });
+    }
+
+    // Grid edges as vertex index pairs, the keys of an EdgeMap.
+    for (std::size_t side : {64, 1024}) {
+      std::vector<std::pair<std::size_t, std::size_t>> edges;
+      for (std::size_t v = 0; v + 1 < side * side; ++v) {
+        edges.emplace_back(v, v + 1);
+        if (v + side < side * side) {
+          edges.emplace_back(v, v + side);
+        }
+      }
+      std::string size = "/";
+      size += std::to_string(edges.size());
+      runner.run("hash/pair_hash/insert" + size, [&] {
+        std::unordered_set<std::pair<std::size_t, std::size_t>,
+                           pair_hash<std::size_t, std::size_t>>
+            set(edges.begin(), edges.end());
+        bench::do_not_optimize(set.size());
+      });
+      runner.run("hash/symmetric_pair_hash/insert" + size, [&] {
+        std::unordered_set<std::pair<std::size_t, std::size_t>,
+                           symmetric_pair_hash<std::size_t, std::size_t>,
+                           symmetric_pair_equal<std::size_t, std::size_t>>
+            set(edges.begin(), edges.end());
+        bench::do_not_optimize(set.size());
+      });
+      runner.run("flat_hash_set/insert" + size, [&] {
+        FlatHashSet<std::pair<std::size_t, std::size_t>,
+                    pair_hash<std::size_t, std::size_t>>
+            set(edges.begin(), edges.end());
+        bench::do_not_optimize(set.size());
+      });
+
+      std::unordered_set<std::pair<std::size_t, std::size_t>,
+                         pair_hash<std::size_t, std::size_t>>
+          std_set(edges.begin(), edges.end());
+      FlatHashSet<std::pair<std::size_t, std::size_t>,
+                  pair_hash<std::size_t, std::size_t>>
+          flat_set(edges.begin(), edges.end());
+      std::size_t next = 0;
+      // Alternating hits and misses, in an order unrelated to insertion.
+      auto probe = [&] {
+        next = (next + 7919) % edges.size();
+        auto [u, v] = edges[next];
+        return next % 2 == 0 ? std::pair{u, v} : std::pair{v, u};
+      };
+      runner.run("hash/unordered_set/contains" + size, [&] {
+        bench::do_not_optimize(std_set.contains(probe()));
+      });
+      runner.run("flat_hash_set/contains" + size, [&] {
+        bench::do_not_optimize(flat_set.contains(probe()));
+      });
+    }
+
+    for (std::size_t n : {8, 64, 4096}) {
+      std::vector<std::uint32_t> v(n, 7);
+      std::string name = "hash/vector_hash/";
+      name += std::to_string(n);
+      runner.run(name, [&] {
+        v[0] += 1;
+        bench::do_not_optimize(vector_hash<std::uint32_t>{}(v));
+      });
+    }
+
+    for (std::size_t n : {64, 256}) {
+      Matrix<double> a(n, n, 1.5), b(n, n, 0.5);
+      std::string name = "matrix/matmul/";
+      name += std::to_string(n);
+      runner.run(name, [&] {
+        auto c = matmul(a, b);
+        bench::do_not_optimize(c);
+      });
+    }
+
+    // A sum of squares over a parameter sweep, through a temporary vector
+    // and through a lazy view; and the sweep written out in bulk.
+    {
+      constexpr std::size_t n = std::size_t{1} << 20;
+      runner.run("R/seq+sum/1048576", [&] {
+        double sum = 0;
+        for (double x : seq(0.0, 1.0, 1.0 / (n - 1))) {
+          sum += x * x;
+        }
+        bench::do_not_optimize(sum);
+      });
+      runner.run("R/seq_view+sum/1048576", [&] {
+        double sum = 0;
+        for (double x : seq_view(0.0, 1.0, 1.0 / (n - 1)) |
+                            std::views::transform([](double x) {
+                              return x * x;
+                            })) {
+          sum += x;
+        }
+        bench::do_not_optimize(sum);
+      });
+      std::vector<double> sweep(n);
+      runner.run("ranges/fill_linear/1048576", [&] {
+        fill_linear<double>(sweep, 0.0, 1.0 / (n - 1));
+        bench::do_not_optimize(sweep);
+      });
+    }
+
+    // Reading an 8 MB array by copying it into a Matrix, and by mapping it.
+    {
+      Matrix<double> m(1024, 1024, 0.5);
+      std::string npy = "bench_matrix.npy", npz = "bench_matrix.npz";
+      save_npy<double>(npy, m);
+      runner.run("numpy/load_npy/1024", [&] {
+        auto loaded = load_npy<double>(npy);
+        bench::do_not_optimize(loaded);
+      });
+      runner.run("numpy/map_npy/1024", [&] {
+        auto array = map_npy(npy);
+        bench::do_not_optimize(array.matrix<double>()(1023, 1023));
+      });
+      runner.run("numpy/npz_write/1024", [&] {
+        NpzWriter out(npz);
+        out.add<double>("m", m);
+        out.close();
+      });
+      runner.run("numpy/npz_read/1024", [&] {
+        NpzFile in(npz);
+        bench::do_not_optimize(in["m"].matrix<double>()(1023, 1023));
+      });
+      std::remove(npy.c_str());
+      std::remove(npz.c_str());
+    }
+  });
+}
@@ -0,0 +1,323 @@
+#include "benchmark.hpp"
+
+#include "utils_cpp/graph/algorithms.hpp"
+#include "utils_cpp/graph/bitadjmat.hpp"
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/distance_oracle.hpp"
+#include "utils_cpp/graph/edgelist_io.hpp"
+#include "utils_cpp/graph/fingerprint.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/line_graph.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+#include "utils_cpp/graph/static_bitadjmat.hpp"
+#include "utils_cpp/graph/transforms.hpp"
+#include "utils_cpp/parallel/batch_pipeline.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+#include "utils_cpp/string.hpp"
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+
+struct family {
+  std::string name;
+  gl::GraphBundle bundle;
+};
+
+// Graphs of each shape at a small and a larger size.
+std::vector<family> graphs() {
+  std::vector<family> out;
+  out.push_back({"grid/32x32", gl::grid(32, 32)});
+  out.push_back({"grid/100x100", gl::grid(100, 100)});
+  out.push_back({"kagome/16x16", gl::kagome(16, 16)});
+  out.push_back({"kagome/40x40", gl::kagome(40, 40)});
+  out.push_back({"random/1000/0.01", gl::random(1000, 0.01, 1)});
+  out.push_back({"random/4000/0.002", gl::random(4000, 0.002, 1)});
+  return out;
+}
+
+// A random edgelist of about 16 MB, one "u v" line per edge.
+std::string edgelist_text() {
+  std::mt19937_64 gen(2);
+  std::string text;
+  for (int i = 0; i < 1'000'000; ++i) {
+    text += std::to_string(gen() % 1'000'000);
+    text += ' ';
+    text += std::to_string(gen() % 1'000'000);
+    text += '\n';
+  }
+  return text;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  return bench::main(argc, argv, [](bench::Runner &runner) {
+    for (const auto &[name, bundle] : graphs()) {
+      const gl::Graph &g = bundle.graph;
+      const gl::CsrGraph csr(g);
+      const gl::BitAdjmat mat(g);
+
+      runner.run("csr/build/" + name, [&] {
+        gl::CsrGraph built(g);
+        bench::do_not_optimize(built);
+      });
+      runner.run("csr/bfs/" + name, [&] {
+        auto distances = gl::bfs_distances(csr, 0);
+        bench::do_not_optimize(distances);
+      });
+      runner.run("csr/dijkstra/" + name, [&] {
+        auto result = gl::dijkstra(csr, 0);
+        bench::do_not_optimize(result);
+      });
+      runner.run("csr/coloring/" + name, [&] {
+        auto colors = gl::graph_coloring(
+            csr, gl::graph_coloring_strategy::SMALLEST_LAST);
+        bench::do_not_optimize(colors);
+      });
+      runner.run("line_graph/" + name, [&] {
+        auto line = gl::line_graph(csr);
+        bench::do_not_optimize(line);
+      });
+
+      runner.run("bitadjmat/build/" + name, [&] {
+        gl::BitAdjmat built(g);
+        bench::do_not_optimize(built);
+      });
+      runner.run("bitadjmat/matmul/" + name, [&] {
+        auto product = mat.matmul(mat);
+        bench::do_not_optimize(product);
+      });
+      runner.run("bitadjmat/triangles/" + name, [&] {
+        auto triangles = mat.triangle_count();
+        bench::do_not_optimize(triangles);
+      });
+    }
+
+    // A 128-vertex coupling graph, with the size known at compile time and
+    // not.
+    {
+      const auto bundle = gl::random(128, 0.1, 3);
+      const gl::BitAdjmat dynamic(bundle.graph);
+      static const gl::StaticBitAdjmat<128> fixed(dynamic);
+      runner.run("bitadjmat/triangles/random/128", [&] {
+        bench::do_not_optimize(dynamic.triangle_count());
+      });
+      runner.run("static_bitadjmat/triangles/random/128", [&] {
+        bench::do_not_optimize(fixed.triangle_count());
+      });
+      runner.run("bitadjmat/matmul/random/128", [&] {
+        auto product = dynamic.matmul(dynamic);
+        bench::do_not_optimize(product);
+      });
+      runner.run("static_bitadjmat/matmul/random/128", [&] {
+        static gl::StaticBitAdjmat<128> product;
+        product = fixed.matmul(fixed);
+        bench::do_not_optimize(product);
+      });
+      runner.run("all_pairs_bfs/random/128", [&] {
+        auto distances = gl::all_pairs_bfs(dynamic);
+        bench::do_not_optimize(distances);
+      });
+      runner.run("static_bitadjmat/bfs_from_all/random/128", [&] {
+        for (std::size_t source = 0; source < 128; ++source) {
+          bench::do_not_optimize(fixed.bfs(source));
+        }
+      });
+    }
+
+    // Keeping all-pairs distances current through a remove and re-add of
+    // an edge, against recomputing them.
+    {
+      const auto bundle = gl::grid(32, 32);
+      gl::DynamicDistanceTable<> table(bundle.graph);
+      runner.run("floyd_warshall/grid/32x32", [&] {
+        auto d = gl::floyd_warshall_matrix(bundle.graph);
+        bench::do_not_optimize(d);
+      });
+      runner.run("dynamic_distance_table/remove+add/grid/32x32", [&] {
+        table.remove_edge(500, 501);
+        table.add_edge(500, 501);
+        bench::do_not_optimize(table(0, 1023));
+      });
+      runner.run("fingerprint/grid/32x32", [&] {
+        bench::do_not_optimize(gl::fingerprint(bundle.graph));
+      });
+      runner.run("canonical_form/grid/32x32", [&] {
+        auto canonical = gl::canonical_form(bundle.graph);
+        bench::do_not_optimize(canonical);
+      });
+      gl::TopologyCache cache;
+      const auto shuffled = gl::shuffle_vertex_labels(bundle.graph, 1u);
+      gl::cached_floyd_warshall(cache, bundle.graph);
+      runner.run("topology_cache/floyd_warshall_hit/grid/32x32", [&] {
+        auto d = gl::cached_floyd_warshall(cache, shuffled);
+        bench::do_not_optimize(d);
+      });
+    }
+
+    // A* corner to corner on a grid, with the heuristic reading a hash map
+    // of position vectors or columnar coordinates.
+    {
+      auto bundle = gl::grid(300, 300);
+      gl::CsrGraph<> csr(bundle.graph);
+      gl::PathfindingWorkspace<> ws;
+      std::size_t goal = 300 * 300 - 1;
+      auto positions =
+          bundle.props.vertex["position"].to_map<std::vector<double>>();
+      gl::ManhattanHeuristic<gl::Graph, decltype(positions), double> by_map(
+          positions, goal);
+      gl::VertexCoordinates coords(bundle);
+      gl::ManhattanCoordinateHeuristic by_columns(coords, goal);
+      runner.run("astar/manhattan_locmap/grid/300x300", [&] {
+        bench::do_not_optimize(
+            gl::astar_early_stopping(csr, 0, goal, by_map, ws));
+      });
+      runner.run("astar/manhattan_coordinates/grid/300x300", [&] {
+        bench::do_not_optimize(
+            gl::astar_early_stopping(csr, 0, goal, by_columns, ws));
+      });
+    }
+
+    // remove_edges copies the graph but shares the vertex properties, which
+    // here are most of the bundle.
+    {
+      auto bundle = gl::grid(100, 100);
+      gl::VertexMap<double> feature;
+      for (std::size_t v = 0; v < 10000; ++v) {
+        feature[v] = 0.5 * static_cast<double>(v);
+      }
+      for (int k = 0; k < 8; ++k) {
+        std::string name = "feature";
+        name += std::to_string(k);
+        bundle.props.vertex.assign(name, feature);
+      }
+      runner.run("remove_edges/props/grid/100x100", [&] {
+        auto pruned = gl::remove_edges(bundle, {{0, 1}});
+        bench::do_not_optimize(pruned);
+      });
+    }
+
+    const std::string text = edgelist_text();
+    runner.run("edgelist/split+from_edgelist/16MB", [&] {
+      std::vector<std::vector<std::size_t>> edges;
+      std::istringstream lines(text);
+      for (std::string line; std::getline(lines, line);) {
+        std::vector<std::size_t> edge;
+        for (const auto &field : split(line, " ")) {
+          edge.push_back(std::stoull(field));
+        }
+        edges.push_back(std::move(edge));
+      }
+      auto g = gl::from_edgelist(edges);
+      bench::do_not_optimize(g);
+    });
+    runner.run("edgelist/parse_edgelist/16MB", [&] {
+      auto parsed = gl::parse_edgelist(text);
+      bench::do_not_optimize(parsed.edges.edges().data());
+    });
+    parallel::thread_pool pool(std::thread::hardware_concurrency());
+    runner.run("edgelist/parse_edgelist_parallel/16MB", [&] {
+      auto parsed = gl::parse_edgelist(text, {}, &pool);
+      bench::do_not_optimize(parsed.edges.edges().data());
+    });
+    runner.run("edgelist/parse_edgelist+build_csr/16MB", [&] {
+      auto csr = gl::parse_edgelist(text, {}, &pool).build_csr();
+      bench::do_not_optimize(csr);
+    });
+
+    // A random graph with 2^18 vertices, 2^21 edges and random weights,
+    // searched by Dijkstra and by delta-stepping.
+    {
+      constexpr std::size_t n = std::size_t{1} << 18;
+      std::mt19937_64 rng(6);
+      std::vector<std::pair<std::size_t, std::size_t>> edges(8 * n);
+      std::vector<double> weights(edges.size());
+      for (std::size_t i = 0; i < edges.size(); ++i) {
+        edges[i] = {rng() % n, rng() % n};
+        weights[i] = std::uniform_real_distribution<>(0.0, 1.0)(rng);
+      }
+      gl::CsrGraph<double> weighted(n, edges, weights);
+      runner.run("sssp/dijkstra/random/262144", [&] {
+        bench::do_not_optimize(gl::dijkstra_distances(weighted, 0));
+      });
+      runner.run("sssp/delta_stepping/random/262144", [&] {
+        bench::do_not_optimize(
+            gl::delta_stepping_distances(weighted, 0, 0.0, &pool));
+      });
+    }
+
+    // 64 instances of generate, prune, shuffle, all-pairs distances and
+    // JSON, collected in order, without and with the pool.
+    {
+      auto make = [](std::size_t, std::uint64_t seed) {
+        auto gb = gl::rand_prune_connected(gl::grid(12, 12), 0.2,
+                                           static_cast<unsigned>(seed));
+        auto g =
+            gl::shuffle_vertex_labels(gb.graph, static_cast<unsigned>(seed));
+        Json record;
+        record["distances"] = gl::floyd_warshall(g);
+        return record.dump();
+      };
+      auto write = [](std::size_t, std::string line) {
+        bench::do_not_optimize(line.size());
+      };
+      runner.run("batch/grid+prune+floyd_warshall/64", [&] {
+        parallel::run_batch(64, 1, make, write);
+      });
+      runner.run("batch/grid+prune+floyd_warshall_parallel/64", [&] {
+        parallel::run_batch(64, 1, make, write, &pool);
+      });
+    }
+
+    // Checking a coloring of a dense graph edge by edge and by ANDing each
+    // adjmat row with the class of its color, then repairing it after an edge
+    // insertion against coloring from scratch.
+    {
+      auto [g, props] = gl::random(2000, 0.2, 1);
+      const gl::CsrGraph csr(g);
+      gl::BitAdjmat mat(g);
+      auto colors =
+          gl::graph_coloring(csr, gl::graph_coloring_strategy::SMALLEST_LAST);
+      gl::ColorClasses classes(colors);
+      runner.run("coloring/verify/edges/random/2000/0.2", [&] {
+        bool proper = true;
+        for (auto e : boost::make_iterator_range(boost::edges(g))) {
+          auto u = boost::source(e, g);
+          auto v = boost::target(e, g);
+          proper &= u == v || colors[u] != colors[v];
+        }
+        bench::do_not_optimize(proper);
+      });
+      runner.run("coloring/verify/bitsliced/random/2000/0.2", [&] {
+        bench::do_not_optimize(gl::verify_coloring(mat, classes));
+      });
+      runner.run("coloring/verify/bitsliced_parallel/random/2000/0.2", [&] {
+        bench::do_not_optimize(gl::verify_coloring(mat, classes, &pool));
+      });
+
+      std::size_t u = 0;
+      std::size_t v = 1;
+      while (mat.get(u, v) || classes.color(u) != classes.color(v)) {
+        ++v;
+      }
+      runner.run("coloring/insert+recolor/random/2000/0.2", [&] {
+        gl::BitAdjmat m = mat;
+        gl::ColorClasses c = classes;
+        bench::do_not_optimize(gl::recolor_after_edge_insert(m, c, u, v));
+      });
+      runner.run("coloring/insert+rerun/random/2000/0.2", [&] {
+        gl::BitAdjmat m = mat;
+        m.set(u, v);
+        bench::do_not_optimize(gl::graph_coloring(
+            gl::CsrGraph(m), gl::graph_coloring_strategy::SMALLEST_LAST));
+      });
+    }
+  });
+}
@@ -0,0 +1,60 @@
+#include "benchmark.hpp"
+
+#include "utils_cpp/json.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+
+// An array of 'n' records with numbers, strings, a nested array and object.
+std::string records(std::size_t n) {
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<double> real(-1e3, 1e3);
+  std::vector<Json> items;
+  for (std::size_t i = 0; i < n; ++i) {
+    Json item;
+    item["id"] = Json(i);
+    item["name"] = Json(std::string_view("record " + std::to_string(i)));
+    item["score"] = Json(real(rng));
+    item["tags"] = Json(std::vector<Json>{Json(std::string_view("a")),
+                                          Json(std::string_view("b")),
+                                          Json(static_cast<int>(i % 7))});
+    item["position"]["x"] = Json(real(rng));
+    item["position"]["y"] = Json(real(rng));
+    items.push_back(std::move(item));
+  }
+  return Json(items).dump();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  return bench::main(argc, argv, [](bench::Runner &runner) {
+    for (std::size_t n : {100, 10000}) {
+      const std::string text = records(n);
+      const Json json = parse(text);
+      std::string suffix = "/";
+      suffix += std::to_string(n);
+      suffix += "_records/";
+      suffix += std::to_string(text.size() / 1024);
+      suffix += "KiB";
+
+      runner.run("json/parse" + suffix, [&] {
+        auto parsed = parse(text);
+        bench::do_not_optimize(parsed);
+      });
+      runner.run("json/dump" + suffix, [&] {
+        auto dumped = json.dump();
+        bench::do_not_optimize(dumped);
+      });
+      runner.run("json/pretty_dump" + suffix, [&] {
+        auto dumped = json.pretty_dump();
+        bench::do_not_optimize(dumped);
+      });
+    }
+  });
+}
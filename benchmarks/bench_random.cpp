@@ -0,0 +1,95 @@
+#include "benchmark.hpp"
+
+#include "utils_cpp/random.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+
+template <typename Gen>
+void engine_benchmarks(bench::Runner &runner, const std::string &name,
+                       Gen gen) {
+  runner.run("random/engine/" + name,
+             [&] { bench::do_not_optimize(gen()); });
+
+  std::vector<double> doubles(4096);
+  runner.run("random/random_double_loop/" + name, [&] {
+    for (double &x : doubles) {
+      x = random_double(gen);
+    }
+    bench::do_not_optimize(doubles.data());
+  });
+  runner.run("random/fill_uniform/" + name, [&] {
+    fill_uniform(std::span(doubles), gen);
+    bench::do_not_optimize(doubles.data());
+  });
+
+  std::vector<std::uint8_t> coins(4096);
+  runner.run("random/random_int_coins/" + name, [&] {
+    for (auto &c : coins) {
+      c = static_cast<std::uint8_t>(random_int(gen));
+    }
+    bench::do_not_optimize(coins.data());
+  });
+  runner.run("random/fill_bernoulli_0.5/" + name, [&] {
+    fill_bernoulli(std::span(coins), 0.5, gen);
+    bench::do_not_optimize(coins.data());
+  });
+  runner.run("random/fill_bernoulli_0.3/" + name, [&] {
+    fill_bernoulli(std::span(coins), 0.3, gen);
+    bench::do_not_optimize(coins.data());
+  });
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  return bench::main(argc, argv, [](bench::Runner &runner) {
+    engine_benchmarks(runner, "mt19937_64", std::mt19937_64(1));
+    engine_benchmarks(runner, "xoshiro256pp", Xoshiro256pp(1));
+    engine_benchmarks(runner, "pcg32", Pcg32(1));
+    engine_benchmarks(runner, "splitmix64", SplitMix64(1));
+
+    Xoshiro256pp gen(2);
+    std::vector<std::size_t> buffer, sorted;
+    for (std::size_t size : {std::size_t{1} << 12, std::size_t{1} << 24}) {
+      for (std::size_t k : {std::size_t{8}, std::size_t{1024}}) {
+        std::string name = "/";
+        name += std::to_string(size);
+        name += "/";
+        name += std::to_string(k);
+        runner.run("random/sample_indices/shuffled_iota" + name, [&] {
+          auto all = shuffled_iota(size, gen);
+          all.resize(k);
+          bench::do_not_optimize(all);
+        });
+        runner.run("random/sample_indices" + name, [&] {
+          auto s = sample_indices_without_replacement(size, k, gen);
+          bench::do_not_optimize(s);
+        });
+        runner.run("random/sample_indices_buffer" + name, [&] {
+          auto s = sample_indices_without_replacement(size, k, gen, buffer);
+          bench::do_not_optimize(s.data());
+        });
+        runner.run("random/sample_sorted_indices" + name, [&] {
+          sorted.clear();
+          sample_sorted_indices(size, k, std::back_inserter(sorted), gen);
+          bench::do_not_optimize(sorted.data());
+        });
+      }
+    }
+
+    std::vector<double> weights(1024);
+    fill_uniform(std::span(weights), gen);
+    AliasTable table(weights);
+    runner.run("random/alias_table/1024",
+               [&] { bench::do_not_optimize(table(gen)); });
+  });
+}
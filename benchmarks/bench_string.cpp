@@ -0,0 +1,151 @@
+#include "benchmark.hpp"
+
+#include "utils_cpp/enum/enum_string.hpp"
+#include "utils_cpp/print.hpp"
+#include "utils_cpp/string.hpp"
+
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+
+// A weighted edgelist: "u v w" on each line.
+std::string edgelist(std::size_t lines) {
+  std::mt19937 rng(3);
+  std::string text;
+  for (std::size_t i = 0; i < lines; ++i) {
+    text += std::to_string(rng() % 1000000);
+    text += ' ';
+    text += std::to_string(rng() % 1000000);
+    text += ' ';
+    text += std::to_string(static_cast<double>(rng() % 1000) / 8);
+    text += '\n';
+  }
+  return text;
+}
+
+enum class Unit {
+  byte, kilobyte, megabyte, gigabyte, second, millisecond, microsecond,
+  nanosecond, meter, kilometer, gram, kilogram, kelvin, ampere, mole, candela
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  return bench::main(argc, argv, [](bench::Runner &runner) {
+    const std::string text = edgelist(10000);
+
+    runner.run("string/edgelist/split+stod", [&] {
+      double sum = 0;
+      for (const auto &line : split(text, "\n")) {
+        for (const auto &field : split(line, " ")) {
+          sum += std::stod(field);
+        }
+      }
+      bench::do_not_optimize(sum);
+    });
+    runner.run("string/edgelist/split_view+parse_number", [&] {
+      double sum = 0;
+      for (std::string_view line : split_view(text, "\n")) {
+        for (std::string_view field : split_view(line, " ")) {
+          sum += parse_number<double>(field).value_or(0);
+        }
+      }
+      bench::do_not_optimize(sum);
+    });
+    const DelimiterSet delimiters(" \n");
+    runner.run("string/edgelist/split_any_view+parse_number", [&] {
+      double sum = 0;
+      for (std::string_view field : split_any_view(text, delimiters)) {
+        sum += parse_number<double>(field).value_or(0);
+      }
+      bench::do_not_optimize(sum);
+    });
+
+    // Long fields, where the search dominates.
+    std::string csv(1 << 20, 'x');
+    for (std::size_t i = 0; i < csv.size(); i += 97) {
+      csv[i] = i % 3 == 0 ? '\n' : ',';
+    }
+    const DelimiterSet csv_delimiters(",\n");
+    runner.run("string/csv/find_first_of", [&] {
+      std::size_t count = 0;
+      for (auto pos = std::string_view(csv).find_first_of(",\n");
+           pos != std::string_view::npos;
+           pos = std::string_view(csv).find_first_of(",\n", pos + 1)) {
+        ++count;
+      }
+      bench::do_not_optimize(count);
+    });
+    runner.run("string/csv/delimiter_set", [&] {
+      std::size_t count = 0;
+      for (auto pos = csv_delimiters.find(csv); pos != std::string_view::npos;
+           pos = csv_delimiters.find(csv, pos + 1)) {
+        ++count;
+      }
+      bench::do_not_optimize(count);
+    });
+
+    std::vector<std::vector<double>> rows(100, std::vector<double>(1000));
+    std::mt19937 rng(1);
+    for (auto &row : rows) {
+      for (auto &x : row) {
+        x = static_cast<double>(rng()) / 1000;
+      }
+    }
+    // Parsing enum-valued fields, e.g. from config or JSON records.
+    std::vector<std::string> unit_names;
+    std::mt19937 unit_rng(5);
+    for (int i = 0; i < 10000; ++i) {
+      auto e = static_cast<Unit>(unit_rng() % 16);
+      unit_names.emplace_back(enum_to_string(e));
+    }
+    std::unordered_map<std::string_view, Unit> unit_map;
+    for (auto e : enum_values<Unit>()) {
+      unit_map.emplace(enum_to_string(e), e);
+    }
+    runner.run("enum/from_string/unordered_map", [&] {
+      std::size_t sum = 0;
+      for (const auto &name : unit_names) {
+        sum += static_cast<std::size_t>(unit_map.find(name)->second);
+      }
+      bench::do_not_optimize(sum);
+    });
+    runner.run("enum/from_string/perfect_hash", [&] {
+      std::size_t sum = 0;
+      for (const auto &name : unit_names) {
+        sum += static_cast<std::size_t>(*enum_from_string<Unit>(name));
+      }
+      bench::do_not_optimize(sum);
+    });
+
+    runner.run("print/vector_vector_double/elementwise", [&] {
+      std::ostringstream os;
+      for (const auto &row : rows) {
+        os << '[';
+        for (std::size_t i = 0; i < row.size(); ++i) {
+          os << (i == 0 ? "" : ", ") << row[i];
+        }
+        os << ']';
+      }
+      bench::do_not_optimize(os.str().size());
+    });
+    runner.run("print/vector_vector_double", [&] {
+      std::ostringstream os;
+      os << rows;
+      bench::do_not_optimize(os.str().size());
+    });
+    runner.run("print/vector_vector_double/escaped", [&] {
+      std::ostringstream os;
+      os << escape_special_chars(true) << rows;
+      bench::do_not_optimize(os.str().size());
+    });
+  });
+}
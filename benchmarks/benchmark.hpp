@@ -0,0 +1,280 @@
+/**********************************************************************
+ * @brief A small micro-benchmark harness for the benchmarks/ targets.
+ * @details Each benchmark is a callable run in batches: the batch size
+ *grows until a batch takes long enough to time reliably, a warmup batch
+ *runs, then a number of timed batches give per-call samples. Results are the
+ *median and the median absolute deviation (MAD) of the samples, printed as a
+ *table and optionally written as JSON (--json <file>) to track regressions.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/json.hpp"
+#include "utils_cpp/timing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace bench {
+
+/**
+ * Keeps 'value' (and what it depends on) from being optimized away, without
+ * the cost of storing it anywhere.
+ */
+template <typename T>
+inline void do_not_optimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  if constexpr (std::is_trivially_copyable_v<T> &&
+                sizeof(T) <= sizeof(void *)) {
+    asm volatile("" : : "r,m"(value) : "memory");
+  } else {
+    asm volatile("" : : "m"(value) : "memory");
+  }
+#else
+  static const volatile void *sink;
+  sink = &value;
+#endif
+}
+
+/**
+ * Makes the compiler assume all memory may have been read and written, so
+ * stores before it are not elided.
+ */
+inline void clobber_memory() {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : : "memory");
+#else
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+struct Result {
+  std::string name;
+  std::size_t batch_size;
+  std::vector<double> samples_ns;
+  double median_ns;
+  double mad_ns;
+  double min_ns;
+  double mean_ns;
+};
+
+inline double median(std::vector<double> values) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  auto middle = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+  std::nth_element(values.begin(), middle, values.end());
+  if (values.size() % 2 == 1) {
+    return *middle;
+  }
+  return (*middle + *std::max_element(values.begin(), middle)) / 2;
+}
+
+/**
+ * Median absolute deviation: the median of |x - median(x)|, a spread
+ * estimate that, unlike the standard deviation, ignores a few outliers.
+ */
+inline double median_absolute_deviation(const std::vector<double> &values) {
+  const double m = median(values);
+  std::vector<double> deviations;
+  deviations.reserve(values.size());
+  for (double v : values) {
+    deviations.push_back(v < m ? m - v : v - m);
+  }
+  return median(deviations);
+}
+
+/**
+ * Runs benchmarks and reports them. Command line:
+ *   [--filter <substring>] [--json <file>] [--samples <n>]
+ *   [--min-batch-ms <ms>] [--list]
+ */
+class Runner {
+public:
+  Runner(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+      std::string_view arg = argv[i];
+      auto value = [&]() -> std::string {
+        if (i + 1 >= argc) {
+          throw std::invalid_argument("missing value for " + std::string(arg));
+        }
+        return argv[++i];
+      };
+      if (arg == "--filter") {
+        filter_ = value();
+      } else if (arg == "--json") {
+        json_path_ = value();
+      } else if (arg == "--samples") {
+        samples_ = std::max<std::size_t>(std::stoul(value()), 1);
+      } else if (arg == "--min-batch-ms") {
+        min_batch_ms_ = std::stod(value());
+      } else if (arg == "--list") {
+        list_only_ = true;
+      } else {
+        throw std::invalid_argument("unknown argument " + std::string(arg));
+      }
+    }
+    std::printf("%-48s %12s %10s %12s %10s\n", "benchmark", "median", "MAD",
+                "min", "batch");
+  }
+
+  Runner(const Runner &) = delete;
+  Runner &operator=(const Runner &) = delete;
+
+  ~Runner() {
+    if (!json_path_.empty()) {
+      std::ofstream out(json_path_);
+      to_json().dump(out);
+      out << '\n';
+    }
+  }
+
+  /// Whether 'name' passes the --filter, e.g. to skip expensive setup.
+  bool selected(std::string_view name) const {
+    return name.find(filter_) != std::string_view::npos;
+  }
+
+  /**
+   * Times f() and records the result under 'name'. f should pass what it
+   * computes to do_not_optimize.
+   */
+  template <typename F>
+  void run(const std::string &name, F &&f) {
+    if (!selected(name)) {
+      return;
+    }
+    if (list_only_) {
+      std::printf("%s\n", name.c_str());
+      return;
+    }
+
+    // Scale the batch until it takes min_batch_ms; this also warms up.
+    std::size_t batch = 1;
+    while (true) {
+      double ms = time_batch(f, batch) / 1e6;
+      if (ms >= min_batch_ms_ || batch >= (std::size_t{1} << 40)) {
+        break;
+      }
+      double factor = ms > 0 ? min_batch_ms_ / ms * 1.2 : 16.0;
+      batch = static_cast<std::size_t>(static_cast<double>(batch) *
+                                       std::clamp(factor, 2.0, 16.0));
+    }
+    time_batch(f, batch);
+
+    Result result;
+    result.name = name;
+    result.batch_size = batch;
+    for (std::size_t s = 0; s < samples_; ++s) {
+      result.samples_ns.push_back(time_batch(f, batch) /
+                                  static_cast<double>(batch));
+    }
+    result.median_ns = median(result.samples_ns);
+    result.mad_ns = median_absolute_deviation(result.samples_ns);
+    result.min_ns =
+        *std::min_element(result.samples_ns.begin(), result.samples_ns.end());
+    double total = 0;
+    for (double v : result.samples_ns) {
+      total += v;
+    }
+    result.mean_ns = total / static_cast<double>(result.samples_ns.size());
+
+    std::printf("%-48s %12s %10s %12s %10zu\n", name.c_str(),
+                format_ns(result.median_ns).c_str(),
+                format_ns(result.mad_ns).c_str(),
+                format_ns(result.min_ns).c_str(), batch);
+    std::fflush(stdout);
+    results_.push_back(std::move(result));
+  }
+
+  const std::vector<Result> &results() const noexcept { return results_; }
+
+  /**
+   * {"date", "samples", "min_batch_ms", "benchmarks": [{"name",
+   * "batch_size", "median_ns", "mad_ns", "min_ns", "mean_ns",
+   * "samples_ns"}]}
+   */
+  utils::Json to_json() const {
+    utils::Json json;
+    json["date"] = utils::Json(std::string_view(utils::get_current_time()));
+    json["samples"] = utils::Json(samples_);
+    json["min_batch_ms"] = utils::Json(min_batch_ms_);
+    std::vector<utils::Json> benchmarks;
+    for (const auto &r : results_) {
+      utils::Json b;
+      b["name"] = utils::Json(std::string_view(r.name));
+      b["batch_size"] = utils::Json(r.batch_size);
+      b["median_ns"] = utils::Json(r.median_ns);
+      b["mad_ns"] = utils::Json(r.mad_ns);
+      b["min_ns"] = utils::Json(r.min_ns);
+      b["mean_ns"] = utils::Json(r.mean_ns);
+      b["samples_ns"] = utils::Json(r.samples_ns);
+      benchmarks.push_back(std::move(b));
+    }
+    json["benchmarks"] = utils::Json(benchmarks);
+    return json;
+  }
+
+private:
+  // Nanoseconds for 'batch' calls of f.
+  template <typename F>
+  static double time_batch(F &f, std::size_t batch) {
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < batch; ++i) {
+      f();
+      clobber_memory();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+  }
+
+  static std::string format_ns(double ns) {
+    char buffer[32];
+    if (ns < 1e3) {
+      std::snprintf(buffer, sizeof(buffer), "%.1f ns", ns);
+    } else if (ns < 1e6) {
+      std::snprintf(buffer, sizeof(buffer), "%.2f us", ns / 1e3);
+    } else if (ns < 1e9) {
+      std::snprintf(buffer, sizeof(buffer), "%.2f ms", ns / 1e6);
+    } else {
+      std::snprintf(buffer, sizeof(buffer), "%.2f s", ns / 1e9);
+    }
+    return buffer;
+  }
+
+  std::string filter_;
+  std::string json_path_;
+  std::size_t samples_ = 15;
+  double min_batch_ms_ = 10.0;
+  bool list_only_ = false;
+  std::vector<Result> results_;
+};
+
+/**
+ * main() for a benchmark executable: 'body' registers benchmarks on the
+ * Runner it is given.
+ */
+template <typename Body>
+int main(int argc, char **argv, Body &&body) {
+  try {
+    Runner runner(argc, argv);
+    body(runner);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,103 @@
+#include "utils_cpp/avl_tree.hpp"
+#include "utils_cpp/btree.hpp"
+#include "utils_cpp/interval_tree.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace utils;
+
+// Nanoseconds per call of f(i) for i in [0, n).
+template <typename F>
+double ns_per_op(std::size_t n, F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < n; ++i) {
+    f(i);
+  }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() /
+         static_cast<double>(n);
+}
+
+int main() {
+  std::mt19937 rng(1);
+
+  // If inserts and erases are O(log n), the time per operation divided by
+  // log2(n) stays roughly flat as n grows by a factor of 1000.
+  std::printf("%9s %8s | %12s %12s | %12s %12s\n", "n", "height",
+              "avl insert", "avl erase", "itv insert", "itv erase");
+  std::printf("%9s %8s | %12s %12s | %12s %12s\n", "", "",
+              "ns/log2(n)", "ns/log2(n)", "ns/log2(n)", "ns/log2(n)");
+
+  for (std::size_t n = 1000; n <= 1000000; n *= 10) {
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    double log_n = std::log2(static_cast<double>(n));
+
+    AVLTree<int> avl;
+    double avl_insert = ns_per_op(n, [&](std::size_t i) { avl.insert(keys[i]); });
+    std::size_t height = avl.height();
+    std::shuffle(keys.begin(), keys.end(), rng);
+    double avl_erase = ns_per_op(n, [&](std::size_t i) { avl.erase(keys[i]); });
+
+    IntervalTree<int> intervals;
+    double itv_insert = ns_per_op(
+        n, [&](std::size_t i) { intervals.insert(keys[i], keys[i] + 10); });
+    std::shuffle(keys.begin(), keys.end(), rng);
+    double itv_erase = ns_per_op(
+        n, [&](std::size_t i) { intervals.erase(keys[i], keys[i] + 10); });
+
+    std::printf("%9zu %8zu | %12.2f %12.2f | %12.2f %12.2f\n", n, height,
+                avl_insert / log_n, avl_erase / log_n, itv_insert / log_n,
+                itv_erase / log_n);
+  }
+
+  // Loading a sorted batch: one insert per key against one O(n) build.
+  std::size_t n = 1000000;
+  std::vector<int> sorted(n);
+  std::iota(sorted.begin(), sorted.end(), 0);
+
+  AVLTree<int> inserted;
+  double insert_ns =
+      ns_per_op(n, [&](std::size_t i) { inserted.insert(sorted[i]); });
+
+  auto start = std::chrono::steady_clock::now();
+  auto built = AVLTree<int>::from_sorted(sorted.begin(), sorted.end());
+  auto stop = std::chrono::steady_clock::now();
+  double build_ns =
+      std::chrono::duration<double, std::nano>(stop - start).count() /
+      static_cast<double>(n);
+
+  std::printf("\nsorted load of %zu keys: insert %.2f ns/key, from_sorted "
+              "%.2f ns/key (%.1fx)\n",
+              n, insert_ns, build_ns, insert_ns / build_ns);
+  std::printf("nth(n / 2) = %d, rank(n / 2) = %zu\n", built.nth(n / 2),
+              built.rank(static_cast<int>(n / 2)));
+
+  // The same random workload on AVLTree and BTreeSet, which share an
+  // interface.
+  std::vector<int> keys(n);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), rng);
+  std::printf("\n%12s %12s %12s %12s\n", "", "insert ns", "contains ns",
+              "erase ns");
+  auto run = [&](const char *name, auto &tree) {
+    double insert = ns_per_op(n, [&](std::size_t i) { tree.insert(keys[i]); });
+    std::size_t found = 0;
+    double contains =
+        ns_per_op(n, [&](std::size_t i) { found += tree.contains(keys[i]); });
+    double erase = ns_per_op(n, [&](std::size_t i) { tree.erase(keys[i]); });
+    std::printf("%12s %12.2f %12.2f %12.2f%s\n", name, insert, contains, erase,
+                found == n ? "" : " (lookup mismatch)");
+  };
+  AVLTree<int> avl_set;
+  run("AVLTree", avl_set);
+  BTreeSet<int> btree_set;
+  run("BTreeSet", btree_set);
+}
@@ -0,0 +1,72 @@
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+#include "utils_cpp/graph/transforms.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+using namespace utils;
+
+// Milliseconds per call of f().
+template <typename F>
+double ms_per_call(std::size_t repeats, F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < repeats; ++i) {
+    f();
+  }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(stop - start).count() /
+         static_cast<double>(repeats);
+}
+
+void run(const char *name, const gl::Graph &g, double seconds_to_order) {
+  constexpr std::size_t repeats = 5;
+  gl::CsrGraph<> csr(g);
+
+  std::size_t checksum = 0;
+  double bfs = ms_per_call(repeats, [&] {
+    checksum += gl::bfs_distances(g, 0).back();
+  });
+  double csr_bfs = ms_per_call(repeats, [&] {
+    checksum += gl::bfs_distances(csr, 0).back();
+  });
+  double csr_dijkstra = ms_per_call(repeats, [&] {
+    checksum += gl::dijkstra_distances(csr, 0).back();
+  });
+
+  std::printf("%-10s | %10.1f | %10.1f %10.1f %12.1f | %zu\n", name,
+              1000 * seconds_to_order, bfs, csr_bfs, csr_dijkstra,
+              checksum % 10);
+}
+
+int main() {
+
+  // A 1000 x 1000 grid whose labels have been shuffled, so that neighbors are
+  // scattered all over memory.
+  gl::Graph grid = gl::grid(1000, 1000).graph;
+  gl::Graph g = gl::shuffle_vertex_labels(grid, 1u);
+
+  // The last column only keeps the traversals from being optimized away.
+  std::printf("%-10s | %10s | %10s %10s %12s |\n", "order", "reorder", "bfs",
+              "csr bfs", "csr dijkstra");
+  std::printf("%-10s | %10s | %10s %10s %12s |\n", "", "ms", "ms", "ms", "ms");
+
+  run("original", grid, 0);
+  run("shuffled", g, 0);
+
+  std::pair<const char *, gl::VertexOrder> methods[] = {
+      {"rcm", gl::VertexOrder::rcm},
+      {"bfs", gl::VertexOrder::bfs},
+      {"degree", gl::VertexOrder::degree},
+      {"gorder", gl::VertexOrder::gorder}};
+
+  for (auto [name, method] : methods) {
+    auto start = std::chrono::steady_clock::now();
+    auto [h, new_index] = gl::reorder_vertices(g, method);
+    auto stop = std::chrono::steady_clock::now();
+    run(name, h, std::chrono::duration<double>(stop - start).count());
+  }
+}
@@ -0,0 +1,112 @@
+#include "utils_cpp/graph/bitadjmat.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/vecbooladjmat.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace utils;
+
+// Milliseconds per call of f().
+template <typename F>
+double ms_per_call(std::size_t repeats, F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < repeats; ++i) {
+    f();
+  }
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(stop - start).count() /
+         static_cast<double>(repeats);
+}
+
+// The previous VecBoolAdjmat storage: one vector<bool> of n * n entries,
+// accessed one bit at a time.
+struct VectorBoolMatrix {
+  std::size_t n;
+  std::vector<bool> bits;
+
+  explicit VectorBoolMatrix(const gl::Graph &g)
+      : n{boost::num_vertices(g)}, bits(n * n) {
+    for (auto [ei, end] = boost::edges(g); ei != end; ++ei) {
+      auto u = boost::source(*ei, g);
+      auto v = boost::target(*ei, g);
+      bits[u * n + v] = true;
+      bits[v * n + u] = true;
+    }
+  }
+
+  std::size_t neighbor_sum() const {
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        if (bits[i * n + j]) {
+          sum += j;
+        }
+      }
+    }
+    return sum;
+  }
+
+  std::size_t count_ones() const {
+    std::size_t count = 0;
+    for (bool b : bits) {
+      count += b;
+    }
+    return count;
+  }
+
+  void xor_with(const VectorBoolMatrix &other) {
+    for (std::size_t i = 0; i < bits.size(); ++i) {
+      bits[i] = bits[i] != other.bits[i];
+    }
+  }
+};
+
+template <typename M> std::size_t neighbor_sum(const M &m, std::size_t n) {
+  std::size_t sum = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    for (auto j : m[i]) {
+      sum += j;
+    }
+  }
+  return sum;
+}
+
+int main() {
+
+  constexpr std::size_t n = 4000;
+  constexpr std::size_t repeats = 5;
+
+  gl::Graph g = gl::random(n, 0.01, 1u).graph;
+  gl::Graph h = gl::random(n, 0.01, 2u).graph;
+
+  VectorBoolMatrix old_g(g), old_h(h);
+  gl::VecBoolAdjmat vec_g(g), vec_h(h);
+  gl::BitAdjmat bit_g(g), bit_h(h);
+
+  // The checksums keep the loops from being optimized away; they match
+  // across rows.
+  std::printf("%-15s | %10s %10s %10s | %s\n", "storage", "rows", "count",
+              "xor", "checksum");
+  std::printf("%-15s | %10s %10s %10s |\n", "", "ms", "ms", "ms");
+
+  std::size_t sum = 0, ones = 0;
+  double rows = ms_per_call(repeats, [&] { sum = old_g.neighbor_sum(); });
+  double count = ms_per_call(repeats, [&] { ones = old_g.count_ones(); });
+  double xors = ms_per_call(repeats, [&] { old_g.xor_with(old_h); });
+  std::printf("%-15s | %10.2f %10.2f %10.2f | %zu %zu\n", "vector<bool>", rows,
+              count, xors, sum, ones);
+
+  rows = ms_per_call(repeats, [&] { sum = neighbor_sum(vec_g, n); });
+  count = ms_per_call(repeats, [&] { ones = vec_g.count_ones(); });
+  xors = ms_per_call(repeats, [&] { vec_g ^= vec_h; });
+  std::printf("%-15s | %10.2f %10.2f %10.2f | %zu %zu\n", "VecBoolAdjmat",
+              rows, count, xors, sum, ones);
+
+  rows = ms_per_call(repeats, [&] { sum = neighbor_sum(bit_g, n); });
+  count = ms_per_call(repeats, [&] { ones = bit_g.count_ones(); });
+  xors = ms_per_call(repeats, [&] { bit_g ^= bit_h; });
+  std::printf("%-15s | %10.2f %10.2f %10.2f | %zu %zu\n", "BitAdjmat", rows,
+              count, xors, sum, ones);
+}
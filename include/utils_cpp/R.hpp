@@ -1,6 +1,8 @@
 /**********************************************************************
  * @brief Replication of some of the basic features of R.
- * @details
+ * @details seq, rep and fapply return vectors; seq_view, rep_view and
+ *fapply_view are lazy views of the same elements, for composing with
+ *std::views without temporaries.
  * @author Sam Tonetto
  * @copyright GNU Public License
  * @date 2023
@@ -8,59 +10,102 @@
 
 #pragma once
 
+#include <cmath>
 #include <cstddef>
+#include <ranges>
+#include <stdexcept>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "metaprogramming/is_instantiation.hpp"
+#include "utils_cpp/ranges.hpp"
 
 namespace utils {
 
+namespace detail {
+
 /**
- * @brief Create a sequence of values from start to end inclusive, increasing by
- * by.
+ * @internal
+ * @brief Number of elements of seq(start, end, by). As in R, floating-point
+ * sequences allow 1e-10 steps of rounding error at the end, so
+ * seq(0.0, 0.3, 0.1) has 4 elements.
  */
 template <typename T>
-  requires std::is_arithmetic_v<T>
-std::vector<T> seq(T start, T end, T by = static_cast<T>(1)) {
-
+std::size_t seq_length(T start, T end, T by) {
   if (by == 0 || (start < end && by < 0) || (start > end && by > 0)) {
     throw std::invalid_argument("Invalid arguments for seq.");
   }
+  if constexpr (std::is_integral_v<T>) {
+    // In unsigned arithmetic, so that end - start cannot overflow.
+    using U = std::make_unsigned_t<T>;
+    U distance = start <= end ? static_cast<U>(static_cast<U>(end) -
+                                               static_cast<U>(start))
+                              : static_cast<U>(static_cast<U>(start) -
+                                               static_cast<U>(end));
+    U magnitude = by > 0 ? static_cast<U>(by)
+                         : static_cast<U>(U{0} - static_cast<U>(by));
+    return static_cast<std::size_t>(distance / magnitude) + 1;
+  } else {
+    return static_cast<std::size_t>(std::floor((end - start) / by + 1e-10)) +
+           1;
+  }
+}
 
-  std::vector<T> result;
-  result.reserve((end - start) / by + 1);
+} // namespace detail
 
-  if (by > 0) {
-    for (T i = start; i <= end; i += by) {
-      result.push_back(i);
-    }
+/**
+ * @brief Create a sequence of values from start to end inclusive, increasing by
+ * by, as a lazy random-access view (see LinearView). Element i is
+ * start + i * by.
+ * @throws std::invalid_argument if by is zero or points away from end
+ */
+template <typename T>
+  requires std::is_arithmetic_v<T>
+LinearView<T> seq_view(T start, T end, T by = static_cast<T>(1)) {
+  return LinearView<T>(start, by, detail::seq_length(start, end, by));
+}
+
+/**
+ * @brief Create a sequence of values from start to end inclusive, increasing by
+ * by.
+ */
+template <typename T>
+  requires std::is_arithmetic_v<T>
+std::vector<T> seq(T start, T end, T by = static_cast<T>(1)) {
+  return seq_view(start, end, by).to_vector();
+}
+
+/**
+ * @brief rep as a lazy random-access view (see CycleView). A vector is
+ * referenced if it is an lvalue, which must then outlive the view, and moved
+ * into the view otherwise.
+ */
+template <typename T>
+auto rep_view(T &&v, std::size_t times, std::size_t each) {
+  using U = std::remove_cvref_t<T>;
+  if constexpr (is_instantiation<std::vector, U>()) {
+    auto base = std::views::all(std::forward<T>(v));
+    std::size_t size = std::ranges::size(base) * times * each;
+    return CycleView<decltype(base)>(std::move(base), size);
   } else {
-    // Note: If T is unsigned, by > 0 should always be true.
-    for (T i = start; i >= end; i += by) {
-      result.push_back(i);
-    }
+    return CycleView<std::ranges::single_view<U>>(
+        std::ranges::single_view<U>(std::forward<T>(v)), times * each);
   }
-  return result;
 }
 
 /**
  * @brief If 'value' is a scalar, return a vector of length 'times * each' with
  * each element equal to 'value'. If 'value' is a vector, return a new vector
- * where each element of 'value' has been repeated 'each' times, and the
- * resulting vector has been repeated 'times' times.
+ * holding 'times * each' copies of it, one after the other.
  */
 template <typename T>
 auto rep(const T &v, std::size_t times, std::size_t each) {
   if constexpr (is_instantiation<std::vector, T>()) {
     std::vector<typename T::value_type> result;
     result.reserve(v.size() * times * each);
-    for (std::size_t i = 0; i < times; ++i) {
-      for (std::size_t j = 0; j < each; ++j) {
-        for (const auto &value : v) {
-          result.push_back(value);
-        }
-      }
+    for (std::size_t i = 0; i < times * each; ++i) {
+      result.insert(result.end(), v.begin(), v.end());
     }
     return result;
   } else {
@@ -131,4 +176,37 @@ std::pair<U, V> fapply(const std::pair<U, V> &pair, Function func) {
   return result;
 }
 
+template <typename R, typename Function>
+auto fapply_view(R &&r, Function func);
+
+namespace detail {
+
+template <typename T, typename Function>
+auto fapply_element(const T &x, const Function &func) {
+  if constexpr (is_instantiation<std::vector, T>()) {
+    return fapply_view(x, func);
+  } else if constexpr (is_instantiation<std::pair, T>()) {
+    return std::pair(fapply_element(x.first, func),
+                     fapply_element(x.second, func));
+  } else {
+    return func(x);
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief fapply as a lazy view: nested vectors become nested views, pairs
+ * become pairs of their mapped members, and func is only called when an
+ * element is read. Random-access if r is. Nothing is allocated, but the
+ * view refers to r, which must outlive it unless it is an rvalue.
+ */
+template <typename R, typename Function>
+auto fapply_view(R &&r, Function func) {
+  return std::views::transform(
+      std::forward<R>(r), [func](const auto &x) {
+        return detail::fapply_element(x, func);
+      });
+}
+
 } // namespace utils
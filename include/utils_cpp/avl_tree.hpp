@@ -8,8 +8,16 @@
 
 #pragma once
 
+#include "utils_cpp/node_pool.hpp"
+
 #include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace utils {
 
@@ -18,51 +26,130 @@ namespace utils {
  * the height of the left and right subtrees of the root differ by at most 1.
  * This leads to a worst-case time complexity of O(log n) for lookups,
  * insertions, and deletions.
+ *
+ * Nodes live in a NodePool that gets its slabs from Allocator, so building
+ * a tree makes few allocations and clear() or destruction frees the slabs
+ * at once rather than node by node.
+ *
+ * Every node also caches the size of its subtree, which gives O(log n)
+ * rank() and nth(), and split() and join() in O(log n). The tree returned by
+ * split() shares its pool with the tree it came from; a pool shared that way
+ * is only freed slab by slab once one tree is left using it.
+ *
+ * Trees that share a pool are not independent for threading purposes: the
+ * pool is not synchronised, so two such trees must not be modified (or
+ * destroyed) at the same time from different threads, even though they are
+ * different objects. Join them back, or replace one with its clone(), to
+ * give each its own pool.
  */
-template <typename T, typename Compare = std::less<T>>
+template <typename T, typename Compare = std::less<T>,
+          typename Allocator = std::allocator<T>>
 class AVLTree {
 
 public:
   AVLTree() : root{nullptr} {}
-  ~AVLTree() { delete root; }
+  explicit AVLTree(const Allocator &alloc) : root{nullptr}, alloc{alloc} {}
+  ~AVLTree() { destroy_nodes(); }
   AVLTree(const AVLTree &) = delete;
   AVLTree &operator=(const AVLTree &) = delete;
-  AVLTree(AVLTree &&other) noexcept : root(std::move(other.root)) {}
+  AVLTree(AVLTree &&other) noexcept
+      : root{std::exchange(other.root, nullptr)}, alloc{other.alloc},
+        pool{std::move(other.pool)} {}
 
   AVLTree &operator=(AVLTree &&other) noexcept {
-    root = std::move(other.root);
+    if (this != &other) {
+      destroy_nodes();
+      root = std::exchange(other.root, nullptr);
+      alloc = other.alloc;
+      pool = std::move(other.pool);
+    }
     return *this;
   }
 
+  /**
+   * Builds a perfectly balanced tree from the strictly increasing keys in
+   * [first, last) in O(n), with the nodes in one slab in key order. Throws
+   * std::invalid_argument if the keys are not strictly increasing.
+   */
+  template <std::forward_iterator It>
+  static AVLTree from_sorted(It first, It last,
+                             const Allocator &alloc = Allocator());
+
+  /**
+   * A deep copy whose nodes are in one contiguous slab.
+   */
   AVLTree clone() const;
 
+  /**
+   * Removes every key. O(1) in the number of nodes when T is trivially
+   * destructible.
+   */
+  void clear() noexcept {
+    destroy_nodes();
+    root = nullptr;
+  }
+
+  std::size_t size() const noexcept { return subtree_size(root); }
+  bool empty() const noexcept { return root == nullptr; }
+
   bool insert(const T &key);
 
   bool contains(const T &key) const { return contains(root, key); }
   void erase(const T &key);
 
-  std::size_t height() const { return height(root); }
+  /**
+   * Height of the tree, 0 for a single node. O(1).
+   */
+  std::size_t height() const { return static_cast<std::size_t>(height(root)); }
   int balance() const { return root->balance; }
 
   T min() const;
   T max() const;
 
+  /**
+   * Number of keys less than key. O(log n).
+   */
+  std::size_t rank(const T &key) const;
+
+  /**
+   * The k-th smallest key, counting from 0. O(log n). Throws
+   * std::out_of_range if k >= size().
+   */
+  const T &nth(std::size_t k) const;
+
+  /**
+   * Moves every key not less than key into the returned tree, leaving the
+   * smaller ones here. O(log n).
+   */
+  AVLTree split(const T &key);
+
+  /**
+   * Moves every key of other into this tree. Every key of other must be
+   * greater than every key here, otherwise std::invalid_argument is thrown
+   * and neither tree changes. O(log n) when other is the only user of its
+   * pool or shares it with this tree, and O(m) for m keys in other when the
+   * nodes have to be copied.
+   */
+  void join(AVLTree &&other);
+
 protected:
   struct Node {
 
     T key;
     int balance;
+    int height;       // of the subtree rooted here, 0 for a leaf
+    std::size_t size; // number of nodes in the subtree rooted here
     Node *left, *right, *parent;
 
     Node(const T &key, Node *parent = nullptr)
-        : key{key}, balance{0}, left{nullptr}, right{nullptr}, parent{parent} {}
-
-    ~Node() {
-      delete left;
-      delete right;
-    }
+        : key{key}, balance{0}, height{0}, size{1}, left{nullptr},
+          right{nullptr}, parent{parent} {}
   };
 
+  using node_pool = NodePool<
+      Node,
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Node>>;
+
   template <bool IsConst>
   class forward_iterator {
 
@@ -115,6 +202,8 @@ protected:
 
   Node *root;
   Compare cmp;
+  Allocator alloc;
+  std::shared_ptr<node_pool> pool; // created on first use
 
 public:
   using iterator = forward_iterator<false>;
@@ -122,7 +211,7 @@ public:
 
   iterator begin() {
     Node *node = root;
-    while (node->left) {
+    while (node && node->left) {
       node = node->left;
     }
     return iterator(node);
@@ -132,7 +221,7 @@ public:
 
   const_iterator begin() const {
     Node *node = root;
-    while (node->left) {
+    while (node && node->left) {
       node = node->left;
     }
     return const_iterator(node);
@@ -140,10 +229,69 @@ public:
 
   const_iterator end() const { return const_iterator(nullptr); }
 
+  /**
+   * First key not less than key, or end().
+   */
+  iterator lower_bound(const T &key) { return iterator(lower_bound_node(key)); }
+  const_iterator lower_bound(const T &key) const {
+    return const_iterator(lower_bound_node(key));
+  }
+
+  /**
+   * First key greater than key, or end().
+   */
+  iterator upper_bound(const T &key) { return iterator(upper_bound_node(key)); }
+  const_iterator upper_bound(const T &key) const {
+    return const_iterator(upper_bound_node(key));
+  }
+
 private:
   bool contains(Node *node, const T &key) const;
 
-  Node *clone_node(const Node *node) const;
+  Node *lower_bound_node(const T &key) const;
+  Node *upper_bound_node(const T &key) const;
+
+  /**
+   * The pool this tree allocates from, created on first use. It may be shared
+   * with trees from split(), and lives until the last of them is destroyed or
+   * cleared; until then, nodes freed by the others only go back on its free
+   * list. Callers must not use it concurrently with any tree sharing it.
+   */
+  node_pool &nodes() {
+    if (!pool) {
+      pool = std::make_shared<node_pool>(alloc);
+    }
+    return *pool;
+  }
+
+  static Node *clone_node(const Node *node, node_pool &target);
+
+  template <typename It>
+  static Node *build(It &it, std::size_t n, node_pool &target);
+
+  /**
+   * Runs the node destructors if they do anything, without recursion or
+   * allocation, then releases the pool. If another tree still shares the
+   * pool, the nodes go back on its free list one by one instead.
+   */
+  void destroy_nodes() noexcept;
+
+  /**
+   * Splits the subtree at node into the keys less than key and the rest.
+   */
+  std::pair<Node *, Node *> split_node(Node *node, const T &key) const;
+
+  /**
+   * Joins two detached subtrees around the detached node mid, where all
+   * keys in left < mid->key < all keys in right, and returns the new root.
+   * O(|height(left) - height(right)| + 1).
+   */
+  static Node *join_nodes(Node *left, Node *mid, Node *right);
+
+  /**
+   * Unlinks the smallest node of the tree at root, which is updated.
+   */
+  static Node *extract_min(Node *&root);
 
   /**
    * Example, with 'node' being '3' in the left tree.
@@ -155,7 +303,7 @@ private:
    *     1 (0)
    *
    */
-  void rotate_right(Node *node);
+  static void rotate_right(Node *node);
 
   /**
    * Example, with 'node' being '1' in the left tree.
@@ -167,37 +315,136 @@ private:
    *         3 (0)
    *
    */
-  void rotate_left(Node *node);
+  static void rotate_left(Node *node);
 
-  std::size_t height(Node *node) const {
-    if (!node) {
-      return -1;
-    }
-    return 1 + std::max(height(node->left), height(node->right));
+  static int height(const Node *node) { return node ? node->height : -1; }
+  static std::size_t subtree_size(const Node *node) {
+    return node ? node->size : 0;
   }
 
-  void set_balance(Node *node) {
-    node->balance = height(node->right) - height(node->left);
+  /**
+   * Recomputes the cached height, size and balance of node from its children,
+   * which must already be up to date.
+   */
+  static void update(Node *node) {
+    int l = height(node->left), r = height(node->right);
+    node->height = 1 + std::max(l, r);
+    node->balance = r - l;
+    node->size = 1 + subtree_size(node->left) + subtree_size(node->right);
   }
 
-  void rebalance(Node *node);
+  /**
+   * Restores the AVL property from node up to the root, updating cached
+   * heights and sizes on the way, and returns the root. O(log n).
+   */
+  static Node *rebalance(Node *node);
 };
 
 // ==============
 // IMPLEMENTATION
 // ==============
 
-template <typename T, typename Compare>
-AVLTree<T, Compare> AVLTree<T, Compare>::clone() const {
-  AVLTree new_tree;
-  new_tree.root = clone_node(root);
+template <typename T, typename Compare, typename Allocator>
+AVLTree<T, Compare, Allocator>
+AVLTree<T, Compare, Allocator>::clone() const {
+  AVLTree new_tree{alloc};
+  if (root) {
+    new_tree.nodes().reserve(size());
+    new_tree.root = clone_node(root, *new_tree.pool);
+  }
   return new_tree;
 }
 
-template <typename T, typename Compare>
-bool AVLTree<T, Compare>::insert(const T &key) {
+template <typename T, typename Compare, typename Allocator>
+template <std::forward_iterator It>
+AVLTree<T, Compare, Allocator>
+AVLTree<T, Compare, Allocator>::from_sorted(It first, It last,
+                                            const Allocator &alloc) {
+  Compare cmp;
+  if (std::adjacent_find(first, last, [&](const T &a, const T &b) {
+        return !cmp(a, b);
+      }) != last) {
+    throw std::invalid_argument(
+        "AVLTree::from_sorted: keys are not strictly increasing");
+  }
+
+  AVLTree tree{alloc};
+  auto n = static_cast<std::size_t>(std::distance(first, last));
+  if (n > 0) {
+    tree.nodes().reserve(n);
+    tree.root = build(first, n, *tree.pool);
+  }
+  return tree;
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename It>
+AVLTree<T, Compare, Allocator>::Node *
+AVLTree<T, Compare, Allocator>::build(It &it, std::size_t n,
+                                      node_pool &target) {
+  if (n == 0) {
+    return nullptr;
+  }
+
+  // In-order, so the nodes are created in key order. The two subtrees differ
+  // in size by at most one, hence in height by at most one.
+  Node *left = build(it, n / 2, target);
+  Node *node = target.create(*it);
+  ++it;
+  node->left = left;
+  node->right = build(it, n - n / 2 - 1, target);
+
+  if (node->left) {
+    node->left->parent = node;
+  }
+  if (node->right) {
+    node->right->parent = node;
+  }
+  update(node);
+
+  return node;
+}
+
+template <typename T, typename Compare, typename Allocator>
+void AVLTree<T, Compare, Allocator>::destroy_nodes() noexcept {
+  if (!pool) {
+    return;
+  }
+
+  bool shared = pool.use_count() > 1;
+  if (shared || !std::is_trivially_destructible_v<Node>) {
+    // Post-order walk through the parent pointers, unlinking each node
+    // before destroying it.
+    Node *node = root;
+    while (node) {
+      if (node->left) {
+        node = node->left;
+      } else if (node->right) {
+        node = node->right;
+      } else {
+        Node *parent = node->parent;
+        if (parent) {
+          (parent->left == node ? parent->left : parent->right) = nullptr;
+        }
+        if (shared) {
+          pool->destroy(node);
+        } else {
+          std::destroy_at(node);
+        }
+        node = parent;
+      }
+    }
+  }
+  if (!shared) {
+    pool->release();
+  }
+  pool.reset();
+}
+
+template <typename T, typename Compare, typename Allocator>
+bool AVLTree<T, Compare, Allocator>::insert(const T &key) {
   if (!root) {
-    root = new Node(key);
+    root = nodes().create(key);
     return true;
   }
 
@@ -216,12 +463,12 @@ bool AVLTree<T, Compare>::insert(const T &key) {
 
     if (!node) {
       if (go_left) {
-        parent->left = new Node(key, parent);
+        parent->left = pool->create(key, parent);
       } else {
-        parent->right = new Node(key, parent);
+        parent->right = pool->create(key, parent);
       }
 
-      rebalance(parent);
+      root = rebalance(parent);
       break;
     }
   }
@@ -229,8 +476,8 @@ bool AVLTree<T, Compare>::insert(const T &key) {
   return true;
 }
 
-template <typename T, typename Compare>
-bool AVLTree<T, Compare>::contains(Node *node, const T &key) const {
+template <typename T, typename Compare, typename Allocator>
+bool AVLTree<T, Compare, Allocator>::contains(Node *node, const T &key) const {
 
   if (!node) {
     return false;
@@ -245,16 +492,20 @@ bool AVLTree<T, Compare>::contains(Node *node, const T &key) const {
   }
 }
 
-template <typename T, typename Compare>
-AVLTree<T, Compare>::Node *
-AVLTree<T, Compare>::clone_node(const Node *node) const {
+template <typename T, typename Compare, typename Allocator>
+AVLTree<T, Compare, Allocator>::Node *
+AVLTree<T, Compare, Allocator>::clone_node(const Node *node,
+                                           node_pool &target) {
   if (!node) {
     return nullptr;
   }
 
-  Node *new_node = new Node(node->key);
-  new_node->left = clone_node(node->left);
-  new_node->right = clone_node(node->right);
+  Node *new_node = target.create(node->key);
+  new_node->balance = node->balance;
+  new_node->height = node->height;
+  new_node->size = node->size;
+  new_node->left = clone_node(node->left, target);
+  new_node->right = clone_node(node->right, target);
 
   if (new_node->left) {
     new_node->left->parent = new_node;
@@ -266,8 +517,8 @@ AVLTree<T, Compare>::clone_node(const Node *node) const {
   return new_node;
 }
 
-template <typename T, typename Compare>
-void AVLTree<T, Compare>::rotate_right(Node *node) {
+template <typename T, typename Compare, typename Allocator>
+void AVLTree<T, Compare, Allocator>::rotate_right(Node *node) {
 
   Node *tmp = node->left;
   tmp->parent = node->parent;
@@ -288,12 +539,12 @@ void AVLTree<T, Compare>::rotate_right(Node *node) {
     }
   }
 
-  set_balance(node);
-  set_balance(tmp);
+  update(node);
+  update(tmp);
 }
 
-template <typename T, typename Compare>
-void AVLTree<T, Compare>::rotate_left(Node *node) {
+template <typename T, typename Compare, typename Allocator>
+void AVLTree<T, Compare, Allocator>::rotate_left(Node *node) {
   Node *tmp = node->right;
   tmp->parent = node->parent;
   node->right = tmp->left;
@@ -313,93 +564,317 @@ void AVLTree<T, Compare>::rotate_left(Node *node) {
     }
   }
 
-  set_balance(node);
-  set_balance(tmp);
+  update(node);
+  update(tmp);
 }
 
-template <typename T, typename Compare>
-void AVLTree<T, Compare>::rebalance(Node *node) {
+template <typename T, typename Compare, typename Allocator>
+AVLTree<T, Compare, Allocator>::Node *
+AVLTree<T, Compare, Allocator>::rebalance(Node *node) {
 
-  set_balance(node);
+  while (true) {
+    update(node);
 
-  if (node->balance == -2) {
-    if (height(node->left->left) >= height(node->left->right)) {
-      rotate_right(node);
+    if (node->balance == -2) {
+      if (height(node->left->left) >= height(node->left->right)) {
+        rotate_right(node);
+      } else {
+        rotate_left(node->left);
+        rotate_right(node);
+      }
+      node = node->parent;
+    } else if (node->balance == 2) {
+      if (height(node->right->right) >= height(node->right->left)) {
+        rotate_left(node);
+      } else {
+        rotate_right(node->right);
+        rotate_left(node);
+      }
+      node = node->parent;
+    }
+
+    if (!node->parent) {
+      return node;
+    }
+    node = node->parent;
+  }
+}
+
+template <typename T, typename Compare, typename Allocator>
+void AVLTree<T, Compare, Allocator>::erase(const T &key) {
+  Node *node = root;
+  while (node && (cmp(key, node->key) || cmp(node->key, key))) {
+    node = cmp(key, node->key) ? node->left : node->right;
+  }
+  if (!node) {
+    return;
+  }
+
+  // With two children, take the in-order successor's key and remove the
+  // successor instead, which has no left child.
+  if (node->left && node->right) {
+    Node *successor = node->right;
+    while (successor->left) {
+      successor = successor->left;
+    }
+    node->key = std::move(successor->key);
+    node = successor;
+  }
+
+  Node *child = node->left ? node->left : node->right;
+  Node *parent = node->parent;
+  if (child) {
+    child->parent = parent;
+  }
+  if (!parent) {
+    root = child;
+  } else if (parent->left == node) {
+    parent->left = child;
+  } else {
+    parent->right = child;
+  }
+
+  pool->destroy(node);
+
+  if (parent) {
+    root = rebalance(parent);
+  }
+}
+
+template <typename T, typename Compare, typename Allocator>
+T AVLTree<T, Compare, Allocator>::min() const {
+  Node *node = root;
+  while (node->left) {
+    node = node->left;
+  }
+  return node->key;
+}
+
+template <typename T, typename Compare, typename Allocator>
+T AVLTree<T, Compare, Allocator>::max() const {
+  Node *node = root;
+  while (node->right) {
+    node = node->right;
+  }
+  return node->key;
+}
+
+template <typename T, typename Compare, typename Allocator>
+std::size_t AVLTree<T, Compare, Allocator>::rank(const T &key) const {
+  std::size_t r = 0;
+  Node *node = root;
+  while (node) {
+    if (cmp(node->key, key)) {
+      r += subtree_size(node->left) + 1;
+      node = node->right;
     } else {
-      rotate_left(node->left);
-      rotate_right(node);
+      node = node->left;
     }
-  } else if (node->balance == 2) {
-    if (height(node->right->right) >= height(node->right->left)) {
-      rotate_left(node);
+  }
+  return r;
+}
+
+template <typename T, typename Compare, typename Allocator>
+const T &AVLTree<T, Compare, Allocator>::nth(std::size_t k) const {
+  if (k >= size()) {
+    throw std::out_of_range("AVLTree::nth: index out of range");
+  }
+
+  Node *node = root;
+  while (true) {
+    std::size_t left = subtree_size(node->left);
+    if (k < left) {
+      node = node->left;
+    } else if (k == left) {
+      return node->key;
     } else {
-      rotate_right(node->right);
-      rotate_left(node);
+      k -= left + 1;
+      node = node->right;
     }
   }
+}
 
-  if (node->parent) {
-    rebalance(node->parent);
-  } else {
-    root = node;
+template <typename T, typename Compare, typename Allocator>
+AVLTree<T, Compare, Allocator>::Node *
+AVLTree<T, Compare, Allocator>::lower_bound_node(const T &key) const {
+  Node *node = root, *result = nullptr;
+  while (node) {
+    if (cmp(node->key, key)) {
+      node = node->right;
+    } else {
+      result = node;
+      node = node->left;
+    }
   }
+  return result;
 }
 
-template <typename T, typename Compare>
-void AVLTree<T, Compare>::erase(const T &key) {
+template <typename T, typename Compare, typename Allocator>
+AVLTree<T, Compare, Allocator>::Node *
+AVLTree<T, Compare, Allocator>::upper_bound_node(const T &key) const {
+  Node *node = root, *result = nullptr;
+  while (node) {
+    if (cmp(key, node->key)) {
+      result = node;
+      node = node->left;
+    } else {
+      node = node->right;
+    }
+  }
+  return result;
+}
+
+template <typename T, typename Compare, typename Allocator>
+AVLTree<T, Compare, Allocator>
+AVLTree<T, Compare, Allocator>::split(const T &key) {
+  AVLTree right_tree{alloc};
   if (!root) {
-    return;
+    return right_tree;
   }
 
-  AVLTree<T, Compare>::Node *node = root, *parent = root,
-                            *node_to_delete = nullptr, *child = root;
+  auto [left, right] = split_node(root, key);
+  root = left;
+  right_tree.root = right;
+  if (right) {
+    right_tree.pool = pool;
+  }
+  if (!root) {
+    pool.reset();
+  }
+  return right_tree;
+}
 
-  while (child) {
-    parent = node;
-    node = child;
+template <typename T, typename Compare, typename Allocator>
+void AVLTree<T, Compare, Allocator>::join(AVLTree &&other) {
+  if (this == &other || !other.root) {
+    return;
+  }
+  if (!root) {
+    *this = std::move(other);
+    return;
+  }
 
-    child = cmp(key, node->key) ? node->left : node->right;
-    if (key == node->key) {
-      node_to_delete = node;
+  Node *last = root;
+  while (last->right) {
+    last = last->right;
+  }
+  Node *first = other.root;
+  while (first->left) {
+    first = first->left;
+  }
+  if (!cmp(last->key, first->key)) {
+    throw std::invalid_argument("AVLTree::join: key ranges overlap");
+  }
+
+  Node *right = other.root;
+  if (other.pool != pool) {
+    if (other.pool.use_count() == 1 &&
+        other.pool->get_allocator() == pool->get_allocator()) {
+      pool->splice(std::move(*other.pool));
+    } else {
+      pool->reserve(other.size());
+      right = clone_node(other.root, *pool);
+      other.destroy_nodes();
     }
   }
+  other.root = nullptr;
+  other.pool.reset();
 
-  if (node_to_delete) {
-    node_to_delete->key = node->key;
+  Node *mid = extract_min(right);
+  root = join_nodes(root, mid, right);
+}
 
-    child = (node->left != nullptr) ? node->left : node->right;
+template <typename T, typename Compare, typename Allocator>
+std::pair<typename AVLTree<T, Compare, Allocator>::Node *,
+          typename AVLTree<T, Compare, Allocator>::Node *>
+AVLTree<T, Compare, Allocator>::split_node(Node *node, const T &key) const {
+  if (!node) {
+    return {nullptr, nullptr};
+  }
 
-    if (root->key == key) {
-      root = child;
-    } else {
+  Node *left = node->left, *right = node->right;
+  if (left) {
+    left->parent = nullptr;
+  }
+  if (right) {
+    right->parent = nullptr;
+  }
+  node->left = node->right = node->parent = nullptr;
 
-      if (parent->left == node) {
-        parent->left = child;
-      } else {
-        parent->right = child;
-      }
+  // Each join is O(height difference), and the differences along the search
+  // path add up to O(log n).
+  if (cmp(node->key, key)) {
+    auto [less, rest] = split_node(right, key);
+    return {join_nodes(left, node, less), rest};
+  }
+  auto [less, rest] = split_node(left, key);
+  return {less, join_nodes(rest, node, right)};
+}
 
-      rebalance(parent);
+template <typename T, typename Compare, typename Allocator>
+AVLTree<T, Compare, Allocator>::Node *
+AVLTree<T, Compare, Allocator>::join_nodes(Node *left, Node *mid,
+                                           Node *right) {
+  int hl = height(left), hr = height(right);
+
+  if (hl > hr + 1) {
+    // Hang mid off the right spine of left, next to a subtree as tall as
+    // right or one taller.
+    Node *parent = nullptr, *node = left;
+    while (height(node) > hr + 1) {
+      parent = node;
+      node = node->right;
+    }
+    mid->left = node;
+    mid->right = right;
+    parent->right = mid;
+    mid->parent = parent;
+  } else if (hr > hl + 1) {
+    Node *parent = nullptr, *node = right;
+    while (height(node) > hl + 1) {
+      parent = node;
+      node = node->left;
     }
+    mid->left = left;
+    mid->right = node;
+    parent->left = mid;
+    mid->parent = parent;
+  } else {
+    mid->left = left;
+    mid->right = right;
+    mid->parent = nullptr;
   }
+
+  if (mid->left) {
+    mid->left->parent = mid;
+  }
+  if (mid->right) {
+    mid->right->parent = mid;
+  }
+  return rebalance(mid);
 }
 
-template <typename T, typename Compare>
-T AVLTree<T, Compare>::min() const {
+template <typename T, typename Compare, typename Allocator>
+AVLTree<T, Compare, Allocator>::Node *
+AVLTree<T, Compare, Allocator>::extract_min(Node *&root) {
   Node *node = root;
   while (node->left) {
     node = node->left;
   }
-  return node->key;
-}
 
-template <typename T, typename Compare>
-T AVLTree<T, Compare>::max() const {
-  Node *node = root;
-  while (node->right) {
-    node = node->right;
+  Node *parent = node->parent;
+  if (node->right) {
+    node->right->parent = parent;
   }
-  return node->key;
+  if (parent) {
+    parent->left = node->right;
+    root = rebalance(parent);
+  } else {
+    root = node->right;
+  }
+
+  node->right = node->parent = nullptr;
+  return node;
 }
 
 } // namespace utils
@@ -1,40 +1,206 @@
 #pragma once
 
 #include <algorithm>
-#include <iomanip>
+#include <bit>
+#include <charconv>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <limits>
-#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#if !defined(__SIZEOF_INT128__)
+#error "bigint.hpp requires a compiler with unsigned __int128"
+#endif
+
 namespace utils {
+
+namespace detail {
+
+/// One binary digit of a BigInt magnitude.
+using limb = std::uint64_t;
+
+__extension__ typedef unsigned __int128 uint128;
+
+/// Largest power of ten that fits in a limb, and its number of zeros.
+constexpr limb limb_decimal_base = 10000000000000000000ull;
+constexpr std::size_t limb_decimal_digits = 19;
+
+/// Multiplication tiers, by limbs of the smaller operand: schoolbook below
+/// karatsuba_threshold, then Karatsuba, Toom-3, and a three-prime
+/// number-theoretic transform from ntt_threshold on.
+constexpr std::size_t karatsuba_threshold = 32;
+constexpr std::size_t toom3_threshold = 250;
+constexpr std::size_t ntt_threshold = 5000;
+
+/// The same tiers for squaring, which has cheaper base cases.
+constexpr std::size_t sqr_karatsuba_threshold = 48;
+constexpr std::size_t sqr_toom3_threshold = 250;
+constexpr std::size_t sqr_ntt_threshold = 5000;
+
+/// Below this many limbs of the divisor, or of the quotient, division is
+/// Knuth's algorithm D rather than Burnikel-Ziegler.
+constexpr std::size_t burnikel_ziegler_threshold = 48;
+
+/// Below this many limbs, conversion to and from decimal is quadratic rather
+/// than divide and conquer.
+constexpr std::size_t radix_conversion_threshold = 32;
+
+/// A vector of limbs that keeps up to two of them (128 bits) inline, so small
+/// BigInts never touch the heap. Copies reuse the existing capacity. It only
+/// has the std::vector operations BigInt needs, and new or resized limbs from
+/// the heap are only zeroed by resize and assign.
+class LimbVector {
+public:
+  using value_type = limb;
+  using iterator = limb *;
+  using const_iterator = const limb *;
+
+  LimbVector() = default;
+  LimbVector(std::size_t n, limb v = 0) { assign(n, v); }
+  template <std::input_iterator It> LimbVector(It first, It last) {
+    assign(first, last);
+  }
+  LimbVector(const LimbVector &o) { assign(o.begin(), o.end()); }
+  LimbVector(LimbVector &&o) noexcept { steal(o); }
+  ~LimbVector() { release(); }
+
+  LimbVector &operator=(const LimbVector &o) {
+    if (this != &o)
+      assign(o.begin(), o.end());
+    return *this;
+  }
+
+  LimbVector &operator=(LimbVector &&o) noexcept {
+    if (this != &o) {
+      release();
+      steal(o);
+    }
+    return *this;
+  }
+
+  std::size_t size() const { return size_; }
+  std::size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+  bool is_inline() const { return data_ == inline_; }
+
+  limb *data() { return data_; }
+  const limb *data() const { return data_; }
+  limb *begin() { return data_; }
+  const limb *begin() const { return data_; }
+  limb *end() { return data_ + size_; }
+  const limb *end() const { return data_ + size_; }
+  limb &operator[](std::size_t i) { return data_[i]; }
+  limb operator[](std::size_t i) const { return data_[i]; }
+  limb &back() { return data_[size_ - 1]; }
+  limb back() const { return data_[size_ - 1]; }
+
+  void reserve(std::size_t n) {
+    if (n > capacity_)
+      grow(n);
+  }
+
+  void resize(std::size_t n) {
+    reserve(n);
+    if (n > size_)
+      std::fill(data_ + size_, data_ + n, limb{0});
+    size_ = n;
+  }
+
+  void assign(std::size_t n, limb v) {
+    size_ = 0;
+    reserve(n);
+    std::fill(data_, data_ + n, v);
+    size_ = n;
+  }
+
+  template <std::input_iterator It> void assign(It first, It last) {
+    auto n = static_cast<std::size_t>(std::distance(first, last));
+    size_ = 0;
+    reserve(n);
+    std::copy(first, last, data_);
+    size_ = n;
+  }
+
+  void push_back(limb v) {
+    if (size_ == capacity_)
+      grow(size_ + 1);
+    data_[size_++] = v;
+  }
+
+  void pop_back() { --size_; }
+  void clear() { size_ = 0; }
+
+  friend bool operator==(const LimbVector &u, const LimbVector &v) {
+    return std::equal(u.begin(), u.end(), v.begin(), v.end());
+  }
+
+private:
+  static constexpr std::size_t inline_capacity = 2;
+
+  /// Reallocates to at least n limbs, at least doubling, keeping the
+  /// contents.
+  void grow(std::size_t n) {
+    n = std::max(n, 2 * capacity_);
+    limb *p = new limb[n];
+    std::copy(data_, data_ + size_, p);
+    release();
+    data_ = p;
+    capacity_ = n;
+  }
+
+  void release() {
+    if (data_ != inline_)
+      delete[] data_;
+  }
+
+  /// Takes o's contents, leaving it empty and inline. Assumes nothing is
+  /// owned.
+  void steal(LimbVector &o) {
+    if (o.data_ == o.inline_) {
+      std::copy(o.inline_, o.inline_ + o.size_, inline_);
+      data_ = inline_;
+      capacity_ = inline_capacity;
+    } else {
+      data_ = o.data_;
+      capacity_ = o.capacity_;
+      o.data_ = o.inline_;
+      o.capacity_ = inline_capacity;
+    }
+    size_ = o.size_;
+    o.size_ = 0;
+  }
+
+  limb inline_[inline_capacity] = {};
+  limb *data_ = inline_;
+  std::size_t size_ = 0;
+  std::size_t capacity_ = inline_capacity;
+};
+
+} // namespace detail
+
 /// Class handling operations on arbitrary-precision integers.
 ///
-/// Adapted from https://gist.github.com/ar-pa/957297fb3f88996ead11 with
-/// slight modifications.
-
-/// Basic idea is to store the big integer in a vector where every element
-/// is base 1000000000, such that the least-significant value is the 0th
-/// element. Any arithmetic operations are performed on this vector.
+/// The magnitude is stored in binary, as a vector of 64-bit limbs with the
+/// least-significant limb at index 0, and the sign separately. Arithmetic
+/// works on the limbs directly (with carry-chain additions and 128-bit
+/// products); decimal conversion only happens when reading or printing.
 ///
-/// Some changes:
-/// - Overflow protection converting to and from long long
-/// - Implementing + in terms of += instead of the other way around (saves
-/// copying)
+/// The representation is kept normalized: no most-significant zero limbs,
+/// and zero is an empty vector with sign +1. Magnitudes of up to 128 bits
+/// are stored inline, and the compound assignments work in place, so
+/// arithmetic on small values does not allocate.
 class BigInt {
 public:
-  /// Convert an 'a' vector from one base to another.
-  ///
-  /// @param a The vector-representation to be converted.
-  /// @param old_digits The max-digits in old base.
-  /// @param new_digits The max-digits in new base.
-  static std::vector<int> convert_base(const std::vector<int> &a,
-                                       std::size_t old_digits,
-                                       std::size_t new_digits);
-
-public:
-  using vll = std::vector<long long>;
+  using limb = detail::limb;
 
   /// Zero-initialize.
   BigInt();
@@ -45,38 +211,44 @@ public:
   /// Initialize from numerical string.
   BigInt(const std::string &s);
 
+  /// Number of decimal digits, or 0 for zero.
   int size() const;
 
+  /// Number of bits of the magnitude, or 0 for zero.
+  std::size_t bit_length() const;
+
   bool is_zero() const;
   bool is_even() const;
   bool is_odd() const;
   BigInt abs() const;
   BigInt operator-() const;
 
-  std::string to_string();
+  std::string to_string() const;
 
-  /// From binary vector where the most-significant bit is 0th index.
   void from_long_long(long long v);
+
+  /// From binary vector where the most-significant bit is 0th index.
   void from_binary_vector(const std::vector<int> &v);
+
+  /// From an optionally signed, non-empty string of decimal digits.
+  ///
+  /// @throws std::invalid_argument if s has no digits or contains anything
+  /// else.
   void from_string(const std::string &s);
 
   /// Convert to long long.
   ///
-  /// @warning There are asserts to check when this is impossible, but
-  /// make sure the number can fit inside a long long anyway!
+  /// @throws std::overflow_error if the number does not fit.
   long long to_ll() const;
 
-  /// Map the 'a' vector to a vector-representation with the 0th index
-  /// being the most-significant bit instead of the least-significant, and
-  /// in a new base.
+  /// The digits of the magnitude in new_base, most-significant first.
   ///
   /// For example,
   ///   auto v = this->to_big_endian_vector(2);
-  /// would map 'a' to a base-2 vector-representation that would read the
-  /// same as a normal binary number.
+  /// gives the bits, reading the same as a normal binary number.
   std::vector<int> to_big_endian_vector(int new_base) const;
 
-  /// Pop off redundant zero elements from the 'a' vector, reducing its
+  /// Pop off redundant zero limbs from the 'a' vector, reducing its
   /// size in the process.
   void trim();
 
@@ -98,10 +270,12 @@ public:
   friend BigInt operator/(const BigInt &u, int v);
   friend BigInt operator%(const BigInt &u, const BigInt &v);
 
-  /// Remainder after division by integer.
+  /// Remainder after division by integer, with the sign of u.
   friend int operator%(const BigInt &u, int v);
 
   /// Exponentiation of one BigInt by another.
+  ///
+  /// @throws std::domain_error if v is negative.
   friend BigInt operator^(const BigInt &u, const BigInt &v);
 
   friend bool operator<(const BigInt &u, const BigInt &v);
@@ -115,137 +289,642 @@ public:
   friend std::ostream &operator<<(std::ostream &os, const BigInt &v);
   friend std::istream &operator>>(std::istream &is, BigInt &v);
 
-  /// Find the greatest common divisor of two BigInts.
+  /// Find the (non-negative) greatest common divisor of two BigInts.
   friend BigInt gcd(const BigInt &u, const BigInt &v);
 
   /// Find the least common multiple of two BigInts.
   friend BigInt lcm(const BigInt &u, const BigInt &v);
 
   /// Find the quotient and remainder upon division of BigInt a1 by BigInt
-  /// b1.
+  /// b1, truncating towards zero, so the remainder has the sign of a1.
   ///
   /// The output is a pair of the form (quotient, remainder).
+  /// @throws std::domain_error if b1 is zero.
   friend std::pair<BigInt, BigInt> divmod(const BigInt &a1, const BigInt &b1);
 
-  /// Efficient algorithm for multiplying two large numbers encoded in
-  /// 'a'-like vector-representations.
-  ///
-  /// @param a vector-representation of number with 0th index being the
-  /// least-significant bit.
-  /// @param b vector-representation of number with 0th index being the
-  /// least-significant digit.
-  /// @note Used as a subroutine for operator*(const BigInt&, const
-  /// BigInt&).
-  /// @note The resultant vector may not 'fit' inside base limits. This is
-  /// why in operator*(const BigInt&, const BigInt&), the 'a' vectors are
-  /// first converted to base 1-million so that multiplication won't
-  /// overflow.
-  static vll karatsuba_multiply(const vll &a, const vll &b);
-
-  /// A base-'Bigint::base' representation of a large number.
+  /// r += u * v, without a temporary product when either factor fits in
+  /// one limb.
+  friend void addmul(BigInt &r, const BigInt &u, const BigInt &v);
+
+  /// r -= u * v, as addmul.
+  friend void submul(BigInt &r, const BigInt &u, const BigInt &v);
+
+  /// The magnitude in base 2^64.
   ///
-  /// The least significant bit is the 0th index, so it is read in the
+  /// The least significant limb is the 0th index, so it is read in the
   /// opposite direction to how numbers are normally written.
-  std::vector<int> a;
+  detail::LimbVector a;
 
   /// The sign of the number, either +1 or -1.
   int sign;
 
-  /// The base of numbers of 'a' (e.g. where base 10 is decimal).
-  ///
-  /// A higher base means more efficient memory usage, since storing large
-  /// numbers will require fewer 32-bit integers.
-  /// @warning Make sure base is a multiple of 10, or bad things could
-  /// happen.
-  static constexpr int base = 1000000000;
-
-  /// This is simply the maximum number of digits any element can take in
-  /// the given base.
-  ///
-  /// @warning Ensure that if base = 100,1000,10000,100000,...,
-  /// base_digits = 2,3,4,5,...
-  static constexpr int base_digits = 9;
+private:
+  /// Adds v_sign * |v| to *this.
+  void add_signed(const BigInt &v, int v_sign);
+
+  /// Adds product_sign * |u| * |v| to *this.
+  void add_product(const BigInt &u, const BigInt &v, int product_sign);
+
+  /// Compares magnitudes, returning -1, 0 or 1.
+  static int compare_magnitudes(const BigInt &u, const BigInt &v);
 };
 
 // IMPLEMENTATION
 
-inline BigInt::BigInt() : sign{1} {}
+namespace detail {
+
+inline limb add_with_carry(limb x, limb y, unsigned char &carry) {
+#if defined(__x86_64__) || defined(_M_X64)
+  unsigned long long sum;
+  carry = _addcarry_u64(carry, x, y, &sum);
+  return sum;
+#else
+  limb partial = x + y;
+  limb sum = partial + carry;
+  carry = (partial < x) | (sum < partial);
+  return sum;
+#endif
+}
 
-inline BigInt::BigInt(const std::string &s) { from_string(s); }
+inline limb sub_with_borrow(limb x, limb y, unsigned char &borrow) {
+#if defined(__x86_64__) || defined(_M_X64)
+  unsigned long long diff;
+  borrow = _subborrow_u64(borrow, x, y, &diff);
+  return diff;
+#else
+  limb partial = x - y;
+  limb diff = partial - borrow;
+  borrow = (x < y) | (partial < borrow);
+  return diff;
+#endif
+}
 
-inline BigInt::BigInt(long long v) { from_long_long(v); }
+/// Size of [p, p + n) without its most-significant zero limbs.
+inline std::size_t limbs_normalized_size(const limb *p, std::size_t n) {
+  while (n > 0 && p[n - 1] == 0) {
+    --n;
+  }
+  return n;
+}
 
-inline int BigInt::size() const {
-  if (a.empty())
+/// Compares [a, a + n) and [b, b + n), returning -1, 0 or 1.
+inline int limbs_cmp(const limb *a, const limb *b, std::size_t n) {
+  for (std::size_t i = n; i-- > 0;) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+/// r = a + b over n limbs, returning the carry. r may alias a or b.
+inline limb limbs_add_n(limb *r, const limb *a, const limb *b, std::size_t n) {
+  unsigned char carry = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    r[i] = add_with_carry(a[i], b[i], carry);
+  }
+  return carry;
+}
+
+/// r = a + b with an >= bn, returning the carry. r may alias a or b.
+inline limb limbs_add(limb *r, const limb *a, std::size_t an, const limb *b,
+                      std::size_t bn) {
+  limb carry = limbs_add_n(r, a, b, bn);
+  for (std::size_t i = bn; i < an; ++i) {
+    limb sum = a[i] + carry;
+    carry = sum < carry;
+    r[i] = sum;
+  }
+  return carry;
+}
+
+/// r = a - b over n limbs, returning the borrow. r may alias a or b.
+inline limb limbs_sub_n(limb *r, const limb *a, const limb *b, std::size_t n) {
+  unsigned char borrow = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    r[i] = sub_with_borrow(a[i], b[i], borrow);
+  }
+  return borrow;
+}
+
+/// r = a - b with an >= bn, returning the borrow. r may alias a or b.
+inline limb limbs_sub(limb *r, const limb *a, std::size_t an, const limb *b,
+                      std::size_t bn) {
+  limb borrow = limbs_sub_n(r, a, b, bn);
+  for (std::size_t i = bn; i < an; ++i) {
+    limb diff = a[i] - borrow;
+    borrow = a[i] < borrow;
+    r[i] = diff;
+  }
+  return borrow;
+}
+
+/// r = a * b over n limbs, returning the high limb. r may alias a.
+inline limb limbs_mul_1(limb *r, const limb *a, std::size_t n, limb b) {
+  limb carry = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    uint128 p = static_cast<uint128>(a[i]) * b + carry;
+    r[i] = static_cast<limb>(p);
+    carry = static_cast<limb>(p >> 64);
+  }
+  return carry;
+}
+
+/// r += a * b over n limbs, returning the carry out of r[n - 1].
+inline limb limbs_addmul_1(limb *r, const limb *a, std::size_t n, limb b) {
+  limb carry = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    uint128 p = static_cast<uint128>(a[i]) * b + r[i] + carry;
+    r[i] = static_cast<limb>(p);
+    carry = static_cast<limb>(p >> 64);
+  }
+  return carry;
+}
+
+/// r -= a * b over n limbs, returning the borrow out of r[n - 1].
+inline limb limbs_submul_1(limb *r, const limb *a, std::size_t n, limb b) {
+  limb carry = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    uint128 p = static_cast<uint128>(a[i]) * b + carry;
+    limb lo = static_cast<limb>(p);
+    carry = static_cast<limb>(p >> 64) + (r[i] < lo);
+    r[i] -= lo;
+  }
+  return carry;
+}
+
+/// q = a / d over n limbs, returning the remainder. q may alias a.
+inline limb limbs_divrem_1(limb *q, const limb *a, std::size_t n, limb d) {
+  limb rem = 0;
+  for (std::size_t i = n; i-- > 0;) {
+    uint128 cur = (static_cast<uint128>(rem) << 64) | a[i];
+    q[i] = static_cast<limb>(cur / d);
+    rem = static_cast<limb>(cur % d);
+  }
+  return rem;
+}
+
+/// r = a << shift over n limbs, 0 <= shift < 64, returning the bits shifted
+/// out. r may alias a.
+inline limb limbs_shl(limb *r, const limb *a, std::size_t n, unsigned shift) {
+  if (shift == 0) {
+    std::copy(a, a + n, r);
     return 0;
+  }
+  limb out = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    limb x = a[i];
+    r[i] = (x << shift) | out;
+    out = x >> (64 - shift);
+  }
+  return out;
+}
 
-  int ans = (a.size() - 1) * base_digits;
-  int ca = a.back();
+/// r = a >> shift over n limbs, 0 <= shift < 64. r may alias a.
+inline void limbs_shr(limb *r, const limb *a, std::size_t n, unsigned shift) {
+  if (shift == 0) {
+    std::copy(a, a + n, r);
+    return;
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    r[i] = (a[i] >> shift) | (i + 1 < n ? a[i + 1] << (64 - shift) : 0);
+  }
+}
 
-  while (ca) {
-    ans++;
-    ca /= 10;
+/// r = a * b by schoolbook multiplication, an >= bn >= 1. r has an + bn
+/// limbs and does not alias a or b.
+inline void limbs_mul_basecase(limb *r, const limb *a, std::size_t an,
+                               const limb *b, std::size_t bn) {
+  r[an] = limbs_mul_1(r, a, an, b[0]);
+  for (std::size_t j = 1; j < bn; ++j) {
+    r[an + j] = limbs_addmul_1(r + j, a, an, b[j]);
   }
+}
 
-  return ans;
+inline void limbs_mul(limb *r, const limb *a, std::size_t an, const limb *b,
+                      std::size_t bn);
+inline void limbs_sqr(limb *r, const limb *a, std::size_t n);
+
+/// Toom-3 multiplication (a squaring if b is a), bn <= an < 2 * bn.
+inline void limbs_mul_toom3(limb *r, const limb *a, std::size_t an,
+                            const limb *b, std::size_t bn);
+
+/// r = a * b for any sizes, including zero. r has an + bn limbs and does not
+/// alias a or b.
+inline void limbs_mul_any(limb *r, const limb *a, std::size_t an,
+                          const limb *b, std::size_t bn) {
+  if (an < bn) {
+    std::swap(a, b);
+    std::swap(an, bn);
+  }
+  if (bn == 0) {
+    std::fill(r, r + an, limb{0});
+    return;
+  }
+  limbs_mul(r, a, an, b, bn);
 }
 
-inline bool BigInt::is_zero() const {
-  return a.empty() || (a.size() == 1 && !a[0]);
+/// Karatsuba multiplication, bn <= an < 2 * bn.
+inline void limbs_mul_karatsuba(limb *r, const limb *a, std::size_t an,
+                                const limb *b, std::size_t bn) {
+  // a = a1 B^k + a0 and b = b1 B^k + b0, with bn > k so b1 is not empty.
+  std::size_t k = an / 2;
+  std::size_t a1n = an - k, b1n = bn - k;
+  std::size_t n = an + bn;
+
+  limbs_mul_any(r, a, k, b, k);                     // a0 b0 in r[0, 2k)
+  limbs_mul_any(r + 2 * k, a + k, a1n, b + k, b1n); // a1 b1 in r[2k, n)
+
+  std::vector<limb> sa(a1n + 1), sb(std::max(k, b1n) + 1);
+  sa[a1n] = limbs_add(sa.data(), a + k, a1n, a, k);
+  if (b1n >= k) {
+    sb[b1n] = limbs_add(sb.data(), b + k, b1n, b, k);
+  } else {
+    sb[k] = limbs_add(sb.data(), b, k, b + k, b1n);
+  }
+  std::size_t san = limbs_normalized_size(sa.data(), sa.size());
+  std::size_t sbn = limbs_normalized_size(sb.data(), sb.size());
+
+  // (a0 + a1)(b0 + b1) - a0 b0 - a1 b1 = a0 b1 + a1 b0, added at B^k.
+  std::vector<limb> mid(san + sbn);
+  limbs_mul_any(mid.data(), sa.data(), san, sb.data(), sbn);
+  std::size_t midn = mid.size();
+  limbs_sub(mid.data(), mid.data(), midn, r,
+            limbs_normalized_size(r, 2 * k));
+  limbs_sub(mid.data(), mid.data(), midn, r + 2 * k,
+            limbs_normalized_size(r + 2 * k, n - 2 * k));
+  midn = limbs_normalized_size(mid.data(), midn);
+  limbs_add(r + k, r + k, n - k, mid.data(), midn);
 }
 
-inline bool BigInt::is_even() const { return !(a[0] % 2); }
+/// A prime p = c 2^k + 1 < 2^63 for the number-theoretic transform, with
+/// its Montgomery constants for R = 2^64.
+struct NttPrime {
+  limb p;
+  limb generator;
+  limb neg_inv; ///< -p^-1 mod R
+  limb r2;      ///< R^2 mod p
+};
 
-inline bool BigInt::is_odd() const { return (a[0] % 2); }
+inline constexpr limb mulmod_u64(limb a, limb b, limb p) {
+  return static_cast<limb>(static_cast<uint128>(a) * b % p);
+}
 
-inline BigInt BigInt::abs() const {
-  BigInt res = *this;
-  res.sign *= res.sign;
+inline constexpr limb powmod_u64(limb b, limb e, limb p) {
+  limb res = 1;
+  for (; e; e >>= 1, b = mulmod_u64(b, b, p)) {
+    if (e & 1)
+      res = mulmod_u64(res, b, p);
+  }
   return res;
 }
 
-inline BigInt BigInt::operator-() const {
-  BigInt res = *this;
-  res.sign = -sign;
-  return res;
+inline constexpr NttPrime make_ntt_prime(limb p, limb generator) {
+  // Newton's iteration doubles the correct low bits of p^-1 from 3.
+  limb inv = p;
+  for (int i = 0; i < 5; ++i)
+    inv *= 2 - p * inv;
+  limb r = static_cast<limb>((static_cast<uint128>(1) << 64) % p);
+  return {p, generator, limb{0} - inv, mulmod_u64(r, r, p)};
 }
 
-inline std::string BigInt::to_string() {
-  std::stringstream ss;
-  ss << *this;
-  return ss.str();
+/// Three primes whose product exceeds every coefficient of a product of
+/// fewer than 2^55 limbs, with power-of-two roots of unity up to 2^55.
+inline constexpr NttPrime ntt_primes[3] = {
+    make_ntt_prime(4179340454199820289ull, 3), // 29 2^57 + 1
+    make_ntt_prime(2485986994308513793ull, 5), // 69 2^55 + 1
+    make_ntt_prime(1945555039024054273ull, 5), // 27 2^56 + 1
+};
+
+/// a b / R mod p, for a < p and any b (Montgomery reduction).
+inline limb mont_mul(limb a, limb b, const NttPrime &m) {
+  uint128 t = static_cast<uint128>(a) * b;
+  limb k = static_cast<limb>(t) * m.neg_inv;
+  limb u = static_cast<limb>((t + static_cast<uint128>(k) * m.p) >> 64);
+  return u >= m.p ? u - m.p : u;
 }
 
-inline void BigInt::from_long_long(long long v) {
-  if (v == std::numeric_limits<long long>::min()) {
-    sign = -1;
-    a = {854775808, 223372036, 9};
+/// x R mod p, for x < p.
+inline limb to_mont(limb x, const NttPrime &m) { return mont_mul(x, m.r2, m); }
+
+/// In-place cyclic transform of x, of power-of-two length n, given the
+/// powers w^j (j < n / 2) of a primitive n-th root in Montgomery form, so
+/// the values stay in the ordinary domain.
+inline void ntt_transform(limb *x, std::size_t n, const limb *roots,
+                          const NttPrime &m) {
+  for (std::size_t i = 1, j = 0; i < n; ++i) {
+    std::size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j)
+      std::swap(x[i], x[j]);
+  }
+  for (std::size_t len = 2; len <= n; len <<= 1) {
+    std::size_t half = len / 2, step = n / len;
+    for (std::size_t i = 0; i < n; i += len) {
+      for (std::size_t j = 0; j < half; ++j) {
+        limb u = x[i + j];
+        limb v = mont_mul(x[i + j + half], roots[j * step], m);
+        limb sum = u + v;
+        x[i + j] = sum >= m.p ? sum - m.p : sum;
+        x[i + j + half] = u >= v ? u - v : u + m.p - v;
+      }
+    }
+  }
+}
+
+/// out[0, n) = the cyclic convolution of a and b (of a with itself if
+/// square) modulo m.p, for a power-of-two n >= an + bn - 1.
+inline void ntt_convolve(limb *out, std::size_t n, const limb *a,
+                         std::size_t an, const limb *b, std::size_t bn,
+                         bool square, const NttPrime &m) {
+  std::vector<limb> roots(std::max<std::size_t>(n / 2, 1));
+  limb w = to_mont(powmod_u64(m.generator, (m.p - 1) / n, m.p), m);
+  roots[0] = to_mont(1, m);
+  for (std::size_t j = 1; j < roots.size(); ++j)
+    roots[j] = mont_mul(roots[j - 1], w, m);
+
+  std::fill(out, out + n, limb{0});
+  for (std::size_t i = 0; i < an; ++i)
+    out[i] = a[i] % m.p;
+  ntt_transform(out, n, roots.data(), m);
+  if (square) {
+    for (std::size_t i = 0; i < n; ++i)
+      out[i] = mont_mul(out[i], out[i], m);
   } else {
-    sign = 1;
-    a.clear();
+    std::vector<limb> y(n);
+    for (std::size_t i = 0; i < bn; ++i)
+      y[i] = b[i] % m.p;
+    ntt_transform(y.data(), n, roots.data(), m);
+    for (std::size_t i = 0; i < n; ++i)
+      out[i] = mont_mul(out[i], y[i], m);
+  }
 
-    if (v < 0) {
-      sign = -1;
-      v = -v;
+  // The inverse transform is the forward one with the outputs reversed.
+  ntt_transform(out, n, roots.data(), m);
+  std::reverse(out + 1, out + n);
+
+  // The products picked up a factor 1 / R, and the transforms a factor n.
+  limb inv_n = powmod_u64(static_cast<limb>(n % m.p), m.p - 2, m.p);
+  limb scale = to_mont(to_mont(inv_n, m), m);
+  for (std::size_t i = 0; i < n; ++i)
+    out[i] = mont_mul(out[i], scale, m);
+}
+
+/// r = a * b (a squaring if b is a) by convolutions modulo three primes,
+/// recombined with Garner's algorithm. r has an + bn limbs.
+inline void limbs_mul_ntt(limb *r, const limb *a, std::size_t an,
+                          const limb *b, std::size_t bn) {
+  bool square = a == b && an == bn;
+  std::size_t len = an + bn - 1, n = std::bit_ceil(len);
+  const NttPrime &m0 = ntt_primes[0], &m1 = ntt_primes[1],
+                 &m2 = ntt_primes[2];
+  std::vector<limb> x0(n), x1(n), x2(n);
+  ntt_convolve(x0.data(), n, a, an, b, bn, square, m0);
+  ntt_convolve(x1.data(), n, a, an, b, bn, square, m1);
+  ntt_convolve(x2.data(), n, a, an, b, bn, square, m2);
+
+  // Each coefficient is y0 + p0 y1 + p0 p1 y2 with yj < pj. The
+  // multipliers are in Montgomery form, so mont_mul multiplies by them.
+  limb inv_p0 = to_mont(powmod_u64(m0.p % m1.p, m1.p - 2, m1.p), m1);
+  limb p0_mod2 = to_mont(m0.p % m2.p, m2);
+  limb inv_p01 = to_mont(
+      powmod_u64(mulmod_u64(m0.p % m2.p, m1.p, m2.p), m2.p - 2, m2.p), m2);
+  uint128 p01 = static_cast<uint128>(m0.p) * m1.p;
+  limb p01_lo = static_cast<limb>(p01), p01_hi = static_cast<limb>(p01 >> 64);
+
+  // Running sum of the coefficients at limb i, in three limbs.
+  limb c0 = 0, c1 = 0, c2 = 0;
+  for (std::size_t i = 0; i < an + bn; ++i) {
+    limb v0 = 0, v1 = 0, v2 = 0;
+    if (i < len) {
+      limb y0 = x0[i];
+      limb t1 = y0 % m1.p;
+      limb y1 = mont_mul(x1[i] >= t1 ? x1[i] - t1 : x1[i] + m1.p - t1,
+                         inv_p0, m1);
+      limb t2 = y0 % m2.p + mont_mul(p0_mod2, y1, m2);
+      t2 = t2 >= m2.p ? t2 - m2.p : t2;
+      limb y2 = mont_mul(x2[i] >= t2 ? x2[i] - t2 : x2[i] + m2.p - t2,
+                         inv_p01, m2);
+
+      uint128 low = static_cast<uint128>(m0.p) * y1 + y0;
+      uint128 hl = static_cast<uint128>(p01_lo) * y2;
+      uint128 hh = static_cast<uint128>(p01_hi) * y2;
+      unsigned char carry = 0;
+      v0 = add_with_carry(static_cast<limb>(low), static_cast<limb>(hl),
+                          carry);
+      v1 = add_with_carry(static_cast<limb>(low >> 64),
+                          static_cast<limb>(hl >> 64), carry);
+      v2 = carry;
+      carry = 0;
+      v1 = add_with_carry(v1, static_cast<limb>(hh), carry);
+      v2 += static_cast<limb>(hh >> 64) + carry;
     }
+    unsigned char carry = 0;
+    c0 = add_with_carry(c0, v0, carry);
+    c1 = add_with_carry(c1, v1, carry);
+    c2 = add_with_carry(c2, v2, carry);
+    r[i] = c0;
+    c0 = c1;
+    c1 = c2;
+    c2 = 0;
+  }
+}
 
-    for (; v > 0; v = v / base)
-      a.push_back(v % base);
+/// r = a * b, an >= bn >= 1. r has an + bn limbs and does not alias a or b.
+inline void limbs_mul(limb *r, const limb *a, std::size_t an, const limb *b,
+                      std::size_t bn) {
+  if (a == b && an == bn) {
+    limbs_sqr(r, a, an);
+  } else if (bn < karatsuba_threshold) {
+    limbs_mul_basecase(r, a, an, b, bn);
+  } else if (bn >= ntt_threshold) {
+    limbs_mul_ntt(r, a, an, b, bn);
+  } else if (an >= 2 * bn) {
+    // Unbalanced: multiply b by bn-limb slices of a.
+    std::fill(r, r + an + bn, limb{0});
+    std::vector<limb> slice(2 * bn);
+    for (std::size_t i = 0; i < an; i += bn) {
+      std::size_t len = std::min(bn, an - i);
+      limbs_mul_any(slice.data(), a + i, len, b, bn);
+      limbs_add(r + i, r + i, an + bn - i, slice.data(), len + bn);
+    }
+  } else if (bn < toom3_threshold) {
+    limbs_mul_karatsuba(r, a, an, b, bn);
+  } else {
+    limbs_mul_toom3(r, a, an, b, bn);
   }
 }
 
-inline void BigInt::from_binary_vector(const std::vector<int> &v) {
-  from_long_long(0);
+/// r = a^2 by schoolbook multiplication, computing each cross product once.
+/// r has 2 n limbs and does not alias a.
+inline void limbs_sqr_basecase(limb *r, const limb *a, std::size_t n) {
+  std::fill(r, r + 2 * n, limb{0});
+  for (std::size_t i = 0; i + 1 < n; ++i)
+    r[i + n] = limbs_addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+  limbs_shl(r, r, 2 * n, 1);
+  unsigned char carry = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    uint128 sq = static_cast<uint128>(a[i]) * a[i];
+    r[2 * i] = add_with_carry(r[2 * i], static_cast<limb>(sq), carry);
+    r[2 * i + 1] =
+        add_with_carry(r[2 * i + 1], static_cast<limb>(sq >> 64), carry);
+  }
+}
 
-  BigInt power_of_2(1);
+/// Karatsuba squaring: three half-size squares.
+inline void limbs_sqr_karatsuba(limb *r, const limb *a, std::size_t n) {
+  std::size_t k = n / 2, a1n = n - k;
+  limbs_sqr(r, a, k);                 // a0^2 in r[0, 2k)
+  limbs_sqr(r + 2 * k, a + k, a1n);   // a1^2 in r[2k, 2n)
+
+  std::vector<limb> sa(a1n + 1);
+  sa[a1n] = limbs_add(sa.data(), a + k, a1n, a, k);
+  std::size_t san = limbs_normalized_size(sa.data(), sa.size());
+
+  // (a0 + a1)^2 - a0^2 - a1^2 = 2 a0 a1, added at B^k.
+  std::vector<limb> mid(2 * san);
+  limbs_sqr(mid.data(), sa.data(), san);
+  std::size_t midn = mid.size();
+  limbs_sub(mid.data(), mid.data(), midn, r,
+            limbs_normalized_size(r, 2 * k));
+  limbs_sub(mid.data(), mid.data(), midn, r + 2 * k,
+            limbs_normalized_size(r + 2 * k, 2 * n - 2 * k));
+  midn = limbs_normalized_size(mid.data(), midn);
+  limbs_add(r + k, r + k, 2 * n - k, mid.data(), midn);
+}
 
-  for (std::size_t i = v.size() - 1; i < v.size(); --i) {
-    if (v[i] == 1)
-      *this += power_of_2;
-    power_of_2 *= 2;
+/// r = a^2 for any n, including zero. r has 2 n limbs and does not alias a.
+inline void limbs_sqr(limb *r, const limb *a, std::size_t n) {
+  if (n < sqr_karatsuba_threshold) {
+    limbs_sqr_basecase(r, a, n);
+  } else if (n < sqr_toom3_threshold) {
+    limbs_sqr_karatsuba(r, a, n);
+  } else if (n < sqr_ntt_threshold) {
+    limbs_mul_toom3(r, a, n, a, n);
+  } else {
+    limbs_mul_ntt(r, a, n, a, n);
   }
 }
 
+/// Knuth's algorithm D: q = a / b and r = a % b, with an >= bn >= 1 and
+/// b[bn - 1] != 0. q has an - bn + 1 limbs and r has bn limbs; neither
+/// aliases a or b.
+inline void limbs_divrem(limb *q, limb *r, const limb *a, std::size_t an,
+                         const limb *b, std::size_t bn) {
+  if (bn == 1) {
+    r[0] = limbs_divrem_1(q, a, an, b[0]);
+    return;
+  }
+
+  // Normalize so the top bit of the divisor is set.
+  unsigned shift = static_cast<unsigned>(std::countl_zero(b[bn - 1]));
+  std::vector<limb> v(bn), u(an + 1);
+  limbs_shl(v.data(), b, bn, shift);
+  u[an] = limbs_shl(u.data(), a, an, shift);
+
+  const limb v1 = v[bn - 1], v2 = v[bn - 2];
+  for (std::size_t j = an - bn + 1; j-- > 0;) {
+    // Estimate the quotient limb from the top three limbs, which makes it
+    // at most one too large.
+    uint128 num = (static_cast<uint128>(u[j + bn]) << 64) | u[j + bn - 1];
+    uint128 qhat = num / v1;
+    if (qhat > std::numeric_limits<limb>::max()) {
+      qhat = std::numeric_limits<limb>::max();
+    }
+    uint128 rhat = num - qhat * v1;
+    while (rhat <= std::numeric_limits<limb>::max() &&
+           qhat * v2 > ((rhat << 64) | u[j + bn - 2])) {
+      --qhat;
+      rhat += v1;
+    }
+
+    limb qj = static_cast<limb>(qhat);
+    limb borrow = limbs_submul_1(u.data() + j, v.data(), bn, qj);
+    limb top = u[j + bn];
+    u[j + bn] = top - borrow;
+    if (top < borrow) { // qhat was one too large: add the divisor back
+      --qj;
+      u[j + bn] += limbs_add_n(u.data() + j, u.data() + j, v.data(), bn);
+    }
+    q[j] = qj;
+  }
+
+  limbs_shr(r, u.data(), bn, shift);
+}
+
+inline void bigint_divrem(const BigInt &a, const BigInt &b, BigInt &q,
+                          BigInt &r);
+inline std::string bigint_to_decimal(const BigInt &x);
+inline void bigint_from_decimal(BigInt &x, std::string_view digits);
+
+} // namespace detail
+
+inline BigInt::BigInt() : sign{1} {}
+
+inline BigInt::BigInt(const std::string &s) { from_string(s); }
+
+inline BigInt::BigInt(long long v) { from_long_long(v); }
+
+inline int BigInt::size() const {
+  if (is_zero())
+    return 0;
+  return static_cast<int>(to_string().size()) - (sign < 0);
+}
+
+inline std::size_t BigInt::bit_length() const {
+  if (a.empty())
+    return 0;
+  return 64 * a.size() - static_cast<std::size_t>(std::countl_zero(a.back()));
+}
+
+inline bool BigInt::is_zero() const { return a.empty(); }
+
+inline bool BigInt::is_even() const { return a.empty() || !(a[0] & 1); }
+
+inline bool BigInt::is_odd() const { return !is_even(); }
+
+inline BigInt BigInt::abs() const {
+  BigInt res = *this;
+  res.sign = 1;
+  return res;
+}
+
+inline BigInt BigInt::operator-() const {
+  BigInt res = *this;
+  if (!res.is_zero())
+    res.sign = -sign;
+  return res;
+}
+
+inline std::string BigInt::to_string() const {
+  if (is_zero())
+    return "0";
+  std::string s = sign < 0 ? "-" : "";
+  return s + detail::bigint_to_decimal(*this);
+}
+
+inline void BigInt::from_long_long(long long v) {
+  sign = v < 0 ? -1 : 1;
+  // Negate in unsigned arithmetic, so LLONG_MIN is fine.
+  limb magnitude =
+      v < 0 ? limb{0} - static_cast<limb>(v) : static_cast<limb>(v);
+  a.clear();
+  if (magnitude)
+    a.push_back(magnitude);
+}
+
+inline void BigInt::from_binary_vector(const std::vector<int> &v) {
+  sign = 1;
+  a.assign((v.size() + 63) / 64, 0);
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    if (v[v.size() - 1 - i] == 1)
+      a[i / 64] |= limb{1} << (i % 64);
+  }
+  trim();
+}
+
 inline void BigInt::from_string(const std::string &s) {
   sign = 1;
   a.clear();
@@ -256,41 +935,25 @@ inline void BigInt::from_string(const std::string &s) {
       sign = -sign;
     pos++;
   }
-
-  // backwards iteration
-  for (std::size_t i = s.size() - 1; i >= pos && i < s.size();
-       i -= base_digits) {
-    int x = 0;
-
-    std::size_t j_start =
-        (i + 1 < base_digits) ? pos : std::max(pos, i - base_digits + 1);
-
-    for (std::size_t j = j_start; j <= i; j++) {
-      x = x * 10 + s[j] - '0';
-    }
-
-    a.push_back(x);
+  if (pos == s.size()) {
+    throw std::invalid_argument("Invalid BigInt string: " + s);
   }
 
+  detail::bigint_from_decimal(*this,
+                              std::string_view(s).substr(pos, s.size() - pos));
   trim();
 }
 
 inline long long BigInt::to_ll() const {
-  long long res = 0;
-
-  // backwards iteration
-  for (std::size_t i = a.size() - 1; i < a.size(); i--) {
-#ifndef NDEBUG
-    long long overflow_test;
-    assert(!__builtin_smulll_overflow(res, base, &overflow_test));
-#endif
-    res *= base;
-#ifndef NDEBUG
-    assert(!__builtin_saddll_overflow(res, base, &overflow_test));
-#endif
-    res += a[i];
+  if (a.empty())
+    return 0;
+  limb limit = static_cast<limb>(std::numeric_limits<long long>::max()) +
+               (sign < 0 ? 1 : 0);
+  if (a.size() > 1 || a[0] > limit) {
+    throw std::overflow_error("BigInt does not fit in a long long");
   }
-  return res * sign;
+  return sign < 0 ? static_cast<long long>(limb{0} - a[0])
+                  : static_cast<long long>(a[0]);
 }
 
 inline std::vector<int> BigInt::to_big_endian_vector(int new_base) const {
@@ -298,11 +961,20 @@ inline std::vector<int> BigInt::to_big_endian_vector(int new_base) const {
     return {0};
 
   std::vector<int> res;
-  BigInt a_copy = *this;
+  if (new_base == 2) {
+    std::size_t bits = bit_length();
+    res.reserve(bits);
+    for (std::size_t i = bits; i-- > 0;)
+      res.push_back(static_cast<int>((a[i / 64] >> (i % 64)) & 1));
+    return res;
+  }
 
-  while (!a_copy.is_zero()) {
-    res.emplace_back(a_copy % new_base);
-    a_copy /= new_base;
+  std::vector<limb> t(a.begin(), a.end());
+  std::size_t n = t.size();
+  while (n > 0) {
+    res.push_back(static_cast<int>(detail::limbs_divrem_1(
+        t.data(), t.data(), n, static_cast<limb>(new_base))));
+    n = detail::limbs_normalized_size(t.data(), n);
   }
   std::reverse(res.begin(), res.end());
   return res;
@@ -316,99 +988,98 @@ inline void BigInt::trim() {
 }
 
 inline BigInt &BigInt::operator=(long long v) {
-  BigInt temp(v);
-  std::swap(*this, temp);
+  from_long_long(v);
   return *this;
 }
 
 inline BigInt &BigInt::operator=(const std::string &s) {
-  BigInt temp(s);
-  std::swap(*this, temp);
+  from_string(s);
   return *this;
 }
 
-inline BigInt &BigInt::operator+=(const BigInt &v) {
-  if (sign == v.sign) {
-    for (std::size_t i = 0, carry = 0;
-         i < std::max(a.size(), v.a.size()) || carry; ++i) {
-      if (i == a.size())
-        a.push_back(0);
-
-      a[i] += carry + (i < v.a.size() ? v.a[i] : 0);
-      carry = a[i] >= base;
-      if (carry)
-        a[i] -= base;
-    }
+inline int BigInt::compare_magnitudes(const BigInt &u, const BigInt &v) {
+  if (u.a.size() != v.a.size())
+    return u.a.size() < v.a.size() ? -1 : 1;
+  return detail::limbs_cmp(u.a.data(), v.a.data(), u.a.size());
+}
+
+inline void BigInt::add_signed(const BigInt &v, int v_sign) {
+  std::size_t an = a.size(), vn = v.a.size();
+  if (vn == 0)
+    return;
+
+  if (sign == v_sign || an == 0) {
+    // |*this| + |v|; when v is *this, both refer to the resized vector.
+    a.resize(std::max(an, vn) + 1);
+    const limb *vp = v.a.data();
+    limb carry = an >= vn ? detail::limbs_add(a.data(), a.data(), an, vp, vn)
+                          : detail::limbs_add(a.data(), vp, vn, a.data(), an);
+    a[std::max(an, vn)] = carry;
+    sign = an == 0 ? v_sign : sign;
+  } else if (compare_magnitudes(*this, v) >= 0) {
+    detail::limbs_sub(a.data(), a.data(), an, v.a.data(), vn);
   } else {
-    *this -= (-v);
+    a.resize(vn);
+    detail::limbs_sub(a.data(), v.a.data(), vn, a.data(), an);
+    sign = v_sign;
   }
+  trim();
+}
+
+inline BigInt &BigInt::operator+=(const BigInt &v) {
+  add_signed(v, v.sign);
   return *this;
 }
 
 inline BigInt &BigInt::operator-=(const BigInt &v) {
-  if (sign == v.sign) {
-    if (abs() >= v.abs()) {
-      for (std::size_t i = 0, carry = 0; i < v.a.size() || carry; ++i) {
-        a[i] -= carry + (i < v.a.size() ? v.a[i] : 0);
-        carry = (a[i] < 0);
-        if (carry)
-          a[i] += base;
-      }
-      trim();
-    } else {
-      for (std::size_t i = 0, carry = 0; i < v.a.size() || carry; ++i) {
-        if (i == a.size())
-          a.push_back(0);
-        a[i] = v.a[i] - carry - a[i];
-        carry = a[i] < 0;
-        if (carry)
-          a[i] += base;
-      }
-      sign = -sign;
-    }
+  if (&v == this) {
+    a.clear();
+    sign = 1;
   } else {
-    *this += (-v);
+    add_signed(v, -v.sign);
   }
   return *this;
 }
 
 inline BigInt &BigInt::operator*=(const BigInt &v) {
-  *this = (*this) * v;
-  return *this;
-}
-
-inline BigInt &BigInt::operator*=(int v) {
-  if (v < 0) {
-    sign = -sign;
-    v = -v;
+  std::size_t an = a.size(), vn = v.a.size();
+  if (an == 0 || vn == 0) {
+    a.clear();
+    sign = 1;
+    return *this;
   }
-  for (std::size_t i = 0, carry = 0; i < a.size() || carry; ++i) {
-    if (i == a.size())
-      a.push_back(0);
-    long long cur = a[i] * static_cast<long long>(v) + carry;
-    carry = static_cast<std::size_t>(cur / base);
-    a[i] = static_cast<int>(cur % base);
+  sign *= v.sign;
+  if (vn == 1) {
+    limb carry = detail::limbs_mul_1(a.data(), a.data(), an, v.a[0]);
+    if (carry)
+      a.push_back(carry);
+  } else if (an == 1) {
+    limb m = a[0];
+    a.resize(vn + 1);
+    a[vn] = detail::limbs_mul_1(a.data(), v.a.data(), vn, m);
+  } else {
+    // The product cannot overwrite its operands, so it goes through a
+    // per-thread buffer that keeps its capacity between calls.
+    thread_local std::vector<limb> product;
+    product.resize(an + vn);
+    detail::limbs_mul_any(product.data(), a.data(), an, v.a.data(), vn);
+    a.assign(product.begin(), product.end());
   }
   trim();
   return *this;
 }
 
+inline BigInt &BigInt::operator*=(int v) {
+  return *this *= static_cast<long long>(v);
+}
+
 inline BigInt &BigInt::operator*=(long long v) {
-  if (v < 0) {
+  if (v < 0)
     sign = -sign;
-    v = -v;
-  }
-  if (v > base) {
-    *this = (*this) * (v / base) * base + (*this) * (v % base);
-    return *this;
-  }
-  for (std::size_t i = 0, carry = 0; i < a.size() || carry; ++i) {
-    if (i == a.size())
-      a.push_back(0);
-    long long cur = a[i] * v + carry;
-    carry = static_cast<std::size_t>(cur / base);
-    a[i] = static_cast<int>(cur % base);
-  }
+  limb m = v < 0 ? limb{0} - static_cast<limb>(v) : static_cast<limb>(v);
+  limb carry = detail::limbs_mul_1(a.data(), a.data(), a.size(), m);
+  if (carry)
+    a.push_back(carry);
   trim();
   return *this;
 }
@@ -419,59 +1090,41 @@ inline BigInt &BigInt::operator/=(const BigInt &v) {
 }
 
 inline BigInt &BigInt::operator/=(int v) {
-  if (v < 0) {
+  if (v == 0)
+    throw std::domain_error("BigInt division by zero");
+  if (v < 0)
     sign = -sign;
-    v = -v;
-  }
-  for (int i = static_cast<int>(a.size()) - 1, rem = 0; i >= 0; --i) {
-    long long cur = a[i] + rem * static_cast<long long>(base);
-    a[i] = static_cast<int>(cur / v);
-    rem = static_cast<int>(cur % v);
-  }
+  limb m = v < 0 ? limb{0} - static_cast<limb>(static_cast<long long>(v))
+                 : static_cast<limb>(v);
+  detail::limbs_divrem_1(a.data(), a.data(), a.size(), m);
   trim();
   return *this;
 }
 
 inline BigInt operator+(const BigInt &u, const BigInt &v) {
-  BigInt res = u;
+  BigInt res;
+  res.a.reserve(std::max(u.a.size(), v.a.size()) + 1);
+  res = u;
   res += v;
   return res;
 }
 
 inline BigInt operator-(const BigInt &u, const BigInt &v) {
-  BigInt res = u;
+  BigInt res;
+  res.a.reserve(std::max(u.a.size(), v.a.size()) + 1);
+  res = u;
   res -= v;
   return res;
 }
 
 inline BigInt operator*(const BigInt &u, const BigInt &v) {
-  // Convert to base-6 vectors so that basic integer multiplication won't
-  // overflow.
-  std::vector<int> a6 = BigInt::convert_base(u.a, BigInt::base_digits, 6);
-  std::vector<int> b6 = BigInt::convert_base(v.a, BigInt::base_digits, 6);
-
-  BigInt::vll a(a6.begin(), a6.end());
-  BigInt::vll b(b6.begin(), b6.end());
-
-  // Make sure both vectors are the same size.
-  while (a.size() < b.size())
-    a.push_back(0);
-  while (b.size() < a.size())
-    b.push_back(0);
-  while (a.size() & (a.size() - 1)) {
-    a.push_back(0);
-    b.push_back(0);
-  }
-
-  BigInt::vll c = BigInt::karatsuba_multiply(a, b);
   BigInt res;
+  if (u.is_zero() || v.is_zero())
+    return res;
+  res.a.resize(u.a.size() + v.a.size());
+  detail::limbs_mul_any(res.a.data(), u.a.data(), u.a.size(), v.a.data(),
+                        v.a.size());
   res.sign = u.sign * v.sign;
-  for (std::size_t i = 0, carry = 0; i < c.size(); ++i) {
-    long long cur = c[i] + carry;
-    res.a.push_back(static_cast<int>(cur % 1000000));
-    carry = static_cast<std::size_t>(cur / 1000000);
-  }
-  res.a = BigInt::convert_base(res.a, 6, BigInt::base_digits);
   res.trim();
   return res;
 }
@@ -497,23 +1150,28 @@ inline BigInt operator%(const BigInt &u, const BigInt &v) {
 }
 
 inline int operator%(const BigInt &u, int v) {
-  if (v < 0)
-    v = -v;
-  int m = 0;
-
-  // backwards iteration
-  for (std::size_t i = u.a.size() - 1; i < u.a.size(); --i)
-    m = (u.a[i] + m * static_cast<long long>(BigInt::base)) % v;
-  return m * u.sign;
+  if (v == 0)
+    throw std::domain_error("BigInt division by zero");
+  BigInt::limb m = v < 0 ? BigInt::limb{0} - static_cast<BigInt::limb>(
+                                                 static_cast<long long>(v))
+                         : static_cast<BigInt::limb>(v);
+  BigInt::limb rem = 0;
+  for (std::size_t i = u.a.size(); i-- > 0;)
+    rem = static_cast<BigInt::limb>(
+        ((static_cast<detail::uint128>(rem) << 64) | u.a[i]) % m);
+  return static_cast<int>(rem) * u.sign;
 }
 
 inline BigInt operator^(const BigInt &u, const BigInt &v) {
-  BigInt ans = 1, a = u, b = v;
-  while (!b.is_zero()) {
-    if (b % 2 == 0)
-      ans *= a;
-    a *= a;
-    b /= 2;
+  if (v.sign < 0)
+    throw std::domain_error("Negative BigInt exponent");
+
+  // Left-to-right binary exponentiation over the bits of v.
+  BigInt ans = 1;
+  for (std::size_t i = v.bit_length(); i-- > 0;) {
+    ans *= ans;
+    if ((v.a[i / 64] >> (i % 64)) & 1)
+      ans *= u;
   }
   return ans;
 }
@@ -521,14 +1179,8 @@ inline BigInt operator^(const BigInt &u, const BigInt &v) {
 inline bool operator<(const BigInt &u, const BigInt &v) {
   if (u.sign != v.sign)
     return u.sign < v.sign;
-  if (u.a.size() != v.a.size())
-    return u.a.size() * u.sign < v.a.size() * v.sign;
-
-  // backwards iteration
-  for (std::size_t i = u.a.size() - 1; i < u.a.size(); i--)
-    if (u.a[i] != v.a[i])
-      return u.a[i] * u.sign < v.a[i] * v.sign;
-  return false;
+  int c = BigInt::compare_magnitudes(u, v);
+  return u.sign > 0 ? c < 0 : c > 0;
 }
 
 inline bool operator>(const BigInt &u, const BigInt &v) { return v < u; }
@@ -538,141 +1190,429 @@ inline bool operator<=(const BigInt &u, const BigInt &v) { return !(u > v); }
 inline bool operator>=(const BigInt &u, const BigInt &v) { return !(u < v); }
 
 inline bool operator==(const BigInt &u, const BigInt &v) {
-  return !(u < v) && !(u > v);
+  return u.sign == v.sign && u.a == v.a;
 }
 
-inline bool operator!=(const BigInt &u, const BigInt &v) {
-  return (u < v) || (u > v);
-}
+inline bool operator!=(const BigInt &u, const BigInt &v) { return !(u == v); }
 
 inline std::ostream &operator<<(std::ostream &os, const BigInt &v) {
-  if (v.sign == -1)
-    os << '-';
-  os << (v.a.empty() ? 0 : v.a.back());
-
-  // backwards iteration
-  for (std::size_t i = v.a.size() - 2; i < v.a.size(); --i)
-    os << std::setw(BigInt::base_digits) << std::setfill('0') << v.a[i];
-  return os;
+  return os << v.to_string();
 }
 
 inline std::istream &operator>>(std::istream &is, BigInt &v) {
   std::string s;
-  is >> s;
-  v.from_string(s);
+  if (is >> s)
+    v.from_string(s);
   return is;
 }
 
 inline BigInt gcd(const BigInt &u, const BigInt &v) {
-  return v.is_zero() ? u : gcd(v, u % v);
+  BigInt x = u.abs(), y = v.abs();
+  while (!y.is_zero()) {
+    BigInt r = x % y;
+    x = std::move(y);
+    y = std::move(r);
+  }
+  return x;
 }
 
 inline BigInt lcm(const BigInt &u, const BigInt &v) {
+  if (u.is_zero() || v.is_zero())
+    return BigInt();
   return u / gcd(u, v) * v;
 }
 
-inline std::vector<int> BigInt::convert_base(const std::vector<int> &a,
-                                             std::size_t old_digits,
-                                             std::size_t new_digits) {
-  std::vector<long long> p(std::max(old_digits, new_digits) + 1);
+namespace detail {
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wnull-dereference"
-  p[0] = 1;
-#pragma GCC diagnostic pop
+/// Limbs [lo, hi) of |x|.
+inline BigInt bigint_limb_slice(const BigInt &x, std::size_t lo,
+                                std::size_t hi) {
+  BigInt res;
+  hi = std::min(hi, x.a.size());
+  if (lo < hi)
+    res.a.assign(x.a.begin() + static_cast<std::ptrdiff_t>(lo),
+                 x.a.begin() + static_cast<std::ptrdiff_t>(hi));
+  res.trim();
+  return res;
+}
 
-  for (std::size_t i = 1; i < p.size(); ++i)
-    p[i] = p[i - 1] * 10;
+/// |hi| B^k + |lo|, with |lo| < B^k.
+inline BigInt bigint_join(const BigInt &hi, const BigInt &lo, std::size_t k) {
+  BigInt res;
+  res.a.assign(k + hi.a.size(), 0);
+  std::copy(lo.a.begin(), lo.a.end(), res.a.begin());
+  std::copy(hi.a.begin(), hi.a.end(),
+            res.a.begin() + static_cast<std::ptrdiff_t>(k));
+  res.trim();
+  return res;
+}
 
-  std::vector<int> res;
-  long long cur = 0;
-  std::size_t cur_digits = 0;
-  for (std::size_t i = 0; i < a.size(); ++i) {
-    cur += a[i] * p[cur_digits];
-    cur_digits += old_digits;
-    while (cur_digits >= new_digits) {
-      res.push_back(static_cast<int>(cur % p[new_digits]));
-      cur /= p[new_digits];
-      cur_digits -= new_digits;
-    }
-  }
-  res.push_back(static_cast<int>(cur));
-  while (!res.empty() && !res.back())
-    res.pop_back();
+/// |x| 2^bits.
+inline BigInt bigint_shl(const BigInt &x, std::size_t bits) {
+  BigInt res;
+  if (x.is_zero())
+    return res;
+  std::size_t limbs = bits / 64;
+  res.a.assign(limbs + x.a.size() + 1, 0);
+  res.a.back() = limbs_shl(res.a.data() + limbs, x.a.data(), x.a.size(),
+                           static_cast<unsigned>(bits % 64));
+  res.trim();
   return res;
 }
 
-inline std::pair<BigInt, BigInt> divmod(const BigInt &a1, const BigInt &b1) {
-  int norm = BigInt::base / (b1.a.back() + 1);
+/// |x| / 2^bits.
+inline BigInt bigint_shr(const BigInt &x, std::size_t bits) {
+  BigInt res;
+  std::size_t limbs = bits / 64;
+  if (limbs >= x.a.size())
+    return res;
+  res.a.resize(x.a.size() - limbs);
+  limbs_shr(res.a.data(), x.a.data() + limbs, res.a.size(),
+            static_cast<unsigned>(bits % 64));
+  res.trim();
+  return res;
+}
 
-  BigInt a = a1.abs() * norm;
-  BigInt b = b1.abs() * norm;
-  BigInt q, r;
-  q.a.resize(a.a.size());
-
-  // backwards iteration
-  for (std::size_t i = a.a.size() - 1; i < a.a.size(); --i) {
-    r *= BigInt::base;
-    r += a.a[i];
-    int s1 = r.a.size() <= b.a.size() ? 0 : r.a[b.a.size()];
-    int s2 = r.a.size() <= b.a.size() - 1 ? 0 : r.a[b.a.size() - 1];
-    int d = (static_cast<long long>(BigInt::base) * s1 + s2) / b.a.back();
-    r -= b * d;
-    while (r < 0) {
-      r += b;
-      --d;
-    }
-    q.a[i] = d;
+inline void limbs_mul_toom3(limb *r, const limb *a, std::size_t an,
+                            const limb *b, std::size_t bn) {
+  bool square = a == b && an == bn;
+  std::size_t k = (an + 2) / 3;
+  auto piece = [k](const limb *p, std::size_t n, std::size_t i) {
+    BigInt x;
+    std::size_t lo = std::min(i * k, n), hi = std::min(lo + k, n);
+    x.a.assign(p + lo, p + hi);
+    x.trim();
+    return x;
+  };
+  auto mul = [square](const BigInt &x, const BigInt &y) {
+    return square ? x * x : x * y;
+  };
+
+  // Evaluate a = a2 x^2 + a1 x + a0 and b at 0, 1, -1, -2 and infinity.
+  BigInt a0 = piece(a, an, 0), a1 = piece(a, an, 1), a2 = piece(a, an, 2);
+  BigInt t = a0 + a2;
+  BigInt pa1 = t + a1, pam1 = t - a1;
+  BigInt pam2 = (pam1 + a2) * 2 - a0;
+  BigInt b0, b2, pb1, pbm1, pbm2;
+  if (!square) {
+    b0 = piece(b, bn, 0);
+    BigInt b1 = piece(b, bn, 1);
+    b2 = piece(b, bn, 2);
+    t = b0 + b2;
+    pb1 = t + b1;
+    pbm1 = t - b1;
+    pbm2 = (pbm1 + b2) * 2 - b0;
   }
 
-  q.sign = a1.sign * b1.sign;
-  r.sign = a1.sign;
+  BigInt r0 = mul(a0, b0), r1 = mul(pa1, pb1), rm1 = mul(pam1, pbm1),
+         rm2 = mul(pam2, pbm2), rinf = mul(a2, b2);
+
+  // Interpolate with Bodrato's sequence; the divisions are exact.
+  BigInt r3 = (rm2 - r1) / 3;
+  r1 = (r1 - rm1) / 2;
+  BigInt r2 = rm1 - r0;
+  r3 = (r2 - r3) / 2 + rinf * 2;
+  r2 = r2 + r1 - rinf;
+  r1 = r1 - r3;
+
+  std::size_t n = an + bn;
+  std::fill(r, r + n, limb{0});
+  const BigInt *coefficients[] = {&r0, &r1, &r2, &r3, &rinf};
+  for (std::size_t i = 0; i < 5; ++i) {
+    const LimbVector &c = coefficients[i]->a;
+    if (!c.empty())
+      limbs_add(r + i * k, r + i * k, n - i * k, c.data(), c.size());
+  }
+}
+
+/// x = v, for a non-negative v of up to 128 bits.
+inline void bigint_set_u128(BigInt &x, uint128 v) {
+  x.sign = 1;
+  x.a.clear();
+  for (; v; v >>= 64)
+    x.a.push_back(static_cast<limb>(v));
+}
+
+/// q = |a| / |b| and r = |a| % |b| by Knuth's algorithm D, or directly on
+/// 128-bit values.
+inline void bigint_divrem_basecase(const BigInt &a, const BigInt &b,
+                                   BigInt &q, BigInt &r) {
+  std::size_t an = a.a.size(), bn = b.a.size();
+  if (an <= 2 && bn <= 2) {
+    auto value = [](const BigInt &x) {
+      uint128 v = 0;
+      for (std::size_t i = x.a.size(); i-- > 0;)
+        v = (v << 64) | x.a[i];
+      return v;
+    };
+    uint128 x = value(a), y = value(b);
+    bigint_set_u128(q, x / y);
+    bigint_set_u128(r, x % y);
+    return;
+  }
+  q = BigInt();
+  if (an < bn || (an == bn && limbs_cmp(a.a.data(), b.a.data(), an) < 0)) {
+    r = a.abs();
+    return;
+  }
+  r = BigInt();
+  q.a.resize(an - bn + 1);
+  r.a.resize(bn);
+  limbs_divrem(q.a.data(), r.a.data(), a.a.data(), an, b.a.data(), bn);
   q.trim();
   r.trim();
+}
+
+inline void bz_div_3n_2n(const BigInt &a, const BigInt &b, std::size_t n,
+                         BigInt &q, BigInt &r);
 
-  return std::make_pair(q, r / norm);
+/// Burnikel-Ziegler: a / b where b has n limbs, its top bit set, and
+/// a < b B^n, so the quotient has at most n limbs.
+inline void bz_div_2n_1n(const BigInt &a, const BigInt &b, std::size_t n,
+                         BigInt &q, BigInt &r) {
+  if (n % 2 || n < burnikel_ziegler_threshold) {
+    bigint_divrem_basecase(a, b, q, r);
+    return;
+  }
+  // a = [a1 a2 a3 a4] in half-blocks: divide [a1 a2 a3] and then [r a4].
+  std::size_t h = n / 2;
+  BigInt q1, r1;
+  bz_div_3n_2n(bigint_limb_slice(a, h, 4 * h), b, h, q1, r1);
+  bz_div_3n_2n(bigint_join(r1, bigint_limb_slice(a, 0, h), h), b, h, q, r);
+  q = bigint_join(q1, q, h);
 }
 
-inline BigInt::vll BigInt::karatsuba_multiply(const BigInt::vll &a,
-                                              const BigInt::vll &b) {
-  std::size_t n = a.size();
-  BigInt::vll res(n + n);
+/// Burnikel-Ziegler: a = [a1 a2 a3] / b = [b1 b2] in blocks of n limbs,
+/// where b has its top bit set and a < b B^n.
+inline void bz_div_3n_2n(const BigInt &a, const BigInt &b, std::size_t n,
+                         BigInt &q, BigInt &r) {
+  // Estimate the quotient from [a1 a2] / b1; it is at most two too large.
+  BigInt b1 = bigint_limb_slice(b, n, 2 * n);
+  BigInt a12 = bigint_limb_slice(a, n, 3 * n);
+  BigInt r1;
+  if (bigint_limb_slice(a, 2 * n, 3 * n) < b1) {
+    bz_div_2n_1n(a12, b1, n, q, r1);
+  } else {
+    // a1 == b1: the estimate is B^n - 1, with remainder a12 - b1 B^n + b1.
+    q = BigInt();
+    q.a.assign(n, ~limb{0});
+    r1 = a12 - bigint_join(b1, BigInt(), n) + b1;
+  }
+  r = bigint_join(r1, bigint_limb_slice(a, 0, n), n) -
+      q * bigint_limb_slice(b, 0, n);
+  while (r.sign < 0) {
+    r += b;
+    q -= 1;
+  }
+}
 
-  if (n <= 32) {
-    for (std::size_t i = 0; i < n; ++i)
-      for (std::size_t j = 0; j < n; ++j)
-        res[i + j] += a[i] * b[j];
-    return res;
+/// q = |a| / |b| and r = |a| % |b|, recursively in O(M(n) log n) once both
+/// the divisor and the quotient are large.
+inline void bigint_divrem(const BigInt &a, const BigInt &b, BigInt &q,
+                          BigInt &r) {
+  std::size_t s = b.a.size();
+  if (s < burnikel_ziegler_threshold ||
+      a.a.size() < s + burnikel_ziegler_threshold) {
+    bigint_divrem_basecase(a, b, q, r);
+    return;
   }
 
-  std::size_t k = (n >> 1);
-  BigInt::vll a1(a.begin(), a.begin() + k);
-  BigInt::vll a2(a.begin() + k, a.end());
-  BigInt::vll b1(b.begin(), b.begin() + k);
-  BigInt::vll b2(b.begin() + k, b.end());
+  // Pad the divisor to n = j m limbs with m a power of two, so halving n
+  // reaches the base case through even sizes, and normalize it.
+  std::size_t m = std::bit_ceil(s / burnikel_ziegler_threshold + 1);
+  std::size_t n = (s + m - 1) / m * m;
+  std::size_t shift = 64 * n - b.bit_length();
+  BigInt bs = bigint_shl(b, shift), as = bigint_shl(a, shift);
+
+  // Divide t blocks of n limbs from the top, keeping the top block below
+  // B^n / 2 <= bs.
+  std::size_t t = std::max<std::size_t>(
+      2, (as.bit_length() + 1 + 64 * n - 1) / (64 * n));
+  BigInt z = bigint_limb_slice(as, (t - 2) * n, t * n), qi;
+  q = BigInt();
+  q.a.assign((t - 1) * n, 0);
+  for (std::size_t i = t - 1; i-- > 0;) {
+    bz_div_2n_1n(z, bs, n, qi, r);
+    std::copy(qi.a.begin(), qi.a.end(),
+              q.a.begin() + static_cast<std::ptrdiff_t>(i * n));
+    if (i > 0)
+      z = bigint_join(r, bigint_limb_slice(as, (i - 1) * n, i * n), n);
+  }
+  q.trim();
+  r = bigint_shr(r, shift);
+}
 
-  BigInt::vll a1b1 = karatsuba_multiply(a1, b1);
-  BigInt::vll a2b2 = karatsuba_multiply(a2, b2);
+/// 10^19, 10^38, 10^76, ..., 10^(19 2^i): the split points of the decimal
+/// conversions.
+inline std::vector<BigInt> decimal_powers(std::size_t count) {
+  std::vector<BigInt> powers(1);
+  powers[0].a.push_back(limb_decimal_base);
+  while (powers.size() < count)
+    powers.push_back(powers.back() * powers.back());
+  return powers;
+}
+
+/// Appends the decimal digits of |x|, left-padded with zeros to width.
+inline void decimal_basecase(const BigInt &x, std::size_t width,
+                             std::string &out) {
+  // Peel off 19 decimal digits at a time, least-significant first.
+  std::vector<limb> t(x.a.begin(), x.a.end());
+  std::size_t n = t.size();
+  std::vector<limb> chunks;
+  while (n > 0) {
+    chunks.push_back(limbs_divrem_1(t.data(), t.data(), n, limb_decimal_base));
+    n = limbs_normalized_size(t.data(), n);
+  }
+
+  std::string s = chunks.empty() ? "" : std::to_string(chunks.back());
+  for (std::size_t i = chunks.size(); i-- > 1;) {
+    std::string digits = std::to_string(chunks[i - 1]);
+    s.append(limb_decimal_digits - digits.size(), '0');
+    s += digits;
+  }
+  if (width > s.size())
+    out.append(width - s.size(), '0');
+  out += s;
+}
 
-  for (std::size_t i = 0; i < k; ++i)
-    a2[i] += a1[i];
-  for (std::size_t i = 0; i < k; ++i)
-    b2[i] += b1[i];
+/// Appends the digits of |x| < powers[levels - 1]^2, padded to width if it
+/// is nonzero, by splitting at powers[levels - 1].
+inline void decimal_recursive(const BigInt &x,
+                              const std::vector<BigInt> &powers,
+                              std::size_t levels, std::size_t width,
+                              std::string &out) {
+  if (levels == 0 || x.a.size() < radix_conversion_threshold) {
+    decimal_basecase(x, width, out);
+    return;
+  }
+  BigInt q, r;
+  bigint_divrem(x, powers[levels - 1], q, r);
+  std::size_t low = limb_decimal_digits << (levels - 1);
+  if (width == 0 && q.is_zero()) {
+    decimal_recursive(r, powers, levels - 1, 0, out);
+    return;
+  }
+  decimal_recursive(q, powers, levels - 1, width ? width - low : 0, out);
+  decimal_recursive(r, powers, levels - 1, low, out);
+}
 
-  BigInt::vll r = karatsuba_multiply(a2, b2);
-  for (std::size_t i = 0; i < a1b1.size(); ++i)
-    r[i] -= a1b1[i];
-  for (std::size_t i = 0; i < a2b2.size(); ++i)
-    r[i] -= a2b2[i];
+inline std::string bigint_to_decimal(const BigInt &x) {
+  std::string out;
+  if (x.a.size() < radix_conversion_threshold) {
+    decimal_basecase(x, 0, out);
+    return out;
+  }
+  // Square up to the first power of ten whose square exceeds x.
+  std::vector<BigInt> powers = decimal_powers(1);
+  while (2 * powers.back().bit_length() - 1 <= x.bit_length())
+    powers.push_back(powers.back() * powers.back());
+  decimal_recursive(x, powers, powers.size(), 0, out);
+  return out;
+}
 
-  for (std::size_t i = 0; i < r.size(); ++i)
-    res[i + k] += r[i];
-  for (std::size_t i = 0; i < a1b1.size(); ++i)
-    res[i] += a1b1[i];
-  for (std::size_t i = 0; i < a2b2.size(); ++i)
-    res[i + n] += a2b2[i];
+/// |x| for a string of decimal digits, most-significant chunk first.
+inline BigInt decimal_parse_basecase(std::string_view digits) {
+  BigInt x;
+  std::size_t chunk = digits.size() % limb_decimal_digits;
+  if (chunk == 0)
+    chunk = limb_decimal_digits;
+  for (std::size_t pos = 0; pos < digits.size();
+       pos += chunk, chunk = limb_decimal_digits) {
+    limb v = 0;
+    const char *first = digits.data() + pos;
+    auto [ptr, ec] = std::from_chars(first, first + chunk, v);
+    if (ec != std::errc{} || ptr != first + chunk) {
+      throw std::invalid_argument("Invalid BigInt string: " +
+                                  std::string(digits));
+    }
+    limb carry = limbs_mul_1(x.a.data(), x.a.data(), x.a.size(),
+                             limb_decimal_base);
+    if (carry)
+      x.a.push_back(carry);
+    if (x.a.empty())
+      x.a.push_back(0);
+    if (limbs_add(x.a.data(), x.a.data(), x.a.size(), &v, 1))
+      x.a.push_back(1);
+  }
+  x.trim();
+  return x;
+}
 
-  return res;
+/// Parses digits as high 10^(19 2^i) + low, with the largest split point
+/// shorter than digits.
+inline BigInt decimal_parse_recursive(std::string_view digits,
+                                      const std::vector<BigInt> &powers) {
+  if (digits.size() <= limb_decimal_digits * radix_conversion_threshold)
+    return decimal_parse_basecase(digits);
+  std::size_t i = 0;
+  while ((limb_decimal_digits << (i + 1)) < digits.size())
+    ++i;
+  std::size_t low = limb_decimal_digits << i;
+  BigInt x = decimal_parse_recursive(digits.substr(0, digits.size() - low),
+                                     powers) *
+             powers[i];
+  x += decimal_parse_recursive(digits.substr(digits.size() - low), powers);
+  return x;
+}
+
+inline void bigint_from_decimal(BigInt &x, std::string_view digits) {
+  std::size_t levels = 1;
+  while ((limb_decimal_digits << levels) < digits.size())
+    ++levels;
+  if (digits.size() <= limb_decimal_digits * radix_conversion_threshold)
+    levels = 0;
+  x.a = decimal_parse_recursive(digits, decimal_powers(levels)).a;
+}
+
+} // namespace detail
+
+inline void BigInt::add_product(const BigInt &u, const BigInt &v,
+                                int product_sign) {
+  const BigInt *x = &u, *y = &v;
+  if (x->a.size() < y->a.size())
+    std::swap(x, y);
+  if (y->a.empty())
+    return;
+
+  std::size_t xn = x->a.size();
+  if (y->a.size() > 1 || x == this || y == this ||
+      (!a.empty() && sign != product_sign)) {
+    BigInt product = u * v;
+    add_signed(product, product_sign);
+    return;
+  }
+
+  // |*this| += |x| m in place.
+  limb m = y->a[0];
+  std::size_t n = std::max(a.size(), xn) + 1;
+  a.resize(n);
+  limb carry = detail::limbs_addmul_1(a.data(), x->a.data(), xn, m);
+  detail::limbs_add(a.data() + xn, a.data() + xn, n - xn, &carry, 1);
+  sign = product_sign;
+  trim();
+}
+
+inline void addmul(BigInt &r, const BigInt &u, const BigInt &v) {
+  r.add_product(u, v, u.sign * v.sign);
+}
+
+inline void submul(BigInt &r, const BigInt &u, const BigInt &v) {
+  r.add_product(u, v, -u.sign * v.sign);
+}
+
+inline std::pair<BigInt, BigInt> divmod(const BigInt &a1, const BigInt &b1) {
+  if (b1.is_zero())
+    throw std::domain_error("BigInt division by zero");
+
+  BigInt q, r;
+  detail::bigint_divrem(a1, b1, q, r);
+
+  q.sign = a1.sign * b1.sign;
+  r.sign = a1.sign;
+  q.trim();
+  r.trim();
+
+  return std::make_pair(q, r);
 }
 
 } // namespace utils
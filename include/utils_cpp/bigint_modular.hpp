@@ -0,0 +1,244 @@
+/**********************************************************************
+ * @brief Modular arithmetic on BigInt: Montgomery multiplication, powmod and
+ *modinv.
+ * @details A MontgomeryContext fixes an odd modulus m and represents x as
+ *x R mod m, with R = 2^(64 n) for the n limbs of m, so a modular product is
+ *one full product and a word-by-word reduction, with no division. powmod
+ *uses it (with a fixed 4-bit window) for odd moduli, and grade-school
+ *square-and-multiply with division otherwise.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "bigint.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace utils {
+
+/// Arithmetic modulo a fixed odd m in Montgomery form.
+///
+/// Precomputes R mod m, R^2 mod m and -m^-1 mod 2^64, and reuses its scratch
+/// buffers between calls, so a context must not be shared between threads.
+class MontgomeryContext {
+public:
+  /// @throws std::domain_error if m is not odd and positive.
+  explicit MontgomeryContext(const BigInt &m);
+
+  const BigInt &modulus() const;
+
+  /// The Montgomery form x R mod m of any x.
+  BigInt to_montgomery(const BigInt &x) const;
+
+  /// x R^-1 mod m: the ordinary value of a Montgomery form.
+  BigInt from_montgomery(const BigInt &x) const;
+
+  /// x y R^-1 mod m: the Montgomery form of the product, from those of the
+  /// factors.
+  BigInt multiply(const BigInt &x, const BigInt &y) const;
+
+  /// base^exp mod m, in [0, m), for an ordinary (not Montgomery) base.
+  ///
+  /// @throws std::domain_error if exp is negative.
+  BigInt pow(const BigInt &base, const BigInt &exp) const;
+
+private:
+  using limb = detail::limb;
+
+  /// r = x y R^-1 mod m over n limbs. r may alias x or y.
+  void mont_mul(limb *r, const limb *x, const limb *y) const;
+
+  /// x mod m, in [0, m), padded to n limbs.
+  std::vector<limb> reduce(const BigInt &x) const;
+
+  /// The BigInt of an n-limb value.
+  BigInt to_bigint(const std::vector<limb> &x) const;
+
+  BigInt m_;
+  std::size_t n_;
+  limb neg_inv_; ///< -m^-1 mod 2^64
+  std::vector<limb> r_mod_;
+  std::vector<limb> r2_mod_;
+  mutable std::vector<limb> product_;
+};
+
+/// base^exp mod m, in [0, m). A negative exp raises the modular inverse of
+/// base.
+///
+/// @throws std::domain_error if m is not positive, or exp is negative and
+/// base is not invertible mod m.
+BigInt powmod(const BigInt &base, const BigInt &exp, const BigInt &m);
+
+/// The x in [0, m) with a x = 1 mod m, by the extended Euclidean algorithm.
+///
+/// @throws std::domain_error if m is not positive or gcd(a, m) != 1.
+BigInt modinv(const BigInt &a, const BigInt &m);
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+inline MontgomeryContext::MontgomeryContext(const BigInt &m)
+    : m_(m), n_(m.a.size()) {
+  if (m.sign < 0 || m.is_even())
+    throw std::domain_error("Montgomery modulus must be odd and positive");
+
+  // Newton's iteration doubles the correct low bits of m^-1 from 3.
+  limb inv = m.a[0];
+  for (int i = 0; i < 5; ++i)
+    inv *= 2 - m.a[0] * inv;
+  neg_inv_ = limb{0} - inv;
+
+  r_mod_ = reduce(detail::bigint_shl(BigInt(1), 64 * n_));
+  r2_mod_ = reduce(detail::bigint_shl(BigInt(1), 128 * n_));
+}
+
+inline const BigInt &MontgomeryContext::modulus() const { return m_; }
+
+inline std::vector<detail::limb>
+MontgomeryContext::reduce(const BigInt &x) const {
+  BigInt r = x % m_;
+  if (r.sign < 0)
+    r += m_;
+  std::vector<limb> res(n_);
+  std::copy(r.a.begin(), r.a.end(), res.begin());
+  return res;
+}
+
+inline BigInt MontgomeryContext::to_bigint(const std::vector<limb> &x) const {
+  BigInt res;
+  res.a.assign(x.begin(), x.end());
+  res.trim();
+  return res;
+}
+
+inline void MontgomeryContext::mont_mul(limb *r, const limb *x,
+                                        const limb *y) const {
+  std::size_t n = n_;
+  product_.assign(2 * n + 1, 0);
+  limb *t = product_.data();
+  detail::limbs_mul_any(t, x, n, y, n);
+
+  // Add multiples of m that clear the low limbs one at a time; then
+  // t / R < 2 m.
+  const limb *mp = m_.a.data();
+  for (std::size_t i = 0; i < n; ++i) {
+    limb carry = detail::limbs_addmul_1(t + i, mp, n, t[i] * neg_inv_);
+    for (std::size_t j = i + n; carry; ++j) {
+      t[j] += carry;
+      carry = t[j] < carry;
+    }
+  }
+  if (t[2 * n] || detail::limbs_cmp(t + n, mp, n) >= 0)
+    detail::limbs_sub_n(t + n, t + n, mp, n);
+  std::copy(t + n, t + 2 * n, r);
+}
+
+inline BigInt MontgomeryContext::to_montgomery(const BigInt &x) const {
+  std::vector<limb> v = reduce(x);
+  mont_mul(v.data(), v.data(), r2_mod_.data());
+  return to_bigint(v);
+}
+
+inline BigInt MontgomeryContext::from_montgomery(const BigInt &x) const {
+  std::vector<limb> v = reduce(x), one(n_);
+  one[0] = 1;
+  mont_mul(v.data(), v.data(), one.data());
+  return to_bigint(v);
+}
+
+inline BigInt MontgomeryContext::multiply(const BigInt &x,
+                                          const BigInt &y) const {
+  std::vector<limb> u = reduce(x), v = reduce(y);
+  mont_mul(u.data(), u.data(), v.data());
+  return to_bigint(u);
+}
+
+inline BigInt MontgomeryContext::pow(const BigInt &base,
+                                     const BigInt &exp) const {
+  if (exp.sign < 0)
+    throw std::domain_error("Negative BigInt exponent");
+
+  // Fixed window: table[d] is base^d in Montgomery form.
+  std::size_t bits = exp.bit_length();
+  std::size_t window = bits > 64 ? 4 : 1;
+  std::vector<std::vector<limb>> table(std::size_t{1} << window);
+  table[0] = r_mod_;
+  table[1] = reduce(base);
+  mont_mul(table[1].data(), table[1].data(), r2_mod_.data());
+  for (std::size_t d = 2; d < table.size(); ++d) {
+    table[d].resize(n_);
+    mont_mul(table[d].data(), table[d - 1].data(), table[1].data());
+  }
+
+  auto bit = [&](std::size_t i) {
+    return i < bits ? (exp.a[i / 64] >> (i % 64)) & 1 : limb{0};
+  };
+  std::vector<limb> acc = r_mod_;
+  for (std::size_t w = (bits + window - 1) / window; w-- > 0;) {
+    std::size_t digit = 0;
+    for (std::size_t j = window; j-- > 0;) {
+      mont_mul(acc.data(), acc.data(), acc.data());
+      digit = 2 * digit + bit(w * window + j);
+    }
+    if (digit)
+      mont_mul(acc.data(), acc.data(), table[digit].data());
+  }
+
+  std::vector<limb> one(n_);
+  one[0] = 1;
+  mont_mul(acc.data(), acc.data(), one.data());
+  return to_bigint(acc);
+}
+
+inline BigInt powmod(const BigInt &base, const BigInt &exp, const BigInt &m) {
+  if (m.sign < 0 || m.is_zero())
+    throw std::domain_error("BigInt modulus must be positive");
+  if (exp.sign < 0)
+    return powmod(modinv(base, m), -exp, m);
+  if (m.is_odd())
+    return MontgomeryContext(m).pow(base, exp);
+
+  BigInt b = base % m;
+  if (b.sign < 0)
+    b += m;
+  BigInt res = BigInt(1) % m;
+  for (std::size_t i = exp.bit_length(); i-- > 0;) {
+    res = res * res % m;
+    if ((exp.a[i / 64] >> (i % 64)) & 1)
+      res = res * b % m;
+  }
+  return res;
+}
+
+inline BigInt modinv(const BigInt &a, const BigInt &m) {
+  if (m.sign < 0 || m.is_zero())
+    throw std::domain_error("BigInt modulus must be positive");
+
+  // Invariant: r0 = t0 a and r1 = t1 a (mod m).
+  BigInt r0 = m, r1 = a % m;
+  if (r1.sign < 0)
+    r1 += m;
+  BigInt t0 = 0, t1 = 1;
+  while (!r1.is_zero()) {
+    auto [q, r] = divmod(r0, r1);
+    r0 = std::move(r1);
+    r1 = std::move(r);
+    submul(t0, q, t1);
+    std::swap(t0, t1);
+  }
+  if (r0 != BigInt(1))
+    throw std::domain_error("BigInt is not invertible modulo m");
+  if (t0.sign < 0)
+    t0 += m;
+  return t0;
+}
+
+} // namespace utils
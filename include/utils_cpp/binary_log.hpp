@@ -0,0 +1,777 @@
+/**********************************************************************
+ * @brief Structured binary logging for high-rate tracing.
+ * @details In the style of NanoLog: every LOGF call site registers a static
+ *descriptor (group, level, format string, file, line and argument types) the
+ *first time it runs. While a BinaryLogger file is open, a call only appends
+ *the descriptor id, a CPU tick timestamp and the raw bytes of its
+ *arguments to a per-thread buffer, without any formatting. Each descriptor is
+ *written to the file once, before the first message that uses it.
+ *decode_binary_log (and tools/decode_binary_log) turn the file back into
+ *text or JSON lines. When no file is open, LOGF formats its arguments and
+ *writes them through LogStream like LOG.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/json.hpp"
+#include "utils_cpp/logger.hpp"
+#include "utils_cpp/timing.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+/**
+ * Example:
+ *
+ * ENABLE_LOG_GROUPS(trace)
+ * CREATE_LOG_GROUPS(trace)
+ *
+ * BinaryLogger::open("trace.bin");
+ * for (...) {
+ *   LOGF(trace, "relaxed {} -> {} at distance {}", u, v, d);
+ * }
+ * BinaryLogger::close();
+ *
+ * // Later, offline:
+ * //   decode_binary_log trace.bin          (text)
+ * //   decode_binary_log --json trace.bin   (JSON lines)
+ *
+ * Arguments may be bools, chars, integers, floating point numbers, enums and
+ * strings. Other values are formatted with operator<< when logged and stored
+ * as strings. Each "{}" in the format is replaced by the next argument, and
+ * arguments without a "{}" are appended after a space.
+ */
+
+// LOGF_AT is LOGF at a given level, e.g. LOGF_AT(groupA, debug, "x = {}", x).
+#define LOGF_AT(group_name, log_level, format, ...)                            \
+  LOGGER_IMPL_IF_ENABLED(group_name, LogLevel::log_level)                      \
+  _logger_impl::log_structured<_logger_impl_##group_name>(                     \
+      [] {                                                                     \
+        return _logger_impl::log_site{_logger_impl_##group_name::name,         \
+                                      LogLevel::log_level, format, __FILE__,   \
+                                      __LINE__};                               \
+      } __VA_OPT__(, ) __VA_ARGS__)
+
+// LOGF logs a format string and its arguments at LogLevel::info.
+#define LOGF(group_name, format, ...)                                          \
+  LOGF_AT(group_name, info, format __VA_OPT__(, ) __VA_ARGS__)
+
+namespace _logger_impl {
+
+/// Type tags of the arguments stored in a binary log.
+enum class arg_type : std::uint8_t {
+  boolean,
+  character,
+  i8,
+  u8,
+  i16,
+  u16,
+  i32,
+  u32,
+  i64,
+  u64,
+  f32,
+  f64,
+  string
+};
+
+template <typename T>
+constexpr arg_type arg_type_of() {
+  if constexpr (std::is_same_v<T, bool>) {
+    return arg_type::boolean;
+  } else if constexpr (std::is_same_v<T, char>) {
+    return arg_type::character;
+  } else if constexpr (std::is_enum_v<T>) {
+    return arg_type_of<std::underlying_type_t<T>>();
+  } else if constexpr (std::is_integral_v<T>) {
+    constexpr bool s = std::is_signed_v<T>;
+    if constexpr (sizeof(T) == 1) {
+      return s ? arg_type::i8 : arg_type::u8;
+    } else if constexpr (sizeof(T) == 2) {
+      return s ? arg_type::i16 : arg_type::u16;
+    } else if constexpr (sizeof(T) == 4) {
+      return s ? arg_type::i32 : arg_type::u32;
+    } else {
+      return s ? arg_type::i64 : arg_type::u64;
+    }
+  } else if constexpr (std::is_same_v<T, float>) {
+    return arg_type::f32;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return arg_type::f64;
+  } else {
+    return arg_type::string;
+  }
+}
+
+/// The static part of a LOGF call site.
+struct log_site {
+  const char *group;
+  LogLevel level;
+  const char *format;
+  const char *file;
+  int line;
+};
+
+struct log_descriptor {
+  log_site site;
+  std::vector<arg_type> args;
+};
+
+/**
+ * Writes 'format' with each "{}" replaced by the next argument, through
+ * 'emit(os, i)' which writes argument i. Arguments left over are appended
+ * after a space. Shared by LOGF's text mode and the decoder, so both print
+ * the same thing.
+ */
+template <typename Emit>
+void write_format(std::ostream &os, std::string_view format,
+                  std::size_t num_args, Emit &&emit) {
+  for (std::size_t i = 0; i < num_args; ++i) {
+    auto pos = format.find("{}");
+    if (pos == std::string_view::npos) {
+      os << format << ' ';
+      format = {};
+    } else {
+      os << format.substr(0, pos);
+      format.remove_prefix(pos + 2);
+    }
+    emit(os, i);
+  }
+  os << format;
+}
+
+/**
+ * The value LOGF's text mode prints for an argument: the same as the decoder
+ * prints for the type it was stored as, e.g. enums and int8_t as numbers.
+ */
+template <typename T>
+decltype(auto) printed_value(const T &value) {
+  constexpr arg_type type = arg_type_of<T>();
+  if constexpr (type == arg_type::boolean || type == arg_type::character) {
+    return static_cast<T>(value);
+  } else if constexpr (std::is_enum_v<T>) {
+    return printed_value(static_cast<std::underlying_type_t<T>>(value));
+  } else if constexpr (std::is_integral_v<T>) {
+    if constexpr (std::is_signed_v<T>) {
+      return static_cast<std::int64_t>(value);
+    } else {
+      return static_cast<std::uint64_t>(value);
+    }
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return static_cast<double>(value);
+  } else {
+    return (value);
+  }
+}
+
+template <typename T>
+void append_bytes(std::vector<char> &out, const T &value) {
+  auto size = out.size();
+  out.resize(size + sizeof(T));
+  std::memcpy(out.data() + size, &value, sizeof(T));
+}
+
+inline void append_string(std::vector<char> &out, std::string_view s) {
+  append_bytes(out, static_cast<std::uint32_t>(s.size()));
+  out.insert(out.end(), s.begin(), s.end());
+}
+
+/**
+ * The argument as it is encoded: values of types without their own arg_type
+ * are formatted into a string, everything else is passed through.
+ */
+template <typename T>
+decltype(auto) encodable(const T &value) {
+  if constexpr (arg_type_of<T>() == arg_type::string &&
+                !std::is_convertible_v<const T &, std::string_view>) {
+    std::ostringstream ss;
+    ss << value;
+    return ss.str();
+  } else {
+    return (value);
+  }
+}
+
+template <typename T>
+std::size_t encoded_size(const T &value) {
+  constexpr arg_type type = arg_type_of<T>();
+  if constexpr (type == arg_type::string) {
+    return sizeof(std::uint32_t) + std::string_view(value).size();
+  } else if constexpr (type == arg_type::f64) {
+    return sizeof(double);
+  } else {
+    return sizeof(T);
+  }
+}
+
+template <typename T>
+char *encode_bytes(char *p, const T &value) {
+  std::memcpy(p, &value, sizeof(T));
+  return p + sizeof(T);
+}
+
+template <typename T>
+char *encode(char *p, const T &value) {
+  constexpr arg_type type = arg_type_of<T>();
+  if constexpr (type == arg_type::string) {
+    std::string_view s(value);
+    p = encode_bytes(p, static_cast<std::uint32_t>(s.size()));
+    std::memcpy(p, s.data(), s.size());
+    return p + s.size();
+  } else if constexpr (std::is_enum_v<T>) {
+    return encode_bytes(p, static_cast<std::underlying_type_t<T>>(value));
+  } else if constexpr (type == arg_type::f64) {
+    return encode_bytes(p, static_cast<double>(value));
+  } else {
+    return encode_bytes(p, value);
+  }
+}
+
+using utils::cpu_ticks;
+using utils::cpu_ticks_per_second;
+
+constexpr char binary_log_magic[8] = {'U', 'T', 'I', 'L', 'S', 'L', 'O', 'G'};
+constexpr std::uint32_t binary_log_version = 1;
+constexpr std::uint32_t binary_log_byte_order = 0x01020304;
+constexpr char descriptor_tag = 'D';
+constexpr char message_tag = 'M';
+constexpr char clock_tag = 'C';
+
+class binary_log_state;
+
+// A thread's buffer of encoded messages, registered with the state so that
+// close() can write out what other threads left in theirs.
+struct binary_thread_buffer {
+  binary_log_state &state;
+  // Set while the thread is writing a message, see binary_log_state.
+  std::atomic<bool> active{false};
+  std::uint64_t generation = 0;
+  std::vector<char> data;
+  // Descriptor ids this thread already knows are in the file.
+  std::vector<bool> known;
+
+  explicit binary_thread_buffer(binary_log_state &state);
+  ~binary_thread_buffer();
+};
+
+/**
+ * State of the binary backend. A writer sets its buffer's 'active' flag
+ * before checking 'is_open', and close() clears 'is_open' before waiting for
+ * every 'active' flag to clear, after which it owns every thread's buffer.
+ * The flags are per thread, so writers never share a cache line.
+ * Lock order: registry_mutex, then file_mutex, then descriptor_mutex.
+ *
+ * Timestamps are cpu_ticks(); the file records their rate and pairs of
+ * (ticks, wall time), from which the decoder recovers wall times.
+ *
+ * File layout: the magic, version, byte order marker and ticks per second,
+ * then entries, each starting with a tag byte:
+ * - 'C' ticks, wall time in ns since the epoch: a clock sync point, one
+ *   right after the header and one after each block of messages;
+ * - 'D' id, level, group, format, file, line, argument types: a descriptor,
+ *   always before the first message that uses it;
+ * - 'M' id, ticks, arguments: a message.
+ */
+class binary_log_state {
+public:
+  ~binary_log_state() { close(); }
+
+  void open(const std::string &filename, std::size_t buffer_bytes) {
+    std::scoped_lock<std::mutex> control(control_mutex);
+    close_locked();
+    double ticks_per_second = cpu_ticks_per_second();
+    std::FILE *f = std::fopen(filename.c_str(), "wb");
+    if (!f) {
+      throw std::runtime_error("BinaryLogger: cannot open '" + filename +
+                               "'");
+    }
+    {
+      std::scoped_lock<std::mutex> lock(file_mutex);
+      file = f;
+      written.clear();
+      std::vector<char> header;
+      header.insert(header.end(), std::begin(binary_log_magic),
+                    std::end(binary_log_magic));
+      append_bytes(header, binary_log_version);
+      append_bytes(header, binary_log_byte_order);
+      append_bytes(header, ticks_per_second);
+      write_file(header);
+      write_clock_sync();
+    }
+    threshold = buffer_bytes;
+    generation.fetch_add(1);
+    is_open.store(true);
+  }
+
+  void close() {
+    std::scoped_lock<std::mutex> control(control_mutex);
+    close_locked();
+  }
+
+  std::uint32_t register_descriptor(log_descriptor descriptor) {
+    std::scoped_lock<std::mutex> lock(descriptor_mutex);
+    descriptors.push_back(std::move(descriptor));
+    return static_cast<std::uint32_t>(descriptors.size() - 1);
+  }
+
+  /// Appends a message, or returns false if no file is open. Arguments must
+  /// have gone through encodable().
+  template <typename... Args>
+  bool write(std::uint32_t id, const Args &...args) {
+    binary_thread_buffer &buffer = local_buffer();
+    buffer.active.store(true);
+    if (!is_open.load()) {
+      buffer.active.store(false, std::memory_order_release);
+      return false;
+    }
+
+    std::uint64_t current = generation.load(std::memory_order_acquire);
+    if (buffer.generation != current) {
+      buffer.generation = current;
+      buffer.data.clear();
+      buffer.data.reserve(threshold + 256);
+      buffer.known.clear();
+    }
+    if (id >= buffer.known.size()) {
+      buffer.known.resize(id + 1, false);
+    }
+    if (!buffer.known[id]) {
+      write_descriptor(id);
+      buffer.known[id] = true;
+    }
+
+    const std::size_t size = 1 + sizeof(id) + sizeof(std::uint64_t) +
+                             (std::size_t{0} + ... + encoded_size(args));
+    std::size_t pos = buffer.data.size();
+    buffer.data.resize(pos + size);
+    char *p = buffer.data.data() + pos;
+    *p++ = message_tag;
+    p = encode_bytes(p, id);
+    p = encode_bytes(p, cpu_ticks());
+    ((p = encode(p, args)), ...);
+
+    if (buffer.data.size() >= threshold) {
+      std::scoped_lock<std::mutex> lock(file_mutex);
+      write_file(buffer.data);
+      write_clock_sync();
+      buffer.data.clear();
+    }
+
+    buffer.active.store(false, std::memory_order_release);
+    return true;
+  }
+
+  std::atomic<bool> is_open{false};
+
+private:
+  friend struct binary_thread_buffer;
+
+  binary_thread_buffer &local_buffer() {
+    thread_local binary_thread_buffer buffer(*this);
+    return buffer;
+  }
+
+  void close_locked() {
+    if (!is_open.load()) {
+      return;
+    }
+    is_open.store(false);
+    std::scoped_lock<std::mutex> registry(registry_mutex);
+    for (auto *buffer : buffers) {
+      while (buffer->active.load()) {
+        std::this_thread::yield();
+      }
+    }
+    std::scoped_lock<std::mutex> lock(file_mutex);
+    std::uint64_t current = generation.load();
+    for (auto *buffer : buffers) {
+      if (buffer->generation == current) {
+        write_file(buffer->data);
+      }
+      buffer->data.clear();
+    }
+    write_clock_sync();
+    std::fclose(file);
+    file = nullptr;
+  }
+
+  // Called by a thread's buffer when the thread exits.
+  void retire(binary_thread_buffer *buffer) {
+    std::scoped_lock<std::mutex> registry(registry_mutex);
+    {
+      std::scoped_lock<std::mutex> lock(file_mutex);
+      if (file && buffer->generation == generation.load() &&
+          !buffer->data.empty()) {
+        write_file(buffer->data);
+        write_clock_sync();
+      }
+    }
+    std::erase(buffers, buffer);
+  }
+
+  void write_descriptor(std::uint32_t id) {
+    std::scoped_lock<std::mutex> lock(file_mutex);
+    if (id < written.size() && written[id]) {
+      return;
+    }
+    if (id >= written.size()) {
+      written.resize(id + 1, false);
+    }
+    written[id] = true;
+
+    std::vector<char> entry;
+    {
+      std::scoped_lock<std::mutex> descriptors_lock(descriptor_mutex);
+      const log_descriptor &d = descriptors[id];
+      entry.push_back(descriptor_tag);
+      append_bytes(entry, id);
+      append_bytes(entry, static_cast<std::uint8_t>(d.site.level));
+      append_string(entry, d.site.group);
+      append_string(entry, d.site.format);
+      append_string(entry, d.site.file);
+      append_bytes(entry, static_cast<std::int32_t>(d.site.line));
+      append_bytes(entry, static_cast<std::uint32_t>(d.args.size()));
+      for (arg_type type : d.args) {
+        entry.push_back(static_cast<char>(type));
+      }
+    }
+    write_file(entry);
+  }
+
+  // Requires file_mutex.
+  void write_clock_sync() {
+    std::vector<char> entry;
+    entry.push_back(clock_tag);
+    append_bytes(entry, cpu_ticks());
+    append_bytes(entry,
+                 static_cast<std::int64_t>(
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count()));
+    write_file(entry);
+  }
+
+  // Requires file_mutex.
+  void write_file(const std::vector<char> &bytes) {
+    if (!bytes.empty()) {
+      std::fwrite(bytes.data(), 1, bytes.size(), file);
+    }
+  }
+
+  std::atomic<std::uint64_t> generation{0};
+  std::size_t threshold = 0;
+
+  std::mutex control_mutex;
+
+  std::mutex registry_mutex;
+  std::vector<binary_thread_buffer *> buffers;
+
+  std::mutex file_mutex;
+  std::FILE *file = nullptr;
+  // Descriptor ids already in the current file.
+  std::vector<bool> written;
+
+  std::mutex descriptor_mutex;
+  std::vector<log_descriptor> descriptors;
+};
+
+inline binary_thread_buffer::binary_thread_buffer(binary_log_state &state)
+    : state{state} {
+  std::scoped_lock<std::mutex> registry(state.registry_mutex);
+  state.buffers.push_back(this);
+}
+
+inline binary_thread_buffer::~binary_thread_buffer() { state.retire(this); }
+
+inline binary_log_state &binary_state() {
+  static binary_log_state state;
+  return state;
+}
+
+template <typename Group, typename Site, typename... Args>
+void log_structured(Site site, const Args &...args) {
+  static const std::uint32_t id = binary_state().register_descriptor(
+      {site(), {arg_type_of<std::decay_t<Args>>()...}});
+  if (binary_state().write(id, encodable(args)...)) {
+    return;
+  }
+
+  LogStream<Group> stream;
+  auto &fs = acquire_format_stream();
+  const std::string_view format = site().format;
+  write_format(fs.os, format, sizeof...(Args), [&](std::ostream &os,
+                                                   std::size_t i) {
+    std::size_t k = 0;
+    ((k++ == i ? void(os << printed_value(args)) : void()), ...);
+  });
+  stream << fs.buffer.text;
+  release_format_stream();
+}
+
+} // namespace _logger_impl
+
+/**
+ * Opens and closes the file that LOGF statements write to.
+ */
+struct BinaryLogger {
+  /**
+   * Starts writing LOGF messages to 'filename', replacing it. Each thread
+   * buffers about 'buffer_bytes' before writing to the file; buffers are
+   * also written out when their thread exits and on close(). Opening while
+   * open closes the previous file first.
+   * @throws std::runtime_error if the file cannot be created.
+   */
+  static void open(const std::string &filename,
+                   std::size_t buffer_bytes = 1 << 16) {
+    _logger_impl::binary_state().open(filename, buffer_bytes);
+  }
+
+  /// Writes out every thread's buffer and closes the file.
+  static void close() { _logger_impl::binary_state().close(); }
+
+  static bool is_open() noexcept {
+    return _logger_impl::binary_state().is_open.load();
+  }
+};
+
+/**
+ * Output of decode_binary_log: lines like LOG's output, or one JSON object
+ * per line.
+ */
+enum class BinaryLogFormat { text, json };
+
+/**
+ * Decodes a file written by BinaryLogger. Text lines look like
+ * "2023-01-31 12:34:56.123456 -- [group]: message". JSON lines hold the
+ * time, level, group, file, line, format, arguments and formatted message.
+ * @return number of messages decoded
+ * @throws std::runtime_error if the input is not a binary log, was written
+ * with a different byte order, or is truncated.
+ */
+inline std::size_t decode_binary_log(std::istream &in, std::ostream &out,
+                                     BinaryLogFormat format) {
+  using namespace _logger_impl;
+  using arg_value = std::variant<bool, char, std::int64_t, std::uint64_t,
+                                 double, std::string>;
+
+  auto read = [&](void *data, std::size_t n) {
+    if (!in.read(static_cast<char *>(data), static_cast<std::streamsize>(n))) {
+      throw std::runtime_error("decode_binary_log: truncated input");
+    }
+  };
+  auto read_value = [&]<typename T>(T) {
+    T value;
+    read(&value, sizeof(T));
+    return value;
+  };
+  auto read_string = [&] {
+    auto n = read_value(std::uint32_t{});
+    std::string s(n, '\0');
+    read(s.data(), n);
+    return s;
+  };
+
+  char magic[8];
+  read(magic, sizeof(magic));
+  if (std::memcmp(magic, binary_log_magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("decode_binary_log: not a binary log");
+  }
+  if (read_value(std::uint32_t{}) != binary_log_version) {
+    throw std::runtime_error("decode_binary_log: unsupported version");
+  }
+  if (read_value(std::uint32_t{}) != binary_log_byte_order) {
+    throw std::runtime_error("decode_binary_log: different byte order");
+  }
+  double ticks_per_second = read_value(double{});
+
+  // Wall times come from the latest clock sync point. Once a sync point is
+  // more than a second after the first one, the tick rate is re-measured
+  // between the two.
+  bool synced = false;
+  std::uint64_t first_ticks = 0, sync_ticks = 0;
+  std::int64_t first_ns = 0, sync_ns = 0;
+
+  struct descriptor {
+    LogLevel level;
+    std::string group, format, file;
+    std::int32_t line;
+    std::vector<arg_type> args;
+  };
+  std::vector<descriptor> descriptors;
+  std::vector<bool> defined;
+
+  static constexpr const char *level_names[] = {"trace", "debug", "info",
+                                                "warn",  "error", "off"};
+
+  timestamp_cache timestamps;
+  format_stream message;
+  format_stream time;
+  std::vector<arg_value> args;
+  std::size_t count = 0;
+
+  char tag;
+  while (in.get(tag)) {
+    if (tag == clock_tag) {
+      sync_ticks = read_value(std::uint64_t{});
+      sync_ns = read_value(std::int64_t{});
+      if (!synced) {
+        first_ticks = sync_ticks;
+        first_ns = sync_ns;
+        synced = true;
+      } else if (sync_ns - first_ns > 1'000'000'000 &&
+                 sync_ticks > first_ticks) {
+        ticks_per_second = static_cast<double>(sync_ticks - first_ticks) /
+                           (static_cast<double>(sync_ns - first_ns) * 1e-9);
+      }
+      continue;
+    }
+
+    auto id = read_value(std::uint32_t{});
+
+    if (tag == descriptor_tag) {
+      descriptor d;
+      d.level = static_cast<LogLevel>(read_value(std::uint8_t{}));
+      d.group = read_string();
+      d.format = read_string();
+      d.file = read_string();
+      d.line = read_value(std::int32_t{});
+      d.args.resize(read_value(std::uint32_t{}));
+      read(d.args.data(), d.args.size());
+      if (id >= descriptors.size()) {
+        descriptors.resize(id + 1);
+        defined.resize(id + 1, false);
+      }
+      descriptors[id] = std::move(d);
+      defined[id] = true;
+      continue;
+    }
+
+    if (tag != message_tag || !synced || id >= defined.size() ||
+        !defined[id]) {
+      throw std::runtime_error("decode_binary_log: corrupt input");
+    }
+    const descriptor &d = descriptors[id];
+    auto ticks = read_value(std::uint64_t{});
+
+    args.clear();
+    for (arg_type type : d.args) {
+      switch (type) {
+      case arg_type::boolean:
+        args.emplace_back(read_value(bool{}));
+        break;
+      case arg_type::character:
+        args.emplace_back(read_value(char{}));
+        break;
+      case arg_type::i8:
+        args.emplace_back(std::int64_t{read_value(std::int8_t{})});
+        break;
+      case arg_type::u8:
+        args.emplace_back(std::uint64_t{read_value(std::uint8_t{})});
+        break;
+      case arg_type::i16:
+        args.emplace_back(std::int64_t{read_value(std::int16_t{})});
+        break;
+      case arg_type::u16:
+        args.emplace_back(std::uint64_t{read_value(std::uint16_t{})});
+        break;
+      case arg_type::i32:
+        args.emplace_back(std::int64_t{read_value(std::int32_t{})});
+        break;
+      case arg_type::u32:
+        args.emplace_back(std::uint64_t{read_value(std::uint32_t{})});
+        break;
+      case arg_type::i64:
+        args.emplace_back(read_value(std::int64_t{}));
+        break;
+      case arg_type::u64:
+        args.emplace_back(read_value(std::uint64_t{}));
+        break;
+      case arg_type::f32:
+        args.emplace_back(double{read_value(float{})});
+        break;
+      case arg_type::f64:
+        args.emplace_back(read_value(double{}));
+        break;
+      case arg_type::string:
+        args.emplace_back(read_string());
+        break;
+      default:
+        throw std::runtime_error("decode_binary_log: corrupt input");
+      }
+    }
+
+    message.buffer.text.clear();
+    write_format(message.os, d.format, args.size(),
+                 [&](std::ostream &os, std::size_t i) {
+                   std::visit([&](const auto &v) { os << v; }, args[i]);
+                 });
+
+    double ticks_since_sync = ticks >= sync_ticks
+                                  ? static_cast<double>(ticks - sync_ticks)
+                                  : -static_cast<double>(sync_ticks - ticks);
+    std::int64_t nanoseconds =
+        sync_ns +
+        static_cast<std::int64_t>(ticks_since_sync / ticks_per_second * 1e9);
+    time.buffer.text.clear();
+    timestamps.write_wall(
+        time.os,
+        std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(nanoseconds))),
+        6);
+
+    const char *level = level_names[std::min<std::size_t>(
+        static_cast<std::size_t>(d.level), std::size(level_names) - 1)];
+    if (format == BinaryLogFormat::text) {
+      out << time.buffer.text << " -- [" << d.group << "]: "
+          << message.buffer.text << '\n';
+    } else {
+      std::vector<utils::Json> json_args;
+      for (const auto &arg : args) {
+        std::visit(
+            [&](const auto &v) {
+              using V = std::decay_t<decltype(v)>;
+              if constexpr (std::is_same_v<V, char>) {
+                json_args.emplace_back(std::string_view(&v, 1));
+              } else if constexpr (std::is_same_v<V, std::string>) {
+                json_args.emplace_back(std::string_view(v));
+              } else {
+                json_args.emplace_back(v);
+              }
+            },
+            arg);
+      }
+      utils::Json line;
+      line["time"] = utils::Json(std::string_view(time.buffer.text));
+      line["timestamp_ns"] = utils::Json(nanoseconds);
+      line["level"] = utils::Json(std::string_view(level));
+      line["group"] = utils::Json(std::string_view(d.group));
+      line["file"] = utils::Json(std::string_view(d.file));
+      line["line"] = utils::Json(d.line);
+      line["format"] = utils::Json(std::string_view(d.format));
+      line["args"] = utils::Json(json_args);
+      line["message"] = utils::Json(std::string_view(message.buffer.text));
+      line.dump(out);
+      out << '\n';
+    }
+    ++count;
+  }
+  return count;
+}
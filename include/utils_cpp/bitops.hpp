@@ -0,0 +1,411 @@
+/**********************************************************************
+ * @brief Bulk bitwise kernels over contiguous arrays of uint64_t words.
+ * @details Used by BitAdjmat and BitVector. Each kernel has a portable loop
+ *that compilers auto-vectorize, plus an explicit AVX2 path when the
+ *translation unit is compiled with AVX2 enabled (e.g. -mavx2 or
+ *-march=native). Population counts use the Harley-Seal carry-save adder
+ *method on AVX2, and the popcount_* functions fuse a bitwise operation with
+ *the count so that no temporary is materialized. decode_ones writes the
+ *positions of the set bits in bulk, with AVX-512 compress stores or a
+ *byte-indexed lookup table instead of one branch per bit.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(__AVX2__) || defined(__BMI2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace utils {
+namespace bitops {
+
+/**
+ * @brief dst[i] |= src[i] for i in [0, words).
+ */
+inline void or_into(std::uint64_t *dst, const std::uint64_t *src,
+                    std::size_t words) noexcept;
+
+/**
+ * @brief dst[i] &= src[i] for i in [0, words).
+ */
+inline void and_into(std::uint64_t *dst, const std::uint64_t *src,
+                     std::size_t words) noexcept;
+
+/**
+ * @brief dst[i] ^= src[i] for i in [0, words).
+ */
+inline void xor_into(std::uint64_t *dst, const std::uint64_t *src,
+                     std::size_t words) noexcept;
+
+/**
+ * @brief dst[i] &= ~src[i] for i in [0, words).
+ */
+inline void andnot_into(std::uint64_t *dst, const std::uint64_t *src,
+                        std::size_t words) noexcept;
+
+/**
+ * @brief dst[i] = ~dst[i] for i in [0, words).
+ */
+inline void not_inplace(std::uint64_t *dst, std::size_t words) noexcept;
+
+/**
+ * @brief Total number of set bits in a[0, words).
+ */
+inline std::size_t popcount(const std::uint64_t *a, std::size_t words) noexcept;
+
+/**
+ * @brief popcount(a & b) without materializing a & b.
+ */
+inline std::size_t popcount_and(const std::uint64_t *a, const std::uint64_t *b,
+                                std::size_t words) noexcept;
+
+/**
+ * @brief popcount(a | b) without materializing a | b.
+ */
+inline std::size_t popcount_or(const std::uint64_t *a, const std::uint64_t *b,
+                               std::size_t words) noexcept;
+
+/**
+ * @brief popcount(a ^ b), i.e. the Hamming distance between a and b.
+ */
+inline std::size_t popcount_xor(const std::uint64_t *a, const std::uint64_t *b,
+                                std::size_t words) noexcept;
+
+/**
+ * @brief popcount(a & ~b) without materializing a & ~b.
+ */
+inline std::size_t popcount_andnot(const std::uint64_t *a,
+                                   const std::uint64_t *b,
+                                   std::size_t words) noexcept;
+
+/**
+ * @brief Writes base + i for every set bit i of a[0, words), in increasing
+ * order, to the front of out and returns how many were written.
+ * @details out must hold at least popcount(a, words) values. Entries past the
+ * returned count may be overwritten.
+ */
+inline std::size_t decode_ones(const std::uint64_t *a, std::size_t words,
+                               std::uint32_t base,
+                               std::span<std::uint32_t> out) noexcept;
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+/**
+ * @brief Position of the r-th (0-based) set bit of w, which has more than r
+ * set bits. One pdep with BMI2, otherwise a byte-wise scan.
+ */
+inline unsigned select_in_word(std::uint64_t w, unsigned r) noexcept;
+
+namespace detail {
+
+struct op_or {
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b) { return a | b; }
+#if defined(__AVX2__)
+  static __m256i apply(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+#endif
+};
+
+struct op_and {
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b) { return a & b; }
+#if defined(__AVX2__)
+  static __m256i apply(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+#endif
+};
+
+struct op_xor {
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b) { return a ^ b; }
+#if defined(__AVX2__)
+  static __m256i apply(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+#endif
+};
+
+struct op_andnot {
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b) {
+    return a & ~b;
+  }
+#if defined(__AVX2__)
+  // _mm256_andnot_si256(x, y) computes ~x & y.
+  static __m256i apply(__m256i a, __m256i b) { return _mm256_andnot_si256(b, a); }
+#endif
+};
+
+struct op_first {
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t) { return a; }
+#if defined(__AVX2__)
+  static __m256i apply(__m256i a, __m256i) { return a; }
+#endif
+};
+
+template <typename Op>
+inline void apply_into(std::uint64_t *dst, const std::uint64_t *src,
+                       std::size_t words) noexcept {
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  std::size_t vector_words = words - words % 4;
+  for (; i < vector_words; i += 4) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), Op::apply(a, b));
+  }
+#endif
+  for (; i < words; ++i) {
+    dst[i] = Op::apply(dst[i], src[i]);
+  }
+}
+
+#if defined(__AVX2__)
+// Per-64-bit-lane popcount of a 256-bit vector (Mula's nibble lookup).
+inline __m256i popcount256(__m256i v) noexcept {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i lo = _mm256_and_si256(v, low_mask);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+  __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                   _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+
+// Carry-save adder: (h, l) = a + b + c, bitwise.
+inline void csa(__m256i &h, __m256i &l, __m256i a, __m256i b,
+                __m256i c) noexcept {
+  __m256i u = _mm256_xor_si256(a, b);
+  h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+  l = _mm256_xor_si256(u, c);
+}
+#endif
+
+template <typename Op>
+inline std::size_t popcount_binary(const std::uint64_t *a,
+                                   const std::uint64_t *b,
+                                   std::size_t words) noexcept {
+  std::size_t i = 0;
+  std::uint64_t count = 0;
+
+#if defined(__AVX2__)
+  auto load = [&](std::size_t w) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + w));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + w));
+    return Op::apply(x, y);
+  };
+
+  // Harley-Seal: 16 vectors (64 words) per iteration, one popcount each.
+  __m256i total = _mm256_setzero_si256();
+  __m256i ones = _mm256_setzero_si256(), twos = _mm256_setzero_si256(),
+          fours = _mm256_setzero_si256(), eights = _mm256_setzero_si256();
+  __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+
+  for (; i + 64 <= words; i += 64) {
+    csa(twos_a, ones, ones, load(i + 0), load(i + 4));
+    csa(twos_b, ones, ones, load(i + 8), load(i + 12));
+    csa(fours_a, twos, twos, twos_a, twos_b);
+    csa(twos_a, ones, ones, load(i + 16), load(i + 20));
+    csa(twos_b, ones, ones, load(i + 24), load(i + 28));
+    csa(fours_b, twos, twos, twos_a, twos_b);
+    csa(eights_a, fours, fours, fours_a, fours_b);
+    csa(twos_a, ones, ones, load(i + 32), load(i + 36));
+    csa(twos_b, ones, ones, load(i + 40), load(i + 44));
+    csa(fours_a, twos, twos, twos_a, twos_b);
+    csa(twos_a, ones, ones, load(i + 48), load(i + 52));
+    csa(twos_b, ones, ones, load(i + 56), load(i + 60));
+    csa(fours_b, twos, twos, twos_a, twos_b);
+    csa(eights_b, fours, fours, fours_a, fours_b);
+    csa(sixteens, eights, eights, eights_a, eights_b);
+    total = _mm256_add_epi64(total, popcount256(sixteens));
+  }
+
+  total = _mm256_slli_epi64(total, 4);
+  total = _mm256_add_epi64(total,
+                           _mm256_slli_epi64(popcount256(eights), 3));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(fours), 2));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(twos), 1));
+  total = _mm256_add_epi64(total, popcount256(ones));
+
+  for (; i + 4 <= words; i += 4) {
+    total = _mm256_add_epi64(total, popcount256(load(i)));
+  }
+
+  alignas(32) std::uint64_t lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), total);
+  count = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+  for (; i < words; ++i) {
+    count += std::popcount(Op::apply(a[i], b[i]));
+  }
+  return count;
+}
+
+// Positions of the set bits of each byte value, padded with zeros.
+inline constexpr auto byte_ones = [] {
+  std::array<std::array<std::uint8_t, 8>, 256> table{};
+  for (unsigned b = 0; b < 256; ++b) {
+    unsigned k = 0;
+    for (unsigned i = 0; i < 8; ++i) {
+      if ((b >> i) & 1) {
+        table[b][k++] = static_cast<std::uint8_t>(i);
+      }
+    }
+  }
+  return table;
+}();
+
+// Writes the set bits of w one at a time; out has room for all of them.
+inline std::uint32_t *decode_word_exact(std::uint64_t w, std::uint32_t base,
+                                        std::uint32_t *out) noexcept {
+  for (; w != 0; w &= w - 1) {
+    *out++ = base + static_cast<std::uint32_t>(std::countr_zero(w));
+  }
+  return out;
+}
+
+// Writes the set bits of w a byte at a time. Each byte stores all 8 table
+// entries and advances by its popcount, so out needs 64 values of room.
+inline std::uint32_t *decode_word_lut(std::uint64_t w, std::uint32_t base,
+                                      std::uint32_t *out) noexcept {
+  for (unsigned byte = 0; byte < 8; ++byte, w >>= 8, base += 8) {
+    const auto &entry = byte_ones[w & 0xff];
+#if defined(__AVX2__)
+    __m256i offsets = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(entry.data())));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i *>(out),
+        _mm256_add_epi32(offsets, _mm256_set1_epi32(static_cast<int>(base))));
+#else
+    for (unsigned i = 0; i < 8; ++i) {
+      out[i] = base + entry[i];
+    }
+#endif
+    out += std::popcount(w & 0xff);
+  }
+  return out;
+}
+
+} // namespace detail
+
+inline unsigned select_in_word(std::uint64_t w, unsigned r) noexcept {
+#if defined(__BMI2__)
+  return static_cast<unsigned>(
+      std::countr_zero(_pdep_u64(std::uint64_t{1} << r, w)));
+#else
+  unsigned shift = 0;
+  for (;; shift += 8) {
+    auto count = static_cast<unsigned>(std::popcount((w >> shift) & 0xff));
+    if (r < count) {
+      break;
+    }
+    r -= count;
+  }
+  std::uint64_t byte = (w >> shift) & 0xff;
+  for (; r > 0; --r) {
+    byte &= byte - 1;
+  }
+  return shift + static_cast<unsigned>(std::countr_zero(byte));
+#endif
+}
+
+inline void or_into(std::uint64_t *dst, const std::uint64_t *src,
+                    std::size_t words) noexcept {
+  detail::apply_into<detail::op_or>(dst, src, words);
+}
+
+inline void and_into(std::uint64_t *dst, const std::uint64_t *src,
+                     std::size_t words) noexcept {
+  detail::apply_into<detail::op_and>(dst, src, words);
+}
+
+inline void xor_into(std::uint64_t *dst, const std::uint64_t *src,
+                     std::size_t words) noexcept {
+  detail::apply_into<detail::op_xor>(dst, src, words);
+}
+
+inline void andnot_into(std::uint64_t *dst, const std::uint64_t *src,
+                        std::size_t words) noexcept {
+  detail::apply_into<detail::op_andnot>(dst, src, words);
+}
+
+inline void not_inplace(std::uint64_t *dst, std::size_t words) noexcept {
+  for (std::size_t i = 0; i < words; ++i) {
+    dst[i] = ~dst[i];
+  }
+}
+
+inline std::size_t popcount(const std::uint64_t *a,
+                            std::size_t words) noexcept {
+  return detail::popcount_binary<detail::op_first>(a, a, words);
+}
+
+inline std::size_t popcount_and(const std::uint64_t *a, const std::uint64_t *b,
+                                std::size_t words) noexcept {
+  return detail::popcount_binary<detail::op_and>(a, b, words);
+}
+
+inline std::size_t popcount_or(const std::uint64_t *a, const std::uint64_t *b,
+                               std::size_t words) noexcept {
+  return detail::popcount_binary<detail::op_or>(a, b, words);
+}
+
+inline std::size_t popcount_xor(const std::uint64_t *a, const std::uint64_t *b,
+                                std::size_t words) noexcept {
+  return detail::popcount_binary<detail::op_xor>(a, b, words);
+}
+
+inline std::size_t popcount_andnot(const std::uint64_t *a,
+                                   const std::uint64_t *b,
+                                   std::size_t words) noexcept {
+  return detail::popcount_binary<detail::op_andnot>(a, b, words);
+}
+
+inline std::size_t decode_ones(const std::uint64_t *a, std::size_t words,
+                               std::uint32_t base,
+                               std::span<std::uint32_t> out) noexcept {
+  std::uint32_t *dst = out.data();
+  [[maybe_unused]] std::uint32_t *const dst_end = dst + out.size();
+
+#if defined(__AVX512F__)
+  // Compress stores only write the selected lanes, so no slack is needed.
+  const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+                                          11, 12, 13, 14, 15);
+  for (std::size_t i = 0; i < words; ++i) {
+    std::uint64_t w = a[i];
+    if (w == 0) {
+      continue;
+    }
+    __m512i idx = _mm512_add_epi32(
+        lanes, _mm512_set1_epi32(static_cast<int>(base + 64 * i)));
+    for (unsigned part = 0; part < 4; ++part, w >>= 16) {
+      auto mask = static_cast<__mmask16>(w & 0xffff);
+      _mm512_mask_compressstoreu_epi32(dst, mask, idx);
+      dst += std::popcount(static_cast<unsigned>(mask));
+      idx = _mm512_add_epi32(idx, _mm512_set1_epi32(16));
+    }
+  }
+#else
+  for (std::size_t i = 0; i < words; ++i) {
+    std::uint64_t w = a[i];
+    if (w == 0) {
+      continue;
+    }
+    auto word_base = static_cast<std::uint32_t>(base + 64 * i);
+    dst = dst_end - dst >= 64 ? detail::decode_word_lut(w, word_base, dst)
+                              : detail::decode_word_exact(w, word_base, dst);
+  }
+#endif
+
+  return static_cast<std::size_t>(dst - out.data());
+}
+
+} // namespace bitops
+} // namespace utils
@@ -8,8 +8,13 @@
 
 #pragma once
 
+#include "utils_cpp/bitops.hpp"
+
+#include <algorithm>
 #include <bit>
+#include <cstdint>
 #include <iostream>
+#include <span>
 #include <vector>
 
 namespace utils {
@@ -28,25 +33,24 @@ public:
 
     std::size_t uint64_index;
 
-    ones_iterator(iter it, iter finish) noexcept
-        : it{it}, finish{finish}, uint64_copy{*it}, uint64_index{0} {
-
-      while (uint64_copy == 0 && it != finish) {
-        ++it;
-        ++uint64_index;
-        uint64_copy = *it;
-      }
+    ones_iterator(iter it_, iter finish_) noexcept
+        : it{it_}, finish{finish_}, uint64_copy{it != finish ? *it : 0},
+          uint64_index{0} {
+      skip_zero_words();
     }
 
     ones_iterator &operator++() noexcept {
-      uint64_copy &= ~(1ULL << std::countr_zero(uint64_copy));
+      uint64_copy &= uint64_copy - 1;
+      skip_zero_words();
+      return *this;
+    }
 
+    void skip_zero_words() noexcept {
       while (uint64_copy == 0 && it != finish) {
         ++it;
         ++uint64_index;
-        uint64_copy = *it;
+        uint64_copy = it != finish ? *it : 0;
       }
-      return *this;
     }
 
     std::size_t operator*() const noexcept {
@@ -112,20 +116,268 @@ public:
   }
 
   std::size_t popcount() const noexcept {
-    std::size_t count = 0;
-    for (auto i : data_) {
-      count += std::popcount(i);
+    return bitops::popcount(data_.data(), data_.size());
+  }
+
+  std::size_t size() const noexcept { return size_; }
+
+  /**
+   * Writes the indices of the set bits, in increasing order, to the front of
+   * out and returns how many there are. out must hold at least popcount();
+   * entries past the returned count may be overwritten.
+   */
+  std::size_t decode_into(std::span<std::uint32_t> out) const noexcept {
+    return bitops::decode_ones(data_.data(), data_.size(), 0, out);
+  }
+
+  /**
+   * Number of set bits in [0, i), for i <= size(). O(i / 64); see RankSelect
+   * for constant time.
+   */
+  std::size_t rank(std::size_t i) const noexcept {
+    std::size_t count = bitops::popcount(data_.data(), i / N);
+    if (i % N != 0) {
+      count += std::popcount(data_[i / N] & ((1ULL << (i % N)) - 1));
     }
     return count;
   }
 
-  std::size_t size() const noexcept { return size_; }
+  /**
+   * Index of the k-th (0-based) set bit, for k < popcount(). O(size() / 64);
+   * see RankSelect for near-constant time.
+   */
+  std::size_t select(std::size_t k) const noexcept {
+    std::size_t word = 0;
+    for (;; ++word) {
+      auto count = static_cast<std::size_t>(std::popcount(data_[word]));
+      if (k < count) {
+        break;
+      }
+      k -= count;
+    }
+    return N * word +
+           bitops::select_in_word(data_[word], static_cast<unsigned>(k));
+  }
+
+  /**
+   * The packed words, least significant bit first. Bits past size() are
+   * always zero.
+   */
+  const std::uint64_t *data() const noexcept { return data_.data(); }
+  std::size_t num_words() const noexcept { return data_.size(); }
+
+  // Bitwise operations. Both operands must have the same size.
+  BitVector &operator&=(const BitVector &other) noexcept {
+    bitops::and_into(data_.data(), other.data_.data(), data_.size());
+    return *this;
+  }
+
+  BitVector &operator|=(const BitVector &other) noexcept {
+    bitops::or_into(data_.data(), other.data_.data(), data_.size());
+    return *this;
+  }
+
+  BitVector &operator^=(const BitVector &other) noexcept {
+    bitops::xor_into(data_.data(), other.data_.data(), data_.size());
+    return *this;
+  }
+
+  /**
+   * this &= ~other
+   */
+  BitVector &andnot_assign(const BitVector &other) noexcept {
+    bitops::andnot_into(data_.data(), other.data_.data(), data_.size());
+    return *this;
+  }
+
+  /**
+   * Flip every bit.
+   */
+  BitVector &toggle() noexcept {
+    bitops::not_inplace(data_.data(), data_.size());
+    if (size_ % N != 0) {
+      data_.back() &= (1ULL << (size_ % N)) - 1;
+    }
+    return *this;
+  }
+
+  friend bool operator==(const BitVector &lhs, const BitVector &rhs) noexcept {
+    return lhs.size_ == rhs.size_ && lhs.data_ == rhs.data_;
+  }
 
 private:
   std::size_t size_;
   std::vector<uint64_t> data_;
 };
 
+inline BitVector operator&(BitVector x, const BitVector &y) noexcept {
+  return x &= y;
+}
+
+inline BitVector operator|(BitVector x, const BitVector &y) noexcept {
+  return x |= y;
+}
+
+inline BitVector operator^(BitVector x, const BitVector &y) noexcept {
+  return x ^= y;
+}
+
+/**
+ * popcount(a & b) without materializing the intersection.
+ */
+inline std::size_t popcount_and(const BitVector &a,
+                                const BitVector &b) noexcept {
+  return bitops::popcount_and(a.data(), b.data(), a.num_words());
+}
+
+/**
+ * popcount(a | b) without materializing the union.
+ */
+inline std::size_t popcount_or(const BitVector &a,
+                               const BitVector &b) noexcept {
+  return bitops::popcount_or(a.data(), b.data(), a.num_words());
+}
+
+/**
+ * popcount(a ^ b), i.e. the Hamming distance.
+ */
+inline std::size_t popcount_xor(const BitVector &a,
+                                const BitVector &b) noexcept {
+  return bitops::popcount_xor(a.data(), b.data(), a.num_words());
+}
+
+/**
+ * popcount(a & ~b) without materializing the difference.
+ */
+inline std::size_t popcount_andnot(const BitVector &a,
+                                   const BitVector &b) noexcept {
+  return bitops::popcount_andnot(a.data(), b.data(), a.num_words());
+}
+
+/**
+ * @brief A succinct rank/select index over a BitVector, in the rank9 layout.
+ * @details Every superblock of 512 bits stores the number of ones before it
+ * and, packed 9 bits each into one more word, the counts before each of its
+ * last seven words: 25% on top of the bits, for O(1) rank. Select also
+ * samples the superblock of every 512th one (at most 12.5% more), binary
+ * searches the superblocks between two samples, then the packed counts and
+ * finally the word.
+ *
+ * The index refers to the BitVector, and is invalidated when it changes.
+ */
+class RankSelect {
+public:
+  explicit RankSelect(const BitVector &bv);
+
+  /**
+   * Number of set bits in [0, i), for i <= size().
+   */
+  std::size_t rank(std::size_t i) const noexcept;
+
+  /**
+   * Index of the k-th (0-based) set bit, for k < num_ones().
+   */
+  std::size_t select(std::size_t k) const noexcept;
+
+  std::size_t num_ones() const noexcept { return num_ones_; }
+  std::size_t size() const noexcept { return bv_->size(); }
+
+  /**
+   * Bytes used by the index, excluding the bits themselves.
+   */
+  std::size_t index_bytes() const noexcept {
+    return sizeof(std::uint64_t) * counts_.size() +
+           sizeof(std::uint32_t) * samples_.size();
+  }
+
+private:
+  static constexpr std::size_t words_per_superblock = 8;
+  static constexpr std::size_t ones_per_sample = 512;
+
+  /// Ones before superblock s.
+  std::uint64_t absolute(std::size_t s) const noexcept {
+    return counts_[2 * s];
+  }
+
+  /// Ones before word w (< 8) within superblock s.
+  std::uint64_t relative(std::size_t s, std::size_t w) const noexcept {
+    return w == 0 ? 0 : (counts_[2 * s + 1] >> (9 * (w - 1))) & 0x1ff;
+  }
+
+  const BitVector *bv_;
+  std::size_t num_ones_ = 0;
+  std::vector<std::uint64_t> counts_;  ///< interleaved absolute, relative
+  std::vector<std::uint32_t> samples_; ///< superblock of one 512 j
+};
+
+inline RankSelect::RankSelect(const BitVector &bv) : bv_{&bv} {
+  const std::uint64_t *words = bv.data();
+  std::size_t num_words = bv.num_words();
+  std::size_t num_superblocks = num_words / words_per_superblock + 1;
+  counts_.assign(2 * num_superblocks, 0);
+
+  std::uint64_t total = 0;
+  for (std::size_t s = 0; s < num_superblocks; ++s) {
+    counts_[2 * s] = total;
+    std::uint64_t within = 0, packed = 0;
+    for (std::size_t w = 0; w < words_per_superblock; ++w) {
+      if (w > 0) {
+        packed |= within << (9 * (w - 1));
+      }
+      std::size_t word = s * words_per_superblock + w;
+      if (word < num_words) {
+        within += static_cast<std::uint64_t>(std::popcount(words[word]));
+      }
+    }
+    counts_[2 * s + 1] = packed;
+    while (samples_.size() * ones_per_sample < total + within) {
+      samples_.push_back(static_cast<std::uint32_t>(s));
+    }
+    total += within;
+  }
+  num_ones_ = total;
+}
+
+inline std::size_t RankSelect::rank(std::size_t i) const noexcept {
+  std::size_t word = i / BitVector::N;
+  std::size_t s = word / words_per_superblock;
+  std::size_t count = absolute(s) + relative(s, word % words_per_superblock);
+  if (i % BitVector::N != 0) {
+    count += std::popcount(bv_->data()[word] &
+                           ((1ULL << (i % BitVector::N)) - 1));
+  }
+  return count;
+}
+
+inline std::size_t RankSelect::select(std::size_t k) const noexcept {
+  // The last superblock starting at or before the k-th one lies between the
+  // samples of the neighbouring multiples of 512.
+  std::size_t lo = samples_[k / ones_per_sample];
+  std::size_t hi = k / ones_per_sample + 1 < samples_.size()
+                       ? samples_[k / ones_per_sample + 1] + 1
+                       : counts_.size() / 2;
+  while (hi - lo > 1) {
+    std::size_t mid = lo + (hi - lo) / 2;
+    if (absolute(mid) <= k) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+
+  std::size_t s = lo;
+  k -= absolute(s);
+  std::size_t w = 1;
+  while (w < words_per_superblock && relative(s, w) <= k) {
+    ++w;
+  }
+  --w;
+  k -= relative(s, w);
+  std::size_t word = s * words_per_superblock + w;
+  return BitVector::N * word +
+         bitops::select_in_word(bv_->data()[word], static_cast<unsigned>(k));
+}
+
 inline std::ostream &operator<<(std::ostream &os,
                                 const BitVector::bit_proxy &p) noexcept {
   os << p.bv.get(p.index);
@@ -0,0 +1,907 @@
+/**********************************************************************
+ * @brief B+-tree ordered set and map
+ * @details Keys live in fixed-size arrays of up to NodeKeys keys per node,
+ *and the leaves are linked in key order, so lookups touch a few cache lines
+ *per level and iteration walks contiguous arrays. The position of a key
+ *inside a node is found by counting the keys less than it, which for
+ *integer keys and std::less is a branch-free SIMD compare on AVX2 and an
+ *auto-vectorized loop elsewhere. BTreeSet has the insert/erase/contains and
+ *iterator interface of AVLTree (iterators yield an entry with a .key), so
+ *the two can be swapped with a typedef.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/node_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace utils {
+
+namespace detail {
+
+/**
+ * Default fan-out: about 256 bytes of keys per node, a multiple of 8
+ * between 8 and 64 keys.
+ */
+template <typename Key>
+constexpr std::size_t btree_node_keys() {
+  return std::clamp<std::size_t>(256 / sizeof(Key) / 8 * 8, 8, 64);
+}
+
+/**
+ * Number of keys in keys[0, n) that are less than key, for sorted keys.
+ * Capacity is the size of the array keys points into, which may be read
+ * past n.
+ */
+template <std::size_t Capacity, typename Key, typename Compare>
+std::size_t btree_count_less(const Key *keys, std::size_t n, const Key &key,
+                             const Compare &cmp) {
+  if constexpr (std::is_same_v<Compare, std::less<Key>> &&
+                std::is_integral_v<Key> &&
+                (sizeof(Key) == 4 || sizeof(Key) == 8)) {
+#if defined(__AVX2__)
+    // AVX2 compares are signed, so unsigned keys get their sign bit flipped.
+    std::uint64_t mask = 0;
+    if constexpr (sizeof(Key) == 4) {
+      const __m256i bias = _mm256_set1_epi32(
+          std::is_signed_v<Key> ? 0 : static_cast<int>(0x80000000u));
+      const __m256i x =
+          _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(key)), bias);
+      for (std::size_t i = 0; i < n; i += 8) {
+        __m256i k = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i)),
+            bias);
+        auto lt = static_cast<unsigned>(
+            _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, k))));
+        mask |= std::uint64_t{lt} << i;
+      }
+    } else {
+      const __m256i bias = _mm256_set1_epi64x(
+          std::is_signed_v<Key> ? 0
+                                : static_cast<long long>(0x8000000000000000ull));
+      const __m256i x = _mm256_xor_si256(
+          _mm256_set1_epi64x(static_cast<long long>(key)), bias);
+      for (std::size_t i = 0; i < n; i += 4) {
+        __m256i k = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i)),
+            bias);
+        auto lt = static_cast<unsigned>(
+            _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(x, k))));
+        mask |= std::uint64_t{lt} << i;
+      }
+    }
+    if (n < 64) {
+      mask &= (std::uint64_t{1} << n) - 1;
+    }
+    static_assert(Capacity <= 64 && Capacity % 8 == 0);
+    return static_cast<std::size_t>(std::popcount(mask));
+#endif
+  }
+
+  if constexpr (std::is_arithmetic_v<Key>) {
+    // A full scan without branches beats a binary search on a node this
+    // small, and vectorizes.
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      count += cmp(keys[i], key) ? 1 : 0;
+    }
+    return count;
+  } else {
+    return static_cast<std::size_t>(
+        std::lower_bound(keys, keys + n, key, cmp) - keys);
+  }
+}
+
+struct btree_no_values {};
+
+/**
+ * What a BTree iterator points at: the key, plus the value in a map.
+ */
+template <typename Key, typename Value>
+struct btree_entry {
+  const Key &key;
+  Value &value;
+};
+
+template <typename Key>
+struct btree_entry<Key, void> {
+  const Key &key;
+};
+
+} // namespace detail
+
+/**
+ * A B+-tree with up to NodeKeys keys per node, as an ordered set when
+ * Mapped is void and an ordered map otherwise. Use it through BTreeSet and
+ * BTreeMap.
+ *
+ * Keys are stored in the leaves, and inner nodes hold the largest key of
+ * each child but the last. Every node except the root is at least half full
+ * minus one, so the height is O(log n / log NodeKeys). Insert and erase
+ * split, merge or borrow on the way down, in one pass from the root. Key
+ * (and Mapped) must be default constructible.
+ *
+ * Nodes come from two NodePools, one for leaves and one for inner nodes,
+ * so clear() and destruction free whole slabs.
+ */
+template <typename Key, typename Mapped, typename Compare = std::less<Key>,
+          std::size_t NodeKeys = detail::btree_node_keys<Key>(),
+          typename Allocator = std::allocator<Key>>
+class BTree {
+
+  static_assert(NodeKeys >= 8 && NodeKeys <= 64 && NodeKeys % 8 == 0,
+                "BTree: NodeKeys must be a multiple of 8 in [8, 64]");
+
+  static constexpr bool is_map = !std::is_void_v<Mapped>;
+
+  // Stands in for Mapped in the map-only signatures when Mapped is void.
+  using value_type_or_none =
+      std::conditional_t<is_map, Mapped, detail::btree_no_values>;
+
+public:
+  using key_type = Key;
+  using mapped_type = Mapped;
+  using key_compare = Compare;
+
+  static constexpr std::size_t node_keys = NodeKeys;
+
+  BTree() = default;
+  explicit BTree(const Allocator &alloc) : leaves{alloc}, inners{alloc} {}
+  ~BTree() { destroy_nodes(); }
+  BTree(const BTree &) = delete;
+  BTree &operator=(const BTree &) = delete;
+  BTree(BTree &&other) noexcept
+      : root{std::exchange(other.root, nullptr)},
+        count{std::exchange(other.count, 0)}, leaves{std::move(other.leaves)},
+        inners{std::move(other.inners)} {}
+
+  BTree &operator=(BTree &&other) noexcept {
+    if (this != &other) {
+      destroy_nodes();
+      root = std::exchange(other.root, nullptr);
+      count = std::exchange(other.count, 0);
+      leaves = std::move(other.leaves);
+      inners = std::move(other.inners);
+    }
+    return *this;
+  }
+
+  /**
+   * A deep copy.
+   */
+  BTree clone() const;
+
+  void clear() noexcept {
+    destroy_nodes();
+    root = nullptr;
+    count = 0;
+  }
+
+  std::size_t size() const noexcept { return count; }
+  bool empty() const noexcept { return count == 0; }
+
+  /**
+   * Inserts key into a set. Returns false if it was already there.
+   */
+  bool insert(const Key &key)
+    requires(!is_map)
+  {
+    return emplace(key).second;
+  }
+
+  /**
+   * Inserts key with value into a map. Returns false, leaving the stored
+   * value alone, if key was already there.
+   */
+  bool insert(const Key &key, const value_type_or_none &value)
+    requires is_map
+  {
+    auto [pos, inserted] = emplace(key);
+    if (inserted) {
+      pos.leaf->values[pos.index] = value;
+    }
+    return inserted;
+  }
+
+  /**
+   * The value for key, default constructed first if key is new.
+   */
+  value_type_or_none &operator[](const Key &key)
+    requires is_map
+  {
+    auto pos = emplace(key).first;
+    return pos.leaf->values[pos.index];
+  }
+
+  /**
+   * The value for key. Throws std::out_of_range if key is not there.
+   */
+  const value_type_or_none &at(const Key &key) const
+    requires is_map;
+  value_type_or_none &at(const Key &key)
+    requires is_map
+  {
+    return const_cast<value_type_or_none &>(std::as_const(*this).at(key));
+  }
+
+  bool contains(const Key &key) const {
+    return find_position(key).leaf != nullptr;
+  }
+
+  /**
+   * Removes key. Returns false if it was not there.
+   */
+  bool erase(const Key &key);
+
+  /**
+   * Number of levels below the root, 0 when the root is a leaf.
+   */
+  std::size_t height() const;
+
+  const Key &min() const;
+  const Key &max() const;
+
+private:
+  struct Node {
+    bool is_leaf;
+    std::uint32_t count = 0;
+    std::array<Key, NodeKeys> keys{};
+
+    explicit Node(bool is_leaf) : is_leaf{is_leaf} {}
+  };
+
+  struct Leaf : Node {
+    [[no_unique_address]] std::conditional_t<
+        is_map, std::array<value_type_or_none, NodeKeys>,
+        detail::btree_no_values> values{};
+    Leaf *next = nullptr;
+
+    Leaf() : Node{true} {}
+  };
+
+  struct Inner : Node {
+    // Child i holds the keys in (keys[i - 1], keys[i]].
+    std::array<Node *, NodeKeys + 1> children{};
+
+    Inner() : Node{false} {}
+  };
+
+  using leaf_pool = NodePool<
+      Leaf,
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Leaf>>;
+  using inner_pool = NodePool<
+      Inner,
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Inner>>;
+
+  struct position {
+    Leaf *leaf;
+    std::size_t index;
+  };
+
+  template <bool IsConst>
+  class forward_iterator {
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = detail::btree_entry<
+        Key, std::conditional_t<IsConst && is_map, const Mapped, Mapped>>;
+    using reference = value_type;
+    using difference_type = std::ptrdiff_t;
+
+    struct pointer {
+      value_type entry;
+      const value_type *operator->() const { return &entry; }
+    };
+
+    forward_iterator() = default;
+    forward_iterator(position pos) : pos{pos} {}
+    template <bool C = IsConst>
+      requires C
+    forward_iterator(const forward_iterator<false> &other)
+        : pos{other.pos} {}
+
+    reference operator*() const {
+      if constexpr (is_map) {
+        return {pos.leaf->keys[pos.index], pos.leaf->values[pos.index]};
+      } else {
+        return {pos.leaf->keys[pos.index]};
+      }
+    }
+    pointer operator->() const { return {**this}; }
+
+    forward_iterator &operator++() {
+      if (++pos.index == pos.leaf->count) {
+        pos = {pos.leaf->next, 0};
+      }
+      return *this;
+    }
+
+    forward_iterator operator++(int) {
+      forward_iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    bool operator==(const forward_iterator &other) const {
+      return pos.leaf == other.pos.leaf && pos.index == other.pos.index;
+    }
+    bool operator!=(const forward_iterator &other) const {
+      return !(*this == other);
+    }
+
+  private:
+    friend class BTree;
+    template <bool>
+    friend class forward_iterator;
+
+    position pos{nullptr, 0};
+  };
+
+  Node *root = nullptr;
+  std::size_t count = 0;
+  Compare cmp;
+  leaf_pool leaves;
+  inner_pool inners;
+
+public:
+  using iterator = forward_iterator<false>;
+  using const_iterator = forward_iterator<true>;
+
+  iterator begin() { return iterator(first_position()); }
+  iterator end() { return iterator(); }
+  const_iterator begin() const { return const_iterator(first_position()); }
+  const_iterator end() const { return const_iterator(); }
+
+  iterator find(const Key &key) { return iterator(find_position(key)); }
+  const_iterator find(const Key &key) const {
+    return const_iterator(find_position(key));
+  }
+
+  /**
+   * First key not less than key, or end().
+   */
+  iterator lower_bound(const Key &key) {
+    return iterator(bound_position(key, false));
+  }
+  const_iterator lower_bound(const Key &key) const {
+    return const_iterator(bound_position(key, false));
+  }
+
+  /**
+   * First key greater than key, or end().
+   */
+  iterator upper_bound(const Key &key) {
+    return iterator(bound_position(key, true));
+  }
+  const_iterator upper_bound(const Key &key) const {
+    return const_iterator(bound_position(key, true));
+  }
+
+private:
+  // Non-root nodes keep at least this many keys.
+  static constexpr std::uint32_t min_keys = NodeKeys / 2 - 1;
+
+  std::size_t rank_in(const Node *node, const Key &key) const {
+    return detail::btree_count_less<NodeKeys>(node->keys.data(), node->count,
+                                              key, cmp);
+  }
+
+  static Inner *as_inner(Node *node) { return static_cast<Inner *>(node); }
+  static Leaf *as_leaf(Node *node) { return static_cast<Leaf *>(node); }
+  static const Inner *as_inner(const Node *node) {
+    return static_cast<const Inner *>(node);
+  }
+  static const Leaf *as_leaf(const Node *node) {
+    return static_cast<const Leaf *>(node);
+  }
+
+  /**
+   * The leaf whose key range holds key.
+   */
+  Leaf *find_leaf(const Key &key) const;
+
+  position find_position(const Key &key) const;
+  position bound_position(const Key &key, bool strict) const;
+  position first_position() const;
+
+  /**
+   * Finds key, inserting a default-valued entry if it is missing. Full nodes
+   * on the way down are split first, so the leaf always has room.
+   */
+  std::pair<position, bool> emplace(const Key &key);
+
+  /**
+   * Splits the full child i of parent in two around its middle key.
+   */
+  void split_child(Inner *parent, std::size_t i);
+
+  /**
+   * Gives child i of parent more than min_keys keys, by borrowing from a
+   * sibling or merging with one. Returns the child that now covers child
+   * i's key range.
+   */
+  Node *fill_child(Inner *parent, std::size_t i);
+
+  /**
+   * Merges child i + 1 of parent into child i.
+   */
+  void merge_children(Inner *parent, std::size_t i);
+
+  Node *clone_node(const Node *node, Leaf *&last_leaf, BTree &target) const;
+
+  void destroy_subtree(Node *node) noexcept;
+  void destroy_nodes() noexcept;
+};
+
+/**
+ * An ordered set on a B+-tree. Drop-in for AVLTree<Key, Compare>.
+ */
+template <typename Key, typename Compare = std::less<Key>,
+          std::size_t NodeKeys = detail::btree_node_keys<Key>(),
+          typename Allocator = std::allocator<Key>>
+using BTreeSet = BTree<Key, void, Compare, NodeKeys, Allocator>;
+
+/**
+ * An ordered map on a B+-tree. Iterators yield entries with .key and .value.
+ */
+template <typename Key, typename T, typename Compare = std::less<Key>,
+          std::size_t NodeKeys = detail::btree_node_keys<Key>(),
+          typename Allocator = std::allocator<Key>>
+using BTreeMap = BTree<Key, T, Compare, NodeKeys, Allocator>;
+
+// ==============
+// IMPLEMENTATION
+// ==============
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+BTree<Key, Mapped, Compare, NodeKeys, Allocator>
+BTree<Key, Mapped, Compare, NodeKeys, Allocator>::clone() const {
+  BTree new_tree{Allocator(leaves.get_allocator())};
+  Leaf *last_leaf = nullptr;
+  new_tree.root = clone_node(root, last_leaf, new_tree);
+  new_tree.count = count;
+  return new_tree;
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+typename BTree<Key, Mapped, Compare, NodeKeys, Allocator>::Node *
+BTree<Key, Mapped, Compare, NodeKeys, Allocator>::clone_node(
+    const Node *node, Leaf *&last_leaf, BTree &target) const {
+  if (!node) {
+    return nullptr;
+  }
+
+  if (node->is_leaf) {
+    Leaf *copy = target.leaves.create();
+    copy->count = node->count;
+    copy->keys = node->keys;
+    copy->values = as_leaf(node)->values;
+    // Children are cloned left to right, so this relinks the leaves in order.
+    if (last_leaf) {
+      last_leaf->next = copy;
+    }
+    last_leaf = copy;
+    return copy;
+  }
+
+  Inner *copy = target.inners.create();
+  copy->count = node->count;
+  copy->keys = node->keys;
+  for (std::size_t i = 0; i <= node->count; ++i) {
+    copy->children[i] =
+        clone_node(as_inner(node)->children[i], last_leaf, target);
+  }
+  return copy;
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+void BTree<Key, Mapped, Compare, NodeKeys, Allocator>::destroy_subtree(
+    Node *node) noexcept {
+  // The recursion is only as deep as the tree, a handful of levels.
+  if (node->is_leaf) {
+    std::destroy_at(as_leaf(node));
+    return;
+  }
+  for (std::size_t i = 0; i <= node->count; ++i) {
+    destroy_subtree(as_inner(node)->children[i]);
+  }
+  std::destroy_at(as_inner(node));
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+void BTree<Key, Mapped, Compare, NodeKeys, Allocator>::destroy_nodes() noexcept {
+  if constexpr (!std::is_trivially_destructible_v<Leaf> ||
+                !std::is_trivially_destructible_v<Inner>) {
+    if (root) {
+      destroy_subtree(root);
+    }
+  }
+  leaves.release();
+  inners.release();
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+const typename BTree<Key, Mapped, Compare, NodeKeys,
+                     Allocator>::value_type_or_none &
+BTree<Key, Mapped, Compare, NodeKeys, Allocator>::at(const Key &key) const
+  requires is_map
+{
+  position pos = find_position(key);
+  if (!pos.leaf) {
+    throw std::out_of_range("BTreeMap::at: key not found");
+  }
+  return pos.leaf->values[pos.index];
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+std::size_t BTree<Key, Mapped, Compare, NodeKeys, Allocator>::height() const {
+  std::size_t h = 0;
+  for (const Node *node = root; node && !node->is_leaf;
+       node = as_inner(node)->children[0]) {
+    ++h;
+  }
+  return h;
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+const Key &BTree<Key, Mapped, Compare, NodeKeys, Allocator>::min() const {
+  return first_position().leaf->keys[0];
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+const Key &BTree<Key, Mapped, Compare, NodeKeys, Allocator>::max() const {
+  const Node *node = root;
+  while (!node->is_leaf) {
+    node = as_inner(node)->children[node->count];
+  }
+  return node->keys[node->count - 1];
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+typename BTree<Key, Mapped, Compare, NodeKeys, Allocator>::Leaf *
+BTree<Key, Mapped, Compare, NodeKeys, Allocator>::find_leaf(
+    const Key &key) const {
+  Node *node = root;
+  if (!node) {
+    return nullptr;
+  }
+  while (!node->is_leaf) {
+    node = as_inner(node)->children[rank_in(node, key)];
+  }
+  return as_leaf(node);
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+typename BTree<Key, Mapped, Compare, NodeKeys, Allocator>::position
+BTree<Key, Mapped, Compare, NodeKeys, Allocator>::find_position(
+    const Key &key) const {
+  Leaf *leaf = find_leaf(key);
+  if (!leaf) {
+    return {nullptr, 0};
+  }
+  std::size_t i = rank_in(leaf, key);
+  if (i < leaf->count && !cmp(key, leaf->keys[i])) {
+    return {leaf, i};
+  }
+  return {nullptr, 0};
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+typename BTree<Key, Mapped, Compare, NodeKeys, Allocator>::position
+BTree<Key, Mapped, Compare, NodeKeys, Allocator>::bound_position(
+    const Key &key, bool strict) const {
+  Leaf *leaf = find_leaf(key);
+  if (!leaf) {
+    return {nullptr, 0};
+  }
+  std::size_t i = rank_in(leaf, key);
+  if (strict && i < leaf->count && !cmp(key, leaf->keys[i])) {
+    ++i;
+  }
+  // Every key in later leaves is greater than key.
+  if (i == leaf->count) {
+    return {leaf->next, 0};
+  }
+  return {leaf, i};
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+typename BTree<Key, Mapped, Compare, NodeKeys, Allocator>::position
+BTree<Key, Mapped, Compare, NodeKeys, Allocator>::first_position() const {
+  Node *node = root;
+  if (!node) {
+    return {nullptr, 0};
+  }
+  while (!node->is_leaf) {
+    node = as_inner(node)->children[0];
+  }
+  return {as_leaf(node), 0};
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+std::pair<typename BTree<Key, Mapped, Compare, NodeKeys, Allocator>::position,
+          bool>
+BTree<Key, Mapped, Compare, NodeKeys, Allocator>::emplace(const Key &key) {
+  if (!root) {
+    root = leaves.create();
+  }
+  if (root->count == NodeKeys) {
+    Inner *new_root = inners.create();
+    new_root->children[0] = root;
+    root = new_root;
+    split_child(new_root, 0);
+  }
+
+  Node *node = root;
+  while (!node->is_leaf) {
+    std::size_t i = rank_in(node, key);
+    Node *child = as_inner(node)->children[i];
+    if (child->count == NodeKeys) {
+      split_child(as_inner(node), i);
+      // The left half now ends at keys[i].
+      if (cmp(node->keys[i], key)) {
+        ++i;
+      }
+      child = as_inner(node)->children[i];
+    }
+    node = child;
+  }
+
+  Leaf *leaf = as_leaf(node);
+  std::size_t i = rank_in(leaf, key);
+  if (i < leaf->count && !cmp(key, leaf->keys[i])) {
+    return {{leaf, i}, false};
+  }
+
+  std::move_backward(leaf->keys.begin() + i, leaf->keys.begin() + leaf->count,
+                     leaf->keys.begin() + leaf->count + 1);
+  leaf->keys[i] = key;
+  if constexpr (is_map) {
+    std::move_backward(leaf->values.begin() + i,
+                       leaf->values.begin() + leaf->count,
+                       leaf->values.begin() + leaf->count + 1);
+    leaf->values[i] = Mapped();
+  }
+  ++leaf->count;
+  ++count;
+  return {{leaf, i}, true};
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+void BTree<Key, Mapped, Compare, NodeKeys, Allocator>::split_child(
+    Inner *parent, std::size_t i) {
+  Node *child = parent->children[i];
+  Node *right;
+  Key separator;
+
+  if (child->is_leaf) {
+    // The left leaf keeps [0, half) and its last key becomes the separator.
+    constexpr std::size_t half = NodeKeys / 2;
+    Leaf *left = as_leaf(child);
+    Leaf *new_leaf = leaves.create();
+    std::move(left->keys.begin() + half, left->keys.end(),
+              new_leaf->keys.begin());
+    if constexpr (is_map) {
+      std::move(left->values.begin() + half, left->values.end(),
+                new_leaf->values.begin());
+    }
+    new_leaf->count = NodeKeys - half;
+    left->count = half;
+    new_leaf->next = left->next;
+    left->next = new_leaf;
+    separator = left->keys[half - 1];
+    right = new_leaf;
+  } else {
+    // The middle key moves up; the halves keep the keys on either side.
+    constexpr std::size_t mid = NodeKeys / 2;
+    Inner *left = as_inner(child);
+    Inner *new_inner = inners.create();
+    std::move(left->keys.begin() + mid + 1, left->keys.end(),
+              new_inner->keys.begin());
+    std::copy(left->children.begin() + mid + 1, left->children.end(),
+              new_inner->children.begin());
+    new_inner->count = NodeKeys - mid - 1;
+    left->count = mid;
+    separator = std::move(left->keys[mid]);
+    right = new_inner;
+  }
+
+  std::move_backward(parent->keys.begin() + i,
+                     parent->keys.begin() + parent->count,
+                     parent->keys.begin() + parent->count + 1);
+  std::copy_backward(parent->children.begin() + i + 1,
+                     parent->children.begin() + parent->count + 1,
+                     parent->children.begin() + parent->count + 2);
+  parent->keys[i] = std::move(separator);
+  parent->children[i + 1] = right;
+  ++parent->count;
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+void BTree<Key, Mapped, Compare, NodeKeys, Allocator>::merge_children(
+    Inner *parent, std::size_t i) {
+  Node *left = parent->children[i];
+  Node *right = parent->children[i + 1];
+
+  if (left->is_leaf) {
+    Leaf *l = as_leaf(left), *r = as_leaf(right);
+    std::move(r->keys.begin(), r->keys.begin() + r->count,
+              l->keys.begin() + l->count);
+    if constexpr (is_map) {
+      std::move(r->values.begin(), r->values.begin() + r->count,
+                l->values.begin() + l->count);
+    }
+    l->count += r->count;
+    l->next = r->next;
+    leaves.destroy(r);
+  } else {
+    // The separator comes down between the two halves.
+    Inner *l = as_inner(left), *r = as_inner(right);
+    l->keys[l->count] = std::move(parent->keys[i]);
+    std::move(r->keys.begin(), r->keys.begin() + r->count,
+              l->keys.begin() + l->count + 1);
+    std::copy(r->children.begin(), r->children.begin() + r->count + 1,
+              l->children.begin() + l->count + 1);
+    l->count += r->count + 1;
+    inners.destroy(r);
+  }
+
+  std::move(parent->keys.begin() + i + 1, parent->keys.begin() + parent->count,
+            parent->keys.begin() + i);
+  std::copy(parent->children.begin() + i + 2,
+            parent->children.begin() + parent->count + 1,
+            parent->children.begin() + i + 1);
+  --parent->count;
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+typename BTree<Key, Mapped, Compare, NodeKeys, Allocator>::Node *
+BTree<Key, Mapped, Compare, NodeKeys, Allocator>::fill_child(Inner *parent,
+                                                             std::size_t i) {
+  Node *child = parent->children[i];
+  Node *left = i > 0 ? parent->children[i - 1] : nullptr;
+  Node *right = i < parent->count ? parent->children[i + 1] : nullptr;
+
+  if (left && left->count > min_keys) {
+    // Shift child right by one and move the last entry of left in.
+    std::move_backward(child->keys.begin(), child->keys.begin() + child->count,
+                       child->keys.begin() + child->count + 1);
+    if (child->is_leaf) {
+      Leaf *c = as_leaf(child), *l = as_leaf(left);
+      c->keys[0] = std::move(l->keys[l->count - 1]);
+      if constexpr (is_map) {
+        std::move_backward(c->values.begin(), c->values.begin() + c->count,
+                           c->values.begin() + c->count + 1);
+        c->values[0] = std::move(l->values[l->count - 1]);
+      }
+      --l->count;
+      parent->keys[i - 1] = l->keys[l->count - 1];
+    } else {
+      Inner *c = as_inner(child), *l = as_inner(left);
+      std::copy_backward(c->children.begin(),
+                         c->children.begin() + c->count + 1,
+                         c->children.begin() + c->count + 2);
+      c->keys[0] = std::move(parent->keys[i - 1]);
+      c->children[0] = l->children[l->count];
+      parent->keys[i - 1] = std::move(l->keys[l->count - 1]);
+      --l->count;
+    }
+    ++child->count;
+    return child;
+  }
+
+  if (right && right->count > min_keys) {
+    // Move the first entry of right to the end of child.
+    if (child->is_leaf) {
+      Leaf *c = as_leaf(child), *r = as_leaf(right);
+      c->keys[c->count] = std::move(r->keys[0]);
+      std::move(r->keys.begin() + 1, r->keys.begin() + r->count,
+                r->keys.begin());
+      if constexpr (is_map) {
+        c->values[c->count] = std::move(r->values[0]);
+        std::move(r->values.begin() + 1, r->values.begin() + r->count,
+                  r->values.begin());
+      }
+      parent->keys[i] = c->keys[c->count];
+    } else {
+      Inner *c = as_inner(child), *r = as_inner(right);
+      c->keys[c->count] = std::move(parent->keys[i]);
+      c->children[c->count + 1] = r->children[0];
+      parent->keys[i] = std::move(r->keys[0]);
+      std::move(r->keys.begin() + 1, r->keys.begin() + r->count,
+                r->keys.begin());
+      std::copy(r->children.begin() + 1, r->children.begin() + r->count + 1,
+                r->children.begin());
+    }
+    --right->count;
+    ++child->count;
+    return child;
+  }
+
+  // Both neighbours are at the minimum, so two minimal nodes fit in one.
+  if (right) {
+    merge_children(parent, i);
+    return child;
+  }
+  merge_children(parent, i - 1);
+  return left;
+}
+
+template <typename Key, typename Mapped, typename Compare,
+          std::size_t NodeKeys, typename Allocator>
+bool BTree<Key, Mapped, Compare, NodeKeys, Allocator>::erase(const Key &key) {
+  if (!root) {
+    return false;
+  }
+
+  // Every node entered below the root has more than min_keys keys, so the
+  // removal never leaves it underfull.
+  Node *node = root;
+  while (!node->is_leaf) {
+    Inner *inner = as_inner(node);
+    std::size_t i = rank_in(inner, key);
+    Node *child = inner->children[i];
+    if (child->count <= min_keys) {
+      child = fill_child(inner, i);
+    }
+    if (inner == root && inner->count == 0) {
+      root = child;
+      inners.destroy(inner);
+    }
+    node = child;
+  }
+
+  Leaf *leaf = as_leaf(node);
+  std::size_t i = rank_in(leaf, key);
+  if (i == leaf->count || cmp(key, leaf->keys[i])) {
+    return false;
+  }
+
+  std::move(leaf->keys.begin() + i + 1, leaf->keys.begin() + leaf->count,
+            leaf->keys.begin() + i);
+  if constexpr (is_map) {
+    std::move(leaf->values.begin() + i + 1,
+              leaf->values.begin() + leaf->count, leaf->values.begin() + i);
+  }
+  --leaf->count;
+  if (--count == 0) {
+    clear();
+  }
+  return true;
+}
+
+} // namespace utils
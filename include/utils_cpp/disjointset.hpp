@@ -1,7 +1,16 @@
 #pragma once
 
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <memory>
 #include <numeric>
+#include <span>
+#include <stdexcept>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace utils {
@@ -44,6 +53,85 @@ public:
   std::vector<std::vector<int>> get_connected_components();
 };
 
+/// Connected components in CSR form. Component c holds the elements
+/// vertices[offsets[c]], ..., vertices[offsets[c + 1] - 1] in increasing
+/// order, and labels[v] is the component of element v. Components are
+/// numbered in order of their smallest element.
+template <typename Index>
+struct DisjointSetComponents {
+  std::vector<Index> labels;
+  std::vector<Index> offsets;
+  std::vector<Index> vertices;
+
+  std::size_t size() const { return offsets.size() - 1; }
+
+  std::span<const Index> component(std::size_t c) const {
+    return {vertices.data() + offsets[c], vertices.data() + offsets[c + 1]};
+  }
+};
+
+/// A lock-free union-find that many threads can use at once, after Anderson
+/// and Woll. Each element has one 64-bit atomic word holding its parent and
+/// its rank, so linking a root and checking that it is still a root with the
+/// rank that was read is a single compare-and-swap. find() does path
+/// halving with compare-and-swap, and unite() links by rank with ties broken
+/// by index, which keeps parent chains acyclic under any interleaving.
+///
+/// Index is std::uint32_t, or std::uint64_t for more than 2^32 elements (up
+/// to 2^58).
+template <std::unsigned_integral Index = std::uint32_t>
+class ConcurrentDisjointSet {
+
+  static_assert(sizeof(Index) == 4 || sizeof(Index) == 8);
+
+  /// Bits of a word that hold the parent; the rest hold the rank.
+  static constexpr int parent_bits = sizeof(Index) == 4 ? 32 : 58;
+  static constexpr std::uint64_t parent_mask =
+      (std::uint64_t{1} << parent_bits) - 1;
+
+  std::size_t _n;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> _words;
+
+  static Index parent_of(std::uint64_t word) {
+    return static_cast<Index>(word & parent_mask);
+  }
+  static std::uint64_t rank_of(std::uint64_t word) {
+    return word >> parent_bits;
+  }
+  static std::uint64_t make_word(Index parent, std::uint64_t rank) {
+    return (rank << parent_bits) | parent;
+  }
+
+public:
+  /// Initiates n singleton sets. Throws std::length_error if n does not fit
+  /// in the index type.
+  explicit ConcurrentDisjointSet(std::size_t n);
+
+  std::size_t size() const { return _n; }
+
+  /// The root of v's set. Safe to call concurrently with unite(), but the
+  /// root may be stale by the time it is returned.
+  Index find(Index v);
+
+  /// Merges the sets of a and b. Returns false if they were already the same
+  /// set. Safe to call concurrently.
+  bool unite(Index a, Index b);
+
+  /// Whether a and b are in the same set. Safe to call concurrently; a true
+  /// answer stays true.
+  bool same(Index a, Index b);
+
+  /// Unites the endpoints of every edge, on pool's threads when pool is not
+  /// null.
+  void unite_all(std::span<const std::pair<Index, Index>> edges,
+                 parallel::thread_pool *pool = nullptr);
+
+  /// The sets as components in CSR form. Must not run concurrently with
+  /// unite().
+  DisjointSetComponents<Index>
+  components(parallel::thread_pool *pool = nullptr);
+};
+
 // IMPLEMENTATION
 
 inline DisjointSet::DisjointSet(int n)
@@ -98,4 +186,151 @@ inline std::vector<std::vector<int>> DisjointSet::get_connected_components() {
   return connected_components;
 }
 
+template <std::unsigned_integral Index>
+ConcurrentDisjointSet<Index>::ConcurrentDisjointSet(std::size_t n)
+    : _n{n}, _words{std::make_unique<std::atomic<std::uint64_t>[]>(n)} {
+  if (n > parent_mask) {
+    throw std::length_error(
+        "ConcurrentDisjointSet: too many elements for the index type");
+  }
+  for (std::size_t v = 0; v < n; ++v) {
+    _words[v].store(make_word(static_cast<Index>(v), 0),
+                    std::memory_order_relaxed);
+  }
+}
+
+template <std::unsigned_integral Index>
+Index ConcurrentDisjointSet<Index>::find(Index v) {
+  while (true) {
+    std::uint64_t word = _words[v].load(std::memory_order_acquire);
+    Index parent = parent_of(word);
+    if (parent == v) {
+      return v;
+    }
+
+    Index grandparent =
+        parent_of(_words[parent].load(std::memory_order_acquire));
+    if (grandparent != parent) {
+      // Path halving: point v at its grandparent. Losing the race is fine,
+      // since someone else moved v closer to the root.
+      _words[v].compare_exchange_weak(
+          word, make_word(grandparent, rank_of(word)),
+          std::memory_order_release, std::memory_order_relaxed);
+    }
+    v = grandparent;
+  }
+}
+
+template <std::unsigned_integral Index>
+bool ConcurrentDisjointSet<Index>::unite(Index a, Index b) {
+  while (true) {
+    a = find(a);
+    b = find(b);
+    if (a == b) {
+      return false;
+    }
+
+    std::uint64_t word_a = _words[a].load(std::memory_order_acquire);
+    std::uint64_t word_b = _words[b].load(std::memory_order_acquire);
+    if (parent_of(word_a) != a || parent_of(word_b) != b) {
+      continue;
+    }
+
+    // Link the root that is lower in (rank, index) order below the other.
+    std::uint64_t rank_a = rank_of(word_a), rank_b = rank_of(word_b);
+    if (rank_a > rank_b || (rank_a == rank_b && a > b)) {
+      std::swap(a, b);
+      std::swap(word_a, word_b);
+      std::swap(rank_a, rank_b);
+    }
+    if (!_words[a].compare_exchange_strong(word_a, make_word(b, rank_a),
+                                           std::memory_order_acq_rel)) {
+      continue;
+    }
+    if (rank_a == rank_b) {
+      // Fails only if b stopped being a root or was bumped already, and
+      // ranks only need to be approximately right.
+      _words[b].compare_exchange_strong(word_b, make_word(b, rank_b + 1),
+                                        std::memory_order_acq_rel);
+    }
+    return true;
+  }
+}
+
+template <std::unsigned_integral Index>
+bool ConcurrentDisjointSet<Index>::same(Index a, Index b) {
+  while (true) {
+    a = find(a);
+    b = find(b);
+    if (a == b) {
+      return true;
+    }
+    // a was a root at some point after b's root was found; if it still is,
+    // the two were separate at that moment.
+    if (parent_of(_words[a].load(std::memory_order_acquire)) == a) {
+      return false;
+    }
+  }
+}
+
+template <std::unsigned_integral Index>
+void ConcurrentDisjointSet<Index>::unite_all(
+    std::span<const std::pair<Index, Index>> edges,
+    parallel::thread_pool *pool) {
+  if (!pool) {
+    for (auto [a, b] : edges) {
+      unite(a, b);
+    }
+    return;
+  }
+  pool->parallel_for(std::size_t{0}, edges.size(), 4096, [&](std::size_t e) {
+    unite(edges[e].first, edges[e].second);
+  });
+}
+
+template <std::unsigned_integral Index>
+DisjointSetComponents<Index>
+ConcurrentDisjointSet<Index>::components(parallel::thread_pool *pool) {
+  DisjointSetComponents<Index> result;
+  std::vector<Index> &labels = result.labels;
+  labels.resize(_n);
+
+  auto find_root = [&](std::size_t v) {
+    labels[v] = find(static_cast<Index>(v));
+  };
+  if (pool) {
+    pool->parallel_for(std::size_t{0}, _n, 4096, find_root);
+  } else {
+    for (std::size_t v = 0; v < _n; ++v) {
+      find_root(v);
+    }
+  }
+
+  // Number the components in order of their smallest element, through a
+  // scratch map from root to label.
+  std::vector<Index> label_of_root(_n, static_cast<Index>(-1));
+  Index num_components = 0;
+  for (std::size_t v = 0; v < _n; ++v) {
+    Index &label = label_of_root[labels[v]];
+    if (label == static_cast<Index>(-1)) {
+      label = num_components++;
+    }
+    labels[v] = label;
+  }
+
+  // Counting sort of the elements by label.
+  result.offsets.assign(static_cast<std::size_t>(num_components) + 1, 0);
+  for (Index label : labels) {
+    ++result.offsets[label + 1];
+  }
+  std::partial_sum(result.offsets.begin(), result.offsets.end(),
+                   result.offsets.begin());
+  result.vertices.resize(_n);
+  std::vector<Index> next(result.offsets.begin(), result.offsets.end() - 1);
+  for (std::size_t v = 0; v < _n; ++v) {
+    result.vertices[next[labels[v]]++] = static_cast<Index>(v);
+  }
+  return result;
+}
+
 } // namespace utils
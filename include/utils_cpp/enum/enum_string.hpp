@@ -0,0 +1,206 @@
+/**********************************************************************
+ * @brief Constant-time conversion between enum values and their names.
+ * @details The names come from enum_print's compile-time field table. For
+ *each enum a perfect hash of the names is built at compile time (hash and
+ *displace: names are split into buckets by one hash, and each bucket gets a
+ *displacement that sends all its names to free slots), so
+ *enum_from_string hashes its argument once, probes one slot and compares one
+ *name. All tables are constexpr variables, with no static initialization.
+ *Like enum_print, only values in [0, ENUM_MAX) are seen.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "utils_cpp/enum/enum_basics.hpp"
+#include "utils_cpp/enum/enum_print.hpp"
+
+namespace utils {
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief The name of an enum value without its enum and namespace
+ * qualifiers.
+ */
+constexpr std::string_view unqualified_enum_name(std::string_view s) noexcept {
+  auto pos = s.rfind("::");
+  return pos == std::string_view::npos ? s : s.substr(pos + 2);
+}
+
+/**
+ * @internal
+ * @brief Whether an entry of enum_fields_array_v names a field, rather than
+ * being a cast of a value with no field, such as (Enum)5.
+ */
+constexpr bool is_enum_field_name(std::string_view s) noexcept {
+  return !s.empty() && s.find(')') == std::string_view::npos;
+}
+
+/// @internal FNV-1a over the name, finished with the splitmix64 finalizer.
+constexpr std::uint64_t enum_name_hash(std::string_view s) noexcept {
+  std::uint64_t h = 0xcbf29ce484222325ull;
+  for (char c : s) {
+    h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+  }
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+  return h ^ (h >> 31);
+}
+
+/// @internal The slot of a name hash under a bucket's displacement.
+constexpr std::size_t enum_name_slot(std::uint64_t h, std::uint32_t d,
+                                     std::size_t num_slots) noexcept {
+  h = (h ^ (d * 0x9e3779b97f4a7c15ull)) * 0xff51afd7ed558ccdull;
+  return static_cast<std::size_t>(h >> 32) & (num_slots - 1);
+}
+
+template <typename E>
+inline constexpr std::size_t enum_count_v = [] {
+  std::size_t n = 0;
+  for (auto s : enum_fields_array_v<E>) {
+    n += is_enum_field_name(s);
+  }
+  return n;
+}();
+
+/**
+ * @internal
+ * @brief The fields of an enum with N fields, and a perfect hash of their
+ * names. slots and index_of_value hold field index + 1, with 0 for none.
+ */
+template <typename E, std::size_t N>
+struct enum_string_table {
+  static constexpr std::size_t num_slots = std::bit_ceil(2 * N + 1);
+  static constexpr std::size_t num_buckets = N / 2 + 1;
+
+  std::array<E, N> values{};
+  std::array<std::string_view, N> names{};
+  std::array<std::uint16_t, ENUM_MAX> index_of_value{};
+  std::array<std::uint32_t, num_buckets> displacement{};
+  std::array<std::uint16_t, num_slots> slots{};
+};
+
+template <typename E>
+consteval auto make_enum_string_table() {
+  constexpr std::size_t N = enum_count_v<E>;
+  using table_type = enum_string_table<E, N>;
+  table_type t;
+
+  std::size_t k = 0;
+  for (std::size_t i = 0; i < ENUM_MAX; ++i) {
+    auto s = enum_fields_array_v<E>[i];
+    if (is_enum_field_name(s)) {
+      t.values[k] = static_cast<E>(i);
+      t.names[k] = unqualified_enum_name(s);
+      t.index_of_value[i] = static_cast<std::uint16_t>(k + 1);
+      ++k;
+    }
+  }
+
+  std::array<std::uint64_t, N> hash{};
+  std::array<std::size_t, table_type::num_buckets> bucket_size{};
+  for (std::size_t i = 0; i < N; ++i) {
+    hash[i] = enum_name_hash(t.names[i]);
+    ++bucket_size[hash[i] % table_type::num_buckets];
+  }
+
+  // Place the largest buckets first, while most slots are still free.
+  for (std::size_t size = N; size > 0; --size) {
+    for (std::size_t b = 0; b < table_type::num_buckets; ++b) {
+      if (bucket_size[b] != size) {
+        continue;
+      }
+      for (std::uint32_t d = 0;; ++d) {
+        std::array<std::size_t, N> placed{};
+        std::size_t num_placed = 0;
+        bool fits = true;
+        for (std::size_t i = 0; i < N && fits; ++i) {
+          if (hash[i] % table_type::num_buckets != b) {
+            continue;
+          }
+          auto slot = enum_name_slot(hash[i], d, table_type::num_slots);
+          fits = t.slots[slot] == 0;
+          for (std::size_t j = 0; j < num_placed && fits; ++j) {
+            fits = placed[j] != slot;
+          }
+          placed[num_placed++] = slot;
+        }
+        if (!fits) {
+          continue;
+        }
+        for (std::size_t i = 0; i < N; ++i) {
+          if (hash[i] % table_type::num_buckets == b) {
+            t.slots[enum_name_slot(hash[i], d, table_type::num_slots)] =
+                static_cast<std::uint16_t>(i + 1);
+          }
+        }
+        t.displacement[b] = d;
+        break;
+      }
+    }
+  }
+  return t;
+}
+
+template <typename E>
+inline constexpr auto enum_string_table_v = make_enum_string_table<E>();
+
+} // namespace detail
+
+/**
+ * @brief The values of E that have a field, in increasing order.
+ */
+template <typename E>
+  requires std::is_enum_v<E>
+constexpr const auto &enum_values() noexcept {
+  return detail::enum_string_table_v<E>.values;
+}
+
+/**
+ * @brief The unqualified name of e, e.g. "LARGEST_FIRST", or an empty view
+ * if e has no field.
+ */
+template <typename E>
+  requires std::is_enum_v<E>
+constexpr std::string_view enum_to_string(E e) noexcept {
+  const auto &t = detail::enum_string_table_v<E>;
+  auto i = static_cast<std::underlying_type_t<E>>(e);
+  if (!std::in_range<std::size_t>(i) ||
+      static_cast<std::size_t>(i) >= ENUM_MAX) {
+    return {};
+  }
+  std::size_t k = t.index_of_value[static_cast<std::size_t>(i)];
+  return k == 0 ? std::string_view{} : t.names[k - 1];
+}
+
+/**
+ * @brief The value of E whose unqualified name is s, in constant time.
+ */
+template <typename E>
+  requires std::is_enum_v<E>
+constexpr std::optional<E> enum_from_string(std::string_view s) noexcept {
+  using table_type = std::decay_t<decltype(detail::enum_string_table_v<E>)>;
+  const auto &t = detail::enum_string_table_v<E>;
+  std::uint64_t h = detail::enum_name_hash(s);
+  std::uint32_t d = t.displacement[h % table_type::num_buckets];
+  std::size_t k = t.slots[detail::enum_name_slot(h, d, table_type::num_slots)];
+  if (k == 0 || t.names[k - 1] != s) {
+    return std::nullopt;
+  }
+  return t.values[k - 1];
+}
+
+} // namespace utils
@@ -0,0 +1,104 @@
+/**********************************************************************
+ * @brief Fenwick (binary indexed) tree for prefix sums.
+ * @details Point updates, prefix sums and a search for the first prefix
+ *sum reaching a target, all in O(log n) on one contiguous array. Lighter
+ *than a SegmentTree when only sums of prefixes are needed.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace utils {
+
+/**
+ * tree[i] (1-based) holds the sum of the elements in (i - lowbit(i), i],
+ * where lowbit(i) is the lowest set bit of i.
+ */
+template <typename T>
+class FenwickTree {
+
+  std::vector<T> tree; // tree[0] is unused
+
+  static std::size_t lowbit(std::size_t i) { return i & (~i + 1); }
+
+public:
+  FenwickTree() : tree(1) {}
+
+  /**
+   * n zeros.
+   */
+  explicit FenwickTree(std::size_t n) : tree(n + 1) {}
+
+  /**
+   * Builds the tree over values in O(n).
+   */
+  explicit FenwickTree(std::span<const T> values) : tree(values.size() + 1) {
+    for (std::size_t i = 1; i < tree.size(); ++i) {
+      tree[i] = values[i - 1];
+    }
+    for (std::size_t i = 1; i < tree.size(); ++i) {
+      std::size_t parent = i + lowbit(i);
+      if (parent < tree.size()) {
+        tree[parent] += tree[i];
+      }
+    }
+  }
+
+  explicit FenwickTree(const std::vector<T> &values)
+      : FenwickTree(std::span<const T>(values)) {}
+
+  std::size_t size() const { return tree.size() - 1; }
+
+  /**
+   * Adds delta to element i.
+   */
+  void add(std::size_t i, const T &delta) {
+    for (++i; i < tree.size(); i += lowbit(i)) {
+      tree[i] += delta;
+    }
+  }
+
+  /**
+   * Sum of the elements in [0, r).
+   */
+  T prefix(std::size_t r) const {
+    T sum{};
+    for (; r > 0; r -= lowbit(r)) {
+      sum += tree[r];
+    }
+    return sum;
+  }
+
+  /**
+   * Sum of the elements in [l, r).
+   */
+  T sum(std::size_t l, std::size_t r) const { return prefix(r) - prefix(l); }
+
+  /**
+   * The smallest r such that prefix(r + 1) >= target, or size() if there is
+   * none. The elements must be non-negative, so that the prefix sums are
+   * non-decreasing.
+   */
+  std::size_t lower_bound(const T &target) const {
+    // Walk down the implicit tree, keeping pos as the longest prefix whose
+    // sum is still below target.
+    std::size_t pos = 0;
+    T acc{};
+    for (std::size_t step = std::bit_floor(size()); step > 0; step >>= 1) {
+      if (pos + step < tree.size() && acc + tree[pos + step] < target) {
+        pos += step;
+        acc += tree[pos];
+      }
+    }
+    return pos;
+  }
+};
+
+} // namespace utils
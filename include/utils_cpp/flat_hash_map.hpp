@@ -0,0 +1,851 @@
+/**********************************************************************
+ * @brief Open-addressing hash map and set with SIMD group probing
+ * @details A SwissTable-style table: elements live in one flat array of
+ *slots, with a parallel array of one control byte per slot holding either
+ *"empty", "deleted" or 7 bits of the element's hash. A lookup hashes the key
+ *once, picks a group of 16 slots, and compares all 16 control bytes against
+ *the 7 hash bits in one SSE2 instruction (or a few 64-bit word operations
+ *elsewhere), so it usually touches one control group and one slot.
+ *FlatHashMap and FlatHashSet take the same template parameters as
+ *std::unordered_map and std::unordered_set and have most of their interface,
+ *but no per-element allocation. Unlike the std containers, inserting may
+ *move elements and invalidates every iterator and reference.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/hash.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace utils {
+
+namespace detail {
+
+using flat_ctrl = std::int8_t;
+
+// Control byte values. Full slots hold the low 7 bits of their hash, so the
+// high bit tells free slots from full ones.
+inline constexpr flat_ctrl flat_empty = -128;
+inline constexpr flat_ctrl flat_deleted = -2;
+
+inline constexpr std::size_t flat_group_width = 16;
+
+/**
+ * Matches on a group of 16 control bytes. Each returns a bitmask with bit i
+ * set when byte i matches.
+ */
+struct flat_group {
+  static std::uint32_t match(const flat_ctrl *ctrl, flat_ctrl h2) noexcept {
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+    return static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2))));
+#else
+    return match_portable(ctrl, h2);
+#endif
+  }
+
+  static std::uint32_t match_empty(const flat_ctrl *ctrl) noexcept {
+    return match(ctrl, flat_empty);
+  }
+
+  /// Empty or deleted slots.
+  static std::uint32_t match_free(const flat_ctrl *ctrl) noexcept {
+#if defined(__SSE2__)
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl))));
+#else
+    return match_free_portable(ctrl);
+#endif
+  }
+
+  // Word-at-a-time versions, for targets without SSE2.
+
+  static std::uint32_t match_portable(const flat_ctrl *ctrl,
+                                      flat_ctrl h2) noexcept {
+    constexpr std::uint64_t ones = 0x0101010101010101ULL;
+    const std::uint64_t pattern = ones * static_cast<std::uint8_t>(h2);
+    return over_words(ctrl, [&](std::uint64_t word) {
+      // The exact "has zero byte" test: the high bit of each byte of the
+      // result is set iff that byte of word ^ pattern is zero.
+      std::uint64_t x = word ^ pattern;
+      return ~(((x & ~highs) + ~highs) | x) & highs;
+    });
+  }
+
+  static std::uint32_t match_free_portable(const flat_ctrl *ctrl) noexcept {
+    return over_words(ctrl, [](std::uint64_t word) { return word & highs; });
+  }
+
+private:
+  static constexpr std::uint64_t highs = 0x8080808080808080ULL;
+
+  // Gathers the high bit of each byte of x into the low 8 bits.
+  static std::uint32_t high_bits(std::uint64_t x) noexcept {
+    return static_cast<std::uint32_t>(((x >> 7) * 0x0102040810204080ULL) >>
+                                      56);
+  }
+
+  // f maps each 8-byte word to a word with only the byte high bits set.
+  template <typename F>
+  static std::uint32_t over_words(const flat_ctrl *ctrl, F f) noexcept {
+    if constexpr (std::endian::native != std::endian::little) {
+      std::uint32_t mask = 0;
+      for (std::size_t i = 0; i < flat_group_width; ++i) {
+        std::uint64_t word = static_cast<std::uint8_t>(ctrl[i]);
+        mask |= static_cast<std::uint32_t>((f(word) >> 7) & 1) << i;
+      }
+      return mask;
+    }
+    std::uint64_t lo, hi;
+    std::memcpy(&lo, ctrl, 8);
+    std::memcpy(&hi, ctrl + 8, 8);
+    return high_bits(f(lo)) | (high_bits(f(hi)) << 8);
+  }
+};
+
+template <typename Key, typename Mapped>
+struct flat_value {
+  using type = std::pair<const Key, Mapped>;
+};
+
+template <typename Key>
+struct flat_value<Key, void> {
+  using type = Key;
+};
+
+} // namespace detail
+
+/**
+ * An open-addressing hash table of groups of 16 slots, as a set when Mapped
+ * is void and a map otherwise. Use it through FlatHashSet and FlatHashMap.
+ *
+ * The capacity is 0 or a power of two of at least 16, and the table grows
+ * (doubling) once 7/8 of the slots are used. Erasing leaves a "deleted"
+ * marker unless the slot's group has an empty slot, and markers are cleared
+ * when the table is rebuilt. The result of Hash is mixed before use, so
+ * hashers that are the identity on integers (std::hash) work well.
+ */
+template <typename Key, typename Mapped, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator =
+              std::allocator<typename detail::flat_value<Key, Mapped>::type>>
+class FlatHashTable {
+
+  static constexpr bool is_map = !std::is_void_v<Mapped>;
+
+public:
+  using key_type = Key;
+  using mapped_type = Mapped;
+  using value_type = typename detail::flat_value<Key, Mapped>::type;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+
+private:
+  using slot_alloc = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<value_type>;
+  using slot_traits = std::allocator_traits<slot_alloc>;
+  using ctrl_alloc = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<detail::flat_ctrl>;
+  using ctrl_traits = std::allocator_traits<ctrl_alloc>;
+
+  template <bool IsConst>
+  class table_iterator {
+    using table_type = std::conditional_t<IsConst, const FlatHashTable,
+                                          FlatHashTable>;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = FlatHashTable::value_type;
+    using difference_type = std::ptrdiff_t;
+    // Set elements are keys, which must not be modified in place.
+    using reference =
+        std::conditional_t<IsConst || !is_map, const value_type &,
+                           value_type &>;
+    using pointer = std::conditional_t<IsConst || !is_map, const value_type *,
+                                       value_type *>;
+
+    table_iterator() = default;
+
+    template <bool C = IsConst>
+      requires C
+    table_iterator(const table_iterator<false> &other)
+        : table{other.table}, index{other.index} {}
+
+    reference operator*() const { return table->slots_[index]; }
+    pointer operator->() const { return table->slots_ + index; }
+
+    table_iterator &operator++() {
+      ++index;
+      index = table->next_full(index);
+      return *this;
+    }
+
+    table_iterator operator++(int) {
+      table_iterator copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    friend bool operator==(const table_iterator &lhs,
+                           const table_iterator &rhs) {
+      return lhs.index == rhs.index;
+    }
+
+  private:
+    friend class FlatHashTable;
+    template <bool>
+    friend class table_iterator;
+
+    table_iterator(table_type *table, std::size_t index)
+        : table{table}, index{index} {}
+
+    table_type *table = nullptr;
+    std::size_t index = 0;
+  };
+
+public:
+  using iterator = table_iterator<false>;
+  using const_iterator = table_iterator<true>;
+
+  FlatHashTable() = default;
+
+  explicit FlatHashTable(size_type capacity, const Hash &hash = Hash(),
+                         const KeyEqual &equal = KeyEqual(),
+                         const Allocator &alloc = Allocator())
+      : hash_{hash}, equal_{equal}, slots_alloc_{alloc}, ctrl_alloc_{alloc} {
+    reserve(capacity);
+  }
+
+  template <typename InputIt>
+  FlatHashTable(InputIt first, InputIt last, size_type capacity = 0,
+                const Hash &hash = Hash(), const KeyEqual &equal = KeyEqual(),
+                const Allocator &alloc = Allocator())
+      : FlatHashTable(capacity, hash, equal, alloc) {
+    insert(first, last);
+  }
+
+  FlatHashTable(std::initializer_list<value_type> values,
+                size_type capacity = 0, const Hash &hash = Hash(),
+                const KeyEqual &equal = KeyEqual(),
+                const Allocator &alloc = Allocator())
+      : FlatHashTable(values.begin(), values.end(), capacity, hash, equal,
+                      alloc) {}
+
+  FlatHashTable(const FlatHashTable &other);
+
+  FlatHashTable(FlatHashTable &&other) noexcept
+      : hash_{std::move(other.hash_)}, equal_{std::move(other.equal_)},
+        slots_alloc_{std::move(other.slots_alloc_)},
+        ctrl_alloc_{std::move(other.ctrl_alloc_)},
+        ctrl_{std::exchange(other.ctrl_, nullptr)},
+        slots_{std::exchange(other.slots_, nullptr)},
+        capacity_{std::exchange(other.capacity_, 0)},
+        size_{std::exchange(other.size_, 0)},
+        growth_left_{std::exchange(other.growth_left_, 0)} {}
+
+  FlatHashTable &operator=(const FlatHashTable &other) {
+    if (this != &other) {
+      FlatHashTable copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  FlatHashTable &operator=(FlatHashTable &&other) noexcept {
+    if (this != &other) {
+      destroy();
+      hash_ = std::move(other.hash_);
+      equal_ = std::move(other.equal_);
+      slots_alloc_ = std::move(other.slots_alloc_);
+      ctrl_alloc_ = std::move(other.ctrl_alloc_);
+      ctrl_ = std::exchange(other.ctrl_, nullptr);
+      slots_ = std::exchange(other.slots_, nullptr);
+      capacity_ = std::exchange(other.capacity_, 0);
+      size_ = std::exchange(other.size_, 0);
+      growth_left_ = std::exchange(other.growth_left_, 0);
+    }
+    return *this;
+  }
+
+  ~FlatHashTable() { destroy(); }
+
+  iterator begin() noexcept { return iterator(this, next_full(0)); }
+  iterator end() noexcept { return iterator(this, capacity_); }
+  const_iterator begin() const noexcept {
+    return const_iterator(this, next_full(0));
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(this, capacity_);
+  }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_type size() const noexcept { return size_; }
+
+  /// Number of slots.
+  size_type capacity() const noexcept { return capacity_; }
+
+  float load_factor() const noexcept {
+    return capacity_ == 0 ? 0.0f
+                          : static_cast<float>(size_) /
+                                static_cast<float>(capacity_);
+  }
+
+  /// Fixed: the table grows when it would be fuller than this.
+  static constexpr float max_load_factor() noexcept { return 0.875f; }
+
+  hasher hash_function() const { return hash_; }
+  key_equal key_eq() const { return equal_; }
+  allocator_type get_allocator() const { return allocator_type(slots_alloc_); }
+
+  /**
+   * Destroys every element. Keeps the slots, like std::vector::clear.
+   */
+  void clear() noexcept;
+
+  /**
+   * Makes room for n elements without further growth.
+   */
+  void reserve(size_type n) {
+    if (n > max_load(capacity_)) {
+      resize(capacity_for(n));
+    }
+  }
+
+  /**
+   * Rebuilds the table with at least 'capacity' slots (and enough for the
+   * current elements), dropping deleted markers. rehash(0) shrinks to fit.
+   */
+  void rehash(size_type capacity) {
+    if (size_ == 0 && capacity == 0) {
+      destroy();
+    } else {
+      resize(std::max(capacity_for(size_), std::bit_ceil(capacity)));
+    }
+  }
+
+  std::pair<iterator, bool> insert(const value_type &value) {
+    return emplace_with_key(key_of(value), value);
+  }
+
+  std::pair<iterator, bool> insert(value_type &&value) {
+    return emplace_with_key(key_of(value), std::move(value));
+  }
+
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    if constexpr (std::forward_iterator<InputIt>) {
+      reserve(size_ + static_cast<size_type>(std::distance(first, last)));
+    }
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  void insert(std::initializer_list<value_type> values) {
+    insert(values.begin(), values.end());
+  }
+
+  /**
+   * Constructs a value_type from args and inserts it if its key is new.
+   */
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args &&...args) {
+    value_type value(std::forward<Args>(args)...);
+    return insert(std::move(value));
+  }
+
+  /**
+   * Inserts key with a value constructed from args, unless key is already
+   * there, in which case args are left alone.
+   */
+  template <typename K, typename... Args>
+  std::pair<iterator, bool> try_emplace(K &&key, Args &&...args)
+    requires is_map
+  {
+    return emplace_with_key(key, std::piecewise_construct,
+                            std::forward_as_tuple(std::forward<K>(key)),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  /**
+   * The value for key, default constructed first if key is new.
+   */
+  template <typename M = Mapped>
+  M &operator[](const Key &key)
+    requires is_map
+  {
+    return try_emplace(key).first->second;
+  }
+
+  template <typename M = Mapped>
+  M &operator[](Key &&key)
+    requires is_map
+  {
+    return try_emplace(std::move(key)).first->second;
+  }
+
+  /**
+   * The value for key. Throws std::out_of_range if key is not there.
+   */
+  template <typename M = Mapped>
+  const M &at(const Key &key) const
+    requires is_map
+  {
+    size_type i = find_index(key);
+    if (i == capacity_) {
+      throw std::out_of_range("FlatHashMap::at: key not found");
+    }
+    return slots_[i].second;
+  }
+
+  template <typename M = Mapped>
+  M &at(const Key &key)
+    requires is_map
+  {
+    return const_cast<M &>(std::as_const(*this).at(key));
+  }
+
+  iterator find(const Key &key) { return iterator(this, find_index(key)); }
+  const_iterator find(const Key &key) const {
+    return const_iterator(this, find_index(key));
+  }
+
+  bool contains(const Key &key) const { return find_index(key) != capacity_; }
+  size_type count(const Key &key) const { return contains(key) ? 1 : 0; }
+
+  /**
+   * Removes key. Returns the number of elements removed, 0 or 1.
+   */
+  size_type erase(const Key &key) {
+    size_type i = find_index(key);
+    if (i == capacity_) {
+      return 0;
+    }
+    erase_at(i);
+    return 1;
+  }
+
+  /**
+   * Removes the element at pos and returns an iterator to the next one.
+   * Other iterators stay valid.
+   */
+  iterator erase(const_iterator pos) {
+    erase_at(pos.index);
+    return iterator(this, next_full(pos.index + 1));
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  void swap(FlatHashTable &other) noexcept {
+    using std::swap;
+    swap(hash_, other.hash_);
+    swap(equal_, other.equal_);
+    swap(slots_alloc_, other.slots_alloc_);
+    swap(ctrl_alloc_, other.ctrl_alloc_);
+    swap(ctrl_, other.ctrl_);
+    swap(slots_, other.slots_);
+    swap(capacity_, other.capacity_);
+    swap(size_, other.size_);
+    swap(growth_left_, other.growth_left_);
+  }
+
+  friend void swap(FlatHashTable &lhs, FlatHashTable &rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+  /**
+   * Same elements (and values, for a map), regardless of order.
+   */
+  friend bool operator==(const FlatHashTable &lhs, const FlatHashTable &rhs) {
+    if (lhs.size() != rhs.size()) {
+      return false;
+    }
+    for (const auto &value : lhs) {
+      auto it = rhs.find(key_of(value));
+      if (it == rhs.end()) {
+        return false;
+      }
+      if constexpr (is_map) {
+        if (!(it->second == value.second)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+private:
+  static const Key &key_of(const value_type &value) noexcept {
+    if constexpr (is_map) {
+      return value.first;
+    } else {
+      return value;
+    }
+  }
+
+  // Slots usable before growing: 7/8 of the capacity.
+  static constexpr size_type max_load(size_type capacity) noexcept {
+    return capacity - capacity / 8;
+  }
+
+  // Smallest capacity that holds n elements.
+  static size_type capacity_for(size_type n) noexcept {
+    size_type capacity = detail::flat_group_width;
+    while (max_load(capacity) < n) {
+      capacity *= 2;
+    }
+    return capacity;
+  }
+
+  std::uint64_t hash_of(const Key &key) const {
+    return detail::mum(static_cast<std::uint64_t>(hash_(key)),
+                       0x9e3779b97f4a7c15ULL);
+  }
+
+  static detail::flat_ctrl h2_of(std::uint64_t hash) noexcept {
+    return static_cast<detail::flat_ctrl>(hash & 0x7f);
+  }
+
+  /**
+   * Triangular probing over groups: group g, g + 1, g + 3, g + 6, ...,
+   * which visits every group when the number of groups is a power of two.
+   */
+  struct probe_sequence {
+    size_type group;
+    size_type mask;
+    size_type step = 0;
+
+    size_type offset() const noexcept {
+      return group * detail::flat_group_width;
+    }
+    void next() noexcept {
+      ++step;
+      group = (group + step) & mask;
+    }
+  };
+
+  probe_sequence probe(std::uint64_t hash) const noexcept {
+    size_type mask = capacity_ / detail::flat_group_width - 1;
+    return {static_cast<size_type>(hash >> 7) & mask, mask};
+  }
+
+  // Slot index of key, or capacity_ if it is not there.
+  size_type find_index(const Key &key) const {
+    return size_ == 0 ? capacity_ : find_index(key, hash_of(key));
+  }
+  size_type find_index(const Key &key, std::uint64_t hash) const;
+
+  // First free slot on the probe sequence of hash.
+  size_type find_free(std::uint64_t hash) const noexcept;
+
+  // First full slot at or after index, or capacity_.
+  size_type next_full(size_type index) const noexcept {
+    while (index < capacity_ && ctrl_[index] < 0) {
+      ++index;
+    }
+    return index;
+  }
+
+  /**
+   * Index of key and false if it is there. Otherwise claims a free slot for
+   * it, growing if needed, and returns its index and true; the caller must
+   * construct the element there.
+   */
+  std::pair<size_type, bool> find_or_prepare_insert(const Key &key);
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace_with_key(const Key &key, Args &&...args);
+
+  // Marks slot i free after its element has been destroyed or never built.
+  void release_slot(size_type i) noexcept;
+
+  void erase_at(size_type i) {
+    slot_traits::destroy(slots_alloc_, slots_ + i);
+    release_slot(i);
+  }
+
+  // Replaces the arrays with empty ones of the given capacity, without
+  // freeing the old ones. Leaves the table alone if allocation throws.
+  void allocate(size_type capacity);
+  void resize(size_type capacity);
+  // Destroys the elements and frees the arrays, leaving an empty table.
+  void destroy() noexcept;
+
+  [[no_unique_address]] Hash hash_{};
+  [[no_unique_address]] KeyEqual equal_{};
+  [[no_unique_address]] slot_alloc slots_alloc_{};
+  [[no_unique_address]] ctrl_alloc ctrl_alloc_{};
+  detail::flat_ctrl *ctrl_ = nullptr;
+  value_type *slots_ = nullptr;
+  size_type capacity_ = 0;
+  size_type size_ = 0;
+  // Empty slots that may still be filled before the table must grow.
+  size_type growth_left_ = 0;
+};
+
+/**
+ * A hash map in one flat array. Drop-in for std::unordered_map, except that
+ * inserting invalidates iterators and references.
+ */
+template <typename Key, typename T, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, T>>>
+using FlatHashMap = FlatHashTable<Key, T, Hash, KeyEqual, Allocator>;
+
+/**
+ * A hash set in one flat array. Drop-in for std::unordered_set, except that
+ * inserting invalidates iterators and references.
+ */
+template <typename Key, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<Key>>
+using FlatHashSet = FlatHashTable<Key, void, Hash, KeyEqual, Allocator>;
+
+// ==============
+// IMPLEMENTATION
+// ==============
+
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual,
+          typename Allocator>
+FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::FlatHashTable(
+    const FlatHashTable &other)
+    : hash_{other.hash_}, equal_{other.equal_},
+      slots_alloc_{slot_traits::select_on_container_copy_construction(
+          other.slots_alloc_)},
+      ctrl_alloc_{ctrl_traits::select_on_container_copy_construction(
+          other.ctrl_alloc_)} {
+  if (other.size_ == 0) {
+    return;
+  }
+  // Same hasher and capacity, so every element can keep its slot.
+  allocate(other.capacity_);
+  size_type i = 0;
+  try {
+    for (; i < capacity_; ++i) {
+      if (other.ctrl_[i] >= 0) {
+        slot_traits::construct(slots_alloc_, slots_ + i, other.slots_[i]);
+      }
+    }
+  } catch (...) {
+    while (i-- > 0) {
+      if (other.ctrl_[i] >= 0) {
+        slot_traits::destroy(slots_alloc_, slots_ + i);
+      }
+    }
+    size_ = 0;
+    destroy();
+    throw;
+  }
+  std::memcpy(ctrl_, other.ctrl_, capacity_);
+  size_ = other.size_;
+  growth_left_ = other.growth_left_;
+}
+
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual,
+          typename Allocator>
+void FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::clear() noexcept {
+  if (capacity_ == 0) {
+    return;
+  }
+  if constexpr (!std::is_trivially_destructible_v<value_type>) {
+    for (size_type i = 0; i < capacity_; ++i) {
+      if (ctrl_[i] >= 0) {
+        slot_traits::destroy(slots_alloc_, slots_ + i);
+      }
+    }
+  }
+  std::memset(ctrl_, static_cast<unsigned char>(detail::flat_empty),
+              capacity_);
+  size_ = 0;
+  growth_left_ = max_load(capacity_);
+}
+
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual,
+          typename Allocator>
+typename FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::size_type
+FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::find_index(
+    const Key &key, std::uint64_t hash) const {
+  const detail::flat_ctrl h2 = h2_of(hash);
+  for (auto seq = probe(hash);; seq.next()) {
+    const detail::flat_ctrl *group = ctrl_ + seq.offset();
+    for (auto hits = detail::flat_group::match(group, h2); hits;
+         hits &= hits - 1) {
+      size_type i =
+          seq.offset() + static_cast<size_type>(std::countr_zero(hits));
+      if (equal_(key_of(slots_[i]), key)) {
+        return i;
+      }
+    }
+    // An empty slot ends every probe sequence that passes through here.
+    if (detail::flat_group::match_empty(group)) {
+      return capacity_;
+    }
+  }
+}
+
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual,
+          typename Allocator>
+typename FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::size_type
+FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::find_free(
+    std::uint64_t hash) const noexcept {
+  for (auto seq = probe(hash);; seq.next()) {
+    if (auto free = detail::flat_group::match_free(ctrl_ + seq.offset())) {
+      return seq.offset() + static_cast<size_type>(std::countr_zero(free));
+    }
+  }
+}
+
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual,
+          typename Allocator>
+std::pair<typename FlatHashTable<Key, Mapped, Hash, KeyEqual,
+                                 Allocator>::size_type,
+          bool>
+FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::find_or_prepare_insert(
+    const Key &key) {
+  const std::uint64_t hash = hash_of(key);
+  if (size_ != 0) {
+    if (size_type i = find_index(key, hash); i != capacity_) {
+      return {i, false};
+    }
+  }
+  size_type i = capacity_ == 0 ? 0 : find_free(hash);
+  // A deleted slot can be reused without using up growth.
+  if (capacity_ == 0 ||
+      (growth_left_ == 0 && ctrl_[i] != detail::flat_deleted)) {
+    // Grow, unless more than half of the used slots are deleted markers,
+    // in which case rebuilding at the same capacity clears them.
+    resize(capacity_ == 0 ? capacity_for(1)
+           : size_ >= max_load(capacity_) / 2 ? capacity_ * 2
+                                              : capacity_);
+    i = find_free(hash);
+  }
+  growth_left_ -= ctrl_[i] == detail::flat_empty;
+  ctrl_[i] = h2_of(hash);
+  ++size_;
+  return {i, true};
+}
+
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual,
+          typename Allocator>
+template <typename... Args>
+std::pair<typename FlatHashTable<Key, Mapped, Hash, KeyEqual,
+                                 Allocator>::iterator,
+          bool>
+FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::emplace_with_key(
+    const Key &key, Args &&...args) {
+  auto [i, inserted] = find_or_prepare_insert(key);
+  if (inserted) {
+    try {
+      slot_traits::construct(slots_alloc_, slots_ + i,
+                             std::forward<Args>(args)...);
+    } catch (...) {
+      release_slot(i);
+      throw;
+    }
+  }
+  return {iterator(this, i), inserted};
+}
+
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual,
+          typename Allocator>
+void FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::release_slot(
+    size_type i) noexcept {
+  --size_;
+  // If i's group still has an empty slot, no probe sequence ever went past
+  // it, so i can become empty too. Otherwise lookups must keep probing.
+  const detail::flat_ctrl *group =
+      ctrl_ + (i & ~(detail::flat_group_width - 1));
+  if (detail::flat_group::match_empty(group)) {
+    ctrl_[i] = detail::flat_empty;
+    ++growth_left_;
+  } else {
+    ctrl_[i] = detail::flat_deleted;
+  }
+}
+
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual,
+          typename Allocator>
+void FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::allocate(
+    size_type capacity) {
+  detail::flat_ctrl *ctrl = ctrl_traits::allocate(ctrl_alloc_, capacity);
+  try {
+    slots_ = slot_traits::allocate(slots_alloc_, capacity);
+  } catch (...) {
+    ctrl_traits::deallocate(ctrl_alloc_, ctrl, capacity);
+    throw;
+  }
+  ctrl_ = ctrl;
+  std::memset(ctrl_, static_cast<unsigned char>(detail::flat_empty), capacity);
+  capacity_ = capacity;
+  growth_left_ = max_load(capacity);
+}
+
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual,
+          typename Allocator>
+void FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::resize(
+    size_type capacity) {
+  detail::flat_ctrl *old_ctrl = ctrl_;
+  value_type *old_slots = slots_;
+  size_type old_capacity = capacity_;
+
+  allocate(capacity);
+  growth_left_ -= size_;
+  for (size_type i = 0; i < old_capacity; ++i) {
+    if (old_ctrl[i] >= 0) {
+      const std::uint64_t hash = hash_of(key_of(old_slots[i]));
+      size_type j = find_free(hash);
+      ctrl_[j] = h2_of(hash);
+      slot_traits::construct(slots_alloc_, slots_ + j,
+                             std::move_if_noexcept(old_slots[i]));
+      slot_traits::destroy(slots_alloc_, old_slots + i);
+    }
+  }
+  if (old_capacity != 0) {
+    ctrl_traits::deallocate(ctrl_alloc_, old_ctrl, old_capacity);
+    slot_traits::deallocate(slots_alloc_, old_slots, old_capacity);
+  }
+}
+
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual,
+          typename Allocator>
+void FlatHashTable<Key, Mapped, Hash, KeyEqual, Allocator>::destroy() noexcept {
+  if (capacity_ == 0) {
+    return;
+  }
+  clear();
+  ctrl_traits::deallocate(ctrl_alloc_, ctrl_, capacity_);
+  slot_traits::deallocate(slots_alloc_, slots_, capacity_);
+  ctrl_ = nullptr;
+  slots_ = nullptr;
+  capacity_ = size_ = growth_left_ = 0;
+}
+
+} // namespace utils
@@ -8,8 +8,23 @@
 
 #pragma once
 
+#include "utils_cpp/bitvector.hpp"
 #include "utils_cpp/graph/bitadjmat.hpp"
+#include "utils_cpp/graph/csr_graph.hpp"
 #include "utils_cpp/graph/graph.hpp"
+#include "utils_cpp/matrix.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace utils {
 namespace gl {
@@ -17,179 +32,862 @@ namespace gl {
 /**
  * @brief Graph coloring strategies that can be used in the `graph_coloring`
  * function.
+ *
+ * @details LARGEST_FIRST colors vertices by decreasing degree. SMALLEST_LAST
+ * colors them in reverse degeneracy order (repeatedly removing a vertex of
+ * smallest remaining degree), which uses at most degeneracy + 1 colors.
  */
 enum class graph_coloring_strategy {
   LARGEST_FIRST,
   SMALLEST_LAST,
 };
 
+namespace detail {
+
 /**
- * @brief Computes a graph coloring, returning a map from vertices to their
- * color index.
+ * @internal
+ * @brief Bitmask of the colors taken by the neighbors of one vertex. A vertex
+ * of degree d always has a free color in [0, d], so larger colors are ignored
+ * and the mask only needs d + 1 bits.
  */
+class ForbiddenColors {
+public:
+  void reset(std::size_t degree) {
+    words_.assign(degree / 64 + 1, 0);
+    limit_ = degree + 1;
+  }
 
-template <typename GraphType>
-VertexMap<std::size_t, GraphType>
-graph_coloring(const GraphType &g, graph_coloring_strategy strategy) {
+  void mark(std::size_t color) noexcept {
+    if (color < limit_) {
+      words_[color / 64] |= std::uint64_t{1} << (color % 64);
+    }
+  }
 
-  VertexMap<std::size_t, GraphType> color_map;
-  color_map.reserve(boost::num_vertices(g));
+  std::size_t first_free() const noexcept {
+    std::size_t i = 0;
+    while (words_[i] == ~std::uint64_t{0}) {
+      ++i;
+    }
+    return i * 64 + static_cast<std::size_t>(std::countr_one(words_[i]));
+  }
 
-  using vertex_t = Vertex<GraphType>;
+private:
+  std::vector<std::uint64_t> words_;
+  std::size_t limit_ = 0;
+};
 
-  if (strategy == graph_coloring_strategy::LARGEST_FIRST) {
+/**
+ * @internal
+ * @brief Degeneracy ordering by the Batagelj-Zaversnik bucket algorithm, in
+ * O(V + E): vertices are kept sorted by remaining degree in one array, and
+ * removing a vertex moves each of its neighbors down one bucket with a swap.
+ * Returns the vertices in removal order.
+ */
+template <typename WeightType>
+std::vector<std::size_t> degeneracy_order(const CsrGraph<WeightType> &g) {
+  std::size_t n = g.num_vertices();
+
+  std::vector<std::size_t> degree(n);
+  std::size_t max_degree = 0;
+  for (std::size_t v = 0; v < n; ++v) {
+    degree[v] = g.degree(v);
+    max_degree = std::max(max_degree, degree[v]);
+  }
+
+  // bucket_start[d] is the position in order of the first vertex of degree d.
+  std::vector<std::size_t> bucket_start(max_degree + 2, 0);
+  for (std::size_t v = 0; v < n; ++v) {
+    ++bucket_start[degree[v] + 1];
+  }
+  for (std::size_t d = 0; d <= max_degree; ++d) {
+    bucket_start[d + 1] += bucket_start[d];
+  }
 
-    // Get vector of (vertex, degree) pairs for all vertices in graph.
-    std::vector<std::pair<std::size_t, vertex_t>> vertex_degree_pairs;
-    vertex_degree_pairs.reserve(boost::num_vertices(g));
-    for (auto v : boost::make_iterator_range(boost::vertices(g))) {
+  std::vector<std::size_t> order(n), position(n);
+  {
+    std::vector<std::size_t> next(bucket_start.begin(), bucket_start.end() - 1);
+    for (std::size_t v = 0; v < n; ++v) {
+      position[v] = next[degree[v]]++;
+      order[position[v]] = v;
+    }
+  }
 
-      vertex_degree_pairs.push_back({boost::degree(v, g), v});
+  for (std::size_t i = 0; i < n; ++i) {
+    std::size_t v = order[i];
+    for (std::size_t u : g.neighbors(v)) {
+      if (degree[u] > degree[v]) {
+        // Swap u with the first vertex of its bucket, then shrink the bucket
+        // past it.
+        std::size_t du = degree[u];
+        std::size_t first = bucket_start[du];
+        std::size_t w = order[first];
+        std::swap(order[position[u]], order[first]);
+        std::swap(position[u], position[w]);
+        ++bucket_start[du];
+        --degree[u];
+      }
     }
+  }
+  return order;
+}
+
+/**
+ * @internal
+ * @brief The order in which a strategy colors the vertices.
+ */
+template <typename WeightType>
+std::vector<std::size_t> coloring_order(const CsrGraph<WeightType> &g,
+                                        graph_coloring_strategy strategy) {
+  std::size_t n = g.num_vertices();
 
-    // Sort vertices in descending order of degree
+  if (strategy == graph_coloring_strategy::LARGEST_FIRST) {
+    std::vector<std::pair<std::size_t, std::size_t>> vertex_degree_pairs;
+    vertex_degree_pairs.reserve(n);
+    for (std::size_t v = 0; v < n; ++v) {
+      vertex_degree_pairs.push_back({g.degree(v), v});
+    }
     std::sort(vertex_degree_pairs.begin(), vertex_degree_pairs.end(),
-              std::greater<std::pair<std::size_t, vertex_t>>());
+              std::greater<std::pair<std::size_t, std::size_t>>());
 
+    std::vector<std::size_t> order;
+    order.reserve(n);
     for (auto [deg, v] : vertex_degree_pairs) {
+      order.push_back(v);
+    }
+    return order;
+
+  } else if (strategy == graph_coloring_strategy::SMALLEST_LAST) {
+    auto order = degeneracy_order(g);
+    std::reverse(order.begin(), order.end());
+    return order;
 
-      // Get the colors of the neighbors of v
-      std::unordered_set<std::size_t> neighbor_colors;
+  } else {
+    throw std::runtime_error("Invalid graph coloring strategy");
+  }
+}
 
-      for (auto nb :
-           boost::make_iterator_range(boost::adjacent_vertices(v, g))) {
-        if (color_map.contains(nb)) {
-          neighbor_colors.insert(color_map[nb]);
+/**
+ * @internal
+ * @brief Gebremedhin-Manne speculative coloring of the vertices in order.
+ */
+template <typename WeightType>
+void speculative_coloring(const CsrGraph<WeightType> &g,
+                          const std::vector<std::size_t> &order,
+                          std::vector<std::size_t> &colors,
+                          parallel::thread_pool &pool) {
+  constexpr std::size_t uncolored = std::numeric_limits<std::size_t>::max();
+  std::size_t n = g.num_vertices();
+
+  std::vector<std::size_t> position(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    position[order[i]] = i;
+  }
+
+  std::vector<std::size_t> worklist = order;
+  std::vector<ForbiddenColors> masks;
+  std::vector<std::vector<std::size_t>> conflicts;
+
+  while (!worklist.empty()) {
+    std::size_t m = worklist.size();
+    std::size_t num_chunks = std::min(m, 4 * (pool.size() + 1));
+    masks.resize(num_chunks);
+    conflicts.assign(num_chunks, {});
+
+    // Each chunk is a contiguous slice of the worklist, so it is still colored
+    // in priority order.
+    auto slice = [&](std::size_t chunk) {
+      return std::span<const std::size_t>(worklist).subspan(
+          chunk * m / num_chunks,
+          (chunk + 1) * m / num_chunks - chunk * m / num_chunks);
+    };
+
+    // Neighbors may be colored concurrently, so colors are accessed
+    // atomically here; a stale read only causes a conflict, detected below.
+    pool.parallel_for(std::size_t{0}, num_chunks, 1, [&](std::size_t chunk) {
+      auto &mask = masks[chunk];
+      for (std::size_t v : slice(chunk)) {
+        mask.reset(g.degree(v));
+        for (std::size_t nb : g.neighbors(v)) {
+          std::size_t c =
+              std::atomic_ref<std::size_t>(colors[nb]).load(
+                  std::memory_order_relaxed);
+          if (c != uncolored && nb != v) {
+            mask.mark(c);
+          }
         }
+        std::atomic_ref<std::size_t>(colors[v]).store(
+            mask.first_free(), std::memory_order_relaxed);
       }
+    });
+
+    // Of two neighbors with the same color, the later one is recolored. The
+    // earliest vertex of the worklist never conflicts, so this terminates.
+    pool.parallel_for(std::size_t{0}, num_chunks, 1, [&](std::size_t chunk) {
+      for (std::size_t v : slice(chunk)) {
+        for (std::size_t nb : g.neighbors(v)) {
+          if (colors[nb] == colors[v] && position[nb] < position[v]) {
+            conflicts[chunk].push_back(v);
+            break;
+          }
+        }
+      }
+    });
+
+    worklist.clear();
+    for (const auto &c : conflicts) {
+      worklist.insert(worklist.end(), c.begin(), c.end());
+    }
+    for (std::size_t v : worklist) {
+      colors[v] = uncolored;
+    }
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Graph coloring over a CsrGraph, returning a vector indexed by vertex.
+ * Each vertex, in the order given by strategy, gets the smallest color not
+ * used by its neighbors.
+ *
+ * @details With a thread pool, runs a speculative (Gebremedhin-Manne)
+ * coloring instead: the vertices are colored concurrently in the same order,
+ * then conflicting neighbors are detected and the later one of each pair is
+ * recolored, until there are no conflicts. The result is always a proper
+ * coloring, but may use a few more colors than the sequential one and can
+ * differ between runs.
+ */
+template <typename WeightType>
+std::vector<std::size_t> graph_coloring(const CsrGraph<WeightType> &g,
+                                        graph_coloring_strategy strategy,
+                                        parallel::thread_pool *pool = nullptr) {
+
+  constexpr std::size_t uncolored = std::numeric_limits<std::size_t>::max();
+
+  auto order = detail::coloring_order(g, strategy);
+  std::vector<std::size_t> colors(g.num_vertices(), uncolored);
 
-      // Find the smallest color not used by the neighbors
-      std::size_t smallest_color = 0;
-      while (neighbor_colors.contains(smallest_color)) {
-        ++smallest_color;
+  if (pool) {
+    detail::speculative_coloring(g, order, colors, *pool);
+    return colors;
+  }
+
+  detail::ForbiddenColors mask;
+  for (std::size_t v : order) {
+    mask.reset(g.degree(v));
+    for (std::size_t nb : g.neighbors(v)) {
+      if (colors[nb] != uncolored) {
+        mask.mark(colors[nb]);
       }
+    }
+    colors[v] = mask.first_free();
+  }
 
-      // Assign the smallest color to v
-      color_map[v] = smallest_color;
+  return colors;
+}
+
+/**
+ * @brief Computes a graph coloring, writing each vertex's color index to
+ * color_map[v]. color_map can be a VertexMap or a DenseVertexMap (which must
+ * already have one entry per vertex). Gives the same coloring as the CsrGraph
+ * overload on CsrGraph(g).
+ */
+template <typename GraphType, typename ColorMap>
+void graph_coloring(const GraphType &g, graph_coloring_strategy strategy,
+                    ColorMap &color_map) {
+  auto colors = graph_coloring(CsrGraph(g), strategy);
+  for (auto v : boost::make_iterator_range(boost::vertices(g))) {
+    color_map[v] = colors[v];
+  }
+}
+
+/**
+ * @brief Computes a graph coloring, returning a map from vertices to their
+ * color index.
+ */
+template <typename GraphType>
+VertexMap<std::size_t, GraphType>
+graph_coloring(const GraphType &g, graph_coloring_strategy strategy) {
+  VertexMap<std::size_t, GraphType> color_map;
+  color_map.reserve(boost::num_vertices(g));
+  graph_coloring(g, strategy, color_map);
+  return color_map;
+}
+
+/**
+ * @brief A coloring of n vertices held both as a color per vertex and as one
+ * BitVector per color, whose bit v is set iff v has that color.
+ *
+ * @details Against the rows of a BitAdjmat, the neighbours of v with color c
+ * are popcount(row(v) & class(c)), so checking a vertex or finding a free
+ * color for it is a few word-wide ANDs per color rather than a walk over its
+ * edges. Classes emptied by recoloring are kept, so num_colors() never
+ * shrinks.
+ */
+class ColorClasses {
+public:
+  ColorClasses() = default;
+
+  /// The coloring with vertex v colored colors[v].
+  explicit ColorClasses(std::span<const std::size_t> colors)
+      : colors_(colors.begin(), colors.end()) {
+    for (std::size_t v = 0; v < colors_.size(); ++v) {
+      grow_class(colors_[v]).set(v);
     }
+  }
 
-    return color_map;
+  std::size_t num_vertices() const noexcept { return colors_.size(); }
+  std::size_t num_colors() const noexcept { return classes_.size(); }
 
-  } else if (strategy == graph_coloring_strategy::SMALLEST_LAST) {
+  std::size_t color(std::size_t v) const { return colors_.at(v); }
+  const std::vector<std::size_t> &colors() const noexcept { return colors_; }
 
-    // not implemented
-    throw std::runtime_error("Smallest last graph coloring not implemented");
+  /// @throws std::out_of_range if c >= num_colors()
+  const BitVector &color_class(std::size_t c) const { return classes_.at(c); }
 
-  } else {
+  /// Moves v to color c, adding classes up to c if needed.
+  void set_color(std::size_t v, std::size_t c) {
+    std::size_t &old = colors_.at(v);
+    classes_[old].reset(v);
+    old = c;
+    grow_class(c).set(v);
+  }
 
-    throw std::runtime_error("Invalid graph coloring strategy");
+  /**
+   * @brief Number of neighbours of v in mat that share its color. A self-loop
+   * on v is not counted.
+   */
+  std::size_t conflicts(const BitAdjmat &mat, std::size_t v) const noexcept {
+    return neighbors_with_color(mat, v, colors_[v]);
+  }
+
+  /**
+   * @brief The smallest color no neighbour of v in mat has, other than v
+   * itself; num_colors() if every color is taken.
+   */
+  std::size_t first_free_color(const BitAdjmat &mat,
+                               std::size_t v) const noexcept {
+    std::size_t c = 0;
+    while (c < classes_.size() && neighbors_with_color(mat, v, c) > 0) {
+      ++c;
+    }
+    return c;
+  }
+
+private:
+  BitVector &grow_class(std::size_t c) {
+    while (classes_.size() <= c) {
+      classes_.emplace_back(colors_.size());
+    }
+    return classes_[c];
+  }
+
+  std::size_t neighbors_with_color(const BitAdjmat &mat, std::size_t v,
+                                   std::size_t c) const noexcept {
+    const BitVector &cls = classes_[c];
+    std::size_t count =
+        bitops::popcount_and(mat[v].data(), cls.data(), cls.num_words());
+    return count - (c == colors_[v] && mat.get(v, v));
   }
+
+  std::vector<std::size_t> colors_;
+  std::vector<BitVector> classes_;
+};
+
+namespace detail {
+
+/// @internal
+inline void check_color_classes(const BitAdjmat &mat,
+                                const ColorClasses &classes,
+                                const char *caller) {
+  if (mat.num_vertices() != classes.num_vertices()) {
+    std::string msg = caller;
+    msg += ": the coloring and the adjmat have different vertex counts";
+    throw std::invalid_argument(msg);
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief The vertices of mat with a neighbour of the same color, in
+ * increasing order. With a pool, blocks of vertices are checked in parallel.
+ * @throws std::invalid_argument if classes does not color mat's vertices
+ */
+inline std::vector<std::size_t>
+coloring_conflicts(const BitAdjmat &mat, const ColorClasses &classes,
+                   parallel::thread_pool *pool = nullptr) {
+  detail::check_color_classes(mat, classes, "coloring_conflicts");
+  std::size_t n = mat.num_vertices();
+  std::vector<std::size_t> result;
+  if (pool == nullptr || n == 0) {
+    for (std::size_t v = 0; v < n; ++v) {
+      if (classes.conflicts(mat, v) > 0) {
+        result.push_back(v);
+      }
+    }
+    return result;
+  }
+
+  std::size_t num_chunks = std::min(n, 4 * (pool->size() + 1));
+  std::vector<std::vector<std::size_t>> found(num_chunks);
+  pool->parallel_for(std::size_t{0}, num_chunks, 1, [&](std::size_t chunk) {
+    for (std::size_t v = chunk * n / num_chunks;
+         v < (chunk + 1) * n / num_chunks; ++v) {
+      if (classes.conflicts(mat, v) > 0) {
+        found[chunk].push_back(v);
+      }
+    }
+  });
+  for (const auto &f : found) {
+    result.insert(result.end(), f.begin(), f.end());
+  }
+  return result;
+}
+
+/**
+ * @brief Whether no two adjacent vertices of mat have the same color.
+ * Self-loops are ignored. With a pool, blocks of vertices are checked in
+ * parallel and all stop at the first conflict found.
+ * @throws std::invalid_argument if classes does not color mat's vertices
+ */
+inline bool verify_coloring(const BitAdjmat &mat, const ColorClasses &classes,
+                            parallel::thread_pool *pool = nullptr) {
+  detail::check_color_classes(mat, classes, "verify_coloring");
+  std::size_t n = mat.num_vertices();
+  if (pool == nullptr || n == 0) {
+    for (std::size_t v = 0; v < n; ++v) {
+      if (classes.conflicts(mat, v) > 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::size_t num_chunks = std::min(n, 4 * (pool->size() + 1));
+  std::atomic<bool> proper{true};
+  pool->parallel_for(std::size_t{0}, num_chunks, 1, [&](std::size_t chunk) {
+    for (std::size_t v = chunk * n / num_chunks;
+         v < (chunk + 1) * n / num_chunks &&
+         proper.load(std::memory_order_relaxed);
+         ++v) {
+      if (classes.conflicts(mat, v) > 0) {
+        proper.store(false, std::memory_order_relaxed);
+      }
+    }
+  });
+  return proper.load();
+}
+
+/**
+ * @brief verify_coloring for a color per vertex, e.g. from graph_coloring.
+ * @throws std::invalid_argument if colors.size() != mat.num_vertices()
+ */
+inline bool verify_coloring(const BitAdjmat &mat,
+                            std::span<const std::size_t> colors,
+                            parallel::thread_pool *pool = nullptr) {
+  return verify_coloring(mat, ColorClasses(colors), pool);
+}
+
+/**
+ * @brief Adds the edge (u, v) to mat and keeps classes a proper coloring of
+ * it, assuming it was one before.
+ *
+ * @details If u and v have the same color, the endpoint whose smallest free
+ * color is lower is moved to that color (v on a tie), opening a new color if
+ * none is free. Nothing else is recolored, so this is O(num_colors * n / 64)
+ * against O(E) for rerunning graph_coloring, at the cost of the coloring
+ * drifting from what a full rerun would give.
+ * @return the vertex that was recolored, if any
+ * @throws std::invalid_argument if classes does not color mat's vertices
+ * @throws std::out_of_range if u or v is not a vertex
+ */
+inline std::optional<std::size_t>
+recolor_after_edge_insert(BitAdjmat &mat, ColorClasses &classes,
+                          std::size_t u, std::size_t v) {
+  detail::check_color_classes(mat, classes, "recolor_after_edge_insert");
+  if (u >= mat.num_vertices() || v >= mat.num_vertices()) {
+    throw std::out_of_range("recolor_after_edge_insert: no such vertex");
+  }
+  mat.set(u, v);
+  if (u == v || classes.color(u) != classes.color(v)) {
+    return std::nullopt;
+  }
+  std::size_t free_u = classes.first_free_color(mat, u);
+  std::size_t free_v = classes.first_free_color(mat, v);
+  if (free_u < free_v) {
+    classes.set_color(u, free_u);
+    return u;
+  }
+  classes.set_color(v, free_v);
+  return v;
 }
 
 template <typename DistanceType>
 using distances_t = std::vector<std::vector<DistanceType>>;
 
+namespace detail {
+
 /**
- * @brief Floyd Warshall algorithm for undirected boost graph. Call using
- * floyd_warshall<DistanceType>(g), or floyd_warshall(g) (default DistanceType
- * is int)
+ * @brief One tile update of the blocked Floyd Warshall algorithm:
+ * d[I][J] = min(d[I][J], d[I][K] + d[K][J]) for the tiles with row ranges
+ * I, column ranges J and pivot range K. Correct even when the tiles alias, as
+ * long as k is the outermost loop. d may be any square view; rows with
+ * adjacent elements are walked through pointers.
  */
-template <typename DistanceType = int>
-distances_t<DistanceType> floyd_warshall(const Graph &g) {
+template <typename DistanceType>
+void floyd_warshall_tile(MatrixView<DistanceType> d, std::size_t i0,
+                         std::size_t i1, std::size_t j0, std::size_t j1,
+                         std::size_t k0, std::size_t k1) {
+  constexpr DistanceType inf = std::numeric_limits<DistanceType>::max();
+  for (std::size_t k = k0; k < k1; ++k) {
+    for (std::size_t i = i0; i < i1; ++i) {
+      DistanceType d_ik = d(i, k);
+      if (d_ik == inf) {
+        continue;
+      }
+      if (d.rows_contiguous()) {
+        const DistanceType *row_k = &d(k, 0);
+        DistanceType *row_i = &d(i, 0);
+        for (std::size_t j = j0; j < j1; ++j) {
+          if (row_k[j] != inf && d_ik + row_k[j] < row_i[j]) {
+            row_i[j] = d_ik + row_k[j];
+          }
+        }
+      } else {
+        for (std::size_t j = j0; j < j1; ++j) {
+          DistanceType d_kj = d(k, j);
+          if (d_kj != inf && d_ik + d_kj < d(i, j)) {
+            d(i, j) = d_ik + d_kj;
+          }
+        }
+      }
+    }
+  }
+}
 
-  std::size_t n = boost::num_vertices(g);
-  DistanceType inf = std::numeric_limits<DistanceType>::max();
-  distances_t<DistanceType> d(n, std::vector<DistanceType>(n, inf));
-  for (std::size_t i = 0; i < n; ++i) {
-    d[i][i] = 0;
+template <typename DistanceType>
+void floyd_warshall_tile(Matrix<DistanceType> &d, std::size_t i0,
+                         std::size_t i1, std::size_t j0, std::size_t j1,
+                         std::size_t k0, std::size_t k1) {
+  floyd_warshall_tile(d.view(), i0, i1, j0, j1, k0, k1);
+}
+
+/**
+ * @brief In-place blocked (tiled) Floyd Warshall over a distance matrix or a
+ * view of one, e.g. a block of a larger matrix. For each pivot tile, the
+ * pivot tile itself is updated, then the tiles in its row and column, then
+ * all remaining tiles. The tiles of the last two phases are independent and
+ * are spread across 'pool' if one is given.
+ * @throws std::runtime_error if d is not square
+ */
+template <typename DistanceType>
+void blocked_floyd_warshall(MatrixView<DistanceType> d,
+                            parallel::thread_pool *pool,
+                            std::size_t block_size) {
+  if (d.num_rows() != d.num_columns()) {
+    throw std::runtime_error("Distance matrix must be square");
   }
-  for (auto e : boost::make_iterator_range(boost::edges(g))) {
-    std::size_t u = boost::source(e, g);
-    std::size_t v = boost::target(e, g);
-    d[u][v] = 1;
-    d[v][u] = 1;
+  std::size_t n = d.num_rows();
+  if (n == 0) {
+    return;
   }
+  if (block_size == 0) {
+    block_size = 64;
+  }
+  std::size_t nb = (n + block_size - 1) / block_size;
 
-  // Start the floyd warshall iterations
-  for (std::size_t k = 0; k < n; ++k) {
-    for (std::size_t i = 0; i < n; ++i) {
-      for (std::size_t j = 0; j < n; ++j) {
-        if (d[i][k] != inf && d[k][j] != inf && d[i][j] > d[i][k] + d[k][j]) {
-          d[i][j] = d[i][k] + d[k][j];
-        }
+  auto lo = [&](std::size_t b) { return b * block_size; };
+  auto hi = [&](std::size_t b) { return std::min(n, (b + 1) * block_size); };
+
+  auto for_each = [&](std::size_t count, auto &&f) {
+    if (pool) {
+      pool->parallel_for(std::size_t{0}, count, 1, f);
+    } else {
+      for (std::size_t i = 0; i < count; ++i) {
+        f(i);
       }
     }
+  };
+
+  for (std::size_t kb = 0; kb < nb; ++kb) {
+    std::size_t k0 = lo(kb), k1 = hi(kb);
+
+    // Phase 1: pivot tile.
+    floyd_warshall_tile(d, k0, k1, k0, k1, k0, k1);
+
+    // Phase 2: tiles in the pivot row and pivot column.
+    for_each(2 * nb, [&](std::size_t t) {
+      std::size_t b = t / 2;
+      if (b == kb) {
+        return;
+      }
+      if (t % 2 == 0) {
+        floyd_warshall_tile(d, k0, k1, lo(b), hi(b), k0, k1);
+      } else {
+        floyd_warshall_tile(d, lo(b), hi(b), k0, k1, k0, k1);
+      }
+    });
+
+    // Phase 3: everything else.
+    for_each(nb * nb, [&](std::size_t t) {
+      std::size_t ib = t / nb, jb = t % nb;
+      if (ib == kb || jb == kb) {
+        return;
+      }
+      floyd_warshall_tile(d, lo(ib), hi(ib), lo(jb), hi(jb), k0, k1);
+    });
   }
+}
 
+template <typename DistanceType>
+void blocked_floyd_warshall(Matrix<DistanceType> &d,
+                            parallel::thread_pool *pool,
+                            std::size_t block_size) {
+  blocked_floyd_warshall(d.view(), pool, block_size);
+}
+
+/**
+ * @brief n x n matrix of max() with a zero diagonal. The storage is not
+ * value-initialized first, and rows are filled on 'pool' if given, so each
+ * page is written once and by the thread that will later use it.
+ */
+template <typename DistanceType>
+Matrix<DistanceType> initial_distance_matrix(std::size_t n,
+                                             parallel::thread_pool *pool) {
+  auto d = Matrix<DistanceType>::uninitialized(n, n);
+  auto fill_row = [&](std::size_t i) {
+    DistanceType *row = &d(i, 0);
+    std::fill(row, row + n, std::numeric_limits<DistanceType>::max());
+    row[i] = 0;
+  };
+  if (pool != nullptr && n > 1) {
+    pool->parallel_for(std::size_t{0}, n, 0, fill_row);
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      fill_row(i);
+    }
+  }
+  return d;
+}
+
+template <typename DistanceType>
+distances_t<DistanceType> to_distances(const Matrix<DistanceType> &m) {
+  std::size_t n = m.size();
+  distances_t<DistanceType> d(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    d[i].assign(m.data(i), m.data(i) + n);
+  }
   return d;
 }
 
+} // namespace detail
+
 /**
- * @brief Floyd Warshall algorithm for directed boost graph. Call using
- * floyd_warshall<DistanceType>(g), or floyd_warshall(g) (default DistanceType
- * is int)
+ * @brief Blocked Floyd Warshall for an undirected boost graph, returning a
+ * contiguous n x n distance matrix. Unreachable pairs have distance
+ * std::numeric_limits<DistanceType>::max().
+ *
+ * @param pool If given, the tiles of each phase are processed in parallel.
+ * @param block_size Tile side length. The default keeps three int tiles well
+ * inside L1/L2.
  */
 template <typename DistanceType = int>
-distances_t<DistanceType> floyd_warshall(const DiGraph &g) {
-  // Set up initial state
-  std::size_t n = boost::num_vertices(g);
-  DistanceType inf = std::numeric_limits<DistanceType>::max();
-  distances_t<DistanceType> d(n, std::vector<DistanceType>(n, inf));
-  for (std::size_t i = 0; i < n; ++i) {
-    d[i][i] = 0;
+Matrix<DistanceType> floyd_warshall_matrix(const Graph &g,
+                                           parallel::thread_pool *pool = nullptr,
+                                           std::size_t block_size = 64) {
+  auto d = detail::initial_distance_matrix<DistanceType>(boost::num_vertices(g),
+                                                        pool);
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    std::size_t u = boost::source(e, g);
+    std::size_t v = boost::target(e, g);
+    if (u != v) {
+      d(u, v) = 1;
+      d(v, u) = 1;
+    }
   }
+  detail::blocked_floyd_warshall(d, pool, block_size);
+  return d;
+}
+
+/**
+ * @brief Blocked Floyd Warshall for a directed boost graph. See the Graph
+ * overload.
+ */
+template <typename DistanceType = int>
+Matrix<DistanceType> floyd_warshall_matrix(const DiGraph &g,
+                                           parallel::thread_pool *pool = nullptr,
+                                           std::size_t block_size = 64) {
+  auto d = detail::initial_distance_matrix<DistanceType>(boost::num_vertices(g),
+                                                        pool);
   for (auto e : boost::make_iterator_range(boost::edges(g))) {
     std::size_t u = boost::source(e, g);
     std::size_t v = boost::target(e, g);
-    d[u][v] = 1;
+    if (u != v) {
+      d(u, v) = 1;
+    }
   }
+  detail::blocked_floyd_warshall(d, pool, block_size);
+  return d;
+}
 
-  // Start the floyd warshall iterations
-  for (std::size_t k = 0; k < n; ++k) {
-    for (std::size_t i = 0; i < n; ++i) {
-      for (std::size_t j = 0; j < n; ++j) {
-        if (d[i][k] != inf && d[k][j] != inf && d[i][j] > d[i][k] + d[k][j]) {
-          d[i][j] = d[i][k] + d[k][j];
-        }
+/**
+ * @brief Blocked Floyd Warshall for a bit-adjacency matrix. See the Graph
+ * overload.
+ */
+template <typename DistanceType = int>
+Matrix<DistanceType> floyd_warshall_matrix(const BitAdjmat &g,
+                                           parallel::thread_pool *pool = nullptr,
+                                           std::size_t block_size = 64) {
+  auto d = detail::initial_distance_matrix<DistanceType>(g.num_vertices(), pool);
+  for (std::size_t i = 0; i < g.num_vertices(); ++i) {
+    for (std::size_t j : g[i]) {
+      if (i != j) {
+        d(i, j) = 1;
       }
     }
   }
-
+  detail::blocked_floyd_warshall(d, pool, block_size);
   return d;
 }
 
+/**
+ * @brief Floyd Warshall algorithm for undirected boost graph. Call using
+ * floyd_warshall<DistanceType>(g), or floyd_warshall(g) (default DistanceType
+ * is int)
+ */
+template <typename DistanceType = int>
+distances_t<DistanceType> floyd_warshall(const Graph &g) {
+  return detail::to_distances(floyd_warshall_matrix<DistanceType>(g));
+}
+
+/**
+ * @brief Floyd Warshall algorithm for directed boost graph. Call using
+ * floyd_warshall<DistanceType>(g), or floyd_warshall(g) (default DistanceType
+ * is int)
+ */
+template <typename DistanceType = int>
+distances_t<DistanceType> floyd_warshall(const DiGraph &g) {
+  return detail::to_distances(floyd_warshall_matrix<DistanceType>(g));
+}
+
 /**
  * @brief Floyd Warshall algorithm for bit-adjacency matrices. Call using
  * floyd_warshall<DistanceType>(g), where DistanceType can be any integer type.
  */
 template <typename DistanceType = int>
 distances_t<DistanceType> floyd_warshall(const BitAdjmat &g) {
+  return detail::to_distances(floyd_warshall_matrix<DistanceType>(g));
+}
+
+/**
+ * @brief Distance used by all_pairs_bfs for unreachable vertex pairs.
+ */
+constexpr std::uint16_t unreachable_distance =
+    std::numeric_limits<std::uint16_t>::max();
+
+/**
+ * @brief Bit-parallel all-pairs shortest paths for unweighted graphs.
+ *
+ * @details Runs a multi-source BFS (MS-BFS) for 64 sources at a time: every
+ * vertex keeps a 64-bit mask of which of the current sources have reached it,
+ * so one pass over the adjacency rows advances all 64 searches by one level.
+ * Batches of sources are independent and are spread over 'pool' if given.
+ *
+ * @return n x n matrix of hop distances, with unreachable_distance for pairs
+ * that are not connected. Graphs with a diameter of 65535 or more are not
+ * supported.
+ */
+inline Matrix<std::uint16_t>
+all_pairs_bfs(const BitAdjmat &g, parallel::thread_pool *pool = nullptr) {
+  constexpr std::size_t W = 64;
 
   std::size_t n = g.num_vertices();
-  DistanceType inf = std::numeric_limits<DistanceType>::max();
-  distances_t<DistanceType> d(n, std::vector<DistanceType>(n, inf));
-  for (std::size_t i = 0; i < n; ++i) {
-    d[i][i] = 0;
+  // Each batch fills its own rows, so the matrix is not written twice.
+  auto dist = Matrix<std::uint16_t>::uninitialized(n, n);
+  if (n == 0) {
+    return dist;
   }
 
-  for (std::size_t i = 0; i < n; ++i) {
-    for (std::size_t j : g[i]) {
-      d[i][j] = 1;
+  // Neighbour lists are extracted once, so the inner loop does not have to
+  // scan empty words of sparse rows.
+  std::vector<std::size_t> offsets(n + 1, 0);
+  std::vector<std::size_t> neighbors;
+  neighbors.reserve(g.count_ones());
+  for (std::size_t v = 0; v < n; ++v) {
+    for (std::size_t u : g[v]) {
+      neighbors.push_back(u);
     }
+    offsets[v + 1] = neighbors.size();
   }
 
-  // Start the floyd warshall iterations
-  for (std::size_t k = 0; k < n; ++k) {
-    for (std::size_t i = 0; i < n; ++i) {
-      for (std::size_t j = 0; j < n; ++j) {
-        if (d[i][k] != inf && d[k][j] != inf && d[i][j] > d[i][k] + d[k][j]) {
-          d[i][j] = d[i][k] + d[k][j];
+  std::size_t num_batches = (n + W - 1) / W;
+
+  auto run_batch = [&](std::size_t batch) {
+    std::size_t first = batch * W;
+    std::size_t count = std::min(W, n - first);
+
+    std::fill(&dist(first, 0), &dist(first, 0) + count * n,
+              unreachable_distance);
+    std::vector<std::uint64_t> seen(n, 0), frontier(n, 0), next(n, 0);
+    for (std::size_t b = 0; b < count; ++b) {
+      seen[first + b] |= 1ULL << b;
+      frontier[first + b] |= 1ULL << b;
+      dist(first + b, first + b) = 0;
+    }
+
+    for (std::uint16_t level = 1;; ++level) {
+      for (std::size_t v = 0; v < n; ++v) {
+        std::uint64_t f = frontier[v];
+        if (f == 0) {
+          continue;
+        }
+        for (std::size_t e = offsets[v]; e < offsets[v + 1]; ++e) {
+          next[neighbors[e]] |= f;
+        }
+      }
+
+      bool any = false;
+      for (std::size_t u = 0; u < n; ++u) {
+        std::uint64_t fresh = next[u] & ~seen[u];
+        next[u] = 0;
+        frontier[u] = fresh;
+        if (fresh == 0) {
+          continue;
+        }
+        any = true;
+        seen[u] |= fresh;
+        while (fresh) {
+          std::size_t b = std::countr_zero(fresh);
+          fresh &= fresh - 1;
+          dist(first + b, u) = level;
         }
       }
+
+      if (!any) {
+        break;
+      }
+    }
+  };
+
+  if (pool) {
+    pool->parallel_for(std::size_t{0}, num_batches, 1, run_batch);
+  } else {
+    for (std::size_t batch = 0; batch < num_batches; ++batch) {
+      run_batch(batch);
     }
   }
 
-  return d;
+  return dist;
+}
+
+/**
+ * @brief Bit-parallel all-pairs shortest paths for an unweighted undirected
+ * boost graph. See the BitAdjmat overload.
+ */
+inline Matrix<std::uint16_t>
+all_pairs_bfs(const Graph &g, parallel::thread_pool *pool = nullptr) {
+  return all_pairs_bfs(BitAdjmat(g), pool);
 }
 
 } // namespace gl
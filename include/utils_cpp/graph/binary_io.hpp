@@ -0,0 +1,564 @@
+/**********************************************************************
+ * @brief Binary on-disk format for graphs, loaded by memory mapping.
+ * @details A file holds the CSR arrays of a graph, its vertex and edge
+ *properties as columns, and its graph properties (name, sizes, ...) in the
+ *header. load_binary maps the file and returns a CsrGraph view and column
+ *views pointing into the mapping, so loading does not parse or copy
+ *anything: only the pages that are actually read get loaded, and several
+ *processes mapping the same file share them.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/graph.hpp"
+#include "utils_cpp/graph/properties.hpp"
+#include "utils_cpp/mapped_file.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace gl {
+
+/**
+ * @brief A vertex or edge property read from a binary graph file. Scalar
+ * properties have one value per element; vector properties have the values
+ * of element i at values[offsets[i] .. offsets[i+1]).
+ */
+struct ColumnView {
+  std::span<const double> values;
+  std::span<const std::size_t> offsets; // empty for scalar properties
+
+  bool is_vector() const noexcept { return !offsets.empty(); }
+
+  std::size_t size() const noexcept {
+    return is_vector() ? offsets.size() - 1 : values.size();
+  }
+
+  double scalar(std::size_t i) const { return values[i]; }
+
+  std::span<const double> vector(std::size_t i) const {
+    return values.subspan(offsets[i], offsets[i + 1] - offsets[i]);
+  }
+};
+
+/**
+ * @brief A graph loaded by load_binary. The graph and the columns point into
+ * the mapped file, which stays mapped as long as this object or any copy of
+ * the graph is alive. Graph properties are small and are copied.
+ */
+template <typename WeightType = std::size_t>
+struct BinaryGraph {
+  CsrGraph<WeightType> graph;
+  GraphPropMap graph_props;
+  std::map<std::string, ColumnView> vertex_props;
+  std::map<std::string, ColumnView> edge_props; // indexed by edge id
+
+  /**
+   * @brief Copies the file into a GraphBundle, with columnar vertex
+   * properties. Undirected graphs only.
+   */
+  GraphBundle to_bundle() const;
+
+  std::shared_ptr<const MappedFile> file;
+};
+
+/**
+ * @brief Writes the graph of gb, its double and vector vertex and edge
+ * properties, and its graph properties. Edge ids are positions in
+ * boost::edges(gb.graph), as for CsrGraph(gb.graph).
+ *
+ * @throws std::invalid_argument for string vertex or edge properties.
+ * @throws std::runtime_error if the file cannot be written.
+ */
+void save_binary(const GraphBundle &gb, const std::string &filename);
+
+/**
+ * @brief Writes a (possibly weighted) CsrGraph and graph properties.
+ */
+template <typename WeightType>
+void save_binary(const CsrGraph<WeightType> &g, const std::string &filename,
+                 const GraphPropMap &graph_props = {});
+
+/**
+ * @brief Maps a file written by save_binary.
+ *
+ * @details Only the header and the bounds of the arrays are checked, so the
+ * file must be trusted. WeightType must match the type that was saved.
+ *
+ * @throws std::runtime_error if the file is not a binary graph of this
+ * version, was written with another weight type, or is truncated.
+ */
+template <typename WeightType = std::size_t>
+BinaryGraph<WeightType> load_binary(const std::string &filename);
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+namespace detail {
+
+/*
+ * Format, version 1. All numbers are little-endian, sizes are 64 bits. Arrays
+ * start at multiples of 64 bytes so they can be used in place.
+ *
+ *   "UCSRGRPH"  u32 version  u32 flags (1: directed, 2: weighted)
+ *   u32 weight size  u32 weight kind (0: unsigned, 1: signed, 2: float)
+ *   u64 num_vertices  u64 num_edges  u64 num_arcs  8 bytes max_weight
+ *   u64 count, then per graph property: string name, u8 tag, value
+ *     (0: string, 1: f64, 2: vector of f64, 3: vector of vectors)
+ *   arrays offsets[n+1], targets[arcs], edge_ids[arcs], weights[arcs]
+ *   vertex properties, then edge properties: u64 count, then per property
+ *     string name, u8 kind (0: scalar, 1: vector), and the arrays
+ *     values[size] or offsets[size+1], values[offsets[size]]
+ *
+ * where a string is a u64 length followed by its bytes.
+ */
+constexpr char binary_magic[8] = {'U', 'C', 'S', 'R', 'G', 'R', 'P', 'H'};
+constexpr std::uint32_t binary_version = 1;
+constexpr std::size_t binary_alignment = 64;
+
+template <typename WeightType>
+constexpr std::uint32_t binary_weight_kind() {
+  if constexpr (std::is_floating_point_v<WeightType>) {
+    return 2;
+  } else if constexpr (std::is_signed_v<WeightType>) {
+    return 1;
+  } else {
+    return 0;
+  }
+}
+
+inline void check_binary_platform() {
+  static_assert(sizeof(std::size_t) == 8 && sizeof(double) == 8,
+                "the binary graph format needs 64-bit sizes");
+  if constexpr (std::endian::native != std::endian::little) {
+    throw std::runtime_error("binary graph files need a little-endian host");
+  }
+}
+
+class BinaryWriter {
+public:
+  explicit BinaryWriter(const std::string &filename)
+      : os_(filename, std::ios::binary) {
+    if (!os_) {
+      throw std::runtime_error("save_binary: cannot open " + filename);
+    }
+  }
+
+  template <typename T>
+  void write(const T &value) {
+    bytes(&value, sizeof(T));
+  }
+
+  void write(const std::string &s) {
+    write<std::uint64_t>(s.size());
+    bytes(s.data(), s.size());
+  }
+
+  template <typename T>
+  void array(std::span<const T> values) {
+    static constexpr char zeros[binary_alignment] = {};
+    bytes(zeros, (binary_alignment - position_ % binary_alignment) %
+                     binary_alignment);
+    bytes(values.data(), values.size_bytes());
+  }
+
+  void close() {
+    os_.close();
+    if (!os_) {
+      throw std::runtime_error("save_binary: write failed");
+    }
+  }
+
+private:
+  void bytes(const void *data, std::size_t size) {
+    os_.write(static_cast<const char *>(data),
+              static_cast<std::streamsize>(size));
+    position_ += size;
+  }
+
+  std::ofstream os_;
+  std::size_t position_ = 0;
+};
+
+class BinaryReader {
+public:
+  explicit BinaryReader(const MappedFile &file) : file_{file} {}
+
+  template <typename T>
+  T read() {
+    T value;
+    std::memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::string read_string() {
+    auto size = read<std::uint64_t>();
+    const char *data = take(size);
+    return {data, size};
+  }
+
+  template <typename T>
+  std::span<const T> array(std::size_t count) {
+    position_ += (binary_alignment - position_ % binary_alignment) %
+                 binary_alignment;
+    if (count > (file_.size() - std::min(position_, file_.size())) / sizeof(T)) {
+      truncated();
+    }
+    return {reinterpret_cast<const T *>(take(count * sizeof(T))), count};
+  }
+
+  const char *take(std::size_t size) {
+    if (position_ > file_.size() || size > file_.size() - position_) {
+      truncated();
+    }
+    const char *data = file_.data() + position_;
+    position_ += size;
+    return data;
+  }
+
+private:
+  [[noreturn]] static void truncated() {
+    throw std::runtime_error("load_binary: file is truncated");
+  }
+
+  const MappedFile &file_;
+  std::size_t position_ = 0;
+};
+
+inline void write_graph_props(BinaryWriter &out, const GraphPropMap &props) {
+  out.write<std::uint64_t>(props.size());
+  for (const auto &[name, prop] : props) {
+    out.write(name);
+    out.write<std::uint8_t>(static_cast<std::uint8_t>(prop.p.index()));
+    std::visit(
+        [&](const auto &value) {
+          using T = std::decay_t<decltype(value)>;
+          if constexpr (std::is_same_v<T, std::string>) {
+            out.write(value);
+          } else if constexpr (std::is_same_v<T, double>) {
+            out.write(value);
+          } else if constexpr (std::is_same_v<T, std::vector<double>>) {
+            out.write<std::uint64_t>(value.size());
+            for (double x : value) {
+              out.write(x);
+            }
+          } else {
+            out.write<std::uint64_t>(value.size());
+            for (const auto &row : value) {
+              out.write<std::uint64_t>(row.size());
+              for (double x : row) {
+                out.write(x);
+              }
+            }
+          }
+        },
+        prop.p);
+  }
+}
+
+inline GraphPropMap read_graph_props(BinaryReader &in) {
+  GraphPropMap props;
+  auto read_vector = [&] {
+    std::vector<double> v(in.read<std::uint64_t>());
+    for (auto &x : v) {
+      x = in.read<double>();
+    }
+    return v;
+  };
+
+  auto count = in.read<std::uint64_t>();
+  for (std::uint64_t i = 0; i < count; ++i) {
+    std::string name = in.read_string();
+    switch (in.read<std::uint8_t>()) {
+    case 0:
+      props[name] = in.read_string();
+      break;
+    case 1:
+      props[name] = in.read<double>();
+      break;
+    case 2:
+      props[name] = read_vector();
+      break;
+    case 3: {
+      std::vector<std::vector<double>> rows(in.read<std::uint64_t>());
+      for (auto &row : rows) {
+        row = read_vector();
+      }
+      props[name] = rows;
+      break;
+    }
+    default:
+      throw std::runtime_error("load_binary: unknown graph property type");
+    }
+  }
+  return props;
+}
+
+/**
+ * Writes one property as a column with 'size' rows. value_of(i, f) calls f
+ * with the double or span of doubles of row i, or not at all if it has none.
+ */
+template <typename ValueOf>
+void write_column(BinaryWriter &out, const std::string &name, bool is_vector,
+                  std::size_t size, ValueOf &&value_of) {
+  out.write(name);
+  out.write<std::uint8_t>(is_vector ? 1 : 0);
+
+  if (!is_vector) {
+    std::vector<double> values(size, 0.0);
+    for (std::size_t i = 0; i < size; ++i) {
+      value_of(i, [&](const auto &x) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(x)>, double>) {
+          values[i] = x;
+        }
+      });
+    }
+    out.array<double>(values);
+    return;
+  }
+
+  std::vector<std::size_t> offsets(size + 1, 0);
+  std::vector<double> values;
+  for (std::size_t i = 0; i < size; ++i) {
+    value_of(i, [&](const auto &x) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(x)>,
+                                   std::span<const double>>) {
+        values.insert(values.end(), x.begin(), x.end());
+      }
+    });
+    offsets[i + 1] = values.size();
+  }
+  out.array<std::size_t>(offsets);
+  out.array<double>(values);
+}
+
+inline std::map<std::string, ColumnView> read_columns(BinaryReader &in,
+                                                      std::size_t size) {
+  std::map<std::string, ColumnView> columns;
+  auto count = in.read<std::uint64_t>();
+  for (std::uint64_t i = 0; i < count; ++i) {
+    std::string name = in.read_string();
+    ColumnView column;
+    if (in.read<std::uint8_t>() == 0) {
+      column.values = in.array<double>(size);
+    } else {
+      column.offsets = in.array<std::size_t>(size + 1);
+      column.values = in.array<double>(column.offsets.back());
+    }
+    columns.emplace(std::move(name), column);
+  }
+  return columns;
+}
+
+template <typename WeightType>
+void write_csr(BinaryWriter &out, const CsrGraph<WeightType> &g,
+               const GraphPropMap &graph_props) {
+  static_assert(sizeof(WeightType) <= 8);
+  check_binary_platform();
+
+  out.write(binary_magic);
+  out.write(binary_version);
+  out.write<std::uint32_t>((g.is_directed() ? 1 : 0) |
+                           (g.is_weighted() ? 2 : 0));
+  out.write<std::uint32_t>(sizeof(WeightType));
+  out.write(binary_weight_kind<WeightType>());
+  out.write<std::uint64_t>(g.num_vertices());
+  out.write<std::uint64_t>(g.num_edges());
+  out.write<std::uint64_t>(g.num_arcs());
+  char max_weight[8] = {};
+  WeightType w = g.max_weight();
+  std::memcpy(max_weight, &w, sizeof(WeightType));
+  out.write(max_weight);
+
+  write_graph_props(out, graph_props);
+
+  out.array(g.offsets());
+  out.array(g.targets());
+  out.array(g.edge_ids());
+  out.array(g.weights());
+}
+
+} // namespace detail
+
+inline void save_binary(const GraphBundle &gb, const std::string &filename) {
+  const Graph &g = gb.graph;
+  CsrGraph<> csr(g);
+
+  detail::BinaryWriter out(filename);
+  detail::write_csr(out, csr, gb.props.graph);
+
+  out.write<std::uint64_t>(gb.props.vertex.size());
+  for (const auto &[name, prop] : gb.props.vertex) {
+    if (std::holds_alternative<VertexProp<>::string_map>(prop.p)) {
+      throw std::invalid_argument(
+          "save_binary: string properties cannot be stored");
+    }
+    bool is_vector = std::holds_alternative<VertexProp<>::vector_map>(prop.p) ||
+                     std::holds_alternative<VectorColumn>(prop.p);
+    detail::write_column(out, name, is_vector, csr.num_vertices(),
+                         [&](std::size_t v, auto &&f) {
+                           try {
+                             prop.visit_value(v, f);
+                           } catch (const std::out_of_range &) {
+                           }
+                         });
+  }
+
+  std::vector<Edge<Graph>> edges;
+  edges.reserve(csr.num_edges());
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    edges.push_back(e);
+  }
+
+  out.write<std::uint64_t>(gb.props.edge.size());
+  for (const auto &[name, prop] : gb.props.edge) {
+    if (std::holds_alternative<EdgeProp<>::string_map>(prop.p)) {
+      throw std::invalid_argument(
+          "save_binary: string properties cannot be stored");
+    }
+    bool is_vector = std::holds_alternative<EdgeProp<>::vector_map>(prop.p);
+    detail::write_column(out, name, is_vector, edges.size(),
+                         [&](std::size_t id, auto &&f) {
+                           try {
+                             prop.visit_value(edges[id], f);
+                           } catch (const std::out_of_range &) {
+                           }
+                         });
+  }
+  out.close();
+}
+
+template <typename WeightType>
+void save_binary(const CsrGraph<WeightType> &g, const std::string &filename,
+                 const GraphPropMap &graph_props) {
+  detail::BinaryWriter out(filename);
+  detail::write_csr(out, g, graph_props);
+  out.write<std::uint64_t>(0); // vertex properties
+  out.write<std::uint64_t>(0); // edge properties
+  out.close();
+}
+
+template <typename WeightType>
+BinaryGraph<WeightType> load_binary(const std::string &filename) {
+  detail::check_binary_platform();
+
+  BinaryGraph<WeightType> result;
+  result.file = std::make_shared<const MappedFile>(filename);
+  detail::BinaryReader in(*result.file);
+
+  if (std::memcmp(in.take(sizeof(detail::binary_magic)), detail::binary_magic,
+                  sizeof(detail::binary_magic)) != 0) {
+    throw std::runtime_error("load_binary: not a binary graph file");
+  }
+  if (in.read<std::uint32_t>() != detail::binary_version) {
+    throw std::runtime_error("load_binary: unsupported format version");
+  }
+  auto flags = in.read<std::uint32_t>();
+  auto weight_size = in.read<std::uint32_t>();
+  auto weight_kind = in.read<std::uint32_t>();
+  bool weighted = flags & 2;
+  if (weighted && (weight_size != sizeof(WeightType) ||
+                   weight_kind != detail::binary_weight_kind<WeightType>())) {
+    throw std::runtime_error("load_binary: weight type does not match");
+  }
+
+  auto num_vertices = in.read<std::uint64_t>();
+  auto num_edges = in.read<std::uint64_t>();
+  auto num_arcs = in.read<std::uint64_t>();
+  WeightType max_weight{};
+  const char *max_weight_bytes = in.take(8);
+  if (weighted) {
+    std::memcpy(&max_weight, max_weight_bytes, sizeof(WeightType));
+  } else {
+    max_weight = num_edges > 0 ? 1 : 0;
+  }
+
+  result.graph_props = detail::read_graph_props(in);
+
+  auto offsets = in.array<std::size_t>(num_vertices + 1);
+  auto targets = in.array<std::size_t>(num_arcs);
+  auto edge_ids = in.array<std::size_t>(num_arcs);
+  auto weights = in.array<WeightType>(weighted ? num_arcs : 0);
+  result.graph = CsrGraph<WeightType>::view(offsets, targets, edge_ids,
+                                            weights, num_edges, max_weight,
+                                            flags & 1, result.file);
+
+  result.vertex_props = detail::read_columns(in, num_vertices);
+  result.edge_props = detail::read_columns(in, num_edges);
+  return result;
+}
+
+template <typename WeightType>
+GraphBundle BinaryGraph<WeightType>::to_bundle() const {
+  if (graph.is_directed()) {
+    throw std::invalid_argument("to_bundle: the graph is directed");
+  }
+
+  std::vector<std::pair<std::size_t, std::size_t>> edges(graph.num_edges());
+  for (std::size_t u = 0; u < graph.num_vertices(); ++u) {
+    auto neighbors = graph.neighbors(u);
+    auto ids = graph.edge_ids(u);
+    for (std::size_t i = 0; i < neighbors.size(); ++i) {
+      if (u <= neighbors[i]) {
+        edges[ids[i]] = {u, neighbors[i]};
+      }
+    }
+  }
+
+  GraphBundle gb(detail::graph_from_edges(graph.num_vertices(), edges));
+  gb.props.graph = graph_props;
+  gb.props.graph.assign("num_vertices", boost::num_vertices(gb.graph));
+  gb.props.graph.assign("num_edges", boost::num_edges(gb.graph));
+
+  for (const auto &[name, column] : vertex_props) {
+    VertexProp<> prop;
+    if (column.is_vector()) {
+      auto &c = prop.p.template emplace<VectorColumn>();
+      c.values.assign(column.values.begin(), column.values.end());
+      c.offsets.assign(column.offsets.begin(), column.offsets.end());
+    } else {
+      prop.p.template emplace<ScalarColumn>().values.assign(
+          column.values.begin(), column.values.end());
+    }
+    gb.props.vertex.assign(name, std::move(prop));
+  }
+
+  for (const auto &[name, column] : edge_props) {
+    EdgeProp<> prop;
+    if (column.is_vector()) {
+      auto &m = prop.p.template emplace<EdgeProp<>::vector_map>();
+      for (std::size_t id = 0; id < edges.size(); ++id) {
+        auto value = column.vector(id);
+        m.emplace(Edge<Graph>(edges[id].first, edges[id].second, nullptr),
+                  std::vector<double>(value.begin(), value.end()));
+      }
+    } else {
+      auto &m = prop.p.template emplace<EdgeProp<>::double_map>();
+      for (std::size_t id = 0; id < edges.size(); ++id) {
+        m.emplace(Edge<Graph>(edges[id].first, edges[id].second, nullptr),
+                  column.scalar(id));
+      }
+    }
+    gb.props.edge.assign(name, std::move(prop));
+  }
+  return gb;
+}
+
+} // namespace gl
+} // namespace utils
@@ -8,13 +8,22 @@
 
 #pragma once
 
+#include "utils_cpp/bitops.hpp"
 #include "utils_cpp/matrix.hpp"
+#include "utils_cpp/numpy.hpp"
 
 #include "utils_cpp/graph/graph.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
 
+#include <algorithm>
 #include <array>
 #include <bit>
 #include <iostream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 namespace utils {
@@ -24,9 +33,16 @@ namespace gl {
    BitAdjmat implementation of a binary square matrix, which should
    be more efficient than using vector<vector<int>>. Stores 64 adjmat entries in
    a single uint64_t and uses bit operations to interact with its entries.
+   Every row starts on a 64-byte boundary and is padded to a multiple of 8
+   words; the padding bits are always zero, so kernels can read whole rows in
+   full vectors without tail handling.
  */
 class BitAdjmat {
 
+  using storage_type =
+      Matrix<std::uint64_t, aligned_allocator<std::uint64_t, 64>>;
+  using word_iterator = storage_type::container_type::const_iterator;
+
 public:
   // =========== Edge Iteration ==========
   // For iterating through all edges of the graph.
@@ -35,7 +51,7 @@ public:
   class edge_iterator {
 
     using edge_pair = std::pair<std::size_t, std::size_t>;
-    using iterator = std::vector<uint64_t>::const_iterator;
+    using iterator = word_iterator;
 
   public:
     edge_iterator(std::size_t num_uint64_per_row, iterator finish,
@@ -86,7 +102,7 @@ public:
   // For iterating through all the neighbors of a vertex.
   // =====================================
   class Row {
-    using iterator = std::vector<uint64_t>::const_iterator;
+    using iterator = word_iterator;
 
   public:
     /**
@@ -118,12 +134,29 @@ public:
 
     std::size_t size() const noexcept;
 
+    /**
+     * Pointer to the packed words of this row, and the number of words. The
+     * row is 64-byte aligned and num_words() includes the zero padding, so it
+     * is a multiple of 8.
+     */
+    const std::uint64_t *data() const noexcept;
+    std::size_t num_words() const noexcept;
+
+    /**
+     * Writes the neighbours, in increasing order, to the front of out and
+     * returns how many there are. Faster than iterating when the whole row
+     * is needed. out must hold at least the degree; entries past the
+     * returned count may be overwritten.
+     */
+    std::size_t decode_into(std::span<std::uint32_t> out) const noexcept;
+
     row_iterator begin() const noexcept;
     row_iterator end() const noexcept;
 
   private:
     iterator start_;
     std::size_t num_vertices_;
+    std::size_t num_words_;
   };
 
   Row operator[](std::size_t row_index) noexcept;
@@ -136,11 +169,27 @@ public:
 
   BitAdjmat() = default;
   BitAdjmat(std::size_t n);
-  BitAdjmat(const Graph &g);
+
+  /**
+   * Adjmat of an undirected graph. Row i is filled from the neighbours of i
+   * alone, so rows are independent and are filled in parallel if a pool is
+   * given. O(E + n^2/64).
+   */
+  BitAdjmat(const Graph &g, parallel::thread_pool *pool = nullptr);
+
+  /**
+   * Adjmat of n vertices with the given undirected edges. The edges are
+   * bucketed by row with a counting sort, then rows are filled as above.
+   * @throws std::out_of_range if an endpoint is not less than n
+   */
+  BitAdjmat(std::size_t n,
+            std::span<const std::pair<std::size_t, std::size_t>> edges,
+            parallel::thread_pool *pool = nullptr);
 
   /**
    * Returns a Graph that corresponds to the current adjacency matrix
-   * representation.
+   * representation, without self-loops. The rows are decoded in bulk and the
+   * graph is built in one pass.
    * @return Graph
    */
   Graph to_graph() const;
@@ -166,6 +215,13 @@ public:
    */
   std::size_t degree(int v) const noexcept;
 
+  /**
+   * Appends every edge (i, j) with i <= j to out, in the same order as
+   * edge_range(), decoding each row in bulk rather than bit by bit.
+   */
+  void decode_edges(
+      std::vector<std::pair<std::uint32_t, std::uint32_t>> &out) const;
+
   /**
    * Get the value of the (i,j)th entry of the adjmat.
    * @param i row index
@@ -254,11 +310,52 @@ public:
   BitAdjmat &toggle() noexcept;
 
   /**
-   * Performs matrix multiplication with another matrix.
-   * @param other matrix to multiply with
-   * @return result of matrix multiplication
+   * Boolean matrix product: result(i,k) = OR_j (this(i,j) AND other(j,k)).
+   * Row i of the result is the OR of the rows of 'other' selected by the set
+   * bits of row i. Sparse inputs iterate over those set bits directly; dense
+   * inputs use the "Method of Four Russians" with 8-bit lookup tables. Row
+   * blocks are processed in parallel if a pool is given.
+   * @param other matrix to multiply with (must have the same size)
+   * @param pool optional thread pool
+   * @return result of matrix multiplication (not necessarily symmetric)
+   */
+  BitAdjmat matmul(const BitAdjmat &other,
+                   parallel::thread_pool *pool = nullptr) const;
+
+  // =========== Neighbourhood counting ==========
+  // AND + popcount over whole rows. Diagonal entries (self-loops) are
+  // ignored.
+  // =============================================
+
+  /**
+   * Number of vertices adjacent to both i and j.
+   */
+  std::size_t common_neighbors_count(std::size_t i,
+                                     std::size_t j) const noexcept;
+
+  /**
+   * Number of triangles. Each edge (i, j) with i < j counts the common
+   * neighbours k > j, so every triangle is counted once. Row blocks are
+   * processed in parallel if a pool is given.
    */
-  BitAdjmat matmul(const BitAdjmat &other) const noexcept;
+  std::size_t triangle_count(parallel::thread_pool *pool = nullptr) const;
+
+  /**
+   * Common-neighbour count of every edge (i, j) with i < j, in the order of
+   * edge_range() with self-loops skipped.
+   */
+  std::vector<std::size_t>
+  edge_common_neighbors(parallel::thread_pool *pool = nullptr) const;
+
+  /**
+   * All maximal cliques with at least min_size vertices, found by
+   * Bron-Kerbosch with pivoting on bitset rows. Each clique is sorted, and
+   * cliques are grouped by their smallest vertex in increasing order. The
+   * search below each vertex runs as a separate task if a pool is given.
+   */
+  std::vector<std::vector<std::size_t>>
+  maximal_cliques(std::size_t min_size = 1,
+                  parallel::thread_pool *pool = nullptr) const;
 
   /**
    * Return a bitwise-negated copy.
@@ -269,6 +366,11 @@ public:
   BitAdjmat &operator&=(const BitAdjmat &other) noexcept;
   BitAdjmat &operator|=(const BitAdjmat &other) noexcept;
 
+  /**
+   * this &= ~other, in place.
+   */
+  BitAdjmat &andnot_assign(const BitAdjmat &other) noexcept;
+
   friend BitAdjmat operator&(const BitAdjmat &x, const BitAdjmat &y) noexcept;
   friend BitAdjmat operator|(const BitAdjmat &x, const BitAdjmat &y) noexcept;
   friend BitAdjmat operator^(const BitAdjmat &x, const BitAdjmat &y) noexcept;
@@ -289,14 +391,82 @@ private:
   BitAdjmat &swap_rows(std::size_t r1, std::size_t r2);
   BitAdjmat &swap_columns(std::size_t c1, std::size_t c2);
 
+  // The packed words of the whole matrix, which are contiguous, and their
+  // count. Used by the bulk bitwise kernels.
+  std::uint64_t *word_data() noexcept;
+  const std::uint64_t *word_data() const noexcept;
+  std::size_t num_words() const noexcept;
+
+  // Bron-Kerbosch step on the candidate set P and excluded set X, stored in
+  // level 'depth' of scratch (P, X and the pivot's non-neighbours, each
+  // num_uint64_per_row words).
+  void bron_kerbosch(std::vector<std::size_t> &clique,
+                     std::vector<std::uint64_t> &scratch, std::size_t depth,
+                     std::size_t min_size,
+                     std::vector<std::vector<std::size_t>> &out) const;
+
+  // Runs f(row) for each row, in blocks of rows in parallel if pool is set.
+  template <typename F>
+  void for_each_row_block(parallel::thread_pool *pool, F &&f) const;
+
+  // Clears the unused bits past num_vertices_ in every row, including the
+  // padding words.
+  void clear_padding() noexcept;
+
 public:
+  constexpr static std::size_t N = 64;
+
+  /// Rows are padded to a multiple of this many words (one cache line).
+  constexpr static std::size_t words_per_line = 8;
+
+  /// Words per row, ceil(n / 64) rounded up to a multiple of words_per_line.
+  static constexpr std::size_t row_stride(std::size_t n) noexcept {
+    std::size_t words = (n + N - 1) / N;
+    return (words + words_per_line - 1) / words_per_line * words_per_line;
+  }
+
   std::size_t num_vertices_;
   std::size_t num_uint64_per_row;
-  Matrix<uint64_t> matrix;
-
-  constexpr static std::size_t N = 64;
+  storage_type matrix;
 };
 
+/**
+ * Number of columns set in both rows, e.g. the number of common neighbors of
+ * two vertices, without materializing the intersection.
+ */
+std::size_t popcount_and(const BitAdjmat::Row &a,
+                         const BitAdjmat::Row &b) noexcept;
+
+/**
+ * Number of columns set in row a but not in row b.
+ */
+std::size_t popcount_andnot(const BitAdjmat::Row &a,
+                            const BitAdjmat::Row &b) noexcept;
+
+/**
+ * Writes mat to filename as an n x n numpy bool array or, if packed, as the
+ * n x ceil(n/8) uint8 array that np.packbits(a, axis=1, bitorder='little')
+ * gives, 8 times smaller. Rows are streamed, so no copy of the whole matrix
+ * is made.
+ * @throws std::runtime_error if the file cannot be written
+ */
+void save_npy(const std::string &filename, const BitAdjmat &mat,
+              bool packed = false);
+
+/**
+ * Adds mat to an npz archive as the array name, in the layouts of save_npy.
+ */
+void add_npz(NpzWriter &npz, const std::string &name, const BitAdjmat &mat,
+             bool packed = false);
+
+/**
+ * The BitAdjmat of an array written by save_npy: an n x n bool array, or a
+ * packed n x ceil(n/8) uint8 one.
+ * @throws std::runtime_error if the array has another dtype or shape, or is
+ * not symmetric
+ */
+BitAdjmat bitadjmat_from_npy(const NpyArray &array);
+
 // ==========================================
 // =========== Implementation ===============
 // ==========================================
@@ -305,12 +475,11 @@ public:
 
 inline BitAdjmat::edge_iterator::edge_iterator(
     std::size_t num_uint64_per_row,
-    std::vector<uint64_t>::const_iterator finish,
-    std::size_t index_of_uint64_in_row, std::size_t row_index,
-    std::vector<uint64_t>::const_iterator it) noexcept
+    word_iterator finish, std::size_t index_of_uint64_in_row,
+    std::size_t row_index, word_iterator it) noexcept
     : num_uint64_per_row{num_uint64_per_row}, finish{finish},
       index_of_uint64_in_row{index_of_uint64_in_row}, row_index{row_index},
-      it{it}, uint64_copy{*it} {
+      it{it}, uint64_copy{it != finish ? *it : 0} {
 
   if (uint64_copy == 0) {
     ++*this;
@@ -323,7 +492,7 @@ inline BitAdjmat::edge_iterator::edge_iterator(
 inline BitAdjmat::edge_iterator &
 BitAdjmat::edge_iterator::operator++() noexcept {
 
-  uint64_copy &= ~(1ULL << std::countr_zero(uint64_copy));
+  uint64_copy &= uint64_copy - 1;
 
   while (uint64_copy == 0 && it != finish) {
 
@@ -410,14 +579,13 @@ BitAdjmat::edge_range_proxy::end() const noexcept {
 }
 
 // =========== BitAdjmat::Row::const_iterator ===========
-inline BitAdjmat::Row::row_iterator::row_iterator(
-    std::vector<uint64_t>::const_iterator it,
-    std::vector<uint64_t>::const_iterator end) noexcept
-    : it_{it}, end_{end}, current_{*it_} {
+inline BitAdjmat::Row::row_iterator::row_iterator(word_iterator it,
+                                                  word_iterator end) noexcept
+    : it_{it}, end_{end}, current_{it_ != end_ ? *it_ : 0} {
   while (current_ == 0 && it_ != end_) {
     ++it_;
     ++cumulative_;
-    current_ = *it_;
+    current_ = it_ != end_ ? *it_ : 0;
   }
 }
 
@@ -428,7 +596,7 @@ BitAdjmat::Row::row_iterator::operator++() noexcept {
   while (current_ == 0 && it_ != end_) {
     ++it_;
     ++cumulative_;
-    current_ = *it_;
+    current_ = it_ != end_ ? *it_ : 0;
   }
   return *this;
 }
@@ -452,7 +620,8 @@ inline bool BitAdjmat::Row::row_iterator::operator!=(
 inline BitAdjmat::Row::Row(const BitAdjmat &parent,
                            std::size_t row_index) noexcept
     : start_{parent.matrix.data(row_index)},
-      num_vertices_{parent.num_vertices_} {}
+      num_vertices_{parent.num_vertices_},
+      num_words_{parent.num_uint64_per_row} {}
 
 inline bool BitAdjmat::Row::contains(std::size_t nb_index) const noexcept {
   return ((*(start_ + nb_index / N)) >> (nb_index % N)) & 1ULL;
@@ -462,6 +631,19 @@ inline std::size_t BitAdjmat::Row::size() const noexcept {
   return num_vertices_;
 }
 
+inline const std::uint64_t *BitAdjmat::Row::data() const noexcept {
+  return &*start_;
+}
+
+inline std::size_t BitAdjmat::Row::num_words() const noexcept {
+  return num_words_;
+}
+
+inline std::size_t
+BitAdjmat::Row::decode_into(std::span<std::uint32_t> out) const noexcept {
+  return bitops::decode_ones(data(), num_words(), 0, out);
+}
+
 inline BitAdjmat::Row::row_iterator BitAdjmat::Row::begin() const noexcept {
   return row_iterator(start_, start_ + (num_vertices_ + N - 1) / N);
 }
@@ -475,20 +657,52 @@ inline BitAdjmat::Row::row_iterator BitAdjmat::Row::end() const noexcept {
 
 inline BitAdjmat::BitAdjmat(std::size_t num_vertices_)
     : num_vertices_{num_vertices_},
-      num_uint64_per_row{num_vertices_ / N + (num_vertices_ % N != 0)},
+      num_uint64_per_row{row_stride(num_vertices_)},
       matrix{num_vertices_, num_uint64_per_row, 0} {}
 
-inline BitAdjmat::BitAdjmat(const Graph &g)
+inline BitAdjmat::BitAdjmat(const Graph &g, parallel::thread_pool *pool)
     : num_vertices_{boost::num_vertices(g)},
-      num_uint64_per_row{num_vertices_ / N + (num_vertices_ % N != 0)},
+      num_uint64_per_row{row_stride(num_vertices_)},
+      matrix{num_vertices_, num_uint64_per_row, 0} {
+
+  // Each row is only written by the task that owns it.
+  for_each_row_block(pool, [&](std::size_t i) {
+    for (auto j : boost::make_iterator_range(boost::adjacent_vertices(i, g))) {
+      matrix(i, j / N) |= 1ULL << (j % N);
+    }
+  });
+}
+
+inline BitAdjmat::BitAdjmat(
+    std::size_t n, std::span<const std::pair<std::size_t, std::size_t>> edges,
+    parallel::thread_pool *pool)
+    : num_vertices_{n}, num_uint64_per_row{row_stride(num_vertices_)},
       matrix{num_vertices_, num_uint64_per_row, 0} {
 
-  for (auto [ei, end] = boost::edges(g); ei != end; ++ei) {
-    uint64_t i = boost::source(*ei, g);
-    uint64_t j = boost::target(*ei, g);
-    this->set(i, j);
-    this->set(j, i);
+  // Counting sort of both arcs of every edge by row.
+  std::vector<std::size_t> offsets(n + 1, 0);
+  for (auto [u, v] : edges) {
+    if (u >= n || v >= n) {
+      throw std::out_of_range("BitAdjmat: edge endpoint out of range");
+    }
+    ++offsets[u + 1];
+    ++offsets[v + 1];
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    offsets[i + 1] += offsets[i];
   }
+  std::vector<std::size_t> targets(offsets[n]);
+  std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+  for (auto [u, v] : edges) {
+    targets[next[u]++] = v;
+    targets[next[v]++] = u;
+  }
+
+  for_each_row_block(pool, [&](std::size_t i) {
+    for (std::size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+      matrix(i, targets[k] / N) |= 1ULL << (targets[k] % N);
+    }
+  });
 }
 
 inline BitAdjmat::Row BitAdjmat::operator[](std::size_t row_index) noexcept {
@@ -501,29 +715,37 @@ BitAdjmat::operator[](std::size_t row_index) const noexcept {
 }
 
 inline Graph BitAdjmat::to_graph() const {
-  Graph g;
-  for (std::size_t i = 0; i < num_vertices_; ++i) {
-    boost::add_vertex(g);
-  }
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> edges;
+  edges.reserve(count_ones() / 2 + 1);
+  decode_edges(edges);
+  std::erase_if(edges, [](const auto &e) { return e.first == e.second; });
+  return detail::graph_from_edges(num_vertices_, edges);
+}
+
+inline std::uint64_t *BitAdjmat::word_data() noexcept {
+  return num_vertices_ == 0 ? nullptr : &matrix(0, 0);
+}
+
+inline const std::uint64_t *BitAdjmat::word_data() const noexcept {
+  return num_vertices_ == 0 ? nullptr : &matrix(0, 0);
+}
+
+inline std::size_t BitAdjmat::num_words() const noexcept {
+  return num_vertices_ * num_uint64_per_row;
+}
 
+inline void BitAdjmat::clear_padding() noexcept {
+  std::size_t used = (num_vertices_ + N - 1) / N;
+  uint64_t mask =
+      num_vertices_ % N == 0 ? ~0ULL : (1ULL << (num_vertices_ % N)) - 1;
   for (std::size_t i = 0; i < num_vertices_; ++i) {
-    for (std::size_t j = i + 1; j < num_vertices_; ++j) {
-      if (get(i, j)) {
-        boost::add_edge(i, j, g);
-      }
-    }
+    matrix(i, used - 1) &= mask;
+    std::fill(&matrix(i, 0) + used, &matrix(i, 0) + num_uint64_per_row, 0);
   }
-  return g;
 }
 
 inline std::size_t BitAdjmat::count_ones() const noexcept {
-  std::size_t count = 0;
-  for (std::size_t i = 0; i < num_vertices_; ++i) {
-    for (std::size_t j = 0; j < num_uint64_per_row; ++j) {
-      count += std::popcount(matrix(i, j));
-    }
-  }
-  return count;
+  return bitops::popcount(word_data(), num_words());
 }
 
 inline std::size_t BitAdjmat::num_edges() const noexcept {
@@ -531,11 +753,27 @@ inline std::size_t BitAdjmat::num_edges() const noexcept {
 }
 
 inline std::size_t BitAdjmat::degree(int v) const noexcept {
-  std::size_t count = 0;
-  for (std::size_t j = 0; j < num_uint64_per_row; ++j) {
-    count += std::popcount(matrix(v, j));
+  return bitops::popcount(&matrix(v, 0), num_uint64_per_row);
+}
+
+inline void BitAdjmat::decode_edges(
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> &out) const {
+  std::vector<std::uint32_t> neighbours(num_vertices_);
+  for (std::size_t i = 0; i < num_vertices_; ++i) {
+    // Only columns j >= i: mask the diagonal word, then decode the rest.
+    std::size_t w0 = i / N;
+    std::uint64_t first = matrix(i, w0) & (~0ULL << (i % N));
+    auto base = static_cast<std::uint32_t>(w0 * N);
+    std::span<std::uint32_t> buf(neighbours);
+    std::size_t count = bitops::decode_ones(&first, 1, base, buf);
+    count += bitops::decode_ones(&matrix(i, 0) + w0 + 1,
+                                 num_uint64_per_row - w0 - 1,
+                                 base + static_cast<std::uint32_t>(N),
+                                 buf.subspan(count));
+    for (std::size_t k = 0; k < count; ++k) {
+      out.emplace_back(static_cast<std::uint32_t>(i), neighbours[k]);
+    }
   }
-  return count;
 }
 
 inline std::size_t BitAdjmat::num_vertices() const noexcept {
@@ -579,12 +817,16 @@ BitAdjmat::swap(const std::vector<std::vector<std::size_t>> &matching) {
 
 inline BitAdjmat &BitAdjmat::permute(const std::vector<std::size_t> &perm) {
 
+  // Row i moves to row perm[i], with each of its set bits j moved to
+  // perm[j]. Rows are decoded in bulk, so this is O(E + n^2/64).
   BitAdjmat new_mat(num_vertices_);
+  std::vector<std::uint32_t> neighbours(num_vertices_);
   for (std::size_t i = 0; i < num_vertices_; ++i) {
-    for (std::size_t j = i + 1; j < num_vertices_; ++j) {
-      if (get(i, j)) {
-        new_mat.set(perm[i], perm[j]);
-      }
+    std::size_t count = (*this)[i].decode_into(neighbours);
+    std::size_t row = perm[i];
+    for (std::size_t k = 0; k < count; ++k) {
+      std::size_t j = perm[neighbours[k]];
+      new_mat.matrix(row, j / N) |= 1ULL << (j % N);
     }
   }
   *this = std::move(new_mat);
@@ -593,17 +835,11 @@ inline BitAdjmat &BitAdjmat::permute(const std::vector<std::size_t> &perm) {
 
 inline BitAdjmat &
 BitAdjmat::permute(const std::unordered_map<std::size_t, std::size_t> &perm) {
-
-  BitAdjmat new_mat(num_vertices_);
+  std::vector<std::size_t> dense(num_vertices_);
   for (std::size_t i = 0; i < num_vertices_; ++i) {
-    for (std::size_t j = i + 1; j < num_vertices_; ++j) {
-      if (get(i, j)) {
-        new_mat.set(perm.at(i), perm.at(j));
-      }
-    }
+    dense[i] = perm.at(i);
   }
-  *this = std::move(new_mat);
-  return *this;
+  return permute(dense);
 }
 
 inline BitAdjmat &BitAdjmat::swap_rows(std::size_t r1, std::size_t r2) {
@@ -629,24 +865,288 @@ inline BitAdjmat &BitAdjmat::swap_columns(std::size_t c1, std::size_t c2) {
 }
 
 inline BitAdjmat &BitAdjmat::toggle() noexcept {
-  for (std::size_t i = 0; i < num_vertices_; ++i) {
-    for (std::size_t j = 0; j < num_uint64_per_row; ++j) {
-      matrix(i, j) = ~matrix(i, j);
+  bitops::not_inplace(word_data(), num_words());
+  clear_padding();
+  return *this;
+}
+
+inline BitAdjmat BitAdjmat::matmul(const BitAdjmat &other,
+                                   parallel::thread_pool *pool) const {
+  if (num_vertices_ != other.num_vertices_) {
+    throw std::invalid_argument("BitAdjmat::matmul: size mismatch");
+  }
+
+  std::size_t n = num_vertices_;
+  std::size_t words = num_uint64_per_row;
+  BitAdjmat result(n);
+  if (n == 0) {
+    return result;
+  }
+
+  // Four Russians pays for its tables once rows have more than ~1 in 16 bits
+  // set; below that, walking the set bits does less work.
+  bool dense = count_ones() * 16 > n * n;
+  constexpr std::size_t group_bits = 8;
+  std::size_t rows_per_block = dense ? 256 : 64;
+  std::size_t num_blocks = (n + rows_per_block - 1) / rows_per_block;
+
+  auto multiply_block = [&](std::size_t block) {
+    std::size_t r0 = block * rows_per_block;
+    std::size_t r1 = std::min(n, r0 + rows_per_block);
+
+    if (!dense) {
+      for (std::size_t i = r0; i < r1; ++i) {
+        std::uint64_t *out = &result.matrix(i, 0);
+        for (std::size_t j : (*this)[i]) {
+          bitops::or_into(out, &other.matrix(j, 0), words);
+        }
+      }
+      return;
+    }
+
+    // table[m] = OR of the rows of 'other' in this 8-row group selected by m.
+    std::vector<std::uint64_t> table((1 << group_bits) * words);
+    for (std::size_t g0 = 0; g0 < n; g0 += group_bits) {
+      std::size_t group_rows = std::min(group_bits, n - g0);
+      std::size_t table_size = std::size_t{1} << group_rows;
+
+      std::fill(table.begin(), table.begin() + words, 0);
+      for (std::size_t m = 1; m < table_size; ++m) {
+        std::uint64_t *entry = &table[m * words];
+        const std::uint64_t *prev = &table[(m & (m - 1)) * words];
+        std::copy(prev, prev + words, entry);
+        bitops::or_into(entry, &other.matrix(g0 + std::countr_zero(m), 0),
+                        words);
+      }
+
+      std::size_t word = g0 / N, shift = g0 % N;
+      std::uint64_t mask = table_size - 1;
+      for (std::size_t i = r0; i < r1; ++i) {
+        std::size_t m = (matrix(i, word) >> shift) & mask;
+        if (m != 0) {
+          bitops::or_into(&result.matrix(i, 0), &table[m * words], words);
+        }
+      }
+    }
+  };
+
+  if (pool) {
+    pool->parallel_for(std::size_t{0}, num_blocks, 1, multiply_block);
+  } else {
+    for (std::size_t block = 0; block < num_blocks; ++block) {
+      multiply_block(block);
     }
   }
-  return *this;
+
+  return result;
+}
+
+template <typename F>
+void BitAdjmat::for_each_row_block(parallel::thread_pool *pool, F &&f) const {
+  constexpr std::size_t rows_per_block = 64;
+  std::size_t num_blocks = (num_vertices_ + rows_per_block - 1) / rows_per_block;
+  auto run_block = [&](std::size_t block) {
+    std::size_t r0 = block * rows_per_block;
+    std::size_t r1 = std::min(num_vertices_, r0 + rows_per_block);
+    for (std::size_t i = r0; i < r1; ++i) {
+      f(i);
+    }
+  };
+  if (pool) {
+    pool->parallel_for(std::size_t{0}, num_blocks, 1, run_block);
+  } else {
+    for (std::size_t block = 0; block < num_blocks; ++block) {
+      run_block(block);
+    }
+  }
+}
+
+inline std::size_t
+BitAdjmat::common_neighbors_count(std::size_t i, std::size_t j) const noexcept {
+  std::size_t count =
+      bitops::popcount_and(&matrix(i, 0), &matrix(j, 0), num_uint64_per_row);
+  // A self-loop on i makes i look like a neighbour of itself, and likewise j.
+  count -= get(i, i) && get(j, i);
+  if (i != j) {
+    count -= get(j, j) && get(i, j);
+  }
+  return count;
 }
 
-inline BitAdjmat BitAdjmat::matmul(const BitAdjmat &other) const noexcept {
-  BitAdjmat result(num_vertices_);
+inline std::size_t BitAdjmat::triangle_count(parallel::thread_pool *pool) const {
+  std::vector<std::size_t> per_row(num_vertices_, 0);
+  for_each_row_block(pool, [&](std::size_t i) {
+    const std::uint64_t *ri = &matrix(i, 0);
+    std::size_t count = 0;
+    for (std::size_t j : (*this)[i]) {
+      if (j <= i) {
+        continue;
+      }
+      // Common neighbours k > j: mask the word holding j, then the rest.
+      const std::uint64_t *rj = &matrix(j, 0);
+      std::size_t w = j / N;
+      std::uint64_t above = (~0ULL << (j % N)) << 1;
+      count += std::popcount(ri[w] & rj[w] & above);
+      count += bitops::popcount_and(ri + w + 1, rj + w + 1,
+                                    num_uint64_per_row - w - 1);
+    }
+    per_row[i] = count;
+  });
+
+  std::size_t total = 0;
+  for (std::size_t c : per_row) {
+    total += c;
+  }
+  return total;
+}
+
+inline std::vector<std::size_t>
+BitAdjmat::edge_common_neighbors(parallel::thread_pool *pool) const {
+  // offsets[i] = number of edges (i', j) with i' < i and i' < j.
+  std::vector<std::size_t> offsets(num_vertices_ + 1, 0);
   for (std::size_t i = 0; i < num_vertices_; ++i) {
-    for (std::size_t j = 0; j < num_vertices_; ++j) {
-      for (std::size_t k = 0; k < num_uint64_per_row; ++k) {
-        result.matrix(i, k) |= matrix(i, k) & other.matrix(j, k);
+    std::size_t w = i / N;
+    std::uint64_t above = (~0ULL << (i % N)) << 1;
+    offsets[i + 1] = offsets[i] + std::popcount(matrix(i, w) & above) +
+                     bitops::popcount(&matrix(i, 0) + w + 1,
+                                      num_uint64_per_row - w - 1);
+  }
+
+  std::vector<std::size_t> counts(offsets.back());
+  for_each_row_block(pool, [&](std::size_t i) {
+    std::size_t e = offsets[i];
+    for (std::size_t j : (*this)[i]) {
+      if (j > i) {
+        counts[e++] = common_neighbors_count(i, j);
       }
     }
+  });
+  return counts;
+}
+
+inline std::vector<std::vector<std::size_t>>
+BitAdjmat::maximal_cliques(std::size_t min_size,
+                           parallel::thread_pool *pool) const {
+  std::size_t words = num_uint64_per_row;
+  std::vector<std::vector<std::vector<std::size_t>>> per_vertex(num_vertices_);
+
+  // Cliques whose smallest vertex is v: P = neighbours above v, X =
+  // neighbours below v.
+  auto search_from = [&](std::size_t v) {
+    std::vector<std::uint64_t> scratch(3 * words);
+    std::uint64_t *p = scratch.data(), *x = p + words;
+    const std::uint64_t *row = &matrix(v, 0);
+    std::size_t w = v / N;
+    std::uint64_t above = (~0ULL << (v % N)) << 1;
+    std::uint64_t below = (1ULL << (v % N)) - 1;
+    for (std::size_t k = 0; k < words; ++k) {
+      p[k] = k > w ? row[k] : 0;
+      x[k] = k < w ? row[k] : 0;
+    }
+    p[w] = row[w] & above;
+    x[w] = row[w] & below;
+
+    std::vector<std::size_t> clique{v};
+    bron_kerbosch(clique, scratch, 0, min_size, per_vertex[v]);
+  };
+
+  if (pool) {
+    pool->parallel_for(std::size_t{0}, num_vertices_, 1, search_from);
+  } else {
+    for (std::size_t v = 0; v < num_vertices_; ++v) {
+      search_from(v);
+    }
+  }
+
+  std::vector<std::vector<std::size_t>> cliques;
+  for (auto &found : per_vertex) {
+    for (auto &clique : found) {
+      cliques.push_back(std::move(clique));
+    }
+  }
+  return cliques;
+}
+
+inline void
+BitAdjmat::bron_kerbosch(std::vector<std::size_t> &clique,
+                         std::vector<std::uint64_t> &scratch, std::size_t depth,
+                         std::size_t min_size,
+                         std::vector<std::vector<std::size_t>> &out) const {
+  std::size_t words = num_uint64_per_row;
+  std::size_t level = 3 * words * depth;
+  // The next level is written below; make room before taking pointers.
+  if (scratch.size() < level + 6 * words) {
+    scratch.resize(level + 6 * words);
+  }
+  std::uint64_t *p = scratch.data() + level;
+  std::uint64_t *x = p + words;
+  std::uint64_t *candidates = x + words;
+  std::size_t candidates_offset = level + 2 * words;
+
+  bool p_empty = true, x_empty = true;
+  for (std::size_t k = 0; k < words; ++k) {
+    p_empty &= p[k] == 0;
+    x_empty &= x[k] == 0;
+  }
+  if (p_empty) {
+    if (x_empty && clique.size() >= min_size) {
+      std::vector<std::size_t> sorted = clique;
+      std::sort(sorted.begin(), sorted.end());
+      out.push_back(std::move(sorted));
+    }
+    return;
+  }
+
+  // Pivot: the vertex of P | X with the most neighbours in P.
+  std::size_t pivot = 0, best = 0;
+  bool have_pivot = false;
+  for (std::size_t k = 0; k < words; ++k) {
+    for (std::uint64_t m = p[k] | x[k]; m; m &= m - 1) {
+      std::size_t u = k * N + std::countr_zero(m);
+      std::size_t c = bitops::popcount_and(p, &matrix(u, 0), words);
+      if (!have_pivot || c > best) {
+        pivot = u;
+        best = c;
+        have_pivot = true;
+      }
+    }
+  }
+
+  const std::uint64_t *pivot_row = &matrix(pivot, 0);
+  for (std::size_t k = 0; k < words; ++k) {
+    candidates[k] = p[k] & ~pivot_row[k];
+  }
+  // A self-loop must not hide the pivot itself.
+  candidates[pivot / N] |= p[pivot / N] & (1ULL << (pivot % N));
+
+  for (std::size_t k = 0; k < words; ++k) {
+    for (std::uint64_t m = scratch[candidates_offset + k]; m; m &= m - 1) {
+      std::size_t v = k * N + std::countr_zero(m);
+      std::uint64_t bit = 1ULL << (v % N);
+
+      // Pointers are re-derived, since the recursion may grow scratch.
+      std::uint64_t *cur_p = scratch.data() + level;
+      std::uint64_t *cur_x = cur_p + words;
+      std::uint64_t *next_p = cur_x + 2 * words;
+      std::uint64_t *next_x = next_p + words;
+      const std::uint64_t *row = &matrix(v, 0);
+      for (std::size_t t = 0; t < words; ++t) {
+        next_p[t] = cur_p[t] & row[t];
+        next_x[t] = cur_x[t] & row[t];
+      }
+      next_p[k] &= ~bit;
+      next_x[k] &= ~bit;
+
+      clique.push_back(v);
+      bron_kerbosch(clique, scratch, depth + 1, min_size, out);
+      clique.pop_back();
+
+      cur_p = scratch.data() + level;
+      cur_x = cur_p + words;
+      cur_p[k] &= ~bit;
+      cur_x[k] |= bit;
+    }
   }
-  return result;
 }
 
 inline BitAdjmat BitAdjmat::operator~() const noexcept {
@@ -656,29 +1156,17 @@ inline BitAdjmat BitAdjmat::operator~() const noexcept {
 }
 
 inline BitAdjmat &BitAdjmat::operator^=(const BitAdjmat &other) noexcept {
-  for (std::size_t i = 0; i < num_vertices_; ++i) {
-    for (std::size_t j = 0; j < num_uint64_per_row; ++j) {
-      matrix(i, j) ^= other.matrix(i, j);
-    }
-  }
+  bitops::xor_into(word_data(), other.word_data(), num_words());
   return *this;
 }
 
 inline BitAdjmat &BitAdjmat::operator&=(const BitAdjmat &other) noexcept {
-  for (std::size_t i = 0; i < num_vertices_; ++i) {
-    for (std::size_t j = 0; j < num_uint64_per_row; ++j) {
-      matrix(i, j) &= other.matrix(i, j);
-    }
-  }
+  bitops::and_into(word_data(), other.word_data(), num_words());
   return *this;
 }
 
 inline BitAdjmat &BitAdjmat::operator|=(const BitAdjmat &other) noexcept {
-  for (std::size_t i = 0; i < num_vertices_; ++i) {
-    for (std::size_t j = 0; j < num_uint64_per_row; ++j) {
-      matrix(i, j) |= other.matrix(i, j);
-    }
-  }
+  bitops::or_into(word_data(), other.word_data(), num_words());
   return *this;
 }
 
@@ -723,6 +1211,124 @@ inline void BitAdjmat::set(const std::pair<std::size_t, std::size_t> &e,
   this->set(e.first, e.second, val);
 }
 
+inline BitAdjmat &BitAdjmat::andnot_assign(const BitAdjmat &other) noexcept {
+  bitops::andnot_into(word_data(), other.word_data(), num_words());
+  return *this;
+}
+
+inline std::size_t popcount_and(const BitAdjmat::Row &a,
+                                const BitAdjmat::Row &b) noexcept {
+  return bitops::popcount_and(a.data(), b.data(), a.num_words());
+}
+
+inline std::size_t popcount_andnot(const BitAdjmat::Row &a,
+                                   const BitAdjmat::Row &b) noexcept {
+  return bitops::popcount_andnot(a.data(), b.data(), a.num_words());
+}
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Calls emit with each row of mat as a span of T: one bool per entry,
+ * or one uint8_t per 8 entries, the first in the lowest bit.
+ */
+template <typename T, typename F>
+void for_each_bitadjmat_npy_row(const BitAdjmat &mat, F &&emit) {
+  const std::size_t n = mat.num_vertices();
+  const std::size_t width = std::is_same_v<T, bool> ? n : (n + 7) / 8;
+  auto row = std::make_unique<T[]>(width);
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint64_t *words = mat[i].data();
+    for (std::size_t k = 0; k < width; ++k) {
+      if constexpr (std::is_same_v<T, bool>) {
+        row[k] = (words[k / 64] >> (k % 64)) & 1;
+      } else {
+        row[k] = static_cast<T>(words[k / 8] >> (8 * (k % 8)));
+      }
+    }
+    emit(std::span<const T>(row.get(), width));
+  }
+}
+
+} // namespace detail
+
+inline void save_npy(const std::string &filename, const BitAdjmat &mat,
+                     bool packed) {
+  const std::size_t n = mat.num_vertices();
+  if (packed) {
+    NpyWriter<std::uint8_t> out(filename, {n, (n + 7) / 8});
+    detail::for_each_bitadjmat_npy_row<std::uint8_t>(
+        mat, [&](std::span<const std::uint8_t> row) { out.write(row); });
+    out.close();
+  } else {
+    NpyWriter<bool> out(filename, {n, n});
+    detail::for_each_bitadjmat_npy_row<bool>(
+        mat, [&](std::span<const bool> row) { out.write(row); });
+    out.close();
+  }
+}
+
+inline void add_npz(NpzWriter &npz, const std::string &name,
+                    const BitAdjmat &mat, bool packed) {
+  const std::size_t n = mat.num_vertices();
+  if (packed) {
+    npz.begin_array<std::uint8_t>(name, {n, (n + 7) / 8});
+    detail::for_each_bitadjmat_npy_row<std::uint8_t>(
+        mat, [&](std::span<const std::uint8_t> row) { npz.write(row); });
+  } else {
+    npz.begin_array<bool>(name, {n, n});
+    detail::for_each_bitadjmat_npy_row<bool>(
+        mat, [&](std::span<const bool> row) { npz.write(row); });
+  }
+  npz.end_array();
+}
+
+inline BitAdjmat bitadjmat_from_npy(const NpyArray &array) {
+  const auto &shape = array.shape();
+  if (array.fortran_order() || shape.size() != 2) {
+    throw std::runtime_error("BitAdjmat npy array is not a C-ordered matrix");
+  }
+  const std::size_t n = shape[0];
+  const bool packed = array.descr() == npy_descr<std::uint8_t>();
+  if (!packed && array.descr() != npy_descr<bool>()) {
+    throw std::runtime_error("BitAdjmat npy dtype " + array.descr() +
+                             " is neither |b1 nor |u1");
+  }
+  const std::size_t width = packed ? (n + 7) / 8 : n;
+  if (shape[1] != width) {
+    throw std::runtime_error("BitAdjmat npy array has the wrong shape");
+  }
+
+  // Bools are read as bytes, since only 0 and 1 are valid bool values.
+  BitAdjmat mat(n);
+  std::size_t ones = 0;
+  auto bytes = array.bytes();
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t k = 0; k < width; ++k) {
+      auto byte = static_cast<unsigned>(bytes[i * width + k]);
+      if (!packed) {
+        byte = byte != 0;
+      }
+      for (; byte != 0; byte &= byte - 1) {
+        std::size_t j = packed ? 8 * k + std::countr_zero(byte) : k;
+        if (j >= n) {
+          throw std::runtime_error("BitAdjmat npy array has bits past "
+                                   "the last column");
+        }
+        mat.set(i, j);
+        ++ones;
+      }
+    }
+  }
+  // set() sets (j, i) as well, which only adds ones if the array was not
+  // symmetric.
+  if (mat.count_ones() != ones) {
+    throw std::runtime_error("BitAdjmat npy array is not symmetric");
+  }
+  return mat;
+}
+
 inline BitAdjmat operator&(const BitAdjmat &x, const BitAdjmat &y) noexcept {
   BitAdjmat result{x};
   result &= y;
@@ -743,17 +1349,11 @@ inline BitAdjmat operator^(const BitAdjmat &x, const BitAdjmat &y) noexcept {
 
 inline std::ostream &BitAdjmat::print_row(int row,
                                           std::ostream &os) const noexcept {
-  int d = row / N;
-
   for (std::size_t i = 0; i < num_vertices_; ++i) {
     if (i != 0) {
       os << ' ';
     }
-    if ((matrix(row, d) >> i) & 1ULL) {
-      os << 1;
-    } else {
-      os << 0;
-    }
+    os << ((matrix(row, i / N) >> (i % N)) & 1ULL);
   }
   return os;
 }
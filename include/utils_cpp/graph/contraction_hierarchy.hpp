@@ -0,0 +1,763 @@
+/**********************************************************************
+ * @brief Contraction hierarchies for fast shortest-path queries on large
+ * static graphs.
+ * @details Preprocessing contracts the vertices one by one in order of
+ *importance, adding a shortcut u->w whenever removing v would destroy the only
+ *shortest path u->v->w. A query is then a bidirectional Dijkstra that only
+ *follows edges towards more important vertices, which settles a handful of
+ *vertices instead of a large part of the graph. The hierarchy can be saved to
+ *and loaded from disk, so preprocessing is paid once per topology.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/graph.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace utils {
+namespace gl {
+
+/**
+ * @brief A contraction hierarchy of a CsrGraph (directed or undirected) with
+ * non-negative weights.
+ *
+ * @details Every edge of the hierarchy, original or shortcut, is stored once
+ * as an arc from its lower-ranked to its higher-ranked endpoint: in the
+ * upward graph if it leaves the lower endpoint, in the downward graph if it
+ * enters it. Shortcuts remember the two arcs they replace, so paths can be
+ * unpacked into original vertices.
+ */
+template <typename WeightType = std::size_t>
+class ContractionHierarchy {
+public:
+  static constexpr WeightType unreachable =
+      std::numeric_limits<WeightType>::max();
+
+  /**
+   * @brief An arc of the hierarchy. For a shortcut, first and second are the
+   * ids of the arcs from -> via and via -> to; for an original edge both
+   * are npos.
+   */
+  struct Arc {
+    std::size_t from;
+    std::size_t to;
+    WeightType weight;
+    std::size_t first;
+    std::size_t second;
+  };
+
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  ContractionHierarchy() = default;
+
+  /**
+   * @brief Builds the hierarchy. The initial vertex priorities, which need a
+   * witness search around every vertex, are computed on 'pool' if given.
+   */
+  explicit ContractionHierarchy(const CsrGraph<WeightType> &g,
+                                parallel::thread_pool *pool = nullptr);
+
+  /**
+   * @brief Hierarchy of a Graph or DiGraph with the given weights.
+   */
+  template <typename GraphType>
+  ContractionHierarchy(const GraphType &g,
+                       const EdgeMap<WeightType, GraphType> &weights,
+                       parallel::thread_pool *pool = nullptr)
+      : ContractionHierarchy(CsrGraph(g, weights), pool) {}
+
+  std::size_t num_vertices() const noexcept { return rank_.size(); }
+
+  /**
+   * @brief Number of arcs, including shortcuts.
+   */
+  std::size_t num_arcs() const noexcept {
+    return up_.targets.size() + down_.targets.size();
+  }
+
+  std::size_t num_shortcuts() const noexcept { return num_shortcuts_; }
+
+  /**
+   * @brief Position of v in the contraction order. Higher is more important.
+   */
+  std::size_t rank(std::size_t v) const { return rank_[v]; }
+
+  /**
+   * @brief Shortest distance from source to target, or unreachable. Use
+   * path() rather than ws.path() for the route.
+   */
+  WeightType distance(std::size_t source, std::size_t target,
+                      BidirectionalWorkspace<WeightType> &ws) const;
+
+  WeightType distance(std::size_t source, std::size_t target) const {
+    BidirectionalWorkspace<WeightType> ws;
+    return distance(source, target, ws);
+  }
+
+  /**
+   * @brief A shortest path from source to target in the original graph, both
+   * included. Empty if target is unreachable.
+   */
+  std::vector<std::size_t> path(std::size_t source, std::size_t target,
+                                BidirectionalWorkspace<WeightType> &ws) const;
+
+  std::vector<std::size_t> path(std::size_t source, std::size_t target) const {
+    BidirectionalWorkspace<WeightType> ws;
+    return path(source, target, ws);
+  }
+
+  /**
+   * @brief Writes the hierarchy in a binary format, tied to the size of
+   * WeightType and std::size_t of the machine that wrote it.
+   */
+  void save(std::ostream &os) const;
+  void save(const std::string &filename) const;
+
+  /**
+   * @throws std::runtime_error if the stream does not hold a hierarchy saved
+   * with the same WeightType, or if it is truncated or inconsistent.
+   */
+  static ContractionHierarchy load(std::istream &is);
+  static ContractionHierarchy load(const std::string &filename);
+
+private:
+  // Arcs grouped by their lower-ranked endpoint.
+  struct Adjacency {
+    std::vector<std::size_t> offsets{0};
+    std::vector<std::size_t> targets;
+    std::vector<WeightType> weights;
+    std::vector<std::size_t> ids;
+  };
+
+  std::vector<std::size_t> rank_;
+  std::vector<Arc> arcs_;   // every arc ever created, indexed by id
+  std::vector<bool> alive_; // false for arcs replaced by a shorter shortcut
+  std::size_t num_shortcuts_ = 0;
+  Adjacency up_;   // u -> w with rank(u) < rank(w), stored at u
+  Adjacency down_; // w -> u with rank(w) > rank(u), stored at u
+
+  void build_search_graphs();
+
+  void unpack(std::size_t id, std::vector<std::size_t> &out) const;
+};
+
+template <typename GraphType, typename WeightType, typename Hash,
+          typename KeyEqual>
+ContractionHierarchy(
+    const GraphType &,
+    const std::unordered_map<Edge<GraphType>, WeightType, Hash, KeyEqual> &)
+    -> ContractionHierarchy<WeightType>;
+
+template <typename GraphType, typename WeightType, typename Hash,
+          typename KeyEqual>
+ContractionHierarchy(
+    const GraphType &,
+    const std::unordered_map<Edge<GraphType>, WeightType, Hash, KeyEqual> &,
+    parallel::thread_pool *) -> ContractionHierarchy<WeightType>;
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief The shrinking graph that vertices are contracted out of.
+ */
+template <typename WeightType>
+class ChBuilder {
+public:
+  using Arc = typename ContractionHierarchy<WeightType>::Arc;
+  static constexpr std::size_t npos = ContractionHierarchy<WeightType>::npos;
+
+  // Witness searches settle at most this many vertices. Giving up early only
+  // adds unnecessary (but correct) shortcuts.
+  static constexpr std::size_t witness_settle_limit = 500;
+
+  struct Link {
+    std::size_t other;
+    WeightType weight;
+    std::size_t id;
+  };
+
+  struct Shortcut {
+    std::size_t from;
+    std::size_t to;
+    WeightType weight;
+    std::size_t first;
+    std::size_t second;
+  };
+
+  std::vector<std::vector<Link>> out, in;
+  std::vector<bool> contracted;
+  std::vector<std::size_t> contracted_neighbors;
+  std::vector<Arc> arcs;
+  std::vector<bool> alive;
+
+  explicit ChBuilder(const CsrGraph<WeightType> &g);
+
+  /**
+   * @brief The shortcuts needed to contract v.
+   */
+  void shortcuts(std::size_t v, PathfindingWorkspace<WeightType> &ws,
+                 std::vector<Shortcut> &result) const;
+
+  long long priority(std::size_t v, PathfindingWorkspace<WeightType> &ws,
+                     std::vector<Shortcut> &scratch) const;
+
+  /**
+   * @brief Contracts v, returning the number of shortcuts added.
+   */
+  std::size_t contract(std::size_t v, PathfindingWorkspace<WeightType> &ws,
+                       std::vector<Shortcut> &scratch);
+
+private:
+  void add_arc(std::size_t from, std::size_t to, WeightType weight,
+               std::size_t first, std::size_t second);
+
+  void witness_search(std::size_t source, std::size_t excluded,
+                      WeightType bound,
+                      PathfindingWorkspace<WeightType> &ws) const;
+};
+
+template <typename WeightType>
+ChBuilder<WeightType>::ChBuilder(const CsrGraph<WeightType> &g)
+    : out(g.num_vertices()), in(g.num_vertices()),
+      contracted(g.num_vertices(), false),
+      contracted_neighbors(g.num_vertices(), 0) {
+  for (std::size_t u = 0; u < g.num_vertices(); ++u) {
+    auto nbs = g.neighbors(u);
+    auto wts = g.weights(u);
+    for (std::size_t i = 0; i < nbs.size(); ++i) {
+      if (nbs[i] != u) {
+        add_arc(u, nbs[i], wts.empty() ? WeightType(1) : wts[i], npos, npos);
+      }
+    }
+  }
+}
+
+template <typename WeightType>
+void ChBuilder<WeightType>::add_arc(std::size_t from, std::size_t to,
+                                    WeightType weight, std::size_t first,
+                                    std::size_t second) {
+  // Parallel arcs are merged, keeping the shortest.
+  for (auto &link : out[from]) {
+    if (link.other == to) {
+      if (weight >= link.weight) {
+        return;
+      }
+      alive[link.id] = false;
+      link.weight = weight;
+      link.id = arcs.size();
+      for (auto &back : in[to]) {
+        if (back.other == from) {
+          back.weight = weight;
+          back.id = arcs.size();
+        }
+      }
+      arcs.push_back({from, to, weight, first, second});
+      alive.push_back(true);
+      return;
+    }
+  }
+
+  out[from].push_back({to, weight, arcs.size()});
+  in[to].push_back({from, weight, arcs.size()});
+  arcs.push_back({from, to, weight, first, second});
+  alive.push_back(true);
+}
+
+template <typename WeightType>
+void ChBuilder<WeightType>::witness_search(
+    std::size_t source, std::size_t excluded, WeightType bound,
+    PathfindingWorkspace<WeightType> &ws) const {
+  ws.reset(out.size());
+  ws.label(source, 0, source);
+  detail::heap_push(ws, WeightType(0), source);
+
+  std::size_t settled = 0;
+  while (!ws.heap.empty() && settled < witness_settle_limit) {
+    auto [d, u] = detail::heap_pop(ws);
+    if (d > ws.distance(u)) {
+      continue; // stale entry
+    }
+    if (d > bound) {
+      break;
+    }
+    ++settled;
+    for (const auto &link : out[u]) {
+      if (link.other == excluded || contracted[link.other]) {
+        continue;
+      }
+      WeightType nd = d + link.weight;
+      if (nd < ws.distance(link.other)) {
+        ws.label(link.other, nd, u);
+        detail::heap_push(ws, nd, link.other);
+      }
+    }
+  }
+}
+
+template <typename WeightType>
+void ChBuilder<WeightType>::shortcuts(std::size_t v,
+                                      PathfindingWorkspace<WeightType> &ws,
+                                      std::vector<Shortcut> &result) const {
+  result.clear();
+
+  WeightType max_out = 0;
+  for (const auto &link : out[v]) {
+    if (!contracted[link.other]) {
+      max_out = std::max(max_out, link.weight);
+    }
+  }
+
+  for (const auto &in_link : in[v]) {
+    std::size_t u = in_link.other;
+    if (contracted[u]) {
+      continue;
+    }
+    witness_search(u, v, in_link.weight + max_out, ws);
+
+    for (const auto &out_link : out[v]) {
+      std::size_t w = out_link.other;
+      if (w == u || contracted[w]) {
+        continue;
+      }
+      WeightType via = in_link.weight + out_link.weight;
+      if (ws.distance(w) > via) {
+        result.push_back({u, w, via, in_link.id, out_link.id});
+      }
+    }
+  }
+}
+
+template <typename WeightType>
+long long
+ChBuilder<WeightType>::priority(std::size_t v,
+                                PathfindingWorkspace<WeightType> &ws,
+                                std::vector<Shortcut> &scratch) const {
+  // Edge difference plus the number of contracted neighbors, which spreads
+  // the contraction evenly over the graph.
+  shortcuts(v, ws, scratch);
+  long long removed = 0;
+  for (const auto &link : out[v]) {
+    removed += !contracted[link.other];
+  }
+  for (const auto &link : in[v]) {
+    removed += !contracted[link.other];
+  }
+  return static_cast<long long>(scratch.size()) - removed +
+         static_cast<long long>(contracted_neighbors[v]);
+}
+
+template <typename WeightType>
+std::size_t ChBuilder<WeightType>::contract(
+    std::size_t v, PathfindingWorkspace<WeightType> &ws,
+    std::vector<Shortcut> &scratch) {
+  shortcuts(v, ws, scratch);
+  for (const auto &s : scratch) {
+    add_arc(s.from, s.to, s.weight, s.first, s.second);
+  }
+  contracted[v] = true;
+
+  // Drop the links to v, so later witness searches do not scan them.
+  auto drop = [v](std::vector<Link> &links) {
+    std::erase_if(links, [v](const Link &l) { return l.other == v; });
+  };
+  for (const auto &link : out[v]) {
+    drop(in[link.other]);
+    ++contracted_neighbors[link.other];
+  }
+  for (const auto &link : in[v]) {
+    drop(out[link.other]);
+    ++contracted_neighbors[link.other];
+  }
+  return scratch.size();
+}
+
+} // namespace detail
+
+template <typename WeightType>
+ContractionHierarchy<WeightType>::ContractionHierarchy(
+    const CsrGraph<WeightType> &g, parallel::thread_pool *pool) {
+  using Builder = detail::ChBuilder<WeightType>;
+
+  std::size_t n = g.num_vertices();
+  Builder builder(g);
+  std::size_t num_original = builder.arcs.size();
+
+  // Initial priorities: one simulated contraction per vertex, independent of
+  // each other, so they are spread over the pool.
+  std::vector<long long> priority(n);
+  auto run_chunk = [&](std::size_t first, std::size_t last) {
+    PathfindingWorkspace<WeightType> ws(n);
+    std::vector<typename Builder::Shortcut> scratch;
+    for (std::size_t v = first; v < last; ++v) {
+      priority[v] = builder.priority(v, ws, scratch);
+    }
+  };
+  if (pool && n > 1) {
+    std::size_t num_chunks = std::min(n, 4 * (pool->size() + 1));
+    std::size_t chunk = (n + num_chunks - 1) / num_chunks;
+    pool->parallel_for(std::size_t{0}, num_chunks, 1, [&](std::size_t c) {
+      run_chunk(std::min(c * chunk, n), std::min((c + 1) * chunk, n));
+    });
+  } else {
+    run_chunk(0, n);
+  }
+
+  // Lazy updates: a popped vertex is re-evaluated, and only contracted if it
+  // is still no worse than the next candidate.
+  using entry = std::pair<long long, std::size_t>;
+  std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+  for (std::size_t v = 0; v < n; ++v) {
+    queue.push({priority[v], v});
+  }
+
+  PathfindingWorkspace<WeightType> ws(n);
+  std::vector<typename Builder::Shortcut> scratch;
+  rank_.assign(n, 0);
+  std::size_t next_rank = 0;
+
+  while (!queue.empty()) {
+    auto [p, v] = queue.top();
+    queue.pop();
+    if (builder.contracted[v]) {
+      continue;
+    }
+    long long current = builder.priority(v, ws, scratch);
+    if (!queue.empty() && current > queue.top().first) {
+      queue.push({current, v});
+      continue;
+    }
+
+    builder.contract(v, ws, scratch);
+    rank_[v] = next_rank++;
+  }
+
+  arcs_ = std::move(builder.arcs);
+  alive_ = std::move(builder.alive);
+  num_shortcuts_ = 0;
+  for (std::size_t id = num_original; id < arcs_.size(); ++id) {
+    num_shortcuts_ += alive_[id];
+  }
+  build_search_graphs();
+}
+
+template <typename WeightType>
+void ContractionHierarchy<WeightType>::build_search_graphs() {
+  std::size_t n = rank_.size();
+
+  auto fill = [&](Adjacency &adj, bool upward) {
+    adj.offsets.assign(n + 1, 0);
+    auto lower = [&](const Arc &a) {
+      return rank_[a.from] < rank_[a.to] ? a.from : a.to;
+    };
+    auto belongs = [&](std::size_t id) {
+      const Arc &a = arcs_[id];
+      return alive_[id] && a.from != a.to &&
+             (rank_[a.from] < rank_[a.to]) == upward;
+    };
+
+    for (std::size_t id = 0; id < arcs_.size(); ++id) {
+      if (belongs(id)) {
+        ++adj.offsets[lower(arcs_[id]) + 1];
+      }
+    }
+    for (std::size_t v = 0; v < n; ++v) {
+      adj.offsets[v + 1] += adj.offsets[v];
+    }
+
+    std::size_t m = adj.offsets[n];
+    adj.targets.resize(m);
+    adj.weights.resize(m);
+    adj.ids.resize(m);
+    std::vector<std::size_t> next(adj.offsets.begin(), adj.offsets.end() - 1);
+    for (std::size_t id = 0; id < arcs_.size(); ++id) {
+      if (belongs(id)) {
+        const Arc &a = arcs_[id];
+        std::size_t lo = lower(a);
+        std::size_t pos = next[lo]++;
+        adj.targets[pos] = lo == a.from ? a.to : a.from;
+        adj.weights[pos] = a.weight;
+        adj.ids[pos] = id;
+      }
+    }
+  };
+
+  fill(up_, true);
+  fill(down_, false);
+}
+
+template <typename WeightType>
+WeightType ContractionHierarchy<WeightType>::distance(
+    std::size_t source, std::size_t target,
+    BidirectionalWorkspace<WeightType> &ws) const {
+  auto &fwd = ws.forward;
+  auto &bwd = ws.backward;
+  std::size_t n = num_vertices();
+  fwd.reset(n);
+  bwd.reset(n);
+  ws.found = false;
+
+  // Predecessors hold the id of the arc a vertex was reached by (npos for
+  // the endpoints), so that path() can unpack shortcuts. ws.path() does not
+  // understand them, which is why ws.found stays false.
+  fwd.label(source, 0, npos);
+  bwd.label(target, 0, npos);
+  detail::heap_push(fwd, WeightType(0), source);
+  detail::heap_push(bwd, WeightType(0), target);
+
+  WeightType best = unreachable;
+  auto step = [&](const Adjacency &adj, PathfindingWorkspace<WeightType> &self,
+                  const PathfindingWorkspace<WeightType> &other) {
+    auto [d, u] = detail::heap_pop(self);
+    if (d > self.distance(u)) {
+      return; // stale entry
+    }
+    if (other.reached(u) && d + other.distance(u) < best) {
+      best = d + other.distance(u);
+      ws.meeting = u;
+    }
+    for (std::size_t i = adj.offsets[u]; i < adj.offsets[u + 1]; ++i) {
+      WeightType nd = d + adj.weights[i];
+      std::size_t v = adj.targets[i];
+      if (nd < self.distance(v)) {
+        self.label(v, nd, adj.ids[i]);
+        detail::heap_push(self, nd, v);
+      }
+    }
+  };
+
+  // Unlike plain bidirectional Dijkstra, the searches cannot stop when they
+  // first meet: the meeting vertex is the highest-ranked one on the path. A
+  // direction is only done once its smallest key cannot beat 'best'.
+  while (true) {
+    bool fwd_live = !fwd.heap.empty() && fwd.heap.front().first < best;
+    bool bwd_live = !bwd.heap.empty() && bwd.heap.front().first < best;
+    if (!fwd_live && !bwd_live) {
+      break;
+    }
+    if (fwd_live && (!bwd_live || fwd.heap.size() <= bwd.heap.size())) {
+      step(up_, fwd, bwd);
+    } else {
+      step(down_, bwd, fwd);
+    }
+  }
+
+  return best;
+}
+
+template <typename WeightType>
+void ContractionHierarchy<WeightType>::unpack(
+    std::size_t id, std::vector<std::size_t> &out) const {
+  // Appends the vertices of arc id after its first vertex.
+  std::vector<std::size_t> stack{id};
+  while (!stack.empty()) {
+    const Arc &a = arcs_[stack.back()];
+    stack.pop_back();
+    if (a.first == npos) {
+      out.push_back(a.to);
+    } else {
+      stack.push_back(a.second);
+      stack.push_back(a.first);
+    }
+  }
+}
+
+template <typename WeightType>
+std::vector<std::size_t>
+ContractionHierarchy<WeightType>::path(
+    std::size_t source, std::size_t target,
+    BidirectionalWorkspace<WeightType> &ws) const {
+  if (distance(source, target, ws) == unreachable) {
+    return {};
+  }
+
+  std::vector<std::size_t> forward_arcs;
+  for (std::size_t v = ws.meeting; v != source;) {
+    std::size_t id = ws.forward.predecessor(v);
+    forward_arcs.push_back(id);
+    v = arcs_[id].from;
+  }
+
+  std::vector<std::size_t> result{source};
+  for (auto it = forward_arcs.rbegin(); it != forward_arcs.rend(); ++it) {
+    unpack(*it, result);
+  }
+  for (std::size_t v = ws.meeting; v != target;) {
+    std::size_t id = ws.backward.predecessor(v);
+    unpack(id, result);
+    v = arcs_[id].to;
+  }
+  return result;
+}
+
+namespace detail {
+
+inline constexpr char ch_magic[8] = {'U', 'T', 'C', 'H', 'v', '1', '\0', '\0'};
+
+template <typename T>
+void ch_write(std::ostream &os, const T &value) {
+  os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+void ch_read(std::istream &is, T &value) {
+  is.read(reinterpret_cast<char *>(&value), sizeof(T));
+  if (!is) {
+    throw std::runtime_error("ContractionHierarchy: truncated input");
+  }
+}
+
+} // namespace detail
+
+template <typename WeightType>
+void ContractionHierarchy<WeightType>::save(std::ostream &os) const {
+  static_assert(std::is_trivially_copyable_v<WeightType>);
+
+  os.write(detail::ch_magic, sizeof(detail::ch_magic));
+  detail::ch_write(os, std::uint64_t{sizeof(WeightType)});
+  detail::ch_write(os, std::uint64_t{rank_.size()});
+  detail::ch_write(os, std::uint64_t{arcs_.size()});
+  detail::ch_write(os, std::uint64_t{num_shortcuts_});
+  for (std::size_t r : rank_) {
+    detail::ch_write(os, std::uint64_t{r});
+  }
+  for (std::size_t id = 0; id < arcs_.size(); ++id) {
+    const Arc &a = arcs_[id];
+    detail::ch_write(os, std::uint64_t{a.from});
+    detail::ch_write(os, std::uint64_t{a.to});
+    detail::ch_write(os, a.weight);
+    detail::ch_write(os, std::uint64_t{a.first});
+    detail::ch_write(os, std::uint64_t{a.second});
+    detail::ch_write(os, std::uint8_t{alive_[id]});
+  }
+  if (!os) {
+    throw std::runtime_error("ContractionHierarchy: could not write");
+  }
+}
+
+template <typename WeightType>
+void ContractionHierarchy<WeightType>::save(const std::string &filename) const {
+  std::ofstream os(filename, std::ios_base::binary);
+  if (!os.is_open()) {
+    throw std::runtime_error("Could not open file");
+  }
+  save(os);
+}
+
+template <typename WeightType>
+ContractionHierarchy<WeightType>
+ContractionHierarchy<WeightType>::load(std::istream &is) {
+  char magic[sizeof(detail::ch_magic)];
+  is.read(magic, sizeof(magic));
+  if (!is || !std::equal(magic, magic + sizeof(magic), detail::ch_magic)) {
+    throw std::runtime_error("ContractionHierarchy: not a saved hierarchy");
+  }
+
+  std::uint64_t weight_size, n, m, shortcuts;
+  detail::ch_read(is, weight_size);
+  if (weight_size != sizeof(WeightType)) {
+    throw std::runtime_error("ContractionHierarchy: weight type mismatch");
+  }
+  detail::ch_read(is, n);
+  detail::ch_read(is, m);
+  detail::ch_read(is, shortcuts);
+  auto corrupt = [](const char *what) {
+    throw std::runtime_error(std::string("ContractionHierarchy: corrupt ") +
+                             what);
+  };
+  if (n >= npos || m >= npos || shortcuts > m) {
+    corrupt("header");
+  }
+
+  // The counts are not trusted with an allocation before the data they
+  // promise has actually been read.
+  constexpr std::uint64_t max_reserve = std::uint64_t{1} << 16;
+  ContractionHierarchy ch;
+  ch.num_shortcuts_ = shortcuts;
+  ch.rank_.reserve(std::min(n, max_reserve));
+  std::vector<bool> rank_seen;
+  rank_seen.reserve(std::min(n, max_reserve));
+  for (std::uint64_t v = 0; v < n; ++v) {
+    std::uint64_t value;
+    detail::ch_read(is, value);
+    ch.rank_.push_back(value);
+    rank_seen.push_back(false);
+  }
+  for (std::size_t r : ch.rank_) {
+    if (r >= n || rank_seen[r]) {
+      corrupt("ranks");
+    }
+    rank_seen[r] = true;
+  }
+
+  ch.arcs_.reserve(std::min(m, max_reserve));
+  ch.alive_.reserve(std::min(m, max_reserve));
+  std::size_t alive_shortcuts = 0;
+  for (std::size_t id = 0; id < m; ++id) {
+    std::uint64_t from, to, first, second;
+    WeightType weight;
+    std::uint8_t alive;
+    detail::ch_read(is, from);
+    detail::ch_read(is, to);
+    detail::ch_read(is, weight);
+    detail::ch_read(is, first);
+    detail::ch_read(is, second);
+    detail::ch_read(is, alive);
+    if (from >= n || to >= n || alive > 1 || !(weight >= WeightType(0))) {
+      corrupt("arc");
+    }
+    // A shortcut replaces two older arcs that meet at its middle vertex,
+    // which also keeps unpack() from looping.
+    if (first != npos || second != npos) {
+      if (first >= id || second >= id ||
+          ch.arcs_[first].from != from || ch.arcs_[second].to != to ||
+          ch.arcs_[first].to != ch.arcs_[second].from) {
+        corrupt("shortcut");
+      }
+      alive_shortcuts += alive;
+    }
+    ch.arcs_.push_back({from, to, weight, first, second});
+    ch.alive_.push_back(alive != 0);
+  }
+  if (alive_shortcuts != shortcuts) {
+    corrupt("shortcut count");
+  }
+
+  ch.build_search_graphs();
+  return ch;
+}
+
+template <typename WeightType>
+ContractionHierarchy<WeightType>
+ContractionHierarchy<WeightType>::load(const std::string &filename) {
+  std::ifstream is(filename, std::ios_base::binary);
+  if (!is.is_open()) {
+    throw std::runtime_error("Could not open file");
+  }
+  return load(is);
+}
+
+} // namespace gl
+} // namespace utils
@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include "utils_cpp/graph/bitadjmat.hpp"
 #include "utils_cpp/graph/graph.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/adjacency_matrix.hpp>
@@ -13,6 +15,9 @@
 
 #include <cstdint>
 #include <iostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace utils {
 namespace gl {
@@ -29,7 +34,8 @@ auto construct_boost_adjacency_matrix(const GraphType &graph)
                      boost::directed_tag>::value,
         boost::adjacency_matrix<boost::directedS>> {
 
-  std::vector<std::pair<int, int>> edge_pairs(boost::num_vertices(graph));
+  std::vector<std::pair<int, int>> edge_pairs;
+  edge_pairs.reserve(boost::num_edges(graph));
 
   auto [ei, end] = boost::edges(graph);
   for (auto it = ei; it != end; ++it) {
@@ -53,7 +59,8 @@ auto construct_boost_adjacency_matrix(const GraphType &graph)
                      boost::undirected_tag>::value,
         boost::adjacency_matrix<boost::undirectedS>> {
 
-  std::vector<std::pair<int, int>> edge_pairs(boost::num_vertices(graph));
+  std::vector<std::pair<int, int>> edge_pairs;
+  edge_pairs.reserve(boost::num_edges(graph));
 
   auto [ei, end] = boost::edges(graph);
   for (auto it = ei; it != end; ++it) {
@@ -114,6 +121,34 @@ auto construct_adjacency_matrix(const GraphType &graph) -> std::enable_if_t<
   return adjmat;
 }
 
+/**
+ * @brief Construct a BitAdjmat from an undirected graph, without going
+ * through a boost adjacency matrix. Rows are filled in parallel if a pool is
+ * given. O(E + n^2/64).
+ * @param graph The graph to construct the adjacency matrix from
+ * @param pool Optional thread pool
+ * @return The adjacency matrix
+ */
+template <typename GraphType>
+auto to_bitadjmat(const GraphType &graph, parallel::thread_pool *pool = nullptr)
+    -> std::enable_if_t<
+        std::is_same<typename boost::graph_traits<GraphType>::directed_category,
+                     boost::undirected_tag>::value,
+        BitAdjmat> {
+
+  if constexpr (std::is_same_v<GraphType, Graph>) {
+    return BitAdjmat(graph, pool);
+  } else {
+    std::vector<std::pair<std::size_t, std::size_t>> edges;
+    edges.reserve(boost::num_edges(graph));
+    auto [ei, end] = boost::edges(graph);
+    for (auto it = ei; it != end; ++it) {
+      edges.emplace_back(boost::source(*it, graph), boost::target(*it, graph));
+    }
+    return BitAdjmat(boost::num_vertices(graph), edges, pool);
+  }
+}
+
 } // namespace gl
 
 } // namespace utils
@@ -0,0 +1,537 @@
+/**********************************************************************
+ * @brief An immutable graph in compressed sparse row (CSR) layout.
+ * @details All neighbor lists live back to back in one contiguous array, so
+ *traversals walk memory linearly instead of chasing the per-vertex vectors of
+ *boost::adjacency_list. Intended for graphs that are built once and then
+ *searched many times.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/graph/bitadjmat.hpp"
+#include "utils_cpp/graph/graph.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace gl {
+
+/**
+ * @brief Read-only graph stored as offsets/targets arrays.
+ *
+ * @details The neighbors of vertex v are targets()[offsets()[v] ..
+ * offsets()[v+1]). Each entry ("arc") also records the id of the edge it
+ * belongs to and, if the graph is weighted, that edge's weight. Both arcs of
+ * an undirected edge share one edge id.
+ *
+ * Edge ids are stable: when built from a Graph or DiGraph, the id of an edge
+ * is its position in boost::edges(g); when built from an edgelist, it is the
+ * position in the list; when built from a BitAdjmat, edges (i, j) with i < j
+ * are numbered in row-major order. Neighbor lists keep the order of
+ * boost::adjacent_vertices, so searches visit vertices in the same order as
+ * on the original graph.
+ *
+ * @tparam WeightType The type of the edge weights, if any.
+ */
+template <typename WeightType = std::size_t>
+class CsrGraph {
+public:
+  using weight_type = WeightType;
+
+  CsrGraph() = default;
+
+  /**
+   * @brief Unweighted CSR copy of a Graph or DiGraph.
+   */
+  template <typename GraphType>
+  explicit CsrGraph(const GraphType &g);
+
+  /**
+   * @brief Weighted CSR copy of a Graph or DiGraph.
+   */
+  template <typename GraphType>
+  CsrGraph(const GraphType &g, const EdgeMap<WeightType, GraphType> &weights);
+
+  /**
+   * @brief Weighted CSR copy of a Graph or DiGraph. No lookups are needed,
+   * since DenseEdgeMap and CsrGraph number the edges the same way.
+   *
+   * @throws std::invalid_argument if weights.size() != boost::num_edges(g).
+   */
+  template <typename GraphType>
+  CsrGraph(const GraphType &g,
+           const DenseEdgeMap<WeightType, GraphType> &weights);
+
+  /**
+   * @brief Unweighted, undirected CSR copy of a BitAdjmat.
+   */
+  explicit CsrGraph(const BitAdjmat &mat);
+
+  /**
+   * @brief Builds a graph on vertices 0..num_vertices-1 from an edgelist whose
+   * entries are std::pair, std::array<T, 2> or std::vector<T>.
+   *
+   * @throws std::out_of_range if an endpoint is not less than num_vertices.
+   */
+  template <typename EdgeList>
+  CsrGraph(std::size_t num_vertices, const EdgeList &edgelist,
+           bool directed = false);
+
+  /**
+   * @brief Same as above, where weights[i] is the weight of edgelist[i].
+   *
+   * @throws std::invalid_argument if the sizes of edgelist and weights
+   * differ.
+   */
+  template <typename EdgeList>
+  CsrGraph(std::size_t num_vertices, const EdgeList &edgelist,
+           const std::vector<WeightType> &weights, bool directed = false);
+
+  /**
+   * @brief A graph that reads arrays owned by someone else, e.g. a memory
+   * mapped file (see load_binary), without copying them. 'owner' is kept
+   * alive by the graph and by every copy of it. weights may be empty.
+   *
+   * @throws std::invalid_argument if the array sizes do not fit together.
+   */
+  static CsrGraph view(std::span<const std::size_t> offsets,
+                       std::span<const std::size_t> targets,
+                       std::span<const std::size_t> edge_ids,
+                       std::span<const WeightType> weights,
+                       std::size_t num_edges, WeightType max_weight,
+                       bool directed, std::shared_ptr<const void> owner);
+
+  CsrGraph(const CsrGraph &other);
+  CsrGraph(CsrGraph &&other) noexcept;
+  CsrGraph &operator=(CsrGraph other) noexcept;
+
+  std::size_t num_vertices() const noexcept { return offsets_view_.size() - 1; }
+
+  /**
+   * @brief Number of edges. An undirected edge counts once.
+   */
+  std::size_t num_edges() const noexcept { return num_edges_; }
+
+  /**
+   * @brief Number of stored arcs, i.e. the length of targets(). Twice
+   * num_edges() for undirected graphs without self-loops.
+   */
+  std::size_t num_arcs() const noexcept { return targets_view_.size(); }
+
+  bool is_directed() const noexcept { return directed_; }
+  bool is_weighted() const noexcept { return !weights_view_.empty(); }
+
+  /**
+   * @brief Whether the arrays are borrowed (see view()) rather than owned.
+   */
+  bool is_view() const noexcept { return owner_ != nullptr; }
+
+  /**
+   * @brief The largest edge weight: 1 if the graph is unweighted, 0 if it has
+   * no edges. Lets the searches pick a cheaper queue for small weights.
+   */
+  WeightType max_weight() const noexcept { return max_weight_; }
+
+  std::size_t degree(std::size_t v) const noexcept {
+    return offsets_view_[v + 1] - offsets_view_[v];
+  }
+
+  /**
+   * @brief The (out-)neighbors of v.
+   */
+  std::span<const std::size_t> neighbors(std::size_t v) const noexcept {
+    return targets_view_.subspan(offsets_view_[v], degree(v));
+  }
+
+  /**
+   * @brief The edge ids of the (out-)arcs of v, parallel to neighbors(v).
+   */
+  std::span<const std::size_t> edge_ids(std::size_t v) const noexcept {
+    return edge_ids_view_.subspan(offsets_view_[v], degree(v));
+  }
+
+  /**
+   * @brief The weights of the (out-)arcs of v, parallel to neighbors(v).
+   * Empty if the graph is unweighted.
+   */
+  std::span<const WeightType> weights(std::size_t v) const noexcept {
+    if (weights_view_.empty()) {
+      return {};
+    }
+    return weights_view_.subspan(offsets_view_[v], degree(v));
+  }
+
+  std::span<const std::size_t> offsets() const noexcept {
+    return offsets_view_;
+  }
+  std::span<const std::size_t> targets() const noexcept {
+    return targets_view_;
+  }
+  std::span<const std::size_t> edge_ids() const noexcept {
+    return edge_ids_view_;
+  }
+  std::span<const WeightType> weights() const noexcept {
+    return weights_view_;
+  }
+
+  /**
+   * @brief The graph with every arc reversed, keeping edge ids. The
+   * neighbors of v in the result are the in-neighbors of v here. An
+   * undirected graph is its own reverse, so it is simply copied.
+   */
+  CsrGraph reversed() const;
+
+private:
+  static constexpr std::size_t no_offsets_[1] = {0};
+
+  // Owned arrays, filled by build(). Empty for views.
+  std::vector<std::size_t> offsets_;
+  std::vector<std::size_t> targets_;
+  std::vector<std::size_t> edge_ids_;
+  std::vector<WeightType> weights_;
+
+  // What the accessors read: the arrays above, or memory kept alive by
+  // owner_.
+  std::span<const std::size_t> offsets_view_{no_offsets_};
+  std::span<const std::size_t> targets_view_;
+  std::span<const std::size_t> edge_ids_view_;
+  std::span<const WeightType> weights_view_;
+  std::shared_ptr<const void> owner_;
+
+  std::size_t num_edges_ = 0;
+  WeightType max_weight_ = 0;
+  bool directed_ = false;
+
+  void build(std::size_t num_vertices,
+             const std::vector<std::pair<std::size_t, std::size_t>> &edges,
+             const std::vector<WeightType> *weights);
+
+  /**
+   * @brief Points the views at the owned arrays.
+   */
+  void attach() noexcept {
+    offsets_view_ = offsets_;
+    targets_view_ = targets_;
+    edge_ids_view_ = edge_ids_;
+    weights_view_ = weights_;
+  }
+
+  void swap(CsrGraph &other) noexcept;
+};
+
+/**
+ * @brief CsrGraph csr(g) deduces the default weight type, and
+ * CsrGraph csr(g, weights) deduces it from the weight map.
+ */
+template <typename GraphType>
+CsrGraph(const GraphType &) -> CsrGraph<>;
+
+template <typename GraphType, typename WeightType, typename Hash,
+          typename KeyEqual>
+CsrGraph(const GraphType &,
+         const std::unordered_map<Edge<GraphType>, WeightType, Hash, KeyEqual>
+             &) -> CsrGraph<WeightType>;
+
+template <typename GraphType, typename WeightType>
+CsrGraph(const GraphType &, const DenseEdgeMap<WeightType, GraphType> &)
+    -> CsrGraph<WeightType>;
+
+CsrGraph(const BitAdjmat &) -> CsrGraph<>;
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+namespace detail {
+
+template <typename T, typename U>
+std::pair<std::size_t, std::size_t> edge_endpoints(const std::pair<T, U> &e) {
+  return {static_cast<std::size_t>(e.first),
+          static_cast<std::size_t>(e.second)};
+}
+
+template <typename T>
+std::pair<std::size_t, std::size_t> edge_endpoints(const std::array<T, 2> &e) {
+  return {static_cast<std::size_t>(e[0]), static_cast<std::size_t>(e[1])};
+}
+
+template <typename T>
+std::pair<std::size_t, std::size_t> edge_endpoints(const std::vector<T> &e) {
+  return {static_cast<std::size_t>(e.at(0)), static_cast<std::size_t>(e.at(1))};
+}
+
+template <typename GraphType>
+std::vector<std::pair<std::size_t, std::size_t>>
+csr_edges(const GraphType &g) {
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  edges.reserve(boost::num_edges(g));
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    edges.push_back({boost::source(e, g), boost::target(e, g)});
+  }
+  return edges;
+}
+
+template <typename GraphType>
+constexpr bool is_directed_graph =
+    !std::is_same_v<typename GraphDirectedness<GraphType>::type,
+                    boost::undirectedS>;
+
+} // namespace detail
+
+template <typename WeightType>
+template <typename GraphType>
+CsrGraph<WeightType>::CsrGraph(const GraphType &g)
+    : directed_{detail::is_directed_graph<GraphType>} {
+  build(boost::num_vertices(g), detail::csr_edges(g), nullptr);
+}
+
+template <typename WeightType>
+template <typename GraphType>
+CsrGraph<WeightType>::CsrGraph(const GraphType &g,
+                               const EdgeMap<WeightType, GraphType> &weights)
+    : directed_{detail::is_directed_graph<GraphType>} {
+  std::vector<WeightType> edge_weights;
+  edge_weights.reserve(boost::num_edges(g));
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    edge_weights.push_back(weights.at(e));
+  }
+  build(boost::num_vertices(g), detail::csr_edges(g), &edge_weights);
+}
+
+template <typename WeightType>
+template <typename GraphType>
+CsrGraph<WeightType>::CsrGraph(
+    const GraphType &g, const DenseEdgeMap<WeightType, GraphType> &weights)
+    : directed_{detail::is_directed_graph<GraphType>} {
+  if (weights.size() != boost::num_edges(g)) {
+    throw std::invalid_argument(
+        "CsrGraph: weight map must have one entry per edge");
+  }
+  build(boost::num_vertices(g), detail::csr_edges(g), &weights.values());
+}
+
+template <typename WeightType>
+CsrGraph<WeightType>::CsrGraph(const BitAdjmat &mat) {
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  edges.reserve(mat.num_edges());
+  for (std::size_t i = 0; i < mat.num_vertices(); ++i) {
+    for (std::size_t j : mat[i]) {
+      if (j > i) {
+        edges.push_back({i, j});
+      }
+    }
+  }
+  build(mat.num_vertices(), edges, nullptr);
+}
+
+template <typename WeightType>
+template <typename EdgeList>
+CsrGraph<WeightType>::CsrGraph(std::size_t num_vertices,
+                               const EdgeList &edgelist, bool directed)
+    : directed_{directed} {
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  edges.reserve(edgelist.size());
+  for (const auto &e : edgelist) {
+    edges.push_back(detail::edge_endpoints(e));
+  }
+  build(num_vertices, edges, nullptr);
+}
+
+template <typename WeightType>
+template <typename EdgeList>
+CsrGraph<WeightType>::CsrGraph(std::size_t num_vertices,
+                               const EdgeList &edgelist,
+                               const std::vector<WeightType> &weights,
+                               bool directed)
+    : directed_{directed} {
+  if (edgelist.size() != weights.size()) {
+    throw std::invalid_argument(
+        "CsrGraph: edgelist and weights must have the same size");
+  }
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  edges.reserve(edgelist.size());
+  for (const auto &e : edgelist) {
+    edges.push_back(detail::edge_endpoints(e));
+  }
+  build(num_vertices, edges, &weights);
+}
+
+template <typename WeightType>
+CsrGraph<WeightType> CsrGraph<WeightType>::reversed() const {
+  if (!directed_) {
+    return *this;
+  }
+
+  // Directed arcs are stored once each, so arc i has edge id edge_ids_[i].
+  std::vector<std::pair<std::size_t, std::size_t>> edges(num_edges_);
+  std::vector<WeightType> edge_weights(is_weighted() ? num_edges_ : 0);
+  for (std::size_t u = 0; u < num_vertices(); ++u) {
+    for (std::size_t i = offsets_view_[u]; i < offsets_view_[u + 1]; ++i) {
+      edges[edge_ids_view_[i]] = {targets_view_[i], u};
+      if (is_weighted()) {
+        edge_weights[edge_ids_view_[i]] = weights_view_[i];
+      }
+    }
+  }
+
+  CsrGraph result;
+  result.directed_ = true;
+  result.build(num_vertices(), edges, is_weighted() ? &edge_weights : nullptr);
+  return result;
+}
+
+template <typename WeightType>
+void CsrGraph<WeightType>::build(
+    std::size_t num_vertices,
+    const std::vector<std::pair<std::size_t, std::size_t>> &edges,
+    const std::vector<WeightType> *weights) {
+
+  num_edges_ = edges.size();
+  max_weight_ = 0;
+  if (weights) {
+    for (const auto &w : *weights) {
+      max_weight_ = std::max(max_weight_, w);
+    }
+  } else if (!edges.empty()) {
+    max_weight_ = 1;
+  }
+
+  // Counting sort of the arcs by source. The sort is stable, so every
+  // neighbor list keeps the order in which its edges were listed.
+  offsets_.assign(num_vertices + 1, 0);
+  for (auto [u, v] : edges) {
+    if (u >= num_vertices || v >= num_vertices) {
+      throw std::out_of_range("CsrGraph: edge endpoint out of range");
+    }
+    ++offsets_[u + 1];
+    if (!directed_ && u != v) {
+      ++offsets_[v + 1];
+    }
+  }
+  for (std::size_t v = 0; v < num_vertices; ++v) {
+    offsets_[v + 1] += offsets_[v];
+  }
+
+  std::size_t num_arcs = offsets_[num_vertices];
+  targets_.resize(num_arcs);
+  edge_ids_.resize(num_arcs);
+  if (weights) {
+    weights_.resize(num_arcs);
+  }
+
+  std::vector<std::size_t> next(offsets_.begin(), offsets_.end() - 1);
+  auto place = [&](std::size_t from, std::size_t to, std::size_t id) {
+    std::size_t pos = next[from]++;
+    targets_[pos] = to;
+    edge_ids_[pos] = id;
+    if (weights) {
+      weights_[pos] = (*weights)[id];
+    }
+  };
+
+  for (std::size_t id = 0; id < edges.size(); ++id) {
+    auto [u, v] = edges[id];
+    place(u, v, id);
+    if (!directed_ && u != v) {
+      place(v, u, id);
+    }
+  }
+  attach();
+}
+
+template <typename WeightType>
+CsrGraph<WeightType> CsrGraph<WeightType>::view(
+    std::span<const std::size_t> offsets, std::span<const std::size_t> targets,
+    std::span<const std::size_t> edge_ids, std::span<const WeightType> weights,
+    std::size_t num_edges, WeightType max_weight, bool directed,
+    std::shared_ptr<const void> owner) {
+  if (offsets.empty() || offsets.front() != 0 ||
+      offsets.back() != targets.size() || edge_ids.size() != targets.size() ||
+      (!weights.empty() && weights.size() != targets.size())) {
+    throw std::invalid_argument("CsrGraph::view: inconsistent array sizes");
+  }
+
+  CsrGraph g;
+  g.offsets_view_ = offsets;
+  g.targets_view_ = targets;
+  g.edge_ids_view_ = edge_ids;
+  g.weights_view_ = weights;
+  g.owner_ = owner ? std::move(owner) : std::make_shared<const char>('\0');
+  g.num_edges_ = num_edges;
+  g.max_weight_ = max_weight;
+  g.directed_ = directed;
+  return g;
+}
+
+template <typename WeightType>
+CsrGraph<WeightType>::CsrGraph(const CsrGraph &other)
+    : offsets_(other.offsets_), targets_(other.targets_),
+      edge_ids_(other.edge_ids_), weights_(other.weights_),
+      owner_(other.owner_), num_edges_{other.num_edges_},
+      max_weight_{other.max_weight_}, directed_{other.directed_} {
+  if (owner_) {
+    offsets_view_ = other.offsets_view_;
+    targets_view_ = other.targets_view_;
+    edge_ids_view_ = other.edge_ids_view_;
+    weights_view_ = other.weights_view_;
+  } else if (!offsets_.empty()) {
+    attach();
+  }
+}
+
+template <typename WeightType>
+CsrGraph<WeightType>::CsrGraph(CsrGraph &&other) noexcept {
+  swap(other);
+}
+
+template <typename WeightType>
+CsrGraph<WeightType> &CsrGraph<WeightType>::operator=(CsrGraph other) noexcept {
+  swap(other);
+  return *this;
+}
+
+template <typename WeightType>
+void CsrGraph<WeightType>::swap(CsrGraph &other) noexcept {
+  // Swapping vectors swaps their buffers, so the views stay valid.
+  std::swap(offsets_, other.offsets_);
+  std::swap(targets_, other.targets_);
+  std::swap(edge_ids_, other.edge_ids_);
+  std::swap(weights_, other.weights_);
+  std::swap(offsets_view_, other.offsets_view_);
+  std::swap(targets_view_, other.targets_view_);
+  std::swap(edge_ids_view_, other.edge_ids_view_);
+  std::swap(weights_view_, other.weights_view_);
+  std::swap(owner_, other.owner_);
+  std::swap(num_edges_, other.num_edges_);
+  std::swap(max_weight_, other.max_weight_);
+  std::swap(directed_, other.directed_);
+}
+
+} // namespace gl
+
+} // namespace utils
+
+/**
+ * @brief Lets Vertex<CsrGraph<W>> and Edge<CsrGraph<W>> name the vertex index
+ * and edge id, so that CsrGraph can be passed to the overloads in
+ * pathfinding.hpp and algorithms.hpp.
+ */
+template <typename WeightType>
+struct boost::graph_traits<utils::gl::CsrGraph<WeightType>> {
+  using vertex_descriptor = std::size_t;
+  using edge_descriptor = std::size_t;
+  using vertices_size_type = std::size_t;
+  using edges_size_type = std::size_t;
+  using degree_size_type = std::size_t;
+};
@@ -0,0 +1,214 @@
+/**********************************************************************
+ * @brief Connectivity checks for graphs that lose vertices or edges one at
+ *a time.
+ * @details VertexDeletionConnectivity decides whether deleting a vertex
+ *would split its component by searching outward from the vertex's
+ *neighbours in lockstep until they meet, so the cost depends on the
+ *neighbourhood rather than on the whole graph. deletable_edges answers the
+ *same question for a fixed order of edge deletions, offline, with one
+ *union-find pass. Used by the connected pruning in transforms.hpp.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/disjointset.hpp"
+#include "utils_cpp/graph/csr_graph.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace gl {
+
+/**
+ * @brief Tracks a graph from which vertices are deleted, and tells whether
+ * deleting a vertex would split the component it is in.
+ *
+ * @details would_split(v) starts one breadth-first search from each live
+ * neighbour of v, avoiding v, and advances them one vertex at a time in
+ * turn. Searches that meet are merged. The answer is "no" once all of them
+ * have merged, and "yes" once a merged group runs out of vertices while
+ * others remain. On a lattice the neighbours of a vertex meet after a few
+ * steps around a short cycle. When they do not, the search stops after
+ * exploring roughly the smallest piece times the degree of v, rather than
+ * the whole graph.
+ */
+class VertexDeletionConnectivity {
+public:
+  explicit VertexDeletionConnectivity(CsrGraph<> graph);
+
+  template <typename GraphType>
+  explicit VertexDeletionConnectivity(const GraphType &g)
+      : VertexDeletionConnectivity(CsrGraph<>(g)) {}
+
+  std::size_t num_vertices() const { return graph_.num_vertices(); }
+  std::size_t num_remaining() const { return remaining_; }
+  bool is_removed(std::size_t v) const { return removed_[v]; }
+
+  /**
+   * @brief Whether deleting v would leave its live neighbours in more than
+   * one component. False for a vertex with at most one live neighbour.
+   */
+  bool would_split(std::size_t v);
+
+  /**
+   * @brief Deletes v, along with its edges.
+   */
+  void remove(std::size_t v);
+
+private:
+  CsrGraph<> graph_;
+  std::vector<char> removed_;
+  std::size_t remaining_;
+
+  // Scratch space for would_split, reused between calls. A vertex has been
+  // reached by the current call iff seen_[x] == epoch_, by search owner_[x].
+  std::uint32_t epoch_ = 0;
+  std::vector<std::uint32_t> seen_;
+  std::vector<std::size_t> owner_;
+  std::vector<std::vector<std::size_t>> queues_;
+  std::vector<std::size_t> heads_;
+  std::vector<std::size_t> group_;  // union-find over the searches
+  std::vector<std::size_t> active_; // per group, searches with a frontier
+
+  std::size_t find_group(std::size_t i) {
+    while (group_[i] != i) {
+      i = group_[i] = group_[group_[i]];
+    }
+    return i;
+  }
+
+  void next_epoch() {
+    if (++epoch_ == 0) {
+      std::fill(seen_.begin(), seen_.end(), 0);
+      epoch_ = 1;
+    }
+  }
+};
+
+/**
+ * @brief For edges deleted greedily in the given order, where each one is
+ * deleted only if that does not add a connected component, marks the edges
+ * that get deleted.
+ *
+ * @details Greedy deletion in this order is the reverse-delete algorithm
+ * for a maximum spanning forest where edge i weighs i. So the kept edges
+ * are exactly those that Kruskal's algorithm takes when adding the edges
+ * back from last to first, which one union-find pass finds in near-linear
+ * time. To delete only k edges, take the first k marked ones.
+ */
+std::vector<bool>
+deletable_edges(std::size_t num_vertices,
+                std::span<const std::pair<std::size_t, std::size_t>> order);
+
+// ==== Implementation ====
+
+inline VertexDeletionConnectivity::VertexDeletionConnectivity(CsrGraph<> graph)
+    : graph_{std::move(graph)}, removed_(graph_.num_vertices(), 0),
+      remaining_{graph_.num_vertices()}, seen_(graph_.num_vertices(), 0),
+      owner_(graph_.num_vertices(), 0) {}
+
+inline void VertexDeletionConnectivity::remove(std::size_t v) {
+  if (!removed_[v]) {
+    removed_[v] = 1;
+    --remaining_;
+  }
+}
+
+inline bool VertexDeletionConnectivity::would_split(std::size_t v) {
+  next_epoch();
+
+  // One search per distinct live neighbour.
+  std::size_t num_searches = 0;
+  for (std::size_t nb : graph_.neighbors(v)) {
+    if (nb == v || removed_[nb] || seen_[nb] == epoch_) {
+      continue;
+    }
+    seen_[nb] = epoch_;
+    owner_[nb] = num_searches;
+    if (queues_.size() <= num_searches) {
+      queues_.emplace_back();
+    }
+    queues_[num_searches].assign(1, nb);
+    ++num_searches;
+  }
+  if (num_searches <= 1) {
+    return false;
+  }
+
+  heads_.assign(num_searches, 0);
+  group_.resize(num_searches);
+  for (std::size_t i = 0; i < num_searches; ++i) {
+    group_[i] = i;
+  }
+  active_.assign(num_searches, 1);
+  std::size_t num_groups = num_searches;
+
+  // v itself is not part of the graph being searched.
+  seen_[v] = epoch_;
+  owner_[v] = num_searches;
+
+  while (true) {
+    for (std::size_t i = 0; i < num_searches; ++i) {
+      std::vector<std::size_t> &queue = queues_[i];
+      if (heads_[i] == queue.size()) {
+        continue;
+      }
+
+      std::size_t x = queue[heads_[i]++];
+      for (std::size_t y : graph_.neighbors(x)) {
+        if (removed_[y]) {
+          continue;
+        }
+        if (seen_[y] != epoch_) {
+          seen_[y] = epoch_;
+          owner_[y] = i;
+          queue.push_back(y);
+          continue;
+        }
+        if (owner_[y] == num_searches) {
+          continue; // y is v
+        }
+        std::size_t a = find_group(i), b = find_group(owner_[y]);
+        if (a != b) {
+          group_[b] = a;
+          active_[a] += active_[b];
+          if (--num_groups == 1) {
+            return false;
+          }
+        }
+      }
+
+      if (heads_[i] == queue.size() && --active_[find_group(i)] == 0) {
+        // Everything this group can reach has been explored, and some other
+        // neighbour of v was not among it.
+        return true;
+      }
+    }
+  }
+}
+
+inline std::vector<bool>
+deletable_edges(std::size_t num_vertices,
+                std::span<const std::pair<std::size_t, std::size_t>> order) {
+  std::vector<bool> deletable(order.size(), true);
+  DisjointSet forest(static_cast<int>(num_vertices));
+  for (std::size_t i = order.size(); i-- > 0;) {
+    int a = forest.find(static_cast<int>(order[i].first));
+    int b = forest.find(static_cast<int>(order[i].second));
+    if (a != b) {
+      forest.unify(a, b);
+      deletable[i] = false;
+    }
+  }
+  return deletable;
+}
+
+} // namespace gl
+} // namespace utils
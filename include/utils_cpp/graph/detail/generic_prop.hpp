@@ -1,6 +1,10 @@
 /**********************************************************************
  * @brief Generic vertex or edge property
- * @details
+ * @details A property holds either a map (VertexMap or EdgeMap) of strings,
+ *doubles or vectors of doubles, or, for vertex properties only, a columnar
+ *ScalarColumn or VectorColumn. The columnar layouts store every vertex's
+ *value contiguously, which saves memory and makes copies cheap for numeric
+ *properties set on every vertex, e.g. coordinates.
  * @author Sam Tonetto
  * @copyright GNU Public License
  * @date 2023
@@ -9,11 +13,22 @@
 #pragma once
 
 #include "utils_cpp/graph/detail/generic_prop_value_proxy.hpp"
+#include "utils_cpp/graph/detail/prop_columns.hpp"
+#include "utils_cpp/graph/graph.hpp"
 
 #include "utils_cpp/metaprogramming/custom_concepts.hpp"
+#include "utils_cpp/metaprogramming/is_instantiation.hpp"
 
 #include "utils_cpp/print.hpp"
 
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
 namespace utils {
 namespace gl {
 
@@ -23,8 +38,18 @@ namespace gl {
 template <template <typename...> typename MapType, typename GraphType>
 struct GenericProp {
 
-  std::variant<MapType<std::string, GraphType>, MapType<double, GraphType>,
-               MapType<std::vector<double>, GraphType>>
+  using string_map = MapType<std::string, GraphType>;
+  using double_map = MapType<double, GraphType>;
+  using vector_map = MapType<std::vector<double>, GraphType>;
+
+  /**
+   * @brief Only vertex properties can be columnar, since vertices (unlike
+   * edge descriptors) are already dense indices.
+   */
+  static constexpr bool supports_columns =
+      std::is_same_v<double_map, VertexMap<double, GraphType>>;
+
+  std::variant<string_map, double_map, vector_map, ScalarColumn, VectorColumn>
       p;
 
   GenericProp(const MapType<std::string, GraphType> &m) : p(m) {}
@@ -61,6 +86,35 @@ struct GenericProp {
     }
   }
 
+  /**
+   * @brief A dense vertex map is stored as a ScalarColumn.
+   */
+  template <Arithmetic T>
+    requires supports_columns
+  GenericProp(const DenseVertexMap<T, GraphType> &m) {
+    auto &column = p.template emplace<ScalarColumn>();
+    column.values.reserve(m.size());
+    for (const auto &value : m) {
+      column.values.push_back(static_cast<double>(value));
+    }
+  }
+
+  /**
+   * @brief A dense vertex map of vectors is stored as a VectorColumn.
+   */
+  template <Arithmetic T>
+    requires supports_columns
+  GenericProp(const DenseVertexMap<std::vector<T>, GraphType> &m) {
+    auto &column = p.template emplace<VectorColumn>();
+    column.offsets.reserve(m.size() + 1);
+    for (const auto &value : m) {
+      for (const auto &e : value) {
+        column.values.push_back(static_cast<double>(e));
+      }
+      column.offsets.push_back(column.values.size());
+    }
+  }
+
   GenericProp() = default;
 
   // variant emplace
@@ -82,6 +136,10 @@ struct GenericProp {
         std::forward<Key>(k), *this};
   }
 
+  /**
+   * @brief Reference to the underlying map. Throws std::bad_variant_access if
+   * the property is columnar; use to_map() to get a copy either way.
+   */
   template <typename T>
   operator const MapType<T, GraphType> &() const {
     return std::get<MapType<T, GraphType>>(p);
@@ -92,21 +150,333 @@ struct GenericProp {
     return std::get<MapType<T, GraphType>>(p);
   }
 
+  /**
+   * @brief Number of keys in the map, or of vertices in the column.
+   */
+  std::size_t size() const {
+    return std::visit([](const auto &storage) { return storage.size(); }, p);
+  }
+
+  bool is_columnar() const {
+    return std::holds_alternative<ScalarColumn>(p) ||
+           std::holds_alternative<VectorColumn>(p);
+  }
+
+  /**
+   * @brief Converts a double or vector property to a ScalarColumn or
+   * VectorColumn covering vertices 0..num_vertices-1. Vertices missing from the
+   * map get 0 or an empty vector. Does nothing if already columnar.
+   *
+   * @throws std::invalid_argument for string properties and for edge
+   * properties.
+   */
+  void make_columnar(std::size_t num_vertices);
+
+  /**
+   * @brief Copy of the property as a map of T, whatever the storage. T can be
+   * std::string, any arithmetic type or a vector of one; numbers are
+   * converted element-wise.
+   *
+   * @throws std::bad_variant_access if T does not match the kind of value
+   * stored, e.g. a number for a string property.
+   */
+  template <typename T>
+  MapType<T, GraphType> to_map() const;
+
+  /**
+   * @brief Copy of the property with every vertex v renamed to new_index[v],
+   * for a graph with num_vertices vertices. Values of vertices mapped to
+   * std::numeric_limits<std::size_t>::max(), and of edges with such an
+   * endpoint, are dropped.
+   *
+   * @details Maps are rekeyed in one pass. Columns are gathered into new
+   * columns, in which vertices that nothing maps to get 0 or an empty vector.
+   */
+  GenericProp remap_vertices(const std::vector<std::size_t> &new_index,
+                             std::size_t num_vertices) const;
+
+  // ---- Per-key access, used by the value proxies ----
+
+  template <typename Key>
+  void set(const Key &k, const std::string &value);
+
+  template <typename Key>
+  void set(const Key &k, double value);
+
+  template <typename Key>
+  void set(const Key &k, std::span<const double> value);
+
+  /**
+   * @brief Calls f with the value of key k, as a const std::string&, a double
+   * or a std::span<const double>.
+   *
+   * @throws std::out_of_range if k has no value.
+   */
+  template <typename Key, typename F>
+  decltype(auto) visit_value(const Key &k, F &&f) const;
+
   template <template <typename...> typename M, typename G, typename T>
   friend bool operator==(const GenericProp<M, G> &lhs, const T &rhs);
+
+  /**
+   * @brief The column row of a vertex key.
+   */
+  template <typename Key>
+  static std::size_t column_index(const Key &k) {
+    if constexpr (std::is_convertible_v<Key, std::size_t>) {
+      return static_cast<std::size_t>(k);
+    } else {
+      throw std::invalid_argument("columnar properties need vertex keys");
+    }
+  }
 };
 
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+template <template <typename...> typename MapType, typename GraphType>
+void GenericProp<MapType, GraphType>::make_columnar(std::size_t num_vertices) {
+  if (!supports_columns) {
+    throw std::invalid_argument("only vertex properties can be columnar");
+  }
+  if (is_columnar()) {
+    return;
+  }
+
+  if (auto *m = std::get_if<double_map>(&p)) {
+    ScalarColumn column;
+    column.values.assign(num_vertices, 0.0);
+    for (const auto &[k, v] : *m) {
+      column.assign(column_index(k), v);
+    }
+    p = std::move(column);
+  } else if (auto *m = std::get_if<vector_map>(&p)) {
+    VectorColumn column;
+    column.offsets.reserve(num_vertices + 1);
+    for (std::size_t v = 0; v < num_vertices; ++v) {
+      if constexpr (supports_columns) {
+        if (auto it = m->find(v); it != m->end()) {
+          column.push_back(it->second);
+          continue;
+        }
+      }
+      column.push_back({});
+    }
+    p = std::move(column);
+  } else {
+    throw std::invalid_argument("string properties cannot be columnar");
+  }
+}
+
+template <template <typename...> typename MapType, typename GraphType>
+template <typename T>
+MapType<T, GraphType> GenericProp<MapType, GraphType>::to_map() const {
+  if constexpr (std::is_same_v<T, double> ||
+                std::is_same_v<T, std::vector<double>> ||
+                std::is_same_v<T, std::string>) {
+    if (auto *m = std::get_if<MapType<T, GraphType>>(&p)) {
+      return *m;
+    }
+  }
+
+  // Numbers are stored as doubles, in a map or a column, and converted
+  // element-wise to T.
+  MapType<T, GraphType> m;
+  if constexpr (Arithmetic<T>) {
+    if (auto *source = std::get_if<double_map>(&p)) {
+      m.reserve(source->size());
+      for (const auto &[k, v] : *source) {
+        m[k] = static_cast<T>(v);
+      }
+      return m;
+    }
+    if constexpr (supports_columns) {
+      if (auto *c = std::get_if<ScalarColumn>(&p)) {
+        m.reserve(c->size());
+        for (std::size_t v = 0; v < c->size(); ++v) {
+          m[v] = static_cast<T>(c->values[v]);
+        }
+        return m;
+      }
+    }
+  } else if constexpr (is_instantiation<std::vector, T>()) {
+    using U = typename T::value_type;
+    static_assert(Arithmetic<U>, "vector properties hold numbers");
+    auto convert = [](const auto &values) {
+      T out;
+      out.reserve(values.size());
+      for (double x : values) {
+        out.push_back(static_cast<U>(x));
+      }
+      return out;
+    };
+    if (auto *source = std::get_if<vector_map>(&p)) {
+      m.reserve(source->size());
+      for (const auto &[k, v] : *source) {
+        m[k] = convert(v);
+      }
+      return m;
+    }
+    if constexpr (supports_columns) {
+      if (auto *c = std::get_if<VectorColumn>(&p)) {
+        m.reserve(c->size());
+        for (std::size_t v = 0; v < c->size(); ++v) {
+          m[v] = convert(c->at(v));
+        }
+        return m;
+      }
+    }
+  }
+  throw std::bad_variant_access();
+}
+
+template <template <typename...> typename MapType, typename GraphType>
+GenericProp<MapType, GraphType> GenericProp<MapType, GraphType>::remap_vertices(
+    const std::vector<std::size_t> &new_index, std::size_t num_vertices) const {
+  constexpr std::size_t dropped = std::numeric_limits<std::size_t>::max();
+  auto remap = [&](std::size_t v) {
+    return v < new_index.size() ? new_index[v] : dropped;
+  };
+
+  GenericProp result;
+
+  if (is_columnar()) {
+    std::vector<std::size_t> old_index(num_vertices, dropped);
+    for (std::size_t v = 0; v < new_index.size(); ++v) {
+      if (new_index[v] < num_vertices) {
+        old_index[new_index[v]] = v;
+      }
+    }
+
+    if (auto *s = std::get_if<ScalarColumn>(&p)) {
+      auto &column = result.p.template emplace<ScalarColumn>();
+      column.values.resize(num_vertices);
+      for (std::size_t w = 0; w < num_vertices; ++w) {
+        column.values[w] = old_index[w] < s->size() ? s->values[old_index[w]]
+                                                    : 0.0;
+      }
+    } else {
+      const auto &c = std::get<VectorColumn>(p);
+      auto &column = result.p.template emplace<VectorColumn>();
+      column.offsets.resize(num_vertices + 1);
+      for (std::size_t w = 0; w < num_vertices; ++w) {
+        std::size_t v = old_index[w];
+        std::size_t length =
+            v < c.size() ? c.offsets[v + 1] - c.offsets[v] : 0;
+        column.offsets[w + 1] = column.offsets[w] + length;
+      }
+      column.values.resize(column.offsets.back());
+      for (std::size_t w = 0; w < num_vertices; ++w) {
+        std::size_t v = old_index[w];
+        if (v < c.size()) {
+          std::copy(c.values.begin() + c.offsets[v],
+                    c.values.begin() + c.offsets[v + 1],
+                    column.values.begin() + column.offsets[w]);
+        }
+      }
+    }
+    return result;
+  }
+
+  std::visit(
+      [&](const auto &m) {
+        using Map = std::decay_t<decltype(m)>;
+        if constexpr (!std::is_same_v<Map, ScalarColumn> &&
+                      !std::is_same_v<Map, VectorColumn>) {
+          auto &remapped = result.p.template emplace<Map>();
+          remapped.reserve(m.size());
+          for (const auto &[k, value] : m) {
+            if constexpr (supports_columns) {
+              if (std::size_t w = remap(k); w != dropped) {
+                remapped.emplace(w, value);
+              }
+            } else {
+              std::size_t s = remap(k.m_source);
+              std::size_t t = remap(k.m_target);
+              if (s != dropped && t != dropped) {
+                remapped.emplace(typename Map::key_type(s, t, nullptr), value);
+              }
+            }
+          }
+        }
+      },
+      p);
+  return result;
+}
+
+template <template <typename...> typename MapType, typename GraphType>
+template <typename Key>
+void GenericProp<MapType, GraphType>::set(const Key &k,
+                                          const std::string &value) {
+  if (size() == 0 && !std::holds_alternative<string_map>(p)) {
+    p.template emplace<string_map>();
+  }
+  std::get<string_map>(p)[k] = value;
+}
+
+template <template <typename...> typename MapType, typename GraphType>
+template <typename Key>
+void GenericProp<MapType, GraphType>::set(const Key &k, double value) {
+  if (auto *c = std::get_if<ScalarColumn>(&p)) {
+    c->assign(column_index(k), value);
+    return;
+  }
+  if (size() == 0 && !std::holds_alternative<double_map>(p)) {
+    p.template emplace<double_map>();
+  }
+  std::get<double_map>(p)[k] = value;
+}
+
+template <template <typename...> typename MapType, typename GraphType>
+template <typename Key>
+void GenericProp<MapType, GraphType>::set(const Key &k,
+                                          std::span<const double> value) {
+  if (auto *c = std::get_if<VectorColumn>(&p)) {
+    c->assign(column_index(k), value);
+    return;
+  }
+  if (size() == 0 && !std::holds_alternative<vector_map>(p)) {
+    p.template emplace<vector_map>();
+  }
+  std::get<vector_map>(p)[k] = std::vector<double>(value.begin(), value.end());
+}
+
+template <template <typename...> typename MapType, typename GraphType>
+template <typename Key, typename F>
+decltype(auto) GenericProp<MapType, GraphType>::visit_value(const Key &k,
+                                                            F &&f) const {
+  switch (p.index()) {
+  case 0:
+    return f(std::get<string_map>(p).at(k));
+  case 1:
+    return f(std::get<double_map>(p).at(k));
+  case 2:
+    return f(std::span<const double>(std::get<vector_map>(p).at(k)));
+  case 3:
+    return f(std::get<ScalarColumn>(p).at(column_index(k)));
+  default:
+    return f(std::get<VectorColumn>(p).at(column_index(k)));
+  }
+}
+
 template <template <typename...> typename M, typename G, typename T>
 bool operator==(const GenericProp<M, G> &lhs, const T &rhs) {
   if constexpr (std::is_same_v<T, GenericProp<M, G>>) { // RHS is generic prop
     return lhs.p == rhs.p;
   } else if constexpr (std::is_same_v<T,
                                       M<std::string, G>>) { // RHS is string map
-    return std::get<M<std::string, G>>(lhs.p) == rhs;
-  } else if constexpr (std::is_same_v<T, M<double, G>>) {
-    return std::get<M<double, G>>(lhs.p) == rhs;
-  } else if constexpr (std::is_same_v<T, M<std::vector<double>, G>>) {
-    return std::get<M<std::vector<double>, G>>(lhs.p) == rhs;
+    return std::holds_alternative<T>(lhs.p) && std::get<T>(lhs.p) == rhs;
+  } else if constexpr (std::is_same_v<T, M<double, G>> ||
+                       std::is_same_v<T, M<std::vector<double>, G>>) {
+    if (lhs.is_columnar()) {
+      try {
+        return lhs.template to_map<typename T::mapped_type>() == rhs;
+      } catch (const std::bad_variant_access &) {
+        return false;
+      }
+    }
+    return std::holds_alternative<T>(lhs.p) && std::get<T>(lhs.p) == rhs;
   } else {
     return false;
   }
@@ -120,8 +490,12 @@ std::ostream &operator<<(std::ostream &os,
     utils::operator<<(os, std::get<M<std::string, G>>(gp.p));
   } else if (std::holds_alternative<M<double, G>>(gp.p)) {
     utils::operator<<(os, std::get<M<double, G>>(gp.p));
-  } else {
+  } else if (std::holds_alternative<M<std::vector<double>, G>>(gp.p)) {
     utils::operator<<(os, std::get<M<std::vector<double>, G>>(gp.p));
+  } else if (std::holds_alternative<ScalarColumn>(gp.p)) {
+    os << std::get<ScalarColumn>(gp.p);
+  } else {
+    os << std::get<VectorColumn>(gp.p);
   }
   return os;
 }
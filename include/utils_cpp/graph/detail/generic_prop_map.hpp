@@ -1,6 +1,17 @@
 /**********************************************************************
  * @brief A string-to-property map metamap.
- * @details
+ * @details Each property is held through a reference count and shared
+ *between copies of the map until one of them writes to it, so copying a
+ *GraphBundle costs one pointer per property, and a transform pays only for
+ *the properties it changes. Reading through a const map never copies, and
+ *assign() replaces a property without giving out a reference to it.
+ *
+ *Anything handing out a mutable reference (non-const operator[], iterating a
+ *non-const map) first gives this map its own copy of that property, and
+ *marks it unshareable: the reference may be kept and written through later,
+ *so every later copy of the map deep-copies that property, as the map did
+ *before it was shared (a "leaked" string in copy-on-write terms). assign()
+ *makes the property shareable again.
  * @author Sam Tonetto
  * @copyright GNU Public License
  * @date 2023
@@ -10,38 +21,175 @@
 
 #include <nlohmann/json.hpp>
 
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
 namespace utils {
 
 namespace gl {
 
+namespace detail {
+
+/**
+ * @internal
+ * @brief A property of a GenericPropMap and whether copies may share it.
+ */
+template <typename PropType>
+struct prop_map_entry {
+  std::shared_ptr<PropType> prop;
+  /// False once a mutable reference to prop has been handed out.
+  bool shareable = true;
+
+  /// The property, owned by this entry alone and marked unshareable.
+  PropType &leak() {
+    if (prop.use_count() > 1) {
+      prop = std::make_shared<PropType>(*prop);
+    }
+    shareable = false;
+    return *prop;
+  }
+};
+
+/**
+ * @internal
+ * @brief Iterator over the (name, property) pairs of a GenericPropMap,
+ * dereferencing to a pair of references. A mutable iterator unshares each
+ * property it dereferences and marks it unshareable.
+ */
+template <typename PropType, bool Const>
+class prop_map_iterator {
+  using map_type = std::map<std::string, prop_map_entry<PropType>>;
+  using base_iterator =
+      std::conditional_t<Const, typename map_type::const_iterator,
+                         typename map_type::iterator>;
+  using prop_reference =
+      std::conditional_t<Const, const PropType &, PropType &>;
+
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = std::pair<const std::string, PropType>;
+  using reference = std::pair<const std::string &, prop_reference>;
+  using difference_type = std::ptrdiff_t;
+
+  prop_map_iterator() = default;
+  explicit prop_map_iterator(base_iterator it) : it_(it) {}
+
+  reference operator*() const {
+    if constexpr (Const) {
+      return {it_->first, *it_->second.prop};
+    } else {
+      return {it_->first, it_->second.leak()};
+    }
+  }
+
+  prop_map_iterator &operator++() {
+    ++it_;
+    return *this;
+  }
+  prop_map_iterator operator++(int) {
+    auto old = *this;
+    ++it_;
+    return old;
+  }
+
+  friend bool operator==(const prop_map_iterator &a,
+                         const prop_map_iterator &b) {
+    return a.it_ == b.it_;
+  }
+
+private:
+  base_iterator it_{};
+};
+
+} // namespace detail
+
 template <typename PropType>
-struct GenericPropMap {
-  std::map<std::string, PropType> data;
+class GenericPropMap {
+public:
+  using iterator = detail::prop_map_iterator<PropType, false>;
+  using const_iterator = detail::prop_map_iterator<PropType, true>;
+
+  GenericPropMap() = default;
+
+  /// Shares every property of other, except those other has handed out
+  /// mutable references to, which are copied.
+  GenericPropMap(const GenericPropMap &other) : data_(other.data_) {
+    for (auto &[key, entry] : data_) {
+      if (!entry.shareable) {
+        entry.prop = std::make_shared<PropType>(*entry.prop);
+        entry.shareable = true;
+      }
+    }
+  }
+
+  GenericPropMap(GenericPropMap &&) noexcept = default;
 
-  PropType &operator[](const std::string &key) { return data[key]; }
+  GenericPropMap &operator=(const GenericPropMap &other) {
+    if (this != &other) {
+      GenericPropMap copy(other);
+      data_ = std::move(copy.data_);
+    }
+    return *this;
+  }
 
+  GenericPropMap &operator=(GenericPropMap &&) noexcept = default;
+
+  /// The property called key, inserted empty if missing, and owned by this
+  /// map alone. Copies of the map made from now on copy it.
+  PropType &operator[](const std::string &key) {
+    auto &entry = data_[key];
+    if (!entry.prop) {
+      entry.prop = std::make_shared<PropType>();
+    }
+    return entry.leak();
+  }
+
+  /// @throws std::out_of_range if there is no property called key
   const PropType &operator[](const std::string &key) const {
-    return data.at(key);
+    return *data_.at(key).prop;
   }
 
-  auto begin() { return data.begin(); }
-  auto end() { return data.end(); }
-  auto begin() const { return data.begin(); }
-  auto end() const { return data.end(); }
+  /// Sets the property called key to value, keeping it shareable.
+  template <typename T>
+  void assign(const std::string &key, T &&value) {
+    data_[key] = {std::make_shared<PropType>(std::forward<T>(value)), true};
+  }
 
-  std::size_t size() const { return data.size(); }
+  iterator begin() { return iterator(data_.begin()); }
+  iterator end() { return iterator(data_.end()); }
+  const_iterator begin() const { return const_iterator(data_.begin()); }
+  const_iterator end() const { return const_iterator(data_.end()); }
+
+  std::size_t size() const { return data_.size(); }
 
   bool contains(const std::string &key) const {
-    return data.find(key) != data.end();
+    return data_.find(key) != data_.end();
+  }
+
+  /// Whether the property called key is the same object in both maps, i.e.
+  /// not copied since one map was copied from the other.
+  bool shares(const std::string &key, const GenericPropMap &other) const {
+    auto a = data_.find(key);
+    auto b = other.data_.find(key);
+    return a != data_.end() && b != other.data_.end() &&
+           a->second.prop == b->second.prop;
   }
 
   nlohmann::json to_json() const {
     nlohmann::json j;
-    for (const auto &[k, v] : data) {
-      std::visit([&j, &k](const auto &e) { j[k] = e; }, v.p);
+    for (const auto &[k, v] : data_) {
+      std::visit([&j, &k](const auto &e) { j[k] = e; }, v.prop->p);
     }
     return j;
   }
+
+private:
+  std::map<std::string, detail::prop_map_entry<PropType>> data_;
 };
 
 } // namespace gl
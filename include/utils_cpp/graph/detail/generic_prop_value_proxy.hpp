@@ -3,9 +3,13 @@
 #include "utils_cpp/metaprogramming/custom_concepts.hpp"
 #include "utils_cpp/metaprogramming/overload.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <span>
 #include <string>
+#include <type_traits>
 #include <variant>
+#include <vector>
 
 #include "utils_cpp/print.hpp"
 
@@ -16,10 +20,109 @@ namespace gl {
 template <template <typename...> typename MapType, typename GraphType>
 struct GenericProp;
 
+struct ScalarColumn;
+struct VectorColumn;
+
 template <typename Key, template <typename...> typename MapType,
           typename GraphType>
 struct ConstGenericPropValueProxy;
 
+namespace detail {
+
+/**
+ * @internal
+ * @brief Compares a stored property value (a std::string, a double or a span
+ * of doubles, as passed by GenericProp::visit_value) with a plain value.
+ * Values of different kinds compare unequal.
+ */
+template <typename Stored, typename T>
+bool prop_value_equals(const Stored &stored, const T &rhs) {
+  using S = std::decay_t<Stored>;
+  if constexpr (std::is_same_v<S, std::string>) {
+    if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+      return stored == std::string_view(rhs);
+    } else {
+      return false;
+    }
+  } else if constexpr (std::is_same_v<S, double>) {
+    if constexpr (Arithmetic<T>) {
+      return stored == static_cast<double>(rhs);
+    } else {
+      return false;
+    }
+  } else { // span of doubles
+    if constexpr (requires { rhs.size(); rhs.begin(); } &&
+                  !std::is_convertible_v<const T &, std::string_view>) {
+      return std::equal(stored.begin(), stored.end(), rhs.begin(), rhs.end(),
+                        [](double a, const auto &b) {
+                          if constexpr (Arithmetic<std::decay_t<decltype(b)>>) {
+                            return a == static_cast<double>(b);
+                          } else {
+                            return false;
+                          }
+                        });
+    } else {
+      return false;
+    }
+  }
+}
+
+/**
+ * @internal
+ * @brief Compares two stored property values of possibly different kinds.
+ */
+template <typename A, typename B>
+bool prop_values_equal(const A &a, const B &b) {
+  using SA = std::decay_t<A>;
+  using SB = std::decay_t<B>;
+  if constexpr (std::is_same_v<SA, SB>) {
+    if constexpr (std::is_same_v<SA, std::span<const double>>) {
+      return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    } else {
+      return a == b;
+    }
+  } else {
+    return false;
+  }
+}
+
+template <typename GP, typename Key>
+std::ostream &print_prop_value(std::ostream &os, const GP &gp, const Key &k) {
+  gp.visit_value(k, [&](const auto &value) {
+    using S = std::decay_t<decltype(value)>;
+    if constexpr (std::is_same_v<S, std::span<const double>>) {
+      utils::operator<<(os, std::vector<double>(value.begin(), value.end()));
+    } else {
+      os << value;
+    }
+  });
+  return os;
+}
+
+template <typename T, typename GP, typename Key>
+T get_prop_value(const GP &gp, const Key &k) {
+  return gp.visit_value(k, [](const auto &value) -> T {
+    using S = std::decay_t<decltype(value)>;
+    if constexpr (std::is_same_v<S, std::span<const double>> &&
+                  std::is_same_v<T, std::vector<double>>) {
+      return T(value.begin(), value.end());
+    } else if constexpr (std::is_convertible_v<const S &, T>) {
+      return static_cast<T>(value);
+    } else {
+      throw std::bad_variant_access();
+    }
+  });
+}
+
+template <typename T>
+struct is_prop_value_proxy : std::false_type {};
+
+} // namespace detail
+
+/**
+ * @brief Reference-like handle to the value of one key of a GenericProp.
+ * Works the same whether the property is stored as a map or as a column.
+ */
 template <typename Key, template <typename...> typename MapType,
           typename GraphType>
 struct GenericPropValueProxy {
@@ -30,226 +133,103 @@ struct GenericPropValueProxy {
   GenericPropValueProxy(const Key &k, GenericProp<MapType, GraphType> &gp)
       : k{k}, gp{gp} {}
 
+  GenericPropValueProxy(const GenericPropValueProxy &rhs)
+      : k{rhs.k}, gp{rhs.gp} {}
+
   template <Arithmetic T>
   GenericPropValueProxy &operator=(const T &n) {
-    std::get<MapType<std::string, GraphType>>(gp.p)[k] = static_cast<double>(n);
+    gp.set(k, static_cast<double>(n));
+    return *this;
   }
 
   template <Arithmetic T>
   GenericPropValueProxy &operator=(const std::vector<T> &v) {
-    std::vector<double> tmp;
-    tmp.reserve(v.size());
-    for (const auto &e : v) {
-      tmp.push_back(static_cast<double>(e));
+    if constexpr (std::is_same_v<T, double>) {
+      gp.set(k, std::span<const double>(v));
+    } else {
+      std::vector<double> tmp;
+      tmp.reserve(v.size());
+      for (const auto &e : v) {
+        tmp.push_back(static_cast<double>(e));
+      }
+      gp.set(k, std::span<const double>(tmp));
     }
-    std::get<MapType<std::vector<double>, GraphType>>(gp.p)[k] = std::move(tmp);
     return *this;
   }
 
-  GenericPropValueProxy(const GenericPropValueProxy &rhs)
-      : k{rhs.k}, gp{rhs.gp} {}
-
   GenericPropValueProxy &operator=(const std::string &s) {
-    std::get<MapType<std::string, GraphType>>(gp.p)[k] = s;
+    gp.set(k, s);
     return *this;
   }
 
   GenericPropValueProxy &operator=(const char *s) {
-    std::get<MapType<std::string, GraphType>>(gp.p)[k] = std::string(s);
+    gp.set(k, std::string(s));
     return *this;
   }
 
-  std::size_t size() const {
-
-    return std::visit(
-        overload{
-            [](const MapType<std::string, GraphType> &m) { return m.size(); },
-            [](const MapType<double, GraphType> &m) { return m.size(); },
-            [](const MapType<std::vector<double>, GraphType> &m) {
-              return m.size();
-            },
-        },
-        gp.p);
-  }
+  std::size_t size() const { return gp.size(); }
 
+  /**
+   * @brief Copies the value of another key (possibly of another property).
+   * If this property is still empty, it takes on the kind of the source
+   * value.
+   */
   GenericPropValueProxy &operator=(const GenericPropValueProxy &rhs) {
     if (this == &rhs) {
       return *this;
     }
-
-    if (std::holds_alternative<MapType<std::string, GraphType>>(gp.p)) {
-
-      if (size() == 0) {
-        gp.template emplace<MapType<std::string, GraphType>>();
-      }
-
-      std::get<MapType<std::string, GraphType>>(gp.p)[k] =
-          std::get<MapType<std::string, GraphType>>(rhs.gp.p).at(rhs.k);
-
-    } else if (std::holds_alternative<MapType<double, GraphType>>(gp.p)) {
-
-      if (size() == 0) {
-        gp.template emplace<MapType<double, GraphType>>();
-      }
-
-      std::get<MapType<double, GraphType>>(gp.p)[k] =
-          std::get<MapType<double, GraphType>>(rhs.gp.p).at(rhs.k);
-
-    } else if (std::holds_alternative<MapType<std::vector<double>, GraphType>>(
-                   gp.p)) {
-
-      if (size() == 0) {
-        gp.template emplace<MapType<std::vector<double>, GraphType>>();
-      }
-
-      std::get<MapType<std::vector<double>, GraphType>>(gp.p)[k] =
-          std::get<MapType<std::vector<double>, GraphType>>(rhs.gp.p).at(rhs.k);
-    }
-
+    rhs.gp.visit_value(rhs.k, [&](const auto &value) { gp.set(k, value); });
     return *this;
   }
 
   template <typename K, template <typename...> typename M, typename G>
   GenericPropValueProxy &
   operator=(const ConstGenericPropValueProxy<K, M, G> &rhs) {
-
-    if (std::holds_alternative<M<std::string, G>>(rhs.gp.p)) {
-
-      if (size() == 0) {
-        gp.template emplace<MapType<std::string, GraphType>>();
-      }
-
-      std::get<M<std::string, G>>(gp.p)[k] =
-          std::get<M<std::string, G>>(rhs.gp.p).at(rhs.k);
-
-    } else if (std::holds_alternative<M<double, G>>(rhs.gp.p)) {
-
-      if (size() == 0) {
-        gp.template emplace<MapType<double, GraphType>>();
-      }
-
-      std::get<M<double, G>>(gp.p)[k] =
-          std::get<M<double, G>>(rhs.gp.p).at(rhs.k);
-
-    } else if (std::holds_alternative<M<std::vector<double>, G>>(rhs.gp.p)) {
-
-      if (size() == 0) {
-        gp.template emplace<MapType<std::vector<double>, GraphType>>();
-      }
-
-      std::get<M<std::vector<double>, G>>(gp.p)[k] =
-          std::get<M<std::vector<double>, G>>(rhs.gp.p).at(rhs.k);
-    }
-
+    rhs.gp.visit_value(rhs.k, [&](const auto &value) { gp.set(k, value); });
     return *this;
   }
 
   GenericPropValueProxy() = default;
 
+  /**
+   * @brief Reference to the stored value. For a columnar vector property
+   * there is no std::vector to refer to, so use values() or get() instead.
+   */
   template <typename T>
   operator T &() {
+    if constexpr (std::is_same_v<T, double>) {
+      if (auto *c = std::get_if<ScalarColumn>(&gp.p)) {
+        return c->at(gp.column_index(k));
+      }
+    }
     return std::get<MapType<T, GraphType>>(gp.p)[k];
   }
 
-  template <typename K, template <typename...> typename M, typename G>
-  friend std::ostream &operator<<(std::ostream &os,
-                                  const GenericPropValueProxy<K, M, G> &gp);
-
-  template <typename K, template <typename...> typename M, typename G,
-            typename T>
-  friend bool operator==(const GenericPropValueProxy<K, M, G> &lhs,
-                         const T &rhs);
-
-  template <typename K, template <typename...> typename M, typename G,
-            typename T>
-  friend bool operator==(const GenericPropValueProxy<K, M, G> &lhs,
-                         const GenericPropValueProxy<K, M, G> &rhs);
-
-  template <typename K, template <typename...> typename M, typename G,
-            typename T>
-  friend bool operator==(const GenericPropValueProxy<K, M, G> &lhs,
-                         const ConstGenericPropValueProxy<K, M, G> &rhs);
-};
-
-template <typename K, template <typename...> typename M, typename G>
-std::ostream &operator<<(std::ostream &os,
-                         const GenericPropValueProxy<K, M, G> &gp) {
-  if (std::holds_alternative<M<std::string, G>>(gp.gp.p)) {
-    os << std::get<M<std::string, G>>(gp.gp.p).at(gp.k);
-  } else if (std::holds_alternative<M<double, G>>(gp.gp.p)) {
-    os << std::get<M<double, G>>(gp.gp.p).at(gp.k);
-  } else if (std::holds_alternative<M<std::vector<double>, G>>(gp.gp.p)) {
-    utils::operator<<(os,
-                      std::get<M<std::vector<double>, G>>(gp.gp.p).at(gp.k));
-  }
-
-  return os;
-}
-
-template <typename K, template <typename...> typename M, typename G, typename T>
-bool operator==(const GenericPropValueProxy<K, M, G> &lhs, const T &rhs) {
-  if constexpr (std::is_same_v<T, GenericPropValueProxy<K, M, G>>) { // RHS is
-                                                                     // generic
-
-    return std::get<M<std::string, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<std::string, G>>(rhs.gp.p)[rhs.k];
-
-  } else if constexpr (std::is_same_v<T,
-                                      M<std::string, G>>) { // RHS is string map
-
-    return std::get<M<std::string, G>>(lhs.gp.p)[lhs.k] == rhs;
-
-  } else if constexpr (std::is_same_v<T, M<double, G>>) {
-
-    return std::get<M<double, G>>(lhs.gp.p)[lhs.k] == rhs;
-
-  } else if constexpr (std::is_same_v<T, M<std::vector<double>, G>>) {
-
-    return std::get<M<std::vector<double>, G>>(lhs.gp.p)[lhs.k] == rhs;
-
-  } else {
-    return false;
-  }
-}
-
-template <typename K, template <typename...> typename M, typename G>
-bool operator==(const GenericPropValueProxy<K, M, G> &lhs,
-                const GenericPropValueProxy<K, M, G> &rhs) {
-
-  if (lhs.gp.p.index() != rhs.gp.p.index()) {
-    return false;
+  /**
+   * @brief Copy of the stored value, for any storage.
+   */
+  template <typename T>
+  T get() const {
+    return detail::get_prop_value<T>(gp, k);
   }
 
-  if (std::holds_alternative<M<std::string, G>>(lhs.gp.p)) {
-    return std::get<M<std::string, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<std::string, G>>(rhs.gp.p)[rhs.k];
-  } else if (std::holds_alternative<M<double, G>>(lhs.gp.p)) {
-    return std::get<M<double, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<double, G>>(rhs.gp.p)[rhs.k];
-  } else if (std::holds_alternative<M<std::vector<double>, G>>(lhs.gp.p)) {
-    return std::get<M<std::vector<double>, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<std::vector<double>, G>>(rhs.gp.p)[rhs.k];
+  /**
+   * @brief View of the doubles of a vector property, for map and columnar
+   * storage alike.
+   */
+  std::span<double> values() {
+    if (auto *c = std::get_if<VectorColumn>(&gp.p)) {
+      return c->at(gp.column_index(k));
+    }
+    auto &m = std::get<MapType<std::vector<double>, GraphType>>(gp.p);
+    return m.at(k);
   }
-}
+};
 
 template <typename K, template <typename...> typename M, typename G>
-bool operator==(const GenericPropValueProxy<K, M, G> &lhs,
-                const ConstGenericPropValueProxy<K, M, G> &rhs) {
-
-  if (lhs.gp.p.index() != rhs.gp.p.index()) {
-    return false;
-  }
-
-  if (std::holds_alternative<M<std::string, G>>(lhs.gp.p)) {
-    return std::get<M<std::string, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<std::string, G>>(rhs.gp.p)[rhs.k];
-  } else if (std::holds_alternative<M<double, G>>(lhs.gp.p)) {
-    return std::get<M<double, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<double, G>>(rhs.gp.p)[rhs.k];
-  } else if (std::holds_alternative<M<std::vector<double>, G>>(lhs.gp.p)) {
-    return std::get<M<std::vector<double>, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<std::vector<double>, G>>(rhs.gp.p)[rhs.k];
-  }
+std::ostream &operator<<(std::ostream &os,
+                         const GenericPropValueProxy<K, M, G> &gp) {
+  return detail::print_prop_value(os, gp.gp, gp.k);
 }
 
 // Const version
@@ -268,149 +248,80 @@ struct ConstGenericPropValueProxy {
   ConstGenericPropValueProxy(const ConstGenericPropValueProxy &rhs)
       : k{rhs.k}, gp{rhs.gp} {}
 
-  std::size_t size() const {
-
-    return std::visit(
-        overload{
-            [](const MapType<std::string, GraphType> &m) { return m.size(); },
-            [](const MapType<double, GraphType> &m) { return m.size(); },
-            [](const MapType<std::vector<double>, GraphType> &m) {
-              return m.size();
-            },
-        },
-        gp.p);
-  }
+  std::size_t size() const { return gp.size(); }
 
-  ConstGenericPropValueProxy &operator=(const ConstGenericPropValueProxy &rhs) {
-    if (this == &rhs) {
-      return *this;
+  /**
+   * @brief Reference to the stored value. For a columnar vector property
+   * there is no std::vector to refer to, so use values() or get() instead.
+   */
+  template <typename T>
+  operator const T &() const {
+    if constexpr (std::is_same_v<T, double>) {
+      if (auto *c = std::get_if<ScalarColumn>(&gp.p)) {
+        return c->values.at(gp.column_index(k));
+      }
     }
-
-    std::visit(
-        overload{
-            [&](MapType<std::string, GraphType> &m) {
-              m[k] = std::get<MapType<std::string, GraphType>>(rhs.gp.p)[rhs.k];
-            },
-            [&](MapType<double, GraphType> &m) {
-              m[k] = std::get<MapType<double, GraphType>>(rhs.gp.p)[rhs.k];
-            },
-            [&](MapType<std::vector<double>, GraphType> &m) {
-              m[k] = std::get<MapType<std::vector<double>, GraphType>>(
-                  rhs.gp.p)[rhs.k];
-            },
-        },
-        rhs.gp.p);
-
-    return *this;
+    return std::get<MapType<T, GraphType>>(gp.p).at(k);
   }
 
-  ConstGenericPropValueProxy() = default;
-
+  /**
+   * @brief Copy of the stored value, for any storage.
+   */
   template <typename T>
-  operator const T &() const {
-    std::get<MapType<T, GraphType>>(gp.p)[k];
+  T get() const {
+    return detail::get_prop_value<T>(gp, k);
   }
 
-  template <typename K, template <typename...> typename M, typename G>
-  friend std::ostream &
-  operator<<(std::ostream &os, const ConstGenericPropValueProxy<K, M, G> &gp);
-
-  template <typename K, template <typename...> typename M, typename G,
-            typename T>
-  friend bool operator==(const ConstGenericPropValueProxy<K, M, G> &lhs,
-                         const T &rhs);
-
-  template <typename K, template <typename...> typename M, typename G,
-            typename T>
-  friend bool operator==(const ConstGenericPropValueProxy<K, M, G> &lhs,
-                         const ConstGenericPropValueProxy<K, M, G> &rhs);
-
-  template <typename K, template <typename...> typename M, typename G,
-            typename T>
-  friend bool operator==(const ConstGenericPropValueProxy<K, M, G> &lhs,
-                         const GenericPropValueProxy<K, M, G> &rhs);
+  /**
+   * @brief View of the doubles of a vector property, for map and columnar
+   * storage alike.
+   */
+  std::span<const double> values() const {
+    return gp.visit_value(k, [](const auto &value) -> std::span<const double> {
+      if constexpr (std::is_same_v<std::decay_t<decltype(value)>,
+                                   std::span<const double>>) {
+        return value;
+      } else {
+        throw std::bad_variant_access();
+      }
+    });
+  }
 };
 
 template <typename K, template <typename...> typename M, typename G>
 std::ostream &operator<<(std::ostream &os,
                          const ConstGenericPropValueProxy<K, M, G> &gp) {
-  if (std::holds_alternative<M<std::string, G>>(gp.gp.p)) {
-    os << std::get<M<std::string, G>>(gp.gp.p).at(gp.k);
-  } else if (std::holds_alternative<M<double, G>>(gp.gp.p)) {
-    os << std::get<M<double, G>>(gp.gp.p).at(gp.k);
-  } else if (std::holds_alternative<M<std::vector<double>, G>>(gp.gp.p)) {
-    utils::operator<<(os,
-                      std::get<M<std::vector<double>, G>>(gp.gp.p).at(gp.k));
-  }
-
-  return os;
+  return detail::print_prop_value(os, gp.gp, gp.k);
 }
 
-template <typename K, template <typename...> typename M, typename G, typename T>
-bool operator==(const ConstGenericPropValueProxy<K, M, G> &lhs, const T &rhs) {
-  if constexpr (std::is_same_v<T,
-                               ConstGenericPropValueProxy<K, M, G>>) { // RHS is
-    // generic
-
-    return std::get<M<std::string, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<std::string, G>>(rhs.gp.p)[rhs.k];
-
-  } else if constexpr (std::is_same_v<T,
-                                      M<std::string, G>>) { // RHS is string map
-
-    return std::get<M<std::string, G>>(lhs.gp.p)[lhs.k] == rhs;
-
-  } else if constexpr (std::is_same_v<T, M<double, G>>) {
-
-    return std::get<M<double, G>>(lhs.gp.p)[lhs.k] == rhs;
-
-  } else if constexpr (std::is_same_v<T, M<std::vector<double>, G>>) {
-
-    return std::get<M<std::vector<double>, G>>(lhs.gp.p)[lhs.k] == rhs;
-
-  } else {
-    return false;
-  }
-}
+namespace detail {
 
 template <typename K, template <typename...> typename M, typename G>
-bool operator==(const ConstGenericPropValueProxy<K, M, G> &lhs,
-                const ConstGenericPropValueProxy<K, M, G> &rhs) {
-
-  if (lhs.gp.p.index() != rhs.gp.p.index()) {
-    return false;
-  }
-
-  if (std::holds_alternative<M<std::string, G>>(lhs.gp.p)) {
-    return std::get<M<std::string, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<std::string, G>>(rhs.gp.p)[rhs.k];
-  } else if (std::holds_alternative<M<double, G>>(lhs.gp.p)) {
-    return std::get<M<double, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<double, G>>(rhs.gp.p)[rhs.k];
-  } else if (std::holds_alternative<M<std::vector<double>, G>>(lhs.gp.p)) {
-    return std::get<M<std::vector<double>, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<std::vector<double>, G>>(rhs.gp.p)[rhs.k];
-  }
-}
+struct is_prop_value_proxy<GenericPropValueProxy<K, M, G>> : std::true_type {};
 
 template <typename K, template <typename...> typename M, typename G>
-bool operator==(const ConstGenericPropValueProxy<K, M, G> &lhs,
-                const GenericPropValueProxy<K, M, G> &rhs) {
-
-  if (lhs.gp.p.index() != rhs.gp.p.index()) {
-    return false;
-  }
-
-  if (std::holds_alternative<M<std::string, G>>(lhs.gp.p)) {
-    return std::get<M<std::string, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<std::string, G>>(rhs.gp.p)[rhs.k];
-  } else if (std::holds_alternative<M<double, G>>(lhs.gp.p)) {
-    return std::get<M<double, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<double, G>>(rhs.gp.p)[rhs.k];
-  } else if (std::holds_alternative<M<std::vector<double>, G>>(lhs.gp.p)) {
-    return std::get<M<std::vector<double>, G>>(lhs.gp.p)[lhs.k] ==
-           std::get<M<std::vector<double>, G>>(rhs.gp.p)[rhs.k];
-  }
+struct is_prop_value_proxy<ConstGenericPropValueProxy<K, M, G>>
+    : std::true_type {};
+
+} // namespace detail
+
+/**
+ * @brief Compares the value behind a proxy with another proxy's value or with
+ * a plain value (a number, a string or a vector of numbers). Values of
+ * different kinds compare unequal.
+ */
+template <typename L, typename R>
+  requires detail::is_prop_value_proxy<L>::value
+bool operator==(const L &lhs, const R &rhs) {
+  return lhs.gp.visit_value(lhs.k, [&](const auto &a) {
+    if constexpr (detail::is_prop_value_proxy<R>::value) {
+      return rhs.gp.visit_value(rhs.k, [&](const auto &b) {
+        return detail::prop_values_equal(a, b);
+      });
+    } else {
+      return detail::prop_value_equals(a, rhs);
+    }
+  });
 }
 
 } // namespace gl
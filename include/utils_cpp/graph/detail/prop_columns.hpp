@@ -0,0 +1,159 @@
+/**********************************************************************
+ * @brief Columnar (struct-of-arrays) storage for vertex properties.
+ * @details Used by GenericProp as an alternative to one hash map entry per
+ *vertex. A scalar property is a single contiguous column of doubles, and a
+ *vector property is one flat buffer of doubles plus an offsets array, so
+ *neither allocates per vertex and both copy as a couple of memcpys.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace utils {
+namespace gl {
+
+/**
+ * @brief A scalar vertex property stored as one column: the value of vertex
+ * v is values[v].
+ */
+struct ScalarColumn {
+  std::vector<double> values;
+
+  std::size_t size() const noexcept { return values.size(); }
+
+  double &at(std::size_t v) { return values.at(v); }
+  double at(std::size_t v) const { return values.at(v); }
+
+  /**
+   * @brief Sets the value of v, growing the column (with zeros) if needed.
+   */
+  void assign(std::size_t v, double value) {
+    if (v >= values.size()) {
+      values.resize(v + 1, 0.0);
+    }
+    values[v] = value;
+  }
+
+  friend bool operator==(const ScalarColumn &lhs,
+                         const ScalarColumn &rhs) = default;
+};
+
+/**
+ * @brief A vector-valued vertex property stored as a flat buffer: the value
+ * of vertex v is values[offsets[v] .. offsets[v+1]).
+ *
+ * @details Overwriting a value with one of the same length is done in place.
+ * Changing a value's length shifts everything after it, so this layout is
+ * meant for properties that are written once and then read many times.
+ */
+struct VectorColumn {
+  std::vector<double> values;
+  std::vector<std::size_t> offsets{0};
+
+  std::size_t size() const noexcept { return offsets.size() - 1; }
+
+  std::span<double> at(std::size_t v) {
+    check(v);
+    return {values.data() + offsets[v], offsets[v + 1] - offsets[v]};
+  }
+
+  std::span<const double> at(std::size_t v) const {
+    check(v);
+    return {values.data() + offsets[v], offsets[v + 1] - offsets[v]};
+  }
+
+  void push_back(std::span<const double> value) {
+    values.insert(values.end(), value.begin(), value.end());
+    offsets.push_back(values.size());
+  }
+
+  /**
+   * @brief Sets the value of v, growing the column (with empty values) if
+   * needed.
+   */
+  void assign(std::size_t v, std::span<const double> value) {
+    while (v >= size()) {
+      offsets.push_back(values.size());
+    }
+
+    std::size_t begin = offsets[v];
+    std::size_t old_size = offsets[v + 1] - begin;
+
+    if (value.size() == old_size) {
+      std::copy(value.begin(), value.end(), values.begin() + begin);
+      return;
+    }
+
+    std::vector<double> copy(value.begin(), value.end()); // value may alias
+    values.erase(values.begin() + begin, values.begin() + begin + old_size);
+    values.insert(values.begin() + begin, copy.begin(), copy.end());
+
+    for (std::size_t i = v + 1; i < offsets.size(); ++i) {
+      offsets[i] = offsets[i] - old_size + copy.size();
+    }
+  }
+
+  friend bool operator==(const VectorColumn &lhs,
+                         const VectorColumn &rhs) = default;
+
+private:
+  void check(std::size_t v) const {
+    if (v >= size()) {
+      throw std::out_of_range("VectorColumn: vertex out of range");
+    }
+  }
+};
+
+/**
+ * @brief Columns serialize like the VertexMaps they replace, i.e. as a list
+ * of [vertex, value] pairs.
+ */
+inline void to_json(nlohmann::json &j, const ScalarColumn &c) {
+  j = nlohmann::json::array();
+  for (std::size_t v = 0; v < c.size(); ++v) {
+    j.push_back({v, c.values[v]});
+  }
+}
+
+inline void to_json(nlohmann::json &j, const VectorColumn &c) {
+  j = nlohmann::json::array();
+  for (std::size_t v = 0; v < c.size(); ++v) {
+    auto value = c.at(v);
+    j.push_back({v, std::vector<double>(value.begin(), value.end())});
+  }
+}
+
+inline std::ostream &operator<<(std::ostream &os, const ScalarColumn &c) {
+  os << "{";
+  for (std::size_t v = 0; v < c.size(); ++v) {
+    os << (v ? ", " : "") << v << ": " << c.values[v];
+  }
+  return os << "}";
+}
+
+inline std::ostream &operator<<(std::ostream &os, const VectorColumn &c) {
+  os << "{";
+  for (std::size_t v = 0; v < c.size(); ++v) {
+    os << (v ? ", " : "") << v << ": [";
+    auto value = c.at(v);
+    for (std::size_t i = 0; i < value.size(); ++i) {
+      os << (i ? ", " : "") << value[i];
+    }
+    os << "]";
+  }
+  return os << "}";
+}
+
+} // namespace gl
+} // namespace utils
@@ -0,0 +1,109 @@
+/**********************************************************************
+ * @brief Radix heap: a monotone priority queue for unsigned integer keys.
+ * @details Used by Dijkstra on CsrGraphs with unsigned integer weights.
+ *Entries are kept in buckets by the highest bit in which their key differs
+ *from the last key popped, so push is O(1) and each entry is moved between
+ *buckets at most once per bit of the key.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace gl {
+namespace detail {
+
+/**
+ * @internal
+ * @brief Min-queue of (key, value) pairs where keys are never pushed below
+ * the last key popped, as in Dijkstra with non-negative weights.
+ */
+template <typename Key, typename Value = std::size_t>
+class RadixHeap {
+  static_assert(std::is_unsigned_v<Key>, "RadixHeap needs unsigned keys");
+
+public:
+  bool empty() const noexcept { return size_ == 0; }
+  std::size_t size() const noexcept { return size_; }
+
+  /**
+   * @brief Removes all entries, keeping the bucket storage.
+   */
+  void clear() noexcept {
+    for (auto &b : buckets_) {
+      b.clear();
+    }
+    size_ = 0;
+    last_ = 0;
+  }
+
+  /**
+   * @brief Adds an entry. key must not be less than the last key popped.
+   */
+  void push(Key key, Value value) {
+    buckets_[bucket(key)].emplace_back(key, value);
+    ++size_;
+  }
+
+  /**
+   * @brief Removes and returns an entry with the smallest key. The heap must
+   * not be empty.
+   */
+  std::pair<Key, Value> pop();
+
+private:
+  std::size_t bucket(Key key) const noexcept {
+    return key == last_ ? 0 : std::bit_width(static_cast<Key>(key ^ last_));
+  }
+
+  std::array<std::vector<std::pair<Key, Value>>,
+             std::numeric_limits<Key>::digits + 1>
+      buckets_;
+  Key last_ = 0;
+  std::size_t size_ = 0;
+};
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+template <typename Key, typename Value>
+std::pair<Key, Value> RadixHeap<Key, Value>::pop() {
+  if (buckets_[0].empty()) {
+    std::size_t i = 1;
+    while (buckets_[i].empty()) {
+      ++i;
+    }
+
+    // Every entry of bucket i agrees with the new minimum above bit i-1, so
+    // they all land in lower buckets.
+    auto &b = buckets_[i];
+    last_ = std::min_element(b.begin(), b.end(), [](auto &x, auto &y) {
+              return x.first < y.first;
+            })->first;
+    for (const auto &entry : b) {
+      buckets_[bucket(entry.first)].push_back(entry);
+    }
+    b.clear();
+  }
+
+  auto top = buckets_[0].back();
+  buckets_[0].pop_back();
+  --size_;
+  return top;
+}
+
+} // namespace detail
+} // namespace gl
+} // namespace utils
@@ -0,0 +1,745 @@
+/**********************************************************************
+ * @brief Precomputed distance indices for answering many queries on the
+ * same graph.
+ * @details LandmarkIndex stores the distances between every vertex and a few
+ *landmarks, and turns them into a triangle-inequality (ALT) lower bound that
+ *can be used as an A-star heuristic. It is much tighter than a geometric
+ *heuristic on graphs that are not planar-like, e.g. chimera. DistanceTable
+ *stores all pairs, for graphs small enough to afford n^2 entries, so a query
+ *is a single lookup. DynamicDistanceTable keeps the all-pairs hop distances of
+ *an unweighted graph current as edges are added and removed.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/graph.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+#include "utils_cpp/matrix.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace gl {
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Distances are stored as 32-bit integers for integer weights, and in
+ * the weight type otherwise.
+ */
+template <typename WeightType>
+using oracle_storage_t =
+    std::conditional_t<std::is_integral_v<WeightType>, std::uint32_t,
+                       WeightType>;
+
+/**
+ * @internal
+ * @brief Converts a distance to the storage type, mapping unreachable to
+ * unreachable.
+ *
+ * @throws std::overflow_error if a finite distance does not fit.
+ */
+template <typename StorageType, typename WeightType>
+StorageType to_oracle_storage(WeightType d) {
+  constexpr StorageType unreachable = std::numeric_limits<StorageType>::max();
+  if (d == std::numeric_limits<WeightType>::max()) {
+    return unreachable;
+  }
+  if constexpr (std::is_integral_v<WeightType>) {
+    if (static_cast<std::uintmax_t>(d) >= unreachable) {
+      throw std::overflow_error(
+          "distance oracle: distance does not fit the storage type");
+    }
+  }
+  return static_cast<StorageType>(d);
+}
+
+} // namespace detail
+
+template <typename WeightType, typename StorageType>
+class LandmarkHeuristic;
+
+/**
+ * @brief Landmark (ALT) lower bounds on shortest-path distances.
+ *
+ * @details For every landmark L and vertices u, t, the triangle inequality
+ * gives d(u,t) >= d(L,t) - d(L,u) and d(u,t) >= d(u,L) - d(t,L). The index
+ * stores d(L,v) (and d(v,L) for directed graphs) for every vertex, one row of
+ * num_landmarks() entries per vertex, and the bound is the largest of these
+ * differences. Edge weights must be non-negative.
+ *
+ * @tparam WeightType Weight type of the graph.
+ * @tparam StorageType Type of the stored distances, std::uint32_t for integer
+ * weights.
+ */
+template <typename WeightType = std::size_t,
+          typename StorageType = detail::oracle_storage_t<WeightType>>
+class LandmarkIndex {
+public:
+  static constexpr StorageType unreachable =
+      std::numeric_limits<StorageType>::max();
+
+  /**
+   * @brief Picks num_landmarks landmarks by farthest-point selection: each
+   * new landmark is the vertex farthest from the ones already chosen, and
+   * vertices no landmark reaches are picked first. The distances from the
+   * landmarks in a directed graph are computed on 'pool' if given.
+   */
+  LandmarkIndex(const CsrGraph<WeightType> &g, std::size_t num_landmarks,
+                parallel::thread_pool *pool = nullptr);
+
+  /**
+   * @brief Uses the given landmarks. The Dijkstra searches from them run on
+   * 'pool' if given.
+   */
+  LandmarkIndex(const CsrGraph<WeightType> &g,
+                const std::vector<std::size_t> &landmarks,
+                parallel::thread_pool *pool = nullptr);
+
+  /**
+   * @brief Landmark index of a Graph or DiGraph with the given weights.
+   */
+  template <typename GraphType>
+  LandmarkIndex(const GraphType &g, const EdgeMap<WeightType, GraphType> &w,
+                std::size_t num_landmarks,
+                parallel::thread_pool *pool = nullptr)
+      : LandmarkIndex(CsrGraph(g, w), num_landmarks, pool) {}
+
+  std::size_t num_vertices() const noexcept { return from_.shape().first; }
+  std::size_t num_landmarks() const noexcept { return landmarks_.size(); }
+  const std::vector<std::size_t> &landmarks() const noexcept {
+    return landmarks_;
+  }
+
+  /**
+   * @brief Distance from landmark i to v, or unreachable.
+   */
+  StorageType from_landmark(std::size_t i, std::size_t v) const {
+    return from_(v, i);
+  }
+
+  /**
+   * @brief Distance from v to landmark i, or unreachable.
+   */
+  StorageType to_landmark(std::size_t i, std::size_t v) const {
+    return directed_ ? to_(v, i) : from_(v, i);
+  }
+
+  /**
+   * @brief A lower bound on the distance from u to t.
+   */
+  WeightType lower_bound(std::size_t u, std::size_t t) const;
+
+  /**
+   * @brief A-star heuristic for reaching goal, for astar,
+   * astar_early_stopping and the CsrGraph astar_early_stopping.
+   */
+  LandmarkHeuristic<WeightType, StorageType> heuristic(std::size_t goal) const {
+    return {*this, goal};
+  }
+
+private:
+  friend class LandmarkHeuristic<WeightType, StorageType>;
+
+  std::vector<std::size_t> landmarks_;
+  Matrix<StorageType> from_; // from_(v, i) = d(landmark i, v)
+  Matrix<StorageType> to_;   // to_(v, i) = d(v, landmark i), directed only
+  bool directed_ = false;
+
+  void store_row(Matrix<StorageType> &m, std::size_t i,
+                 const PathfindingWorkspace<WeightType> &ws);
+  void compute_to(const CsrGraph<WeightType> &g, parallel::thread_pool *pool);
+
+  static WeightType bound(const StorageType *from_u, const StorageType *from_t,
+                          const StorageType *to_u, const StorageType *to_t,
+                          std::size_t k);
+};
+
+/**
+ * @brief A-star heuristic from a LandmarkIndex. It copies the goal's row of
+ * the index, so each call only reads the row of the vertex being evaluated.
+ * The index must outlive the heuristic.
+ */
+template <typename WeightType, typename StorageType>
+class LandmarkHeuristic {
+public:
+  LandmarkHeuristic(const LandmarkIndex<WeightType, StorageType> &index,
+                    std::size_t goal);
+
+  WeightType operator()(std::size_t v) const;
+
+private:
+  const LandmarkIndex<WeightType, StorageType> *index;
+  std::vector<StorageType> goal_from;
+  std::vector<StorageType> goal_to;
+};
+
+/**
+ * @brief Exact all-pairs distance table, where a query is a single load.
+ * Needs num_vertices()^2 entries of StorageType, so it is meant for small
+ * graphs.
+ */
+template <typename WeightType = std::size_t,
+          typename StorageType = detail::oracle_storage_t<WeightType>>
+class DistanceTable {
+public:
+  static constexpr StorageType unreachable =
+      std::numeric_limits<StorageType>::max();
+
+  /**
+   * @brief Runs one Dijkstra per vertex, in parallel on 'pool' if given.
+   */
+  explicit DistanceTable(const CsrGraph<WeightType> &g,
+                         parallel::thread_pool *pool = nullptr);
+
+  template <typename GraphType>
+  DistanceTable(const GraphType &g, const EdgeMap<WeightType, GraphType> &w,
+                parallel::thread_pool *pool = nullptr)
+      : DistanceTable(CsrGraph(g, w), pool) {}
+
+  std::size_t num_vertices() const noexcept { return table.shape().first; }
+
+  /**
+   * @brief The distance from u to v, or
+   * std::numeric_limits<WeightType>::max() if v is unreachable from u.
+   */
+  WeightType operator()(std::size_t u, std::size_t v) const {
+    StorageType d = table(u, v);
+    return d == unreachable ? std::numeric_limits<WeightType>::max()
+                            : static_cast<WeightType>(d);
+  }
+
+  const Matrix<StorageType> &matrix() const noexcept { return table; }
+
+  /**
+   * @brief The exact (perfect) A-star heuristic for reaching goal. The table
+   * must outlive it.
+   */
+  auto heuristic(std::size_t goal) const {
+    return [this, goal](std::size_t v) { return (*this)(v, goal); };
+  }
+
+private:
+  Matrix<StorageType> table;
+};
+
+/**
+ * @brief All-pairs hop distances of an unweighted graph that stay up to date
+ * as edges are added and removed, without recomputing every pair.
+ *
+ * @details The table holds the same matrix as floyd_warshall_matrix() on the
+ * current graph. Adding an edge (u, v) can only shorten paths through it, so
+ * each row s is lowered in O(n) with d(s, t) = min(d(s, t), d(s, u) + 1 +
+ * d(v, t)), skipping the rows for which the edge is not a shortcut. Removing
+ * an edge (u, v) can only lengthen paths from a source s if v's distance
+ * depended on it: d(s, u) + 1 == d(s, v), and no other in-neighbour w of v
+ * has d(s, w) + 1 == d(s, v). Only the rows of those sources are recomputed,
+ * by BFS. Rows are updated in parallel on 'pool' if given.
+ *
+ * Self-loops and parallel edges are ignored, as by floyd_warshall_matrix().
+ *
+ * @tparam DistanceType Type of the stored distances, as in
+ * floyd_warshall_matrix().
+ */
+template <typename DistanceType = int>
+class DynamicDistanceTable {
+public:
+  static constexpr DistanceType unreachable =
+      std::numeric_limits<DistanceType>::max();
+
+  /**
+   * @brief Builds the table for num_vertices vertices and the given edges by
+   * one BFS per vertex.
+   *
+   * @throws std::out_of_range if an endpoint is not less than num_vertices.
+   */
+  DynamicDistanceTable(
+      std::size_t num_vertices,
+      const std::vector<std::pair<std::size_t, std::size_t>> &edges,
+      bool directed = false, parallel::thread_pool *pool = nullptr);
+
+  explicit DynamicDistanceTable(const Graph &g,
+                                parallel::thread_pool *pool = nullptr)
+      : DynamicDistanceTable(boost::num_vertices(g), edge_pairs(g), false,
+                             pool) {}
+
+  explicit DynamicDistanceTable(const DiGraph &g,
+                                parallel::thread_pool *pool = nullptr)
+      : DynamicDistanceTable(boost::num_vertices(g), edge_pairs(g), true,
+                             pool) {}
+
+  std::size_t num_vertices() const noexcept { return adjacency_.size(); }
+  bool is_directed() const noexcept { return directed_; }
+
+  /**
+   * @brief The distance from u to v, or unreachable.
+   */
+  DistanceType operator()(std::size_t u, std::size_t v) const {
+    return table_(u, v);
+  }
+
+  const Matrix<DistanceType> &matrix() const noexcept { return table_; }
+
+  bool has_edge(std::size_t u, std::size_t v) const;
+
+  /**
+   * @brief Adds the edge (u, v) and lowers the distances it shortens.
+   *
+   * @return false, changing nothing, if the edge is already present or u ==
+   * v.
+   * @throws std::out_of_range if u or v is not a vertex.
+   */
+  bool add_edge(std::size_t u, std::size_t v);
+
+  /**
+   * @brief Removes the edge (u, v) and recomputes the rows of the sources
+   * whose shortest paths used it.
+   *
+   * @return false, changing nothing, if the edge is not present.
+   * @throws std::out_of_range if u or v is not a vertex.
+   */
+  bool remove_edge(std::size_t u, std::size_t v);
+
+  /**
+   * @brief The number of rows recomputed by BFS by remove_edge() since the
+   * table was built.
+   */
+  std::size_t rows_recomputed() const noexcept { return rows_recomputed_; }
+
+private:
+  std::vector<std::vector<std::size_t>> adjacency_; // out-neighbours
+  std::vector<std::vector<std::size_t>> in_adjacency_; // directed only
+  Matrix<DistanceType> table_;
+  bool directed_ = false;
+  parallel::thread_pool *pool_ = nullptr;
+  std::size_t rows_recomputed_ = 0;
+
+  template <typename GraphType>
+  static std::vector<std::pair<std::size_t, std::size_t>>
+  edge_pairs(const GraphType &g);
+
+  void check_vertex(std::size_t v) const;
+  void insert_arc(std::size_t u, std::size_t v);
+  void erase_arc(std::size_t u, std::size_t v);
+  bool depends_on(std::size_t s, std::size_t u, std::size_t v) const;
+  void bfs_row(std::size_t s, std::vector<std::size_t> &queue);
+  void bfs_rows(const std::vector<std::size_t> &sources);
+};
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+template <typename WeightType, typename StorageType>
+void LandmarkIndex<WeightType, StorageType>::store_row(
+    Matrix<StorageType> &m, std::size_t i,
+    const PathfindingWorkspace<WeightType> &ws) {
+  for (std::size_t v : ws.reached_vertices()) {
+    m(v, i) = detail::to_oracle_storage<StorageType>(ws.distance(v));
+  }
+}
+
+template <typename WeightType, typename StorageType>
+void LandmarkIndex<WeightType, StorageType>::compute_to(
+    const CsrGraph<WeightType> &g, parallel::thread_pool *pool) {
+  to_ = Matrix<StorageType>();
+  if (!directed_) {
+    return;
+  }
+  std::size_t n = g.num_vertices();
+  to_.resize(n, landmarks_.size(), unreachable);
+
+  auto dist = dijkstra_many(g.reversed(), landmarks_, pool);
+  for (std::size_t i = 0; i < landmarks_.size(); ++i) {
+    for (std::size_t v = 0; v < n; ++v) {
+      to_(v, i) = detail::to_oracle_storage<StorageType>(dist(i, v));
+    }
+  }
+}
+
+template <typename WeightType, typename StorageType>
+LandmarkIndex<WeightType, StorageType>::LandmarkIndex(
+    const CsrGraph<WeightType> &g, std::size_t num_landmarks,
+    parallel::thread_pool *pool)
+    : directed_{g.is_directed()} {
+  std::size_t n = g.num_vertices();
+  num_landmarks = std::min(num_landmarks, n);
+  from_.resize(n, num_landmarks, unreachable);
+  if (num_landmarks == 0) {
+    return;
+  }
+
+  PathfindingWorkspace<WeightType> ws(n);
+
+  // Distance from the nearest landmark so far. Vertices no landmark reaches
+  // keep 'unreachable', the largest value, so they are chosen first.
+  std::vector<StorageType> nearest(n, unreachable);
+  auto farthest = [&] {
+    std::size_t best = 0;
+    for (std::size_t v = 1; v < n; ++v) {
+      if (nearest[v] > nearest[best]) {
+        best = v;
+      }
+    }
+    return best;
+  };
+
+  // The first landmark is the vertex farthest from vertex 0.
+  dijkstra(g, 0, ws);
+  for (std::size_t v : ws.reached_vertices()) {
+    nearest[v] = detail::to_oracle_storage<StorageType>(ws.distance(v));
+  }
+
+  for (std::size_t i = 0; i < num_landmarks; ++i) {
+    std::size_t l = farthest();
+    landmarks_.push_back(l);
+    if (i == 0) {
+      std::fill(nearest.begin(), nearest.end(), unreachable);
+    }
+
+    dijkstra(g, l, ws);
+    store_row(from_, i, ws);
+    for (std::size_t v : ws.reached_vertices()) {
+      nearest[v] = std::min(nearest[v], from_(v, i));
+    }
+    nearest[l] = 0;
+  }
+
+  compute_to(g, pool);
+}
+
+template <typename WeightType, typename StorageType>
+LandmarkIndex<WeightType, StorageType>::LandmarkIndex(
+    const CsrGraph<WeightType> &g, const std::vector<std::size_t> &landmarks,
+    parallel::thread_pool *pool)
+    : landmarks_{landmarks}, directed_{g.is_directed()} {
+  std::size_t n = g.num_vertices();
+  for (std::size_t l : landmarks_) {
+    if (l >= n) {
+      throw std::out_of_range("LandmarkIndex: landmark is not a vertex");
+    }
+  }
+
+  from_.resize(n, landmarks_.size(), unreachable);
+  auto dist = dijkstra_many(g, landmarks_, pool);
+  for (std::size_t i = 0; i < landmarks_.size(); ++i) {
+    for (std::size_t v = 0; v < n; ++v) {
+      from_(v, i) = detail::to_oracle_storage<StorageType>(dist(i, v));
+    }
+  }
+
+  compute_to(g, pool);
+}
+
+template <typename WeightType, typename StorageType>
+WeightType LandmarkIndex<WeightType, StorageType>::bound(
+    const StorageType *from_u, const StorageType *from_t,
+    const StorageType *to_u, const StorageType *to_t, std::size_t k) {
+  StorageType best = 0;
+  for (std::size_t i = 0; i < k; ++i) {
+    // d(L,t) - d(L,u), only valid if L reaches both.
+    if (from_u[i] != unreachable && from_t[i] != unreachable &&
+        from_t[i] > from_u[i]) {
+      best = std::max<StorageType>(best, from_t[i] - from_u[i]);
+    }
+    // d(u,L) - d(t,L), only valid if both reach L.
+    if (to_u[i] != unreachable && to_t[i] != unreachable &&
+        to_u[i] > to_t[i]) {
+      best = std::max<StorageType>(best, to_u[i] - to_t[i]);
+    }
+  }
+  return static_cast<WeightType>(best);
+}
+
+template <typename WeightType, typename StorageType>
+WeightType
+LandmarkIndex<WeightType, StorageType>::lower_bound(std::size_t u,
+                                                    std::size_t t) const {
+  const Matrix<StorageType> &to = directed_ ? to_ : from_;
+  std::size_t k = num_landmarks();
+  if (k == 0) {
+    return 0;
+  }
+  return bound(&from_(u, 0), &from_(t, 0), &to(u, 0), &to(t, 0), k);
+}
+
+template <typename WeightType, typename StorageType>
+LandmarkHeuristic<WeightType, StorageType>::LandmarkHeuristic(
+    const LandmarkIndex<WeightType, StorageType> &index, std::size_t goal)
+    : index{&index} {
+  std::size_t k = index.num_landmarks();
+  goal_from.reserve(k);
+  goal_to.reserve(k);
+  for (std::size_t i = 0; i < k; ++i) {
+    goal_from.push_back(index.from_landmark(i, goal));
+    goal_to.push_back(index.to_landmark(i, goal));
+  }
+}
+
+template <typename WeightType, typename StorageType>
+WeightType
+LandmarkHeuristic<WeightType, StorageType>::operator()(std::size_t v) const {
+  std::size_t k = goal_from.size();
+  if (k == 0) {
+    return 0;
+  }
+  const auto &to = index->directed_ ? index->to_ : index->from_;
+  return LandmarkIndex<WeightType, StorageType>::bound(
+      &index->from_(v, 0), goal_from.data(), &to(v, 0), goal_to.data(), k);
+}
+
+template <typename WeightType, typename StorageType>
+DistanceTable<WeightType, StorageType>::DistanceTable(
+    const CsrGraph<WeightType> &g, parallel::thread_pool *pool) {
+  std::size_t n = g.num_vertices();
+  table.resize(n, n, unreachable);
+
+  // Same chunking as dijkstra_many, but writing straight into the compact
+  // table rather than going through an n x n matrix of WeightType.
+  auto run_chunk = [&](std::size_t first, std::size_t last) {
+    PathfindingWorkspace<WeightType> ws(n);
+    for (std::size_t u = first; u < last; ++u) {
+      dijkstra(g, u, ws);
+      for (std::size_t v : ws.reached_vertices()) {
+        table(u, v) = detail::to_oracle_storage<StorageType>(ws.distance(v));
+      }
+    }
+  };
+
+  if (pool && n > 1) {
+    std::size_t num_chunks = std::min(n, 4 * (pool->size() + 1));
+    std::size_t chunk = (n + num_chunks - 1) / num_chunks;
+    pool->parallel_for(std::size_t{0}, num_chunks, 1, [&](std::size_t c) {
+      run_chunk(std::min(c * chunk, n), std::min((c + 1) * chunk, n));
+    });
+  } else {
+    run_chunk(0, n);
+  }
+}
+
+template <typename DistanceType>
+DynamicDistanceTable<DistanceType>::DynamicDistanceTable(
+    std::size_t num_vertices,
+    const std::vector<std::pair<std::size_t, std::size_t>> &edges,
+    bool directed, parallel::thread_pool *pool)
+    : adjacency_(num_vertices), in_adjacency_(directed ? num_vertices : 0),
+      directed_(directed), pool_(pool) {
+  for (auto [u, v] : edges) {
+    check_vertex(u);
+    check_vertex(v);
+    if (u != v && !has_edge(u, v)) {
+      insert_arc(u, v);
+      if (!directed_) {
+        insert_arc(v, u);
+      }
+    }
+  }
+  table_ = Matrix<DistanceType>::uninitialized(num_vertices, num_vertices);
+  std::vector<std::size_t> all(num_vertices);
+  for (std::size_t s = 0; s < num_vertices; ++s) {
+    all[s] = s;
+  }
+  bfs_rows(all);
+  rows_recomputed_ = 0;
+}
+
+template <typename DistanceType>
+template <typename GraphType>
+std::vector<std::pair<std::size_t, std::size_t>>
+DynamicDistanceTable<DistanceType>::edge_pairs(const GraphType &g) {
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  edges.reserve(boost::num_edges(g));
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    edges.emplace_back(boost::source(e, g), boost::target(e, g));
+  }
+  return edges;
+}
+
+template <typename DistanceType>
+void DynamicDistanceTable<DistanceType>::check_vertex(std::size_t v) const {
+  if (v >= adjacency_.size()) {
+    throw std::out_of_range("DynamicDistanceTable: vertex out of range");
+  }
+}
+
+template <typename DistanceType>
+bool DynamicDistanceTable<DistanceType>::has_edge(std::size_t u,
+                                                  std::size_t v) const {
+  check_vertex(u);
+  check_vertex(v);
+  const auto &nbs = adjacency_[u];
+  return std::find(nbs.begin(), nbs.end(), v) != nbs.end();
+}
+
+template <typename DistanceType>
+void DynamicDistanceTable<DistanceType>::insert_arc(std::size_t u,
+                                                    std::size_t v) {
+  adjacency_[u].push_back(v);
+  if (directed_) {
+    in_adjacency_[v].push_back(u);
+  }
+}
+
+template <typename DistanceType>
+void DynamicDistanceTable<DistanceType>::erase_arc(std::size_t u,
+                                                   std::size_t v) {
+  auto erase = [](std::vector<std::size_t> &nbs, std::size_t x) {
+    *std::find(nbs.begin(), nbs.end(), x) = nbs.back();
+    nbs.pop_back();
+  };
+  erase(adjacency_[u], v);
+  if (directed_) {
+    erase(in_adjacency_[v], u);
+  }
+}
+
+template <typename DistanceType>
+bool DynamicDistanceTable<DistanceType>::depends_on(std::size_t s,
+                                                    std::size_t u,
+                                                    std::size_t v) const {
+  DistanceType to_u = table_(s, u), to_v = table_(s, v);
+  if (to_u == unreachable || to_u + 1 != to_v) {
+    return false;
+  }
+  // Called once the arc is erased, so u is no longer an in-neighbour of v.
+  for (std::size_t w : directed_ ? in_adjacency_[v] : adjacency_[v]) {
+    DistanceType to_w = table_(s, w);
+    if (to_w != unreachable && to_w + 1 == to_v) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename DistanceType>
+void DynamicDistanceTable<DistanceType>::bfs_row(
+    std::size_t s, std::vector<std::size_t> &queue) {
+  std::size_t n = num_vertices();
+  DistanceType *row = &table_(s, 0);
+  std::fill(row, row + n, unreachable);
+  row[s] = 0;
+  queue.clear();
+  queue.push_back(s);
+  for (std::size_t head = 0; head < queue.size(); ++head) {
+    std::size_t u = queue[head];
+    for (std::size_t v : adjacency_[u]) {
+      if (row[v] == unreachable) {
+        row[v] = static_cast<DistanceType>(row[u] + 1);
+        queue.push_back(v);
+      }
+    }
+  }
+}
+
+template <typename DistanceType>
+void DynamicDistanceTable<DistanceType>::bfs_rows(
+    const std::vector<std::size_t> &sources) {
+  rows_recomputed_ += sources.size();
+  auto run_chunk = [&](std::size_t first, std::size_t last) {
+    std::vector<std::size_t> queue;
+    queue.reserve(num_vertices());
+    for (std::size_t i = first; i < last; ++i) {
+      bfs_row(sources[i], queue);
+    }
+  };
+  std::size_t k = sources.size();
+  if (pool_ && k > 1) {
+    std::size_t num_chunks = std::min(k, 4 * (pool_->size() + 1));
+    std::size_t chunk = (k + num_chunks - 1) / num_chunks;
+    pool_->parallel_for(std::size_t{0}, num_chunks, 1, [&](std::size_t c) {
+      run_chunk(std::min(c * chunk, k), std::min((c + 1) * chunk, k));
+    });
+  } else {
+    run_chunk(0, k);
+  }
+}
+
+template <typename DistanceType>
+bool DynamicDistanceTable<DistanceType>::add_edge(std::size_t u,
+                                                  std::size_t v) {
+  if (u == v || has_edge(u, v)) {
+    return false;
+  }
+  insert_arc(u, v);
+  if (!directed_) {
+    insert_arc(v, u);
+  }
+
+  // A shortest path uses the new edge at most once, so every row is lowered
+  // from the old rows of u and v, copied first since they change too.
+  std::size_t n = num_vertices();
+  std::vector<DistanceType> from_u(&table_(u, 0), &table_(u, 0) + n);
+  std::vector<DistanceType> from_v(&table_(v, 0), &table_(v, 0) + n);
+  auto lower = [&](DistanceType *row, DistanceType to_a,
+                   const std::vector<DistanceType> &from_b) {
+    if (to_a == unreachable) {
+      return;
+    }
+    for (std::size_t t = 0; t < n; ++t) {
+      if (from_b[t] != unreachable) {
+        auto d = static_cast<DistanceType>(to_a + 1 + from_b[t]);
+        row[t] = std::min(row[t], d);
+      }
+    }
+  };
+  auto update_row = [&](std::size_t s) {
+    DistanceType *row = &table_(s, 0);
+    DistanceType to_u = row[u], to_v = row[v];
+    // The edge is a shortcut from s only if it beats the current distance
+    // to its far end.
+    if (to_u != unreachable && (to_v == unreachable || to_u + 1 < to_v)) {
+      lower(row, to_u, from_v);
+    }
+    if (!directed_ && to_v != unreachable &&
+        (to_u == unreachable || to_v + 1 < to_u)) {
+      lower(row, to_v, from_u);
+    }
+  };
+  if (pool_ && n > 1) {
+    pool_->parallel_for(std::size_t{0}, n, 0, update_row);
+  } else {
+    for (std::size_t s = 0; s < n; ++s) {
+      update_row(s);
+    }
+  }
+  return true;
+}
+
+template <typename DistanceType>
+bool DynamicDistanceTable<DistanceType>::remove_edge(std::size_t u,
+                                                     std::size_t v) {
+  if (!has_edge(u, v)) {
+    return false;
+  }
+  erase_arc(u, v);
+  if (!directed_) {
+    erase_arc(v, u);
+  }
+
+  // If the far end of the edge keeps its distance from s, so does every
+  // other vertex.
+  std::vector<std::size_t> affected;
+  for (std::size_t s = 0; s < num_vertices(); ++s) {
+    if (depends_on(s, u, v) || (!directed_ && depends_on(s, v, u))) {
+      affected.push_back(s);
+    }
+  }
+  bfs_rows(affected);
+  return true;
+}
+
+} // namespace gl
+} // namespace utils
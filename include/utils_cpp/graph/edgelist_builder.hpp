@@ -0,0 +1,166 @@
+/**********************************************************************
+ * @brief Bulk construction of graphs from edge lists.
+ * @details EdgeListBuilder collects edges first and builds a Graph, DiGraph
+ *or CsrGraph from all of them at once. Degrees are counted before anything
+ *is inserted, so every neighbor list is allocated exactly once, and
+ *duplicate edges can be dropped with a radix sort on the way.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/graph.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace gl {
+
+/**
+ * @brief Collects edges, then builds a graph from all of them in one pass.
+ *
+ * @details The number of vertices grows to cover every endpoint added, and
+ * can be set up front. Edges keep the order they were added in, unless
+ * deduplicate() sorts them.
+ *
+ * @code
+ * EdgeListBuilder builder(n);
+ * builder.reserve(m);
+ * for (...) builder.add_edge(u, v);
+ * builder.deduplicate();
+ * Graph g = builder.build_graph();
+ * @endcode
+ */
+class EdgeListBuilder {
+public:
+  using edge_type = std::pair<std::size_t, std::size_t>;
+
+  explicit EdgeListBuilder(std::size_t num_vertices = 0,
+                           bool directed = false)
+      : num_vertices_{num_vertices}, directed_{directed} {}
+
+  std::size_t num_vertices() const noexcept { return num_vertices_; }
+  std::size_t num_edges() const noexcept { return edges_.size(); }
+  bool is_directed() const noexcept { return directed_; }
+  const std::vector<edge_type> &edges() const noexcept { return edges_; }
+
+  void reserve(std::size_t num_edges) { edges_.reserve(num_edges); }
+
+  void add_edge(std::size_t u, std::size_t v) {
+    edges_.emplace_back(u, v);
+    num_vertices_ = std::max(num_vertices_, std::max(u, v) + 1);
+  }
+
+  /**
+   * @brief Adds every edge of an edgelist whose entries are std::pair,
+   * std::array<T, 2> or std::vector<T>.
+   */
+  template <typename EdgeList>
+  void add_edges(const EdgeList &edgelist) {
+    edges_.reserve(edges_.size() + edgelist.size());
+    for (const auto &e : edgelist) {
+      auto [u, v] = detail::edge_endpoints(e);
+      add_edge(u, v);
+    }
+  }
+
+  /**
+   * @brief Drops repeated edges, keeping one copy of each, and sorts the
+   * rest. For undirected graphs (u, v) and (v, u) are the same edge and end
+   * up stored as (min, max). Uses an LSD radix sort when the vertex count
+   * fits in 32 bits.
+   */
+  void deduplicate();
+
+  /**
+   * @brief Builds a Graph, DiGraph or other vecS adjacency_list. Its
+   * directedness comes from the type, not from is_directed().
+   */
+  template <typename GraphType = Graph>
+  GraphType build_graph() const {
+    return detail::graph_from_edges<GraphType>(num_vertices_, edges_);
+  }
+
+  /**
+   * @brief Builds an unweighted CsrGraph. Edge ids are positions in edges().
+   */
+  template <typename WeightType = std::size_t>
+  CsrGraph<WeightType> build_csr() const {
+    return CsrGraph<WeightType>(num_vertices_, edges_, directed_);
+  }
+
+private:
+  std::vector<edge_type> edges_;
+  std::size_t num_vertices_;
+  bool directed_;
+};
+
+// ==== Implementation ====
+
+namespace detail {
+
+/**
+ * Sorts edges by (first, second), 16 bits of the packed key at a time.
+ * Requires num_vertices <= 2^32.
+ */
+inline void
+radix_sort_edges(std::vector<std::pair<std::size_t, std::size_t>> &edges,
+                 std::size_t num_vertices) {
+  constexpr int digit_bits = 16;
+  constexpr std::size_t num_buckets = std::size_t{1} << digit_bits;
+
+  const int half_bits =
+      std::bit_width(num_vertices > 0 ? num_vertices - 1 : 0);
+  const int key_bits = 2 * half_bits;
+  auto key = [&](const std::pair<std::size_t, std::size_t> &e) {
+    return (static_cast<std::uint64_t>(e.first) << half_bits) |
+           static_cast<std::uint64_t>(e.second);
+  };
+
+  std::vector<std::pair<std::size_t, std::size_t>> buffer(edges.size());
+  std::vector<std::size_t> counts(num_buckets);
+  for (int shift = 0; shift < key_bits; shift += digit_bits) {
+    std::fill(counts.begin(), counts.end(), 0);
+    for (const auto &e : edges) {
+      ++counts[(key(e) >> shift) & (num_buckets - 1)];
+    }
+    std::size_t sum = 0;
+    for (auto &c : counts) {
+      sum += std::exchange(c, sum);
+    }
+    for (const auto &e : edges) {
+      buffer[counts[(key(e) >> shift) & (num_buckets - 1)]++] = e;
+    }
+    edges.swap(buffer);
+  }
+}
+
+} // namespace detail
+
+inline void EdgeListBuilder::deduplicate() {
+  if (!directed_) {
+    for (auto &[u, v] : edges_) {
+      if (u > v) {
+        std::swap(u, v);
+      }
+    }
+  }
+
+  if (num_vertices_ <= (std::size_t{1} << 32)) {
+    detail::radix_sort_edges(edges_, num_vertices_);
+  } else {
+    std::sort(edges_.begin(), edges_.end());
+  }
+  edges_.erase(std::unique(edges_.begin(), edges_.end()), edges_.end());
+}
+
+} // namespace gl
+} // namespace utils
@@ -0,0 +1,249 @@
+/**********************************************************************
+ * @brief Fast loading of graphs from text edgelists and CSV files.
+ * @details read_edgelist maps the file and parses it in place: the text is
+ *cut at line boundaries into chunks of roughly equal size, which are parsed
+ *in parallel on a parallel::thread_pool if one is given, with vertex ids and
+ *weights converted by std::from_chars. Nothing is allocated per line or per
+ *field; each chunk appends to its own edge vector, and the chunks are joined
+ *in file order into an EdgeListBuilder, ready for build_graph or build_csr.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/edgelist_builder.hpp"
+#include "utils_cpp/mapped_file.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace gl {
+
+/**
+ * @brief How to read a text edgelist.
+ *
+ * @details Each line holds the two endpoints of an edge and, if weighted, its
+ * weight, separated by spaces, tabs or commas. Further columns are ignored.
+ * Blank lines, and lines whose first non-blank character is '#' or '%', are
+ * skipped. Lines may end in "\n" or "\r\n".
+ */
+struct EdgeListFormat {
+  bool directed = false;
+  /// Parse the third column as the weight of the edge.
+  bool weighted = false;
+  /// The id of the first vertex in the file, subtracted from every id (e.g.
+  /// 1 for files that number vertices from 1).
+  std::size_t first_vertex = 0;
+  /// Lines skipped at the start of the file, e.g. a CSV header.
+  std::size_t skip_lines = 0;
+};
+
+/**
+ * @brief The edges of a text edgelist and, if it is weighted, their weights:
+ * weights[i] is the weight of edges.edges()[i]. Calling
+ * edges.deduplicate() reorders the edges without their weights.
+ */
+template <typename WeightType = std::size_t>
+struct TextEdgeList {
+  EdgeListBuilder edges;
+  std::vector<WeightType> weights; // empty unless weighted
+
+  /**
+   * @brief A CsrGraph of the edges, weighted if the edgelist is.
+   */
+  CsrGraph<WeightType> build_csr() const {
+    if (weights.empty()) {
+      return edges.template build_csr<WeightType>();
+    }
+    return CsrGraph<WeightType>(edges.num_vertices(), edges.edges(), weights,
+                                edges.is_directed());
+  }
+};
+
+/**
+ * @brief Parses an edgelist held in memory, in parallel on pool if given.
+ * The edges keep their order in the text.
+ *
+ * @throws std::runtime_error naming the line of the first malformed line
+ * found: a missing or non-numeric column, a vertex id below first_vertex, or
+ * a value out of range.
+ */
+template <typename WeightType = std::size_t>
+TextEdgeList<WeightType> parse_edgelist(std::string_view text,
+                                        const EdgeListFormat &format = {},
+                                        parallel::thread_pool *pool = nullptr);
+
+/**
+ * @brief parse_edgelist on a memory-mapped file.
+ *
+ * @throws std::runtime_error if the file cannot be read, or as
+ * parse_edgelist.
+ */
+template <typename WeightType = std::size_t>
+TextEdgeList<WeightType> read_edgelist(const std::string &filename,
+                                       const EdgeListFormat &format = {},
+                                       parallel::thread_pool *pool = nullptr);
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+namespace detail {
+
+// Chunks smaller than this are not worth a task of their own.
+inline constexpr std::size_t min_edgelist_chunk = std::size_t{1} << 20;
+
+inline bool is_edgelist_separator(char c) noexcept {
+  return c == ' ' || c == '\t' || c == ',';
+}
+
+// The start of the line after the one containing p, or end.
+inline const char *next_line(const char *p, const char *end) noexcept {
+  const void *newline = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+  return newline ? static_cast<const char *>(newline) + 1 : end;
+}
+
+template <typename WeightType>
+struct edgelist_chunk {
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  std::vector<WeightType> weights;
+  // Where parsing failed, or nullptr.
+  const char *error = nullptr;
+};
+
+/**
+ * @internal
+ * @brief Parses the whole lines in [p, end) into chunk. Stops at the first
+ * malformed line and records where it is.
+ */
+template <typename WeightType>
+void parse_edgelist_lines(const char *p, const char *end,
+                          const EdgeListFormat &format,
+                          edgelist_chunk<WeightType> &chunk) {
+  auto skip_separators = [&] {
+    while (p != end && is_edgelist_separator(*p)) {
+      ++p;
+    }
+  };
+  // Parses one field at p; false if there is none or it is out of range.
+  auto field = [&](auto &value) {
+    skip_separators();
+    auto [ptr, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc() || ptr == p) {
+      return false;
+    }
+    p = ptr;
+    return true;
+  };
+
+  while (p != end) {
+    const char *line = p;
+    skip_separators();
+    if (p == end) {
+      break;
+    }
+    if (*p == '\n' || *p == '\r' || *p == '#' || *p == '%') {
+      p = next_line(p, end);
+      continue;
+    }
+
+    std::size_t u, v;
+    WeightType w{};
+    bool ok = field(u) && field(v) && (!format.weighted || field(w)) &&
+              (p == end || is_edgelist_separator(*p) || *p == '\r' ||
+               *p == '\n') &&
+              u >= format.first_vertex && v >= format.first_vertex;
+    if (!ok) {
+      chunk.error = line;
+      return;
+    }
+    chunk.edges.emplace_back(u - format.first_vertex, v - format.first_vertex);
+    if (format.weighted) {
+      chunk.weights.push_back(w);
+    }
+    p = next_line(p, end);
+  }
+}
+
+} // namespace detail
+
+template <typename WeightType>
+TextEdgeList<WeightType> parse_edgelist(std::string_view text,
+                                        const EdgeListFormat &format,
+                                        parallel::thread_pool *pool) {
+  const char *begin = text.data();
+  const char *end = begin + text.size();
+  const char *first = begin;
+  for (std::size_t i = 0; i < format.skip_lines && first != end; ++i) {
+    first = detail::next_line(first, end);
+  }
+
+  // Chunk boundaries, moved forward to the start of a line.
+  const auto size = static_cast<std::size_t>(end - first);
+  std::size_t num_chunks = 1;
+  if (pool) {
+    num_chunks = std::clamp(size / detail::min_edgelist_chunk, std::size_t{1},
+                            4 * (pool->size() + 1));
+  }
+  std::vector<const char *> bounds(num_chunks + 1, end);
+  bounds[0] = first;
+  for (std::size_t i = 1; i < num_chunks; ++i) {
+    bounds[i] = std::max(bounds[i - 1],
+                         detail::next_line(first + i * size / num_chunks, end));
+  }
+
+  std::vector<detail::edgelist_chunk<WeightType>> chunks(num_chunks);
+  auto parse_chunk = [&](std::size_t i) {
+    detail::parse_edgelist_lines(bounds[i], bounds[i + 1], format, chunks[i]);
+  };
+  if (pool && num_chunks > 1) {
+    pool->parallel_for(std::size_t{0}, num_chunks, 1, parse_chunk);
+  } else {
+    parse_chunk(0);
+  }
+
+  std::size_t num_edges = 0;
+  for (const auto &chunk : chunks) {
+    if (chunk.error) {
+      std::string message = "parse_edgelist: malformed line ";
+      message += std::to_string(std::count(begin, chunk.error, '\n') + 1);
+      throw std::runtime_error(message);
+    }
+    num_edges += chunk.edges.size();
+  }
+
+  TextEdgeList<WeightType> result{EdgeListBuilder(0, format.directed), {}};
+  result.edges.reserve(num_edges);
+  result.weights.reserve(format.weighted ? num_edges : 0);
+  for (auto &chunk : chunks) {
+    result.edges.add_edges(chunk.edges);
+    result.weights.insert(result.weights.end(), chunk.weights.begin(),
+                          chunk.weights.end());
+    chunk = {};
+  }
+  return result;
+}
+
+template <typename WeightType>
+TextEdgeList<WeightType> read_edgelist(const std::string &filename,
+                                       const EdgeListFormat &format,
+                                       parallel::thread_pool *pool) {
+  MappedFile file(filename);
+  return parse_edgelist<WeightType>(file.view(), format, pool);
+}
+
+} // namespace gl
+} // namespace utils
@@ -0,0 +1,540 @@
+/**********************************************************************
+ * @brief Relabeling-invariant graph hashes, and a cache of algorithm results
+ * keyed on topology.
+ * @details fingerprint() hashes the vertex colors of a few rounds of
+ *Weisfeiler-Lehman refinement: each round recolors a vertex by its own color
+ *and the multiset of its neighbors' colors, so the result does not depend on
+ *how the vertices are numbered. Different fingerprints prove two graphs are
+ *not isomorphic; equal ones make it likely that they are.
+ *
+ *canonical_form() goes further and numbers the vertices by their refined
+ *colors, individualizing a vertex whenever refinement leaves ties, so that a
+ *graph and a relabeled copy usually get the same canonical edge list.
+ *TopologyCache stores results in canonical numbering under that edge list,
+ *and only returns them after comparing the edge list exactly: a collision or
+ *an unlucky tie-break costs a recomputation, never a wrong result.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/graph/algorithms.hpp"
+#include "utils_cpp/graph/bitadjmat.hpp"
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/graph.hpp"
+#include "utils_cpp/hash.hpp"
+#include "utils_cpp/lru_cache.hpp"
+#include "utils_cpp/matrix.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace gl {
+
+/**
+ * @brief A hash of a graph that does not depend on how its vertices are
+ * numbered, with its vertex and edge counts.
+ */
+struct GraphFingerprint {
+  std::uint64_t hash = 0;
+  std::size_t num_vertices = 0;
+  std::size_t num_edges = 0;
+
+  bool operator==(const GraphFingerprint &) const = default;
+};
+
+/**
+ * @brief Vertex colors after the given number of Weisfeiler-Lehman rounds,
+ * starting from the degrees. Vertices that an isomorphism maps onto each
+ * other get the same color, and the colors are comparable across graphs.
+ * Directed graphs are refined along out-arcs.
+ */
+template <typename WeightType>
+std::vector<std::uint64_t> wl_colors(const CsrGraph<WeightType> &g,
+                                     std::size_t rounds = 3);
+
+/**
+ * @brief Hash of the multiset of wl_colors(g, rounds), with the vertex and
+ * edge counts.
+ */
+template <typename WeightType>
+GraphFingerprint fingerprint(const CsrGraph<WeightType> &g,
+                             std::size_t rounds = 3);
+
+inline GraphFingerprint fingerprint(const Graph &g, std::size_t rounds = 3) {
+  return fingerprint(CsrGraph(g), rounds);
+}
+
+inline GraphFingerprint fingerprint(const BitAdjmat &g,
+                                    std::size_t rounds = 3) {
+  return fingerprint(CsrGraph(g), rounds);
+}
+
+/**
+ * @brief A graph renumbered by canonical_form().
+ */
+struct CanonicalGraph {
+  GraphFingerprint fingerprint;
+  /// labels[v] is the canonical number of vertex v.
+  std::vector<std::size_t> labels;
+  /// The edges in canonical numbering, sorted; (min, max) for undirected
+  /// graphs.
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  bool directed = false;
+  /// Hash of the vertex count, the direction and the canonical edges.
+  std::uint64_t edges_hash = 0;
+};
+
+/**
+ * @brief Numbers the vertices of g by their colors under Weisfeiler-Lehman
+ * refinement run to a fixed point. While two vertices share a color, the
+ * smallest class of equal colors has its lowest-numbered vertex recolored
+ * and refinement resumes.
+ *
+ * @details A graph and a relabeled copy get the same edges whenever each
+ * individualized class is an orbit of the automorphism group, which covers
+ * the lattices of library.hpp and random graphs; for graphs where it is not
+ * (e.g. some strongly regular graphs) the edges may differ.
+ */
+template <typename WeightType>
+CanonicalGraph canonical_form(const CsrGraph<WeightType> &g);
+
+inline CanonicalGraph canonical_form(const Graph &g) {
+  return canonical_form(CsrGraph(g));
+}
+
+inline CanonicalGraph canonical_form(const BitAdjmat &g) {
+  return canonical_form(CsrGraph(g));
+}
+
+/**
+ * @brief LRU cache of algorithm results, keyed by the canonical edge list of
+ * a graph and the name of the algorithm with its parameters.
+ *
+ * @details Results are vectors of integers in canonical vertex numbering, so
+ * a relabeled copy of a graph reuses them after mapping them back. The cache
+ * can be saved to and loaded from a file, to be shared between runs. Not
+ * thread-safe.
+ */
+class TopologyCache {
+public:
+  explicit TopologyCache(std::size_t capacity = 64) : cache_(capacity) {}
+
+  std::size_t size() const noexcept { return cache_.size(); }
+  std::size_t capacity() const noexcept { return cache_.capacity(); }
+  std::size_t hits() const noexcept { return hits_; }
+  std::size_t misses() const noexcept { return misses_; }
+
+  /**
+   * @brief The result of 'algorithm' on g, computed by compute() (in
+   * canonical numbering) unless it is cached. The result must have
+   * result_size elements.
+   *
+   * @throws std::runtime_error if the cached or computed result has a
+   * different size, e.g. because a loaded cache file was corrupt.
+   */
+  template <typename Compute>
+  const std::vector<std::int64_t> &get_or_compute(const CanonicalGraph &g,
+                                                  const std::string &algorithm,
+                                                  std::size_t result_size,
+                                                  Compute &&compute);
+
+  /**
+   * @brief Writes every entry to filename, in native byte order.
+   *
+   * @throws std::runtime_error if the file cannot be written.
+   */
+  void save(const std::string &filename) const;
+
+  /**
+   * @brief Adds the entries saved in filename, as if they had just been
+   * computed in the order they were last used.
+   *
+   * @throws std::runtime_error if the file cannot be read or is not a cache
+   * file.
+   */
+  void load(const std::string &filename);
+
+private:
+  struct key {
+    std::uint64_t edges_hash;
+    std::string algorithm;
+
+    bool operator==(const key &) const = default;
+  };
+
+  struct key_hash {
+    std::size_t operator()(const key &k) const noexcept {
+      std::size_t seed = static_cast<std::size_t>(k.edges_hash);
+      hash_combine(seed, k.algorithm);
+      return seed;
+    }
+  };
+
+  struct entry {
+    std::size_t num_vertices;
+    bool directed;
+    std::vector<std::pair<std::size_t, std::size_t>> edges;
+    std::vector<std::int64_t> result;
+  };
+
+  LruCache<key, entry, key_hash> cache_;
+  std::size_t hits_ = 0;
+  std::size_t misses_ = 0;
+};
+
+/**
+ * @brief floyd_warshall_matrix(g) through the cache. g is a Graph, DiGraph
+ * or BitAdjmat.
+ */
+template <typename GraphType>
+Matrix<int> cached_floyd_warshall(TopologyCache &cache, const GraphType &g);
+
+/**
+ * @brief graph_coloring() through the cache. On a hit for a relabeled copy
+ * of g, the result is the coloring of that copy, mapped to g: it is proper
+ * and uses as many colors, but may differ from graph_coloring(g, strategy).
+ */
+template <typename GraphType>
+std::vector<std::size_t>
+cached_graph_coloring(TopologyCache &cache, const GraphType &g,
+                      graph_coloring_strategy strategy);
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief One Weisfeiler-Lehman round. The neighbor colors are summed after
+ * mixing, which is order-independent and keeps repeated colors apart.
+ */
+template <typename WeightType>
+void wl_round(const CsrGraph<WeightType> &g,
+              const std::vector<std::uint64_t> &in,
+              std::vector<std::uint64_t> &out) {
+  for (std::size_t v = 0; v < g.num_vertices(); ++v) {
+    std::uint64_t neighbors = 0;
+    for (std::size_t u : g.neighbors(v)) {
+      neighbors += mix64(in[u]);
+    }
+    out[v] = mix64(in[v] ^ mix64(neighbors));
+  }
+}
+
+inline std::size_t num_colors(std::vector<std::uint64_t> colors) {
+  std::sort(colors.begin(), colors.end());
+  return static_cast<std::size_t>(
+      std::unique(colors.begin(), colors.end()) - colors.begin());
+}
+
+/**
+ * @internal
+ * @brief Refines colors until a round no longer splits any color class.
+ */
+template <typename WeightType>
+void wl_refine(const CsrGraph<WeightType> &g,
+               std::vector<std::uint64_t> &colors) {
+  std::vector<std::uint64_t> next(colors.size());
+  std::size_t classes = num_colors(colors);
+  while (true) {
+    wl_round(g, colors, next);
+    std::size_t refined = num_colors(next);
+    if (refined == classes) {
+      return;
+    }
+    colors.swap(next);
+    classes = refined;
+  }
+}
+
+inline std::uint64_t
+canonical_edges_hash(std::size_t num_vertices, bool directed,
+                     const std::vector<std::pair<std::size_t, std::size_t>>
+                         &edges) {
+  std::size_t seed = hash_value(num_vertices);
+  hash_combine(seed, directed);
+  hash_combine(seed, hash_bytes(edges.data(), edges.size() * sizeof(edges[0])));
+  return seed;
+}
+
+} // namespace detail
+
+template <typename WeightType>
+std::vector<std::uint64_t> wl_colors(const CsrGraph<WeightType> &g,
+                                     std::size_t rounds) {
+  std::size_t n = g.num_vertices();
+  std::vector<std::uint64_t> colors(n), next(n);
+  for (std::size_t v = 0; v < n; ++v) {
+    colors[v] = mix64(g.degree(v));
+  }
+  for (std::size_t r = 0; r < rounds; ++r) {
+    detail::wl_round(g, colors, next);
+    colors.swap(next);
+  }
+  return colors;
+}
+
+template <typename WeightType>
+GraphFingerprint fingerprint(const CsrGraph<WeightType> &g,
+                             std::size_t rounds) {
+  std::size_t seed = 0;
+  for (std::uint64_t c : wl_colors(g, rounds)) {
+    symmetric_hash_combine(seed, c);
+  }
+  hash_combine(seed, g.num_vertices());
+  hash_combine(seed, g.num_edges());
+  return {seed, g.num_vertices(), g.num_edges()};
+}
+
+template <typename WeightType>
+CanonicalGraph canonical_form(const CsrGraph<WeightType> &g) {
+  std::size_t n = g.num_vertices();
+  CanonicalGraph result;
+  result.fingerprint = fingerprint(g);
+
+  auto colors = wl_colors(g, 0);
+  detail::wl_refine(g, colors);
+
+  // Vertices sorted by (color, index); ties are runs of equal colors.
+  std::vector<std::size_t> order(n);
+  auto sort_order = [&] {
+    for (std::size_t v = 0; v < n; ++v) {
+      order[v] = v;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+      return colors[a] != colors[b] ? colors[a] < colors[b] : a < b;
+    });
+  };
+  while (true) {
+    sort_order();
+    // The smallest class of equal colors, by size then color.
+    std::size_t best = n, best_size = n + 1;
+    for (std::size_t i = 0; i < n;) {
+      std::size_t j = i + 1;
+      while (j < n && colors[order[j]] == colors[order[i]]) {
+        ++j;
+      }
+      if (j - i > 1 && j - i < best_size) {
+        best = i;
+        best_size = j - i;
+      }
+      i = j;
+    }
+    if (best == n) {
+      break;
+    }
+    colors[order[best]] = mix64(colors[order[best]] ^ 0x5bd1e995u);
+    detail::wl_refine(g, colors);
+  }
+
+  result.labels.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    result.labels[order[i]] = i;
+  }
+  for (std::size_t u = 0; u < n; ++u) {
+    for (std::size_t v : g.neighbors(u)) {
+      std::size_t a = result.labels[u], b = result.labels[v];
+      if (g.is_directed()) {
+        result.edges.emplace_back(a, b);
+      } else if (u <= v) {
+        result.edges.emplace_back(std::min(a, b), std::max(a, b));
+      }
+    }
+  }
+  std::sort(result.edges.begin(), result.edges.end());
+  result.directed = g.is_directed();
+  result.edges_hash =
+      detail::canonical_edges_hash(n, result.directed, result.edges);
+  return result;
+}
+
+template <typename Compute>
+const std::vector<std::int64_t> &
+TopologyCache::get_or_compute(const CanonicalGraph &g,
+                              const std::string &algorithm,
+                              std::size_t result_size, Compute &&compute) {
+  auto check_size = [&](const std::vector<std::int64_t> &result)
+      -> const std::vector<std::int64_t> & {
+    if (result.size() != result_size) {
+      throw std::runtime_error("TopologyCache: result of " + algorithm +
+                               " has " + std::to_string(result.size()) +
+                               " elements, expected " +
+                               std::to_string(result_size));
+    }
+    return result;
+  };
+
+  key k{g.edges_hash, algorithm};
+  std::size_t n = g.labels.size();
+  if (entry *e = cache_.find(k)) {
+    if (e->num_vertices == n && e->directed == g.directed &&
+        e->edges == g.edges) {
+      ++hits_;
+      return check_size(e->result);
+    }
+  }
+  ++misses_;
+  std::vector<std::int64_t> result = std::forward<Compute>(compute)();
+  check_size(result);
+  return cache_.insert(k, {n, g.directed, g.edges, std::move(result)}).result;
+}
+
+inline void TopologyCache::save(const std::string &filename) const {
+  std::ofstream out(filename, std::ios::binary);
+  auto put = [&](std::uint64_t x) {
+    out.write(reinterpret_cast<const char *>(&x), sizeof(x));
+  };
+  out.write("UTGCACHE", 8);
+  put(1); // version
+  put(cache_.size());
+  // Least recently used first, so loading restores the order.
+  for (auto it = cache_.end(); it != cache_.begin();) {
+    --it;
+    const auto &[k, e] = *it;
+    put(k.algorithm.size());
+    out.write(k.algorithm.data(),
+              static_cast<std::streamsize>(k.algorithm.size()));
+    put(e.num_vertices);
+    put(e.directed);
+    put(e.edges.size());
+    out.write(reinterpret_cast<const char *>(e.edges.data()),
+              static_cast<std::streamsize>(e.edges.size() *
+                                           sizeof(e.edges[0])));
+    put(e.result.size());
+    out.write(reinterpret_cast<const char *>(e.result.data()),
+              static_cast<std::streamsize>(e.result.size() *
+                                           sizeof(e.result[0])));
+  }
+  if (!out) {
+    throw std::runtime_error("TopologyCache: cannot write " + filename);
+  }
+}
+
+inline void TopologyCache::load(const std::string &filename) {
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("TopologyCache: cannot open " + filename);
+  }
+  auto fail = [&]() -> void {
+    throw std::runtime_error("TopologyCache: malformed cache file " +
+                             filename);
+  };
+  auto get = [&] {
+    std::uint64_t x = 0;
+    if (!in.read(reinterpret_cast<char *>(&x), sizeof(x))) {
+      fail();
+    }
+    return x;
+  };
+  // Reads count elements of T, without trusting count before the data is
+  // actually there.
+  auto get_array = [&]<typename T>(std::vector<T> &v, std::uint64_t count) {
+    v.clear();
+    constexpr std::uint64_t batch = std::uint64_t{1} << 16;
+    while (count > 0) {
+      std::size_t m = static_cast<std::size_t>(std::min(count, batch));
+      std::size_t old = v.size();
+      v.resize(old + m);
+      if (!in.read(reinterpret_cast<char *>(v.data() + old),
+                   static_cast<std::streamsize>(m * sizeof(T)))) {
+        fail();
+      }
+      count -= m;
+    }
+  };
+
+  char magic[8];
+  if (!in.read(magic, 8) || std::string(magic, 8) != "UTGCACHE" ||
+      get() != 1) {
+    fail();
+  }
+  std::uint64_t count = get();
+  for (std::uint64_t i = 0; i < count; ++i) {
+    std::vector<char> algorithm;
+    get_array(algorithm, get());
+    entry e;
+    e.num_vertices = static_cast<std::size_t>(get());
+    e.directed = get() != 0;
+    get_array(e.edges, get());
+    get_array(e.result, get());
+    for (auto [a, b] : e.edges) {
+      if (a >= e.num_vertices || b >= e.num_vertices) {
+        fail();
+      }
+    }
+    key k{detail::canonical_edges_hash(e.num_vertices, e.directed, e.edges),
+          std::string(algorithm.begin(), algorithm.end())};
+    cache_.insert(k, std::move(e));
+  }
+}
+
+template <typename GraphType>
+Matrix<int> cached_floyd_warshall(TopologyCache &cache, const GraphType &g) {
+  auto canonical = canonical_form(CsrGraph(g));
+  const auto &labels = canonical.labels;
+  std::size_t n = labels.size();
+  auto compute = [&] {
+    auto d = floyd_warshall_matrix(g);
+    std::vector<std::int64_t> result(n * n);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        result[labels[i] * n + labels[j]] = d(i, j);
+      }
+    }
+    return result;
+  };
+  const auto &stored =
+      cache.get_or_compute(canonical, "floyd_warshall", n * n, compute);
+
+  Matrix<int> d(n, n);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      d(i, j) = static_cast<int>(stored[labels[i] * n + labels[j]]);
+    }
+  }
+  return d;
+}
+
+template <typename GraphType>
+std::vector<std::size_t>
+cached_graph_coloring(TopologyCache &cache, const GraphType &g,
+                      graph_coloring_strategy strategy) {
+  CsrGraph csr(g);
+  auto canonical = canonical_form(csr);
+  const auto &labels = canonical.labels;
+  std::string algorithm = "graph_coloring/";
+  algorithm += strategy == graph_coloring_strategy::LARGEST_FIRST
+                   ? "largest_first"
+                   : "smallest_last";
+  auto compute = [&] {
+    auto colors = graph_coloring(csr, strategy);
+    std::vector<std::int64_t> result(colors.size());
+    for (std::size_t v = 0; v < colors.size(); ++v) {
+      result[labels[v]] = static_cast<std::int64_t>(colors[v]);
+    }
+    return result;
+  };
+  const auto &stored =
+      cache.get_or_compute(canonical, algorithm, labels.size(), compute);
+
+  std::vector<std::size_t> colors(labels.size());
+  for (std::size_t v = 0; v < colors.size(); ++v) {
+    colors[v] = static_cast<std::size_t>(stored[labels[v]]);
+  }
+  return colors;
+}
+
+} // namespace gl
+} // namespace utils
@@ -14,7 +14,11 @@
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graph_traits.hpp>
 
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
 #include <iostream>
+#include <vector>
 
 namespace utils {
 namespace gl {
@@ -232,8 +236,8 @@ struct EdgeHash;
  * @brief Specialization of detail::EdgeHash struct for undirected graphs.
  *
  * This specialization provides a hash function for edge descriptors of
- * undirected graphs. It computes the hash by combining the hash values of the
- * source and target vertices using XOR.
+ * undirected graphs. It computes the hash by adding the mixed hash values of
+ * the source and target vertices, so both orientations hash the same.
  *
  * @tparam GraphType The graph type.
  */
@@ -260,7 +264,7 @@ struct EdgeHash<GraphType, boost::undirectedS> {
  *
  * This specialization provides a hash function for edge descriptors of directed
  * graphs. It computes the hash value by combining the hash values of the source
- * and target vertices using boost::hash_combine.
+ * and target vertices using hash_combine.
  *
  * @tparam GraphType The graph type.
  */
@@ -327,14 +331,17 @@ struct EdgeKeyEquals<GraphType, boost::directedS> {
  *
  * @tparam ValueType The value type associated with each edge.
  * @tparam GraphType The graph type.
+ * @tparam MapType The hash map template, with the parameters of
+ * std::unordered_map, e.g. FlatHashMap from flat_hash_map.hpp. The
+ * algorithms that take an EdgeMap expect the default.
  */
 template <typename ValueType, typename GraphType = Graph,
           typename Directed =
-              typename detail::GraphDirectedness<GraphType>::type>
-using EdgeMap =
-    typename std::unordered_map<Edge<GraphType>, ValueType,
-                                detail::EdgeHash<GraphType, Directed>,
-                                detail::EdgeKeyEquals<GraphType, Directed>>;
+              typename detail::GraphDirectedness<GraphType>::type,
+          template <typename...> class MapType = std::unordered_map>
+using EdgeMap = MapType<Edge<GraphType>, ValueType,
+                        detail::EdgeHash<GraphType, Directed>,
+                        detail::EdgeKeyEquals<GraphType, Directed>>;
 
 /**
  * @brief Alias for an unordered_map using vertex descriptors as keys.
@@ -344,9 +351,165 @@ using EdgeMap =
  *
  * @tparam ValueType The value type associated with each vertex.
  * @tparam GraphType The graph type.
+ * @tparam MapType The hash map template, as for EdgeMap.
+ */
+template <typename ValueType, typename GraphType = Graph,
+          template <typename...> class MapType = std::unordered_map>
+using VertexMap = MapType<Vertex<GraphType>, ValueType>;
+
+// ---- Dense Property Maps ----
+
+/**
+ * @brief A vertex property map backed by a std::vector.
+ *
+ * With vecS vertex storage the vertex descriptors are already 0..n-1, so a
+ * vertex's value lives at values()[v] and lookups never hash. Has the same
+ * operator[], at() and contains() as VertexMap, so it can be used wherever a
+ * VertexMap is read, e.g. as the location map of the A-star heuristics.
+ *
+ * @tparam ValueType The value type associated with each vertex.
+ * @tparam GraphType The graph type.
+ */
+template <typename ValueType, typename GraphType = Graph>
+class DenseVertexMap {
+public:
+  using key_type = Vertex<GraphType>;
+  using mapped_type = ValueType;
+  using reference = typename std::vector<ValueType>::reference;
+  using const_reference = typename std::vector<ValueType>::const_reference;
+
+  DenseVertexMap() = default;
+
+  /**
+   * @brief num_vertices copies of 'value'.
+   */
+  explicit DenseVertexMap(std::size_t num_vertices,
+                          const ValueType &value = ValueType{})
+      : values_(num_vertices, value) {}
+
+  /**
+   * @brief One copy of 'value' per vertex of g.
+   */
+  explicit DenseVertexMap(const GraphType &g,
+                          const ValueType &value = ValueType{})
+      : values_(boost::num_vertices(g), value) {}
+
+  /**
+   * @brief Dense copy of a VertexMap. Vertices missing from 'sparse' get
+   * ValueType{}.
+   */
+  DenseVertexMap(const GraphType &g,
+                 const VertexMap<ValueType, GraphType> &sparse)
+      : values_(boost::num_vertices(g)) {
+    for (const auto &[v, value] : sparse) {
+      values_.at(v) = value;
+    }
+  }
+
+  reference operator[](key_type v) { return values_[v]; }
+  const_reference operator[](key_type v) const { return values_[v]; }
+
+  reference at(key_type v) { return values_.at(v); }
+  const_reference at(key_type v) const { return values_.at(v); }
+
+  bool contains(key_type v) const noexcept { return v < values_.size(); }
+  std::size_t size() const noexcept { return values_.size(); }
+
+  auto begin() noexcept { return values_.begin(); }
+  auto end() noexcept { return values_.end(); }
+  auto begin() const noexcept { return values_.begin(); }
+  auto end() const noexcept { return values_.end(); }
+
+  std::vector<ValueType> &values() noexcept { return values_; }
+  const std::vector<ValueType> &values() const noexcept { return values_; }
+
+  friend bool operator==(const DenseVertexMap &lhs,
+                         const DenseVertexMap &rhs) = default;
+
+private:
+  std::vector<ValueType> values_;
+};
+
+/**
+ * @brief An edge property map backed by a std::vector indexed by edge id.
+ *
+ * @details The id of an edge is its position in boost::edges(g), which is
+ * stable as long as the graph is not modified. CsrGraph numbers edges the
+ * same way, so a DenseEdgeMap can be handed straight to the CsrGraph-based
+ * algorithms without any lookups.
+ *
+ * @tparam ValueType The value type associated with each edge.
+ * @tparam GraphType The graph type.
  */
 template <typename ValueType, typename GraphType = Graph>
-using VertexMap = std::unordered_map<Vertex<GraphType>, ValueType>;
+class DenseEdgeMap {
+public:
+  using key_type = std::size_t;
+  using mapped_type = ValueType;
+  using reference = typename std::vector<ValueType>::reference;
+  using const_reference = typename std::vector<ValueType>::const_reference;
+
+  DenseEdgeMap() = default;
+
+  /**
+   * @brief num_edges copies of 'value'.
+   */
+  explicit DenseEdgeMap(std::size_t num_edges,
+                        const ValueType &value = ValueType{})
+      : values_(num_edges, value) {}
+
+  /**
+   * @brief One copy of 'value' per edge of g.
+   */
+  explicit DenseEdgeMap(const GraphType &g,
+                        const ValueType &value = ValueType{})
+      : values_(boost::num_edges(g), value) {}
+
+  /**
+   * @brief values()[id] = f(e) for the id-th edge e of boost::edges(g).
+   */
+  template <typename F>
+    requires std::invocable<F &, Edge<GraphType>>
+  DenseEdgeMap(const GraphType &g, F &&f) {
+    values_.reserve(boost::num_edges(g));
+    for (auto e : boost::make_iterator_range(boost::edges(g))) {
+      values_.push_back(f(e));
+    }
+  }
+
+  /**
+   * @brief Dense copy of an EdgeMap. Edges missing from 'sparse' get
+   * ValueType{}.
+   */
+  DenseEdgeMap(const GraphType &g, const EdgeMap<ValueType, GraphType> &sparse)
+      : DenseEdgeMap(g, [&](Edge<GraphType> e) {
+          auto it = sparse.find(e);
+          return it == sparse.end() ? ValueType{} : it->second;
+        }) {}
+
+  reference operator[](key_type id) { return values_[id]; }
+  const_reference operator[](key_type id) const { return values_[id]; }
+
+  reference at(key_type id) { return values_.at(id); }
+  const_reference at(key_type id) const { return values_.at(id); }
+
+  bool contains(key_type id) const noexcept { return id < values_.size(); }
+  std::size_t size() const noexcept { return values_.size(); }
+
+  auto begin() noexcept { return values_.begin(); }
+  auto end() noexcept { return values_.end(); }
+  auto begin() const noexcept { return values_.begin(); }
+  auto end() const noexcept { return values_.end(); }
+
+  std::vector<ValueType> &values() noexcept { return values_; }
+  const std::vector<ValueType> &values() const noexcept { return values_; }
+
+  friend bool operator==(const DenseEdgeMap &lhs,
+                         const DenseEdgeMap &rhs) = default;
+
+private:
+  std::vector<ValueType> values_;
+};
 
 // ---- Property Sets ----
 
@@ -354,53 +517,102 @@ using VertexMap = std::unordered_map<Vertex<GraphType>, ValueType>;
  * @brief Alias for an unordered_set containing edge descriptors.
  *
  * @tparam GraphType The graph type.
+ * @tparam SetType The hash set template, with the parameters of
+ * std::unordered_set, e.g. FlatHashSet from flat_hash_map.hpp.
  */
 template <typename GraphType = Graph,
           typename Directed =
-              typename detail::GraphDirectedness<GraphType>::type>
-using EdgeSet =
-    typename std::unordered_set<Edge<GraphType>,
-                                detail::EdgeHash<GraphType, Directed>,
-                                detail::EdgeKeyEquals<GraphType, Directed>>;
+              typename detail::GraphDirectedness<GraphType>::type,
+          template <typename...> class SetType = std::unordered_set>
+using EdgeSet = SetType<Edge<GraphType>, detail::EdgeHash<GraphType, Directed>,
+                        detail::EdgeKeyEquals<GraphType, Directed>>;
 
 /**
  * @brief Alias for an unordered_set containing vertex descriptors.
  *
  * @tparam GraphType The graph type.
+ * @tparam SetType The hash set template, as for EdgeSet.
  */
-template <typename GraphType = Graph>
-using VertexSet = typename std::unordered_set<Vertex<GraphType>>;
+template <typename GraphType = Graph,
+          template <typename...> class SetType = std::unordered_set>
+using VertexSet = SetType<Vertex<GraphType>>;
 
 // ---- Loading from Edgelist ----
 
+namespace detail {
+
+/**
+ * @internal
+ * @brief Builds a vecS adjacency_list on num_vertices vertices from
+ * endpoint pairs, reserving every out-edge list at its final size before
+ * inserting, so no list is reallocated.
+ */
+template <typename GraphType = Graph, typename EdgeRange>
+GraphType graph_from_edges(std::size_t num_vertices, const EdgeRange &edges) {
+  GraphType g(num_vertices);
+
+  if constexpr (std::is_same_v<typename GraphType::out_edge_list_selector,
+                               boost::vecS>) {
+    constexpr bool undirected =
+        std::is_same_v<typename GraphDirectedness<GraphType>::type,
+                       boost::undirectedS>;
+    std::vector<std::size_t> degrees(num_vertices, 0);
+    for (const auto &[u, v] : edges) {
+      ++degrees[u];
+      if (undirected && u != v) {
+        ++degrees[v];
+      }
+    }
+    for (std::size_t v = 0; v < num_vertices; ++v) {
+      g.out_edge_list(v).reserve(degrees[v]);
+    }
+  }
+
+  for (const auto &[u, v] : edges) {
+    boost::add_edge(u, v, g);
+  }
+  return g;
+}
+
+template <typename EdgeList>
+std::size_t edgelist_num_vertices(const EdgeList &edgelist) {
+  std::size_t n = 0;
+  for (const auto &edge : edgelist) {
+    n = std::max<std::size_t>(
+        n, std::max<std::size_t>(edge[0], edge[1]) + 1);
+  }
+  return n;
+}
+
+} // namespace detail
+
 template <typename T>
   requires std::is_integral_v<T>
 Graph from_edgelist(const std::vector<std::vector<T>> &edgelist) {
-  Graph g;
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  edges.reserve(edgelist.size());
   for (const auto &edge : edgelist) {
-    add_edge(edge[0], edge[1], g);
+    edges.emplace_back(edge[0], edge[1]);
   }
-  return g;
+  return detail::graph_from_edges(detail::edgelist_num_vertices(edgelist),
+                                  edges);
 }
 
 template <typename T>
   requires std::is_integral_v<T>
 Graph from_edgelist(const std::vector<std::array<T, 2>> &edgelist) {
-  Graph g;
-  for (const auto &edge : edgelist) {
-    add_edge(edge[0], edge[1], g);
-  }
-  return g;
+  return detail::graph_from_edges(detail::edgelist_num_vertices(edgelist),
+                                  edgelist);
 }
 
 template <typename T>
   requires std::is_integral_v<T>
 Graph from_edgelist(const std::vector<std::pair<T, T>> &edgelist) {
-  Graph g;
-  for (const auto &edge : edgelist) {
-    add_edge(edge.first, edge.second, g);
+  std::size_t n = 0;
+  for (const auto &[u, v] : edgelist) {
+    n = std::max<std::size_t>(n, std::max<std::size_t>(u, v) + 1);
   }
-  return g;
+  return detail::graph_from_edges(n, edgelist);
 }
 
 inline std::vector<std::pair<std::size_t, std::size_t>>
@@ -469,3 +681,9 @@ inline std::ostream &operator<<(std::ostream &os, const utils::gl::DiGraph &g) {
 }
 
 } // namespace utils
+
+// Declares the Boost Graph functions for the implicit lattice views. It comes
+// after everything above, which it builds on, and before any header whose
+// templates call boost::num_vertices(g) and the like, which have to see
+// those declarations.
+#include "utils_cpp/graph/implicit_graph.hpp"
@@ -1,18 +1,38 @@
 /**********************************************************************
  * @brief Utilities for writing to graphviz
- * @details
+ * @details GraphWriter builds the attributes of every element in hash maps and
+ *suits small graphs that are styled by hand. write_dot streams a graph or a
+ *GraphBundle straight from its properties, formatting numbers with to_chars
+ *into one large buffer that is flushed in big chunks, optionally through
+ *gzip. Compression needs zlib, i.e. UTILS_CPP_HAS_ZLIB, which CMake defines
+ *when it finds zlib.
  * @author Sam Tonetto
  * @copyright GNU Public License
  * @date 2023
  ***********************************************************************/
 
+#pragma once
+
 #include "utils_cpp/graph/graph.hpp"
 #include "utils_cpp/graph/properties.hpp"
 
 #include "utils_cpp/print.hpp"
 
+#if defined(UTILS_CPP_HAS_ZLIB)
+#include <zlib.h>
+#endif
+
+#include <charconv>
+#include <cstdio>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
 namespace utils {
@@ -135,17 +155,19 @@ inline void to_dot(GraphBundle &gb, const std::string &filename) {
   gw.add_vertex_property("shape", "circle");
   gw.add_edge_property("penwidth", "2");
 
-  std::cout << "gb.props.vertex.contains(\"position\") = "
-            << gb.props.vertex.contains("position") << std::endl;
-
   if (gb.props.vertex.contains("position")) {
     gw.add_vertex_property("pin", "true");
 
-    gl::VertexMap<std::vector<double>> pos = gb.props.vertex["position"];
+    auto pos = std::as_const(gb.props.vertex)["position"]
+                   .to_map<std::vector<double>>();
 
     for (auto [v, p] : pos) {
-      gw.vertex_props[v]["pos"] =
-          "\"" + std::to_string(p[0]) + "," + std::to_string(p[1]) + "!" + "\"";
+      std::string pos_str = "\"";
+      pos_str += std::to_string(p[0]);
+      pos_str += ',';
+      pos_str += std::to_string(p[1]);
+      pos_str += "!\"";
+      gw.vertex_props[v]["pos"] = std::move(pos_str);
     }
   }
 
@@ -171,6 +193,396 @@ void to_dot(GraphType &g, const std::string &filename) {
   ofs.close();
 }
 
+// ==== Streaming writer ====
+
+/**
+ * Options of write_dot.
+ */
+struct DotOptions {
+  /**
+   * Properties to write as attributes. Empty means all vertex and edge
+   * properties of the bundle.
+   */
+  std::vector<std::string> attributes;
+
+  /**
+   * Write no attributes at all, only the vertices and edges.
+   */
+  bool omit_attributes = false;
+
+  /**
+   * Add the styling of to_dot (splines, circular nodes, thick edges), as
+   * default node and edge statements rather than on every element.
+   */
+  bool style = false;
+
+  /**
+   * gzip the output. Only for the filename overloads, and only with zlib.
+   */
+  bool compress = false;
+
+  /**
+   * Bytes formatted before each write to the file or stream.
+   */
+  std::size_t buffer_size = std::size_t{1} << 20;
+};
+
+namespace detail {
+
+/**
+ * Formats into a fixed buffer and passes it to a sink each time it fills up.
+ */
+class DotBuffer {
+public:
+  using sink_type = std::function<void(const char *, std::size_t)>;
+
+  DotBuffer(std::size_t capacity, sink_type sink)
+      : buffer_(std::max<std::size_t>(capacity, 64)), sink_{std::move(sink)} {}
+
+  void put(char c) {
+    reserve(1);
+    buffer_[size_++] = c;
+  }
+
+  void put(std::string_view s) {
+    if (s.size() > buffer_.size()) {
+      flush();
+      sink_(s.data(), s.size());
+      return;
+    }
+    reserve(s.size());
+    std::copy(s.begin(), s.end(), buffer_.data() + size_);
+    size_ += s.size();
+  }
+
+  template <typename T>
+    requires std::is_arithmetic_v<T>
+  void put_number(T x) {
+    reserve(32); // enough for any double or 64-bit integer
+    char *end = buffer_.data() + size_;
+    size_ = std::to_chars(end, end + 32, x).ptr - buffer_.data();
+  }
+
+  void flush() {
+    if (size_ > 0) {
+      sink_(buffer_.data(), size_);
+      size_ = 0;
+    }
+  }
+
+private:
+  void reserve(std::size_t n) {
+    if (size_ + n > buffer_.size()) {
+      flush();
+    }
+  }
+
+  std::vector<char> buffer_;
+  std::size_t size_ = 0;
+  sink_type sink_;
+};
+
+inline void put_dot_value(DotBuffer &out, double x) { out.put_number(x); }
+
+inline void put_dot_value(DotBuffer &out, std::span<const double> x,
+                          bool pinned = false) {
+  out.put('"');
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    if (i > 0) {
+      out.put(',');
+    }
+    out.put_number(x[i]);
+  }
+  if (pinned) {
+    out.put('!');
+  }
+  out.put('"');
+}
+
+inline void put_dot_value(DotBuffer &out, const std::string &x) {
+  out.put('"');
+  for (char c : x) {
+    if (c == '"' || c == '\\') {
+      out.put('\\');
+    }
+    out.put(c);
+  }
+  out.put('"');
+}
+
+/**
+ * A vertex property laid out by vertex: columns are used as they are, and
+ * maps are turned into one pointer per vertex in a single pass over them.
+ */
+struct DotVertexAttribute {
+  std::string_view name;
+  bool position = false;
+  std::variant<const ScalarColumn *, const VectorColumn *,
+               std::vector<const double *>,
+               std::vector<const std::vector<double> *>,
+               std::vector<const std::string *>>
+      values;
+
+  template <typename GraphType>
+  DotVertexAttribute(std::string_view name, const VertexProp<GraphType> &prop,
+                     std::size_t num_vertices)
+      : name{name}, position{name == "position"} {
+    auto by_vertex = [&](const auto &m) {
+      using T = typename std::decay_t<decltype(m)>::mapped_type;
+      std::vector<const T *> dense(num_vertices, nullptr);
+      for (const auto &[v, value] : m) {
+        if (v < num_vertices) {
+          dense[v] = &value;
+        }
+      }
+      values = std::move(dense);
+    };
+    std::visit(
+        [&](const auto &storage) {
+          using Storage = std::decay_t<decltype(storage)>;
+          if constexpr (std::is_same_v<Storage, ScalarColumn> ||
+                        std::is_same_v<Storage, VectorColumn>) {
+            values = &storage;
+          } else {
+            by_vertex(storage);
+          }
+        },
+        prop.p);
+  }
+
+  /**
+   * Writes "name=value", or nothing if v has no value. Returns whether
+   * something was written.
+   */
+  bool put(DotBuffer &out, std::size_t v, bool first) const {
+    return std::visit(
+        [&](const auto &column) {
+          using Column = std::decay_t<decltype(column)>;
+          if constexpr (std::is_same_v<Column, const ScalarColumn *>) {
+            if (v >= column->size()) {
+              return false;
+            }
+            put_name(out, first);
+            put_dot_value(out, column->values[v]);
+          } else if constexpr (std::is_same_v<Column, const VectorColumn *>) {
+            if (v >= column->size()) {
+              return false;
+            }
+            put_name(out, first);
+            put_dot_value(out, column->at(v), position);
+          } else {
+            if (column[v] == nullptr) {
+              return false;
+            }
+            put_name(out, first);
+            if constexpr (std::is_same_v<Column,
+                                         std::vector<const std::vector<double> *>>) {
+              put_dot_value(out, std::span<const double>(*column[v]), position);
+            } else {
+              put_dot_value(out, *column[v]);
+            }
+          }
+          return true;
+        },
+        values);
+  }
+
+private:
+  void put_name(DotBuffer &out, bool first) const {
+    out.put(first ? " [" : ", ");
+    out.put(position ? std::string_view{"pos"} : name);
+    out.put('=');
+  }
+};
+
+inline bool dot_attribute_selected(const DotOptions &options,
+                            const std::string &name) {
+  return !options.omit_attributes &&
+         (options.attributes.empty() ||
+          std::find(options.attributes.begin(), options.attributes.end(),
+                    name) != options.attributes.end());
+}
+
+template <typename GraphType>
+void write_dot(DotBuffer &out, const GraphType &g,
+               const Properties<GraphType> *props, const DotOptions &options) {
+  constexpr bool directed =
+      std::is_same_v<typename detail::GraphDirectedness<GraphType>::type,
+                     boost::directedS>;
+  const std::size_t n = boost::num_vertices(g);
+
+  std::vector<DotVertexAttribute> vertex_attributes;
+  std::vector<std::pair<std::string_view, const EdgeProp<GraphType> *>>
+      edge_attributes;
+  if (props != nullptr) {
+    for (const auto &[name, prop] : props->vertex) {
+      if (dot_attribute_selected(options, name)) {
+        vertex_attributes.emplace_back(name, prop, n);
+      }
+    }
+    for (const auto &[name, prop] : props->edge) {
+      if (dot_attribute_selected(options, name)) {
+        edge_attributes.emplace_back(name, &prop);
+      }
+    }
+  }
+
+  out.put(directed ? "digraph G {\n" : "graph G {\n");
+  if (options.style) {
+    out.put("  splines=true;\n  node [shape=circle];\n"
+            "  edge [penwidth=2];\n");
+  }
+
+  for (std::size_t v = 0; v < n; ++v) {
+    out.put("  ");
+    out.put_number(v);
+    bool first = true;
+    for (const auto &attribute : vertex_attributes) {
+      if (attribute.put(out, v, first)) {
+        first = false;
+      }
+    }
+    out.put(first ? ";\n" : "];\n");
+  }
+
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    out.put("  ");
+    out.put_number(boost::source(e, g));
+    out.put(directed ? " -> " : " -- ");
+    out.put_number(boost::target(e, g));
+
+    bool first = true;
+    for (const auto &[name, prop] : edge_attributes) {
+      std::visit(
+          [&](const auto &storage) {
+            using Storage = std::decay_t<decltype(storage)>;
+            if constexpr (!std::is_same_v<Storage, ScalarColumn> &&
+                          !std::is_same_v<Storage, VectorColumn>) {
+              auto it = storage.find(e);
+              if (it == storage.end()) {
+                return;
+              }
+              out.put(first ? " [" : ", ");
+              out.put(name);
+              out.put('=');
+              if constexpr (std::is_same_v<typename Storage::mapped_type,
+                                           std::vector<double>>) {
+                put_dot_value(out, std::span<const double>(it->second));
+              } else {
+                put_dot_value(out, it->second);
+              }
+              first = false;
+            }
+          },
+          prop->p);
+    }
+    out.put(first ? ";\n" : "];\n");
+  }
+
+  out.put("}\n");
+  out.flush();
+}
+
+template <typename GraphType>
+void write_dot(const std::string &filename, const GraphType &g,
+               const Properties<GraphType> *props, const DotOptions &options) {
+  if (options.compress) {
+#if defined(UTILS_CPP_HAS_ZLIB)
+    auto close = [](gzFile f) { gzclose(f); };
+    std::unique_ptr<gzFile_s, decltype(close)> file(
+        gzopen(filename.c_str(), "wb"), close);
+    if (!file) {
+      throw std::runtime_error("write_dot: cannot open " + filename);
+    }
+    DotBuffer out(options.buffer_size, [&](const char *data, std::size_t size) {
+      if (gzwrite(file.get(), data, static_cast<unsigned>(size)) !=
+          static_cast<int>(size)) {
+        throw std::runtime_error("write_dot: cannot write " + filename);
+      }
+    });
+    write_dot(out, g, props, options);
+    // gzclose writes the last compressed block, so it can fail too.
+    if (gzclose(file.release()) != Z_OK) {
+      throw std::runtime_error("write_dot: cannot write " + filename);
+    }
+    return;
+#else
+    throw std::runtime_error(
+        "write_dot: compressed output needs zlib (UTILS_CPP_HAS_ZLIB)");
+#endif
+  }
+
+  auto close = [](std::FILE *f) { std::fclose(f); };
+  std::unique_ptr<std::FILE, decltype(close)> file(
+      std::fopen(filename.c_str(), "wb"), close);
+  if (!file) {
+    throw std::runtime_error("write_dot: cannot open " + filename);
+  }
+  DotBuffer out(options.buffer_size, [&](const char *data, std::size_t size) {
+    if (std::fwrite(data, 1, size, file.get()) != size) {
+      throw std::runtime_error("write_dot: cannot write " + filename);
+    }
+  });
+  write_dot(out, g, props, options);
+  // fclose flushes the stdio buffer, so this is where a full disk shows up.
+  if (std::fclose(file.release()) != 0) {
+    throw std::runtime_error("write_dot: cannot write " + filename);
+  }
+}
+
+} // namespace detail
+
+/**
+ * Writes g in DOT format to os, with no attributes except the styling
+ * requested in options.
+ */
+template <typename GraphType>
+void write_dot(const GraphType &g, std::ostream &os,
+               const DotOptions &options = {}) {
+  detail::DotBuffer out(options.buffer_size,
+                        [&](const char *data, std::size_t size) {
+                          os.write(data, static_cast<std::streamsize>(size));
+                        });
+  detail::write_dot<GraphType>(out, g, nullptr, options);
+}
+
+/**
+ * Writes the graph of gb in DOT format to os, with its vertex and edge
+ * properties (or those listed in options.attributes) as attributes.
+ *
+ * @details Doubles use the shortest representation that round-trips, vectors
+ * and strings are quoted. A vertex property named "position" is written as a
+ * pinned graphviz position, pos="x,y!". Columnar vertex properties are read
+ * directly; edge properties cost one hash lookup per edge.
+ */
+template <typename GraphType>
+void write_dot(const graph::GraphBundle<GraphType> &gb, std::ostream &os,
+               const DotOptions &options = {}) {
+  detail::DotBuffer out(options.buffer_size,
+                        [&](const char *data, std::size_t size) {
+                          os.write(data, static_cast<std::streamsize>(size));
+                        });
+  detail::write_dot(out, gb.graph, &gb.props, options);
+}
+
+/**
+ * Writes g to a file, gzipped if options.compress is set.
+ *
+ * @throws std::runtime_error if the file cannot be written, or if compression
+ * is requested without zlib.
+ */
+template <typename GraphType>
+void write_dot(const GraphType &g, const std::string &filename,
+               const DotOptions &options = {}) {
+  detail::write_dot<GraphType>(filename, g, nullptr, options);
+}
+
+template <typename GraphType>
+void write_dot(const graph::GraphBundle<GraphType> &gb,
+               const std::string &filename, const DotOptions &options = {}) {
+  detail::write_dot(filename, gb.graph, &gb.props, options);
+}
+
 } // namespace gl
 
 } // namespace utils
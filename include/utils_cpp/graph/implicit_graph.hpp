@@ -0,0 +1,640 @@
+/**********************************************************************
+ * @brief Graph views that compute the library lattices on the fly.
+ * @details GridView, ChimeraView, KagomeView and IbmHexView number their
+ *vertices exactly like grid(), chimera(), kagome() and ibm_hex() in
+ *library.hpp, but store only the lattice dimensions: neighbours and
+ *positions are worked out arithmetically from the vertex index. They model
+ *the Boost VertexListGraph, IncidenceGraph, AdjacencyGraph and EdgeListGraph
+ *concepts, so they can be handed to the searches in pathfinding.hpp or
+ *turned into a CsrGraph without building an adjacency_list first.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/graph/graph.hpp"
+
+#include <boost/graph/graph_traits.hpp>
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/property_map/property_map.hpp>
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+namespace utils {
+namespace gl {
+
+/**
+ * @brief Edge descriptor of an ImplicitGraph. Named like the descriptors of
+ * boost::adjacency_list, so that EdgeMap and friends work unchanged.
+ */
+struct ImplicitEdge {
+  std::size_t m_source;
+  std::size_t m_target;
+
+  friend bool operator==(const ImplicitEdge &, const ImplicitEdge &) = default;
+};
+
+/**
+ * @brief Undirected graph whose structure comes from a Layout instead of
+ * stored adjacency lists.
+ *
+ * @details A Layout provides num_vertices(), num_edges(), max_degree(),
+ * position(v) and neighbor(v, slot) for slot < max_degree(), which returns
+ * the neighbour in that slot or no_vertex if there is none. Each vertex's
+ * neighbours are visited in slot order. Constructors are inherited from the
+ * Layout.
+ */
+template <typename Layout>
+class ImplicitGraph : public Layout {
+public:
+  using Layout::Layout;
+
+  static constexpr std::size_t no_vertex =
+      std::numeric_limits<std::size_t>::max();
+
+  class out_edge_iterator;
+  class adjacency_iterator;
+  class edge_iterator;
+
+  struct traversal_category : boost::incidence_graph_tag,
+                              boost::adjacency_graph_tag,
+                              boost::vertex_list_graph_tag,
+                              boost::edge_list_graph_tag {};
+
+  using vertex_descriptor = std::size_t;
+  using edge_descriptor = ImplicitEdge;
+  using directed_category = boost::undirected_tag;
+  using edge_parallel_category = boost::disallow_parallel_edge_tag;
+  using vertex_iterator = boost::counting_iterator<std::size_t>;
+  using in_edge_iterator = void;
+  using vertices_size_type = std::size_t;
+  using edges_size_type = std::size_t;
+  using degree_size_type = std::size_t;
+
+  static vertex_descriptor null_vertex() { return no_vertex; }
+
+  std::size_t degree(std::size_t v) const {
+    std::size_t d = 0;
+    for (std::size_t slot = 0; slot < this->max_degree(); ++slot) {
+      d += this->neighbor(v, slot) != no_vertex;
+    }
+    return d;
+  }
+};
+
+/**
+ * @brief Walks the filled slots of one vertex.
+ */
+template <typename Layout>
+class ImplicitGraph<Layout>::out_edge_iterator
+    : public boost::iterator_facade<out_edge_iterator, ImplicitEdge,
+                                    std::forward_iterator_tag, ImplicitEdge> {
+public:
+  out_edge_iterator() = default;
+  out_edge_iterator(const ImplicitGraph *g, std::size_t v, std::size_t slot)
+      : g_{g}, v_{v}, slot_{slot} {
+    skip_empty();
+  }
+
+private:
+  friend class boost::iterator_core_access;
+
+  const ImplicitGraph *g_ = nullptr;
+  std::size_t v_ = 0;
+  std::size_t slot_ = 0;
+
+  void skip_empty() {
+    while (slot_ < g_->max_degree() &&
+           g_->neighbor(v_, slot_) == ImplicitGraph::no_vertex) {
+      ++slot_;
+    }
+  }
+
+  ImplicitEdge dereference() const { return {v_, g_->neighbor(v_, slot_)}; }
+
+  bool equal(const out_edge_iterator &other) const {
+    return v_ == other.v_ && slot_ == other.slot_;
+  }
+
+  void increment() {
+    ++slot_;
+    skip_empty();
+  }
+};
+
+template <typename Layout>
+class ImplicitGraph<Layout>::adjacency_iterator
+    : public boost::iterator_facade<adjacency_iterator, std::size_t,
+                                    std::forward_iterator_tag, std::size_t> {
+public:
+  adjacency_iterator() = default;
+  explicit adjacency_iterator(out_edge_iterator it) : it_{it} {}
+
+private:
+  friend class boost::iterator_core_access;
+
+  out_edge_iterator it_;
+
+  std::size_t dereference() const { return (*it_).m_target; }
+  bool equal(const adjacency_iterator &other) const {
+    return it_ == other.it_;
+  }
+  void increment() { ++it_; }
+};
+
+/**
+ * @brief Walks every edge once, as (u, v) with u < v, in order of u.
+ */
+template <typename Layout>
+class ImplicitGraph<Layout>::edge_iterator
+    : public boost::iterator_facade<edge_iterator, ImplicitEdge,
+                                    std::forward_iterator_tag, ImplicitEdge> {
+public:
+  edge_iterator() = default;
+  edge_iterator(const ImplicitGraph *g, std::size_t v) : g_{g}, v_{v} {
+    skip_empty();
+  }
+
+private:
+  friend class boost::iterator_core_access;
+
+  const ImplicitGraph *g_ = nullptr;
+  std::size_t v_ = 0;
+  std::size_t slot_ = 0;
+
+  bool is_edge() const {
+    std::size_t w = g_->neighbor(v_, slot_);
+    return w != ImplicitGraph::no_vertex && v_ < w;
+  }
+
+  void skip_empty() {
+    while (v_ < g_->num_vertices()) {
+      for (; slot_ < g_->max_degree(); ++slot_) {
+        if (is_edge()) {
+          return;
+        }
+      }
+      ++v_;
+      slot_ = 0;
+    }
+  }
+
+  ImplicitEdge dereference() const { return {v_, g_->neighbor(v_, slot_)}; }
+
+  bool equal(const edge_iterator &other) const {
+    return v_ == other.v_ && slot_ == other.slot_;
+  }
+
+  void increment() {
+    ++slot_;
+    skip_empty();
+  }
+};
+
+// ==== Layouts ====
+
+/**
+ * @brief The h x w grid of grid(h, w): vertex i * w + j sits at (j, i).
+ * Slots are left, right, up and down.
+ */
+class GridLayout {
+public:
+  GridLayout(std::size_t h, std::size_t w) : h_{h}, w_{w} {}
+
+  std::size_t height() const { return h_; }
+  std::size_t width() const { return w_; }
+
+  std::size_t num_vertices() const { return h_ * w_; }
+  std::size_t num_edges() const {
+    return num_vertices() == 0 ? 0 : h_ * (w_ - 1) + w_ * (h_ - 1);
+  }
+  static constexpr std::size_t max_degree() { return 4; }
+
+  std::size_t neighbor(std::size_t v, std::size_t slot) const {
+    constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+    std::size_t j = v % w_;
+    switch (slot) {
+    case 0:
+      return j > 0 ? v - 1 : none;
+    case 1:
+      return j + 1 < w_ ? v + 1 : none;
+    case 2:
+      return v >= w_ ? v - w_ : none;
+    default:
+      return v + w_ < num_vertices() ? v + w_ : none;
+    }
+  }
+
+  std::array<double, 2> position(std::size_t v) const {
+    return {static_cast<double>(v % w_), static_cast<double>(v / w_)};
+  }
+
+private:
+  std::size_t h_;
+  std::size_t w_;
+};
+
+/**
+ * @brief The chimera graph of chimera(h, w, k): an h x w array of K_{k,k}
+ * cells. Vertex i is in column i % (2w) and row i / (2w); even columns are
+ * the vertical halves of the cells, odd columns the horizontal ones. Slots
+ * 0..k-1 are the other half of the cell, then the two couplers to the
+ * neighbouring cells.
+ */
+class ChimeraLayout {
+public:
+  ChimeraLayout(std::size_t h, std::size_t w, std::size_t k)
+      : h_{h}, w_{w}, k_{k} {}
+
+  std::size_t num_vertices() const { return 2 * k_ * h_ * w_; }
+  std::size_t num_edges() const {
+    if (num_vertices() == 0) {
+      return 0;
+    }
+    return h_ * w_ * k_ * k_ + w_ * k_ * (h_ - 1) + h_ * k_ * (w_ - 1);
+  }
+  std::size_t max_degree() const { return k_ + 2; }
+
+  std::size_t neighbor(std::size_t v, std::size_t slot) const {
+    constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+    const std::size_t cols = 2 * w_;
+    std::size_t x = v % cols;
+    std::size_t y = v / cols;
+    bool vertical = x % 2 == 0;
+
+    if (slot < k_) {
+      std::size_t row = y - y % k_ + slot;
+      return row * cols + (vertical ? x + 1 : x - 1);
+    }
+    if (vertical) {
+      // Couplers to the same column of the cells above and below.
+      if (slot == k_) {
+        return y >= k_ ? v - k_ * cols : none;
+      }
+      return y + k_ < h_ * k_ ? v + k_ * cols : none;
+    }
+    if (slot == k_) {
+      return x >= 2 ? v - 2 : none;
+    }
+    return x + 2 < cols ? v + 2 : none;
+  }
+
+  std::array<double, 2> position(std::size_t v) const {
+    return {static_cast<double>(v % (2 * w_)),
+            static_cast<double>(h_ * k_) - 1.0 -
+                static_cast<double>(v / (2 * w_))};
+  }
+
+private:
+  std::size_t h_;
+  std::size_t w_;
+  std::size_t k_;
+};
+
+/**
+ * @brief The kagome lattice of kagome(nrows, ncols). Vertices are the points
+ * (c, r) of a (2 * ncols + 1) x (2 * nrows + 1) grid, without those where
+ * both c and r are odd, numbered row by row.
+ */
+class KagomeLayout {
+public:
+  KagomeLayout(std::size_t nrows, std::size_t ncols)
+      : nrows_{nrows}, ncols_{ncols} {}
+
+  std::size_t num_vertices() const {
+    return (nrows_ + 1) * (2 * ncols_ + 1) + nrows_ * (ncols_ + 1);
+  }
+  std::size_t num_edges() const {
+    return (nrows_ + 1) * 2 * ncols_ + nrows_ * (4 * ncols_ + 2);
+  }
+  static constexpr std::size_t max_degree() { return 4; }
+
+  std::size_t neighbor(std::size_t v, std::size_t slot) const {
+    constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+    auto [c, r] = coord(v);
+    const std::size_t last_c = 2 * ncols_;
+    const std::size_t last_r = 2 * nrows_;
+
+    if (r % 2 == 1) {
+      // Between two grid rows: straight up and down, and the diagonals to
+      // the upper right and lower left.
+      switch (slot) {
+      case 0:
+        return index(c, r - 1);
+      case 1:
+        return index(c, r + 1);
+      case 2:
+        return c < last_c ? index(c + 1, r + 1) : none;
+      default:
+        return c > 0 ? index(c - 1, r - 1) : none;
+      }
+    }
+
+    switch (slot) {
+    case 0:
+      return c > 0 ? v - 1 : none;
+    case 1:
+      return c < last_c ? v + 1 : none;
+    case 2:
+      if (r == 0) {
+        return none;
+      }
+      return c % 2 == 0 ? index(c, r - 1) : index(c - 1, r - 1);
+    default:
+      if (r == last_r) {
+        return none;
+      }
+      return c % 2 == 0 ? index(c, r + 1) : index(c + 1, r + 1);
+    }
+  }
+
+  std::array<double, 2> position(std::size_t v) const {
+    auto [c, r] = coord(v);
+    return {static_cast<double>(c), static_cast<double>(r)};
+  }
+
+private:
+  std::size_t nrows_;
+  std::size_t ncols_;
+
+  // An even row and the odd row after it.
+  std::size_t block() const { return 3 * ncols_ + 2; }
+
+  std::pair<std::size_t, std::size_t> coord(std::size_t v) const {
+    std::size_t b = v / block();
+    std::size_t offset = v % block();
+    if (offset < 2 * ncols_ + 1) {
+      return {offset, 2 * b};
+    }
+    return {2 * (offset - (2 * ncols_ + 1)), 2 * b + 1};
+  }
+
+  std::size_t index(std::size_t c, std::size_t r) const {
+    std::size_t base = r / 2 * block();
+    return r % 2 == 0 ? base + c : base + 2 * ncols_ + 1 + c / 2;
+  }
+};
+
+/**
+ * @brief The heavy-hex lattice of ibm_hex(nrows, ncols), for nrows, ncols
+ * >= 1.
+ *
+ * @details Qubits sit on a (4 * ncols + 3) x (2 * nrows + 1) grid. Vertices
+ * 1 .. L-2 form one snake through the even rows, L = 4(nrows + 1)(ncols + 1)
+ * - 3, stepping down at the alternating ends. The remaining vertices are the
+ * bridges in the odd rows, at x = 2, 6, ... in rows 1, 5, ... and at
+ * x = 4 * ncols, 4 * ncols - 4, ... in rows 3, 7, .... The first bridge is
+ * vertex 0, the last one (for nrows > 1) is vertex L-1, and the rest follow
+ * from L on, row by row. Slots are the previous and next vertex on the
+ * snake, then the qubits directly above and below.
+ */
+class IbmHexLayout {
+public:
+  IbmHexLayout(std::size_t nrows, std::size_t ncols)
+      : nrows_{nrows}, ncols_{ncols}, width_{4 * ncols + 3},
+        line_{4 * (nrows + 1) * (ncols + 1) - 3} {}
+
+  std::size_t num_vertices() const { return line_ - 2 + nrows_ * ncols_; }
+  std::size_t num_edges() const { return line_ - 3 + 2 * nrows_ * ncols_; }
+  static constexpr std::size_t max_degree() { return 4; }
+
+  std::size_t neighbor(std::size_t v, std::size_t slot) const {
+    constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+    auto [x, y] = coord(v);
+
+    if (y % 2 == 1 && !on_snake(v)) {
+      switch (slot) {
+      case 2:
+        return snake_index(x, y - 1);
+      case 3:
+        return snake_index(x, y + 1);
+      default:
+        return none;
+      }
+    }
+
+    switch (slot) {
+    case 0:
+      return v >= 2 ? v - 1 : none;
+    case 1:
+      return v + 3 <= line_ ? v + 1 : none;
+    case 2:
+      return y % 2 == 0 && y > 0 ? bridge_index(x, y - 1) : none;
+    default:
+      return y % 2 == 0 && y < 2 * nrows_ ? bridge_index(x, y + 1) : none;
+    }
+  }
+
+  std::array<double, 2> position(std::size_t v) const {
+    auto [x, y] = coord(v);
+    return {static_cast<double>(x), static_cast<double>(y)};
+  }
+
+private:
+  std::size_t nrows_;
+  std::size_t ncols_;
+  std::size_t width_; // of the qubit grid
+  std::size_t line_;  // L
+
+  bool on_snake(std::size_t v) const { return v >= 1 && v + 2 <= line_; }
+
+  bool last_bridge_on_snake_end() const { return nrows_ > 1; }
+
+  std::pair<std::size_t, std::size_t> coord(std::size_t v) const {
+    if (on_snake(v)) {
+      // Row 0 starts at x = 2; then each block is a step down followed by a
+      // full row.
+      if (v + 2 <= width_) {
+        return {v + 1, 0};
+      }
+      std::size_t q = v - (width_ - 1);
+      std::size_t b = q / (width_ + 1);
+      std::size_t offset = q % (width_ + 1);
+      if (offset == 0) {
+        return {b % 2 == 0 ? width_ - 1 : 0, 2 * b + 1};
+      }
+      std::size_t r = b + 1;
+      std::size_t o = offset - 1;
+      return {r % 2 == 0 ? o : width_ - 1 - o, 2 * r};
+    }
+
+    // Bridge slot (s, k): row 2s + 1, k-th position along it.
+    std::size_t s = 0, k = 0;
+    if (v == 0) {
+      s = 0;
+    } else if (last_bridge_on_snake_end() && v == line_ - 1) {
+      s = nrows_ - 1;
+    } else {
+      std::size_t t = v - (line_ - 1) - (last_bridge_on_snake_end() ? 1 : 0) + 1;
+      if (last_bridge_on_snake_end() && t >= (nrows_ - 1) * ncols_) {
+        ++t;
+      }
+      s = t / ncols_;
+      k = t % ncols_;
+    }
+    return {s % 2 == 0 ? 2 + 4 * k : 4 * ncols_ - 4 * k, 2 * s + 1};
+  }
+
+  // The snake vertex at (x, y), y even. Only called for points on the grid.
+  std::size_t snake_index(std::size_t x, std::size_t y) const {
+    std::size_t r = y / 2;
+    if (r == 0) {
+      return x - 1;
+    }
+    std::size_t o = r % 2 == 0 ? x : width_ - 1 - x;
+    return (width_ - 1) + (r - 1) * (width_ + 1) + 1 + o;
+  }
+
+  // The bridge at (x, y), y odd, or none if there is no qubit there.
+  std::size_t bridge_index(std::size_t x, std::size_t y) const {
+    constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+    std::size_t s = (y - 1) / 2;
+    std::size_t k = 0;
+    if (s % 2 == 0) {
+      if (x < 2 || (x - 2) % 4 != 0 || (x - 2) / 4 >= ncols_) {
+        return none;
+      }
+      k = (x - 2) / 4;
+    } else {
+      if (x % 4 != 0 || x < 4 || x > 4 * ncols_) {
+        return none;
+      }
+      k = (4 * ncols_ - x) / 4;
+    }
+
+    if (s == 0 && k == 0) {
+      return 0;
+    }
+    bool last = last_bridge_on_snake_end();
+    if (last && s == nrows_ - 1 && k == 0) {
+      return line_ - 1;
+    }
+    return line_ - 1 + (last ? 1 : 0) + s * ncols_ + k - 1 -
+           (last && s == nrows_ - 1 ? 1 : 0);
+  }
+};
+
+using GridView = ImplicitGraph<GridLayout>;
+using ChimeraView = ImplicitGraph<ChimeraLayout>;
+using KagomeView = ImplicitGraph<KagomeLayout>;
+using IbmHexView = ImplicitGraph<IbmHexLayout>;
+
+namespace detail {
+
+template <typename Layout>
+struct GraphDirectedness<ImplicitGraph<Layout>> {
+  using type = boost::undirectedS;
+};
+
+} // namespace detail
+
+// ==== Boost Graph interface ====
+//
+// Found by argument-dependent lookup from the Boost algorithms, and brought
+// into namespace boost below for the boost::num_vertices(g) style calls in
+// this library.
+
+template <typename Layout>
+std::pair<boost::counting_iterator<std::size_t>,
+          boost::counting_iterator<std::size_t>>
+vertices(const ImplicitGraph<Layout> &g) {
+  return {boost::counting_iterator<std::size_t>(0),
+          boost::counting_iterator<std::size_t>(g.num_vertices())};
+}
+
+template <typename Layout>
+std::size_t num_vertices(const ImplicitGraph<Layout> &g) {
+  return g.num_vertices();
+}
+
+template <typename Layout>
+std::size_t num_edges(const ImplicitGraph<Layout> &g) {
+  return g.num_edges();
+}
+
+template <typename Layout>
+std::pair<typename ImplicitGraph<Layout>::out_edge_iterator,
+          typename ImplicitGraph<Layout>::out_edge_iterator>
+out_edges(std::size_t v, const ImplicitGraph<Layout> &g) {
+  using It = typename ImplicitGraph<Layout>::out_edge_iterator;
+  return {It(&g, v, 0), It(&g, v, g.max_degree())};
+}
+
+template <typename Layout>
+std::size_t out_degree(std::size_t v, const ImplicitGraph<Layout> &g) {
+  return g.degree(v);
+}
+
+template <typename Layout>
+std::size_t degree(std::size_t v, const ImplicitGraph<Layout> &g) {
+  return g.degree(v);
+}
+
+template <typename Layout>
+std::pair<typename ImplicitGraph<Layout>::adjacency_iterator,
+          typename ImplicitGraph<Layout>::adjacency_iterator>
+adjacent_vertices(std::size_t v, const ImplicitGraph<Layout> &g) {
+  using It = typename ImplicitGraph<Layout>::adjacency_iterator;
+  auto [first, last] = out_edges(v, g);
+  return {It(first), It(last)};
+}
+
+template <typename Layout>
+std::pair<typename ImplicitGraph<Layout>::edge_iterator,
+          typename ImplicitGraph<Layout>::edge_iterator>
+edges(const ImplicitGraph<Layout> &g) {
+  using It = typename ImplicitGraph<Layout>::edge_iterator;
+  return {It(&g, 0), It(&g, g.num_vertices())};
+}
+
+template <typename Layout>
+std::size_t source(ImplicitEdge e, const ImplicitGraph<Layout> &) {
+  return e.m_source;
+}
+
+template <typename Layout>
+std::size_t target(ImplicitEdge e, const ImplicitGraph<Layout> &) {
+  return e.m_target;
+}
+
+} // namespace gl
+} // namespace utils
+
+namespace boost {
+
+using utils::gl::adjacent_vertices;
+using utils::gl::degree;
+using utils::gl::edges;
+using utils::gl::num_edges;
+using utils::gl::num_vertices;
+using utils::gl::out_degree;
+using utils::gl::out_edges;
+using utils::gl::source;
+using utils::gl::target;
+using utils::gl::vertices;
+
+template <typename Layout>
+struct property_map<utils::gl::ImplicitGraph<Layout>, vertex_index_t> {
+  using type = typed_identity_property_map<std::size_t>;
+  using const_type = type;
+};
+
+template <typename Layout>
+typed_identity_property_map<std::size_t>
+get(vertex_index_t, const utils::gl::ImplicitGraph<Layout> &) {
+  return {};
+}
+
+template <typename Layout>
+std::size_t get(vertex_index_t, const utils::gl::ImplicitGraph<Layout> &,
+                std::size_t v) {
+  return v;
+}
+
+} // namespace boost
@@ -4,14 +4,19 @@
 
 #pragma once
 
+#include "utils_cpp/flat_hash_map.hpp"
 #include "utils_cpp/graph/graph.hpp"
 #include "utils_cpp/graph/properties.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <random>
+#include <ranges>
+#include <stdexcept>
 #include <string>
 #include <tuple>
-#include <unordered_map>
-#include <unordered_set>
 
 namespace utils {
 namespace gl {
@@ -89,6 +94,45 @@ GraphBundle kagome(std::size_t nrows, std::size_t ncols);
 GraphBundle random(std::size_t size, double density,
                    unsigned seed = std::random_device{}());
 
+/**
+ * @brief Edges of an Erdos-Renyi G(n, p) graph: each of the n(n-1)/2 pairs is
+ * an edge with probability p, independently. Uses the geometric skipping of
+ * Batagelj and Brandes, so the cost is O(n + number of edges) rather than
+ * O(n^2).
+ * @details The pairs are split into a fixed number of chunks that only
+ * depend on n and p, and each chunk has its own generator seeded from seed
+ * and the chunk index. The output is therefore the same for a given seed
+ * whether or not a pool is given, and however many threads it has. Edges
+ * (v, w) have w < v and are sorted by v, then w.
+ * @param n Number of vertices
+ * @param p Probability of connecting two vertices
+ * @param seed Seed for random number generator
+ * @param pool If not null, chunks are generated on its threads
+ */
+std::vector<std::pair<std::size_t, std::size_t>>
+gnp_edges(std::size_t n, double p, std::uint64_t seed,
+          parallel::thread_pool *pool = nullptr);
+
+/**
+ * @brief Edges of an Erdos-Renyi G(n, m) graph: m distinct pairs chosen
+ * uniformly at random, in O(m) expected time (or O(n(n-1)/2 - m) when m is
+ * more than half of the pairs). Sorted like gnp_edges.
+ * @throws std::invalid_argument if m > n(n-1)/2.
+ */
+std::vector<std::pair<std::size_t, std::size_t>>
+gnm_edges(std::size_t n, std::size_t m, std::uint64_t seed);
+
+/**
+ * @brief Construct random graph with exactly num_edges edges, chosen
+ * uniformly among all such graphs.
+ * @param size Number of vertices
+ * @param num_edges Number of edges
+ * @param seed Seed for random number generator
+ * @return A pair of the graph and its properties
+ */
+GraphBundle random_gnm(std::size_t size, std::size_t num_edges,
+                       unsigned seed = std::random_device{}());
+
 /**
  * @brief Construct random bipartite graph, where density determines the
  * probability of connecting two vertices in opposite partitions.
@@ -102,10 +146,26 @@ GraphBundle random_bipartite(std::size_t size1, std::size_t size2,
                              double density,
                              unsigned seed = std::random_device{}());
 
+/**
+ * @brief Edges of a random degree-regular graph on n vertices, as pairs
+ * (v, w) with w < v.
+ * @details Pairs up the n * degree stubs at random (the configuration
+ * model), then removes each loop and repeated edge by switching it with a
+ * random other edge: (u, v) and (x, y) become (u, x) and (v, y) whenever
+ * that creates neither. A pairing has about degree^2 / 4 bad edges, each
+ * fixed in a few tries, and edge multiplicities live in one flat
+ * open-addressing table, so the cost is near-linear in n * degree with no
+ * restarts. For degree > (n - 1) / 2 the complement is generated instead.
+ * The result is deterministic for a given seed.
+ * @throws std::invalid_argument if n * degree is odd or degree >= n.
+ */
+std::vector<std::pair<std::size_t, std::size_t>>
+regular_edges(std::size_t n, std::size_t degree, std::uint64_t seed);
+
 /**
  * @brief Construct random regular graph, where degree determines the degree of
- * each vertex. Based heavily off the NetworkX implementation of random regular.
- * Requires that size * degree is even, and also that size < degree.
+ * each vertex. See regular_edges.
+ * Requires that size * degree is even, and also that degree < size.
  * @param size Number of vertices
  * @param degree Degree of each vertex
  * @param seed Seed for random number generator
@@ -127,27 +187,29 @@ inline GraphBundle grid(std::size_t h, std::size_t w) {
   VertexMap<std::vector<double>> positions;
   for (std::size_t i = 0; i < h; ++i) {
     for (std::size_t j = 0; j < w; ++j) {
-      positions[boost::add_vertex(gb.graph)] = {static_cast<double>(j),
-                                                static_cast<double>(i)};
+      positions[i * w + j] = {static_cast<double>(j), static_cast<double>(i)};
     }
   }
 
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  edges.reserve(2 * h * w);
   for (std::size_t i = 0; i < h * w; ++i) {
     if (i % w < w - 1) {
-      boost::add_edge(i, i + 1, g);
+      edges.emplace_back(i, i + 1);
     }
     if (i / w < h - 1) {
-      boost::add_edge(i, i + w, g);
+      edges.emplace_back(i, i + w);
     }
   }
+  g = detail::graph_from_edges(h * w, edges);
 
-  gb.props.graph["name"] = "grid";
-  gb.props.graph["height"] = h;
-  gb.props.graph["width"] = w;
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
-  gb.props.graph["num_edges"] = boost::num_edges(g);
+  gb.props.graph.assign("name", "grid");
+  gb.props.graph.assign("height", h);
+  gb.props.graph.assign("width", w);
+  gb.props.graph.assign("num_vertices", boost::num_vertices(g));
+  gb.props.graph.assign("num_edges", boost::num_edges(g));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.vertex.assign("position", positions);
 
   return gb;
 }
@@ -170,12 +232,12 @@ inline GraphBundle complete(std::size_t size) {
     }
   }
 
-  gb.props.graph["name"] = "complete";
-  gb.props.graph["size"] = size;
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
-  gb.props.graph["num_edges"] = boost::num_edges(g);
+  gb.props.graph.assign("name", "complete");
+  gb.props.graph.assign("size", size);
+  gb.props.graph.assign("num_vertices", boost::num_vertices(g));
+  gb.props.graph.assign("num_edges", boost::num_edges(g));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.vertex.assign("position", positions);
 
   return gb;
 }
@@ -207,13 +269,13 @@ inline GraphBundle kuratowski(std::size_t h, std::size_t w) {
       boost::add_edge(i, i + w, g); // connect down
   }
 
-  gb.props.graph["name"] = "kuratowski";
-  gb.props.graph["height"] = h;
-  gb.props.graph["width"] = w;
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
-  gb.props.graph["num_edges"] = boost::num_edges(g);
+  gb.props.graph.assign("name", "kuratowski");
+  gb.props.graph.assign("height", h);
+  gb.props.graph.assign("width", w);
+  gb.props.graph.assign("num_vertices", boost::num_vertices(g));
+  gb.props.graph.assign("num_edges", boost::num_edges(g));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.vertex.assign("position", positions);
 
   return gb;
 }
@@ -246,7 +308,7 @@ inline GraphBundle chimera(std::size_t h, std::size_t w, std::size_t k_cc) {
                         g); // intra-cell
       }
 
-      if (y < (h - 1) * k_cc - 1) {
+      if (y < (h - 1) * k_cc) {
         boost::add_edge(i, i + 2 * k_cc * w, g); // inter-cell vertical
       }
     } else {
@@ -256,11 +318,11 @@ inline GraphBundle chimera(std::size_t h, std::size_t w, std::size_t k_cc) {
     }
   }
 
-  gb.props.graph["name"] = "chimera";
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
-  gb.props.graph["num_edges"] = boost::num_edges(g);
+  gb.props.graph.assign("name", "chimera");
+  gb.props.graph.assign("num_vertices", boost::num_vertices(g));
+  gb.props.graph.assign("num_edges", boost::num_edges(g));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.vertex.assign("position", positions);
 
   return gb;
 }
@@ -282,12 +344,12 @@ inline GraphBundle ring(std::size_t size) {
     boost::add_edge(i, (i + 1) % size, g);
   }
 
-  gb.props.graph["name"] = "ring";
-  gb.props.graph["size"] = size;
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
-  gb.props.graph["num_edges"] = boost::num_edges(g);
+  gb.props.graph.assign("name", "ring");
+  gb.props.graph.assign("size", size);
+  gb.props.graph.assign("num_vertices", boost::num_vertices(g));
+  gb.props.graph.assign("num_edges", boost::num_edges(g));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.vertex.assign("position", positions);
 
   return gb;
 }
@@ -307,12 +369,12 @@ inline GraphBundle path(std::size_t size) {
     boost::add_edge(i, (i + 1) % size, g);
   }
 
-  gb.props.graph["name"] = "path";
-  gb.props.graph["size"] = size;
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
-  gb.props.graph["num_edges"] = boost::num_edges(g);
+  gb.props.graph.assign("name", "path");
+  gb.props.graph.assign("size", size);
+  gb.props.graph.assign("num_vertices", boost::num_vertices(g));
+  gb.props.graph.assign("num_edges", boost::num_edges(g));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.vertex.assign("position", positions);
 
   return gb;
 }
@@ -327,17 +389,17 @@ inline GraphBundle ibm_hex(std::size_t nrows, std::size_t ncols) {
 
   const std::size_t num_qubits = 5 * nrows * ncols + 4 * (nrows + ncols) - 1;
 
-  gb.props.graph["name"] = "ibm_hex";
-  gb.props.graph["num_rows"] = nrows;
-  gb.props.graph["num_cols"] = ncols;
+  gb.props.graph.assign("name", "ibm_hex");
+  gb.props.graph.assign("num_rows", nrows);
+  gb.props.graph.assign("num_cols", ncols);
 
   const std::size_t longest_line = 4 * (nrows * ncols + nrows + ncols) + 1;
   const std::size_t qwidth = 4 * (ncols + 1) - 1;
   const std::size_t qheight = 2 * nrows + 1;
 
   std::vector<std::pair<std::size_t, std::size_t>> vertex_to_coord(num_qubits);
-  std::unordered_map<std::pair<std::size_t, std::size_t>, std::size_t,
-                     pair_hash<std::size_t, std::size_t>>
+  FlatHashMap<std::pair<std::size_t, std::size_t>, std::size_t,
+              pair_hash<std::size_t, std::size_t>>
       coord_to_vertex;
 
   std::size_t qx = 1;
@@ -431,10 +493,10 @@ inline GraphBundle ibm_hex(std::size_t nrows, std::size_t ncols) {
     boost::add_edge(below_index, i, g);
   }
 
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
-  gb.props.graph["num_edges"] = boost::num_edges(g);
+  gb.props.graph.assign("num_vertices", boost::num_vertices(g));
+  gb.props.graph.assign("num_edges", boost::num_edges(g));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.vertex.assign("position", positions);
 
   return gb;
 }
@@ -445,20 +507,20 @@ inline GraphBundle kagome(std::size_t nrows, std::size_t ncols) {
 
   Graph &g = gb.graph;
 
-  gb.props.graph["name"] = "kagome";
-  gb.props.graph["num_rows"] = nrows;
-  gb.props.graph["num_cols"] = ncols;
+  gb.props.graph.assign("name", "kagome");
+  gb.props.graph.assign("num_rows", nrows);
+  gb.props.graph.assign("num_cols", ncols);
 
   const std::size_t num_grid_vertices = (nrows + 1) * (ncols + 1);
   const std::size_t num_grid_edges = (nrows + 1) * ncols + (ncols + 1) * nrows;
   const std::size_t num_vertices = num_grid_vertices + num_grid_edges;
 
-  gb.props.graph["num_grid_vertices"] = num_grid_vertices;
-  gb.props.graph["num_grid_edges"] = num_grid_edges;
-  gb.props.graph["num_vertices"] = num_vertices;
+  gb.props.graph.assign("num_grid_vertices", num_grid_vertices);
+  gb.props.graph.assign("num_grid_edges", num_grid_edges);
+  gb.props.graph.assign("num_vertices", num_vertices);
 
-  std::unordered_map<std::pair<std::size_t, std::size_t>, std::size_t,
-                     pair_hash<std::size_t, std::size_t>>
+  FlatHashMap<std::pair<std::size_t, std::size_t>, std::size_t,
+              pair_hash<std::size_t, std::size_t>>
       coord_to_vertex;
 
   // Add vertices
@@ -507,48 +569,225 @@ inline GraphBundle kagome(std::size_t nrows, std::size_t ncols) {
     }
   }
 
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
+  gb.props.graph.assign("num_vertices", boost::num_vertices(g));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.vertex.assign("position", positions);
 
   return gb;
 }
 
-inline GraphBundle random(std::size_t size, double density, unsigned seed) {
+namespace detail {
 
-  std::mt19937 gen(seed);
+/**
+ * Calls emit(v, w) for the pairs w < v with v in [v_begin, v_end) that come
+ * up in a G(n, p) sample, in order, jumping over the pairs that are not
+ * edges with one geometric draw per edge. 0 < p < 1.
+ */
+template <typename Generator, typename Emit>
+void gnp_rows(std::size_t v_begin, std::size_t v_end, double p,
+              Generator &gen, Emit &&emit) {
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  const double log_q = std::log1p(-p);
+
+  // w may run past v: the skip carries over into the following rows.
+  std::size_t v = std::max<std::size_t>(v_begin, 1);
+  std::size_t w = 0;
+  bool first = true;
+  while (v < v_end) {
+    double skip = std::floor(std::log1p(-uniform(gen)) / log_q);
+    // A skip this large always runs past the end.
+    if (skip >= static_cast<double>(v_end) * static_cast<double>(v_end)) {
+      return;
+    }
+    w += static_cast<std::size_t>(skip) + (first ? 0 : 1);
+    first = false;
+    while (w >= v && v < v_end) {
+      w -= v;
+      ++v;
+    }
+    if (v < v_end) {
+      emit(v, w);
+    }
+  }
+}
 
-  GraphBundle gb;
+/**
+ * The pair (v, w) with w < v at position k in the order (1, 0), (2, 0),
+ * (2, 1), (3, 0), ...
+ */
+inline std::pair<std::size_t, std::size_t> pair_at(std::uint64_t k) {
+  auto v = static_cast<std::uint64_t>(
+      (1.0 + std::sqrt(1.0 + 8.0 * static_cast<double>(k))) / 2.0);
+  // Correct for rounding in the square root.
+  while (v * (v - 1) / 2 > k) {
+    --v;
+  }
+  while ((v + 1) * v / 2 <= k) {
+    ++v;
+  }
+  return {static_cast<std::size_t>(v),
+          static_cast<std::size_t>(k - v * (v - 1) / 2)};
+}
 
+inline GraphBundle
+random_bundle(std::size_t size,
+              const std::vector<std::pair<std::size_t, std::size_t>> &edges) {
+  GraphBundle gb;
   Graph &g = gb.graph;
 
-  gb.props.graph["name"] = "random";
-  gb.props.graph["size"] = size;
-  gb.props.graph["density"] = density;
-  gb.props.graph["seed"] = seed;
-
   VertexMap<std::vector<double>> positions;
   for (std::size_t i = 0; i < size; ++i) {
-
-    positions[boost::add_vertex(gb.graph)] = {
+    positions[i] = {
         std::cos(2.0 * M_PI * i / static_cast<double>(size)),
         std::sin(2.0 * M_PI * i / static_cast<double>(size))};
   }
 
-  std::uniform_real_distribution<> dis(0, 1);
-  for (std::size_t i = 0; i < size; ++i) {
-    for (std::size_t j = i + 1; j < size; ++j) {
-      double randreal = dis(gen);
-      if (randreal < density) {
-        boost::add_edge(i, j, g);
+  // The generators list pairs (v, w) with w < v; edges are stored as (w, v),
+  // as they always have been.
+  g = gl::detail::graph_from_edges(
+      size, edges | std::views::transform([](const auto &e) {
+              return std::pair{e.second, e.first};
+            }));
+
+  gb.props.graph.assign("num_vertices", boost::num_vertices(g));
+  gb.props.graph.assign("num_edges", boost::num_edges(g));
+
+  gb.props.vertex.assign("position", positions);
+
+  return gb;
+}
+
+} // namespace detail
+
+inline std::vector<std::pair<std::size_t, std::size_t>>
+gnp_edges(std::size_t n, double p, std::uint64_t seed,
+          parallel::thread_pool *pool) {
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  if (n < 2 || p <= 0.0) {
+    return edges;
+  }
+  if (p >= 1.0) {
+    edges.reserve(n * (n - 1) / 2);
+    for (std::size_t v = 1; v < n; ++v) {
+      for (std::size_t w = 0; w < v; ++w) {
+        edges.emplace_back(v, w);
+      }
+    }
+    return edges;
+  }
+
+  // Chunks of rows with about the same number of expected edges, at least
+  // 2^14 each. Row v has v pairs, so chunk c starts at n * sqrt(c / k).
+  double num_pairs = 0.5 * static_cast<double>(n) * static_cast<double>(n - 1);
+  auto num_chunks = static_cast<std::size_t>(
+      std::clamp(num_pairs * p / 16384.0, 1.0, 4096.0));
+  std::vector<std::size_t> row_begin(num_chunks + 1);
+  for (std::size_t c = 0; c <= num_chunks; ++c) {
+    row_begin[c] = static_cast<std::size_t>(std::ceil(
+        static_cast<double>(n) *
+        std::sqrt(static_cast<double>(c) / static_cast<double>(num_chunks))));
+  }
+  row_begin[num_chunks] = n;
+
+  std::vector<std::vector<std::pair<std::size_t, std::size_t>>> chunks(
+      num_chunks);
+  auto generate = [&](std::size_t c) {
+    std::seed_seq seq{static_cast<std::uint32_t>(seed),
+                      static_cast<std::uint32_t>(seed >> 32),
+                      static_cast<std::uint32_t>(c)};
+    std::mt19937_64 gen(seq);
+    double rows = static_cast<double>(row_begin[c + 1] - row_begin[c]);
+    double mean = p * rows * static_cast<double>(row_begin[c + 1]);
+    chunks[c].reserve(static_cast<std::size_t>(mean * 1.1) + 16);
+    detail::gnp_rows(row_begin[c], row_begin[c + 1], p, gen,
+                     [&](std::size_t v, std::size_t w) {
+                       chunks[c].emplace_back(v, w);
+                     });
+  };
+  if (pool) {
+    pool->parallel_for(std::size_t{0}, num_chunks, 1, generate);
+  } else {
+    for (std::size_t c = 0; c < num_chunks; ++c) {
+      generate(c);
+    }
+  }
+
+  std::size_t total = 0;
+  for (const auto &chunk : chunks) {
+    total += chunk.size();
+  }
+  edges.reserve(total);
+  for (const auto &chunk : chunks) {
+    edges.insert(edges.end(), chunk.begin(), chunk.end());
+  }
+  return edges;
+}
+
+inline std::vector<std::pair<std::size_t, std::size_t>>
+gnm_edges(std::size_t n, std::size_t m, std::uint64_t seed) {
+  std::uint64_t num_pairs =
+      n < 2 ? 0 : static_cast<std::uint64_t>(n) * (n - 1) / 2;
+  if (m > num_pairs) {
+    throw std::invalid_argument("gnm_edges: more edges than vertex pairs");
+  }
+
+  // Floyd's algorithm picks k distinct pair indices with k draws. For a
+  // dense graph, pick the pairs to leave out instead.
+  bool complement = m > num_pairs / 2;
+  std::uint64_t k = complement ? num_pairs - m : m;
+
+  std::mt19937_64 gen(seed);
+  FlatHashSet<std::uint64_t> chosen;
+  chosen.reserve(k);
+  for (std::uint64_t j = num_pairs - k; j < num_pairs; ++j) {
+    std::uint64_t t = std::uniform_int_distribution<std::uint64_t>(0, j)(gen);
+    if (!chosen.insert(t).second) {
+      chosen.insert(j);
+    }
+  }
+  std::vector<std::uint64_t> indices(chosen.begin(), chosen.end());
+  std::sort(indices.begin(), indices.end());
+
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  edges.reserve(m);
+  if (!complement) {
+    for (std::uint64_t index : indices) {
+      edges.push_back(detail::pair_at(index));
+    }
+  } else {
+    auto skipped = indices.begin();
+    for (std::uint64_t index = 0; index < num_pairs; ++index) {
+      if (skipped != indices.end() && *skipped == index) {
+        ++skipped;
+      } else {
+        edges.push_back(detail::pair_at(index));
       }
     }
   }
+  return edges;
+}
+
+inline GraphBundle random(std::size_t size, double density, unsigned seed) {
 
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
-  gb.props.graph["num_edges"] = boost::num_edges(g);
+  GraphBundle gb = detail::random_bundle(size, gnp_edges(size, density, seed));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.graph.assign("name", "random");
+  gb.props.graph.assign("size", size);
+  gb.props.graph.assign("density", density);
+  gb.props.graph.assign("seed", seed);
+
+  return gb;
+}
+
+inline GraphBundle random_gnm(std::size_t size, std::size_t num_edges,
+                              unsigned seed) {
+
+  GraphBundle gb =
+      detail::random_bundle(size, gnm_edges(size, num_edges, seed));
+
+  gb.props.graph.assign("name", "random_gnm");
+  gb.props.graph.assign("size", size);
+  gb.props.graph.assign("seed", seed);
 
   return gb;
 }
@@ -563,11 +802,11 @@ inline GraphBundle random_bipartite(std::size_t size1, std::size_t size2,
 
   std::mt19937 gen(seed);
 
-  gb.props.graph["name"] = "random_bipartite";
-  gb.props.graph["size1"] = size1;
-  gb.props.graph["size2"] = size2;
-  gb.props.graph["density"] = density;
-  gb.props.graph["seed"] = seed;
+  gb.props.graph.assign("name", "random_bipartite");
+  gb.props.graph.assign("size1", size1);
+  gb.props.graph.assign("size2", size2);
+  gb.props.graph.assign("density", density);
+  gb.props.graph.assign("seed", seed);
 
   for (std::size_t i = 0; i < size1; ++i) {
     positions[boost::add_vertex(gb.graph)] = {0, static_cast<double>(i)};
@@ -577,114 +816,241 @@ inline GraphBundle random_bipartite(std::size_t size1, std::size_t size2,
     positions[boost::add_vertex(gb.graph)] = {1, static_cast<double>(i)};
   }
 
+  // Skip over the pairs (i, j), in row-major order, that are not edges.
   std::uniform_real_distribution<double> dist(0.0, 1.0);
-
-  for (std::size_t i = 0; i < size1; ++i) {
-    for (std::size_t j = 0; j < size2; ++j) {
-      if (dist(gen) < density) {
-        boost::add_edge(i, size1 + j, g);
-      }
+  double num_pairs = static_cast<double>(size1) * static_cast<double>(size2);
+  double k = -1.0;
+  while (density > 0.0) {
+    k += 1.0;
+    if (density < 1.0) {
+      k += std::floor(std::log1p(-dist(gen)) / std::log1p(-density));
     }
+    if (k >= num_pairs) {
+      break;
+    }
+    auto index = static_cast<std::size_t>(k);
+    boost::add_edge(index / size2, size1 + index % size2, g);
   }
 
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
-  gb.props.graph["num_edges"] = boost::num_edges(g);
+  gb.props.graph.assign("num_vertices", boost::num_vertices(g));
+  gb.props.graph.assign("num_edges", boost::num_edges(g));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.vertex.assign("position", positions);
 
   return gb;
 }
 
-inline bool _suitable(
-    const std::unordered_set<std::pair<std::size_t, std::size_t>,
-                             symmetric_pair_hash<std::size_t, std::size_t>,
-                             symmetric_pair_equal<std::size_t, std::size_t>>
-        &edges,
-    const std::unordered_map<std::size_t, std::size_t> &potential_edges) {
+namespace detail {
 
-  if (potential_edges.empty()) {
-    return true;
+/**
+ * Multiplicities of the pairs {v, w} of a multigraph on n vertices, in a
+ * linear-probing table. Slots whose count drops to zero keep their key, so
+ * probes stay valid; the table is rebuilt without them when it fills up.
+ */
+class pair_counts {
+public:
+  pair_counts(std::size_t n, std::size_t expected) : n_{n} {
+    std::size_t capacity = 16;
+    while (capacity < 2 * expected) {
+      capacity *= 2;
+    }
+    keys_.assign(capacity, 0);
+    counts_.assign(capacity, 0);
   }
 
-  for (auto [k1, v1] : potential_edges) {
-    for (auto [k2, v2] : potential_edges) {
-      if (k1 == k2)
-        break;
+  std::uint32_t count(std::size_t v, std::size_t w) const {
+    return counts_[slot(key(v, w))];
+  }
 
-      bool contains_edge = (k1 > k2 && edges.contains({k2, k1})) ||
-                           (k1 < k2 && edges.contains({k1, k2}));
-      if (!contains_edge)
-        return true;
+  // Returns the new count.
+  std::uint32_t add(std::size_t v, std::size_t w) {
+    if (2 * (used_ + 1) > keys_.size()) {
+      grow();
     }
+    std::uint64_t k = key(v, w);
+    std::size_t i = slot(k);
+    if (keys_[i] == 0) {
+      keys_[i] = k;
+      ++used_;
+    }
+    return ++counts_[i];
   }
-  return false;
-}
 
-inline std::optional<
-    std::unordered_set<std::pair<std::size_t, std::size_t>,
-                       symmetric_pair_hash<std::size_t, std::size_t>,
-                       symmetric_pair_equal<std::size_t, std::size_t>>>
-_try_creation(std::size_t size, std::size_t degree, std::mt19937 &gen) {
-
-  std::unordered_set<std::pair<std::size_t, std::size_t>,
-                     symmetric_pair_hash<std::size_t, std::size_t>,
-                     symmetric_pair_equal<std::size_t, std::size_t>>
-      edges;
-  std::vector<std::size_t> stubs;
-  stubs.reserve(size * degree);
-  for (std::size_t i = 0; i < degree; ++i) {
-    for (std::size_t j = 0; j < size; ++j) {
-      stubs.push_back(j);
+  void remove(std::size_t v, std::size_t w) { --counts_[slot(key(v, w))]; }
+
+private:
+  std::size_t n_;
+  std::size_t used_ = 0;
+  std::vector<std::uint64_t> keys_; // 0 for an empty slot
+  std::vector<std::uint32_t> counts_;
+
+  std::uint64_t key(std::size_t v, std::size_t w) const {
+    if (v > w) {
+      std::swap(v, w);
     }
+    return static_cast<std::uint64_t>(v) * n_ + w + 1;
   }
 
-  while (!stubs.empty()) {
-
-    std::unordered_map<std::size_t, std::size_t> potential_edges;
-    std::shuffle(stubs.begin(), stubs.end(), gen);
+  std::size_t slot(std::uint64_t k) const {
+    std::size_t mask = keys_.size() - 1;
+    std::size_t i = static_cast<std::size_t>((k * 0x9e3779b97f4a7c15ull) >> 20) & mask;
+    while (keys_[i] != 0 && keys_[i] != k) {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
 
-    for (std::size_t i = 0; i < static_cast<std::size_t>(stubs.size()) - 1;
-         i += 2) {
-      std::size_t s1 = stubs[i];
-      std::size_t s2 = stubs[i + 1];
+  void grow() {
+    std::vector<std::uint64_t> keys = std::move(keys_);
+    std::vector<std::uint32_t> counts = std::move(counts_);
+    std::size_t live = 0;
+    for (std::uint32_t c : counts) {
+      live += c != 0;
+    }
+    std::size_t capacity = keys.size();
+    while (capacity < 4 * (live + 1)) {
+      capacity *= 2;
+    }
+    keys_.assign(capacity, 0);
+    counts_.assign(capacity, 0);
+    used_ = live;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      if (counts[i] != 0) {
+        std::size_t j = slot(keys[i]);
+        keys_[j] = keys[i];
+        counts_[j] = counts[i];
+      }
+    }
+  }
+};
+
+// regular_edges for 2 * degree < n. Returns no edges in the rare case that
+// a bad edge finds no switch, e.g. when most edges are loops.
+inline std::vector<std::pair<std::size_t, std::size_t>>
+sparse_regular_edges(std::size_t n, std::size_t degree, std::mt19937_64 &gen,
+                     pair_counts &counts) {
+  std::size_t m = n * degree / 2;
+
+  std::vector<std::size_t> stubs(n * degree);
+  for (std::size_t i = 0; i < stubs.size(); ++i) {
+    stubs[i] = i / degree;
+  }
+  std::shuffle(stubs.begin(), stubs.end(), gen);
+
+  // Loops, and every copy of an edge after the first.
+  std::vector<std::pair<std::size_t, std::size_t>> edges(m);
+  std::vector<std::size_t> bad;
+  for (std::size_t i = 0; i < m; ++i) {
+    auto [u, v] = edges[i] = {stubs[2 * i], stubs[2 * i + 1]};
+    if (counts.add(u, v) > 1 || u == v) {
+      bad.push_back(i);
+    }
+  }
+  stubs = {};
 
-      if (s1 > s2) {
-        std::swap(s1, s2);
+  std::uniform_int_distribution<std::size_t> pick(0, m - 1);
+  for (std::size_t i : bad) {
+    for (std::size_t tries = 0;; ++tries) {
+      if (tries > 64 + 4 * m) {
+        return {};
+      }
+      // A switch elsewhere may have fixed this one already.
+      auto [u, v] = edges[i];
+      if (u != v && counts.count(u, v) == 1) {
+        break;
       }
 
-      if (s1 != s2 && !edges.contains({s1, s2})) {
-        edges.insert({s1, s2});
-      } else {
-        potential_edges[s1]++;
-        potential_edges[s2]++;
+      std::size_t j = pick(gen);
+      auto [x, y] = edges[j];
+      if (gen() & 1) {
+        std::swap(x, y);
+      }
+      if (j == i || u == x || v == y || (u == v && x == y) ||
+          (u == y && v == x) ||
+          counts.count(u, x) != 0 || counts.count(v, y) != 0) {
+        continue;
       }
-    }
 
-    if (!_suitable(edges, potential_edges)) {
-      return std::nullopt;
+      counts.remove(u, v);
+      counts.remove(x, y);
+      counts.add(u, x);
+      counts.add(v, y);
+      edges[i] = {u, x};
+      edges[j] = {v, y};
     }
+  }
 
-    std::vector<std::size_t> next_stubs;
-    for (auto [k, v] : potential_edges) {
-      for (std::size_t i = 0; i < v; ++i) {
-        next_stubs.push_back(k);
-      }
+  for (auto &[v, w] : edges) {
+    if (v < w) {
+      std::swap(v, w);
     }
-    stubs = next_stubs;
   }
   return edges;
 }
 
-inline GraphBundle random_regular(std::size_t size, std::size_t degree,
-                                  unsigned seed) {
+} // namespace detail
 
-  GraphBundle gb;
+inline std::vector<std::pair<std::size_t, std::size_t>>
+regular_edges(std::size_t n, std::size_t degree, std::uint64_t seed) {
+  if (n * degree % 2 != 0) {
+    throw std::invalid_argument("regular_edges: n * degree must be even");
+  }
+  if (degree >= n && n > 0) {
+    throw std::invalid_argument("regular_edges: degree must be less than n");
+  }
+  if (degree == 0) {
+    return {};
+  }
 
-  Graph &g = gb.graph;
+  std::mt19937_64 gen(seed);
 
-  VertexMap<std::vector<double>> positions;
+  bool complement = 2 * degree > n - 1;
+  std::size_t d = complement ? n - 1 - degree : degree;
+  detail::pair_counts counts(n, n * d / 2);
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  while (d > 0 && edges.empty()) {
+    counts = detail::pair_counts(n, n * d / 2);
+    edges = detail::sparse_regular_edges(n, d, gen, counts);
+  }
+  if (!complement) {
+    return edges;
+  }
 
-  std::mt19937 gen(seed);
+  // The complement, walking each vertex's sorted lower neighbours alongside
+  // the w it would otherwise connect to.
+  std::vector<std::size_t> offsets(n + 1, 0);
+  for (auto [v, w] : edges) {
+    ++offsets[v + 1];
+  }
+  for (std::size_t v = 0; v < n; ++v) {
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<std::size_t> lower(edges.size());
+  std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+  for (auto [v, w] : edges) {
+    lower[fill[v]++] = w;
+  }
+  edges = {};
+
+  std::vector<std::pair<std::size_t, std::size_t>> dense;
+  dense.reserve(n * degree / 2);
+  for (std::size_t v = 1; v < n; ++v) {
+    auto first = lower.begin() + static_cast<std::ptrdiff_t>(offsets[v]);
+    auto last = lower.begin() + static_cast<std::ptrdiff_t>(offsets[v + 1]);
+    std::sort(first, last);
+    for (std::size_t w = 0; w < v; ++w) {
+      if (first != last && *first == w) {
+        ++first;
+      } else {
+        dense.emplace_back(v, w);
+      }
+    }
+  }
+  return dense;
+}
+
+inline GraphBundle random_regular(std::size_t size, std::size_t degree,
+                                  unsigned seed) {
 
   if (size * degree % 2 != 0) {
     throw std::runtime_error("size * degree must be even");
@@ -694,29 +1060,13 @@ inline GraphBundle random_regular(std::size_t size, std::size_t degree,
     throw std::runtime_error("degree must be less than size");
   }
 
-  gb.props.graph["name"] = "random_regular";
-  gb.props.graph["size"] = size;
-  gb.props.graph["degree"] = degree;
-  gb.props.graph["seed"] = seed;
-
-  auto edges = _try_creation(size, degree, gen);
-  while (!edges) {
-    edges = _try_creation(size, degree, gen);
-  }
-
-  for (std::size_t i = 0; i < size; ++i) {
-    positions[boost::add_vertex(gb.graph)] = {std::cos(2 * M_PI * i / size),
-                                              std::sin(2 * M_PI * i / size)};
-  }
-
-  for (auto [s1, s2] : *edges) {
-    boost::add_edge(s1, s2, g);
-  }
-
-  gb.props.graph["num_vertices"] = boost::num_vertices(g);
-  gb.props.graph["num_edges"] = boost::num_edges(g);
+  GraphBundle gb =
+      detail::random_bundle(size, regular_edges(size, degree, seed));
 
-  gb.props.vertex["position"] = positions;
+  gb.props.graph.assign("name", "random_regular");
+  gb.props.graph.assign("size", size);
+  gb.props.graph.assign("degree", degree);
+  gb.props.graph.assign("seed", seed);
 
   return gb;
 }
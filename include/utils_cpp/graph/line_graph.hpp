@@ -9,9 +9,16 @@
 
 #pragma once
 
+#include "utils_cpp/graph/csr_graph.hpp"
 #include "utils_cpp/graph/graph.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
 #include "utils_cpp/print.hpp"
 
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
 namespace utils {
 
 namespace gl {
@@ -23,39 +30,95 @@ namespace gl {
  * a common vertex. This is known as the 'line graph' of g.
  *
  * @param g The undirected input graph.
+ * @param pool If not null, the cliques of different vertices are emitted in
+ * parallel. The result does not depend on it.
  * @return std::pair<Graph, VertexMap<Edge<>>> The line graph of g and a map
  * from vertices of lg to edges of g.
  */
-inline std::pair<Graph, VertexMap<Edge<>>> line_graph(const Graph &g) {
+std::pair<Graph, VertexMap<Edge<>>>
+line_graph(const Graph &g, parallel::thread_pool *pool = nullptr);
 
-  Graph lg(boost::num_edges(g));
+/**
+ * @brief The line graph of an undirected CsrGraph, as a CsrGraph. Vertex i
+ * of the result is the edge with id i in g.
+ *
+ * @details Each vertex of g contributes a clique on its incident edge ids,
+ * which CsrGraph already stores next to each neighbor list. The cliques'
+ * sizes are summed up front, so every vertex writes its pairs straight into
+ * its own slice of one array, and the result is built from that array in
+ * one pass. O(sum of deg^2) time and memory, with no hashing or edge
+ * lookups.
+ *
+ * @throws std::invalid_argument if g is directed.
+ */
+template <typename WeightType>
+CsrGraph<> line_graph(const CsrGraph<WeightType> &g,
+                      parallel::thread_pool *pool = nullptr);
 
-  EdgeMap<Vertex<>, Graph> edge_to_vertex;
-  VertexMap<Edge<>, Graph> vertex_to_edge;
+// ==== Implementation ====
 
-  std::size_t index = 0;
-  for (Edge<> e : boost::make_iterator_range(boost::edges(g))) {
-    edge_to_vertex[e] = index;
-    vertex_to_edge[index] = e;
-    ++index;
-  }
+namespace detail {
 
-  for (Vertex<> v : boost::make_iterator_range(boost::vertices(g))) {
+template <typename WeightType>
+std::vector<std::pair<std::size_t, std::size_t>>
+line_graph_edges(const CsrGraph<WeightType> &g, parallel::thread_pool *pool) {
+  if (g.is_directed()) {
+    throw std::invalid_argument("line_graph: the graph must be undirected");
+  }
 
-    std::vector<std::size_t> lg_clique_nodes;
+  const std::size_t n = g.num_vertices();
+  std::vector<std::size_t> offsets(n + 1, 0);
+  for (std::size_t v = 0; v < n; ++v) {
+    std::size_t d = g.degree(v);
+    offsets[v + 1] = offsets[v] + d * (d - 1) / 2;
+  }
 
-    for (Vertex<> nb :
-         boost::make_iterator_range(boost::adjacent_vertices(v, g))) {
-      lg_clique_nodes.push_back(edge_to_vertex[boost::edge(v, nb, g).first]);
+  std::vector<std::pair<std::size_t, std::size_t>> edges(offsets[n]);
+  auto emit = [&](std::size_t v) {
+    auto ids = g.edge_ids(v);
+    std::size_t pos = offsets[v];
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+      for (std::size_t j = i + 1; j < ids.size(); ++j) {
+        edges[pos++] = {ids[i], ids[j]};
+      }
     }
+  };
 
-    for (std::size_t i = 0; i < lg_clique_nodes.size(); ++i) {
-      for (std::size_t j = i + 1; j < lg_clique_nodes.size(); ++j) {
-        boost::add_edge(lg_clique_nodes[i], lg_clique_nodes[j], lg);
-      }
+  if (pool) {
+    pool->parallel_for(std::size_t{0}, n, 0, emit);
+  } else {
+    for (std::size_t v = 0; v < n; ++v) {
+      emit(v);
     }
   }
-  return {lg, vertex_to_edge};
+  return edges;
+}
+
+} // namespace detail
+
+inline std::pair<Graph, VertexMap<Edge<>>>
+line_graph(const Graph &g, parallel::thread_pool *pool) {
+
+  // CsrGraph numbers the edges in boost::edges order, so edge id i is the
+  // i-th edge below.
+  auto edges = detail::line_graph_edges(CsrGraph(g), pool);
+
+  VertexMap<Edge<>, Graph> vertex_to_edge;
+  vertex_to_edge.reserve(boost::num_edges(g));
+  std::size_t index = 0;
+  for (Edge<> e : boost::make_iterator_range(boost::edges(g))) {
+    vertex_to_edge[index] = e;
+    ++index;
+  }
+
+  return {detail::graph_from_edges(boost::num_edges(g), edges),
+          vertex_to_edge};
+}
+
+template <typename WeightType>
+CsrGraph<> line_graph(const CsrGraph<WeightType> &g,
+                      parallel::thread_pool *pool) {
+  return CsrGraph<>(g.num_edges(), detail::line_graph_edges(g, pool));
 }
 
 } // namespace gl
@@ -14,29 +14,111 @@
 
 #pragma once
 
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/detail/radix_heap.hpp"
 #include "utils_cpp/graph/graph.hpp"
+#include "utils_cpp/matrix.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+#include "utils_cpp/stats.hpp"
 
 #include <boost/graph/astar_search.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <string>
 #include <type_traits>
+#include <variant>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 namespace utils {
 namespace gl {
 
 namespace detail {
 
+/**
+ * @internal
+ * @brief A weight map giving every edge a weight of 1, without storing
+ * anything per edge.
+ */
 template <typename GraphType>
-inline EdgeMap<std::size_t, GraphType>
-make_unit_weight_map(const GraphType &g) {
-  EdgeMap<std::size_t, GraphType> weight_map;
-  weight_map.reserve(boost::num_edges(g));
-  for (auto e : boost::make_iterator_range(boost::edges(g))) {
-    weight_map[e] = 1;
-  }
-  return weight_map;
+inline auto make_unit_weight_map(const GraphType &) {
+  return boost::make_static_property_map<Edge<GraphType>>(std::size_t{1});
 }
 
+/**
+ * @internal
+ * @brief Weight types for which Dijkstra uses a radix heap (or a 0-1 BFS when
+ * every weight is 0 or 1) instead of a binary heap.
+ */
+template <typename WeightType>
+constexpr bool integer_weights =
+    std::is_unsigned_v<WeightType> && !std::is_same_v<WeightType, bool>;
+
+/**
+ * @internal
+ * @brief Whether the Dijkstra overloads for a Graph or DiGraph hand the search
+ * to the CsrGraph version, which has the integer-weight engine.
+ */
+template <typename GraphType, typename WeightType>
+constexpr bool use_integer_dijkstra =
+    integer_weights<WeightType> &&
+    std::is_same_v<Vertex<GraphType>, std::size_t>;
+
+/**
+ * @internal
+ * @brief Boost visitors feeding the utils::stats counters. Their callbacks
+ * are empty unless UTILS_CPP_ENABLE_STATS is defined.
+ */
+template <typename Base>
+struct stats_visitor : Base {
+  template <typename V, typename G>
+  void discover_vertex(V, const G &) {
+    UTILS_CPP_STATS_ADD(heap_pushes, 1);
+  }
+  template <typename V, typename G>
+  void examine_vertex(V, const G &) {
+    UTILS_CPP_STATS_ADD(vertices_settled, 1);
+  }
+  template <typename E, typename G>
+  void examine_edge(E, const G &) {
+    UTILS_CPP_STATS_ADD(edges_scanned, 1);
+  }
+  template <typename E, typename G>
+  void edge_relaxed(E, const G &) {
+    UTILS_CPP_STATS_ADD(edges_relaxed, 1);
+  }
+};
+
+using dijkstra_stats_visitor = stats_visitor<boost::default_dijkstra_visitor>;
+using astar_stats_visitor = stats_visitor<boost::default_astar_visitor>;
+
+/**
+ * @internal
+ * @brief An A* heuristic that can also fill out[i] = h(vertices[i]) for a
+ * whole span of vertices in one call.
+ */
+template <typename H>
+concept batch_heuristic = requires(const H &h,
+                                   std::span<const std::size_t> vertices,
+                                   std::span<double> out) {
+  h(vertices, out);
+};
+
 } // namespace detail
 
 /**
@@ -76,112 +158,1660 @@ template <typename GraphType>
 std::vector<std::size_t> bfs_distances(const GraphType &g,
                                        Vertex<GraphType> source) {
 
-  std::vector<std::size_t> distances(boost::num_vertices(g));
+  std::vector<std::size_t> distances(boost::num_vertices(g));
+
+  auto recorder =
+      boost::record_distances(distances.data(), boost::on_tree_edge{});
+
+  boost::breadth_first_search(
+      g, source, boost::visitor(boost::make_bfs_visitor(recorder)));
+
+  return distances;
+}
+
+/**
+ * @brief Run BFS from a source vertex to all other vertices in the graph,
+  returning predecessors only
+ * @param g The graph to search
+ * @param source The source vertex
+ * @return A vector containing the predecessors of each vertex in the graph.
+ */
+template <typename GraphType>
+std::vector<Vertex<GraphType>> bfs_predecessors(const GraphType &g,
+                                                Vertex<GraphType> source) {
+
+  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
+
+  auto recorder =
+      boost::record_predecessors(predecessors.data(), boost::on_tree_edge{});
+
+  boost::breadth_first_search(
+      g, source, boost::visitor(boost::make_bfs_visitor(recorder)));
+
+  return predecessors;
+}
+
+/**
+ * @brief Run Dijkstra from a source vertex to all other vertices in the graph,
+  returning predecessors only
+ * @param g The graph to search
+ * @param source The source vertex
+ * @param weight_map (optional) A map from edges to their weights.
+ * @return A pair of vectors, the first containing the distances from the
+ * source vertex to each vertex in the graph, and the second containing the
+ * predecessors of each vertex in the graph
+ */
+template <typename GraphType, typename WeightType>
+std::pair<std::vector<WeightType>, std::vector<Vertex<GraphType>>>
+dijkstra(const GraphType &g, Vertex<GraphType> source,
+         const EdgeMap<WeightType, GraphType> &weight_map) {
+
+  if constexpr (detail::use_integer_dijkstra<GraphType, WeightType>) {
+    return dijkstra(CsrGraph(g, weight_map), source);
+  }
+
+  std::vector<WeightType> distances(boost::num_vertices(g));
+  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
+
+  boost::dijkstra_shortest_paths(
+      g, source,
+      boost::predecessor_map(predecessors.data())
+          .distance_map(distances.data())
+          .weight_map(boost::make_assoc_property_map(weight_map))
+          .visitor(detail::dijkstra_stats_visitor()));
+
+  return {distances, predecessors};
+}
+
+/**
+ * @brief Run Dijkstra from a source vertex to all other vertices in the
+ * graph, returning distances only
+ * @param g The graph to search
+ * @param source The source vertex
+ * @param weight_map (optional) A map from edges to their weights.
+ * @return A vector containing the distances from the source vertex to each
+ vertex in the graph.
+ */
+template <typename GraphType, typename WeightType>
+std::vector<WeightType>
+dijkstra_distances(const GraphType &g, Vertex<GraphType> source,
+                   const EdgeMap<WeightType, GraphType> &weight_map) {
+
+  if constexpr (detail::use_integer_dijkstra<GraphType, WeightType>) {
+    return dijkstra_distances(CsrGraph(g, weight_map), source);
+  }
+
+  std::vector<WeightType> distances(boost::num_vertices(g));
+
+  boost::dijkstra_shortest_paths(
+      g, source,
+      boost::distance_map(distances.data())
+          .weight_map(boost::make_assoc_property_map(weight_map))
+          .visitor(detail::dijkstra_stats_visitor()));
+
+  return distances;
+}
+
+/**
+ * @brief Run Dijkstra from a source vertex to all other vertices in the graph,
+ *        returning predecessors only
+ * @param g The graph to search
+ * @param source The source vertex
+ * @param weight_map (optional) A map from edges to their weights. If omitted,
+ * falls back to BFS.
+ * @return A vector containing the predecessors of each vertex in the graph.
+ */
+template <typename GraphType, typename WeightType = std::size_t>
+std::vector<Vertex<GraphType>>
+dijkstra_predecessors(const GraphType &g, Vertex<GraphType> source,
+                      const EdgeMap<WeightType, GraphType> &weight_map) {
+
+  if constexpr (detail::use_integer_dijkstra<GraphType, WeightType>) {
+    return dijkstra_predecessors(CsrGraph(g, weight_map), source);
+  }
+
+  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
+
+  boost::dijkstra_shortest_paths(
+      g, source,
+      boost::predecessor_map(predecessors.data())
+          .weight_map(boost::make_assoc_property_map(weight_map))
+          .visitor(detail::dijkstra_stats_visitor()));
+
+  return predecessors;
+}
+
+// ============== CsrGraph Overloads ================
+
+template <typename DistanceType>
+class PathfindingWorkspace;
+
+template <typename WeightType>
+void dijkstra(const CsrGraph<WeightType> &g, std::size_t source,
+              PathfindingWorkspace<WeightType> &ws);
+
+/**
+ * @brief BFS over a CsrGraph. Same results as bfs() on the Graph or DiGraph
+ * the CsrGraph was built from: unreachable vertices are left with distance
+ * and predecessor 0.
+ */
+template <typename WeightType>
+std::pair<std::vector<std::size_t>, std::vector<std::size_t>>
+bfs(const CsrGraph<WeightType> &g, std::size_t source) {
+
+  std::vector<std::size_t> distances(g.num_vertices());
+  std::vector<std::size_t> predecessors(g.num_vertices());
+  std::vector<bool> visited(g.num_vertices());
+
+  // Every vertex is enqueued at most once, so a vector with a read cursor is
+  // all the queue BFS needs.
+  std::vector<std::size_t> queue;
+  queue.reserve(g.num_vertices());
+  queue.push_back(source);
+  visited[source] = true;
+
+  for (std::size_t head = 0; head < queue.size(); ++head) {
+    std::size_t u = queue[head];
+    for (std::size_t v : g.neighbors(u)) {
+      if (!visited[v]) {
+        visited[v] = true;
+        distances[v] = distances[u] + 1;
+        predecessors[v] = u;
+        queue.push_back(v);
+      }
+    }
+  }
+
+  return {distances, predecessors};
+}
+
+/**
+ * @brief BFS over a CsrGraph, returning distances only.
+ */
+template <typename WeightType>
+std::vector<std::size_t> bfs_distances(const CsrGraph<WeightType> &g,
+                                       std::size_t source) {
+  return bfs(g, source).first;
+}
+
+/**
+ * @brief BFS over a CsrGraph, returning predecessors only.
+ */
+template <typename WeightType>
+std::vector<std::size_t> bfs_predecessors(const CsrGraph<WeightType> &g,
+                                          std::size_t source) {
+  return bfs(g, source).second;
+}
+
+/**
+ * @brief Dijkstra over a CsrGraph, using its edge weights (or a weight of 1
+ * per edge if it is unweighted). As with boost, unreachable vertices have
+ * distance std::numeric_limits<WeightType>::max() and are their own
+ * predecessor.
+ */
+template <typename WeightType>
+std::pair<std::vector<WeightType>, std::vector<std::size_t>>
+dijkstra(const CsrGraph<WeightType> &g, std::size_t source) {
+
+  if constexpr (detail::integer_weights<WeightType>) {
+    PathfindingWorkspace<WeightType> ws;
+    dijkstra(g, source, ws);
+    std::vector<WeightType> distances(g.num_vertices());
+    std::vector<std::size_t> predecessors(g.num_vertices());
+    for (std::size_t v = 0; v < g.num_vertices(); ++v) {
+      distances[v] = ws.distance(v);
+      predecessors[v] = ws.predecessor(v);
+    }
+    return {distances, predecessors};
+  }
+
+  constexpr WeightType inf = std::numeric_limits<WeightType>::max();
+
+  std::vector<WeightType> distances(g.num_vertices(), inf);
+  std::vector<std::size_t> predecessors(g.num_vertices());
+  for (std::size_t v = 0; v < g.num_vertices(); ++v) {
+    predecessors[v] = v;
+  }
+
+  using entry = std::pair<WeightType, std::size_t>;
+  std::priority_queue<entry, std::vector<entry>, std::greater<entry>> heap;
+
+  distances[source] = 0;
+  heap.push({0, source});
+  UTILS_CPP_STATS_ADD(heap_pushes, 1);
+
+  while (!heap.empty()) {
+    auto [d, u] = heap.top();
+    heap.pop();
+    if (d > distances[u]) {
+      UTILS_CPP_STATS_ADD(stale_pops, 1);
+      continue; // stale entry
+    }
+    auto nbs = g.neighbors(u);
+    auto ws = g.weights(u);
+    UTILS_CPP_STATS_ADD(vertices_settled, 1);
+    UTILS_CPP_STATS_ADD(edges_scanned, nbs.size());
+    for (std::size_t i = 0; i < nbs.size(); ++i) {
+      WeightType nd = d + (ws.empty() ? WeightType(1) : ws[i]);
+      std::size_t v = nbs[i];
+      if (nd < distances[v]) {
+        distances[v] = nd;
+        predecessors[v] = u;
+        heap.push({nd, v});
+        UTILS_CPP_STATS_ADD(edges_relaxed, 1);
+        UTILS_CPP_STATS_ADD(heap_pushes, 1);
+      }
+    }
+  }
+
+  return {distances, predecessors};
+}
+
+/**
+ * @brief Dijkstra over a CsrGraph, returning distances only.
+ */
+template <typename WeightType>
+std::vector<WeightType> dijkstra_distances(const CsrGraph<WeightType> &g,
+                                           std::size_t source) {
+  return dijkstra(g, source).first;
+}
+
+/**
+ * @brief Dijkstra over a CsrGraph, returning predecessors only.
+ */
+template <typename WeightType>
+std::vector<std::size_t> dijkstra_predecessors(const CsrGraph<WeightType> &g,
+                                               std::size_t source) {
+  return dijkstra(g, source).second;
+}
+
+/**
+ * @brief dijkstra_all_distances_all_predecessors over a CsrGraph, using its
+ * edge weights (or a weight of 1 per edge if it is unweighted). This copies
+ * the predecessor lists of shortest_path_dag() into sets; use that directly
+ * to avoid allocating a set per vertex.
+ */
+template <typename WeightType>
+std::pair<std::vector<WeightType>, std::vector<VertexSet<Graph>>>
+dijkstra_all_distances_all_predecessors(const CsrGraph<WeightType> &g,
+                                        std::size_t source) {
+  auto dag = shortest_path_dag(g, source);
+
+  std::vector<VertexSet<Graph>> predecessors(g.num_vertices());
+  for (std::size_t v = 0; v < g.num_vertices(); ++v) {
+    auto preds = dag.predecessors(v);
+    predecessors[v].insert(preds.begin(), preds.end());
+  }
+  return {std::move(dag.distances), predecessors};
+}
+
+// ============== Reusable Workspaces ================
+
+/**
+ * @brief Preallocated buffers for running many single-source searches on
+ * CsrGraphs, without allocating per query.
+ *
+ * @details Each vertex carries a generation stamp, and a vertex only counts as
+ * reached in the current search if its stamp matches the workspace's
+ * generation. Starting a new search therefore only bumps the generation, so
+ * its cost does not depend on how much of the graph the previous search
+ * touched (the stamps are cleared once every 2^32 searches).
+ *
+ * A workspace can be reused across graphs; it grows to the largest one.
+ * Workspaces are not thread-safe, use one per thread.
+ *
+ * @tparam DistanceType Type of the distances, std::size_t for BFS and the
+ * weight type of the graph for Dijkstra and A-star.
+ */
+template <typename DistanceType = std::size_t>
+class PathfindingWorkspace {
+public:
+  /// Distance of vertices that the last search did not reach.
+  static constexpr DistanceType unreachable =
+      std::numeric_limits<DistanceType>::max();
+
+  PathfindingWorkspace() = default;
+  explicit PathfindingWorkspace(std::size_t num_vertices) {
+    reset(num_vertices);
+  }
+
+  /**
+   * @brief Starts a new search on a graph with num_vertices vertices,
+   * forgetting the results of the previous one.
+   */
+  void reset(std::size_t num_vertices);
+
+  /**
+   * @brief Number of vertices the buffers are currently sized for.
+   */
+  std::size_t capacity() const noexcept { return stamps.size(); }
+
+  bool reached(std::size_t v) const { return stamps[v] == generation; }
+
+  /**
+   * @brief Distance of v found by the last search, or unreachable.
+   */
+  DistanceType distance(std::size_t v) const {
+    return reached(v) ? dist[v] : unreachable;
+  }
+
+  /**
+   * @brief Predecessor of v in the last search. Sources and vertices that were
+   * not reached are their own predecessor.
+   */
+  std::size_t predecessor(std::size_t v) const {
+    return reached(v) ? pred[v] : v;
+  }
+
+  /**
+   * @brief Vertices reached by the last search, in the order they were first
+   * reached.
+   */
+  std::span<const std::size_t> reached_vertices() const noexcept {
+    return order;
+  }
+
+  /**
+   * @brief Path from the source of the last search to target, both included.
+   * Empty if target was not reached.
+   */
+  std::vector<std::size_t> path_to(std::size_t target) const;
+
+  /**
+   * @brief Sets the distance and predecessor of v, marking it as reached.
+   * Used by the search functions.
+   */
+  void label(std::size_t v, DistanceType d, std::size_t p) {
+    if (!reached(v)) {
+      stamps[v] = generation;
+      order.push_back(v);
+    }
+    dist[v] = d;
+    pred[v] = p;
+  }
+
+  // Scratch min-heap of (key, vertex) pairs, for the search functions.
+  std::vector<std::pair<DistanceType, std::size_t>> heap;
+
+  // Scratch queue used by Dijkstra instead of 'heap' when the distances are
+  // unsigned integers.
+  std::conditional_t<detail::integer_weights<DistanceType>,
+                     detail::RadixHeap<DistanceType>, std::monostate>
+      radix;
+
+  // Scratch values of a batch heuristic for the neighbours of one vertex,
+  // used by A-star.
+  std::vector<double> batch_h;
+
+private:
+  std::vector<DistanceType> dist;
+  std::vector<std::size_t> pred;
+  std::vector<std::uint32_t> stamps;
+  std::vector<std::size_t> order;
+  std::uint32_t generation = 0;
+};
+
+/**
+ * @brief BFS over a CsrGraph into a reusable workspace.
+ */
+template <typename WeightType>
+void bfs(const CsrGraph<WeightType> &g, std::size_t source,
+         PathfindingWorkspace<std::size_t> &ws);
+
+/**
+ * @brief BFS from several sources at once: the distance of a vertex is its
+ * distance to the nearest source, and following predecessors leads to that
+ * source.
+ */
+template <typename WeightType>
+void multi_source_bfs(const CsrGraph<WeightType> &g,
+                      const std::vector<std::size_t> &sources,
+                      PathfindingWorkspace<std::size_t> &ws);
+
+/**
+ * @brief Multi-source BFS returning distances and predecessors. Vertices that
+ * no source reaches have distance std::numeric_limits<std::size_t>::max() and
+ * are their own predecessor.
+ */
+template <typename WeightType>
+std::pair<std::vector<std::size_t>, std::vector<std::size_t>>
+multi_source_bfs(const CsrGraph<WeightType> &g,
+                 const std::vector<std::size_t> &sources);
+
+template <typename GraphType>
+std::pair<std::vector<std::size_t>, std::vector<std::size_t>>
+multi_source_bfs(const GraphType &g, const std::vector<std::size_t> &sources) {
+  return multi_source_bfs(CsrGraph(g), sources);
+}
+
+/**
+ * @brief Dijkstra over a CsrGraph into a reusable workspace. For unsigned
+ * integer weights this uses a radix heap, or a 0-1 BFS if no weight exceeds
+ * 1, instead of a binary heap. The same holds for every Dijkstra overload on
+ * a CsrGraph, and for the Graph/DiGraph overloads taking an EdgeMap.
+ */
+template <typename WeightType>
+void dijkstra(const CsrGraph<WeightType> &g, std::size_t source,
+              PathfindingWorkspace<WeightType> &ws);
+
+/**
+ * @brief A-star over a CsrGraph into a reusable workspace, stopping once the
+ * goal is settled. heuristic(v) must be consistent; it is converted to
+ * WeightType, which for integer weights rounds it down and keeps it
+ * consistent.
+ *
+ * @return The distance to goal, or PathfindingWorkspace::unreachable. The path
+ * is available through ws.path_to(goal).
+ */
+template <typename WeightType, typename AStarHeuristic>
+WeightType astar_early_stopping(const CsrGraph<WeightType> &g,
+                                std::size_t source, std::size_t goal,
+                                const AStarHeuristic &heuristic,
+                                PathfindingWorkspace<WeightType> &ws);
+
+/**
+ * @brief Dijkstra from each of several sources.
+ *
+ * @details Row i of the result holds the distances from sources[i], with
+ * std::numeric_limits<WeightType>::max() for unreachable vertices. The
+ * sources are split into chunks that run in parallel on 'pool' if given, with
+ * one workspace per chunk.
+ */
+template <typename WeightType>
+Matrix<WeightType> dijkstra_many(const CsrGraph<WeightType> &g,
+                                 const std::vector<std::size_t> &sources,
+                                 parallel::thread_pool *pool = nullptr);
+
+template <typename GraphType, typename WeightType>
+Matrix<WeightType> dijkstra_many(const GraphType &g,
+                                 const std::vector<std::size_t> &sources,
+                                 const EdgeMap<WeightType, GraphType> &weights,
+                                 parallel::thread_pool *pool = nullptr) {
+  return dijkstra_many(CsrGraph(g, weights), sources, pool);
+}
+
+/**
+ * @brief Single-source shortest paths over a CsrGraph by delta-stepping, with
+ * the relaxations of each round run in parallel on 'pool' if given.
+ *
+ * @details Vertices are kept in buckets of width delta by tentative distance.
+ * The lowest bucket is emptied by repeatedly relaxing the light arcs (weight
+ * at most delta) of the vertices in it, in parallel, and its heavy arcs are
+ * then relaxed once. A small delta approaches Dijkstra, a large one
+ * Bellman-Ford; 0 picks the largest weight over the average degree.
+ *
+ * The distances are those of dijkstra(), with the same 'unreachable'. A
+ * reached vertex's predecessor is the smallest vertex u with dist[u] + w(u, v)
+ * == dist[v] (found by a search over tight arcs when weights of 0 are
+ * present); it equals dijkstra()'s whenever the shortest path to v is unique,
+ * and does not depend on the number of threads. The source and unreachable
+ * vertices are their own predecessors.
+ *
+ * Weights must be non-negative.
+ */
+template <typename WeightType>
+std::pair<std::vector<WeightType>, std::vector<std::size_t>>
+delta_stepping(const CsrGraph<WeightType> &g, std::size_t source,
+               WeightType delta = 0, parallel::thread_pool *pool = nullptr);
+
+/**
+ * @brief delta_stepping(), returning distances only. Skips the predecessor
+ * pass.
+ */
+template <typename WeightType>
+std::vector<WeightType>
+delta_stepping_distances(const CsrGraph<WeightType> &g, std::size_t source,
+                         WeightType delta = 0,
+                         parallel::thread_pool *pool = nullptr);
+
+/**
+ * @brief Graphs with at least this many arcs are searched by delta_stepping()
+ * in the overloads below that take a pool.
+ */
+inline constexpr std::size_t delta_stepping_min_arcs = std::size_t{1} << 18;
+
+/**
+ * @brief Dijkstra distances over a CsrGraph, handed to delta_stepping() on
+ * 'pool' when the graph is large enough for the parallel rounds to pay off.
+ * The result is the same either way.
+ */
+template <typename WeightType>
+std::vector<WeightType> dijkstra_distances(const CsrGraph<WeightType> &g,
+                                           std::size_t source,
+                                           parallel::thread_pool *pool) {
+  if (pool && g.num_arcs() >= delta_stepping_min_arcs) {
+    return delta_stepping_distances(g, source, WeightType(0), pool);
+  }
+  return dijkstra_distances(g, source);
+}
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+template <typename DistanceType>
+void PathfindingWorkspace<DistanceType>::reset(std::size_t num_vertices) {
+  if (num_vertices > stamps.size()) {
+    // New slots get stamp 0, which never matches a live generation.
+    dist.resize(num_vertices);
+    pred.resize(num_vertices);
+    stamps.resize(num_vertices, 0);
+    order.reserve(num_vertices);
+  }
+  if (++generation == 0) {
+    std::fill(stamps.begin(), stamps.end(), 0);
+    generation = 1;
+  }
+  order.clear();
+  heap.clear();
+}
+
+template <typename DistanceType>
+std::vector<std::size_t>
+PathfindingWorkspace<DistanceType>::path_to(std::size_t target) const {
+  std::vector<std::size_t> path;
+  if (target >= capacity() || !reached(target)) {
+    return path;
+  }
+  path.push_back(target);
+  while (pred[path.back()] != path.back()) {
+    path.push_back(pred[path.back()]);
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief BFS from every vertex already labelled in ws, in label order.
+ */
+template <typename WeightType>
+void bfs_from_labelled(const CsrGraph<WeightType> &g,
+                       PathfindingWorkspace<std::size_t> &ws) {
+  // reached_vertices() doubles as the queue, since BFS labels vertices in the
+  // order it dequeues them. It is re-read on each step because label() grows
+  // it.
+  for (std::size_t head = 0; head < ws.reached_vertices().size(); ++head) {
+    std::size_t u = ws.reached_vertices()[head];
+    std::size_t du = ws.distance(u);
+    for (std::size_t v : g.neighbors(u)) {
+      if (!ws.reached(v)) {
+        ws.label(v, du + 1, u);
+      }
+    }
+  }
+}
+
+template <typename DistanceType>
+void heap_push(PathfindingWorkspace<DistanceType> &ws, DistanceType key,
+               std::size_t v) {
+  UTILS_CPP_STATS_ADD(heap_pushes, 1);
+  ws.heap.emplace_back(key, v);
+  std::push_heap(ws.heap.begin(), ws.heap.end(), std::greater<>{});
+}
+
+template <typename DistanceType>
+std::pair<DistanceType, std::size_t>
+heap_pop(PathfindingWorkspace<DistanceType> &ws) {
+  std::pop_heap(ws.heap.begin(), ws.heap.end(), std::greater<>{});
+  auto top = ws.heap.back();
+  ws.heap.pop_back();
+  return top;
+}
+
+} // namespace detail
+
+template <typename WeightType>
+void bfs(const CsrGraph<WeightType> &g, std::size_t source,
+         PathfindingWorkspace<std::size_t> &ws) {
+  ws.reset(g.num_vertices());
+  ws.label(source, 0, source);
+  detail::bfs_from_labelled(g, ws);
+}
+
+template <typename WeightType>
+void multi_source_bfs(const CsrGraph<WeightType> &g,
+                      const std::vector<std::size_t> &sources,
+                      PathfindingWorkspace<std::size_t> &ws) {
+  ws.reset(g.num_vertices());
+  for (std::size_t s : sources) {
+    if (!ws.reached(s)) {
+      ws.label(s, 0, s);
+    }
+  }
+  detail::bfs_from_labelled(g, ws);
+}
+
+template <typename WeightType>
+std::pair<std::vector<std::size_t>, std::vector<std::size_t>>
+multi_source_bfs(const CsrGraph<WeightType> &g,
+                 const std::vector<std::size_t> &sources) {
+  PathfindingWorkspace<std::size_t> ws;
+  multi_source_bfs(g, sources, ws);
+
+  std::vector<std::size_t> distances(g.num_vertices());
+  std::vector<std::size_t> predecessors(g.num_vertices());
+  for (std::size_t v = 0; v < g.num_vertices(); ++v) {
+    distances[v] = ws.distance(v);
+    predecessors[v] = ws.predecessor(v);
+  }
+  return {distances, predecessors};
+}
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Dijkstra when every weight is 0 or 1: a deque with 0-edges pushed
+ * to the front and 1-edges to the back replaces the heap.
+ */
+template <typename WeightType>
+void zero_one_bfs(const CsrGraph<WeightType> &g, std::size_t source,
+                  PathfindingWorkspace<WeightType> &ws) {
+  std::deque<std::pair<WeightType, std::size_t>> queue;
+  queue.emplace_back(WeightType(0), source);
+  UTILS_CPP_STATS_ADD(heap_pushes, 1);
+
+  while (!queue.empty()) {
+    auto [d, u] = queue.front();
+    queue.pop_front();
+    if (d > ws.distance(u)) {
+      UTILS_CPP_STATS_ADD(stale_pops, 1);
+      continue; // stale entry
+    }
+    auto nbs = g.neighbors(u);
+    auto wts = g.weights(u);
+    UTILS_CPP_STATS_ADD(vertices_settled, 1);
+    UTILS_CPP_STATS_ADD(edges_scanned, nbs.size());
+    for (std::size_t i = 0; i < nbs.size(); ++i) {
+      WeightType w = wts.empty() ? WeightType(1) : wts[i];
+      WeightType nd = d + w;
+      std::size_t v = nbs[i];
+      if (nd < ws.distance(v)) {
+        ws.label(v, nd, u);
+        UTILS_CPP_STATS_ADD(edges_relaxed, 1);
+        UTILS_CPP_STATS_ADD(heap_pushes, 1);
+        if (w == 0) {
+          queue.emplace_front(nd, v);
+        } else {
+          queue.emplace_back(nd, v);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @internal
+ * @brief Dijkstra with a radix heap, for unsigned integer weights.
+ */
+template <typename WeightType>
+void radix_dijkstra(const CsrGraph<WeightType> &g, std::size_t source,
+                    PathfindingWorkspace<WeightType> &ws) {
+  auto &heap = ws.radix;
+  heap.clear();
+  heap.push(0, source);
+  UTILS_CPP_STATS_ADD(heap_pushes, 1);
+
+  while (!heap.empty()) {
+    auto [d, u] = heap.pop();
+    if (d > ws.distance(u)) {
+      UTILS_CPP_STATS_ADD(stale_pops, 1);
+      continue; // stale entry
+    }
+    auto nbs = g.neighbors(u);
+    auto wts = g.weights(u);
+    UTILS_CPP_STATS_ADD(vertices_settled, 1);
+    UTILS_CPP_STATS_ADD(edges_scanned, nbs.size());
+    for (std::size_t i = 0; i < nbs.size(); ++i) {
+      WeightType nd = d + wts[i];
+      std::size_t v = nbs[i];
+      if (nd < ws.distance(v)) {
+        ws.label(v, nd, u);
+        heap.push(nd, v);
+        UTILS_CPP_STATS_ADD(edges_relaxed, 1);
+        UTILS_CPP_STATS_ADD(heap_pushes, 1);
+      }
+    }
+  }
+}
+
+} // namespace detail
+
+template <typename WeightType>
+void dijkstra(const CsrGraph<WeightType> &g, std::size_t source,
+              PathfindingWorkspace<WeightType> &ws) {
+  ws.reset(g.num_vertices());
+  ws.label(source, 0, source);
+
+  if constexpr (detail::integer_weights<WeightType>) {
+    if (g.max_weight() <= 1) {
+      detail::zero_one_bfs(g, source, ws);
+    } else {
+      detail::radix_dijkstra(g, source, ws);
+    }
+    return;
+  }
+
+  detail::heap_push(ws, WeightType(0), source);
+
+  while (!ws.heap.empty()) {
+    auto [d, u] = detail::heap_pop(ws);
+    if (d > ws.distance(u)) {
+      UTILS_CPP_STATS_ADD(stale_pops, 1);
+      continue; // stale entry
+    }
+    auto nbs = g.neighbors(u);
+    auto wts = g.weights(u);
+    UTILS_CPP_STATS_ADD(vertices_settled, 1);
+    UTILS_CPP_STATS_ADD(edges_scanned, nbs.size());
+    for (std::size_t i = 0; i < nbs.size(); ++i) {
+      WeightType nd = d + (wts.empty() ? WeightType(1) : wts[i]);
+      std::size_t v = nbs[i];
+      if (nd < ws.distance(v)) {
+        ws.label(v, nd, u);
+        UTILS_CPP_STATS_ADD(edges_relaxed, 1);
+        detail::heap_push(ws, nd, v);
+      }
+    }
+  }
+}
+
+template <typename WeightType, typename AStarHeuristic>
+WeightType astar_early_stopping(const CsrGraph<WeightType> &g,
+                                std::size_t source, std::size_t goal,
+                                const AStarHeuristic &heuristic,
+                                PathfindingWorkspace<WeightType> &ws) {
+  auto h = [&](std::size_t v) { return static_cast<WeightType>(heuristic(v)); };
+
+  // A heuristic with a batch form computes h for all the neighbours of u
+  // at once, relaxed or not.
+  constexpr bool batched = detail::batch_heuristic<AStarHeuristic>;
+  auto &batch_h = ws.batch_h;
+
+  ws.reset(g.num_vertices());
+  ws.label(source, 0, source);
+  detail::heap_push(ws, h(source), source);
+
+  while (!ws.heap.empty()) {
+    auto [f, u] = detail::heap_pop(ws);
+    WeightType d = ws.distance(u);
+    if (f > d + h(u)) {
+      UTILS_CPP_STATS_ADD(stale_pops, 1);
+      continue; // stale entry
+    }
+    UTILS_CPP_STATS_ADD(vertices_settled, 1);
+    if (u == goal) {
+      return d;
+    }
+    auto nbs = g.neighbors(u);
+    auto wts = g.weights(u);
+    UTILS_CPP_STATS_ADD(edges_scanned, nbs.size());
+    if constexpr (batched) {
+      if (batch_h.size() < nbs.size()) {
+        batch_h.resize(nbs.size());
+      }
+      heuristic(nbs, std::span<double>(batch_h));
+    }
+    for (std::size_t i = 0; i < nbs.size(); ++i) {
+      WeightType nd = d + (wts.empty() ? WeightType(1) : wts[i]);
+      std::size_t v = nbs[i];
+      if (nd < ws.distance(v)) {
+        ws.label(v, nd, u);
+        UTILS_CPP_STATS_ADD(edges_relaxed, 1);
+        WeightType hv;
+        if constexpr (batched) {
+          hv = static_cast<WeightType>(batch_h[i]);
+        } else {
+          hv = h(v);
+        }
+        detail::heap_push(ws, nd + hv, v);
+      }
+    }
+  }
+
+  return PathfindingWorkspace<WeightType>::unreachable;
+}
+
+template <typename WeightType>
+Matrix<WeightType> dijkstra_many(const CsrGraph<WeightType> &g,
+                                 const std::vector<std::size_t> &sources,
+                                 parallel::thread_pool *pool) {
+  std::size_t n = g.num_vertices();
+  Matrix<WeightType> dist(sources.size(), n,
+                          PathfindingWorkspace<WeightType>::unreachable);
+
+  // Only the reached vertices need writing, the rest of the row already
+  // holds 'unreachable'.
+  auto run_chunk = [&](std::size_t first, std::size_t last) {
+    PathfindingWorkspace<WeightType> ws(n);
+    for (std::size_t i = first; i < last; ++i) {
+      dijkstra(g, sources[i], ws);
+      for (std::size_t v : ws.reached_vertices()) {
+        dist(i, v) = ws.distance(v);
+      }
+    }
+  };
+
+  if (pool && sources.size() > 1) {
+    std::size_t num_chunks = std::min(sources.size(), 4 * (pool->size() + 1));
+    std::size_t chunk = (sources.size() + num_chunks - 1) / num_chunks;
+    pool->parallel_for(std::size_t{0}, num_chunks, 1, [&](std::size_t c) {
+      run_chunk(std::min(c * chunk, sources.size()),
+                std::min((c + 1) * chunk, sources.size()));
+    });
+  } else {
+    run_chunk(0, sources.size());
+  }
+
+  return dist;
+}
+
+namespace detail {
+
+// Frontiers smaller than this are relaxed on the calling thread.
+inline constexpr std::size_t delta_stepping_grain = 1024;
+
+template <typename WeightType>
+WeightType default_delta(const CsrGraph<WeightType> &g) {
+  auto weights = g.weights();
+  if (weights.empty() || g.num_vertices() == 0) {
+    return WeightType(1);
+  }
+  WeightType max_weight = *std::max_element(weights.begin(), weights.end());
+  double degree = static_cast<double>(g.num_arcs()) /
+                  static_cast<double>(g.num_vertices());
+  auto delta = static_cast<WeightType>(static_cast<double>(max_weight) /
+                                       std::max(degree, 1.0));
+  return delta > WeightType(0) ? delta : WeightType(1);
+}
+
+/**
+ * @internal
+ * @brief The state of one delta-stepping search. Distances and stamps are
+ * updated through std::atomic_ref while a round is relaxed in parallel, and
+ * read plainly between rounds.
+ */
+template <typename WeightType>
+class delta_stepping_search {
+public:
+  static constexpr WeightType unreachable =
+      std::numeric_limits<WeightType>::max();
+
+  delta_stepping_search(const CsrGraph<WeightType> &g, WeightType delta,
+                        parallel::thread_pool *pool)
+      : g_(g), delta_(delta > WeightType(0) ? delta : default_delta(g)),
+        pool_(pool), dist_(g.num_vertices(), unreachable),
+        stamps_(g.num_vertices(), 0) {}
+
+  std::vector<WeightType> run(std::size_t source) {
+    dist_[source] = 0;
+    buckets_[0].push_back(source);
+
+    std::vector<std::size_t> frontier, settled, improved;
+    while (!buckets_.empty()) {
+      auto first = buckets_.begin();
+      std::size_t bucket = first->first;
+      std::vector<std::size_t> queued = std::move(first->second);
+      buckets_.erase(first);
+
+      // A vertex may have been queued several times, or have since moved
+      // to a lower bucket that was already emptied.
+      ++stamp_;
+      frontier.clear();
+      for (std::size_t v : queued) {
+        if (bucket_of(dist_[v]) == bucket && claim(v)) {
+          frontier.push_back(v);
+        }
+      }
+
+      settled.clear();
+      while (!frontier.empty()) {
+        settled.insert(settled.end(), frontier.begin(), frontier.end());
+        relax(frontier, true, improved);
+        frontier.clear();
+        for (std::size_t v : improved) {
+          std::size_t b = bucket_of(dist_[v]);
+          (b == bucket ? frontier : buckets_[b]).push_back(v);
+        }
+      }
+
+      ++stamp_;
+      std::erase_if(settled, [&](std::size_t v) { return !claim(v); });
+      relax(settled, false, improved);
+      for (std::size_t v : improved) {
+        buckets_[bucket_of(dist_[v])].push_back(v);
+      }
+    }
+    return std::move(dist_);
+  }
+
+private:
+  std::size_t bucket_of(WeightType d) const noexcept {
+    return static_cast<std::size_t>(d / delta_);
+  }
+
+  // True for the first caller on v since the stamp was last bumped.
+  bool claim(std::size_t v) noexcept {
+    std::atomic_ref<std::size_t> stamp(stamps_[v]);
+    return stamp.exchange(stamp_, std::memory_order_relaxed) != stamp_;
+  }
+
+  /**
+   * Relaxes the light (or heavy) arcs of the vertices in 'from', and leaves
+   * the vertices whose distance dropped in 'improved', each once.
+   */
+  void relax(const std::vector<std::size_t> &from, bool light,
+             std::vector<std::size_t> &improved) {
+    ++stamp_;
+    improved.clear();
+    auto relax_range = [&](std::size_t first, std::size_t last,
+                           std::vector<std::size_t> &out) {
+      for (std::size_t i = first; i < last; ++i) {
+        std::size_t u = from[i];
+        WeightType du = std::atomic_ref<WeightType>(dist_[u]).load(
+            std::memory_order_relaxed);
+        auto nbs = g_.neighbors(u);
+        auto wts = g_.weights(u);
+        for (std::size_t j = 0; j < nbs.size(); ++j) {
+          WeightType w = wts.empty() ? WeightType(1) : wts[j];
+          if ((w <= delta_) != light) {
+            continue;
+          }
+          WeightType nd = du + w;
+          std::atomic_ref<WeightType> dv(dist_[nbs[j]]);
+          WeightType old = dv.load(std::memory_order_relaxed);
+          bool lowered = false;
+          while (nd < old) {
+            if (dv.compare_exchange_weak(old, nd, std::memory_order_relaxed)) {
+              lowered = true;
+              break;
+            }
+          }
+          if (lowered && claim(nbs[j])) {
+            out.push_back(nbs[j]);
+          }
+        }
+      }
+    };
+
+    if (!pool_ || from.size() < 2 * delta_stepping_grain) {
+      relax_range(0, from.size(), improved);
+      return;
+    }
+    std::size_t num_chunks =
+        std::min(from.size() / delta_stepping_grain, 4 * (pool_->size() + 1));
+    std::size_t chunk = (from.size() + num_chunks - 1) / num_chunks;
+    std::vector<std::vector<std::size_t>> outs(num_chunks);
+    pool_->parallel_for(std::size_t{0}, num_chunks, 1, [&](std::size_t c) {
+      relax_range(std::min(c * chunk, from.size()),
+                  std::min((c + 1) * chunk, from.size()), outs[c]);
+    });
+    for (const auto &out : outs) {
+      improved.insert(improved.end(), out.begin(), out.end());
+    }
+  }
+
+  const CsrGraph<WeightType> &g_;
+  WeightType delta_;
+  parallel::thread_pool *pool_;
+  std::vector<WeightType> dist_;
+  std::vector<std::size_t> stamps_;
+  std::size_t stamp_ = 0;
+  std::map<std::size_t, std::vector<std::size_t>> buckets_;
+};
+
+/**
+ * @internal
+ * @brief Predecessors for the distances of a delta-stepping search. With
+ * positive weights the tight arcs form a DAG and every reached vertex takes
+ * its smallest tight in-neighbour, in parallel. Arcs of weight 0 can close
+ * cycles of tight arcs, so then a BFS over tight arcs from the source picks
+ * them instead.
+ */
+template <typename WeightType>
+std::vector<std::size_t>
+delta_stepping_predecessors(const CsrGraph<WeightType> &g, std::size_t source,
+                            const std::vector<WeightType> &dist,
+                            parallel::thread_pool *pool) {
+  std::size_t n = g.num_vertices();
+  std::vector<std::size_t> pred(n);
+  for (std::size_t v = 0; v < n; ++v) {
+    pred[v] = v;
+  }
+  auto tight = [&](std::size_t u, std::size_t v, WeightType w) {
+    return v != source && dist[u] != std::numeric_limits<WeightType>::max() &&
+           dist[u] + w == dist[v];
+  };
+
+  auto weights = g.weights();
+  if (std::find(weights.begin(), weights.end(), WeightType(0)) !=
+      weights.end()) {
+    std::vector<std::size_t> queue = {source};
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+      std::size_t u = queue[head];
+      auto nbs = g.neighbors(u);
+      auto wts = g.weights(u);
+      for (std::size_t j = 0; j < nbs.size(); ++j) {
+        std::size_t v = nbs[j];
+        if (pred[v] == v && tight(u, v, wts[j])) {
+          pred[v] = u;
+          queue.push_back(v);
+        }
+      }
+    }
+    return pred;
+  }
+
+  auto scan = [&](std::size_t u) {
+    auto nbs = g.neighbors(u);
+    auto wts = g.weights(u);
+    for (std::size_t j = 0; j < nbs.size(); ++j) {
+      std::size_t v = nbs[j];
+      if (tight(u, v, wts.empty() ? WeightType(1) : wts[j])) {
+        std::atomic_ref<std::size_t> p(pred[v]);
+        std::size_t old = p.load(std::memory_order_relaxed);
+        while ((old == v || u < old) &&
+               !p.compare_exchange_weak(old, u, std::memory_order_relaxed)) {
+        }
+      }
+    }
+  };
+  if (pool && n >= 2 * delta_stepping_grain) {
+    pool->parallel_for(std::size_t{0}, n, delta_stepping_grain, scan);
+  } else {
+    for (std::size_t u = 0; u < n; ++u) {
+      scan(u);
+    }
+  }
+  return pred;
+}
+
+} // namespace detail
+
+template <typename WeightType>
+std::vector<WeightType>
+delta_stepping_distances(const CsrGraph<WeightType> &g, std::size_t source,
+                         WeightType delta, parallel::thread_pool *pool) {
+  return detail::delta_stepping_search<WeightType>(g, delta, pool).run(source);
+}
+
+template <typename WeightType>
+std::pair<std::vector<WeightType>, std::vector<std::size_t>>
+delta_stepping(const CsrGraph<WeightType> &g, std::size_t source,
+               WeightType delta, parallel::thread_pool *pool) {
+  auto dist = delta_stepping_distances(g, source, delta, pool);
+  auto pred = detail::delta_stepping_predecessors(g, source, dist, pool);
+  return {std::move(dist), std::move(pred)};
+}
+
+// ============== Point-to-Point Searches ================
+
+/**
+ * @brief Buffers for the bidirectional searches: one workspace per direction,
+ * and the vertex where the two searches met.
+ */
+template <typename DistanceType = std::size_t>
+struct BidirectionalWorkspace {
+  PathfindingWorkspace<DistanceType> forward;
+  PathfindingWorkspace<DistanceType> backward;
+  std::size_t meeting = 0;
+  bool found = false;
+
+  /**
+   * @brief Shortest path found by the last search, from source to target.
+   * Empty if the target was not reachable.
+   */
+  std::vector<std::size_t> path() const {
+    if (!found) {
+      return {};
+    }
+    // Backward predecessors point from a vertex towards the target.
+    std::vector<std::size_t> p = forward.path_to(meeting);
+    for (std::size_t v = meeting; backward.predecessor(v) != v;) {
+      v = backward.predecessor(v);
+      p.push_back(v);
+    }
+    return p;
+  }
+};
+
+/**
+ * @brief Dijkstra from source that stops as soon as target is settled.
+ *
+ * @return The distance to target, or PathfindingWorkspace::unreachable. The
+ * path is available through ws.path_to(target).
+ */
+template <typename WeightType>
+WeightType dijkstra_to(const CsrGraph<WeightType> &g, std::size_t source,
+                       std::size_t target,
+                       PathfindingWorkspace<WeightType> &ws) {
+  return astar_early_stopping(
+      g, source, target, [](std::size_t) { return WeightType(0); }, ws);
+}
+
+/**
+ * @brief Visitor ending a boost Dijkstra search once the goal is settled, by
+ * throwing found_goal (the same approach as astar_goal_visitor).
+ */
+template <class GraphType>
+class dijkstra_goal_visitor : public detail::dijkstra_stats_visitor {
+public:
+  struct found_goal {};
+
+  dijkstra_goal_visitor(Vertex<GraphType> goal) : m_goal(goal) {}
+
+  void examine_vertex(Vertex<GraphType> u, const GraphType &g) {
+    detail::dijkstra_stats_visitor::examine_vertex(u, g);
+    if (u == m_goal)
+      throw found_goal();
+  }
+
+private:
+  Vertex<GraphType> m_goal;
+};
+
+namespace detail {
+
+template <typename WeightType, typename GraphType, typename WeightPropertyMap>
+std::pair<WeightType, std::vector<Vertex<GraphType>>>
+dijkstra_to(const GraphType &g, Vertex<GraphType> source,
+            Vertex<GraphType> target, WeightPropertyMap weights) {
+
+  std::vector<WeightType> distances(boost::num_vertices(g));
+  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
+  dijkstra_goal_visitor<GraphType> vis{target};
+
+  try {
+    boost::dijkstra_shortest_paths(g, source,
+                                   boost::predecessor_map(predecessors.data())
+                                       .distance_map(distances.data())
+                                       .weight_map(weights)
+                                       .visitor(vis));
+  } catch (typename dijkstra_goal_visitor<GraphType>::found_goal) {
+    // target settled
+  }
+
+  return {distances[target], predecessors};
+}
+
+} // namespace detail
+
+/**
+ * @brief Dijkstra from source to target on a Graph or DiGraph, stopping once
+ * target is settled. Returns the distance to target
+ * (std::numeric_limits<WeightType>::max() if unreachable) and the
+ * predecessors, which are only meaningful along the path to target.
+ */
+template <typename GraphType, typename WeightType>
+std::pair<WeightType, std::vector<Vertex<GraphType>>>
+dijkstra_to(const GraphType &g, Vertex<GraphType> source,
+            Vertex<GraphType> target,
+            const EdgeMap<WeightType, GraphType> &weight_map) {
+  return detail::dijkstra_to<WeightType>(
+      g, source, target, boost::make_assoc_property_map(weight_map));
+}
+
+/**
+ * @brief Weightless overload of dijkstra_to.
+ */
+template <typename GraphType>
+std::pair<std::size_t, std::vector<Vertex<GraphType>>>
+dijkstra_to(const GraphType &g, Vertex<GraphType> source,
+            Vertex<GraphType> target) {
+  return detail::dijkstra_to<std::size_t>(g, source, target,
+                                          detail::make_unit_weight_map(g));
+}
+
+/**
+ * @brief Bidirectional Dijkstra: a forward search from source on g and a
+ * backward search from target on reverse (g.reversed(), or g itself if it
+ * is undirected) that stop once they cannot improve the best meeting point.
+ * Passing the reverse graph in lets it be built once for many queries.
+ *
+ * @return The distance from source to target, or
+ * PathfindingWorkspace::unreachable. The path is available through
+ * ws.path().
+ */
+template <typename WeightType>
+WeightType bidirectional_dijkstra(const CsrGraph<WeightType> &g,
+                                  const CsrGraph<WeightType> &reverse,
+                                  std::size_t source, std::size_t target,
+                                  BidirectionalWorkspace<WeightType> &ws) {
+  constexpr WeightType inf = PathfindingWorkspace<WeightType>::unreachable;
+
+  auto &fwd = ws.forward;
+  auto &bwd = ws.backward;
+  fwd.reset(g.num_vertices());
+  bwd.reset(g.num_vertices());
+  ws.found = false;
+
+  WeightType best = inf;
+  auto meet = [&](std::size_t v) {
+    if (fwd.reached(v) && bwd.reached(v) &&
+        fwd.distance(v) + bwd.distance(v) < best) {
+      best = fwd.distance(v) + bwd.distance(v);
+      ws.meeting = v;
+      ws.found = true;
+    }
+  };
+
+  // Settles one vertex of one direction.
+  auto step = [&](const CsrGraph<WeightType> &graph,
+                  PathfindingWorkspace<WeightType> &self) {
+    auto [d, u] = detail::heap_pop(self);
+    if (d > self.distance(u)) {
+      return; // stale entry
+    }
+    auto nbs = graph.neighbors(u);
+    auto wts = graph.weights(u);
+    for (std::size_t i = 0; i < nbs.size(); ++i) {
+      WeightType nd = d + (wts.empty() ? WeightType(1) : wts[i]);
+      std::size_t v = nbs[i];
+      if (nd < self.distance(v)) {
+        self.label(v, nd, u);
+        detail::heap_push(self, nd, v);
+        meet(v);
+      }
+    }
+  };
+
+  fwd.label(source, 0, source);
+  bwd.label(target, 0, target);
+  detail::heap_push(fwd, WeightType(0), source);
+  detail::heap_push(bwd, WeightType(0), target);
+  meet(source);
+
+  // Stale heap entries only lower the bound, so the stopping test stays
+  // correct without cleaning them out first.
+  while (!fwd.heap.empty() && !bwd.heap.empty()) {
+    if (best != inf &&
+        fwd.heap.front().first + bwd.heap.front().first >= best) {
+      break;
+    }
+    if (fwd.heap.size() <= bwd.heap.size()) {
+      step(g, fwd);
+    } else {
+      step(reverse, bwd);
+    }
+  }
+
+  return best;
+}
+
+/**
+ * @brief Bidirectional BFS, expanding one whole level of the smaller
+ * frontier at a time and stopping at the first level where the two searches
+ * meet.
+ *
+ * @return The number of hops from source to target, or
+ * PathfindingWorkspace::unreachable. The path is available through
+ * ws.path().
+ */
+template <typename WeightType>
+std::size_t bidirectional_bfs(const CsrGraph<WeightType> &g,
+                              const CsrGraph<WeightType> &reverse,
+                              std::size_t source, std::size_t target,
+                              BidirectionalWorkspace<std::size_t> &ws) {
+  constexpr std::size_t inf = PathfindingWorkspace<std::size_t>::unreachable;
+
+  auto &fwd = ws.forward;
+  auto &bwd = ws.backward;
+  fwd.reset(g.num_vertices());
+  bwd.reset(g.num_vertices());
+
+  fwd.label(source, 0, source);
+  bwd.label(target, 0, target);
+  if (source == target) {
+    ws.meeting = source;
+    ws.found = true;
+    return 0;
+  }
+  ws.found = false;
+
+  // reached_vertices() is each direction's BFS queue; [head, end) is the
+  // current frontier.
+  std::size_t fwd_head = 0;
+  std::size_t bwd_head = 0;
+
+  auto expand_level = [&](const CsrGraph<WeightType> &graph,
+                          PathfindingWorkspace<std::size_t> &self,
+                          const PathfindingWorkspace<std::size_t> &other,
+                          std::size_t &head) {
+    std::size_t best = inf;
+    std::size_t end = self.reached_vertices().size();
+    for (; head < end; ++head) {
+      std::size_t u = self.reached_vertices()[head];
+      for (std::size_t v : graph.neighbors(u)) {
+        if (!self.reached(v)) {
+          self.label(v, self.distance(u) + 1, u);
+        }
+        if (other.reached(v) &&
+            self.distance(v) + other.distance(v) < best) {
+          best = self.distance(v) + other.distance(v);
+          ws.meeting = v;
+        }
+      }
+    }
+    return best;
+  };
+
+  while (fwd_head < fwd.reached_vertices().size() &&
+         bwd_head < bwd.reached_vertices().size()) {
+    std::size_t fwd_frontier = fwd.reached_vertices().size() - fwd_head;
+    std::size_t bwd_frontier = bwd.reached_vertices().size() - bwd_head;
+
+    std::size_t best = fwd_frontier <= bwd_frontier
+                           ? expand_level(g, fwd, bwd, fwd_head)
+                           : expand_level(reverse, bwd, fwd, bwd_head);
+    if (best != inf) {
+      ws.found = true;
+      return best;
+    }
+  }
+
+  return inf;
+}
+
+/**
+ * @brief Convenience overload of bidirectional_dijkstra for a single query:
+ * returns the distance and the path from source to target (empty if
+ * unreachable).
+ */
+template <typename WeightType>
+std::pair<WeightType, std::vector<std::size_t>>
+bidirectional_dijkstra(const CsrGraph<WeightType> &g, std::size_t source,
+                       std::size_t target) {
+  BidirectionalWorkspace<WeightType> ws;
+  WeightType d =
+      g.is_directed()
+          ? bidirectional_dijkstra(g, g.reversed(), source, target, ws)
+          : bidirectional_dijkstra(g, g, source, target, ws);
+  return {d, ws.path()};
+}
+
+/**
+ * @brief Convenience overload of bidirectional_bfs for a single query.
+ */
+template <typename WeightType>
+std::pair<std::size_t, std::vector<std::size_t>>
+bidirectional_bfs(const CsrGraph<WeightType> &g, std::size_t source,
+                  std::size_t target) {
+  BidirectionalWorkspace<std::size_t> ws;
+  std::size_t d = g.is_directed()
+                      ? bidirectional_bfs(g, g.reversed(), source, target, ws)
+                      : bidirectional_bfs(g, g, source, target, ws);
+  return {d, ws.path()};
+}
+
+/**
+ * @brief bidirectional_dijkstra on a Graph or DiGraph. This builds a
+ * CsrGraph for the query; build one yourself to answer many queries.
+ */
+template <typename GraphType, typename WeightType>
+std::pair<WeightType, std::vector<std::size_t>>
+bidirectional_dijkstra(const GraphType &g, Vertex<GraphType> source,
+                       Vertex<GraphType> target,
+                       const EdgeMap<WeightType, GraphType> &weight_map) {
+  return bidirectional_dijkstra(CsrGraph(g, weight_map), source, target);
+}
+
+/**
+ * @brief bidirectional_bfs on a Graph or DiGraph. This builds a CsrGraph for
+ * the query; build one yourself to answer many queries.
+ */
+template <typename GraphType>
+std::pair<std::size_t, std::vector<std::size_t>>
+bidirectional_bfs(const GraphType &g, Vertex<GraphType> source,
+                  Vertex<GraphType> target) {
+  return bidirectional_bfs(CsrGraph(g), source, target);
+}
+
+// ============== Shortest-Path DAG ================
+
+template <typename WeightType>
+class ShortestPathRange;
+
+/**
+ * @brief Every shortest path from one source, as a DAG of predecessor lists.
+ *
+ * @details The predecessor lists are stored back to back (CSR), so the whole
+ * DAG is a handful of flat vectors. path_counts[v] is the number of distinct
+ * shortest paths from the source to v, saturating at
+ * std::numeric_limits<std::size_t>::max(). With zero-weight edges, a
+ * predecessor must also have been settled earlier, which keeps the DAG
+ * acyclic.
+ */
+template <typename WeightType>
+struct ShortestPathDag {
+  std::size_t source = 0;
+  std::vector<WeightType> distances;
+  std::vector<std::size_t> offsets{0};
+  std::vector<std::size_t> preds;
+  std::vector<std::size_t> path_counts;
+
+  std::span<const std::size_t> predecessors(std::size_t v) const {
+    return {preds.data() + offsets[v], offsets[v + 1] - offsets[v]};
+  }
+
+  bool reachable(std::size_t v) const {
+    return distances[v] != std::numeric_limits<WeightType>::max();
+  }
+
+  std::size_t num_paths(std::size_t v) const { return path_counts[v]; }
+
+  /**
+   * @brief Lazily enumerates every shortest path from the source to target.
+   * Only the current path is kept in memory.
+   */
+  ShortestPathRange<WeightType> paths(std::size_t target) const {
+    return {*this, target};
+  }
+};
+
+/**
+ * @brief Input range over the shortest paths to one target of a
+ * ShortestPathDag. Each path runs from the source to the target, and stays
+ * valid until the iterator is advanced. The DAG must outlive the range.
+ */
+template <typename WeightType>
+class ShortestPathRange {
+public:
+  ShortestPathRange(const ShortestPathDag<WeightType> &dag, std::size_t target)
+      : dag{&dag}, target{target} {}
+
+  class iterator {
+  public:
+    using value_type = std::vector<std::size_t>;
+    using difference_type = std::ptrdiff_t;
+    using reference = const value_type &;
+    using pointer = const value_type *;
+    using iterator_category = std::input_iterator_tag;
+
+    iterator() = default;
+
+    reference operator*() const { return path; }
+    pointer operator->() const { return &path; }
+
+    iterator &operator++() {
+      advance();
+      return *this;
+    }
 
-  auto recorder =
-      boost::record_distances(distances.data(), boost::on_tree_edge{});
+    void operator++(int) { advance(); }
 
-  boost::breadth_first_search(
-      g, source, boost::visitor(boost::make_bfs_visitor(recorder)));
+    bool operator==(std::default_sentinel_t) const { return stack.empty(); }
 
-  return distances;
-}
+  private:
+    friend class ShortestPathRange;
 
-/**
- * @brief Run BFS from a source vertex to all other vertices in the graph,
-  returning predecessors only
- * @param g The graph to search
- * @param source The source vertex
- * @return A vector containing the predecessors of each vertex in the graph.
- */
-template <typename GraphType>
-std::vector<Vertex<GraphType>> bfs_predecessors(const GraphType &g,
-                                                Vertex<GraphType> source) {
+    // (vertex, index of the predecessor currently followed), from the target
+    // down to the source.
+    const ShortestPathDag<WeightType> *dag = nullptr;
+    std::vector<std::pair<std::size_t, std::size_t>> stack;
+    std::vector<std::size_t> path;
 
-  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
+    iterator(const ShortestPathDag<WeightType> &dag, std::size_t target)
+        : dag{&dag} {
+      if (dag.reachable(target)) {
+        stack.push_back({target, 0});
+        descend();
+      }
+    }
 
-  auto recorder =
-      boost::record_predecessors(predecessors.data(), boost::on_tree_edge{});
+    // Follows first predecessors until the source, then publishes the path.
+    void descend() {
+      while (stack.back().first != dag->source) {
+        std::size_t v = stack.back().first;
+        stack.push_back({dag->predecessors(v)[stack.back().second], 0});
+      }
+      path.clear();
+      for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+        path.push_back(it->first);
+      }
+    }
 
-  boost::breadth_first_search(
-      g, source, boost::visitor(boost::make_bfs_visitor(recorder)));
+    void advance() {
+      stack.pop_back(); // the source
+      while (!stack.empty()) {
+        auto &[v, i] = stack.back();
+        if (++i < dag->predecessors(v).size()) {
+          descend();
+          return;
+        }
+        stack.pop_back();
+      }
+    }
+  };
 
-  return predecessors;
+  iterator begin() const { return iterator(*dag, target); }
+  std::default_sentinel_t end() const { return {}; }
+
+private:
+  const ShortestPathDag<WeightType> *dag;
+  std::size_t target;
+};
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Whether two path lengths count as a tie: exact for integers, within
+ * one ulp for floating point (the rule dijkstra_all_distances_all_predecessors
+ * has always used).
+ */
+template <typename WeightType>
+bool same_distance(WeightType a, WeightType b) {
+  if constexpr (std::is_floating_point_v<WeightType>) {
+    return a == b || std::nextafter(a, b) == b;
+  } else {
+    return a == b;
+  }
 }
 
+} // namespace detail
+
 /**
- * @brief Run Dijkstra from a source vertex to all other vertices in the graph,
-  returning predecessors only
- * @param g The graph to search
- * @param source The source vertex
- * @param weight_map (optional) A map from edges to their weights.
- * @return A pair of vectors, the first containing the distances from the
- * source vertex to each vertex in the graph, and the second containing the
- * predecessors of each vertex in the graph
+ * @brief Shortest-path DAG of a CsrGraph from source, using its edge weights
+ * (or a weight of 1 per edge if it is unweighted). One Dijkstra computes the
+ * distances, and a single pass over the arcs then collects the tight ones, so
+ * no per-vertex sets are built or rebuilt during the search.
  */
-template <typename GraphType, typename WeightType>
-std::pair<std::vector<WeightType>, std::vector<Vertex<GraphType>>>
-dijkstra(const GraphType &g, Vertex<GraphType> source,
-         const EdgeMap<WeightType, GraphType> &weight_map) {
+template <typename WeightType>
+ShortestPathDag<WeightType> shortest_path_dag(const CsrGraph<WeightType> &g,
+                                              std::size_t source) {
+  std::size_t n = g.num_vertices();
+
+  PathfindingWorkspace<WeightType> ws(n);
+  dijkstra(g, source, ws);
+
+  ShortestPathDag<WeightType> dag;
+  dag.source = source;
+  dag.distances.resize(n);
+  for (std::size_t v = 0; v < n; ++v) {
+    dag.distances[v] = ws.distance(v);
+  }
 
-  std::vector<WeightType> distances(boost::num_vertices(g));
-  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
+  // Reached vertices sorted by distance (stably, so ties keep the order they
+  // were reached in) are a topological order of the DAG.
+  std::vector<std::size_t> order(ws.reached_vertices().begin(),
+                                 ws.reached_vertices().end());
+  std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+    return dag.distances[a] < dag.distances[b];
+  });
+  std::vector<std::size_t> position(n, n);
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    position[order[i]] = i;
+  }
 
-  boost::dijkstra_shortest_paths(
-      g, source,
-      boost::predecessor_map(predecessors.data())
-          .distance_map(distances.data())
-          .weight_map(boost::make_assoc_property_map(weight_map)));
+  auto tight = [&](std::size_t u, std::size_t v, WeightType w) {
+    return position[u] < position[v] &&
+           detail::same_distance(dag.distances[u] + w, dag.distances[v]);
+  };
 
-  return {distances, predecessors};
+  // Two passes over the arcs: count, then fill.
+  dag.offsets.assign(n + 1, 0);
+  for (std::size_t u : order) {
+    auto nbs = g.neighbors(u);
+    auto wts = g.weights(u);
+    for (std::size_t i = 0; i < nbs.size(); ++i) {
+      if (tight(u, nbs[i], wts.empty() ? WeightType(1) : wts[i])) {
+        ++dag.offsets[nbs[i] + 1];
+      }
+    }
+  }
+  for (std::size_t v = 0; v < n; ++v) {
+    dag.offsets[v + 1] += dag.offsets[v];
+  }
+  dag.preds.resize(dag.offsets[n]);
+  std::vector<std::size_t> next(dag.offsets.begin(), dag.offsets.end() - 1);
+  for (std::size_t u : order) {
+    auto nbs = g.neighbors(u);
+    auto wts = g.weights(u);
+    for (std::size_t i = 0; i < nbs.size(); ++i) {
+      if (tight(u, nbs[i], wts.empty() ? WeightType(1) : wts[i])) {
+        dag.preds[next[nbs[i]]++] = u;
+      }
+    }
+  }
+
+  constexpr std::size_t saturated = std::numeric_limits<std::size_t>::max();
+  dag.path_counts.assign(n, 0);
+  for (std::size_t v : order) {
+    if (v == source) {
+      dag.path_counts[v] = 1;
+      continue;
+    }
+    std::size_t count = 0;
+    for (std::size_t u : dag.predecessors(v)) {
+      std::size_t c = dag.path_counts[u];
+      count = c > saturated - count ? saturated : count + c;
+    }
+    dag.path_counts[v] = count;
+  }
+
+  return dag;
 }
 
 /**
- * @brief Run Dijkstra from a source vertex to all other vertices in the
- * graph, returning distances only
- * @param g The graph to search
- * @param source The source vertex
- * @param weight_map (optional) A map from edges to their weights.
- * @return A vector containing the distances from the source vertex to each
- vertex in the graph.
+ * @brief Shortest-path DAG of a Graph or DiGraph with the given weights.
  */
 template <typename GraphType, typename WeightType>
-std::vector<WeightType>
-dijkstra_distances(const GraphType &g, Vertex<GraphType> source,
-                   const EdgeMap<WeightType, GraphType> &weight_map) {
-
-  std::vector<WeightType> distances(boost::num_vertices(g));
-
-  boost::dijkstra_shortest_paths(
-      g, source,
-      boost::distance_map(distances.data())
-          .weight_map(boost::make_assoc_property_map(weight_map)));
-
-  return distances;
+ShortestPathDag<WeightType>
+shortest_path_dag(const GraphType &g, Vertex<GraphType> source,
+                  const EdgeMap<WeightType, GraphType> &weight_map) {
+  return shortest_path_dag(CsrGraph(g, weight_map), source);
 }
 
 /**
- * @brief Run Dijkstra from a source vertex to all other vertices in the graph,
- *        returning predecessors only
- * @param g The graph to search
- * @param source The source vertex
- * @param weight_map (optional) A map from edges to their weights. If omitted,
- * falls back to BFS.
- * @return A vector containing the predecessors of each vertex in the graph.
+ * @brief Shortest-path DAG of a Graph or DiGraph, with unit weights.
  */
-template <typename GraphType, typename WeightType = std::size_t>
-std::vector<Vertex<GraphType>>
-dijkstra_predecessors(const GraphType &g, Vertex<GraphType> source,
-                      const EdgeMap<WeightType, GraphType> &weight_map) {
-
-  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
-
-  boost::dijkstra_shortest_paths(
-      g, source,
-      boost::predecessor_map(predecessors.data())
-          .weight_map(boost::make_assoc_property_map(weight_map)));
-
-  return predecessors;
+template <typename GraphType>
+ShortestPathDag<std::size_t> shortest_path_dag(const GraphType &g,
+                                               Vertex<GraphType> source) {
+  return shortest_path_dag(CsrGraph(g), source);
 }
 
 /**
@@ -264,8 +1894,43 @@ template <typename GraphType>
 std::pair<std::vector<std::size_t>, std::vector<VertexSet<GraphType>>>
 dijkstra_all_distances_all_predecessors(const GraphType &g,
                                         Vertex<GraphType> source) {
-  EdgeMap<std::size_t, GraphType> weight_map = detail::make_unit_weight_map(g);
-  return dijkstra_all_distances_all_predecessors(g, source, weight_map);
+  return dijkstra_all_distances_all_predecessors(CsrGraph(g), source);
+}
+
+/**
+ * @brief Overloads of the Dijkstra functions taking a DenseEdgeMap. These run
+ * on a CsrGraph copy of g, so looking up a weight is an array access instead
+ * of a hash lookup. To run many searches on the same graph, build the
+ * CsrGraph once and call the CsrGraph overloads directly.
+ */
+template <typename GraphType, typename WeightType>
+std::pair<std::vector<WeightType>, std::vector<Vertex<GraphType>>>
+dijkstra(const GraphType &g, Vertex<GraphType> source,
+         const DenseEdgeMap<WeightType, GraphType> &weight_map) {
+  return dijkstra(CsrGraph(g, weight_map), source);
+}
+
+template <typename GraphType, typename WeightType>
+std::vector<WeightType>
+dijkstra_distances(const GraphType &g, Vertex<GraphType> source,
+                   const DenseEdgeMap<WeightType, GraphType> &weight_map) {
+  return dijkstra(CsrGraph(g, weight_map), source).first;
+}
+
+template <typename GraphType, typename WeightType>
+std::vector<Vertex<GraphType>>
+dijkstra_predecessors(const GraphType &g, Vertex<GraphType> source,
+                      const DenseEdgeMap<WeightType, GraphType> &weight_map) {
+  return dijkstra(CsrGraph(g, weight_map), source).second;
+}
+
+template <typename GraphType, typename WeightType>
+std::pair<std::vector<WeightType>, std::vector<VertexSet<GraphType>>>
+dijkstra_all_distances_all_predecessors(
+    const GraphType &g, Vertex<GraphType> source,
+    const DenseEdgeMap<WeightType, GraphType> &weight_map) {
+  return dijkstra_all_distances_all_predecessors(CsrGraph(g, weight_map),
+                                                 source);
 }
 
 // ============== A-Star Visitors ================
@@ -278,14 +1943,14 @@ dijkstra_all_distances_all_predecessors(const GraphType &g,
  * sure.
  */
 template <class GraphType>
-class astar_goal_visitor : public boost::default_astar_visitor {
+class astar_goal_visitor : public detail::astar_stats_visitor {
 public:
   struct found_goal {}; // exception for terminationn
 
   astar_goal_visitor(Vertex<GraphType> goal) : m_goal(goal) {}
 
-  void examine_vertex(Vertex<GraphType> u,
-                      [[maybe_unused]] const GraphType &g) {
+  void examine_vertex(Vertex<GraphType> u, const GraphType &g) {
+    detail::astar_stats_visitor::examine_vertex(u, g);
     if (u == m_goal)
       throw found_goal();
   }
@@ -295,6 +1960,58 @@ private:
 };
 // ================== End A-Star Visitors ====================
 
+namespace detail {
+
+/**
+ * @internal
+ * @brief The A* searches below, for any boost weight property map. The
+ * EdgeMap overloads pass an associative property map, the weightless ones a
+ * static map of 1s, so no per-edge storage is built for unit weights.
+ */
+template <typename WeightType, typename GraphType, typename AStarHeuristic,
+          typename WeightPropertyMap>
+std::pair<std::vector<WeightType>, std::vector<Vertex<GraphType>>>
+astar(const GraphType &g, Vertex<GraphType> source,
+      const AStarHeuristic &heuristic, WeightPropertyMap weights) {
+
+  std::vector<WeightType> distances(boost::num_vertices(g));
+  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
+
+  boost::astar_search(g, source, heuristic,
+                      boost::predecessor_map(predecessors.data())
+                          .distance_map(distances.data())
+                          .weight_map(weights)
+                          .visitor(astar_stats_visitor()));
+
+  return {distances, predecessors};
+}
+
+template <typename WeightType, typename GraphType, typename AStarHeuristic,
+          typename WeightPropertyMap>
+std::pair<WeightType, std::vector<Vertex<GraphType>>>
+astar_early_stopping(const GraphType &g, Vertex<GraphType> source,
+                     Vertex<GraphType> goal, const AStarHeuristic &heuristic,
+                     WeightPropertyMap weights) {
+
+  std::vector<WeightType> distances(boost::num_vertices(g));
+  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
+  astar_goal_visitor<GraphType> vis{goal};
+
+  try {
+    boost::astar_search(g, source, heuristic,
+                        boost::predecessor_map(predecessors.data())
+                            .distance_map(distances.data())
+                            .weight_map(weights)
+                            .visitor(vis));
+  } catch (typename astar_goal_visitor<GraphType>::found_goal fg) {
+    // do nothing
+  }
+
+  return {distances[goal], predecessors};
+}
+
+} // namespace detail
+
 /**
  * @brief Run A* from a source vertex, using a
  *        given heuristic, returning distances and predecessors
@@ -311,27 +2028,16 @@ std::pair<std::vector<WeightType>, std::vector<Vertex<GraphType>>>
 astar(const GraphType &g, Vertex<GraphType> source,
       const AStarHeuristic &heuristic,
       const EdgeMap<WeightType, GraphType> &weight_map) {
-
-  std::vector<WeightType> distances(boost::num_vertices(g));
-  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
-
-  boost::astar_search(
-      g, source, heuristic,
-      boost::predecessor_map(predecessors.data())
-          .distance_map(distances.data())
-          .weight_map(boost::make_assoc_property_map(weight_map))
-          .visitor(boost::default_astar_visitor()));
-
-  return {distances, predecessors};
+  return detail::astar<WeightType>(g, source, heuristic,
+                                   boost::make_assoc_property_map(weight_map));
 }
 
 template <typename GraphType, typename AStarHeuristic>
 std::pair<std::vector<std::size_t>, std::vector<Vertex<GraphType>>>
 astar(const GraphType &g, Vertex<GraphType> source,
       const AStarHeuristic &heuristic) {
-
-  EdgeMap<std::size_t, GraphType> weight_map = detail::make_unit_weight_map(g);
-  return astar(g, source, heuristic, weight_map);
+  return detail::astar<std::size_t>(g, source, heuristic,
+                                    detail::make_unit_weight_map(g));
 }
 
 /**
@@ -349,23 +2055,8 @@ std::pair<WeightType, std::vector<Vertex<GraphType>>>
 astar_early_stopping(const GraphType &g, Vertex<GraphType> source,
                      Vertex<GraphType> goal, const AStarHeuristic &heuristic,
                      const EdgeMap<WeightType, GraphType> &weight_map) {
-
-  std::vector<WeightType> distances(boost::num_vertices(g));
-  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
-  astar_goal_visitor<GraphType> vis{goal};
-
-  try {
-    boost::astar_search(
-        g, source, heuristic,
-        boost::predecessor_map(predecessors.data())
-            .distance_map(distances.data())
-            .weight_map(boost::make_assoc_property_map(weight_map))
-            .visitor(vis));
-  } catch (typename astar_goal_visitor<GraphType>::found_goal fg) {
-    // do nothing
-  }
-
-  return {distances[goal], predecessors};
+  return detail::astar_early_stopping<WeightType>(
+      g, source, goal, heuristic, boost::make_assoc_property_map(weight_map));
 }
 
 /**
@@ -375,9 +2066,8 @@ template <typename GraphType, typename AStarHeuristic>
 std::pair<std::size_t, std::vector<Vertex<GraphType>>>
 astar_early_stopping(const GraphType &g, Vertex<GraphType> source,
                      Vertex<GraphType> goal, const AStarHeuristic &heuristic) {
-
-  EdgeMap<std::size_t, GraphType> weight_map = detail::make_unit_weight_map(g);
-  return astar_early_stopping(g, source, goal, heuristic, weight_map);
+  return detail::astar_early_stopping<std::size_t>(
+      g, source, goal, heuristic, detail::make_unit_weight_map(g));
 }
 
 /**
@@ -395,25 +2085,14 @@ std::vector<WeightType>
 astar_distances(const GraphType &g, Vertex<GraphType> source,
                 const AStarHeuristic &heuristic,
                 const EdgeMap<WeightType, GraphType> &weight_map) {
-
-  std::vector<WeightType> distances(boost::num_vertices(g));
-
-  boost::astar_search(
-      g, source, heuristic,
-      boost::distance_map(distances.data())
-          .weight_map(boost::make_assoc_property_map(weight_map))
-          .visitor(boost::default_astar_visitor()));
-
-  return distances;
+  return astar(g, source, heuristic, weight_map).first;
 }
 
 template <typename GraphType, typename AStarHeuristic>
 std::vector<std::size_t> astar_distances(const GraphType &g,
                                          Vertex<GraphType> source,
                                          const AStarHeuristic &heuristic) {
-
-  EdgeMap<std::size_t, GraphType> weight_map = detail::make_unit_weight_map(g);
-  return astar_distances(g, source, heuristic, weight_map);
+  return astar(g, source, heuristic).first;
 }
 
 /**
@@ -430,26 +2109,15 @@ template <typename GraphType, typename WeightType, typename AStarHeuristic>
 std::vector<Vertex<GraphType>>
 astar_predecessors(const GraphType &g, Vertex<GraphType> source,
                    const AStarHeuristic &heuristic,
-                   const EdgeMap<GraphType, GraphType> &weight_map) {
-
-  std::vector<Vertex<GraphType>> predecessors(boost::num_vertices(g));
-
-  boost::astar_search(
-      g, source, heuristic,
-      boost::predecessor_map(predecessors.data())
-          .weight_map(boost::make_assoc_property_map(weight_map))
-          .visitor(boost::default_astar_visitor()));
-
-  return predecessors;
+                   const EdgeMap<WeightType, GraphType> &weight_map) {
+  return astar(g, source, heuristic, weight_map).second;
 }
 
 template <typename GraphType, typename AStarHeuristic>
 std::vector<Vertex<GraphType>>
 astar_predecessors(const GraphType &g, Vertex<GraphType> source,
                    const AStarHeuristic &heuristic) {
-
-  EdgeMap<std::size_t, GraphType> weight_map = detail::make_unit_weight_map(g);
-  return astar_predecessors(g, source, heuristic, weight_map);
+  return astar(g, source, heuristic).second;
 }
 
 //============== A-Star Heuristics ==============
@@ -536,6 +2204,162 @@ private:
   std::size_t dim;
 };
 
+/**
+ * @brief Vertex coordinates stored as a struct of arrays: coordinate d of
+ * vertex v is axis(d)[v], for up to three dimensions. Heuristics reading
+ * these load from contiguous arrays, where a LocMap costs a hash lookup and
+ * a pointer chase per call.
+ */
+class VertexCoordinates {
+public:
+  static constexpr std::size_t max_dim = 3;
+
+  VertexCoordinates() = default;
+
+  /**
+   * All vertices at the origin.
+   * @throws std::invalid_argument if dim is 0 or more than max_dim
+   */
+  VertexCoordinates(std::size_t num_vertices, std::size_t dim) : dim_(dim) {
+    if (dim == 0 || dim > max_dim) {
+      throw std::invalid_argument(
+          "VertexCoordinates: dimension must be 1, 2 or 3");
+    }
+    for (std::size_t d = 0; d < dim_; ++d) {
+      axes_[d].assign(num_vertices, 0.0);
+    }
+  }
+
+  /**
+   * From a LocMap such that loc_map.at(v) is a random-access container of
+   * arithmetic values for each of the num_vertices vertices, as taken by
+   * EuclideanHeuristic. The dimension is that of vertex 0.
+   */
+  template <typename LocMap>
+    requires requires(const LocMap &m) { m.at(0).size(); }
+  VertexCoordinates(const LocMap &loc_map, std::size_t num_vertices)
+      : VertexCoordinates(num_vertices,
+                          num_vertices ? loc_map.at(0).size() : 1) {
+    for (std::size_t v = 0; v < num_vertices; ++v) {
+      set(v, loc_map.at(v));
+    }
+  }
+
+  /**
+   * From the vector-valued vertex property 'name' of a GraphBundle, e.g.
+   * the "position" of the graphs in library.hpp, in either representation.
+   */
+  template <typename Bundle>
+    requires requires(const Bundle &gb) { gb.props.vertex; }
+  explicit VertexCoordinates(const Bundle &gb,
+                             const std::string &name = "position")
+      : VertexCoordinates(
+            gb.props.vertex[name].template to_map<std::vector<double>>(),
+            boost::num_vertices(gb.graph)) {}
+
+  std::size_t dim() const noexcept { return dim_; }
+  std::size_t size() const noexcept { return axes_[0].size(); }
+
+  std::span<const double> axis(std::size_t d) const { return axes_.at(d); }
+  std::span<double> axis(std::size_t d) { return axes_.at(d); }
+
+  double operator()(std::size_t v, std::size_t d) const {
+    return axes_[d][v];
+  }
+
+  /// @throws std::invalid_argument if the point has the wrong dimension
+  template <typename Point>
+  void set(std::size_t v, const Point &point) {
+    if (std::size(point) != dim_) {
+      throw std::invalid_argument("VertexCoordinates: wrong dimension");
+    }
+    for (std::size_t d = 0; d < dim_; ++d) {
+      axes_[d].at(v) = static_cast<double>(point[d]);
+    }
+  }
+
+private:
+  std::size_t dim_ = 0;
+  std::array<std::vector<double>, max_dim> axes_;
+};
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Euclidean or Manhattan distance to a fixed goal over
+ * VertexCoordinates, one vertex or a batch at a time. The batch form uses
+ * AVX2 gathers when available.
+ */
+template <bool Euclidean>
+class coordinate_heuristic {
+public:
+  coordinate_heuristic(const VertexCoordinates &coords, std::size_t goal)
+      : dim_(coords.dim()) {
+    for (std::size_t d = 0; d < dim_; ++d) {
+      axes_[d] = coords.axis(d).data();
+      goal_[d] = coords(goal, d);
+    }
+  }
+
+  double operator()(std::size_t v) const noexcept {
+    double result = 0.0;
+    for (std::size_t d = 0; d < dim_; ++d) {
+      double diff = goal_[d] - axes_[d][v];
+      result += Euclidean ? diff * diff : std::abs(diff);
+    }
+    return Euclidean ? std::sqrt(result) : result;
+  }
+
+  /// out[i] = (*this)(vertices[i]); out holds at least vertices.size().
+  void operator()(std::span<const std::size_t> vertices,
+                  std::span<double> out) const noexcept {
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    static_assert(sizeof(std::size_t) == sizeof(long long));
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    for (; i + 4 <= vertices.size(); i += 4) {
+      __m256i idx = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(vertices.data() + i));
+      __m256d acc = _mm256_setzero_pd();
+      for (std::size_t d = 0; d < dim_; ++d) {
+        __m256d c = _mm256_i64gather_pd(axes_[d], idx, 8);
+        __m256d diff = _mm256_sub_pd(_mm256_set1_pd(goal_[d]), c);
+        acc = Euclidean ? _mm256_add_pd(acc, _mm256_mul_pd(diff, diff))
+                        : _mm256_add_pd(acc, _mm256_andnot_pd(sign, diff));
+      }
+      _mm256_storeu_pd(out.data() + i, Euclidean ? _mm256_sqrt_pd(acc) : acc);
+    }
+#endif
+    for (; i < vertices.size(); ++i) {
+      out[i] = (*this)(vertices[i]);
+    }
+  }
+
+private:
+  std::size_t dim_;
+  std::array<const double *, VertexCoordinates::max_dim> axes_{};
+  std::array<double, VertexCoordinates::max_dim> goal_{};
+};
+
+} // namespace detail
+
+/**
+ * @brief The straight-line distance to goal, read from VertexCoordinates,
+ * which must outlive it. Admissible when every edge weighs at least the
+ * distance between its endpoints. Also computes a batch of vertices at once,
+ * which astar_early_stopping on a CsrGraph uses for the neighbours of each
+ * settled vertex.
+ */
+using EuclideanCoordinateHeuristic = detail::coordinate_heuristic<true>;
+
+/**
+ * @brief The L1 distance to goal, read from VertexCoordinates, which must
+ * outlive it; e.g. for grids with unit weights. Has the same batch form as
+ * EuclideanCoordinateHeuristic.
+ */
+using ManhattanCoordinateHeuristic = detail::coordinate_heuristic<false>;
+
 } // namespace gl
 
 } // namespace utils
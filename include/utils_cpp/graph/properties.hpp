@@ -17,11 +17,23 @@
 namespace utils {
 namespace gl {
 
+namespace detail {
+
+// VertexMap and EdgeMap with their default containers, as templates of
+// exactly (ValueType, GraphType) for GenericProp.
+template <typename ValueType, typename GraphType>
+using vertex_map_of = VertexMap<ValueType, GraphType>;
+
+template <typename ValueType, typename GraphType>
+using edge_map_of = EdgeMap<ValueType, GraphType>;
+
+} // namespace detail
+
 template <typename GraphType = Graph>
-using VertexProp = GenericProp<VertexMap, GraphType>;
+using VertexProp = GenericProp<detail::vertex_map_of, GraphType>;
 
 template <typename GraphType = Graph>
-using EdgeProp = GenericProp<EdgeMap, GraphType>;
+using EdgeProp = GenericProp<detail::edge_map_of, GraphType>;
 
 // ===============================
 // Property Maps
@@ -45,8 +57,8 @@ public:
   Properties() = default;
 
   Properties(const GraphType &g) {
-    graph["num_vertices"] = boost::num_vertices(g);
-    graph["num_edges"] = boost::num_edges(g);
+    graph.assign("num_vertices", boost::num_vertices(g));
+    graph.assign("num_edges", boost::num_edges(g));
   }
 
   GraphPropMap graph;
@@ -72,8 +84,8 @@ public:
 
   GraphBundle(const GraphType &g, const Properties<GraphType> &p)
       : graph{g}, props{p} {
-    props.graph["num_vertices"] = boost::num_vertices(g);
-    props.graph["num_edges"] = boost::num_edges(g);
+    props.graph.assign("num_vertices", boost::num_vertices(g));
+    props.graph.assign("num_edges", boost::num_edges(g));
   }
 
   auto &operator[](const std::string &key) { return props.graph[key]; }
@@ -0,0 +1,478 @@
+/**********************************************************************
+ * @brief A compressed adjacency matrix for large sparse undirected graphs.
+ * @details Each row is a RoaringBitmap rather than a dense run of n bits, so
+ *memory grows with the number of edges instead of n^2: a 100000-vertex graph
+ *takes 1.25 GB as a BitAdjmat, but only a few megabytes here when it has a
+ *few hundred thousand edges. The Row and edge_range() interfaces follow
+ *BitAdjmat, so code iterating neighbours or edges works with either.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/roaring_bitmap.hpp"
+
+#include "utils_cpp/graph/bitadjmat.hpp"
+#include "utils_cpp/graph/graph.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace gl {
+
+/**
+   SparseBitAdjmat stores the rows of a symmetric binary matrix as roaring
+   bitmaps: sorted 16-bit arrays for sparse chunks of 65536 columns and plain
+   bitmaps for dense ones. Vertices are limited to 32-bit indices.
+ */
+class SparseBitAdjmat {
+
+public:
+  // =========== Edge Iteration ==========
+  // For iterating through all edges (i, j) with i <= j.
+  // Usage: for(auto [ei, end] = g.edges(); ei != end; ++ei) { ... }
+  // =====================================
+  class edge_iterator {
+
+    using edge_pair = std::pair<std::size_t, std::size_t>;
+    using iterator = RoaringBitmap::const_iterator;
+
+  public:
+    edge_iterator(const SparseBitAdjmat &mat, std::size_t row_index) noexcept;
+
+    edge_iterator &operator++() noexcept;
+
+    edge_pair operator*() const noexcept;
+    edge_pair const *operator->() const noexcept;
+
+    bool operator==(const edge_iterator &other) const noexcept;
+    bool operator!=(const edge_iterator &other) const noexcept;
+
+  private:
+    /// Moves forward to the first row, from the current one, with an entry
+    /// on or above the diagonal.
+    void settle() noexcept;
+
+    const SparseBitAdjmat *mat;
+    std::size_t row_index;
+    iterator it;
+
+    edge_pair current_edge;
+  };
+
+  std::pair<edge_iterator, edge_iterator> edges() const noexcept;
+
+  // =========== Edge Range ==========
+  // For iterating through all edges of the graph.
+  // Usage: for(auto edge : g.edge_range()) { ... }
+  // =================================
+
+  class edge_range_proxy {
+  public:
+    edge_range_proxy(const SparseBitAdjmat &mat) noexcept;
+
+    edge_iterator begin() const noexcept;
+    edge_iterator end() const noexcept;
+
+  private:
+    const SparseBitAdjmat &mat;
+  };
+
+  edge_range_proxy edge_range() const noexcept;
+
+  // =========== Row Iteration ===========
+  // For iterating through all the neighbors of a vertex.
+  // =====================================
+  class Row {
+  public:
+    /**
+     * Read-only iterator over the neighbours, in increasing order.
+     */
+    using row_iterator = RoaringBitmap::const_iterator;
+
+    Row(const SparseBitAdjmat &mat, std::size_t row) noexcept;
+
+    bool contains(std::size_t nb_index) const noexcept;
+
+    std::size_t size() const noexcept;
+
+    /**
+     * The neighbours of this row.
+     */
+    const RoaringBitmap &bitmap() const noexcept;
+
+    row_iterator begin() const noexcept;
+    row_iterator end() const noexcept;
+
+  private:
+    const RoaringBitmap *bits_;
+    std::size_t num_vertices_;
+  };
+
+  Row operator[](std::size_t row_index) const noexcept;
+
+public:
+  // ==========================================
+  // =========== Basic functionality ==========
+  // ==========================================
+
+  SparseBitAdjmat() = default;
+
+  /**
+   * An empty graph on n vertices.
+   * @throws std::length_error if n does not fit in 32 bits.
+   */
+  SparseBitAdjmat(std::size_t n);
+  SparseBitAdjmat(const Graph &g);
+  explicit SparseBitAdjmat(const BitAdjmat &mat);
+
+  /**
+   * Returns a Graph that corresponds to the current adjacency matrix
+   * representation.
+   * @return Graph
+   */
+  Graph to_graph() const;
+
+  /**
+   * Returns the dense BitAdjmat with the same entries.
+   */
+  BitAdjmat to_bitadjmat() const;
+
+  /**
+   * @return number of 1s in the adjmat.
+   */
+  std::size_t count_ones() const noexcept;
+
+  /**
+   * @return Number of vertices described by the adjmat.
+   */
+  std::size_t num_vertices() const noexcept;
+
+  /**
+   * @return number of edges in the adjmat (half of count_ones)
+   */
+  std::size_t num_edges() const noexcept;
+
+  /**
+   * @return number of edges incident to a particular vertex
+   */
+  std::size_t degree(std::size_t v) const noexcept;
+
+  /**
+   * Heap bytes used by the rows.
+   */
+  std::size_t memory_bytes() const noexcept;
+
+  /**
+   * Get the value of the (i,j)th entry of the adjmat.
+   * @param i row index
+   * @param j column index
+   * @return The (i,j)th entry of the adjmat
+   */
+  bool get(std::size_t i, std::size_t j) const noexcept;
+  bool get(const std::pair<std::size_t, std::size_t> &e) const noexcept;
+
+  /**
+   * Sets both the (i,j) and (j,i) entries of the adjmat to 1.
+   * @param i row index
+   * @param j column index
+   */
+  void set(std::size_t i, std::size_t j);
+  void set(const std::pair<std::size_t, std::size_t> &e);
+
+  /**
+   * Clears both the (i,j) and (j,i) entries of the adjmat.
+   * @param i row index
+   * @param j column index
+   */
+  void reset(std::size_t i, std::size_t j);
+  void reset(const std::pair<std::size_t, std::size_t> &e);
+
+  /**
+   * Sets both the (i,j) and (j,i) entries of the adjmat to val
+   * @param i row index
+   * @param j column index
+   * @param val value to set
+   */
+  void set(std::size_t i, std::size_t j, bool val);
+  void set(const std::pair<std::size_t, std::size_t> &e, bool val);
+
+  friend bool operator==(const SparseBitAdjmat &lhs,
+                         const SparseBitAdjmat &rhs) noexcept;
+  friend bool operator!=(const SparseBitAdjmat &lhs,
+                         const SparseBitAdjmat &rhs) noexcept;
+
+private:
+  std::size_t num_vertices_ = 0;
+  std::vector<RoaringBitmap> rows_;
+};
+
+/**
+ * Number of common neighbours of two rows, |a & b|.
+ */
+std::size_t popcount_and(const SparseBitAdjmat::Row &a,
+                         const SparseBitAdjmat::Row &b) noexcept;
+
+/**
+ * |a & ~b|: the neighbours of a that are not neighbours of b.
+ */
+std::size_t popcount_andnot(const SparseBitAdjmat::Row &a,
+                            const SparseBitAdjmat::Row &b) noexcept;
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+// =========== SparseBitAdjmat::edge_iterator ===========
+
+inline SparseBitAdjmat::edge_iterator::edge_iterator(
+    const SparseBitAdjmat &mat, std::size_t row_index) noexcept
+    : mat{&mat}, row_index{row_index} {
+  if (row_index < mat.num_vertices_) {
+    it = mat.rows_[row_index].lower_bound(
+        static_cast<std::uint32_t>(row_index));
+    settle();
+  }
+}
+
+inline void SparseBitAdjmat::edge_iterator::settle() noexcept {
+  while (it == mat->rows_[row_index].end()) {
+    if (++row_index == mat->num_vertices_) {
+      it = iterator{};
+      return;
+    }
+    it = mat->rows_[row_index].lower_bound(
+        static_cast<std::uint32_t>(row_index));
+  }
+  current_edge = {row_index, *it};
+}
+
+inline SparseBitAdjmat::edge_iterator &
+SparseBitAdjmat::edge_iterator::operator++() noexcept {
+  ++it;
+  settle();
+  return *this;
+}
+
+inline std::pair<std::size_t, std::size_t>
+SparseBitAdjmat::edge_iterator::operator*() const noexcept {
+  return current_edge;
+}
+
+inline std::pair<std::size_t, std::size_t> const *
+SparseBitAdjmat::edge_iterator::operator->() const noexcept {
+  return &current_edge;
+}
+
+inline bool SparseBitAdjmat::edge_iterator::operator==(
+    const SparseBitAdjmat::edge_iterator &other) const noexcept {
+  return row_index == other.row_index &&
+         (row_index == mat->num_vertices_ || it == other.it);
+}
+
+inline bool SparseBitAdjmat::edge_iterator::operator!=(
+    const SparseBitAdjmat::edge_iterator &other) const noexcept {
+  return !(*this == other);
+}
+
+inline std::pair<SparseBitAdjmat::edge_iterator,
+                 SparseBitAdjmat::edge_iterator>
+SparseBitAdjmat::edges() const noexcept {
+  return {edge_iterator(*this, 0), edge_iterator(*this, num_vertices_)};
+}
+
+inline SparseBitAdjmat::edge_range_proxy::edge_range_proxy(
+    const SparseBitAdjmat &mat) noexcept
+    : mat{mat} {}
+
+inline SparseBitAdjmat::edge_range_proxy
+SparseBitAdjmat::edge_range() const noexcept {
+  return edge_range_proxy{*this};
+}
+
+inline SparseBitAdjmat::edge_iterator
+SparseBitAdjmat::edge_range_proxy::begin() const noexcept {
+  return edge_iterator(mat, 0);
+}
+
+inline SparseBitAdjmat::edge_iterator
+SparseBitAdjmat::edge_range_proxy::end() const noexcept {
+  return edge_iterator(mat, mat.num_vertices_);
+}
+
+// =========== SparseBitAdjmat::Row ===========
+
+inline SparseBitAdjmat::Row::Row(const SparseBitAdjmat &mat,
+                                 std::size_t row) noexcept
+    : bits_{&mat.rows_[row]}, num_vertices_{mat.num_vertices_} {}
+
+inline bool SparseBitAdjmat::Row::contains(std::size_t nb_index) const noexcept {
+  return bits_->contains(static_cast<std::uint32_t>(nb_index));
+}
+
+inline std::size_t SparseBitAdjmat::Row::size() const noexcept {
+  return num_vertices_;
+}
+
+inline const RoaringBitmap &SparseBitAdjmat::Row::bitmap() const noexcept {
+  return *bits_;
+}
+
+inline SparseBitAdjmat::Row::row_iterator
+SparseBitAdjmat::Row::begin() const noexcept {
+  return bits_->begin();
+}
+
+inline SparseBitAdjmat::Row::row_iterator
+SparseBitAdjmat::Row::end() const noexcept {
+  return bits_->end();
+}
+
+inline SparseBitAdjmat::Row
+SparseBitAdjmat::operator[](std::size_t row_index) const noexcept {
+  return Row(*this, row_index);
+}
+
+// =========== SparseBitAdjmat ===========
+
+inline SparseBitAdjmat::SparseBitAdjmat(std::size_t n)
+    : num_vertices_{n}, rows_(n) {
+  if (n > std::size_t{1} << 32) {
+    throw std::length_error("SparseBitAdjmat supports at most 2^32 vertices");
+  }
+}
+
+inline SparseBitAdjmat::SparseBitAdjmat(const Graph &g)
+    : SparseBitAdjmat(boost::num_vertices(g)) {
+  for (auto [ei, end] = boost::edges(g); ei != end; ++ei) {
+    this->set(boost::source(*ei, g), boost::target(*ei, g));
+  }
+}
+
+inline SparseBitAdjmat::SparseBitAdjmat(const BitAdjmat &mat)
+    : SparseBitAdjmat(mat.num_vertices()) {
+  for (std::size_t i = 0; i < num_vertices_; ++i) {
+    for (std::size_t j : mat[i]) {
+      rows_[i].add(static_cast<std::uint32_t>(j));
+    }
+  }
+}
+
+inline Graph SparseBitAdjmat::to_graph() const {
+  Graph g;
+  for (std::size_t i = 0; i < num_vertices_; ++i) {
+    boost::add_vertex(g);
+  }
+  for (auto [i, j] : edge_range()) {
+    if (i != j) {
+      boost::add_edge(i, j, g);
+    }
+  }
+  return g;
+}
+
+inline BitAdjmat SparseBitAdjmat::to_bitadjmat() const {
+  BitAdjmat mat(num_vertices_);
+  for (auto e : edge_range()) {
+    mat.set(e);
+  }
+  return mat;
+}
+
+inline std::size_t SparseBitAdjmat::count_ones() const noexcept {
+  std::size_t count = 0;
+  for (const RoaringBitmap &row : rows_) {
+    count += row.cardinality();
+  }
+  return count;
+}
+
+inline std::size_t SparseBitAdjmat::num_vertices() const noexcept {
+  return num_vertices_;
+}
+
+inline std::size_t SparseBitAdjmat::num_edges() const noexcept {
+  return count_ones() / 2;
+}
+
+inline std::size_t SparseBitAdjmat::degree(std::size_t v) const noexcept {
+  return rows_[v].cardinality();
+}
+
+inline std::size_t SparseBitAdjmat::memory_bytes() const noexcept {
+  std::size_t bytes = rows_.capacity() * sizeof(RoaringBitmap);
+  for (const RoaringBitmap &row : rows_) {
+    bytes += row.memory_bytes();
+  }
+  return bytes;
+}
+
+inline bool SparseBitAdjmat::get(std::size_t i, std::size_t j) const noexcept {
+  return rows_[i].contains(static_cast<std::uint32_t>(j));
+}
+
+inline bool SparseBitAdjmat::get(
+    const std::pair<std::size_t, std::size_t> &e) const noexcept {
+  return get(e.first, e.second);
+}
+
+inline void SparseBitAdjmat::set(std::size_t i, std::size_t j) {
+  rows_[i].add(static_cast<std::uint32_t>(j));
+  rows_[j].add(static_cast<std::uint32_t>(i));
+}
+
+inline void SparseBitAdjmat::set(const std::pair<std::size_t, std::size_t> &e) {
+  set(e.first, e.second);
+}
+
+inline void SparseBitAdjmat::reset(std::size_t i, std::size_t j) {
+  rows_[i].remove(static_cast<std::uint32_t>(j));
+  rows_[j].remove(static_cast<std::uint32_t>(i));
+}
+
+inline void
+SparseBitAdjmat::reset(const std::pair<std::size_t, std::size_t> &e) {
+  reset(e.first, e.second);
+}
+
+inline void SparseBitAdjmat::set(std::size_t i, std::size_t j, bool val) {
+  if (val) {
+    set(i, j);
+  } else {
+    reset(i, j);
+  }
+}
+
+inline void SparseBitAdjmat::set(const std::pair<std::size_t, std::size_t> &e,
+                                 bool val) {
+  set(e.first, e.second, val);
+}
+
+inline bool operator==(const SparseBitAdjmat &lhs,
+                       const SparseBitAdjmat &rhs) noexcept {
+  return lhs.num_vertices_ == rhs.num_vertices_ && lhs.rows_ == rhs.rows_;
+}
+
+inline bool operator!=(const SparseBitAdjmat &lhs,
+                       const SparseBitAdjmat &rhs) noexcept {
+  return !(lhs == rhs);
+}
+
+inline std::size_t popcount_and(const SparseBitAdjmat::Row &a,
+                                const SparseBitAdjmat::Row &b) noexcept {
+  return popcount_and(a.bitmap(), b.bitmap());
+}
+
+inline std::size_t popcount_andnot(const SparseBitAdjmat::Row &a,
+                                   const SparseBitAdjmat::Row &b) noexcept {
+  return a.bitmap().cardinality() - popcount_and(a.bitmap(), b.bitmap());
+}
+
+} // namespace gl
+} // namespace utils
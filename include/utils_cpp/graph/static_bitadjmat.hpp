@@ -0,0 +1,453 @@
+/**********************************************************************
+ * @brief A bitwise adjacency matrix whose size is fixed at compile time.
+ * @details StaticBitAdjmat<N> keeps its N rows of ceil(N/64) words in a
+ *std::array, so it needs no allocation, every loop over a row has a
+ *compile-time trip count the compiler unrolls, and everything except the
+ *conversions to and from BitAdjmat is constexpr. Small coupling graphs (up to
+ *a few hundred vertices) fit in L1, and the generators below (static_grid,
+ *static_ring, ...) can build them at compile time. A 1024-vertex matrix
+ *takes 128 KB, so large ones are better made static or on the heap than on
+ *the stack.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/graph/bitadjmat.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+namespace utils {
+namespace gl {
+
+/**
+   StaticBitAdjmat<N> is BitAdjmat for exactly N vertices: the same row-major
+   bit layout (bit j % 64 of word j / 64 of row i is entry (i, j)), with the
+   padding bits past column N always zero. set() and reset() are symmetric,
+   as in BitAdjmat; matmul may give a matrix that is not.
+ */
+template <std::size_t N>
+class StaticBitAdjmat {
+public:
+  static constexpr std::size_t words_per_row = (N + 63) / 64;
+  using row_type = std::array<std::uint64_t, words_per_row>;
+
+  /// Hop distance bfs reports for vertices it cannot reach.
+  static constexpr std::uint16_t unreachable =
+      std::numeric_limits<std::uint16_t>::max();
+
+  /// The empty graph.
+  constexpr StaticBitAdjmat() noexcept = default;
+
+  /**
+   * The graph with the given undirected edges.
+   * @throws std::out_of_range if an endpoint is not less than N
+   */
+  constexpr explicit StaticBitAdjmat(
+      std::span<const std::pair<std::size_t, std::size_t>> edges);
+
+  /**
+   * A copy of mat.
+   * @throws std::invalid_argument if mat does not have N vertices
+   */
+  explicit StaticBitAdjmat(const BitAdjmat &mat);
+
+  /// The same (symmetric) matrix as a BitAdjmat.
+  BitAdjmat to_bitadjmat() const;
+
+  static constexpr std::size_t num_vertices() noexcept { return N; }
+  constexpr std::size_t count_ones() const noexcept;
+  constexpr std::size_t num_edges() const noexcept { return count_ones() / 2; }
+  constexpr std::size_t degree(std::size_t v) const noexcept {
+    return popcount(rows_[v]);
+  }
+
+  constexpr bool get(std::size_t i, std::size_t j) const noexcept {
+    return (rows_[i][j / 64] >> (j % 64)) & 1;
+  }
+  constexpr void set(std::size_t i, std::size_t j) noexcept {
+    rows_[i][j / 64] |= std::uint64_t{1} << (j % 64);
+    rows_[j][i / 64] |= std::uint64_t{1} << (i % 64);
+  }
+  constexpr void reset(std::size_t i, std::size_t j) noexcept {
+    rows_[i][j / 64] &= ~(std::uint64_t{1} << (j % 64));
+    rows_[j][i / 64] &= ~(std::uint64_t{1} << (i % 64));
+  }
+  constexpr void set(std::size_t i, std::size_t j, bool value) noexcept {
+    value ? set(i, j) : reset(i, j);
+  }
+
+  /// The packed words of row i.
+  constexpr const row_type &row(std::size_t i) const noexcept {
+    return rows_[i];
+  }
+
+  /// Calls f(u) for each neighbour u of v, in increasing order.
+  template <typename F>
+  constexpr void for_each_neighbor(std::size_t v, F &&f) const;
+
+  /// Calls f(i, j) for each edge with i <= j, in row-major order.
+  template <typename F>
+  constexpr void for_each_edge(F &&f) const;
+
+  /// Toggles every entry, 0 -> 1 and 1 -> 0.
+  constexpr StaticBitAdjmat &toggle() noexcept;
+  constexpr StaticBitAdjmat operator~() const noexcept {
+    return StaticBitAdjmat(*this).toggle();
+  }
+
+  constexpr StaticBitAdjmat &operator&=(const StaticBitAdjmat &other) noexcept;
+  constexpr StaticBitAdjmat &operator|=(const StaticBitAdjmat &other) noexcept;
+  constexpr StaticBitAdjmat &operator^=(const StaticBitAdjmat &other) noexcept;
+
+  friend constexpr StaticBitAdjmat operator&(StaticBitAdjmat x,
+                                             const StaticBitAdjmat &y) noexcept {
+    return x &= y;
+  }
+  friend constexpr StaticBitAdjmat operator|(StaticBitAdjmat x,
+                                             const StaticBitAdjmat &y) noexcept {
+    return x |= y;
+  }
+  friend constexpr StaticBitAdjmat operator^(StaticBitAdjmat x,
+                                             const StaticBitAdjmat &y) noexcept {
+    return x ^= y;
+  }
+  friend constexpr bool operator==(const StaticBitAdjmat &,
+                                   const StaticBitAdjmat &) noexcept = default;
+
+  /**
+   * Boolean matrix product, as BitAdjmat::matmul: row i of the result is the
+   * OR of the rows of other selected by the set bits of row i.
+   */
+  constexpr StaticBitAdjmat matmul(const StaticBitAdjmat &other) const noexcept;
+
+  /// Number of vertices adjacent to both i and j, ignoring self-loops.
+  constexpr std::size_t common_neighbors_count(std::size_t i,
+                                               std::size_t j) const noexcept;
+
+  /// Number of triangles, each counted once. Self-loops are ignored.
+  constexpr std::size_t triangle_count() const noexcept;
+
+  /**
+   * Hop distances from source to every vertex, or unreachable. The frontier
+   * is a bitset, and each level is the OR of the rows of its vertices.
+   */
+  constexpr std::array<std::uint16_t, N> bfs(std::size_t source) const noexcept;
+
+  /// True if every vertex can reach every other; the empty graph is.
+  constexpr bool is_connected() const noexcept;
+
+private:
+  static constexpr std::size_t popcount(const row_type &row) noexcept {
+    std::size_t count = 0;
+    for (std::size_t w = 0; w < words_per_row; ++w) {
+      count += static_cast<std::size_t>(std::popcount(row[w]));
+    }
+    return count;
+  }
+
+  // Valid bits of the last word of a row.
+  static constexpr std::uint64_t last_word_mask =
+      N % 64 == 0 ? ~std::uint64_t{0} : (std::uint64_t{1} << (N % 64)) - 1;
+
+  std::array<row_type, N> rows_{};
+};
+
+/**
+ * The h x w grid graph, with vertex i * w + j at row i and column j, as
+ * library's grid(h, w).
+ */
+template <std::size_t H, std::size_t W>
+constexpr StaticBitAdjmat<H * W> static_grid() noexcept;
+
+/// The cycle 0 - 1 - ... - (N-1) - 0, for N >= 3.
+template <std::size_t N>
+constexpr StaticBitAdjmat<N> static_ring() noexcept;
+
+/// The path 0 - 1 - ... - (N-1).
+template <std::size_t N>
+constexpr StaticBitAdjmat<N> static_path() noexcept;
+
+/// The complete graph on N vertices, without self-loops.
+template <std::size_t N>
+constexpr StaticBitAdjmat<N> static_complete() noexcept;
+
+// ==========================================
+// =========== Implementation ===============
+// ==========================================
+
+template <std::size_t N>
+constexpr StaticBitAdjmat<N>::StaticBitAdjmat(
+    std::span<const std::pair<std::size_t, std::size_t>> edges) {
+  for (auto [u, v] : edges) {
+    if (u >= N || v >= N) {
+      throw std::out_of_range("StaticBitAdjmat: vertex out of range");
+    }
+    set(u, v);
+  }
+}
+
+template <std::size_t N>
+StaticBitAdjmat<N>::StaticBitAdjmat(const BitAdjmat &mat) {
+  if (mat.num_vertices() != N) {
+    throw std::invalid_argument("StaticBitAdjmat: size mismatch");
+  }
+  for (std::size_t i = 0; i < N; ++i) {
+    const std::uint64_t *words = mat[i].data();
+    for (std::size_t w = 0; w < words_per_row; ++w) {
+      rows_[i][w] = words[w];
+    }
+  }
+}
+
+template <std::size_t N>
+BitAdjmat StaticBitAdjmat<N>::to_bitadjmat() const {
+  BitAdjmat mat(N);
+  for_each_edge([&](std::size_t i, std::size_t j) { mat.set(i, j); });
+  return mat;
+}
+
+template <std::size_t N>
+constexpr std::size_t StaticBitAdjmat<N>::count_ones() const noexcept {
+  std::size_t count = 0;
+  for (const row_type &row : rows_) {
+    count += popcount(row);
+  }
+  return count;
+}
+
+template <std::size_t N>
+template <typename F>
+constexpr void StaticBitAdjmat<N>::for_each_neighbor(std::size_t v,
+                                                     F &&f) const {
+  for (std::size_t w = 0; w < words_per_row; ++w) {
+    for (std::uint64_t word = rows_[v][w]; word != 0; word &= word - 1) {
+      f(w * 64 + static_cast<std::size_t>(std::countr_zero(word)));
+    }
+  }
+}
+
+template <std::size_t N>
+template <typename F>
+constexpr void StaticBitAdjmat<N>::for_each_edge(F &&f) const {
+  for (std::size_t i = 0; i < N; ++i) {
+    // Only columns j >= i: mask the diagonal word and skip those before it.
+    std::size_t first = i / 64;
+    for (std::size_t w = first; w < words_per_row; ++w) {
+      std::uint64_t word = rows_[i][w];
+      if (w == first) {
+        word &= ~std::uint64_t{0} << (i % 64);
+      }
+      for (; word != 0; word &= word - 1) {
+        f(i, w * 64 + static_cast<std::size_t>(std::countr_zero(word)));
+      }
+    }
+  }
+}
+
+template <std::size_t N>
+constexpr StaticBitAdjmat<N> &StaticBitAdjmat<N>::toggle() noexcept {
+  for (row_type &row : rows_) {
+    for (std::size_t w = 0; w < words_per_row; ++w) {
+      row[w] = ~row[w];
+    }
+    if constexpr (words_per_row > 0) {
+      row[words_per_row - 1] &= last_word_mask;
+    }
+  }
+  return *this;
+}
+
+template <std::size_t N>
+constexpr StaticBitAdjmat<N> &
+StaticBitAdjmat<N>::operator&=(const StaticBitAdjmat &other) noexcept {
+  for (std::size_t i = 0; i < N; ++i) {
+    for (std::size_t w = 0; w < words_per_row; ++w) {
+      rows_[i][w] &= other.rows_[i][w];
+    }
+  }
+  return *this;
+}
+
+template <std::size_t N>
+constexpr StaticBitAdjmat<N> &
+StaticBitAdjmat<N>::operator|=(const StaticBitAdjmat &other) noexcept {
+  for (std::size_t i = 0; i < N; ++i) {
+    for (std::size_t w = 0; w < words_per_row; ++w) {
+      rows_[i][w] |= other.rows_[i][w];
+    }
+  }
+  return *this;
+}
+
+template <std::size_t N>
+constexpr StaticBitAdjmat<N> &
+StaticBitAdjmat<N>::operator^=(const StaticBitAdjmat &other) noexcept {
+  for (std::size_t i = 0; i < N; ++i) {
+    for (std::size_t w = 0; w < words_per_row; ++w) {
+      rows_[i][w] ^= other.rows_[i][w];
+    }
+  }
+  return *this;
+}
+
+template <std::size_t N>
+constexpr StaticBitAdjmat<N>
+StaticBitAdjmat<N>::matmul(const StaticBitAdjmat &other) const noexcept {
+  StaticBitAdjmat result;
+  for (std::size_t i = 0; i < N; ++i) {
+    row_type &out = result.rows_[i];
+    for_each_neighbor(i, [&](std::size_t j) {
+      for (std::size_t w = 0; w < words_per_row; ++w) {
+        out[w] |= other.rows_[j][w];
+      }
+    });
+  }
+  return result;
+}
+
+template <std::size_t N>
+constexpr std::size_t
+StaticBitAdjmat<N>::common_neighbors_count(std::size_t i,
+                                           std::size_t j) const noexcept {
+  std::size_t count = 0;
+  for (std::size_t w = 0; w < words_per_row; ++w) {
+    count += static_cast<std::size_t>(std::popcount(rows_[i][w] & rows_[j][w]));
+  }
+  // A self-loop on i makes i look like a neighbour of itself, and likewise j.
+  count -= get(i, i) && get(j, i);
+  if (i != j) {
+    count -= get(j, j) && get(i, j);
+  }
+  return count;
+}
+
+template <std::size_t N>
+constexpr std::size_t StaticBitAdjmat<N>::triangle_count() const noexcept {
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < N; ++i) {
+    for_each_neighbor(i, [&](std::size_t j) {
+      if (j <= i) {
+        return;
+      }
+      // Common neighbours k > j: mask the word holding j, then the rest.
+      std::size_t first = j / 64;
+      std::uint64_t above = (~std::uint64_t{0} << (j % 64)) << 1;
+      count += static_cast<std::size_t>(
+          std::popcount(rows_[i][first] & rows_[j][first] & above));
+      for (std::size_t w = first + 1; w < words_per_row; ++w) {
+        count +=
+            static_cast<std::size_t>(std::popcount(rows_[i][w] & rows_[j][w]));
+      }
+    });
+  }
+  return count;
+}
+
+template <std::size_t N>
+constexpr std::array<std::uint16_t, N>
+StaticBitAdjmat<N>::bfs(std::size_t source) const noexcept {
+  std::array<std::uint16_t, N> dist{};
+  dist.fill(unreachable);
+  if (source >= N) {
+    return dist;
+  }
+  row_type seen{}, frontier{};
+  seen[source / 64] = frontier[source / 64] = std::uint64_t{1}
+                                              << (source % 64);
+  dist[source] = 0;
+  for (std::uint16_t level = 1;; ++level) {
+    row_type next{};
+    for (std::size_t w = 0; w < words_per_row; ++w) {
+      for (std::uint64_t word = frontier[w]; word != 0; word &= word - 1) {
+        const row_type &row =
+            rows_[w * 64 + static_cast<std::size_t>(std::countr_zero(word))];
+        for (std::size_t x = 0; x < words_per_row; ++x) {
+          next[x] |= row[x];
+        }
+      }
+    }
+    bool any = false;
+    for (std::size_t w = 0; w < words_per_row; ++w) {
+      frontier[w] = next[w] & ~seen[w];
+      seen[w] |= frontier[w];
+      for (std::uint64_t word = frontier[w]; word != 0; word &= word - 1) {
+        dist[w * 64 + static_cast<std::size_t>(std::countr_zero(word))] =
+            level;
+        any = true;
+      }
+    }
+    if (!any) {
+      return dist;
+    }
+  }
+}
+
+template <std::size_t N>
+constexpr bool StaticBitAdjmat<N>::is_connected() const noexcept {
+  if constexpr (N == 0) {
+    return true;
+  } else {
+    for (std::uint16_t d : bfs(0)) {
+      if (d == unreachable) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+template <std::size_t H, std::size_t W>
+constexpr StaticBitAdjmat<H * W> static_grid() noexcept {
+  StaticBitAdjmat<H * W> g;
+  for (std::size_t i = 0; i < H * W; ++i) {
+    if (i % W < W - 1) {
+      g.set(i, i + 1);
+    }
+    if (i / W < H - 1) {
+      g.set(i, i + W);
+    }
+  }
+  return g;
+}
+
+template <std::size_t N>
+constexpr StaticBitAdjmat<N> static_ring() noexcept {
+  static_assert(N >= 3, "a ring needs at least 3 vertices");
+  StaticBitAdjmat<N> g;
+  for (std::size_t i = 0; i < N; ++i) {
+    g.set(i, (i + 1) % N);
+  }
+  return g;
+}
+
+template <std::size_t N>
+constexpr StaticBitAdjmat<N> static_path() noexcept {
+  StaticBitAdjmat<N> g;
+  for (std::size_t i = 0; i + 1 < N; ++i) {
+    g.set(i, i + 1);
+  }
+  return g;
+}
+
+template <std::size_t N>
+constexpr StaticBitAdjmat<N> static_complete() noexcept {
+  StaticBitAdjmat<N> g;
+  g.toggle();
+  for (std::size_t i = 0; i < N; ++i) {
+    g.reset(i, i);
+  }
+  return g;
+}
+
+} // namespace gl
+} // namespace utils
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include "utils_cpp/graph/deletion_connectivity.hpp"
 #include "utils_cpp/graph/graph.hpp"
 #include "utils_cpp/graph/properties.hpp"
 #include "utils_cpp/graph/transforms_def.hpp"
@@ -17,6 +18,14 @@
 #include <boost/graph/copy.hpp>
 #include <boost/property_map/dynamic_property_map.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
 #include "utils_cpp/print.hpp"
 
 namespace utils {
@@ -24,78 +33,95 @@ namespace gl {
 
 // ==== Vertices ====
 
-inline GraphBundle remove_vertices(const GraphBundle &gb,
-                                   const std::vector<std::size_t> &vertices) {
-
-  // Instead of removing vertices from existing graph,
-  // instead construct a new graph.
-  // 1. Obtain a mapping from old -> new vertex indices: v -> f(v)
-  // 2. Construct new graph from these mappings.
-
-  Graph new_graph;
-
-  std::unordered_set<Vertex<Graph>> removal_set(vertices.begin(),
-                                                vertices.end());
-
-  // Step 1.
-  std::unordered_map<Vertex<Graph>, Vertex<Graph>> old_to_new_index_map;
-  Vertex<Graph> new_vertex_idx = 0;
-  for (auto v : boost::make_iterator_range(boost::vertices(gb.graph))) {
-    if (!removal_set.contains(v)) {
-      old_to_new_index_map[v] = new_vertex_idx;
-      ++new_vertex_idx;
+namespace detail {
+
+/**
+ * The graph on num_vertices vertices with an edge (new_index[u], new_index[v])
+ * for every edge (u, v) of g whose endpoints are both mapped. Built in one
+ * pass by graph_from_edges, keeping the order of boost::edges(g).
+ */
+inline Graph remap_graph(const Graph &g,
+                         const std::vector<std::size_t> &new_index,
+                         std::size_t num_vertices) {
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  edges.reserve(boost::num_edges(g));
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    auto u = new_index[boost::source(e, g)];
+    auto v = new_index[boost::target(e, g)];
+    if (u != unmapped_vertex && v != unmapped_vertex) {
+      edges.emplace_back(u, v);
     }
   }
+  return graph_from_edges(num_vertices, edges);
+}
 
-  // Step 2.
-  for (auto e : boost::make_iterator_range(boost::edges(gb.graph))) {
-    auto u = boost::source(e, gb.graph);
-    auto v = boost::target(e, gb.graph);
+/**
+ * Remaps a graph and all its vertex and edge properties. Graph properties are
+ * copied unchanged.
+ */
+inline GraphBundle remap_bundle(const GraphBundle &gb,
+                                const std::vector<std::size_t> &new_index,
+                                std::size_t num_vertices) {
+  Graph new_graph = remap_graph(gb.graph, new_index, num_vertices);
 
-    if (!removal_set.contains(u) && !removal_set.contains(v)) {
-      boost::add_edge(old_to_new_index_map[u], old_to_new_index_map[v],
-                      new_graph);
-    }
+  Properties new_props;
+  new_props.graph = gb.props.graph;
+  for (const auto &[key, prop] : gb.props.vertex) {
+    new_props.vertex.assign(key, prop.remap_vertices(new_index, num_vertices));
   }
-
-  // --- Update Properties ----
-
-  std::unordered_map<Vertex<Graph>, Vertex<Graph>> new_to_old_index_map;
-  for (auto &[k, v] : old_to_new_index_map) {
-    new_to_old_index_map[v] = k;
+  for (const auto &[key, prop] : gb.props.edge) {
+    new_props.edge.assign(key, prop.remap_vertices(new_index, num_vertices));
   }
 
-  Properties new_props(new_graph);
-
-  // Update vertex properties with remapped indices
+  return GraphBundle{std::move(new_graph), std::move(new_props)};
+}
 
-  for (auto &[key, val] : gb.props.vertex) {
-    for (auto v : boost::make_iterator_range(boost::vertices(new_graph))) {
-      new_props.vertex[key][v] = gb.props.vertex[key][new_to_old_index_map[v]];
+/**
+ * Number of vertices of a relabelled graph: one more than the largest label
+ * used. Throws if that is fewer than g has.
+ */
+inline std::size_t relabelled_size(const Graph &g,
+                                   const std::vector<std::size_t> &new_index) {
+  std::size_t n = boost::num_vertices(g);
+  std::size_t size = 0;
+  for (std::size_t v = 0; v < n; ++v) {
+    if (new_index[v] != unmapped_vertex) {
+      size = std::max(size, new_index[v] + 1);
     }
   }
+  if (size < n) {
+    throw std::runtime_error("Mapping does not cover all vertices");
+  }
+  return size;
+}
+
+} // namespace detail
 
-  // Update edge properties with remapped indices
+inline GraphBundle remove_vertices(const GraphBundle &gb,
+                                   const std::vector<std::size_t> &vertices) {
 
-  for (auto &[key, val] : gb.props.edge) {
-    for (auto new_edge : boost::make_iterator_range(boost::edges(new_graph))) {
+  // Kept vertices are numbered in their original order, through a dense
+  // old -> new index vector, and the graph is then rebuilt in one pass.
 
-      auto old_edge =
-          boost::edge(new_to_old_index_map[boost::source(new_edge, new_graph)],
-                      new_to_old_index_map[boost::target(new_edge, new_graph)],
-                      gb.graph)
-              .first;
+  std::size_t n = boost::num_vertices(gb.graph);
 
-      new_props.edge[key][new_edge] = gb.props.edge[key][old_edge];
+  std::vector<std::size_t> new_index(n, 0);
+  for (auto v : vertices) {
+    if (v < n) {
+      new_index[v] = unmapped_vertex;
     }
   }
 
-  // Update global graph properties
-
-  new_props.graph = gb.props.graph;
-  new_props.graph["removed_vertices"] = vertices;
+  std::size_t num_kept = 0;
+  for (auto &i : new_index) {
+    if (i != unmapped_vertex) {
+      i = num_kept++;
+    }
+  }
 
-  return GraphBundle{new_graph, new_props};
+  GraphBundle result = detail::remap_bundle(gb, new_index, num_kept);
+  result.props.graph.assign("removed_vertices", vertices);
+  return result;
 }
 
 // -------------------------------------------
@@ -106,56 +132,41 @@ get_vertices_to_remove(const Graph &g, std::size_t num_to_remove,
                        RandomGenerator &&gen) {
 
   // Each while loop:
-  // Iterate through shuffled vertices, testing each by isolating it.
-  // - If remaining graph stays connected, add vertex to removal list.
-  // - else, un-isolate the vertex and proceed to next vertex.
-  // Isolating a vertex just means removing its incident edges. This has the
-  // same topological effect as removal, but doesn't mess with vertex numbering.
+  // Iterate through the shuffled candidates, removing every vertex whose
+  // removal keeps the rest of its component connected. A rejected vertex can
+  // become removable once others are gone, so the rejected ones are tried
+  // again, in a new order, until enough have been removed. Every pass removes
+  // at least one vertex, since a leaf of a spanning tree never splits its
+  // component.
+
+  if (num_to_remove > boost::num_vertices(g)) {
+    throw std::invalid_argument(
+        "get_vertices_to_remove: more vertices requested than the graph has");
+  }
 
-  Graph new_g{g};
+  VertexDeletionConnectivity connectivity(g);
 
   std::vector<std::size_t> to_remove;
-
-  std::vector<std::pair<Vertex<Graph>, bool>> candidates(
-      boost::num_vertices(new_g));
-  for (std::size_t i = 0; i < boost::num_vertices(new_g); ++i) {
-    candidates[i] = {i, true};
-  }
-
-  std::vector<int> components(boost::num_vertices(new_g));
+  std::vector<std::size_t> candidates(boost::num_vertices(g));
+  std::iota(candidates.begin(), candidates.end(), 0);
 
   while (to_remove.size() < num_to_remove) {
 
     std::shuffle(candidates.begin(), candidates.end(), gen);
 
-    for (auto &[v, selectable] : candidates) {
-
-      std::vector<Vertex<Graph>> cached_nbs;
-      if (selectable) {
-        for (auto nb :
-             boost::make_iterator_range(boost::adjacent_vertices(v, new_g))) {
-          cached_nbs.push_back(nb);
-        }
+    std::vector<std::size_t> rejected;
+    for (auto v : candidates) {
+      if (to_remove.size() == num_to_remove) {
+        break;
       }
-
-      auto num_conn_before = boost::connected_components(new_g, &components[0]);
-      boost::clear_vertex(v, new_g);
-      auto num_conn_after = boost::connected_components(new_g, &components[0]);
-
-      bool no_longer_connected = (num_conn_after > num_conn_before + 1);
-      if (no_longer_connected) {
-        for (auto nb : cached_nbs) {
-          boost::add_edge(v, nb, new_g);
-        }
+      if (connectivity.would_split(v)) {
+        rejected.push_back(v);
       } else {
+        connectivity.remove(v);
         to_remove.push_back(v);
-        if (to_remove.size() == num_to_remove) {
-          break;
-        }
       }
-
-      selectable = false;
     }
+    candidates = std::move(rejected);
   }
   return to_remove;
 }
@@ -202,7 +213,7 @@ remove_edges(const GraphBundle &gb,
     boost::remove_edge(e[0], e[1], new_gb.graph);
   }
 
-  new_gb.props.graph["removed_edges"] = edges;
+  new_gb.props.graph.assign("removed_edges", edges);
   return new_gb;
 }
 
@@ -214,53 +225,86 @@ inline GraphBundle rand_prune_edges_connected(const GraphBundle &gb,
 
   std::mt19937_64 gen(seed);
 
-  GraphBundle new_gb{gb};
-
   if (num_to_remove == 0) {
     return gb;
   }
 
-  // .second = true => can select edge, else can't select it
-  std::vector<std::pair<Edge<Graph>, bool>> edge_vec(
-      boost::num_edges(new_gb.graph));
-  for (auto edge : boost::make_iterator_range(boost::edges(new_gb.graph))) {
-    edge_vec.push_back({edge, true});
+  // Try the edges in a random order, removing each one that does not
+  // disconnect the graph. deletable_edges decides all of them in one
+  // union-find pass.
+  //
+  // remove_edges removes every parallel copy of an edge at once, so the
+  // copies are one candidate, weighted by their number. Skipping a deletable
+  // candidate only keeps more edges, so the rest stay safe to remove.
+  std::size_t n = boost::num_vertices(gb.graph);
+  std::vector<std::pair<std::size_t, std::size_t>> order;
+  order.reserve(boost::num_edges(gb.graph));
+  for (auto e : boost::make_iterator_range(boost::edges(gb.graph))) {
+    order.emplace_back(boost::source(e, gb.graph), boost::target(e, gb.graph));
   }
 
-  std::vector<std::size_t> components(boost::num_vertices(new_gb.graph));
-
-  std::vector<std::vector<std::size_t>> removed_edges;
-
-  while (removed_edges.size() < num_to_remove) {
-
-    std::shuffle(edge_vec.begin(), edge_vec.end(), gen);
-
-    for (auto &[e, selectable] : edge_vec) {
-
-      if (selectable) {
+  // Most graphs are simple, which a linear scan confirms without hashing.
+  std::vector<std::size_t> multiplicity;
+  std::vector<std::size_t> last_seen(n, unmapped_vertex);
+  bool simple = true;
+  for (std::size_t u = 0; u < n && simple; ++u) {
+    for (auto v : boost::make_iterator_range(
+             boost::adjacent_vertices(u, gb.graph))) {
+      if (last_seen[v] == u) {
+        simple = false;
+        break;
+      }
+      last_seen[v] = u;
+    }
+  }
+  if (!simple) {
+    std::unordered_map<std::size_t, std::size_t> index_of;
+    std::size_t num_distinct = 0;
+    for (auto [u, v] : order) {
+      auto [it, inserted] = index_of.try_emplace(
+          std::min(u, v) * n + std::max(u, v), num_distinct);
+      if (inserted) {
+        order[num_distinct++] = {u, v};
+        multiplicity.push_back(1);
+      } else {
+        ++multiplicity[it->second];
+      }
+    }
+    order.resize(num_distinct);
+  }
 
-        auto num_conn_before =
-            boost::connected_components(new_gb.graph, &components[0]);
-        boost::remove_edge(e, new_gb.graph);
-        auto num_conn_after =
-            boost::connected_components(new_gb.graph, &components[0]);
+  if (simple) {
+    std::shuffle(order.begin(), order.end(), gen);
+  } else {
+    // Shuffle the candidates, carrying their multiplicities along.
+    for (std::size_t i = order.size(); i > 1; --i) {
+      std::uniform_int_distribution<std::size_t> pick(0, i - 1);
+      std::size_t j = pick(gen);
+      std::swap(order[i - 1], order[j]);
+      std::swap(multiplicity[i - 1], multiplicity[j]);
+    }
+  }
 
-        if (num_conn_after > num_conn_before) {
-          boost::add_edge(e.m_source, e.m_target, new_gb.graph);
-        } else {
-          removed_edges.push_back({{e.m_source, e.m_target}});
+  std::vector<bool> deletable = deletable_edges(n, order);
 
-          if (removed_edges.size() == num_to_remove) {
-            break;
-          }
-        }
-        selectable = false;
-      }
+  std::vector<std::vector<std::size_t>> removed_edges;
+  std::size_t num_removed = 0;
+  for (std::size_t i = 0; i < order.size() && num_removed < num_to_remove;
+       ++i) {
+    std::size_t copies = simple ? 1 : multiplicity[i];
+    if (deletable[i] && num_removed + copies <= num_to_remove) {
+      removed_edges.push_back({order[i].first, order[i].second});
+      num_removed += copies;
     }
   }
 
-  new_gb.props.graph["removed_edges"] = removed_edges;
-  return new_gb;
+  if (num_removed < num_to_remove) {
+    throw std::invalid_argument(
+        "rand_prune_edges_connected: cannot remove that many edges without "
+        "disconnecting the graph");
+  }
+
+  return remove_edges(gb, removed_edges);
 }
 
 // -------------------------------------------
@@ -275,49 +319,53 @@ inline GraphBundle rand_prune_edges_connected(const GraphBundle &gb,
   return rand_prune_edges_connected(gb, num_to_remove, seed);
 }
 
+inline Graph relabel_vertices(const Graph &g,
+                              const std::vector<std::size_t> &new_index) {
+
+  if (new_index.size() < boost::num_vertices(g)) {
+    throw std::runtime_error("Mapping does not cover all vertices");
+  }
+
+  Graph new_graph = detail::remap_graph(
+      g, new_index, detail::relabelled_size(g, new_index));
+
+  if (boost::num_edges(new_graph) != boost::num_edges(g)) {
+    throw std::runtime_error("Mapping does not cover all vertices");
+  }
+  return new_graph;
+}
+
 inline Graph
 relabel_vertices(const Graph &g,
                  const std::unordered_map<std::size_t, std::size_t> &mapping) {
 
-  std::size_t largest_mapped_index = 0;
-  for (const auto &[old_index, new_index] : mapping) {
-    if (old_index < boost::num_vertices(g) &&
-        new_index > largest_mapped_index) {
-      largest_mapped_index = new_index;
+  std::vector<std::size_t> new_index(boost::num_vertices(g), unmapped_vertex);
+  for (const auto &[old_index, new_label] : mapping) {
+    if (old_index < new_index.size()) {
+      new_index[old_index] = new_label;
     }
   }
+  return relabel_vertices(g, new_index);
+}
+
+inline GraphBundle relabel_vertices(const GraphBundle &gb,
+                                    const std::vector<std::size_t> &new_index) {
 
-  if (largest_mapped_index + 1 < boost::num_vertices(g)) {
+  if (new_index.size() < boost::num_vertices(gb.graph)) {
     throw std::runtime_error("Mapping does not cover all vertices");
   }
 
-  Graph new_graph;
-  for (std::size_t i = 0; i < largest_mapped_index; ++i) {
-    boost::add_vertex(new_graph);
-  }
+  GraphBundle result = detail::remap_bundle(
+      gb, new_index, detail::relabelled_size(gb.graph, new_index));
 
-  for (auto e : boost::make_iterator_range(boost::edges(g))) {
-    auto source = boost::source(e, g);
-    auto target = boost::target(e, g);
-
-    auto new_source = mapping.at(source);
-    auto new_target = mapping.at(target);
-
-    boost::add_edge(new_source, new_target, new_graph);
+  if (boost::num_edges(result.graph) != boost::num_edges(gb.graph)) {
+    throw std::runtime_error("Mapping does not cover all vertices");
   }
-
-  return new_graph;
+  return result;
 }
 
 inline Graph shuffle_vertex_labels(const Graph &g, std::mt19937_64 &gen) {
-
-  auto shuffled = shuffled_iota(boost::num_vertices(g), gen);
-  std::unordered_map<std::size_t, std::size_t> mapping;
-  for (std::size_t i = 0; i < boost::num_vertices(g); ++i) {
-    mapping[i] = shuffled[i];
-  }
-
-  return relabel_vertices(g, mapping);
+  return relabel_vertices(g, shuffled_iota(boost::num_vertices(g), gen));
 }
 
 inline Graph shuffle_vertex_labels(const Graph &g, unsigned seed) {
@@ -328,20 +376,347 @@ inline Graph shuffle_vertex_labels(const Graph &g, unsigned seed) {
 inline std::pair<Graph, std::unordered_map<std::size_t, std::size_t>>
 contiguize(const Graph &g) {
 
-  std::unordered_map<std::size_t, std::size_t> mapping, reverse_mapping;
+  std::vector<std::size_t> new_index(boost::num_vertices(g), unmapped_vertex);
+  std::unordered_map<std::size_t, std::size_t> reverse_mapping;
 
-  std::size_t new_index = 0;
+  std::size_t new_label = 0;
   for (const auto &v : boost::make_iterator_range(boost::vertices(g))) {
     if (boost::degree(v, g) == 0) {
       continue;
     }
 
-    mapping[v] = new_index;
-    reverse_mapping[new_index] = v;
-    ++new_index;
+    new_index[v] = new_label;
+    reverse_mapping[new_label] = v;
+    ++new_label;
   }
 
-  return {relabel_vertices(g, mapping), reverse_mapping};
+  return {detail::remap_graph(g, new_index, new_label), reverse_mapping};
+}
+
+// ==== Reordering ====
+
+namespace detail {
+
+/**
+ * new_index of the vertices listed in order: order[i] becomes vertex i.
+ */
+inline std::vector<std::size_t>
+order_to_index(const std::vector<std::size_t> &order) {
+  std::vector<std::size_t> new_index(order.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    new_index[order[i]] = i;
+  }
+  return new_index;
+}
+
+/**
+ * Appends the vertices reached from source, in BFS order, to 'order'. With
+ * by_degree, the unvisited neighbors of each vertex are queued in increasing
+ * order of degree, as in Cuthill-McKee.
+ */
+inline void bfs_append(const Graph &g, std::size_t source,
+                              std::vector<bool> &visited,
+                              std::vector<std::size_t> &order,
+                              bool by_degree) {
+  std::size_t head = order.size();
+  order.push_back(source);
+  visited[source] = true;
+
+  while (head < order.size()) {
+    std::size_t u = order[head++];
+    std::size_t first = order.size();
+    for (auto w : boost::make_iterator_range(boost::adjacent_vertices(u, g))) {
+      if (!visited[w]) {
+        visited[w] = true;
+        order.push_back(w);
+      }
+    }
+    if (by_degree) {
+      std::stable_sort(order.begin() + first, order.end(),
+                       [&](std::size_t a, std::size_t b) {
+                         return boost::degree(a, g) < boost::degree(b, g);
+                       });
+    }
+  }
+}
+
+/**
+ * A pseudo-peripheral vertex of the component of 'start' (George and Liu):
+ * repeatedly moves to the lowest-degree vertex of the last BFS level until
+ * the eccentricity stops growing.
+ *
+ * 'level' has one entry per vertex, all unmapped_vertex, and is left that
+ * way: only the vertices a BFS reached are reset, so one buffer serves every
+ * component in time proportional to the component.
+ */
+inline std::size_t pseudo_peripheral_vertex(const Graph &g, std::size_t start,
+                                            std::vector<std::size_t> &level) {
+  std::vector<std::size_t> touched;
+
+  std::size_t eccentricity = 0;
+  for (bool first = true;; first = false) {
+    for (auto v : touched) {
+      level[v] = unmapped_vertex;
+    }
+    touched.assign(1, start);
+    level[start] = 0;
+    for (std::size_t head = 0; head < touched.size(); ++head) {
+      std::size_t u = touched[head];
+      for (auto w :
+           boost::make_iterator_range(boost::adjacent_vertices(u, g))) {
+        if (level[w] == unmapped_vertex) {
+          level[w] = level[u] + 1;
+          touched.push_back(w);
+        }
+      }
+    }
+
+    std::size_t depth = level[touched.back()];
+    std::size_t next = touched.back();
+    for (auto it = touched.rbegin(); it != touched.rend() && level[*it] == depth;
+         ++it) {
+      if (boost::degree(*it, g) < boost::degree(next, g)) {
+        next = *it;
+      }
+    }
+
+    if (!first && depth <= eccentricity) {
+      for (auto v : touched) {
+        level[v] = unmapped_vertex;
+      }
+      return start;
+    }
+    eccentricity = depth;
+    start = next;
+  }
+}
+
+/**
+ * Max-priority queue of vertices with integer keys that only change by +1 or
+ * -1, each in O(1): vertices with equal keys share a doubly linked bucket.
+ * This is the "unit heap" of Gorder.
+ */
+class UnitHeap {
+public:
+  explicit UnitHeap(std::size_t n)
+      : key_(n, 0), prev_(n), next_(n), in_heap_(n, true), heads_(1, none) {
+    for (std::size_t v = 0; v < n; ++v) {
+      link(v);
+    }
+  }
+
+  bool contains(std::size_t v) const { return in_heap_[v]; }
+
+  void increment(std::size_t v) {
+    unlink(v);
+    ++key_[v];
+    if (key_[v] == heads_.size()) {
+      heads_.push_back(none);
+    }
+    link(v);
+    top_ = std::max(top_, key_[v]);
+  }
+
+  void decrement(std::size_t v) {
+    unlink(v);
+    --key_[v];
+    link(v);
+  }
+
+  void erase(std::size_t v) {
+    unlink(v);
+    in_heap_[v] = false;
+  }
+
+  /**
+   * Removes and returns a vertex with the largest key. The heap must not be
+   * empty.
+   */
+  std::size_t pop() {
+    while (heads_[top_] == none) {
+      --top_;
+    }
+    std::size_t v = heads_[top_];
+    erase(v);
+    return v;
+  }
+
+private:
+  static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+  void link(std::size_t v) {
+    std::size_t &head = heads_[key_[v]];
+    prev_[v] = none;
+    next_[v] = head;
+    if (head != none) {
+      prev_[head] = v;
+    }
+    head = v;
+  }
+
+  void unlink(std::size_t v) {
+    if (prev_[v] != none) {
+      next_[prev_[v]] = next_[v];
+    } else {
+      heads_[key_[v]] = next_[v];
+    }
+    if (next_[v] != none) {
+      prev_[next_[v]] = prev_[v];
+    }
+  }
+
+  std::vector<std::size_t> key_, prev_, next_;
+  std::vector<bool> in_heap_;
+  std::vector<std::size_t> heads_;
+  std::size_t top_ = 0;
+};
+
+} // namespace detail
+
+/**
+ * The vertices of g in BFS order from source, then from the smallest
+ * unvisited vertex of each remaining component.
+ */
+inline std::vector<std::size_t> bfs_order(const Graph &g,
+                                          std::size_t source = 0) {
+  std::size_t n = boost::num_vertices(g);
+  std::vector<std::size_t> order;
+  order.reserve(n);
+  std::vector<bool> visited(n, false);
+
+  if (source < n) {
+    detail::bfs_append(g, source, visited, order, false);
+  }
+  for (std::size_t v = 0; v < n; ++v) {
+    if (!visited[v]) {
+      detail::bfs_append(g, v, visited, order, false);
+    }
+  }
+  return detail::order_to_index(order);
+}
+
+inline std::vector<std::size_t> reverse_cuthill_mckee_order(const Graph &g) {
+  std::size_t n = boost::num_vertices(g);
+  std::vector<std::size_t> order;
+  order.reserve(n);
+  std::vector<bool> visited(n, false);
+
+  std::vector<std::size_t> level(n, unmapped_vertex);
+  for (std::size_t v = 0; v < n; ++v) {
+    if (!visited[v]) {
+      detail::bfs_append(g, detail::pseudo_peripheral_vertex(g, v, level),
+                         visited, order, true);
+    }
+  }
+  std::reverse(order.begin(), order.end());
+  return detail::order_to_index(order);
+}
+
+inline std::vector<std::size_t> degree_order(const Graph &g) {
+  std::size_t n = boost::num_vertices(g);
+  std::size_t max_degree = 0;
+  for (std::size_t v = 0; v < n; ++v) {
+    max_degree = std::max<std::size_t>(max_degree, boost::degree(v, g));
+  }
+
+  // Counting sort by decreasing degree; ties keep their original order.
+  std::vector<std::size_t> start(max_degree + 2, 0);
+  for (std::size_t v = 0; v < n; ++v) {
+    ++start[max_degree - boost::degree(v, g) + 1];
+  }
+  std::partial_sum(start.begin(), start.end(), start.begin());
+
+  std::vector<std::size_t> new_index(n);
+  for (std::size_t v = 0; v < n; ++v) {
+    new_index[v] = start[max_degree - boost::degree(v, g)]++;
+  }
+  return new_index;
+}
+
+inline std::vector<std::size_t> gorder(const Graph &g, std::size_t window) {
+  std::size_t n = boost::num_vertices(g);
+  if (n == 0) {
+    return {};
+  }
+  if (window == 0) {
+    throw std::invalid_argument("gorder: window must be positive");
+  }
+
+  // Vertices share a neighbor through u for every pair of u's neighbors, so
+  // expanding hubs costs O(degree^2). As in the Gorder paper, neighbors of
+  // degree above sqrt(n) only count as direct neighbors.
+  const auto hub_degree =
+      static_cast<std::size_t>(std::sqrt(static_cast<double>(n)));
+
+  detail::UnitHeap heap(n);
+  auto update = [&](std::size_t placed, bool entering) {
+    auto change = [&](std::size_t w) {
+      if (heap.contains(w)) {
+        entering ? heap.increment(w) : heap.decrement(w);
+      }
+    };
+    for (auto u :
+         boost::make_iterator_range(boost::adjacent_vertices(placed, g))) {
+      change(u);
+      if (boost::degree(u, g) <= hub_degree) {
+        for (auto w :
+             boost::make_iterator_range(boost::adjacent_vertices(u, g))) {
+          if (w != placed) {
+            change(w);
+          }
+        }
+      }
+    }
+  };
+
+  std::vector<std::size_t> order;
+  order.reserve(n);
+
+  std::size_t first = 0;
+  for (std::size_t v = 1; v < n; ++v) {
+    if (boost::degree(v, g) > boost::degree(first, g)) {
+      first = v;
+    }
+  }
+  heap.erase(first);
+  order.push_back(first);
+  update(first, true);
+
+  while (order.size() < n) {
+    if (order.size() > window) {
+      update(order[order.size() - window - 1], false);
+    }
+    std::size_t v = heap.pop();
+    order.push_back(v);
+    update(v, true);
+  }
+  return detail::order_to_index(order);
+}
+
+inline std::vector<std::size_t> vertex_order(const Graph &g,
+                                             VertexOrder method) {
+  switch (method) {
+  case VertexOrder::rcm:
+    return reverse_cuthill_mckee_order(g);
+  case VertexOrder::bfs:
+    return bfs_order(g);
+  case VertexOrder::degree:
+    return degree_order(g);
+  default:
+    return gorder(g);
+  }
+}
+
+inline std::pair<Graph, std::vector<std::size_t>>
+reorder_vertices(const Graph &g, VertexOrder method) {
+  auto new_index = vertex_order(g, method);
+  return {detail::remap_graph(g, new_index, new_index.size()), new_index};
+}
+
+inline std::pair<GraphBundle, std::vector<std::size_t>>
+reorder_vertices(const GraphBundle &gb, VertexOrder method) {
+  auto new_index = vertex_order(gb.graph, method);
+  return {detail::remap_bundle(gb, new_index, new_index.size()), new_index};
 }
 
 } // namespace gl
@@ -7,12 +7,20 @@
 #include <boost/graph/copy.hpp>
 #include <boost/property_map/dynamic_property_map.hpp>
 
+#include <limits>
 #include <random>
 #include <unordered_map>
+#include <vector>
 
 namespace utils {
 namespace gl {
 
+/**
+ * Marks a vertex that an index remapping drops.
+ */
+inline constexpr std::size_t unmapped_vertex =
+    std::numeric_limits<std::size_t>::max();
+
 /**
  * Remove vertices, returning an updated GraphBundle.
  */
@@ -32,6 +40,13 @@ GraphBundle rand_prune_connected(const Graph &g, double fraction_to_remove,
 GraphBundle remove_edges(const GraphBundle &gb,
                          const std::vector<std::vector<std::size_t>> &edges);
 
+/**
+ * Remove num_to_remove random edges without disconnecting the graph. Like
+ * remove_edges, this removes all parallel copies of an edge together, and
+ * counts each copy.
+ *
+ * @throws std::invalid_argument if that many edges cannot be removed.
+ */
 GraphBundle rand_prune_edges_connected(const GraphBundle &gb,
                                        std::size_t num_to_remove,
                                        unsigned seed = std::random_device{}());
@@ -47,6 +62,20 @@ Graph relabel_vertices(
     const Graph &g,
     const std::unordered_map<std::size_t, std::size_t> &mapping);
 
+/**
+ * Relabel vertex v as new_index[v]. Linear in the size of the graph, with no
+ * hashing. Isolated vertices may be left unmapped (unmapped_vertex).
+ */
+Graph relabel_vertices(const Graph &g,
+                       const std::vector<std::size_t> &new_index);
+
+/**
+ * Relabel the vertices of a bundle, moving its vertex and edge properties
+ * along. Columnar vertex properties stay columnar.
+ */
+GraphBundle relabel_vertices(const GraphBundle &gb,
+                             const std::vector<std::size_t> &new_index);
+
 /**
  * Shuffle existing vertex labels, maintaining the same graph topology.
  */
@@ -68,5 +97,51 @@ Graph shuffle_vertex_labels(const Graph &g, unsigned seed);
 std::pair<Graph, std::unordered_map<std::size_t, std::size_t>>
 contiguize(const Graph &g);
 
+/**
+ * Vertex orderings that improve the memory locality of traversals.
+ */
+enum class VertexOrder {
+  rcm,    ///< reverse Cuthill-McKee: small bandwidth
+  bfs,    ///< breadth-first search order
+  degree, ///< decreasing degree, hubs first
+  gorder  ///< Gorder: vertices sharing neighbors close together
+};
+
+/**
+ * The orderings below return a permutation 'new_index', where vertex v becomes
+ * vertex new_index[v]. It can be passed to relabel_vertices and to
+ * BitAdjmat::permute.
+ */
+std::vector<std::size_t> bfs_order(const Graph &g, std::size_t source);
+
+/**
+ * Reverse Cuthill-McKee ordering. Each component is traversed from a
+ * pseudo-peripheral vertex, queueing neighbors by increasing degree.
+ */
+std::vector<std::size_t> reverse_cuthill_mckee_order(const Graph &g);
+
+/**
+ * Sort by decreasing degree, stable. O(V + E).
+ */
+std::vector<std::size_t> degree_order(const Graph &g);
+
+/**
+ * Gorder (Wei et al., SIGMOD 2016): greedily places next the vertex with the
+ * most neighbors and shared neighbors among the last 'window' placed ones.
+ */
+std::vector<std::size_t> gorder(const Graph &g, std::size_t window = 5);
+
+std::vector<std::size_t> vertex_order(const Graph &g, VertexOrder method);
+
+/**
+ * Reorder the vertices, returning the relabelled graph (or bundle, with its
+ * properties moved along) and the permutation that was applied.
+ */
+std::pair<Graph, std::vector<std::size_t>>
+reorder_vertices(const Graph &g, VertexOrder method = VertexOrder::rcm);
+
+std::pair<GraphBundle, std::vector<std::size_t>>
+reorder_vertices(const GraphBundle &gb, VertexOrder method = VertexOrder::rcm);
+
 } // namespace gl
 } // namespace utils
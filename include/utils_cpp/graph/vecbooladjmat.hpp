@@ -1,8 +1,10 @@
 /**********************************************************************
- * @brief A bitwise adjacency matrix implementation using vector<bool>.
- * Generally "BitAdjmat" is preferred since it takes better advantage of
- * bit-packing operations such as std::countr_zero and std::popcount.
- * @details
+ * @brief The VecBoolAdjmat interface, kept for existing callers.
+ * @details VecBoolAdjmat used to store its entries in a vector<bool>. It is
+ *now a thin facade over BitAdjmat, so rows are iterated with
+ *std::countr_zero and the counts and bitwise operations run on whole words.
+ *Unlike BitAdjmat, set() only changes the (i,j) entry, so the matrix need
+ *not be symmetric. New code should use BitAdjmat directly.
  * @author Sam Tonetto
  * @copyright GNU Public License
  * @date 2023
@@ -10,10 +12,12 @@
 
 #pragma once
 
+#include "utils_cpp/graph/bitadjmat.hpp"
 #include "utils_cpp/graph/graph.hpp"
 
-#include <bit>
-#include <unordered_set>
+#include <cstdint>
+#include <iostream>
+#include <utility>
 #include <vector>
 
 namespace utils {
@@ -21,36 +25,17 @@ namespace utils {
 namespace gl {
 
 /**
-   VecBoolAdjmat implementation of a binary square matrix, which should
-   be more efficient than using vector<vector<int>>. Stores 64 adjmat entries in
-   a single uint64_t and uses bit operations to interact with its entries.
-   Prefer using bitadjmat.hpp since it is more efficient though.
+   VecBoolAdjmat implementation of a binary square matrix, stored as a
+   BitAdjmat: 64 entries per uint64_t, with word-level iteration and bulk
+   operations.
  */
 class VecBoolAdjmat {
 
 public:
   class Row {
-
   public:
-    class iterator {
-    public:
-      explicit iterator(std::vector<bool>::iterator begin,
-                        std::vector<bool>::iterator end) noexcept;
-
-      explicit iterator(std::vector<bool>::iterator end) noexcept;
-
-      iterator &operator++() noexcept;
-      std::size_t operator*() const noexcept;
-      bool operator==(const iterator &other) const noexcept;
-      bool operator!=(const iterator &other) const noexcept;
-
-    private:
-      std::vector<bool>::iterator begin_;
-      std::vector<bool>::iterator it_;
-      std::vector<bool>::iterator end_;
-    };
+    using iterator = BitAdjmat::Row::row_iterator;
 
-  public:
     Row(VecBoolAdjmat &parent, std::size_t row_index) noexcept;
 
     bool contains(std::size_t col) const noexcept;
@@ -60,30 +45,13 @@ public:
     iterator end() const noexcept;
 
   private:
-    std::vector<bool>::iterator begin_;
-    std::vector<bool>::iterator end_;
+    BitAdjmat::Row row_;
   };
 
   class ConstRow {
   public:
-    class const_iterator {
-    public:
-      explicit const_iterator(std::vector<bool>::const_iterator begin,
-                              std::vector<bool>::const_iterator end) noexcept;
-
-      explicit const_iterator(std::vector<bool>::const_iterator end) noexcept;
-      const_iterator &operator++() noexcept;
-      std::size_t operator*() const noexcept;
-      bool operator==(const const_iterator &other) const noexcept;
-      bool operator!=(const const_iterator &other) const noexcept;
-
-    private:
-      std::vector<bool>::const_iterator begin_;
-      std::vector<bool>::const_iterator it_;
-      std::vector<bool>::const_iterator end_;
-    };
+    using const_iterator = BitAdjmat::Row::row_iterator;
 
-  public:
     ConstRow(const VecBoolAdjmat &parent, std::size_t row_index) noexcept;
 
     bool contains(std::size_t col) const noexcept;
@@ -93,8 +61,7 @@ public:
     const_iterator end() const noexcept;
 
   private:
-    std::vector<bool>::const_iterator begin_;
-    std::vector<bool>::const_iterator end_;
+    BitAdjmat::Row row_;
   };
 
 public:
@@ -194,6 +161,12 @@ public:
    */
   VecBoolAdjmat &operator|=(const VecBoolAdjmat &other) noexcept;
 
+  /**
+   * The underlying BitAdjmat, for its kernels (matmul, triangle counts,
+   * cliques, ...).
+   */
+  const BitAdjmat &bitadjmat() const noexcept;
+
   friend std::ostream &operator<<(std::ostream &os,
                                   const VecBoolAdjmat &m) noexcept;
 
@@ -204,161 +177,66 @@ public:
                          const VecBoolAdjmat &rhs) noexcept;
 
 private:
-  VecBoolAdjmat &swap_rows(std::size_t r1, std::size_t r2);
-  VecBoolAdjmat &swap_columns(std::size_t c1, std::size_t c2);
-
-private:
-  std::size_t num_vertices;
-  std::vector<bool> matrix;
-
-  constexpr static std::size_t N = 64;
-
-private:
-  std::size_t flat_index(std::size_t i, std::size_t j) const noexcept;
+  BitAdjmat matrix;
 };
 
 // ==========================================
 // =========== Implementation ===============
 // ==========================================
 
-// =========== VecBoolAdjmat::Row::iterator ===========
-inline VecBoolAdjmat::Row::iterator::iterator(
-    std::vector<bool>::iterator begin, std::vector<bool>::iterator end) noexcept
-    : begin_{begin}, it_{begin}, end_{end} {
-  if (it_ != end_ && !*it_) {
-    ++(*this);
-  }
-}
-
-inline VecBoolAdjmat::Row::iterator::iterator(
-    std::vector<bool>::iterator end) noexcept
-    : begin_{end}, it_{end}, end_{end} {}
-
-inline VecBoolAdjmat::Row::iterator &
-VecBoolAdjmat::Row::iterator::operator++() noexcept {
-  do {
-    ++it_;
-  } while (it_ != end_ && !*it_);
-  return *this;
-}
-
-inline std::size_t VecBoolAdjmat::Row::iterator::operator*() const noexcept {
-  return it_ - begin_;
-}
-
-inline bool
-VecBoolAdjmat::Row::iterator::operator==(const iterator &other) const noexcept {
-  return it_ == other.it_;
-}
-
-inline bool
-VecBoolAdjmat::Row::iterator::operator!=(const iterator &other) const noexcept {
-  return it_ != other.it_;
-}
-
 // =========== VecBoolAdjmat::Row ===========
 inline VecBoolAdjmat::Row::Row(VecBoolAdjmat &parent,
                                std::size_t row_index) noexcept
-    : begin_{parent.matrix.begin() + row_index * parent.num_vertices},
-      end_{begin_ + parent.num_vertices} {}
+    : row_{parent.matrix, row_index} {}
 
 inline bool
 VecBoolAdjmat::Row::contains(std::size_t neighbor_index) const noexcept {
-  return *(begin_ + neighbor_index);
+  return row_.contains(neighbor_index);
 }
 
 inline std::size_t VecBoolAdjmat::Row::size() const noexcept {
-  return end_ - begin_;
+  return row_.size();
 }
 
 inline VecBoolAdjmat::Row::iterator VecBoolAdjmat::Row::begin() const noexcept {
-  return iterator(begin_, end_);
+  return row_.begin();
 }
 
 inline VecBoolAdjmat::Row::iterator VecBoolAdjmat::Row::end() const noexcept {
-  return iterator(end_, end_);
-}
-
-// =========== VecBoolAdjmat::Row::const_iterator ===========
-inline VecBoolAdjmat::ConstRow::const_iterator::const_iterator(
-    std::vector<bool>::const_iterator begin,
-    std::vector<bool>::const_iterator end) noexcept
-    : begin_{begin}, it_{begin}, end_{end} {
-  if (it_ != end_ && !*it_) {
-    ++(*this);
-  }
-}
-
-inline VecBoolAdjmat::ConstRow::const_iterator::const_iterator(
-    std::vector<bool>::const_iterator end) noexcept
-    : begin_{end}, it_{end}, end_{end} {}
-
-inline VecBoolAdjmat::ConstRow::const_iterator &
-VecBoolAdjmat::ConstRow::const_iterator::operator++() noexcept {
-  do {
-    ++it_;
-  } while (it_ != end_ && !*it_);
-  return *this;
-}
-
-inline std::size_t
-VecBoolAdjmat::ConstRow::const_iterator::operator*() const noexcept {
-  return it_ - begin_;
-}
-
-inline bool VecBoolAdjmat::ConstRow::const_iterator::operator==(
-    const const_iterator &other) const noexcept {
-  return it_ == other.it_;
-}
-
-inline bool VecBoolAdjmat::ConstRow::const_iterator::operator!=(
-    const const_iterator &other) const noexcept {
-  return it_ != other.it_;
+  return row_.end();
 }
 
 // =========== VecBoolAdjmat::ConstRow ===========
 
 inline VecBoolAdjmat::ConstRow::ConstRow(const VecBoolAdjmat &parent,
                                          std::size_t row_index) noexcept
-    : begin_{parent.matrix.begin() + row_index * parent.num_vertices},
-      end_{begin_ + parent.num_vertices} {}
+    : row_{parent.matrix, row_index} {}
 
 inline bool
 VecBoolAdjmat::ConstRow::contains(std::size_t neighbor_index) const noexcept {
-  return *(begin_ + neighbor_index);
+  return row_.contains(neighbor_index);
 }
 
 inline std::size_t VecBoolAdjmat::ConstRow::size() const noexcept {
-  return end_ - begin_;
+  return row_.size();
 }
 
 inline VecBoolAdjmat::ConstRow::const_iterator
 VecBoolAdjmat::ConstRow::begin() const noexcept {
-  return const_iterator(begin_, end_);
+  return row_.begin();
 }
 
 inline VecBoolAdjmat::ConstRow::const_iterator
 VecBoolAdjmat::ConstRow::end() const noexcept {
-  return const_iterator(end_, end_);
+  return row_.end();
 }
 
 // =========== VecBoolAdjmat ===========
 
 inline VecBoolAdjmat::VecBoolAdjmat(std::size_t num_vertices)
-    : num_vertices{num_vertices},
-      matrix{std::vector<bool>(num_vertices * num_vertices, 0)} {}
-
-inline VecBoolAdjmat::VecBoolAdjmat(const Graph &g)
-    : num_vertices{boost::num_vertices(g)},
-      matrix{std::vector<bool>(num_vertices * num_vertices, 0)} {
-
-  for (auto [ei, end] = boost::edges(g); ei != end; ++ei) {
-    uint64_t i = boost::source(*ei, g);
-    uint64_t j = boost::target(*ei, g);
-    matrix[flat_index(i, j)] = 1;
-    matrix[flat_index(j, i)] = 1;
-  }
-}
+    : matrix{num_vertices} {}
+
+inline VecBoolAdjmat::VecBoolAdjmat(const Graph &g) : matrix{g} {}
 
 inline VecBoolAdjmat::Row
 VecBoolAdjmat::operator[](std::size_t row_index) noexcept {
@@ -370,28 +248,10 @@ VecBoolAdjmat::operator[](std::size_t row_index) const noexcept {
   return ConstRow(*this, row_index);
 }
 
-inline Graph VecBoolAdjmat::to_graph() const {
-  Graph g;
-  for (std::size_t i = 0; i < num_vertices; ++i) {
-    boost::add_vertex(g);
-  }
-
-  for (std::size_t i = 0; i < num_vertices; ++i) {
-    for (std::size_t j = i + 1; j < num_vertices; ++j) {
-      if (matrix[flat_index(i, j)]) {
-        boost::add_edge(i, j, g);
-      }
-    }
-  }
-  return g;
-}
+inline Graph VecBoolAdjmat::to_graph() const { return matrix.to_graph(); }
 
 inline std::size_t VecBoolAdjmat::count_ones() const noexcept {
-  std::size_t count = 0;
-  for (auto element : matrix) {
-    count += element;
-  }
-  return count;
+  return matrix.count_ones();
 }
 
 inline std::size_t VecBoolAdjmat::count_edges() const noexcept {
@@ -399,97 +259,66 @@ inline std::size_t VecBoolAdjmat::count_edges() const noexcept {
 }
 
 inline std::size_t VecBoolAdjmat::count_edges(int v) const noexcept {
-  std::size_t count = 0;
-  for (auto element : this->operator[](v)) {
-    count += element;
-  }
-  return count;
+  return matrix.degree(v);
 }
 
-inline std::size_t VecBoolAdjmat::size() const noexcept { return num_vertices; }
+inline std::size_t VecBoolAdjmat::size() const noexcept {
+  return matrix.num_vertices();
+}
 
 inline VecBoolAdjmat &VecBoolAdjmat::swap(std::size_t v1, std::size_t v2) {
-  swap_rows(v1, v2);
-  swap_columns(v1, v2);
+  matrix.swap(v1, v2);
   return *this;
 }
 
 inline VecBoolAdjmat &VecBoolAdjmat::swap(
     const std::vector<std::pair<std::size_t, std::size_t>> &matching) {
-  for (auto [v1, v2] : matching) {
-    swap(v1, v2);
-  }
-  return *this;
-}
-
-inline VecBoolAdjmat &VecBoolAdjmat::swap_rows(std::size_t r1, std::size_t r2) {
-  auto r1_begin_ = matrix.begin() + r1 * num_vertices;
-  auto r1_end = matrix.begin() + (r1 + 1) * num_vertices;
-  auto r2_begin_ = matrix.begin() + r2 * num_vertices;
-  std::swap_ranges(r1_begin_, r1_end, r2_begin_);
-  return *this;
-}
-
-inline VecBoolAdjmat &VecBoolAdjmat::swap_columns(std::size_t c1,
-                                                  std::size_t c2) {
-  for (std::size_t i = 0; i < num_vertices; ++i) {
-    std::vector<bool>::swap(matrix[flat_index(i, c1)],
-                            matrix[flat_index(i, c2)]);
-  }
+  matrix.swap(matching);
   return *this;
 }
 
 inline VecBoolAdjmat &VecBoolAdjmat::flip() noexcept {
-  matrix.flip();
+  matrix.toggle();
   return *this;
 }
 
 inline VecBoolAdjmat &
 VecBoolAdjmat::operator^=(const VecBoolAdjmat &other) noexcept {
-  for (std::size_t i = 0; i < num_vertices; ++i) {
-    matrix[i] = matrix[i] ^ other.matrix[i];
-  }
+  matrix ^= other.matrix;
   return *this;
 }
 
 inline VecBoolAdjmat &
 VecBoolAdjmat::operator&=(const VecBoolAdjmat &other) noexcept {
-  for (std::size_t i = 0; i < num_vertices; ++i) {
-    matrix[i] = matrix[i] && other.matrix[i];
-  }
+  matrix &= other.matrix;
   return *this;
 }
 
 inline VecBoolAdjmat &
 VecBoolAdjmat::operator|=(const VecBoolAdjmat &other) noexcept {
-  for (std::size_t i = 0; i < num_vertices; ++i) {
-    matrix[i] = matrix[i] || other.matrix[i];
-  }
+  matrix |= other.matrix;
   return *this;
 }
 
 inline bool VecBoolAdjmat::get(std::size_t i, std::size_t j) const noexcept {
-  return matrix[flat_index(i, j)];
+  return matrix.get(i, j);
 }
 
 inline void VecBoolAdjmat::set(std::size_t i, std::size_t j,
                                bool val) noexcept {
-  matrix[flat_index(i, j)] = val;
+  // Only the (i,j) word, unlike BitAdjmat::set which also sets (j,i).
+  const std::uint64_t bit = 1ULL << (j % BitAdjmat::N);
+  std::uint64_t &word = matrix.matrix(i, j / BitAdjmat::N);
+  word = val ? (word | bit) : (word & ~bit);
+}
+
+inline const BitAdjmat &VecBoolAdjmat::bitadjmat() const noexcept {
+  return matrix;
 }
 
 inline std::ostream &operator<<(std::ostream &os,
                                 const VecBoolAdjmat &m) noexcept {
-  for (std::size_t i = 0; i < m.num_vertices; ++i) {
-    for (std::size_t j = 0; j < m.num_vertices; ++j) {
-      if (j != 0) {
-        os << ' ';
-      }
-
-      os << m.matrix[m.flat_index(i, j)];
-    }
-    os << "\n";
-  }
-  return os;
+  return os << m.matrix;
 }
 
 inline bool operator==(const VecBoolAdjmat &lhs,
@@ -502,11 +331,6 @@ inline bool operator!=(const VecBoolAdjmat &lhs,
   return !(lhs == rhs);
 }
 
-inline std::size_t VecBoolAdjmat::flat_index(std::size_t i,
-                                             std::size_t j) const noexcept {
-  return i * num_vertices + j;
-}
-
 } // namespace gl
 
 } // namespace utils
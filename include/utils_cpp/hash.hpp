@@ -1,6 +1,11 @@
 /**********************************************************************
  * @brief Hash functions for various data types
- * @details
+ * @details Hashes are combined with a 64-bit multiply-and-fold mixer (the
+ *"mum" step of wyhash), and integer keys are passed through a splitmix64
+ *finalizer first, since std::hash is the identity on integers. Contiguous
+ *runs of integers (vector_hash, array_hash, hash_span) are hashed as bytes
+ *with a wyhash-style bulk hash. Values are stable within a build, not across
+ *platforms or versions: do not persist them.
  * @author Sam Tonetto
  * @copyright GNU Public License
  * @date 2023
@@ -9,33 +14,201 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <map>
 #include <set>
+#include <span>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
 namespace utils {
 
+namespace detail {
+
+inline constexpr std::uint64_t hash_secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull,
+    0x589965cc75374cc3ull};
+
+/**
+ * Full 64x64 -> 128 bit product of a and b: the low half is left in a and the
+ * high half in b.
+ */
+inline void multiply(std::uint64_t &a, std::uint64_t &b) noexcept {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = static_cast<__uint128_t>(a) * b;
+  a = static_cast<std::uint64_t>(r);
+  b = static_cast<std::uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64) && !defined(__clang__)
+  a = _umul128(a, b, &b);
+#else
+  std::uint64_t ha = a >> 32, hb = b >> 32, la = a & 0xffffffffu,
+                lb = b & 0xffffffffu;
+  std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  std::uint64_t t = rl + (rm0 << 32), c = t < rl;
+  std::uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  a = lo;
+  b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+/**
+ * The 128-bit product of a and b folded to 64 bits by xoring its halves.
+ * Every input bit affects every output bit.
+ */
+inline std::uint64_t mum(std::uint64_t a, std::uint64_t b) noexcept {
+  multiply(a, b);
+  return a ^ b;
+}
+
+inline std::uint64_t read64(const unsigned char *p) noexcept {
+  std::uint64_t v;
+  std::memcpy(&v, p, 8);
+  return v;
+}
+
+inline std::uint64_t read32(const unsigned char *p) noexcept {
+  std::uint32_t v;
+  std::memcpy(&v, p, 4);
+  return v;
+}
+
+// Types hashed as bytes: integers and enums, whose std::hash cannot be
+// specialized to disagree with their bytes. Other types with unique object
+// representations may have a std::hash that matches a looser operator==, so
+// they go through std::hash. bool is excluded because std::vector<bool> has no
+// contiguous storage.
+template <typename T>
+inline constexpr bool bytes_hashable_v =
+    (std::is_integral_v<T> || std::is_enum_v<T>) && !std::is_same_v<T, bool>;
+
+} // namespace detail
+
+/**
+ * The splitmix64 finalizer: a bijection on 64-bit values in which each input
+ * bit flips about half of the output bits. mix64(0) is not 0.
+ */
+inline std::uint64_t mix64(std::uint64_t x) noexcept {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/**
+ * Hashes 'len' bytes starting at 'data' (wyhash). Fast for short keys, and
+ * processes long ones 48 bytes at a time in three independent lanes.
+ */
+inline std::size_t hash_bytes(const void *data, std::size_t len,
+                              std::uint64_t seed = 0) noexcept {
+  using detail::hash_secret;
+  using detail::mum;
+  using detail::read32;
+  using detail::read64;
+  const auto *p = static_cast<const unsigned char *>(data);
+  seed ^= mum(seed ^ hash_secret[0], hash_secret[1]);
+  std::uint64_t a, b;
+  if (len <= 16) {
+    if (len >= 4) {
+      std::size_t step = (len >> 3) << 2;
+      a = (read32(p) << 32) | read32(p + step);
+      b = (read32(p + len - 4) << 32) | read32(p + len - 4 - step);
+    } else if (len > 0) {
+      a = (std::uint64_t{p[0]} << 16) | (std::uint64_t{p[len >> 1]} << 8) |
+          p[len - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    std::size_t i = len;
+    if (i > 48) {
+      std::uint64_t seed1 = seed, seed2 = seed;
+      do {
+        seed = mum(read64(p) ^ hash_secret[1], read64(p + 8) ^ seed);
+        seed1 = mum(read64(p + 16) ^ hash_secret[2], read64(p + 24) ^ seed1);
+        seed2 = mum(read64(p + 32) ^ hash_secret[3], read64(p + 40) ^ seed2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (i > 16) {
+      seed = mum(read64(p) ^ hash_secret[1], read64(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = read64(p + i - 16);
+    b = read64(p + i - 8);
+  }
+  a ^= hash_secret[1];
+  b ^= seed;
+  detail::multiply(a, b);
+  return static_cast<std::size_t>(
+      mum(a ^ hash_secret[0] ^ len, b ^ hash_secret[1]));
+}
+
 /**
- * This is basically boost::hash_combine
+ * std::hash<T>, passed through mix64 for integers, enums and pointers, for
+ * which std::hash is usually the identity.
+ */
+template <typename T>
+inline std::size_t hash_value(const T &v) {
+  if constexpr (std::is_integral_v<T> || std::is_enum_v<T> ||
+                std::is_pointer_v<T>) {
+    return static_cast<std::size_t>(mix64(std::hash<T>{}(v)));
+  } else {
+    return std::hash<T>{}(v);
+  }
+}
+
+/**
+ * Mixes the hash of v into seed. Order-dependent: combining a then b differs
+ * from b then a.
  */
 template <typename T>
 inline void hash_combine(std::size_t &seed, const T &v) {
-  seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  seed = static_cast<std::size_t>(
+      detail::mum(seed ^ detail::hash_secret[0],
+                  hash_value(v) ^ detail::hash_secret[1]));
 }
 
-/** taken from python's frozenset:
- * https://stackoverflow.com/questions/20832279/python-frozenset-hashing-algorithm-implementation
- *
- * I benchmarked this against sorting then using hash_combine and it was faster,
- * with fewer collisions, for the case of inserting all the edges of a complete
- * undirected graph.
+/**
+ * Adds the hash of v to seed. Addition is commutative and associative, so
+ * the result does not depend on the order of the elements, and unlike xor,
+ * repeated elements do not cancel out.
  */
 template <typename T>
 inline void symmetric_hash_combine(std::size_t &seed, const T &v) {
-  seed ^= (v ^ (v << 16) ^ 89869747UL) * 3644798167UL;
+  seed += static_cast<std::size_t>(mix64(hash_value(v)));
+}
+
+/**
+ * Hash of a contiguous sequence. Integer elements are hashed as bytes in one
+ * pass; other types are combined one at a time.
+ */
+template <typename T, std::size_t Extent>
+inline std::size_t hash_span(std::span<T, Extent> s) {
+  using value_type = std::remove_cv_t<T>;
+  if constexpr (detail::bytes_hashable_v<value_type>) {
+    return hash_bytes(s.data(), s.size_bytes());
+  } else {
+    std::size_t seed = 0;
+    for (const auto &elem : s) {
+      hash_combine(seed, elem);
+    }
+    return seed;
+  }
 }
 
 /**
@@ -85,11 +258,15 @@ struct symmetric_pair_equal {
 template <typename T>
 struct vector_hash {
   std::size_t operator()(const std::vector<T> &v) const {
-    std::size_t seed = 0;
-    for (const auto &elem : v) {
-      hash_combine(seed, elem);
+    if constexpr (detail::bytes_hashable_v<T>) {
+      return hash_span(std::span(v));
+    } else {
+      std::size_t seed = 0;
+      for (const auto &elem : v) {
+        hash_combine(seed, elem);
+      }
+      return seed;
     }
-    return seed;
   }
 };
 
@@ -240,14 +417,10 @@ struct unordered_map_hash {
 /**
  * @brief array hash
  */
-template <typename T, size_t N>
+template <typename T, std::size_t N>
 struct array_hash {
   std::size_t operator()(const std::array<T, N> &a) const {
-    std::size_t seed = 0;
-    for (const auto &elem : a) {
-      hash_combine(seed, elem);
-    }
-    return seed;
+    return hash_span(std::span(a));
   }
 };
 
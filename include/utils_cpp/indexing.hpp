@@ -15,11 +15,12 @@ namespace utils {
 
 /**
  * Applies an index-mapping to an arbitrarily nested vector, returning the new
- * vector.
+ * vector. The mapping is any map from std::size_t to std::size_t with
+ * operator[], e.g. std::unordered_map or FlatHashMap.
  */
-inline std::vector<std::size_t>
-apply_index_mapping(const std::vector<std::size_t> &vec,
-                    std::unordered_map<std::size_t, std::size_t> &mapping) {
+template <typename Mapping = std::unordered_map<std::size_t, std::size_t>>
+std::vector<std::size_t>
+apply_index_mapping(const std::vector<std::size_t> &vec, Mapping &mapping) {
 
   std::vector<std::size_t> new_vec(vec.size());
   for (std::size_t i = 0; i < vec.size(); ++i) {
@@ -29,10 +30,10 @@ apply_index_mapping(const std::vector<std::size_t> &vec,
   return new_vec;
 }
 
-template <typename T>
-std::vector<T>
-apply_index_mapping(const std::vector<T> &vec,
-                    std::unordered_map<std::size_t, std::size_t> &mapping) {
+template <typename T,
+          typename Mapping = std::unordered_map<std::size_t, std::size_t>>
+std::vector<T> apply_index_mapping(const std::vector<T> &vec,
+                                   Mapping &mapping) {
 
   std::vector<T> result(vec.size());
   std::size_t i = 0;
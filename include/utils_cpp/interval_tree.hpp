@@ -8,20 +8,29 @@
 
 #pragma once
 
+#include "utils_cpp/node_pool.hpp"
+
 #include <algorithm>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace utils {
 
 /**
  * Interval trees allow you to efficiently check if a value is contained in an
- * interval, or to check overlap between an interval and other intervals (not
- * yet implemented).
+ * interval, and to enumerate the intervals overlapping a range or containing
+ * each of a batch of points.
+ *
+ * Nodes live in a NodePool that gets its slabs from Allocator, so clear() and
+ * destruction free the slabs at once rather than node by node.
  */
-template <typename T, typename Compare = std::less<T>>
+template <typename T, typename Compare = std::less<T>,
+          typename Allocator = std::allocator<T>>
 class IntervalTree {
 
 public:
@@ -29,74 +38,216 @@ public:
 
     T low, high;
     int balance;
+    int height; // of the subtree rooted here, 0 for a leaf
     IntervalNode *left, *right, *parent;
 
     T max_high; // tracks maximum 'high' value in the subtree starting at this
                 // node.
 
     IntervalNode(const T &low, const T &high, IntervalNode *parent = nullptr)
-        : low{low}, high{high}, balance{0}, left{nullptr}, right{nullptr},
-          parent{parent}, max_high{high} {}
-
-    ~IntervalNode() {
-      delete left;
-      delete right;
-    }
+        : low{low}, high{high}, balance{0}, height{0}, left{nullptr},
+          right{nullptr}, parent{parent}, max_high{high} {}
   };
 
 private:
+  using node_pool =
+      NodePool<IntervalNode, typename std::allocator_traits<
+                                 Allocator>::template rebind_alloc<IntervalNode>>;
+
   IntervalNode *root;
   Compare cmp;
+  node_pool pool;
 
 public:
   IntervalTree() : root{nullptr} {}
-  ~IntervalTree() { delete root; }
+  explicit IntervalTree(const Allocator &alloc) : root{nullptr}, pool{alloc} {}
+  ~IntervalTree() { destroy_nodes(); }
 
   IntervalTree(const IntervalTree &) = delete;
   IntervalTree &operator=(const IntervalTree &) = delete;
-  IntervalTree(IntervalTree &&other) noexcept : root{std::move(other.root)} {}
+  IntervalTree(IntervalTree &&other) noexcept
+      : root{std::exchange(other.root, nullptr)},
+        pool{std::move(other.pool)} {}
 
   IntervalTree &operator=(IntervalTree &&other) noexcept {
-    root = std::move(other.root);
+    if (this != &other) {
+      destroy_nodes();
+      root = std::exchange(other.root, nullptr);
+      pool = std::move(other.pool);
+    }
     return *this;
   }
 
+  /**
+   * A deep copy whose nodes are in one contiguous slab.
+   */
+  IntervalTree clone() const;
+
+  /**
+   * Removes every interval. O(1) in the number of nodes when T is trivially
+   * destructible.
+   */
+  void clear() noexcept {
+    destroy_nodes();
+    root = nullptr;
+  }
+
+  std::size_t size() const noexcept { return pool.size(); }
+  bool empty() const noexcept { return root == nullptr; }
+
   bool contains(const T &point) const { return contains(root, point); }
+
+  /**
+   * Writes every interval overlapping [low, high] to out, as std::pair<T, T>
+   * in increasing order of (low, high).
+   * @return out past the last interval written.
+   */
+  template <typename OutputIt>
+  OutputIt find_overlapping(const T &low, const T &high, OutputIt out) const {
+    return find_overlapping(root, low, high, out);
+  }
+
+  /**
+   * Answers a batch of stabbing queries in one traversal. For each interval
+   * containing points[i], writes std::pair<std::size_t, std::pair<T, T>>
+   * (i, interval) to out. points must be sorted by Compare. Each subtree is
+   * visited once for the whole run of points that can reach it, rather than
+   * once per point.
+   * @return out past the last pair written.
+   */
+  template <typename OutputIt>
+  OutputIt find_containing(std::span<const T> points, OutputIt out) const {
+    return find_containing(root, points, 0, out);
+  }
+
   bool insert(const T &low, const T &high);
 
   bool insert(const std::pair<T, T> &interval) {
     return insert(interval.first, interval.second);
   }
 
+  /**
+   * Removes the interval [low, high] if present.
+   */
   void erase(const T &low, const T &high);
 
-  std::size_t height() const { return height(root); }
+  void erase(const std::pair<T, T> &interval) {
+    erase(interval.first, interval.second);
+  }
+
+  /**
+   * Height of the tree, 0 for a single node. O(1).
+   */
+  std::size_t height() const { return static_cast<std::size_t>(height(root)); }
   int balance() const { return root->balance; }
 
 private:
   bool contains(IntervalNode *node, const T &point) const;
 
+  template <typename OutputIt>
+  OutputIt find_overlapping(const IntervalNode *node, const T &low,
+                            const T &high, OutputIt out) const;
+
+  // points is the sub-range of the batch, starting at index 'first'.
+  template <typename OutputIt>
+  OutputIt find_containing(const IntervalNode *node, std::span<const T> points,
+                           std::size_t first, OutputIt out) const;
+
   void rotate_left(IntervalNode *node);
   void rotate_right(IntervalNode *node);
 
-  std::size_t height(IntervalNode *node) const {
-    if (!node) {
-      return -1;
-    }
-    return 1 + std::max(height(node->left), height(node->right));
+  static int height(const IntervalNode *node) {
+    return node ? node->height : -1;
   }
 
-  void set_balance(IntervalNode *node) {
-    node->balance = height(node->right) - height(node->left);
+  /**
+   * Intervals are ordered by low, then high, so equal intervals always meet
+   * on the search path.
+   */
+  bool less(const T &low, const T &high, const IntervalNode *node) const {
+    return cmp(low, node->low) ||
+           (!cmp(node->low, low) && cmp(high, node->high));
   }
 
+  /**
+   * Recomputes the cached height, balance and max_high of node from its
+   * children, which must already be up to date.
+   */
+  void update(IntervalNode *node) const;
+
+  /**
+   * Restores the AVL property from node up to the root, updating cached
+   * fields on the way. O(log n).
+   */
   void rebalance(IntervalNode *node);
 
-  void set_max_high(IntervalNode *node);
+  static IntervalNode *clone_node(const IntervalNode *node, node_pool &target);
+
+  /**
+   * Runs the node destructors if they do anything, without recursion or
+   * allocation, then releases the pool.
+   */
+  void destroy_nodes() noexcept;
 };
 
-template <typename T, typename Compare>
-bool IntervalTree<T, Compare>::contains(IntervalNode *node,
+template <typename T, typename Compare, typename Allocator>
+IntervalTree<T, Compare, Allocator>
+IntervalTree<T, Compare, Allocator>::clone() const {
+  IntervalTree new_tree{Allocator(pool.get_allocator())};
+  new_tree.pool.reserve(pool.size());
+  new_tree.root = clone_node(root, new_tree.pool);
+  return new_tree;
+}
+
+template <typename T, typename Compare, typename Allocator>
+typename IntervalTree<T, Compare, Allocator>::IntervalNode *
+IntervalTree<T, Compare, Allocator>::clone_node(const IntervalNode *node,
+                                                node_pool &target) {
+  if (!node) {
+    return nullptr;
+  }
+
+  IntervalNode *new_node = target.create(*node);
+  new_node->parent = nullptr;
+  new_node->left = clone_node(node->left, target);
+  new_node->right = clone_node(node->right, target);
+
+  if (new_node->left) {
+    new_node->left->parent = new_node;
+  }
+  if (new_node->right) {
+    new_node->right->parent = new_node;
+  }
+
+  return new_node;
+}
+
+template <typename T, typename Compare, typename Allocator>
+void IntervalTree<T, Compare, Allocator>::destroy_nodes() noexcept {
+  if constexpr (!std::is_trivially_destructible_v<IntervalNode>) {
+    // Post-order walk through the parent pointers, unlinking each node
+    // before destroying it.
+    IntervalNode *node = root;
+    while (node) {
+      if (node->left) {
+        node = node->left;
+      } else if (node->right) {
+        node = node->right;
+      } else {
+        IntervalNode *parent = node->parent;
+        if (parent) {
+          (parent->left == node ? parent->left : parent->right) = nullptr;
+        }
+        std::destroy_at(node);
+        node = parent;
+      }
+    }
+  }
+  pool.release();
+}
+
+template <typename T, typename Compare, typename Allocator>
+bool IntervalTree<T, Compare, Allocator>::contains(IntervalNode *node,
                                         const T &point) const {
   if (!node) {
     return false;
@@ -113,10 +264,60 @@ bool IntervalTree<T, Compare>::contains(IntervalNode *node,
   return contains(node->right, point);
 }
 
-template <typename T, typename Compare>
-bool IntervalTree<T, Compare>::insert(const T &low, const T &high) {
+template <typename T, typename Compare, typename Allocator>
+template <typename OutputIt>
+OutputIt IntervalTree<T, Compare, Allocator>::find_overlapping(
+    const IntervalNode *node, const T &low, const T &high, OutputIt out) const {
+  // Nothing in this subtree reaches low.
+  if (!node || cmp(node->max_high, low)) {
+    return out;
+  }
+  out = find_overlapping(node->left, low, high, out);
+  // This node and its right subtree start after high.
+  if (cmp(high, node->low)) {
+    return out;
+  }
+  if (!cmp(node->high, low)) {
+    *out++ = std::pair<T, T>(node->low, node->high);
+  }
+  return find_overlapping(node->right, low, high, out);
+}
+
+template <typename T, typename Compare, typename Allocator>
+template <typename OutputIt>
+OutputIt IntervalTree<T, Compare, Allocator>::find_containing(
+    const IntervalNode *node, std::span<const T> points, std::size_t first,
+    OutputIt out) const {
+  if (!node || points.empty()) {
+    return out;
+  }
+  // Points above max_high cannot be in this subtree.
+  auto reach = std::upper_bound(points.begin(), points.end(), node->max_high,
+                                cmp);
+  points = points.first(static_cast<std::size_t>(reach - points.begin()));
+  if (points.empty()) {
+    return out;
+  }
+
+  out = find_containing(node->left, points, first, out);
+
+  // Points below node->low miss this node and everything to its right.
+  auto from = std::lower_bound(points.begin(), points.end(), node->low, cmp);
+  auto skip = static_cast<std::size_t>(from - points.begin());
+  auto to = std::upper_bound(from, points.end(), node->high, cmp);
+  for (auto it = from; it != to; ++it) {
+    *out++ = std::pair<std::size_t, std::pair<T, T>>(
+        first + static_cast<std::size_t>(it - points.begin()),
+        std::pair<T, T>(node->low, node->high));
+  }
+
+  return find_containing(node->right, points.subspan(skip), first + skip, out);
+}
+
+template <typename T, typename Compare, typename Allocator>
+bool IntervalTree<T, Compare, Allocator>::insert(const T &low, const T &high) {
   if (!root) {
-    root = new IntervalNode(low, high);
+    root = pool.create(low, high);
     return true;
   }
 
@@ -132,14 +333,14 @@ bool IntervalTree<T, Compare>::insert(const T &low, const T &high) {
 
     parent = node;
 
-    bool go_left = cmp(low, node->low);
+    bool go_left = less(low, high, node);
     node = go_left ? node->left : node->right;
 
     if (!node) {
       if (go_left) {
-        parent->left = new IntervalNode(low, high, parent);
+        parent->left = pool.create(low, high, parent);
       } else {
-        parent->right = new IntervalNode(low, high, parent);
+        parent->right = pool.create(low, high, parent);
       }
 
       rebalance(parent);
@@ -150,24 +351,23 @@ bool IntervalTree<T, Compare>::insert(const T &low, const T &high) {
   return true;
 }
 
-template <typename T, typename Compare>
-void IntervalTree<T, Compare>::set_max_high(IntervalNode *node) {
+template <typename T, typename Compare, typename Allocator>
+void IntervalTree<T, Compare, Allocator>::update(IntervalNode *node) const {
+  int l = height(node->left), r = height(node->right);
+  node->height = 1 + std::max(l, r);
+  node->balance = r - l;
 
-  if (node) {
-    node->max_high = node->high;
-    if (node->left) {
-      node->max_high = std::max(node->max_high, node->left->max_high);
-    }
-    if (node->right) {
-      node->max_high = std::max(node->max_high, node->right->max_high);
-    }
-  } else {
-    node->max_high = std::numeric_limits<T>::min();
+  node->max_high = node->high;
+  if (node->left && cmp(node->max_high, node->left->max_high)) {
+    node->max_high = node->left->max_high;
+  }
+  if (node->right && cmp(node->max_high, node->right->max_high)) {
+    node->max_high = node->right->max_high;
   }
 }
 
-template <typename T, typename Compare>
-void IntervalTree<T, Compare>::rotate_right(IntervalNode *node) {
+template <typename T, typename Compare, typename Allocator>
+void IntervalTree<T, Compare, Allocator>::rotate_right(IntervalNode *node) {
 
   IntervalNode *tmp = node->left;
   tmp->parent = node->parent;
@@ -188,17 +388,13 @@ void IntervalTree<T, Compare>::rotate_right(IntervalNode *node) {
     }
   }
 
-  set_balance(node);
-  set_balance(tmp);
-
-  // tmp becomes parent of node, so we must update node's max_high first.
-  // at least I think so...
-  set_max_high(node);
-  set_max_high(tmp);
+  // tmp is now the parent of node, so node is updated first.
+  update(node);
+  update(tmp);
 }
 
-template <typename T, typename Compare>
-void IntervalTree<T, Compare>::rotate_left(IntervalNode *node) {
+template <typename T, typename Compare, typename Allocator>
+void IntervalTree<T, Compare, Allocator>::rotate_left(IntervalNode *node) {
   IntervalNode *tmp = node->right;
   tmp->parent = node->parent;
   node->right = tmp->left;
@@ -218,40 +414,82 @@ void IntervalTree<T, Compare>::rotate_left(IntervalNode *node) {
     }
   }
 
-  set_balance(node);
-  set_balance(tmp);
-
-  // tmp becomes parent of node, so we must update node's max_high first
-  // ... at least I think so
-  set_max_high(node);
-  set_max_high(tmp);
+  // tmp is now the parent of node, so node is updated first.
+  update(node);
+  update(tmp);
 }
 
-template <typename T, typename Compare>
-void IntervalTree<T, Compare>::rebalance(IntervalNode *node) {
+template <typename T, typename Compare, typename Allocator>
+void IntervalTree<T, Compare, Allocator>::rebalance(IntervalNode *node) {
 
-  set_balance(node);
+  while (true) {
+    update(node);
 
-  if (node->balance == -2) {
-    if (height(node->left->left) >= height(node->left->right)) {
-      rotate_right(node);
-    } else {
-      rotate_left(node->left);
-      rotate_right(node);
+    if (node->balance == -2) {
+      if (height(node->left->left) >= height(node->left->right)) {
+        rotate_right(node);
+      } else {
+        rotate_left(node->left);
+        rotate_right(node);
+      }
+      node = node->parent;
+    } else if (node->balance == 2) {
+      if (height(node->right->right) >= height(node->right->left)) {
+        rotate_left(node);
+      } else {
+        rotate_right(node->right);
+        rotate_left(node);
+      }
+      node = node->parent;
     }
-  } else if (node->balance == 2) {
-    if (height(node->right->right) >= height(node->right->left)) {
-      rotate_left(node);
-    } else {
-      rotate_right(node->right);
-      rotate_left(node);
+
+    if (!node->parent) {
+      root = node;
+      return;
     }
+    node = node->parent;
   }
+}
 
-  if (node->parent) {
-    rebalance(node->parent);
+template <typename T, typename Compare, typename Allocator>
+void IntervalTree<T, Compare, Allocator>::erase(const T &low, const T &high) {
+  IntervalNode *node = root;
+  while (node && !(node->low == low && node->high == high)) {
+    node = less(low, high, node) ? node->left : node->right;
+  }
+  if (!node) {
+    return;
+  }
+
+  // With two children, take the in-order successor's interval and remove the
+  // successor instead, which has no left child.
+  if (node->left && node->right) {
+    IntervalNode *successor = node->right;
+    while (successor->left) {
+      successor = successor->left;
+    }
+    node->low = std::move(successor->low);
+    node->high = std::move(successor->high);
+    node = successor;
+  }
+
+  IntervalNode *child = node->left ? node->left : node->right;
+  IntervalNode *parent = node->parent;
+  if (child) {
+    child->parent = parent;
+  }
+  if (!parent) {
+    root = child;
+  } else if (parent->left == node) {
+    parent->left = child;
   } else {
-    root = std::move(node);
+    parent->right = child;
+  }
+
+  pool.destroy(node);
+
+  if (parent) {
+    rebalance(parent);
   }
 }
 
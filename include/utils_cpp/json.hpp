@@ -9,19 +9,35 @@
 #pragma once
 
 #include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <memory>
+#include <optional>
+#include <span>
 #include <sstream>
-#include <stack>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
 #include <unordered_map>
 #include <variant>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "mapped_file.hpp"
 #include "metaprogramming/is_instantiation.hpp"
+#include "stats.hpp"
 #include "string.hpp"
 
 namespace utils {
@@ -59,6 +75,9 @@ Json parse(std::string_view json_str);
 /**
  * Parse a JSON file.
  * Arrays [] are stored as JsonArrays, objects {} as JsonObjects.
+ * A regular file is memory-mapped and parsed in place, so no copy of its
+ * contents is made. Anything that cannot be mapped, such as a pipe,
+ * /dev/stdin or a procfs file, is read through a stream instead.
  */
 Json parse_file(const std::string &filename);
 
@@ -174,17 +193,45 @@ public:
   constexpr Json(float value) : value_{static_cast<JsonNumber>(value)} {}
   constexpr Json(double value) : value_{static_cast<JsonNumber>(value)} {}
 
+  /**
+   * Serializes to a string. Numbers are written in their shortest round-trip
+   * form, independent of the locale, and non-finite numbers as null.
+   * Strings are written as stored: valid escape sequences kept from parsing
+   * are passed through, while raw quotes, control characters and backslashes
+   * that start no valid escape are escaped, so the output is always valid
+   * JSON.
+   */
   std::string dump() const;
   std::string pretty_dump(std::size_t tab_size = 2) const;
 
+  /**
+   * Serializes to a stream through a fixed-size internal buffer, so no
+   * string of the whole document is built.
+   */
+  void dump(std::ostream &os) const;
+  void pretty_dump(std::ostream &os, std::size_t tab_size = 2) const;
+
+  /**
+   * Appends the serialization to out, which can be reused between calls to
+   * avoid reallocating.
+   */
+  void dump_to(std::string &out) const;
+
+  /**
+   * Writes as much of the serialization as fits in [buffer, buffer + size)
+   * and returns the full length, which is larger than size if it was
+   * truncated. No terminating null is written.
+   */
+  std::size_t dump_to(char *buffer, std::size_t size) const;
+
   /**
    * Write to file, overwriting anything existing.
    * Creates the file if it doesn't exist.
    */
-  void write_to_file(const std::string &filename) {
-    std::ofstream outfile(filename);
+  void write_to_file(const std::string &filename) const {
+    std::ofstream outfile(filename, std::ios_base::binary);
     if (outfile.is_open()) {
-      outfile << this->dump();
+      dump(outfile);
       outfile.close();
     }
   }
@@ -197,49 +244,11 @@ public:
   }
 
   /**
-   * Performs the function of `append_to_file`, but without parsing first to
-   * check the validity of the file - to be valid the file must basically have
+   * Performs the function of `append_to_file`, but without checking that the
+   * file starts with an array - to be valid the file must basically have
    * an array as the top-level element.
    */
-  void unsafe_append_to_file(const std::string &filename) {
-
-    if (!std::filesystem::exists(filename)) {
-
-      Json json;
-      json.value_.emplace<JsonArray>();
-      std::get<JsonArray>(json.value_).push_back(*this);
-
-      std::ofstream outfilestream(filename, std::ios_base::app);
-      outfilestream << json.dump();
-      outfilestream.close();
-    } else {
-      // Look for last occurrence of "]" in file, replace it with ",". Also,
-      // read file in reverse for better performance.
-      std::fstream filestream(filename,
-                              std::ios_base::binary | std::ios_base::ate |
-                                  std::ios_base::in | std::ios_base::out);
-
-      for (long long i = filestream.tellg(); i >= 0; --i) {
-        filestream.clear();
-
-        filestream.seekg(i, std::ios_base::beg);
-        char c = filestream.peek();
-
-        if (!std::isspace(static_cast<unsigned char>(c))) {
-          if (c == ']') {
-            filestream.seekp(i, std::ios_base::beg);
-            filestream.put(',');
-            break;
-          }
-        }
-      }
-      filestream.close();
-
-      std::ofstream outfilestream(filename, std::ios_base::app);
-      outfilestream << this->dump() << ']';
-      outfilestream.close();
-    }
-  }
+  void unsafe_append_to_file(const std::string &filename) const;
 
   /**
    * Append to a file as a new array element.
@@ -249,66 +258,17 @@ public:
    array), or
    * 3. The file doesn't exist, in which case the file is created then step 2
    is performed.
+   * Only the first and last characters of the file are checked, so this costs
+   * O(size of *this) however large the file is. To append many values, keep a
+   * JsonArrayAppender open instead.
    */
-  void append_to_file(const std::string &filename) {
-
-    if (!std::filesystem::exists(filename)) {
-
-      Json json;
-      json.value_.emplace<JsonArray>();
-      std::get<JsonArray>(json.value_).push_back(*this);
-
-      std::ofstream outfilestream(filename, std::ios_base::app);
-      outfilestream << json.dump();
-      outfilestream.close();
-
-    } else {
-
-      Json json = parse_file(filename);
-
-      if (json.empty()) {
-        json.value_.emplace<JsonArray>();
-        std::get<JsonArray>(json.value_).push_back(*this);
-        std::ofstream outfilestream(filename, std::ios_base::app);
-        outfilestream << json.dump();
-        outfilestream.close();
-
-      } else if (json.is_array()) {
-        // Look for last occurrence of "]" in file, replace it with ",". Also,
-        // read file in reverse for better performance.
-        std::fstream filestream(filename,
-                                std::ios_base::binary | std::ios_base::ate |
-                                    std::ios_base::in | std::ios_base::out);
-
-        for (long long i = static_cast<long long>(filestream.tellg()); i >= 0;
-             --i) {
-
-          filestream.clear();
+  void append_to_file(const std::string &filename) const;
 
-          filestream.seekg(i, std::ios_base::beg);
-          char c = filestream.peek();
-
-          if (!std::isspace(static_cast<unsigned char>(c))) {
-            if (c == ']') {
-              filestream.seekp(i, std::ios_base::beg);
-              filestream.put(',');
-              break;
-            }
-          }
-        }
-        filestream.close();
-
-        std::ofstream outfilestream(filename, std::ios_base::app);
-        outfilestream << this->dump() << ']';
-        outfilestream.close();
-
-      } else {
-        throw std::runtime_error(
-            "Cannot append to file. Either file must be "
-            "empty, non-existent, or top-level element must be an array.");
-      }
-    }
-  }
+  /**
+   * Append to a JSON-lines (NDJSON) file as a new line, creating the file if
+   * needed. Nothing is read back.
+   */
+  void append_line_to_file(const std::string &filename) const;
 
   bool empty() const {
     if (is_array()) {
@@ -401,7 +361,34 @@ public:
   }
 
   const ValueType &value() const { return value_; }
-  ValueType value() { return value_; }
+  ValueType &value() { return value_; }
+
+  /**
+   * References the stored value without copying it. T is one of JsonObject,
+   * JsonArray, JsonNumber, JsonString, JsonBool or JsonNull.
+   * @throws std::bad_variant_access if the value holds another type.
+   */
+  template <typename T>
+  const T &get_ref() const {
+    return std::get<T>(value_);
+  }
+  template <typename T>
+  T &get_ref() {
+    return std::get<T>(value_);
+  }
+
+  /**
+   * The elements of an array or members of an object, without copying.
+   * @throws std::bad_variant_access if the value is not an array / object.
+   */
+  std::span<const Json> as_array_view() const {
+    return std::get<JsonArray>(value_);
+  }
+  std::span<Json> as_array_view() { return std::get<JsonArray>(value_); }
+  const JsonObject &as_object_view() const {
+    return std::get<JsonObject>(value_);
+  }
+  JsonObject &as_object_view() { return std::get<JsonObject>(value_); }
 
   /**
    * Extracts JSON into a standard C++ type.
@@ -409,9 +396,11 @@ public:
    * auto value = dict["key"].get<double>();
    * It is also capable of extracting containers, e.g.
    * auto value = dict["key"].get<std::vector<double>>();
+   * On an rvalue, e.g. std::move(dict["key"]).get<JsonArray>(), strings and
+   * subtrees are moved out instead of copied.
    */
   template <typename T>
-  T get() const {
+  T get() const & {
     if constexpr (is_instantiation<std::vector, T>()) {
       T vec_result;
       vec_result.reserve(std::get<JsonArray>(value_).size());
@@ -430,6 +419,63 @@ public:
     }
   }
 
+  template <typename T>
+  T get() && {
+    if constexpr (std::is_same_v<T, Json>) {
+      return std::move(*this);
+    } else if constexpr (is_instantiation<std::vector, T>()) {
+      T vec_result;
+      vec_result.reserve(std::get<JsonArray>(value_).size());
+      for (auto &elem : std::get<JsonArray>(value_)) {
+        vec_result.push_back(
+            std::move(elem).template get<typename T::value_type>());
+      }
+      return vec_result;
+    } else if constexpr (is_instantiation<std::map, T>()) {
+      T map_result;
+      for (auto &[key, val] : std::get<JsonObject>(value_)) {
+        map_result.emplace(
+            key, std::move(val).template get<typename T::mapped_type>());
+      }
+      return map_result;
+    } else {
+      return std::move(std::get<T>(value_));
+    }
+  }
+
+  /**
+   * Extracts JSON into out, like get<T>(), but reusing out's storage:
+   * containers are cleared and refilled in place, and numbers are converted
+   * to any arithmetic type. E.g.
+   * std::vector<double> buffer;
+   * for (...) dict["key"].get_to(buffer);
+   */
+  template <typename T>
+  void get_to(T &out) const {
+    if constexpr (std::is_same_v<T, Json>) {
+      out = *this;
+    } else if constexpr (is_instantiation<std::vector, T>()) {
+      const auto &arr = std::get<JsonArray>(value_);
+      out.clear();
+      out.reserve(arr.size());
+      for (const auto &elem : arr) {
+        typename T::value_type x{};
+        elem.get_to(x);
+        out.push_back(std::move(x));
+      }
+    } else if constexpr (is_instantiation<std::map, T>() ||
+                         is_instantiation<std::unordered_map, T>()) {
+      out.clear();
+      for (const auto &[key, val] : std::get<JsonObject>(value_)) {
+        val.get_to(out[key]);
+      }
+    } else if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+      out = static_cast<T>(std::get<JsonNumber>(value_));
+    } else {
+      out = std::get<T>(value_);
+    }
+  }
+
   /**
    * Extracts JSON into a standard C++ type.
    * This version of .get() is used with this syntax:
@@ -453,7 +499,7 @@ public:
     result.reserve(this->size());
 
     for (const auto &x : std::get<JsonArray>(value_)) {
-      result.emplace_back(x.get<T>());
+      result.emplace_back(x.template get<T>());
     }
 
     return result;
@@ -464,7 +510,7 @@ public:
     std::map<std::string, V> result;
 
     for (const auto &[k, v] : std::get<JsonObject>(value_)) {
-      result.emplace(k, v.get<V>());
+      result.emplace(k, v.template get<V>());
     }
 
     return result;
@@ -475,7 +521,7 @@ public:
     std::unordered_map<std::string, V> result;
 
     for (const auto &[k, v] : std::get<JsonObject>(value_)) {
-      result.emplace(k, v.get<V>());
+      result.emplace(k, v.template get<V>());
     }
 
     return result;
@@ -567,13 +613,56 @@ public:
     }
     return *this;
   }
+};
+
+// ========== APPENDERS ============
+
+/**
+ * Keeps a file whose top-level value is an array open for appending. The
+ * offset of the closing ']' is found once, when opening, by reading back over
+ * trailing whitespace; each append() then overwrites it with ",value]", so the
+ * file stays valid JSON after every call and nothing is ever re-read.
+ */
+class JsonArrayAppender {
+public:
+  /**
+   * Opens filename, creating it holding an empty array if it doesn't exist or
+   * is empty. With check_head, also checks that the file starts with '['.
+   *
+   * @throws std::runtime_error if the file cannot be opened or does not hold
+   * an array.
+   */
+  explicit JsonArrayAppender(const std::string &filename,
+                             bool check_head = true);
+
+  void append(const Json &json);
+
+  void flush() { file_.flush(); }
 
 private:
-  std::stringstream &dump(std::stringstream &ss) const;
+  std::fstream file_;
+  std::streamoff tail_ = 0; ///< Offset of the closing ']'.
+  bool empty_ = true;
+};
 
-  std::stringstream &pretty_dump(std::stringstream &ss,
-                                 std::size_t tab_size = 2,
-                                 std::size_t current_offset = 0) const;
+/**
+ * Keeps a JSON-lines (NDJSON) file open, writing one value per line.
+ */
+class JsonLinesAppender {
+public:
+  /**
+   * Opens filename for appending, creating it if it doesn't exist.
+   *
+   * @throws std::runtime_error if the file cannot be opened.
+   */
+  explicit JsonLinesAppender(const std::string &filename);
+
+  void append(const Json &json);
+
+  void flush() { file_.flush(); }
+
+private:
+  std::ofstream file_;
 };
 
 // ========== ITERATORS ============
@@ -664,6 +753,48 @@ struct json_iterator_wrapper {
   }
 };
 
+namespace detail {
+
+/**
+ * @internal
+ * @brief Bitmask of the bytes of [p, p + 64) that are a quote or a backslash,
+ * bit i for byte i, as in the first stage of simdjson. Uses SSE2 when
+ * available and a SWAR loop over 64-bit words otherwise. p must have at least
+ * 64 readable bytes.
+ */
+inline std::uint64_t json_quote_or_backslash_mask(const char *p) noexcept;
+
+/**
+ * @internal
+ * @brief Pointer to the first quote or backslash in [p, end), or end.
+ */
+inline const char *json_find_quote_or_backslash(const char *p,
+                                                const char *end) noexcept;
+
+/**
+ * @internal
+ * @brief The closing quote of the string whose contents start at p, skipping
+ * escaped characters, or nullptr if the string is unterminated.
+ */
+inline const char *json_string_end(const char *p, const char *end) noexcept;
+
+/**
+ * @internal
+ * @brief Parses the JSON number at the start of [p, end) into value. Returns
+ * the end of the number, or nullptr if there is no valid, in-range number
+ * there.
+ */
+inline const char *json_scan_number(const char *p, const char *end,
+                                    JsonNumber &value) noexcept;
+
+} // namespace detail
+
+/**
+ * Single-pass JSON parser working directly on the input, without copying or
+ * minifying it first. Containers are tracked with an explicit stack, so deep
+ * nesting does not recurse. Strings are kept as written, including escape
+ * sequences, which is what Json::dump() expects.
+ */
 class JsonParser {
 public:
   JsonParser(std::string_view json_str);
@@ -671,90 +802,46 @@ public:
   Json parse();
 
 private:
-  std::string minified;
-  std::size_t index = 0;
-
-  std::stack<std::reference_wrapper<Json>> stack;
+  const char *pos;
+  const char *end;
 
-public:
-  struct Start {
-    void handle(JsonParser &context);
-  };
-  struct ObjKey {
-    void handle(JsonParser &context);
-  };
-  struct ObjValStart {
-    void handle(JsonParser &context);
-  };
-  struct ObjValEnd {
-    void handle(JsonParser &context);
-  };
-  struct ArrValStart {
-    void handle(JsonParser &context);
-  };
-  struct ArrValEnd {
-    void handle(JsonParser &context);
-  };
+  /// Open arrays and objects, innermost last.
+  std::vector<Json *> stack;
 
-  using StateType = std::variant<Start, ObjKey, ObjValStart, ObjValEnd,
-                                 ArrValStart, ArrValEnd>;
+  void skip_whitespace() noexcept {
+    while (pos != end &&
+           (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) {
+      ++pos;
+    }
+  }
 
-  StateType state = Start{};
+  [[noreturn]] void fail(const char *what) const;
 
   /**
-   * Seeks ahead from start_index to find a matching end quote character (that
-   * hasn't been escaped). If the end quote character is found, the string
-   * between start_index and the end quote character is returned. If the end
-   * quote character is not found, an exception is thrown.
+   * Parses the value at pos into json. If it is a non-empty array or object,
+   * the container is pushed on the stack and the slot for its first element
+   * is returned; otherwise returns nullptr.
    */
-  std::string gather_string(std::size_t start_index);
-
-  std::size_t handle_closing_parenthesis();
-  std::size_t handle_scalar();
+  Json *begin_value(Json &json);
 
-  template <typename State>
-  void handle(char input) {
-    std::get<State>(state).handle(*this, input);
-  }
-
-  template <typename State>
-  void go_to() {
-    state.emplace<State>();
-  }
-
-  template <typename State>
-  bool is_current_state() {
-    return std::holds_alternative<State>(state);
-  }
+  /**
+   * After a complete value, consumes any closing brackets and the next comma.
+   * Returns the slot for the next element, or nullptr once the top-level
+   * value is complete.
+   */
+  Json *next_slot();
 
-  template <typename T, typename... Args>
-  void emplace_top(Args &&...args) {
-    stack.top().get().value_.emplace<T>(std::forward<Args>(args)...);
-  }
+  /**
+   * Reads `"key":` and returns the slot for its value in object.
+   */
+  Json *object_slot(Json &object);
 
-  Json &top() { return stack.top().get(); }
-  const Json &top() const { return stack.top().get(); }
+  /**
+   * Reads the string starting at the quote at pos, without the quotes.
+   */
+  std::string_view scan_string();
 
-  std::string get_state_string() {
-    return std::visit(
-        [](auto &&arg) {
-          using T = std::decay_t<decltype(arg)>;
-          if (std::is_same_v<Start, T>) {
-            return "Start";
-          } else if (std::is_same_v<ObjKey, T>) {
-            return "ObjKey";
-          } else if (std::is_same_v<ObjValStart, T>) {
-            return "ObjValStart";
-          } else if (std::is_same_v<ObjValEnd, T>) {
-            return "ObjValEnd";
-          } else if (std::is_same_v<ArrValStart, T>) {
-            return "ArrValStart";
-          } else if (std::is_same_v<ArrValEnd, T>) {
-            return "ArrValEnd";
-          }
-        },
-        state);
-  }
+  JsonNumber scan_number();
 };
 
 // ===============================
@@ -787,18 +874,31 @@ inline Json parse(std::string_view json_str) {
 }
 
 inline Json parse_file(const std::string &filename) {
-  std::ifstream infile(filename);
+  // Pipes and procfs files report a size of 0, and character devices cannot
+  // be mapped at all.
+  std::error_code ec;
+  if (std::filesystem::is_regular_file(filename, ec) &&
+      std::filesystem::file_size(filename, ec) > 0 && !ec) {
+    std::optional<MappedFile> file;
+    try {
+      file.emplace(filename);
+    } catch (const std::runtime_error &) {
+    }
+    if (file) {
+      return parse(file->view());
+    }
+  }
 
-  if (!infile.is_open()) {
+  std::ifstream f(filename, std::ios_base::binary);
+  if (!f) {
     throw std::runtime_error("Could not open file");
   }
-
-  std::stringstream buffer;
-  buffer << infile.rdbuf();
-
-  infile.close();
-
-  return parse(buffer.str());
+  std::string contents{std::istreambuf_iterator<char>(f),
+                       std::istreambuf_iterator<char>()};
+  if (f.bad()) {
+    throw std::runtime_error("Could not read file");
+  }
+  return parse(contents);
 }
 
 inline std::string prettify(std::string_view json_str) {
@@ -875,355 +975,687 @@ inline std::string minify(std::string_view json_str) {
   return minified;
 }
 
-inline std::string Json::dump() const {
-  std::stringstream ss;
-  dump(ss);
-  return ss.str();
+namespace detail {
+
+/**
+ * @internal
+ * @brief Json serialization sink appending to a std::string.
+ */
+struct JsonStringSink {
+  std::string &out;
+
+  void write(const char *p, std::size_t n) { out.append(p, n); }
+  void put(char c) { out.push_back(c); }
+};
+
+/**
+ * @internal
+ * @brief Json serialization sink writing to a std::ostream through a
+ * fixed-size buffer. Call flush() when done.
+ */
+struct JsonStreamSink {
+  std::ostream &os;
+  char buffer[1 << 14];
+  std::size_t used = 0;
+
+  void flush() {
+    os.write(buffer, static_cast<std::streamsize>(used));
+    used = 0;
+  }
+  void write(const char *p, std::size_t n) {
+    if (used + n > sizeof(buffer)) {
+      flush();
+      if (n > sizeof(buffer)) {
+        os.write(p, static_cast<std::streamsize>(n));
+        return;
+      }
+    }
+    std::memcpy(buffer + used, p, n);
+    used += n;
+  }
+  void put(char c) {
+    if (used == sizeof(buffer)) {
+      flush();
+    }
+    buffer[used++] = c;
+  }
+};
+
+/**
+ * @internal
+ * @brief Json serialization sink filling a fixed buffer and counting the
+ * total length, including what did not fit.
+ */
+struct JsonBufferSink {
+  char *buffer;
+  std::size_t size;
+  std::size_t length = 0;
+
+  void write(const char *p, std::size_t n) {
+    if (length < size) {
+      std::memcpy(buffer + length, p, std::min(n, size - length));
+    }
+    length += n;
+  }
+  void put(char c) {
+    if (length < size) {
+      buffer[length] = c;
+    }
+    ++length;
+  }
+};
+
+template <typename Sink>
+void write_json_number(Sink &sink, JsonNumber x) {
+  if (!std::isfinite(x)) {
+    sink.write("null", 4);
+    return;
+  }
+  char buf[32];
+  auto result = std::to_chars(buf, buf + sizeof(buf), x);
+  sink.write(buf, static_cast<std::size_t>(result.ptr - buf));
 }
 
-inline std::string Json::pretty_dump(std::size_t tab_size) const {
-  std::stringstream ss;
-  pretty_dump(ss, tab_size);
-  return ss.str();
+/**
+ * @internal
+ * @brief Length of the valid escape sequence following a backslash at
+ * s[i - 1]: 1, or 5 for \uXXXX, or 0 if the backslash starts none.
+ */
+inline std::size_t json_escape_length(std::string_view s,
+                                      std::size_t i) noexcept {
+  if (i >= s.size()) {
+    return 0;
+  }
+  switch (s[i]) {
+  case '"':
+  case '\\':
+  case '/':
+  case 'b':
+  case 'f':
+  case 'n':
+  case 'r':
+  case 't':
+    return 1;
+  case 'u':
+    if (s.size() - i < 5) {
+      return 0;
+    }
+    for (std::size_t k = i + 1; k < i + 5; ++k) {
+      if (!std::isxdigit(static_cast<unsigned char>(s[k]))) {
+        return 0;
+      }
+    }
+    return 5;
+  default:
+    return 0;
+  }
 }
 
-inline std::stringstream &Json::dump(std::stringstream &ss) const {
-  return std::visit(
-      [&ss](auto &&arg) -> std::stringstream & {
-        using T = std::decay_t<decltype(arg)>;
+template <typename Sink>
+void write_json_string(Sink &sink, std::string_view s) {
+  auto is_plain = [](char c) {
+    return static_cast<unsigned char>(c) >= 0x20 && c != '"' && c != '\\';
+  };
 
-        if constexpr (std::is_same_v<T, JsonNull>) {
-          ss << "null";
-        } else if constexpr (std::is_same_v<T, JsonBool>) {
-          ss << std::boolalpha << arg;
-        } else if constexpr (std::is_same_v<T, JsonNumber>) {
-          ss << std::setprecision(std::numeric_limits<JsonNumber>::max_digits10)
-             << arg;
-        } else if constexpr (std::is_same_v<T, JsonString>) {
-          ss << "\"" << arg << "\"";
-        } else if constexpr (std::is_same_v<T, JsonArray>) {
-          ss << '[';
-          std::size_t index = 0;
-          for (const auto &el : arg) {
-            el.dump(ss);
-            if (index + 1 < arg.size()) {
-              ss << ',';
-            }
-            ++index;
-          }
-          ss << ']';
-        } else if constexpr (std::is_same_v<T, JsonObject>) {
-          ss << '{';
-          std::size_t index = 0;
-          for (const auto &[key, val] : arg) {
-            ss << "\"" << key << "\":" << val.dump();
-            if (index + 1 < arg.size()) {
-              ss << ',';
-            }
-            ++index;
-          }
-          ss << '}';
-        } else {
-          throw std::runtime_error("Invalid type");
-        }
-        return ss;
-      },
-      value_);
+  sink.put('"');
+  std::size_t i = 0;
+  while (i < s.size()) {
+    // Copy the longest run of characters that need no escaping at once.
+    std::size_t run = i;
+    while (run < s.size() && is_plain(s[run])) {
+      ++run;
+    }
+    sink.write(s.data() + i, run - i);
+    if (run == s.size()) {
+      break;
+    }
+
+    char c = s[run];
+    i = run + 1;
+    if (c == '\\') {
+      std::size_t len = json_escape_length(s, i);
+      if (len > 0) { // a valid escape sequence, kept as it is
+        sink.put('\\');
+        sink.write(s.data() + i, len);
+        i += len;
+      } else {
+        sink.write("\\\\", 2);
+      }
+    } else if (c == '"') {
+      sink.write("\\\"", 2);
+    } else {
+      switch (c) {
+      case '\n':
+        sink.write("\\n", 2);
+        break;
+      case '\t':
+        sink.write("\\t", 2);
+        break;
+      case '\r':
+        sink.write("\\r", 2);
+        break;
+      case '\b':
+        sink.write("\\b", 2);
+        break;
+      case '\f':
+        sink.write("\\f", 2);
+        break;
+      default: {
+        constexpr char hex[] = "0123456789abcdef";
+        char esc[6] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0xf], hex[c & 0xf]};
+        sink.write(esc, 6);
+      }
+      }
+    }
+  }
+  sink.put('"');
 }
 
-inline std::stringstream &Json::pretty_dump(std::stringstream &ss,
-                                            std::size_t tab_size,
-                                            std::size_t current_offset) const {
-  return std::visit(
-      [&ss, tab_size, current_offset](auto &&arg) -> std::stringstream & {
+template <typename Sink>
+void write_indent(Sink &sink, std::size_t n) {
+  static constexpr char spaces[] = "                                ";
+  while (n > 0) {
+    std::size_t k = std::min(n, sizeof(spaces) - 1);
+    sink.write(spaces, k);
+    n -= k;
+  }
+}
+
+/**
+ * @internal
+ * @brief Serializes json to sink. pretty selects the pretty_dump layout.
+ */
+template <typename Sink>
+void write_json(Sink &sink, const Json &json, bool pretty,
+                std::size_t tab_size, std::size_t offset) {
+  std::visit(
+      [&](const auto &arg) {
         using T = std::decay_t<decltype(arg)>;
 
         if constexpr (std::is_same_v<T, JsonNull>) {
-          ss << "null";
+          sink.write("null", 4);
         } else if constexpr (std::is_same_v<T, JsonBool>) {
-          ss << std::boolalpha << arg;
+          arg ? sink.write("true", 4) : sink.write("false", 5);
         } else if constexpr (std::is_same_v<T, JsonNumber>) {
-          ss << std::setprecision(std::numeric_limits<JsonNumber>::max_digits10)
-             << arg;
+          write_json_number(sink, arg);
         } else if constexpr (std::is_same_v<T, JsonString>) {
-          ss << "\"" << arg << "\"";
-        } else if constexpr (std::is_same_v<T, JsonArray>) {
-          ss << "[\n";
+          write_json_string(sink, arg);
+        } else {
+          constexpr bool is_object = std::is_same_v<T, JsonObject>;
+          sink.put(is_object ? '{' : '[');
+          if (pretty) {
+            sink.put('\n');
+          }
           std::size_t index = 0;
           for (const auto &el : arg) {
-            ss << std::string(current_offset + tab_size, ' ');
-            el.pretty_dump(ss, tab_size, current_offset + tab_size);
-
-            if (index + 1 < arg.size()) {
-              ss << ',';
+            if (index++ > 0) {
+              pretty ? sink.write(",\n", 2) : sink.put(',');
             }
-            if (index < arg.size()) {
-              ss << '\n';
+            if (pretty) {
+              write_indent(sink, offset + tab_size);
             }
-            index++;
-          }
-          ss << std::string(current_offset, ' ') << ']';
-        } else if constexpr (std::is_same_v<T, JsonObject>) {
-          ss << "{\n";
-          std::size_t index = 0;
-          for (const auto &[key, val] : arg) {
-            ss << std::string(current_offset + tab_size, ' ') << "\"" << key
-               << "\": ";
-
-            val.pretty_dump(ss, tab_size, current_offset + tab_size);
-            if (index + 1 < arg.size()) {
-              ss << ',';
+            if constexpr (is_object) {
+              write_json_string(sink, el.first);
+              pretty ? sink.write(": ", 2) : sink.put(':');
+              write_json(sink, el.second, pretty, tab_size, offset + tab_size);
+            } else {
+              write_json(sink, el, pretty, tab_size, offset + tab_size);
             }
-            if (index < arg.size()) {
-              ss << '\n';
+          }
+          if (pretty) {
+            if (index > 0) {
+              sink.put('\n');
             }
-            index++;
+            write_indent(sink, offset);
           }
-          ss << std::string(current_offset, ' ') << '}';
-        } else {
-          throw std::runtime_error("Invalid type");
+          sink.put(is_object ? '}' : ']');
         }
-        return ss;
       },
-      value_);
+      json.value());
 }
 
-// ===== JSON Parsing =====
+} // namespace detail
 
-inline void JsonParser::Start::handle(JsonParser &p) {
+inline std::string Json::dump() const {
+  std::string out;
+  dump_to(out);
+  return out;
+}
 
-  char c = p.minified[p.index];
+inline std::string Json::pretty_dump(std::size_t tab_size) const {
+  std::string out;
+  detail::JsonStringSink sink{out};
+  detail::write_json(sink, *this, true, tab_size, 0);
+  return out;
+}
 
-  if (c == '{') {
-    p.index += 1;
-    p.state.emplace<JsonParser::ObjKey>();
+inline void Json::dump(std::ostream &os) const {
+  auto sink = std::make_unique<detail::JsonStreamSink>(os);
+  detail::write_json(*sink, *this, false, 0, 0);
+  sink->flush();
+}
 
-  } else if (c == '[') {
+inline void Json::pretty_dump(std::ostream &os, std::size_t tab_size) const {
+  auto sink = std::make_unique<detail::JsonStreamSink>(os);
+  detail::write_json(*sink, *this, true, tab_size, 0);
+  sink->flush();
+}
 
-    p.emplace_top<JsonArray>();
-    p.index += 1;
-    p.state.emplace<JsonParser::ArrValStart>();
+inline void Json::dump_to(std::string &out) const {
+  detail::JsonStringSink sink{out};
+  detail::write_json(sink, *this, false, 0, 0);
+}
 
-  } else {
+inline std::size_t Json::dump_to(char *buffer, std::size_t size) const {
+  detail::JsonBufferSink sink{buffer, size};
+  detail::write_json(sink, *this, false, 0, 0);
+  return sink.length;
+}
 
-    p.index += p.handle_scalar();
+// ===== Appending =====
 
-    if (p.index != p.minified.size()) {
-      throw std::runtime_error("Invalid JSON");
-    }
+inline JsonArrayAppender::JsonArrayAppender(const std::string &filename,
+                                            bool check_head) {
+  if (!std::filesystem::exists(filename)) {
+    std::ofstream(filename, std::ios_base::binary);
+  }
+  file_.open(filename,
+             std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+  if (!file_.is_open()) {
+    throw std::runtime_error("Could not open file");
   }
-}
-
-inline void JsonParser::ObjKey::handle(JsonParser &p) {
 
-  char c = p.minified[p.index];
+  auto is_space = [](char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+  };
 
-  if (c == '}') {
+  // Reads backwards from offset until a non-whitespace character, returning
+  // its offset, or -1 if there is none.
+  auto last_non_space = [&](std::streamoff offset) -> std::streamoff {
+    char block[256];
+    while (offset > 0) {
+      std::streamoff n = std::min<std::streamoff>(offset, sizeof(block));
+      offset -= n;
+      file_.seekg(offset);
+      file_.read(block, n);
+      for (std::streamoff i = n; i-- > 0;) {
+        if (!is_space(block[i])) {
+          return offset + i;
+        }
+      }
+    }
+    return -1;
+  };
 
-    p.index += p.handle_closing_parenthesis();
+  file_.seekg(0, std::ios_base::end);
+  std::streamoff last = last_non_space(file_.tellg());
 
-  } else {
+  if (last < 0) { // empty or only whitespace
+    file_.clear();
+    file_.seekp(0);
+    file_ << "[]";
+    tail_ = 1;
+    empty_ = true;
+    return;
+  }
 
-    std::string key = p.gather_string(p.index);
-    p.stack.push(p.stack.top().get()[key]);
+  file_.seekg(last);
+  if (file_.get() != ']') {
+    throw std::runtime_error(
+        "Cannot append to file. Either file must be "
+        "empty, non-existent, or top-level element must be an array.");
+  }
+  tail_ = last;
 
-    p.index += key.size(); // the actual key size
-    p.index += 2;          // start and end quotes
+  std::streamoff before = last_non_space(last);
+  file_.seekg(std::max<std::streamoff>(before, 0));
+  empty_ = before >= 0 && file_.get() == '[';
 
-    if (p.minified[p.index] != ':') {
+  if (check_head) {
+    file_.seekg(0);
+    char c = 0;
+    while (file_.get(c) && is_space(c)) {
+    }
+    if (c != '[') {
       throw std::runtime_error(
-          "Invalid JSON - Key string must be followed by colon");
+          "Cannot append to file. Either file must be "
+          "empty, non-existent, or top-level element must be an array.");
     }
-    p.index += 1; // colon
-    p.state.emplace<JsonParser::ObjValStart>();
   }
+  file_.clear();
 }
 
-inline void JsonParser::ObjValStart::handle(JsonParser &p) {
+inline void JsonArrayAppender::append(const Json &json) {
+  std::string s = json.dump();
 
-  char c = p.minified[p.index];
-
-  if (c == '{') {
-    p.index += 1;
-    p.state.emplace<JsonParser::ObjKey>();
-  } else if (c == '[') {
-    p.index += 1;
-    p.emplace_top<JsonArray>();
-    p.state.emplace<JsonParser::ArrValStart>();
-  } else {
-    p.index += p.handle_scalar();
-    p.stack.pop();
-    p.state.emplace<JsonParser::ObjValEnd>();
+  file_.seekp(tail_);
+  if (!empty_) {
+    file_.put(',');
+    ++tail_;
   }
-}
-
-inline void JsonParser::ObjValEnd::handle(JsonParser &p) {
-
-  char c = p.minified[p.index];
-
-  if (c == '}') {
-    p.index += p.handle_closing_parenthesis();
-  } else if (c == ',') {
-    p.index += 1;
-    p.state.emplace<JsonParser::ObjKey>();
-  } else {
-    throw std::runtime_error("Invalid JSON");
+  file_.write(s.data(), static_cast<std::streamsize>(s.size()));
+  file_.put(']');
+  if (!file_) {
+    throw std::runtime_error("Could not append to file");
   }
+
+  tail_ += static_cast<std::streamoff>(s.size());
+  empty_ = false;
 }
 
-inline void JsonParser::ArrValStart::handle(JsonParser &p) {
-
-  char c = p.minified[p.index];
-
-  if (c == '[') {
-    p.top().emplace_back(JsonArray{});
-    p.stack.push(p.top().back());
-    p.index += 1;
-    p.state.emplace<JsonParser::ArrValStart>();
-  } else if (c == '{') {
-    p.top().emplace_back(JsonObject{});
-    p.stack.push(p.top().back());
-    p.index += 1;
-    p.state.emplace<JsonParser::ObjKey>();
-  } else if (c == ']') {
-    p.index += p.handle_closing_parenthesis();
-  } else {
-    p.top().emplace_back(JsonObject{});
-    p.stack.push(p.top().back());
-    p.index += p.handle_scalar();
-    p.stack.pop();
-    p.state.emplace<JsonParser::ArrValEnd>();
+inline JsonLinesAppender::JsonLinesAppender(const std::string &filename)
+    : file_(filename, std::ios_base::binary | std::ios_base::app) {
+  if (!file_.is_open()) {
+    throw std::runtime_error("Could not open file");
   }
 }
 
-inline void JsonParser::ArrValEnd::handle(JsonParser &p) {
-  char c = p.minified[p.index];
-
-  if (c == ',') {
-    p.index += 1;
-    p.state.emplace<JsonParser::ArrValStart>();
-  } else if (c == ']') {
-    p.index += p.handle_closing_parenthesis();
+inline void JsonLinesAppender::append(const Json &json) {
+  file_ << json.dump() << '\n';
+  if (!file_) {
+    throw std::runtime_error("Could not append to file");
   }
 }
 
-inline std::size_t JsonParser::handle_closing_parenthesis() {
-
-  bool is_str_end = (index + 1 == minified.size());
+inline void Json::unsafe_append_to_file(const std::string &filename) const {
+  JsonArrayAppender(filename, false).append(*this);
+}
 
-  if (is_str_end) {
+inline void Json::append_to_file(const std::string &filename) const {
+  JsonArrayAppender(filename).append(*this);
+}
 
-    bool is_matching_paren =
-        (stack.top().get().is_array() && minified[index] == ']') ||
-        (stack.top().get().is_object() && minified[index] == '}');
+inline void Json::append_line_to_file(const std::string &filename) const {
+  JsonLinesAppender(filename).append(*this);
+}
 
-    if (!is_matching_paren) {
-      throw std::runtime_error("Invalid JSON - Incorrect parenthesis match.");
-    } else if (stack.size() > 1) {
+// ===== JSON Parsing =====
 
-      throw std::runtime_error("Invalid JSON - Not enough closing  parens");
-    } else if (stack.size() < 1) {
-      throw std::runtime_error("Invalid JSON - Too many closing parens");
+namespace detail {
+
+inline std::uint64_t json_quote_or_backslash_mask(const char *p) noexcept {
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  std::uint64_t mask = 0;
+  for (int i = 0; i < 4; ++i) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * i));
+    __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                _mm_cmpeq_epi8(chunk, backslash));
+    mask |= static_cast<std::uint64_t>(
+                static_cast<std::uint16_t>(_mm_movemask_epi8(hits)))
+            << (16 * i);
+  }
+  return mask;
+#else
+  // A byte of x ^ (c * ones) is zero where x has c; the classic "has zero
+  // byte" trick then sets its high bit.
+  constexpr std::uint64_t ones = 0x0101010101010101ULL;
+  constexpr std::uint64_t highs = 0x8080808080808080ULL;
+  auto zero_bytes = [](std::uint64_t x) {
+    return ~(((x & ~highs) + ~highs) | x) & highs;
+  };
+  std::uint64_t mask = 0;
+  if constexpr (std::endian::native != std::endian::little) {
+    for (int i = 0; i < 64; ++i) {
+      mask |= std::uint64_t{p[i] == '"' || p[i] == '\\'} << i;
     }
+    return mask;
+  }
+  for (int i = 0; i < 8; ++i) {
+    std::uint64_t word;
+    std::memcpy(&word, p + 8 * i, 8);
+    std::uint64_t hits =
+        zero_bytes(word ^ ('"' * ones)) | zero_bytes(word ^ ('\\' * ones));
+    // Gather the high bit of each byte into the low 8 bits.
+    mask |= (((hits >> 7) * 0x0102040810204080ULL) >> 56) << (8 * i);
+  }
+  return mask;
+#endif
+}
 
-  } else {
-    stack.pop();
-
-    if (top().is_array()) {
-      go_to<JsonParser::ArrValEnd>();
-    } else if (top().is_object()) {
-      go_to<JsonParser::ObjValEnd>();
-    } else {
-      throw std::runtime_error("Invalid JSON");
+inline const char *json_find_quote_or_backslash(const char *p,
+                                                const char *end) noexcept {
+  while (end - p >= 64) {
+    if (std::uint64_t mask = json_quote_or_backslash_mask(p)) {
+      return p + std::countr_zero(mask);
     }
+    p += 64;
+  }
+  while (p != end && *p != '"' && *p != '\\') {
+    ++p;
   }
-  return 1;
+  return p;
 }
 
-std::string JsonParser::gather_string(std::size_t index) {
-  std::size_t end = index + 1;
-  while (end < minified.size() && minified[end] != '"') {
-    if (minified[end] == '\\') {
-      ++end;
+inline const char *json_string_end(const char *p, const char *end) noexcept {
+  for (;;) {
+    p = json_find_quote_or_backslash(p, end);
+    if (p == end) {
+      return nullptr;
+    }
+    if (*p == '"') {
+      return p;
+    }
+    if (end - p < 2) {
+      return nullptr;
     }
-    ++end;
+    p += 2; // skip the escaped character
   }
+}
 
-  if (end == minified.size()) {
-    throw std::runtime_error("Invalid JSON - Unterminated string.");
+inline const char *json_scan_number(const char *p, const char *end,
+                                    JsonNumber &value) noexcept {
+  // Check the JSON number grammar, which std::from_chars is laxer about
+  // (it accepts e.g. "inf" and leading zeros):
+  // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+  auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+  auto digits = [&](const char *q) {
+    while (q != end && is_digit(*q)) {
+      ++q;
+    }
+    return q;
+  };
+
+  const char *begin = p;
+  if (p != end && *p == '-') {
+    ++p;
+  }
+  if (p == end || !is_digit(*p)) {
+    return nullptr;
+  }
+  p = (*p == '0') ? p + 1 : digits(p);
+  if (p != end && *p == '.') {
+    if (++p == end || !is_digit(*p)) {
+      return nullptr;
+    }
+    p = digits(p);
+  }
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    if (p != end && (*p == '+' || *p == '-')) {
+      ++p;
+    }
+    if (p == end || !is_digit(*p)) {
+      return nullptr;
+    }
+    p = digits(p);
   }
 
-  return std::string(minified.begin() + index + 1, minified.begin() + end);
+  auto [ptr, ec] = std::from_chars(begin, p, value);
+  if (ec != std::errc{} || ptr != p) {
+    return nullptr;
+  }
+  return p;
 }
 
-inline std::size_t JsonParser::handle_scalar() {
+} // namespace detail
 
-  char c = minified[index];
-
-  if (c == '"') {
-
-    // STRING
+inline JsonParser::JsonParser(std::string_view json_str)
+    : pos{json_str.data()}, end{json_str.data() + json_str.size()} {}
 
-    std::string s = gather_string(index);
-    stack.top().get().value_ = JsonString{s};
-    return s.size() + 2;
+inline void JsonParser::fail(const char *what) const {
+  throw std::runtime_error(std::string("Invalid JSON - ") + what);
+}
 
-  } else if (minified.substr(index, 4) == "null") {
+inline Json JsonParser::parse() {
 
-    emplace_top<JsonNull>();
-    return 4;
+  Json json;
+  const char *start = pos;
 
-  } else if (minified.substr(index, 4) == "true") {
+  skip_whitespace();
+  if (pos == end) {
+    return json; // empty input parses as an empty object
+  }
 
-    emplace_top<JsonBool>(true);
-    return 4;
+  Json *slot = &json;
+  while (slot) {
+    Json *child = begin_value(*slot);
+    slot = child ? child : next_slot();
+  }
 
-  } else if (minified.substr(index, 5) == "false") {
+  skip_whitespace();
+  if (pos != end) {
+    fail("Unexpected characters after the top-level value.");
+  }
 
-    emplace_top<JsonBool>(false);
-    return 5;
+  UTILS_CPP_STATS_ADD(json_bytes_parsed, pos - start);
+  return json;
+}
 
-  } else {
+inline Json *JsonParser::begin_value(Json &json) {
 
-    std::size_t i = index;
-    while (i < minified.size() && minified[i] != ',' && minified[i] != '}' &&
-           minified[i] != ']') {
-      ++i;
+  skip_whitespace();
+  if (pos == end) {
+    fail("Missing value.");
+  }
+  UTILS_CPP_STATS_ADD(json_values, 1);
+
+  switch (*pos) {
+  case '{':
+    ++pos;
+    json.value_.emplace<JsonObject>();
+    skip_whitespace();
+    if (pos != end && *pos == '}') {
+      ++pos;
+      return nullptr;
+    }
+    stack.push_back(&json);
+    return object_slot(json);
+
+  case '[':
+    ++pos;
+    json.value_.emplace<JsonArray>();
+    skip_whitespace();
+    if (pos != end && *pos == ']') {
+      ++pos;
+      return nullptr;
     }
-    std::string s = minified.substr(index, i - index);
+    stack.push_back(&json);
+    UTILS_CPP_STATS_ADD(json_allocations, 1);
+    return &std::get<JsonArray>(json.value_).emplace_back();
+
+  case '"': {
+    auto &str = json.value_.emplace<JsonString>(scan_string());
+    UTILS_CPP_STATS_ADD(json_allocations,
+                        str.size() > JsonString().capacity() ? 1 : 0);
+    return nullptr;
+  }
 
-    if (convertible_to_double(s)) {
-      emplace_top<JsonNumber>(std::stold(s));
-      return i - index;
+  case 't':
+  case 'f':
+  case 'n': {
+    std::string_view rest(pos, static_cast<std::size_t>(end - pos));
+    if (rest.starts_with("true")) {
+      json.value_.emplace<JsonBool>(true);
+      pos += 4;
+    } else if (rest.starts_with("false")) {
+      json.value_.emplace<JsonBool>(false);
+      pos += 5;
+    } else if (rest.starts_with("null")) {
+      json.value_.emplace<JsonNull>();
+      pos += 4;
     } else {
-      throw std::runtime_error("Invalid scalar");
+      fail("Invalid scalar.");
     }
+    return nullptr;
+  }
+
+  default:
+    json.value_.emplace<JsonNumber>(scan_number());
+    return nullptr;
   }
 }
 
-inline JsonParser::JsonParser(std::string_view json_str)
-    : minified{minify(json_str)} {}
+inline Json *JsonParser::next_slot() {
 
-inline Json JsonParser::parse() {
+  while (!stack.empty()) {
+    skip_whitespace();
+    if (pos == end) {
+      fail("Missing closing braces or brackets.");
+    }
 
-  Json json;
+    Json &container = *stack.back();
+    char c = *pos++;
+
+    if (c == ',') {
+      if (container.is_object()) {
+        return object_slot(container);
+      }
+      auto &array = std::get<JsonArray>(container.value_);
+      UTILS_CPP_STATS_ADD(json_allocations,
+                          array.size() == array.capacity() ? 1 : 0);
+      return &array.emplace_back();
+    } else if ((c == '}' && container.is_object()) ||
+               (c == ']' && container.is_array())) {
+      stack.pop_back();
+    } else {
+      fail("Expected a comma or a matching closing bracket.");
+    }
+  }
+  return nullptr;
+}
 
-  stack.push(json);
+inline Json *JsonParser::object_slot(Json &object) {
 
-  while (index < minified.size()) {
-    std::visit([this](auto &&state) { state.handle(*this); }, state);
+  skip_whitespace();
+  if (pos == end || *pos != '"') {
+    fail("Object keys must be strings.");
   }
+  std::string_view key = scan_string();
 
-  if (stack.size() > 1) {
-    throw std::runtime_error(
-        "Invalid JSON - Missing closing braces or brackets.");
+  skip_whitespace();
+  if (pos == end || *pos != ':') {
+    fail("Key string must be followed by colon");
+  }
+  ++pos;
+
+  // A repeated key keeps the last value, as before.
+  auto &obj = std::get<JsonObject>(object.value_);
+  auto it = obj.try_emplace(std::string(key)).first;
+  UTILS_CPP_STATS_ADD(json_allocations,
+                      1 + (key.size() > JsonString().capacity() ? 1 : 0));
+  return &it->second;
+}
 
-  } else if (stack.size() < 1) {
-    throw std::runtime_error(
-        "Invalid JSON - Too many closing braces or brackets.");
+inline std::string_view JsonParser::scan_string() {
+  const char *begin = pos + 1;
+  const char *close = detail::json_string_end(begin, end);
+  if (!close) {
+    fail("Unterminated string.");
   }
+  pos = close + 1;
+  return {begin, static_cast<std::size_t>(close - begin)};
+}
 
-  return json;
+inline JsonNumber JsonParser::scan_number() {
+  JsonNumber value{};
+  pos = detail::json_scan_number(pos, end, value);
+  if (!pos) {
+    fail("Invalid number.");
+  }
+  return value;
 }
 
 } // namespace utils
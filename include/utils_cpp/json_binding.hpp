@@ -0,0 +1,656 @@
+/**********************************************************************
+ * @brief Direct struct <-> JSON text binding, without building a Json.
+ * @details A struct is made bindable by listing its fields once, with
+ *UTILS_JSON_FIELDS(Type, field...) at namespace scope (or by hand-writing the
+ *utils_json_fields function that macro defines). to_json_string and
+ *from_json_string then serialize and parse it directly, with each field's
+ *encoder and decoder chosen at compile time. Unlike Json, which stores
+ *strings as written, bound strings are real (unescaped) strings: they are
+ *fully escaped on output and unescaped on input, so values round-trip.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "json.hpp"
+#include "metaprogramming/is_instantiation.hpp"
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace utils {
+
+/**
+ * One bound field: its JSON key and a pointer to the member.
+ */
+template <typename T, typename M>
+struct JsonField {
+  std::string_view name;
+  M T::*member;
+};
+
+template <typename T, typename M>
+constexpr JsonField<T, M> json_field(std::string_view name, M T::*member) {
+  return {name, member};
+}
+
+/**
+ * Types with a utils_json_fields(const T*) function, found by argument
+ * dependent lookup, returning a tuple of JsonFields.
+ */
+template <typename T>
+concept JsonBindable = requires(const T *p) { utils_json_fields(p); };
+
+/**
+ * Serializes value (a bound struct, or a number, bool, string, Json, or a
+ * vector, array, map with string keys, optional, pair or tuple of those).
+ */
+template <typename T>
+std::string to_json_string(const T &value);
+
+/**
+ * Appends the serialization of value to out.
+ */
+template <typename T>
+void append_json(std::string &out, const T &value);
+
+/**
+ * Writes the serialization of value to os through a fixed-size buffer.
+ */
+template <typename T>
+void write_json(std::ostream &os, const T &value);
+
+/**
+ * Parses json_str into value. Object keys without a matching field are
+ * skipped, and fields missing from the input keep their current value.
+ *
+ * @throws std::runtime_error on malformed JSON or a type mismatch.
+ */
+template <typename T>
+void from_json_string(std::string_view json_str, T &value);
+
+template <typename T>
+T from_json_string(std::string_view json_str) {
+  T value{};
+  from_json_string(json_str, value);
+  return value;
+}
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+namespace detail {
+
+template <typename T>
+constexpr bool is_std_array = false;
+template <typename T, std::size_t N>
+constexpr bool is_std_array<std::array<T, N>> = true;
+
+template <typename T>
+concept StringKeyedMap =
+    (is_instantiation<std::map, T>() ||
+     is_instantiation<std::unordered_map, T>()) &&
+    std::is_convertible_v<typename T::key_type, std::string_view>;
+
+template <typename Sink>
+void write_escaped_string(Sink &sink, std::string_view s) {
+  auto is_plain = [](char c) {
+    return static_cast<unsigned char>(c) >= 0x20 && c != '"' && c != '\\';
+  };
+
+  sink.put('"');
+  std::size_t i = 0;
+  while (i < s.size()) {
+    std::size_t run = i;
+    while (run < s.size() && is_plain(s[run])) {
+      ++run;
+    }
+    sink.write(s.data() + i, run - i);
+    if (run == s.size()) {
+      break;
+    }
+    char c = s[run];
+    i = run + 1;
+    switch (c) {
+    case '"':
+      sink.write("\\\"", 2);
+      break;
+    case '\\':
+      sink.write("\\\\", 2);
+      break;
+    case '\n':
+      sink.write("\\n", 2);
+      break;
+    case '\t':
+      sink.write("\\t", 2);
+      break;
+    case '\r':
+      sink.write("\\r", 2);
+      break;
+    case '\b':
+      sink.write("\\b", 2);
+      break;
+    case '\f':
+      sink.write("\\f", 2);
+      break;
+    default: {
+      constexpr char hex[] = "0123456789abcdef";
+      char esc[6] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0xf], hex[c & 0xf]};
+      sink.write(esc, 6);
+    }
+    }
+  }
+  sink.put('"');
+}
+
+template <typename Sink, typename T>
+void encode_json(Sink &sink, const T &value) {
+  if constexpr (JsonBindable<T>) {
+    sink.put('{');
+    bool first = true;
+    std::apply(
+        [&](const auto &...fields) {
+          ((sink.write(first ? "\"" : ",\"", first ? 1 : 2),
+            sink.write(fields.name.data(), fields.name.size()),
+            sink.write("\":", 2), encode_json(sink, value.*(fields.member)),
+            first = false),
+           ...);
+        },
+        utils_json_fields(static_cast<const T *>(nullptr)));
+    sink.put('}');
+
+  } else if constexpr (std::is_same_v<T, Json>) {
+    write_json(sink, value, false, 0, 0);
+
+  } else if constexpr (std::is_same_v<T, bool>) {
+    value ? sink.write("true", 4) : sink.write("false", 5);
+
+  } else if constexpr (std::is_enum_v<T>) {
+    encode_json(sink, static_cast<std::underlying_type_t<T>>(value));
+
+  } else if constexpr (std::is_integral_v<T>) {
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    sink.write(buf, static_cast<std::size_t>(result.ptr - buf));
+
+  } else if constexpr (std::is_floating_point_v<T>) {
+    write_json_number(sink, static_cast<JsonNumber>(value));
+
+  } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+    write_escaped_string(sink, std::string_view(value));
+
+  } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+    sink.write("null", 4);
+
+  } else if constexpr (is_instantiation<std::optional, T>()) {
+    if (value) {
+      encode_json(sink, *value);
+    } else {
+      sink.write("null", 4);
+    }
+
+  } else if constexpr (is_instantiation<std::pair, T>() ||
+                       is_instantiation<std::tuple, T>()) {
+    sink.put('[');
+    bool first = true;
+    std::apply(
+        [&](const auto &...elems) {
+          ((first ? void() : sink.put(','), encode_json(sink, elems),
+            first = false),
+           ...);
+        },
+        value);
+    sink.put(']');
+
+  } else if constexpr (StringKeyedMap<T>) {
+    sink.put('{');
+    bool first = true;
+    for (const auto &[k, v] : value) {
+      if (!first) {
+        sink.put(',');
+      }
+      first = false;
+      write_escaped_string(sink, std::string_view(k));
+      sink.put(':');
+      encode_json(sink, v);
+    }
+    sink.put('}');
+
+  } else if constexpr (is_instantiation<std::vector, T>() ||
+                       is_std_array<T>) {
+    sink.put('[');
+    bool first = true;
+    for (const auto &elem : value) {
+      if (!first) {
+        sink.put(',');
+      }
+      first = false;
+      encode_json(sink, static_cast<const typename T::value_type &>(elem));
+    }
+    sink.put(']');
+
+  } else {
+    static_assert(sizeof(T) == 0, "type cannot be serialized to JSON");
+  }
+}
+
+/**
+ * @internal
+ * @brief Reading position in JSON text for from_json_string.
+ */
+struct JsonCursor {
+  const char *pos;
+  const char *end;
+
+  [[noreturn]] void fail(const char *what) const {
+    throw std::runtime_error(std::string("Invalid JSON - ") + what);
+  }
+
+  char peek() {
+    while (pos != end &&
+           (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) {
+      ++pos;
+    }
+    if (pos == end) {
+      fail("Unexpected end of input.");
+    }
+    return *pos;
+  }
+
+  void expect(char c) {
+    if (peek() != c) {
+      fail("Unexpected character.");
+    }
+    ++pos;
+  }
+
+  bool consume(std::string_view literal) {
+    peek();
+    if (std::string_view(pos, static_cast<std::size_t>(end - pos))
+            .starts_with(literal)) {
+      pos += literal.size();
+      return true;
+    }
+    return false;
+  }
+
+  /// The raw contents of the string at pos, which is left past it.
+  std::string_view raw_string() {
+    expect('"');
+    const char *close = json_string_end(pos, end);
+    if (!close) {
+      fail("Unterminated string.");
+    }
+    std::string_view s(pos, static_cast<std::size_t>(close - pos));
+    pos = close + 1;
+    return s;
+  }
+
+  /// Skips over one value of any type.
+  void skip_value();
+};
+
+inline void JsonCursor::skip_value() {
+  std::size_t depth = 0;
+  do {
+    char c = peek();
+    if (c == '"') {
+      raw_string();
+    } else if (c == '{' || c == '[') {
+      ++pos;
+      ++depth;
+    } else if (c == '}' || c == ']') {
+      if (depth == 0) {
+        fail("Unexpected closing bracket.");
+      }
+      ++pos;
+      --depth;
+    } else if (c == ',' || c == ':') {
+      if (depth == 0) {
+        fail("Unexpected character.");
+      }
+      ++pos;
+    } else if (consume("true") || consume("false") || consume("null")) {
+    } else {
+      JsonNumber x;
+      pos = json_scan_number(pos, end, x);
+      if (!pos) {
+        fail("Invalid number.");
+      }
+    }
+  } while (depth > 0);
+}
+
+inline void append_utf8(std::string &out, std::uint32_t cp) {
+  if (cp < 0x80) {
+    out.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+  } else if (cp < 0x10000) {
+    out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+  } else {
+    out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+  }
+}
+
+/**
+ * @internal
+ * @brief Decodes the escape sequences of a raw JSON string into out.
+ */
+inline void unescape_json_string(std::string_view raw, std::string &out) {
+  out.clear();
+  out.reserve(raw.size());
+
+  auto hex4 = [&](std::size_t i) {
+    std::uint32_t cp = 0;
+    if (i + 4 > raw.size() ||
+        std::from_chars(raw.data() + i, raw.data() + i + 4, cp, 16).ptr !=
+            raw.data() + i + 4) {
+      throw std::runtime_error("Invalid JSON - Bad \\u escape.");
+    }
+    return cp;
+  };
+
+  std::size_t i = 0;
+  while (i < raw.size()) {
+    std::size_t next = raw.find('\\', i);
+    if (next == std::string_view::npos) {
+      out.append(raw.substr(i));
+      return;
+    }
+    out.append(raw.substr(i, next - i));
+
+    char c = raw[next + 1]; // a raw string never ends in a lone backslash
+    i = next + 2;
+    switch (c) {
+    case 'n':
+      out.push_back('\n');
+      break;
+    case 't':
+      out.push_back('\t');
+      break;
+    case 'r':
+      out.push_back('\r');
+      break;
+    case 'b':
+      out.push_back('\b');
+      break;
+    case 'f':
+      out.push_back('\f');
+      break;
+    case 'u': {
+      std::uint32_t cp = hex4(i);
+      i += 4;
+      if (cp >= 0xd800 && cp < 0xdc00 && i + 1 < raw.size() && raw[i] == '\\' &&
+          raw[i + 1] == 'u') { // surrogate pair
+        std::uint32_t low = hex4(i + 2);
+        if (low >= 0xdc00 && low < 0xe000) {
+          cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+          i += 6;
+        }
+      }
+      append_utf8(out, cp);
+      break;
+    }
+    default: // '"', '\\' and '/'
+      out.push_back(c);
+    }
+  }
+}
+
+template <typename T>
+void decode_json(JsonCursor &cur, T &value) {
+  if constexpr (JsonBindable<T>) {
+    cur.expect('{');
+    if (cur.peek() == '}') {
+      ++cur.pos;
+      return;
+    }
+    const auto fields = utils_json_fields(static_cast<const T *>(nullptr));
+    for (;;) {
+      std::string_view key = cur.raw_string();
+      cur.expect(':');
+      bool found = std::apply(
+          [&](const auto &...f) {
+            return ((f.name == key ? (decode_json(cur, value.*(f.member)), true)
+                                   : false) ||
+                    ...);
+          },
+          fields);
+      if (!found) {
+        cur.skip_value();
+      }
+      if (cur.peek() == ',') {
+        ++cur.pos;
+      } else {
+        cur.expect('}');
+        return;
+      }
+    }
+
+  } else if constexpr (std::is_same_v<T, Json>) {
+    const char *begin = (cur.peek(), cur.pos);
+    cur.skip_value();
+    value = parse(
+        std::string_view(begin, static_cast<std::size_t>(cur.pos - begin)));
+
+  } else if constexpr (std::is_same_v<T, bool>) {
+    if (cur.consume("true")) {
+      value = true;
+    } else if (cur.consume("false")) {
+      value = false;
+    } else {
+      cur.fail("Expected a bool.");
+    }
+
+  } else if constexpr (std::is_enum_v<T>) {
+    std::underlying_type_t<T> raw{};
+    decode_json(cur, raw);
+    value = static_cast<T>(raw);
+
+  } else if constexpr (std::is_arithmetic_v<T>) {
+    cur.peek();
+    JsonNumber x;
+    const char *number_end = json_scan_number(cur.pos, cur.end, x);
+    if (!number_end) {
+      cur.fail("Expected a number.");
+    }
+    if constexpr (std::is_integral_v<T>) {
+      // Read integers exactly; fall back to the double for e.g. "1e3". The
+      // range is checked before the cast, which is undefined outside it:
+      // T holds exactly the integers in [lo, hi).
+      auto [ptr, ec] = std::from_chars(cur.pos, number_end, value);
+      if (ec != std::errc{} || ptr != number_end) {
+        constexpr JsonNumber hi =
+            JsonNumber(std::numeric_limits<T>::max() / 2 + 1) * 2;
+        constexpr JsonNumber lo = std::is_signed_v<T> ? -hi : 0;
+        if (!(x >= lo && x < hi) || x != std::trunc(x)) {
+          cur.fail("Number does not fit the integer field.");
+        }
+        value = static_cast<T>(x);
+      }
+    } else {
+      if (std::isfinite(x) && std::abs(x) > std::numeric_limits<T>::max()) {
+        cur.fail("Number does not fit the floating-point field.");
+      }
+      value = static_cast<T>(x);
+    }
+    cur.pos = number_end;
+
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    unescape_json_string(cur.raw_string(), value);
+
+  } else if constexpr (is_instantiation<std::optional, T>()) {
+    if (cur.consume("null")) {
+      value.reset();
+    } else {
+      decode_json(cur, value.emplace());
+    }
+
+  } else if constexpr (is_instantiation<std::pair, T>() ||
+                       is_instantiation<std::tuple, T>()) {
+    cur.expect('[');
+    bool first = true;
+    std::apply(
+        [&](auto &...elems) {
+          ((first ? void() : cur.expect(','), decode_json(cur, elems),
+            first = false),
+           ...);
+        },
+        value);
+    cur.expect(']');
+
+  } else if constexpr (StringKeyedMap<T>) {
+    value.clear();
+    cur.expect('{');
+    if (cur.peek() == '}') {
+      ++cur.pos;
+      return;
+    }
+    std::string key;
+    for (;;) {
+      unescape_json_string(cur.raw_string(), key);
+      cur.expect(':');
+      decode_json(cur, value[key]);
+      if (cur.peek() == ',') {
+        ++cur.pos;
+      } else {
+        cur.expect('}');
+        return;
+      }
+    }
+
+  } else if constexpr (is_instantiation<std::vector, T>() ||
+                       is_std_array<T>) {
+    cur.expect('[');
+    std::size_t n = 0;
+    if constexpr (!is_std_array<T>) {
+      value.clear();
+    }
+    if (cur.peek() == ']') {
+      ++cur.pos;
+    } else {
+      for (;;) {
+        if constexpr (is_std_array<T>) {
+          if (n == value.size()) {
+            cur.fail("Too many elements for the array.");
+          }
+          decode_json(cur, value[n]);
+        } else {
+          typename T::value_type elem{};
+          decode_json(cur, elem);
+          value.push_back(std::move(elem));
+        }
+        ++n;
+        if (cur.peek() == ',') {
+          ++cur.pos;
+        } else {
+          cur.expect(']');
+          break;
+        }
+      }
+    }
+    if constexpr (is_std_array<T>) {
+      if (n != value.size()) {
+        cur.fail("Too few elements for the array.");
+      }
+    }
+
+  } else {
+    static_assert(sizeof(T) == 0, "type cannot be parsed from JSON");
+  }
+}
+
+} // namespace detail
+
+template <typename T>
+std::string to_json_string(const T &value) {
+  std::string out;
+  append_json(out, value);
+  return out;
+}
+
+template <typename T>
+void append_json(std::string &out, const T &value) {
+  detail::JsonStringSink sink{out};
+  detail::encode_json(sink, value);
+}
+
+template <typename T>
+void write_json(std::ostream &os, const T &value) {
+  auto sink = std::make_unique<detail::JsonStreamSink>(os);
+  detail::encode_json(*sink, value);
+  sink->flush();
+}
+
+template <typename T>
+void from_json_string(std::string_view json_str, T &value) {
+  detail::JsonCursor cur{json_str.data(), json_str.data() + json_str.size()};
+  detail::decode_json(cur, value);
+
+  while (cur.pos != cur.end && (*cur.pos == ' ' || *cur.pos == '\n' ||
+                                *cur.pos == '\r' || *cur.pos == '\t')) {
+    ++cur.pos;
+  }
+  if (cur.pos != cur.end) {
+    cur.fail("Unexpected characters after the top-level value.");
+  }
+}
+
+} // namespace utils
+
+// ===== Field-list macro =====
+
+#define UTILS_JSON_PARENS ()
+#define UTILS_JSON_EXPAND(...)                                                 \
+  UTILS_JSON_EXPAND3(UTILS_JSON_EXPAND3(UTILS_JSON_EXPAND3(__VA_ARGS__)))
+#define UTILS_JSON_EXPAND3(...)                                                \
+  UTILS_JSON_EXPAND2(UTILS_JSON_EXPAND2(UTILS_JSON_EXPAND2(__VA_ARGS__)))
+#define UTILS_JSON_EXPAND2(...)                                                \
+  UTILS_JSON_EXPAND1(UTILS_JSON_EXPAND1(UTILS_JSON_EXPAND1(__VA_ARGS__)))
+#define UTILS_JSON_EXPAND1(...) __VA_ARGS__
+
+#define UTILS_JSON_FIELD_ENTRY(Type, field)                                    \
+  ::utils::json_field<Type>(#field, &Type::field)
+
+#define UTILS_JSON_FOR_EACH_FIELD(Type, ...)                                   \
+  __VA_OPT__(UTILS_JSON_EXPAND(UTILS_JSON_FOR_EACH_HELPER(Type, __VA_ARGS__)))
+#define UTILS_JSON_FOR_EACH_HELPER(Type, field, ...)                           \
+  UTILS_JSON_FIELD_ENTRY(Type, field)                                          \
+  __VA_OPT__(, UTILS_JSON_FOR_EACH_AGAIN UTILS_JSON_PARENS(Type, __VA_ARGS__))
+#define UTILS_JSON_FOR_EACH_AGAIN() UTILS_JSON_FOR_EACH_HELPER
+
+/**
+ * Makes the public fields of Type bindable, with their names as keys. Use at
+ * namespace scope, in the namespace of Type, e.g.
+ * UTILS_JSON_FIELDS(Point, x, y)
+ * (up to 27 fields).
+ */
+#define UTILS_JSON_FIELDS(Type, ...)                                           \
+  [[maybe_unused]] inline constexpr auto utils_json_fields(const Type *) {     \
+    return std::make_tuple(UTILS_JSON_FOR_EACH_FIELD(Type, __VA_ARGS__));      \
+  }
@@ -0,0 +1,793 @@
+/**********************************************************************
+ * @brief CBOR (RFC 8949) encoding of Json, with zero-copy reads.
+ * @details dump_cbor writes a Json as CBOR: integral numbers as CBOR integers,
+ *other numbers as doubles, and every non-empty array of numbers as one packed
+ *block of little-endian doubles (RFC 8746 typed array, tag 86) whose payload
+ *is aligned to 8 bytes from the start of the output. CborDocument reads CBOR
+ *in place, from memory or a memory-mapped file, and as_doubles() views a
+ *packed block as a std::span<const double> without copying it.
+ *Strings are stored as they are in Json, i.e. raw, with escapes as written.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "json.hpp"
+#include "json_document.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utils {
+
+/**
+ * Serializes json to CBOR.
+ */
+std::string dump_cbor(const Json &json);
+
+/**
+ * Writes json as CBOR to os through a fixed-size buffer.
+ */
+void write_cbor(std::ostream &os, const Json &json);
+
+/**
+ * Writes json as CBOR to a file, overwriting anything existing.
+ */
+void write_cbor_file(const Json &json, const std::string &filename);
+
+/**
+ * Parses CBOR into a Json. Tags other than typed double arrays are ignored,
+ * and byte strings are read as strings.
+ *
+ * @throws std::runtime_error on malformed or unsupported CBOR.
+ */
+Json parse_cbor(std::string_view bytes);
+
+Json parse_cbor_file(const std::string &filename);
+
+class CborDocument;
+
+/**
+ * Handle to one value of a CborDocument. Cheap to copy; valid as long as the
+ * document is. Lookups walk the encoded items, so element and member access
+ * cost O(index), except in packed double arrays where it is O(1).
+ */
+class CborValueRef {
+public:
+  JsonType type() const;
+
+  bool is_object() const { return type() == JsonType::Object; }
+  bool is_array() const { return type() == JsonType::Array; }
+  bool is_number() const { return type() == JsonType::Number; }
+  bool is_string() const { return type() == JsonType::String; }
+  bool is_bool() const { return type() == JsonType::Bool; }
+  bool is_null() const { return type() == JsonType::Null; }
+
+  /**
+   * Number of elements of an array or members of an object; 1 for scalars.
+   */
+  std::size_t size() const;
+
+  /**
+   * @throws std::runtime_error if the value has a different type.
+   */
+  JsonNumber as_number() const;
+  bool as_bool() const;
+
+  /**
+   * The string, viewing the source bytes. Chunked (indefinite-length)
+   * strings are not supported.
+   */
+  std::string_view as_string() const;
+
+  /**
+   * Element i of an array.
+   *
+   * @throws std::out_of_range if i is out of range.
+   */
+  CborValueRef operator[](std::size_t i) const;
+
+  /**
+   * Member of an object, found by a linear scan.
+   *
+   * @throws std::out_of_range if there is no such key.
+   */
+  CborValueRef operator[](std::string_view key) const;
+
+  bool contains(std::string_view key) const;
+
+  /**
+   * True for an array stored as one packed block of doubles.
+   */
+  bool is_packed_doubles() const;
+
+  /**
+   * Views a packed double array in place.
+   *
+   * @throws std::runtime_error unless is_packed_doubles(), the payload is
+   * aligned for double and the host is little-endian.
+   */
+  std::span<const double> as_doubles() const;
+
+  /**
+   * Copies an array of numbers, packed or not, into a vector.
+   */
+  std::vector<double> get_doubles() const;
+
+  /**
+   * Copies the value and everything under it into a Json.
+   */
+  Json to_json() const;
+
+private:
+  friend class CborDocument;
+
+  const std::uint8_t *item_;   ///< Start of the item, past any ignored tags.
+  const std::uint8_t *end_;    ///< End of the buffer.
+  const std::uint8_t *packed_; ///< Element of a packed array, or nullptr.
+
+  CborValueRef(const std::uint8_t *item, const std::uint8_t *end,
+               const std::uint8_t *packed = nullptr);
+
+  std::span<const std::uint8_t> packed_payload() const;
+  std::optional<CborValueRef> find(std::string_view key) const;
+
+  template <typename F>
+  void for_each_child(F &&f) const;
+};
+
+/**
+ * A read-only CBOR document. Strings and packed arrays view the source bytes,
+ * which must outlive the document unless it was loaded with parse_file().
+ */
+class CborDocument {
+public:
+  CborDocument() = default;
+
+  /**
+   * Checks that bytes holds exactly one well-formed CBOR item.
+   *
+   * @throws std::runtime_error otherwise.
+   */
+  static CborDocument parse(std::string_view bytes);
+
+  /**
+   * Memory-maps and checks a file; the document keeps the mapping.
+   */
+  static CborDocument parse_file(const std::string &filename);
+
+  CborValueRef root() const;
+
+  Json to_json() const { return root().to_json(); }
+
+private:
+  MappedFile file_;
+  std::string_view bytes_;
+};
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+namespace detail {
+
+constexpr std::uint64_t cbor_typed_doubles_tag = 86; // binary64, little-endian
+constexpr std::uint64_t cbor_indefinite =
+    std::numeric_limits<std::uint64_t>::max();
+
+[[noreturn]] inline void cbor_fail(const char *what) {
+  throw std::runtime_error(std::string("Invalid CBOR - ") + what);
+}
+
+/**
+ * @internal
+ * @brief Decoded initial bytes of a CBOR item.
+ */
+struct CborHead {
+  std::uint8_t major;
+  std::uint8_t info;
+  std::uint64_t arg; ///< cbor_indefinite for indefinite lengths.
+  const std::uint8_t *next;
+};
+
+inline CborHead cbor_head(const std::uint8_t *p, const std::uint8_t *end) {
+  if (p == end) {
+    cbor_fail("Unexpected end of input.");
+  }
+  CborHead h{static_cast<std::uint8_t>(*p >> 5),
+             static_cast<std::uint8_t>(*p & 0x1f), 0, p + 1};
+  if (h.info < 24) {
+    h.arg = h.info;
+  } else if (h.info < 28) {
+    std::size_t n = std::size_t{1} << (h.info - 24);
+    if (static_cast<std::size_t>(end - h.next) < n) {
+      cbor_fail("Unexpected end of input.");
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      h.arg = (h.arg << 8) | h.next[i];
+    }
+    h.next += n;
+  } else if (h.info == 31 && h.major >= 2 && h.major != 6) {
+    h.arg = cbor_indefinite;
+  } else {
+    cbor_fail("Reserved additional information.");
+  }
+  return h;
+}
+
+/// Pointer just past the item at p.
+inline const std::uint8_t *cbor_skip(const std::uint8_t *p,
+                                     const std::uint8_t *end) {
+  std::vector<std::uint64_t> open; // items left in each open container
+  bool done;
+  do {
+    done = true;
+    if (!open.empty() && open.back() == cbor_indefinite && p != end &&
+        *p == 0xff) {
+      ++p;
+      open.pop_back();
+    } else {
+      CborHead h = cbor_head(p, end);
+      p = h.next;
+      switch (h.major) {
+      case 2:
+      case 3:
+        if (h.arg == cbor_indefinite) {
+          open.push_back(cbor_indefinite);
+          done = false;
+        } else if (h.arg > static_cast<std::uint64_t>(end - p)) {
+          cbor_fail("Unexpected end of input.");
+        } else {
+          p += h.arg;
+        }
+        break;
+      case 4:
+      case 5:
+        if (h.arg == cbor_indefinite) {
+          open.push_back(cbor_indefinite);
+          done = false;
+        } else if (h.arg > 0) {
+          if (h.arg > static_cast<std::uint64_t>(end - p)) {
+            cbor_fail("Unexpected end of input.");
+          }
+          open.push_back(h.major == 5 ? 2 * h.arg : h.arg);
+          done = false;
+        }
+        break;
+      case 6: // the tagged item follows
+        done = false;
+        break;
+      case 7:
+        if (h.info == 31) {
+          cbor_fail("Unexpected break.");
+        }
+        break;
+      }
+    }
+    if (done) {
+      while (!open.empty() && open.back() != cbor_indefinite &&
+             --open.back() == 0) {
+        open.pop_back();
+      }
+    }
+  } while (!open.empty() || !done);
+  return p;
+}
+
+inline std::uint64_t load_le64(const std::uint8_t *p) {
+  std::uint64_t bits;
+  std::memcpy(&bits, p, 8);
+  if constexpr (std::endian::native != std::endian::little) {
+    std::uint64_t swapped = 0;
+    for (int i = 0; i < 8; ++i) {
+      swapped = (swapped << 8) | p[i ^ 7];
+    }
+    bits = swapped;
+  }
+  return bits;
+}
+
+inline double cbor_half_to_double(std::uint64_t half) {
+  int exponent = static_cast<int>((half >> 10) & 0x1f);
+  double mantissa = static_cast<double>(half & 0x3ff);
+  double value;
+  if (exponent == 0) {
+    value = std::ldexp(mantissa, -24);
+  } else if (exponent == 31) {
+    value = mantissa == 0 ? std::numeric_limits<double>::infinity()
+                          : std::numeric_limits<double>::quiet_NaN();
+  } else {
+    value = std::ldexp(mantissa + 1024, exponent - 25);
+  }
+  return (half & 0x8000) ? -value : value;
+}
+
+/**
+ * @internal
+ * @brief CBOR writer over one of the Json serialization sinks, tracking the
+ * output position to align packed arrays.
+ */
+template <typename Sink>
+struct CborWriter {
+  Sink &sink;
+  std::size_t pos = 0;
+
+  void write(const void *p, std::size_t n) {
+    sink.write(static_cast<const char *>(p), n);
+    pos += n;
+  }
+  void put(std::uint8_t c) {
+    sink.put(static_cast<char>(c));
+    ++pos;
+  }
+
+  /// Size of the shortest head for arg.
+  static std::size_t head_size(std::uint64_t arg) {
+    return arg < 24 ? 1 : arg < (1u << 8) ? 2 : arg < (1u << 16) ? 3
+           : arg < (std::uint64_t{1} << 32) ? 5 : 9;
+  }
+
+  /// Writes a head of exactly size bytes, which must be able to hold arg.
+  void head(std::uint8_t major, std::uint64_t arg, std::size_t size) {
+    std::uint8_t buf[9];
+    if (size == 1) {
+      buf[0] = static_cast<std::uint8_t>(major << 5 | arg);
+    } else {
+      buf[0] = static_cast<std::uint8_t>(
+          major << 5 | (24 + std::countr_zero(size - 1)));
+      for (std::size_t i = size - 1; i > 0; --i, arg >>= 8) {
+        buf[i] = static_cast<std::uint8_t>(arg);
+      }
+    }
+    write(buf, size);
+  }
+  void head(std::uint8_t major, std::uint64_t arg) {
+    head(major, arg, head_size(arg));
+  }
+
+  void number(JsonNumber x) {
+    constexpr double two_64 = 18446744073709551616.0;
+    if (x == std::trunc(x) && x > -two_64 && x < two_64 &&
+        !(x == 0 && std::signbit(x))) {
+      if (x >= 0) {
+        head(0, static_cast<std::uint64_t>(x));
+      } else {
+        head(1, static_cast<std::uint64_t>(-x) - 1);
+      }
+    } else {
+      head(7, std::bit_cast<std::uint64_t>(x), 9);
+    }
+  }
+
+  /**
+   * Writes tag 86 and the byte string head, choosing their encoded sizes
+   * (and an optional no-op tag 55799) so the payload starts 8-aligned.
+   */
+  void packed_heads(std::size_t num_bytes) {
+    constexpr std::size_t sizes[] = {2, 3, 5, 9};
+    std::size_t best_total = 0, best[3] = {0, 2, head_size(num_bytes)};
+    for (std::size_t self_describe : {0, 3}) {
+      for (std::size_t tag_size : sizes) {
+        for (std::size_t len_size : sizes) {
+          std::size_t total = self_describe + tag_size + len_size;
+          if (len_size >= head_size(num_bytes) && (pos + total) % 8 == 0 &&
+              (best_total == 0 || total < best_total)) {
+            best_total = total;
+            best[0] = self_describe;
+            best[1] = tag_size;
+            best[2] = len_size;
+          }
+        }
+      }
+    }
+    if (best[0]) {
+      head(6, 55799, 3);
+    }
+    head(6, cbor_typed_doubles_tag, best[1]);
+    head(2, num_bytes, best[2]);
+  }
+
+  void packed_doubles(const JsonArray &arr) {
+    packed_heads(8 * arr.size());
+    std::uint8_t buf[8 * 256];
+    std::size_t used = 0;
+    for (const Json &elem : arr) {
+      std::uint64_t bits =
+          std::bit_cast<std::uint64_t>(std::get<JsonNumber>(elem.value()));
+      for (int i = 0; i < 8; ++i, bits >>= 8) {
+        buf[used++] = static_cast<std::uint8_t>(bits);
+      }
+      if (used == sizeof(buf)) {
+        write(buf, used);
+        used = 0;
+      }
+    }
+    write(buf, used);
+  }
+
+  void value(const Json &json) {
+    std::visit(
+        [&](const auto &arg) {
+          using T = std::decay_t<decltype(arg)>;
+          if constexpr (std::is_same_v<T, JsonObject>) {
+            head(5, arg.size());
+            for (const auto &[key, val] : arg) {
+              head(3, key.size());
+              write(key.data(), key.size());
+              value(val);
+            }
+          } else if constexpr (std::is_same_v<T, JsonArray>) {
+            bool all_numbers =
+                !arg.empty() &&
+                std::all_of(arg.begin(), arg.end(), [](const Json &elem) {
+                  return std::holds_alternative<JsonNumber>(elem.value());
+                });
+            if (all_numbers) {
+              packed_doubles(arg);
+            } else {
+              head(4, arg.size());
+              for (const Json &elem : arg) {
+                value(elem);
+              }
+            }
+          } else if constexpr (std::is_same_v<T, JsonNumber>) {
+            number(arg);
+          } else if constexpr (std::is_same_v<T, JsonString>) {
+            head(3, arg.size());
+            write(arg.data(), arg.size());
+          } else if constexpr (std::is_same_v<T, JsonBool>) {
+            put(arg ? 0xf5 : 0xf4);
+          } else {
+            put(0xf6);
+          }
+        },
+        json.value());
+  }
+};
+
+} // namespace detail
+
+inline std::string dump_cbor(const Json &json) {
+  std::string out;
+  detail::JsonStringSink sink{out};
+  detail::CborWriter<detail::JsonStringSink>{sink}.value(json);
+  return out;
+}
+
+inline void write_cbor(std::ostream &os, const Json &json) {
+  auto sink = std::make_unique<detail::JsonStreamSink>(os);
+  detail::CborWriter<detail::JsonStreamSink>{*sink}.value(json);
+  sink->flush();
+}
+
+inline void write_cbor_file(const Json &json, const std::string &filename) {
+  std::ofstream outfile(filename, std::ios_base::binary);
+  if (!outfile.is_open()) {
+    throw std::runtime_error("Could not open file");
+  }
+  write_cbor(outfile, json);
+}
+
+inline Json parse_cbor(std::string_view bytes) {
+  return CborDocument::parse(bytes).to_json();
+}
+
+inline Json parse_cbor_file(const std::string &filename) {
+  return CborDocument::parse_file(filename).to_json();
+}
+
+inline CborDocument CborDocument::parse(std::string_view bytes) {
+  auto begin = reinterpret_cast<const std::uint8_t *>(bytes.data());
+  auto end = begin + bytes.size();
+  if (detail::cbor_skip(begin, end) != end) {
+    detail::cbor_fail("Unexpected bytes after the top-level item.");
+  }
+  CborDocument doc;
+  doc.bytes_ = bytes;
+  return doc;
+}
+
+inline CborDocument CborDocument::parse_file(const std::string &filename) {
+  MappedFile file(filename);
+  CborDocument doc = parse(file.view());
+  doc.file_ = std::move(file); // moving keeps the mapping's address
+  return doc;
+}
+
+inline CborValueRef CborDocument::root() const {
+  auto begin = reinterpret_cast<const std::uint8_t *>(bytes_.data());
+  return {begin, begin + bytes_.size()};
+}
+
+inline CborValueRef::CborValueRef(const std::uint8_t *item,
+                                  const std::uint8_t *end,
+                                  const std::uint8_t *packed)
+    : item_{item}, end_{end}, packed_{packed} {
+  if (packed_) {
+    return;
+  }
+  for (;;) {
+    detail::CborHead h = detail::cbor_head(item_, end_);
+    if (h.major != 6 || h.arg == detail::cbor_typed_doubles_tag) {
+      break;
+    }
+    item_ = h.next;
+  }
+}
+
+inline JsonType CborValueRef::type() const {
+  if (packed_) {
+    return JsonType::Number;
+  }
+  detail::CborHead h = detail::cbor_head(item_, end_);
+  switch (h.major) {
+  case 0:
+  case 1:
+    return JsonType::Number;
+  case 2:
+  case 3:
+    return JsonType::String;
+  case 4:
+  case 6:
+    return JsonType::Array;
+  case 5:
+    return JsonType::Object;
+  default:
+    return h.info == 20 || h.info == 21 ? JsonType::Bool
+           : h.info >= 25               ? JsonType::Number
+                                        : JsonType::Null;
+  }
+}
+
+inline std::span<const std::uint8_t> CborValueRef::packed_payload() const {
+  detail::CborHead tag = detail::cbor_head(item_, end_);
+  if (tag.major != 6) {
+    return {};
+  }
+  detail::CborHead h = detail::cbor_head(tag.next, end_);
+  if (h.major != 2 || h.arg == detail::cbor_indefinite || h.arg % 8 != 0) {
+    detail::cbor_fail("Typed double array must be a byte string of doubles.");
+  }
+  return {h.next, static_cast<std::size_t>(h.arg)};
+}
+
+template <typename F>
+void CborValueRef::for_each_child(F &&f) const {
+  detail::CborHead h = detail::cbor_head(item_, end_);
+  if (h.major != 4 && h.major != 5) {
+    throw std::runtime_error("CBOR value is not an array or object.");
+  }
+  const std::uint8_t *p = h.next;
+  std::uint64_t n = h.major == 5 && h.arg != detail::cbor_indefinite
+                        ? 2 * h.arg
+                        : h.arg;
+  for (std::uint64_t i = 0;
+       n == detail::cbor_indefinite ? p != end_ && *p != 0xff : i < n; ++i) {
+    if (!f(p)) {
+      return;
+    }
+    p = detail::cbor_skip(p, end_);
+  }
+}
+
+inline std::size_t CborValueRef::size() const {
+  if (packed_) {
+    return 1;
+  }
+  detail::CborHead h = detail::cbor_head(item_, end_);
+  if (h.major == 6) {
+    return packed_payload().size() / 8;
+  }
+  if (h.major != 4 && h.major != 5) {
+    return 1;
+  }
+  if (h.arg != detail::cbor_indefinite) {
+    return static_cast<std::size_t>(h.arg);
+  }
+  std::size_t n = 0;
+  for_each_child([&](const std::uint8_t *) { return ++n, true; });
+  return h.major == 5 ? n / 2 : n;
+}
+
+inline JsonNumber CborValueRef::as_number() const {
+  if (packed_) {
+    return std::bit_cast<double>(detail::load_le64(packed_));
+  }
+  detail::CborHead h = detail::cbor_head(item_, end_);
+  switch (h.major) {
+  case 0:
+    return static_cast<JsonNumber>(h.arg);
+  case 1:
+    return -1 - static_cast<JsonNumber>(h.arg);
+  case 7:
+    if (h.info == 25) {
+      return detail::cbor_half_to_double(h.arg);
+    } else if (h.info == 26) {
+      return std::bit_cast<float>(static_cast<std::uint32_t>(h.arg));
+    } else if (h.info == 27) {
+      return std::bit_cast<double>(h.arg);
+    }
+    [[fallthrough]];
+  default:
+    throw std::runtime_error("CBOR value is not a number.");
+  }
+}
+
+inline bool CborValueRef::as_bool() const {
+  if (!is_bool()) {
+    throw std::runtime_error("CBOR value is not a bool.");
+  }
+  return *item_ == 0xf5;
+}
+
+inline std::string_view CborValueRef::as_string() const {
+  detail::CborHead h = packed_ ? detail::CborHead{}
+                               : detail::cbor_head(item_, end_);
+  if (packed_ || (h.major != 2 && h.major != 3)) {
+    throw std::runtime_error("CBOR value is not a string.");
+  }
+  if (h.arg == detail::cbor_indefinite) {
+    throw std::runtime_error("Chunked CBOR strings are not supported.");
+  }
+  return {reinterpret_cast<const char *>(h.next),
+          static_cast<std::size_t>(h.arg)};
+}
+
+inline CborValueRef CborValueRef::operator[](std::size_t i) const {
+  if (is_packed_doubles()) {
+    auto payload = packed_payload();
+    if (i >= payload.size() / 8) {
+      throw std::out_of_range("CBOR array index out of range.");
+    }
+    return {item_, end_, payload.data() + 8 * i};
+  }
+  if (!is_array()) {
+    throw std::runtime_error("CBOR value is not an array.");
+  }
+  const std::uint8_t *found = nullptr;
+  std::size_t k = 0;
+  for_each_child([&](const std::uint8_t *p) {
+    if (k++ == i) {
+      found = p;
+    }
+    return !found;
+  });
+  if (!found) {
+    throw std::out_of_range("CBOR array index out of range.");
+  }
+  return {found, end_};
+}
+
+inline std::optional<CborValueRef>
+CborValueRef::find(std::string_view key) const {
+  if (!is_object()) {
+    throw std::runtime_error("CBOR value is not an object.");
+  }
+  std::optional<CborValueRef> found;
+  bool is_key = true, matched = false;
+  for_each_child([&](const std::uint8_t *p) {
+    if (matched) {
+      found = CborValueRef(p, end_);
+      return false;
+    }
+    if (is_key) {
+      matched = CborValueRef(p, end_).as_string() == key;
+    }
+    is_key = !is_key;
+    return true;
+  });
+  return found;
+}
+
+inline CborValueRef CborValueRef::operator[](std::string_view key) const {
+  auto found = find(key);
+  if (!found) {
+    throw std::out_of_range("CBOR object has no key " + std::string(key));
+  }
+  return *found;
+}
+
+inline bool CborValueRef::contains(std::string_view key) const {
+  return find(key).has_value();
+}
+
+inline bool CborValueRef::is_packed_doubles() const {
+  return !packed_ && detail::cbor_head(item_, end_).major == 6;
+}
+
+inline std::span<const double> CborValueRef::as_doubles() const {
+  if (!is_packed_doubles()) {
+    throw std::runtime_error("CBOR value is not a packed double array.");
+  }
+  auto payload = packed_payload();
+  if (std::endian::native != std::endian::little ||
+      reinterpret_cast<std::uintptr_t>(payload.data()) % alignof(double) !=
+          0) {
+    throw std::runtime_error("Packed CBOR doubles cannot be viewed in place.");
+  }
+  return {reinterpret_cast<const double *>(payload.data()),
+          payload.size() / 8};
+}
+
+inline std::vector<double> CborValueRef::get_doubles() const {
+  std::vector<double> result;
+  if (is_packed_doubles()) {
+    auto payload = packed_payload();
+    result.resize(payload.size() / 8);
+    for (std::size_t i = 0; i < result.size(); ++i) {
+      result[i] = std::bit_cast<double>(detail::load_le64(&payload[8 * i]));
+    }
+  } else {
+    for_each_child([&](const std::uint8_t *p) {
+      result.push_back(CborValueRef(p, end_).as_number());
+      return true;
+    });
+  }
+  return result;
+}
+
+inline Json CborValueRef::to_json() const {
+  Json json;
+  switch (type()) {
+  case JsonType::Object: {
+    json = JsonObject{};
+    std::string key;
+    bool is_key = true;
+    for_each_child([&](const std::uint8_t *p) {
+      CborValueRef child(p, end_);
+      if (is_key) {
+        key = child.as_string();
+      } else {
+        json[key] = child.to_json();
+      }
+      is_key = !is_key;
+      return true;
+    });
+    break;
+  }
+  case JsonType::Array:
+    json = JsonArray{};
+    if (is_packed_doubles()) {
+      for (double x : get_doubles()) {
+        json.push_back(x);
+      }
+    } else {
+      for_each_child([&](const std::uint8_t *p) {
+        json.push_back(CborValueRef(p, end_).to_json());
+        return true;
+      });
+    }
+    break;
+  case JsonType::Number:
+    json = as_number();
+    break;
+  case JsonType::String:
+    json = std::string(as_string());
+    break;
+  case JsonType::Bool:
+    json = as_bool();
+    break;
+  case JsonType::Null:
+    json = nullptr;
+    break;
+  }
+  return json;
+}
+
+} // namespace utils
@@ -0,0 +1,470 @@
+/**********************************************************************
+ * @brief Immutable, flat JSON DOM.
+ * @details JsonDocument stores every value of a parsed document in one
+ *contiguous array of nodes, in document order, so building and destroying
+ *it costs a handful of allocations whatever its size. Strings and object keys
+ *are string_views into the source text, and the members of each object are
+ *kept sorted by key for binary-search lookup. Convert to a Json with
+ *to_json() when a mutable tree is needed.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "json.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace utils {
+
+enum class JsonType { Object, Array, Number, String, Bool, Null };
+
+class JsonDocument;
+
+/**
+ * Handle to one value of a JsonDocument. Cheap to copy; valid as long as the
+ * document is.
+ */
+class JsonValueRef {
+public:
+  JsonType type() const noexcept;
+
+  bool is_object() const noexcept { return type() == JsonType::Object; }
+  bool is_array() const noexcept { return type() == JsonType::Array; }
+  bool is_number() const noexcept { return type() == JsonType::Number; }
+  bool is_string() const noexcept { return type() == JsonType::String; }
+  bool is_bool() const noexcept { return type() == JsonType::Bool; }
+  bool is_null() const noexcept { return type() == JsonType::Null; }
+
+  /**
+   * Number of elements of an array or members of an object; 1 for scalars.
+   */
+  std::size_t size() const noexcept;
+
+  /**
+   * @throws std::runtime_error if the value has a different type.
+   */
+  JsonNumber as_number() const;
+  bool as_bool() const;
+
+  /**
+   * The raw string, including escape sequences, viewing the source text.
+   */
+  std::string_view as_string() const;
+
+  /**
+   * Element i of an array.
+   *
+   * @throws std::out_of_range if i is out of range.
+   */
+  JsonValueRef operator[](std::size_t i) const;
+
+  /**
+   * Member of an object, found by binary search.
+   *
+   * @throws std::out_of_range if there is no such key.
+   */
+  JsonValueRef operator[](std::string_view key) const;
+
+  bool contains(std::string_view key) const;
+
+  /**
+   * Key and value of member i of an object, in key order.
+   */
+  std::string_view key(std::size_t i) const;
+  JsonValueRef value(std::size_t i) const;
+
+  /**
+   * Copies the value and everything under it into a Json.
+   */
+  Json to_json() const;
+
+private:
+  friend class JsonDocument;
+
+  const JsonDocument *doc_;
+  std::uint32_t index_;
+
+  JsonValueRef(const JsonDocument *doc, std::uint32_t index)
+      : doc_{doc}, index_{index} {}
+
+  std::uint32_t find(std::string_view key) const;
+};
+
+/**
+ * A parsed, read-only JSON document. Strings view the source text, which must
+ * outlive the document unless it was loaded with parse_file().
+ */
+class JsonDocument {
+public:
+  JsonDocument() = default;
+
+  /**
+   * Parses json_str, which must outlive the document and not be modified.
+   * As with utils::parse, empty input gives an empty object.
+   *
+   * @throws std::runtime_error on malformed JSON.
+   */
+  static JsonDocument parse(std::string_view json_str);
+
+  /**
+   * Memory-maps and parses a file; the document keeps the mapping.
+   */
+  static JsonDocument parse_file(const std::string &filename);
+
+  JsonValueRef root() const { return {this, 0}; }
+
+  Json to_json() const { return root().to_json(); }
+
+  /**
+   * Number of values in the document.
+   */
+  std::size_t num_nodes() const noexcept { return nodes_.size(); }
+
+private:
+  friend class JsonValueRef;
+
+  struct Node {
+    JsonType type;
+    std::uint32_t next;  ///< Index just past this node's subtree.
+    std::uint32_t size;  ///< Number of elements or members.
+    std::uint32_t first; ///< First entry in elements_ or members_.
+    JsonNumber number;   ///< Value of a number, or 0/1 for a bool.
+    std::string_view text;
+  };
+
+  struct Member {
+    std::string_view key;
+    std::uint32_t value;
+  };
+
+  MappedFile file_;
+  std::vector<Node> nodes_;
+  std::vector<std::uint32_t> elements_;
+  std::vector<Member> members_;
+
+  void build(std::string_view json_str);
+};
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+inline JsonDocument JsonDocument::parse(std::string_view json_str) {
+  JsonDocument doc;
+  doc.build(json_str);
+  return doc;
+}
+
+inline JsonDocument JsonDocument::parse_file(const std::string &filename) {
+  JsonDocument doc;
+  doc.file_ = MappedFile(filename);
+  doc.build(doc.file_.view());
+  return doc;
+}
+
+inline void JsonDocument::build(std::string_view json_str) {
+
+  const char *pos = json_str.data();
+  const char *end = pos + json_str.size();
+
+  auto fail = [](const char *what) {
+    throw std::runtime_error(std::string("Invalid JSON - ") + what);
+  };
+  auto skip_whitespace = [&] {
+    while (pos != end &&
+           (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) {
+      ++pos;
+    }
+  };
+  auto scan_string = [&] {
+    const char *begin = pos + 1;
+    const char *close = detail::json_string_end(begin, end);
+    if (!close) {
+      fail("Unterminated string.");
+    }
+    pos = close + 1;
+    return std::string_view(begin, static_cast<std::size_t>(close - begin));
+  };
+  auto scan_key = [&] {
+    skip_whitespace();
+    if (pos == end || *pos != '"') {
+      fail("Object keys must be strings.");
+    }
+    auto key = scan_string();
+    skip_whitespace();
+    if (pos == end || *pos != ':') {
+      fail("Key string must be followed by colon");
+    }
+    ++pos;
+    return key;
+  };
+
+  // Children of the open containers are collected here, then moved to
+  // elements_ or members_ when the container closes, so that each
+  // container's entries end up contiguous.
+  struct Open {
+    std::uint32_t node;
+    std::size_t pending_begin;
+  };
+  std::vector<Open> open;
+  std::vector<std::uint32_t> pending_elements;
+  std::vector<Member> pending_members;
+  std::string_view key;
+
+  auto close = [&] {
+    Open o = open.back();
+    open.pop_back();
+    Node &node = nodes_[o.node];
+    node.next = static_cast<std::uint32_t>(nodes_.size());
+
+    if (node.type == JsonType::Array) {
+      node.first = static_cast<std::uint32_t>(elements_.size());
+      node.size = static_cast<std::uint32_t>(pending_elements.size() -
+                                             o.pending_begin);
+      elements_.insert(elements_.end(),
+                       pending_elements.begin() + o.pending_begin,
+                       pending_elements.end());
+      pending_elements.resize(o.pending_begin);
+    } else {
+      auto first = pending_members.begin() + o.pending_begin;
+      std::stable_sort(first, pending_members.end(),
+                       [](const Member &a, const Member &b) {
+                         return a.key < b.key;
+                       });
+      // A repeated key keeps its last value, like utils::parse.
+      node.first = static_cast<std::uint32_t>(members_.size());
+      for (auto it = first; it != pending_members.end(); ++it) {
+        if (it + 1 != pending_members.end() && (it + 1)->key == it->key) {
+          continue;
+        }
+        members_.push_back(*it);
+      }
+      node.size = static_cast<std::uint32_t>(members_.size() - node.first);
+      pending_members.resize(o.pending_begin);
+    }
+  };
+
+  skip_whitespace();
+  if (pos == end) {
+    nodes_.push_back({JsonType::Object, 1, 0, 0, 0, {}});
+    return;
+  }
+
+  for (;;) {
+    skip_whitespace();
+    if (pos == end) {
+      fail("Missing value.");
+    }
+    if (nodes_.size() == std::numeric_limits<std::uint32_t>::max()) {
+      throw std::length_error("JSON document has too many values");
+    }
+
+    auto index = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.push_back({JsonType::Null, index + 1, 0, 0, 0, {}});
+    if (!open.empty()) {
+      if (nodes_[open.back().node].type == JsonType::Object) {
+        pending_members.push_back({key, index});
+      } else {
+        pending_elements.push_back(index);
+      }
+    }
+
+    char c = *pos;
+    if (c == '{' || c == '[') {
+      ++pos;
+      bool is_object = (c == '{');
+      nodes_[index].type = is_object ? JsonType::Object : JsonType::Array;
+      open.push_back({index, is_object ? pending_members.size()
+                                       : pending_elements.size()});
+      skip_whitespace();
+      if (pos != end && *pos == (is_object ? '}' : ']')) {
+        ++pos;
+        close();
+      } else {
+        if (is_object) {
+          key = scan_key();
+        }
+        continue;
+      }
+    } else if (c == '"') {
+      nodes_[index].type = JsonType::String;
+      nodes_[index].text = scan_string();
+    } else if (c == 't' || c == 'f' || c == 'n') {
+      std::string_view rest(pos, static_cast<std::size_t>(end - pos));
+      if (rest.starts_with("true")) {
+        nodes_[index].type = JsonType::Bool;
+        nodes_[index].number = 1;
+        pos += 4;
+      } else if (rest.starts_with("false")) {
+        nodes_[index].type = JsonType::Bool;
+        pos += 5;
+      } else if (rest.starts_with("null")) {
+        pos += 4;
+      } else {
+        fail("Invalid scalar.");
+      }
+    } else {
+      nodes_[index].type = JsonType::Number;
+      pos = detail::json_scan_number(pos, end, nodes_[index].number);
+      if (!pos) {
+        fail("Invalid number.");
+      }
+    }
+
+    // After a complete value: close containers until the next comma.
+    bool more = false;
+    while (!open.empty() && !more) {
+      skip_whitespace();
+      if (pos == end) {
+        fail("Missing closing braces or brackets.");
+      }
+      bool is_object = nodes_[open.back().node].type == JsonType::Object;
+      char d = *pos++;
+      if (d == ',') {
+        if (is_object) {
+          key = scan_key();
+        }
+        more = true;
+      } else if (d == (is_object ? '}' : ']')) {
+        close();
+      } else {
+        fail("Expected a comma or a matching closing bracket.");
+      }
+    }
+    if (!more) {
+      break;
+    }
+  }
+
+  skip_whitespace();
+  if (pos != end) {
+    fail("Unexpected characters after the top-level value.");
+  }
+}
+
+inline JsonType JsonValueRef::type() const noexcept {
+  return doc_->nodes_[index_].type;
+}
+
+inline std::size_t JsonValueRef::size() const noexcept {
+  const auto &node = doc_->nodes_[index_];
+  return (node.type == JsonType::Object || node.type == JsonType::Array)
+             ? node.size
+             : 1;
+}
+
+inline JsonNumber JsonValueRef::as_number() const {
+  if (!is_number()) {
+    throw std::runtime_error("JSON value is not a number");
+  }
+  return doc_->nodes_[index_].number;
+}
+
+inline bool JsonValueRef::as_bool() const {
+  if (!is_bool()) {
+    throw std::runtime_error("JSON value is not a bool");
+  }
+  return doc_->nodes_[index_].number != 0;
+}
+
+inline std::string_view JsonValueRef::as_string() const {
+  if (!is_string()) {
+    throw std::runtime_error("JSON value is not a string");
+  }
+  return doc_->nodes_[index_].text;
+}
+
+inline JsonValueRef JsonValueRef::operator[](std::size_t i) const {
+  const auto &node = doc_->nodes_[index_];
+  if (node.type != JsonType::Array || i >= node.size) {
+    throw std::out_of_range("JSON array index out of range");
+  }
+  return {doc_, doc_->elements_[node.first + i]};
+}
+
+inline std::uint32_t JsonValueRef::find(std::string_view key) const {
+  const auto &node = doc_->nodes_[index_];
+  if (node.type != JsonType::Object) {
+    return std::numeric_limits<std::uint32_t>::max();
+  }
+  auto first = doc_->members_.begin() + node.first;
+  auto last = first + node.size;
+  auto it = std::lower_bound(
+      first, last, key,
+      [](const JsonDocument::Member &m, std::string_view k) {
+        return m.key < k;
+      });
+  return (it != last && it->key == key)
+             ? it->value
+             : std::numeric_limits<std::uint32_t>::max();
+}
+
+inline JsonValueRef JsonValueRef::operator[](std::string_view key) const {
+  std::uint32_t value = find(key);
+  if (value == std::numeric_limits<std::uint32_t>::max()) {
+    throw std::out_of_range("JSON object has no key " + std::string(key));
+  }
+  return {doc_, value};
+}
+
+inline bool JsonValueRef::contains(std::string_view key) const {
+  return find(key) != std::numeric_limits<std::uint32_t>::max();
+}
+
+inline std::string_view JsonValueRef::key(std::size_t i) const {
+  const auto &node = doc_->nodes_[index_];
+  if (node.type != JsonType::Object || i >= node.size) {
+    throw std::out_of_range("JSON object member index out of range");
+  }
+  return doc_->members_[node.first + i].key;
+}
+
+inline JsonValueRef JsonValueRef::value(std::size_t i) const {
+  key(i); // range check
+  return {doc_, doc_->members_[doc_->nodes_[index_].first + i].value};
+}
+
+inline Json JsonValueRef::to_json() const {
+  Json json;
+  switch (type()) {
+  case JsonType::Object:
+    json = JsonObject{};
+    for (std::size_t i = 0; i < size(); ++i) {
+      json[std::string(key(i))] = value(i).to_json();
+    }
+    break;
+  case JsonType::Array: {
+    json = JsonArray{};
+    for (std::size_t i = 0; i < size(); ++i) {
+      json.push_back((*this)[i].to_json());
+    }
+    break;
+  }
+  case JsonType::Number:
+    json = as_number();
+    break;
+  case JsonType::String:
+    json = std::string(as_string());
+    break;
+  case JsonType::Bool:
+    json = as_bool();
+    break;
+  case JsonType::Null:
+    json = nullptr;
+    break;
+  }
+  return json;
+}
+
+} // namespace utils
@@ -0,0 +1,273 @@
+/**********************************************************************
+ * @brief Parallel parsing of JSON-lines files and large top-level arrays.
+ * @details A sequential pre-scan finds the record boundaries (the commas at
+ *depth 1 of a top-level array, or the newlines of a JSON-lines file), skipping
+ *over strings with the same scanner as the parser. The records are then
+ *parsed independently on a parallel::thread_pool, in chunks of roughly equal
+ *byte size, either into one Json array or handed to a callback.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "json.hpp"
+#include "mapped_file.hpp"
+#include "parallel/thread_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utils {
+
+/**
+ * The text of each element of a top-level JSON array, in order. Elements are
+ * not validated, only delimited.
+ *
+ * @throws std::runtime_error if json_str is not an array, or an element is
+ * empty.
+ */
+std::vector<std::string_view> split_json_array(std::string_view json_str);
+
+/**
+ * The non-blank lines of a JSON-lines (NDJSON) text, in order.
+ */
+std::vector<std::string_view> split_json_lines(std::string_view json_str);
+
+/**
+ * Parses a top-level array, with its elements parsed on pool if given.
+ * Gives the same result as utils::parse.
+ */
+Json parse_json_array(std::string_view json_str,
+                      parallel::thread_pool *pool = nullptr);
+
+/**
+ * Parses a JSON-lines text into an array with one element per line.
+ */
+Json parse_json_lines(std::string_view json_str,
+                      parallel::thread_pool *pool = nullptr);
+
+/**
+ * parse_json_array and parse_json_lines on a memory-mapped file.
+ */
+Json parse_json_array_file(const std::string &filename,
+                           parallel::thread_pool *pool = nullptr);
+Json parse_json_lines_file(const std::string &filename,
+                           parallel::thread_pool *pool = nullptr);
+
+/**
+ * Parses each element of a top-level array and calls f(index, Json&&) with
+ * it. With a pool, f is called concurrently from several threads, in no
+ * particular order, so it must be thread-safe.
+ */
+template <typename F>
+void for_each_array_record(std::string_view json_str, F &&f,
+                           parallel::thread_pool *pool = nullptr);
+
+/**
+ * As for_each_array_record, for the lines of a JSON-lines text.
+ */
+template <typename F>
+void for_each_json_line(std::string_view json_str, F &&f,
+                        parallel::thread_pool *pool = nullptr);
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+namespace detail {
+
+inline bool is_json_whitespace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline bool is_blank(std::string_view s) {
+  return std::all_of(s.begin(), s.end(), is_json_whitespace);
+}
+
+/**
+ * @internal
+ * @brief Calls f(i, records[i]) for every record, on pool if given. Chunks
+ * cover roughly equal numbers of bytes, so a few large records do not leave
+ * the other threads idle.
+ */
+template <typename F>
+void for_each_record_view(const std::vector<std::string_view> &records, F &&f,
+                          parallel::thread_pool *pool) {
+  std::size_t n = records.size();
+  if (!pool || n < 2) {
+    for (std::size_t i = 0; i < n; ++i) {
+      f(i, records[i]);
+    }
+    return;
+  }
+
+  const char *first = records.front().data();
+  std::size_t total = static_cast<std::size_t>(
+      records.back().data() + records.back().size() - first);
+  std::size_t num_chunks = std::min(n, 4 * (pool->size() + 1));
+
+  // Index of the first record starting at or after byte offset.
+  auto record_at = [&](std::size_t offset) {
+    return static_cast<std::size_t>(
+        std::lower_bound(records.begin(), records.end(), first + offset,
+                         [](std::string_view r, const char *p) {
+                           return r.data() < p;
+                         }) -
+        records.begin());
+  };
+
+  pool->parallel_for(std::size_t{0}, num_chunks, 1, [&](std::size_t chunk) {
+    std::size_t begin = record_at(chunk * total / num_chunks);
+    std::size_t end = chunk + 1 == num_chunks
+                          ? n
+                          : record_at((chunk + 1) * total / num_chunks);
+    for (std::size_t i = begin; i < end; ++i) {
+      f(i, records[i]);
+    }
+  });
+}
+
+inline Json parse_records(const std::vector<std::string_view> &records,
+                          parallel::thread_pool *pool) {
+  Json json = JsonArray{};
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    json.emplace_back();
+  }
+  for_each_record_view(
+      records,
+      [&](std::size_t i, std::string_view record) { json[i] = parse(record); },
+      pool);
+  return json;
+}
+
+} // namespace detail
+
+inline std::vector<std::string_view>
+split_json_array(std::string_view json_str) {
+  auto fail = [](const char *what) {
+    throw std::runtime_error(std::string("Invalid JSON - ") + what);
+  };
+
+  const char *p = json_str.data();
+  const char *end = p + json_str.size();
+  while (p != end && detail::is_json_whitespace(*p)) {
+    ++p;
+  }
+  if (p == end || *p != '[') {
+    fail("Expected a top-level array.");
+  }
+
+  std::vector<std::string_view> records;
+  const char *record_begin = ++p;
+  std::size_t depth = 0;
+
+  auto add_record = [&](bool last) {
+    std::string_view record(record_begin,
+                            static_cast<std::size_t>(p - record_begin));
+    if (detail::is_blank(record)) {
+      if (last && records.empty()) {
+        return; // []
+      }
+      fail("Empty array element.");
+    }
+    records.push_back(record);
+  };
+
+  for (;; ++p) {
+    if (p == end) {
+      fail("Unterminated array.");
+    }
+    char c = *p;
+    if (c == '"') {
+      const char *close = detail::json_string_end(p + 1, end);
+      if (!close) {
+        fail("Unterminated string.");
+      }
+      p = close;
+    } else if (c == '[' || c == '{') {
+      ++depth;
+    } else if (c == ']' || c == '}') {
+      if (depth == 0) {
+        if (c != ']') {
+          fail("Mismatched brackets.");
+        }
+        add_record(true);
+        break;
+      }
+      --depth;
+    } else if (c == ',' && depth == 0) {
+      add_record(false);
+      record_begin = p + 1;
+    }
+  }
+
+  for (++p; p != end; ++p) {
+    if (!detail::is_json_whitespace(*p)) {
+      fail("Unexpected characters after the top-level value.");
+    }
+  }
+  return records;
+}
+
+inline std::vector<std::string_view>
+split_json_lines(std::string_view json_str) {
+  std::vector<std::string_view> records;
+  while (!json_str.empty()) {
+    std::size_t newline = json_str.find('\n');
+    std::string_view line = json_str.substr(0, newline);
+    if (!detail::is_blank(line)) {
+      records.push_back(line);
+    }
+    json_str.remove_prefix(newline == std::string_view::npos ? json_str.size()
+                                                             : newline + 1);
+  }
+  return records;
+}
+
+inline Json parse_json_array(std::string_view json_str,
+                             parallel::thread_pool *pool) {
+  return detail::parse_records(split_json_array(json_str), pool);
+}
+
+inline Json parse_json_lines(std::string_view json_str,
+                             parallel::thread_pool *pool) {
+  return detail::parse_records(split_json_lines(json_str), pool);
+}
+
+inline Json parse_json_array_file(const std::string &filename,
+                                  parallel::thread_pool *pool) {
+  MappedFile file(filename);
+  return parse_json_array(file.view(), pool);
+}
+
+inline Json parse_json_lines_file(const std::string &filename,
+                                  parallel::thread_pool *pool) {
+  MappedFile file(filename);
+  return parse_json_lines(file.view(), pool);
+}
+
+template <typename F>
+void for_each_array_record(std::string_view json_str, F &&f,
+                           parallel::thread_pool *pool) {
+  detail::for_each_record_view(
+      split_json_array(json_str),
+      [&](std::size_t i, std::string_view record) { f(i, parse(record)); },
+      pool);
+}
+
+template <typename F>
+void for_each_json_line(std::string_view json_str, F &&f,
+                        parallel::thread_pool *pool) {
+  detail::for_each_record_view(
+      split_json_lines(json_str),
+      [&](std::size_t i, std::string_view record) { f(i, parse(record)); },
+      pool);
+}
+
+} // namespace utils
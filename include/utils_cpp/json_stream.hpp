@@ -0,0 +1,614 @@
+/**********************************************************************
+ * @brief Streaming (SAX and pull) JSON readers.
+ * @details Reads JSON incrementally from a std::istream or a file descriptor
+ *in fixed-size chunks, without building a Json DOM, so inputs much larger
+ *than memory can be processed. JsonPullParser hands out one event at a time;
+ *sax_parse drives a JsonHandler with the same events. The input can hold any
+ *number of whitespace-separated top-level values, e.g. JSON lines. Strings
+ *are reported as written, including escape sequences, like utils::parse.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "json.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace utils {
+
+/**
+ * One event of a JsonPullParser. text (the raw contents of a key or string,
+ * or the digits of a number) stays valid until the next call to next().
+ */
+struct JsonEvent {
+  enum class Type {
+    StartObject,
+    EndObject,
+    StartArray,
+    EndArray,
+    Key,
+    String,
+    Number,
+    Bool,
+    Null,
+    End, ///< No more input.
+  };
+
+  Type type = Type::End;
+  std::string_view text;
+  JsonNumber number = 0;
+  bool boolean = false;
+
+  /// Number of containers enclosing the event; 0 for top-level values.
+  std::size_t depth = 0;
+};
+
+/**
+ * Pull parser over a std::istream or a file descriptor. Only a buffer of
+ * chunk_size bytes (grown if a single token is larger) and the stack of open
+ * containers are kept in memory.
+ */
+class JsonPullParser {
+public:
+  static constexpr std::size_t default_chunk_size = 1 << 16;
+
+  /**
+   * Reads from is, which must outlive the parser.
+   */
+  explicit JsonPullParser(std::istream &is,
+                          std::size_t chunk_size = default_chunk_size);
+
+  /**
+   * Reads from an open file descriptor, which the parser does not close.
+   */
+  explicit JsonPullParser(int fd, std::size_t chunk_size = default_chunk_size);
+
+  /**
+   * The next event. Returns an End event once the input is exhausted.
+   *
+   * @throws std::runtime_error on malformed JSON.
+   */
+  JsonEvent next();
+
+  /**
+   * Skips a value without reporting its events. After a Key event, or
+   * between array elements or top-level values, skips the next value; right
+   * after a StartObject or StartArray event, skips the rest of that container
+   * (including its end).
+   */
+  void skip();
+
+  /**
+   * Reads the next value (as for skip()) into a Json. Handy for taking single
+   * records out of a large stream. Must not be called right before a key or
+   * the end of a container.
+   *
+   * @throws std::logic_error if called there.
+   */
+  Json read_json();
+
+private:
+  enum class Expect { Value, ValueOrEnd, Key, KeyOrEnd, Colon, CommaOrEnd };
+
+  std::istream *is_ = nullptr;
+  int fd_ = -1;
+
+  std::vector<char> buffer_;
+  std::size_t pos_ = 0;
+  std::size_t end_ = 0;
+  bool eof_ = false;
+
+  std::vector<char> containers_; // '{' or '[' for each open container
+  Expect expect_ = Expect::Value;
+  JsonEvent::Type last_ = JsonEvent::Type::End;
+
+  /// Reads more input, keeping [pos_, end_). Returns false at end of input.
+  bool fill();
+
+  /// Skips whitespace; returns false at end of input.
+  bool skip_whitespace();
+
+  /// Makes at least n bytes available from pos_, if the input has them.
+  bool ensure(std::size_t n);
+
+  [[noreturn]] void fail(const char *what) const;
+
+  std::string_view scan_string();
+  std::string_view scan_number_text();
+  void read_literal(std::string_view literal);
+
+  JsonEvent value_event(char c);
+  void end_value();
+
+  JsonEvent make_event(JsonEvent::Type type) {
+    JsonEvent event;
+    event.type = type;
+    event.depth = containers_.size();
+    return event;
+  }
+};
+
+/**
+ * Receives the events of sax_parse. Every callback returns true to continue,
+ * or false to stop parsing.
+ */
+class JsonHandler {
+public:
+  virtual ~JsonHandler() = default;
+
+  virtual bool on_start_object() { return true; }
+  virtual bool on_end_object() { return true; }
+  virtual bool on_start_array() { return true; }
+  virtual bool on_end_array() { return true; }
+
+  /// The raw key, valid only during the call.
+  virtual bool on_key(std::string_view) { return true; }
+
+  /// The raw string, valid only during the call.
+  virtual bool on_string(std::string_view) { return true; }
+
+  virtual bool on_number(JsonNumber) { return true; }
+  virtual bool on_bool(bool) { return true; }
+  virtual bool on_null() { return true; }
+};
+
+/**
+ * Feeds every event of parser to handler. Returns false if the handler
+ * stopped early, true if the whole input was read.
+ */
+bool sax_parse(JsonPullParser &parser, JsonHandler &handler);
+
+/**
+ * SAX-parses a stream in chunks of chunk_size bytes.
+ */
+bool sax_parse(std::istream &is, JsonHandler &handler,
+               std::size_t chunk_size = JsonPullParser::default_chunk_size);
+
+/**
+ * SAX-parses an open file descriptor in chunks of chunk_size bytes.
+ */
+bool sax_parse(int fd, JsonHandler &handler,
+               std::size_t chunk_size = JsonPullParser::default_chunk_size);
+
+/**
+ * SAX-parses a file.
+ *
+ * @throws std::runtime_error if the file cannot be opened.
+ */
+bool sax_parse_file(const std::string &filename, JsonHandler &handler,
+                    std::size_t chunk_size = JsonPullParser::default_chunk_size);
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+inline JsonPullParser::JsonPullParser(std::istream &is, std::size_t chunk_size)
+    : is_{&is}, buffer_(std::max<std::size_t>(chunk_size, 64)) {}
+
+inline JsonPullParser::JsonPullParser(int fd, std::size_t chunk_size)
+    : fd_{fd}, buffer_(std::max<std::size_t>(chunk_size, 64)) {}
+
+inline void JsonPullParser::fail(const char *what) const {
+  throw std::runtime_error(std::string("Invalid JSON - ") + what);
+}
+
+inline bool JsonPullParser::fill() {
+  if (eof_) {
+    return false;
+  }
+
+  // Keep the unconsumed bytes, which may be a token split across chunks, and
+  // grow the buffer only if that token fills it.
+  std::size_t kept = end_ - pos_;
+  if (pos_ > 0) {
+    std::memmove(buffer_.data(), buffer_.data() + pos_, kept);
+    pos_ = 0;
+    end_ = kept;
+  }
+  if (end_ == buffer_.size()) {
+    buffer_.resize(2 * buffer_.size());
+  }
+
+  std::size_t n = 0;
+  char *dst = buffer_.data() + end_;
+  std::size_t room = buffer_.size() - end_;
+  if (is_) {
+    is_->read(dst, static_cast<std::streamsize>(room));
+    n = static_cast<std::size_t>(is_->gcount());
+  } else {
+#ifdef _WIN32
+    int r = ::_read(fd_, dst, static_cast<unsigned>(room));
+#else
+    auto r = ::read(fd_, dst, room);
+#endif
+    if (r < 0) {
+      throw std::runtime_error("Could not read JSON input");
+    }
+    n = static_cast<std::size_t>(r);
+  }
+
+  if (n == 0) {
+    eof_ = true;
+    return false;
+  }
+  end_ += n;
+  return true;
+}
+
+inline bool JsonPullParser::skip_whitespace() {
+  for (;;) {
+    while (pos_ != end_) {
+      char c = buffer_[pos_];
+      if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+        return true;
+      }
+      ++pos_;
+    }
+    if (!fill()) {
+      return false;
+    }
+  }
+}
+
+inline bool JsonPullParser::ensure(std::size_t n) {
+  while (end_ - pos_ < n) {
+    if (!fill()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline std::string_view JsonPullParser::scan_string() {
+  // Offsets from pos_ (at the opening quote), since fill() moves the data.
+  std::size_t i = 1;
+  for (;;) {
+    const char *begin = buffer_.data() + pos_;
+    const char *p = detail::json_find_quote_or_backslash(
+        begin + std::min(i, end_ - pos_), buffer_.data() + end_);
+    i = static_cast<std::size_t>(p - begin);
+
+    if (pos_ + i < end_ && *p == '"') {
+      std::string_view s(begin + 1, i - 1);
+      pos_ += i + 1;
+      return s;
+    }
+    if (pos_ + i < end_) {
+      i += 2; // skip the escaped character
+    }
+    if (pos_ + i >= end_ && !fill()) {
+      fail("Unterminated string.");
+    }
+  }
+}
+
+inline std::string_view JsonPullParser::scan_number_text() {
+  auto in_number = [](char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+           c == 'e' || c == 'E';
+  };
+  std::size_t i = 0;
+  for (;;) {
+    while (pos_ + i < end_ && in_number(buffer_[pos_ + i])) {
+      ++i;
+    }
+    if (pos_ + i < end_ || !fill()) {
+      break;
+    }
+  }
+  std::string_view s(buffer_.data() + pos_, i);
+  pos_ += i;
+  return s;
+}
+
+inline void JsonPullParser::read_literal(std::string_view literal) {
+  if (!ensure(literal.size()) ||
+      std::string_view(buffer_.data() + pos_, literal.size()) != literal) {
+    fail("Invalid scalar.");
+  }
+  pos_ += literal.size();
+}
+
+inline void JsonPullParser::end_value() {
+  expect_ = containers_.empty() ? Expect::Value : Expect::CommaOrEnd;
+}
+
+inline JsonEvent JsonPullParser::value_event(char c) {
+  switch (c) {
+  case '{': {
+    ++pos_;
+    auto event = make_event(JsonEvent::Type::StartObject);
+    containers_.push_back('{');
+    expect_ = Expect::KeyOrEnd;
+    return event;
+  }
+  case '[': {
+    ++pos_;
+    auto event = make_event(JsonEvent::Type::StartArray);
+    containers_.push_back('[');
+    expect_ = Expect::ValueOrEnd;
+    return event;
+  }
+  case '"': {
+    auto event = make_event(JsonEvent::Type::String);
+    event.text = scan_string();
+    end_value();
+    return event;
+  }
+  case 't':
+  case 'f': {
+    auto event = make_event(JsonEvent::Type::Bool);
+    event.boolean = (c == 't');
+    read_literal(event.boolean ? "true" : "false");
+    end_value();
+    return event;
+  }
+  case 'n': {
+    auto event = make_event(JsonEvent::Type::Null);
+    read_literal("null");
+    end_value();
+    return event;
+  }
+  default: {
+    auto event = make_event(JsonEvent::Type::Number);
+    event.text = scan_number_text();
+    const char *end = event.text.data() + event.text.size();
+    if (event.text.empty() ||
+        detail::json_scan_number(event.text.data(), end, event.number) !=
+            end) {
+      fail("Invalid number.");
+    }
+    end_value();
+    return event;
+  }
+  }
+}
+
+inline JsonEvent JsonPullParser::next() {
+
+  if (!skip_whitespace()) {
+    if (!containers_.empty()) {
+      fail("Missing closing braces or brackets.");
+    }
+    return make_event(last_ = JsonEvent::Type::End);
+  }
+
+  char c = buffer_[pos_];
+  JsonEvent event;
+
+  switch (expect_) {
+  case Expect::ValueOrEnd:
+    if (c == ']') {
+      ++pos_;
+      containers_.pop_back();
+      event = make_event(JsonEvent::Type::EndArray);
+      end_value();
+      break;
+    }
+    [[fallthrough]];
+  case Expect::Value:
+    event = value_event(c);
+    break;
+
+  case Expect::KeyOrEnd:
+    if (c == '}') {
+      ++pos_;
+      containers_.pop_back();
+      event = make_event(JsonEvent::Type::EndObject);
+      end_value();
+      break;
+    }
+    [[fallthrough]];
+  case Expect::Key: {
+    if (c != '"') {
+      fail("Object keys must be strings.");
+    }
+    event = make_event(JsonEvent::Type::Key);
+    event.text = scan_string();
+    // The colon is read by the next call, since reading more input could
+    // move the key.
+    expect_ = Expect::Colon;
+    break;
+  }
+
+  case Expect::Colon:
+    if (c != ':') {
+      fail("Key string must be followed by colon");
+    }
+    ++pos_;
+    expect_ = Expect::Value;
+    return next();
+
+  case Expect::CommaOrEnd: {
+    char open = containers_.back();
+    ++pos_;
+    if (c == ',') {
+      expect_ = (open == '{') ? Expect::Key : Expect::Value;
+      return next();
+    } else if ((c == '}' && open == '{') || (c == ']' && open == '[')) {
+      containers_.pop_back();
+      event = make_event(open == '{' ? JsonEvent::Type::EndObject
+                                     : JsonEvent::Type::EndArray);
+      end_value();
+    } else {
+      fail("Expected a comma or a matching closing bracket.");
+    }
+    break;
+  }
+  }
+
+  last_ = event.type;
+  return event;
+}
+
+inline void JsonPullParser::skip() {
+  std::size_t depth = containers_.size();
+  bool in_container = last_ == JsonEvent::Type::StartObject ||
+                      last_ == JsonEvent::Type::StartArray;
+  if (!in_container) {
+    auto event = next();
+    if (event.type != JsonEvent::Type::StartObject &&
+        event.type != JsonEvent::Type::StartArray) {
+      return;
+    }
+    depth = containers_.size();
+  }
+  // Read until the container opened at depth is closed.
+  while (containers_.size() >= depth) {
+    if (next().type == JsonEvent::Type::End) {
+      fail("Missing closing braces or brackets.");
+    }
+  }
+}
+
+inline Json JsonPullParser::read_json() {
+
+  Json json;
+  std::vector<Json *> open; // containers being filled, innermost last
+  Json *slot = &json;
+
+  do {
+    auto event = next();
+
+    if (event.type == JsonEvent::Type::End) {
+      fail("Missing value.");
+    }
+    bool is_end = event.type == JsonEvent::Type::EndObject ||
+                  event.type == JsonEvent::Type::EndArray;
+    if (open.empty() && (is_end || event.type == JsonEvent::Type::Key)) {
+      throw std::logic_error("read_json() must be called before a value");
+    }
+    if (is_end) {
+      open.pop_back();
+      continue;
+    }
+    if (event.type == JsonEvent::Type::Key) {
+      slot = &(*open.back())[std::string(event.text)];
+      continue;
+    }
+    if (!open.empty() && open.back()->is_array()) {
+      open.back()->push_back(Json());
+      slot = &open.back()->back();
+    }
+
+    switch (event.type) {
+    case JsonEvent::Type::StartObject:
+      *slot = JsonObject{};
+      open.push_back(slot);
+      break;
+    case JsonEvent::Type::StartArray:
+      *slot = JsonArray{};
+      open.push_back(slot);
+      break;
+    case JsonEvent::Type::String:
+      *slot = std::string(event.text);
+      break;
+    case JsonEvent::Type::Number:
+      *slot = event.number;
+      break;
+    case JsonEvent::Type::Bool:
+      *slot = event.boolean;
+      break;
+    default:
+      *slot = nullptr;
+      break;
+    }
+  } while (!open.empty());
+
+  return json;
+}
+
+inline bool sax_parse(JsonPullParser &parser, JsonHandler &handler) {
+  for (;;) {
+    auto event = parser.next();
+    bool go_on = true;
+    switch (event.type) {
+    case JsonEvent::Type::StartObject:
+      go_on = handler.on_start_object();
+      break;
+    case JsonEvent::Type::EndObject:
+      go_on = handler.on_end_object();
+      break;
+    case JsonEvent::Type::StartArray:
+      go_on = handler.on_start_array();
+      break;
+    case JsonEvent::Type::EndArray:
+      go_on = handler.on_end_array();
+      break;
+    case JsonEvent::Type::Key:
+      go_on = handler.on_key(event.text);
+      break;
+    case JsonEvent::Type::String:
+      go_on = handler.on_string(event.text);
+      break;
+    case JsonEvent::Type::Number:
+      go_on = handler.on_number(event.number);
+      break;
+    case JsonEvent::Type::Bool:
+      go_on = handler.on_bool(event.boolean);
+      break;
+    case JsonEvent::Type::Null:
+      go_on = handler.on_null();
+      break;
+    case JsonEvent::Type::End:
+      return true;
+    }
+    if (!go_on) {
+      return false;
+    }
+  }
+}
+
+inline bool sax_parse(std::istream &is, JsonHandler &handler,
+                      std::size_t chunk_size) {
+  JsonPullParser parser(is, chunk_size);
+  return sax_parse(parser, handler);
+}
+
+inline bool sax_parse(int fd, JsonHandler &handler, std::size_t chunk_size) {
+  JsonPullParser parser(fd, chunk_size);
+  return sax_parse(parser, handler);
+}
+
+inline bool sax_parse_file(const std::string &filename, JsonHandler &handler,
+                           std::size_t chunk_size) {
+#ifdef _WIN32
+  int fd = ::_open(filename.c_str(), _O_RDONLY | _O_BINARY);
+#else
+  int fd = ::open(filename.c_str(), O_RDONLY);
+#endif
+  if (fd < 0) {
+    throw std::runtime_error("Could not open file");
+  }
+
+  struct fd_closer {
+    int fd;
+#ifdef _WIN32
+    ~fd_closer() { ::_close(fd); }
+#else
+    ~fd_closer() { ::close(fd); }
+#endif
+  } closer{fd};
+
+  return sax_parse(fd, handler, chunk_size);
+}
+
+} // namespace utils
@@ -32,19 +32,55 @@
  *   Logger::show_group = true;    // prepends group; defaults to true
  *   Logger::newline = true;       // prepends newline; defaults to true
  *
+ *   // Runtime levels, checked before any formatting. LOG logs at info, which
+ *   // is every group's default level.
+ *   Logger::configure("warn,groupB=debug");
+ *   LOG_AT(groupB, debug) << "shown";
+ *   LOG(groupA) << "hidden until groupA's level is info or lower";
+ *
  *   myfunc();  // Only GroupA and GroupB will be logged.
  * }
  *
  * // Note, if you have a function such as print(std::ostream& os), you can also
  * // use it to write to a log group with print(LOG(groupA)), for example.
+ *
+ *
+ * // Asynchronous logging:
+ * //
+ * // By default every LOG statement writes to the log stream under a global
+ * // mutex. After AsyncLogger::start(), LOG statements only append a record to
+ * // a ring buffer owned by the calling thread, and a background thread writes
+ * // them out. Call AsyncLogger::stop() (or flush()) before reading the output.
+ *
+ * AsyncLogOptions options;
+ * options.overflow = LogOverflow::drop;     // when a thread's ring is full
+ * options.deferred_formatting = true;       // format numbers on the flusher
+ * AsyncLogger::start(options);
+ * myfunc();
+ * AsyncLogger::stop();
  */
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 // To ensure every time logger is included, user has access to print
 // convenience functions and STL container operator<< overloads.
@@ -58,6 +94,9 @@ struct _logger_impl_group_enabled {
 #define CREATE_LOG_GROUP(group_name)                                           \
   struct _logger_impl_##group_name {                                           \
     static constexpr const char *name = #group_name;                           \
+    inline static std::atomic<LogLevel> level{LogLevel::info};                 \
+    inline static const bool registered =                                      \
+        Logger::register_group(name, level);                                   \
   };
 
 #define ENABLE_LOG_GROUP(group_name)                                           \
@@ -71,35 +110,46 @@ struct _logger_impl_group_enabled {
 #define ENABLE_LOG_GROUPS(...) MAP(ENABLE_LOG_GROUP, __VA_ARGS__)
 #define CREATE_LOG_GROUPS(...) MAP(CREATE_LOG_GROUP, __VA_ARGS__)
 
-// LOG is now a macro that uses LogStream
-#define LOG(group_name)                                                        \
+// Sets the runtime level of a group, e.g. SET_LOG_LEVEL(groupA, debug).
+#define SET_LOG_LEVEL(group_name, log_level)                                   \
+  _logger_impl_##group_name::level.store(LogLevel::log_level,                  \
+                                         std::memory_order_relaxed)
+
+// Groups disabled at compile time cost nothing. For enabled groups, the
+// runtime level is a single relaxed atomic load, done before the LogStream
+// is built, so filtered messages never format their arguments.
+#define LOGGER_IMPL_IF_ENABLED(group_name, log_level)                          \
   if constexpr (!_logger_impl_group_enabled<                                   \
                     _logger_impl_##group_name>::value) {                       \
-  } else                                                                       \
-    LogStream<_logger_impl_##group_name>()
+  } else if (!Logger::enabled<_logger_impl_##group_name>(log_level)) {         \
+  } else
+
+// LOG is now a macro that uses LogStream. It logs at LogLevel::info.
+#define LOG(group_name)                                                        \
+  LOGGER_IMPL_IF_ENABLED(group_name, LogLevel::info)                           \
+  LogStream<_logger_impl_##group_name>()
+
+// LOG_AT is LOG at a given level, e.g. LOG_AT(groupA, debug).
+#define LOG_AT(group_name, log_level)                                          \
+  LOGGER_IMPL_IF_ENABLED(group_name, LogLevel::log_level)                      \
+  LogStream<_logger_impl_##group_name>()
 
 // LOG_NN is LOG with "No Newline" at the end.
 #define LOG_NN(group_name)                                                     \
-  if constexpr (!_logger_impl_group_enabled<                                   \
-                    _logger_impl_##group_name>::value) {                       \
-  } else                                                                       \
-    LogStream<_logger_impl_##group_name>(Logger::show_time,                    \
-                                         Logger::show_group, false)
+  LOGGER_IMPL_IF_ENABLED(group_name, LogLevel::info)                           \
+  LogStream<_logger_impl_##group_name>(Logger::show_time, Logger::show_group,  \
+                                       false)
 
 // LOG_NP is LOG with "No Prefix" at the beginning (that is, neither show_time
 // nor show_group).
 #define LOG_NP(group_name)                                                     \
-  if constexpr (!_logger_impl_group_enabled<                                   \
-                    _logger_impl_##group_name>::value) {                       \
-  } else                                                                       \
-    LogStream<_logger_impl_##group_name>(false, false, Logger::newline)
+  LOGGER_IMPL_IF_ENABLED(group_name, LogLevel::info)                           \
+  LogStream<_logger_impl_##group_name>(false, false, Logger::newline)
 
 // LOG_NNP is LOG with "No Newline" and "No Prefix".
 #define LOG_NNP(group_name)                                                    \
-  if constexpr (!_logger_impl_group_enabled<                                   \
-                    _logger_impl_##group_name>::value) {                       \
-  } else                                                                       \
-    LogStream<_logger_impl_##group_name>(false, false, false)
+  LOGGER_IMPL_IF_ENABLED(group_name, LogLevel::info)                           \
+  LogStream<_logger_impl_##group_name>(false, false, false)
 
 // ========== Variadic Macro Map ===========
 // This is taken pretty much verbatim from the amazing solution by William
@@ -155,15 +205,94 @@ struct _logger_impl_group_enabled {
 #define MAP(f, ...) EVAL(MAP1(f, __VA_ARGS__, (), 0))
 // ==========================================
 
-inline std::string get_current_time() {
-  auto now = std::chrono::system_clock::now();
-  auto now_time_t = std::chrono::system_clock::to_time_t(now);
-  auto tm = std::localtime(&now_time_t);
+namespace _logger_impl {
+
+// Formats a timestamp like "2023-01-31 12:34:56".
+inline std::string format_time(std::chrono::system_clock::time_point time) {
+  auto time_t = std::chrono::system_clock::to_time_t(time);
+  std::tm tm{};
+#ifdef _WIN32
+  localtime_s(&tm, &time_t);
+#else
+  localtime_r(&time_t, &tm);
+#endif
   std::stringstream time_stream;
-  time_stream << std::put_time(tm, "%Y-%m-%d %H:%M:%S");
+  time_stream << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
   return time_stream.str();
 }
 
+using log_clock = std::chrono::steady_clock;
+
+/**
+ * Turns steady clock readings into wall clock timestamps. The formatted
+ * "%Y-%m-%d %H:%M:%S" prefix is cached and only rebuilt when the second
+ * changes, and the wall clock is re-read at most once per second, so a
+ * timestamp costs one steady_clock::now() on the logging thread.
+ */
+class timestamp_cache {
+  std::chrono::system_clock::time_point anchor_system{};
+  log_clock::time_point anchor_steady{};
+  bool anchored = false;
+  std::chrono::system_clock::time_point cached_second{};
+  std::string prefix;
+
+public:
+  void write(std::ostream &os, log_clock::time_point time, int decimals) {
+    using namespace std::chrono;
+    if (!anchored || time - anchor_steady > seconds(1)) {
+      anchor_system = system_clock::now();
+      anchor_steady = log_clock::now();
+      anchored = true;
+    }
+    write_wall(os,
+               anchor_system +
+                   duration_cast<system_clock::duration>(time - anchor_steady),
+               decimals);
+  }
+
+  /// Writes a wall clock time, with 'decimals' digits of the second.
+  void write_wall(std::ostream &os, std::chrono::system_clock::time_point wall,
+                  int decimals) {
+    using namespace std::chrono;
+    auto second = floor<seconds>(wall);
+    if (prefix.empty() || second != cached_second) {
+      prefix = format_time(second);
+      cached_second = second;
+    }
+    os << prefix;
+    if (decimals > 0) {
+      auto fraction = duration_cast<nanoseconds>(wall - second).count();
+      for (int i = decimals; i < 9; ++i) {
+        fraction /= 10;
+      }
+      char digits[9];
+      for (int i = decimals - 1; i >= 0; --i) {
+        digits[i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+      }
+      os << '.';
+      os.write(digits, decimals);
+    }
+  }
+};
+
+inline void write_timestamp(std::ostream &os, log_clock::time_point time,
+                            int decimals) {
+  thread_local timestamp_cache cache;
+  cache.write(os, time, decimals);
+}
+
+} // namespace _logger_impl
+
+inline std::string get_current_time() {
+  return _logger_impl::format_time(std::chrono::system_clock::now());
+}
+
+/**
+ * Severity of a message. A group logs the messages at or above its level.
+ */
+enum class LogLevel { trace, debug, info, warn, error, off };
+
 /**
  * This is mostly just a struct with logging settings.
  */
@@ -173,45 +302,703 @@ struct Logger {
   inline static bool show_time = false;
   inline static bool show_group = true;
   inline static bool newline = true;
+  /// Digits of the fraction of a second in timestamps, from 0 to 9.
+  inline static int time_decimals = 0;
   static void set_log_stream(std::ostream &s) { log_stream = &s; }
+
+  /// Whether a group created with CREATE_LOG_GROUP logs at 'level'.
+  template <typename Group>
+  static bool enabled(LogLevel level) noexcept {
+    return level >= Group::level.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Sets the runtime level of the group called 'group'.
+   * @return false if no such group was created.
+   */
+  static bool set_level(std::string_view group, LogLevel level) {
+    std::scoped_lock<std::mutex> guard(registry().mutex);
+    bool found = false;
+    for (auto &[name, group_level] : registry().groups) {
+      if (name == group) {
+        group_level->store(level, std::memory_order_relaxed);
+        found = true;
+      }
+    }
+    return found;
+  }
+
+  /// Sets the runtime level of every group.
+  static void set_level(LogLevel level) {
+    std::scoped_lock<std::mutex> guard(registry().mutex);
+    for (auto &[name, group_level] : registry().groups) {
+      group_level->store(level, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Sets levels from a comma-separated list such as "warn,net=debug,db=off",
+   * e.g. read from an environment variable. A bare level applies to every
+   * group; later entries override earlier ones.
+   * @throws std::invalid_argument on an unknown level or group.
+   */
+  static void configure(std::string_view spec) {
+    while (!spec.empty()) {
+      auto comma = spec.find(',');
+      auto entry = spec.substr(0, comma);
+      spec = comma == std::string_view::npos ? std::string_view{}
+                                             : spec.substr(comma + 1);
+      if (entry.empty()) {
+        continue;
+      }
+      auto equals = entry.find('=');
+      if (equals == std::string_view::npos) {
+        set_level(parse_level(entry));
+      } else if (!set_level(entry.substr(0, equals),
+                            parse_level(entry.substr(equals + 1)))) {
+        throw std::invalid_argument("Logger: unknown log group '" +
+                                    std::string(entry.substr(0, equals)) +
+                                    "'");
+      }
+    }
+  }
+
+  static LogLevel parse_level(std::string_view name) {
+    constexpr std::pair<std::string_view, LogLevel> names[] = {
+        {"trace", LogLevel::trace}, {"debug", LogLevel::debug},
+        {"info", LogLevel::info},   {"warn", LogLevel::warn},
+        {"error", LogLevel::error}, {"off", LogLevel::off}};
+    for (auto [level_name, level] : names) {
+      if (level_name == name) {
+        return level;
+      }
+    }
+    throw std::invalid_argument("Logger: unknown log level '" +
+                                std::string(name) + "'");
+  }
+
+  /// Called by CREATE_LOG_GROUP, so that groups can be found by name.
+  static bool register_group(const char *name, std::atomic<LogLevel> &level) {
+    std::scoped_lock<std::mutex> guard(registry().mutex);
+    registry().groups.emplace_back(name, &level);
+    return true;
+  }
+
+private:
+  struct group_registry {
+    std::mutex mutex;
+    std::vector<std::pair<std::string_view, std::atomic<LogLevel> *>> groups;
+  };
+
+  // A function-local static, since groups register during static
+  // initialization, in any order.
+  static group_registry &registry() {
+    static group_registry r;
+    return r;
+  }
+};
+
+/**
+ * What a LOG statement does when its thread's ring buffer is full.
+ */
+enum class LogOverflow {
+  block, ///< Wait for the flusher to make room.
+  drop,  ///< Discard the message.
+  count  ///< Discard the message, and log how many were dropped.
+};
+
+/**
+ * Settings of the asynchronous backend, see AsyncLogger::start.
+ */
+struct AsyncLogOptions {
+  /// Records per thread ring buffer. Must be a power of two.
+  std::size_t queue_capacity = 1024;
+  LogOverflow overflow = LogOverflow::block;
+  /// If true, arithmetic values, enums and manipulators are copied into the
+  /// record and formatted by the flusher thread. Other values are still
+  /// formatted by the calling thread, with default stream flags.
+  bool deferred_formatting = false;
+  /// How often the flusher wakes up when nobody asks it to.
+  std::chrono::microseconds flush_interval = std::chrono::milliseconds(1);
+};
+
+namespace _logger_impl {
+
+/**
+ * Appends everything written to it to a string, which keeps its capacity
+ * between messages.
+ */
+class text_buffer : public std::streambuf {
+public:
+  std::string text;
+
+protected:
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      text.push_back(traits_type::to_char_type(c));
+    }
+    return traits_type::not_eof(c);
+  }
+
+  std::streamsize xsputn(const char *s, std::streamsize n) override {
+    text.append(s, static_cast<std::size_t>(n));
+    return n;
+  }
+};
+
+struct format_stream {
+  text_buffer buffer;
+  std::ostream os{&buffer};
+};
+
+struct format_stream_stack {
+  std::vector<std::unique_ptr<format_stream>> streams;
+  std::size_t depth = 0;
+};
+
+// Each thread reuses its own format streams instead of building an
+// ostringstream per message. There is one per nesting level, in case
+// formatting a logged value logs something itself.
+inline format_stream_stack &format_streams() {
+  thread_local format_stream_stack stack;
+  return stack;
+}
+
+inline format_stream &acquire_format_stream() {
+  format_stream_stack &stack = format_streams();
+  if (stack.depth == stack.streams.size()) {
+    stack.streams.push_back(std::make_unique<format_stream>());
+  }
+  format_stream &fs = *stack.streams[stack.depth++];
+  fs.buffer.text.clear();
+  fs.os.clear();
+  fs.os.flags(std::ios_base::dec | std::ios_base::skipws);
+  fs.os.precision(6);
+  fs.os.width(0);
+  fs.os.fill(' ');
+  return fs;
+}
+
+inline void release_format_stream() { --format_streams().depth; }
+
+// Restores the formatting state of a stream on destruction, so that
+// manipulators in one message do not leak into the next.
+class format_guard {
+  std::ostream &os;
+  std::ios_base::fmtflags flags;
+  std::streamsize precision;
+  std::streamsize width;
+  char fill;
+
+public:
+  explicit format_guard(std::ostream &os)
+      : os{os}, flags{os.flags()}, precision{os.precision()},
+        width{os.width()}, fill{os.fill()} {}
+  ~format_guard() {
+    os.flags(flags);
+    os.precision(precision);
+    os.width(width);
+    os.fill(fill);
+  }
+};
+
+template <typename T>
+inline constexpr bool is_deferrable_v =
+    std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+    std::is_same_v<T, std::ios_base &(*)(std::ios_base &)> ||
+    std::is_same_v<T, std::ostream &(*)(std::ostream &)>;
+
+/**
+ * One log message. The payload is a sequence of entries in a fixed buffer,
+ * each a writer function, a size and the bytes it reads: either text, or a
+ * copy of a deferrable value. Whatever does not fit goes to 'spill' as text.
+ */
+class log_record {
+public:
+  static constexpr std::size_t capacity = 192;
+
+  const char *group = "";
+  log_clock::time_point time{};
+  int time_decimals = 0;
+  bool show_time = false;
+  bool show_group = true;
+  bool newline = true;
+
+  void append_text(std::string_view text) {
+    if (!append(&write_text, text.data(), text.size())) {
+      spill.append(text);
+    }
+  }
+
+  template <typename T>
+  void append_value(const T &value) {
+    static_assert(is_deferrable_v<T>);
+    if (!append(&write_value<T>, &value, sizeof(T))) {
+      format_stream &fs = acquire_format_stream();
+      fs.os << value;
+      spill += fs.buffer.text;
+      release_format_stream();
+    }
+  }
+
+  void write_payload(std::ostream &os) const {
+    std::size_t pos = 0;
+    while (pos < size) {
+      writer w;
+      std::uint32_t n;
+      std::memcpy(&w, buffer + pos, sizeof(w));
+      std::memcpy(&n, buffer + pos + sizeof(w), sizeof(n));
+      pos += header_size;
+      w(os, buffer + pos, n);
+      pos += n;
+    }
+    os << spill;
+  }
+
+private:
+  using writer = void (*)(std::ostream &, const unsigned char *, std::size_t);
+  static constexpr std::size_t header_size =
+      sizeof(writer) + sizeof(std::uint32_t);
+
+  static void write_text(std::ostream &os, const unsigned char *data,
+                         std::size_t n) {
+    os.write(reinterpret_cast<const char *>(data),
+             static_cast<std::streamsize>(n));
+  }
+
+  template <typename T>
+  static void write_value(std::ostream &os, const unsigned char *data,
+                          std::size_t) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    os << value;
+  }
+
+  // Entries must stay in order, so once something spilled, everything after
+  // it spills too.
+  bool append(writer w, const void *data, std::size_t n) {
+    if (!spill.empty() || n > capacity || size + header_size + n > capacity) {
+      return false;
+    }
+    auto length = static_cast<std::uint32_t>(n);
+    std::memcpy(buffer + size, &w, sizeof(w));
+    std::memcpy(buffer + size + sizeof(w), &length, sizeof(length));
+    std::memcpy(buffer + size + header_size, data, n);
+    size += header_size + n;
+    return true;
+  }
+
+  std::size_t size = 0;
+  unsigned char buffer[capacity] = {};
+  std::string spill;
+};
+
+inline void write_record(std::ostream &os, const log_record &record) {
+  format_guard guard(os);
+  if (record.show_time) {
+    write_timestamp(os, record.time, record.time_decimals);
+    os << " -- ";
+  }
+  if (record.show_group) {
+    os << "[" << record.group << "]: ";
+  }
+  record.write_payload(os);
+  if (record.newline) {
+    os << '\n';
+  }
+}
+
+/**
+ * Single-producer single-consumer ring of records, owned by one logging
+ * thread and drained by the flusher.
+ */
+class log_ring {
+  std::unique_ptr<log_record[]> slots;
+  std::size_t mask;
+  alignas(64) std::atomic<std::size_t> head{0};
+  alignas(64) std::atomic<std::size_t> tail{0};
+
+public:
+  /// Set when the owning thread exits; the ring is removed once empty.
+  std::atomic<bool> orphaned{false};
+
+  explicit log_ring(std::size_t capacity)
+      : slots{std::make_unique<log_record[]>(capacity)}, mask{capacity - 1} {}
+
+  /// Moves 'record' in and returns true, or returns false if the ring is
+  /// full. Returns the number of queued records in 'queued'.
+  bool try_push(log_record &record, std::size_t &queued) noexcept {
+    std::size_t t = tail.load(std::memory_order_relaxed);
+    queued = t - head.load(std::memory_order_acquire);
+    if (queued > mask) {
+      return false;
+    }
+    slots[t & mask] = std::move(record);
+    tail.store(t + 1, std::memory_order_release);
+    ++queued;
+    return true;
+  }
+
+  template <typename F>
+  void drain(F &&f) {
+    std::size_t h = head.load(std::memory_order_relaxed);
+    std::size_t t = tail.load(std::memory_order_acquire);
+    for (; h != t; ++h) {
+      f(slots[h & mask]);
+    }
+    head.store(t, std::memory_order_release);
+  }
+
+  bool empty() const noexcept {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+
+  std::size_t capacity() const noexcept { return mask + 1; }
+};
+
+// A thread's ring, tagged with the AsyncLogger::start call it belongs to.
+struct ring_handle {
+  std::shared_ptr<log_ring> ring;
+  std::uint64_t generation = 0;
+
+  void reset(std::shared_ptr<log_ring> new_ring, std::uint64_t new_generation) {
+    if (ring) {
+      ring->orphaned.store(true, std::memory_order_release);
+    }
+    ring = std::move(new_ring);
+    generation = new_generation;
+  }
+
+  ~ring_handle() { reset(nullptr, 0); }
+};
+
+/**
+ * State of the asynchronous backend. LOG statements count themselves in
+ * 'in_flight' before checking 'running', and stop() clears 'running' before
+ * waiting for 'in_flight' to drop to zero, so that no record is pushed after
+ * the flusher's final drain.
+ */
+class async_state {
+public:
+  ~async_state() { stop(); }
+
+  void start(const AsyncLogOptions &new_options) {
+    if (new_options.queue_capacity < 2 ||
+        (new_options.queue_capacity & (new_options.queue_capacity - 1)) != 0) {
+      throw std::invalid_argument(
+          "AsyncLogger: queue_capacity must be a power of two >= 2");
+    }
+    std::scoped_lock<std::mutex> control(control_mutex);
+    stop_locked();
+    options = new_options;
+    overflow.store(options.overflow);
+    deferred.store(options.deferred_formatting);
+    stop_requested = false;
+    flusher_done = false;
+    reported_drops = dropped.load();
+    generation.fetch_add(1);
+    flusher = std::thread([this] { run(); });
+    running.store(true);
+  }
+
+  void stop() {
+    std::scoped_lock<std::mutex> control(control_mutex);
+    stop_locked();
+  }
+
+  /**
+   * Waits until every record submitted before the call is written and the
+   * stream flushed. A stop() racing with the call is safe: either the flusher
+   * has not yet taken its final pass, which completes every outstanding
+   * request, or it has, and the records are already written.
+   */
+  void flush() {
+    if (!running.load()) {
+      flush_stream();
+      return;
+    }
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    if (stop_requested) {
+      lock.unlock();
+      flush_stream();
+      return;
+    }
+    std::uint64_t target = ++flush_requested;
+    wake_cv.notify_one();
+    flushed_cv.wait(lock, [&] {
+      return flush_completed >= target || (stop_requested && flusher_done);
+    });
+  }
+
+  bool submit(log_record &record) {
+    in_flight.fetch_add(1);
+    if (!running.load()) {
+      in_flight.fetch_sub(1);
+      return false;
+    }
+
+    log_ring &ring = local_ring();
+    std::size_t queued;
+    while (!ring.try_push(record, queued)) {
+      if (overflow.load(std::memory_order_relaxed) != LogOverflow::block) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        break;
+      }
+      wake_flusher();
+      std::this_thread::yield();
+    }
+    if (queued >= ring.capacity() / 2) {
+      wake_flusher();
+    }
+
+    in_flight.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  std::atomic<bool> running{false};
+  std::atomic<bool> deferred{false};
+  std::atomic<LogOverflow> overflow{LogOverflow::block};
+  std::atomic<std::size_t> dropped{0};
+
+private:
+  static void flush_stream() {
+    std::scoped_lock<std::mutex> guard(Logger::log_mutex);
+    Logger::log_stream->flush();
+  }
+
+  void stop_locked() {
+    if (!running.load()) {
+      return;
+    }
+    running.store(false);
+    while (in_flight.load() != 0) {
+      std::this_thread::yield();
+    }
+    {
+      std::scoped_lock<std::mutex> lock(wake_mutex);
+      stop_requested = true;
+    }
+    wake_cv.notify_one();
+    flusher.join();
+    rings.clear();
+  }
+
+  log_ring &local_ring() {
+    thread_local ring_handle handle;
+    std::uint64_t current = generation.load(std::memory_order_acquire);
+    if (!handle.ring || handle.generation != current) {
+      auto ring = std::make_shared<log_ring>(options.queue_capacity);
+      {
+        std::scoped_lock<std::mutex> lock(registry_mutex);
+        rings.push_back(ring);
+      }
+      handle.reset(std::move(ring), current);
+    }
+    return *handle.ring;
+  }
+
+  void wake_flusher() {
+    if (!wake.exchange(true, std::memory_order_relaxed)) {
+      wake_cv.notify_one();
+    }
+  }
+
+  void run() {
+    format_stream out;
+    std::vector<std::shared_ptr<log_ring>> snapshot;
+
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    while (true) {
+      wake_cv.wait_for(lock, options.flush_interval, [&] {
+        return stop_requested || flush_requested != flush_completed ||
+               wake.load(std::memory_order_relaxed);
+      });
+      wake.store(false, std::memory_order_relaxed);
+      bool stopping = stop_requested;
+      std::uint64_t target = flush_requested;
+      lock.unlock();
+
+      {
+        std::scoped_lock<std::mutex> registry(registry_mutex);
+        snapshot = rings;
+      }
+      for (auto &ring : snapshot) {
+        ring->drain([&](const log_record &r) { write_record(out.os, r); });
+      }
+      std::size_t drops = dropped.load(std::memory_order_relaxed);
+      if (drops != reported_drops &&
+          overflow.load(std::memory_order_relaxed) == LogOverflow::count) {
+        out.os << "[logger]: " << drops - reported_drops
+               << " messages dropped\n";
+      }
+      reported_drops = drops;
+
+      if (!out.buffer.text.empty() || target != flush_completed || stopping) {
+        std::scoped_lock<std::mutex> guard(Logger::log_mutex);
+        Logger::log_stream->write(
+            out.buffer.text.data(),
+            static_cast<std::streamsize>(out.buffer.text.size()));
+        if (target != flush_completed || stopping) {
+          Logger::log_stream->flush();
+        }
+      }
+      out.buffer.text.clear();
+
+      {
+        std::scoped_lock<std::mutex> registry(registry_mutex);
+        rings.erase(std::remove_if(rings.begin(), rings.end(),
+                                   [](const std::shared_ptr<log_ring> &r) {
+                                     return r->orphaned.load(
+                                                std::memory_order_acquire) &&
+                                            r->empty();
+                                   }),
+                    rings.end());
+      }
+      snapshot.clear();
+
+      lock.lock();
+      if (stopping) {
+        // flush() makes no new request once stop_requested is set, so this
+        // final pass answers every outstanding one.
+        flush_completed = flush_requested;
+        flusher_done = true;
+        flushed_cv.notify_all();
+        break;
+      }
+      if (target != flush_completed) {
+        flush_completed = target;
+        flushed_cv.notify_all();
+      }
+    }
+  }
+
+  AsyncLogOptions options;
+  std::atomic<std::size_t> in_flight{0};
+  std::atomic<std::uint64_t> generation{0};
+  std::atomic<bool> wake{false};
+  // Drops already reported by the flusher, for LogOverflow::count.
+  std::size_t reported_drops = 0;
+
+  std::mutex control_mutex;
+  std::thread flusher;
+
+  std::mutex registry_mutex;
+  std::vector<std::shared_ptr<log_ring>> rings;
+
+  std::mutex wake_mutex;
+  std::condition_variable wake_cv;
+  std::condition_variable flushed_cv;
+  bool stop_requested = false;
+  // Set by the flusher after its final pass.
+  bool flusher_done = false;
+  std::uint64_t flush_requested = 0;
+  std::uint64_t flush_completed = 0;
+};
+
+} // namespace _logger_impl
+
+/**
+ * Switches LOG statements to an asynchronous backend: each thread appends
+ * records to its own lock-free ring buffer, and a background thread formats
+ * and writes them to Logger::log_stream. Groups disabled at compile time cost
+ * nothing either way.
+ */
+struct AsyncLogger {
+  /**
+   * Starts the flusher thread, restarting it if already running.
+   * @throws std::invalid_argument if queue_capacity is not a power of two.
+   */
+  static void start(AsyncLogOptions options = {}) { state.start(options); }
+
+  /// Writes out every queued record and stops the flusher thread. LOG
+  /// statements are synchronous again afterwards.
+  static void stop() { state.stop(); }
+
+  /// Blocks until every record queued before the call has been written out.
+  static void flush() { state.flush(); }
+
+  static bool running() noexcept { return state.running.load(); }
+
+  static bool deferred_formatting() noexcept {
+    return state.deferred.load(std::memory_order_relaxed);
+  }
+
+  /// Number of messages dropped because a ring buffer was full.
+  static std::size_t dropped() noexcept { return state.dropped.load(); }
+
+  /// Queues a finished record. Returns false, leaving the record untouched,
+  /// if the backend is not running.
+  static bool submit(_logger_impl::log_record &record) {
+    return state.submit(record);
+  }
+
+private:
+  inline static _logger_impl::async_state state;
 };
 
 /**
  * This class does the actual logging. It is created and destroyed with each
- * call to LOG macro.
+ * call to LOG macro. Values are formatted into a reusable per-thread stream
+ * (or copied, with deferred formatting), and the finished record is either
+ * queued to the AsyncLogger or written out under Logger::log_mutex.
  */
 template <typename Group>
 class LogStream {
 
-  std::ostringstream ss;
-
-  bool show_time = Logger::show_time;
-  bool show_group = Logger::show_group;
-  bool newline = Logger::newline;
+  _logger_impl::log_record record;
+  _logger_impl::format_stream *eager = nullptr;
+  bool deferred = AsyncLogger::deferred_formatting();
 
 public:
-  LogStream() = default;
+  LogStream() : LogStream(Logger::show_time, Logger::show_group, Logger::newline) {}
 
-  LogStream(bool show_time, bool show_group, bool newline)
-      : ss{}, show_time{show_time}, show_group{show_group}, newline{newline} {}
+  LogStream(bool show_time, bool show_group, bool newline) {
+    record.group = Group::name;
+    record.show_time = show_time;
+    record.show_group = show_group;
+    record.newline = newline;
+    if (show_time) {
+      record.time = _logger_impl::log_clock::now();
+      record.time_decimals = std::clamp(Logger::time_decimals, 0, 9);
+    }
+  }
+
+  LogStream(const LogStream &) = delete;
+  LogStream &operator=(const LogStream &) = delete;
 
   template <typename T>
   LogStream &operator<<(const T &value) {
-    ss << value;
+    using U = std::decay_t<T>;
+    if (deferred) {
+      if constexpr (_logger_impl::is_deferrable_v<U>) {
+        const U copy = value;
+        record.append_value(copy);
+      } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+        record.append_text(std::string_view(value));
+      } else {
+        auto &fs = _logger_impl::acquire_format_stream();
+        fs.os << value;
+        record.append_text(fs.buffer.text);
+        _logger_impl::release_format_stream();
+      }
+      return *this;
+    }
+    if (!eager) {
+      eager = &_logger_impl::acquire_format_stream();
+    }
+    eager->os << value;
     return *this;
   }
 
   ~LogStream() {
-    std::scoped_lock<std::mutex> guard(Logger::log_mutex);
-    if (show_time) {
-      *Logger::log_stream << get_current_time() << " -- ";
-    }
-    if (show_group) {
-      *Logger::log_stream << "[" << Group::name << "]: ";
+    if (eager) {
+      record.append_text(eager->buffer.text);
+      _logger_impl::release_format_stream();
     }
-    *Logger::log_stream << ss.str();
-    if (newline) {
-      *Logger::log_stream << '\n';
+    if (!AsyncLogger::submit(record)) {
+      std::scoped_lock<std::mutex> guard(Logger::log_mutex);
+      _logger_impl::write_record(*Logger::log_stream, record);
     }
   }
 };
@@ -0,0 +1,129 @@
+/**********************************************************************
+ * @brief A fixed-capacity cache that evicts the least recently used entry.
+ * @details Entries live in a list ordered from most to least recently used,
+ *and a hash map from keys to list nodes makes lookups, insertions and
+ *evictions O(1). Nodes are never moved in memory, so a pointer returned by
+ *find() stays valid until that entry is evicted or erased.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace utils {
+
+/**
+ * @brief Least-recently-used cache holding at most capacity() entries. Not
+ * thread-safe.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class LruCache {
+public:
+  using entry_type = std::pair<const Key, Value>;
+  using const_iterator = typename std::list<entry_type>::const_iterator;
+
+  /// @throws std::invalid_argument if capacity is 0
+  explicit LruCache(std::size_t capacity) : capacity_(capacity) {
+    if (capacity_ == 0) {
+      throw std::invalid_argument("LruCache: capacity must be positive");
+    }
+    index_.reserve(capacity_);
+  }
+
+  std::size_t size() const noexcept { return entries_.size(); }
+  std::size_t capacity() const noexcept { return capacity_; }
+  bool empty() const noexcept { return entries_.empty(); }
+
+  /// Lookups through find() that found their key, and that did not.
+  std::size_t hits() const noexcept { return hits_; }
+  std::size_t misses() const noexcept { return misses_; }
+
+  bool contains(const Key &key) const { return index_.contains(key); }
+
+  /**
+   * @brief The value of key, marked as most recently used, or nullptr.
+   */
+  Value *find(const Key &key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      ++misses_;
+      return nullptr;
+    }
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->second;
+  }
+
+  /**
+   * @brief Inserts or replaces the value of key and marks it as most
+   * recently used, evicting the least recently used entry if the cache is
+   * full.
+   */
+  Value &insert(const Key &key, Value value) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      it->second->second = std::move(value);
+      return it->second->second;
+    }
+    if (entries_.size() == capacity_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.emplace_front(key, std::move(value));
+    index_.emplace(key, entries_.begin());
+    return entries_.front().second;
+  }
+
+  /**
+   * @brief The value of key if cached, otherwise compute() inserted as the
+   * value of key.
+   */
+  template <typename Compute>
+  Value &get_or_compute(const Key &key, Compute &&compute) {
+    if (Value *v = find(key)) {
+      return *v;
+    }
+    return insert(key, std::forward<Compute>(compute)());
+  }
+
+  bool erase(const Key &key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return false;
+    }
+    entries_.erase(it->second);
+    index_.erase(it);
+    return true;
+  }
+
+  void clear() noexcept {
+    entries_.clear();
+    index_.clear();
+  }
+
+  /// Entries from most to least recently used. Iterating does not count as
+  /// use.
+  const_iterator begin() const noexcept { return entries_.begin(); }
+  const_iterator end() const noexcept { return entries_.end(); }
+
+private:
+  std::size_t capacity_;
+  std::size_t hits_ = 0;
+  std::size_t misses_ = 0;
+  std::list<entry_type> entries_;
+  std::unordered_map<Key, typename std::list<entry_type>::iterator, Hash,
+                     KeyEqual>
+      index_;
+};
+
+} // namespace utils
@@ -0,0 +1,167 @@
+/**********************************************************************
+ * @brief Read-only memory-mapped files.
+ * @details Maps a whole file into memory with mmap (POSIX) or
+ *MapViewOfFile (Windows), so it can be read like a string without copying
+ *it into the heap first. Pages are loaded lazily by the OS and can be
+ *dropped again under memory pressure.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace utils {
+
+/**
+ * @brief A file mapped read-only into memory for the lifetime of the object.
+ * Move-only. An empty file gives an empty view without mapping anything.
+ */
+class MappedFile {
+public:
+  MappedFile() = default;
+
+  /**
+   * @throws std::runtime_error if the file cannot be opened or mapped.
+   */
+  explicit MappedFile(const std::string &filename);
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&other) noexcept { swap(other); }
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    MappedFile tmp(std::move(other));
+    swap(tmp);
+    return *this;
+  }
+
+  ~MappedFile() { unmap(); }
+
+  const char *data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  std::string_view view() const noexcept { return {data_, size_}; }
+
+  void swap(MappedFile &other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+  }
+
+private:
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+
+  void unmap() noexcept;
+};
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+#ifdef _WIN32
+
+inline MappedFile::MappedFile(const std::string &filename) {
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Could not open file");
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    throw std::runtime_error("Could not get file size");
+  }
+  if (file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return;
+  }
+
+  // The view keeps the mapping alive, so both handles can be closed.
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping) {
+    throw std::runtime_error("Could not map file");
+  }
+  void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!view) {
+    throw std::runtime_error("Could not map file");
+  }
+
+  data_ = static_cast<const char *>(view);
+  size_ = static_cast<std::size_t>(file_size.QuadPart);
+}
+
+inline void MappedFile::unmap() noexcept {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#else
+
+inline MappedFile::MappedFile(const std::string &filename) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open file");
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Could not get file size");
+  }
+  if (st.st_size == 0) {
+    ::close(fd);
+    return;
+  }
+
+  // The mapping stays valid after the descriptor is closed.
+  std::size_t size = static_cast<std::size_t>(st.st_size);
+  void *addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    throw std::runtime_error("Could not map file");
+  }
+  ::madvise(addr, size, MADV_SEQUENTIAL);
+
+  data_ = static_cast<const char *>(addr);
+  size_ = size;
+}
+
+inline void MappedFile::unmap() noexcept {
+  if (data_) {
+    ::munmap(const_cast<char *>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#endif
+
+} // namespace utils
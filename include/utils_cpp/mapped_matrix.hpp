@@ -0,0 +1,415 @@
+/**********************************************************************
+ * @brief Matrices stored in memory-mapped .npy files.
+ * @details MappedMatrix maps a C-ordered 2D .npy file read-write (or
+ *read-only), so tables larger than RAM can be written and read in place
+ *while the OS pages them in and out. The file stays loadable with
+ *numpy.load. for_each_tile walks the matrix band by band, prefetching the
+ *next band of rows and optionally dropping finished ones, so that blocked
+ *algorithms touch the file sequentially.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/matrix.hpp"
+#include "utils_cpp/numpy.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace utils {
+
+/**
+ * @brief A num_rows x num_columns matrix of T stored in a .npy file mapped
+ * into memory for the lifetime of the object. Move-only. Writes go straight
+ * to the page cache and reach the file when the OS writes them back, or on
+ * flush(). Writing through a matrix opened read-only crashes.
+ *
+ * @code
+ * auto d = MappedMatrix<int>::create("distances.npy", n, n);
+ * d.for_each_tile(256, 256, [&](MatrixView<int> tile) { ... }, true);
+ * d.flush();
+ * @endcode
+ */
+template <typename T>
+class MappedMatrix {
+public:
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+                "MappedMatrix needs a numeric element type");
+
+  MappedMatrix() = default;
+
+  /**
+   * Creates (or truncates) filename as a .npy file of the given shape and
+   * maps it. The elements start out zero; on most file systems the file is
+   * sparse until they are written.
+   * @throws std::runtime_error if the file cannot be created or mapped
+   */
+  static MappedMatrix create(const std::string &filename, std::size_t num_rows,
+                             std::size_t num_columns);
+
+  /**
+   * Maps an existing C-ordered 1D or 2D .npy file of T.
+   * @throws std::runtime_error if the file cannot be mapped, or holds another
+   * dtype or layout
+   */
+  static MappedMatrix open(const std::string &filename, bool writable = true);
+
+  MappedMatrix(const MappedMatrix &) = delete;
+  MappedMatrix &operator=(const MappedMatrix &) = delete;
+
+  MappedMatrix(MappedMatrix &&other) noexcept { swap(other); }
+  MappedMatrix &operator=(MappedMatrix &&other) noexcept {
+    MappedMatrix tmp(std::move(other));
+    swap(tmp);
+    return *this;
+  }
+
+  ~MappedMatrix() { unmap(); }
+
+  T &operator()(std::size_t row, std::size_t col) noexcept {
+    return data()[row * num_columns_ + col];
+  }
+  const T &operator()(std::size_t row, std::size_t col) const noexcept {
+    return data()[row * num_columns_ + col];
+  }
+
+  std::pair<std::size_t, std::size_t> shape() const noexcept {
+    return {num_rows_, num_columns_};
+  }
+  std::size_t num_rows() const noexcept { return num_rows_; }
+  std::size_t num_columns() const noexcept { return num_columns_; }
+  bool writable() const noexcept { return writable_; }
+
+  T *data() noexcept { return reinterpret_cast<T *>(base_ + data_offset_); }
+  const T *data() const noexcept {
+    return reinterpret_cast<const T *>(base_ + data_offset_);
+  }
+
+  /// Views for the Matrix kernels. Nothing is copied.
+  MatrixView<T> view() noexcept {
+    return {data(), num_rows_, num_columns_, num_columns_};
+  }
+  ConstMatrixView<T> view() const noexcept {
+    return {data(), num_rows_, num_columns_, num_columns_};
+  }
+
+  MatrixView<T> block(std::size_t row, std::size_t col, std::size_t num_rows,
+                      std::size_t num_columns) {
+    return view().block(row, col, num_rows, num_columns);
+  }
+  ConstMatrixView<T> block(std::size_t row, std::size_t col,
+                           std::size_t num_rows,
+                           std::size_t num_columns) const {
+    return view().block(row, col, num_rows, num_columns);
+  }
+
+  /**
+   * Writes modified pages back to the file and waits for them.
+   * @throws std::runtime_error if the write fails
+   */
+  void flush();
+
+  /// Asks the OS to start reading rows [begin, end) in ahead of use.
+  void prefetch_rows(std::size_t begin, std::size_t end) const noexcept;
+
+  /// Lets the OS drop rows [begin, end) from memory. Modified pages are
+  /// still written back, and are read in again if touched.
+  void release_rows(std::size_t begin, std::size_t end) const noexcept;
+
+  /**
+   * Calls f(tile) for each tile, as utils::for_each_tile does, prefetching
+   * the next band of tile_rows rows before working on the current one. If
+   * release is true, each band is released once all its tiles are done, so
+   * a sweep over a file larger than RAM does not evict pages that are still
+   * needed.
+   */
+  template <typename F>
+  void for_each_tile(std::size_t tile_rows, std::size_t tile_columns, F &&f,
+                     bool release = false);
+
+  void swap(MappedMatrix &other) noexcept {
+    std::swap(base_, other.base_);
+    std::swap(mapped_size_, other.mapped_size_);
+    std::swap(data_offset_, other.data_offset_);
+    std::swap(num_rows_, other.num_rows_);
+    std::swap(num_columns_, other.num_columns_);
+    std::swap(writable_, other.writable_);
+  }
+
+private:
+  char *base_ = nullptr;
+  std::size_t mapped_size_ = 0;
+  std::size_t data_offset_ = 0;
+  std::size_t num_rows_ = 0;
+  std::size_t num_columns_ = 0;
+  bool writable_ = false;
+
+  /// Maps the whole of an open file and reads its header.
+  void map(const std::string &filename, bool writable, bool create,
+           const std::string &header, std::size_t file_size);
+  void unmap() noexcept;
+
+  /// Page-aligned byte range covering rows [begin, end), clamped to the
+  /// mapping.
+  std::pair<char *, std::size_t> row_pages(std::size_t begin,
+                                           std::size_t end) const noexcept;
+};
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+template <typename T>
+MappedMatrix<T> MappedMatrix<T>::create(const std::string &filename,
+                                        std::size_t num_rows,
+                                        std::size_t num_columns) {
+  std::string header = npy_header<T>(num_rows, num_columns);
+  MappedMatrix m;
+  m.map(filename, true, true, header,
+        header.size() + num_rows * num_columns * sizeof(T));
+  return m;
+}
+
+template <typename T>
+MappedMatrix<T> MappedMatrix<T>::open(const std::string &filename,
+                                      bool writable) {
+  MappedMatrix m;
+  m.map(filename, writable, false, {}, 0);
+  return m;
+}
+
+template <typename T>
+template <typename F>
+void MappedMatrix<T>::for_each_tile(std::size_t tile_rows,
+                                    std::size_t tile_columns, F &&f,
+                                    bool release) {
+  if (tile_rows == 0 || tile_columns == 0) {
+    throw std::invalid_argument("Tile dimensions must be positive");
+  }
+  auto whole = view();
+  for (std::size_t i = 0; i < num_rows_; i += tile_rows) {
+    std::size_t height = std::min(tile_rows, num_rows_ - i);
+    prefetch_rows(i + height, i + height + tile_rows);
+    utils::for_each_tile(whole.block(i, 0, height, num_columns_), height,
+                         tile_columns, f);
+    if (release) {
+      release_rows(i, i + height);
+    }
+  }
+}
+
+template <typename T>
+std::pair<char *, std::size_t>
+MappedMatrix<T>::row_pages(std::size_t begin, std::size_t end) const noexcept {
+  end = std::min(end, num_rows_);
+  if (base_ == nullptr || begin >= end) {
+    return {nullptr, 0};
+  }
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  std::size_t page = info.dwPageSize;
+#else
+  std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+  std::size_t row_bytes = num_columns_ * sizeof(T);
+  std::size_t first = (data_offset_ + begin * row_bytes) / page * page;
+  std::size_t last = std::min(mapped_size_, data_offset_ + end * row_bytes);
+  return {base_ + first, last - first};
+}
+
+#ifdef _WIN32
+
+template <typename T>
+void MappedMatrix<T>::map(const std::string &filename, bool writable,
+                          bool create, const std::string &header,
+                          std::size_t file_size) {
+  DWORD access = writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+  HANDLE file = CreateFileA(filename.c_str(), access, FILE_SHARE_READ, nullptr,
+                            create ? CREATE_ALWAYS : OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Could not open " + filename);
+  }
+
+  LARGE_INTEGER size;
+  if (create) {
+    DWORD written = 0;
+    size.QuadPart = static_cast<LONGLONG>(file_size);
+    if (!WriteFile(file, header.data(), static_cast<DWORD>(header.size()),
+                   &written, nullptr) ||
+        !SetFilePointerEx(file, size, nullptr, FILE_BEGIN) ||
+        !SetEndOfFile(file)) {
+      CloseHandle(file);
+      throw std::runtime_error("Could not write " + filename);
+    }
+  } else if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    throw std::runtime_error("Could not get file size");
+  }
+
+  // The view keeps the mapping alive, so both handles can be closed.
+  HANDLE mapping = CreateFileMappingA(
+      file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping) {
+    throw std::runtime_error("Could not map " + filename);
+  }
+  void *view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                             0, 0, 0);
+  CloseHandle(mapping);
+  if (!view) {
+    throw std::runtime_error("Could not map " + filename);
+  }
+
+  base_ = static_cast<char *>(view);
+  mapped_size_ = static_cast<std::size_t>(size.QuadPart);
+  writable_ = writable;
+
+  // On a bad header the destructor unmaps.
+  NpyHeader parsed = parse_npy_header(std::string_view(base_, mapped_size_));
+  auto [num_rows, num_columns] = detail::npy_matrix_shape<T>(parsed);
+  if (parsed.data_offset + num_rows * num_columns * sizeof(T) > mapped_size_) {
+    throw std::runtime_error("Truncated npy file " + filename);
+  }
+  data_offset_ = parsed.data_offset;
+  num_rows_ = num_rows;
+  num_columns_ = num_columns;
+}
+
+template <typename T>
+void MappedMatrix<T>::unmap() noexcept {
+  if (base_) {
+    UnmapViewOfFile(base_);
+  }
+  base_ = nullptr;
+  mapped_size_ = 0;
+}
+
+template <typename T>
+void MappedMatrix<T>::flush() {
+  if (base_ && writable_ && !FlushViewOfFile(base_, 0)) {
+    throw std::runtime_error("Could not flush mapped matrix");
+  }
+}
+
+template <typename T>
+void MappedMatrix<T>::prefetch_rows(std::size_t, std::size_t) const noexcept {}
+
+template <typename T>
+void MappedMatrix<T>::release_rows(std::size_t, std::size_t) const noexcept {}
+
+#else
+
+template <typename T>
+void MappedMatrix<T>::map(const std::string &filename, bool writable,
+                          bool create, const std::string &header,
+                          std::size_t file_size) {
+  int flags = writable ? O_RDWR : O_RDONLY;
+  if (create) {
+    flags |= O_CREAT | O_TRUNC;
+  }
+  int fd = ::open(filename.c_str(), flags, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open " + filename);
+  }
+
+  if (create) {
+    bool ok = ::write(fd, header.data(), header.size()) ==
+                  static_cast<ssize_t>(header.size()) &&
+              ::ftruncate(fd, static_cast<off_t>(file_size)) == 0;
+    if (!ok) {
+      ::close(fd);
+      throw std::runtime_error("Could not write " + filename);
+    }
+  } else {
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Could not get file size");
+    }
+    file_size = static_cast<std::size_t>(st.st_size);
+  }
+
+  // The mapping stays valid after the descriptor is closed.
+  int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *addr = file_size == 0 ? MAP_FAILED
+                              : ::mmap(nullptr, file_size, protection,
+                                       MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    throw std::runtime_error("Could not map " + filename);
+  }
+
+  base_ = static_cast<char *>(addr);
+  mapped_size_ = file_size;
+  writable_ = writable;
+
+  // On a bad header the destructor unmaps.
+  NpyHeader parsed = parse_npy_header(std::string_view(base_, mapped_size_));
+  auto [num_rows, num_columns] = detail::npy_matrix_shape<T>(parsed);
+  if (parsed.data_offset + num_rows * num_columns * sizeof(T) > mapped_size_) {
+    throw std::runtime_error("Truncated npy file " + filename);
+  }
+  data_offset_ = parsed.data_offset;
+  num_rows_ = num_rows;
+  num_columns_ = num_columns;
+}
+
+template <typename T>
+void MappedMatrix<T>::unmap() noexcept {
+  if (base_) {
+    ::munmap(base_, mapped_size_);
+  }
+  base_ = nullptr;
+  mapped_size_ = 0;
+}
+
+template <typename T>
+void MappedMatrix<T>::flush() {
+  if (base_ && writable_ && ::msync(base_, mapped_size_, MS_SYNC) != 0) {
+    throw std::runtime_error("Could not flush mapped matrix");
+  }
+}
+
+template <typename T>
+void MappedMatrix<T>::prefetch_rows(std::size_t begin,
+                                    std::size_t end) const noexcept {
+  auto [addr, size] = row_pages(begin, end);
+  if (size > 0) {
+    ::madvise(addr, size, MADV_WILLNEED);
+  }
+}
+
+template <typename T>
+void MappedMatrix<T>::release_rows(std::size_t begin,
+                                   std::size_t end) const noexcept {
+  // Dropping the pages of a shared file mapping keeps their contents: dirty
+  // pages stay in the page cache until written back.
+  auto [addr, size] = row_pages(begin, end);
+  if (size > 0) {
+    ::madvise(addr, size, MADV_DONTNEED);
+  }
+}
+
+#endif
+
+} // namespace utils
@@ -1,27 +1,311 @@
 #pragma once
 
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 namespace utils {
 
+/**
+ * @brief Allocator that returns storage aligned to Alignment bytes (a cache
+ * line by default), e.g. for Matrix rows read with aligned SIMD loads.
+ */
+template <typename T, std::size_t Alignment = 64>
+struct aligned_allocator {
+  static_assert(std::has_single_bit(Alignment) && Alignment >= alignof(T),
+                "Alignment must be a power of two no smaller than alignof(T)");
+
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = aligned_allocator<U, Alignment>;
+  };
+
+  constexpr aligned_allocator() noexcept = default;
+
+  template <typename U>
+  constexpr aligned_allocator(const aligned_allocator<U, Alignment> &) noexcept {}
+
+  T *allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+  }
+
+  void deallocate(T *p, std::size_t n) noexcept {
+    ::operator delete(p, n * sizeof(T), std::align_val_t{Alignment});
+  }
+
+  template <typename U>
+  friend constexpr bool
+  operator==(const aligned_allocator &,
+             const aligned_allocator<U, Alignment> &) noexcept {
+    return true;
+  }
+};
+
+/**
+ * @brief Allocator that maps large blocks straight from the OS (mmap, or
+ * VirtualAlloc on Windows) instead of the heap. The pages are zero-filled
+ * lazily on first touch, so nothing is written up front, and on Linux blocks
+ * of at least one huge page are marked MADV_HUGEPAGE so that transparent huge
+ * pages cut TLB misses on large matrices. Blocks smaller than
+ * MinMappedBytes come from aligned operator new instead. Either way the
+ * storage is at least 64-byte aligned.
+ */
+template <typename T, std::size_t MinMappedBytes = std::size_t{1} << 20>
+struct mmap_allocator {
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = mmap_allocator<U, MinMappedBytes>;
+  };
+
+  constexpr mmap_allocator() noexcept = default;
+
+  template <typename U>
+  constexpr mmap_allocator(const mmap_allocator<U, MinMappedBytes> &) noexcept {
+  }
+
+  T *allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    std::size_t bytes = n * sizeof(T);
+    if (bytes < MinMappedBytes) {
+      return static_cast<T *>(::operator new(bytes, std::align_val_t{64}));
+    }
+#ifdef _WIN32
+    void *p = ::VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT,
+                             PAGE_READWRITE);
+    if (p == nullptr) {
+      throw std::bad_alloc();
+    }
+#else
+    void *p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    constexpr std::size_t huge_page = std::size_t{2} << 20;
+    if (bytes >= huge_page) {
+      ::madvise(p, bytes, MADV_HUGEPAGE);
+    }
+#endif
+#endif
+    return static_cast<T *>(p);
+  }
+
+  void deallocate(T *p, std::size_t n) noexcept {
+    std::size_t bytes = n * sizeof(T);
+    if (bytes < MinMappedBytes) {
+      ::operator delete(p, bytes, std::align_val_t{64});
+      return;
+    }
+#ifdef _WIN32
+    ::VirtualFree(p, 0, MEM_RELEASE);
+#else
+    ::munmap(p, bytes);
+#endif
+  }
+
+  template <typename U>
+  friend constexpr bool
+  operator==(const mmap_allocator &,
+             const mmap_allocator<U, MinMappedBytes> &) noexcept {
+    return true;
+  }
+};
+
+namespace detail {
+
+/**
+ * Allocator adaptor whose construct() without arguments default-initializes
+ * rather than value-initializes, so std::vector<T>(n) of a trivial T leaves
+ * the memory untouched. Everything else is forwarded to A.
+ */
+template <typename A>
+struct default_init_allocator : A {
+  using traits = std::allocator_traits<A>;
+
+  template <typename U>
+  struct rebind {
+    using other =
+        default_init_allocator<typename traits::template rebind_alloc<U>>;
+  };
+
+  using A::A;
+
+  constexpr default_init_allocator() noexcept = default;
+
+  constexpr default_init_allocator(const A &a) noexcept : A(a) {}
+
+  template <typename U>
+  void construct(U *p) noexcept(std::is_nothrow_default_constructible_v<U>) {
+    ::new (static_cast<void *>(p)) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U *p, Args &&...args) {
+    traits::construct(static_cast<A &>(*this), p, std::forward<Args>(args)...);
+  }
+};
+
+} // namespace detail
+
+template <typename T, typename Allocator = std::allocator<T>>
+class Matrix;
+
+/**
+ * @brief Non-owning view of a matrix, with a row stride and a column stride
+ * given in elements. Blocks, single rows and columns, and transposes of a
+ * Matrix or of another view all share the same storage, so none of them
+ * copies. MatrixView<const T> (ConstMatrixView<T>) is the read-only view.
+ * Like std::span, a view must not outlive the storage it points into.
+ */
+template <typename T>
+class MatrixView {
+public:
+  using value_type = std::remove_const_t<T>;
+
+  constexpr MatrixView() noexcept = default;
+
+  constexpr MatrixView(T *data, std::size_t num_rows, std::size_t num_columns,
+                       std::size_t row_stride,
+                       std::size_t column_stride = 1) noexcept;
+
+  /// View of a whole matrix.
+  template <typename U, typename A>
+    requires std::is_convertible_v<U *, T *>
+  constexpr MatrixView(Matrix<U, A> &m) noexcept;
+
+  template <typename U, typename A>
+    requires std::is_convertible_v<const U *, T *>
+  constexpr MatrixView(const Matrix<U, A> &m) noexcept;
+
+  /// A view of T converts to a view of const T.
+  template <typename U>
+    requires(std::is_convertible_v<U *, T *> && !std::is_same_v<U, T>)
+  constexpr MatrixView(const MatrixView<U> &other) noexcept;
+
+  constexpr T &operator()(std::size_t row, std::size_t col) const noexcept {
+    return data_[row * row_stride_ + col * column_stride_];
+  }
+
+  constexpr std::pair<std::size_t, std::size_t> shape() const noexcept {
+    return {num_rows_, num_columns_};
+  }
+  constexpr std::size_t num_rows() const noexcept { return num_rows_; }
+  constexpr std::size_t num_columns() const noexcept { return num_columns_; }
+  constexpr std::size_t row_stride() const noexcept { return row_stride_; }
+  constexpr std::size_t column_stride() const noexcept {
+    return column_stride_;
+  }
+  constexpr T *data() const noexcept { return data_; }
+  constexpr bool empty() const noexcept {
+    return num_rows_ == 0 || num_columns_ == 0;
+  }
+
+  /// True if the elements of each row are adjacent in memory.
+  constexpr bool rows_contiguous() const noexcept {
+    return column_stride_ == 1 || num_columns_ <= 1;
+  }
+
+  /**
+   * The num_rows x num_columns block whose top-left element is (row, col).
+   * @throws std::out_of_range if the block does not fit in this view
+   */
+  constexpr MatrixView block(std::size_t row, std::size_t col,
+                             std::size_t num_rows,
+                             std::size_t num_columns) const;
+
+  /// Row i as a 1 x num_columns() view.
+  constexpr MatrixView row(std::size_t i) const;
+
+  /// Column j as a num_rows() x 1 view.
+  constexpr MatrixView col(std::size_t j) const;
+
+  /// The transpose, obtained by swapping the shape and the strides.
+  constexpr MatrixView transposed() const noexcept;
+
+  /// Copies the viewed elements into a new Matrix.
+  Matrix<value_type> to_matrix() const;
+
+  /// Copies other, which has the same shape, into the viewed elements.
+  /// @throws std::runtime_error if the shapes differ
+  void assign(MatrixView<const value_type> other) const
+    requires(!std::is_const_v<T>);
+
+  void fill(const value_type &value) const
+    requires(!std::is_const_v<T>);
+
+private:
+  template <typename U>
+  friend class MatrixView;
+
+  T *data_ = nullptr;
+  std::size_t num_rows_ = 0;
+  std::size_t num_columns_ = 0;
+  std::size_t row_stride_ = 0;
+  std::size_t column_stride_ = 1;
+};
+
+template <typename T>
+using ConstMatrixView = MatrixView<const T>;
+
 /**
  * @brief Just a simple Matrix class that uses a 1D vector container so that
  * data in the matrix is completely contiguous. The elements are stored in
  * "row-major" order, so that all the elements of a single row are next to each
- * other in memory.
+ * other in memory. The allocator can be swapped for an aligned_allocator
+ * when rows should start on cache-line boundaries, or for an mmap_allocator
+ * to put large matrices on huge pages.
  */
-template <typename T>
+template <typename T, typename Allocator>
 class Matrix {
 public:
+  using allocator_type = Allocator;
+  using container_type =
+      std::vector<T, detail::default_init_allocator<Allocator>>;
+
   /**
    * Helper class that allows for operator[] access to rows.
    */
   class Row {
 
   public:
-    using iterator = typename std::vector<T>::iterator;
-    using const_iterator = typename std::vector<T>::const_iterator;
+    using iterator = typename container_type::iterator;
+    using const_iterator = typename container_type::const_iterator;
 
     friend class Matrix;
 
@@ -85,6 +369,14 @@ public:
   constexpr Matrix(std::size_t num_rows, std::size_t num_columns,
                    const T &initial_value = T());
 
+  /**
+   * A num_rows x num_columns matrix whose elements are default-initialized,
+   * i.e. left indeterminate for trivial types such as numbers. Nothing is
+   * written, so the pages of a large matrix are first touched by whichever
+   * thread fills them. Every element must be written before it is read.
+   */
+  static Matrix uninitialized(std::size_t num_rows, std::size_t num_columns);
+
   /**
    * Resizes the matrix to have the given number of rows and columns.
    * If this involves increasing the size of the matrix, the new elements
@@ -124,14 +416,26 @@ public:
   /**
    * Returns an iterator pointing to the beginning of the underlying vector.
    */
-  constexpr typename std::vector<T>::const_iterator data() const noexcept;
+  constexpr typename container_type::const_iterator data() const noexcept;
 
   /**
    * Iterator to beginning of row corresponding to given row index.
    */
-  constexpr typename std::vector<T>::const_iterator
+  constexpr typename container_type::const_iterator
   data(std::size_t row_index) const noexcept;
 
+  /**
+   * Views of the whole matrix, or of the num_rows x num_columns block whose
+   * top-left element is (row, col). Nothing is copied.
+   */
+  constexpr MatrixView<T> view() noexcept { return *this; }
+  constexpr ConstMatrixView<T> view() const noexcept { return *this; }
+  constexpr MatrixView<T> block(std::size_t row, std::size_t col,
+                                std::size_t num_rows, std::size_t num_columns);
+  constexpr ConstMatrixView<T> block(std::size_t row, std::size_t col,
+                                     std::size_t num_rows,
+                                     std::size_t num_columns) const;
+
   /**
    * Writes a representation of the matrix to the given output stream.
    * @param os The output stream to write to.
@@ -145,179 +449,385 @@ public:
    * @param m The matrix to write.
    * @return The output stream.
    */
-  template <typename U>
+  template <typename U, typename UA>
   friend constexpr std::ostream &operator<<(std::ostream &os,
-                                            const Matrix<U> &m) noexcept;
+                                            const Matrix<U, UA> &m) noexcept;
 
-  template <typename U, typename V>
-  friend constexpr bool operator==(const Matrix<U> &lhs,
-                                   const Matrix<V> &rhs) noexcept;
+  template <typename U, typename UA, typename V, typename VA>
+  friend constexpr bool operator==(const Matrix<U, UA> &lhs,
+                                   const Matrix<V, VA> &rhs) noexcept;
 
-  template <typename U, typename V>
-  friend constexpr bool operator!=(const Matrix<U> &lhs,
-                                   const Matrix<V> &rhs) noexcept;
+  template <typename U, typename UA, typename V, typename VA>
+  friend constexpr bool operator!=(const Matrix<U, UA> &lhs,
+                                   const Matrix<V, VA> &rhs) noexcept;
 
 private:
-  std::vector<T> data_;
-  std::size_t num_columns;
+  container_type data_;
+  std::size_t num_columns = 0;
+};
+
+// =========== Numeric kernels ===========
+
+/**
+ * Semirings for matmul. Each one has a zero() that is the identity of add()
+ * and annihilates mul(). For integers matmul relies on that to skip entries
+ * of the left operand that equal zero(); for floating point it does not,
+ * because 0 * inf and 0 * NaN are NaN.
+ */
+namespace semiring {
+
+/// Ordinary (+, *) arithmetic.
+template <typename T>
+struct plus_times {
+  static constexpr T zero() noexcept { return T(0); }
+  static constexpr T add(T a, T b) noexcept { return a + b; }
+  static constexpr T mul(T a, T b) noexcept { return a * b; }
+};
+
+/// (min, +), for shortest paths. Infinity (or the maximum value, for
+/// integers) means no path, and adding it to anything gives it back. Integer
+/// sums saturate, so a path too long for T becomes no path.
+template <typename T>
+struct min_plus {
+  static constexpr T zero() noexcept {
+    if constexpr (std::numeric_limits<T>::has_infinity) {
+      return std::numeric_limits<T>::infinity();
+    } else {
+      return std::numeric_limits<T>::max();
+    }
+  }
+  static constexpr T add(T a, T b) noexcept { return b < a ? b : a; }
+  static constexpr T mul(T a, T b) noexcept {
+    if constexpr (std::numeric_limits<T>::has_infinity) {
+      return a + b;
+    } else {
+      if (a == zero() || b == zero() || (b > 0 && a > zero() - b)) {
+        return zero();
+      }
+      if constexpr (std::is_signed_v<T>) {
+        if (b < 0 && a < std::numeric_limits<T>::lowest() - b) {
+          return std::numeric_limits<T>::lowest();
+        }
+      }
+      return T(a + b);
+    }
+  }
+};
+
+/// (or, and) over integers holding 0 or 1, for reachability.
+template <typename T>
+  requires std::is_integral_v<T>
+struct or_and {
+  static constexpr T zero() noexcept { return T(0); }
+  static constexpr T add(T a, T b) noexcept { return a | b; }
+  static constexpr T mul(T a, T b) noexcept { return a & b; }
+};
+
+} // namespace semiring
+
+/// S provides zero(), add() and mul() over T.
+template <typename S, typename T>
+concept semiring_for = requires(T a, T b) {
+  { S::zero() } -> std::convertible_to<T>;
+  { S::add(a, b) } -> std::convertible_to<T>;
+  { S::mul(a, b) } -> std::convertible_to<T>;
+};
+
+namespace detail {
+
+template <typename M>
+struct matrix_operand_traits {};
+
+template <typename T, typename A>
+struct matrix_operand_traits<Matrix<T, A>> {
+  using value_type = T;
+  using result_type = Matrix<T, A>;
+};
+
+template <typename T>
+struct matrix_operand_traits<MatrixView<T>> {
+  using value_type = std::remove_const_t<T>;
+  using result_type = Matrix<value_type>;
+};
+
+} // namespace detail
+
+/// A Matrix or a MatrixView, which every kernel below accepts.
+template <typename M>
+concept matrix_operand = requires {
+  typename detail::matrix_operand_traits<std::remove_cvref_t<M>>::value_type;
 };
 
+template <matrix_operand M>
+using matrix_value_t =
+    typename detail::matrix_operand_traits<std::remove_cvref_t<M>>::value_type;
+
+/// What a kernel returns for operand M: a Matrix with M's allocator, or a
+/// default Matrix for views.
+template <matrix_operand M>
+using matrix_result_t =
+    typename detail::matrix_operand_traits<std::remove_cvref_t<M>>::result_type;
+
+/**
+ * Matrix product of a (n x k) and b (k x m) over the semiring S. The
+ * product is blocked so that a panel of b stays in cache while it is reused,
+ * and blocks of rows run in parallel if a pool is given. Rows are updated
+ * with AVX2 for float, double and int when the translation unit is compiled
+ * with AVX2 enabled, and by an auto-vectorizable loop otherwise.
+ * @throws std::runtime_error if the inner dimensions differ
+ */
+template <matrix_operand M1, matrix_operand M2,
+          semiring_for<matrix_value_t<M1>> S>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> matmul(const M1 &a, const M2 &b, S,
+                           parallel::thread_pool *pool = nullptr);
+
+/// Ordinary matrix product, over semiring::plus_times.
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> matmul(const M1 &a, const M2 &b,
+                           parallel::thread_pool *pool = nullptr);
+
+/**
+ * c = add(c, a * b) over the semiring S, written into the view c in place,
+ * e.g. to update one tile of a blocked Floyd-Warshall from two others. c
+ * must not overlap a or b.
+ * @throws std::runtime_error if the shapes do not match
+ */
+template <typename T, semiring_for<T> S>
+void matmul_into(MatrixView<T> c, std::type_identity_t<ConstMatrixView<T>> a,
+                 std::type_identity_t<ConstMatrixView<T>> b, S,
+                 parallel::thread_pool *pool = nullptr);
+
+/**
+ * Transpose, copied in square tiles so that both reads and writes stay in
+ * cache. Rows of tiles run in parallel if a pool is given. Use
+ * MatrixView::transposed() instead when a copy is not needed.
+ */
+template <matrix_operand M>
+matrix_result_t<M> transpose(const M &m, parallel::thread_pool *pool = nullptr);
+
+/**
+ * Elementwise operations. Note that operator* is the elementwise (Hadamard)
+ * product; use matmul for the matrix product.
+ * @throws std::runtime_error if the shapes differ
+ */
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> operator+(const M1 &lhs, const M2 &rhs);
+
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> operator-(const M1 &lhs, const M2 &rhs);
+
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> operator*(const M1 &lhs, const M2 &rhs);
+
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> elementwise_min(const M1 &lhs, const M2 &rhs);
+
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> elementwise_max(const M1 &lhs, const M2 &rhs);
+
+/**
+ * Calls f(tile) for each tile_rows x tile_columns block of m (smaller along
+ * the bottom and right edges), tile row by tile row and left to right
+ * within each. With row-major storage consecutive tiles share the same band
+ * of rows, so one pass over a large or file-backed matrix sweeps through
+ * memory once.
+ */
+template <typename T, typename F>
+void for_each_tile(MatrixView<T> m, std::size_t tile_rows,
+                   std::size_t tile_columns, F &&f);
+
+/**
+ * Folds each row into one value, starting from init, e.g.
+ * reduce_rows(m, 0.0, std::plus<>{}) gives the row sums.
+ * @return One value per row
+ */
+template <matrix_operand M, typename Op>
+std::vector<matrix_value_t<M>>
+reduce_rows(const M &m, matrix_value_t<M> init, Op op,
+            parallel::thread_pool *pool = nullptr);
+
+/**
+ * Folds each column into one value, starting from init. The matrix is read
+ * row by row, so every row folds into all the column accumulators at once.
+ * @return One value per column
+ */
+template <matrix_operand M, typename Op>
+std::vector<matrix_value_t<M>>
+reduce_columns(const M &m, matrix_value_t<M> init, Op op,
+               parallel::thread_pool *pool = nullptr);
+
 // =========== IMPLEMENTATION ===========
 
 // =========== Matrix Row ===============
-template <typename T>
-constexpr Matrix<T>::Row::Row(Matrix &parent, std::size_t row) noexcept
+template <typename T, typename Allocator>
+constexpr Matrix<T, Allocator>::Row::Row(Matrix &parent, std::size_t row) noexcept
     : start{parent.data_.begin() + row * parent.num_columns},
       finish{start + parent.num_columns} {}
 
-template <typename T>
-constexpr T &Matrix<T>::Row::operator[](std::size_t col) noexcept {
+template <typename T, typename Allocator>
+constexpr T &Matrix<T, Allocator>::Row::operator[](std::size_t col) noexcept {
   return *(start + col);
 }
 
-template <typename T>
-constexpr const T &Matrix<T>::Row::operator[](std::size_t col) const noexcept {
+template <typename T, typename Allocator>
+constexpr const T &Matrix<T, Allocator>::Row::operator[](std::size_t col) const noexcept {
   return *(start + col);
 }
 
-template <typename T>
-constexpr std::size_t Matrix<T>::Row::size() const noexcept {
+template <typename T, typename Allocator>
+constexpr std::size_t Matrix<T, Allocator>::Row::size() const noexcept {
   return finish - start;
 }
 
-template <typename T>
-constexpr typename Matrix<T>::Row::iterator Matrix<T>::Row::begin() noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::Row::iterator Matrix<T, Allocator>::Row::begin() noexcept {
   return start;
 }
 
-template <typename T>
-constexpr typename Matrix<T>::Row::iterator Matrix<T>::Row::end() noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::Row::iterator Matrix<T, Allocator>::Row::end() noexcept {
   return finish;
 }
 
-template <typename T>
-constexpr typename Matrix<T>::Row::const_iterator
-Matrix<T>::Row::begin() const noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::Row::const_iterator
+Matrix<T, Allocator>::Row::begin() const noexcept {
   return start;
 }
 
-template <typename T>
-constexpr typename Matrix<T>::Row::const_iterator
-Matrix<T>::Row::end() const noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::Row::const_iterator
+Matrix<T, Allocator>::Row::end() const noexcept {
   return finish;
 }
 
 // =========== Matrix row iterator ======
 
-template <typename T>
-constexpr Matrix<T>::iterator::iterator(Matrix &parent,
+template <typename T, typename Allocator>
+constexpr Matrix<T, Allocator>::iterator::iterator(Matrix &parent,
                                         std::size_t row_index) noexcept
     : parent{parent}, row_index{row_index} {}
 
-template <typename T>
-constexpr typename Matrix<T>::Row Matrix<T>::iterator::operator*() noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::Row Matrix<T, Allocator>::iterator::operator*() noexcept {
   return Row(parent, row_index);
 }
 
-template <typename T>
-constexpr typename Matrix<T>::iterator &
-Matrix<T>::iterator::operator++() noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::iterator &
+Matrix<T, Allocator>::iterator::operator++() noexcept {
   ++row_index;
   return *this;
 }
 
-template <typename T>
+template <typename T, typename Allocator>
 constexpr bool
-Matrix<T>::iterator::operator==(const iterator &other) const noexcept {
+Matrix<T, Allocator>::iterator::operator==(const iterator &other) const noexcept {
   return row_index == other.row_index && &parent == &other.parent;
 }
 
-template <typename T>
+template <typename T, typename Allocator>
 constexpr bool
-Matrix<T>::iterator::operator!=(const iterator &other) const noexcept {
+Matrix<T, Allocator>::iterator::operator!=(const iterator &other) const noexcept {
   return !(*this == other);
 }
 
-template <typename T>
-constexpr typename Matrix<T>::iterator Matrix<T>::begin() noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::iterator Matrix<T, Allocator>::begin() noexcept {
   return iterator(*this, 0);
 }
 
-template <typename T>
-constexpr typename Matrix<T>::iterator Matrix<T>::end() noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::iterator Matrix<T, Allocator>::end() noexcept {
   return iterator(*this, size());
 }
 
 // =========== Matrix const row iterator ======
 
-template <typename T>
-constexpr Matrix<T>::const_iterator::const_iterator(
+template <typename T, typename Allocator>
+constexpr Matrix<T, Allocator>::const_iterator::const_iterator(
     const Matrix &parent, std::size_t row_index) noexcept
     : parent{parent}, row_index{row_index} {}
 
-template <typename T>
-constexpr const typename Matrix<T>::Row
-Matrix<T>::const_iterator::operator*() const noexcept {
+template <typename T, typename Allocator>
+constexpr const typename Matrix<T, Allocator>::Row
+Matrix<T, Allocator>::const_iterator::operator*() const noexcept {
   return Row(parent, row_index);
 }
 
-template <typename T>
-constexpr typename Matrix<T>::const_iterator &
-Matrix<T>::const_iterator::operator++() noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::const_iterator &
+Matrix<T, Allocator>::const_iterator::operator++() noexcept {
   ++row_index;
   return *this;
 }
 
-template <typename T>
-constexpr bool Matrix<T>::const_iterator::operator==(
+template <typename T, typename Allocator>
+constexpr bool Matrix<T, Allocator>::const_iterator::operator==(
     const const_iterator &other) const noexcept {
   return row_index == other.row_index && &parent == &other.parent;
 }
 
-template <typename T>
-constexpr bool Matrix<T>::const_iterator::operator!=(
+template <typename T, typename Allocator>
+constexpr bool Matrix<T, Allocator>::const_iterator::operator!=(
     const const_iterator &other) const noexcept {
   return !(*this == other);
 }
 
-template <typename T>
-constexpr typename Matrix<T>::const_iterator Matrix<T>::begin() const noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::const_iterator Matrix<T, Allocator>::begin() const noexcept {
   return const_iterator(*this, 0);
 }
 
-template <typename T>
-constexpr typename Matrix<T>::const_iterator Matrix<T>::end() const noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::const_iterator Matrix<T, Allocator>::end() const noexcept {
   return const_iterator(*this, size());
 }
 
 // =========== Matrix ===================
-template <typename T>
-constexpr typename Matrix<T>::Row
-Matrix<T>::operator[](std::size_t row) noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::Row
+Matrix<T, Allocator>::operator[](std::size_t row) noexcept {
   return Row(*this, row);
 }
 
-template <typename T>
-constexpr const typename Matrix<T>::Row
-Matrix<T>::operator[](std::size_t row) const noexcept {
+template <typename T, typename Allocator>
+constexpr const typename Matrix<T, Allocator>::Row
+Matrix<T, Allocator>::operator[](std::size_t row) const noexcept {
   return Row(*this, row);
 }
 
-template <typename T>
-constexpr Matrix<T>::Matrix(std::size_t num_rows, std::size_t num_columns,
+template <typename T, typename Allocator>
+constexpr Matrix<T, Allocator>::Matrix(std::size_t num_rows, std::size_t num_columns,
                             const T &initial_value)
-    : data_{std::vector<T>(num_rows * num_columns, initial_value)},
+    : data_{container_type(num_rows * num_columns, initial_value)},
       num_columns{num_columns} {}
 
-template <typename T>
-constexpr void Matrix<T>::resize(std::size_t num_rows, std::size_t num_columns,
+template <typename T, typename Allocator>
+Matrix<T, Allocator> Matrix<T, Allocator>::uninitialized(std::size_t num_rows,
+                                                         std::size_t num_columns) {
+  Matrix m;
+  m.data_ = container_type(num_rows * num_columns);
+  m.num_columns = num_columns;
+  return m;
+}
+
+template <typename T, typename Allocator>
+constexpr void Matrix<T, Allocator>::resize(std::size_t num_rows, std::size_t num_columns,
                                  const T &initial_value) {
   data_.resize(num_rows * num_columns, initial_value);
   this->num_columns = num_columns;
 }
 
-template <typename T>
-constexpr void Matrix<T>::reshape(std::size_t num_rows,
+template <typename T, typename Allocator>
+constexpr void Matrix<T, Allocator>::reshape(std::size_t num_rows,
                                   std::size_t num_columns) {
   if (num_rows * num_columns != data_.size()) {
     throw std::runtime_error("Cannot reshape matrix to different size");
@@ -325,42 +835,42 @@ constexpr void Matrix<T>::reshape(std::size_t num_rows,
   this->num_columns = num_columns;
 }
 
-template <typename T>
-constexpr T &Matrix<T>::operator()(std::size_t row, std::size_t col) noexcept {
+template <typename T, typename Allocator>
+constexpr T &Matrix<T, Allocator>::operator()(std::size_t row, std::size_t col) noexcept {
   return data_[row * num_columns + col];
 }
 
-template <typename T>
-constexpr const T &Matrix<T>::operator()(std::size_t row,
+template <typename T, typename Allocator>
+constexpr const T &Matrix<T, Allocator>::operator()(std::size_t row,
                                          std::size_t col) const noexcept {
   return data_[row * num_columns + col];
 }
 
-template <typename T>
+template <typename T, typename Allocator>
 constexpr std::pair<std::size_t, std::size_t>
-Matrix<T>::shape() const noexcept {
-  return {data_.size() / num_columns, num_columns};
+Matrix<T, Allocator>::shape() const noexcept {
+  return {size(), num_columns};
 }
 
-template <typename T>
-constexpr std::size_t Matrix<T>::size() const noexcept {
-  return data_.size() / num_columns;
+template <typename T, typename Allocator>
+constexpr std::size_t Matrix<T, Allocator>::size() const noexcept {
+  return num_columns == 0 ? 0 : data_.size() / num_columns;
 }
 
-template <typename T>
-constexpr typename std::vector<T>::const_iterator
-Matrix<T>::data() const noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::container_type::const_iterator
+Matrix<T, Allocator>::data() const noexcept {
   return data_.begin();
 }
 
-template <typename T>
-constexpr typename std::vector<T>::const_iterator
-Matrix<T>::data(std::size_t row_index) const noexcept {
+template <typename T, typename Allocator>
+constexpr typename Matrix<T, Allocator>::container_type::const_iterator
+Matrix<T, Allocator>::data(std::size_t row_index) const noexcept {
   return data_.begin() + num_columns * row_index;
 }
 
-template <typename T>
-std::ostream &Matrix<T>::repr(std::ostream &os) const {
+template <typename T, typename Allocator>
+std::ostream &Matrix<T, Allocator>::repr(std::ostream &os) const {
   auto [num_rows, num_columns] = shape();
   os << "Matrix(\n\t";
   os << "num_columns: " << num_columns << "\n\t";
@@ -375,9 +885,9 @@ std::ostream &Matrix<T>::repr(std::ostream &os) const {
   return os;
 }
 
-template <typename T>
+template <typename T, typename Allocator>
 constexpr std::ostream &operator<<(std::ostream &os,
-                                   const Matrix<T> &m) noexcept {
+                                   const Matrix<T, Allocator> &m) noexcept {
   auto [num_rows, num_columns] = m.shape();
   for (std::size_t i = 0; i < num_rows; ++i) {
     for (std::size_t j = 0; j < num_columns; ++j) {
@@ -388,14 +898,540 @@ constexpr std::ostream &operator<<(std::ostream &os,
   return os;
 }
 
-template <typename U, typename V>
-constexpr bool operator==(const Matrix<U> &lhs, const Matrix<V> &rhs) noexcept {
+template <typename U, typename UA, typename V, typename VA>
+constexpr bool operator==(const Matrix<U, UA> &lhs,
+                          const Matrix<V, VA> &rhs) noexcept {
   return lhs.data_ == rhs.data_ && lhs.num_columns == rhs.num_columns;
 }
 
-template <typename U, typename V>
-constexpr bool operator!=(const Matrix<U> &lhs, const Matrix<V> &rhs) noexcept {
+template <typename U, typename UA, typename V, typename VA>
+constexpr bool operator!=(const Matrix<U, UA> &lhs,
+                          const Matrix<V, VA> &rhs) noexcept {
   return !(lhs == rhs);
 }
 
+// =========== MatrixView ===============
+
+template <typename T>
+constexpr MatrixView<T>::MatrixView(T *data, std::size_t num_rows,
+                                    std::size_t num_columns,
+                                    std::size_t row_stride,
+                                    std::size_t column_stride) noexcept
+    : data_{data}, num_rows_{num_rows}, num_columns_{num_columns},
+      row_stride_{row_stride}, column_stride_{column_stride} {}
+
+template <typename T>
+template <typename U, typename A>
+  requires std::is_convertible_v<U *, T *>
+constexpr MatrixView<T>::MatrixView(Matrix<U, A> &m) noexcept
+    : MatrixView(m.size() == 0 ? nullptr : &m(0, 0), m.shape().first,
+                 m.shape().second, m.shape().second) {}
+
+template <typename T>
+template <typename U, typename A>
+  requires std::is_convertible_v<const U *, T *>
+constexpr MatrixView<T>::MatrixView(const Matrix<U, A> &m) noexcept
+    : MatrixView(m.size() == 0 ? nullptr : &m(0, 0), m.shape().first,
+                 m.shape().second, m.shape().second) {}
+
+template <typename T>
+template <typename U>
+  requires(std::is_convertible_v<U *, T *> && !std::is_same_v<U, T>)
+constexpr MatrixView<T>::MatrixView(const MatrixView<U> &other) noexcept
+    : data_{other.data_}, num_rows_{other.num_rows_},
+      num_columns_{other.num_columns_}, row_stride_{other.row_stride_},
+      column_stride_{other.column_stride_} {}
+
+template <typename T>
+constexpr MatrixView<T> MatrixView<T>::block(std::size_t row, std::size_t col,
+                                             std::size_t num_rows,
+                                             std::size_t num_columns) const {
+  if (row > num_rows_ || num_rows > num_rows_ - row || col > num_columns_ ||
+      num_columns > num_columns_ - col) {
+    throw std::out_of_range("Matrix block out of range");
+  }
+  T *start = num_rows * num_columns == 0 ? data_ : &(*this)(row, col);
+  return MatrixView(start, num_rows, num_columns, row_stride_,
+                    column_stride_);
+}
+
+template <typename T>
+constexpr MatrixView<T> MatrixView<T>::row(std::size_t i) const {
+  return block(i, 0, 1, num_columns_);
+}
+
+template <typename T>
+constexpr MatrixView<T> MatrixView<T>::col(std::size_t j) const {
+  return block(0, j, num_rows_, 1);
+}
+
+template <typename T>
+constexpr MatrixView<T> MatrixView<T>::transposed() const noexcept {
+  return MatrixView(data_, num_columns_, num_rows_, column_stride_,
+                    row_stride_);
+}
+
+template <typename T>
+Matrix<typename MatrixView<T>::value_type> MatrixView<T>::to_matrix() const {
+  Matrix<value_type> m(num_rows_, num_columns_);
+  MatrixView<value_type>(m).assign(*this);
+  return m;
+}
+
+template <typename T>
+void MatrixView<T>::assign(MatrixView<const value_type> other) const
+  requires(!std::is_const_v<T>)
+{
+  if (other.shape() != shape()) {
+    throw std::runtime_error("Matrix shapes do not match");
+  }
+  for (std::size_t i = 0; i < num_rows_; ++i) {
+    for (std::size_t j = 0; j < num_columns_; ++j) {
+      (*this)(i, j) = other(i, j);
+    }
+  }
+}
+
+template <typename T>
+void MatrixView<T>::fill(const value_type &value) const
+  requires(!std::is_const_v<T>)
+{
+  for (std::size_t i = 0; i < num_rows_; ++i) {
+    for (std::size_t j = 0; j < num_columns_; ++j) {
+      (*this)(i, j) = value;
+    }
+  }
+}
+
+template <typename T, typename Allocator>
+constexpr MatrixView<T>
+Matrix<T, Allocator>::block(std::size_t row, std::size_t col,
+                            std::size_t num_rows, std::size_t num_columns) {
+  return view().block(row, col, num_rows, num_columns);
+}
+
+template <typename T, typename Allocator>
+constexpr ConstMatrixView<T>
+Matrix<T, Allocator>::block(std::size_t row, std::size_t col,
+                            std::size_t num_rows,
+                            std::size_t num_columns) const {
+  return view().block(row, col, num_rows, num_columns);
+}
+
+// =========== Numeric kernels ===========
+
+namespace detail {
+
+template <typename T>
+constexpr void check_kernel_type() noexcept {
+  static_assert(!std::is_same_v<T, bool>,
+                "Matrix<bool> is backed by std::vector<bool>, which has no "
+                "contiguous storage; use std::uint8_t instead");
+}
+
+template <matrix_operand M>
+ConstMatrixView<matrix_value_t<M>> const_view(const M &m) noexcept {
+  return m;
+}
+
+/// Runs f(block) for each block in [0, num_blocks), on the pool if given.
+template <typename F>
+void for_each_block(std::size_t num_blocks, parallel::thread_pool *pool,
+                    F &&f) {
+  if (pool != nullptr && num_blocks > 1) {
+    pool->parallel_for(std::size_t{0}, num_blocks, 1, f);
+  } else {
+    for (std::size_t block = 0; block < num_blocks; ++block) {
+      f(block);
+    }
+  }
+}
+
+#if defined(__AVX2__)
+template <typename T>
+struct avx2_lanes {
+  static constexpr bool enabled = false;
+};
+
+template <>
+struct avx2_lanes<float> {
+  using V = __m256;
+  static constexpr bool enabled = true;
+  static constexpr std::size_t width = 8;
+  static V set1(float x) { return _mm256_set1_ps(x); }
+  static V load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, V v) { _mm256_storeu_ps(p, v); }
+  static V add(V a, V b) { return _mm256_add_ps(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static V min(V a, V b) { return _mm256_min_ps(a, b); }
+  static V add_absorbing(V a, V b, V) { return _mm256_add_ps(a, b); }
+};
+
+template <>
+struct avx2_lanes<double> {
+  using V = __m256d;
+  static constexpr bool enabled = true;
+  static constexpr std::size_t width = 4;
+  static V set1(double x) { return _mm256_set1_pd(x); }
+  static V load(const double *p) { return _mm256_loadu_pd(p); }
+  static void store(double *p, V v) { _mm256_storeu_pd(p, v); }
+  static V add(V a, V b) { return _mm256_add_pd(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+  static V min(V a, V b) { return _mm256_min_pd(a, b); }
+  static V add_absorbing(V a, V b, V) { return _mm256_add_pd(a, b); }
+};
+
+template <>
+struct avx2_lanes<std::int32_t> {
+  using V = __m256i;
+  static constexpr bool enabled = true;
+  static constexpr std::size_t width = 8;
+  static V set1(std::int32_t x) { return _mm256_set1_epi32(x); }
+  static V load(const std::int32_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  static void store(std::int32_t *p, V v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+  }
+  static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+  static V mul(V a, V b) { return _mm256_mullo_epi32(a, b); }
+  static V min(V a, V b) { return _mm256_min_epi32(a, b); }
+  static V bit_or(V a, V b) { return _mm256_or_si256(a, b); }
+  static V bit_and(V a, V b) { return _mm256_and_si256(a, b); }
+  // a + b saturated to [INT32_MIN, INT32_MAX], or inf where either of them
+  // is inf. Overflow flips the sign of the sum away from both operands.
+  static V add_absorbing(V a, V b, V inf) {
+    V sum = _mm256_add_epi32(a, b);
+    V overflow = _mm256_srai_epi32(
+        _mm256_and_si256(_mm256_xor_si256(a, sum), _mm256_xor_si256(b, sum)),
+        31);
+    V saturated = _mm256_xor_si256(_mm256_srai_epi32(a, 31),
+                                   _mm256_set1_epi32(INT32_MAX));
+    sum = _mm256_blendv_epi8(sum, saturated, overflow);
+    V absorbed =
+        _mm256_or_si256(_mm256_cmpeq_epi32(a, inf), _mm256_cmpeq_epi32(b, inf));
+    return _mm256_blendv_epi8(sum, inf, absorbed);
+  }
+};
+
+/// Vector add() and mul() of a semiring, where there is one.
+template <typename S>
+struct avx2_semiring {
+  static constexpr bool enabled = false;
+};
+
+template <typename T>
+struct avx2_semiring<semiring::plus_times<T>> {
+  using L = avx2_lanes<T>;
+  static constexpr bool enabled = L::enabled;
+  template <typename V>
+  static V add(V a, V b) {
+    return L::add(a, b);
+  }
+  template <typename V>
+  static V mul(V a, V b) {
+    return L::mul(a, b);
+  }
+};
+
+template <typename T>
+struct avx2_semiring<semiring::min_plus<T>> {
+  using L = avx2_lanes<T>;
+  static constexpr bool enabled = L::enabled;
+  template <typename V>
+  static V add(V a, V b) {
+    return L::min(a, b);
+  }
+  template <typename V>
+  static V mul(V a, V b) {
+    return L::add_absorbing(a, b, L::set1(semiring::min_plus<T>::zero()));
+  }
+};
+
+template <>
+struct avx2_semiring<semiring::or_and<std::int32_t>> {
+  using L = avx2_lanes<std::int32_t>;
+  static constexpr bool enabled = true;
+  static __m256i add(__m256i a, __m256i b) { return L::bit_or(a, b); }
+  static __m256i mul(__m256i a, __m256i b) { return L::bit_and(a, b); }
+};
+#endif
+
+/// c[j] = add(c[j], mul(x, b[j])) for j in [0, n).
+template <typename S, typename T>
+inline void semiring_axpy(T *c, T x, const T *b, std::size_t n) noexcept {
+  std::size_t j = 0;
+#if defined(__AVX2__)
+  if constexpr (avx2_semiring<S>::enabled) {
+    using L = avx2_lanes<T>;
+    auto xv = L::set1(x);
+    for (; j + L::width <= n; j += L::width) {
+      auto prod = avx2_semiring<S>::mul(xv, L::load(b + j));
+      L::store(c + j, avx2_semiring<S>::add(L::load(c + j), prod));
+    }
+  }
+#endif
+  for (; j < n; ++j) {
+    c[j] = S::add(c[j], S::mul(x, b[j]));
+  }
+}
+
+template <typename R, typename T, typename Op>
+R zip_with(ConstMatrixView<T> lhs, ConstMatrixView<T> rhs, Op op) {
+  check_kernel_type<T>();
+  if (lhs.shape() != rhs.shape()) {
+    throw std::runtime_error("Matrix shapes do not match");
+  }
+  auto [num_rows, num_columns] = lhs.shape();
+  R result(num_rows, num_columns);
+  if (lhs.empty()) {
+    return result;
+  }
+  for (std::size_t i = 0; i < num_rows; ++i) {
+    T *z = &result(i, 0);
+    if (lhs.rows_contiguous() && rhs.rows_contiguous()) {
+      const T *x = &lhs(i, 0);
+      const T *y = &rhs(i, 0);
+      for (std::size_t j = 0; j < num_columns; ++j) {
+        z[j] = op(x[j], y[j]);
+      }
+    } else {
+      for (std::size_t j = 0; j < num_columns; ++j) {
+        z[j] = op(lhs(i, j), rhs(i, j));
+      }
+    }
+  }
+  return result;
+}
+
+} // namespace detail
+
+template <typename T, semiring_for<T> S>
+void matmul_into(MatrixView<T> c, std::type_identity_t<ConstMatrixView<T>> a,
+                 std::type_identity_t<ConstMatrixView<T>> b, S s,
+                 parallel::thread_pool *pool) {
+  detail::check_kernel_type<T>();
+  auto [n, k] = a.shape();
+  auto [b_rows, m] = b.shape();
+  if (k != b_rows || c.shape() != std::make_pair(n, m)) {
+    throw std::runtime_error("Matrix dimensions do not match for matmul");
+  }
+  if (c.empty() || k == 0) {
+    return;
+  }
+  if (!b.rows_contiguous()) {
+    // The row kernel streams rows of b, so a strided b (e.g. a transposed
+    // view) is packed once; this is O(km) against the O(nkm) product.
+    Matrix<T> packed = b.to_matrix();
+    matmul_into(c, a, ConstMatrixView<T>(packed), s, pool);
+    return;
+  }
+
+  // A depth_block x column_block panel of b is reused by every row of a
+  // row block, and a row block of c is only written by one task.
+  constexpr std::size_t row_block = 64;
+  constexpr std::size_t depth_block = 128;
+  constexpr std::size_t column_block = 512;
+
+  auto multiply_block = [&](std::size_t block) {
+    std::size_t i_begin = block * row_block;
+    std::size_t i_end = std::min(n, i_begin + row_block);
+    for (std::size_t kk = 0; kk < k; kk += depth_block) {
+      std::size_t k_end = std::min(k, kk + depth_block);
+      for (std::size_t jj = 0; jj < m; jj += column_block) {
+        std::size_t width = std::min(m, jj + column_block) - jj;
+        for (std::size_t i = i_begin; i < i_end; ++i) {
+          for (std::size_t p = kk; p < k_end; ++p) {
+            T x = a(i, p);
+            if (std::is_integral_v<T> && x == S::zero()) {
+              continue;
+            }
+            if (c.rows_contiguous()) {
+              detail::semiring_axpy<S>(&c(i, jj), x, &b(p, jj), width);
+            } else {
+              for (std::size_t j = jj; j < jj + width; ++j) {
+                c(i, j) = S::add(c(i, j), S::mul(x, b(p, j)));
+              }
+            }
+          }
+        }
+      }
+    }
+  };
+
+  detail::for_each_block((n + row_block - 1) / row_block, pool,
+                         multiply_block);
+}
+
+template <matrix_operand M1, matrix_operand M2,
+          semiring_for<matrix_value_t<M1>> S>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> matmul(const M1 &a, const M2 &b, S s,
+                           parallel::thread_pool *pool) {
+  using T = matrix_value_t<M1>;
+  auto a_view = detail::const_view(a);
+  auto b_view = detail::const_view(b);
+  if (a_view.num_columns() != b_view.num_rows()) {
+    throw std::runtime_error("Matrix dimensions do not match for matmul");
+  }
+  matrix_result_t<M1> c(a_view.num_rows(), b_view.num_columns(), S::zero());
+  matmul_into<T>(c, a_view, b_view, s, pool);
+  return c;
+}
+
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> matmul(const M1 &a, const M2 &b,
+                           parallel::thread_pool *pool) {
+  return matmul(a, b, semiring::plus_times<matrix_value_t<M1>>{}, pool);
+}
+
+template <matrix_operand M>
+matrix_result_t<M> transpose(const M &m, parallel::thread_pool *pool) {
+  detail::check_kernel_type<matrix_value_t<M>>();
+  auto source = detail::const_view(m);
+  auto [num_rows, num_columns] = source.shape();
+  matrix_result_t<M> t(num_columns, num_rows);
+  if (source.empty()) {
+    return t;
+  }
+
+  constexpr std::size_t tile = 32;
+  auto transpose_tile_row = [&](std::size_t block) {
+    std::size_t i_begin = block * tile;
+    std::size_t i_end = std::min(num_rows, i_begin + tile);
+    for (std::size_t jj = 0; jj < num_columns; jj += tile) {
+      std::size_t j_end = std::min(num_columns, jj + tile);
+      for (std::size_t i = i_begin; i < i_end; ++i) {
+        for (std::size_t j = jj; j < j_end; ++j) {
+          t(j, i) = source(i, j);
+        }
+      }
+    }
+  };
+
+  detail::for_each_block((num_rows + tile - 1) / tile, pool,
+                         transpose_tile_row);
+  return t;
+}
+
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> operator+(const M1 &lhs, const M2 &rhs) {
+  using T = matrix_value_t<M1>;
+  return detail::zip_with<matrix_result_t<M1>, T>(
+      lhs, rhs, [](T x, T y) { return T(x + y); });
+}
+
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> operator-(const M1 &lhs, const M2 &rhs) {
+  using T = matrix_value_t<M1>;
+  return detail::zip_with<matrix_result_t<M1>, T>(
+      lhs, rhs, [](T x, T y) { return T(x - y); });
+}
+
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> operator*(const M1 &lhs, const M2 &rhs) {
+  using T = matrix_value_t<M1>;
+  return detail::zip_with<matrix_result_t<M1>, T>(
+      lhs, rhs, [](T x, T y) { return T(x * y); });
+}
+
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> elementwise_min(const M1 &lhs, const M2 &rhs) {
+  using T = matrix_value_t<M1>;
+  return detail::zip_with<matrix_result_t<M1>, T>(
+      lhs, rhs, [](T x, T y) { return y < x ? y : x; });
+}
+
+template <matrix_operand M1, matrix_operand M2>
+  requires std::is_same_v<matrix_value_t<M1>, matrix_value_t<M2>>
+matrix_result_t<M1> elementwise_max(const M1 &lhs, const M2 &rhs) {
+  using T = matrix_value_t<M1>;
+  return detail::zip_with<matrix_result_t<M1>, T>(
+      lhs, rhs, [](T x, T y) { return x < y ? y : x; });
+}
+
+template <typename T, typename F>
+void for_each_tile(MatrixView<T> m, std::size_t tile_rows,
+                   std::size_t tile_columns, F &&f) {
+  if (tile_rows == 0 || tile_columns == 0) {
+    throw std::invalid_argument("Tile dimensions must be positive");
+  }
+  for (std::size_t i = 0; i < m.num_rows(); i += tile_rows) {
+    std::size_t height = std::min(tile_rows, m.num_rows() - i);
+    for (std::size_t j = 0; j < m.num_columns(); j += tile_columns) {
+      f(m.block(i, j, height, std::min(tile_columns, m.num_columns() - j)));
+    }
+  }
+}
+
+template <matrix_operand M, typename Op>
+std::vector<matrix_value_t<M>> reduce_rows(const M &m, matrix_value_t<M> init,
+                                           Op op, parallel::thread_pool *pool) {
+  using T = matrix_value_t<M>;
+  detail::check_kernel_type<T>();
+  auto source = detail::const_view(m);
+  auto [num_rows, num_columns] = source.shape();
+  std::vector<T> result(num_rows, init);
+
+  constexpr std::size_t rows_per_block = 64;
+  auto reduce_block = [&](std::size_t block) {
+    std::size_t i_end = std::min(num_rows, (block + 1) * rows_per_block);
+    for (std::size_t i = block * rows_per_block; i < i_end; ++i) {
+      T acc = init;
+      for (std::size_t j = 0; j < num_columns; ++j) {
+        acc = op(acc, source(i, j));
+      }
+      result[i] = acc;
+    }
+  };
+
+  detail::for_each_block((num_rows + rows_per_block - 1) / rows_per_block,
+                         pool, reduce_block);
+  return result;
+}
+
+template <matrix_operand M, typename Op>
+std::vector<matrix_value_t<M>>
+reduce_columns(const M &m, matrix_value_t<M> init, Op op,
+               parallel::thread_pool *pool) {
+  using T = matrix_value_t<M>;
+  detail::check_kernel_type<T>();
+  auto source = detail::const_view(m);
+  auto [num_rows, num_columns] = source.shape();
+  std::vector<T> result(num_columns, init);
+  if (source.empty()) {
+    return result;
+  }
+
+  // Each task owns a strip of columns and sweeps it down all the rows.
+  constexpr std::size_t columns_per_block = 1024;
+  auto reduce_block = [&](std::size_t block) {
+    std::size_t j_begin = block * columns_per_block;
+    std::size_t j_end = std::min(num_columns, j_begin + columns_per_block);
+    T *acc = result.data();
+    for (std::size_t i = 0; i < num_rows; ++i) {
+      if (source.rows_contiguous()) {
+        const T *row = &source(i, 0);
+        for (std::size_t j = j_begin; j < j_end; ++j) {
+          acc[j] = op(acc[j], row[j]);
+        }
+      } else {
+        for (std::size_t j = j_begin; j < j_end; ++j) {
+          acc[j] = op(acc[j], source(i, j));
+        }
+      }
+    }
+  };
+
+  detail::for_each_block(
+      (num_columns + columns_per_block - 1) / columns_per_block, pool,
+      reduce_block);
+  return result;
+}
+
 } // namespace utils
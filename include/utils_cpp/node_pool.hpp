@@ -0,0 +1,173 @@
+/**********************************************************************
+ * @brief Slab allocator with a free list for fixed-size tree nodes.
+ * @details Nodes are carved out of slabs that double in size, and freed
+ *nodes go on an intrusive free list for reuse. Releasing the pool frees
+ *every slab at once without visiting the nodes, which is what makes
+ *clearing or destroying a tree of trivially destructible nodes O(1) in the
+ *number of nodes. Used by AVLTree and IntervalTree.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace utils {
+
+template <typename Node, typename Allocator = std::allocator<Node>>
+class NodePool {
+public:
+  /// First slab size, in nodes. Later slabs double, up to max_slab_size.
+  static constexpr std::size_t min_slab_size = 64;
+  static constexpr std::size_t max_slab_size = std::size_t{1} << 16;
+
+  explicit NodePool(const Allocator &alloc = Allocator()) : alloc_{alloc} {}
+  ~NodePool() { release(); }
+
+  NodePool(const NodePool &) = delete;
+  NodePool &operator=(const NodePool &) = delete;
+
+  NodePool(NodePool &&other) noexcept
+      : alloc_{std::move(other.alloc_)},
+        slabs_{std::exchange(other.slabs_, {})},
+        free_{std::exchange(other.free_, nullptr)},
+        next_{std::exchange(other.next_, nullptr)},
+        end_{std::exchange(other.end_, nullptr)},
+        size_{std::exchange(other.size_, 0)} {}
+
+  NodePool &operator=(NodePool &&other) noexcept {
+    if (this != &other) {
+      release();
+      alloc_ = std::move(other.alloc_);
+      slabs_ = std::exchange(other.slabs_, {});
+      free_ = std::exchange(other.free_, nullptr);
+      next_ = std::exchange(other.next_, nullptr);
+      end_ = std::exchange(other.end_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  /**
+   * Constructs a node from args in a free slot.
+   */
+  template <typename... Args>
+  Node *create(Args &&...args) {
+    slot *s = take();
+    try {
+      Node *node = ::new (static_cast<void *>(s->storage))
+          Node(std::forward<Args>(args)...);
+      ++size_;
+      return node;
+    } catch (...) {
+      give_back(s);
+      throw;
+    }
+  }
+
+  /**
+   * Destroys a node created by this pool and puts its slot on the free list.
+   */
+  void destroy(Node *node) noexcept {
+    std::destroy_at(node);
+    --size_;
+    give_back(reinterpret_cast<slot *>(node));
+  }
+
+  /**
+   * Makes room for n more nodes in one contiguous slab, unless the current
+   * slab already has room.
+   */
+  void reserve(std::size_t n) {
+    if (static_cast<std::size_t>(end_ - next_) < n) {
+      add_slab(n);
+    }
+  }
+
+  /**
+   * Frees every slab without running node destructors. The caller must have
+   * destroyed the live nodes already unless Node is trivially destructible.
+   */
+  void release() noexcept {
+    slot_allocator a = slot_alloc();
+    for (auto [slab, count] : slabs_) {
+      std::allocator_traits<slot_allocator>::deallocate(a, slab, count);
+    }
+    slabs_.clear();
+    free_ = next_ = end_ = nullptr;
+    size_ = 0;
+  }
+
+  /**
+   * Takes over the slabs of other, so its live nodes now belong to this
+   * pool. The allocators must compare equal. Free slots of other are dropped
+   * rather than merged, and stay unused until release().
+   */
+  void splice(NodePool &&other) {
+    slabs_.insert(slabs_.end(), other.slabs_.begin(), other.slabs_.end());
+    size_ += other.size_;
+    other.slabs_.clear();
+    other.free_ = other.next_ = other.end_ = nullptr;
+    other.size_ = 0;
+  }
+
+  Allocator get_allocator() const { return alloc_; }
+
+  /**
+   * Number of live nodes.
+   */
+  std::size_t size() const noexcept { return size_; }
+
+private:
+  union slot {
+    slot *next;
+    alignas(Node) unsigned char storage[sizeof(Node)];
+  };
+
+  using slot_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<slot>;
+
+  slot_allocator slot_alloc() const { return slot_allocator(alloc_); }
+
+  slot *take() {
+    if (free_) {
+      return std::exchange(free_, free_->next);
+    }
+    if (next_ == end_) {
+      std::size_t last = slabs_.empty() ? 0 : slabs_.back().second;
+      add_slab(std::clamp(2 * last, min_slab_size, max_slab_size));
+    }
+    return next_++;
+  }
+
+  void give_back(slot *s) noexcept {
+    s->next = free_;
+    free_ = s;
+  }
+
+  void add_slab(std::size_t count) {
+    slabs_.reserve(slabs_.size() + 1);
+    slot_allocator a = slot_alloc();
+    slot *slab = std::allocator_traits<slot_allocator>::allocate(a, count);
+    slabs_.emplace_back(slab, count);
+    // The rest of the old slab is abandoned; slabs are only freed together.
+    next_ = slab;
+    end_ = slab + count;
+  }
+
+  Allocator alloc_;
+  std::vector<std::pair<slot *, std::size_t>> slabs_;
+  slot *free_ = nullptr; ///< freed slots, linked through slot::next
+  slot *next_ = nullptr; ///< bump pointer into the newest slab
+  slot *end_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+} // namespace utils
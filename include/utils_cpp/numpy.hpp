@@ -1,6 +1,13 @@
 /**********************************************************************
  * @brief Various numpy features, C++-ified.
- * @details
+ * @details arange as a lazy view, and reading and writing .npy and .npz
+ *files. Readers map the file and return NpyArray views into it, so loading
+ *an array of any size copies nothing; an NpzFile is indexed from the zip
+ *central directory and hands out views of its stored members. NpyWriter
+ *and NpzWriter stream the data, so arrays larger than memory can be written
+ *a row at a time; the npz writer pads every member so its data is 64-byte
+ *aligned in the file and can be mapped back without a copy. The header
+ *format is shared with the memory-mapped MappedMatrix.
  * @author Sam Tonetto
  * @copyright GNU Public License
  * @date 2023
@@ -8,8 +15,30 @@
 
 #pragma once
 
+#include "utils_cpp/mapped_file.hpp"
+#include "utils_cpp/matrix.hpp"
+#include "utils_cpp/ranges.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace utils {
 
@@ -17,6 +46,9 @@ namespace utils {
  * Just create a basic range [start,stop) with optional step size, like
  * np.arange. Start, stop, and step must be the same type. In the examples,
  * aggregate initialization is used, but you can also use parentheses.
+ * The range is a lazy random-access view: element i is start + i * step,
+ * computed on access, so it composes with std::views without a temporary
+ * vector, and to_vector fills one in a vectorized loop.
  * @example
  * for (auto i : arange{10}) { ... } // 0,1,2,3,4,5,6,7,8,9
  * for (auto i : arange{1, 10}) { ... } // 1,2,3,4,5,6,7,8,9
@@ -27,57 +59,1158 @@ namespace utils {
  * auto range = arange{1.0, 10.0, 0.5}; // OK - double
  * auto range = arange{1, 10, 1};       // OK - int
  * auto range = arange{1, 10, 0.5};     // ERROR - different types
+ * @example
+ * auto squares = arange{5} | std::views::transform(square); // lazy
  */
 template <typename T>
-struct arange {
-  T start;
-  T stop;
-  T step;
+struct arange : std::ranges::view_interface<arange<T>> {
+  T start{};
+  T stop{};
+  T step{1};
 
-  std::size_t size;
+  using iterator = detail::linear_iterator<T>;
 
   arange() = default;
 
-  arange(T start, T stop, T step = 1)
-      : start{start}, stop{stop}, step{step},
-        size{static_cast<std::size_t>((stop - start) / step)} {
-
+  arange(T start, T stop, T step = 1) : start{start}, stop{stop}, step{step} {
     if (step == 0) {
       throw std::invalid_argument("arange step cannot be zero");
     }
   }
 
-  arange(T stop)
-      : start{0}, stop{stop}, step{1},
-        size{static_cast<std::size_t>((stop - start) / step)} {
+  arange(T stop) : arange(T{0}, stop) {}
 
-    if (step == 0) {
-      throw std::invalid_argument("arange step cannot be zero");
-    }
-  }
+  /// Number of elements, ceil((stop - start) / step) or 0, as in numpy.
+  std::size_t size() const noexcept;
 
   T operator[](std::size_t i) const {
-    if (i >= size) {
+    if (i >= size()) {
       throw std::out_of_range("arange index out of range");
     }
-    return start + i * step;
+    return begin()[static_cast<std::ptrdiff_t>(i)];
+  }
+
+  iterator begin() const noexcept { return {start, step, 0}; }
+  iterator end() const noexcept { return {start, step, size()}; }
+
+  std::vector<T> to_vector() const {
+    return LinearView<T>(start, step, size()).to_vector();
+  }
+};
+
+template <typename T>
+std::size_t arange<T>::size() const noexcept {
+  if (step > 0 ? !(start < stop) : !(stop < start)) {
+    return 0;
+  }
+  if constexpr (std::is_integral_v<T>) {
+    // In unsigned arithmetic, so that stop - start cannot overflow.
+    using U = std::make_unsigned_t<T>;
+    U distance = step > 0 ? static_cast<U>(static_cast<U>(stop) -
+                                           static_cast<U>(start))
+                          : static_cast<U>(static_cast<U>(start) -
+                                           static_cast<U>(stop));
+    U magnitude = step > 0 ? static_cast<U>(step)
+                           : static_cast<U>(U{0} - static_cast<U>(step));
+    return static_cast<std::size_t>((distance - 1) / magnitude) + 1;
+  } else {
+    return static_cast<std::size_t>(std::ceil((stop - start) / step));
+  }
+}
+
+/**
+ * The numpy dtype string of T, e.g. "<f8" for double on a little-endian
+ * machine. Only bool, integer and floating-point types are supported.
+ */
+template <typename T>
+std::string npy_descr();
+
+/**
+ * Parsed header of a .npy file.
+ */
+struct NpyHeader {
+  std::string descr;
+  bool fortran_order = false;
+  std::vector<std::size_t> shape;
+  /// Byte offset of the first element.
+  std::size_t data_offset = 0;
+};
+
+/**
+ * The complete header (magic, version, length and dictionary) of a version
+ * 1.0 .npy file holding a C-ordered num_rows x num_columns array of T. It is
+ * padded so that the data starts on a 64-byte boundary.
+ */
+template <typename T>
+std::string npy_header(std::size_t num_rows, std::size_t num_columns);
+
+/**
+ * The header of a C-ordered array of T of any shape; an empty shape is a
+ * scalar.
+ */
+template <typename T>
+std::string npy_header(const std::vector<std::size_t> &shape);
+
+/**
+ * Parses the header at the start of a .npy file (versions 1.0 to 3.0).
+ * @throws std::runtime_error if it is not a valid header
+ */
+NpyHeader parse_npy_header(std::string_view data);
+
+/**
+ * Writes m to filename as a 2D .npy file that numpy.load can read.
+ * @throws std::runtime_error if the file cannot be written
+ */
+template <typename T>
+void save_npy(const std::string &filename, ConstMatrixView<T> m);
+
+/**
+ * Reads a 2D (or 1D, as one column) C-ordered .npy file of T.
+ * @throws std::runtime_error if the file cannot be read, or holds another
+ * dtype or layout
+ */
+template <typename T>
+Matrix<T> load_npy(const std::string &filename);
+
+/**
+ * Writes values to filename as a 1D .npy file.
+ * @throws std::runtime_error if the file cannot be written
+ */
+template <typename T>
+void save_npy(const std::string &filename, const std::vector<T> &values);
+
+/**
+ * Reads all the elements of a .npy file of T, in file order, whatever its
+ * shape.
+ * @throws std::runtime_error if the file cannot be read or holds another
+ * dtype
+ */
+template <typename T>
+std::vector<T> load_npy_vector(const std::string &filename);
+
+/**
+ * @brief An array stored in the npy format, viewed where it lies: usually in
+ * a memory-mapped .npy or .npz file, which the array keeps mapped for as long
+ * as it or a copy of it lives. The elements are only copied if they are not
+ * aligned for their type in the file.
+ *
+ * @details The dtype is checked when the elements are accessed, not when the
+ * array is opened, so arrays of any dtype can be opened and inspected.
+ */
+class NpyArray {
+public:
+  NpyArray() = default;
+
+  /**
+   * Views the npy image held in data, which owner keeps alive.
+   * @throws std::runtime_error if data is not an npy image or is truncated
+   */
+  NpyArray(std::string_view data, std::shared_ptr<const void> owner);
+
+  const NpyHeader &header() const noexcept { return header_; }
+  const std::string &descr() const noexcept { return header_.descr; }
+  const std::vector<std::size_t> &shape() const noexcept {
+    return header_.shape;
+  }
+  bool fortran_order() const noexcept { return header_.fortran_order; }
+  /// Number of elements, the product of the shape.
+  std::size_t size() const noexcept { return size_; }
+  /// The raw elements.
+  std::span<const std::byte> bytes() const noexcept { return bytes_; }
+
+  /**
+   * All the elements, in file order.
+   * @throws std::runtime_error if the dtype is not that of T
+   */
+  template <typename T>
+  std::span<const T> values() const;
+
+  /**
+   * The elements of a C-ordered 2D array, or of a 1D array as one column.
+   * @throws std::runtime_error if the dtype is not that of T, or the array
+   * is not a 1D or 2D C-ordered one
+   */
+  template <typename T>
+  ConstMatrixView<T> matrix() const;
+
+private:
+  NpyHeader header_;
+  std::size_t size_ = 0;
+  std::span<const std::byte> bytes_;
+  std::shared_ptr<const void> owner_;
+};
+
+/**
+ * Maps a .npy file and views its array.
+ * @throws std::runtime_error if the file cannot be read or is not an npy
+ * file
+ */
+NpyArray map_npy(const std::string &filename);
+
+/**
+ * @brief A memory-mapped .npz archive, as written by numpy.savez or
+ * NpzWriter. Members are found through the central directory of the zip
+ * file and viewed in place. Compressed members (numpy.savez_compressed) are
+ * listed but cannot be opened.
+ */
+class NpzFile {
+public:
+  /**
+   * @throws std::runtime_error if the file cannot be read or is not a zip
+   * file
+   */
+  explicit NpzFile(const std::string &filename);
+
+  /// Array names, without the ".npy" suffix, in sorted order.
+  std::vector<std::string> names() const;
+  bool contains(std::string_view name) const;
+  std::size_t size() const noexcept { return entries_.size(); }
+
+  /**
+   * The array called name, which stays valid after the NpzFile is gone.
+   * @throws std::out_of_range if there is no such array
+   * @throws std::runtime_error if it is compressed or malformed
+   */
+  NpyArray operator[](std::string_view name) const;
+
+private:
+  struct entry {
+    std::uint64_t local_header_offset = 0;
+    std::uint64_t size = 0;
+    std::uint16_t method = 0;
+  };
+
+  std::string filename_;
+  std::shared_ptr<const MappedFile> file_;
+  std::map<std::string, entry, std::less<>> entries_;
+};
+
+/**
+ * @brief Writes a .npy file of T incrementally: the header is written on
+ * construction, then the elements in any number of calls to write, in
+ * C order. Nothing is buffered beyond the stream's own buffer.
+ *
+ * @example
+ * NpyWriter<float> out("big.npy", {num_rows, num_columns});
+ * for (...) { out.write(row); }
+ * out.close();
+ */
+template <typename T>
+class NpyWriter {
+public:
+  /// @throws std::runtime_error if the file cannot be opened
+  NpyWriter(const std::string &filename, const std::vector<std::size_t> &shape);
+
+  /// Closes the file if close was not called, without reporting errors.
+  ~NpyWriter() = default;
+  NpyWriter(NpyWriter &&) = default;
+  NpyWriter &operator=(NpyWriter &&) = default;
+
+  /// @throws std::runtime_error if this would write more elements than the
+  /// shape holds
+  void write(std::span<const T> values);
+
+  /// Elements still to be written.
+  std::size_t remaining() const noexcept { return remaining_; }
+
+  /// @throws std::runtime_error if elements are missing or writing failed
+  void close();
+
+private:
+  std::string filename_;
+  std::ofstream out_;
+  std::size_t remaining_ = 0;
+};
+
+/**
+ * @brief Writes a .npz archive (an uncompressed zip of .npy files, as
+ * numpy.savez writes) incrementally. Arrays are added whole with add, or
+ * streamed between begin_array and end_array; the CRC of each member is
+ * computed as its data is written. Members larger than 4 GiB use zip64.
+ * Every member's data starts on a 64-byte boundary of the file.
+ *
+ * @example
+ * NpzWriter npz("graph.npz");
+ * npz.add("weights", weights);
+ * npz.begin_array<double>("embedding", {n, dim});
+ * for (...) { npz.write<double>(row); }
+ * npz.end_array();
+ * npz.close();
+ */
+class NpzWriter {
+public:
+  /// @throws std::runtime_error if the file cannot be opened
+  explicit NpzWriter(const std::string &filename);
+
+  /// Closes the archive if close was not called and no array is left
+  /// unfinished, without reporting errors.
+  ~NpzWriter();
+  NpzWriter(NpzWriter &&) = default;
+  NpzWriter &operator=(NpzWriter &&) = default;
+
+  /**
+   * Starts an array called name (stored as name.npy) of the given shape.
+   * @throws std::logic_error if another array is still open
+   * @throws std::invalid_argument if the name is already used
+   */
+  template <typename T>
+  void begin_array(const std::string &name,
+                   const std::vector<std::size_t> &shape);
+
+  /**
+   * Appends elements to the open array.
+   * @throws std::logic_error if no array of T is open
+   * @throws std::runtime_error if this would write more elements than its
+   * shape holds
+   */
+  template <typename T>
+  void write(std::span<const T> values);
+
+  /// @throws std::logic_error if no array is open or elements are missing
+  void end_array();
+
+  /// Adds a whole 2D array.
+  template <typename T>
+  void add(const std::string &name, ConstMatrixView<T> m);
+
+  /// Adds a whole 1D array.
+  template <typename T>
+  void add(const std::string &name, const std::vector<T> &values);
+
+  /**
+   * Writes the central directory and closes the file.
+   * @throws std::logic_error if an array is still open
+   * @throws std::runtime_error if writing failed
+   */
+  void close();
+
+private:
+  struct member {
+    std::string name;
+    std::uint64_t local_header_offset = 0;
+    std::uint64_t size = 0;
+    std::uint32_t crc = 0;
+  };
+
+  void write_bytes(const void *data, std::size_t size);
+
+  std::string filename_;
+  std::ofstream out_;
+  std::uint64_t offset_ = 0;
+  std::vector<member> members_;
+  // The open array: its dtype, the elements left and the running CRC.
+  bool open_ = false;
+  std::string descr_;
+  std::uint64_t remaining_ = 0;
+  std::uint32_t crc_ = 0;
+};
+
+// ==== Implementation ====
+
+template <typename T>
+std::string npy_descr() {
+  static_assert(std::is_arithmetic_v<T>, "npy_descr needs a numeric type");
+  char kind = std::is_same_v<T, bool>           ? 'b'
+              : std::is_floating_point_v<T>    ? 'f'
+              : std::is_signed_v<T>            ? 'i'
+                                               : 'u';
+  char order = sizeof(T) == 1                           ? '|'
+               : std::endian::native == std::endian::little ? '<'
+                                                            : '>';
+  return std::string{order, kind} + std::to_string(sizeof(T));
+}
+
+namespace detail {
+
+inline std::string npy_header_for(const std::string &descr,
+                                  const std::vector<std::size_t> &shape) {
+  // Shapes are written as Python tuples: "()", "(7,)" or "(3, 4)".
+  std::string dict = "{'descr': '";
+  dict += descr;
+  dict += "', 'fortran_order': False, 'shape': (";
+  for (std::size_t i = 0; i < shape.size(); ++i) {
+    dict += i == 0 ? "" : ", ";
+    dict += std::to_string(shape[i]);
+  }
+  dict += shape.size() == 1 ? ",), }" : "), }";
+
+  // 6 bytes of magic, 2 of version and 2 of length precede the dictionary,
+  // which is padded with spaces and ends in a newline.
+  constexpr std::size_t preamble = 10;
+  std::size_t total = (preamble + dict.size() + 1 + 63) / 64 * 64;
+  std::size_t dict_length = total - preamble;
+  if (dict_length > 0xffff) {
+    throw std::runtime_error("npy header too long");
+  }
+  dict.resize(dict_length - 1, ' ');
+  dict += '\n';
+
+  std::string header = "\x93NUMPY";
+  header += '\x01';
+  header += '\x00';
+  header += static_cast<char>(dict_length & 0xff);
+  header += static_cast<char>(dict_length >> 8);
+  return header + dict;
+}
+
+} // namespace detail
+
+template <typename T>
+std::string npy_header(std::size_t num_rows, std::size_t num_columns) {
+  return detail::npy_header_for(npy_descr<T>(), {num_rows, num_columns});
+}
+
+template <typename T>
+std::string npy_header(const std::vector<std::size_t> &shape) {
+  return detail::npy_header_for(npy_descr<T>(), shape);
+}
+
+namespace detail {
+
+inline std::string_view npy_value(std::string_view dict, std::string_view key) {
+  std::string quoted(1, '\'');
+  quoted.append(key);
+  quoted += '\'';
+  std::size_t pos = dict.find(quoted);
+  if (pos == std::string_view::npos) {
+    throw std::runtime_error("npy header has no " + std::string(key));
+  }
+  pos = dict.find(':', pos);
+  if (pos == std::string_view::npos) {
+    throw std::runtime_error("Malformed npy header");
+  }
+  return dict.substr(pos + 1);
+}
+
+} // namespace detail
+
+namespace detail {
+
+/// Lengths of the preamble (magic, version and length field) and of the
+/// dictionary that follows it, read from the first 12 bytes of data.
+inline std::pair<std::size_t, std::size_t>
+npy_header_lengths(std::string_view data) {
+  if (data.size() < 10 || data.substr(0, 6) != "\x93NUMPY") {
+    throw std::runtime_error("Not an npy file");
+  }
+  auto byte = [&](std::size_t i) {
+    return static_cast<std::size_t>(static_cast<unsigned char>(data[i]));
+  };
+  switch (byte(6)) {
+  case 1:
+    return {10, byte(8) | byte(9) << 8};
+  case 2:
+  case 3:
+    if (data.size() < 12) {
+      throw std::runtime_error("Truncated npy header");
+    }
+    return {12, byte(8) | byte(9) << 8 | byte(10) << 16 | byte(11) << 24};
+  default:
+    throw std::runtime_error("Unsupported npy version");
+  }
+}
+
+} // namespace detail
+
+inline NpyHeader parse_npy_header(std::string_view data) {
+  auto [preamble, dict_length] = detail::npy_header_lengths(data);
+  if (data.size() < preamble + dict_length) {
+    throw std::runtime_error("Truncated npy header");
+  }
+
+  std::string_view dict = data.substr(preamble, dict_length);
+  NpyHeader header;
+  header.data_offset = preamble + dict_length;
+
+  std::string_view descr = detail::npy_value(dict, "descr");
+  std::size_t open = descr.find('\'');
+  std::size_t close = descr.find('\'', open + 1);
+  if (open == std::string_view::npos || close == std::string_view::npos) {
+    throw std::runtime_error("Malformed npy descr");
+  }
+  header.descr = std::string(descr.substr(open + 1, close - open - 1));
+
+  std::string_view order = detail::npy_value(dict, "fortran_order");
+  order.remove_prefix(std::min(order.find_first_not_of(' '), order.size()));
+  header.fortran_order = order.starts_with("True");
+
+  std::string_view shape = detail::npy_value(dict, "shape");
+  open = shape.find('(');
+  close = shape.find(')');
+  if (open == std::string_view::npos || close == std::string_view::npos) {
+    throw std::runtime_error("Malformed npy shape");
+  }
+  std::size_t value = 0;
+  bool in_number = false;
+  for (char c : shape.substr(open + 1, close - open - 1)) {
+    if (c >= '0' && c <= '9') {
+      value = value * 10 + static_cast<std::size_t>(c - '0');
+      in_number = true;
+    } else if (in_number) {
+      header.shape.push_back(value);
+      value = 0;
+      in_number = false;
+    }
+  }
+  if (in_number) {
+    header.shape.push_back(value);
+  }
+  return header;
+}
+
+namespace detail {
+
+/// Rows and columns of a header that describes a C-ordered matrix of T.
+template <typename T>
+std::pair<std::size_t, std::size_t> npy_matrix_shape(const NpyHeader &header) {
+  if (header.descr != npy_descr<T>()) {
+    throw std::runtime_error("npy dtype " + header.descr + " is not " +
+                             npy_descr<T>());
+  }
+  if (header.fortran_order) {
+    throw std::runtime_error("Fortran-ordered npy files are not supported");
+  }
+  if (header.shape.size() == 1) {
+    return {header.shape[0], 1};
+  }
+  if (header.shape.size() != 2) {
+    throw std::runtime_error("npy file is not 1D or 2D");
   }
+  return {header.shape[0], header.shape[1]};
+}
 
-  struct iterator {
-    T value, step;
+} // namespace detail
 
-    T operator*() const { return value; }
-    iterator &operator++() {
-      value += step;
-      return *this;
+namespace detail {
+
+/// Calls emit with the rows of m in order, as spans of contiguous elements;
+/// rows that are not contiguous in m are gathered into a buffer first.
+template <typename T, typename F>
+void for_each_npy_row(ConstMatrixView<T> m, F &&emit) {
+  if (m.rows_contiguous()) {
+    for (std::size_t i = 0; i < m.num_rows(); ++i) {
+      emit(std::span<const T>(m.data() + i * m.row_stride(), m.num_columns()));
+    }
+    return;
+  }
+  std::vector<T> row(m.num_columns());
+  for (std::size_t i = 0; i < m.num_rows(); ++i) {
+    for (std::size_t j = 0; j < m.num_columns(); ++j) {
+      row[j] = m(i, j);
     }
-    bool operator!=(const iterator &other) const {
-      return (step > 0) ? (value < other.value) : (value > other.value);
+    emit(std::span<const T>(row));
+  }
+}
+
+} // namespace detail
+
+template <typename T>
+void save_npy(const std::string &filename, ConstMatrixView<T> m) {
+  NpyWriter<T> out(filename, {m.num_rows(), m.num_columns()});
+  detail::for_each_npy_row(m, [&](std::span<const T> row) { out.write(row); });
+  out.close();
+}
+
+template <typename T>
+void save_npy(const std::string &filename, const std::vector<T> &values) {
+  NpyWriter<T> out(filename, {values.size()});
+  out.write(values);
+  out.close();
+}
+
+template <typename T>
+Matrix<T> load_npy(const std::string &filename) {
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Could not open " + filename);
+  }
+  std::string header(12, '\0');
+  in.read(header.data(), 12);
+  auto [preamble, dict_length] = detail::npy_header_lengths(header);
+  if (preamble + dict_length < header.size()) {
+    throw std::runtime_error("Malformed npy header");
+  }
+  header.resize(preamble + dict_length);
+  in.read(header.data() + 12,
+          static_cast<std::streamsize>(header.size() - 12));
+  NpyHeader parsed = parse_npy_header(header);
+  auto [num_rows, num_columns] = detail::npy_matrix_shape<T>(parsed);
+
+  auto m = Matrix<T>::uninitialized(num_rows, num_columns);
+  in.clear();
+  in.seekg(static_cast<std::streamoff>(parsed.data_offset));
+  if (num_rows * num_columns > 0) {
+    in.read(reinterpret_cast<char *>(&m(0, 0)),
+            static_cast<std::streamsize>(num_rows * num_columns * sizeof(T)));
+  }
+  if (!in) {
+    throw std::runtime_error("Truncated npy file " + filename);
+  }
+  return m;
+}
+
+template <typename T>
+std::vector<T> load_npy_vector(const std::string &filename) {
+  NpyArray array = map_npy(filename);
+  auto values = array.values<T>();
+  return std::vector<T>(values.begin(), values.end());
+}
+
+// ==== NpyArray ====
+
+namespace detail {
+
+/// Size in bytes of one element of dtype descr, e.g. 8 for "<f8". The count
+/// of a unicode string dtype such as "<U5" is in characters of 4 bytes.
+inline std::size_t npy_item_size(std::string_view descr) {
+  std::size_t size = 0;
+  if (descr.size() > 2) {
+    auto [ptr, ec] =
+        std::from_chars(descr.data() + 2, descr.data() + descr.size(), size);
+    if (ec == std::errc() && ptr == descr.data() + descr.size() && size > 0) {
+      if (descr[1] != 'U') {
+        return size;
+      }
+      if (size <= std::numeric_limits<std::size_t>::max() / 4) {
+        return 4 * size;
+      }
+    }
+  }
+  throw std::runtime_error("Unsupported npy dtype " + std::string(descr));
+}
+
+} // namespace detail
+
+inline NpyArray::NpyArray(std::string_view data,
+                          std::shared_ptr<const void> owner)
+    : header_(parse_npy_header(data)), size_(1) {
+  for (std::size_t extent : header_.shape) {
+    size_ *= extent;
+  }
+  std::size_t item_size = detail::npy_item_size(header_.descr);
+  if (size_ > (data.size() - header_.data_offset) / item_size) {
+    throw std::runtime_error("Truncated npy data");
+  }
+  std::size_t num_bytes = size_ * item_size;
+
+  const char *first = data.data() + header_.data_offset;
+  std::size_t alignment = std::min<std::size_t>(std::bit_floor(item_size), 16);
+  if (reinterpret_cast<std::uintptr_t>(first) % alignment == 0) {
+    owner_ = std::move(owner);
+  } else {
+    constexpr std::align_val_t copy_alignment{64};
+    void *copy = ::operator new(std::max<std::size_t>(num_bytes, 1),
+                                copy_alignment);
+    std::memcpy(copy, first, num_bytes);
+    owner_ = std::shared_ptr<const void>(copy, [](const void *p) {
+      ::operator delete(const_cast<void *>(p), copy_alignment);
+    });
+    first = static_cast<const char *>(copy);
+  }
+  bytes_ = {reinterpret_cast<const std::byte *>(first), num_bytes};
+}
+
+template <typename T>
+std::span<const T> NpyArray::values() const {
+  if (header_.descr != npy_descr<T>()) {
+    throw std::runtime_error("npy dtype " + header_.descr + " is not " +
+                             npy_descr<T>());
+  }
+  return {reinterpret_cast<const T *>(bytes_.data()), size_};
+}
+
+template <typename T>
+ConstMatrixView<T> NpyArray::matrix() const {
+  auto [num_rows, num_columns] = detail::npy_matrix_shape<T>(header_);
+  return {values<T>().data(), num_rows, num_columns, num_columns};
+}
+
+inline NpyArray map_npy(const std::string &filename) {
+  auto file = std::make_shared<const MappedFile>(filename);
+  std::string_view data = file->view();
+  return NpyArray(data, std::move(file));
+}
+
+// ==== Zip archives ====
+
+namespace detail {
+
+inline constexpr std::uint32_t zip_local_header_signature = 0x04034b50;
+inline constexpr std::uint32_t zip_central_header_signature = 0x02014b50;
+inline constexpr std::uint32_t zip_end_signature = 0x06054b50;
+inline constexpr std::uint32_t zip64_end_signature = 0x06064b50;
+inline constexpr std::uint32_t zip64_locator_signature = 0x07064b50;
+inline constexpr std::size_t zip_local_header_size = 30;
+inline constexpr std::size_t zip_central_header_size = 46;
+inline constexpr std::size_t zip_end_size = 22;
+inline constexpr std::size_t zip64_end_size = 56;
+inline constexpr std::size_t zip64_locator_size = 20;
+// Fields too large for 16 or 32 bits hold these and move to zip64 records.
+inline constexpr std::uint64_t zip_max16 = 0xffff;
+inline constexpr std::uint64_t zip_max32 = 0xffffffff;
+// Extra field ids: zip64 sizes and offsets, and alignment padding (the id
+// Android's zipalign uses).
+inline constexpr std::uint16_t zip64_extra_id = 0x0001;
+inline constexpr std::uint16_t zip_align_extra_id = 0xd935;
+// Alignment of member data written by NpzWriter.
+inline constexpr std::size_t npz_alignment = 64;
+
+/// The little-endian integer of the given size in bytes at p.
+inline std::uint64_t read_le(const char *p, std::size_t size) noexcept {
+  std::uint64_t value = 0;
+  for (std::size_t i = size; i-- > 0;) {
+    value = value << 8 | static_cast<unsigned char>(p[i]);
+  }
+  return value;
+}
+
+/// Appends value as a little-endian integer of the given size in bytes.
+inline void append_le(std::string &out, std::uint64_t value,
+                      std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    out += static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+}
+
+inline constexpr auto crc32_tables = [] {
+  std::array<std::array<std::uint32_t, 256>, 8> tables{};
+  for (std::uint32_t i = 0; i < 256; ++i) {
+    std::uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320u : 0u);
+    }
+    tables[0][i] = crc;
+  }
+  for (std::size_t k = 1; k < 8; ++k) {
+    for (std::size_t i = 0; i < 256; ++i) {
+      std::uint32_t prev = tables[k - 1][i];
+      tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xff];
+    }
+  }
+  return tables;
+}();
+
+/**
+ * @internal
+ * @brief The CRC-32 of zip (and zlib) of data, continuing from the CRC of
+ * the bytes before it. Slicing-by-8: eight table lookups per 8 bytes.
+ */
+inline std::uint32_t crc32(const void *data, std::size_t size,
+                           std::uint32_t crc = 0) noexcept {
+  const auto &t = crc32_tables;
+  const auto *p = static_cast<const unsigned char *>(data);
+  crc = ~crc;
+  for (; size >= 8; size -= 8, p += 8) {
+    std::uint32_t a = crc ^ static_cast<std::uint32_t>(
+                                read_le(reinterpret_cast<const char *>(p), 4));
+    auto b = static_cast<std::uint32_t>(
+        read_le(reinterpret_cast<const char *>(p + 4), 4));
+    crc = t[7][a & 0xff] ^ t[6][(a >> 8) & 0xff] ^ t[5][(a >> 16) & 0xff] ^
+          t[4][a >> 24] ^ t[3][b & 0xff] ^ t[2][(b >> 8) & 0xff] ^
+          t[1][(b >> 16) & 0xff] ^ t[0][b >> 24];
+  }
+  for (; size > 0; --size, ++p) {
+    crc = t[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+} // namespace detail
+
+// ==== NpzFile ====
+
+inline NpzFile::NpzFile(const std::string &filename)
+    : filename_(filename),
+      file_(std::make_shared<const MappedFile>(filename)) {
+  const char *data = file_->data();
+  const std::size_t size = file_->size();
+  auto require = [&](bool ok) {
+    if (!ok) {
+      throw std::runtime_error("Malformed npz file " + filename_);
     }
   };
+  auto u16 = [&](std::uint64_t at) { return detail::read_le(data + at, 2); };
+  auto u32 = [&](std::uint64_t at) { return detail::read_le(data + at, 4); };
+  auto u64 = [&](std::uint64_t at) { return detail::read_le(data + at, 8); };
 
-  iterator begin() const { return {start, step}; }
-  iterator end() const { return {stop, step}; }
-};
+  // The end of central directory record is last, followed only by a
+  // comment of at most 64 KiB.
+  require(size >= detail::zip_end_size);
+  std::size_t end = size - detail::zip_end_size;
+  std::size_t lowest = end - std::min<std::size_t>(end, detail::zip_max16);
+  while (u32(end) != detail::zip_end_signature) {
+    require(end > lowest);
+    --end;
+  }
+  std::uint64_t num_entries = u16(end + 10);
+  std::uint64_t directory_size = u32(end + 12);
+  std::uint64_t directory_offset = u32(end + 16);
+  if (num_entries == detail::zip_max16 ||
+      directory_size == detail::zip_max32 ||
+      directory_offset == detail::zip_max32) {
+    require(end >= detail::zip64_locator_size);
+    std::size_t locator = end - detail::zip64_locator_size;
+    require(u32(locator) == detail::zip64_locator_signature);
+    std::uint64_t end64 = u64(locator + 8);
+    require(end64 <= locator - std::min<std::size_t>(
+                                   locator, detail::zip64_end_size) &&
+            u32(end64) == detail::zip64_end_signature);
+    num_entries = u64(end64 + 32);
+    directory_size = u64(end64 + 40);
+    directory_offset = u64(end64 + 48);
+  }
+  require(directory_offset <= end && directory_size <= end - directory_offset);
+
+  std::uint64_t at = directory_offset;
+  const std::uint64_t directory_end = directory_offset + directory_size;
+  for (std::uint64_t i = 0; i < num_entries; ++i) {
+    require(directory_end - at >= detail::zip_central_header_size &&
+            u32(at) == detail::zip_central_header_signature);
+    entry e;
+    e.method = static_cast<std::uint16_t>(u16(at + 10));
+    e.size = u32(at + 20);
+    std::uint64_t uncompressed_size = u32(at + 24);
+    e.local_header_offset = u32(at + 42);
+    std::uint64_t name_length = u16(at + 28);
+    std::uint64_t extra_length = u16(at + 30);
+    std::uint64_t comment_length = u16(at + 32);
+    std::uint64_t next = at + detail::zip_central_header_size + name_length +
+                         extra_length + comment_length;
+    require(next <= directory_end);
+    std::string name(data + at + detail::zip_central_header_size,
+                     name_length);
+
+    // Fields that overflowed are in the zip64 extra field, in this order.
+    std::uint64_t extra = at + detail::zip_central_header_size + name_length;
+    const std::uint64_t extra_end = extra + extra_length;
+    while (extra_end - extra >= 4) {
+      std::uint64_t id = u16(extra), length = u16(extra + 2);
+      require(extra_end - extra - 4 >= length);
+      if (id == detail::zip64_extra_id) {
+        std::uint64_t field = extra + 4;
+        for (std::uint64_t *value :
+             {&uncompressed_size, &e.size, &e.local_header_offset}) {
+          if (*value == detail::zip_max32) {
+            require(field + 8 <= extra + 4 + length);
+            *value = u64(field);
+            field += 8;
+          }
+        }
+      }
+      extra += 4 + length;
+    }
+
+    if (name.ends_with(".npy")) {
+      name.resize(name.size() - 4);
+    }
+    entries_[std::move(name)] = e;
+    at = next;
+  }
+}
+
+inline std::vector<std::string> NpzFile::names() const {
+  std::vector<std::string> result;
+  result.reserve(entries_.size());
+  for (const auto &[name, e] : entries_) {
+    result.push_back(name);
+  }
+  return result;
+}
+
+inline bool NpzFile::contains(std::string_view name) const {
+  return entries_.find(name) != entries_.end();
+}
+
+inline NpyArray NpzFile::operator[](std::string_view name) const {
+  auto it = entries_.find(name);
+  if (it == entries_.end()) {
+    throw std::out_of_range("npz file has no array " + std::string(name));
+  }
+  const entry &e = it->second;
+  if (e.method != 0) {
+    throw std::runtime_error("npz array " + std::string(name) +
+                             " is compressed");
+  }
+  const char *data = file_->data();
+  const std::size_t size = file_->size();
+  std::uint64_t at = e.local_header_offset;
+  if (at > size || size - at < detail::zip_local_header_size ||
+      detail::read_le(data + at, 4) != detail::zip_local_header_signature) {
+    throw std::runtime_error("Malformed npz file " + filename_);
+  }
+  std::uint64_t first = at + detail::zip_local_header_size +
+                        detail::read_le(data + at + 26, 2) +
+                        detail::read_le(data + at + 28, 2);
+  if (first > size || size - first < e.size) {
+    throw std::runtime_error("Malformed npz file " + filename_);
+  }
+  return NpyArray(std::string_view(data + first, e.size), file_);
+}
+
+// ==== NpyWriter ====
+
+template <typename T>
+NpyWriter<T>::NpyWriter(const std::string &filename,
+                        const std::vector<std::size_t> &shape)
+    : filename_(filename), out_(filename, std::ios::binary), remaining_(1) {
+  if (!out_) {
+    throw std::runtime_error("Could not open " + filename);
+  }
+  for (std::size_t extent : shape) {
+    remaining_ *= extent;
+  }
+  std::string header = npy_header<T>(shape);
+  out_.write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+template <typename T>
+void NpyWriter<T>::write(std::span<const T> values) {
+  if (values.size() > remaining_) {
+    throw std::runtime_error("Too many elements written to " + filename_);
+  }
+  remaining_ -= values.size();
+  out_.write(reinterpret_cast<const char *>(values.data()),
+             static_cast<std::streamsize>(values.size_bytes()));
+}
+
+template <typename T>
+void NpyWriter<T>::close() {
+  if (!out_.is_open()) {
+    return;
+  }
+  if (remaining_ != 0) {
+    throw std::runtime_error(std::to_string(remaining_) +
+                             " elements missing from " + filename_);
+  }
+  out_.close();
+  if (!out_) {
+    throw std::runtime_error("Could not write " + filename_);
+  }
+}
+
+// ==== NpzWriter ====
+
+inline NpzWriter::NpzWriter(const std::string &filename)
+    : filename_(filename), out_(filename, std::ios::binary) {
+  if (!out_) {
+    throw std::runtime_error("Could not open " + filename);
+  }
+}
+
+inline NpzWriter::~NpzWriter() {
+  try {
+    if (out_.is_open() && !open_) {
+      close();
+    }
+  } catch (...) {
+  }
+}
+
+inline void NpzWriter::write_bytes(const void *data, std::size_t size) {
+  out_.write(static_cast<const char *>(data),
+             static_cast<std::streamsize>(size));
+  offset_ += size;
+}
+
+template <typename T>
+void NpzWriter::begin_array(const std::string &name,
+                            const std::vector<std::size_t> &shape) {
+  if (open_) {
+    throw std::logic_error("NpzWriter: an array is already open");
+  }
+  std::string entry_name = name + ".npy";
+  for (const member &m : members_) {
+    if (m.name == entry_name) {
+      throw std::invalid_argument("NpzWriter: duplicate array " + name);
+    }
+  }
+
+  std::string npy = npy_header<T>(shape);
+  std::uint64_t num_elements = 1;
+  for (std::size_t extent : shape) {
+    num_elements *= extent;
+  }
+  std::uint64_t size = npy.size() + num_elements * sizeof(T);
+  bool zip64 = size >= detail::zip_max32;
+
+  // The zip64 extra field, if needed, then a padding field sized so that
+  // the npy header, and so the data after it, starts on a 64-byte boundary.
+  std::string extra;
+  if (zip64) {
+    detail::append_le(extra, detail::zip64_extra_id, 2);
+    detail::append_le(extra, 16, 2);
+    detail::append_le(extra, size, 8);
+    detail::append_le(extra, size, 8);
+  }
+  std::uint64_t unpadded = offset_ + detail::zip_local_header_size +
+                           entry_name.size() + extra.size() + 6;
+  std::size_t padding = (detail::npz_alignment -
+                         unpadded % detail::npz_alignment) %
+                        detail::npz_alignment;
+  detail::append_le(extra, detail::zip_align_extra_id, 2);
+  detail::append_le(extra, 2 + padding, 2);
+  detail::append_le(extra, detail::npz_alignment, 2);
+  extra.append(padding, '\0');
+
+  // The CRC is not known yet; end_array fills it in.
+  std::string header;
+  detail::append_le(header, detail::zip_local_header_signature, 4);
+  detail::append_le(header, zip64 ? 45 : 20, 2); // version needed
+  detail::append_le(header, 0, 2);               // flags
+  detail::append_le(header, 0, 2);               // stored
+  detail::append_le(header, 0, 2);               // time
+  detail::append_le(header, 0x21, 2);            // date, 1980-01-01
+  detail::append_le(header, 0, 4);               // crc
+  detail::append_le(header, zip64 ? detail::zip_max32 : size, 4);
+  detail::append_le(header, zip64 ? detail::zip_max32 : size, 4);
+  detail::append_le(header, entry_name.size(), 2);
+  detail::append_le(header, extra.size(), 2);
+  header += entry_name;
+  header += extra;
+
+  members_.push_back({std::move(entry_name), offset_, size, 0});
+  write_bytes(header.data(), header.size());
+  write_bytes(npy.data(), npy.size());
+  open_ = true;
+  descr_ = npy_descr<T>();
+  remaining_ = num_elements;
+  crc_ = detail::crc32(npy.data(), npy.size());
+}
+
+template <typename T>
+void NpzWriter::write(std::span<const T> values) {
+  if (!open_ || descr_ != npy_descr<T>()) {
+    throw std::logic_error("NpzWriter: no open array of dtype " +
+                           npy_descr<T>());
+  }
+  if (values.size() > remaining_) {
+    throw std::runtime_error("NpzWriter: too many elements written to " +
+                             members_.back().name);
+  }
+  remaining_ -= values.size();
+  crc_ = detail::crc32(values.data(), values.size_bytes(), crc_);
+  write_bytes(values.data(), values.size_bytes());
+}
+
+inline void NpzWriter::end_array() {
+  if (!open_) {
+    throw std::logic_error("NpzWriter: no open array");
+  }
+  if (remaining_ != 0) {
+    throw std::logic_error("NpzWriter: " + std::to_string(remaining_) +
+                           " elements missing from " + members_.back().name);
+  }
+  member &m = members_.back();
+  m.crc = crc_;
+  std::string crc;
+  detail::append_le(crc, crc_, 4);
+  out_.seekp(static_cast<std::streamoff>(m.local_header_offset + 14));
+  out_.write(crc.data(), 4);
+  out_.seekp(static_cast<std::streamoff>(offset_));
+  open_ = false;
+}
+
+template <typename T>
+void NpzWriter::add(const std::string &name, ConstMatrixView<T> m) {
+  begin_array<T>(name, {m.num_rows(), m.num_columns()});
+  detail::for_each_npy_row(m, [&](std::span<const T> row) { write(row); });
+  end_array();
+}
+
+template <typename T>
+void NpzWriter::add(const std::string &name, const std::vector<T> &values) {
+  begin_array<T>(name, {values.size()});
+  write(std::span<const T>(values));
+  end_array();
+}
+
+inline void NpzWriter::close() {
+  if (!out_.is_open()) {
+    return;
+  }
+  if (open_) {
+    throw std::logic_error("NpzWriter: array " + members_.back().name +
+                           " is still open");
+  }
+
+  const std::uint64_t directory_offset = offset_;
+  std::string directory;
+  for (const member &m : members_) {
+    std::string extra;
+    for (std::uint64_t value : {m.size, m.size, m.local_header_offset}) {
+      if (value >= detail::zip_max32) {
+        detail::append_le(extra, value, 8);
+      }
+    }
+    if (!extra.empty()) {
+      std::string fields = std::move(extra);
+      extra.clear();
+      detail::append_le(extra, detail::zip64_extra_id, 2);
+      detail::append_le(extra, fields.size(), 2);
+      extra += fields;
+    }
+    auto field32 = [](std::uint64_t value) {
+      return std::min(value, detail::zip_max32);
+    };
+    bool zip64 = !extra.empty();
+    detail::append_le(directory, detail::zip_central_header_signature, 4);
+    detail::append_le(directory, 45, 2);            // version made by
+    detail::append_le(directory, zip64 ? 45 : 20, 2); // version needed
+    detail::append_le(directory, 0, 2);             // flags
+    detail::append_le(directory, 0, 2);             // stored
+    detail::append_le(directory, 0, 2);             // time
+    detail::append_le(directory, 0x21, 2);          // date
+    detail::append_le(directory, m.crc, 4);
+    detail::append_le(directory, field32(m.size), 4);
+    detail::append_le(directory, field32(m.size), 4);
+    detail::append_le(directory, m.name.size(), 2);
+    detail::append_le(directory, extra.size(), 2);
+    detail::append_le(directory, 0, 2); // comment length
+    detail::append_le(directory, 0, 2); // disk
+    detail::append_le(directory, 0, 2); // internal attributes
+    detail::append_le(directory, 0, 4); // external attributes
+    detail::append_le(directory, field32(m.local_header_offset), 4);
+    directory += m.name;
+    directory += extra;
+  }
+  write_bytes(directory.data(), directory.size());
+
+  const std::uint64_t num_entries = members_.size();
+  const std::uint64_t directory_size = directory.size();
+  std::string end;
+  if (num_entries >= detail::zip_max16 ||
+      directory_size >= detail::zip_max32 ||
+      directory_offset >= detail::zip_max32) {
+    const std::uint64_t end64_offset = offset_;
+    detail::append_le(end, detail::zip64_end_signature, 4);
+    detail::append_le(end, detail::zip64_end_size - 12, 8);
+    detail::append_le(end, 45, 2); // version made by
+    detail::append_le(end, 45, 2); // version needed
+    detail::append_le(end, 0, 4);  // this disk
+    detail::append_le(end, 0, 4);  // directory disk
+    detail::append_le(end, num_entries, 8);
+    detail::append_le(end, num_entries, 8);
+    detail::append_le(end, directory_size, 8);
+    detail::append_le(end, directory_offset, 8);
+    detail::append_le(end, detail::zip64_locator_signature, 4);
+    detail::append_le(end, 0, 4); // disk of the zip64 end record
+    detail::append_le(end, end64_offset, 8);
+    detail::append_le(end, 1, 4); // number of disks
+  }
+  detail::append_le(end, detail::zip_end_signature, 4);
+  detail::append_le(end, 0, 2); // this disk
+  detail::append_le(end, 0, 2); // directory disk
+  detail::append_le(end, std::min(num_entries, detail::zip_max16), 2);
+  detail::append_le(end, std::min(num_entries, detail::zip_max16), 2);
+  detail::append_le(end, std::min(directory_size, detail::zip_max32), 4);
+  detail::append_le(end, std::min(directory_offset, detail::zip_max32), 4);
+  detail::append_le(end, 0, 2); // comment length
+  write_bytes(end.data(), end.size());
+
+  out_.close();
+  if (!out_) {
+    throw std::runtime_error("Could not write " + filename_);
+  }
+}
 
 } // namespace utils
@@ -0,0 +1,200 @@
+/**********************************************************************
+ * @brief Thread affinity, thread naming and NUMA topology helpers.
+ * @details Only implemented on Linux, where NUMA topology is read from sysfs
+ *so that there is no dependency on libnuma. On other platforms the topology
+ *is reported as a single node and pinning/naming are no-ops which return
+ *false.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+namespace utils {
+namespace parallel {
+
+/**
+ * @brief Parses a Linux-style cpu list such as "0-3,8,10-11".
+ */
+inline std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty() || item == "\n") {
+      continue;
+    }
+    auto dash = item.find('-');
+    if (dash == std::string::npos) {
+      cpus.push_back(std::stoi(item));
+    } else {
+      int lo = std::stoi(item.substr(0, dash));
+      int hi = std::stoi(item.substr(dash + 1));
+      for (int c = lo; c <= hi; ++c) {
+        cpus.push_back(c);
+      }
+    }
+  }
+  return cpus;
+}
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief The CPUs of each node under a sysfs node directory, indexed by node
+ * number. Node numbers can have gaps (e.g. after hot-removal), so they come
+ * from 'online', or from the nodeN entries if that file is missing. A gap or
+ * a node without CPUs gets an empty list.
+ */
+inline std::vector<std::vector<int>>
+read_numa_node_cpus(const std::string &node_dir) {
+  std::vector<int> online;
+  if (std::ifstream ifs(node_dir + "/online"); ifs) {
+    std::string list;
+    std::getline(ifs, list);
+    online = parse_cpu_list(list);
+  } else {
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(node_dir, ec), end;
+         !ec && it != end; it.increment(ec)) {
+      std::string name = it->path().filename().string();
+      if (name.size() > 4 && name.rfind("node", 0) == 0 &&
+          std::all_of(name.begin() + 4, name.end(),
+                      [](unsigned char c) { return std::isdigit(c); })) {
+        online.push_back(std::stoi(name.substr(4)));
+      }
+    }
+  }
+
+  std::vector<std::vector<int>> nodes;
+  for (int node : online) {
+    std::ifstream ifs(node_dir + "/node" + std::to_string(node) +
+                      "/cpulist");
+    if (!ifs) {
+      continue;
+    }
+    std::string list;
+    std::getline(ifs, list);
+    auto index = static_cast<std::size_t>(node);
+    if (nodes.size() <= index) {
+      nodes.resize(index + 1);
+    }
+    nodes[index] = parse_cpu_list(list);
+  }
+  return nodes;
+}
+
+} // namespace detail
+
+/**
+ * @brief The CPUs belonging to each NUMA node, indexed by node number. Node
+ * numbers that are offline, and nodes with memory but no CPUs, have an empty
+ * list.
+ *
+ * @details Falls back to a single node with CPUs 0..hardware_concurrency()-1
+ * if the topology cannot be determined.
+ */
+inline std::vector<std::vector<int>> numa_node_cpus() {
+  std::vector<std::vector<int>> nodes;
+
+#if defined(__linux__)
+  nodes = detail::read_numa_node_cpus("/sys/devices/system/node");
+  if (std::all_of(nodes.begin(), nodes.end(),
+                  [](const auto &cpus) { return cpus.empty(); })) {
+    nodes.clear();
+  }
+#endif
+
+  if (nodes.empty()) {
+    std::vector<int> all(std::max(1u, std::thread::hardware_concurrency()));
+    for (std::size_t i = 0; i < all.size(); ++i) {
+      all[i] = static_cast<int>(i);
+    }
+    nodes.push_back(std::move(all));
+  }
+  return nodes;
+}
+
+/**
+ * @brief Number of NUMA node numbers (at least 1), i.e. one past the highest
+ * online node.
+ */
+inline std::size_t num_numa_nodes() { return numa_node_cpus().size(); }
+
+/**
+ * @brief Restricts the calling thread to run only on the given CPUs.
+ *
+ * @return true on success, false if unsupported or the call failed.
+ */
+inline bool pin_current_thread(const std::vector<int> &cpus) {
+#if defined(__linux__)
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int c : cpus) {
+    if (c >= 0 && c < CPU_SETSIZE) {
+      CPU_SET(c, &set);
+    }
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
+/**
+ * @brief Sets the calling thread's name, as shown in e.g. top, perf and gdb.
+ * Linux limits names to 15 characters, so longer names are truncated.
+ *
+ * @return true on success, false if unsupported or the call failed.
+ */
+inline bool set_current_thread_name(const std::string &name) {
+#if defined(__linux__)
+  return pthread_setname_np(pthread_self(), name.substr(0, 15).c_str()) == 0;
+#elif defined(__APPLE__)
+  return pthread_setname_np(name.c_str()) == 0;
+#else
+  (void)name;
+  return false;
+#endif
+}
+
+/**
+ * @brief The calling thread's name, or an empty string if unsupported.
+ */
+inline std::string current_thread_name() {
+#if defined(__linux__) || defined(__APPLE__)
+  char buf[64] = {0};
+  if (pthread_getname_np(pthread_self(), buf, sizeof(buf)) == 0) {
+    return buf;
+  }
+#endif
+  return "";
+}
+
+} // namespace parallel
+
+} // namespace utils
@@ -0,0 +1,313 @@
+/**********************************************************************
+ * @brief Generating large batches of independent instances on a thread
+ *pool, with the results written out in order.
+ * @details run_batch calls make(i, seed_i) for every index i on the pool and
+ *write(i, result) on the calling thread in increasing order of i. Each
+ *instance is seeded from the batch seed and its index alone, so the output is
+ *the same for any number of threads. At most max_in_flight instances are
+ *computed or waiting to be written at any time: the writer submits instance
+ *i + max_in_flight only after it has taken instance i, which bounds memory
+ *and keeps a slow sink from being overrun. While waiting, the calling thread
+ *runs pool tasks itself.
+ *
+ *json_lines_sink is a write() for run_batch: it buffers JSON lines and
+ *writes them to one file, or to a new shard file every records_per_shard
+ *instances.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/json.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+#include "utils_cpp/random.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace parallel {
+
+/**
+ * @brief The seed of instance index of a batch seeded with seed. Nearby
+ * indices and nearby batch seeds give unrelated instance seeds.
+ */
+inline std::uint64_t batch_instance_seed(std::uint64_t seed,
+                                         std::size_t index) noexcept {
+  SplitMix64 mix(seed);
+  return SplitMix64(mix() ^ static_cast<std::uint64_t>(index))();
+}
+
+struct batch_options {
+  /// Most instances computed or waiting to be written at once. 0 means four
+  /// per pool thread.
+  std::size_t max_in_flight = 0;
+};
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief One instance between make() and write(). ready is set by the task
+ * that computed it, and cleared by the writer when it takes the value.
+ */
+template <typename T>
+struct batch_slot {
+  std::optional<T> value;
+  std::exception_ptr error;
+  std::atomic<bool> ready{false};
+};
+
+} // namespace detail
+
+/**
+ * @brief Calls write(i, make(i, batch_instance_seed(seed, i))) for i in
+ * [0, count), with the make() calls run on pool and the write() calls made
+ * from the calling thread, in order.
+ *
+ * @details make must be safe to call concurrently. Serializing inside make
+ * (e.g. returning Json::dump()) keeps that work on the pool rather than on
+ * the writing thread. Without a pool everything runs on the calling thread.
+ *
+ * If make or write throws, no further instances are started, the ones in
+ * flight are waited for, and the exception of the lowest index is rethrown.
+ * Instances before it have been written.
+ */
+template <typename Make, typename Write>
+void run_batch(std::size_t count, std::uint64_t seed, Make &&make,
+               Write &&write, thread_pool *pool = nullptr,
+               const batch_options &options = {}) {
+  if (pool == nullptr) {
+    for (std::size_t i = 0; i < count; ++i) {
+      write(i, make(i, batch_instance_seed(seed, i)));
+    }
+    return;
+  }
+  if (count == 0) {
+    return;
+  }
+
+  using result_type =
+      std::decay_t<std::invoke_result_t<Make &, std::size_t, std::uint64_t>>;
+  using slot_type = detail::batch_slot<result_type>;
+
+  std::size_t window = options.max_in_flight > 0 ? options.max_in_flight
+                                                 : 4 * (pool->size() + 1);
+  window = std::min(window, count);
+
+  // Shared with the tasks, which may still be returning after the writer has
+  // seen their slot become ready.
+  std::shared_ptr<slot_type[]> slots(new slot_type[window]);
+
+  std::size_t submitted = 0;
+  auto submit = [&](std::size_t i) {
+    pool->submit_detached([slots, &make, seed, i, window] {
+      slot_type &slot = slots[i % window];
+      try {
+        slot.value.emplace(make(i, batch_instance_seed(seed, i)));
+      } catch (...) {
+        slot.error = std::current_exception();
+      }
+      slot.ready.store(true, std::memory_order_release);
+    });
+  };
+  auto wait_for = [&](slot_type &slot) {
+    while (!slot.ready.load(std::memory_order_acquire)) {
+      pool->run_pending_task();
+    }
+  };
+
+  for (; submitted < window; ++submitted) {
+    submit(submitted);
+  }
+
+  std::exception_ptr error;
+  std::size_t i = 0;
+  for (; i < count; ++i) {
+    slot_type &slot = slots[i % window];
+    wait_for(slot);
+    if (slot.error) {
+      error = slot.error;
+      break;
+    }
+    result_type value = std::move(*slot.value);
+    slot.value.reset();
+    slot.ready.store(false, std::memory_order_relaxed);
+    if (submitted < count) {
+      submit(submitted++);
+    }
+    try {
+      write(i, std::move(value));
+    } catch (...) {
+      error = std::current_exception();
+      break;
+    }
+  }
+
+  if (error) {
+    // make is captured by reference, so the tasks must finish before
+    // returning.
+    for (std::size_t j = i + 1; j < submitted; ++j) {
+      wait_for(slots[j % window]);
+    }
+    std::rethrow_exception(error);
+  }
+}
+
+struct json_lines_sink_options {
+  /// Bytes buffered before they are written to the file.
+  std::size_t buffer_size = std::size_t{1} << 20;
+
+  /// If positive, instance i goes to shard i / records_per_shard, in the file
+  /// json_lines_sink::shard_path(path, shard). Otherwise all go to path.
+  std::size_t records_per_shard = 0;
+
+  /// Append to existing files instead of truncating them.
+  bool append = false;
+};
+
+/**
+ * @brief Writes one JSON value per line, as the write() of run_batch. Not
+ * thread-safe; records are expected in increasing order of index.
+ */
+class json_lines_sink {
+public:
+  /// @throws std::invalid_argument if path is empty
+  explicit json_lines_sink(std::string path,
+                           const json_lines_sink_options &options = {})
+      : path_(std::move(path)), options_(options) {
+    if (path_.empty()) {
+      throw std::invalid_argument("json_lines_sink: empty path");
+    }
+    buffer_.reserve(options_.buffer_size + 4096);
+  }
+
+  json_lines_sink(const json_lines_sink &) = delete;
+  json_lines_sink &operator=(const json_lines_sink &) = delete;
+
+  /// Flushes what is buffered. Errors are lost; call flush() to see them.
+  ~json_lines_sink() {
+    try {
+      flush();
+    } catch (...) {
+    }
+  }
+
+  /**
+   * @brief path with "-<shard>" inserted before its extension, e.g.
+   * "out.jsonl" -> "out-00003.jsonl".
+   */
+  static std::string shard_path(const std::string &path, std::size_t shard) {
+    char suffix[24];
+    std::snprintf(suffix, sizeof(suffix), "-%05zu", shard);
+    auto slash = path.find_last_of('/');
+    auto dot = path.find_last_of('.');
+    if (dot == std::string::npos ||
+        (slash != std::string::npos && dot < slash)) {
+      dot = path.size();
+    }
+    std::string result = path.substr(0, dot);
+    result += suffix;
+    result += path.substr(dot);
+    return result;
+  }
+
+  /// @throws std::runtime_error if a file cannot be opened or written
+  void operator()(std::size_t index, const Json &record) {
+    select_shard(index);
+    record.dump_to(buffer_);
+    end_record();
+  }
+
+  /// A record already serialized, e.g. by Json::dump() inside make().
+  void operator()(std::size_t index, std::string_view line) {
+    select_shard(index);
+    buffer_ += line;
+    end_record();
+  }
+
+  void operator()(std::size_t index, const std::string &line) {
+    (*this)(index, std::string_view(line));
+  }
+
+  /// @throws std::runtime_error if the file cannot be opened or written
+  void flush() {
+    if (buffer_.empty()) {
+      return;
+    }
+    if (!file_.is_open()) {
+      open(shard_ ? shard_path(path_, *shard_) : path_);
+    }
+    file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    file_.flush();
+    if (!file_) {
+      throw std::runtime_error("json_lines_sink: could not write " +
+                               files_.back());
+    }
+    buffer_.clear();
+  }
+
+  /// Records written or buffered so far.
+  std::size_t size() const noexcept { return records_; }
+
+  /// The files opened so far, in order.
+  const std::vector<std::string> &files() const noexcept { return files_; }
+
+private:
+  void select_shard(std::size_t index) {
+    if (options_.records_per_shard == 0) {
+      return;
+    }
+    std::size_t shard = index / options_.records_per_shard;
+    if (shard_ != shard) {
+      flush();
+      file_.close();
+      file_.clear();
+      shard_ = shard;
+    }
+  }
+
+  void end_record() {
+    buffer_ += '\n';
+    ++records_;
+    if (buffer_.size() >= options_.buffer_size) {
+      flush();
+    }
+  }
+
+  void open(const std::string &filename) {
+    auto mode = std::ios_base::binary | std::ios_base::out |
+                (options_.append ? std::ios_base::app : std::ios_base::trunc);
+    file_.open(filename, mode);
+    if (!file_.is_open()) {
+      throw std::runtime_error("json_lines_sink: could not open " + filename);
+    }
+    files_.push_back(filename);
+  }
+
+  std::string path_;
+  json_lines_sink_options options_;
+  std::string buffer_;
+  std::ofstream file_;
+  std::optional<std::size_t> shard_;
+  std::vector<std::string> files_;
+  std::size_t records_ = 0;
+};
+
+} // namespace parallel
+} // namespace utils
@@ -0,0 +1,278 @@
+/**********************************************************************
+ * @brief A lock-free bounded multi-producer multi-consumer queue.
+ * @details Preallocated power-of-two ring buffer with a sequence number per
+ *slot, following Dmitry Vyukov's bounded MPMC queue. Unlike threadsafe_queue,
+ *pushing and popping never allocates and never takes a mutex.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace utils {
+namespace parallel {
+
+/**
+ * @brief Bounded lock-free MPMC queue holding at most Capacity elements.
+ *
+ * @details Each slot carries a sequence number which tells producers and
+ * consumers whether it is free to write or ready to read for their ticket.
+ * try_push/try_pop are non-blocking and fail when the queue is full/empty.
+ * push/wait_and_pop take a ticket and then wait on their slot's sequence
+ * number, so they are fair under contention.
+ *
+ * @tparam T Element type. Must be nothrow move constructible.
+ * @tparam Capacity Number of slots. Must be a power of two.
+ */
+template <typename T, std::size_t Capacity>
+class bounded_mpmc_queue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "bounded_mpmc_queue Capacity must be a power of two >= 2");
+  static_assert(std::is_nothrow_move_constructible_v<T>,
+                "bounded_mpmc_queue requires a nothrow move constructible T");
+
+  static constexpr std::size_t cache_line_size = 64;
+  static constexpr std::size_t mask = Capacity - 1;
+
+  struct alignas(cache_line_size) slot {
+    std::atomic<std::size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T *ptr() { return std::launder(reinterpret_cast<T *>(storage)); }
+  };
+
+  std::unique_ptr<slot[]> buffer;
+  alignas(cache_line_size) std::atomic<std::size_t> enqueue_pos{0};
+  alignas(cache_line_size) std::atomic<std::size_t> dequeue_pos{0};
+
+  static void wait_for_sequence(slot &s, std::size_t expected);
+
+  template <typename... Args>
+  void construct_in(slot &s, std::size_t pos, Args &&...args);
+  T take_from(slot &s, std::size_t pos);
+
+public:
+  bounded_mpmc_queue();
+  ~bounded_mpmc_queue();
+
+  bounded_mpmc_queue(const bounded_mpmc_queue &other) = delete;
+  bounded_mpmc_queue &operator=(const bounded_mpmc_queue &other) = delete;
+
+  /**
+   * @brief Pushes a value onto the back of the queue, waiting for a free slot
+   * if the queue is full.
+   */
+  void push(T new_value);
+
+  /**
+   * @brief Tries to push a value onto the back of the queue.
+   *
+   * @return true on success, false (leaving 'new_value' untouched) if the
+   * queue is full.
+   */
+  bool try_push(T &&new_value);
+  bool try_push(const T &new_value);
+
+  /**
+   * @brief Tries to pop the value from the front of the queue into 'value'.
+   *
+   * @return true on success, false immediately if the queue is empty.
+   */
+  bool try_pop(T &value);
+
+  /**
+   * @brief Tries to pop the value from the front of the queue.
+   *
+   * @return The popped value, or std::nullopt if the queue was empty.
+   */
+  std::optional<T> try_pop();
+
+  /**
+   * @brief Pops the value from the front of the queue, waiting for one to be
+   * pushed if the queue is empty.
+   */
+  void wait_and_pop(T &value);
+  T wait_and_pop();
+
+  /**
+   * @brief Whether the queue is empty. Only a snapshot under concurrent use.
+   */
+  bool empty() const;
+
+  /**
+   * @brief Approximate number of elements. Only a snapshot under concurrent
+   * use.
+   */
+  std::size_t size() const;
+
+  static constexpr std::size_t capacity() { return Capacity; }
+};
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+template <typename T, std::size_t Capacity>
+bounded_mpmc_queue<T, Capacity>::bounded_mpmc_queue()
+    : buffer(new slot[Capacity]) {
+  for (std::size_t i = 0; i < Capacity; ++i) {
+    buffer[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+template <typename T, std::size_t Capacity>
+bounded_mpmc_queue<T, Capacity>::~bounded_mpmc_queue() {
+  while (try_pop()) {
+  }
+}
+
+template <typename T, std::size_t Capacity>
+void bounded_mpmc_queue<T, Capacity>::wait_for_sequence(slot &s,
+                                                        std::size_t expected) {
+  for (;;) {
+    std::size_t seq = s.sequence.load(std::memory_order_acquire);
+    if (seq == expected) {
+      return;
+    }
+    s.sequence.wait(seq, std::memory_order_acquire);
+  }
+}
+
+template <typename T, std::size_t Capacity>
+template <typename... Args>
+void bounded_mpmc_queue<T, Capacity>::construct_in(slot &s, std::size_t pos,
+                                                   Args &&...args) {
+  ::new (static_cast<void *>(s.storage)) T(std::forward<Args>(args)...);
+  s.sequence.store(pos + 1, std::memory_order_release);
+  s.sequence.notify_all();
+}
+
+template <typename T, std::size_t Capacity>
+T bounded_mpmc_queue<T, Capacity>::take_from(slot &s, std::size_t pos) {
+  T value(std::move(*s.ptr()));
+  s.ptr()->~T();
+  s.sequence.store(pos + Capacity, std::memory_order_release);
+  s.sequence.notify_all();
+  return value;
+}
+
+template <typename T, std::size_t Capacity>
+void bounded_mpmc_queue<T, Capacity>::push(T new_value) {
+  std::size_t pos = enqueue_pos.fetch_add(1, std::memory_order_relaxed);
+  slot &s = buffer[pos & mask];
+  wait_for_sequence(s, pos);
+  construct_in(s, pos, std::move(new_value));
+}
+
+template <typename T, std::size_t Capacity>
+bool bounded_mpmc_queue<T, Capacity>::try_push(T &&new_value) {
+  std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    slot &s = buffer[pos & mask];
+    std::size_t seq = s.sequence.load(std::memory_order_acquire);
+    auto diff = static_cast<std::ptrdiff_t>(seq) -
+                static_cast<std::ptrdiff_t>(pos);
+
+    if (diff == 0) {
+      if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+        construct_in(s, pos, std::move(new_value));
+        return true;
+      }
+    } else if (diff < 0) {
+      return false; // full
+    } else {
+      pos = enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T, std::size_t Capacity>
+bool bounded_mpmc_queue<T, Capacity>::try_push(const T &new_value) {
+  T copy(new_value);
+  return try_push(std::move(copy));
+}
+
+template <typename T, std::size_t Capacity>
+bool bounded_mpmc_queue<T, Capacity>::try_pop(T &value) {
+  std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    slot &s = buffer[pos & mask];
+    std::size_t seq = s.sequence.load(std::memory_order_acquire);
+    auto diff = static_cast<std::ptrdiff_t>(seq) -
+                static_cast<std::ptrdiff_t>(pos + 1);
+
+    if (diff == 0) {
+      if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+        value = take_from(s, pos);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false; // empty
+    } else {
+      pos = dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T, std::size_t Capacity>
+std::optional<T> bounded_mpmc_queue<T, Capacity>::try_pop() {
+  std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    slot &s = buffer[pos & mask];
+    std::size_t seq = s.sequence.load(std::memory_order_acquire);
+    auto diff = static_cast<std::ptrdiff_t>(seq) -
+                static_cast<std::ptrdiff_t>(pos + 1);
+
+    if (diff == 0) {
+      if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+        return take_from(s, pos);
+      }
+    } else if (diff < 0) {
+      return std::nullopt;
+    } else {
+      pos = dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T, std::size_t Capacity>
+void bounded_mpmc_queue<T, Capacity>::wait_and_pop(T &value) {
+  value = wait_and_pop();
+}
+
+template <typename T, std::size_t Capacity>
+T bounded_mpmc_queue<T, Capacity>::wait_and_pop() {
+  std::size_t pos = dequeue_pos.fetch_add(1, std::memory_order_relaxed);
+  slot &s = buffer[pos & mask];
+  wait_for_sequence(s, pos + 1);
+  return take_from(s, pos);
+}
+
+template <typename T, std::size_t Capacity>
+bool bounded_mpmc_queue<T, Capacity>::empty() const {
+  return size() == 0;
+}
+
+template <typename T, std::size_t Capacity>
+std::size_t bounded_mpmc_queue<T, Capacity>::size() const {
+  auto diff =
+      static_cast<std::ptrdiff_t>(enqueue_pos.load(std::memory_order_relaxed)) -
+      static_cast<std::ptrdiff_t>(dequeue_pos.load(std::memory_order_relaxed));
+  return diff > 0 ? static_cast<std::size_t>(diff) : 0;
+}
+
+} // namespace parallel
+
+} // namespace utils
@@ -0,0 +1,463 @@
+/**********************************************************************
+ * @brief C++20 coroutine tasks on top of thread_pool.
+ * @details task<T> is a lazily started coroutine: it runs when it is
+ *co_awaited, and resumes its awaiter when it finishes, by symmetric transfer.
+ *co_await schedule_on(pool) moves the rest of a coroutine onto a pool
+ *worker, and co_await when_all(...) starts several tasks and suspends the
+ *caller until the last one finishes, on whichever thread that happens. No
+ *worker ever blocks on another task, so nested parallelism (per-source work
+ *inside per-instance jobs, say) cannot run the pool out of threads the way
+ *waiting on a std::future inside a task can. sync_wait is the bridge from
+ *ordinary code.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace parallel {
+
+template <typename T = void>
+class task;
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief What task promises share: the awaiting coroutine, resumed from
+ * final_suspend, and the exception that escaped the body.
+ */
+struct task_promise_base {
+  std::coroutine_handle<> continuation = std::noop_coroutine();
+  std::exception_ptr error;
+
+  struct final_awaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<Promise> h) noexcept {
+      return h.promise().continuation;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  final_awaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct task_promise : task_promise_base {
+  std::optional<T> value;
+
+  task<T> get_return_object() noexcept;
+
+  template <typename U>
+  void return_value(U &&v) {
+    value.emplace(std::forward<U>(v));
+  }
+
+  T result() {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return std::move(*value);
+  }
+};
+
+template <>
+struct task_promise<void> : task_promise_base {
+  task<void> get_return_object() noexcept;
+
+  void return_void() const noexcept {}
+
+  void result() const {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+};
+
+} // namespace detail
+
+/**
+ * @brief A coroutine returning T, started when first co_awaited. Move-only;
+ * destroying a task that never ran simply frees it.
+ */
+template <typename T>
+class task {
+  static_assert(!std::is_reference_v<T>, "task<T&> is not supported");
+
+public:
+  using promise_type = detail::task_promise<T>;
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  task() noexcept = default;
+  explicit task(handle_type h) noexcept : h_(h) {}
+
+  task(task &&other) noexcept : h_(std::exchange(other.h_, {})) {}
+  task &operator=(task &&other) noexcept {
+    if (this != &other) {
+      if (h_) {
+        h_.destroy();
+      }
+      h_ = std::exchange(other.h_, {});
+    }
+    return *this;
+  }
+  task(const task &) = delete;
+  task &operator=(const task &) = delete;
+
+  ~task() {
+    if (h_) {
+      h_.destroy();
+    }
+  }
+
+  bool valid() const noexcept { return static_cast<bool>(h_); }
+
+  /// Runs the task until it finishes, then resumes the awaiter with its
+  /// result, or rethrows what it threw.
+  auto operator co_await() && noexcept {
+    struct awaiter {
+      handle_type h;
+      bool await_ready() const noexcept { return h.done(); }
+      std::coroutine_handle<>
+      await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        h.promise().continuation = awaiting;
+        return h;
+      }
+      T await_resume() { return h.promise().result(); }
+    };
+    return awaiter{h_};
+  }
+
+private:
+  handle_type h_;
+};
+
+namespace detail {
+
+template <typename T>
+task<T> task_promise<T>::get_return_object() noexcept {
+  return task<T>{std::coroutine_handle<task_promise<T>>::from_promise(*this)};
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept {
+  return task<void>{
+      std::coroutine_handle<task_promise<void>>::from_promise(*this)};
+}
+
+} // namespace detail
+
+/**
+ * @brief co_await schedule_on(pool) resumes the coroutine as a task on pool.
+ */
+inline auto schedule_on(thread_pool &pool) noexcept {
+  struct awaiter {
+    thread_pool *pool;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) const {
+      pool->submit_detached([h] { h.resume(); });
+    }
+    void await_resume() const noexcept {}
+  };
+  return awaiter{&pool};
+}
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Shared by the children of one when_all. remaining starts at one more
+ * than the number of children, the extra count belonging to when_all itself,
+ * so the parent cannot be resumed before it has started them all.
+ */
+struct when_all_counter {
+  std::atomic<std::size_t> remaining;
+  std::coroutine_handle<> parent;
+};
+
+/**
+ * @internal
+ * @brief Coroutine that awaits one child of a when_all and, if it is the
+ * last to finish, resumes the parent.
+ */
+class when_all_runner {
+public:
+  struct promise_type {
+    when_all_counter *counter = nullptr;
+    std::exception_ptr error;
+
+    struct final_awaiter {
+      bool await_ready() const noexcept { return false; }
+      std::coroutine_handle<>
+      await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+        // Once decremented, the parent may run and free this frame.
+        when_all_counter *c = h.promise().counter;
+        std::coroutine_handle<> parent = c->parent;
+        if (c->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          return parent;
+        }
+        return std::noop_coroutine();
+      }
+      void await_resume() const noexcept {}
+    };
+
+    when_all_runner get_return_object() noexcept {
+      return when_all_runner{
+          std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    final_awaiter final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+  };
+
+  explicit when_all_runner(std::coroutine_handle<promise_type> h) noexcept
+      : h_(h) {}
+  when_all_runner(when_all_runner &&other) noexcept
+      : h_(std::exchange(other.h_, {})) {}
+  when_all_runner(const when_all_runner &) = delete;
+  when_all_runner &operator=(const when_all_runner &) = delete;
+  when_all_runner &operator=(when_all_runner &&) = delete;
+  ~when_all_runner() {
+    if (h_) {
+      h_.destroy();
+    }
+  }
+
+  void start(when_all_counter &counter) {
+    h_.promise().counter = &counter;
+    h_.resume();
+  }
+
+  void rethrow_if_failed() const {
+    if (h_.promise().error) {
+      std::rethrow_exception(h_.promise().error);
+    }
+  }
+
+private:
+  std::coroutine_handle<promise_type> h_;
+};
+
+template <typename T>
+when_all_runner run_when_all_child(task<T> t, std::optional<T> &out) {
+  out.emplace(co_await std::move(t));
+}
+
+inline when_all_runner run_when_all_child(task<void> t) {
+  co_await std::move(t);
+}
+
+/**
+ * @internal
+ * @brief Starts every runner and suspends until all have finished.
+ */
+inline auto await_runners(std::vector<when_all_runner> &runners,
+                          when_all_counter &counter) noexcept {
+  struct awaiter {
+    std::vector<when_all_runner> &runners;
+    when_all_counter &counter;
+    bool await_ready() const noexcept { return runners.empty(); }
+    bool await_suspend(std::coroutine_handle<> parent) noexcept {
+      counter.parent = parent;
+      counter.remaining.store(runners.size() + 1, std::memory_order_relaxed);
+      for (auto &r : runners) {
+        r.start(counter);
+      }
+      return counter.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+    void await_resume() const noexcept {}
+  };
+  return awaiter{runners, counter};
+}
+
+template <typename... Ts, std::size_t... I>
+task<std::tuple<Ts...>> when_all_tuple(std::tuple<task<Ts>...> tasks,
+                                       std::index_sequence<I...>) {
+  std::tuple<std::optional<Ts>...> results;
+  std::vector<when_all_runner> runners;
+  runners.reserve(sizeof...(Ts));
+  (runners.push_back(run_when_all_child(std::move(std::get<I>(tasks)),
+                                        std::get<I>(results))),
+   ...);
+  when_all_counter counter;
+  co_await await_runners(runners, counter);
+  for (const auto &r : runners) {
+    r.rethrow_if_failed();
+  }
+  co_return std::tuple<Ts...>{std::move(*std::get<I>(results))...};
+}
+
+} // namespace detail
+
+/**
+ * @brief Runs all the tasks and suspends the caller until every one has
+ * finished. The tasks are started in order on the calling thread, so each
+ * should co_await schedule_on(pool) to run in parallel. If any throws, the
+ * exception of the first in order is rethrown once all have finished.
+ */
+template <typename T>
+  requires(!std::is_void_v<T>)
+task<std::vector<T>> when_all(std::vector<task<T>> tasks) {
+  std::vector<std::optional<T>> results(tasks.size());
+  std::vector<detail::when_all_runner> runners;
+  runners.reserve(tasks.size());
+  for (std::size_t i = 0; i < tasks.size(); ++i) {
+    runners.push_back(
+        detail::run_when_all_child(std::move(tasks[i]), results[i]));
+  }
+  detail::when_all_counter counter;
+  co_await detail::await_runners(runners, counter);
+  for (const auto &r : runners) {
+    r.rethrow_if_failed();
+  }
+  std::vector<T> values;
+  values.reserve(results.size());
+  for (auto &r : results) {
+    values.push_back(std::move(*r));
+  }
+  co_return values;
+}
+
+inline task<void> when_all(std::vector<task<void>> tasks) {
+  std::vector<detail::when_all_runner> runners;
+  runners.reserve(tasks.size());
+  for (auto &t : tasks) {
+    runners.push_back(detail::run_when_all_child(std::move(t)));
+  }
+  detail::when_all_counter counter;
+  co_await detail::await_runners(runners, counter);
+  for (const auto &r : runners) {
+    r.rethrow_if_failed();
+  }
+}
+
+/// when_all for tasks of different, non-void, result types.
+template <typename... Ts>
+  requires(sizeof...(Ts) > 0 && (!std::is_void_v<Ts> && ...))
+task<std::tuple<Ts...>> when_all(task<Ts>... tasks) {
+  return detail::when_all_tuple(std::tuple<task<Ts>...>(std::move(tasks)...),
+                                std::index_sequence_for<Ts...>{});
+}
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Coroutine that runs a task for sync_wait and raises a flag when it
+ * is done.
+ */
+class sync_wait_runner {
+public:
+  struct promise_type {
+    std::shared_ptr<std::atomic<bool>> done =
+        std::make_shared<std::atomic<bool>>(false);
+
+    struct final_awaiter {
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+        // The waiting thread may free this frame as soon as done is set.
+        auto done = h.promise().done;
+        done->store(true, std::memory_order_release);
+        done->notify_all();
+      }
+      void await_resume() const noexcept {}
+    };
+
+    sync_wait_runner get_return_object() noexcept {
+      return sync_wait_runner{
+          std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    final_awaiter final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+
+  explicit sync_wait_runner(std::coroutine_handle<promise_type> h) noexcept
+      : h_(h) {}
+  sync_wait_runner(const sync_wait_runner &) = delete;
+  sync_wait_runner &operator=(const sync_wait_runner &) = delete;
+  ~sync_wait_runner() { h_.destroy(); }
+
+  void run(thread_pool *pool) {
+    auto done = h_.promise().done;
+    h_.resume();
+    while (!done->load(std::memory_order_acquire)) {
+      if (pool != nullptr) {
+        pool->run_pending_task();
+      } else {
+        done->wait(false, std::memory_order_acquire);
+      }
+    }
+  }
+
+private:
+  std::coroutine_handle<promise_type> h_;
+};
+
+template <typename T>
+sync_wait_runner run_sync_wait(task<T> t, std::optional<T> &out,
+                               std::exception_ptr &error) {
+  try {
+    out.emplace(co_await std::move(t));
+  } catch (...) {
+    error = std::current_exception();
+  }
+}
+
+inline sync_wait_runner run_sync_wait(task<void> t,
+                                      std::exception_ptr &error) {
+  try {
+    co_await std::move(t);
+  } catch (...) {
+    error = std::current_exception();
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Runs t to completion from ordinary code and returns its result, or
+ * rethrows its exception. With a pool, the calling thread runs pool tasks
+ * while it waits, so sync_wait may be called from a worker of that pool;
+ * without one it sleeps.
+ */
+template <typename T>
+T sync_wait(task<T> t, thread_pool *pool = nullptr) {
+  std::exception_ptr error;
+  if constexpr (std::is_void_v<T>) {
+    detail::run_sync_wait(std::move(t), error).run(pool);
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  } else {
+    std::optional<T> out;
+    detail::run_sync_wait(std::move(t), out, error).run(pool);
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return std::move(*out);
+  }
+}
+
+} // namespace parallel
+} // namespace utils
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <memory>
+#include <cstddef>
+#include <new>
+#include <type_traits>
 #include <utility>
 
 namespace utils {
@@ -13,35 +15,101 @@ namespace parallel {
  * requires a copy-constructible function. So, we need to build a custom wrapper
  * for move-only functions.
  *
+ * Callables of up to inline_size bytes (e.g. a packaged_task, or a lambda
+ * capturing a handful of references) are stored inline, so wrapping them does
+ * not allocate. Larger callables fall back to the heap.
+ *
  * This is used in parallel::thread_pool.
  */
 class function_wrapper {
+public:
+  static constexpr std::size_t inline_size = 56;
+  static constexpr std::size_t inline_align = alignof(std::max_align_t);
+
+private:
+  struct ops_type {
+    void (*call)(void *storage);
+    void (*move)(void *dst, void *src) noexcept; // move-construct, destroy src
+    void (*destroy)(void *storage) noexcept;
+  };
 
-  struct impl_base {
-    virtual void call() = 0;
-    virtual ~impl_base() {}
+  template <typename F>
+  static constexpr bool stored_inline =
+      sizeof(F) <= inline_size && alignof(F) <= inline_align &&
+      std::is_nothrow_move_constructible_v<F>;
+
+  template <typename F>
+  struct inline_ops {
+    static F *get(void *s) { return std::launder(reinterpret_cast<F *>(s)); }
+    static void call(void *s) { (*get(s))(); }
+    static void move(void *dst, void *src) noexcept {
+      ::new (dst) F(std::move(*get(src)));
+      get(src)->~F();
+    }
+    static void destroy(void *s) noexcept { get(s)->~F(); }
+    static constexpr ops_type table{&call, &move, &destroy};
   };
 
   template <typename F>
-  struct impl_type : impl_base {
-    F f;
-    impl_type(F &&f_) : f(std::move(f_)) {}
-    void call() { f(); }
+  struct heap_ops {
+    static F *&get(void *s) { return *std::launder(reinterpret_cast<F **>(s)); }
+    static void call(void *s) { (*get(s))(); }
+    static void move(void *dst, void *src) noexcept {
+      ::new (dst) F *(get(src));
+    }
+    static void destroy(void *s) noexcept { delete get(s); }
+    static constexpr ops_type table{&call, &move, &destroy};
   };
 
-  std::unique_ptr<impl_base> impl;
+  alignas(inline_align) unsigned char storage[inline_size];
+  const ops_type *ops = nullptr;
+
+  void reset() noexcept {
+    if (ops) {
+      ops->destroy(storage);
+      ops = nullptr;
+    }
+  }
 
 public:
-  template <typename F>
-  function_wrapper(F &&f) : impl(new impl_type<F>(std::move(f))) {}
+  template <typename F,
+            typename = std::enable_if_t<
+                !std::is_same_v<std::decay_t<F>, function_wrapper>>>
+  function_wrapper(F &&f) {
+    using stored_type = std::decay_t<F>;
+    if constexpr (stored_inline<stored_type>) {
+      ::new (static_cast<void *>(storage)) stored_type(std::forward<F>(f));
+      ops = &inline_ops<stored_type>::table;
+    } else {
+      ::new (static_cast<void *>(storage))
+          stored_type *(new stored_type(std::forward<F>(f)));
+      ops = &heap_ops<stored_type>::table;
+    }
+  }
 
-  void operator()() { impl->call(); }
+  void operator()() { ops->call(storage); }
+
+  explicit operator bool() const { return ops != nullptr; }
 
   function_wrapper() = default;
 
-  function_wrapper(function_wrapper &&other) : impl(std::move(other.impl)) {}
-  function_wrapper &operator=(function_wrapper &&other) {
-    impl = std::move(other.impl);
+  ~function_wrapper() { reset(); }
+
+  function_wrapper(function_wrapper &&other) noexcept : ops(other.ops) {
+    if (ops) {
+      ops->move(storage, other.storage);
+      other.ops = nullptr;
+    }
+  }
+  function_wrapper &operator=(function_wrapper &&other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other.ops) {
+        other.ops->move(storage, other.storage);
+        ops = other.ops;
+        other.ops = nullptr;
+      }
+    }
     return *this;
   }
   function_wrapper(const function_wrapper &) = delete;
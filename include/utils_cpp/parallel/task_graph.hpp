@@ -0,0 +1,235 @@
+/**********************************************************************
+ * @brief A small dependency-graph (DAG) executor on top of thread_pool.
+ * @details Tasks are added to a task_graph together with "runs before"
+ *edges. When the graph is run, every task whose predecessors have all
+ *finished is handed to the pool straight away, so independent stages overlap
+ *and no worker ever blocks waiting on an upstream future.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/parallel/function_wrapper.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace utils {
+namespace parallel {
+
+/**
+ * @brief A set of tasks with dependencies between them.
+ *
+ * @details Example:
+ *
+ *   parallel::task_graph tg;
+ *   auto build = tg.add([&] { gb = gl::grid(10, 10); });
+ *   auto prune = tg.add([&] { gl::rand_prune_connected(gb, 5); });
+ *   auto other = tg.add([&] { ... }); // independent, overlaps with the others
+ *   auto apsp  = tg.add([&] { d = gl::floyd_warshall(gb.graph); });
+ *   tg.precede(build, prune);
+ *   tg.precede(prune, apsp);
+ *   tg.run(pool).wait();
+ *
+ * When a task finishes, one of its newly-ready successors is run directly on
+ * the same thread (keeping its inputs hot in cache) and the rest are pushed to
+ * the pool. If a task throws, its transitive successors are skipped and the
+ * first exception is rethrown from the handle's wait().
+ *
+ * The graph may be run more than once, but not concurrently, and must outlive
+ * the returned handle's completion.
+ */
+class task_graph {
+public:
+  using task_id = std::size_t;
+
+  /**
+   * @brief Adds a task. The callable takes no arguments; its return value (if
+   * any) is ignored.
+   */
+  template <typename F>
+  task_id add(F &&f);
+
+  /**
+   * @brief Declares that task 'before' must finish before task 'after' starts.
+   */
+  void precede(task_id before, task_id after);
+
+  /**
+   * @brief Declares that 'task' must not start until 'dependency' finishes.
+   * Equivalent to precede(dependency, task).
+   */
+  void depends_on(task_id task, task_id dependency) {
+    precede(dependency, task);
+  }
+
+  std::size_t size() const { return nodes.size(); }
+
+  /**
+   * @brief Starts running the graph on 'pool'.
+   *
+   * @throws std::invalid_argument if the dependencies contain a cycle.
+   * @return A handle which completes when every task has finished (or been
+   * skipped because an upstream task threw).
+   */
+  bulk_handle run(thread_pool &pool);
+
+private:
+  struct node {
+    function_wrapper work;
+    std::vector<task_id> successors;
+    std::size_t num_predecessors = 0;
+    std::atomic<std::size_t> remaining_predecessors{0};
+    std::atomic<bool> skip{false};
+
+    template <typename F>
+    explicit node(F &&f) : work(std::forward<F>(f)) {}
+  };
+
+  std::deque<node> nodes;
+
+  void check_acyclic() const;
+  void execute(thread_pool &pool,
+               const std::shared_ptr<bulk_handle::state> &st, task_id id);
+};
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+template <typename F>
+task_graph::task_id task_graph::add(F &&f) {
+  nodes.emplace_back([f = std::forward<F>(f)]() mutable { f(); });
+  return nodes.size() - 1;
+}
+
+inline void task_graph::precede(task_id before, task_id after) {
+  if (before >= nodes.size() || after >= nodes.size()) {
+    throw std::out_of_range("task_graph::precede: invalid task id");
+  }
+  if (before == after) {
+    throw std::invalid_argument("task_graph::precede: task cannot precede "
+                                "itself");
+  }
+  nodes[before].successors.push_back(after);
+  ++nodes[after].num_predecessors;
+}
+
+inline void task_graph::check_acyclic() const {
+  std::vector<std::size_t> indegree(nodes.size());
+  std::vector<task_id> ready;
+  for (task_id i = 0; i < nodes.size(); ++i) {
+    indegree[i] = nodes[i].num_predecessors;
+    if (indegree[i] == 0) {
+      ready.push_back(i);
+    }
+  }
+
+  std::size_t visited = 0;
+  while (!ready.empty()) {
+    task_id id = ready.back();
+    ready.pop_back();
+    ++visited;
+    for (task_id s : nodes[id].successors) {
+      if (--indegree[s] == 0) {
+        ready.push_back(s);
+      }
+    }
+  }
+
+  if (visited != nodes.size()) {
+    throw std::invalid_argument("task_graph contains a cycle");
+  }
+}
+
+inline bulk_handle task_graph::run(thread_pool &pool) {
+  check_acyclic();
+
+  bulk_handle handle(&pool, nodes.size());
+  if (nodes.empty()) {
+    return handle;
+  }
+
+  std::vector<task_id> roots;
+  for (task_id i = 0; i < nodes.size(); ++i) {
+    nodes[i].remaining_predecessors.store(nodes[i].num_predecessors,
+                                          std::memory_order_relaxed);
+    nodes[i].skip.store(false, std::memory_order_relaxed);
+    if (nodes[i].num_predecessors == 0) {
+      roots.push_back(i);
+    }
+  }
+
+  auto st = handle.state_;
+  pool.push_tasks(roots.size(), [&](std::size_t i) {
+    return function_wrapper(
+        [this, &pool, st, id = roots[i]]() { execute(pool, st, id); });
+  });
+
+  return handle;
+}
+
+inline void task_graph::execute(thread_pool &pool,
+                                const std::shared_ptr<bulk_handle::state> &st,
+                                task_id id) {
+  while (true) {
+    node &n = nodes[id];
+    bool skip = n.skip.load(std::memory_order_acquire);
+
+    std::exception_ptr error;
+    if (!skip) {
+      try {
+        n.work();
+      } catch (...) {
+        error = std::current_exception();
+        skip = true;
+      }
+    }
+
+    // Release successors. The first one that becomes ready is continued on
+    // this thread, the rest go to the pool.
+    bool have_next = false;
+    task_id next = 0;
+    for (task_id s : n.successors) {
+      if (skip) {
+        nodes[s].skip.store(true, std::memory_order_release);
+      }
+      if (nodes[s].remaining_predecessors.fetch_sub(
+              1, std::memory_order_acq_rel) == 1) {
+        if (!have_next) {
+          have_next = true;
+          next = s;
+        } else {
+          pool.submit_detached(
+              [this, &pool, st, s]() { execute(pool, st, s); });
+        }
+      }
+    }
+
+    // The task is counted as finished only now. Once the last one is, wait()
+    // may return and the graph be destroyed, so after this the graph is only
+    // touched through tasks not yet counted, such as next.
+    st->run([&] {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    });
+
+    if (!have_next) {
+      return;
+    }
+    id = next;
+  }
+}
+
+} // namespace parallel
+
+} // namespace utils
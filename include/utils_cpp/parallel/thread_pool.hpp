@@ -1,7 +1,10 @@
 /**********************************************************************
  * @brief A Threadpool based heavily (almost verbatim) on Anthony Williams'
  *implementation in "C++ Concurrency in Action".
- * @details
+ * @details Uses the work-stealing design from the book: each worker owns a
+ *local deque, tasks submitted from inside a worker go to that worker's deque,
+ *and idle workers steal from the others. Workers sleep on a condition variable
+ *when there is no work left, rather than spinning.
  * @author Based on code by Anthony Williams.
  * @copyright I don't know.
  * @date 2023
@@ -9,10 +12,24 @@
 
 #pragma once
 
+#include "utils_cpp/parallel/affinity.hpp"
 #include "utils_cpp/parallel/function_wrapper.hpp"
 #include "utils_cpp/parallel/threadsafe_queue.hpp"
+#include "utils_cpp/parallel/work_stealing_queue.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <exception>
 #include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 namespace utils {
@@ -36,42 +53,154 @@ public:
   }
 };
 
+class thread_pool;
+class task_graph;
+
+/**
+ * A single completion handle for a batch of tasks submitted with
+ * thread_pool::submit_bulk (and used internally by parallel_for and
+ * parallel_reduce), so that a batch of N tasks costs one shared counter rather
+ * than N futures.
+ */
+class bulk_handle {
+  struct state {
+    std::atomic<std::size_t> remaining;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    explicit state(std::size_t count) : remaining{count} {}
+
+    template <typename F>
+    void run(F &&f);
+  };
+
+  std::shared_ptr<state> state_;
+  thread_pool *pool_ = nullptr;
+
+  bulk_handle(thread_pool *pool, std::size_t count)
+      : state_{std::make_shared<state>(count)}, pool_{pool} {}
+
+  friend class thread_pool;
+  friend class task_graph;
+
+public:
+  bulk_handle() = default;
+
+  /**
+   * @brief Whether every task in the batch has finished.
+   */
+  bool done() const {
+    return !state_ || state_->remaining.load(std::memory_order_acquire) == 0;
+  }
+
+  /**
+   * @brief Blocks until every task in the batch has finished, running other
+   * pending pool tasks in the meantime. Rethrows the first exception thrown by
+   * any task in the batch.
+   */
+  void wait();
+};
+
 /**
- * A very simple thread pool for independent tasks.
+ * Options for constructing a thread_pool.
+ *
+ * Pinning and NUMA binding use the helpers in parallel/affinity.hpp and are
+ * silently skipped on platforms where they are unsupported.
+ */
+struct thread_pool_options {
+  /// Number of worker threads. 0 means thread_pool::default_thread_count(),
+  /// or the number of CPUs on the node if numa_node is set.
+  std::size_t thread_count = 0;
+
+  /// If non-empty, worker i is named "<name>-<i>" so it can be identified in
+  /// perf, top, gdb etc.
+  std::string name;
+
+  /// CPUs the workers may run on. Ignored if numa_node is set.
+  std::vector<int> cpus;
+
+  /// If true, worker i is pinned to the single CPU cpus[i % cpus.size()].
+  /// Otherwise every worker may run on any of 'cpus'.
+  bool pin_each_worker = false;
+
+  /// If >= 0, restrict workers to the CPUs of this NUMA node. Since Linux
+  /// allocates pages on the node of the thread that first touches them, memory
+  /// initialised inside tasks on this pool ends up local to the node.
+  int numa_node = -1;
+};
+
+/**
+ * A work-stealing thread pool for independent tasks.
+ *
+ * Tasks submitted from outside the pool go onto a shared queue. Tasks
+ * submitted from one of the pool's own worker threads go onto that worker's
+ * local deque, where they are popped LIFO by the owner and stolen FIFO by
+ * other idle workers.
+ *
+ * A task that needs to wait on the result of another task should call
+ * run_pending_task() in its wait loop, rather than blocking on
+ * std::future::get(), so that the worker keeps making progress.
  */
 class thread_pool {
   std::atomic_bool done;
-  threadsafe_queue<function_wrapper> work_queue;
+  std::atomic<std::size_t> pending_tasks;
+  threadsafe_queue<function_wrapper> pool_work_queue;
+  std::vector<std::unique_ptr<work_stealing_queue>> queues;
+
+  std::mutex sleep_mutex;
+  std::condition_variable sleep_cv;
+
+  std::vector<int> worker_cpus;
+  bool pin_each_worker = false;
+  std::string worker_name;
+  int numa_node_ = -1;
+
   std::vector<std::thread> threads;
   thread_joiner joiner;
 
-  void worker_thread() {
-    while (!done) {
-      function_wrapper task;
-      if (work_queue.try_pop(task)) {
-        task();
-      } else {
-        std::this_thread::yield();
-      }
-    }
-  }
+  inline static thread_local thread_pool *local_pool = nullptr;
+  inline static thread_local work_stealing_queue *local_work_queue = nullptr;
+  inline static thread_local std::size_t my_index = 0;
+
+  void worker_thread(std::size_t index);
+  void start_workers(std::size_t thread_count);
+
+  bool pop_task_from_local_queue(function_wrapper &task);
+  bool pop_task_from_pool_queue(function_wrapper &task);
+  bool pop_task_from_other_thread_queue(function_wrapper &task);
+  bool try_run_pending_task();
+
+  void push_task(function_wrapper task);
+
+  template <typename MakeTask>
+  void push_tasks(std::size_t count, MakeTask &&make_task);
+
+  std::size_t default_grain(std::size_t n) const;
+
+  friend class bulk_handle;
+  friend class task_graph;
 
 public:
-  thread_pool(std::size_t thread_count = std::thread::hardware_concurrency() -
-                                         1)
-      : done{false}, joiner{threads} {
+  /**
+   * @brief The default number of worker threads: one less than the number of
+   * hardware threads (leaving one for the submitting thread), but at least one.
+   */
+  static std::size_t default_thread_count();
 
-    try {
-      for (std::size_t i = 0; i < thread_count; ++i) {
-        threads.push_back(std::thread(&thread_pool::worker_thread, this));
-      }
-    } catch (...) {
-      done = true;
-      throw;
-    }
-  }
+  thread_pool(std::size_t thread_count = default_thread_count());
+
+  /**
+   * @brief Constructs a pool with CPU pinning, NUMA binding and/or named
+   * worker threads.
+   *
+   * @throws std::out_of_range if options.numa_node does not exist.
+   */
+  explicit thread_pool(const thread_pool_options &options);
+
+  ~thread_pool();
 
-  ~thread_pool() { done = true; }
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
 
   template <typename FunctionType>
   std::future<typename std::invoke_result_t<FunctionType>>
@@ -80,11 +209,411 @@ public:
 
     std::packaged_task<result_type()> task(std::move(f));
     std::future<result_type> res(task.get_future());
-    work_queue.push(std::move(task));
+    push_task(std::move(task));
     return res;
   }
+
+  /**
+   * @brief Fire-and-forget submission: runs f() on the pool without creating a
+   * packaged_task or future. Small callables are stored inline in the task
+   * wrapper, which saves the packaged_task's shared state, but queueing the
+   * task still allocates.
+   *
+   * @details Like a std::thread, an exception escaping f() terminates the
+   * program. Use submit() if you need the result or the exception.
+   */
+  template <typename FunctionType>
+  void submit_detached(FunctionType f) {
+    push_task(function_wrapper(std::move(f)));
+  }
+
+  /**
+   * @brief Submits a whole range of nullary callables at once.
+   *
+   * @details Unlike calling submit() in a loop, there is no packaged_task or
+   * future per task: the batch shares a single bulk_handle.
+   *
+   * @param tasks A range of callables taking no arguments. The callables are
+   * moved into the pool.
+   * @return A handle which can be waited on for the whole batch.
+   */
+  template <std::ranges::input_range Range>
+  bulk_handle submit_bulk(Range &&tasks);
+
+  /**
+   * @brief Calls f(i) for every i in [begin, end), in parallel, and blocks until
+   * all calls have finished. The calling thread also works on the range.
+   *
+   * @param begin First index.
+   * @param end One past the last index.
+   * @param grain Number of consecutive indices per task. If 0, a grain is
+   * chosen to give a few chunks per worker thread.
+   * @param f Callable taking a single index.
+   */
+  template <std::integral Index, typename F>
+  void parallel_for(Index begin, Index end, std::size_t grain, F &&f);
+
+  /**
+   * @brief Computes reduce(...reduce(reduce(identity, map(begin)),
+   * map(begin+1))..., map(end-1)) in parallel.
+   *
+   * @details The range is split into chunks of 'grain' indices. Each chunk is
+   * folded from 'identity' in index order, and the chunk results are then
+   * folded in chunk order, so for an associative 'reduce' the result does not
+   * depend on the number of threads.
+   *
+   * @param grain Number of consecutive indices per task. If 0, chosen
+   * automatically.
+   * @return The reduced value, or 'identity' if the range is empty.
+   */
+  template <std::integral Index, typename T, typename Map, typename Reduce>
+  T parallel_reduce(Index begin, Index end, std::size_t grain, T identity,
+                    Map &&map, Reduce &&reduce);
+
+  /**
+   * @brief Runs a single pending task on the calling thread if one is
+   * available, otherwise yields.
+   */
+  void run_pending_task();
+
+  std::size_t size() const { return threads.size(); }
+
+  /**
+   * @brief The NUMA node this pool is bound to, or -1 if unbound.
+   */
+  int numa_node() const { return numa_node_; }
 };
 
+/**
+ * @brief Creates one sub-pool per NUMA node with CPUs, in node order, each
+ * with its workers bound to that node's CPUs.
+ *
+ * @details Allocate and initialise per-node data (e.g. a partition of an
+ * adjacency matrix) from tasks submitted to that node's pool, so the pages are
+ * first touched, and hence placed, on the right node.
+ *
+ * @param base Options applied to every sub-pool. numa_node is overwritten, and
+ * if non-empty the name gets the node number appended ("<name><node>").
+ */
+inline std::vector<std::unique_ptr<thread_pool>>
+make_numa_thread_pools(thread_pool_options base = {}) {
+  std::vector<std::unique_ptr<thread_pool>> pools;
+  std::string name = base.name;
+  auto nodes = numa_node_cpus();
+  for (std::size_t node = 0; node < nodes.size(); ++node) {
+    if (nodes[node].empty()) {
+      continue;
+    }
+    base.numa_node = static_cast<int>(node);
+    if (!name.empty()) {
+      base.name = name + std::to_string(node);
+    }
+    pools.push_back(std::make_unique<thread_pool>(base));
+  }
+  return pools;
+}
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+inline std::size_t thread_pool::default_thread_count() {
+  std::size_t hw = std::thread::hardware_concurrency();
+  return std::max<std::size_t>(1, hw > 0 ? hw - 1 : 1);
+}
+
+inline thread_pool::thread_pool(std::size_t thread_count)
+    : done{false}, pending_tasks{0}, joiner{threads} {
+  start_workers(thread_count);
+}
+
+inline thread_pool::thread_pool(const thread_pool_options &options)
+    : done{false}, pending_tasks{0}, worker_cpus{options.cpus},
+      pin_each_worker{options.pin_each_worker}, worker_name{options.name},
+      numa_node_{options.numa_node}, joiner{threads} {
+
+  std::size_t thread_count = options.thread_count;
+
+  if (numa_node_ >= 0) {
+    worker_cpus = numa_node_cpus().at(static_cast<std::size_t>(numa_node_));
+    if (thread_count == 0) {
+      thread_count = worker_cpus.size();
+    }
+  }
+  if (thread_count == 0) {
+    thread_count = default_thread_count();
+  }
+
+  start_workers(thread_count);
+}
+
+inline void thread_pool::start_workers(std::size_t thread_count) {
+  try {
+    for (std::size_t i = 0; i < thread_count; ++i) {
+      queues.push_back(std::make_unique<work_stealing_queue>());
+    }
+    for (std::size_t i = 0; i < thread_count; ++i) {
+      threads.push_back(std::thread(&thread_pool::worker_thread, this, i));
+    }
+  } catch (...) {
+    done = true;
+    sleep_cv.notify_all();
+    throw;
+  }
+}
+
+inline thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    done = true;
+  }
+  sleep_cv.notify_all();
+}
+
+inline void thread_pool::worker_thread(std::size_t index) {
+  local_pool = this;
+  my_index = index;
+  local_work_queue = queues[my_index].get();
+
+  if (!worker_name.empty()) {
+    set_current_thread_name(worker_name + "-" + std::to_string(index));
+  }
+  if (!worker_cpus.empty()) {
+    if (pin_each_worker) {
+      pin_current_thread({worker_cpus[index % worker_cpus.size()]});
+    } else {
+      pin_current_thread(worker_cpus);
+    }
+  }
+
+  while (!done) {
+    if (try_run_pending_task()) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    sleep_cv.wait(lock, [this] { return done || pending_tasks > 0; });
+  }
+}
+
+inline void thread_pool::push_task(function_wrapper task) {
+  // Counting the task under the lock guarantees that a worker which is about
+  // to check the sleep predicate either sees the new task or is already
+  // waiting, and so gets notified below.
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    ++pending_tasks;
+  }
+
+  if (local_pool == this && local_work_queue) {
+    local_work_queue->push(std::move(task));
+  } else {
+    pool_work_queue.push(std::move(task));
+  }
+
+  sleep_cv.notify_one();
+}
+
+template <typename MakeTask>
+void thread_pool::push_tasks(std::size_t count, MakeTask &&make_task) {
+  if (count == 0) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    pending_tasks += count;
+  }
+
+  bool local = local_pool == this && local_work_queue;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (local) {
+      local_work_queue->push(make_task(i));
+    } else {
+      pool_work_queue.push(make_task(i));
+    }
+  }
+
+  if (count == 1) {
+    sleep_cv.notify_one();
+  } else {
+    sleep_cv.notify_all();
+  }
+}
+
+inline std::size_t thread_pool::default_grain(std::size_t n) const {
+  // A few chunks per thread (including the calling thread) gives idle workers
+  // something to steal without making the chunks too small.
+  return std::max<std::size_t>(1, n / (4 * (threads.size() + 1)));
+}
+
+inline bool thread_pool::pop_task_from_local_queue(function_wrapper &task) {
+  return local_pool == this && local_work_queue &&
+         local_work_queue->try_pop(task);
+}
+
+inline bool thread_pool::pop_task_from_pool_queue(function_wrapper &task) {
+  return pool_work_queue.try_pop(task);
+}
+
+inline bool
+thread_pool::pop_task_from_other_thread_queue(function_wrapper &task) {
+  std::size_t start = local_pool == this ? my_index + 1 : 0;
+  for (std::size_t i = 0; i < queues.size(); ++i) {
+    std::size_t index = (start + i) % queues.size();
+    if (queues[index]->try_steal(task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline bool thread_pool::try_run_pending_task() {
+  function_wrapper task;
+  if (pop_task_from_local_queue(task) || pop_task_from_pool_queue(task) ||
+      pop_task_from_other_thread_queue(task)) {
+    --pending_tasks;
+    task();
+    return true;
+  }
+  return false;
+}
+
+inline void thread_pool::run_pending_task() {
+  if (!try_run_pending_task()) {
+    std::this_thread::yield();
+  }
+}
+
+template <std::ranges::input_range Range>
+bulk_handle thread_pool::submit_bulk(Range &&tasks) {
+  using task_type = std::ranges::range_value_t<Range>;
+
+  std::vector<task_type> batch;
+  if constexpr (std::ranges::sized_range<Range>) {
+    batch.reserve(std::ranges::size(tasks));
+  }
+  for (auto &&t : tasks) {
+    if constexpr (std::is_rvalue_reference_v<Range &&>) {
+      batch.push_back(std::move(t));
+    } else {
+      batch.push_back(t);
+    }
+  }
+
+  bulk_handle handle(this, batch.size());
+  auto st = handle.state_;
+  push_tasks(batch.size(), [&](std::size_t i) {
+    return function_wrapper(
+        [st, t = std::move(batch[i])]() mutable { st->run(t); });
+  });
+
+  return handle;
+}
+
+template <std::integral Index, typename F>
+void thread_pool::parallel_for(Index begin, Index end, std::size_t grain,
+                               F &&f) {
+  if (end <= begin) {
+    return;
+  }
+
+  std::size_t n = static_cast<std::size_t>(end - begin);
+  if (grain == 0) {
+    grain = default_grain(n);
+  }
+  std::size_t chunks = (n + grain - 1) / grain;
+
+  auto run_chunk = [begin, n, grain, &f](std::size_t c) {
+    Index b = begin + static_cast<Index>(c * grain);
+    Index e = begin + static_cast<Index>(std::min(n, (c + 1) * grain));
+    for (Index i = b; i < e; ++i) {
+      f(i);
+    }
+  };
+
+  bulk_handle handle(this, chunks);
+  auto st = handle.state_;
+
+  // Chunk 0 is run by the calling thread.
+  push_tasks(chunks - 1, [&](std::size_t i) {
+    return function_wrapper(
+        [st, run_chunk, c = i + 1]() { st->run([&] { run_chunk(c); }); });
+  });
+  st->run([&] { run_chunk(0); });
+
+  handle.wait();
+}
+
+template <std::integral Index, typename T, typename Map, typename Reduce>
+T thread_pool::parallel_reduce(Index begin, Index end, std::size_t grain,
+                               T identity, Map &&map, Reduce &&reduce) {
+  if (end <= begin) {
+    return identity;
+  }
+
+  std::size_t n = static_cast<std::size_t>(end - begin);
+  if (grain == 0) {
+    grain = default_grain(n);
+  }
+  std::size_t chunks = (n + grain - 1) / grain;
+
+  std::vector<T> partial(chunks, identity);
+
+  parallel_for<std::size_t>(0, chunks, 1, [&](std::size_t c) {
+    Index b = begin + static_cast<Index>(c * grain);
+    Index e = begin + static_cast<Index>(std::min(n, (c + 1) * grain));
+    T acc = identity;
+    for (Index i = b; i < e; ++i) {
+      acc = reduce(std::move(acc), map(i));
+    }
+    partial[c] = std::move(acc);
+  });
+
+  T result = std::move(identity);
+  for (auto &p : partial) {
+    result = reduce(std::move(result), std::move(p));
+  }
+  return result;
+}
+
+template <typename F>
+void bulk_handle::state::run(F &&f) {
+  try {
+    f();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (!error) {
+      error = std::current_exception();
+    }
+  }
+
+  if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    remaining.notify_all();
+  }
+}
+
+inline void bulk_handle::wait() {
+  if (!state_) {
+    return;
+  }
+
+  for (;;) {
+    std::size_t r = state_->remaining.load(std::memory_order_acquire);
+    if (r == 0) {
+      break;
+    }
+    if (!pool_->try_run_pending_task()) {
+      state_->remaining.wait(r, std::memory_order_acquire);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(state_->error_mutex);
+  if (state_->error) {
+    std::rethrow_exception(state_->error);
+  }
+}
+
 } // namespace parallel
 
 } // namespace utils
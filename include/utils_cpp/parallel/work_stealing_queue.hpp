@@ -0,0 +1,84 @@
+/**********************************************************************
+ * @brief A per-thread work-stealing deque, based on the implementation in "C++
+ *Concurrency in Action" by Anthony Williams.
+ * @details The owning thread pushes and pops at the front (LIFO, which keeps
+ *recently-spawned work hot in cache), while other threads steal from the back
+ *(FIFO, so thieves take the oldest and typically largest chunks of work).
+ * @author Original author is Anthony Williams.
+ * @copyright I don't know.
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/parallel/function_wrapper.hpp"
+
+#include <deque>
+#include <mutex>
+
+namespace utils {
+namespace parallel {
+
+class work_stealing_queue {
+private:
+  using data_type = function_wrapper;
+  std::deque<data_type> the_queue;
+  mutable std::mutex the_mutex;
+
+public:
+  work_stealing_queue() {}
+  work_stealing_queue(const work_stealing_queue &other) = delete;
+  work_stealing_queue &operator=(const work_stealing_queue &other) = delete;
+
+  /**
+   * @brief Pushes a task onto the front of the queue. Should only be called by
+   * the owning thread.
+   */
+  void push(data_type data) {
+    std::lock_guard<std::mutex> lock(the_mutex);
+    the_queue.push_front(std::move(data));
+  }
+
+  bool empty() const {
+    std::lock_guard<std::mutex> lock(the_mutex);
+    return the_queue.empty();
+  }
+
+  /**
+   * @brief Pops the most recently pushed task. Should only be called by the
+   * owning thread.
+   *
+   * @return true if a task was popped into 'res', false if the queue was empty.
+   */
+  bool try_pop(data_type &res) {
+    std::lock_guard<std::mutex> lock(the_mutex);
+    if (the_queue.empty()) {
+      return false;
+    }
+
+    res = std::move(the_queue.front());
+    the_queue.pop_front();
+    return true;
+  }
+
+  /**
+   * @brief Steals the oldest task from the back of the queue. Called by
+   * threads other than the owner.
+   *
+   * @return true if a task was stolen into 'res', false if the queue was empty.
+   */
+  bool try_steal(data_type &res) {
+    std::lock_guard<std::mutex> lock(the_mutex);
+    if (the_queue.empty()) {
+      return false;
+    }
+
+    res = std::move(the_queue.back());
+    the_queue.pop_back();
+    return true;
+  }
+};
+
+} // namespace parallel
+
+} // namespace utils
@@ -1,7 +1,11 @@
 /**********************************************************************
  * @brief Library for printing common data structures, usually for debugging
  *purposes.
- * @details
+ * @details Containers of numbers are formatted with std::to_chars into a
+ *thread-local buffer and written to the stream in large blocks, whenever the
+ *stream's flags and locale would give the same text (the defaults do).
+ *Indentation is written from a cached string of spaces, and
+ *escape_special_chars escapes whole strings at a time.
  * @author Sam Tonetto
  * @copyright GNU Public License
  * @date 2023
@@ -9,13 +13,20 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <charconv>
 #include <iostream>
+#include <locale>
 #include <map>
 #include <queue>
 #include <set>
 #include <stack>
+#include <string>
+#include <string_view>
+#include <system_error>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -51,17 +62,33 @@ protected:
 
   virtual int_type overflow(int_type c) {
     if (c != EOF) {
-      char special = process_char(c);
+      char special = process_char(static_cast<char>(c));
       if (special) {
         original_buf->sputc('\\');
         original_buf->sputc(special);
       } else {
-        original_buf->sputc(c);
+        original_buf->sputc(static_cast<char>(c));
       }
     }
     return c;
   }
 
+  // Writes the runs between special characters in one call each, instead of
+  // one overflow() per character.
+  virtual std::streamsize xsputn(const char *s, std::streamsize n) {
+    std::string_view rest(s, static_cast<std::size_t>(n));
+    while (!rest.empty()) {
+      std::size_t run = std::min(rest.find_first_of("\n\t"), rest.size());
+      original_buf->sputn(rest.data(), static_cast<std::streamsize>(run));
+      if (run < rest.size()) {
+        overflow(traits_type::to_int_type(rest[run]));
+        ++run;
+      }
+      rest.remove_prefix(run);
+    }
+    return n;
+  }
+
   virtual int sync() { return original_buf->pubsync(); }
 
 public:
@@ -69,21 +96,42 @@ public:
   std::streambuf *original_buf;
 };
 
+// Each stream gets its own escaping buffer, kept in this pword slot and
+// deleted with the stream.
+inline int escape_buf_index = std::ios_base::xalloc();
+
 struct escape_special_chars {
   bool state;
   escape_special_chars(bool state) : state(state) {}
 
   friend std::ostream &operator<<(std::ostream &os,
                                   const escape_special_chars &esc) {
-    if (esc.state) {
-      static escape_special_chars_buf escape_buf(os.rdbuf());
-      os.rdbuf(&escape_buf);
-    } else {
-      os.rdbuf(
-          static_cast<escape_special_chars_buf *>(os.rdbuf())->original_buf);
+    auto *current = dynamic_cast<escape_special_chars_buf *>(os.rdbuf());
+    if (esc.state && !current) {
+      void *&slot = os.pword(escape_buf_index);
+      if (!slot) {
+        slot = new escape_special_chars_buf(nullptr);
+        os.register_callback(release_buf, escape_buf_index);
+      }
+      auto *buf = static_cast<escape_special_chars_buf *>(slot);
+      buf->original_buf = os.rdbuf();
+      os.rdbuf(buf);
+    } else if (!esc.state && current) {
+      os.rdbuf(current->original_buf);
     }
     return os;
   }
+
+private:
+  static void release_buf(std::ios_base::event event, std::ios_base &ios,
+                          int index) {
+    void *&slot = ios.pword(index);
+    if (event == std::ios_base::erase_event) {
+      delete static_cast<escape_special_chars_buf *>(slot);
+    }
+    // After copyfmt the slot holds the other stream's buffer.
+    slot = nullptr;
+  }
 };
 
 struct prettyprint {
@@ -120,6 +168,97 @@ std::string to_binary_string(T x) {
   return result;
 }
 
+// ========= Fast paths ===========
+
+namespace detail {
+
+/**
+ * Writes 'width' spaces, from a string of spaces kept per thread.
+ */
+struct indentation {
+  std::size_t width;
+
+  friend std::ostream &operator<<(std::ostream &os, indentation in) {
+    thread_local std::string spaces;
+    if (spaces.size() < in.width) {
+      spaces.resize(std::max(in.width, 2 * spaces.size()), ' ');
+    }
+    return os.write(spaces.data(), static_cast<std::streamsize>(in.width));
+  }
+};
+
+// Numbers that std::to_chars formats like operator<< does (not bool or the
+// character types, which print as words or characters).
+template <typename T>
+inline constexpr bool to_chars_printable_v =
+    std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+    !std::is_same_v<T, char> && !std::is_same_v<T, signed char> &&
+    !std::is_same_v<T, unsigned char> && !std::is_same_v<T, wchar_t> &&
+    !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t> &&
+    !std::is_same_v<T, char32_t>;
+
+/**
+ * True if os prints numbers as std::to_chars does: decimal integers, and
+ * floating point numbers like printf's %g at os.precision(), with no field
+ * width and in the classic locale.
+ */
+inline bool has_plain_number_format(const std::ostream &os) {
+  constexpr auto format_flags =
+      std::ios_base::basefield | std::ios_base::floatfield |
+      std::ios_base::showpos | std::ios_base::showpoint |
+      std::ios_base::showbase | std::ios_base::uppercase;
+  return (os.flags() & format_flags) == std::ios_base::dec &&
+         os.width() == 0 && os.precision() <= 40 &&
+         os.getloc() == std::locale::classic();
+}
+
+/**
+ * Prints a container of numbers, indented, between 'open' and 'close',
+ * formatting it into a thread-local buffer that is written out in blocks of
+ * up to 64 KiB. Returns false, having written nothing, if os does not have
+ * the plain number format.
+ */
+template <typename Container>
+bool print_numbers(std::ostream &os, const Container &container, char open,
+                   char close) {
+  if (!has_plain_number_format(os)) {
+    return false;
+  }
+  constexpr std::size_t flush_size = std::size_t{1} << 16;
+  thread_local std::string buffer;
+  buffer.clear();
+  buffer.append(utils::indent_amount, ' ');
+  buffer += open;
+
+  const auto precision = static_cast<int>(os.precision());
+  bool first = true;
+  for (const auto &x : container) {
+    if (!first) {
+      buffer += ", ";
+    }
+    first = false;
+    // Enough for any integer, and any %g output at precision 40.
+    char digits[64];
+    std::to_chars_result result;
+    if constexpr (std::is_floating_point_v<std::decay_t<decltype(x)>>) {
+      result = std::to_chars(digits, digits + sizeof(digits), x,
+                             std::chars_format::general, precision);
+    } else {
+      result = std::to_chars(digits, digits + sizeof(digits), x);
+    }
+    buffer.append(digits, result.ptr);
+    if (buffer.size() >= flush_size) {
+      os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      buffer.clear();
+    }
+  }
+  buffer += close;
+  os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  return true;
+}
+
+} // namespace detail
+
 // ========= Forward Declarations ===========
 
 template <typename T>
@@ -171,7 +310,13 @@ std::ostream &operator<<(std::ostream &os, const std::tuple<T...> &tup);
 template <typename T>
 std::ostream &operator<<(std::ostream &os, const std::vector<T> &container) {
 
-  std::string indent = std::string(utils::indent_amount, ' ');
+  if constexpr (detail::to_chars_printable_v<T>) {
+    if (detail::print_numbers(os, container, '[', ']')) {
+      return os;
+    }
+  }
+
+  const detail::indentation indent{utils::indent_amount};
 
   if (container.size() == 0) {
     os << indent << "[]";
@@ -230,7 +375,13 @@ std::ostream &operator<<(std::ostream &os, const std::vector<T> &container) {
 template <typename T, std::size_t N>
 std::ostream &operator<<(std::ostream &os, const std::array<T, N> &container) {
 
-  std::string indent = std::string(utils::indent_amount, ' ');
+  if constexpr (detail::to_chars_printable_v<T>) {
+    if (detail::print_numbers(os, container, '[', ']')) {
+      return os;
+    }
+  }
+
+  const detail::indentation indent{utils::indent_amount};
 
   if (container.size() == 0) {
     os << indent << "[]";
@@ -310,7 +461,13 @@ template <typename T, typename Compare>
 std::ostream &operator<<(std::ostream &os,
                          const std::set<T, Compare> &container) {
 
-  std::string indent = std::string(utils::indent_amount, ' ');
+  if constexpr (detail::to_chars_printable_v<T>) {
+    if (detail::print_numbers(os, container, '{', '}')) {
+      return os;
+    }
+  }
+
+  const detail::indentation indent{utils::indent_amount};
 
   if (container.size() == 0) {
     os << indent << "{}";
@@ -370,7 +527,13 @@ std::ostream &
 operator<<(std::ostream &os,
            const std::unordered_set<T, Hash, KeyEqual> &container) {
 
-  std::string indent = std::string(utils::indent_amount, ' ');
+  if constexpr (detail::to_chars_printable_v<T>) {
+    if (detail::print_numbers(os, container, '{', '}')) {
+      return os;
+    }
+  }
+
+  const detail::indentation indent{utils::indent_amount};
 
   if (container.size() == 0) {
     os << indent << "{}";
@@ -429,7 +592,7 @@ template <typename K, typename V, typename Compare>
 std::ostream &operator<<(std::ostream &os,
                          const std::map<K, V, Compare> &container) {
 
-  std::string indent = std::string(utils::indent_amount, ' ');
+  const detail::indentation indent{utils::indent_amount};
 
   if (container.size() == 0) {
     os << indent << "{}";
@@ -489,7 +652,7 @@ std::ostream &
 operator<<(std::ostream &os,
            const std::unordered_map<K, V, Hash, KeyEqual> &container) {
 
-  std::string indent = std::string(utils::indent_amount, ' ');
+  const detail::indentation indent{utils::indent_amount};
 
   if (container.size() == 0) {
     os << indent << "{}";
@@ -547,7 +710,7 @@ operator<<(std::ostream &os,
 template <typename T>
 std::ostream &operator<<(std::ostream &os, const std::stack<T> &container) {
 
-  std::string indent = std::string(utils::indent_amount, ' ');
+  const detail::indentation indent{utils::indent_amount};
 
   if (container.size() == 0) {
     os << indent << "[]";
@@ -608,7 +771,7 @@ std::ostream &operator<<(std::ostream &os, const std::stack<T> &container) {
 template <typename T>
 std::ostream &operator<<(std::ostream &os, const std::queue<T> &container) {
 
-  std::string indent = std::string(utils::indent_amount, ' ');
+  const detail::indentation indent{utils::indent_amount};
 
   if (container.size() == 0) {
     os << indent << "[]";
@@ -671,7 +834,7 @@ std::ostream &
 operator<<(std::ostream &os,
            const std::priority_queue<T, Container, Compare> &container) {
 
-  std::string indent = std::string(utils::indent_amount, ' ');
+  const detail::indentation indent{utils::indent_amount};
 
   if (container.size() == 0) {
     os << indent << "[]";
@@ -0,0 +1,497 @@
+/**********************************************************************
+ * @brief Scoped timers and hierarchical profiling zones.
+ * @details A ScopedTimer times the scope it lives in. Timers nested inside
+ *each other form a tree of zones per thread, keyed by name under their
+ *parent, and every zone keeps its count, total, min, max and a log-scale
+ *histogram for percentiles. Profiler::report() merges the trees of every
+ *thread, running or finished, and exports them as JSON; with event recording
+ *on, Profiler::chrome_trace() also writes every zone as a Chrome trace event
+ *(chrome://tracing, Perfetto).
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "utils_cpp/json.hpp"
+#include "utils_cpp/timing.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utils {
+
+/**
+ * Aggregated timings of one zone and, recursively, of the zones timed inside
+ * it. Durations are in nanoseconds.
+ */
+struct ProfileZone {
+  /// Histogram buckets per power of two, so percentiles are within ~6%.
+  static constexpr std::size_t sub_buckets = 8;
+  static constexpr std::size_t num_buckets = 62 * sub_buckets;
+
+  std::string name = "root";
+  std::uint64_t count = 0;
+  std::uint64_t total_ns = 0;
+  std::uint64_t min_ns = std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t max_ns = 0;
+  std::array<std::uint64_t, num_buckets> histogram{};
+  std::vector<ProfileZone> children;
+
+  void add(std::uint64_t ns) noexcept {
+    ++count;
+    total_ns += ns;
+    min_ns = std::min(min_ns, ns);
+    max_ns = std::max(max_ns, ns);
+    ++histogram[bucket(ns)];
+  }
+
+  /// Adds the timings of 'other', and of its children to the matching ones.
+  void merge(const ProfileZone &other) {
+    count += other.count;
+    total_ns += other.total_ns;
+    min_ns = std::min(min_ns, other.min_ns);
+    max_ns = std::max(max_ns, other.max_ns);
+    for (std::size_t i = 0; i < num_buckets; ++i) {
+      histogram[i] += other.histogram[i];
+    }
+    for (const auto &child : other.children) {
+      child_named(child.name).merge(child);
+    }
+  }
+
+  ProfileZone &child_named(std::string_view child_name) {
+    for (auto &child : children) {
+      if (child.name == child_name) {
+        return child;
+      }
+    }
+    children.emplace_back();
+    children.back().name = child_name;
+    return children.back();
+  }
+
+  /// nullptr if there is no such child.
+  const ProfileZone *find(std::string_view child_name) const noexcept {
+    for (const auto &child : children) {
+      if (child.name == child_name) {
+        return &child;
+      }
+    }
+    return nullptr;
+  }
+
+  double mean_ns() const noexcept {
+    return count ? static_cast<double>(total_ns) / static_cast<double>(count)
+                 : 0.0;
+  }
+
+  /**
+   * @param p percentile in [0, 100]
+   * @return the p-th percentile duration, from the middle of its histogram
+   * bucket, or 0 if the zone never ran.
+   */
+  double percentile(double p) const noexcept {
+    if (count == 0) {
+      return 0.0;
+    }
+    auto rank = static_cast<std::uint64_t>(
+        std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 *
+                  static_cast<double>(count)));
+    rank = std::max<std::uint64_t>(rank, 1);
+    std::uint64_t seen = 0;
+    std::size_t i = 0;
+    for (; i < num_buckets; ++i) {
+      seen += histogram[i];
+      if (seen >= rank) {
+        break;
+      }
+    }
+    return std::clamp(bucket_middle(i), static_cast<double>(min_ns),
+                      static_cast<double>(max_ns));
+  }
+
+  /**
+   * {"name", "count", "total_ns", "mean_ns", "min_ns", "max_ns", "p50_ns",
+   * "p90_ns", "p99_ns", "children": [...]}
+   */
+  Json to_json() const {
+    Json json;
+    json["name"] = Json(std::string_view(name));
+    json["count"] = Json(count);
+    json["total_ns"] = Json(total_ns);
+    json["mean_ns"] = Json(mean_ns());
+    json["min_ns"] = Json(count ? min_ns : 0);
+    json["max_ns"] = Json(max_ns);
+    json["p50_ns"] = Json(percentile(50));
+    json["p90_ns"] = Json(percentile(90));
+    json["p99_ns"] = Json(percentile(99));
+    std::vector<Json> nested;
+    nested.reserve(children.size());
+    for (const auto &child : children) {
+      nested.push_back(child.to_json());
+    }
+    json["children"] = Json(nested);
+    return json;
+  }
+
+  static std::size_t bucket(std::uint64_t ns) noexcept {
+    if (ns < sub_buckets) {
+      return static_cast<std::size_t>(ns);
+    }
+    // ns >> shift is in [sub_buckets, 2 * sub_buckets).
+    const auto shift = static_cast<std::size_t>(std::bit_width(ns)) - 4;
+    return std::min((shift + 1) * sub_buckets +
+                        static_cast<std::size_t>(ns >> shift) - sub_buckets,
+                    num_buckets - 1);
+  }
+
+  static double bucket_middle(std::size_t i) noexcept {
+    if (i < sub_buckets) {
+      return static_cast<double>(i);
+    }
+    const std::size_t shift = i / sub_buckets - 1;
+    const double low =
+        std::ldexp(static_cast<double>(sub_buckets + i % sub_buckets),
+                   static_cast<int>(shift));
+    return low + std::ldexp(0.5, static_cast<int>(shift));
+  }
+};
+
+namespace _profiler_impl {
+
+struct trace_event {
+  const char *name;
+  std::uint64_t start_ns;
+  std::uint64_t duration_ns;
+};
+
+struct thread_profile;
+
+struct profiler_state {
+  std::atomic<bool> use_tsc{false};
+  std::atomic<bool> record_events{false};
+  // Converts cpu_ticks() to ns since 'origin', when use_tsc is set.
+  double ns_per_tick = 1.0;
+  std::uint64_t origin_ticks = 0;
+  std::chrono::steady_clock::time_point origin =
+      std::chrono::steady_clock::now();
+
+  std::mutex mutex;
+  std::atomic<std::uint32_t> next_thread_id{0};
+  // Threads with a profile that have not exited yet.
+  std::vector<thread_profile *> live;
+  // Zones and events of threads that exited.
+  ProfileZone finished;
+  std::vector<std::pair<std::uint32_t, std::vector<trace_event>>>
+      finished_events;
+};
+
+inline profiler_state &state() {
+  static profiler_state s;
+  return s;
+}
+
+/**
+ * The zone tree of one thread, as flat nodes that link to their parent so
+ * entering a zone only scans the children of the current one.
+ *
+ * Only the owning thread changes it, always holding 'mutex', so that other
+ * threads can read it under 'mutex' while holding state().mutex. The owner
+ * reads it without locking.
+ */
+struct thread_profile {
+  struct node {
+    ProfileZone zone;
+    std::size_t parent;
+    std::vector<std::size_t> children;
+    // The name pointer the zone was entered with, to skip the string compare
+    // when the same literal enters it again.
+    const char *key = nullptr;
+  };
+
+  std::vector<node> nodes;
+  std::size_t current = 0;
+  std::uint32_t thread_id;
+  std::vector<trace_event> events;
+  std::mutex mutex;
+
+  thread_profile() : thread_id{state().next_thread_id.fetch_add(1)} {
+    nodes.push_back({ProfileZone{}, 0, {}, nullptr});
+    auto &s = state();
+    std::scoped_lock<std::mutex> lock(s.mutex);
+    s.live.push_back(this);
+  }
+
+  ~thread_profile() {
+    auto &s = state();
+    std::scoped_lock<std::mutex> lock(s.mutex);
+    std::erase(s.live, this);
+    s.finished.merge(run_tree());
+    if (!events.empty()) {
+      s.finished_events.emplace_back(thread_id, std::move(events));
+    }
+  }
+
+  std::size_t enter(const char *name) {
+    for (std::size_t child : nodes[current].children) {
+      if (nodes[child].key == name) {
+        return current = child;
+      }
+    }
+    for (std::size_t child : nodes[current].children) {
+      if (nodes[child].zone.name == name) {
+        nodes[child].key = name;
+        return current = child;
+      }
+    }
+    std::scoped_lock<std::mutex> lock(mutex);
+    nodes.push_back({ProfileZone{}, current, {}, name});
+    nodes.back().zone.name = name;
+    nodes[current].children.push_back(nodes.size() - 1);
+    return current = nodes.size() - 1;
+  }
+
+  /// The nodes as a ProfileZone tree.
+  ProfileZone tree(std::size_t i = 0) const {
+    ProfileZone zone = nodes[i].zone;
+    for (std::size_t child : nodes[i].children) {
+      zone.children.push_back(tree(child));
+    }
+    return zone;
+  }
+
+  /// Like tree(), but leaves out zones that have not run since zero().
+  ProfileZone run_tree(std::size_t i = 0) const {
+    ProfileZone zone = nodes[i].zone;
+    for (std::size_t child : nodes[i].children) {
+      ProfileZone sub = run_tree(child);
+      if (sub.count > 0 || !sub.children.empty()) {
+        zone.children.push_back(std::move(sub));
+      }
+    }
+    return zone;
+  }
+
+  void clear() {
+    std::scoped_lock<std::mutex> lock(mutex);
+    nodes.resize(1);
+    nodes[0] = {ProfileZone{}, 0, {}, nullptr};
+    current = 0;
+    events.clear();
+  }
+
+  /**
+   * Zeroes the timings but keeps the nodes, so it is safe while the owning
+   * thread is inside a ScopedTimer. Called by other threads with the lock.
+   */
+  void zero() {
+    for (auto &n : nodes) {
+      ProfileZone zone;
+      zone.name = std::move(n.zone.name);
+      n.zone = std::move(zone);
+    }
+    events.clear();
+  }
+};
+
+inline thread_profile &local_profile() {
+  thread_local thread_profile profile;
+  return profile;
+}
+
+} // namespace _profiler_impl
+
+/**
+ * Times its own lifetime as a zone named 'name', nested under the innermost
+ * ScopedTimer alive on the same thread. Zones with the same name and parent
+ * are aggregated. With event recording on, the name must outlive the report
+ * (string literals do).
+ *
+ * @example
+ * void step() {
+ *   utils::ScopedTimer timer("step");
+ *   { utils::ScopedTimer t("solve"); solve(); }
+ *   { utils::ScopedTimer t("write"); write(); }
+ * }
+ */
+class ScopedTimer {
+public:
+  explicit ScopedTimer(const char *name)
+      : profile_{_profiler_impl::local_profile()}, node_{profile_.enter(name)},
+        name_{name} {
+    auto &s = _profiler_impl::state();
+    tsc_ = s.use_tsc.load(std::memory_order_acquire);
+    start_ = tsc_ ? cpu_ticks() : steady_now();
+  }
+
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+  ~ScopedTimer() {
+    auto &s = _profiler_impl::state();
+    std::uint64_t start_ns, duration_ns;
+    if (tsc_) {
+      const std::uint64_t ticks = cpu_ticks() - start_;
+      duration_ns = static_cast<std::uint64_t>(
+          static_cast<double>(ticks) * s.ns_per_tick);
+      start_ns = static_cast<std::uint64_t>(
+          static_cast<double>(start_ - s.origin_ticks) * s.ns_per_tick);
+    } else {
+      duration_ns = steady_now() - start_;
+      start_ns = start_;
+    }
+    std::scoped_lock<std::mutex> lock(profile_.mutex);
+    auto &node = profile_.nodes[node_];
+    node.zone.add(duration_ns);
+    profile_.current = node.parent;
+    if (s.record_events.load(std::memory_order_relaxed)) {
+      profile_.events.push_back({name_, start_ns, duration_ns});
+    }
+  }
+
+private:
+  // Nanoseconds since the profiler's origin.
+  static std::uint64_t steady_now() noexcept {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - _profiler_impl::state().origin)
+            .count());
+  }
+
+  _profiler_impl::thread_profile &profile_;
+  std::size_t node_;
+  const char *name_;
+  bool tsc_;
+  std::uint64_t start_;
+};
+
+/**
+ * Settings and reports of the ScopedTimer zones.
+ */
+struct Profiler {
+  /**
+   * Reads the time stamp counter (cpu_ticks) instead of steady_clock, which
+   * is cheaper on x86. The tick rate is measured on the first call that
+   * enables it, which takes a couple of milliseconds. Zones already running
+   * keep the clock they started with.
+   */
+  static void use_tsc(bool on) {
+    auto &s = _profiler_impl::state();
+    if (on) {
+      std::scoped_lock<std::mutex> lock(s.mutex);
+      if (s.origin_ticks == 0) {
+        s.ns_per_tick = 1e9 / cpu_ticks_per_second();
+        const auto since_origin = std::chrono::steady_clock::now() - s.origin;
+        s.origin_ticks =
+            cpu_ticks() -
+            static_cast<std::uint64_t>(
+                std::chrono::duration<double, std::nano>(since_origin).count() /
+                s.ns_per_tick);
+      }
+    }
+    s.use_tsc.store(on);
+  }
+
+  /**
+   * Also keeps one event per zone run, for chrome_trace(). Off by default,
+   * since the events grow without bound.
+   */
+  static void record_events(bool on) {
+    _profiler_impl::state().record_events.store(on);
+  }
+
+  /**
+   * The zones of every thread, merged by name path. The root zone is named
+   * "root" and has no timings itself. Threads that are still running, such
+   * as pool workers, contribute the zones they have closed so far.
+   */
+  static ProfileZone report() {
+    auto &s = _profiler_impl::state();
+    auto &local = _profiler_impl::local_profile();
+    ProfileZone zone = local.tree();
+    std::scoped_lock<std::mutex> lock(s.mutex);
+    for (auto *other : s.live) {
+      if (other != &local) {
+        std::scoped_lock<std::mutex> other_lock(other->mutex);
+        zone.merge(other->run_tree());
+      }
+    }
+    zone.merge(s.finished);
+    return zone;
+  }
+
+  /**
+   * Writes the recorded events of every thread in the Chrome trace event
+   * format, as complete ("X") events with times in microseconds.
+   */
+  static void chrome_trace(std::ostream &os) {
+    auto &s = _profiler_impl::state();
+    auto &local = _profiler_impl::local_profile();
+    std::vector<Json> events;
+    auto add = [&](std::uint32_t tid,
+                   const std::vector<_profiler_impl::trace_event> &list) {
+      for (const auto &e : list) {
+        Json event;
+        event["name"] = Json(std::string_view(e.name));
+        event["ph"] = Json(std::string_view("X"));
+        event["ts"] = Json(static_cast<double>(e.start_ns) / 1e3);
+        event["dur"] = Json(static_cast<double>(e.duration_ns) / 1e3);
+        event["pid"] = Json(0);
+        event["tid"] = Json(tid);
+        events.push_back(std::move(event));
+      }
+    };
+    add(local.thread_id, local.events);
+    {
+      std::scoped_lock<std::mutex> lock(s.mutex);
+      for (auto *other : s.live) {
+        if (other != &local) {
+          std::scoped_lock<std::mutex> other_lock(other->mutex);
+          add(other->thread_id, other->events);
+        }
+      }
+      for (const auto &[tid, list] : s.finished_events) {
+        add(tid, list);
+      }
+    }
+    Json trace;
+    trace["traceEvents"] = Json(events);
+    trace["displayTimeUnit"] = Json(std::string_view("ns"));
+    trace.dump(os);
+  }
+
+  /**
+   * Drops the zones and events of every thread. The calling thread must not
+   * be inside a ScopedTimer; other threads may be, and the zones they have
+   * open are counted when they close.
+   */
+  static void reset() {
+    auto &s = _profiler_impl::state();
+    auto &local = _profiler_impl::local_profile();
+    local.clear();
+    std::scoped_lock<std::mutex> lock(s.mutex);
+    for (auto *other : s.live) {
+      if (other != &local) {
+        std::scoped_lock<std::mutex> other_lock(other->mutex);
+        other->zero();
+      }
+    }
+    s.finished = ProfileZone{};
+    s.finished_events.clear();
+  }
+};
+
+} // namespace utils
@@ -1,7 +1,14 @@
 /**********************************************************************
  * @brief Custom random utilities that aim to produce consistent results
  * independent of platform (unlike e.g. STL distributions).
- * @details
+ * @details Besides std::mt19937_64, the functions take any uniform random
+ *bit generator, including the faster engines defined here: SplitMix64,
+ *Xoshiro256pp (with jump-ahead for parallel streams) and Pcg32. Engines with
+ *32-bit output are drawn from twice per 64-bit value. RandomBits hands out
+ *single bits from 64-bit draws, and fill_uniform / fill_bernoulli produce
+ *whole arrays, converting blocks of raw draws in loops that vectorize.
+ *Sampling without replacement takes time proportional to the sample, not to
+ *the range it is drawn from.
  * @author Sam Tonetto
  * @copyright GNU Public License
  * @date 2023
@@ -9,21 +16,386 @@
 
 #pragma once
 
+#include "utils_cpp/flat_hash_map.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numeric>
 #include <random>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 namespace utils {
 
+// ---- Engines ----
+
+/**
+ * SplitMix64: one 64-bit add and a finalizer per output. Passes BigCrush,
+ * and is what the other engines use to expand a 64-bit seed into their
+ * state.
+ */
+class SplitMix64 {
+public:
+  using result_type = std::uint64_t;
+
+  explicit SplitMix64(std::uint64_t seed = 0) noexcept : state_{seed} {}
+
+  static constexpr result_type min() noexcept { return 0; }
+  static constexpr result_type max() noexcept {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() noexcept {
+    std::uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  friend bool operator==(const SplitMix64 &, const SplitMix64 &) = default;
+
+private:
+  std::uint64_t state_;
+};
+
+/**
+ * xoshiro256++ (Blackman and Vigna): 256 bits of state, period 2^256 - 1,
+ * and a handful of shifts, rotates and adds per output. jump() and
+ * long_jump() advance by 2^128 and 2^192 outputs, which splits one seed into
+ * non-overlapping streams; see random_streams.
+ */
+class Xoshiro256pp {
+public:
+  using result_type = std::uint64_t;
+
+  /// The state is expanded from seed with SplitMix64, so it is never all
+  /// zero.
+  explicit Xoshiro256pp(std::uint64_t seed = 0) noexcept {
+    SplitMix64 expand(seed);
+    for (auto &word : state_) {
+      word = expand();
+    }
+  }
+
+  /// The state must not be all zero.
+  explicit Xoshiro256pp(const std::array<std::uint64_t, 4> &state) noexcept
+      : state_{state} {}
+
+  static constexpr result_type min() noexcept { return 0; }
+  static constexpr result_type max() noexcept {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() noexcept {
+    auto &s = state_;
+    const std::uint64_t result = std::rotl(s[0] + s[3], 23) + s[0];
+    const std::uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = std::rotl(s[3], 45);
+    return result;
+  }
+
+  /// Advances by 2^128 outputs.
+  void jump() noexcept {
+    apply_jump({0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL});
+  }
+
+  /// Advances by 2^192 outputs.
+  void long_jump() noexcept {
+    apply_jump({0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                0x77710069854ee241ULL, 0x39109bb02acbe635ULL});
+  }
+
+  const std::array<std::uint64_t, 4> &state() const noexcept {
+    return state_;
+  }
+
+  friend bool operator==(const Xoshiro256pp &, const Xoshiro256pp &) = default;
+
+private:
+  // The state after the number of steps whose characteristic polynomial
+  // residue is 'poly'.
+  void apply_jump(const std::array<std::uint64_t, 4> &poly) noexcept {
+    std::array<std::uint64_t, 4> jumped{};
+    for (std::uint64_t word : poly) {
+      for (int b = 0; b < 64; ++b) {
+        if (word & (std::uint64_t{1} << b)) {
+          for (std::size_t i = 0; i < 4; ++i) {
+            jumped[i] ^= state_[i];
+          }
+        }
+        (*this)();
+      }
+    }
+    state_ = jumped;
+  }
+
+  std::array<std::uint64_t, 4> state_;
+};
+
+/**
+ * PCG32 (O'Neill), the XSH-RR variant: a 64-bit LCG with a permuted 32-bit
+ * output. Small state, and 2^63 selectable streams; advance() jumps ahead
+ * by any number of outputs in O(log n).
+ */
+class Pcg32 {
+public:
+  using result_type = std::uint32_t;
+
+  explicit Pcg32(std::uint64_t seed = 0x853c49e6748fea9bULL,
+                 std::uint64_t stream = 0xda3e39cb94b95bdbULL) noexcept
+      : increment_{(stream << 1) | 1} {
+    (*this)();
+    state_ += seed;
+    (*this)();
+  }
+
+  static constexpr result_type min() noexcept { return 0; }
+  static constexpr result_type max() noexcept {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() noexcept {
+    const std::uint64_t old = state_;
+    state_ = old * multiplier + increment_;
+    const auto xorshifted =
+        static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+    return std::rotr(xorshifted, static_cast<int>(old >> 59));
+  }
+
+  /// Advances by delta outputs, as if operator() were called delta times.
+  void advance(std::uint64_t delta) noexcept {
+    // Square-and-multiply on the affine map x -> multiplier * x + increment.
+    std::uint64_t acc_mult = 1, acc_plus = 0;
+    std::uint64_t cur_mult = multiplier, cur_plus = increment_;
+    for (; delta > 0; delta >>= 1) {
+      if (delta & 1) {
+        acc_mult *= cur_mult;
+        acc_plus = acc_plus * cur_mult + cur_plus;
+      }
+      cur_plus = (cur_mult + 1) * cur_plus;
+      cur_mult *= cur_mult;
+    }
+    state_ = acc_mult * state_ + acc_plus;
+  }
+
+  friend bool operator==(const Pcg32 &, const Pcg32 &) = default;
+
+private:
+  static constexpr std::uint64_t multiplier = 6364136223846793005ULL;
+
+  std::uint64_t state_ = 0;
+  std::uint64_t increment_;
+};
+
+/**
+ * n Xoshiro256pp streams from one seed, each 2^128 outputs after the
+ * previous one, so they never overlap. Use one per thread.
+ */
+inline std::vector<Xoshiro256pp> random_streams(std::uint64_t seed,
+                                                std::size_t n) {
+  std::vector<Xoshiro256pp> streams;
+  streams.reserve(n);
+  Xoshiro256pp gen(seed);
+  for (std::size_t i = 0; i < n; ++i) {
+    streams.push_back(gen);
+    gen.jump();
+  }
+  return streams;
+}
+
+namespace detail {
+
+/**
+ * A uniform 64-bit value from gen: one draw from a 64-bit engine, two from a
+ * 32-bit one.
+ */
+template <std::uniform_random_bit_generator Gen>
+std::uint64_t next_u64(Gen &gen) {
+  using result_type = typename Gen::result_type;
+  static_assert(Gen::min() == 0 &&
+                    (Gen::max() == std::numeric_limits<std::uint64_t>::max() ||
+                     Gen::max() == std::numeric_limits<std::uint32_t>::max()),
+                "utils random functions need a generator of all 32-bit or "
+                "all 64-bit values");
+  if constexpr (Gen::max() == std::numeric_limits<std::uint64_t>::max()) {
+    return static_cast<std::uint64_t>(gen());
+  } else {
+    const std::uint64_t high = static_cast<result_type>(gen());
+    return (high << 32) | static_cast<result_type>(gen());
+  }
+}
+
+// [0, 1) with 52 random bits: the top bits as the mantissa of a double in
+// [1, 2), minus one. Unlike an integer-to-double conversion, this
+// vectorizes with SSE2.
+inline double unit_double(std::uint64_t bits) noexcept {
+  return std::bit_cast<double>((bits >> 12) | 0x3ff0000000000000ULL) - 1.0;
+}
+
+} // namespace detail
+
+// ---- Bits and batches ----
+
+/**
+ * Single random bits from a generator, 64 per 64-bit draw, in order from the
+ * least significant bit of each draw. Holds a reference to gen.
+ */
+template <std::uniform_random_bit_generator Gen>
+class RandomBits {
+public:
+  explicit RandomBits(Gen &gen) noexcept : gen_{&gen} {}
+
+  bool operator()() {
+    if (left_ == 0) {
+      refill();
+    }
+    const bool bit = word_ & 1;
+    word_ >>= 1;
+    --left_;
+    return bit;
+  }
+
+  /**
+   * The next n bits, n <= 64, as the low bits of the result (the first bit
+   * drawn is the least significant).
+   */
+  std::uint64_t bits(unsigned n) {
+    if (n > 64) {
+      throw std::invalid_argument("RandomBits::bits: n must be at most 64");
+    }
+    std::uint64_t result = 0;
+    unsigned have = 0;
+    if (left_ < n) {
+      result = word_;
+      have = left_;
+      refill();
+    }
+    const unsigned need = n - have;
+    if (need == 64) {
+      result = word_;
+      word_ = 0;
+    } else {
+      result |= (word_ & ((std::uint64_t{1} << need) - 1)) << have;
+      word_ >>= need;
+    }
+    left_ -= need;
+    return result;
+  }
+
+private:
+  void refill() {
+    word_ = detail::next_u64(*gen_);
+    left_ = 64;
+  }
+
+  Gen *gen_;
+  std::uint64_t word_ = 0;
+  unsigned left_ = 0;
+};
+
+/**
+ * Fills out with uniform doubles in [0, 1), each with 52 random bits.
+ * Draws a block of raw values, then converts the block, so the conversion
+ * loop vectorizes.
+ */
+template <std::uniform_random_bit_generator Gen>
+void fill_uniform(std::span<double> out, Gen &gen) {
+  constexpr std::size_t block = 64;
+  std::array<std::uint64_t, block> raw;
+  for (std::size_t i = 0; i < out.size(); i += block) {
+    const std::size_t n = std::min(block, out.size() - i);
+    for (std::size_t j = 0; j < n; ++j) {
+      raw[j] = detail::next_u64(gen);
+    }
+    for (std::size_t j = 0; j < n; ++j) {
+      out[i + j] = detail::unit_double(raw[j]);
+    }
+  }
+}
+
+/**
+ * Fills out with uniform doubles in [min, max).
+ */
+template <std::uniform_random_bit_generator Gen>
+void fill_uniform(std::span<double> out, double min, double max, Gen &gen) {
+  fill_uniform(out, gen);
+  const double scale = max - min;
+  for (double &x : out) {
+    x = min + x * scale;
+  }
+}
+
+/**
+ * Fills out with independent Bernoulli(p) values, 1 with probability p.
+ * p = 0.5 takes one bit per value; other p compare a 64-bit draw with
+ * p * 2^64.
+ */
+template <typename T, std::uniform_random_bit_generator Gen>
+  requires std::is_arithmetic_v<T>
+void fill_bernoulli(std::span<T> out, double p, Gen &gen) {
+  if (!(p > 0.0)) {
+    std::fill(out.begin(), out.end(), T{0});
+    return;
+  }
+  if (p >= 1.0) {
+    std::fill(out.begin(), out.end(), T{1});
+    return;
+  }
+  if (p == 0.5) {
+    for (std::size_t i = 0; i < out.size(); i += 64) {
+      std::uint64_t word = detail::next_u64(gen);
+      const std::size_t n = std::min<std::size_t>(64, out.size() - i);
+      for (std::size_t j = 0; j < n; ++j) {
+        out[i + j] = static_cast<T>((word >> j) & 1);
+      }
+    }
+    return;
+  }
+  // p * 2^64, exact for the p that doubles can represent.
+  const auto threshold = static_cast<std::uint64_t>(p * 0x1.0p64);
+  constexpr std::size_t block = 64;
+  std::array<std::uint64_t, block> raw;
+  for (std::size_t i = 0; i < out.size(); i += block) {
+    const std::size_t n = std::min(block, out.size() - i);
+    for (std::size_t j = 0; j < n; ++j) {
+      raw[j] = detail::next_u64(gen);
+    }
+    for (std::size_t j = 0; j < n; ++j) {
+      out[i + j] = static_cast<T>(raw[j] < threshold);
+    }
+  }
+}
+
+// ---- Distributions ----
+
 /**
  * @brief Generates a random integer in the range [0, 1] *inclusive*.
  */
-inline int random_int(std::mt19937_64 &gen) { return gen() & 1; }
+template <std::uniform_random_bit_generator Gen>
+int random_int(Gen &gen) {
+  return static_cast<int>(detail::next_u64(gen) & 1);
+}
 
 /**
  * @brief Generates a random double in the range [0, 1] *inclusive*.
  */
-inline double random_double(std::mt19937_64 &gen) {
-  return static_cast<double>(gen()) / static_cast<double>(gen.max() + 1.0);
+template <std::uniform_random_bit_generator Gen>
+double random_double(Gen &gen) {
+  return static_cast<double>(detail::next_u64(gen)) / 0x1.0p64;
 }
 
 /**
@@ -36,18 +408,19 @@ inline double random_double(std::mt19937_64 &gen) {
  * Finally, a random integer is sampled until it lands in the range [0,
  * max_value) and the result is shifted back to the original range.
  */
-template <typename T>
+template <typename T, std::uniform_random_bit_generator Gen>
   requires std::is_integral_v<T>
-T random_int(T min, T max, std::mt19937_64 &gen) {
+T random_int(T min, T max, Gen &gen) {
 
   using ULL = unsigned long long;
+  constexpr ULL gen_max = std::numeric_limits<std::uint64_t>::max();
 
   ULL range_size = max - min + 1; // if this overflows... too bad
-  ULL max_value = gen.max() - gen.max() % range_size;
+  ULL max_value = gen_max - gen_max % range_size;
 
   ULL sampled_int;
   do {
-    sampled_int = gen();
+    sampled_int = detail::next_u64(gen);
   } while (sampled_int >= max_value);
 
   return min + static_cast<T>(sampled_int % range_size);
@@ -56,15 +429,16 @@ T random_int(T min, T max, std::mt19937_64 &gen) {
 /**
  * @brief Generates a random double in the range [min, max] *inclusive*.
  */
-inline double random_double(double min, double max, std::mt19937_64 &gen) {
+template <std::uniform_random_bit_generator Gen>
+double random_double(double min, double max, Gen &gen) {
   return min + random_double(gen) * (max - min);
 }
 
 /**
  * @brief Selects a random element from a vector of elements.
  */
-template <typename T>
-T random_choice(const std::vector<T> &data, std::mt19937_64 &gen) {
+template <typename T, std::uniform_random_bit_generator Gen>
+T random_choice(const std::vector<T> &data, Gen &gen) {
 
   if (data.empty()) {
     throw std::invalid_argument(
@@ -78,8 +452,8 @@ T random_choice(const std::vector<T> &data, std::mt19937_64 &gen) {
  * @brief Consistently shuffles a vector of elements using Durstenfeld's
  * implementation of the Fisher-Yates algorithm.
  */
-template <typename T>
-void random_shuffle(std::vector<T> &data, std::mt19937_64 &gen) {
+template <typename T, std::uniform_random_bit_generator Gen>
+void random_shuffle(std::vector<T> &data, Gen &gen) {
   if (data.empty()) {
     return;
   }
@@ -95,9 +469,10 @@ void random_shuffle(std::vector<T> &data, std::mt19937_64 &gen) {
  * @brief Consistently shuffles a vector of elements using Durstenfeld's
  * implementation of the Fisher-Yates algorithm.
  */
-template <typename RandomAccessIterator>
+template <typename RandomAccessIterator,
+          std::uniform_random_bit_generator Gen>
 void random_shuffle(RandomAccessIterator begin, RandomAccessIterator end,
-                    std::mt19937_64 &gen) {
+                    Gen &gen) {
   if (begin == end) {
     return;
   }
@@ -113,8 +488,8 @@ void random_shuffle(RandomAccessIterator begin, RandomAccessIterator end,
  * @brief Constructs and returns a shuffled vector of contiguous indices in the
  * range [0, size).
  */
-inline std::vector<std::size_t> shuffled_iota(std::size_t size,
-                                              std::mt19937_64 &gen) {
+template <std::uniform_random_bit_generator Gen>
+std::vector<std::size_t> shuffled_iota(std::size_t size, Gen &gen) {
 
   std::vector<std::size_t> indices(size);
   std::iota(indices.begin(), indices.end(), 0);
@@ -122,53 +497,341 @@ inline std::vector<std::size_t> shuffled_iota(std::size_t size,
   return indices;
 }
 
+namespace detail {
+
+// Below this fraction of the range, Floyd's algorithm touches less memory
+// than initializing the index buffer of a partial Fisher-Yates shuffle.
+inline constexpr std::size_t floyd_max_fraction = 32;
+
+// Uniform in (0, 1], so that its logarithm is finite.
+template <std::uniform_random_bit_generator Gen>
+double open_unit_double(Gen &gen) {
+  return 1.0 - unit_double(next_u64(gen));
+}
+
+// Vitter's Algorithm A: num_samples sorted indices from [0, size), offset
+// by first. Expected time O(size), used by Algorithm D once few records
+// remain per sample.
+template <std::output_iterator<std::size_t> OutputIt,
+          std::uniform_random_bit_generator Gen>
+OutputIt vitter_a(std::size_t first, std::size_t size, std::size_t num_samples,
+                  OutputIt out, Gen &gen) {
+  double top = static_cast<double>(size - num_samples);
+  double remaining = static_cast<double>(size);
+  for (; num_samples >= 2; --num_samples) {
+    const double v = unit_double(next_u64(gen));
+    double quot = top / remaining;
+    while (quot > v) {
+      ++first;
+      top -= 1.0;
+      remaining -= 1.0;
+      quot *= top / remaining;
+    }
+    *out++ = first++;
+    remaining -= 1.0;
+  }
+  if (num_samples == 1) {
+    const auto skip = static_cast<std::size_t>(
+        remaining * unit_double(next_u64(gen)));
+    *out++ = first + std::min(skip, static_cast<std::size_t>(remaining) - 1);
+  }
+  return out;
+}
+
+} // namespace detail
+
+/**
+ * @brief Writes a uniformly random subset of num_samples indices from [0,
+ * size) to out, in increasing order.
+ *
+ * @details Vitter's Algorithm D: each index is found by drawing the gap to
+ * it directly, so the expected time is O(num_samples) and no memory is used
+ * beyond the output. Indices are written as they are drawn, so the output
+ * iterator can consume them one at a time. Sizes are handled as doubles and
+ * must stay below 2^53.
+ */
+template <std::output_iterator<std::size_t> OutputIt,
+          std::uniform_random_bit_generator Gen>
+OutputIt sample_sorted_indices(std::size_t size, std::size_t num_samples,
+                               OutputIt out, Gen &gen) {
+
+  if (num_samples > size) {
+    throw std::invalid_argument(
+        "Cannot sample more indices than the size of the container.");
+  }
+  if (num_samples == 0) {
+    return out;
+  }
+
+  // Switch to Algorithm A once fewer than 13 records remain per sample.
+  constexpr std::size_t alpha_inv = 13;
+  std::size_t first = 0;
+  std::size_t n = num_samples, records = size;
+  double n_real = static_cast<double>(n);
+  double records_real = static_cast<double>(records);
+  double n_inv = 1.0 / n_real;
+  double v_prime = std::exp(std::log(detail::open_unit_double(gen)) * n_inv);
+  std::size_t qu1 = records - n + 1;
+  double qu1_real = static_cast<double>(qu1);
+
+  while (n > 1 && alpha_inv * n < records) {
+    const double n_min1_inv = 1.0 / (n_real - 1.0);
+    std::size_t skip;
+    while (true) {
+      // Draw a candidate gap X from the continuous approximation.
+      double x;
+      while (true) {
+        x = records_real * (1.0 - v_prime);
+        skip = static_cast<std::size_t>(x);
+        if (skip < qu1) {
+          break;
+        }
+        v_prime = std::exp(std::log(detail::open_unit_double(gen)) * n_inv);
+      }
+      const double u = detail::open_unit_double(gen);
+      const double skip_real = static_cast<double>(skip);
+      const double y1 =
+          std::exp(std::log(u * records_real / qu1_real) * n_min1_inv);
+      v_prime = y1 * (1.0 - x / records_real) *
+                (qu1_real / (qu1_real - skip_real));
+      if (v_prime <= 1.0) {
+        // Accepted by the cheap test; v_prime is reused for the next gap.
+        break;
+      }
+
+      // The exact test.
+      double y2 = 1.0, top = records_real - 1.0, bottom;
+      std::size_t limit;
+      if (n - 1 > skip) {
+        bottom = records_real - n_real;
+        limit = records - skip;
+      } else {
+        bottom = records_real - skip_real - 1.0;
+        limit = qu1;
+      }
+      for (std::size_t t = records - 1; t >= limit; --t) {
+        y2 = y2 * top / bottom;
+        top -= 1.0;
+        bottom -= 1.0;
+      }
+      if (records_real / (records_real - x) >=
+          y1 * std::exp(std::log(y2) * n_min1_inv)) {
+        v_prime =
+            std::exp(std::log(detail::open_unit_double(gen)) * n_min1_inv);
+        break;
+      }
+      v_prime = std::exp(std::log(detail::open_unit_double(gen)) * n_inv);
+    }
+
+    first += skip;
+    *out++ = first++;
+    records -= skip + 1;
+    records_real -= static_cast<double>(skip) + 1.0;
+    --n;
+    n_real -= 1.0;
+    n_inv = n_min1_inv;
+    qu1 -= skip;
+    qu1_real -= static_cast<double>(skip);
+  }
+
+  if (n > 1) {
+    return detail::vitter_a(first, records, n, out, gen);
+  }
+  // One sample left: v_prime is uniform, so the gap is uniform too.
+  const auto skip = static_cast<std::size_t>(records_real * v_prime);
+  *out++ = first + std::min(skip, records - 1);
+  return out;
+}
+
+/**
+ * @brief Selects a random subset of indices up to a given container size
+ * without replacement, using a caller-owned buffer.
+ *
+ * @details A partial Fisher-Yates shuffle: only the first num_samples
+ * positions of buffer are shuffled, in O(num_samples) time. buffer must
+ * hold a permutation of [0, size) and is left holding one; it is
+ * initialized when its size differs from size. Reusing it across calls
+ * therefore costs O(size) once. The returned span views the start of
+ * buffer and is valid until buffer is next modified.
+ */
+template <std::uniform_random_bit_generator Gen>
+std::span<const std::size_t>
+sample_indices_without_replacement(std::size_t size, std::size_t num_samples,
+                                   Gen &gen, std::vector<std::size_t> &buffer) {
+
+  if (num_samples > size) {
+    throw std::invalid_argument(
+        "Cannot sample more indices than the size of the container.");
+  }
+
+  if (buffer.size() != size) {
+    buffer.resize(size);
+    std::iota(buffer.begin(), buffer.end(), 0);
+  }
+  for (std::size_t i = 0; i < num_samples; ++i) {
+    std::size_t j = random_int(i, size - 1, gen);
+    if (i != j) {
+      std::swap(buffer[i], buffer[j]);
+    }
+  }
+  return std::span<const std::size_t>(buffer.data(), num_samples);
+}
+
 /**
  * @brief Selects a random subset of indices up to a given container size
  * without replacement.
+ *
+ * @details The indices come in random order. For samples that are small
+ * compared to size, Floyd's algorithm draws them in O(num_samples) time and
+ * memory, using a flat hash set of the indices chosen so far. Larger samples
+ * use a partial Fisher-Yates shuffle of [0, size).
  */
-std::vector<std::size_t> inline sample_indices_without_replacement(
-    std::size_t size, std::size_t num_samples, std::mt19937_64 &gen) {
+template <std::uniform_random_bit_generator Gen>
+std::vector<std::size_t>
+sample_indices_without_replacement(std::size_t size, std::size_t num_samples,
+                                   Gen &gen) {
 
   if (num_samples > size) {
     throw std::invalid_argument(
         "Cannot sample more indices than the size of the container.");
   }
 
-  auto indices = shuffled_iota(size, gen);
-  return std::vector<std::size_t>(indices.begin(),
-                                  indices.begin() + num_samples);
+  if (num_samples > size / detail::floyd_max_fraction) {
+    std::vector<std::size_t> indices;
+    sample_indices_without_replacement(size, num_samples, gen, indices);
+    indices.resize(num_samples);
+    return indices;
+  }
+
+  std::vector<std::size_t> indices;
+  indices.reserve(num_samples);
+  FlatHashSet<std::size_t> chosen;
+  chosen.reserve(num_samples);
+  for (std::size_t j = size - num_samples; j < size; ++j) {
+    std::size_t t = random_int(0ul, j, gen);
+    if (!chosen.insert(t).second) {
+      t = j;
+      chosen.insert(t);
+    }
+    indices.push_back(t);
+  }
+  // Floyd's algorithm picks a uniform subset, but not in a uniform order
+  // (j is always last among the elements chosen so far).
+  utils::random_shuffle(indices, gen);
+  return indices;
 }
 
 /**
  * @brief Selects a random subset of elements from a vector of elements without
  * replacement.
  */
-template <typename T>
+template <typename T, std::uniform_random_bit_generator Gen>
 std::vector<T> sample_without_replacement(const std::vector<T> &data,
-                                          std::size_t num_samples,
-                                          std::mt19937_64 &gen) {
+                                          std::size_t num_samples, Gen &gen) {
 
   if (num_samples > data.size()) {
     throw std::invalid_argument(
         "Cannot sample more elements than the size of the vector.");
   }
 
-  auto indices = shuffled_iota(data.size(), gen);
+  auto indices = sample_indices_without_replacement(data.size(), num_samples,
+                                                    gen);
   std::vector<T> samples;
   samples.reserve(num_samples);
-  for (std::size_t i = 0; i < num_samples; ++i) {
-    samples.push_back(data[indices[i]]);
+  for (std::size_t i : indices) {
+    samples.push_back(data[i]);
   }
 
   return samples;
 }
 
+/**
+ * @brief Samples indices with probabilities proportional to fixed weights,
+ * in O(1) time per sample.
+ *
+ * @details Vose's alias method: building the table takes O(n) time. Each
+ * sample picks a column uniformly, then either the column itself or its
+ * alias by comparing a uniform double against the column's threshold.
+ */
+class AliasTable {
+public:
+  AliasTable() = default;
+
+  /**
+   * Throws std::invalid_argument if weights is empty, contains a negative
+   * or non-finite weight, or sums to zero.
+   */
+  explicit AliasTable(std::span<const double> weights) {
+    const std::size_t n = weights.size();
+    if (n == 0) {
+      throw std::invalid_argument("AliasTable: no weights given.");
+    }
+    double total = 0;
+    for (double w : weights) {
+      if (!(w >= 0) || !std::isfinite(w)) {
+        throw std::invalid_argument(
+            "AliasTable: weights must be finite and non-negative.");
+      }
+      total += w;
+    }
+    if (!(total > 0) || !std::isfinite(total)) {
+      throw std::invalid_argument(
+          "AliasTable: weights must have a positive, finite sum.");
+    }
+
+    threshold_.resize(n);
+    alias_.resize(n);
+    std::vector<std::size_t> small, large;
+    const double scale = static_cast<double>(n) / total;
+    for (std::size_t i = 0; i < n; ++i) {
+      threshold_[i] = weights[i] * scale;
+      alias_[i] = i;
+      (threshold_[i] < 1.0 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+      const std::size_t s = small.back(), l = large.back();
+      small.pop_back();
+      alias_[s] = l;
+      threshold_[l] -= 1.0 - threshold_[s];
+      if (threshold_[l] < 1.0) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    // Whatever is left is 1 up to rounding error.
+    for (std::size_t i : small) {
+      threshold_[i] = 1.0;
+    }
+    for (std::size_t i : large) {
+      threshold_[i] = 1.0;
+    }
+  }
+
+  std::size_t size() const noexcept { return threshold_.size(); }
+
+  /**
+   * An index in [0, size()). Must not be called on an empty table.
+   */
+  template <std::uniform_random_bit_generator Gen>
+  std::size_t operator()(Gen &gen) const {
+    const std::size_t column = random_int(0ul, size() - 1, gen);
+    return detail::unit_double(detail::next_u64(gen)) < threshold_[column]
+               ? column
+               : alias_[column];
+  }
+
+private:
+  std::vector<double> threshold_;
+  std::vector<std::size_t> alias_;
+};
+
 /**
  * @brief Constructs and returns a shuffled mapping from contiguous indices in
  * the range [0, size) to contiguous indices in the range [0, size).
  */
-std::unordered_map<std::size_t, std::size_t> inline shuffled_mapping(
-    std::size_t size, std::mt19937_64 &gen) {
+template <std::uniform_random_bit_generator Gen>
+std::unordered_map<std::size_t, std::size_t> shuffled_mapping(std::size_t size,
+                                                              Gen &gen) {
 
   auto shuffled_indices = shuffled_iota(size, gen);
   std::unordered_map<std::size_t, std::size_t> mapping;
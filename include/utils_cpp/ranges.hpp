@@ -0,0 +1,315 @@
+/**********************************************************************
+ * @brief Lazy random-access views behind arange, seq and rep.
+ * @details LinearView is the arithmetic sequence start + i * step, and
+ *CycleView repeats another random-access view up to a given length. Both are
+ *std::ranges views that compute elements on access, so they compose with
+ *std::views::transform and friends without temporary vectors. When the
+ *elements are wanted in memory, copy_to and fill_linear write them in bulk
+ *with loops the compiler vectorizes.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace utils {
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief Random-access iterator over start + i * step. Each element is
+ * computed from its index, not accumulated, so floating-point sequences do
+ * not drift.
+ */
+template <typename T>
+class linear_iterator {
+public:
+  using iterator_concept = std::random_access_iterator_tag;
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+
+  constexpr linear_iterator() noexcept = default;
+  constexpr linear_iterator(T start, T step, std::size_t index) noexcept
+      : start_(start), step_(step), index_(index) {}
+
+  constexpr T operator*() const noexcept {
+    return static_cast<T>(start_ + static_cast<T>(index_) * step_);
+  }
+  constexpr T operator[](difference_type n) const noexcept {
+    return *(*this + n);
+  }
+
+  constexpr linear_iterator &operator++() noexcept {
+    ++index_;
+    return *this;
+  }
+  constexpr linear_iterator operator++(int) noexcept {
+    auto old = *this;
+    ++index_;
+    return old;
+  }
+  constexpr linear_iterator &operator--() noexcept {
+    --index_;
+    return *this;
+  }
+  constexpr linear_iterator operator--(int) noexcept {
+    auto old = *this;
+    --index_;
+    return old;
+  }
+  constexpr linear_iterator &operator+=(difference_type n) noexcept {
+    index_ += static_cast<std::size_t>(n);
+    return *this;
+  }
+  constexpr linear_iterator &operator-=(difference_type n) noexcept {
+    index_ -= static_cast<std::size_t>(n);
+    return *this;
+  }
+
+  friend constexpr linear_iterator operator+(linear_iterator it,
+                                             difference_type n) noexcept {
+    return it += n;
+  }
+  friend constexpr linear_iterator operator+(difference_type n,
+                                             linear_iterator it) noexcept {
+    return it += n;
+  }
+  friend constexpr linear_iterator operator-(linear_iterator it,
+                                             difference_type n) noexcept {
+    return it -= n;
+  }
+  friend constexpr difference_type
+  operator-(const linear_iterator &a, const linear_iterator &b) noexcept {
+    return static_cast<difference_type>(a.index_ - b.index_);
+  }
+
+  // Iterators of the same sequence compare by position.
+  friend constexpr bool operator==(const linear_iterator &a,
+                                   const linear_iterator &b) noexcept {
+    return a.index_ == b.index_;
+  }
+  friend constexpr std::strong_ordering
+  operator<=>(const linear_iterator &a, const linear_iterator &b) noexcept {
+    return a.index_ <=> b.index_;
+  }
+
+private:
+  T start_{};
+  T step_{};
+  std::size_t index_ = 0;
+};
+
+} // namespace detail
+
+/**
+ * Writes start + i * step to out[i] for every i, with the same values as
+ * LinearView. The loop vectorizes: the index is kept in 32 bits whenever it
+ * fits, since SSE2 and AVX2 convert 32-bit integers to floating point but
+ * not 64-bit ones.
+ */
+template <typename T>
+  requires std::is_arithmetic_v<T>
+void fill_linear(std::span<T> out, T start, T step) noexcept {
+  constexpr auto max32 =
+      static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max());
+  T *p = out.data();
+  const auto n = static_cast<std::int32_t>(std::min(out.size(), max32));
+  for (std::int32_t i = 0; i < n; ++i) {
+    p[i] = static_cast<T>(start + static_cast<T>(i) * step);
+  }
+  for (std::size_t i = max32; i < out.size(); ++i) {
+    p[i] = static_cast<T>(start + static_cast<T>(i) * step);
+  }
+}
+
+/**
+ * @brief The sequence start, start + step, ..., of size elements, as a
+ * random-access view. A step of zero repeats start.
+ */
+template <typename T>
+  requires std::is_arithmetic_v<T>
+class LinearView : public std::ranges::view_interface<LinearView<T>> {
+public:
+  using iterator = detail::linear_iterator<T>;
+
+  constexpr LinearView() noexcept = default;
+  constexpr LinearView(T start, T step, std::size_t size) noexcept
+      : start_(start), step_(step), size_(size) {}
+
+  constexpr iterator begin() const noexcept { return {start_, step_, 0}; }
+  constexpr iterator end() const noexcept { return {start_, step_, size_}; }
+  constexpr std::size_t size() const noexcept { return size_; }
+
+  constexpr T start() const noexcept { return start_; }
+  constexpr T step() const noexcept { return step_; }
+
+  /// Writes the elements to the front of out, which holds at least size().
+  void copy_to(std::span<T> out) const noexcept {
+    fill_linear(out.first(size_), start_, step_);
+  }
+
+  std::vector<T> to_vector() const {
+    std::vector<T> result(size_);
+    copy_to(result);
+    return result;
+  }
+
+private:
+  T start_{};
+  T step_{};
+  std::size_t size_ = 0;
+};
+
+/**
+ * @brief The elements of a random-access view V, repeated from the start
+ * until there are size of them. Element k is base[k % base.size()].
+ */
+template <std::ranges::view V>
+  requires std::ranges::random_access_range<const V> &&
+           std::ranges::sized_range<const V>
+class CycleView : public std::ranges::view_interface<CycleView<V>> {
+  using base_iterator = std::ranges::iterator_t<const V>;
+
+public:
+  class iterator {
+  public:
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::ranges::range_value_t<const V>;
+    using reference = std::ranges::range_reference_t<const V>;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    iterator(base_iterator first, std::size_t period, std::size_t index)
+        : first_(first), period_(period), index_(index) {}
+
+    reference operator*() const {
+      return first_[static_cast<difference_type>(index_ % period_)];
+    }
+    reference operator[](difference_type n) const { return *(*this + n); }
+
+    iterator &operator++() noexcept {
+      ++index_;
+      return *this;
+    }
+    iterator operator++(int) noexcept {
+      auto old = *this;
+      ++index_;
+      return old;
+    }
+    iterator &operator--() noexcept {
+      --index_;
+      return *this;
+    }
+    iterator operator--(int) noexcept {
+      auto old = *this;
+      --index_;
+      return old;
+    }
+    iterator &operator+=(difference_type n) noexcept {
+      index_ += static_cast<std::size_t>(n);
+      return *this;
+    }
+    iterator &operator-=(difference_type n) noexcept {
+      index_ -= static_cast<std::size_t>(n);
+      return *this;
+    }
+
+    friend iterator operator+(iterator it, difference_type n) noexcept {
+      return it += n;
+    }
+    friend iterator operator+(difference_type n, iterator it) noexcept {
+      return it += n;
+    }
+    friend iterator operator-(iterator it, difference_type n) noexcept {
+      return it -= n;
+    }
+    friend difference_type operator-(const iterator &a,
+                                     const iterator &b) noexcept {
+      return static_cast<difference_type>(a.index_ - b.index_);
+    }
+    friend bool operator==(const iterator &a, const iterator &b) noexcept {
+      return a.index_ == b.index_;
+    }
+    friend std::strong_ordering operator<=>(const iterator &a,
+                                            const iterator &b) noexcept {
+      return a.index_ <=> b.index_;
+    }
+
+  private:
+    base_iterator first_{};
+    std::size_t period_ = 1;
+    std::size_t index_ = 0;
+  };
+
+  CycleView()
+    requires std::default_initializable<V>
+  = default;
+
+  /// @throws std::invalid_argument if size > 0 and base is empty
+  CycleView(V base, std::size_t size) : base_(std::move(base)), size_(size) {
+    if (size_ > 0 && std::ranges::empty(base_)) {
+      throw std::invalid_argument("CycleView of an empty range");
+    }
+  }
+
+  iterator begin() const { return {std::ranges::begin(base_), period(), 0}; }
+  iterator end() const { return {std::ranges::begin(base_), period(), size_}; }
+  std::size_t size() const noexcept { return size_; }
+
+  const V &base() const noexcept { return base_; }
+
+  /**
+   * Writes the elements to the front of out, which holds at least size():
+   * one copy of base, then doubling copies of what is already written.
+   */
+  template <typename T>
+  void copy_to(std::span<T> out) const {
+    if (size_ == 0) {
+      return;
+    }
+    auto first = std::ranges::begin(base_);
+    std::size_t written = std::min(period(), size_);
+    std::copy(first, first + static_cast<std::ptrdiff_t>(written),
+              out.begin());
+    while (written < size_) {
+      std::size_t n = std::min(written, size_ - written);
+      std::copy_n(out.begin(), n, out.begin() + written);
+      written += n;
+    }
+  }
+
+  std::vector<std::ranges::range_value_t<const V>> to_vector() const {
+    std::vector<std::ranges::range_value_t<const V>> result(size_);
+    copy_to(std::span(result));
+    return result;
+  }
+
+private:
+  std::size_t period() const noexcept {
+    return std::max<std::size_t>(std::ranges::size(base_), 1);
+  }
+
+  V base_{};
+  std::size_t size_ = 0;
+};
+
+template <typename R>
+CycleView(R &&, std::size_t) -> CycleView<std::views::all_t<R>>;
+
+} // namespace utils
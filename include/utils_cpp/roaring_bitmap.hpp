@@ -0,0 +1,591 @@
+/**********************************************************************
+ * @brief A compressed (roaring) bitmap of 32-bit integers.
+ * @details The values are split by their high 16 bits into chunks of 65536,
+ *and each non-empty chunk is stored in the container that suits its density:
+ *a sorted array of the low 16 bits while it holds at most 4096 values, and a
+ *65536-bit bitmap (8 KiB) above that. Memory is therefore proportional to the
+ *number of values for sparse sets and to the range for dense ones, and
+ *intersections and unions work container by container, merging arrays and
+ *combining bitmaps word by word.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include "bitops.hpp"
+#include "bitvector.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace utils {
+
+class RoaringBitmap {
+public:
+  /// Chunks holding more values than this are stored as bitmaps.
+  static constexpr std::size_t max_array_size = 4096;
+
+  /// Words in a bitmap container.
+  static constexpr std::size_t bitmap_words = 1024;
+
+  /**
+   * Forward iterator over the values, in increasing order.
+   */
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::uint32_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::uint32_t *;
+    using reference = std::uint32_t;
+
+    const_iterator() = default;
+
+    std::uint32_t operator*() const noexcept { return value_; }
+    const_iterator &operator++() noexcept;
+    const_iterator operator++(int) noexcept {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator==(const const_iterator &other) const noexcept {
+      return container_ == other.container_ && value_ == other.value_;
+    }
+    bool operator!=(const const_iterator &other) const noexcept {
+      return !(*this == other);
+    }
+
+  private:
+    friend class RoaringBitmap;
+
+    /// At the first value of container c at or after position pos (an
+    /// array index, or a bit index in a bitmap), or its successors.
+    const_iterator(const RoaringBitmap *bitmap, std::size_t c,
+                   std::size_t pos) noexcept;
+
+    void settle(std::size_t pos) noexcept;
+
+    const RoaringBitmap *bitmap_ = nullptr;
+    std::size_t container_ = 0;
+    std::size_t index_ = 0; ///< array index, or bitmap word
+    std::uint64_t word_ = 0;
+    std::uint32_t value_ = 0;
+  };
+
+  RoaringBitmap() = default;
+
+  /**
+   * The set bits of a BitVector.
+   */
+  explicit RoaringBitmap(const BitVector &bv);
+
+  /**
+   * A BitVector of the given size with the values set. Values must be below
+   * size.
+   */
+  BitVector to_bitvector(std::size_t size) const;
+
+  /**
+   * Inserts x, returning whether it was absent.
+   */
+  bool add(std::uint32_t x);
+
+  /**
+   * Removes x, returning whether it was present.
+   */
+  bool remove(std::uint32_t x);
+
+  bool contains(std::uint32_t x) const noexcept;
+
+  /**
+   * Number of values.
+   */
+  std::size_t cardinality() const noexcept;
+  bool empty() const noexcept { return keys_.empty(); }
+  void clear() noexcept;
+
+  /**
+   * Heap bytes used by the containers.
+   */
+  std::size_t memory_bytes() const noexcept;
+
+  const_iterator begin() const noexcept { return {this, 0, 0}; }
+  const_iterator end() const noexcept { return {this, keys_.size(), 0}; }
+
+  /**
+   * Iterator to the first value >= x.
+   */
+  const_iterator lower_bound(std::uint32_t x) const noexcept;
+
+  RoaringBitmap &operator&=(const RoaringBitmap &other);
+  RoaringBitmap &operator|=(const RoaringBitmap &other);
+
+  friend RoaringBitmap operator&(const RoaringBitmap &x,
+                                 const RoaringBitmap &y);
+  friend RoaringBitmap operator|(const RoaringBitmap &x,
+                                 const RoaringBitmap &y);
+
+  /**
+   * |x & y| without materializing the intersection.
+   */
+  friend std::size_t popcount_and(const RoaringBitmap &x,
+                                  const RoaringBitmap &y) noexcept;
+
+  friend bool operator==(const RoaringBitmap &x,
+                         const RoaringBitmap &y) noexcept;
+  friend bool operator!=(const RoaringBitmap &x,
+                         const RoaringBitmap &y) noexcept {
+    return !(x == y);
+  }
+
+private:
+  /// The low 16 bits of one chunk's values: a sorted array, or a bitmap if
+  /// bits is non-empty.
+  struct Container {
+    std::vector<std::uint16_t> array;
+    std::vector<std::uint64_t> bits;
+    std::size_t cardinality = 0;
+
+    bool is_bitmap() const noexcept { return !bits.empty(); }
+    bool contains(std::uint16_t low) const noexcept;
+    bool add(std::uint16_t low);
+    bool remove(std::uint16_t low);
+
+    /// Picks the representation for the current cardinality.
+    void normalize();
+    void to_bitmap();
+    void to_array();
+
+    friend bool operator==(const Container &x, const Container &y) noexcept {
+      return x.cardinality == y.cardinality && x.array == y.array &&
+             x.bits == y.bits;
+    }
+  };
+
+  static Container intersect(const Container &x, const Container &y);
+  static Container unite(const Container &x, const Container &y);
+  static std::size_t intersect_count(const Container &x,
+                                     const Container &y) noexcept;
+
+  /// Index of the container for key, or keys_.size().
+  std::size_t find(std::uint16_t key) const noexcept;
+
+  std::vector<std::uint16_t> keys_;
+  std::vector<Container> containers_;
+};
+
+// ==============================
+// ======= Implementation =======
+// ==============================
+
+// =========== RoaringBitmap::Container ===========
+
+inline bool
+RoaringBitmap::Container::contains(std::uint16_t low) const noexcept {
+  if (is_bitmap()) {
+    return (bits[low / 64] >> (low % 64)) & 1;
+  }
+  return std::binary_search(array.begin(), array.end(), low);
+}
+
+inline bool RoaringBitmap::Container::add(std::uint16_t low) {
+  if (is_bitmap()) {
+    std::uint64_t &w = bits[low / 64];
+    std::uint64_t mask = std::uint64_t{1} << (low % 64);
+    if (w & mask) {
+      return false;
+    }
+    w |= mask;
+    ++cardinality;
+    return true;
+  }
+  auto it = std::lower_bound(array.begin(), array.end(), low);
+  if (it != array.end() && *it == low) {
+    return false;
+  }
+  array.insert(it, low);
+  ++cardinality;
+  normalize();
+  return true;
+}
+
+inline bool RoaringBitmap::Container::remove(std::uint16_t low) {
+  if (is_bitmap()) {
+    std::uint64_t &w = bits[low / 64];
+    std::uint64_t mask = std::uint64_t{1} << (low % 64);
+    if (!(w & mask)) {
+      return false;
+    }
+    w &= ~mask;
+    --cardinality;
+    normalize();
+    return true;
+  }
+  auto it = std::lower_bound(array.begin(), array.end(), low);
+  if (it == array.end() || *it != low) {
+    return false;
+  }
+  array.erase(it);
+  --cardinality;
+  return true;
+}
+
+inline void RoaringBitmap::Container::normalize() {
+  if (is_bitmap() && cardinality <= max_array_size) {
+    to_array();
+  } else if (!is_bitmap() && cardinality > max_array_size) {
+    to_bitmap();
+  }
+}
+
+inline void RoaringBitmap::Container::to_bitmap() {
+  bits.assign(bitmap_words, 0);
+  for (std::uint16_t low : array) {
+    bits[low / 64] |= std::uint64_t{1} << (low % 64);
+  }
+  array.clear();
+  array.shrink_to_fit();
+}
+
+inline void RoaringBitmap::Container::to_array() {
+  array.clear();
+  array.reserve(cardinality);
+  for (std::size_t w = 0; w < bitmap_words; ++w) {
+    for (std::uint64_t word = bits[w]; word; word &= word - 1) {
+      array.push_back(
+          static_cast<std::uint16_t>(64 * w + std::countr_zero(word)));
+    }
+  }
+  bits.clear();
+  bits.shrink_to_fit();
+}
+
+inline RoaringBitmap::Container
+RoaringBitmap::intersect(const Container &x, const Container &y) {
+  Container res;
+  if (x.is_bitmap() && y.is_bitmap()) {
+    res.bits = x.bits;
+    bitops::and_into(res.bits.data(), y.bits.data(), bitmap_words);
+    res.cardinality = bitops::popcount(res.bits.data(), bitmap_words);
+  } else if (x.is_bitmap() || y.is_bitmap()) {
+    const Container &array = x.is_bitmap() ? y : x;
+    const Container &bitmap = x.is_bitmap() ? x : y;
+    for (std::uint16_t low : array.array) {
+      if (bitmap.contains(low)) {
+        res.array.push_back(low);
+      }
+    }
+    res.cardinality = res.array.size();
+  } else {
+    std::set_intersection(x.array.begin(), x.array.end(), y.array.begin(),
+                          y.array.end(), std::back_inserter(res.array));
+    res.cardinality = res.array.size();
+  }
+  res.normalize();
+  return res;
+}
+
+inline RoaringBitmap::Container RoaringBitmap::unite(const Container &x,
+                                                     const Container &y) {
+  Container res;
+  if (!x.is_bitmap() && !y.is_bitmap() &&
+      x.cardinality + y.cardinality <= max_array_size) {
+    std::set_union(x.array.begin(), x.array.end(), y.array.begin(),
+                   y.array.end(), std::back_inserter(res.array));
+    res.cardinality = res.array.size();
+    return res;
+  }
+
+  if (x.is_bitmap()) {
+    res.bits = x.bits;
+  } else {
+    res.array = x.array;
+    res.cardinality = x.cardinality;
+    res.to_bitmap();
+  }
+  if (y.is_bitmap()) {
+    bitops::or_into(res.bits.data(), y.bits.data(), bitmap_words);
+  } else {
+    for (std::uint16_t low : y.array) {
+      res.bits[low / 64] |= std::uint64_t{1} << (low % 64);
+    }
+  }
+  res.cardinality = bitops::popcount(res.bits.data(), bitmap_words);
+  res.normalize();
+  return res;
+}
+
+inline std::size_t
+RoaringBitmap::intersect_count(const Container &x,
+                               const Container &y) noexcept {
+  if (x.is_bitmap() && y.is_bitmap()) {
+    return bitops::popcount_and(x.bits.data(), y.bits.data(), bitmap_words);
+  }
+  if (x.is_bitmap() || y.is_bitmap()) {
+    const Container &array = x.is_bitmap() ? y : x;
+    const Container &bitmap = x.is_bitmap() ? x : y;
+    std::size_t count = 0;
+    for (std::uint16_t low : array.array) {
+      count += bitmap.contains(low);
+    }
+    return count;
+  }
+  std::size_t count = 0;
+  auto i = x.array.begin(), j = y.array.begin();
+  while (i != x.array.end() && j != y.array.end()) {
+    if (*i < *j) {
+      ++i;
+    } else if (*j < *i) {
+      ++j;
+    } else {
+      ++count;
+      ++i;
+      ++j;
+    }
+  }
+  return count;
+}
+
+// =========== RoaringBitmap::const_iterator ===========
+
+inline RoaringBitmap::const_iterator::const_iterator(
+    const RoaringBitmap *bitmap, std::size_t c, std::size_t pos) noexcept
+    : bitmap_{bitmap}, container_{c} {
+  settle(pos);
+}
+
+inline void RoaringBitmap::const_iterator::settle(std::size_t pos) noexcept {
+  const auto &containers = bitmap_->containers_;
+  for (; container_ < containers.size(); ++container_, pos = 0) {
+    const Container &c = containers[container_];
+    std::uint32_t high = std::uint32_t{bitmap_->keys_[container_]} << 16;
+    if (!c.is_bitmap()) {
+      if (pos < c.array.size()) {
+        index_ = pos;
+        value_ = high | c.array[pos];
+        return;
+      }
+      continue;
+    }
+    index_ = pos / 64;
+    if (index_ >= bitmap_words) {
+      continue;
+    }
+    word_ = c.bits[index_] & (~std::uint64_t{0} << (pos % 64));
+    while (word_ == 0 && ++index_ < bitmap_words) {
+      word_ = c.bits[index_];
+    }
+    if (word_ != 0) {
+      value_ = high | static_cast<std::uint32_t>(64 * index_ +
+                                                 std::countr_zero(word_));
+      return;
+    }
+  }
+  value_ = 0;
+}
+
+inline RoaringBitmap::const_iterator &
+RoaringBitmap::const_iterator::operator++() noexcept {
+  const Container &c = bitmap_->containers_[container_];
+  if (c.is_bitmap()) {
+    std::size_t bit = 64 * index_ + std::countr_zero(word_) + 1;
+    settle(bit);
+  } else {
+    settle(index_ + 1);
+  }
+  return *this;
+}
+
+// =========== RoaringBitmap ===========
+
+inline RoaringBitmap::RoaringBitmap(const BitVector &bv) {
+  const std::uint64_t *words = bv.data();
+  std::size_t num_words = bv.num_words();
+  for (std::size_t w0 = 0; w0 < num_words; w0 += bitmap_words) {
+    std::size_t len = std::min(bitmap_words, num_words - w0);
+    std::size_t count = bitops::popcount(words + w0, len);
+    if (count == 0) {
+      continue;
+    }
+    Container c;
+    c.cardinality = count;
+    c.bits.assign(bitmap_words, 0);
+    std::copy(words + w0, words + w0 + len, c.bits.begin());
+    c.normalize();
+    keys_.push_back(static_cast<std::uint16_t>(w0 / bitmap_words));
+    containers_.push_back(std::move(c));
+  }
+}
+
+inline BitVector RoaringBitmap::to_bitvector(std::size_t size) const {
+  BitVector bv(size);
+  for (std::uint32_t x : *this) {
+    bv.set(x);
+  }
+  return bv;
+}
+
+inline std::size_t RoaringBitmap::find(std::uint16_t key) const noexcept {
+  auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+  return it != keys_.end() && *it == key
+             ? static_cast<std::size_t>(it - keys_.begin())
+             : keys_.size();
+}
+
+inline bool RoaringBitmap::add(std::uint32_t x) {
+  auto key = static_cast<std::uint16_t>(x >> 16);
+  auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+  auto c = it - keys_.begin();
+  if (it == keys_.end() || *it != key) {
+    keys_.insert(it, key);
+    containers_.insert(containers_.begin() + c, Container{});
+  }
+  return containers_[static_cast<std::size_t>(c)].add(
+      static_cast<std::uint16_t>(x));
+}
+
+inline bool RoaringBitmap::remove(std::uint32_t x) {
+  std::size_t c = find(static_cast<std::uint16_t>(x >> 16));
+  if (c == keys_.size() ||
+      !containers_[c].remove(static_cast<std::uint16_t>(x))) {
+    return false;
+  }
+  if (containers_[c].cardinality == 0) {
+    keys_.erase(keys_.begin() + static_cast<std::ptrdiff_t>(c));
+    containers_.erase(containers_.begin() + static_cast<std::ptrdiff_t>(c));
+  }
+  return true;
+}
+
+inline bool RoaringBitmap::contains(std::uint32_t x) const noexcept {
+  std::size_t c = find(static_cast<std::uint16_t>(x >> 16));
+  return c != keys_.size() &&
+         containers_[c].contains(static_cast<std::uint16_t>(x));
+}
+
+inline std::size_t RoaringBitmap::cardinality() const noexcept {
+  std::size_t count = 0;
+  for (const Container &c : containers_) {
+    count += c.cardinality;
+  }
+  return count;
+}
+
+inline void RoaringBitmap::clear() noexcept {
+  keys_.clear();
+  containers_.clear();
+}
+
+inline std::size_t RoaringBitmap::memory_bytes() const noexcept {
+  std::size_t bytes = keys_.capacity() * sizeof(std::uint16_t) +
+                      containers_.capacity() * sizeof(Container);
+  for (const Container &c : containers_) {
+    bytes += c.array.capacity() * sizeof(std::uint16_t) +
+             c.bits.capacity() * sizeof(std::uint64_t);
+  }
+  return bytes;
+}
+
+inline RoaringBitmap::const_iterator
+RoaringBitmap::lower_bound(std::uint32_t x) const noexcept {
+  auto key = static_cast<std::uint16_t>(x >> 16);
+  auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+  auto c = static_cast<std::size_t>(it - keys_.begin());
+  if (it == keys_.end() || *it != key) {
+    return {this, c, 0};
+  }
+  auto low = static_cast<std::uint16_t>(x);
+  const Container &container = containers_[c];
+  if (container.is_bitmap()) {
+    return {this, c, low};
+  }
+  return {this, c,
+          static_cast<std::size_t>(std::lower_bound(container.array.begin(),
+                                                    container.array.end(),
+                                                    low) -
+                                   container.array.begin())};
+}
+
+inline RoaringBitmap &RoaringBitmap::operator&=(const RoaringBitmap &other) {
+  *this = *this & other;
+  return *this;
+}
+
+inline RoaringBitmap &RoaringBitmap::operator|=(const RoaringBitmap &other) {
+  *this = *this | other;
+  return *this;
+}
+
+inline RoaringBitmap operator&(const RoaringBitmap &x,
+                               const RoaringBitmap &y) {
+  RoaringBitmap res;
+  std::size_t i = 0, j = 0;
+  while (i < x.keys_.size() && j < y.keys_.size()) {
+    if (x.keys_[i] < y.keys_[j]) {
+      ++i;
+    } else if (y.keys_[j] < x.keys_[i]) {
+      ++j;
+    } else {
+      auto c = RoaringBitmap::intersect(x.containers_[i], y.containers_[j]);
+      if (c.cardinality != 0) {
+        res.keys_.push_back(x.keys_[i]);
+        res.containers_.push_back(std::move(c));
+      }
+      ++i;
+      ++j;
+    }
+  }
+  return res;
+}
+
+inline RoaringBitmap operator|(const RoaringBitmap &x,
+                               const RoaringBitmap &y) {
+  RoaringBitmap res;
+  std::size_t i = 0, j = 0;
+  while (i < x.keys_.size() || j < y.keys_.size()) {
+    if (j == y.keys_.size() ||
+        (i < x.keys_.size() && x.keys_[i] < y.keys_[j])) {
+      res.keys_.push_back(x.keys_[i]);
+      res.containers_.push_back(x.containers_[i++]);
+    } else if (i == x.keys_.size() || y.keys_[j] < x.keys_[i]) {
+      res.keys_.push_back(y.keys_[j]);
+      res.containers_.push_back(y.containers_[j++]);
+    } else {
+      res.keys_.push_back(x.keys_[i]);
+      res.containers_.push_back(
+          RoaringBitmap::unite(x.containers_[i++], y.containers_[j++]));
+    }
+  }
+  return res;
+}
+
+inline std::size_t popcount_and(const RoaringBitmap &x,
+                                const RoaringBitmap &y) noexcept {
+  std::size_t count = 0;
+  std::size_t i = 0, j = 0;
+  while (i < x.keys_.size() && j < y.keys_.size()) {
+    if (x.keys_[i] < y.keys_[j]) {
+      ++i;
+    } else if (y.keys_[j] < x.keys_[i]) {
+      ++j;
+    } else {
+      count += RoaringBitmap::intersect_count(x.containers_[i++],
+                                              y.containers_[j++]);
+    }
+  }
+  return count;
+}
+
+inline bool operator==(const RoaringBitmap &x,
+                       const RoaringBitmap &y) noexcept {
+  return x.keys_ == y.keys_ && x.containers_ == y.containers_;
+}
+
+} // namespace utils
@@ -1,49 +1,69 @@
-/**
- * Segment Tree datastructure.
- * !!!
- * UNFINISHED
- * !!!
- */
+/**********************************************************************
+ * @brief Segment trees for range queries, with and without lazy range
+ *updates.
+ * @details SegmentTree does point updates and range queries for any
+ *associative combine function with an identity. LazySegmentTree adds range
+ *assign and range add through lazy propagation, and max_right for binary
+ *searching on prefixes. Its combine function comes from a monoid type (see
+ *the monoid namespace for sum, min and max).
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
 
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cstddef>
+#include <limits>
+#include <span>
 #include <vector>
 
 namespace utils {
 
 /**
  * A Segment Tree is an efficient data structure for performing range queries
- * (e.g. what is the min, max, mean etc. of the elements in range [l,r)) for a
+ * (e.g. what is the min, max, sum etc. of the elements in range [l,r)) for a
  * fixed size array. The time complexity for both point updates and range
  * queries is O(log n).
  *
  * Normally, Segment Trees are implemented using binary trees, but here we use
  * an array and bitwise operations, which is more efficient in terms of both
  * memory and speed.
+ *
+ * Fn must be associative, and identity must satisfy
+ * combine(identity, x) == combine(x, identity) == x.
  */
 template <typename T, typename Fn>
 class SegmentTree {
 
   Fn combine;
-  std::size_t n; // size of original array
+  std::size_t n = 0; // size of original array
+  T identity{};
   std::vector<T> arr;
 
 public:
   SegmentTree() = default;
 
-  SegmentTree(const std::vector<T> &arr)
-      : n{arr.size()}, arr{std::vector<T>(2 * n)} {
+  /**
+   * Builds the tree over values in O(n).
+   */
+  explicit SegmentTree(std::span<const T> values, const T &identity = T{})
+      : n{values.size()}, identity{identity}, arr(2 * n, identity) {
 
-    for (int i = 0; i < n; ++i) {
-      arr[i + n] = arr[i];
-    }
+    std::copy(values.begin(), values.end(), arr.begin() + n);
 
-    for (int i = n - 1; i > 0; --i) {
+    for (std::size_t i = n - 1; i > 0 && i < n; --i) {
       arr[i] = combine(arr[i << 1], arr[i << 1 | 1]);
     }
   }
 
+  explicit SegmentTree(const std::vector<T> &values, const T &identity = T{})
+      : SegmentTree(std::span<const T>(values), identity) {}
+
+  std::size_t size() const { return n; }
+
   /**
    * Updates an index of the original array, according to the combine function.
    */
@@ -59,10 +79,11 @@ public:
 
   /**
    * Performs a query on the index range [l, r) of the original array,
-   * according to the combine function.
+   * according to the combine function. Returns the identity for an empty
+   * range.
    */
-  T query(std::size_t l, std::size_t r) {
-    T resl, resr;
+  T query(std::size_t l, std::size_t r) const {
+    T resl = identity, resr = identity;
     for (l += n, r += n; l < r; l >>= 1, r >>= 1) {
       if (l & 1) {
         resl = combine(resl, arr[l]);
@@ -70,11 +91,316 @@ public:
       }
       if (r & 1) {
         --r;
-        resl = combine(arr[r], resr);
+        resr = combine(arr[r], resr);
       }
     }
     return combine(resl, resr);
   }
 };
 
+/**
+ * Monoids for LazySegmentTree. Besides identity() and combine(), each one says
+ * how a range update changes the aggregate of len elements:
+ * repeat(x, len) is the aggregate of len copies of x, and
+ * add(aggregate, delta, len) is the aggregate after adding delta to each.
+ */
+namespace monoid {
+
+template <typename T>
+struct Sum {
+  using value_type = T;
+  static T identity() { return T{}; }
+  static T combine(const T &a, const T &b) { return a + b; }
+  static T repeat(const T &x, std::size_t len) {
+    return x * static_cast<T>(len);
+  }
+  static T add(const T &aggregate, const T &delta, std::size_t len) {
+    return aggregate + delta * static_cast<T>(len);
+  }
+};
+
+template <typename T>
+struct Min {
+  using value_type = T;
+  static T identity() { return std::numeric_limits<T>::max(); }
+  static T combine(const T &a, const T &b) { return std::min(a, b); }
+  static T repeat(const T &x, std::size_t) { return x; }
+  static T add(const T &aggregate, const T &delta, std::size_t) {
+    return aggregate + delta;
+  }
+};
+
+template <typename T>
+struct Max {
+  using value_type = T;
+  static T identity() { return std::numeric_limits<T>::lowest(); }
+  static T combine(const T &a, const T &b) { return std::max(a, b); }
+  static T repeat(const T &x, std::size_t) { return x; }
+  static T add(const T &aggregate, const T &delta, std::size_t) {
+    return aggregate + delta;
+  }
+};
+
+} // namespace monoid
+
+/**
+ * A segment tree over a monoid with range assign and range add, both
+ * O(log n), through lazy propagation. Pending updates on a node are an
+ * optional assignment followed by an add, which composes with any later
+ * update. Adds use operator+ with T{} as zero.
+ *
+ * The tree is stored as a perfect binary tree in one array, with the root at
+ * index 1 and the leaves at [capacity, 2 * capacity).
+ */
+template <typename Monoid>
+class LazySegmentTree {
+
+public:
+  using value_type = typename Monoid::value_type;
+  using T = value_type;
+
+  LazySegmentTree() = default;
+
+  /**
+   * n copies of value.
+   */
+  LazySegmentTree(std::size_t n, const T &value)
+      : LazySegmentTree(std::vector<T>(n, value)) {}
+
+  /**
+   * Builds the tree over values in O(n).
+   */
+  explicit LazySegmentTree(std::span<const T> values);
+
+  explicit LazySegmentTree(const std::vector<T> &values)
+      : LazySegmentTree(std::span<const T>(values)) {}
+
+  std::size_t size() const { return n; }
+
+  T get(std::size_t i);
+  void set(std::size_t i, const T &value);
+
+  /**
+   * The combination of the elements in [l, r), or the identity if l == r.
+   */
+  T query(std::size_t l, std::size_t r);
+
+  /**
+   * The combination of all elements. O(1).
+   */
+  T all() const { return data[1]; }
+
+  /**
+   * Sets every element in [l, r) to value.
+   */
+  void assign(std::size_t l, std::size_t r, const T &value) {
+    apply(l, r, update{true, value, T{}});
+  }
+
+  /**
+   * Adds delta to every element in [l, r).
+   */
+  void add(std::size_t l, std::size_t r, const T &delta) {
+    apply(l, r, update{false, T{}, delta});
+  }
+
+  /**
+   * The largest r such that pred(query(l, r)) holds, by descending the tree
+   * in O(log n). pred must hold for the identity, and be monotone: once it
+   * fails for some r it fails for every larger r.
+   */
+  template <typename Pred>
+  std::size_t max_right(std::size_t l, Pred pred);
+
+private:
+  struct update {
+    bool assign; // if set, replace by value before adding delta
+    T value;
+    T delta;
+  };
+
+  std::size_t n = 0;        // number of elements
+  std::size_t capacity = 0; // n rounded up to a power of two
+  int levels = 0;           // log2(capacity)
+  std::vector<T> data;      // aggregates, 2 * capacity
+  std::vector<update> lazy; // pending updates of the inner nodes, capacity
+
+  std::size_t length(std::size_t k) const {
+    return capacity >> (std::bit_width(k) - 1);
+  }
+
+  void pull(std::size_t k) {
+    data[k] = Monoid::combine(data[2 * k], data[2 * k + 1]);
+  }
+
+  void apply_node(std::size_t k, const update &u);
+
+  void push(std::size_t k) {
+    apply_node(2 * k, lazy[k]);
+    apply_node(2 * k + 1, lazy[k]);
+    lazy[k] = update{false, T{}, T{}};
+  }
+
+  // Pushes the pending updates on the paths to the leaves l and r - 1, so
+  // that the nodes covering [l, r) are up to date.
+  void push_bounds(std::size_t l, std::size_t r) {
+    for (int i = levels; i > 0; --i) {
+      if (((l >> i) << i) != l) {
+        push(l >> i);
+      }
+      if (((r >> i) << i) != r) {
+        push((r - 1) >> i);
+      }
+    }
+  }
+
+  void apply(std::size_t l, std::size_t r, const update &u);
+};
+
+// ==============
+// IMPLEMENTATION
+// ==============
+
+template <typename Monoid>
+LazySegmentTree<Monoid>::LazySegmentTree(std::span<const T> values)
+    : n{values.size()}, capacity{std::bit_ceil(std::max<std::size_t>(n, 1))},
+      levels{std::countr_zero(capacity)},
+      data(2 * capacity, Monoid::identity()),
+      lazy(capacity, update{false, T{}, T{}}) {
+  std::copy(values.begin(), values.end(), data.begin() + capacity);
+  for (std::size_t k = capacity - 1; k > 0; --k) {
+    pull(k);
+  }
+}
+
+template <typename Monoid>
+void LazySegmentTree<Monoid>::apply_node(std::size_t k, const update &u) {
+  if (u.assign) {
+    data[k] = Monoid::add(Monoid::repeat(u.value, length(k)), u.delta,
+                          length(k));
+  } else {
+    data[k] = Monoid::add(data[k], u.delta, length(k));
+  }
+
+  if (k < capacity) {
+    update &pending = lazy[k];
+    if (u.assign) {
+      pending = u;
+    } else {
+      pending.delta = pending.delta + u.delta;
+    }
+  }
+}
+
+template <typename Monoid>
+auto LazySegmentTree<Monoid>::get(std::size_t i) -> T {
+  i += capacity;
+  for (int level = levels; level > 0; --level) {
+    push(i >> level);
+  }
+  return data[i];
+}
+
+template <typename Monoid>
+void LazySegmentTree<Monoid>::set(std::size_t i, const T &value) {
+  i += capacity;
+  for (int level = levels; level > 0; --level) {
+    push(i >> level);
+  }
+  data[i] = value;
+  for (int level = 1; level <= levels; ++level) {
+    pull(i >> level);
+  }
+}
+
+template <typename Monoid>
+auto LazySegmentTree<Monoid>::query(std::size_t l, std::size_t r) -> T {
+  if (l >= r) {
+    return Monoid::identity();
+  }
+
+  l += capacity;
+  r += capacity;
+  push_bounds(l, r);
+
+  T left = Monoid::identity(), right = Monoid::identity();
+  for (; l < r; l >>= 1, r >>= 1) {
+    if (l & 1) {
+      left = Monoid::combine(left, data[l++]);
+    }
+    if (r & 1) {
+      right = Monoid::combine(data[--r], right);
+    }
+  }
+  return Monoid::combine(left, right);
+}
+
+template <typename Monoid>
+void LazySegmentTree<Monoid>::apply(std::size_t l, std::size_t r,
+                                    const update &u) {
+  if (l >= r) {
+    return;
+  }
+
+  l += capacity;
+  r += capacity;
+  push_bounds(l, r);
+
+  for (std::size_t a = l, b = r; a < b; a >>= 1, b >>= 1) {
+    if (a & 1) {
+      apply_node(a++, u);
+    }
+    if (b & 1) {
+      apply_node(--b, u);
+    }
+  }
+
+  for (int i = 1; i <= levels; ++i) {
+    if (((l >> i) << i) != l) {
+      pull(l >> i);
+    }
+    if (((r >> i) << i) != r) {
+      pull((r - 1) >> i);
+    }
+  }
+}
+
+template <typename Monoid>
+template <typename Pred>
+std::size_t LazySegmentTree<Monoid>::max_right(std::size_t l, Pred pred) {
+  if (l >= n) {
+    return n;
+  }
+
+  l += capacity;
+  for (int i = levels; i > 0; --i) {
+    push(l >> i);
+  }
+
+  // Climb while the whole node starting at l still satisfies pred, then
+  // descend into the first node that does not.
+  T acc = Monoid::identity();
+  do {
+    while (l % 2 == 0) {
+      l >>= 1;
+    }
+    if (!pred(Monoid::combine(acc, data[l]))) {
+      while (l < capacity) {
+        push(l);
+        l = 2 * l;
+        T next = Monoid::combine(acc, data[l]);
+        if (pred(next)) {
+          acc = next;
+          ++l;
+        }
+      }
+      return std::min(l - capacity, n);
+    }
+    acc = Monoid::combine(acc, data[l]);
+    ++l;
+  } while ((l & (~l + 1)) != l);
+
+  return n;
+}
+
 } // namespace utils
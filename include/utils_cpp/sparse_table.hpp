@@ -0,0 +1,70 @@
+/**********************************************************************
+ * @brief Sparse table for O(1) range queries over static data.
+ * @details For an idempotent function such as min, max, gcd, bitwise and
+ *or bitwise or, any range is covered by two overlapping power-of-two
+ *blocks, so a query is two lookups and one call. Building takes
+ *O(n log n) time and memory.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace utils {
+
+/**
+ * Fn must be associative and idempotent (fn(x, x) == x). Level k of the table
+ * holds fn over [i, i + 2^k) for every i where that block fits, and all
+ * levels are stored back to back in one array of n per level.
+ */
+template <typename T, typename Fn>
+class SparseTable {
+
+  Fn combine;
+  std::size_t n = 0;
+  std::vector<T> table;
+
+public:
+  SparseTable() = default;
+
+  explicit SparseTable(std::span<const T> values)
+      : n{values.size()},
+        table(n * static_cast<std::size_t>(std::bit_width(n))) {
+    std::copy(values.begin(), values.end(), table.begin());
+
+    std::size_t levels = static_cast<std::size_t>(std::bit_width(n));
+    for (std::size_t k = 1; k < levels; ++k) {
+      std::size_t half = std::size_t{1} << (k - 1);
+      const T *prev = table.data() + (k - 1) * n;
+      T *row = table.data() + k * n;
+      // A plain loop over two shifted rows, which vectorizes when combine
+      // inlines to a min, max or bitwise op.
+      for (std::size_t i = 0; i + 2 * half <= n; ++i) {
+        row[i] = combine(prev[i], prev[i + half]);
+      }
+    }
+  }
+
+  explicit SparseTable(const std::vector<T> &values)
+      : SparseTable(std::span<const T>(values)) {}
+
+  std::size_t size() const { return n; }
+
+  /**
+   * fn over the elements in [l, r), which must be non-empty.
+   */
+  T query(std::size_t l, std::size_t r) const {
+    std::size_t k = static_cast<std::size_t>(std::bit_width(r - l)) - 1;
+    const T *row = table.data() + k * n;
+    return combine(row[l], row[r - (std::size_t{1} << k)]);
+  }
+};
+
+} // namespace utils
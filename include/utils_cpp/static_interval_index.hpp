@@ -0,0 +1,163 @@
+/**********************************************************************
+ * @brief A read-only interval index in contiguous arrays.
+ * @details The intervals are sorted by their low end and laid out as an
+ *implicit binary search tree in Eytzinger (breadth-first) order: node k has
+ *children 2k and 2k + 1, so the top levels of the tree share a few cache
+ *lines and no pointers are chased. Each node also stores the largest high
+ *end in its subtree, which prunes subtrees that end before the query. Built
+ *once in O(n log n); a query costs O(log n + k) for k reported intervals.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace utils {
+
+/**
+ * StaticIntervalIndex answers stabbing and overlap queries over a fixed set
+ * of closed intervals [low, high]. Unlike IntervalTree it cannot be modified
+ * after build(), but it reports every matching interval, not just whether
+ * one exists. Results are appended in increasing order of (low, high).
+ */
+template <typename T, typename Compare = std::less<T>>
+class StaticIntervalIndex {
+public:
+  using interval_type = std::pair<T, T>;
+
+  StaticIntervalIndex() = default;
+
+  explicit StaticIntervalIndex(std::vector<interval_type> intervals) {
+    build(std::move(intervals));
+  }
+
+  /**
+   * Replaces the contents with the given intervals. Duplicates are kept.
+   */
+  void build(std::vector<interval_type> intervals);
+
+  /**
+   * Appends every interval that contains point to out.
+   */
+  void stabbing_query(const T &point, std::vector<interval_type> &out) const;
+
+  /**
+   * Appends every interval that overlaps [low, high] to out.
+   */
+  void overlapping(const T &low, const T &high,
+                   std::vector<interval_type> &out) const;
+
+  /**
+   * Whether any interval contains point.
+   */
+  bool contains(const T &point) const;
+
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+private:
+  /// Fills the Eytzinger slots from the sorted intervals, in order.
+  std::size_t place(const std::vector<interval_type> &sorted, std::size_t i,
+                    std::size_t k);
+
+  /// In-order walk of the subtree at k, reporting intervals that overlap
+  /// [low, high]. If out is null, stops at the first match.
+  bool visit(std::size_t k, const T &low, const T &high,
+             std::vector<interval_type> *out) const;
+
+  // Slot 0 is unused so that the children of k are 2k and 2k + 1.
+  std::vector<T> lows_;
+  std::vector<T> highs_;
+  std::vector<T> max_high_; ///< largest high in the subtree of each slot
+  std::size_t size_ = 0;
+  Compare cmp;
+};
+
+// ==============
+// IMPLEMENTATION
+// ==============
+
+template <typename T, typename Compare>
+void StaticIntervalIndex<T, Compare>::build(std::vector<interval_type> intervals) {
+  std::sort(intervals.begin(), intervals.end(),
+            [this](const interval_type &a, const interval_type &b) {
+              return cmp(a.first, b.first) ||
+                     (!cmp(b.first, a.first) && cmp(a.second, b.second));
+            });
+
+  size_ = intervals.size();
+  lows_.assign(size_ + 1, T{});
+  highs_.assign(size_ + 1, T{});
+  place(intervals, 0, 1);
+
+  max_high_ = highs_;
+  for (std::size_t k = size_; k > 1; --k) {
+    T &parent = max_high_[k / 2];
+    if (cmp(parent, max_high_[k])) {
+      parent = max_high_[k];
+    }
+  }
+}
+
+template <typename T, typename Compare>
+std::size_t
+StaticIntervalIndex<T, Compare>::place(const std::vector<interval_type> &sorted,
+                                       std::size_t i, std::size_t k) {
+  if (k > size_) {
+    return i;
+  }
+  i = place(sorted, i, 2 * k);
+  lows_[k] = sorted[i].first;
+  highs_[k] = sorted[i].second;
+  return place(sorted, i + 1, 2 * k + 1);
+}
+
+template <typename T, typename Compare>
+bool StaticIntervalIndex<T, Compare>::visit(
+    std::size_t k, const T &low, const T &high,
+    std::vector<interval_type> *out) const {
+  // Nothing in this subtree reaches low.
+  if (k > size_ || cmp(max_high_[k], low)) {
+    return false;
+  }
+  if (visit(2 * k, low, high, out) && !out) {
+    return true;
+  }
+  // This node and its right subtree start after high.
+  if (cmp(high, lows_[k])) {
+    return false;
+  }
+  if (!cmp(highs_[k], low)) {
+    if (!out) {
+      return true;
+    }
+    out->emplace_back(lows_[k], highs_[k]);
+  }
+  return visit(2 * k + 1, low, high, out);
+}
+
+template <typename T, typename Compare>
+void StaticIntervalIndex<T, Compare>::stabbing_query(
+    const T &point, std::vector<interval_type> &out) const {
+  visit(1, point, point, &out);
+}
+
+template <typename T, typename Compare>
+void StaticIntervalIndex<T, Compare>::overlapping(
+    const T &low, const T &high, std::vector<interval_type> &out) const {
+  visit(1, low, high, &out);
+}
+
+template <typename T, typename Compare>
+bool StaticIntervalIndex<T, Compare>::contains(const T &point) const {
+  return visit(1, point, point, nullptr);
+}
+
+} // namespace utils
@@ -0,0 +1,210 @@
+/**********************************************************************
+ * @brief Hot-path counters for pathfinding and Json parsing.
+ * @details Compiled in only when UTILS_CPP_ENABLE_STATS is defined (the
+ *UTILS_CPP_ENABLE_STATS CMake option defines it for every target); otherwise
+ *UTILS_CPP_STATS_ADD expands to an unevaluated expression and the
+ *instrumented code compiles as if it were not there. Each thread counts into
+ *its own block of relaxed atomics, which only that thread writes, so counting
+ *is a load, an add and a store. stats::snapshot() sums the blocks of every
+ *thread, live or finished. Define the macro the same way in every translation
+ *unit of a program.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#ifdef UTILS_CPP_ENABLE_STATS
+#define UTILS_CPP_STATS_ADD(name, n)                                           \
+  ::utils::stats::add(::utils::stats::counter::name, (n))
+#else
+// Unevaluated, so variables used only for counting do not trigger warnings.
+#define UTILS_CPP_STATS_ADD(name, n) ((void)sizeof(n))
+#endif
+
+namespace utils {
+namespace stats {
+
+#ifdef UTILS_CPP_ENABLE_STATS
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+enum class counter : std::size_t {
+  /// Vertices popped and expanded by dijkstra, astar and their variants.
+  vertices_settled,
+  /// Out-edges of settled vertices looked at.
+  edges_scanned,
+  /// Out-edges that improved a tentative distance.
+  edges_relaxed,
+  /// Entries pushed onto a priority queue (binary heap, radix heap or 0-1
+  /// deque).
+  heap_pushes,
+  /// Popped entries skipped because a shorter distance was already found.
+  stale_pops,
+  /// Input bytes consumed by JsonParser::parse.
+  json_bytes_parsed,
+  /// Values (scalars, arrays and objects) parsed.
+  json_values,
+  /// Heap allocations made while parsing: object members, array buffer
+  /// growth and strings too long for the small string buffer.
+  json_allocations,
+  num_counters
+};
+
+inline constexpr std::size_t num_counters =
+    static_cast<std::size_t>(counter::num_counters);
+
+inline constexpr std::array<std::string_view, num_counters> counter_names = {
+    "vertices_settled", "edges_scanned",     "edges_relaxed",
+    "heap_pushes",      "stale_pops",        "json_bytes_parsed",
+    "json_values",      "json_allocations"};
+
+/**
+ * Values of every counter at some point.
+ */
+struct Snapshot {
+  std::array<std::uint64_t, num_counters> values{};
+
+  std::uint64_t operator[](counter c) const noexcept {
+    return values[static_cast<std::size_t>(c)];
+  }
+
+  /// The counts between 'earlier' and this snapshot.
+  Snapshot operator-(const Snapshot &earlier) const noexcept {
+    Snapshot diff;
+    for (std::size_t i = 0; i < num_counters; ++i) {
+      diff.values[i] = values[i] - earlier.values[i];
+    }
+    return diff;
+  }
+
+  /// One "utils_cpp_<name> <value>" line per counter, the Prometheus text
+  /// exposition format.
+  friend std::ostream &operator<<(std::ostream &os, const Snapshot &s) {
+    for (std::size_t i = 0; i < num_counters; ++i) {
+      os << "utils_cpp_" << counter_names[i] << ' ' << s.values[i] << '\n';
+    }
+    return os;
+  }
+};
+
+namespace detail {
+
+struct block;
+
+struct registry {
+  std::mutex mutex;
+  std::vector<block *> live;
+  // Counts of threads that exited.
+  Snapshot finished;
+};
+
+inline registry &global_registry() {
+  static registry r;
+  return r;
+}
+
+struct block {
+  std::array<std::atomic<std::uint64_t>, num_counters> values{};
+
+  block() {
+    auto &r = global_registry();
+    std::scoped_lock<std::mutex> lock(r.mutex);
+    r.live.push_back(this);
+  }
+
+  ~block() {
+    auto &r = global_registry();
+    std::scoped_lock<std::mutex> lock(r.mutex);
+    for (std::size_t i = 0; i < num_counters; ++i) {
+      r.finished.values[i] += values[i].load(std::memory_order_relaxed);
+    }
+    std::erase(r.live, this);
+  }
+
+  Snapshot read() const noexcept {
+    Snapshot s;
+    for (std::size_t i = 0; i < num_counters; ++i) {
+      s.values[i] = values[i].load(std::memory_order_relaxed);
+    }
+    return s;
+  }
+};
+
+inline block &local_block() {
+  thread_local block b;
+  return b;
+}
+
+} // namespace detail
+
+/**
+ * Adds n to counter c of the calling thread. Use UTILS_CPP_STATS_ADD in
+ * instrumented code, so that it compiles away when stats are disabled.
+ */
+inline void add(counter c, std::uint64_t n) noexcept {
+  auto &value = detail::local_block().values[static_cast<std::size_t>(c)];
+  value.store(value.load(std::memory_order_relaxed) + n,
+              std::memory_order_relaxed);
+}
+
+/**
+ * The counts of the calling thread only, e.g. to attribute the work of one
+ * call by subtracting a snapshot taken before it.
+ */
+inline Snapshot local_snapshot() {
+  if constexpr (!enabled) {
+    return {};
+  }
+  return detail::local_block().read();
+}
+
+/**
+ * The counts of all threads, including those that have exited. Counters of
+ * running threads are read while they may be changing, so the result is
+ * only a consistent total once those threads are idle.
+ */
+inline Snapshot snapshot() {
+  if constexpr (!enabled) {
+    return {};
+  }
+  auto &r = detail::global_registry();
+  std::scoped_lock<std::mutex> lock(r.mutex);
+  Snapshot total = r.finished;
+  for (const detail::block *b : r.live) {
+    Snapshot s = b->read();
+    for (std::size_t i = 0; i < num_counters; ++i) {
+      total.values[i] += s.values[i];
+    }
+  }
+  return total;
+}
+
+/**
+ * Zeroes every counter. Counts added concurrently by other threads may be
+ * lost or may survive the reset.
+ */
+inline void reset() {
+  auto &r = detail::global_registry();
+  std::scoped_lock<std::mutex> lock(r.mutex);
+  r.finished = Snapshot{};
+  for (detail::block *b : r.live) {
+    for (auto &value : b->values) {
+      value.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+} // namespace stats
+} // namespace utils
@@ -1,6 +1,11 @@
 /**********************************************************************
  * @brief Utilities for string (and other) parsing.
- * @details
+ * @details split() copies every token into a std::string. For large inputs,
+ *split_view() and split_any_view() yield std::string_views into the input
+ *without allocating, DelimiterSet finds the next of several delimiter
+ *characters 16 bytes at a time with SSE2, and parse_number() converts a
+ *token with std::from_chars, reporting failure with an empty optional
+ *instead of an exception.
  * @author Sam Tonetto
  * @copyright GNU Public License
  * @date 2023
@@ -8,10 +13,25 @@
 
 #pragma once
 
-#include <sstream>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace utils {
 
 /**
@@ -36,51 +56,281 @@ std::string join(const std::vector<std::string> &strings,
  * whitespace is not allowed, string must be fully consumed, no extraneous
  * leading zeros.
  */
-bool convertible_to_double(const std::string &s);
+bool convertible_to_double(std::string_view s);
 
 /**
  * Check if a string is convertible to a long long. No whitespace is allowed,
  * no decimal points (unless decimal part is zero), and no extraneous leading
  * zeros.
  */
-bool convertible_to_long_long(const std::string &s);
+bool convertible_to_long_long(std::string_view s);
+
+/**
+ * Parses the whole of s as a number of type T with std::from_chars: decimal
+ * integers, or floating point numbers in fixed or scientific notation
+ * (including "inf" and "nan"). Returns std::nullopt if s is empty, has
+ * leading or trailing characters that are not part of the number (including
+ * whitespace and a leading '+'), or is out of the range of T. Never throws
+ * and never allocates.
+ */
+template <typename T>
+  requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+std::optional<T> parse_number(std::string_view s) noexcept;
+
+/**
+ * A set of delimiter characters, with a search for the first of them that
+ * compares 16 bytes at a time with SSE2 when there are at most
+ * max_simd_delimiters distinct characters, and looks bytes up in a table
+ * otherwise.
+ */
+class DelimiterSet {
+public:
+  static constexpr std::size_t max_simd_delimiters = 8;
+
+  /**
+   * @throws std::invalid_argument if delimiters is empty.
+   */
+  explicit DelimiterSet(std::string_view delimiters);
+
+  bool contains(char c) const noexcept {
+    return table_[static_cast<unsigned char>(c)];
+  }
+
+  /**
+   * The position of the first delimiter in s at or after pos, or
+   * std::string_view::npos.
+   */
+  std::size_t find(std::string_view s, std::size_t pos = 0) const noexcept;
+
+  /// find() with the table lookup only.
+  std::size_t find_portable(std::string_view s,
+                            std::size_t pos = 0) const noexcept;
+
+  /**
+   * The position of the first character in s at or after pos that is not a
+   * delimiter, or std::string_view::npos.
+   */
+  std::size_t find_not(std::string_view s, std::size_t pos = 0) const noexcept;
+
+private:
+  std::array<bool, 256> table_{};
+  std::array<char, max_simd_delimiters> chars_{};
+  std::size_t num_chars_ = 0;
+};
+
+/**
+ * A lazy forward range of the tokens of a string, as std::string_views into
+ * it. Made by split_view() and split_any_view(); the string (and the
+ * DelimiterSet, for split_any_view) must outlive the view and its
+ * iterators, but the iterators do not refer to the view itself.
+ */
+class SplitView : public std::ranges::view_interface<SplitView> {
+public:
+  class iterator {
+  public:
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    iterator() = default;
+
+    std::string_view operator*() const noexcept { return token_; }
+    const std::string_view *operator->() const noexcept { return &token_; }
+
+    iterator &operator++() {
+      next();
+      return *this;
+    }
+    iterator operator++(int) {
+      auto copy = *this;
+      next();
+      return copy;
+    }
+
+    bool operator==(const iterator &other) const noexcept {
+      return done_ == other.done_ &&
+             (done_ || token_.data() == other.token_.data());
+    }
+
+  private:
+    friend class SplitView;
+
+    explicit iterator(const SplitView &view)
+        : rest_{view.strv_}, delimiter_{view.delimiter_}, set_{view.set_},
+          done_{false} {
+      next();
+    }
+
+    void next();
+
+    // The part of the string after the current token.
+    std::string_view rest_;
+    std::string_view token_;
+    std::string_view delimiter_;
+    const DelimiterSet *set_ = nullptr;
+    bool done_ = true;
+  };
+
+  SplitView() = default;
+
+  iterator begin() const { return iterator(*this); }
+  iterator end() const noexcept { return iterator(); }
+
+private:
+  friend SplitView split_view(std::string_view, std::string_view);
+  friend SplitView split_any_view(std::string_view, const DelimiterSet &);
+
+  std::string_view strv_;
+  std::string_view delimiter_;
+  // Set when tokens are separated by runs of any of these characters.
+  const DelimiterSet *set_ = nullptr;
+};
+
+/**
+ * split() without copying: the same tokens, as a lazy range of
+ * std::string_views into strv.
+ */
+SplitView split_view(std::string_view strv, std::string_view delimiter);
+
+/**
+ * The non-empty runs of characters in strv that are not in delimiters, as a
+ * lazy range of std::string_views, e.g. the fields of an edgelist line with
+ * DelimiterSet(" \t\r\n"). delimiters must outlive the range.
+ */
+SplitView split_any_view(std::string_view strv, const DelimiterSet &delimiters);
 
 // ==============================
 // ======= Implementation =======
 // ==============================
 
-inline std::vector<std::string> split(std::string_view strv,
-                                      std::string_view delimiter = " ") {
+namespace detail {
 
-  if (delimiter.empty()) {
-    throw std::invalid_argument("Delimiter cannot be an empty string.");
-  }
+inline const DelimiterSet &whitespace_delimiters() {
+  static const DelimiterSet set(" \t\n\r\f\v");
+  return set;
+}
 
-  std::vector<std::string> result;
-  size_t pos;
+} // namespace detail
 
-  if (delimiter.size() == 1 && std::isspace(delimiter[0])) {
+inline DelimiterSet::DelimiterSet(std::string_view delimiters) {
+  if (delimiters.empty()) {
+    throw std::invalid_argument("Delimiter set cannot be empty.");
+  }
+  for (char c : delimiters) {
+    auto &in_set = table_[static_cast<unsigned char>(c)];
+    if (!in_set && num_chars_ < max_simd_delimiters) {
+      chars_[num_chars_] = c;
+    }
+    num_chars_ += !in_set;
+    in_set = true;
+  }
+}
 
-    std::size_t start = 0;
-    while ((pos = strv.find_first_not_of(" \t\n\r\f\v", start)) !=
-           std::string_view::npos) {
-      start = strv.find_first_of(" \t\n\r\f\v", pos);
-      result.emplace_back(strv.substr(pos, start - pos));
+inline std::size_t DelimiterSet::find(std::string_view s,
+                                      std::size_t pos) const noexcept {
+#if defined(__SSE2__)
+  if (num_chars_ <= max_simd_delimiters) {
+    __m128i needles[max_simd_delimiters];
+    for (std::size_t i = 0; i < num_chars_; ++i) {
+      needles[i] = _mm_set1_epi8(chars_[i]);
     }
+    for (; pos + 16 <= s.size(); pos += 16) {
+      const __m128i block = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(s.data() + pos));
+      __m128i hits = _mm_cmpeq_epi8(block, needles[0]);
+      for (std::size_t i = 1; i < num_chars_; ++i) {
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+      }
+      if (const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits))) {
+        return pos + static_cast<std::size_t>(std::countr_zero(mask));
+      }
+    }
+  }
+#endif
+  return find_portable(s, pos);
+}
 
-  } else {
+inline std::size_t
+DelimiterSet::find_portable(std::string_view s,
+                            std::size_t pos) const noexcept {
+  for (; pos < s.size(); ++pos) {
+    if (contains(s[pos])) {
+      return pos;
+    }
+  }
+  return std::string_view::npos;
+}
 
-    while ((pos = strv.find(delimiter)) != std::string_view::npos) {
-      result.emplace_back(strv.substr(0, pos));
-      strv.remove_prefix(pos + delimiter.size()); // remove delimiter itself
+inline std::size_t DelimiterSet::find_not(std::string_view s,
+                                          std::size_t pos) const noexcept {
+  for (; pos < s.size(); ++pos) {
+    if (!contains(s[pos])) {
+      return pos;
     }
+  }
+  return std::string_view::npos;
+}
 
-    // add what remains
-    if (!strv.empty()) {
-      result.emplace_back(strv);
+inline void SplitView::iterator::next() {
+  if (set_) {
+    const std::size_t start = set_->find_not(rest_);
+    if (start == std::string_view::npos) {
+      done_ = true;
+      return;
     }
+    const std::size_t end = set_->find(rest_, start);
+    token_ = rest_.substr(start, end - start);
+    rest_.remove_prefix(end == std::string_view::npos ? rest_.size() : end);
+    return;
+  }
+
+  // Like split(), a trailing delimiter does not end an empty token.
+  if (rest_.empty()) {
+    done_ = true;
+    return;
+  }
+  const std::size_t pos = rest_.find(delimiter_);
+  if (pos == std::string_view::npos) {
+    token_ = rest_;
+    rest_ = rest_.substr(rest_.size());
+  } else {
+    token_ = rest_.substr(0, pos);
+    rest_.remove_prefix(pos + delimiter_.size());
+  }
+}
+
+inline SplitView split_view(std::string_view strv,
+                            std::string_view delimiter = " ") {
+
+  if (delimiter.empty()) {
+    throw std::invalid_argument("Delimiter cannot be an empty string.");
   }
 
+  SplitView view;
+  view.strv_ = strv;
+  view.delimiter_ = delimiter;
+  if (delimiter.size() == 1 &&
+      std::isspace(static_cast<unsigned char>(delimiter[0]))) {
+    view.set_ = &detail::whitespace_delimiters();
+  }
+  return view;
+}
+
+inline SplitView split_any_view(std::string_view strv,
+                                const DelimiterSet &delimiters) {
+  SplitView view;
+  view.strv_ = strv;
+  view.set_ = &delimiters;
+  return view;
+}
+
+inline std::vector<std::string> split(std::string_view strv,
+                                      std::string_view delimiter = " ") {
+
+  std::vector<std::string> result;
+  for (std::string_view token : split_view(strv, delimiter)) {
+    result.emplace_back(token);
+  }
   return result;
 }
 
@@ -123,28 +373,59 @@ inline std::string join(const std::vector<std::string> &strings,
   return result;
 }
 
-inline bool convertible_to_double(const std::string &s) {
-  // no extraneous leading zeros
-  if ((s.size() > 1 && s[0] == '0' && s[1] != '.') ||
-      (s.size() > 2 && s[0] == '-' && s[1] == '0' && s[1] != '.'))
-    return false;
+template <typename T>
+  requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+std::optional<T> parse_number(std::string_view s) noexcept {
+  T value;
+  const char *end = s.data() + s.size();
+  auto [ptr, ec] = std::from_chars(s.data(), end, value);
+  if (ec != std::errc() || ptr != end || s.empty()) {
+    return std::nullopt;
+  }
+  return value;
+}
 
-  std::istringstream iss(s);
-  double num;
-  iss >> std::noskipws >> num;
-  return iss.eof() && !iss.fail();
+namespace detail {
+
+// The checks convertible_to_double and convertible_to_long_long make on top
+// of parse_number: an optional '+' is allowed (as by istream), but no second
+// sign, no extraneous leading zeros, and no "inf" or "nan".
+inline std::optional<std::string_view> strict_number_digits(std::string_view s,
+                                                            bool integer) {
+  if (!s.empty() && s[0] == '+') {
+    s.remove_prefix(1);
+    if (!s.empty() && s[0] == '-') {
+      return std::nullopt;
+    }
+  }
+  std::string_view digits = s;
+  if (!digits.empty() && digits[0] == '-') {
+    digits.remove_prefix(1);
+  }
+  if (digits.empty() ||
+      (digits[0] != '.' && (digits[0] < '0' || digits[0] > '9'))) {
+    return std::nullopt;
+  }
+  if (digits.size() > 1 && digits[0] == '0' && (integer || digits[1] != '.')) {
+    return std::nullopt;
+  }
+  return s;
 }
 
-inline bool convertible_to_long_long(const std::string &s) {
+} // namespace detail
 
-  if ((s.size() > 1 && s[0] == '0') ||
-      (s.size() > 2 && s[0] == '-' && s[1] == '0'))
-    return false;
+inline bool convertible_to_double(std::string_view s) {
+  auto number = detail::strict_number_digits(s, false);
+  return number && parse_number<double>(*number).has_value();
+}
 
-  std::istringstream iss(s);
-  long long num;
-  iss >> std::noskipws >> num;
-  return iss.eof() && !iss.fail();
+inline bool convertible_to_long_long(std::string_view s) {
+  auto number = detail::strict_number_digits(s, true);
+  return number && parse_number<long long>(*number).has_value();
 }
 
 } // namespace utils
+
+template <>
+inline constexpr bool std::ranges::enable_borrowed_range<utils::SplitView> =
+    true;
@@ -3,11 +3,14 @@
 
 #include "utils_cpp/graph/algorithms.hpp"
 #include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
 
 #include <boost/graph/graphviz.hpp>
 #include <boost/property_map/dynamic_property_map.hpp>
 
+#include <algorithm>
 #include <iostream>
+#include <random>
 #include <sstream>
 #include <string>
 
@@ -118,3 +121,334 @@ TEST_CASE("graph coloring") {
 
   CHECK(color_map == correct);
 }
+
+TEST_CASE("blocked floyd warshall matches bfs") {
+  parallel::thread_pool pool(2);
+
+  // Connected graphs with 49, 44 and 37 vertices, so most of the block sizes
+  // below leave a partial last tile.
+  for (auto gb : {gl::ibm_hex(2, 3), gl::grid(4, 11), gl::ring(37)}) {
+    auto &g = gb.graph;
+    std::size_t n = boost::num_vertices(g);
+
+    // Reference distances from one BFS per source, independent of the
+    // kernel under test.
+    std::vector<std::vector<std::size_t>> reference;
+    for (std::size_t s = 0; s < n; ++s) {
+      reference.push_back(gl::bfs_distances(g, s));
+    }
+
+    for (std::size_t block_size : {1, 3, 5, 7, 64}) {
+      auto serial = gl::floyd_warshall_matrix(g, nullptr, block_size);
+      auto par = gl::floyd_warshall_matrix(g, &pool, block_size);
+      for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+          CHECK(static_cast<std::size_t>(serial(i, j)) == reference[i][j]);
+          CHECK(static_cast<std::size_t>(par(i, j)) == reference[i][j]);
+        }
+      }
+    }
+
+    auto wrapped = gl::floyd_warshall(g);
+    gl::BitAdjmat adjmat(g);
+    auto from_adjmat =
+        gl::floyd_warshall_matrix<std::uint16_t>(adjmat, &pool, 5);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        CHECK(static_cast<std::size_t>(wrapped[i][j]) == reference[i][j]);
+        CHECK(from_adjmat(i, j) == reference[i][j]);
+      }
+    }
+  }
+}
+
+TEST_CASE("blocked floyd warshall on matrix views") {
+  gl::DiGraph g;
+  for (std::size_t v = 0; v < 10; ++v) {
+    boost::add_edge(v, (v + 1) % 11, g);
+    boost::add_edge(v, (v * 3) % 11, g);
+  }
+  constexpr std::size_t n = 11;
+  constexpr int inf = std::numeric_limits<int>::max();
+  auto expected = gl::floyd_warshall_matrix(g, nullptr, 4);
+
+  // The initial distances in the block at (2, 3) of a larger matrix.
+  Matrix<int> big(n + 5, n + 7, -1);
+  auto block = big.block(2, 3, n, n);
+  block.fill(inf);
+  for (std::size_t v = 0; v < n; ++v) {
+    block(v, v) = 0;
+  }
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    if (boost::source(e, g) != boost::target(e, g)) {
+      block(boost::source(e, g), boost::target(e, g)) = 1;
+    }
+  }
+  Matrix<int> initial = block.to_matrix();
+
+  parallel::thread_pool pool(2);
+  gl::detail::blocked_floyd_warshall(block, &pool, 4);
+  CHECK(block.to_matrix() == expected);
+  CHECK(big(0, 0) == -1);
+  CHECK(big(n + 4, n + 6) == -1);
+
+  // A transposed view has non-adjacent row elements, and gives the distances
+  // of the reversed graph.
+  Matrix<int> transposed = initial;
+  gl::detail::blocked_floyd_warshall(transposed.view().transposed(), nullptr,
+                                     3);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      CHECK(transposed(i, j) == expected(i, j));
+    }
+  }
+
+  CHECK_THROWS_AS(
+      gl::detail::blocked_floyd_warshall(big.view(), nullptr, 4),
+      std::runtime_error);
+}
+
+TEST_CASE("blocked floyd warshall directed unreachable") {
+  gl::DiGraph g;
+  boost::add_edge(0, 1, g);
+  boost::add_edge(1, 2, g);
+  boost::add_edge(3, 4, g);
+
+  auto d = gl::floyd_warshall_matrix<std::size_t>(g, nullptr, 2);
+  std::size_t inf = std::numeric_limits<std::size_t>::max();
+  CHECK(d(0, 2) == 2);
+  CHECK(d(2, 0) == inf);
+  CHECK(d(0, 4) == inf);
+  CHECK(d(3, 4) == 1);
+}
+
+TEST_CASE("bit-parallel all pairs bfs") {
+  parallel::thread_pool pool(2);
+
+  for (auto gb : {gl::ibm_hex(3, 3), gl::grid(9, 9), gl::chimera(2, 2, 4)}) {
+    auto &g = gb.graph;
+    std::size_t n = boost::num_vertices(g);
+    auto reference = gl::floyd_warshall(g);
+
+    auto serial = gl::all_pairs_bfs(g);
+    auto par = gl::all_pairs_bfs(gl::BitAdjmat(g), &pool);
+    CHECK(serial == par);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = 0; j < n; ++j) {
+        CHECK(serial(i, j) == reference[i][j]);
+      }
+    }
+  }
+
+  SUBCASE("disconnected") {
+    gl::BitAdjmat adjmat(70);
+    adjmat.set(0, 69);
+    adjmat.set(69, 5);
+    auto d = gl::all_pairs_bfs(adjmat);
+    CHECK(d(0, 5) == 2);
+    CHECK(d(5, 0) == 2);
+    CHECK(d(0, 1) == gl::unreachable_distance);
+    CHECK(d(1, 1) == 0);
+  }
+}
+
+TEST_CASE("graph coloring into a dense vertex map") {
+  auto gb = gl::ibm_hex(2, 2);
+
+  auto expected =
+      gl::graph_coloring(gb.graph, gl::graph_coloring_strategy::LARGEST_FIRST);
+
+  gl::DenseVertexMap<std::size_t> colors(gb.graph);
+  gl::graph_coloring(gb.graph, gl::graph_coloring_strategy::LARGEST_FIRST,
+                     colors);
+
+  for (auto v : boost::make_iterator_range(boost::vertices(gb.graph))) {
+    CHECK(colors[v] == expected.at(v));
+  }
+}
+
+namespace {
+
+template <typename GraphType>
+bool is_proper_coloring(const GraphType &g,
+                        const std::vector<std::size_t> &colors) {
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    auto u = boost::source(e, g);
+    auto v = boost::target(e, g);
+    if (u != v && colors[u] == colors[v]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t num_colors(const std::vector<std::size_t> &colors) {
+  return colors.empty() ? 0
+                        : *std::max_element(colors.begin(), colors.end()) + 1;
+}
+
+} // namespace
+
+TEST_CASE("smallest last graph coloring") {
+
+  SUBCASE("grid") {
+    auto [graph, props] = gl::grid(4, 5);
+    auto colors = gl::graph_coloring(
+        gl::CsrGraph(graph), gl::graph_coloring_strategy::SMALLEST_LAST);
+    CHECK(is_proper_coloring(graph, colors));
+    CHECK(num_colors(colors) <= 3); // the degeneracy of a grid is 2
+
+    auto color_map =
+        gl::graph_coloring(graph, gl::graph_coloring_strategy::SMALLEST_LAST);
+    for (std::size_t v = 0; v < colors.size(); ++v) {
+      CHECK(color_map.at(v) == colors[v]);
+    }
+  }
+
+  SUBCASE("trees use two colors") {
+    auto [tree, props] = gl::path(10);
+    boost::add_edge(3, 10, tree);
+    boost::add_edge(10, 11, tree);
+    auto colors = gl::graph_coloring(
+        gl::CsrGraph(tree), gl::graph_coloring_strategy::SMALLEST_LAST);
+    CHECK(is_proper_coloring(tree, colors));
+    CHECK(num_colors(colors) == 2);
+  }
+
+  SUBCASE("complete graph") {
+    auto [graph, props] = gl::complete(6);
+    auto colors = gl::graph_coloring(
+        gl::CsrGraph(graph), gl::graph_coloring_strategy::SMALLEST_LAST);
+    CHECK(is_proper_coloring(graph, colors));
+    CHECK(num_colors(colors) == 6);
+  }
+}
+
+TEST_CASE("parallel speculative graph coloring") {
+  auto [graph, props] = gl::random(400, 0.05, 1);
+  gl::CsrGraph csr(graph);
+
+  std::size_t max_degree = 0;
+  for (std::size_t v = 0; v < csr.num_vertices(); ++v) {
+    max_degree = std::max(max_degree, csr.degree(v));
+  }
+
+  parallel::thread_pool pool(3);
+
+  for (auto strategy : {gl::graph_coloring_strategy::LARGEST_FIRST,
+                        gl::graph_coloring_strategy::SMALLEST_LAST}) {
+    auto sequential = gl::graph_coloring(csr, strategy);
+    auto colors = gl::graph_coloring(csr, strategy, &pool);
+    REQUIRE(colors.size() == csr.num_vertices());
+    CHECK(is_proper_coloring(graph, sequential));
+    CHECK(is_proper_coloring(graph, colors));
+    CHECK(num_colors(colors) <= max_degree + 1);
+  }
+
+  gl::Graph empty;
+  CHECK(gl::graph_coloring(gl::CsrGraph(empty),
+                           gl::graph_coloring_strategy::SMALLEST_LAST, &pool)
+            .empty());
+}
+
+TEST_CASE("bit-sliced coloring verification") {
+  auto [graph, props] = gl::random(300, 0.05, 2);
+  gl::BitAdjmat mat(graph);
+  auto colors = gl::graph_coloring(gl::CsrGraph(graph),
+                                   gl::graph_coloring_strategy::SMALLEST_LAST);
+  parallel::thread_pool pool(3);
+
+  gl::ColorClasses classes(colors);
+  CHECK(classes.num_colors() == num_colors(colors));
+  CHECK(classes.colors() == colors);
+  for (std::size_t c = 0; c < classes.num_colors(); ++c) {
+    for (std::size_t v = 0; v < colors.size(); ++v) {
+      CHECK(classes.color_class(c).get(v) == (colors[v] == c));
+    }
+  }
+
+  CHECK(gl::verify_coloring(mat, colors));
+  CHECK(gl::verify_coloring(mat, colors, &pool));
+  CHECK(gl::coloring_conflicts(mat, classes, &pool).empty());
+
+  SUBCASE("conflicts are found") {
+    auto e = *boost::edges(graph).first;
+    auto u = boost::source(e, graph);
+    auto v = boost::target(e, graph);
+    colors[v] = colors[u];
+    gl::ColorClasses bad(colors);
+    CHECK(bad.conflicts(mat, u) > 0);
+    CHECK(!gl::verify_coloring(mat, bad));
+    CHECK(!gl::verify_coloring(mat, bad, &pool));
+
+    std::vector<std::size_t> expected;
+    for (std::size_t w = 0; w < colors.size(); ++w) {
+      for (auto nb : boost::make_iterator_range(boost::adjacent_vertices(
+               w, graph))) {
+        if (nb != w && colors[nb] == colors[w]) {
+          expected.push_back(w);
+          break;
+        }
+      }
+    }
+    CHECK(gl::coloring_conflicts(mat, bad) == expected);
+    CHECK(gl::coloring_conflicts(mat, bad, &pool) == expected);
+  }
+
+  SUBCASE("self-loops are ignored") {
+    mat.set(5, 5);
+    CHECK(gl::verify_coloring(mat, classes, &pool));
+  }
+
+  SUBCASE("size mismatch") {
+    gl::BitAdjmat small(10);
+    CHECK_THROWS_AS(gl::verify_coloring(small, classes),
+                    std::invalid_argument);
+  }
+}
+
+TEST_CASE("recoloring after edge insertion") {
+  auto [graph, props] = gl::grid(6, 6);
+  gl::BitAdjmat mat(graph);
+  auto colors = gl::graph_coloring(gl::CsrGraph(graph),
+                                   gl::graph_coloring_strategy::LARGEST_FIRST);
+  gl::ColorClasses classes(colors);
+  REQUIRE(classes.num_colors() == 2);
+
+  // Same color: one endpoint moves. 0 and 2 are two apart in the first row,
+  // so any 2-coloring of the grid gives them the same color.
+  REQUIRE(classes.color(0) == classes.color(2));
+  auto moved = gl::recolor_after_edge_insert(mat, classes, 0, 2);
+  REQUIRE(moved);
+  CHECK((*moved == 0 || *moved == 2));
+  CHECK(mat.get(0, 2));
+  CHECK(classes.num_colors() == 3);
+  CHECK(gl::verify_coloring(mat, classes));
+
+  // Different colors: nothing moves.
+  REQUIRE(classes.color(4) != classes.color(15));
+  CHECK(!gl::recolor_after_edge_insert(mat, classes, 4, 15));
+  CHECK(mat.get(15, 4));
+
+  // Many insertions keep the coloring proper and the classes in sync.
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<std::size_t> pick(0, 35);
+  for (int i = 0; i < 200; ++i) {
+    auto u = pick(rng);
+    auto v = pick(rng);
+    gl::recolor_after_edge_insert(mat, classes, u, v);
+    boost::add_edge(u, v, graph);
+  }
+  CHECK(is_proper_coloring(graph, classes.colors()));
+  CHECK(gl::verify_coloring(mat, classes));
+  CHECK(gl::ColorClasses(classes.colors()).num_colors() <=
+        classes.num_colors());
+  for (std::size_t c = 0; c < classes.num_colors(); ++c) {
+    for (std::size_t v = 0; v < 36; ++v) {
+      CHECK(classes.color_class(c).get(v) == (classes.color(v) == c));
+    }
+  }
+
+  CHECK_THROWS_AS(gl::recolor_after_edge_insert(mat, classes, 0, 36),
+                  std::out_of_range);
+}
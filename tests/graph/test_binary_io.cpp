@@ -0,0 +1,140 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/graph/binary_io.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace utils;
+
+TEST_CASE("save and load a GraphBundle") {
+
+  auto gb = gl::grid(4, 3);
+  gb.props.graph["name"] = "grid";
+  gb.props.graph["removed_edges"] =
+      std::vector<std::vector<double>>{{0, 1}, {2, 3}};
+  gb.props.vertex["position"].make_columnar(12);
+  gl::VertexMap<double> height;
+  for (std::size_t v = 0; v < 12; v += 2) {
+    height[v] = 0.5 * v;
+  }
+  gb.props.vertex["height"] = height;
+  gl::EdgeMap<double> weight;
+  for (auto e : boost::make_iterator_range(boost::edges(gb.graph))) {
+    weight[e] = boost::source(e, gb.graph) + 10.0 * boost::target(e, gb.graph);
+  }
+  gb.props.edge["weight"] = weight;
+
+  gl::save_binary(gb, "_test_graph.bin");
+  auto loaded = gl::load_binary("_test_graph.bin");
+
+  SUBCASE("graph") {
+    gl::CsrGraph<> csr(gb.graph);
+    CHECK(loaded.graph.is_view());
+    CHECK(!loaded.graph.is_directed());
+    CHECK(loaded.graph.num_vertices() == 12);
+    CHECK(loaded.graph.num_edges() == csr.num_edges());
+    CHECK(std::ranges::equal(loaded.graph.targets(), csr.targets()));
+    CHECK(std::ranges::equal(loaded.graph.edge_ids(), csr.edge_ids()));
+    CHECK(gl::bfs_distances(loaded.graph, 0) == gl::bfs_distances(csr, 0));
+  }
+
+  SUBCASE("properties") {
+    CHECK(loaded.graph_props["name"] == "grid");
+    CHECK(loaded.graph_props["num_vertices"] == 12.0);
+    CHECK(loaded.graph_props["removed_edges"] ==
+          std::vector<std::vector<double>>{{0, 1}, {2, 3}});
+
+    const auto &position = loaded.vertex_props.at("position");
+    CHECK(position.is_vector());
+    CHECK(position.size() == 12);
+    CHECK(std::ranges::equal(position.vector(5), std::vector<double>{2, 1}));
+
+    const auto &h = loaded.vertex_props.at("height");
+    CHECK(!h.is_vector());
+    CHECK(h.scalar(4) == 2.0);
+    CHECK(h.scalar(5) == 0.0); // missing values are stored as 0
+
+    const auto &w = loaded.edge_props.at("weight");
+    for (std::size_t u = 0; u < 12; ++u) {
+      auto neighbors = loaded.graph.neighbors(u);
+      auto ids = loaded.graph.edge_ids(u);
+      for (std::size_t i = 0; i < neighbors.size(); ++i) {
+        auto [a, b] = std::minmax(u, neighbors[i]);
+        CHECK(w.scalar(ids[i]) == a + 10.0 * b);
+      }
+    }
+  }
+
+  SUBCASE("back to a bundle") {
+    gl::GraphBundle copy = loaded.to_bundle();
+    CHECK(boost::num_edges(copy.graph) == boost::num_edges(gb.graph));
+    for (auto e : boost::make_iterator_range(boost::edges(gb.graph))) {
+      CHECK(boost::edge(boost::source(e, gb.graph), boost::target(e, gb.graph),
+                        copy.graph)
+                .second);
+    }
+    CHECK(copy.props.vertex["position"] ==
+          gb.props.vertex["position"].to_map<std::vector<double>>());
+    gl::EdgeMap<double> copied_weight = copy.props.edge["weight"];
+    CHECK(copied_weight.size() == weight.size());
+    for (const auto &[e, w] : weight) {
+      CHECK(copied_weight.at(e) == w);
+    }
+  }
+
+  SUBCASE("the mapping outlives the BinaryGraph") {
+    gl::CsrGraph<> g = loaded.graph;
+    loaded = {};
+    CHECK(g.num_vertices() == 12);
+    CHECK(gl::bfs_distances(g, 0)[11] == 5);
+  }
+
+  std::remove("_test_graph.bin");
+}
+
+TEST_CASE("save and load a weighted CsrGraph") {
+
+  std::vector<std::pair<int, int>> edges = {{0, 1}, {1, 2}, {2, 0}, {2, 3}};
+  std::vector<double> weights = {1.5, 2.0, 0.25, 4.0};
+  gl::CsrGraph<double> g(4, edges, weights, true);
+
+  gl::GraphPropMap props;
+  props["name"] = "small";
+  gl::save_binary(g, "_test_csr.bin", props);
+
+  auto loaded = gl::load_binary<double>("_test_csr.bin");
+  CHECK(loaded.graph.is_directed());
+  CHECK(loaded.graph.is_weighted());
+  CHECK(loaded.graph.max_weight() == 4.0);
+  CHECK(loaded.graph_props["name"] == "small");
+  CHECK(gl::dijkstra_distances(loaded.graph, 0) ==
+        gl::dijkstra_distances(g, 0));
+
+  CHECK_THROWS_AS(gl::load_binary<float>("_test_csr.bin"), std::runtime_error);
+  std::remove("_test_csr.bin");
+}
+
+TEST_CASE("load_binary rejects bad files") {
+
+  {
+    std::ofstream os("_test_bad.bin", std::ios::binary);
+    os << "not a graph at all";
+  }
+  CHECK_THROWS_AS(gl::load_binary("_test_bad.bin"), std::runtime_error);
+
+  gl::save_binary(gl::grid(3, 3), "_test_bad.bin");
+  {
+    std::ifstream is("_test_bad.bin", std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(is)), {});
+    std::ofstream os("_test_bad.bin", std::ios::binary);
+    os << contents.substr(0, contents.size() / 2);
+  }
+  CHECK_THROWS_AS(gl::load_binary("_test_bad.bin"), std::runtime_error);
+
+  std::remove("_test_bad.bin");
+  CHECK_THROWS_AS(gl::load_binary("_test_bad.bin"), std::runtime_error);
+}
@@ -1,11 +1,18 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
+#include <numeric>
+#include <random>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "utils_cpp/graph/bitadjmat.hpp"
+#include "utils_cpp/graph/conversions.hpp"
 #include "utils_cpp/graph/library.hpp"
 
 using namespace utils;
@@ -313,3 +320,317 @@ TEST_CASE("bug on row 31") {
     CHECK(x != 31);
   }
 }
+
+namespace {
+gl::BitAdjmat naive_matmul(const gl::BitAdjmat &a, const gl::BitAdjmat &b) {
+  std::size_t n = a.num_vertices();
+  gl::BitAdjmat result(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t k = 0; k < n; ++k) {
+      bool v = false;
+      for (std::size_t j = 0; j < n && !v; ++j) {
+        v = a.get(i, j) && b.get(j, k);
+      }
+      if (v) {
+        result.matrix(i, k / gl::BitAdjmat::N) |= 1ULL
+                                                   << (k % gl::BitAdjmat::N);
+      }
+    }
+  }
+  return result;
+}
+} // namespace
+
+TEST_CASE("matmul") {
+  parallel::thread_pool pool(2);
+
+  SUBCASE("path graph squared connects vertices at distance 2") {
+    auto [g, props] = gl::path(5);
+    gl::BitAdjmat a(g);
+    auto a2 = a.matmul(a);
+    CHECK(a2.get(0, 2));
+    CHECK(a2.get(0, 0));
+    CHECK(!a2.get(0, 1));
+    CHECK(!a2.get(0, 3));
+    CHECK(a2 == naive_matmul(a, a));
+  }
+
+  // Sparse inputs use the set-bit path, dense inputs Four Russians.
+  for (std::size_t n : {1, 63, 64, 65, 130, 300}) {
+    for (unsigned density : {2u, 50u}) {
+      std::mt19937 rng(n + density);
+      gl::BitAdjmat a(n), b(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = i; j < n; ++j) {
+          if (rng() % 100 < density) {
+            a.set(i, j);
+          }
+          if (rng() % 100 < density) {
+            b.set(i, j);
+          }
+        }
+      }
+      auto expected = naive_matmul(a, b);
+      CHECK(a.matmul(b) == expected);
+      CHECK(a.matmul(b, &pool) == expected);
+    }
+  }
+
+  CHECK_THROWS_AS(gl::BitAdjmat(3).matmul(gl::BitAdjmat(4)),
+                  std::invalid_argument);
+}
+
+TEST_CASE("bulk bitwise operations") {
+  auto [g, props] = gl::grid(3, 3);
+  gl::BitAdjmat a(g);
+  std::size_t n = a.num_vertices();
+
+  CHECK(a.count_ones() == 2 * boost::num_edges(g));
+
+  SUBCASE("toggle does not set padding bits") {
+    gl::BitAdjmat t = a;
+    t.toggle();
+    CHECK(t.count_ones() == n * n - a.count_ones());
+    t.toggle();
+    CHECK(t == a);
+  }
+
+  SUBCASE("rows are aligned and padded with zeros") {
+    gl::BitAdjmat t = ~a;
+    for (std::size_t i = 0; i < n; ++i) {
+      auto row = t[i];
+      CHECK(reinterpret_cast<std::uintptr_t>(row.data()) % 64 == 0);
+      CHECK(row.num_words() % 8 == 0);
+      CHECK((row.data()[0] >> n) == 0);
+      for (std::size_t w = 1; w < row.num_words(); ++w) {
+        CHECK(row.data()[w] == 0);
+      }
+    }
+  }
+
+  SUBCASE("common neighbors") {
+    // In the 3x3 grid, corners 0 and 8 share no neighbours, 0 and 4 share 1
+    // and 3.
+    CHECK(gl::popcount_and(a[0], a[8]) == 0);
+    CHECK(gl::popcount_and(a[0], a[4]) == 2);
+    CHECK(gl::popcount_andnot(a[4], a[0]) == 2);
+  }
+
+  SUBCASE("andnot") {
+    gl::BitAdjmat b = a;
+    b.andnot_assign(a);
+    CHECK(b.count_ones() == 0);
+    CHECK((a ^ a).count_ones() == 0);
+    CHECK((a | a) == a);
+    CHECK((a & ~a).count_ones() == 0);
+  }
+}
+
+TEST_CASE("bulk decoding of rows and edges") {
+  std::mt19937 rng(11);
+  for (std::size_t n : {1, 5, 64, 130, 300}) {
+    std::bernoulli_distribution coin(n < 100 ? 0.5 : 0.1);
+    gl::BitAdjmat mat(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = i; j < n; ++j) {
+        if (coin(rng)) {
+          mat.set(i, j);
+        }
+      }
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+      std::vector<std::uint32_t> expected;
+      for (auto nb : mat[i]) {
+        expected.push_back(static_cast<std::uint32_t>(nb));
+      }
+      std::vector<std::uint32_t> buf(expected.size());
+      CHECK(mat[i].decode_into(buf) == expected.size());
+      CHECK(buf == expected);
+    }
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> expected, edges;
+    for (auto [i, j] : mat.edge_range()) {
+      expected.emplace_back(static_cast<std::uint32_t>(i),
+                            static_cast<std::uint32_t>(j));
+    }
+    mat.decode_edges(edges);
+    CHECK(edges == expected);
+  }
+}
+
+TEST_CASE("triangles, common neighbours and maximal cliques") {
+  SUBCASE("small graph") {
+    // Two triangles 0-1-2 and 1-2-3 sharing the edge 1-2, plus a pendant
+    // vertex 4 on 3 and an isolated vertex 5.
+    gl::BitAdjmat mat(6);
+    for (auto [i, j] : std::vector<std::pair<std::size_t, std::size_t>>{
+             {0, 1}, {0, 2}, {1, 2}, {1, 3}, {2, 3}, {3, 4}}) {
+      mat.set(i, j);
+    }
+
+    CHECK(mat.triangle_count() == 2);
+    CHECK(mat.common_neighbors_count(1, 2) == 2);
+    CHECK(mat.common_neighbors_count(0, 3) == 2);
+    CHECK(mat.common_neighbors_count(0, 4) == 0);
+    CHECK(mat.edge_common_neighbors() ==
+          std::vector<std::size_t>{1, 1, 2, 1, 1, 0});
+
+    using cliques_t = std::vector<std::vector<std::size_t>>;
+    CHECK(mat.maximal_cliques() ==
+          cliques_t{{0, 1, 2}, {1, 2, 3}, {3, 4}, {5}});
+    CHECK(mat.maximal_cliques(3) == cliques_t{{0, 1, 2}, {1, 2, 3}});
+
+    // Self-loops do not change anything.
+    mat.set(1, 1);
+    CHECK(mat.triangle_count() == 2);
+    CHECK(mat.common_neighbors_count(1, 2) == 2);
+    CHECK(mat.maximal_cliques(3) == cliques_t{{0, 1, 2}, {1, 2, 3}});
+  }
+
+  SUBCASE("random graph against brute force") {
+    std::mt19937 rng(5);
+    std::bernoulli_distribution coin(0.3);
+    std::size_t n = 150;
+    gl::BitAdjmat mat(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = i + 1; j < n; ++j) {
+        if (coin(rng)) {
+          mat.set(i, j);
+        }
+      }
+    }
+
+    std::size_t triangles = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t j = i + 1; j < n; ++j) {
+        for (std::size_t k = j + 1; k < n; ++k) {
+          triangles += mat.get(i, j) && mat.get(j, k) && mat.get(i, k);
+        }
+      }
+    }
+
+    parallel::thread_pool pool(4);
+    CHECK(mat.triangle_count() == triangles);
+    CHECK(mat.triangle_count(&pool) == triangles);
+
+    auto counts = mat.edge_common_neighbors(&pool);
+    std::size_t e = 0;
+    for (auto [i, j] : mat.edge_range()) {
+      std::size_t common = 0;
+      for (std::size_t k = 0; k < n; ++k) {
+        common += mat.get(i, k) && mat.get(j, k);
+      }
+      REQUIRE(e < counts.size());
+      CHECK(counts[e++] == common);
+    }
+    CHECK(e == counts.size());
+
+    auto cliques = mat.maximal_cliques(3);
+    CHECK(mat.maximal_cliques(3, &pool) == cliques);
+    for (const auto &clique : cliques) {
+      for (std::size_t a = 0; a < clique.size(); ++a) {
+        for (std::size_t b = a + 1; b < clique.size(); ++b) {
+          CHECK(mat.get(clique[a], clique[b]));
+        }
+      }
+      // No vertex extends the clique.
+      for (std::size_t v = 0; v < n; ++v) {
+        bool extends = true;
+        for (std::size_t u : clique) {
+          extends = extends && u != v && mat.get(u, v);
+        }
+        CHECK_FALSE(extends);
+      }
+    }
+  }
+}
+
+TEST_CASE("bulk conversions") {
+
+  auto g = gl::random(150, 0.1, 7).graph;
+  gl::BitAdjmat reference(boost::num_vertices(g));
+  for (auto [ei, end] = boost::edges(g); ei != end; ++ei) {
+    reference.set(boost::source(*ei, g), boost::target(*ei, g));
+  }
+
+  parallel::thread_pool pool(4);
+  CHECK(gl::BitAdjmat(g) == reference);
+  CHECK(gl::BitAdjmat(g, &pool) == reference);
+  CHECK(gl::to_bitadjmat(g, &pool) == reference);
+
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  for (auto [ei, end] = boost::edges(g); ei != end; ++ei) {
+    edges.emplace_back(boost::source(*ei, g), boost::target(*ei, g));
+  }
+  CHECK(gl::BitAdjmat(boost::num_vertices(g), edges, &pool) == reference);
+  edges.emplace_back(0, 150);
+  CHECK_THROWS_AS(gl::BitAdjmat(150, edges), std::out_of_range);
+
+  auto h = reference.to_graph();
+  CHECK(boost::num_vertices(h) == boost::num_vertices(g));
+  CHECK(boost::num_edges(h) == boost::num_edges(g));
+  CHECK(gl::BitAdjmat(h) == reference);
+
+  // Permuting the matrix matches relabelling the graph.
+  std::vector<std::size_t> perm(150);
+  std::iota(perm.begin(), perm.end(), 0);
+  std::shuffle(perm.begin(), perm.end(), std::mt19937{3});
+  gl::BitAdjmat permuted = reference;
+  permuted.permute(perm);
+  for (auto [ei, end] = boost::edges(g); ei != end; ++ei) {
+    CHECK(permuted.get(perm[boost::source(*ei, g)], perm[boost::target(*ei, g)]));
+  }
+  CHECK(permuted.num_edges() == reference.num_edges());
+}
+
+TEST_CASE("npy and npz round trips") {
+  std::mt19937 rng(11);
+  gl::BitAdjmat mat(77);
+  for (int k = 0; k < 400; ++k) {
+    mat.set(rng() % 77, rng() % 77);
+  }
+
+  std::string filename = "temporary_bitadjmat.npy";
+  gl::save_npy(filename, mat);
+  auto array = map_npy(filename);
+  CHECK(array.descr() == "|b1");
+  CHECK(array.shape() == std::vector<std::size_t>{77, 77});
+  CHECK(gl::bitadjmat_from_npy(array) == mat);
+
+  gl::save_npy(filename, mat, true);
+  array = map_npy(filename);
+  CHECK(array.descr() == "|u1");
+  CHECK(array.shape() == std::vector<std::size_t>{77, 10});
+  // Bit j of a row is bit j % 8 of byte j / 8, as np.packbits with
+  // bitorder='little' stores it.
+  auto bytes = array.values<std::uint8_t>();
+  for (std::size_t j = 0; j < 77; ++j) {
+    CHECK(((bytes[5 * 10 + j / 8] >> (j % 8)) & 1) == mat.get(5, j));
+  }
+  CHECK(gl::bitadjmat_from_npy(array) == mat);
+
+  // Only symmetric matrices are undirected graphs.
+  std::vector<std::uint8_t> directed = {0, 1, 0, 0};
+  NpyWriter<std::uint8_t> out(filename, {2, 1});
+  out.write(std::span<const std::uint8_t>(directed.data(), 2));
+  out.close();
+  CHECK_THROWS_AS(gl::bitadjmat_from_npy(map_npy(filename)),
+                  std::runtime_error);
+  save_npy(filename, directed);
+  CHECK_THROWS_AS(gl::bitadjmat_from_npy(map_npy(filename)),
+                  std::runtime_error);
+  std::remove(filename.c_str());
+
+  filename = "temporary_bitadjmat.npz";
+  {
+    NpzWriter npz(filename);
+    gl::add_npz(npz, "dense", mat);
+    gl::add_npz(npz, "packed", mat, true);
+    npz.close();
+  }
+  NpzFile npz(filename);
+  CHECK(gl::bitadjmat_from_npy(npz["dense"]) == mat);
+  CHECK(gl::bitadjmat_from_npy(npz["packed"]) == mat);
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,150 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/graph/contraction_hierarchy.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+
+template <typename GraphType, typename WeightType>
+WeightType path_length(const GraphType &g,
+                       const gl::EdgeMap<WeightType, GraphType> &weights,
+                       const std::vector<std::size_t> &path) {
+  WeightType total = 0;
+  for (std::size_t i = 0; i + 1 < path.size(); ++i) {
+    auto [e, exists] = boost::edge(path[i], path[i + 1], g);
+    REQUIRE(exists);
+    total += weights.at(e);
+  }
+  return total;
+}
+
+} // namespace
+
+TEST_CASE("contraction hierarchy on an undirected graph") {
+  auto gb = gl::kagome(3, 3);
+  auto &graph = gb.graph;
+  std::size_t n = boost::num_vertices(graph);
+
+  std::mt19937 rng(0);
+  gl::EdgeMap<int, gl::Graph> weights;
+  for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+    weights[e] = 1 + (rng() % 10);
+  }
+
+  parallel::thread_pool pool(2);
+  gl::ContractionHierarchy ch(graph, weights, &pool);
+  REQUIRE(ch.num_vertices() == n);
+
+  gl::BidirectionalWorkspace<int> ws;
+  for (std::size_t s = 0; s < n; s += 7) {
+    auto expected = gl::dijkstra_distances(graph, s, weights);
+    for (std::size_t t = 0; t < n; ++t) {
+      CHECK(ch.distance(s, t, ws) == expected[t]);
+
+      auto path = ch.path(s, t, ws);
+      REQUIRE(!path.empty());
+      CHECK(path.front() == s);
+      CHECK(path.back() == t);
+      CHECK(path_length(graph, weights, path) == expected[t]);
+    }
+  }
+
+  SUBCASE("save and load") {
+    std::stringstream ss;
+    ch.save(ss);
+    auto loaded = gl::ContractionHierarchy<int>::load(ss);
+    CHECK(loaded.num_vertices() == n);
+    CHECK(loaded.num_shortcuts() == ch.num_shortcuts());
+    for (std::size_t t = 0; t < n; ++t) {
+      CHECK(loaded.distance(3, t) == ch.distance(3, t));
+    }
+
+    std::stringstream wrong;
+    ch.save(wrong);
+    CHECK_THROWS_AS(gl::ContractionHierarchy<double>::load(wrong),
+                    std::runtime_error);
+  }
+
+  SUBCASE("load rejects malformed input") {
+    std::stringstream ss;
+    ch.save(ss);
+    const std::string good = ss.str();
+    auto load = [](const std::string &bytes) {
+      std::istringstream is(bytes);
+      return gl::ContractionHierarchy<int>::load(is);
+    };
+    auto with_word = [&](std::size_t offset, std::uint64_t value) {
+      std::string bytes = good;
+      bytes.replace(offset, 8, reinterpret_cast<const char *>(&value), 8);
+      return bytes;
+    };
+    CHECK(load(good).num_vertices() == n);
+
+    for (std::size_t size = 0; size < good.size(); size += 7) {
+      CHECK_THROWS_AS(load(good.substr(0, size)), std::runtime_error);
+    }
+
+    // Header: magic, weight size, n, m, shortcuts. Then n ranks, then arcs
+    // of from, to, weight, first, second and an alive byte.
+    std::size_t ranks = 40;
+    std::size_t arcs = ranks + 8 * n;
+    std::uint64_t shortcuts = ch.num_shortcuts();
+    CHECK_THROWS_AS(load(with_word(16, std::uint64_t{1} << 60)),
+                    std::runtime_error);
+    CHECK_THROWS_AS(load(with_word(24, std::uint64_t{1} << 60)),
+                    std::runtime_error);
+    CHECK_THROWS_AS(load(with_word(32, shortcuts + 1)), std::runtime_error);
+    CHECK_THROWS_AS(load(with_word(ranks, n)), std::runtime_error);
+    std::uint64_t rank1;
+    std::memcpy(&rank1, good.data() + ranks + 8, 8);
+    CHECK_THROWS_AS(load(with_word(ranks, rank1)), std::runtime_error);
+    CHECK_THROWS_AS(load(with_word(arcs, n)), std::runtime_error);
+    CHECK_THROWS_AS(load(with_word(arcs + 8, n + 5)), std::runtime_error);
+    // Arc 0 cannot be a shortcut: there are no older arcs to replace.
+    CHECK_THROWS_AS(load(with_word(arcs + 16 + sizeof(int), 0)),
+                    std::runtime_error);
+  }
+}
+
+TEST_CASE("contraction hierarchy on a directed graph") {
+  // A directed ring with random chords.
+  std::size_t n = 40;
+  gl::DiGraph g(n);
+  gl::EdgeMap<std::size_t, gl::DiGraph> weights;
+  std::mt19937 rng(1);
+  for (std::size_t v = 0; v < n; ++v) {
+    weights[boost::add_edge(v, (v + 1) % n, g).first] = 1 + rng() % 5;
+    if (rng() % 3 == 0) {
+      weights[boost::add_edge(v, rng() % n, g).first] = 1 + rng() % 20;
+    }
+  }
+  // One vertex only has outgoing edges.
+  std::size_t source_only = boost::add_vertex(g);
+  weights[boost::add_edge(source_only, 0, g).first] = 3;
+
+  gl::ContractionHierarchy ch(gl::CsrGraph(g, weights));
+  for (std::size_t s = 0; s <= n; ++s) {
+    auto expected = gl::dijkstra_distances(g, s, weights);
+    for (std::size_t t = 0; t <= n; ++t) {
+      CHECK(ch.distance(s, t) == expected[t]);
+      auto path = ch.path(s, t);
+      if (expected[t] == ch.unreachable) {
+        CHECK(path.empty());
+      } else {
+        CHECK(path_length(g, weights, path) == expected[t]);
+      }
+    }
+  }
+}
@@ -0,0 +1,237 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/graph/algorithms.hpp"
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <array>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace utils;
+
+TEST_CASE("csr graph construction") {
+
+  SUBCASE("from undirected graph") {
+    auto gb = gl::ibm_hex(2, 2);
+    gl::CsrGraph csr(gb.graph);
+
+    CHECK(!csr.is_directed());
+    CHECK(!csr.is_weighted());
+    CHECK(csr.num_vertices() == boost::num_vertices(gb.graph));
+    CHECK(csr.num_edges() == boost::num_edges(gb.graph));
+    CHECK(csr.num_arcs() == 2 * boost::num_edges(gb.graph));
+
+    for (auto v : boost::make_iterator_range(boost::vertices(gb.graph))) {
+      std::vector<std::size_t> expected;
+      for (auto nb : boost::make_iterator_range(
+               boost::adjacent_vertices(v, gb.graph))) {
+        expected.push_back(nb);
+      }
+      auto nbs = csr.neighbors(v);
+      CHECK(std::vector<std::size_t>(nbs.begin(), nbs.end()) == expected);
+    }
+  }
+
+  SUBCASE("from directed graph") {
+    gl::DiGraph g(4);
+    boost::add_edge(0, 1, g);
+    boost::add_edge(1, 2, g);
+    boost::add_edge(3, 1, g);
+    gl::CsrGraph csr(g);
+
+    CHECK(csr.is_directed());
+    CHECK(csr.num_arcs() == 3);
+    CHECK(csr.degree(1) == 1);
+    CHECK(csr.degree(2) == 0);
+    CHECK(csr.neighbors(3)[0] == 1);
+  }
+
+  SUBCASE("from bitadjmat") {
+    auto gb = gl::grid(3, 4);
+    gl::BitAdjmat mat(gb.graph);
+    gl::CsrGraph csr(mat);
+
+    CHECK(csr.num_edges() == boost::num_edges(gb.graph));
+    for (std::size_t v = 0; v < csr.num_vertices(); ++v) {
+      CHECK(csr.degree(v) == boost::degree(v, gb.graph));
+      for (std::size_t nb : csr.neighbors(v)) {
+        CHECK(mat.get(v, nb));
+      }
+    }
+  }
+
+  SUBCASE("from edgelist with shared edge ids") {
+    std::vector<std::array<int, 2>> edges = {{0, 1}, {1, 2}, {2, 2}};
+    gl::CsrGraph<double> csr(3, edges, {0.5, 1.5, 2.5});
+
+    CHECK(csr.is_weighted());
+    CHECK(csr.num_arcs() == 5); // the self-loop is stored once
+    CHECK(csr.edge_ids(0)[0] == 0);
+    CHECK(csr.edge_ids(1)[0] == 0);
+    CHECK(csr.edge_ids(1)[1] == 1);
+    CHECK(csr.weights(1)[1] == 1.5);
+    CHECK(csr.weights(2)[1] == 2.5);
+
+    CHECK_THROWS_AS(gl::CsrGraph(2, edges), std::out_of_range);
+    CHECK_THROWS_AS(gl::CsrGraph<double>(3, edges, std::vector<double>{1.0}),
+                    std::invalid_argument);
+  }
+}
+
+TEST_CASE("csr graph bfs and dijkstra match boost") {
+  auto gb = gl::ibm_hex(2, 2);
+  auto &graph = gb.graph;
+
+  std::mt19937 rng(0);
+  gl::EdgeMap<int, gl::Graph> weights;
+  for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+    weights[e] = 1 + (rng() & 3);
+  }
+
+  gl::CsrGraph unweighted(graph);
+  gl::CsrGraph weighted(graph, weights);
+
+  for (std::size_t source : {0, 3, 17}) {
+    auto [d, p] = gl::bfs(graph, source);
+    auto [csr_d, csr_p] = gl::bfs(unweighted, source);
+    CHECK(csr_d == d);
+    CHECK(csr_p == p);
+
+    auto expected = gl::dijkstra_distances(graph, source, weights);
+    auto [wd, wp] = gl::dijkstra(weighted, source);
+    CHECK(wd == expected);
+    for (std::size_t v = 0; v < wp.size(); ++v) {
+      if (v != source) {
+        CHECK(wd[wp[v]] < wd[v]);
+      }
+    }
+
+    CHECK(gl::dijkstra_distances(unweighted, source) == d);
+  }
+
+  SUBCASE("unreachable vertices") {
+    gl::DiGraph g(3);
+    boost::add_edge(0, 1, g);
+    auto [d, p] = gl::dijkstra(gl::CsrGraph(g), 0);
+    CHECK(d[1] == 1);
+    CHECK(d[2] == std::numeric_limits<std::size_t>::max());
+    CHECK(p[2] == 2);
+  }
+}
+
+TEST_CASE("csr graph coloring matches boost") {
+  for (auto gb : {gl::grid(3, 3), gl::ibm_hex(2, 2), gl::complete(6)}) {
+    auto expected = gl::graph_coloring(
+        gb.graph, gl::graph_coloring_strategy::LARGEST_FIRST);
+    auto colors = gl::graph_coloring(
+        gl::CsrGraph(gb.graph), gl::graph_coloring_strategy::LARGEST_FIRST);
+
+    REQUIRE(colors.size() == expected.size());
+    for (std::size_t v = 0; v < colors.size(); ++v) {
+      CHECK(colors[v] == expected.at(v));
+    }
+  }
+}
+
+TEST_CASE("csr graph searches with a reusable workspace") {
+  auto gb = gl::ibm_hex(2, 2);
+  auto &graph = gb.graph;
+  std::size_t n = boost::num_vertices(graph);
+
+  std::mt19937 rng(1);
+  gl::EdgeMap<int, gl::Graph> weights;
+  for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+    weights[e] = 1 + (rng() & 3);
+  }
+
+  gl::CsrGraph unweighted(graph);
+  gl::CsrGraph weighted(graph, weights);
+
+  SUBCASE("bfs and dijkstra match the allocating versions") {
+    gl::PathfindingWorkspace<std::size_t> bfs_ws;
+    gl::PathfindingWorkspace<int> dijkstra_ws;
+
+    for (std::size_t source : {0, 3, 17, 3}) {
+      gl::bfs(unweighted, source, bfs_ws);
+      auto d = gl::bfs_distances(unweighted, source);
+      CHECK(bfs_ws.reached_vertices().size() == n);
+      for (std::size_t v = 0; v < n; ++v) {
+        CHECK(bfs_ws.distance(v) == d[v]);
+      }
+
+      gl::dijkstra(weighted, source, dijkstra_ws);
+      auto wd = gl::dijkstra_distances(weighted, source);
+      for (std::size_t v = 0; v < n; ++v) {
+        CHECK(dijkstra_ws.distance(v) == wd[v]);
+      }
+
+      auto path = dijkstra_ws.path_to(n - 1);
+      REQUIRE(!path.empty());
+      CHECK(path.front() == source);
+      CHECK(path.back() == n - 1);
+    }
+  }
+
+  SUBCASE("results do not leak between searches") {
+    gl::DiGraph g(4);
+    boost::add_edge(0, 1, g);
+    boost::add_edge(2, 3, g);
+    gl::CsrGraph csr(g);
+
+    gl::PathfindingWorkspace<std::size_t> ws;
+    gl::bfs(csr, 0, ws);
+    CHECK(ws.reached(1));
+    gl::bfs(csr, 2, ws);
+    CHECK(!ws.reached(1));
+    CHECK(ws.distance(1) == gl::PathfindingWorkspace<>::unreachable);
+    CHECK(ws.predecessor(1) == 1);
+    CHECK(ws.distance(3) == 1);
+    CHECK(ws.path_to(1).empty());
+  }
+
+  SUBCASE("multi source bfs") {
+    auto [d, p] = gl::multi_source_bfs(graph, {0, n - 1});
+    auto d0 = gl::bfs_distances(unweighted, 0);
+    auto d1 = gl::bfs_distances(unweighted, n - 1);
+    for (std::size_t v = 0; v < n; ++v) {
+      CHECK(d[v] == std::min(d0[v], d1[v]));
+      if (d[v] > 0) {
+        CHECK(d[p[v]] + 1 == d[v]);
+      }
+    }
+    CHECK(d[0] == 0);
+    CHECK(d[n - 1] == 0);
+  }
+
+  SUBCASE("a star with zero heuristic matches dijkstra") {
+    gl::PathfindingWorkspace<int> ws;
+    auto zero = [](std::size_t) { return 0.0; };
+    auto expected = gl::dijkstra_distances(weighted, 0);
+    for (std::size_t goal : {std::size_t{1}, std::size_t{9}, n - 1}) {
+      CHECK(gl::astar_early_stopping(weighted, 0, goal, zero, ws) ==
+            expected[goal]);
+      CHECK(ws.path_to(goal).front() == 0);
+    }
+  }
+
+  SUBCASE("dijkstra many") {
+    std::vector<std::size_t> sources = {0, 5, 3, n - 1, 0};
+    parallel::thread_pool pool(2);
+
+    for (auto *p : {static_cast<parallel::thread_pool *>(nullptr), &pool}) {
+      auto dist = gl::dijkstra_many(graph, sources, weights, p);
+      REQUIRE(dist.shape().first == sources.size());
+      for (std::size_t i = 0; i < sources.size(); ++i) {
+        auto expected = gl::dijkstra_distances(weighted, sources[i]);
+        for (std::size_t v = 0; v < n; ++v) {
+          CHECK(dist(i, v) == expected[v]);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,81 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/graph/deletion_connectivity.hpp"
+#include "utils_cpp/graph/library.hpp"
+
+#include <boost/graph/connected_components.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+
+// Number of components of g without the vertices in removed.
+std::size_t count_components(const gl::Graph &g,
+                             const std::vector<char> &removed) {
+  gl::Graph h(boost::num_vertices(g));
+  std::size_t num_removed = 0;
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    auto u = boost::source(e, g), v = boost::target(e, g);
+    if (!removed[u] && !removed[v]) {
+      boost::add_edge(u, v, h);
+    }
+  }
+  for (char r : removed) {
+    num_removed += r ? 1 : 0;
+  }
+  std::vector<int> component(boost::num_vertices(h));
+  return boost::connected_components(h, component.data()) - num_removed;
+}
+
+} // namespace
+
+TEST_CASE("VertexDeletionConnectivity agrees with a full recount") {
+  std::mt19937_64 gen(1);
+  for (auto gb : {gl::grid(8, 8), gl::random(60, 0.06, 3)}) {
+    const gl::Graph &g = gb.graph;
+    std::size_t n = boost::num_vertices(g);
+    gl::VertexDeletionConnectivity connectivity(g);
+    std::vector<char> removed(n, 0);
+
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), gen);
+
+    bool agree = true;
+    for (std::size_t v : order) {
+      std::size_t before = count_components(g, removed);
+      removed[v] = 1;
+      std::size_t after = count_components(g, removed);
+      removed[v] = 0;
+      // Deleting v removes its component if v was isolated, and otherwise
+      // splits it if the count goes up.
+      bool splits = after > before;
+      agree = agree && connectivity.would_split(v) == splits;
+      if (!splits) {
+        removed[v] = 1;
+        connectivity.remove(v);
+      }
+    }
+    CHECK(agree);
+    CHECK(connectivity.num_remaining() ==
+          n - static_cast<std::size_t>(
+                  std::count(removed.begin(), removed.end(), 1)));
+  }
+}
+
+TEST_CASE("deletable_edges keeps a spanning forest") {
+  // A 4-cycle plus a pendant edge and a separate edge.
+  std::vector<std::pair<std::size_t, std::size_t>> order{
+      {0, 1}, {4, 0}, {1, 2}, {5, 6}, {2, 3}, {3, 0}};
+  auto deletable = gl::deletable_edges(7, order);
+  // Only the first cycle edge tried can go; the pendant and separate edges
+  // are bridges.
+  CHECK(deletable == std::vector<bool>{true, false, false, false, false,
+                                       false});
+}
@@ -0,0 +1,166 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/graph/algorithms.hpp"
+#include "utils_cpp/graph/distance_oracle.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace utils;
+
+TEST_CASE("landmark index") {
+  auto gb = gl::chimera(2, 2, 4);
+  auto &graph = gb.graph;
+  std::size_t n = boost::num_vertices(graph);
+
+  std::mt19937 rng(0);
+  gl::EdgeMap<int, gl::Graph> weights;
+  for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+    weights[e] = 1 + (rng() % 10);
+  }
+  gl::CsrGraph csr(graph, weights);
+  gl::DistanceTable<int> exact(csr);
+
+  SUBCASE("bounds are admissible and exact at the landmarks") {
+    gl::LandmarkIndex<int> index(graph, weights, 4);
+    REQUIRE(index.num_landmarks() == 4);
+
+    for (std::size_t u = 0; u < n; ++u) {
+      for (std::size_t t = 0; t < n; ++t) {
+        CHECK(index.lower_bound(u, t) <= exact(u, t));
+      }
+      for (std::size_t l : index.landmarks()) {
+        CHECK(index.lower_bound(u, l) == exact(u, l));
+      }
+    }
+  }
+
+  SUBCASE("a star with the landmark heuristic") {
+    gl::LandmarkIndex<int> index(csr, 4);
+    gl::PathfindingWorkspace<int> ws;
+    for (std::size_t goal : {std::size_t{5}, n - 1}) {
+      auto h = index.heuristic(goal);
+      auto [d, _] = gl::astar_early_stopping(graph, 0, goal, h, weights);
+      CHECK(d == exact(0, goal));
+      CHECK(gl::astar_early_stopping(csr, 0, goal, h, ws) == exact(0, goal));
+    }
+  }
+
+  SUBCASE("explicit landmarks on a directed graph") {
+    gl::DiGraph g(4);
+    gl::EdgeMap<int, gl::DiGraph> w;
+    w[boost::add_edge(0, 1, g).first] = 2;
+    w[boost::add_edge(1, 2, g).first] = 3;
+    w[boost::add_edge(2, 3, g).first] = 4;
+
+    parallel::thread_pool pool(2);
+    gl::LandmarkIndex<int> index(gl::CsrGraph(g, w),
+                                 std::vector<std::size_t>{0, 3}, &pool);
+    CHECK(index.from_landmark(0, 2) == 5);
+    CHECK(index.to_landmark(1, 1) == 7);
+    CHECK(index.from_landmark(1, 0) == index.unreachable);
+    CHECK(index.lower_bound(1, 3) == 7);
+    CHECK(index.lower_bound(0, 2) == 5);
+  }
+}
+
+TEST_CASE("exact distance table") {
+  auto gb = gl::grid(4, 4);
+  parallel::thread_pool pool(2);
+  gl::DistanceTable<std::size_t> table(gl::CsrGraph(gb.graph), &pool);
+
+  REQUIRE(table.num_vertices() == 16);
+  for (std::size_t u = 0; u < 16; ++u) {
+    auto d = gl::bfs_distances(gb.graph, u);
+    for (std::size_t v = 0; v < 16; ++v) {
+      CHECK(table(u, v) == d[v]);
+    }
+  }
+
+  auto h = table.heuristic(15);
+  CHECK(h(0) == 6);
+}
+
+TEST_CASE("dynamic distance table") {
+  parallel::thread_pool pool(2);
+
+  SUBCASE("matches floyd warshall after each change") {
+    std::size_t n = 40;
+    std::mt19937 rng(6);
+    for (bool directed : {false, true}) {
+      gl::Graph g(n);
+      gl::DiGraph dg(n);
+      std::vector<std::pair<std::size_t, std::size_t>> edges;
+      auto present = [&](std::size_t u, std::size_t v) {
+        auto has = [&](auto e) {
+          return std::find(edges.begin(), edges.end(), e) != edges.end();
+        };
+        return has(std::pair{u, v}) || (!directed && has(std::pair{v, u}));
+      };
+      while (edges.size() < 60) {
+        std::size_t u = rng() % n, v = rng() % n;
+        if (u != v && !present(u, v)) {
+          edges.emplace_back(u, v);
+        }
+      }
+      gl::DynamicDistanceTable<> table(n, edges, directed, &pool);
+
+      for (int step = 0; step < 200; ++step) {
+        std::size_t u = rng() % n, v = rng() % n;
+        if (rng() % 2 == 0 || edges.empty()) {
+          bool added = table.add_edge(u, v);
+          CHECK(added == (u != v && !present(u, v)));
+          if (added) {
+            edges.emplace_back(u, v);
+          }
+        } else {
+          auto [a, b] = edges[rng() % edges.size()];
+          REQUIRE(table.remove_edge(a, b));
+          std::erase_if(edges, [&](auto e) {
+            return e == std::pair{a, b} ||
+                   (!directed && e == std::pair{b, a});
+          });
+          CHECK(!table.has_edge(a, b));
+        }
+
+        gl::DynamicDistanceTable<> rebuilt(n, edges, directed);
+        REQUIRE(table.matrix() == rebuilt.matrix());
+      }
+
+      // The BFS rows agree with floyd_warshall_matrix on the final graph.
+      for (auto [u, v] : edges) {
+        boost::add_edge(u, v, g);
+        boost::add_edge(u, v, dg);
+      }
+      auto expected = directed ? gl::floyd_warshall_matrix(dg)
+                               : gl::floyd_warshall_matrix(g);
+      CHECK(table.matrix() == expected);
+    }
+  }
+
+  SUBCASE("local changes recompute few rows") {
+    auto gb = gl::grid(20, 20);
+    gl::DynamicDistanceTable<> table(gb.graph);
+    REQUIRE(table.rows_recomputed() == 0);
+
+    // Removing a corner edge of the grid only lengthens the paths from the
+    // sources in the first row, for which it was the only way in or out of
+    // the corner.
+    CHECK(table.remove_edge(0, 1));
+    CHECK(table(0, 1) == 3);
+    CHECK(table.rows_recomputed() == 20);
+    CHECK(table.add_edge(0, 1));
+    CHECK(table(0, 1) == 1);
+    CHECK(table.matrix() == gl::floyd_warshall_matrix(gb.graph));
+
+    CHECK(!table.add_edge(0, 1));
+    CHECK(!table.add_edge(5, 5));
+    CHECK(!table.remove_edge(0, 399));
+    CHECK_THROWS_AS(table.add_edge(0, 400), std::out_of_range);
+  }
+}
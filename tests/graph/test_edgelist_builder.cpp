@@ -0,0 +1,107 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/graph/edgelist_builder.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace utils;
+
+TEST_CASE("edgelist builder") {
+
+  SUBCASE("grows to cover every endpoint") {
+    gl::EdgeListBuilder builder;
+    builder.add_edge(0, 1);
+    builder.add_edge(4, 2);
+    CHECK(builder.num_vertices() == 5);
+    CHECK(builder.num_edges() == 2);
+
+    gl::EdgeListBuilder sized(10);
+    sized.add_edge(1, 2);
+    CHECK(boost::num_vertices(sized.build_graph()) == 10);
+  }
+
+  SUBCASE("graph and csr agree with add_edge") {
+    std::mt19937_64 gen(3);
+    std::uniform_int_distribution<std::size_t> pick(0, 199);
+    gl::EdgeListBuilder builder(200);
+    gl::Graph expected(200);
+    for (int i = 0; i < 1000; ++i) {
+      std::size_t u = pick(gen), v = pick(gen);
+      builder.add_edge(u, v);
+      boost::add_edge(u, v, expected);
+    }
+
+    gl::Graph g = builder.build_graph();
+    CHECK(boost::num_vertices(g) == 200);
+    CHECK(boost::num_edges(g) == 1000);
+    CHECK(gl::to_edgelist(g) == gl::to_edgelist(expected));
+    for (auto v : boost::make_iterator_range(boost::vertices(g))) {
+      REQUIRE(boost::out_degree(v, g) == boost::out_degree(v, expected));
+    }
+
+    auto csr = builder.build_csr();
+    CHECK(csr.num_vertices() == 200);
+    CHECK(csr.num_edges() == 1000);
+    CHECK(gl::bfs_distances(csr, 0) == gl::bfs_distances(g, 0));
+  }
+
+  SUBCASE("directed") {
+    gl::EdgeListBuilder builder(3, true);
+    builder.add_edges(std::vector<std::array<int, 2>>{{0, 1}, {1, 2}});
+    auto g = builder.build_graph<gl::DiGraph>();
+    CHECK(boost::num_edges(g) == 2);
+    CHECK(boost::out_degree(2, g) == 0);
+    CHECK(builder.build_csr().is_directed());
+  }
+
+  SUBCASE("deduplicate") {
+    gl::EdgeListBuilder builder;
+    builder.add_edges(std::vector<std::pair<int, int>>{
+        {3, 1}, {1, 3}, {0, 2}, {2, 2}, {0, 2}, {70000, 5}, {5, 70000}});
+    builder.deduplicate();
+    std::vector<std::pair<std::size_t, std::size_t>> expected{
+        {0, 2}, {1, 3}, {2, 2}, {5, 70000}};
+    CHECK(builder.edges() == expected);
+
+    gl::EdgeListBuilder directed(0, true);
+    directed.add_edges(
+        std::vector<std::pair<int, int>>{{3, 1}, {1, 3}, {3, 1}});
+    directed.deduplicate();
+    CHECK(directed.num_edges() == 2);
+  }
+
+  SUBCASE("deduplicate matches std::sort") {
+    std::mt19937_64 gen(5);
+    std::uniform_int_distribution<std::size_t> pick(0, 99999);
+    gl::EdgeListBuilder builder;
+    std::vector<std::pair<std::size_t, std::size_t>> expected;
+    for (int i = 0; i < 20000; ++i) {
+      std::size_t u = pick(gen) % 300, v = pick(gen);
+      builder.add_edge(u, v);
+      expected.emplace_back(std::min(u, v), std::max(u, v));
+    }
+    std::sort(expected.begin(), expected.end());
+    expected.erase(std::unique(expected.begin(), expected.end()),
+                   expected.end());
+    builder.deduplicate();
+    CHECK(builder.edges() == expected);
+  }
+}
+
+TEST_CASE("from_edgelist") {
+  std::vector<std::vector<int>> vectors{{0, 1}, {1, 2}, {4, 0}};
+  std::vector<std::array<int, 2>> arrays{{0, 1}, {1, 2}, {4, 0}};
+  std::vector<std::pair<int, int>> pairs{{0, 1}, {1, 2}, {4, 0}};
+  for (const auto &g : {gl::from_edgelist(vectors), gl::from_edgelist(arrays),
+                        gl::from_edgelist(pairs)}) {
+    CHECK(boost::num_vertices(g) == 5);
+    CHECK(boost::num_edges(g) == 3);
+    CHECK(boost::degree(0, g) == 2);
+  }
+}
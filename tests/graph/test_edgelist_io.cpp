@@ -0,0 +1,118 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/graph/edgelist_io.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace utils;
+
+using edges_t = std::vector<std::pair<std::size_t, std::size_t>>;
+
+TEST_CASE("parse edgelist") {
+
+  SUBCASE("separators, comments and line endings") {
+    auto parsed = gl::parse_edgelist("# a comment\n"
+                                     "0 1\n"
+                                     "\n"
+                                     "  1\t2 extra columns\r\n"
+                                     "% another comment\n"
+                                     "2,3\n"
+                                     "4 0");
+    CHECK(parsed.edges.edges() == edges_t{{0, 1}, {1, 2}, {2, 3}, {4, 0}});
+    CHECK(parsed.edges.num_vertices() == 5);
+    CHECK(parsed.weights.empty());
+    CHECK(parsed.build_csr().num_edges() == 4);
+  }
+
+  SUBCASE("weights, a header and ids from one") {
+    gl::EdgeListFormat format;
+    format.weighted = true;
+    format.directed = true;
+    format.first_vertex = 1;
+    format.skip_lines = 1;
+    auto parsed = gl::parse_edgelist<double>("source,target,weight\n"
+                                             "1,2,0.5\n"
+                                             "2,3,1e2\n",
+                                             format);
+    CHECK(parsed.edges.edges() == edges_t{{0, 1}, {1, 2}});
+    CHECK(parsed.weights == std::vector<double>{0.5, 100});
+    auto csr = parsed.build_csr();
+    CHECK(csr.is_directed());
+    CHECK(csr.num_vertices() == 3);
+    CHECK(csr.num_edges() == 2);
+  }
+
+  SUBCASE("malformed lines name the line") {
+    auto error_of = [](std::string_view text, gl::EdgeListFormat format) {
+      try {
+        gl::parse_edgelist(text, format);
+      } catch (const std::runtime_error &e) {
+        return std::string(e.what());
+      }
+      return std::string();
+    };
+    gl::EdgeListFormat plain, weighted, from_one;
+    weighted.weighted = true;
+    from_one.first_vertex = 1;
+    CHECK(error_of("0 1\n2\n", plain) ==
+          "parse_edgelist: malformed line 2");
+    CHECK(error_of("0 1\n\n1 x\n", plain) ==
+          "parse_edgelist: malformed line 3");
+    CHECK(error_of("0 1x\n", plain) == "parse_edgelist: malformed line 1");
+    CHECK(error_of("-1 2\n", plain) == "parse_edgelist: malformed line 1");
+    CHECK(error_of("0 99999999999999999999\n", plain) ==
+          "parse_edgelist: malformed line 1");
+    CHECK(error_of("0 1\n", weighted) == "parse_edgelist: malformed line 1");
+    CHECK(error_of("1 2\n0 1\n", from_one) ==
+          "parse_edgelist: malformed line 2");
+  }
+
+  SUBCASE("parallel parsing gives the same edges in the same order") {
+    std::mt19937_64 gen(5);
+    std::string text;
+    edges_t expected;
+    std::vector<double> weights;
+    for (int i = 0; i < 300000; ++i) {
+      std::size_t u = gen() % 100000, v = gen() % 100000;
+      double w = static_cast<double>(gen() % 1000) / 4;
+      expected.emplace_back(u, v);
+      weights.push_back(w);
+      text += std::to_string(u) + ' ' + std::to_string(v) + '\t' +
+              std::to_string(w) + (i % 7 == 0 ? "\r\n" : "\n");
+    }
+    gl::EdgeListFormat format;
+    format.weighted = true;
+    parallel::thread_pool pool(3);
+    auto parsed = gl::parse_edgelist<double>(text, format, &pool);
+    CHECK(parsed.edges.edges() == expected);
+    CHECK(parsed.weights == weights);
+
+    // The first malformed line is reported, whichever chunk it is in.
+    text.insert(text.size() / 2, "bad line\n");
+    auto line = std::count(text.begin(), text.begin() + text.size() / 2, '\n');
+    std::string message = "parse_edgelist: malformed line ";
+    message += std::to_string(line + 1);
+    CHECK_THROWS_WITH_AS(gl::parse_edgelist<double>(text, format, &pool),
+                         message.c_str(), std::runtime_error);
+  }
+}
+
+TEST_CASE("read edgelist") {
+  {
+    std::ofstream out("_test_edgelist.txt", std::ios_base::binary);
+    out << "0 1\n1 2\n2 0\n";
+  }
+  auto parsed = gl::read_edgelist("_test_edgelist.txt");
+  CHECK(parsed.edges.edges() == edges_t{{0, 1}, {1, 2}, {2, 0}});
+  std::remove("_test_edgelist.txt");
+
+  CHECK_THROWS_AS(gl::read_edgelist("_no_such_edgelist.txt"),
+                  std::runtime_error);
+}
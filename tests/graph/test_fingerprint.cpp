@@ -0,0 +1,207 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/graph/algorithms.hpp"
+#include "utils_cpp/graph/fingerprint.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/transforms.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+
+std::vector<gl::GraphBundle> bundles() {
+  return {gl::grid(4, 5),        gl::kagome(3, 3), gl::chimera(2, 2, 4),
+          gl::ibm_hex(2, 2),     gl::ring(12),     gl::random(60, 0.1, 3),
+          gl::complete(6)};
+}
+
+} // namespace
+
+TEST_CASE("fingerprints ignore vertex labels") {
+  for (const auto &gb : bundles()) {
+    auto shuffled = gl::shuffle_vertex_labels(gb.graph, 7u);
+    auto f = gl::fingerprint(gb.graph);
+    CHECK(f == gl::fingerprint(shuffled));
+    CHECK(f == gl::fingerprint(gl::BitAdjmat(gb.graph)));
+    CHECK(f.num_vertices == boost::num_vertices(gb.graph));
+    CHECK(f.num_edges == boost::num_edges(gb.graph));
+  }
+  CHECK(gl::fingerprint(gl::grid(4, 5).graph) !=
+        gl::fingerprint(gl::kagome(3, 3).graph));
+
+  // Removing one edge changes the hash, not only the edge count.
+  auto g = gl::grid(5, 5).graph;
+  auto a = g, b = g;
+  boost::remove_edge(0, 1, a);
+  boost::remove_edge(6, 7, b);
+  CHECK(gl::fingerprint(a).hash != gl::fingerprint(b).hash);
+}
+
+TEST_CASE("canonical form") {
+  for (const auto &gb : bundles()) {
+    auto c = gl::canonical_form(gb.graph);
+    for (unsigned seed : {1u, 2u, 3u}) {
+      auto shuffled = gl::canonical_form(gl::shuffle_vertex_labels(gb.graph,
+                                                                   seed));
+      CHECK(shuffled.edges == c.edges);
+      CHECK(shuffled.edges_hash == c.edges_hash);
+    }
+
+    // The labels are a permutation that maps the edges onto the canonical
+    // ones.
+    std::vector<bool> seen(c.labels.size());
+    for (std::size_t l : c.labels) {
+      REQUIRE(l < seen.size());
+      CHECK(!seen[l]);
+      seen[l] = true;
+    }
+    for (auto e : boost::make_iterator_range(boost::edges(gb.graph))) {
+      std::size_t a = c.labels[boost::source(e, gb.graph)];
+      std::size_t b = c.labels[boost::target(e, gb.graph)];
+      CHECK(std::binary_search(c.edges.begin(), c.edges.end(),
+                               std::pair{std::min(a, b), std::max(a, b)}));
+    }
+  }
+}
+
+TEST_CASE("topology cache") {
+  gl::TopologyCache cache(8);
+  auto gb = gl::kagome(3, 3);
+  auto shuffled = gl::shuffle_vertex_labels(gb.graph, 5u);
+
+  SUBCASE("floyd warshall") {
+    CHECK(gl::cached_floyd_warshall(cache, gb.graph) ==
+          gl::floyd_warshall_matrix(gb.graph));
+    CHECK(cache.misses() == 1);
+    CHECK(gl::cached_floyd_warshall(cache, shuffled) ==
+          gl::floyd_warshall_matrix(shuffled));
+    CHECK(cache.hits() == 1);
+
+    gl::BitAdjmat mat(gb.graph);
+    CHECK(gl::cached_floyd_warshall(cache, mat) ==
+          gl::floyd_warshall_matrix(mat));
+    CHECK(cache.hits() == 2);
+  }
+
+  SUBCASE("graph coloring") {
+    auto strategy = gl::graph_coloring_strategy::SMALLEST_LAST;
+    auto colors = gl::cached_graph_coloring(cache, gb.graph, strategy);
+    CHECK(colors == gl::graph_coloring(gl::CsrGraph(gb.graph), strategy));
+    auto reused = gl::cached_graph_coloring(cache, shuffled, strategy);
+    CHECK(cache.hits() == 1);
+    for (auto e : boost::make_iterator_range(boost::edges(shuffled))) {
+      CHECK(reused[boost::source(e, shuffled)] !=
+            reused[boost::target(e, shuffled)]);
+    }
+    CHECK(*std::max_element(reused.begin(), reused.end()) ==
+          *std::max_element(colors.begin(), colors.end()));
+
+    gl::cached_graph_coloring(cache, gb.graph,
+                              gl::graph_coloring_strategy::LARGEST_FIRST);
+    CHECK(cache.misses() == 2);
+  }
+
+  SUBCASE("fingerprint collisions are misses") {
+    // Both 2-regular on 6 vertices, so refinement cannot tell them apart.
+    gl::Graph hexagon = gl::ring(6).graph;
+    gl::Graph triangles(6);
+    for (std::size_t t : {0, 3}) {
+      boost::add_edge(t, t + 1, triangles);
+      boost::add_edge(t + 1, t + 2, triangles);
+      boost::add_edge(t + 2, t, triangles);
+    }
+    REQUIRE(gl::fingerprint(hexagon) == gl::fingerprint(triangles));
+    CHECK(gl::cached_floyd_warshall(cache, hexagon) ==
+          gl::floyd_warshall_matrix(hexagon));
+    CHECK(gl::cached_floyd_warshall(cache, triangles) ==
+          gl::floyd_warshall_matrix(triangles));
+    CHECK(cache.misses() == 2);
+
+    gl::DiGraph directed(2);
+    boost::add_edge(0, 1, directed);
+    gl::Graph undirected(2);
+    boost::add_edge(0, 1, undirected);
+    CHECK(gl::cached_floyd_warshall(cache, directed) ==
+          gl::floyd_warshall_matrix(directed));
+    CHECK(gl::cached_floyd_warshall(cache, undirected) ==
+          gl::floyd_warshall_matrix(undirected));
+    CHECK(cache.misses() == 4);
+  }
+
+  SUBCASE("eviction") {
+    gl::TopologyCache small(1);
+    gl::cached_floyd_warshall(small, gb.graph);
+    gl::cached_floyd_warshall(small, gl::ring(5).graph);
+    gl::cached_floyd_warshall(small, gb.graph);
+    CHECK(small.misses() == 3);
+    CHECK(small.size() == 1);
+  }
+
+  SUBCASE("save and load") {
+    std::string filename = "test_topology_cache.bin";
+    gl::cached_floyd_warshall(cache, gb.graph);
+    gl::cached_graph_coloring(cache, gl::grid(3, 3).graph,
+                              gl::graph_coloring_strategy::LARGEST_FIRST);
+    cache.save(filename);
+
+    gl::TopologyCache loaded;
+    loaded.load(filename);
+    CHECK(loaded.size() == 2);
+    CHECK(gl::cached_floyd_warshall(loaded, shuffled) ==
+          gl::floyd_warshall_matrix(shuffled));
+    CHECK(loaded.hits() == 1);
+    CHECK(loaded.misses() == 0);
+
+    {
+      std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+      out << "UTGCACHE garbage";
+    }
+    CHECK_THROWS_AS(loaded.load(filename), std::runtime_error);
+    std::remove(filename.c_str());
+    CHECK_THROWS_AS(loaded.load(filename), std::runtime_error);
+  }
+
+  SUBCASE("results of the wrong size") {
+    std::string filename = "test_topology_cache_size.bin";
+    auto canonical = gl::canonical_form(gl::CsrGraph(gb.graph));
+    auto one = [] { return std::vector<std::int64_t>{0}; };
+    CHECK_THROWS_AS(cache.get_or_compute(canonical, "floyd_warshall", 2, one),
+                    std::runtime_error);
+    CHECK(cache.size() == 0);
+
+    // Shorten the stored distance matrix, which is the last thing in the
+    // file, to a single element.
+    gl::cached_floyd_warshall(cache, gb.graph);
+    cache.save(filename);
+    std::string bytes;
+    {
+      std::ifstream in(filename, std::ios::binary);
+      bytes.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    std::size_t n = boost::num_vertices(gb.graph);
+    std::size_t count_at = bytes.size() - n * n * 8 - 8;
+    std::uint64_t one_element = 1;
+    bytes.replace(count_at, 8, reinterpret_cast<const char *>(&one_element),
+                  8);
+    bytes.resize(count_at + 16);
+    {
+      std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+      out << bytes;
+    }
+
+    gl::TopologyCache loaded;
+    loaded.load(filename);
+    std::remove(filename.c_str());
+    CHECK_THROWS_AS(gl::cached_floyd_warshall(loaded, shuffled),
+                    std::runtime_error);
+  }
+}
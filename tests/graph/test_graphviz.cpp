@@ -97,3 +97,113 @@ TEST_CASE("test to dot") {
 
   std::remove("_test_to_dot_output.dot");
 }
+
+TEST_CASE("write_dot") {
+
+  auto gb = gl::grid(2, 2);
+  gl::EdgeMap<double> weight;
+  for (auto e : boost::make_iterator_range(boost::edges(gb.graph))) {
+    weight[e] = 0.5 * boost::target(e, gb.graph);
+  }
+  gb.props.edge["weight"] = weight;
+  gl::VertexMap<std::string> label = {{0, "a"}, {3, "say \"d\""}};
+  gb.props.vertex["label"] = label;
+
+  SUBCASE("all attributes") {
+    std::stringstream ss;
+    gl::write_dot(gb, ss);
+    CHECK(ss.str() ==
+          "graph G {\n"
+          "  0 [label=\"a\", pos=\"0,0!\"];\n"
+          "  1 [pos=\"1,0!\"];\n"
+          "  2 [pos=\"0,1!\"];\n"
+          "  3 [label=\"say \\\"d\\\"\", pos=\"1,1!\"];\n"
+          "  0 -- 1 [weight=0.5];\n"
+          "  0 -- 2 [weight=1];\n"
+          "  1 -- 3 [weight=1.5];\n"
+          "  2 -- 3 [weight=1.5];\n"
+          "}\n");
+  }
+
+  SUBCASE("subset of attributes, columnar, tiny buffer") {
+    gb.props.vertex["position"].make_columnar(4);
+    std::stringstream ss;
+    gl::DotOptions options;
+    options.attributes = {"position"};
+    options.style = true;
+    options.buffer_size = 1;
+    gl::write_dot(gb, ss, options);
+    CHECK(ss.str() == "graph G {\n"
+                      "  splines=true;\n  node [shape=circle];\n"
+                      "  edge [penwidth=2];\n"
+                      "  0 [pos=\"0,0!\"];\n"
+                      "  1 [pos=\"1,0!\"];\n"
+                      "  2 [pos=\"0,1!\"];\n"
+                      "  3 [pos=\"1,1!\"];\n"
+                      "  0 -- 1;\n  0 -- 2;\n  1 -- 3;\n  2 -- 3;\n"
+                      "}\n");
+  }
+
+  SUBCASE("no attributes") {
+    gl::DotOptions options;
+    options.omit_attributes = true;
+    std::stringstream with_bundle, without_bundle;
+    gl::write_dot(gb, with_bundle, options);
+    gl::write_dot(gb.graph, without_bundle);
+    CHECK(with_bundle.str() == without_bundle.str());
+    CHECK(with_bundle.str() == "graph G {\n  0;\n  1;\n  2;\n  3;\n"
+                               "  0 -- 1;\n  0 -- 2;\n  1 -- 3;\n  2 -- 3;\n"
+                               "}\n");
+  }
+
+  SUBCASE("to a file") {
+    gl::write_dot(gb, "_test_write_dot.dot");
+    std::ifstream ifs("_test_write_dot.dot");
+    std::stringstream from_file, expected;
+    from_file << ifs.rdbuf();
+    gl::write_dot(gb, expected);
+    CHECK(from_file.str() == expected.str());
+    std::remove("_test_write_dot.dot");
+  }
+
+  SUBCASE("to a full device") {
+    // Writes to /dev/full only fail once the data is flushed, on close.
+    std::ofstream probe("/dev/full");
+    if (probe) {
+      CHECK_THROWS_AS(gl::write_dot(gb, "/dev/full"), std::runtime_error);
+#if defined(UTILS_CPP_HAS_ZLIB)
+      gl::DotOptions options;
+      options.compress = true;
+      CHECK_THROWS_AS(gl::write_dot(gb, "/dev/full", options),
+                      std::runtime_error);
+#endif
+    }
+  }
+
+#if defined(UTILS_CPP_HAS_ZLIB)
+  SUBCASE("gzipped") {
+    gl::DotOptions options;
+    options.compress = true;
+    gl::write_dot(gb, "_test_write_dot.dot.gz", options);
+
+    gzFile file = gzopen("_test_write_dot.dot.gz", "rb");
+    REQUIRE(file != nullptr);
+    std::string contents(4096, '\0');
+    int size = gzread(file, contents.data(), contents.size());
+    gzclose(file);
+    contents.resize(size);
+
+    std::stringstream expected;
+    gl::write_dot(gb, expected);
+    CHECK(contents == expected.str());
+    std::remove("_test_write_dot.dot.gz");
+  }
+#else
+  SUBCASE("compression needs zlib") {
+    gl::DotOptions options;
+    options.compress = true;
+    CHECK_THROWS_AS(gl::write_dot(gb, "_test_write_dot.dot.gz", options),
+                    std::runtime_error);
+  }
+#endif
+}
@@ -0,0 +1,134 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/implicit_graph.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace utils;
+
+template <typename GraphType>
+std::vector<std::pair<std::size_t, std::size_t>>
+sorted_edges(const GraphType &g) {
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    auto u = boost::source(e, g);
+    auto v = boost::target(e, g);
+    edges.emplace_back(std::min(u, v), std::max(u, v));
+  }
+  std::sort(edges.begin(), edges.end());
+  return edges;
+}
+
+// The view must have the same vertices, edges, degrees and positions as the
+// materialized library graph.
+template <typename View>
+void check_matches(const View &view, gl::GraphBundle gb) {
+  const auto &g = gb.graph;
+  REQUIRE(boost::num_vertices(view) == boost::num_vertices(g));
+  REQUIRE(boost::num_edges(view) == boost::num_edges(g));
+
+  auto edges = sorted_edges(view);
+  CHECK(edges.size() == view.num_edges());
+  CHECK(edges == sorted_edges(g));
+
+  gl::VertexMap<std::vector<double>> positions = gb.props.vertex["position"];
+  for (auto v : boost::make_iterator_range(boost::vertices(view))) {
+    REQUIRE(boost::out_degree(v, view) == boost::degree(v, g));
+
+    std::vector<std::size_t> expected, actual;
+    for (auto w : boost::make_iterator_range(boost::adjacent_vertices(v, g))) {
+      expected.push_back(w);
+    }
+    for (auto e : boost::make_iterator_range(boost::out_edges(v, view))) {
+      REQUIRE(boost::source(e, view) == v);
+      actual.push_back(boost::target(e, view));
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    REQUIRE(actual == expected);
+
+    auto position = view.position(v);
+    REQUIRE(position[0] == positions[v][0]);
+    REQUIRE(position[1] == positions[v][1]);
+  }
+}
+
+TEST_CASE("implicit views match the library graphs") {
+
+  SUBCASE("grid") {
+    for (std::size_t h : {1, 2, 5}) {
+      for (std::size_t w : {1, 3, 7}) {
+        check_matches(gl::GridView(h, w), gl::grid(h, w));
+      }
+    }
+  }
+
+  SUBCASE("chimera") {
+    for (std::size_t h : {1, 2, 3}) {
+      for (std::size_t w : {1, 2, 4}) {
+        for (std::size_t k : {1, 2, 4}) {
+          check_matches(gl::ChimeraView(h, w, k), gl::chimera(h, w, k));
+        }
+      }
+    }
+  }
+
+  SUBCASE("kagome") {
+    for (std::size_t r : {1, 2, 3}) {
+      for (std::size_t c : {1, 2, 5}) {
+        check_matches(gl::KagomeView(r, c), gl::kagome(r, c));
+      }
+    }
+  }
+
+  SUBCASE("ibm hex") {
+    for (std::size_t r : {1, 2, 3, 4, 5}) {
+      for (std::size_t c : {1, 2, 3, 4}) {
+        check_matches(gl::IbmHexView(r, c), gl::ibm_hex(r, c));
+      }
+    }
+  }
+}
+
+TEST_CASE("searches on implicit views") {
+
+  SUBCASE("bfs") {
+    gl::IbmHexView view(4, 3);
+    auto gb = gl::ibm_hex(4, 3);
+    for (std::size_t source : {0, 7, 40}) {
+      CHECK(gl::bfs_distances(view, source) ==
+            gl::bfs_distances(gb.graph, source));
+    }
+  }
+
+  SUBCASE("unit-weight dijkstra") {
+    gl::KagomeView view(3, 4);
+    gl::EdgeMap<std::size_t, gl::KagomeView> weights;
+    for (auto e : boost::make_iterator_range(boost::edges(view))) {
+      weights[e] = 1;
+    }
+    CHECK(gl::dijkstra_distances(view, std::size_t{5}, weights) ==
+          gl::bfs_distances(view, 5));
+  }
+
+  SUBCASE("csr copy") {
+    gl::GridView view(30, 40);
+    gl::CsrGraph csr(view);
+    CHECK(csr.num_vertices() == 1200);
+    CHECK(csr.num_edges() == view.num_edges());
+    CHECK(gl::bfs_distances(csr, 0) == gl::bfs_distances(view, 0));
+  }
+
+  SUBCASE("large grid costs nothing to build") {
+    gl::GridView view(1000, 1000);
+    CHECK(sizeof(view) == 2 * sizeof(std::size_t));
+    auto distances = gl::bfs_distances(view, 0);
+    CHECK(distances.back() == 1998);
+  }
+}
@@ -37,3 +37,130 @@ TEST_CASE("random graph") {
 
   std::cout << "boost::num_edges(g) = " << boost::num_edges(g) << std::endl;
 }
+
+TEST_CASE("random graphs store edges from the smaller vertex") {
+  auto check = [](const auto &g) {
+    CHECK(boost::num_edges(g) > 0);
+    for (auto e : boost::make_iterator_range(boost::edges(g))) {
+      CHECK(boost::source(e, g) < boost::target(e, g));
+    }
+  };
+  check(gl::random(50, 0.2, 1u).graph);
+  check(gl::random_gnm(50, 100, 1u).graph);
+  check(gl::random_regular(50, 4, 1u).graph);
+}
+
+TEST_CASE("gnp edges") {
+  const std::size_t n = 2000;
+
+  SUBCASE("edge count is close to its mean") {
+    double p = 0.01;
+    auto edges = gl::gnp_edges(n, p, 7);
+    double mean = p * n * (n - 1) / 2;
+    CHECK(std::abs(static_cast<double>(edges.size()) - mean) <
+          5 * std::sqrt(mean));
+
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+      REQUIRE(edges[i].second < edges[i].first);
+      REQUIRE(edges[i].first < n);
+      if (i > 0) {
+        REQUIRE(edges[i - 1] < edges[i]);
+      }
+    }
+  }
+
+  SUBCASE("same edges with and without a pool") {
+    parallel::thread_pool pool(4);
+    auto serial = gl::gnp_edges(n, 0.05, 11);
+    auto parallel = gl::gnp_edges(n, 0.05, 11, &pool);
+    CHECK(serial == parallel);
+    CHECK(serial != gl::gnp_edges(n, 0.05, 12));
+  }
+
+  SUBCASE("p = 0 and p = 1") {
+    CHECK(gl::gnp_edges(n, 0.0, 1).empty());
+    CHECK(gl::gnp_edges(50, 1.0, 1).size() == 50 * 49 / 2);
+    CHECK(gl::gnp_edges(1, 0.5, 1).empty());
+  }
+
+  SUBCASE("random graph has the sampled edges") {
+    auto gb = gl::random(300, 0.1, 3);
+    CHECK(boost::num_edges(gb.graph) == gl::gnp_edges(300, 0.1, 3).size());
+  }
+}
+
+TEST_CASE("gnm edges") {
+  for (std::size_t m : {0, 1, 100, 1000, 1225}) {
+    auto edges = gl::gnm_edges(50, m, 5);
+    REQUIRE(edges.size() == m);
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+      REQUIRE(edges[i].second < edges[i].first);
+      REQUIRE(edges[i].first < 50);
+      if (i > 0) {
+        REQUIRE(edges[i - 1] < edges[i]);
+      }
+    }
+  }
+  CHECK_THROWS_AS(gl::gnm_edges(50, 1226, 5), std::invalid_argument);
+
+  auto gb = gl::random_gnm(1000, 5000, 9);
+  CHECK(boost::num_edges(gb.graph) == 5000);
+}
+
+TEST_CASE("random bipartite graph") {
+  auto gb = gl::random_bipartite(200, 300, 0.05, 4);
+  auto &g = gb.graph;
+  double mean = 0.05 * 200 * 300;
+  CHECK(std::abs(static_cast<double>(boost::num_edges(g)) - mean) <
+        5 * std::sqrt(mean));
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    auto a = std::min(boost::source(e, g), boost::target(e, g));
+    auto b = std::max(boost::source(e, g), boost::target(e, g));
+    REQUIRE(a < 200);
+    REQUIRE(b >= 200);
+  }
+  CHECK(boost::num_edges(gl::random_bipartite(20, 30, 1.0, 1).graph) == 600);
+}
+
+TEST_CASE("regular edges") {
+  auto check_regular = [](std::size_t n, std::size_t d, std::uint64_t seed) {
+    auto edges = gl::regular_edges(n, d, seed);
+    REQUIRE(edges.size() == n * d / 2);
+    std::vector<std::size_t> degrees(n, 0);
+    std::sort(edges.begin(), edges.end());
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+      REQUIRE(edges[i].second < edges[i].first);
+      if (i > 0) {
+        REQUIRE(edges[i - 1] != edges[i]);
+      }
+      ++degrees[edges[i].first];
+      ++degrees[edges[i].second];
+    }
+    for (auto degree : degrees) {
+      REQUIRE(degree == d);
+    }
+  };
+
+  for (std::uint64_t seed = 0; seed < 20; ++seed) {
+    check_regular(5, 2, seed);
+    check_regular(10, 3, seed);
+    check_regular(12, 8, seed);
+  }
+  check_regular(1000, 20, 1);
+  check_regular(400, 199, 2);
+  check_regular(400, 200, 3);
+  check_regular(301, 300, 4);
+  check_regular(7, 0, 5);
+
+  CHECK(gl::regular_edges(500, 10, 7) == gl::regular_edges(500, 10, 7));
+  CHECK(gl::regular_edges(500, 10, 7) != gl::regular_edges(500, 10, 8));
+
+  CHECK_THROWS_AS(gl::regular_edges(5, 3, 1), std::invalid_argument);
+  CHECK_THROWS_AS(gl::regular_edges(4, 4, 1), std::invalid_argument);
+
+  auto gb = gl::random_regular(100, 6, 1);
+  CHECK(boost::num_edges(gb.graph) == 300);
+  for (auto v : boost::make_iterator_range(boost::vertices(gb.graph))) {
+    CHECK(boost::degree(v, gb.graph) == 6);
+  }
+}
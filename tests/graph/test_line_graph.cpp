@@ -4,6 +4,10 @@
 #include "utils_cpp/graph/graphviz.hpp"
 #include "utils_cpp/graph/library.hpp"
 #include "utils_cpp/graph/line_graph.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
+
+#include <algorithm>
+#include <random>
 
 using namespace utils;
 
@@ -80,3 +84,65 @@ TEST_CASE("test line graph") {
     CHECK(verify_line_graph(lg, g, v_to_e_map));
   }
 }
+
+TEST_CASE("line graph matches the definition") {
+
+  std::mt19937_64 gen(2);
+  gl::Graph g(60);
+  std::uniform_int_distribution<std::size_t> pick(0, 59);
+  for (int i = 0; i < 400; ++i) {
+    std::size_t u = pick(gen), v = pick(gen);
+    if (u != v && !boost::edge(u, v, g).second) {
+      boost::add_edge(u, v, g);
+    }
+  }
+
+  // Brute force: two edges are adjacent iff they share an endpoint.
+  auto edges = gl::to_edgelist(g);
+  std::vector<std::pair<std::size_t, std::size_t>> expected;
+  for (std::size_t i = 0; i < edges.size(); ++i) {
+    for (std::size_t j = i + 1; j < edges.size(); ++j) {
+      auto [a, b] = edges[i];
+      auto [c, d] = edges[j];
+      if (a == c || a == d || b == c || b == d) {
+        expected.emplace_back(i, j);
+      }
+    }
+  }
+
+  auto normalized = [](std::vector<std::pair<std::size_t, std::size_t>> e) {
+    for (auto &[u, v] : e) {
+      if (u > v) {
+        std::swap(u, v);
+      }
+    }
+    std::sort(e.begin(), e.end());
+    return e;
+  };
+
+  auto [lg, v_to_e_map] = gl::line_graph(g);
+  CHECK(boost::num_vertices(lg) == edges.size());
+  CHECK(normalized(gl::to_edgelist(lg)) == expected);
+  CHECK(verify_line_graph(lg, g, v_to_e_map));
+
+  parallel::thread_pool pool(4);
+  auto [parallel_lg, parallel_map] = gl::line_graph(g, &pool);
+  CHECK(gl::to_edgelist(parallel_lg) == gl::to_edgelist(lg));
+
+  gl::CsrGraph csr(g);
+  auto csr_lg = gl::line_graph(csr, &pool);
+  CHECK(csr_lg.num_vertices() == edges.size());
+  CHECK(csr_lg.num_edges() == expected.size());
+  std::vector<std::pair<std::size_t, std::size_t>> csr_edges;
+  for (std::size_t v = 0; v < csr_lg.num_vertices(); ++v) {
+    for (std::size_t nb : csr_lg.neighbors(v)) {
+      if (v < nb) {
+        csr_edges.emplace_back(v, nb);
+      }
+    }
+  }
+  CHECK(normalized(csr_edges) == expected);
+
+  gl::CsrGraph<> directed(3, std::vector<std::pair<int, int>>{{0, 1}}, true);
+  CHECK_THROWS_AS(gl::line_graph(directed), std::invalid_argument);
+}
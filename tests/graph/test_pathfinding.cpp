@@ -4,9 +4,13 @@
 #include "utils_cpp/graph/graph.hpp"
 #include "utils_cpp/graph/library.hpp"
 #include "utils_cpp/graph/pathfinding.hpp"
+#include "utils_cpp/parallel/thread_pool.hpp"
 
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <random>
+#include <set>
 #include <string>
 
 using namespace utils;
@@ -144,3 +148,402 @@ TEST_CASE("test a star with euclidean heuristic") {
                                                     5, 9, 10, 8, 9, 13, 14}));
   }
 }
+
+TEST_CASE("test dijkstra with dense edge map") {
+  auto gb = gl::ibm_hex(2, 2);
+  auto &graph = gb.graph;
+  std::size_t source = 3;
+
+  std::mt19937 rng(0);
+  gl::EdgeMap<int, gl::Graph> weights;
+  for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+    weights[e] = 1 + (rng() & 3);
+  }
+  gl::DenseEdgeMap<int, gl::Graph> dense_weights(graph, weights);
+  REQUIRE(dense_weights.size() == boost::num_edges(graph));
+
+  SUBCASE("matches the EdgeMap version") {
+    auto expected = gl::dijkstra_distances(graph, source, weights);
+    CHECK(gl::dijkstra_distances(graph, source, dense_weights) == expected);
+
+    auto [distances, predecessors] =
+        gl::dijkstra(graph, source, dense_weights);
+    CHECK(distances == expected);
+    for (std::size_t v = 0; v < predecessors.size(); ++v) {
+      if (v != source) {
+        CHECK(distances[predecessors[v]] < distances[v]);
+      }
+    }
+  }
+
+  SUBCASE("all predecessors") {
+    auto [graph, props] = gl::grid(3, 3);
+    gl::DenseEdgeMap<std::size_t, gl::Graph> unit(graph, std::size_t{1});
+
+    auto [distances, predecessors] =
+        gl::dijkstra_all_distances_all_predecessors(graph, 0, unit);
+
+    CHECK(distances == std::vector<std::size_t>{0, 1, 2, 1, 2, 3, 2, 3, 4});
+    std::vector<gl::VertexSet<gl::Graph>> correct_predecessors = {
+        {}, {0}, {1}, {0}, {1, 3}, {2, 4}, {3}, {4, 6}, {5, 7}};
+    CHECK(predecessors == correct_predecessors);
+  }
+
+  SUBCASE("edge map built from a function of the edge") {
+    gl::DenseEdgeMap<std::size_t, gl::Graph> sum(
+        graph, [&](gl::Edge<gl::Graph> e) {
+          return boost::source(e, graph) + boost::target(e, graph);
+        });
+    std::size_t id = 0;
+    for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+      CHECK(sum[id++] == boost::source(e, graph) + boost::target(e, graph));
+    }
+  }
+}
+
+TEST_CASE("test a star with dense location map") {
+  auto [graph, props] = gl::grid(4, 4);
+
+  gl::DenseVertexMap<std::vector<double>, gl::Graph> positions(graph);
+  for (auto v : boost::make_iterator_range(boost::vertices(graph))) {
+    std::vector<double> position = props.vertex["position"][v];
+    positions[v] = position;
+  }
+
+  gl::ManhattanHeuristic<gl::Graph,
+                         gl::DenseVertexMap<std::vector<double>, gl::Graph>,
+                         double>
+      manhattan_heuristic(positions, 15);
+
+  auto [distance, predecessors] =
+      gl::astar_early_stopping(graph, 0, 15, manhattan_heuristic);
+  CHECK(distance == 6);
+}
+
+TEST_CASE("test coordinate heuristics") {
+  auto gb = gl::grid(6, 5);
+  gl::VertexCoordinates coords(gb);
+  REQUIRE(coords.dim() == 2);
+  REQUIRE(coords.size() == 30);
+  CHECK(coords(7, 0) == 2.0);
+  CHECK(coords(7, 1) == 1.0);
+
+  gl::EuclideanCoordinateHeuristic euclidean(coords, 29);
+  gl::ManhattanCoordinateHeuristic manhattan(coords, 29);
+  CHECK(manhattan(0) == 9.0);
+  CHECK(euclidean(0) == doctest::Approx(std::sqrt(16.0 + 25.0)));
+  CHECK(euclidean(29) == 0.0);
+
+  SUBCASE("batch matches single calls") {
+    std::vector<std::size_t> vertices = {3, 0, 29, 17, 8, 8, 21, 1, 14};
+    std::vector<double> out(vertices.size());
+    euclidean(vertices, out);
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+      CHECK(out[i] == euclidean(vertices[i]));
+    }
+    manhattan(vertices, out);
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+      CHECK(out[i] == manhattan(vertices[i]));
+    }
+  }
+
+  SUBCASE("A* on CsrGraph") {
+    gl::CsrGraph<> csr(gb.graph);
+    gl::PathfindingWorkspace<> ws;
+    CHECK(gl::astar_early_stopping(csr, 0, 29, manhattan, ws) == 9);
+    CHECK(ws.path_to(29).size() == 10);
+    // The batch buffer is kept in the workspace for the next query.
+    REQUIRE(!ws.batch_h.empty());
+    const double *batch_h = ws.batch_h.data();
+    gl::ManhattanCoordinateHeuristic to_corner(coords, 4);
+    CHECK(gl::astar_early_stopping(csr, 25, 4, to_corner, ws) == 9);
+    CHECK(ws.batch_h.data() == batch_h);
+  }
+
+  SUBCASE("A* on boost graphs") {
+    auto [distance, predecessors] =
+        gl::astar_early_stopping(gb.graph, 0, 29, manhattan);
+    CHECK(distance == 9);
+  }
+
+  SUBCASE("three dimensions and invalid input") {
+    gl::VertexMap<std::vector<double>> loc = {{0, {0, 0, 0}}, {1, {1, 2, 2}}};
+    gl::VertexCoordinates c3(loc, 2);
+    CHECK(gl::EuclideanCoordinateHeuristic(c3, 1)(0) == 3.0);
+    CHECK_THROWS_AS(gl::VertexCoordinates(2, 4), std::invalid_argument);
+    CHECK_THROWS_AS(c3.set(0, std::vector<double>{1.0}),
+                    std::invalid_argument);
+  }
+}
+
+TEST_CASE("test point to point searches") {
+  auto gb = gl::ibm_hex(2, 2);
+  auto &graph = gb.graph;
+  std::size_t n = boost::num_vertices(graph);
+
+  std::mt19937 rng(2);
+  gl::EdgeMap<int, gl::Graph> weights;
+  for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+    weights[e] = 1 + (rng() & 7);
+  }
+
+  auto check_path = [&](const std::vector<std::size_t> &path,
+                        std::size_t source, std::size_t target) {
+    REQUIRE(!path.empty());
+    CHECK(path.front() == source);
+    CHECK(path.back() == target);
+    for (std::size_t i = 0; i + 1 < path.size(); ++i) {
+      CHECK(boost::edge(path[i], path[i + 1], graph).second);
+    }
+  };
+
+  SUBCASE("undirected graph") {
+    for (std::size_t source : {0, 7}) {
+      auto expected = gl::dijkstra_distances(graph, source, weights);
+      auto hops = gl::bfs_distances(graph, source);
+      for (std::size_t target : {std::size_t{0}, std::size_t{5}, n - 1}) {
+        CHECK(gl::dijkstra_to(graph, source, target, weights).first ==
+              expected[target]);
+        CHECK(gl::dijkstra_to(graph, source, target).first == hops[target]);
+
+        auto [d, path] =
+            gl::bidirectional_dijkstra(graph, source, target, weights);
+        CHECK(d == expected[target]);
+        check_path(path, source, target);
+
+        auto [h, hop_path] = gl::bidirectional_bfs(graph, source, target);
+        CHECK(h == hops[target]);
+        CHECK(hop_path.size() == h + 1);
+        check_path(hop_path, source, target);
+      }
+    }
+  }
+
+  SUBCASE("directed graph") {
+    // 0 -> 1 -> 2 -> 3 and a shortcut 0 -> 3 that only goes one way.
+    gl::DiGraph g(5);
+    gl::EdgeMap<int, gl::DiGraph> w;
+    w[boost::add_edge(0, 1, g).first] = 1;
+    w[boost::add_edge(1, 2, g).first] = 1;
+    w[boost::add_edge(2, 3, g).first] = 1;
+    w[boost::add_edge(0, 3, g).first] = 5;
+    w[boost::add_edge(3, 0, g).first] = 1;
+
+    CHECK(gl::dijkstra_to(g, 0, 3, w).first == 3);
+    CHECK(gl::dijkstra_to(g, 3, 2, w).first == 3);
+    CHECK(gl::dijkstra_to(g, 0, 4, w).first ==
+          std::numeric_limits<int>::max());
+
+    auto [d, path] = gl::bidirectional_dijkstra(g, 3, 2, w);
+    CHECK(d == 3);
+    CHECK(path == std::vector<std::size_t>{3, 0, 1, 2});
+
+    auto [h, hop_path] = gl::bidirectional_bfs(g, 0, 3);
+    CHECK(h == 1);
+    CHECK(hop_path == std::vector<std::size_t>{0, 3});
+
+    auto [none, no_path] = gl::bidirectional_bfs(g, 0, 4);
+    CHECK(none == gl::PathfindingWorkspace<>::unreachable);
+    CHECK(no_path.empty());
+  }
+
+  SUBCASE("reusing workspaces and the reverse graph") {
+    gl::CsrGraph csr(graph, weights);
+    auto reverse = csr.reversed();
+    gl::BidirectionalWorkspace<int> ws;
+    gl::PathfindingWorkspace<int> single;
+    for (std::size_t target = 0; target < n; ++target) {
+      int d = gl::bidirectional_dijkstra(csr, reverse, 2, target, ws);
+      CHECK(d == gl::dijkstra_to(csr, 2, target, single));
+    }
+  }
+}
+
+TEST_CASE("test dijkstra with unsigned integer weights") {
+  auto gb = gl::ibm_hex(2, 2);
+  auto &graph = gb.graph;
+
+  std::mt19937 rng(3);
+  gl::EdgeMap<int, gl::Graph> signed_weights;
+  gl::EdgeMap<unsigned, gl::Graph> small_weights;
+  gl::EdgeMap<unsigned, gl::Graph> zero_one_weights;
+  for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+    signed_weights[e] = 1 + (rng() % 10);
+    small_weights[e] = static_cast<unsigned>(signed_weights[e]);
+    zero_one_weights[e] = rng() & 1;
+  }
+
+  for (std::size_t source : {0, 3, 20}) {
+    // int weights still go through boost, so they serve as the reference.
+    auto expected = gl::dijkstra_distances(graph, source, signed_weights);
+    auto [distances, predecessors] =
+        gl::dijkstra(graph, source, small_weights);
+    for (std::size_t v = 0; v < distances.size(); ++v) {
+      CHECK(distances[v] == static_cast<unsigned>(expected[v]));
+      if (v != source) {
+        auto e = boost::edge(predecessors[v], v, graph).first;
+        CHECK(distances[predecessors[v]] + small_weights.at(e) == distances[v]);
+      }
+    }
+    CHECK(gl::dijkstra_predecessors(graph, source, small_weights) ==
+          predecessors);
+
+    gl::EdgeMap<int, gl::Graph> zero_one_reference;
+    for (auto [e, w] : zero_one_weights) {
+      zero_one_reference[e] = static_cast<int>(w);
+    }
+    auto expected01 =
+        gl::dijkstra_distances(graph, source, zero_one_reference);
+    auto distances01 = gl::dijkstra_distances(graph, source, zero_one_weights);
+    for (std::size_t v = 0; v < distances01.size(); ++v) {
+      CHECK(distances01[v] == static_cast<unsigned>(expected01[v]));
+    }
+  }
+
+  SUBCASE("unreachable vertices") {
+    gl::DiGraph g(3);
+    gl::EdgeMap<std::size_t, gl::DiGraph> w;
+    w[boost::add_edge(0, 1, g).first] = 7;
+    auto [d, p] = gl::dijkstra(g, 0, w);
+    CHECK(d == std::vector<std::size_t>{
+                   0, 7, gl::PathfindingWorkspace<>::unreachable});
+    CHECK(p == std::vector<std::size_t>{0, 0, 2});
+  }
+}
+
+TEST_CASE("test shortest path dag") {
+  std::size_t rows = 4, cols = 5;
+  auto [graph, props] = gl::grid(rows, cols);
+  std::size_t target = rows * cols - 1;
+
+  auto dag = gl::shortest_path_dag(graph, 0);
+
+  SUBCASE("agrees with all predecessors") {
+    auto [distances, predecessors] =
+        gl::dijkstra_all_distances_all_predecessors(graph, 0);
+    CHECK(dag.distances == distances);
+    for (std::size_t v = 0; v < boost::num_vertices(graph); ++v) {
+      auto preds = dag.predecessors(v);
+      CHECK(gl::VertexSet<gl::Graph>(preds.begin(), preds.end()) ==
+            predecessors[v]);
+    }
+  }
+
+  SUBCASE("path counts") {
+    // Monotone lattice paths: binomial(3 + 4, 3).
+    CHECK(dag.num_paths(0) == 1);
+    CHECK(dag.num_paths(target) == 35);
+    CHECK(dag.num_paths(cols) == 1);
+  }
+
+  SUBCASE("enumerates every shortest path once") {
+    std::set<std::vector<std::size_t>> seen;
+    for (const auto &path : dag.paths(target)) {
+      REQUIRE(path.size() == dag.distances[target] + 1);
+      CHECK(path.front() == 0);
+      CHECK(path.back() == target);
+      for (std::size_t i = 1; i < path.size(); ++i) {
+        CHECK(boost::edge(path[i - 1], path[i], graph).second);
+      }
+      seen.insert(path);
+    }
+    CHECK(seen.size() == dag.num_paths(target));
+
+    auto source_paths = dag.paths(0);
+    CHECK(std::ranges::distance(source_paths) == 1);
+  }
+
+  SUBCASE("zero weights and unreachable vertices") {
+    gl::DiGraph g(4);
+    gl::EdgeMap<double, gl::DiGraph> w;
+    w[boost::add_edge(0, 1, g).first] = 0.0;
+    w[boost::add_edge(1, 0, g).first] = 0.0;
+    w[boost::add_edge(0, 2, g).first] = 1.0;
+    w[boost::add_edge(1, 2, g).first] = 1.0;
+
+    auto zero_dag = gl::shortest_path_dag(g, 0, w);
+    CHECK(zero_dag.predecessors(0).empty());
+    CHECK(zero_dag.num_paths(1) == 1);
+    CHECK(zero_dag.num_paths(2) == 2);
+    CHECK(!zero_dag.reachable(3));
+    CHECK(zero_dag.num_paths(3) == 0);
+    auto none = zero_dag.paths(3);
+    CHECK(none.begin() == none.end());
+  }
+}
+
+TEST_CASE("test delta stepping") {
+  // A random graph with a few unreachable vertices, large enough for the
+  // rounds to be split across the pool.
+  std::size_t n = 20000;
+  std::mt19937 rng(4);
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  for (std::size_t i = 0; i < 4 * n; ++i) {
+    edges.emplace_back(rng() % (n - 10), rng() % (n - 10));
+  }
+  std::vector<double> real_weights;
+  std::vector<unsigned> small_weights;
+  for (std::size_t i = 0; i < edges.size(); ++i) {
+    real_weights.push_back(std::uniform_real_distribution<>(0.1, 10.0)(rng));
+    small_weights.push_back(rng() % 4);
+  }
+  parallel::thread_pool pool(3);
+
+  SUBCASE("unique shortest paths match dijkstra") {
+    for (bool directed : {false, true}) {
+      gl::CsrGraph<double> g(n, edges, real_weights, directed);
+      auto expected = gl::dijkstra(g, 0);
+      for (double delta : {0.0, 0.5, 50.0}) {
+        for (auto *p : {static_cast<parallel::thread_pool *>(nullptr), &pool}) {
+          CHECK(gl::delta_stepping(g, 0, delta, p) == expected);
+        }
+      }
+    }
+  }
+
+  SUBCASE("ties and zero weights") {
+    constexpr unsigned unreachable = std::numeric_limits<unsigned>::max();
+    gl::CsrGraph<unsigned> g(n, edges, small_weights);
+    auto expected = gl::dijkstra_distances(g, 7);
+    for (unsigned delta : {0u, 1u, 100u}) {
+      auto [dist, pred] = gl::delta_stepping(g, 7, delta, &pool);
+      CHECK(dist == expected);
+      CHECK(gl::delta_stepping(g, 7, delta) == std::pair{dist, pred});
+      for (std::size_t v = 0; v < n; ++v) {
+        if (v == 7 || dist[v] == unreachable) {
+          CHECK(pred[v] == v);
+          continue;
+        }
+        // Following predecessors reaches the source along tight arcs.
+        std::size_t steps = 0;
+        for (std::size_t u = v; u != 7; u = pred[u], ++steps) {
+          REQUIRE(steps < n);
+          REQUIRE(pred[u] != u);
+          CHECK(dist[pred[u]] <= dist[u]);
+        }
+      }
+    }
+  }
+
+  SUBCASE("unweighted graphs") {
+    gl::CsrGraph<std::size_t> g(n, edges);
+    auto expected = gl::dijkstra(g, 3);
+    CHECK(gl::delta_stepping(g, std::size_t{3}, std::size_t{0}, &pool)
+              .first == expected.first);
+    CHECK(gl::dijkstra_distances(g, 3, &pool) == expected.first);
+  }
+
+  SUBCASE("engine switch by size") {
+    std::vector<std::pair<std::size_t, std::size_t>> many;
+    for (std::size_t i = 0; i < gl::delta_stepping_min_arcs; ++i) {
+      many.emplace_back(rng() % n, rng() % n);
+    }
+    std::vector<double> w(many.size());
+    for (auto &x : w) {
+      x = std::uniform_real_distribution<>(0.0, 1.0)(rng);
+    }
+    gl::CsrGraph<double> g(n, many, w, true);
+    REQUIRE(g.num_arcs() >= gl::delta_stepping_min_arcs);
+    CHECK(gl::dijkstra_distances(g, 0, &pool) == gl::dijkstra_distances(g, 0));
+  }
+}
@@ -1,8 +1,12 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
+#include "utils_cpp/flat_hash_map.hpp"
 #include "utils_cpp/graph/properties.hpp"
 
+#include <utility>
+#include <variant>
+
 /*
  * For some reason, Doctest's CHECK does not like operator== for PropMaps, so
  * instead we move the equality check out of doctest's CHECK macro.
@@ -95,3 +99,136 @@ TEST_CASE("test to json") {
   CHECK(ss.str() == "{\"name\":\"chimera\",\"size\":8.0,\"vertices\":[0.0,1.0,"
                     "2.0,3.0,4.0,5.0,6.0,7.0]}");
 }
+
+TEST_CASE("columnar vertex properties") {
+
+  utils::gl::Graph g(4);
+  utils::gl::Properties p(g);
+
+  SUBCASE("scalar column from dense vertex map") {
+    p.vertex["weight"] = utils::gl::DenseVertexMap<int>(g, 1);
+    CHECK(p.vertex["weight"].is_columnar());
+
+    p.vertex["weight"][2] = 5;
+    double w = p.vertex["weight"][2];
+    CHECK(w == 5.0);
+    CHECK(p.vertex["weight"][2] == 5);
+
+    bool check = p.vertex["weight"] ==
+                 utils::gl::VertexMap<double>{{0, 1}, {1, 1}, {2, 5}, {3, 1}};
+    CHECK(check);
+  }
+
+  SUBCASE("vector column keeps values when lengths change") {
+    utils::gl::DenseVertexMap<std::vector<double>> pos(g);
+    for (std::size_t v = 0; v < 4; ++v) {
+      pos[v] = {double(v), double(v)};
+    }
+    p.vertex["position"] = pos;
+    CHECK(p.vertex["position"].is_columnar());
+
+    p.vertex["position"][1] = std::vector<double>{7, 8, 9};
+    p.vertex["position"][2] = std::vector<int>{};
+
+    CHECK(p.vertex["position"][0] == std::vector<double>{0, 0});
+    CHECK(p.vertex["position"][1] == std::vector<double>{7, 8, 9});
+    CHECK(p.vertex["position"][2].get<std::vector<double>>().empty());
+    CHECK(p.vertex["position"][3] == std::vector<double>{3, 3});
+
+    p.vertex["position"][3].values()[0] = -1;
+    CHECK(p.vertex["position"][3] == std::vector<double>{-1, 3});
+
+    auto m = p.vertex["position"].to_map<std::vector<double>>();
+    CHECK(m.size() == 4);
+    CHECK(m[1] == std::vector<double>{7, 8, 9});
+  }
+
+  SUBCASE("columns and maps convert to maps of other number types") {
+    utils::gl::DenseVertexMap<int> weight(g);
+    utils::gl::DenseVertexMap<std::vector<float>> pos(g);
+    for (std::size_t v = 0; v < 4; ++v) {
+      weight[v] = static_cast<int>(v) - 1;
+      pos[v] = std::vector<float>(v, 0.5f);
+    }
+    p.vertex["weight"] = weight;
+    p.vertex["position"] = pos;
+    p.vertex["count"] = utils::gl::VertexMap<std::size_t>{{1, 7}, {3, 9}};
+    REQUIRE(p.vertex["weight"].is_columnar());
+    REQUIRE(p.vertex["position"].is_columnar());
+    REQUIRE(!p.vertex["count"].is_columnar());
+
+    const auto &vertex = std::as_const(p.vertex);
+    auto weights = vertex["weight"].to_map<int>();
+    auto positions = vertex["position"].to_map<std::vector<float>>();
+    auto counts = vertex["count"].to_map<std::size_t>();
+    REQUIRE(weights.size() == 4);
+    REQUIRE(positions.size() == 4);
+    for (std::size_t v = 0; v < 4; ++v) {
+      CHECK(weights.at(v) == weight[v]);
+      CHECK(positions.at(v) == pos[v]);
+    }
+    CHECK(counts == utils::gl::VertexMap<std::size_t>{{1, 7}, {3, 9}});
+    CHECK_THROWS_AS(vertex["count"].to_map<std::vector<int>>(),
+                    std::bad_variant_access);
+
+    // Back into a property and out again.
+    p.vertex.assign("weight_map", weights);
+    CHECK(vertex["weight_map"].to_map<int>() == weights);
+  }
+
+  SUBCASE("make columnar") {
+    p.vertex["d"] = utils::gl::VertexMap<double>{{1, 2.5}};
+    p.vertex["s"] = utils::gl::VertexMap<std::string>{{1, "a"}};
+
+    p.vertex["d"].make_columnar(4);
+    CHECK(p.vertex["d"].is_columnar());
+    CHECK(p.vertex["d"].size() == 4);
+    CHECK(p.vertex["d"][0] == 0.0);
+    CHECK(p.vertex["d"][1] == 2.5);
+
+    CHECK_THROWS_AS(p.vertex["s"].make_columnar(4), std::invalid_argument);
+  }
+
+  SUBCASE("copy between columnar and map properties") {
+    p.vertex["a"] = utils::gl::DenseVertexMap<double>(g, 3.0);
+    p.vertex["b"][0] = p.vertex["a"][0];
+    CHECK(!p.vertex["b"].is_columnar());
+    CHECK(p.vertex["b"][0] == 3.0);
+    CHECK(p.vertex["b"][0] == p.vertex["a"][0]);
+  }
+
+  SUBCASE("to json") {
+    p.vertex["w"] = utils::gl::DenseVertexMap<double>(g, 0.5);
+    nlohmann::json j = p.vertex.to_json();
+    std::stringstream ss;
+    ss << j;
+    CHECK(ss.str() == "{\"w\":[[0,0.5],[1,0.5],[2,0.5],[3,0.5]]}");
+  }
+}
+
+TEST_CASE("flat hash property maps and sets") {
+  using namespace utils;
+  auto g = gl::detail::graph_from_edges(
+      4, std::vector<std::pair<int, int>>{{0, 1}, {1, 2}, {2, 3}, {3, 0}});
+
+  gl::EdgeMap<double, gl::Graph, boost::undirectedS, FlatHashMap> weights;
+  gl::EdgeSet<gl::Graph, boost::undirectedS, FlatHashSet> edges;
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    weights[e] = static_cast<double>(boost::source(e, g));
+    edges.insert(e);
+  }
+  CHECK(weights.size() == 4);
+  // Undirected edges match in either orientation.
+  auto e = boost::edge(1, 0, g).first;
+  CHECK(weights.at(e) == 0.0);
+  CHECK(edges.contains(e));
+
+  gl::VertexSet<gl::Graph, FlatHashSet> vertices;
+  gl::VertexMap<int, gl::Graph, FlatHashMap> degree;
+  for (auto v : boost::make_iterator_range(boost::vertices(g))) {
+    vertices.insert(v);
+    degree[v] = static_cast<int>(boost::degree(v, g));
+  }
+  CHECK(vertices.size() == 4);
+  CHECK(degree.at(2) == 2);
+}
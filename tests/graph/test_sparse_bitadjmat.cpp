@@ -0,0 +1,92 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/sparse_bitadjmat.hpp"
+
+using namespace utils;
+
+TEST_CASE("edge iteration matches BitAdjmat") {
+
+  auto gb = gl::grid(3, 3);
+  auto &g = gb.graph;
+
+  gl::BitAdjmat dense(g);
+  gl::SparseBitAdjmat sparse(g);
+
+  std::stringstream ss, ss2, ss3;
+  for (auto edge : dense.edge_range()) {
+    ss << edge.first << edge.second << ' ';
+  }
+  for (auto edge : sparse.edge_range()) {
+    ss2 << edge.first << edge.second << ' ';
+  }
+  for (auto [ei, end] = sparse.edges(); ei != end; ++ei) {
+    ss3 << ei->first << ei->second << ' ';
+  }
+
+  CHECK(ss.str() == ss2.str());
+  CHECK(ss.str() == ss3.str());
+  CHECK(sparse.num_edges() == dense.num_edges());
+  CHECK(sparse.to_bitadjmat() == dense);
+  CHECK(gl::SparseBitAdjmat(dense) == sparse);
+}
+
+TEST_CASE("row iteration, set and reset") {
+  gl::SparseBitAdjmat mat(5);
+  mat.set(0, 3);
+  mat.set(0, 1);
+  mat.set(2, 2);
+
+  std::stringstream ss;
+  for (auto nb : mat[0]) {
+    ss << nb << ' ';
+  }
+  CHECK(ss.str() == "1 3 ");
+  CHECK(mat[0].size() == 5);
+  CHECK(mat.get(3, 0));
+  CHECK(mat.degree(0) == 2);
+  CHECK(mat.count_ones() == 5);
+
+  mat.reset(0, 3);
+  CHECK_FALSE(mat.get(0, 3));
+  CHECK_FALSE(mat[3].contains(0));
+
+  std::stringstream ss2;
+  for (auto [i, j] : mat.edge_range()) {
+    ss2 << i << j << ' ';
+  }
+  CHECK(ss2.str() == "01 22 ");
+}
+
+TEST_CASE("large sparse graph") {
+  const std::size_t n = 100000;
+  gl::SparseBitAdjmat mat(n);
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<std::size_t> dist(0, n - 1);
+  for (std::size_t k = 0; k < 300000; ++k) {
+    std::size_t i = dist(rng), j = dist(rng);
+    if (i != j) {
+      mat.set(i, j);
+    }
+  }
+  // far below the n^2 / 8 = 1.25 GB of a BitAdjmat
+  CHECK(mat.memory_bytes() < 64 * 1024 * 1024);
+
+  std::size_t edges = 0;
+  for ([[maybe_unused]] auto e : mat.edge_range()) {
+    ++edges;
+  }
+  CHECK(edges == mat.num_edges());
+
+  std::size_t common = 0;
+  for (auto nb : mat[0]) {
+    common += mat[1].contains(nb);
+  }
+  CHECK(gl::popcount_and(mat[0], mat[1]) == common);
+  CHECK(gl::popcount_andnot(mat[0], mat[1]) == mat.degree(0) - common);
+}
@@ -0,0 +1,102 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "utils_cpp/graph/algorithms.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/static_bitadjmat.hpp"
+
+using namespace utils;
+
+// Built and queried entirely at compile time.
+constexpr auto grid_3x4 = gl::static_grid<3, 4>();
+static_assert(grid_3x4.num_edges() == 17);
+static_assert(grid_3x4.degree(0) == 2 && grid_3x4.degree(5) == 4);
+static_assert(grid_3x4.bfs(0)[11] == 5);
+static_assert(grid_3x4.is_connected());
+static_assert(grid_3x4.triangle_count() == 0);
+static_assert(gl::static_complete<5>().triangle_count() == 10);
+static_assert(gl::static_ring<70>().bfs(0)[35] == 35);
+static_assert(!(gl::static_path<3>() | gl::StaticBitAdjmat<3>()).get(0, 2));
+static_assert(
+    [] {
+      constexpr std::array<std::pair<std::size_t, std::size_t>, 2> edges = {
+          {{0, 1}, {2, 3}}};
+      gl::StaticBitAdjmat<4> g(edges);
+      return !g.is_connected() && g.bfs(0)[3] == g.unreachable;
+    }());
+
+TEST_CASE("static generators match the library") {
+  CHECK(gl::static_grid<5, 7>().to_bitadjmat() ==
+        gl::BitAdjmat(gl::grid(5, 7).graph));
+  CHECK(gl::static_ring<100>().to_bitadjmat() ==
+        gl::BitAdjmat(gl::ring(100).graph));
+  CHECK(gl::static_complete<65>().to_bitadjmat() ==
+        gl::BitAdjmat(gl::complete(65).graph));
+}
+
+TEST_CASE("StaticBitAdjmat agrees with BitAdjmat") {
+  constexpr std::size_t n = 130; // three words per row, the last partial
+  std::mt19937 rng(4);
+  std::vector<std::pair<std::size_t, std::size_t>> edges;
+  for (int k = 0; k < 1500; ++k) {
+    edges.emplace_back(rng() % n, rng() % n);
+  }
+  gl::BitAdjmat dense(n, edges);
+  gl::StaticBitAdjmat<n> fixed(edges);
+  CHECK(gl::StaticBitAdjmat<n>(dense) == fixed);
+  CHECK(fixed.to_bitadjmat() == dense);
+
+  CHECK(fixed.count_ones() == dense.count_ones());
+  CHECK(fixed.num_edges() == dense.num_edges());
+  CHECK(fixed.triangle_count() == dense.triangle_count());
+  for (std::size_t i = 0; i < n; i += 7) {
+    CHECK(fixed.degree(i) == dense.degree(static_cast<int>(i)));
+    for (std::size_t j = 0; j < n; j += 5) {
+      CHECK(fixed.get(i, j) == dense.get(i, j));
+      CHECK(fixed.common_neighbors_count(i, j) ==
+            dense.common_neighbors_count(i, j));
+    }
+  }
+
+  // The product need not be symmetric, so compare it entry by entry.
+  auto product = fixed.matmul(~fixed);
+  auto expected = dense.matmul(~dense);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < n; ++j) {
+      CHECK(product.get(i, j) == expected.get(i, j));
+    }
+  }
+  CHECK((~fixed).count_ones() == (~dense).count_ones());
+  CHECK(((fixed ^ ~fixed).count_ones()) == n * n);
+  CHECK((fixed & ~fixed) == gl::StaticBitAdjmat<n>());
+
+  auto distances = gl::all_pairs_bfs(dense);
+  for (std::size_t s : {0, 17, 129}) {
+    auto d = fixed.bfs(s);
+    for (std::size_t v = 0; v < n; ++v) {
+      CHECK(d[v] == distances(s, v));
+    }
+  }
+
+  std::vector<std::pair<std::size_t, std::size_t>> seen;
+  fixed.for_each_edge([&](std::size_t i, std::size_t j) {
+    seen.emplace_back(i, j);
+  });
+  std::vector<std::pair<std::size_t, std::size_t>> expected_edges;
+  for (auto edge : dense.edge_range()) {
+    expected_edges.push_back(edge);
+  }
+  CHECK(seen == expected_edges);
+
+  CHECK_THROWS_AS(gl::StaticBitAdjmat<n>(gl::BitAdjmat(n + 1)),
+                  std::invalid_argument);
+  std::vector<std::pair<std::size_t, std::size_t>> bad = {{0, n}};
+  CHECK_THROWS_AS(gl::StaticBitAdjmat<n>{bad}, std::out_of_range);
+}
@@ -1,7 +1,9 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
+#include "utils_cpp/graph/bitadjmat.hpp"
 #include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
 #include "utils_cpp/graph/transforms.hpp"
 
 using namespace utils;
@@ -34,6 +36,26 @@ TEST_CASE("test remove edges") {
                  0.9) < 0.1);
 }
 
+TEST_CASE("remove edges from a multigraph") {
+  // A 4-cycle with vertex 4 hanging off vertex 3 by two parallel edges.
+  gl::GraphBundle gb;
+  for (auto [u, v] : std::vector<std::pair<std::size_t, std::size_t>>{
+           {0, 1}, {1, 2}, {2, 3}, {3, 0}, {3, 4}, {3, 4}}) {
+    boost::add_edge(u, v, gb.graph);
+  }
+
+  for (unsigned seed = 0; seed < 50; ++seed) {
+    auto pruned = gl::rand_prune_edges_connected(gb, std::size_t{1}, seed);
+    std::vector<std::size_t> component(5);
+    CHECK(boost::connected_components(pruned.graph, component.data()) == 1);
+    CHECK(boost::num_edges(pruned.graph) == 5);
+  }
+  // Removing both parallel edges would disconnect vertex 4, so only one
+  // edge of the cycle can go.
+  CHECK_THROWS_AS(gl::rand_prune_edges_connected(gb, std::size_t{2}, 0u),
+                  std::invalid_argument);
+}
+
 TEST_CASE("test remove vertices") {
   auto gb = gl::grid(9, 9);
 
@@ -154,3 +176,279 @@ TEST_CASE("gl::relabel_vertices") {
     CHECK(boost::edge(2, 3, new_g).second);
   }
 }
+
+TEST_CASE("remove_vertices moves properties") {
+
+  auto gb = gl::grid(3, 3);
+  gb.props.vertex["position"].make_columnar(9);
+  gl::VertexMap<double> label;
+  for (std::size_t v = 0; v < 9; ++v) {
+    label[v] = 10.0 * v;
+  }
+  gb.props.vertex["label"] = label;
+  gl::EdgeMap<double> weight;
+  for (auto e : boost::make_iterator_range(boost::edges(gb.graph))) {
+    weight[e] = boost::source(e, gb.graph) + boost::target(e, gb.graph);
+  }
+  gb.props.edge["weight"] = weight;
+
+  auto new_gb = gl::remove_vertices(gb, {0, 1, 3, 5});
+
+  // Kept vertices 2, 4, 6, 7, 8 become 0 .. 4.
+  std::vector<std::size_t> old_of = {2, 4, 6, 7, 8};
+
+  CHECK(new_gb.props.vertex["position"].is_columnar());
+  gl::VertexMap<std::vector<double>> old_pos =
+      gb.props.vertex["position"].to_map<std::vector<double>>();
+  gl::VertexMap<std::vector<double>> new_pos =
+      new_gb.props.vertex["position"].to_map<std::vector<double>>();
+  gl::VertexMap<double> new_label = new_gb.props.vertex["label"];
+  for (std::size_t v = 0; v < old_of.size(); ++v) {
+    CHECK(new_pos.at(v) == old_pos.at(old_of[v]));
+    CHECK(new_label.at(v) == 10.0 * old_of[v]);
+  }
+
+  gl::EdgeMap<double> new_weight = new_gb.props.edge["weight"];
+  CHECK(new_weight.size() == 3);
+  for (auto e : boost::make_iterator_range(boost::edges(new_gb.graph))) {
+    CHECK(new_weight.at(e) == old_of[boost::source(e, new_gb.graph)] +
+                                  old_of[boost::target(e, new_gb.graph)]);
+  }
+
+  CHECK(new_gb["num_vertices"] == 5.0);
+  CHECK(new_gb["num_edges"] == 3.0);
+}
+
+TEST_CASE("transforms share properties they do not change") {
+
+  auto gb = gl::grid(4, 4);
+  gl::VertexMap<double> label;
+  for (std::size_t v = 0; v < 16; ++v) {
+    label[v] = 10.0 * v;
+  }
+  gb.props.vertex.assign("label", label);
+  gb.props.graph.assign("name", "grid");
+
+  SUBCASE("copies share until written") {
+    gl::GraphBundle copy = gb;
+    CHECK(copy.props.vertex.shares("label", gb.props.vertex));
+    CHECK(copy.props.graph.shares("name", gb.props.graph));
+
+    copy.props.vertex["label"].set(0, -1.0);
+    CHECK_FALSE(copy.props.vertex.shares("label", gb.props.vertex));
+    CHECK(copy.props.graph.shares("name", gb.props.graph));
+
+    const auto &original = gb.props.vertex;
+    CHECK(original["label"].to_map<double>().at(0) == 0.0);
+    CHECK(std::as_const(copy.props.vertex)["label"].to_map<double>().at(0) ==
+          -1.0);
+  }
+
+  SUBCASE("remove_edges keeps vertex properties") {
+    auto new_gb = gl::remove_edges(gb, {{0, 1}});
+    CHECK(new_gb.props.vertex.shares("label", gb.props.vertex));
+    CHECK(new_gb.props.vertex.shares("position", gb.props.vertex));
+    CHECK(new_gb.props.graph.shares("name", gb.props.graph));
+    CHECK_FALSE(gb.props.graph.contains("removed_edges"));
+  }
+
+  SUBCASE("references taken before a copy do not reach the copy") {
+    auto &held = gb.props.vertex["label"];
+    auto new_gb = gl::remove_edges(gb, {{0, 1}});
+    CHECK_FALSE(new_gb.props.vertex.shares("label", gb.props.vertex));
+    held.set(0, -42.0);
+    CHECK(std::as_const(new_gb.props.vertex)["label"].to_map<double>().at(
+              0) == 0.0);
+    CHECK(std::as_const(gb.props.vertex)["label"].to_map<double>().at(0) ==
+          -42.0);
+
+    // Copies of the copy share again, and assign() makes the original's
+    // property shareable again.
+    gl::GraphBundle copy = new_gb;
+    CHECK(copy.props.vertex.shares("label", new_gb.props.vertex));
+    gb.props.vertex.assign("label", label);
+    gl::GraphBundle copy2 = gb;
+    CHECK(copy2.props.vertex.shares("label", gb.props.vertex));
+  }
+
+  SUBCASE("iterating a non-const map stops sharing") {
+    for (auto &&[key, prop] : gb.props.graph) {
+      (void)key;
+      (void)prop;
+    }
+    gl::GraphBundle copy = gb;
+    CHECK_FALSE(copy.props.graph.shares("name", gb.props.graph));
+    CHECK(copy.props.vertex.shares("label", gb.props.vertex));
+  }
+
+  SUBCASE("remove_vertices keeps graph properties") {
+    auto new_gb = gl::remove_vertices(gb, {0});
+    CHECK(new_gb.props.graph.shares("name", gb.props.graph));
+    CHECK_FALSE(new_gb.props.vertex.shares("label", gb.props.vertex));
+    CHECK_FALSE(gb.props.graph.contains("removed_vertices"));
+  }
+}
+
+TEST_CASE("relabel_vertices with an index vector") {
+
+  auto gb = gl::grid(2, 3);
+  gb.props.vertex["position"].make_columnar(6);
+  std::vector<std::size_t> new_index = {5, 4, 3, 2, 1, 0};
+
+  gl::Graph g = gl::relabel_vertices(gb.graph, new_index);
+  CHECK(boost::num_edges(g) == boost::num_edges(gb.graph));
+  for (auto e : boost::make_iterator_range(boost::edges(gb.graph))) {
+    CHECK(boost::edge(new_index[boost::source(e, gb.graph)],
+                      new_index[boost::target(e, gb.graph)], g)
+              .second);
+  }
+
+  auto new_gb = gl::relabel_vertices(gb, new_index);
+  CHECK(boost::num_edges(new_gb.graph) == boost::num_edges(gb.graph));
+  gl::VertexMap<std::vector<double>> old_pos =
+      gb.props.vertex["position"].to_map<std::vector<double>>();
+  gl::VertexMap<std::vector<double>> new_pos =
+      new_gb.props.vertex["position"].to_map<std::vector<double>>();
+  for (std::size_t v = 0; v < 6; ++v) {
+    CHECK(new_pos.at(new_index[v]) == old_pos.at(v));
+  }
+
+  new_index[2] = gl::unmapped_vertex;
+  CHECK_THROWS(gl::relabel_vertices(gb.graph, new_index));
+}
+
+TEST_CASE("gl::contiguize") {
+
+  gl::Graph g(5);
+  boost::add_edge(0, 2, g);
+  boost::add_edge(2, 4, g);
+
+  auto [h, reverse_mapping] = gl::contiguize(g);
+
+  CHECK(boost::num_vertices(h) == 3);
+  CHECK(boost::edge(0, 1, h).second);
+  CHECK(boost::edge(1, 2, h).second);
+  CHECK(reverse_mapping.at(2) == 4);
+}
+
+namespace {
+
+bool is_permutation(const std::vector<std::size_t> &new_index) {
+  std::vector<bool> seen(new_index.size(), false);
+  for (auto i : new_index) {
+    if (i >= new_index.size() || seen[i]) {
+      return false;
+    }
+    seen[i] = true;
+  }
+  return true;
+}
+
+std::size_t bandwidth(const gl::Graph &g) {
+  std::size_t b = 0;
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    auto u = boost::source(e, g);
+    auto v = boost::target(e, g);
+    b = std::max(b, u > v ? u - v : v - u);
+  }
+  return b;
+}
+
+} // namespace
+
+TEST_CASE("vertex reordering") {
+
+  // A shuffled grid, a path and an isolated vertex.
+  gl::Graph g = gl::grid(12, 12).graph;
+  for (std::size_t v = 144; v < 150; ++v) {
+    boost::add_edge(v, v + 1, g);
+  }
+  boost::add_vertex(g);
+  g = gl::shuffle_vertex_labels(g, 7u);
+
+  for (auto method : {gl::VertexOrder::rcm, gl::VertexOrder::bfs,
+                      gl::VertexOrder::degree, gl::VertexOrder::gorder}) {
+    auto [h, new_index] = gl::reorder_vertices(g, method);
+    CHECK(is_permutation(new_index));
+    CHECK(new_index.size() == boost::num_vertices(g));
+    CHECK(boost::num_edges(h) == boost::num_edges(g));
+
+    gl::BitAdjmat adjmat(g);
+    adjmat.permute(new_index);
+    CHECK(adjmat == gl::BitAdjmat(h));
+  }
+
+  SUBCASE("rcm has small bandwidth") {
+    CHECK(bandwidth(g) > 50);
+    auto [h, new_index] = gl::reorder_vertices(g, gl::VertexOrder::rcm);
+    CHECK(bandwidth(h) <= 13);
+  }
+
+  SUBCASE("rcm over many components") {
+    // 3000 disjoint edges and 4000 isolated vertices.
+    gl::Graph many(10000);
+    for (std::size_t v = 0; v < 6000; v += 2) {
+      boost::add_edge(v, v + 1, many);
+    }
+    many = gl::shuffle_vertex_labels(many, 3u);
+    auto [h, new_index] = gl::reorder_vertices(many, gl::VertexOrder::rcm);
+    CHECK(is_permutation(new_index));
+    CHECK(bandwidth(h) == 1);
+  }
+
+  SUBCASE("bfs order follows distances") {
+    auto new_index = gl::bfs_order(g, 5);
+    CHECK(new_index[5] == 0);
+    gl::Graph h = gl::relabel_vertices(g, new_index);
+    auto distances = gl::bfs_distances(h, 0);
+    for (std::size_t v = 1; v < 144; ++v) {
+      CHECK(distances[v - 1] <= distances[v]);
+    }
+  }
+
+  SUBCASE("degree order") {
+    auto [h, new_index] = gl::reorder_vertices(g, gl::VertexOrder::degree);
+    for (std::size_t v = 1; v < boost::num_vertices(h); ++v) {
+      CHECK(boost::degree(v - 1, h) >= boost::degree(v, h));
+    }
+  }
+}
+
+TEST_CASE("gorder keeps cliques together") {
+
+  // Five disjoint 4-cliques, with shuffled labels.
+  gl::Graph g(20);
+  for (std::size_t c = 0; c < 20; c += 4) {
+    for (std::size_t u = c; u < c + 4; ++u) {
+      for (std::size_t v = u + 1; v < c + 4; ++v) {
+        boost::add_edge(u, v, g);
+      }
+    }
+  }
+  std::mt19937_64 gen(3);
+  auto shuffle = utils::shuffled_iota(20, gen);
+  g = gl::relabel_vertices(g, shuffle);
+
+  auto new_index = gl::gorder(g, 3);
+  CHECK(is_permutation(new_index));
+  for (std::size_t v = 0; v < 20; ++v) {
+    // The clique of shuffled vertex shuffle[v] is v / 4.
+    CHECK(new_index[shuffle[v]] / 4 == new_index[shuffle[v - v % 4]] / 4);
+  }
+}
+
+TEST_CASE("reorder_vertices moves bundle properties") {
+
+  auto gb = gl::grid(5, 4);
+  gb.props.vertex["position"].make_columnar(20);
+
+  auto [new_gb, new_index] = gl::reorder_vertices(gb, gl::VertexOrder::gorder);
+
+  gl::VertexMap<std::vector<double>> old_pos =
+      gb.props.vertex["position"].to_map<std::vector<double>>();
+  gl::VertexMap<std::vector<double>> new_pos =
+      new_gb.props.vertex["position"].to_map<std::vector<double>>();
+  for (std::size_t v = 0; v < 20; ++v) {
+    CHECK(new_pos.at(new_index[v]) == old_pos.at(v));
+  }
+}
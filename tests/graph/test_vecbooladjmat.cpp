@@ -4,9 +4,11 @@
 #include "utils_cpp/graph/library.hpp"
 #include "utils_cpp/graph/vecbooladjmat.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 using namespace utils;
 
@@ -219,3 +221,68 @@ TEST_CASE("test setting") {
   }
   CHECK(ss.str() == "0");
 }
+
+TEST_CASE("degree and bitwise operations") {
+
+  // 70 vertices, so rows span two words.
+  auto gb = gl::grid(7, 10);
+  auto &g = gb.graph;
+
+  gl::VecBoolAdjmat a(g);
+
+  // count_edges(v) is the number of neighbors, not the sum of their indices.
+  CHECK(a.count_edges(0) == 2);
+  CHECK(a.count_edges(11) == 4);
+  CHECK(a.count_edges() == boost::num_edges(g));
+
+  // The bitwise operations cover every entry, not only the first row.
+  gl::VecBoolAdjmat b(70);
+  b.set(69, 68, true);
+  b.set(68, 69, true);
+
+  auto c = a;
+  c ^= b;
+  CHECK(c.get(69, 68) == false);
+  CHECK(c.get(68, 69) == false);
+  CHECK(c.count_ones() == a.count_ones() - 2);
+
+  c |= b;
+  CHECK(c == a);
+
+  c &= b;
+  CHECK(c == b);
+
+  gl::VecBoolAdjmat d(70);
+  d.flip();
+  CHECK(d.count_ones() == 70 * 70);
+}
+
+TEST_CASE("printing past the first 64 columns") {
+  gl::VecBoolAdjmat m(70);
+  m.set(0, 65, true);
+  m.set(65, 0, true);
+  m.set(66, 1, true);
+  m.set(69, 69, true);
+
+  std::stringstream ss;
+  ss << m;
+
+  std::vector<std::string> rows;
+  std::string line;
+  while (std::getline(ss, line)) {
+    line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
+    rows.push_back(line);
+  }
+  REQUIRE(rows.size() == 70);
+  for (std::size_t i = 0; i < 70; ++i) {
+    REQUIRE(rows[i].size() == 70);
+    for (std::size_t j = 0; j < 70; ++j) {
+      CHECK((rows[i][j] == '1') == m.get(i, j));
+    }
+  }
+  CHECK(rows[0][65] == '1');
+  CHECK(rows[65][0] == '1');
+  CHECK(rows[66][1] == '1');
+  CHECK(rows[69][69] == '1');
+  CHECK(std::count(rows[1].begin(), rows[1].end(), '1') == 0);
+}
@@ -0,0 +1,161 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/graph/algorithms.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/transforms.hpp"
+#include "utils_cpp/parallel/batch_pipeline.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+
+std::string read_file(const std::string &filename) {
+  std::ifstream file(filename, std::ios_base::binary);
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+// The production workload in miniature: generate, prune, shuffle, compute
+// all-pairs distances, serialize.
+std::string make_instance(std::size_t index, std::uint64_t seed) {
+  auto gb = gl::grid(4 + index % 3, 5);
+  gb = gl::rand_prune_connected(gb, 0.2, static_cast<unsigned>(seed));
+  auto g = gl::shuffle_vertex_labels(gb.graph, static_cast<unsigned>(seed));
+  Json record;
+  record["index"] = index;
+  record["distances"] = gl::floyd_warshall(g);
+  return record.dump();
+}
+
+std::vector<std::string> run_collect(std::size_t count,
+                                     parallel::thread_pool *pool,
+                                     std::size_t max_in_flight) {
+  std::vector<std::string> out;
+  parallel::run_batch(
+      count, 7, make_instance,
+      [&](std::size_t i, std::string line) {
+        CHECK(i == out.size());
+        out.push_back(std::move(line));
+      },
+      pool, {max_in_flight});
+  return out;
+}
+
+} // namespace
+
+TEST_CASE("run_batch gives the same results for any thread count") {
+  auto expected = run_collect(40, nullptr, 0);
+  REQUIRE(expected.size() == 40);
+  CHECK(expected[0] != expected[3]);
+
+  parallel::thread_pool one(1);
+  parallel::thread_pool three(3);
+  CHECK(run_collect(40, &one, 0) == expected);
+  CHECK(run_collect(40, &three, 0) == expected);
+  CHECK(run_collect(40, &three, 1) == expected);
+  CHECK(run_collect(40, &three, 5) == expected);
+  CHECK(run_collect(0, &three, 0).empty());
+}
+
+TEST_CASE("batch_instance_seed") {
+  CHECK(parallel::batch_instance_seed(1, 0) !=
+        parallel::batch_instance_seed(1, 1));
+  CHECK(parallel::batch_instance_seed(1, 0) !=
+        parallel::batch_instance_seed(2, 0));
+  CHECK(parallel::batch_instance_seed(1, 5) ==
+        parallel::batch_instance_seed(1, 5));
+}
+
+TEST_CASE("run_batch stops at the first failure") {
+  parallel::thread_pool pool(2);
+
+  SUBCASE("make throws") {
+    std::vector<std::size_t> written;
+    auto make = [](std::size_t i, std::uint64_t) {
+      if (i == 13 || i == 20) {
+        throw std::runtime_error("instance " + std::to_string(i));
+      }
+      return i;
+    };
+    auto write = [&](std::size_t, std::size_t v) { written.push_back(v); };
+    CHECK_THROWS_WITH_AS(parallel::run_batch(100, 0, make, write, &pool),
+                         "instance 13", std::runtime_error);
+    CHECK(written.size() == 13);
+  }
+
+  SUBCASE("write throws") {
+    auto make = [](std::size_t i, std::uint64_t) { return i; };
+    auto write = [](std::size_t i, std::size_t) {
+      if (i == 3) {
+        throw std::logic_error("sink full");
+      }
+    };
+    CHECK_THROWS_AS(parallel::run_batch(100, 0, make, write, &pool),
+                    std::logic_error);
+  }
+}
+
+TEST_CASE("json_lines_sink") {
+  CHECK(parallel::json_lines_sink::shard_path("out.jsonl", 3) ==
+        "out-00003.jsonl");
+  CHECK(parallel::json_lines_sink::shard_path("dir.d/out", 12) ==
+        "dir.d/out-00012");
+
+  parallel::thread_pool pool(2);
+  std::string expected;
+  for (const auto &line : run_collect(10, nullptr, 0)) {
+    expected += line;
+    expected += '\n';
+  }
+
+  SUBCASE("one file") {
+    std::string filename = "test_batch_pipeline.jsonl";
+    {
+      parallel::json_lines_sink sink(filename, {.buffer_size = 100});
+      parallel::run_batch(10, 7, make_instance, sink, &pool);
+      CHECK(sink.size() == 10);
+    }
+    CHECK(read_file(filename) == expected);
+    std::remove(filename.c_str());
+  }
+
+  SUBCASE("shards") {
+    parallel::json_lines_sink sink("test_batch_pipeline.jsonl",
+                                   {.records_per_shard = 4});
+    parallel::run_batch(10, 7, make_instance, sink, &pool);
+    sink.flush();
+    REQUIRE(sink.files().size() == 3);
+    std::string joined;
+    for (const auto &file : sink.files()) {
+      joined += read_file(file);
+      std::remove(file.c_str());
+    }
+    CHECK(joined == expected);
+  }
+
+  SUBCASE("Json records") {
+    std::string filename = "test_batch_pipeline_json.jsonl";
+    {
+      parallel::json_lines_sink sink(filename);
+      parallel::run_batch(
+          3, 0,
+          [](std::size_t i, std::uint64_t) {
+            Json j;
+            j["i"] = i;
+            return j;
+          },
+          sink, &pool);
+    }
+    CHECK(read_file(filename) == "{\"i\":0}\n{\"i\":1}\n{\"i\":2}\n");
+    std::remove(filename.c_str());
+  }
+}
@@ -0,0 +1,104 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/parallel/bounded_mpmc_queue.hpp"
+
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace utils;
+
+TEST_CASE("Test bounded mpmc queue single thread") {
+  parallel::bounded_mpmc_queue<int, 4> queue;
+
+  SUBCASE("FIFO order") {
+    queue.push(1);
+    queue.push(2);
+    queue.push(3);
+
+    CHECK(queue.size() == 3);
+    CHECK(*queue.try_pop() == 1);
+    CHECK(*queue.try_pop() == 2);
+    CHECK(queue.wait_and_pop() == 3);
+    CHECK(queue.empty());
+    CHECK(!queue.try_pop());
+  }
+
+  SUBCASE("try_push fails when full") {
+    for (int i = 0; i < 4; ++i) {
+      CHECK(queue.try_push(i));
+    }
+    CHECK(!queue.try_push(4));
+
+    int value = -1;
+    CHECK(queue.try_pop(value));
+    CHECK(value == 0);
+    CHECK(queue.try_push(4));
+  }
+
+  SUBCASE("Wraps around many times") {
+    for (int i = 0; i < 1000; ++i) {
+      CHECK(queue.try_push(i));
+      CHECK(*queue.try_pop() == i);
+    }
+  }
+}
+
+TEST_CASE("Test bounded mpmc queue non-trivial types") {
+  parallel::bounded_mpmc_queue<std::unique_ptr<std::string>, 8> queue;
+
+  queue.push(std::make_unique<std::string>("hello"));
+  CHECK(queue.try_push(std::make_unique<std::string>("world")));
+
+  CHECK(**queue.try_pop() == "hello");
+
+  // The remaining element is destroyed with the queue.
+}
+
+TEST_CASE("Test bounded mpmc queue multiple producers and consumers") {
+  parallel::bounded_mpmc_queue<int, 16> queue;
+
+  const int num_producers = 3;
+  const int num_consumers = 3;
+  const int per_producer = 2000;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; ++p) {
+    producers.emplace_back([&queue, p] {
+      for (int i = 0; i < per_producer; ++i) {
+        int value = p * per_producer + i;
+        if (i % 2 == 0) {
+          queue.push(value);
+        } else {
+          while (!queue.try_push(value)) {
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+  }
+
+  std::vector<long long> sums(num_consumers, 0);
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < num_consumers; ++c) {
+    consumers.emplace_back([&queue, &sums, c] {
+      for (int i = 0; i < per_producer; ++i) {
+        sums[c] += queue.wait_and_pop();
+      }
+    });
+  }
+
+  for (auto &t : producers) {
+    t.join();
+  }
+  for (auto &t : consumers) {
+    t.join();
+  }
+
+  long long n = num_producers * per_producer;
+  CHECK(std::accumulate(sums.begin(), sums.end(), 0LL) == n * (n - 1) / 2);
+  CHECK(queue.empty());
+}
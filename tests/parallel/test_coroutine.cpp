@@ -0,0 +1,151 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/parallel/coroutine.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace utils;
+using parallel::task;
+
+namespace {
+
+task<int> answer() { co_return 42; }
+
+task<int> add_one(task<int> t) { co_return co_await std::move(t) + 1; }
+
+task<int> square_on(parallel::thread_pool &pool, int i) {
+  co_await parallel::schedule_on(pool);
+  co_return i * i;
+}
+
+task<std::thread::id> thread_of(parallel::thread_pool &pool) {
+  co_await parallel::schedule_on(pool);
+  co_return std::this_thread::get_id();
+}
+
+task<int> fail_on(parallel::thread_pool &pool, int i) {
+  co_await parallel::schedule_on(pool);
+  if (i % 3 == 2) {
+    throw std::runtime_error("task " + std::to_string(i));
+  }
+  co_return i;
+}
+
+// A job that fans out into subtasks and waits for them, as a per-instance
+// job running per-source searches would.
+task<int> job(parallel::thread_pool &pool, int i, int width) {
+  co_await parallel::schedule_on(pool);
+  std::vector<task<int>> parts;
+  for (int k = 0; k < width; ++k) {
+    parts.push_back(square_on(pool, i * width + k));
+  }
+  int sum = 0;
+  for (int v : co_await parallel::when_all(std::move(parts))) {
+    sum += v;
+  }
+  co_return sum;
+}
+
+} // namespace
+
+TEST_CASE("task") {
+  CHECK(parallel::sync_wait(answer()) == 42);
+  CHECK(parallel::sync_wait(add_one(add_one(answer()))) == 44);
+
+  task<int> never_started = answer();
+  CHECK(never_started.valid());
+}
+
+TEST_CASE("schedule_on moves the coroutine to the pool") {
+  parallel::thread_pool pool(2);
+  auto id = parallel::sync_wait(thread_of(pool));
+  CHECK(id != std::this_thread::get_id());
+  CHECK(parallel::sync_wait(thread_of(pool), &pool) != std::thread::id{});
+}
+
+TEST_CASE("when_all") {
+  parallel::thread_pool pool(3);
+
+  SUBCASE("results in order") {
+    std::vector<task<int>> tasks;
+    for (int i = 0; i < 200; ++i) {
+      tasks.push_back(square_on(pool, i));
+    }
+    auto values = parallel::sync_wait(parallel::when_all(std::move(tasks)));
+    REQUIRE(values.size() == 200);
+    for (int i = 0; i < 200; ++i) {
+      CHECK(values[i] == i * i);
+    }
+  }
+
+  SUBCASE("empty") {
+    auto values =
+        parallel::sync_wait(parallel::when_all(std::vector<task<int>>{}));
+    CHECK(values.empty());
+  }
+
+  SUBCASE("void tasks") {
+    std::atomic<int> count{0};
+    auto bump = [&]() -> task<void> {
+      co_await parallel::schedule_on(pool);
+      ++count;
+    };
+    std::vector<task<void>> tasks;
+    for (int i = 0; i < 50; ++i) {
+      tasks.push_back(bump());
+    }
+    parallel::sync_wait(parallel::when_all(std::move(tasks)));
+    CHECK(count == 50);
+  }
+
+  SUBCASE("different types") {
+    auto text = [&]() -> task<std::string> {
+      co_await parallel::schedule_on(pool);
+      co_return "text";
+    };
+    auto [a, b] = parallel::sync_wait(
+        parallel::when_all(square_on(pool, 5), text()));
+    CHECK(a == 25);
+    CHECK(b == "text");
+  }
+
+  SUBCASE("first exception in order") {
+    std::vector<task<int>> tasks;
+    for (int i = 0; i < 20; ++i) {
+      tasks.push_back(fail_on(pool, i));
+    }
+    CHECK_THROWS_WITH_AS(
+        parallel::sync_wait(parallel::when_all(std::move(tasks))), "task 2",
+        std::runtime_error);
+  }
+}
+
+TEST_CASE("nested when_all does not need a thread per waiting job") {
+  // One worker: if a job blocked its thread while waiting for its parts,
+  // nothing would be left to run them.
+  parallel::thread_pool pool(1);
+  std::vector<task<int>> jobs;
+  for (int i = 0; i < 16; ++i) {
+    jobs.push_back(job(pool, i, 8));
+  }
+  auto sums = parallel::sync_wait(parallel::when_all(std::move(jobs)));
+  for (int i = 0; i < 16; ++i) {
+    int expected = 0;
+    for (int k = 0; k < 8; ++k) {
+      expected += (i * 8 + k) * (i * 8 + k);
+    }
+    CHECK(sums[i] == expected);
+  }
+
+  SUBCASE("sync_wait from inside the pool") {
+    auto inner = pool.submit(
+        [&] { return parallel::sync_wait(job(pool, 1, 4), &pool); });
+    CHECK(inner.get() == 4 * 4 + 5 * 5 + 6 * 6 + 7 * 7);
+  }
+}
@@ -0,0 +1,141 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/parallel/task_graph.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace utils;
+
+TEST_CASE("Test task_graph respects dependencies") {
+  parallel::thread_pool pool(3);
+  parallel::task_graph tg;
+
+  std::mutex m;
+  std::vector<int> order;
+  auto record = [&](int i) {
+    return [&, i]() {
+      std::lock_guard<std::mutex> lock(m);
+      order.push_back(i);
+    };
+  };
+
+  // Diamond: 0 -> {1, 2} -> 3, plus an independent task 4.
+  auto t0 = tg.add(record(0));
+  auto t1 = tg.add(record(1));
+  auto t2 = tg.add(record(2));
+  auto t3 = tg.add(record(3));
+  tg.add(record(4));
+
+  tg.precede(t0, t1);
+  tg.precede(t0, t2);
+  tg.precede(t1, t3);
+  tg.depends_on(t3, t2);
+
+  SUBCASE("single run") {
+    tg.run(pool).wait();
+
+    REQUIRE(order.size() == 5);
+    auto pos = [&](int i) {
+      return std::find(order.begin(), order.end(), i) - order.begin();
+    };
+    CHECK(pos(0) < pos(1));
+    CHECK(pos(0) < pos(2));
+    CHECK(pos(1) < pos(3));
+    CHECK(pos(2) < pos(3));
+  }
+
+  SUBCASE("graph can be run repeatedly") {
+    for (int i = 0; i < 10; ++i) {
+      tg.run(pool).wait();
+    }
+    CHECK(order.size() == 50);
+  }
+}
+
+TEST_CASE("Test task_graph long chain and wide fan-out") {
+  parallel::thread_pool pool(2);
+  parallel::task_graph tg;
+
+  std::atomic<int> counter = 0;
+  std::vector<int> seen(200, -1);
+
+  parallel::task_graph::task_id prev = tg.add([&] { seen[0] = counter++; });
+  for (int i = 1; i < 100; ++i) {
+    auto t = tg.add([&, i] { seen[i] = counter++; });
+    tg.precede(prev, t);
+    prev = t;
+  }
+  for (int i = 100; i < 200; ++i) {
+    auto t = tg.add([&, i] { seen[i] = counter++; });
+    tg.precede(prev, t);
+  }
+
+  tg.run(pool).wait();
+
+  for (int i = 0; i < 100; ++i) {
+    CHECK(seen[i] == i);
+  }
+  for (int i = 100; i < 200; ++i) {
+    CHECK(seen[i] >= 100);
+  }
+}
+
+TEST_CASE("Test task_graph errors") {
+  parallel::thread_pool pool(2);
+
+  SUBCASE("cycle detection") {
+    parallel::task_graph tg;
+    auto a = tg.add([] {});
+    auto b = tg.add([] {});
+    tg.precede(a, b);
+    tg.precede(b, a);
+    CHECK_THROWS_AS(tg.run(pool), std::invalid_argument);
+  }
+
+  SUBCASE("exception skips successors") {
+    parallel::task_graph tg;
+    bool ran_after = false;
+    bool ran_independent = false;
+    auto a = tg.add([] { throw std::runtime_error("fail"); });
+    auto b = tg.add([&] { ran_after = true; });
+    tg.add([&] { ran_independent = true; });
+    tg.precede(a, b);
+
+    auto handle = tg.run(pool);
+    CHECK_THROWS_AS(handle.wait(), std::runtime_error);
+    CHECK(!ran_after);
+    CHECK(ran_independent);
+  }
+
+  SUBCASE("empty graph") {
+    parallel::task_graph tg;
+    auto handle = tg.run(pool);
+    handle.wait();
+    CHECK(handle.done());
+  }
+}
+
+TEST_CASE("Test task_graph may be destroyed right after wait") {
+  parallel::thread_pool pool(3);
+  for (int round = 0; round < 200; ++round) {
+    std::atomic<int> count{0};
+    {
+      auto tg = std::make_unique<parallel::task_graph>();
+      auto root = tg->add([&] { ++count; });
+      for (int i = 0; i < 8; ++i) {
+        auto mid = tg->add([&] { ++count; });
+        auto leaf = tg->add([&] { ++count; });
+        tg->precede(root, mid);
+        tg->precede(mid, leaf);
+      }
+      tg->run(pool).wait();
+    }
+    CHECK(count == 17);
+  }
+}
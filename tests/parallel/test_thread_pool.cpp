@@ -3,6 +3,15 @@
 
 #include "utils_cpp/parallel/thread_pool.hpp"
 
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
 using namespace utils;
 
 TEST_CASE("Testing thread_pool functionality") {
@@ -66,3 +75,269 @@ TEST_CASE("Testing threadsafe_queue functionality") {
     CHECK(queue.empty());
   }
 }
+
+TEST_CASE("Testing thread_pool work stealing") {
+  parallel::thread_pool pool(4);
+
+  SUBCASE("Tasks submitted from inside a worker") {
+    auto outer = pool.submit([&pool]() {
+      std::vector<std::future<int>> inner;
+      for (int i = 0; i < 50; ++i) {
+        inner.push_back(pool.submit([i]() { return i; }));
+      }
+
+      int sum = 0;
+      for (auto &f : inner) {
+        while (f.wait_for(std::chrono::seconds(0)) !=
+               std::future_status::ready) {
+          pool.run_pending_task();
+        }
+        sum += f.get();
+      }
+      return sum;
+    });
+
+    CHECK(outer.get() == 49 * 50 / 2);
+  }
+
+  SUBCASE("Pool goes idle and wakes up again") {
+    CHECK(pool.submit([]() { return 1; }).get() == 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(pool.submit([]() { return 2; }).get() == 2);
+  }
+
+  SUBCASE("Single worker thread") {
+    parallel::thread_pool single(1);
+    CHECK(single.size() == 1);
+    CHECK(single.submit([]() { return 3; }).get() == 3);
+  }
+}
+
+TEST_CASE("Testing work_stealing_queue functionality") {
+  parallel::work_stealing_queue queue;
+
+  int order = 0;
+  queue.push([&order]() { order = order * 10 + 1; });
+  queue.push([&order]() { order = order * 10 + 2; });
+  queue.push([&order]() { order = order * 10 + 3; });
+
+  parallel::function_wrapper task;
+
+  // Owner pops newest first, thieves steal oldest first.
+  CHECK(queue.try_pop(task));
+  task();
+  CHECK(queue.try_steal(task));
+  task();
+  CHECK(queue.try_pop(task));
+  task();
+
+  CHECK(order == 312);
+  CHECK(queue.empty());
+  CHECK(!queue.try_steal(task));
+}
+
+TEST_CASE("Testing thread_pool bulk operations") {
+  parallel::thread_pool pool(3);
+
+  SUBCASE("submit_bulk") {
+    std::vector<std::atomic<int>> hits(64);
+    std::vector<std::function<void()>> tasks;
+    for (int i = 0; i < 64; ++i) {
+      tasks.push_back([&hits, i]() { hits[i] += i; });
+    }
+
+    auto handle = pool.submit_bulk(std::move(tasks));
+    handle.wait();
+
+    CHECK(handle.done());
+    for (int i = 0; i < 64; ++i) {
+      CHECK(hits[i] == i);
+    }
+  }
+
+  SUBCASE("parallel_for") {
+    std::vector<int> v(1000, 0);
+    pool.parallel_for(0, 1000, 7, [&v](int i) { v[i] = 2 * i; });
+
+    for (int i = 0; i < 1000; ++i) {
+      CHECK(v[i] == 2 * i);
+    }
+
+    // automatic grain, empty range
+    std::atomic<int> count = 0;
+    pool.parallel_for(std::size_t{0}, std::size_t{123}, 0,
+                      [&count](std::size_t) { ++count; });
+    CHECK(count == 123);
+    pool.parallel_for(5, 5, 1, [&count](int) { ++count; });
+    CHECK(count == 123);
+  }
+
+  SUBCASE("parallel_reduce") {
+    long long sum = pool.parallel_reduce(
+        1, 10001, 100, 0LL, [](int i) { return static_cast<long long>(i); },
+        [](long long a, long long b) { return a + b; });
+    CHECK(sum == 10000LL * 10001 / 2);
+
+    // Non-commutative but associative: concatenation keeps index order.
+    std::string s = pool.parallel_reduce(
+        0, 10, 3, std::string{},
+        [](int i) { return std::string(1, static_cast<char>('a' + i)); },
+        [](std::string a, const std::string &b) { return a + b; });
+    CHECK(s == "abcdefghij");
+  }
+
+  SUBCASE("nested parallel_for inside a task") {
+    auto f = pool.submit([&pool]() {
+      return pool.parallel_reduce(
+          0, 100, 10, 0, [](int i) { return i; },
+          [](int a, int b) { return a + b; });
+    });
+    CHECK(f.get() == 4950);
+  }
+
+  SUBCASE("exceptions are rethrown from wait") {
+    CHECK_THROWS_AS(pool.parallel_for(0, 100, 10,
+                                      [](int i) {
+                                        if (i == 42) {
+                                          throw std::runtime_error("boom");
+                                        }
+                                      }),
+                    std::runtime_error);
+  }
+}
+
+TEST_CASE("Testing function_wrapper") {
+  SUBCASE("Small callables are stored inline") {
+    int x = 0;
+    parallel::function_wrapper f([&x]() { ++x; });
+    parallel::function_wrapper g(std::move(f));
+    CHECK(!f);
+    CHECK(g);
+    g();
+    CHECK(x == 1);
+  }
+
+  SUBCASE("Large and move-only callables") {
+    std::array<int, 64> big{};
+    big[63] = 5;
+    int result = 0;
+    parallel::function_wrapper f([big, &result]() { result = big[63]; });
+
+    auto p = std::make_unique<int>(7);
+    parallel::function_wrapper h(
+        [p = std::move(p), &result]() { result += *p; });
+
+    parallel::function_wrapper moved;
+    moved = std::move(f);
+    moved();
+    h();
+    CHECK(result == 12);
+  }
+
+  SUBCASE("Destroys the stored callable exactly once") {
+    auto counter = std::make_shared<int>(0);
+    {
+      parallel::function_wrapper f([counter]() {});
+      parallel::function_wrapper g(std::move(f));
+      CHECK(counter.use_count() == 2);
+    }
+    CHECK(counter.use_count() == 1);
+  }
+}
+
+TEST_CASE("Testing thread_pool submit_detached") {
+  std::atomic<int> count = 0;
+  {
+    parallel::thread_pool pool(2);
+    for (int i = 0; i < 100; ++i) {
+      pool.submit_detached([&count]() { ++count; });
+    }
+    while (count < 100) {
+      pool.run_pending_task();
+    }
+  }
+  CHECK(count == 100);
+}
+
+TEST_CASE("Testing thread_pool options") {
+  SUBCASE("cpu list parsing") {
+    CHECK(parallel::parse_cpu_list("0-3,8,10-11\n") ==
+          std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    CHECK(parallel::parse_cpu_list("").empty());
+  }
+
+  SUBCASE("numa topology") {
+    auto nodes = parallel::numa_node_cpus();
+    CHECK(nodes.size() >= 1);
+    CHECK(parallel::num_numa_nodes() == nodes.size());
+  }
+
+  SUBCASE("numa node numbers with gaps") {
+    // A fake sysfs node directory where node 1 has gone offline and node 3
+    // has memory but no CPUs.
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "utils_cpp_test_numa_nodes";
+    fs::remove_all(dir);
+    auto write = [&](const std::string &file, const std::string &text) {
+      fs::create_directories((dir / file).parent_path());
+      std::ofstream(dir / file) << text;
+    };
+    write("node0/cpulist", "0-1\n");
+    write("node2/cpulist", "2,3\n");
+    write("node3/cpulist", "\n");
+    write("possible", "0-3\n");
+
+    // Without 'online', the nodeN directories are listed.
+    auto listed = parallel::detail::read_numa_node_cpus(dir.string());
+    CHECK(listed == std::vector<std::vector<int>>{{0, 1}, {}, {2, 3}, {}});
+
+    write("online", "0,2-3\n");
+    auto online = parallel::detail::read_numa_node_cpus(dir.string());
+    CHECK(online == listed);
+
+    write("online", "2\n");
+    online = parallel::detail::read_numa_node_cpus(dir.string());
+    CHECK(online == std::vector<std::vector<int>>{{}, {}, {2, 3}});
+    fs::remove_all(dir);
+  }
+
+  SUBCASE("named and pinned workers") {
+    parallel::thread_pool_options options;
+    options.thread_count = 2;
+    options.name = "tp";
+    options.cpus = parallel::numa_node_cpus()[0];
+    options.pin_each_worker = true;
+
+    parallel::thread_pool pool(options);
+    CHECK(pool.size() == 2);
+    CHECK(pool.numa_node() == -1);
+
+#if defined(__linux__)
+    std::string name = pool.submit(parallel::current_thread_name).get();
+    CHECK(name.rfind("tp-", 0) == 0);
+#endif
+  }
+
+  SUBCASE("per-node sub-pools") {
+    auto pools = parallel::make_numa_thread_pools();
+    auto nodes = parallel::numa_node_cpus();
+    CHECK(pools.size() == static_cast<std::size_t>(std::count_if(
+                              nodes.begin(), nodes.end(),
+                              [](const auto &cpus) { return !cpus.empty(); })));
+    for (std::size_t i = 0; i < pools.size(); ++i) {
+      int node = pools[i]->numa_node();
+      CHECK(!nodes.at(static_cast<std::size_t>(node)).empty());
+      if (i > 0) {
+        CHECK(node > pools[i - 1]->numa_node());
+      }
+      CHECK(pools[i]->size() >= 1);
+      CHECK(pools[i]->submit([]() { return 5; }).get() == 5);
+    }
+  }
+
+  SUBCASE("invalid numa node") {
+    parallel::thread_pool_options options;
+    options.numa_node = 1 << 20;
+    CHECK_THROWS_AS(parallel::thread_pool{options}, std::out_of_range);
+  }
+}
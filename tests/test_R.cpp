@@ -3,6 +3,11 @@
 
 #include "utils_cpp/R.hpp"
 
+#include <ranges>
+#include <string>
+#include <utility>
+#include <vector>
+
 using namespace utils;
 
 TEST_CASE("Testing seq function") {
@@ -121,3 +126,50 @@ TEST_CASE("Testing fapply") {
               {{2, 4}, {6, 8}}, {{10, 12}, {14, 16}}});
   }
 }
+
+TEST_CASE("lazy seq, rep and fapply") {
+  auto s = seq_view(10, 1, -2);
+  static_assert(std::ranges::random_access_range<decltype(s)>);
+  CHECK(std::vector<int>(s.begin(), s.end()) == seq(10, 1, -2));
+  CHECK(s.size() == 5);
+  CHECK_THROWS_AS(seq_view(1, 5, -1), std::invalid_argument);
+
+  // As in R, rounding error below 1e-10 steps does not drop the end.
+  CHECK(seq(0.0, 0.3, 0.1).size() == 4);
+  CHECK(seq(0.0, 1.0, 0.1).back() == 1.0);
+  CHECK(seq_view(0.0, 1.0, 0.1)[3] == 3 * 0.1);
+
+  auto squares =
+      seq_view(1, 4) | std::views::transform([](int x) { return x * x; });
+  CHECK(std::vector<int>(squares.begin(), squares.end()) ==
+        std::vector<int>{1, 4, 9, 16});
+
+  std::vector<int> v = {1, 2};
+  auto r = rep_view(v, 2, 3);
+  static_assert(std::ranges::random_access_range<decltype(r)>);
+  CHECK(r.to_vector() == rep(v, 2, 3));
+  CHECK(std::vector<int>(r.begin(), r.end()) == rep(v, 2, 3));
+  CHECK(rep_view(std::vector<int>{4, 5}, 1, 2).to_vector() ==
+        std::vector<int>{4, 5, 4, 5});
+  CHECK(rep_view(std::string("x"), 2, 2).to_vector() ==
+        rep(std::string("x"), 2, 2));
+  CHECK(rep_view(3.14, 0, 5).empty());
+
+  std::vector<std::pair<std::vector<int>, int>> nested = {{{1, 2}, 3},
+                                                          {{4}, 5}};
+  int calls = 0;
+  auto mapped = fapply_view(nested, [&calls](int x) {
+    ++calls;
+    return 10 * x;
+  });
+  CHECK(calls == 0);
+  auto second = mapped[1];
+  CHECK(second.second == 50);
+  CHECK(second.first[0] == 40);
+  CHECK(calls == 2);
+  std::vector<int> first;
+  for (int x : mapped[0].first) {
+    first.push_back(x);
+  }
+  CHECK(first == std::vector<int>{10, 20});
+}
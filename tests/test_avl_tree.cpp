@@ -3,6 +3,12 @@
 
 #include "utils_cpp/avl_tree.hpp"
 
+#include <cmath>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
 TEST_CASE("Testing AVLTree functionality") {
   utils::AVLTree<int> tree;
 
@@ -78,3 +84,151 @@ TEST_CASE("Testing AVLTree functionality") {
     CHECK(it == tree.end());
   }
 }
+
+TEST_CASE("random inserts and erases keep the tree balanced") {
+  utils::AVLTree<int> tree;
+  std::set<int> reference;
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> dist(0, 20000);
+
+  for (int step = 0; step < 100000; ++step) {
+    int key = dist(rng);
+    if (step % 3 == 2) {
+      tree.erase(key);
+      reference.erase(key);
+    } else {
+      CHECK(tree.insert(key) == reference.insert(key).second);
+    }
+  }
+
+  std::vector<int> keys;
+  for (const auto &node : tree) {
+    keys.push_back(node.key);
+  }
+  CHECK(keys == std::vector<int>(reference.begin(), reference.end()));
+
+  // An AVL tree with n nodes has height below 1.44 log2(n + 2).
+  double n = static_cast<double>(reference.size());
+  CHECK(static_cast<double>(tree.height()) < 1.44 * std::log2(n + 2));
+
+  for (int key : reference) {
+    tree.erase(key);
+  }
+  CHECK(tree.begin() == tree.end());
+}
+
+TEST_CASE("order statistics, bounds and bulk loading") {
+  std::vector<int> sorted;
+  for (int i = 0; i < 1000; ++i) {
+    sorted.push_back(3 * i);
+  }
+  auto tree = utils::AVLTree<int>::from_sorted(sorted.begin(), sorted.end());
+  CHECK(tree.size() == 1000);
+  CHECK(tree.height() <= 10);
+
+  CHECK(tree.rank(0) == 0);
+  CHECK(tree.rank(1) == 1);
+  CHECK(tree.rank(3) == 1);
+  CHECK(tree.rank(10000) == 1000);
+  CHECK(tree.nth(0) == 0);
+  CHECK(tree.nth(500) == 1500);
+  CHECK(tree.nth(999) == 2997);
+  CHECK_THROWS_AS(tree.nth(1000), std::out_of_range);
+
+  CHECK(tree.lower_bound(4)->key == 6);
+  CHECK(tree.lower_bound(6)->key == 6);
+  CHECK(tree.upper_bound(6)->key == 9);
+  CHECK(tree.lower_bound(2998) == tree.end());
+
+  std::vector<int> range;
+  for (auto it = tree.lower_bound(10); it != tree.upper_bound(20); ++it) {
+    range.push_back(it->key);
+  }
+  CHECK(range == std::vector<int>{12, 15, 18});
+
+  // Sizes stay right through inserts and erases.
+  tree.insert(1);
+  tree.erase(1500);
+  CHECK(tree.rank(3) == 2);
+  CHECK(tree.nth(500) == 1497);
+  CHECK(tree.nth(501) == 1503);
+
+  std::vector<int> unsorted{1, 3, 2};
+  CHECK_THROWS_AS(
+      utils::AVLTree<int>::from_sorted(unsorted.begin(), unsorted.end()),
+      std::invalid_argument);
+}
+
+TEST_CASE("split and join") {
+  std::mt19937 rng(5);
+  std::vector<int> keys(5000);
+  for (int i = 0; i < 5000; ++i) {
+    keys[i] = 2 * i;
+  }
+  auto tree = utils::AVLTree<int>::from_sorted(keys.begin(), keys.end());
+
+  auto check = [](const utils::AVLTree<int> &t, int lo, int hi) {
+    std::vector<int> got;
+    for (const auto &node : t) {
+      got.push_back(node.key);
+    }
+    std::vector<int> expected;
+    for (int k = lo; k < hi; k += 2) {
+      expected.push_back(k);
+    }
+    CHECK(got == expected);
+    CHECK(t.size() == expected.size());
+    double n = static_cast<double>(expected.size());
+    CHECK(static_cast<double>(t.height()) < 1.44 * std::log2(n + 2));
+  };
+
+  auto right = tree.split(3001);
+  check(tree, 0, 3002);
+  check(right, 3002, 10000);
+
+  // Trees from one split share a pool, and can still be changed apart.
+  right.insert(20001);
+  tree.erase(0);
+  auto middle = right.split(6000);
+  check(right, 3002, 6000);
+  tree.join(std::move(right));
+  check(tree, 2, 6000);
+  CHECK(right.empty());
+  CHECK_THROWS_AS(middle.join(std::move(tree)), std::invalid_argument);
+  check(tree, 2, 6000);
+  middle.erase(20001);
+
+  // Join trees from separate pools, of very different heights.
+  std::vector<int> tail{100000};
+  auto small = utils::AVLTree<int>::from_sorted(tail.begin(), tail.end());
+  middle.join(std::move(small));
+  CHECK(middle.max() == 100000);
+  middle.erase(100000);
+  tree.join(std::move(middle));
+  check(tree, 2, 10000);
+
+  // Random splits and joins against a sorted reference.
+  std::uniform_int_distribution<int> dist(0, 10000);
+  for (int step = 0; step < 200; ++step) {
+    int at = dist(rng);
+    auto upper = tree.split(at);
+    CHECK(tree.rank(at) == tree.size());
+    CHECK(upper.rank(at) == 0);
+    tree.join(std::move(upper));
+  }
+  check(tree, 2, 10000);
+
+  // Joining a tree whose pool is shared with a third one copies its nodes.
+  auto head = utils::AVLTree<int>::from_sorted(keys.begin(), keys.begin() + 1);
+  auto shared_upper = tree.split(5000);
+  head.join(std::move(tree));
+  check(head, 0, 5000);
+  tree = std::move(head);
+  tree.erase(0);
+  tree.join(std::move(shared_upper));
+
+  auto all = tree.split(-1);
+  CHECK(tree.empty());
+  tree.join(std::move(all));
+  check(tree, 2, 10000);
+}
@@ -3,6 +3,12 @@
 
 #include "utils_cpp/bigint.hpp"
 
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
 using namespace utils;
 
 TEST_CASE("bigint_from_string") {
@@ -52,3 +58,236 @@ TEST_CASE("bigint_from_longlong") {
 
   CHECK(results == answer);
 }
+
+namespace {
+
+std::string random_digits(std::mt19937_64 &gen, std::size_t n) {
+  std::string s(1, static_cast<char>('1' + gen() % 9));
+  for (std::size_t i = 1; i < n; ++i)
+    s.push_back(static_cast<char>('0' + gen() % 10));
+  return s;
+}
+
+} // namespace
+
+TEST_CASE("bigint_known_values") {
+  CHECK((BigInt(2) ^ BigInt(64)).to_string() == "18446744073709551616");
+  CHECK((BigInt(2) ^ BigInt(100)).to_string() ==
+        "1267650600228229401496703205376");
+  CHECK((BigInt(-3) ^ BigInt(3)) == BigInt(-27));
+  CHECK((BigInt(7) ^ BigInt(0)) == BigInt(1));
+
+  BigInt factorial = 1;
+  for (int i = 2; i <= 100; ++i)
+    factorial *= i;
+  std::string f = factorial.to_string();
+  CHECK(factorial.size() == 158);
+  CHECK(f.substr(0, 20) == "93326215443944152681");
+  CHECK(f.substr(f.size() - 24) == std::string(24, '0'));
+
+  CHECK(BigInt(10).to_big_endian_vector(2) == std::vector<int>{1, 0, 1, 0});
+  CHECK(BigInt(255).to_big_endian_vector(16) == std::vector<int>{15, 15});
+  BigInt from_bits;
+  from_bits.from_binary_vector({1, 0, 1, 0});
+  CHECK(from_bits == BigInt(10));
+
+  CHECK(BigInt("-9223372036854775808").to_ll() ==
+        std::numeric_limits<long long>::min());
+  CHECK_THROWS_AS(BigInt("9223372036854775808").to_ll(), std::overflow_error);
+  CHECK_THROWS_AS(BigInt("12a"), std::invalid_argument);
+  CHECK_THROWS_AS(BigInt(""), std::invalid_argument);
+  CHECK_THROWS_AS(BigInt("-"), std::invalid_argument);
+  CHECK_THROWS_AS(BigInt("+-"), std::invalid_argument);
+  CHECK(BigInt("-0") == BigInt(0));
+  std::istringstream empty_stream("");
+  BigInt unread(7);
+  CHECK_FALSE(static_cast<bool>(empty_stream >> unread));
+  CHECK(unread == BigInt(7));
+  CHECK_THROWS_AS(BigInt(1) / BigInt(0), std::domain_error);
+
+  CHECK(BigInt("-100") % 7 == -2);
+  CHECK(BigInt("-100") / 7 == BigInt(-14));
+  CHECK(gcd(BigInt(-12), BigInt(18)) == BigInt(6));
+  CHECK(lcm(BigInt(4), BigInt(6)) == BigInt(12));
+  CHECK(BigInt(-5) < BigInt(-4));
+  CHECK(BigInt(-5) < BigInt(3));
+  CHECK(BigInt("18446744073709551616") > BigInt("18446744073709551615"));
+}
+
+TEST_CASE("bigint_arithmetic_identities") {
+  std::mt19937_64 gen(42);
+  for (std::size_t digits : {5, 25, 300, 2000, 6000}) {
+    BigInt x(random_digits(gen, digits));
+    BigInt y(random_digits(gen, digits / 2 + 1));
+    BigInt z(random_digits(gen, digits / 3 + 1));
+
+    // Round trips through decimal.
+    CHECK(BigInt(x.to_string()) == x);
+    CHECK(BigInt((-x).to_string()) == -x);
+
+    // Multiplication against distributivity, which exercises karatsuba
+    // and the unbalanced split on the larger sizes.
+    CHECK((x + y) * z == x * z + y * z);
+    CHECK((x - y) * (x + y) == x * x - y * y);
+
+    // Division identities.
+    auto [q, r] = divmod(x, y);
+    CHECK(q * y + r == x);
+    CHECK(r.abs() < y.abs());
+    CHECK(r >= BigInt(0));
+    auto [nq, nr] = divmod(-x, y);
+    CHECK(nq == -q);
+    CHECK(nr == -r);
+    CHECK((x * y) / y == x);
+    CHECK((x * y) % y == BigInt(0));
+
+    BigInt s = x;
+    s += s;
+    CHECK(s == x * 2);
+    s -= s;
+    CHECK(s.is_zero());
+  }
+}
+
+TEST_CASE("bigint_large_division_and_conversion") {
+  std::mt19937_64 gen(7);
+
+  // Burnikel-Ziegler against schoolbook division, on unbalanced operands
+  // whose limb counts are neither powers of two nor even.
+  for (auto [an, bn] : std::vector<std::pair<std::size_t, std::size_t>>{
+           {20000, 1000}, {9000, 4500}, {12345, 6789}, {30000, 29000}}) {
+    BigInt x(random_digits(gen, an)), y(random_digits(gen, bn));
+    auto [q, r] = divmod(x, y);
+    BigInt q2, r2;
+    utils::detail::bigint_divrem_basecase(x, y, q2, r2);
+    CHECK(q == q2);
+    CHECK(r == r2);
+    CHECK(q * y + r == x);
+  }
+
+  // The quotient estimate is B^n - 1 when the top blocks are equal.
+  BigInt b = (BigInt(2) ^ BigInt(64 * 200)) - 1;
+  BigInt a = b * b * b - 1;
+  auto [q, r] = divmod(a, b);
+  CHECK(q == b * b - 1);
+  CHECK(r == b - 1);
+
+  // Divide-and-conquer radix conversion on 100k digits.
+  std::string digits = random_digits(gen, 100000);
+  BigInt x(digits);
+  CHECK(x.to_string() == digits);
+  CHECK((-x).to_string() == "-" + digits);
+  CHECK(x.size() == 100000);
+
+  std::string power = "1";
+  power.append(50000, '0');
+  CHECK((BigInt(10) ^ BigInt(50000)).to_string() == power);
+  CHECK(BigInt(power) == (BigInt(10) ^ BigInt(50000)));
+  CHECK(BigInt(std::string(40000, '9')) + 1 == (BigInt(10) ^ BigInt(40000)));
+  CHECK(BigInt(std::string(3000, '0') + "12") == BigInt(12));
+}
+
+TEST_CASE("bigint_multiplication_tiers") {
+  using utils::detail::limb;
+  std::mt19937_64 gen(11);
+
+  // Every tier against schoolbook, on random limbs and on all-ones limbs,
+  // which give the largest convolution coefficients.
+  for (std::size_t n : {40, 260, 700}) {
+    for (bool ones : {false, true}) {
+      std::vector<limb> a(n), b(n * 3 / 4 + 1);
+      for (auto &x : a)
+        x = ones ? ~limb{0} : gen();
+      for (auto &x : b)
+        x = ones ? ~limb{0} : gen();
+      std::size_t an = a.size(), bn = b.size();
+
+      std::vector<limb> expected(an + bn), r(an + bn);
+      utils::detail::limbs_mul_basecase(expected.data(), a.data(), an,
+                                        b.data(), bn);
+      utils::detail::limbs_mul_karatsuba(r.data(), a.data(), an, b.data(),
+                                         bn);
+      CHECK(r == expected);
+      utils::detail::limbs_mul_toom3(r.data(), a.data(), an, b.data(), bn);
+      CHECK(r == expected);
+      utils::detail::limbs_mul_ntt(r.data(), a.data(), an, b.data(), bn);
+      CHECK(r == expected);
+
+      std::vector<limb> square(2 * an), sq(2 * an);
+      utils::detail::limbs_mul_basecase(square.data(), a.data(), an,
+                                        a.data(), an);
+      utils::detail::limbs_sqr_basecase(sq.data(), a.data(), an);
+      CHECK(sq == square);
+      utils::detail::limbs_sqr_karatsuba(sq.data(), a.data(), an);
+      CHECK(sq == square);
+      utils::detail::limbs_mul_toom3(sq.data(), a.data(), an, a.data(), an);
+      CHECK(sq == square);
+      utils::detail::limbs_mul_ntt(sq.data(), a.data(), an, a.data(), an);
+      CHECK(sq == square);
+    }
+  }
+
+  // Exponentiation squares its way through every tier.
+  BigInt x = BigInt(3) ^ BigInt(400000);
+  BigInt y = BigInt(3) ^ BigInt(200000);
+  CHECK(x == y * y);
+  CHECK(x == (BigInt(3) ^ BigInt(150000)) * (BigInt(3) ^ BigInt(250000)));
+  CHECK(x % 1000 == 1);
+  CHECK(x / y == y);
+}
+
+TEST_CASE("bigint_in_place_and_small_values") {
+  // Up to 128 bits stay inline, including through arithmetic.
+  BigInt x("340282366920938463463374607431768211455"); // 2^128 - 1
+  CHECK(x.a.is_inline());
+  BigInt y = x;
+  y -= BigInt("18446744073709551616");
+  CHECK(y.a.is_inline());
+  BigInt z = x;
+  z += 1;
+  CHECK(!z.a.is_inline());
+  CHECK(z == (BigInt(2) ^ BigInt(128)));
+
+  BigInt moved = std::move(z);
+  CHECK(moved == (BigInt(2) ^ BigInt(128)));
+  CHECK(z.is_zero());
+
+  // 128-bit division takes the direct path.
+  auto [q, r] = divmod(x, BigInt("98765432109876543210"));
+  CHECK(q == BigInt("3445358964686899059"));
+  CHECK(r == BigInt("3465190854646372065"));
+  CHECK(q * BigInt("98765432109876543210") + r == x);
+
+  // In-place multiplication, including aliasing and capacity reuse.
+  std::mt19937_64 gen(5);
+  for (std::size_t digits : {1, 20, 40, 300, 3000}) {
+    BigInt u(random_digits(gen, digits)), v(random_digits(gen, digits + 7));
+    BigInt expected = u * v;
+    BigInt w = u;
+    w *= v;
+    CHECK(w == expected);
+    w = -v;
+    w *= u;
+    CHECK(w == -expected);
+    w = u;
+    w *= w;
+    CHECK(w == u * u);
+
+    // Fused multiply-add against the separate operations.
+    BigInt acc = v;
+    addmul(acc, u, BigInt(12345));
+    CHECK(acc == v + u * 12345);
+    submul(acc, u, BigInt(12345));
+    CHECK(acc == v);
+    addmul(acc, u, v);
+    CHECK(acc == v + expected);
+    submul(acc, -u, -v);
+    CHECK(acc == v);
+    submul(acc, BigInt(3), v);
+    CHECK(acc == -v - v);
+    addmul(acc, acc, BigInt(2));
+    CHECK(acc == (-v - v) * 3);
+    addmul(acc, BigInt(0), u);
+    CHECK(acc == (-v - v) * 3);
+  }
+}
@@ -0,0 +1,85 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/bigint_modular.hpp"
+
+#include <random>
+#include <string>
+
+using namespace utils;
+
+namespace {
+
+BigInt random_below(std::mt19937_64 &gen, const BigInt &m) {
+  BigInt x;
+  x.a.resize(m.a.size() + 1);
+  for (auto &limb : x.a)
+    limb = gen();
+  x.trim();
+  return x % m;
+}
+
+} // namespace
+
+TEST_CASE("powmod known values") {
+  BigInt m("10000000000000000000000000000000000000009"); // 10^40 + 9
+  CHECK(powmod(BigInt(3), BigInt("1000000000000000000000000000007"), m) ==
+        BigInt("2138002172992880834929659640920470850964"));
+  CHECK(modinv(BigInt(17), m) ==
+        BigInt("1176470588235294117647058823529411764707"));
+  CHECK(powmod(BigInt(17), BigInt(-1), m) == modinv(BigInt(17), m));
+
+  // Even modulus, without Montgomery form.
+  BigInt even = BigInt("18446744073709551616") * 6; // 6 2^64
+  CHECK(powmod(BigInt(123456789), BigInt(987654321), even) ==
+        BigInt("2707128288486860373"));
+
+  // Fermat on the Mersenne prime 2^521 - 1, which has nine limbs.
+  BigInt p = (BigInt(2) ^ BigInt(521)) - 1;
+  CHECK(powmod(BigInt(5), p - 1, p) == BigInt(1));
+  CHECK(powmod(BigInt(-5), p - 1, p) == BigInt(1));
+
+  CHECK(powmod(BigInt(7), BigInt(0), BigInt(13)) == BigInt(1));
+  CHECK(powmod(BigInt(7), BigInt(5), BigInt(1)) == BigInt(0));
+  CHECK_THROWS_AS(powmod(BigInt(2), BigInt(3), BigInt(0)), std::domain_error);
+  CHECK_THROWS_AS(modinv(BigInt(6), BigInt(9)), std::domain_error);
+  CHECK_THROWS_AS(MontgomeryContext(BigInt(10)), std::domain_error);
+}
+
+TEST_CASE("montgomery context against plain arithmetic") {
+  std::mt19937_64 gen(3);
+  for (std::size_t bits : {60, 64, 130, 700, 3000}) {
+    BigInt m = (BigInt(2) ^ BigInt(static_cast<long long>(bits))) -
+               BigInt(static_cast<long long>(2 * (gen() % 1000) + 1));
+    MontgomeryContext ctx(m);
+    CHECK(ctx.modulus() == m);
+
+    for (int trial = 0; trial < 5; ++trial) {
+      BigInt x = random_below(gen, m), y = random_below(gen, m);
+      BigInt mx = ctx.to_montgomery(x), my = ctx.to_montgomery(y);
+      CHECK(ctx.from_montgomery(mx) == x);
+      CHECK(ctx.from_montgomery(ctx.multiply(mx, my)) == x * y % m);
+      CHECK(ctx.from_montgomery(ctx.multiply(mx, mx)) == x * x % m);
+      CHECK(ctx.to_montgomery(-x) == ctx.to_montgomery(m - x));
+
+      BigInt e = random_below(gen, BigInt(1000000));
+      BigInt expected = BigInt(1);
+      BigInt base = x;
+      for (BigInt k = e; !k.is_zero(); k /= 2) {
+        if (k.is_odd())
+          expected = expected * base % m;
+        base = base * base % m;
+      }
+      CHECK(ctx.pow(x, e) == expected);
+      CHECK(powmod(x, e, m) == expected);
+      CHECK(powmod(x, e, m * 2) % m == expected);
+
+      if (gcd(x, m) == BigInt(1)) {
+        BigInt inv = modinv(x, m);
+        CHECK(inv >= BigInt(0));
+        CHECK(inv < m);
+        CHECK(x * inv % m == BigInt(1));
+      }
+    }
+  }
+}
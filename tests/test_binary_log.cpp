@@ -0,0 +1,169 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/binary_log.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+ENABLE_LOG_GROUPS(trace, info)
+CREATE_LOG_GROUPS(trace, info, hidden)
+
+enum class color : std::uint8_t { red, green };
+
+struct point {
+  int x, y;
+};
+
+std::ostream &operator<<(std::ostream &os, const point &p) {
+  return os << '(' << p.x << ", " << p.y << ')';
+}
+
+void log_all_types(int i) {
+  LOGF(trace, "i={} u={} big={} f={} d={} b={} c={} s={} e={} p={}", i, 7u,
+       -(1LL << 40), 0.5f, 2.25, true, 'z', std::string("str"), color::green,
+       point{i, -i});
+}
+
+std::string decode(const std::string &filename, BinaryLogFormat format) {
+  std::ifstream in(filename, std::ios::binary);
+  std::ostringstream out;
+  decode_binary_log(in, out, format);
+  return out.str();
+}
+
+// Drops the "2023-01-31 12:34:56.123456 -- " prefix of text lines.
+std::vector<std::string> messages(const std::string &text) {
+  std::vector<std::string> lines;
+  std::istringstream in(text);
+  std::string line;
+  while (std::getline(in, line)) {
+    lines.push_back(line.substr(line.find(" -- ") + 4));
+  }
+  return lines;
+}
+
+TEST_CASE("text mode without a binary log") {
+  std::stringstream ss;
+  Logger::set_log_stream(ss);
+
+  log_all_types(3);
+  LOGF(info, "no arguments");
+  LOGF(info, "{} of {}", 1);
+  LOGF(info, "extra", 1, 2);
+  LOGF(hidden, "compiled out {}", 1);
+  LOGF_AT(info, debug, "filtered at runtime {}", 1);
+
+  CHECK(ss.str() == "[trace]: i=3 u=7 big=-1099511627776 f=0.5 d=2.25 b=1 "
+                    "c=z s=str e=1 p=(3, -3)\n"
+                    "[info]: no arguments\n"
+                    "[info]: 1 of {}\n"
+                    "[info]: extra 1 2\n");
+  Logger::set_log_stream(std::clog);
+}
+
+TEST_CASE("binary round trip") {
+  std::string filename = "temporary_binary_log.bin";
+
+  // A tiny buffer, so that messages reach the file from several flushes.
+  BinaryLogger::open(filename, 64);
+  CHECK(BinaryLogger::is_open());
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < 100; ++i) {
+        LOGF(info, "thread {} message {}", t, i);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_all_types(5);
+  LOGF(info, "no arguments");
+  LOGF_AT(info, debug, "filtered");
+  BinaryLogger::close();
+  CHECK(!BinaryLogger::is_open());
+
+  auto lines = messages(decode(filename, BinaryLogFormat::text));
+  REQUIRE(lines.size() == 402);
+
+  std::vector<int> next(4, 0);
+  bool in_order = true;
+  for (std::size_t k = 0; k < 400; ++k) {
+    int t, i;
+    REQUIRE(std::sscanf(lines[k].c_str(), "[info]: thread %d message %d", &t,
+                        &i) == 2);
+    in_order = in_order && next[t] == i;
+    next[t] = i + 1;
+  }
+  CHECK(in_order);
+  CHECK(lines[400] == "[trace]: i=5 u=7 big=-1099511627776 f=0.5 d=2.25 b=1 "
+                      "c=z s=str e=1 p=(5, -5)");
+  CHECK(lines[401] == "[info]: no arguments");
+
+  SUBCASE("json") {
+    std::istringstream json(decode(filename, BinaryLogFormat::json));
+    std::string line, last;
+    int count = 0;
+    while (std::getline(json, line)) {
+      ++count;
+      if (line.find("\"trace\"") != std::string::npos) {
+        last = line;
+      }
+    }
+    CHECK(count == 402);
+
+    auto j = utils::parse(last);
+    CHECK(j["group"].get<std::string>() == "trace");
+    CHECK(j["level"].get<std::string>() == "info");
+    CHECK(j["message"].get<std::string>() ==
+          "i=5 u=7 big=-1099511627776 f=0.5 d=2.25 b=1 c=z s=str e=1 p=(5, "
+          "-5)");
+    auto args = j["args"].as_array_view();
+    REQUIRE(args.size() == 10);
+    CHECK(args[0].get<double>() == 5);
+    CHECK(args[3].get<double>() == 0.5);
+    CHECK(args[5].get<bool>() == true);
+    CHECK(args[6].get<std::string>() == "z");
+    CHECK(args[9].get<std::string>() == "(5, -5)");
+  }
+
+  SUBCASE("reopen") {
+    // Descriptors are written again to a new file.
+    BinaryLogger::open(filename);
+    log_all_types(6);
+    BinaryLogger::close();
+    auto reopened = messages(decode(filename, BinaryLogFormat::text));
+    REQUIRE(reopened.size() == 1);
+    CHECK(reopened[0].find("i=6") != std::string::npos);
+  }
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("decoding errors") {
+  std::ostringstream out;
+
+  std::istringstream not_a_log("hello world, this is not a log");
+  CHECK_THROWS_AS(decode_binary_log(not_a_log, out, BinaryLogFormat::text),
+                  std::runtime_error);
+
+  std::string filename = "temporary_binary_log_truncated.bin";
+  BinaryLogger::open(filename);
+  log_all_types(1);
+  BinaryLogger::close();
+
+  std::ifstream in(filename, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)),
+                    std::istreambuf_iterator<char>());
+  std::istringstream truncated(bytes.substr(0, bytes.size() - 3));
+  CHECK_THROWS_AS(decode_binary_log(truncated, out, BinaryLogFormat::text),
+                  std::runtime_error);
+  std::remove(filename.c_str());
+}
@@ -3,6 +3,11 @@
 
 #include "utils_cpp/bitvector.hpp"
 
+#include <bit>
+#include <cstdint>
+#include <random>
+#include <vector>
+
 TEST_CASE("create, set and iterate through bitvector") {
 
   utils::BitVector bv(8);
@@ -73,3 +78,134 @@ TEST_CASE("over size 64") {
     CHECK(ss.str() == "0 50 71 ");
   }
 }
+
+TEST_CASE("bulk bitwise operations") {
+  std::size_t n = 1000;
+  utils::BitVector a(n), b(n);
+  std::size_t expected_and = 0, expected_or = 0, expected_xor = 0,
+              expected_andnot = 0, expected_a = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    bool x = (i * 7) % 3 == 0;
+    bool y = (i * 11) % 5 < 2;
+    a.set(i, x);
+    b.set(i, y);
+    expected_a += x;
+    expected_and += x && y;
+    expected_or += x || y;
+    expected_xor += x != y;
+    expected_andnot += x && !y;
+  }
+
+  CHECK(a.popcount() == expected_a);
+  CHECK(utils::popcount_and(a, b) == expected_and);
+  CHECK(utils::popcount_or(a, b) == expected_or);
+  CHECK(utils::popcount_xor(a, b) == expected_xor);
+  CHECK(utils::popcount_andnot(a, b) == expected_andnot);
+
+  CHECK((a & b).popcount() == expected_and);
+  CHECK((a | b).popcount() == expected_or);
+  CHECK((a ^ b).popcount() == expected_xor);
+
+  utils::BitVector c = a;
+  c.andnot_assign(b);
+  CHECK(c.popcount() == expected_andnot);
+
+  c = a;
+  c.toggle();
+  CHECK(c.popcount() == n - expected_a);
+  c.toggle();
+  CHECK(c == a);
+}
+
+TEST_CASE("bitops kernels on long arrays") {
+  // Long enough to exercise the 64-word Harley-Seal blocks and the tails.
+  for (std::size_t words : {0, 1, 3, 4, 63, 64, 65, 200}) {
+    std::vector<std::uint64_t> a(words), b(words);
+    std::uint64_t state = 0x9e3779b97f4a7c15ULL;
+    std::size_t expected = 0, expected_and = 0;
+    for (std::size_t i = 0; i < words; ++i) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      a[i] = state;
+      b[i] = state * 0x2545F4914F6CDD1DULL;
+      expected += std::popcount(a[i]);
+      expected_and += std::popcount(a[i] & b[i]);
+    }
+    CHECK(utils::bitops::popcount(a.data(), words) == expected);
+    CHECK(utils::bitops::popcount_and(a.data(), b.data(), words) ==
+          expected_and);
+
+    utils::bitops::and_into(a.data(), b.data(), words);
+    CHECK(utils::bitops::popcount(a.data(), words) == expected_and);
+  }
+}
+
+TEST_CASE("rank and select") {
+  std::mt19937_64 gen(9);
+  for (std::size_t size : {0, 1, 63, 64, 511, 512, 513, 5000, 100000}) {
+    for (double density : {0.0, 0.001, 0.1, 0.5, 0.97, 1.0}) {
+      utils::BitVector bv(size);
+      std::bernoulli_distribution bit(density);
+      std::vector<std::size_t> ones;
+      for (std::size_t i = 0; i < size; ++i) {
+        if (bit(gen)) {
+          bv.set(i);
+          ones.push_back(i);
+        }
+      }
+
+      utils::RankSelect index(bv);
+      REQUIRE(index.num_ones() == ones.size());
+      CHECK(index.rank(size) == ones.size());
+      CHECK(bv.rank(size) == ones.size());
+      CHECK(index.index_bytes() ==
+            16 * ((size + 63) / 64 / 8 + 1) + 4 * ((ones.size() + 511) / 512));
+
+      std::size_t count = 0;
+      for (std::size_t i = 0; i < size; i += 1 + i % 7) {
+        while (count < ones.size() && ones[count] < i) {
+          ++count;
+        }
+        CHECK(index.rank(i) == count);
+        CHECK(bv.rank(i) == count);
+      }
+      for (std::size_t k = 0; k < ones.size(); k += 1 + k % 5) {
+        CHECK(index.select(k) == ones[k]);
+        CHECK(bv.select(k) == ones[k]);
+      }
+    }
+  }
+
+  for (unsigned r = 0; r < 64; ++r) {
+    CHECK(utils::bitops::select_in_word(~std::uint64_t{0}, r) == r);
+  }
+  CHECK(utils::bitops::select_in_word(0x8000000000000100ull, 1) == 63);
+}
+
+TEST_CASE("decode set bits into a buffer") {
+  std::mt19937 rng(7);
+  for (std::size_t size : {0, 1, 63, 64, 65, 1000, 4096}) {
+    for (double density : {0.01, 0.5, 0.99}) {
+      std::bernoulli_distribution coin(density);
+      utils::BitVector bv(size);
+      std::vector<std::uint32_t> ones;
+      for (std::size_t i = 0; i < size; ++i) {
+        if (coin(rng)) {
+          bv.set(i);
+          ones.push_back(static_cast<std::uint32_t>(i));
+        }
+      }
+
+      // exactly sized, so the tail is decoded without slack
+      std::vector<std::uint32_t> exact(ones.size());
+      CHECK(bv.decode_into(exact) == ones.size());
+      CHECK(exact == ones);
+
+      std::vector<std::uint32_t> roomy(size + 64);
+      std::size_t count = bv.decode_into(roomy);
+      roomy.resize(count);
+      CHECK(roomy == ones);
+    }
+  }
+}
@@ -0,0 +1,165 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/avl_tree.hpp"
+#include "utils_cpp/btree.hpp"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Random inserts and erases against std::set, through the interface that
+// AVLTree and BTreeSet share.
+template <typename Tree, typename Key>
+void check_against_set(Tree &tree, Key lo, Key hi, int steps) {
+  std::set<Key> reference;
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<Key> dist(lo, hi);
+
+  for (int step = 0; step < steps; ++step) {
+    Key key = dist(rng);
+    if (step % 3 == 2) {
+      tree.erase(key);
+      reference.erase(key);
+    } else {
+      CHECK(tree.insert(key) == reference.insert(key).second);
+    }
+    if (step % 97 == 0) {
+      CHECK(tree.contains(key) == reference.contains(key));
+    }
+  }
+
+  std::vector<Key> keys;
+  for (auto it = tree.begin(); it != tree.end(); ++it) {
+    keys.push_back(it->key);
+  }
+  CHECK(keys == std::vector<Key>(reference.begin(), reference.end()));
+  CHECK(tree.min() == *reference.begin());
+  CHECK(tree.max() == *reference.rbegin());
+
+  for (Key key : reference) {
+    tree.erase(key);
+  }
+  CHECK(tree.begin() == tree.end());
+}
+
+} // namespace
+
+TEST_CASE("BTreeSet matches std::set") {
+  SUBCASE("small nodes") {
+    utils::BTreeSet<int, std::less<int>, 8> tree;
+    check_against_set(tree, 0, 5000, 60000);
+    CHECK(tree.empty());
+  }
+  SUBCASE("default nodes") {
+    utils::BTreeSet<int> tree;
+    check_against_set(tree, -100000, 100000, 100000);
+  }
+  SUBCASE("unsigned and 64-bit keys") {
+    utils::BTreeSet<std::uint32_t, std::less<std::uint32_t>, 16> u32;
+    check_against_set(u32, std::uint32_t{0}, std::uint32_t{0xffffffff}, 20000);
+    utils::BTreeSet<std::uint64_t, std::less<std::uint64_t>, 16> u64;
+    check_against_set(u64, std::uint64_t{0}, ~std::uint64_t{0}, 20000);
+    utils::BTreeSet<std::int64_t> i64;
+    check_against_set(i64, std::int64_t{-3000}, std::int64_t{3000}, 20000);
+  }
+  SUBCASE("custom order") {
+    utils::BTreeSet<int, std::greater<int>, 8> tree;
+    for (int i = 0; i < 100; ++i) {
+      tree.insert(i);
+    }
+    CHECK(tree.begin()->key == 99);
+    CHECK(tree.min() == 99);
+    CHECK(tree.lower_bound(50)->key == 50);
+    CHECK(tree.upper_bound(50)->key == 49);
+  }
+  SUBCASE("same interface as AVLTree") {
+    utils::AVLTree<int> avl;
+    check_against_set(avl, 0, 5000, 20000);
+  }
+}
+
+TEST_CASE("BTreeSet stays shallow") {
+  utils::BTreeSet<int, std::less<int>, 8> tree;
+  for (int i = 0; i < 100000; ++i) {
+    tree.insert(i);
+  }
+  CHECK(tree.size() == 100000);
+  // Every non-root inner node has at least 4 children, and leaves hold at
+  // least 3 keys.
+  CHECK(tree.height() <= 9);
+
+  for (int i = 0; i < 100000; i += 2) {
+    CHECK(tree.erase(i));
+  }
+  CHECK_FALSE(tree.erase(0));
+  CHECK(tree.size() == 50000);
+  CHECK(tree.height() <= 9);
+
+  CHECK(tree.lower_bound(10)->key == 11);
+  CHECK(tree.upper_bound(11)->key == 13);
+  CHECK(tree.lower_bound(99999) != tree.end());
+  CHECK(tree.upper_bound(99999) == tree.end());
+
+  auto copy = tree.clone();
+  tree.clear();
+  CHECK(copy.size() == 50000);
+  int expected = 1;
+  bool in_order = true;
+  for (const auto &entry : copy) {
+    in_order = in_order && entry.key == expected;
+    expected += 2;
+  }
+  CHECK(in_order);
+}
+
+TEST_CASE("BTreeMap") {
+  utils::BTreeMap<std::string, int, std::less<std::string>, 8> map;
+  std::map<std::string, int> reference;
+  std::mt19937 rng(2);
+  std::uniform_int_distribution<int> dist(0, 3000);
+
+  for (int step = 0; step < 20000; ++step) {
+    std::string key = "key" + std::to_string(dist(rng));
+    switch (step % 4) {
+    case 0:
+      CHECK(map.insert(key, step) == reference.emplace(key, step).second);
+      break;
+    case 1:
+      map[key] += 1;
+      reference[key] += 1;
+      break;
+    case 2:
+      CHECK(map.erase(key) == (reference.erase(key) == 1));
+      break;
+    default:
+      CHECK(map.contains(key) == reference.contains(key));
+    }
+  }
+
+  CHECK(map.size() == reference.size());
+  auto ref = reference.begin();
+  bool same = true;
+  for (auto entry : map) {
+    same = same && entry.key == ref->first && entry.value == ref->second;
+    ++ref;
+  }
+  CHECK(same);
+
+  auto key = reference.begin()->first;
+  CHECK(map.at(key) == reference.at(key));
+  CHECK(map.find(key)->value == reference.at(key));
+  map.find(key)->value = -1;
+  CHECK(map.at(key) == -1);
+  CHECK(map.find("missing") == map.end());
+  CHECK_THROWS_AS(map.at("missing"), std::out_of_range);
+
+  const auto &const_map = map;
+  CHECK(const_map.begin()->key == key);
+}
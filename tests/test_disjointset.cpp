@@ -3,6 +3,12 @@
 
 #include "utils_cpp/disjointset.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
 using namespace utils;
 
 TEST_CASE("Constructor & Initial State") {
@@ -63,3 +69,59 @@ TEST_CASE("Further Unifications") {
   components = ds.get_connected_components();
   CHECK(components.size() == 2);
 }
+
+TEST_CASE("ConcurrentDisjointSet matches DisjointSet") {
+  const std::size_t n = 20000;
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<std::uint32_t> vertex(0, n - 1);
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> edges(15000);
+  for (auto &e : edges) {
+    e = {vertex(rng), vertex(rng)};
+  }
+
+  DisjointSet reference(static_cast<int>(n));
+  for (auto [a, b] : edges) {
+    reference.unify(static_cast<int>(a), static_cast<int>(b));
+  }
+  auto expected = reference.get_connected_components();
+
+  parallel::thread_pool pool(4);
+  for (parallel::thread_pool *p : {static_cast<parallel::thread_pool *>(nullptr),
+                                   &pool}) {
+    ConcurrentDisjointSet<> ds(n);
+    ds.unite_all(edges, p);
+    auto components = ds.components(p);
+
+    // DisjointSet also numbers components by their smallest element.
+    REQUIRE(components.size() == expected.size());
+    bool same = true;
+    for (std::size_t c = 0; c < expected.size(); ++c) {
+      auto got = components.component(c);
+      same = same && std::equal(got.begin(), got.end(), expected[c].begin(),
+                                expected[c].end());
+      for (auto v : got) {
+        same = same && components.labels[v] == c;
+      }
+    }
+    CHECK(same);
+    CHECK(ds.same(edges[0].first, edges[0].second));
+  }
+}
+
+TEST_CASE("ConcurrentDisjointSet with 64-bit indices") {
+  ConcurrentDisjointSet<std::uint64_t> ds(10);
+  CHECK(ds.unite(1, 2));
+  CHECK(ds.unite(2, 3));
+  CHECK_FALSE(ds.unite(1, 3));
+  CHECK(ds.unite(8, 9));
+  CHECK(ds.same(1, 3));
+  CHECK_FALSE(ds.same(1, 9));
+
+  auto components = ds.components();
+  CHECK(components.size() == 7);
+  CHECK(components.offsets.back() == 10);
+  CHECK(std::vector<std::uint64_t>(components.component(1).begin(),
+                                   components.component(1).end()) ==
+        std::vector<std::uint64_t>{1, 2, 3});
+  CHECK(components.labels[9] == 6);
+}
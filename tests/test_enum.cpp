@@ -2,6 +2,10 @@
 #include "doctest/doctest.h"
 
 #include "utils_cpp/enum/enum_map.hpp"
+#include "utils_cpp/enum/enum_string.hpp"
+#include "utils_cpp/graph/algorithms.hpp"
+
+#include <string>
 
 enum class TestEnum {
   A,
@@ -20,3 +24,47 @@ TEST_CASE("test enum map") {
   CHECK(test_map[TestEnum::C] == 3);
   CHECK(test_map[TestEnum::D] == 4);
 }
+
+namespace outer::inner {
+enum class Sparse { zero = 0, seven = 7, big = 200 };
+enum Plain { red, green, blue };
+} // namespace outer::inner
+
+TEST_CASE("enum names to and from strings") {
+  using outer::inner::Sparse;
+
+  static_assert(utils::enum_to_string(TestEnum::C) == "C");
+  static_assert(utils::enum_from_string<TestEnum>("D") == TestEnum::D);
+  static_assert(!utils::enum_from_string<TestEnum>("E"));
+  static_assert(utils::enum_values<Sparse>().size() == 3);
+
+  SUBCASE("fields round trip") {
+    for (auto e : utils::enum_values<TestEnum>()) {
+      CHECK(utils::enum_from_string<TestEnum>(utils::enum_to_string(e)) == e);
+    }
+    CHECK(utils::enum_to_string(Sparse::big) == "big");
+    CHECK(utils::enum_from_string<Sparse>("seven") == Sparse::seven);
+    CHECK(utils::enum_from_string<outer::inner::Plain>("blue") ==
+          outer::inner::blue);
+    CHECK(utils::enum_from_string<utils::gl::graph_coloring_strategy>(
+              "SMALLEST_LAST") ==
+          utils::gl::graph_coloring_strategy::SMALLEST_LAST);
+  }
+
+  SUBCASE("values without a field") {
+    CHECK(utils::enum_to_string(static_cast<Sparse>(3)).empty());
+    CHECK(utils::enum_to_string(static_cast<Sparse>(1000)).empty());
+  }
+
+  SUBCASE("unknown names") {
+    CHECK_FALSE(utils::enum_from_string<Sparse>(""));
+    CHECK_FALSE(utils::enum_from_string<Sparse>("Sparse::big"));
+    CHECK_FALSE(utils::enum_from_string<Sparse>("bi"));
+    CHECK_FALSE(utils::enum_from_string<Sparse>("big "));
+    for (int i = 0; i < 1000; ++i) {
+      std::string name = "x";
+      name += std::to_string(i);
+      CHECK_FALSE(utils::enum_from_string<TestEnum>(name));
+    }
+  }
+}
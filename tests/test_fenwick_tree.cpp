@@ -0,0 +1,59 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/fenwick_tree.hpp"
+
+#include <numeric>
+#include <random>
+#include <vector>
+
+TEST_CASE("FenwickTree prefix sums") {
+  std::mt19937 rng(8);
+  std::uniform_int_distribution<int> value(0, 20);
+
+  for (std::size_t n : {1, 5, 64, 100}) {
+    std::vector<long long> reference(n);
+    for (auto &v : reference) {
+      v = value(rng);
+    }
+    utils::FenwickTree<long long> tree(reference);
+    CHECK(tree.size() == n);
+
+    std::uniform_int_distribution<std::size_t> index(0, n - 1);
+    for (int step = 0; step < 500; ++step) {
+      std::size_t i = index(rng);
+      long long delta = value(rng);
+      reference[i] += delta;
+      tree.add(i, delta);
+
+      std::size_t r = index(rng) + 1;
+      CHECK(tree.prefix(r) ==
+            std::accumulate(reference.begin(), reference.begin() + r, 0LL));
+      CHECK(tree.sum(i, r < i ? i : r) ==
+            std::accumulate(reference.begin() + i,
+                            reference.begin() + (r < i ? i : r), 0LL));
+    }
+
+    std::vector<long long> prefix(n + 1);
+    std::partial_sum(reference.begin(), reference.end(), prefix.begin() + 1);
+    for (long long target = 0; target <= prefix[n] + 1; target += 7) {
+      std::size_t expected = static_cast<std::size_t>(
+          std::lower_bound(prefix.begin() + 1, prefix.end(), target) -
+          (prefix.begin() + 1));
+      CHECK(tree.lower_bound(target) == expected);
+    }
+  }
+}
+
+TEST_CASE("FenwickTree starting from zeros") {
+  utils::FenwickTree<int> tree(10);
+  CHECK(tree.prefix(10) == 0);
+  tree.add(3, 5);
+  tree.add(7, 2);
+  CHECK(tree.prefix(3) == 0);
+  CHECK(tree.prefix(4) == 5);
+  CHECK(tree.sum(4, 10) == 2);
+  CHECK(tree.lower_bound(1) == 3);
+  CHECK(tree.lower_bound(6) == 7);
+  CHECK(tree.lower_bound(8) == 10);
+}
@@ -0,0 +1,152 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/flat_hash_map.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace utils;
+
+TEST_CASE("group matches agree with the portable versions") {
+  std::mt19937 rng(3);
+  alignas(16) detail::flat_ctrl ctrl[16];
+  for (int round = 0; round < 1000; ++round) {
+    for (auto &c : ctrl) {
+      switch (rng() % 4) {
+      case 0:
+        c = detail::flat_empty;
+        break;
+      case 1:
+        c = detail::flat_deleted;
+        break;
+      default:
+        c = static_cast<detail::flat_ctrl>(rng() % 128);
+      }
+    }
+    auto h2 = static_cast<detail::flat_ctrl>(rng() % 128);
+    std::uint32_t expected_match = 0, expected_free = 0, expected_empty = 0;
+    for (std::uint32_t i = 0; i < 16; ++i) {
+      expected_match |= std::uint32_t{ctrl[i] == h2} << i;
+      expected_free |= std::uint32_t{ctrl[i] < 0} << i;
+      expected_empty |= std::uint32_t{ctrl[i] == detail::flat_empty} << i;
+    }
+    CHECK(detail::flat_group::match(ctrl, h2) == expected_match);
+    CHECK(detail::flat_group::match_portable(ctrl, h2) == expected_match);
+    CHECK(detail::flat_group::match_free(ctrl) == expected_free);
+    CHECK(detail::flat_group::match_free_portable(ctrl) == expected_free);
+    CHECK(detail::flat_group::match_empty(ctrl) == expected_empty);
+  }
+}
+
+TEST_CASE("FlatHashMap matches std::map") {
+  FlatHashMap<int, int> map;
+  std::map<int, int> reference;
+  std::mt19937 rng(7);
+
+  for (int step = 0; step < 200000; ++step) {
+    int key = static_cast<int>(rng() % 5000);
+    switch (step % 4) {
+    case 0:
+    case 1: {
+      auto [it, inserted] = map.insert({key, step});
+      CHECK(inserted == reference.insert({key, step}).second);
+      CHECK(it->first == key);
+      break;
+    }
+    case 2:
+      CHECK(map.erase(key) == reference.erase(key));
+      break;
+    case 3:
+      map[key] += 1;
+      reference[key] += 1;
+      break;
+    }
+  }
+  CHECK(map.size() == reference.size());
+  CHECK(map.load_factor() <= FlatHashMap<int, int>::max_load_factor());
+  CHECK(std::map<int, int>(map.begin(), map.end()) == reference);
+  for (int key = 0; key < 5000; ++key) {
+    CHECK(map.contains(key) == reference.contains(key));
+  }
+
+  // Erasing while iterating.
+  for (auto it = map.begin(); it != map.end();) {
+    it = it->second % 2 == 0 ? map.erase(it) : std::next(it);
+  }
+  std::erase_if(reference, [](const auto &kv) { return kv.second % 2 == 0; });
+  CHECK(std::map<int, int>(map.begin(), map.end()) == reference);
+}
+
+TEST_CASE("FlatHashSet") {
+  FlatHashSet<std::string> set{"a", "b", "c"};
+  CHECK(set.size() == 3);
+  CHECK(set.insert("a").second == false);
+  CHECK(set.emplace("d").second);
+  CHECK(set.count("d") == 1);
+  CHECK(set.find("e") == set.end());
+  CHECK(std::set<std::string>(set.begin(), set.end()) ==
+        std::set<std::string>{"a", "b", "c", "d"});
+
+  // Many erases and inserts in a table that never grows exercise the
+  // deleted markers and the rebuild that clears them.
+  FlatHashSet<std::uint64_t> ints;
+  ints.reserve(100);
+  const auto capacity = ints.capacity();
+  for (std::uint64_t i = 0; i < 100000; ++i) {
+    ints.insert(i);
+    if (i >= 50) {
+      CHECK(ints.erase(i - 50) == 1);
+    }
+  }
+  CHECK(ints.size() == 50);
+  CHECK(ints.capacity() == capacity);
+  for (std::uint64_t i = 100000 - 50; i < 100000; ++i) {
+    CHECK(ints.contains(i));
+  }
+  CHECK_FALSE(ints.contains(100000 - 51));
+
+  ints.clear();
+  CHECK(ints.empty());
+  CHECK(ints.begin() == ints.end());
+  ints.rehash(0);
+  CHECK(ints.capacity() == 0);
+  CHECK_FALSE(ints.contains(1));
+}
+
+TEST_CASE("copies, moves and comparisons") {
+  FlatHashMap<std::string, std::vector<int>> map;
+  for (int i = 0; i < 100; ++i) {
+    map[std::to_string(i)] = {i, i};
+  }
+  auto copy = map;
+  CHECK(copy == map);
+  copy["0"].push_back(1);
+  CHECK(copy != map);
+  CHECK(map.at("0").size() == 2);
+  CHECK_THROWS_AS(map.at("x"), std::out_of_range);
+
+  auto moved = std::move(copy);
+  CHECK(moved.size() == 100);
+  CHECK(copy.empty());
+  copy = moved;
+  CHECK(copy == moved);
+  copy = std::move(map);
+  CHECK(copy.at("0") == std::vector<int>{0, 0});
+
+  CHECK(moved.try_emplace("0", 5, 5).second == false);
+  CHECK(moved.try_emplace("new", 2, 7).second);
+  CHECK(moved.at("new") == std::vector<int>{7, 7});
+
+  FlatHashMap<int, std::unique_ptr<int>> owners;
+  for (int i = 0; i < 1000; ++i) {
+    owners.try_emplace(i, std::make_unique<int>(i));
+  }
+  CHECK(*owners.at(999) == 999);
+}
@@ -3,7 +3,33 @@
 
 #include "utils_cpp/hash.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <iostream>
+#include <span>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+// An undirected edge: equal to its reverse, with a hash to match.
+struct UEdge {
+  int u, v;
+  friend bool operator==(const UEdge &a, const UEdge &b) {
+    return (a.u == b.u && a.v == b.v) || (a.u == b.v && a.v == b.u);
+  }
+};
+
+} // namespace
+
+template <>
+struct std::hash<UEdge> {
+  std::size_t operator()(const UEdge &e) const {
+    return std::hash<int>{}(std::min(e.u, e.v)) * 31 +
+           std::hash<int>{}(std::max(e.u, e.v));
+  }
+};
 
 TEST_CASE("test basic hashes") {
 
@@ -86,3 +112,105 @@ TEST_CASE("test with equality") {
   CHECK(array_uset.contains(std::array<int, 3>({2, 1, 0})));
   CHECK(array_uset.contains(std::array<int, 3>({0, 2, 3})) == false);
 }
+
+TEST_CASE("symmetric hashes ignore order but not multiplicity") {
+  utils::symmetric_pair_hash<int, int> h;
+  CHECK(h({3, 7}) == h({7, 3}));
+  CHECK(h({3, 3}) != h({7, 7}));
+
+  utils::symmetric_vector_hash<int> vh;
+  CHECK(vh({1, 2, 3}) == vh({3, 1, 2}));
+  // Xor-based combining would make both of these hash like {}.
+  CHECK(vh({5, 5}) != vh({}));
+  CHECK(vh({1, 1, 2}) != vh({2}));
+
+  utils::set_hash<std::string> sh;
+  CHECK(sh({"a", "b"}) != sh({"a", "c"}));
+}
+
+TEST_CASE("ordered hashes depend on order") {
+  utils::pair_hash<int, int> h;
+  CHECK(h({3, 7}) != h({7, 3}));
+  CHECK(h({0, 0}) != h({0, 1}));
+
+  utils::vector_hash<int> vh;
+  CHECK(vh({1, 2, 3}) != vh({3, 2, 1}));
+  CHECK(vh({}) != vh({0}));
+  CHECK(vh({0}) != vh({0, 0}));
+  // Byte-hashed and element-wise paths are both deterministic.
+  CHECK(vh({1, 2, 3}) == vh({1, 2, 3}));
+  utils::vector_hash<std::string> svh;
+  CHECK(svh({"a", "b"}) == svh({"a", "b"}));
+  CHECK(svh({"a", "b"}) != svh({"b", "a"}));
+
+  std::array<int, 3> a{1, 2, 3};
+  std::vector<int> v{1, 2, 3};
+  CHECK(utils::array_hash<int, 3>{}(a) == utils::hash_span(std::span(v)));
+}
+
+TEST_CASE("hash_bytes") {
+  // Every length from 0 to 200 over a prefix of the same buffer, which
+  // covers the short, 16-byte and 48-byte paths.
+  std::vector<unsigned char> bytes(200);
+  for (std::size_t i = 0; i < bytes.size(); ++i) {
+    bytes[i] = static_cast<unsigned char>(i * 31 + 7);
+  }
+  std::unordered_set<std::size_t> seen;
+  for (std::size_t len = 0; len <= bytes.size(); ++len) {
+    seen.insert(utils::hash_bytes(bytes.data(), len));
+  }
+  CHECK(seen.size() == bytes.size() + 1);
+  CHECK(utils::hash_bytes(bytes.data(), 10, 1) !=
+        utils::hash_bytes(bytes.data(), 10, 2));
+
+  // Flipping one input bit flips about half of the output bits.
+  for (std::size_t len : {3, 8, 16, 40, 100}) {
+    const std::size_t base = utils::hash_bytes(bytes.data(), len);
+    double total = 0;
+    for (std::size_t bit = 0; bit < len * 8; ++bit) {
+      auto flipped = bytes;
+      flipped[bit / 8] ^= static_cast<unsigned char>(1u << (bit % 8));
+      total += std::popcount(base ^ utils::hash_bytes(flipped.data(), len));
+    }
+    CHECK(total / static_cast<double>(len * 8) ==
+          doctest::Approx(32).epsilon(0.15));
+  }
+}
+
+TEST_CASE("pair keys spread over the low bits") {
+  // Grid edges (i, j) -> (i, j + 1) as vertex index pairs, the keys an
+  // EdgeMap sees. A power-of-two table indexes by the low bits only.
+  constexpr std::size_t side = 128, bins = 1024;
+  std::vector<std::size_t> ordered(bins), symmetric(bins);
+  utils::pair_hash<std::size_t, std::size_t> h;
+  utils::symmetric_pair_hash<std::size_t, std::size_t> sh;
+  std::size_t keys = 0;
+  for (std::size_t i = 0; i < side; ++i) {
+    for (std::size_t j = 0; j + 1 < side; ++j) {
+      std::pair<std::size_t, std::size_t> e{i * side + j, i * side + j + 1};
+      ++ordered[h(e) % bins];
+      ++symmetric[sh(e) % bins];
+      ++keys;
+    }
+  }
+  // About 16 keys per bin on average.
+  CHECK(*std::max_element(ordered.begin(), ordered.end()) < 3 * keys / bins);
+  CHECK(*std::max_element(symmetric.begin(), symmetric.end()) <
+        3 * keys / bins);
+}
+
+TEST_CASE("sequence hashes use a custom std::hash") {
+  static_assert(std::has_unique_object_representations_v<UEdge>);
+  std::vector<UEdge> a{{1, 2}, {3, 4}};
+  std::vector<UEdge> b{{2, 1}, {4, 3}};
+  REQUIRE(a == b);
+
+  utils::vector_hash<UEdge> h;
+  CHECK(h(a) == h(b));
+  CHECK(utils::hash_span(std::span(a)) == utils::hash_span(std::span(b)));
+
+  std::unordered_set<std::vector<UEdge>, utils::vector_hash<UEdge>> set;
+  set.insert(a);
+  set.insert(b);
+  CHECK(set.size() == 1);
+}
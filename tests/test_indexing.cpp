@@ -1,6 +1,7 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
+#include "utils_cpp/flat_hash_map.hpp"
 #include "utils_cpp/indexing.hpp"
 
 using namespace utils;
@@ -18,3 +19,10 @@ TEST_CASE("testing apply_index_mapping") {
   CHECK(mappedVec2 ==
         std::vector<std::vector<std::size_t>>{{10, 20}, {30, 40}});
 }
+
+TEST_CASE("apply_index_mapping with a FlatHashMap") {
+  FlatHashMap<std::size_t, std::size_t> mapping = {{1, 10}, {2, 20}};
+  std::vector<std::vector<std::size_t>> vec = {{1}, {2, 1}};
+  CHECK(apply_index_mapping(vec, mapping) ==
+        std::vector<std::vector<std::size_t>>{{10}, {20, 10}});
+}
@@ -3,6 +3,14 @@
 
 #include "utils_cpp/interval_tree.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <set>
+#include <span>
+#include <vector>
+
 TEST_CASE("test insert") {
 
   utils::IntervalTree<int> tree;
@@ -22,3 +30,92 @@ TEST_CASE("test insert") {
 
   CHECK((tree.balance() >= -1 && tree.balance() <= 1));
 }
+
+TEST_CASE("random inserts and erases") {
+  utils::IntervalTree<int> tree;
+  std::set<std::pair<int, int>> reference;
+  std::mt19937 rng(4);
+  std::uniform_int_distribution<int> low_dist(0, 5000), len_dist(0, 20);
+
+  for (int step = 0; step < 30000; ++step) {
+    int low = low_dist(rng);
+    std::pair<int, int> interval{low, low + len_dist(rng)};
+    if (step % 3 == 2 && !reference.empty()) {
+      // erase an existing interval
+      auto it = reference.lower_bound(interval);
+      if (it == reference.end()) {
+        it = reference.begin();
+      }
+      tree.erase(*it);
+      reference.erase(it);
+    } else {
+      CHECK(tree.insert(interval) == reference.insert(interval).second);
+    }
+  }
+
+  double n = static_cast<double>(reference.size());
+  CHECK(static_cast<double>(tree.height()) < 1.44 * std::log2(n + 2));
+
+  for (int point = -1; point < 5025; ++point) {
+    bool expected = false;
+    for (auto [low, high] : reference) {
+      if (low > point) {
+        break;
+      }
+      expected = expected || high >= point;
+    }
+    CHECK(tree.contains(point) == expected);
+  }
+}
+
+TEST_CASE("overlap enumeration and batch point queries") {
+  utils::IntervalTree<int> tree;
+  std::vector<std::pair<int, int>> intervals;
+  std::mt19937 rng(6);
+  std::uniform_int_distribution<int> low_dist(0, 3000), len_dist(0, 50);
+  for (int i = 0; i < 2000; ++i) {
+    int low = low_dist(rng);
+    std::pair<int, int> interval{low, low + len_dist(rng)};
+    if (tree.insert(interval)) {
+      intervals.push_back(interval);
+    }
+  }
+  std::sort(intervals.begin(), intervals.end());
+
+  SUBCASE("find_overlapping") {
+    for (int q = 0; q < 300; ++q) {
+      int low = low_dist(rng) - 20;
+      int high = low + len_dist(rng);
+      std::vector<std::pair<int, int>> expected, found;
+      for (auto [a, b] : intervals) {
+        if (a <= high && low <= b) {
+          expected.emplace_back(a, b);
+        }
+      }
+      tree.find_overlapping(low, high, std::back_inserter(found));
+      CHECK(found == expected);
+    }
+  }
+
+  SUBCASE("find_containing") {
+    std::vector<int> points;
+    for (int q = 0; q < 500; ++q) {
+      points.push_back(low_dist(rng) + 10);
+    }
+    points.push_back(points.front()); // a repeated point is answered twice
+    std::sort(points.begin(), points.end());
+
+    std::vector<std::pair<std::size_t, std::pair<int, int>>> expected, found;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      for (auto [a, b] : intervals) {
+        if (a <= points[i] && points[i] <= b) {
+          expected.push_back({i, {a, b}});
+        }
+      }
+    }
+    tree.find_containing(std::span<const int>(points),
+                         std::back_inserter(found));
+    std::sort(found.begin(), found.end());
+    CHECK(found == expected);
+  }
+}
@@ -3,9 +3,19 @@
 
 #include "utils_cpp/json.hpp"
 
+#include <nlohmann/json.hpp>
+
+#include <cstdio>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <sstream>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 TEST_CASE("key with space") {
   utils::Json dict;
@@ -77,26 +87,26 @@ TEST_CASE("dump object") {
   CHECK(
       dict.dump() ==
       "{\"key-bool\":false,\"key-"
-      "double\":3.7999999999999998,\"key-int\":1,"
+      "double\":3.8,\"key-int\":1,"
       "\"key-null\":null,"
       "\"key-string\":\"helloworld\",\"object-map\":{\"inner-key-1\":1,\"inner-"
       "key-2\":2},\"object-umap\":{\"inner-key-1\":\"inner-val-1\",\"inner-key-"
       "2\":\"inner-val-2\"},\"vector-bool\":[true,false],\"vector-"
       "double\":[1,"
-      "2.2999999999999998],\"vector-int\":[1,2,3],\"vector-object-map\":[{"
+      "2.3],\"vector-int\":[1,2,3],\"vector-object-map\":[{"
       "\"1\":1,\"2\":2},{"
       "\"3\":3,\"4\":4}],\"vector-string\":[\"hello\",\"world\"]}");
 
   CHECK(dict.pretty_dump(2) ==
         "{\n  \"key-bool\": false,\n  \"key-double\": "
-        "3.7999999999999998,\n  "
+        "3.8,\n  "
         "\"key-int\": "
         "1,\n  \"key-null\": null,\n  \"key-string\": \"helloworld\",\n  "
         "\"object-map\": {\n    \"inner-key-1\": 1,\n    \"inner-key-2\": 2\n  "
         "},\n  \"object-umap\": {\n    \"inner-key-1\": \"inner-val-1\",\n    "
         "\"inner-key-2\": \"inner-val-2\"\n  },\n  \"vector-bool\": [\n    "
         "true,\n    false\n  ],\n  \"vector-double\": [\n    1,\n    "
-        "2.2999999999999998\n  "
+        "2.3\n  "
         "],\n  \"vector-int\": [\n    1,\n    2,\n    3\n  ],\n  "
         "\"vector-object-map\": [\n    {\n      \"1\": 1,\n      \"2\": 2\n    "
         "},\n    {\n      \"3\": 3,\n      \"4\": 4\n    }\n  ],\n  "
@@ -388,3 +398,286 @@ TEST_CASE("array and obj iteration") {
 
   CHECK(encoded_data_structure == correct);
 }
+
+TEST_CASE("parse long strings with escapes") {
+  // Long enough that quotes and backslashes fall in every position of the
+  // 64-byte blocks scanned at a time.
+  std::string value;
+  for (int i = 0; i < 300; ++i) {
+    value += (i % 37 == 0) ? "\\\"" : (i % 23 == 0 ? "\\\\" : "x");
+  }
+  std::string json_string = "{\"long\": \"" + value + "\", \"after\": 1}";
+
+  auto json = utils::parse(json_string);
+  CHECK(json["long"].get<std::string>() == value);
+  CHECK(json["after"].get<double>() == 1);
+  CHECK(utils::parse(json.dump()).dump() == json.dump());
+
+  CHECK_THROWS(utils::parse("\"" + value));
+  CHECK_THROWS(utils::parse("\"abc\\"));
+}
+
+TEST_CASE("parse numbers") {
+  CHECK(utils::parse("-0.5").get<double>() == -0.5);
+  CHECK(utils::parse("1e3").get<double>() == 1000);
+  CHECK(utils::parse("2.5E-1").get<double>() == 0.25);
+  CHECK(utils::parse("[0, -0, 10]")[2].get<double>() == 10);
+  CHECK(utils::parse(" \t\r\n 7 \n").get<double>() == 7);
+
+  CHECK_THROWS(utils::parse("01"));
+  CHECK_THROWS(utils::parse("1."));
+  CHECK_THROWS(utils::parse("-"));
+  CHECK_THROWS(utils::parse(".5"));
+  CHECK_THROWS(utils::parse("1e"));
+  CHECK_THROWS(utils::parse("inf"));
+  CHECK_THROWS(utils::parse("1e999"));
+}
+
+TEST_CASE("parse malformed input") {
+  CHECK(utils::parse("").empty());
+  CHECK(utils::parse("  \n").is_object());
+
+  CHECK_THROWS(utils::parse("{\"a\" 1}"));
+  CHECK_THROWS(utils::parse("{\"a\": 1,}"));
+  CHECK_THROWS(utils::parse("{1: 2}"));
+  CHECK_THROWS(utils::parse("[1, 2}"));
+  CHECK_THROWS(utils::parse("[1 2]"));
+  CHECK_THROWS(utils::parse("[1, 2]]"));
+  CHECK_THROWS(utils::parse("{} {}"));
+  CHECK_THROWS(utils::parse("[tru]"));
+
+  auto json = utils::parse("{\"k\": 1, \"k\": 2}");
+  CHECK(json.size() == 1);
+  CHECK(json["k"].get<double>() == 2);
+}
+
+TEST_CASE("parse deeply nested arrays") {
+  std::size_t depth = 10000;
+  std::string json_string(depth, '[');
+  json_string += std::string(depth, ']');
+
+  auto json = utils::parse(json_string);
+  const utils::Json *inner = &json;
+  for (std::size_t i = 1; i < 10; ++i) {
+    REQUIRE(inner->is_array());
+    inner = &(*inner)[0];
+  }
+  CHECK(inner->is_array());
+}
+
+TEST_CASE("parse empty and missing files") {
+  std::string filename = "temporary_empty_test_file.json";
+  { std::ofstream f(filename); }
+  CHECK(utils::parse_file(filename).empty());
+  std::remove(filename.c_str());
+
+  CHECK_THROWS(utils::parse_file("no_such_file.json"));
+}
+
+#ifndef _WIN32
+TEST_CASE("parse files that cannot be mapped") {
+  // A FIFO has no size and cannot be mapped, so it goes through the stream.
+  std::string fifo = "temporary_test_fifo.json";
+  std::remove(fifo.c_str());
+  REQUIRE(::mkfifo(fifo.c_str(), 0600) == 0);
+  std::thread writer([&] {
+    std::ofstream f(fifo);
+    f << "{\"piped\": [1, 2, 3]}";
+  });
+  auto json = utils::parse_file(fifo);
+  writer.join();
+  std::remove(fifo.c_str());
+  CHECK(json["piped"].size() == 3);
+}
+#endif
+
+TEST_CASE("array appender keeps the file valid") {
+  std::string filename = "test_array_appender.json";
+  {
+    std::ofstream f(filename);
+    f << "  [ {\"id\": 0} ]\n\n";
+  }
+
+  {
+    utils::JsonArrayAppender appender(filename);
+    for (int i = 1; i < 5; ++i) {
+      utils::Json record;
+      record["id"] = i;
+      appender.append(record);
+      appender.flush();
+      CHECK(utils::parse_file(filename).size() == static_cast<std::size_t>(i + 1));
+    }
+  }
+
+  auto json = utils::parse_file(filename);
+  for (std::size_t i = 0; i < 5; ++i) {
+    CHECK(json[i]["id"].get<double>() == static_cast<double>(i));
+  }
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("array appender on empty arrays and invalid files") {
+  std::string filename = "test_array_appender_empty.json";
+  {
+    std::ofstream f(filename);
+    f << "[ ]";
+  }
+  utils::Json(1).append_to_file(filename);
+  utils::Json(2).unsafe_append_to_file(filename);
+  CHECK(utils::parse_file(filename).dump() == "[1,2]");
+
+  {
+    std::ofstream f(filename);
+    f << "{\"key\": [1]}";
+  }
+  CHECK_THROWS(utils::Json(3).append_to_file(filename));
+
+  {
+    std::ofstream f(filename);
+    f << "{\"key\": []}";
+  }
+  CHECK_THROWS(utils::JsonArrayAppender(filename));
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("json lines appender") {
+  std::string filename = "test_json_lines.jsonl";
+  std::remove(filename.c_str());
+
+  {
+    utils::JsonLinesAppender appender(filename);
+    for (int i = 0; i < 3; ++i) {
+      utils::Json record;
+      record["id"] = i;
+      appender.append(record);
+    }
+  }
+  utils::Json last;
+  last["id"] = 3;
+  last.append_line_to_file(filename);
+
+  std::ifstream f(filename);
+  std::string line;
+  double expected = 0;
+  while (std::getline(f, line)) {
+    CHECK(utils::parse(line)["id"].get<double>() == expected);
+    ++expected;
+  }
+  CHECK(expected == 4);
+  f.close();
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("dump numbers and strings") {
+  utils::Json json;
+  json["pi"] = 3.141592653589793;
+  json["tenth"] = 0.1;
+  json["big"] = 1e300;
+  json["nan"] = std::numeric_limits<double>::quiet_NaN();
+  json["quote"] = "say \"hi\"\n";
+  json["tab\tkey"] = "\x01";
+  json["trailing"] = "back\\";
+
+  std::string dumped = json.dump();
+  CHECK(dumped == "{\"big\":1e+300,\"nan\":null,\"pi\":3.141592653589793,"
+                  "\"quote\":\"say \\\"hi\\\"\\n\",\"tab\\tkey\":\"\\u0001\","
+                  "\"tenth\":0.1,\"trailing\":\"back\\\\\"}");
+
+  // Parsed strings keep their escapes, so dumping round-trips.
+  CHECK(utils::parse(dumped).dump() == dumped);
+  CHECK(utils::parse(dumped)["pi"].get<double>() == 3.141592653589793);
+}
+
+TEST_CASE("dump strings with invalid escapes") {
+  // A backslash that starts no valid escape is written as \\, so a strict
+  // parser reads back exactly the stored text.
+  for (std::string_view text :
+       {"C:\\gdir", "\\u12", "end \\u00g1", "\\x41", "\\", "a\\ q\\"}) {
+    std::string dumped = utils::Json(text).dump();
+    INFO(dumped);
+    auto strict = nlohmann::json::parse(dumped);
+    REQUIRE(strict.is_string());
+    CHECK(strict.get<std::string>() == text);
+    CHECK(utils::parse(dumped).dump() == dumped);
+  }
+
+  // A backslash before a control character: both are escaped.
+  std::string dumped = utils::Json(std::string_view("a\\\x01")).dump();
+  CHECK(dumped == "\"a\\\\\\u0001\"");
+  CHECK(nlohmann::json::parse(dumped).get<std::string>() == "a\\\x01");
+
+  // Valid escapes are kept.
+  CHECK(utils::Json(std::string_view("\\u00e9\\/\\n")).dump() ==
+        "\"\\u00e9\\/\\n\"");
+}
+
+TEST_CASE("dump to streams and buffers") {
+  utils::Json json;
+  for (int i = 0; i < 5000; ++i) {
+    json["records"].push_back(utils::Json(std::to_string(i)));
+  }
+  std::string expected = json.dump();
+  REQUIRE(expected.size() > (1 << 14)); // larger than the stream buffer
+
+  std::ostringstream os;
+  json.dump(os);
+  CHECK(os.str() == expected);
+
+  std::ostringstream pretty;
+  json.pretty_dump(pretty, 4);
+  CHECK(pretty.str() == json.pretty_dump(4));
+
+  std::string reused = "prefix:";
+  json.dump_to(reused);
+  CHECK(reused == "prefix:" + expected);
+
+  std::vector<char> small(10);
+  CHECK(json.dump_to(small.data(), small.size()) == expected.size());
+  CHECK(std::string(small.begin(), small.end()) == expected.substr(0, 10));
+
+  std::string filename = "test_write_to_file_stream.json";
+  json.write_to_file(filename);
+  CHECK(utils::parse_file(filename).dump() == expected);
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("views, get_to and moving get") {
+  auto json = utils::parse("{\"config\": {\"name\": \"long name\", "
+                           "\"weights\": [1, 2.5, 4], "
+                           "\"table\": {\"a\": [1], \"b\": [2, 3]}}}");
+  const auto &cjson = json;
+
+  // References into the tree, not copies.
+  const auto &config = cjson["config"].get_ref<utils::JsonObject>();
+  CHECK(&config == &cjson["config"].as_object_view());
+  auto weights = cjson["config"]["weights"].as_array_view();
+  CHECK(weights.size() == 3);
+  CHECK(weights.data() ==
+        cjson["config"]["weights"].get_ref<utils::JsonArray>().data());
+  CHECK(weights[1].get<double>() == 2.5);
+
+  json["config"]["name"].get_ref<std::string>() += "!";
+  std::get<utils::JsonArray>(json["config"]["weights"].value())
+      .push_back(utils::Json(8));
+  CHECK(json["config"]["weights"].size() == 4);
+
+  std::vector<int> ints = {7, 7, 7, 7, 7, 7};
+  json["config"]["weights"].get_to(ints);
+  CHECK(ints == std::vector<int>{1, 2, 4, 8});
+
+  std::map<std::string, std::vector<double>> table;
+  json["config"]["table"].get_to(table);
+  CHECK(table["b"] == std::vector<double>{2, 3});
+
+  // Subtrees and strings are moved out instead of copied.
+  auto name = std::move(json["config"]["name"]).get<std::string>();
+  CHECK(name == "long name!");
+  auto moved = std::move(json["config"]["table"]).get<utils::JsonObject>();
+  CHECK(moved.size() == 2);
+  auto numbers =
+      std::move(json["config"]["weights"]).get<std::vector<double>>();
+  CHECK(numbers == std::vector<double>{1, 2.5, 4, 8});
+}
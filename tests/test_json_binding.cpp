@@ -0,0 +1,130 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/json_binding.hpp"
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace test_binding {
+
+enum class Color { Red, Green };
+
+struct Point {
+  double x = 0;
+  double y = 0;
+};
+UTILS_JSON_FIELDS(Point, x, y)
+
+struct Shape {
+  std::string name;
+  int id = 0;
+  bool closed = false;
+  Color color = Color::Red;
+  std::vector<Point> points;
+  std::optional<std::string> label;
+  std::map<std::string, int> tags;
+};
+UTILS_JSON_FIELDS(Shape, name, id, closed, color, points, label, tags)
+
+} // namespace test_binding
+
+using test_binding::Color;
+using test_binding::Point;
+using test_binding::Shape;
+
+TEST_CASE("struct to json string") {
+  Shape s{"tri", 7, true, Color::Green, {{0, 0}, {1, 0.5}}, std::nullopt,
+          {{"a", 1}}};
+  CHECK(utils::to_json_string(s) ==
+        "{\"name\":\"tri\",\"id\":7,\"closed\":true,\"color\":1,"
+        "\"points\":[{\"x\":0,\"y\":0},{\"x\":1,\"y\":0.5}],"
+        "\"label\":null,\"tags\":{\"a\":1}}");
+
+  // The output is valid for the DOM parser as well.
+  auto json = utils::parse(utils::to_json_string(s));
+  CHECK(json["points"][1]["y"].get<double>() == 0.5);
+}
+
+TEST_CASE("struct from json string") {
+  auto s = utils::from_json_string<Shape>(
+      " { \"points\": [ {\"y\": 2, \"x\": 1} ], \"unknown\": {\"a\": [1, "
+      "\"}\"]}, \"id\": 1e2, \"label\": \"q\\\"\\u00e9\\n\", \"name\": \"s\" "
+      "} ");
+  CHECK(s.name == "s");
+  CHECK(s.id == 100);
+  CHECK(!s.closed); // missing fields keep their default
+  REQUIRE(s.points.size() == 1);
+  CHECK(s.points[0].x == 1);
+  CHECK(s.points[0].y == 2);
+  REQUIRE(s.label);
+  CHECK(*s.label == "q\"\xc3\xa9\n");
+
+  CHECK_THROWS_AS(utils::from_json_string<Shape>("{\"id\": \"x\"}"),
+                  std::runtime_error);
+  CHECK_THROWS_AS(utils::from_json_string<Shape>("{\"id\": 1.5}"),
+                  std::runtime_error);
+  CHECK_THROWS_AS(utils::from_json_string<Shape>("{\"id\": 1"),
+                  std::runtime_error);
+  CHECK_THROWS_AS(utils::from_json_string<Point>("{} x"), std::runtime_error);
+}
+
+TEST_CASE("numbers out of range for their fields") {
+  using utils::from_json_string;
+  CHECK(from_json_string<int>("-2147483648") == -2147483647 - 1);
+  CHECK(from_json_string<int>("-2.147483648e9") == -2147483647 - 1);
+  CHECK(from_json_string<std::uint8_t>("2.55e2") == 255);
+  CHECK(from_json_string<std::uint64_t>("1.8e19") == 18000000000000000000u);
+
+  CHECK_THROWS_AS(from_json_string<int>("2.147483648e9"), std::runtime_error);
+  CHECK_THROWS_AS(from_json_string<int>("-1e300"), std::runtime_error);
+  CHECK_THROWS_AS(from_json_string<int>("1e400"), std::runtime_error);
+  CHECK_THROWS_AS(from_json_string<std::uint8_t>("2.56e2"),
+                  std::runtime_error);
+  CHECK_THROWS_AS(from_json_string<unsigned>("-1e0"), std::runtime_error);
+  CHECK_THROWS_AS(from_json_string<std::uint64_t>("1.8446744073709552e19"),
+                  std::runtime_error);
+  CHECK_THROWS_AS(from_json_string<int>("1.5e0"), std::runtime_error);
+  CHECK_THROWS_AS(from_json_string<float>("1e300"), std::runtime_error);
+  CHECK(from_json_string<float>("1e-300") == 0.0f);
+}
+
+TEST_CASE("binding round trip") {
+  std::vector<Shape> shapes;
+  for (int i = 0; i < 100; ++i) {
+    Shape s;
+    s.name = "shape \\ \"";
+    s.name += std::to_string(i);
+    s.name += "\"\t";
+    s.id = -i;
+    s.closed = i % 2 == 0;
+    s.color = i % 3 == 0 ? Color::Red : Color::Green;
+    s.points = {{i * 0.1, -i / 3.0}};
+    if (i % 5 == 0) {
+      s.label = "label";
+    }
+    s.tags[std::to_string(i)] = i;
+    shapes.push_back(s);
+  }
+
+  std::ostringstream os;
+  utils::write_json(os, shapes);
+  CHECK(os.str() == utils::to_json_string(shapes));
+
+  auto back = utils::from_json_string<std::vector<Shape>>(os.str());
+  REQUIRE(back.size() == shapes.size());
+  for (std::size_t i = 0; i < shapes.size(); ++i) {
+    CHECK(back[i].name == shapes[i].name);
+    CHECK(back[i].id == shapes[i].id);
+    CHECK(back[i].closed == shapes[i].closed);
+    CHECK(back[i].color == shapes[i].color);
+    CHECK(back[i].points[0].x == shapes[i].points[0].x);
+    CHECK(back[i].points[0].y == shapes[i].points[0].y);
+    CHECK(back[i].label == shapes[i].label);
+    CHECK(back[i].tags == shapes[i].tags);
+  }
+}
@@ -0,0 +1,146 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/json_cbor.hpp"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string hex(const std::string &bytes) {
+  std::string out;
+  constexpr char digits[] = "0123456789abcdef";
+  for (unsigned char c : bytes) {
+    out.push_back(digits[c >> 4]);
+    out.push_back(digits[c & 0xf]);
+  }
+  return out;
+}
+
+std::string unhex(std::string_view s) {
+  std::string digits, out;
+  for (char c : s) {
+    if (c != ' ') {
+      digits.push_back(c);
+    }
+  }
+  for (std::size_t i = 0; i + 1 < digits.size(); i += 2) {
+    out.push_back(
+        static_cast<char>(std::stoi(digits.substr(i, 2), nullptr, 16)));
+  }
+  return out;
+}
+
+} // namespace
+
+TEST_CASE("cbor scalars") {
+  // Examples from RFC 8949, appendix A.
+  CHECK(hex(utils::dump_cbor(utils::Json(0))) == "00");
+  CHECK(hex(utils::dump_cbor(utils::Json(23))) == "17");
+  CHECK(hex(utils::dump_cbor(utils::Json(1000000))) == "1a000f4240");
+  CHECK(hex(utils::dump_cbor(utils::Json(-1000))) == "3903e7");
+  CHECK(hex(utils::dump_cbor(utils::Json(1.1))) == "fb3ff199999999999a");
+  CHECK(hex(utils::dump_cbor(utils::Json(true))) == "f5");
+  CHECK(hex(utils::dump_cbor(utils::Json(std::string_view("a")))) == "6161");
+
+  utils::Json null;
+  null = nullptr;
+  CHECK(hex(utils::dump_cbor(null)) == "f6");
+
+  CHECK(utils::CborDocument::parse(unhex("f93c00")).root().as_number() == 1.0);
+  CHECK(utils::CborDocument::parse(unhex("f9c400")).root().as_number() == -4.0);
+  CHECK(utils::CborDocument::parse(unhex("fa47c35000")).root().as_number() ==
+        100000.0);
+  CHECK(utils::CborDocument::parse(unhex("3bffffffffffffffff"))
+            .root()
+            .as_number() == -18446744073709551616.0);
+}
+
+TEST_CASE("cbor round trip") {
+  auto json = utils::parse(
+      "{\"name\": \"g\\\"1\", \"n\": 12, \"weights\": [0.5, -2, 1e100], "
+      "\"nested\": [1, \"x\", [true, false, null], {}], \"empty\": []}");
+
+  std::string bytes = utils::dump_cbor(json);
+  CHECK(utils::parse_cbor(bytes).dump() == json.dump());
+
+  std::ostringstream os;
+  utils::write_cbor(os, json);
+  CHECK(os.str() == bytes);
+
+  auto doc = utils::CborDocument::parse(bytes);
+  auto root = doc.root();
+  REQUIRE(root.is_object());
+  CHECK(root.size() == 5);
+  CHECK(root["name"].as_string() == "g\\\"1");
+  CHECK(root["n"].as_number() == 12);
+  CHECK(root["nested"][2][1].is_bool());
+  CHECK(root["nested"][2][2].is_null());
+  CHECK(!root.contains("missing"));
+  CHECK_THROWS_AS(root["missing"], std::out_of_range);
+
+  auto weights = root["weights"];
+  REQUIRE(weights.is_packed_doubles());
+  CHECK(weights.size() == 3);
+  CHECK(weights[2].as_number() == 1e100);
+  CHECK(weights.get_doubles() == std::vector<double>{0.5, -2, 1e100});
+  CHECK(!root["nested"].is_packed_doubles());
+  CHECK(root["empty"].size() == 0);
+
+  CHECK_THROWS_AS(utils::parse_cbor(bytes.substr(0, bytes.size() - 1)),
+                  std::runtime_error);
+  CHECK_THROWS_AS(utils::parse_cbor(bytes + '\0'), std::runtime_error);
+}
+
+TEST_CASE("cbor foreign encodings") {
+  // Indefinite-length array and map, a tagged value and a float array
+  // written as individual items.
+  std::string bytes = unhex("bf 6161 9f0102ff 6162 c11a514b67b0 "
+                            "6163 82f93c00fb4000000000000000 ff");
+  auto doc = utils::CborDocument::parse(bytes);
+  auto root = doc.root();
+  CHECK(root.size() == 3);
+  CHECK(root["a"].size() == 2);
+  CHECK(root["a"][1].as_number() == 2);
+  CHECK(root["b"].as_number() == 1363896240);
+  CHECK(root["c"].get_doubles() == std::vector<double>{1.0, 2.0});
+  CHECK(root.to_json().dump() ==
+        "{\"a\":[1,2],\"b\":1363896240,\"c\":[1,2]}");
+}
+
+TEST_CASE("zero-copy packed doubles") {
+  std::vector<double> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back(i * 0.25 - 3);
+  }
+
+  // Vary the prefix so the packed payload lands at every offset mod 8.
+  for (std::size_t k = 0; k < 8; ++k) {
+    utils::Json json;
+    json[std::string(k, 'k')] = values;
+    std::string bytes = utils::dump_cbor(json);
+
+    auto root = utils::CborDocument::parse(bytes).root();
+    auto view = root[std::string(k, 'k')].as_doubles();
+    CHECK(std::vector<double>(view.begin(), view.end()) == values);
+    CHECK(reinterpret_cast<const char *>(view.data()) >= bytes.data());
+    CHECK(reinterpret_cast<const char *>(view.data()) <
+          bytes.data() + bytes.size());
+  }
+
+  std::string filename = "test_json_cbor.cbor";
+  utils::Json json;
+  json["props"] = values;
+  utils::write_cbor_file(json, filename);
+  {
+    auto doc = utils::CborDocument::parse_file(filename);
+    auto view = doc.root()["props"].as_doubles();
+    CHECK(view.size() == values.size());
+    CHECK(view[999] == values[999]);
+    CHECK(utils::parse_cbor_file(filename).dump() == json.dump());
+  }
+  std::remove(filename.c_str());
+}
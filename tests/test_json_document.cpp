@@ -0,0 +1,79 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/json_document.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+TEST_CASE("flat document lookups") {
+  std::string source = "{\"zeta\": [1, 2, {\"deep\": \"x\\\"y\"}], "
+                       "\"alpha\": true, \"mid\": null, \"num\": -1.5e2}";
+  auto doc = utils::JsonDocument::parse(source);
+  auto root = doc.root();
+
+  REQUIRE(root.is_object());
+  CHECK(root.size() == 4);
+
+  // Members are sorted by key.
+  CHECK(root.key(0) == "alpha");
+  CHECK(root.key(3) == "zeta");
+
+  CHECK(root["alpha"].as_bool());
+  CHECK(root["mid"].is_null());
+  CHECK(root["num"].as_number() == -150);
+  CHECK(root["zeta"].size() == 3);
+  CHECK(root["zeta"][1].as_number() == 2);
+  CHECK(root["zeta"][2]["deep"].as_string() == "x\\\"y");
+
+  // Strings view the source buffer.
+  auto deep = root["zeta"][2]["deep"].as_string();
+  CHECK(deep.data() >= source.data());
+  CHECK(deep.data() < source.data() + source.size());
+
+  CHECK(root.contains("mid"));
+  CHECK_FALSE(root.contains("missing"));
+  CHECK_THROWS_AS(root["missing"], std::out_of_range);
+  CHECK_THROWS_AS(root["zeta"][3], std::out_of_range);
+  CHECK_THROWS(root["alpha"].as_number());
+}
+
+TEST_CASE("flat document round trips to Json") {
+  std::string source = "[{\"b\": [], \"a\": {}}, 0.25, \"s\", false, null, "
+                       "[[1], [2, [3]]], {\"k\": 1, \"k\": 2}]";
+  auto doc = utils::JsonDocument::parse(source);
+  CHECK(doc.to_json().dump() == utils::parse(source).dump());
+
+  // The repeated key keeps its last value.
+  CHECK(doc.root()[6].size() == 1);
+  CHECK(doc.root()[6]["k"].as_number() == 2);
+
+  CHECK(utils::JsonDocument::parse("  ").to_json().dump() == "{}");
+  CHECK(utils::JsonDocument::parse("42").root().as_number() == 42);
+}
+
+TEST_CASE("flat document from a file") {
+  std::string filename = "temporary_document_test_file.json";
+  {
+    std::ofstream f(filename);
+    f << "{\"records\": [{\"id\": 1}, {\"id\": 2}]}";
+  }
+
+  auto doc = utils::JsonDocument::parse_file(filename);
+  auto moved = std::move(doc);
+  CHECK(moved.root()["records"][1]["id"].as_number() == 2);
+  CHECK(moved.num_nodes() == 6);
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("flat document rejects malformed input") {
+  CHECK_THROWS(utils::JsonDocument::parse("[1, 2"));
+  CHECK_THROWS(utils::JsonDocument::parse("[1, 2}"));
+  CHECK_THROWS(utils::JsonDocument::parse("{\"a\": 1,}"));
+  CHECK_THROWS(utils::JsonDocument::parse("{\"a\" 1}"));
+  CHECK_THROWS(utils::JsonDocument::parse("[1] 2"));
+  CHECK_THROWS(utils::JsonDocument::parse("[01]"));
+  CHECK_THROWS(utils::JsonDocument::parse("\"abc"));
+}
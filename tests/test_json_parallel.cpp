@@ -0,0 +1,84 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/json_parallel.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+TEST_CASE("split json records") {
+  auto records = utils::split_json_array(
+      " [1, \"a,]\\\"\", {\"x\": [2, 3]}, [[]] ]\n");
+  REQUIRE(records.size() == 4);
+  CHECK(records[0] == "1");
+  CHECK(records[1] == " \"a,]\\\"\"");
+  CHECK(records[2] == " {\"x\": [2, 3]}");
+  CHECK(records[3] == " [[]] ");
+
+  CHECK(utils::split_json_array("[ ]").empty());
+  CHECK_THROWS_AS(utils::split_json_array("{}"), std::runtime_error);
+  CHECK_THROWS_AS(utils::split_json_array("[1,,2]"), std::runtime_error);
+  CHECK_THROWS_AS(utils::split_json_array("[1,2,]"), std::runtime_error);
+  CHECK_THROWS_AS(utils::split_json_array("[1,[2]"), std::runtime_error);
+  CHECK_THROWS_AS(utils::split_json_array("[1] 2"), std::runtime_error);
+
+  auto lines = utils::split_json_lines("{\"a\": 1}\n\n  \r\n[2]\r\n3");
+  REQUIRE(lines.size() == 3);
+  CHECK(lines[0] == "{\"a\": 1}");
+  CHECK(lines[2] == "3");
+}
+
+TEST_CASE("parallel parse of records") {
+  std::string text = "[";
+  std::string lines;
+  for (int i = 0; i < 500; ++i) {
+    std::string record = "{\"id\": ";
+    record += std::to_string(i);
+    record += ", \"name\": \"r\\\"";
+    record += std::to_string(i);
+    record += "\", \"data\": [";
+    record += std::to_string(i * 0.5);
+    record += "]}";
+    text += i ? ", " : "";
+    text += record;
+    lines += record;
+    lines += "\n";
+  }
+  text += "]";
+
+  auto expected = utils::parse(text).dump();
+
+  utils::parallel::thread_pool pool(3);
+  CHECK(utils::parse_json_array(text).dump() == expected);
+  CHECK(utils::parse_json_array(text, &pool).dump() == expected);
+  CHECK(utils::parse_json_lines(lines, &pool).dump() == expected);
+
+  std::vector<int> seen(500, 0);
+  std::atomic<std::size_t> count = 0;
+  utils::for_each_array_record(
+      text,
+      [&](std::size_t i, utils::Json &&record) {
+        seen[i] = static_cast<int>(record["id"].get<double>());
+        ++count;
+      },
+      &pool);
+  CHECK(count == 500);
+  for (int i = 0; i < 500; ++i) {
+    CHECK(seen[i] == i);
+  }
+
+  // Errors inside a record propagate to the caller.
+  CHECK_THROWS_AS(utils::parse_json_array("[1, {\"a\" 2}, 3]", &pool),
+                  std::runtime_error);
+
+  std::string filename = "test_json_parallel.jsonl";
+  utils::Json record;
+  record["x"] = 1;
+  std::remove(filename.c_str());
+  record.append_line_to_file(filename);
+  record.append_line_to_file(filename);
+  CHECK(utils::parse_json_lines_file(filename, &pool).size() == 2);
+  std::remove(filename.c_str());
+}
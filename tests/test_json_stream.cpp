@@ -0,0 +1,151 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/json_stream.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Records each event as a short string.
+struct RecordingHandler : utils::JsonHandler {
+  std::vector<std::string> events;
+
+  bool on_start_object() override { return add("{"); }
+  bool on_end_object() override { return add("}"); }
+  bool on_start_array() override { return add("["); }
+  bool on_end_array() override { return add("]"); }
+  bool on_key(std::string_view k) override { return add("k:" + std::string(k)); }
+  bool on_string(std::string_view s) override {
+    return add("s:" + std::string(s));
+  }
+  bool on_number(double x) override { return add("n:" + std::to_string(x)); }
+  bool on_bool(bool b) override { return add(b ? "true" : "false"); }
+  bool on_null() override { return add("null"); }
+
+  bool add(std::string e) {
+    events.push_back(std::move(e));
+    return true;
+  }
+};
+
+} // namespace
+
+TEST_CASE("sax events") {
+  std::istringstream is(
+      "{\"a\": [1, -2.5e1, \"x\\\"y\"], \"b\": {\"c\": null}, \"d\": true}");
+  RecordingHandler handler;
+  CHECK(utils::sax_parse(is, handler));
+
+  std::vector<std::string> expected = {
+      "{",        "k:a", "[",          "n:1.000000", "n:-25.000000",
+      "s:x\\\"y", "]",   "k:b",        "{",          "k:c",
+      "null",     "}",   "k:d",        "true",       "}"};
+  CHECK(handler.events == expected);
+}
+
+TEST_CASE("pull parser with small chunks matches parse") {
+  std::string document = "{\"records\": [";
+  for (int i = 0; i < 200; ++i) {
+    document += (i ? ", " : "") + std::string("{\"id\": ") +
+                std::to_string(i) + ", \"name\": \"record number " +
+                std::to_string(i) + " with \\\\ escapes\", \"ok\": " +
+                (i % 2 ? "true" : "false") + ", \"v\": [0.5, null, []]}";
+  }
+  document += "], \"long\": \"" + std::string(500, 'z') + "\"}";
+
+  // The smallest chunk, so that tokens are split across reads.
+  std::istringstream is(document);
+  utils::JsonPullParser parser(is, 1);
+  auto json = parser.read_json();
+
+  CHECK(json.dump() == utils::parse(document).dump());
+  CHECK(parser.next().type == utils::JsonEvent::Type::End);
+}
+
+TEST_CASE("pull parser over json lines") {
+  std::istringstream is("{\"id\": 1, \"blob\": {\"x\": [1, 2, 3]}}\n"
+                        "{\"id\": 2, \"blob\": \"skip me\"}\n"
+                        "{\"id\": 3, \"blob\": [[[]]]}\n");
+  utils::JsonPullParser parser(is, 16);
+
+  std::vector<double> ids;
+  for (;;) {
+    auto event = parser.next();
+    if (event.type == utils::JsonEvent::Type::End) {
+      break;
+    }
+    REQUIRE(event.type == utils::JsonEvent::Type::StartObject);
+    CHECK(event.depth == 0);
+
+    for (event = parser.next(); event.type == utils::JsonEvent::Type::Key;
+         event = parser.next()) {
+      if (event.text == "id") {
+        auto value = parser.next();
+        CHECK(value.depth == 1);
+        ids.push_back(value.number);
+      } else {
+        parser.skip();
+      }
+    }
+    CHECK(event.type == utils::JsonEvent::Type::EndObject);
+  }
+  CHECK(ids == std::vector<double>{1, 2, 3});
+}
+
+TEST_CASE("skip the rest of a container") {
+  std::istringstream is("[[1, {\"a\": [2]}, 3], 4]");
+  utils::JsonPullParser parser(is);
+  CHECK(parser.next().type == utils::JsonEvent::Type::StartArray);
+  CHECK(parser.next().type == utils::JsonEvent::Type::StartArray);
+  parser.skip();
+  auto event = parser.next();
+  CHECK(event.type == utils::JsonEvent::Type::Number);
+  CHECK(event.number == 4);
+  CHECK(parser.next().type == utils::JsonEvent::Type::EndArray);
+}
+
+TEST_CASE("stop early and read from a file") {
+  std::string filename = "temporary_sax_test_file.json";
+  {
+    std::ofstream f(filename);
+    f << "[1, 2, 3, 4]";
+  }
+
+  struct FirstTwo : utils::JsonHandler {
+    std::vector<double> numbers;
+    bool on_number(double x) override {
+      numbers.push_back(x);
+      return numbers.size() < 2;
+    }
+  } handler;
+
+  CHECK_FALSE(utils::sax_parse_file(filename, handler));
+  CHECK(handler.numbers == std::vector<double>{1, 2});
+
+  std::remove(filename.c_str());
+  CHECK_THROWS(utils::sax_parse_file(filename, handler));
+}
+
+TEST_CASE("malformed streams throw") {
+  auto parse_all = [](const std::string &s) {
+    std::istringstream is(s);
+    RecordingHandler handler;
+    return utils::sax_parse(is, handler);
+  };
+
+  CHECK(parse_all(""));
+  CHECK(parse_all("1 2 \"three\""));
+  CHECK_THROWS(parse_all("[1, 2"));
+  CHECK_THROWS(parse_all("[1, ]"));
+  CHECK_THROWS(parse_all("{\"a\" 1}"));
+  CHECK_THROWS(parse_all("{\"a\": 1,}"));
+  CHECK_THROWS(parse_all("[1}"));
+  CHECK_THROWS(parse_all("\"abc"));
+  CHECK_THROWS(parse_all("nul"));
+  CHECK_THROWS(parse_all("01"));
+}
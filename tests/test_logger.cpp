@@ -2,7 +2,11 @@
 #include "doctest/doctest.h"
 #include "utils_cpp/logger.hpp"
 
+#include <cstdio>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 ENABLE_LOG_GROUPS(A1)
 CREATE_LOG_GROUPS(A1, A2)
@@ -46,3 +50,268 @@ TEST_CASE("Test different log variants") {
     CHECK(ss.str() == "Hello from Group B3");
   }
 }
+
+ENABLE_LOG_GROUPS(C1)
+CREATE_LOG_GROUPS(C1, C2)
+
+struct point {
+  int x, y;
+};
+
+std::ostream &operator<<(std::ostream &os, const point &p) {
+  return os << '(' << p.x << ", " << p.y << ')';
+}
+
+TEST_CASE("async logging") {
+
+  std::stringstream ss;
+  Logger::set_log_stream(ss);
+
+  SUBCASE("all messages from all threads arrive whole") {
+    AsyncLogger::start();
+    CHECK(AsyncLogger::running());
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([t] {
+        for (int i = 0; i < 1000; ++i) {
+          LOG(C1) << "thread " << t << " message " << i;
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    LOG(C2) << "disabled";
+    AsyncLogger::stop();
+    CHECK(!AsyncLogger::running());
+
+    std::vector<int> next(4, 0);
+    std::string line;
+    int lines = 0;
+    bool in_order = true;
+    while (std::getline(ss, line)) {
+      int t, i;
+      CHECK(std::sscanf(line.c_str(), "[C1]: thread %d message %d", &t, &i) ==
+            2);
+      in_order = in_order && next[t] == i;
+      next[t] = i + 1;
+      ++lines;
+    }
+    CHECK(lines == 4000);
+    CHECK(in_order);
+  }
+
+  SUBCASE("flush racing with stop") {
+    for (int round = 0; round < 200; ++round) {
+      AsyncLogger::start();
+      std::thread flusher([] {
+        for (int i = 0; i < 20; ++i) {
+          LOG_NP(C1) << "x";
+          AsyncLogger::flush();
+        }
+      });
+      AsyncLogger::stop();
+      flusher.join();
+    }
+    AsyncLogger::flush();
+    CHECK(ss.str().size() == 200 * 20 * 2);
+  }
+
+  SUBCASE("flush") {
+    AsyncLogger::start();
+    LOG_NP(C1) << "before flush";
+    AsyncLogger::flush();
+    CHECK(ss.str() == "before flush\n");
+    AsyncLogger::stop();
+
+    // Synchronous again.
+    LOG_NP(C1) << "after stop";
+    CHECK(ss.str() == "before flush\nafter stop\n");
+  }
+
+  SUBCASE("deferred formatting") {
+    AsyncLogOptions options;
+    options.deferred_formatting = true;
+    AsyncLogger::start(options);
+
+    int x = 255;
+    std::string s = "str";
+    LOG(C1) << 1 << ' ' << 2.5 << " " << s << ' ' << std::hex << x << ' '
+            << point{1, 2};
+    x = 0;
+    s = "changed";
+    LOG(C1) << x;
+    AsyncLogger::stop();
+
+    // The second message does not inherit std::hex from the first one.
+    CHECK(ss.str() == "[C1]: 1 2.5 str ff (1, 2)\n[C1]: 0\n");
+  }
+
+  SUBCASE("long messages") {
+    AsyncLogOptions options;
+    options.deferred_formatting = true;
+    AsyncLogger::start(options);
+
+    // More than fits in a record's buffer, so the tail spills into a string.
+    std::string expected = "[C1]: ";
+    {
+      LogStream<_logger_impl_C1> log;
+      for (int i = 0; i < 100; ++i) {
+        log << i << ',';
+        expected += std::to_string(i) + ',';
+      }
+    }
+    AsyncLogger::stop();
+
+    CHECK(ss.str() == expected + '\n');
+  }
+
+  SUBCASE("overflow policies") {
+    for (auto policy : {LogOverflow::drop, LogOverflow::count}) {
+      ss.str("");
+      ss.clear();
+      std::size_t dropped_before = AsyncLogger::dropped();
+
+      AsyncLogOptions options;
+      options.queue_capacity = 2;
+      options.overflow = policy;
+      options.flush_interval = std::chrono::hours(1);
+      AsyncLogger::start(options);
+      for (int i = 0; i < 100; ++i) {
+        LOG_NP(C1) << i;
+      }
+      AsyncLogger::stop();
+
+      std::size_t dropped = AsyncLogger::dropped() - dropped_before;
+      std::size_t lines = 0, notices = 0;
+      std::string line;
+      while (std::getline(ss, line)) {
+        if (line.find("messages dropped") != std::string::npos) {
+          ++notices;
+        } else {
+          ++lines;
+        }
+      }
+      CHECK(lines + dropped == 100);
+      if (policy == LogOverflow::drop) {
+        CHECK(notices == 0);
+      } else {
+        CHECK((notices > 0) == (dropped > 0));
+      }
+    }
+  }
+
+  SUBCASE("invalid capacity") {
+    AsyncLogOptions options;
+    options.queue_capacity = 3;
+    CHECK_THROWS_AS(AsyncLogger::start(options), std::invalid_argument);
+    CHECK(!AsyncLogger::running());
+  }
+
+  Logger::set_log_stream(std::clog);
+}
+
+ENABLE_LOG_GROUPS(D1, D2)
+CREATE_LOG_GROUPS(D1, D2)
+
+TEST_CASE("runtime levels") {
+
+  std::stringstream ss;
+  Logger::set_log_stream(ss);
+
+  int formatted = 0;
+  auto count = [&] { return ++formatted; };
+
+  SUBCASE("default level is info") {
+    LOG_AT(D1, debug) << count();
+    LOG_AT(D1, warn) << "warn";
+    LOG(D1) << "info";
+    CHECK(ss.str() == "[D1]: warn\n[D1]: info\n");
+    CHECK(formatted == 0);
+  }
+
+  SUBCASE("per group") {
+    SET_LOG_LEVEL(D1, off);
+    LOG_AT(D1, error) << count();
+    LOG(D2) << count();
+    CHECK(ss.str() == "[D2]: 1\n");
+    CHECK(formatted == 1);
+  }
+
+  SUBCASE("by name") {
+    CHECK(Logger::set_level("D2", LogLevel::trace));
+    CHECK(!Logger::set_level("no such group", LogLevel::trace));
+    LOG_AT(D2, trace) << "trace";
+    CHECK(ss.str() == "[D2]: trace\n");
+  }
+
+  SUBCASE("configure") {
+    Logger::configure("off,D2=debug");
+    LOG(D1) << "D1";
+    LOG_AT(D2, debug) << "D2";
+    CHECK(ss.str() == "[D2]: D2\n");
+
+    CHECK_THROWS_AS(Logger::configure("D1=loud"), std::invalid_argument);
+    CHECK_THROWS_AS(Logger::configure("D3=info"), std::invalid_argument);
+  }
+
+  Logger::set_level(LogLevel::info);
+  Logger::set_log_stream(std::clog);
+}
+
+TEST_CASE("timestamps") {
+
+  std::stringstream ss;
+  Logger::set_log_stream(ss);
+  Logger::show_time = true;
+
+  auto is_timestamp = [](const std::string &s, int decimals) {
+    // "2023-01-31 12:34:56" then '.' and the fraction.
+    const std::string digits = "0123456789";
+    std::string pattern = "dddd-dd-dd dd:dd:dd";
+    if (decimals > 0) {
+      pattern += '.' + std::string(decimals, 'd');
+    }
+    if (s.size() != pattern.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < s.size(); ++i) {
+      bool digit = digits.find(s[i]) != std::string::npos;
+      if ((pattern[i] == 'd') != digit || (!digit && pattern[i] != s[i])) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  SUBCASE("seconds") {
+    LOG(D1) << "x";
+    auto line = ss.str();
+    auto pos = line.find(" -- [D1]: x\n");
+    REQUIRE(pos != std::string::npos);
+    CHECK(is_timestamp(line.substr(0, pos), 0));
+  }
+
+  SUBCASE("milliseconds") {
+    Logger::time_decimals = 3;
+    LOG(D1) << "x";
+    Logger::time_decimals = 0;
+    auto line = ss.str();
+    auto pos = line.find(" -- [D1]: x\n");
+    REQUIRE(pos != std::string::npos);
+    CHECK(is_timestamp(line.substr(0, pos), 3));
+  }
+
+  SUBCASE("matches the wall clock") {
+    auto before = get_current_time();
+    LOG(D1) << "x";
+    auto after = get_current_time();
+    auto stamp = ss.str().substr(0, before.size());
+    CHECK(before <= stamp);
+    CHECK(stamp <= after);
+  }
+
+  Logger::show_time = false;
+  Logger::set_log_stream(std::clog);
+}
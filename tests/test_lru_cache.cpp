@@ -0,0 +1,68 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/lru_cache.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace utils;
+
+TEST_CASE("lru cache") {
+  LruCache<int, std::string> cache(2);
+  CHECK(cache.empty());
+  CHECK_THROWS_AS((LruCache<int, int>{0}), std::invalid_argument);
+
+  cache.insert(1, "one");
+  cache.insert(2, "two");
+  REQUIRE(cache.find(1) != nullptr);
+  CHECK(*cache.find(1) == "one");
+
+  // 2 is now the least recently used, so it is evicted.
+  cache.insert(3, "three");
+  CHECK(cache.size() == 2);
+  CHECK(!cache.contains(2));
+  CHECK(cache.find(2) == nullptr);
+  CHECK(cache.contains(1));
+
+  std::vector<int> order;
+  for (const auto &[k, v] : cache) {
+    order.push_back(k);
+  }
+  CHECK(order == std::vector<int>{3, 1});
+
+  SUBCASE("replacing a value marks it used") {
+    cache.insert(1, "uno");
+    cache.insert(4, "four");
+    CHECK(*cache.find(1) == "uno");
+    CHECK(!cache.contains(3));
+  }
+
+  SUBCASE("get or compute") {
+    int calls = 0;
+    auto compute = [&] {
+      ++calls;
+      return std::string("five");
+    };
+    CHECK(cache.get_or_compute(5, compute) == "five");
+    CHECK(cache.get_or_compute(5, compute) == "five");
+    CHECK(calls == 1);
+  }
+
+  SUBCASE("hit and miss counts") {
+    std::size_t hits = cache.hits(), misses = cache.misses();
+    cache.find(1);
+    cache.find(7);
+    CHECK(cache.hits() == hits + 1);
+    CHECK(cache.misses() == misses + 1);
+  }
+
+  SUBCASE("erase and clear") {
+    CHECK(cache.erase(1));
+    CHECK(!cache.erase(1));
+    CHECK(cache.size() == 1);
+    cache.clear();
+    CHECK(cache.empty());
+  }
+}
@@ -0,0 +1,44 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/mapped_file.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+TEST_CASE("map a file") {
+  std::string filename = "temporary_mapped_file.txt";
+  std::string contents(10000, 'x');
+  contents += "end";
+  {
+    std::ofstream f(filename, std::ios_base::binary);
+    f << contents;
+  }
+
+  utils::MappedFile file(filename);
+  CHECK(file.size() == contents.size());
+  CHECK(file.view() == contents);
+
+  utils::MappedFile moved(std::move(file));
+  CHECK(file.empty());
+  CHECK(moved.view().substr(moved.size() - 3) == "end");
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("map an empty file") {
+  std::string filename = "temporary_empty_mapped_file.txt";
+  { std::ofstream f(filename); }
+
+  utils::MappedFile file(filename);
+  CHECK(file.empty());
+  CHECK(file.view().empty());
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("map a missing file") {
+  CHECK_THROWS_AS(utils::MappedFile("no_such_file_for_mapping.txt"),
+                  std::runtime_error);
+}
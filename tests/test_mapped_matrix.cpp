@@ -0,0 +1,67 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/mapped_matrix.hpp"
+
+#include <cstdio>
+#include <string>
+
+using namespace utils;
+
+TEST_CASE("create, fill and reopen a mapped matrix") {
+  std::string filename = "temporary_mapped_matrix.npy";
+  {
+    auto m = MappedMatrix<int>::create(filename, 300, 257);
+    CHECK(m.shape() == std::make_pair(std::size_t{300}, std::size_t{257}));
+    CHECK(m(299, 256) == 0);
+    CHECK(reinterpret_cast<std::uintptr_t>(m.data()) % 64 == 0);
+
+    std::size_t tiles = 0;
+    m.for_each_tile(
+        64, 100,
+        [&](MatrixView<int> tile) {
+          ++tiles;
+          for (std::size_t i = 0; i < tile.num_rows(); ++i) {
+            for (std::size_t j = 0; j < tile.num_columns(); ++j) {
+              tile(i, j) = static_cast<int>(tiles);
+            }
+          }
+        },
+        true);
+    CHECK(tiles == 5 * 3);
+    m.flush();
+  }
+
+  // Tiles are visited band by band, left to right.
+  auto m = MappedMatrix<int>::open(filename, false);
+  CHECK_FALSE(m.writable());
+  CHECK(m(0, 0) == 1);
+  CHECK(m(0, 256) == 3);
+  CHECK(m(64, 0) == 4);
+  CHECK(m(299, 256) == 15);
+
+  // The file is a plain .npy.
+  auto loaded = load_npy<int>(filename);
+  CHECK(loaded == m.view().to_matrix());
+
+  CHECK_THROWS_AS(MappedMatrix<float>::open(filename), std::runtime_error);
+  CHECK_THROWS_AS(MappedMatrix<int>::open("no_such_file.npy"),
+                  std::runtime_error);
+
+  MappedMatrix<int> moved(std::move(m));
+  CHECK(moved.block(64, 100, 1, 1)(0, 0) == 5);
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("kernels on mapped matrices") {
+  std::string filename = "temporary_mapped_product.npy";
+  Matrix<double> a(40, 30, 0.5), b(30, 20, 2.0);
+
+  auto c = MappedMatrix<double>::create(filename, 40, 20);
+  matmul_into(c.view(), a, b, semiring::plus_times<double>{});
+  CHECK(c.view().to_matrix() == matmul(a, b));
+  CHECK(c(39, 19) == 30.0);
+
+  std::remove(filename.c_str());
+}
@@ -1,7 +1,12 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
+#include <cmath>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <random>
 #include <sstream>
 #include <string>
 
@@ -83,3 +88,276 @@ TEST_CASE("Test Matrix Iteration") {
 
   CHECK(total == 4);
 }
+
+TEST_CASE("Test Matrix with aligned allocator") {
+  Matrix<std::uint64_t, aligned_allocator<std::uint64_t, 64>> m(3, 8, 1);
+  CHECK(reinterpret_cast<std::uintptr_t>(&m(0, 0)) % 64 == 0);
+  CHECK(reinterpret_cast<std::uintptr_t>(&m(1, 0)) % 64 == 0);
+  CHECK(m(2, 7) == 1);
+
+  m.resize(5, 8, 2);
+  CHECK(reinterpret_cast<std::uintptr_t>(&m(0, 0)) % 64 == 0);
+  CHECK(m(4, 0) == 2);
+
+  auto copy = m;
+  CHECK(copy == m);
+}
+
+namespace {
+
+template <typename T, typename S>
+Matrix<T> naive_matmul(const Matrix<T> &a, const Matrix<T> &b, S) {
+  auto [n, k] = a.shape();
+  std::size_t m = b.shape().second;
+  Matrix<T> c(n, m, S::zero());
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < m; ++j) {
+      for (std::size_t p = 0; p < k; ++p) {
+        c(i, j) = S::add(c(i, j), S::mul(a(i, p), b(p, j)));
+      }
+    }
+  }
+  return c;
+}
+
+template <typename T>
+Matrix<T> random_matrix(std::size_t rows, std::size_t cols, int max,
+                        unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> dist(0, max);
+  Matrix<T> m(rows, cols);
+  for (std::size_t i = 0; i < rows; ++i) {
+    for (std::size_t j = 0; j < cols; ++j) {
+      m(i, j) = static_cast<T>(dist(gen));
+    }
+  }
+  return m;
+}
+
+} // namespace
+
+TEST_CASE_TEMPLATE("matmul over semirings", T, int, float, double,
+                   std::int64_t) {
+  parallel::thread_pool pool(3);
+
+  // Sizes straddle the row, depth and column blocks.
+  auto a = random_matrix<T>(131, 150, 4, 1);
+  auto b = random_matrix<T>(150, 533, 4, 2);
+  auto expected = naive_matmul(a, b, semiring::plus_times<T>{});
+  CHECK(matmul(a, b) == expected);
+  CHECK(matmul(a, b, &pool) == expected);
+
+  auto inf = semiring::min_plus<T>::zero();
+  a(0, 3) = inf;
+  b(5, 7) = inf;
+  auto expected_min = naive_matmul(a, b, semiring::min_plus<T>{});
+  CHECK(matmul(a, b, semiring::min_plus<T>{}, &pool) == expected_min);
+
+  CHECK_THROWS_AS(matmul(a, a), std::runtime_error);
+}
+
+TEST_CASE("shortest paths and reachability by repeated squaring") {
+  // Path 0 -> 1 -> 2 -> 3 with weights 1, 2, 3.
+  using S = semiring::min_plus<int>;
+  Matrix<int> d(4, 4, S::zero());
+  for (std::size_t i = 0; i < 4; ++i) {
+    d(i, i) = 0;
+  }
+  d(0, 1) = 1;
+  d(1, 2) = 2;
+  d(2, 3) = 3;
+  d = matmul(d, d, S{});
+  d = matmul(d, d, S{});
+  CHECK(d(0, 3) == 6);
+  CHECK(d(1, 3) == 5);
+  CHECK(d(3, 0) == S::zero());
+
+  Matrix<std::uint8_t> r(4, 4, 0);
+  for (std::size_t i = 0; i < 4; ++i) {
+    r(i, i) = 1;
+  }
+  r(0, 1) = r(1, 2) = r(2, 3) = 1;
+  r = matmul(r, r, semiring::or_and<std::uint8_t>{});
+  r = matmul(r, r, semiring::or_and<std::uint8_t>{});
+  CHECK(r(0, 3) == 1);
+  CHECK(r(3, 0) == 0);
+}
+
+TEST_CASE("matmul special values") {
+  // Zeros in a still multiply inf and NaN in b, which gives NaN.
+  Matrix<double> a(2, 3, 0.0);
+  Matrix<double> b(3, 20, 1.0);
+  a(1, 1) = 2.0;
+  b(0, 0) = std::numeric_limits<double>::infinity();
+  b(0, 17) = std::numeric_limits<double>::quiet_NaN();
+  auto c = matmul(a, b);
+  CHECK(std::isnan(c(0, 0)));
+  CHECK(std::isnan(c(0, 17)));
+  CHECK(c(0, 1) == 0.0);
+  CHECK(c(1, 1) == 2.0);
+
+  // Integer min-plus sums saturate instead of wrapping around.
+  using S = semiring::min_plus<std::int32_t>;
+  constexpr std::int32_t inf = S::zero();
+  constexpr std::int32_t lowest = std::numeric_limits<std::int32_t>::lowest();
+  Matrix<std::int32_t> x(2, 1);
+  x(0, 0) = inf - 1;
+  x(1, 0) = lowest + 1;
+  Matrix<std::int32_t> y(1, 20, 5);
+  for (std::size_t j = 10; j < 20; ++j) {
+    y(0, j) = -5;
+  }
+  auto d = matmul(x, y, S{});
+  for (std::size_t j = 0; j < 20; ++j) {
+    CHECK(d(0, j) == (j < 10 ? inf : inf - 6));
+    CHECK(d(1, j) == (j < 10 ? lowest + 6 : lowest));
+  }
+  CHECK(S::mul(inf - 1, 5) == inf);
+  CHECK(S::mul(lowest + 1, -5) == lowest);
+  CHECK(semiring::min_plus<std::uint8_t>::mul(250, 10) == 255);
+}
+
+TEST_CASE("transpose") {
+  parallel::thread_pool pool(2);
+  auto m = random_matrix<double>(70, 45, 100, 3);
+  auto t = transpose(m, &pool);
+  CHECK(t.shape() == std::make_pair(std::size_t{45}, std::size_t{70}));
+  bool all_equal = true;
+  for (std::size_t i = 0; i < 70; ++i) {
+    for (std::size_t j = 0; j < 45; ++j) {
+      all_equal = all_equal && t(j, i) == m(i, j);
+    }
+  }
+  CHECK(all_equal);
+  CHECK(transpose(t) == m);
+  CHECK(transpose(Matrix<int>()).size() == 0);
+}
+
+TEST_CASE("elementwise operations and reductions") {
+  Matrix<int> a(2, 3), b(2, 3);
+  for (std::size_t i = 0; i < 6; ++i) {
+    a(i / 3, i % 3) = static_cast<int>(i);
+    b(i / 3, i % 3) = 5 - static_cast<int>(i);
+  }
+
+  CHECK((a + b) == Matrix<int>(2, 3, 5));
+  CHECK((a - a) == Matrix<int>(2, 3, 0));
+  CHECK((a * b)(1, 0) == 6);
+  CHECK(elementwise_min(a, b)(0, 0) == 0);
+  CHECK(elementwise_min(a, b)(1, 2) == 0);
+  CHECK(elementwise_max(a, b)(0, 0) == 5);
+  CHECK_THROWS_AS(a + Matrix<int>(3, 2), std::runtime_error);
+
+  parallel::thread_pool pool(2);
+  CHECK(reduce_rows(a, 0, std::plus<>{}, &pool) == std::vector<int>{3, 12});
+  CHECK(reduce_columns(a, 0, std::plus<>{}, &pool) ==
+        std::vector<int>{3, 5, 7});
+  CHECK(reduce_columns(b, 100, [](int x, int y) { return std::min(x, y); }) ==
+        std::vector<int>{2, 1, 0});
+
+  auto wide = random_matrix<int>(3, 2500, 9, 4);
+  auto sums = reduce_columns(wide, 0, std::plus<>{}, &pool);
+  CHECK(sums[2400] == wide(0, 2400) + wide(1, 2400) + wide(2, 2400));
+}
+
+TEST_CASE("views, blocks and strides") {
+  Matrix<int> m(4, 5);
+  for (std::size_t i = 0; i < 4; ++i) {
+    for (std::size_t j = 0; j < 5; ++j) {
+      m(i, j) = static_cast<int>(10 * i + j);
+    }
+  }
+
+  auto b = m.block(1, 2, 2, 3);
+  CHECK(b.shape() == std::make_pair(std::size_t{2}, std::size_t{3}));
+  CHECK(b(0, 0) == 12);
+  CHECK(b(1, 2) == 24);
+  CHECK(b.row_stride() == 5);
+
+  // Views alias the matrix.
+  b(1, 1) = -1;
+  CHECK(m(2, 3) == -1);
+
+  auto t = b.transposed();
+  CHECK(t.shape() == std::make_pair(std::size_t{3}, std::size_t{2}));
+  CHECK(t(2, 0) == 14);
+  CHECK_FALSE(t.rows_contiguous());
+  CHECK(t.block(1, 1, 2, 1)(1, 0) == 24);
+
+  CHECK(m.view().row(3)(0, 4) == 34);
+  CHECK(m.view().col(1)(2, 0) == 21);
+  CHECK(b.col(0).to_matrix() == Matrix<int>(2, 1, 0) + m.block(1, 2, 2, 1));
+  CHECK_THROWS_AS(m.block(3, 0, 2, 1), std::out_of_range);
+  CHECK_THROWS_AS(b.col(3), std::out_of_range);
+
+  ConstMatrixView<int> cb = b;
+  CHECK(cb(0, 1) == 13);
+  const Matrix<int> &cm = m;
+  CHECK(cm.block(0, 0, 1, 1)(0, 0) == 0);
+
+  m.block(0, 0, 2, 2).fill(7);
+  CHECK(m(1, 1) == 7);
+  m.block(2, 0, 2, 2).assign(m.block(0, 0, 2, 2));
+  CHECK(m(3, 1) == 7);
+}
+
+TEST_CASE("kernels on views") {
+  parallel::thread_pool pool(2);
+  auto a = random_matrix<double>(90, 70, 5, 5);
+  auto b = random_matrix<double>(90, 70, 5, 6);
+
+  // a * b^T through a transposed view matches an explicit transpose.
+  auto expected = matmul(a, transpose(b));
+  CHECK(matmul(a, b.view().transposed(), &pool) == expected);
+
+  CHECK(transpose(a.view().transposed()) == transpose(transpose(a)));
+  CHECK((a.block(10, 10, 20, 20) + b.block(0, 0, 20, 20))(3, 4) ==
+        a(13, 14) + b(3, 4));
+  CHECK(reduce_rows(a.view().transposed(), 0.0, std::plus<>{}) ==
+        reduce_columns(a, 0.0, std::plus<>{}));
+  CHECK(reduce_columns(a.view().transposed(), 0.0, std::plus<>{}, &pool) ==
+        reduce_rows(a, 0.0, std::plus<>{}));
+
+  // One tile of a min-plus product, accumulated in place as in blocked
+  // Floyd-Warshall: C_00 = min(C_00, A_01 B_10).
+  using S = semiring::min_plus<double>;
+  auto d = random_matrix<double>(64, 64, 20, 7);
+  auto tiles = d;
+  matmul_into(tiles.block(0, 0, 32, 32), d.block(0, 32, 32, 32),
+              d.block(32, 0, 32, 32), S{}, &pool);
+  auto product = matmul(d.block(0, 32, 32, 32), d.block(32, 0, 32, 32), S{});
+  auto expected_tile = elementwise_min(d.block(0, 0, 32, 32), product);
+  CHECK(tiles.block(0, 0, 32, 32).to_matrix() == expected_tile);
+  CHECK(tiles.block(32, 32, 32, 32).to_matrix() ==
+        d.block(32, 32, 32, 32).to_matrix());
+
+  // A strided destination takes the scalar path.
+  Matrix<double> ct(32, 32, S::zero());
+  matmul_into(ct.view().transposed(), d.block(0, 32, 32, 32),
+              d.block(32, 0, 32, 32), S{});
+  CHECK(transpose(ct) == product);
+}
+
+TEST_CASE("uninitialized construction and mmap-backed storage") {
+  auto m = Matrix<double>::uninitialized(3, 4);
+  CHECK(m.shape() == std::make_pair(std::size_t{3}, std::size_t{4}));
+  m.view().fill(2.5);
+  CHECK(m == Matrix<double>(3, 4, 2.5));
+  CHECK(Matrix<int>::uninitialized(0, 0).size() == 0);
+
+  // Below and above the threshold at which blocks are mapped.
+  Matrix<int, mmap_allocator<int>> small(8, 8, 3);
+  CHECK(reinterpret_cast<std::uintptr_t>(&small(0, 0)) % 64 == 0);
+  CHECK(small(7, 7) == 3);
+
+  auto large = Matrix<std::uint32_t, mmap_allocator<std::uint32_t>>::
+      uninitialized(1024, 1024);
+  CHECK(reinterpret_cast<std::uintptr_t>(&large(0, 0)) % 4096 == 0);
+  large(1023, 1023) = 7;
+  large(0, 0) = 1;
+  auto copy = large;
+  CHECK(copy(1023, 1023) == 7);
+  large.resize(2048, 1024, 9);
+  CHECK(large(0, 0) == 1);
+  CHECK(large(2047, 5) == 9);
+}
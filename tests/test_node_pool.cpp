@@ -0,0 +1,118 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/avl_tree.hpp"
+#include "utils_cpp/interval_tree.hpp"
+#include "utils_cpp/node_pool.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Counts allocate() calls, to check that nodes come from a few slabs.
+template <typename T>
+struct counting_allocator {
+  using value_type = T;
+
+  std::size_t *count;
+
+  explicit counting_allocator(std::size_t *count) : count{count} {}
+  template <typename U>
+  counting_allocator(const counting_allocator<U> &other) : count{other.count} {}
+
+  T *allocate(std::size_t n) {
+    ++*count;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, std::size_t n) { std::allocator<T>().deallocate(p, n); }
+
+  template <typename U>
+  bool operator==(const counting_allocator<U> &other) const {
+    return count == other.count;
+  }
+};
+
+} // namespace
+
+TEST_CASE("node pool reuses freed slots") {
+  utils::NodePool<std::pair<int, int>> pool;
+  auto *a = pool.create(1, 2);
+  auto *b = pool.create(3, 4);
+  CHECK(pool.size() == 2);
+  CHECK(b->second == 4);
+
+  pool.destroy(a);
+  CHECK(pool.size() == 1);
+  auto *c = pool.create(5, 6);
+  CHECK(c == a);
+
+  pool.release();
+  CHECK(pool.size() == 0);
+}
+
+TEST_CASE("trees allocate nodes in slabs") {
+  std::size_t allocations = 0;
+  counting_allocator<int> alloc(&allocations);
+
+  utils::AVLTree<int, std::less<int>, counting_allocator<int>> tree(alloc);
+  for (int i = 0; i < 10000; ++i) {
+    tree.insert(i);
+  }
+  CHECK(tree.size() == 10000);
+  // Slabs double from 64 nodes, so 10000 nodes take 8 slabs.
+  CHECK(allocations <= 8);
+
+  allocations = 0;
+  auto copy = tree.clone();
+  CHECK(allocations == 1);
+  CHECK(copy.size() == 10000);
+  CHECK(copy.contains(9999));
+
+  tree.clear();
+  CHECK(tree.empty());
+  CHECK_FALSE(tree.contains(5));
+  CHECK(copy.contains(5));
+  tree.insert(5);
+  CHECK(tree.contains(5));
+}
+
+TEST_CASE("trees with non-trivial keys destroy them") {
+  utils::AVLTree<std::string> tree;
+  for (int i = 0; i < 1000; ++i) {
+    tree.insert(std::string(50, 'a') + std::to_string(i));
+  }
+  for (int i = 0; i < 1000; i += 2) {
+    tree.erase(std::string(50, 'a') + std::to_string(i));
+  }
+  auto copy = tree.clone();
+  tree.clear();
+  CHECK(copy.size() == 500);
+  CHECK(copy.contains(std::string(50, 'a') + "1"));
+  CHECK_FALSE(copy.contains(std::string(50, 'a') + "0"));
+
+  // The halves of a split share a pool until one of them is gone.
+  auto upper = copy.split(std::string(50, 'a') + "5");
+  CHECK(copy.size() + upper.size() == 500);
+  std::size_t upper_size = upper.size();
+  copy.clear();
+  upper.insert("b");
+  CHECK(upper.contains(std::string(50, 'a') + "999"));
+  copy.insert("0");
+  copy.join(std::move(upper));
+  CHECK(copy.contains("b"));
+  CHECK(copy.size() == upper_size + 2);
+
+  utils::IntervalTree<int> intervals;
+  for (int i = 0; i < 1000; ++i) {
+    intervals.insert(2 * i, 2 * i);
+  }
+  auto intervals_copy = intervals.clone();
+  intervals.clear();
+  CHECK(intervals.empty());
+  CHECK(intervals_copy.size() == 1000);
+  CHECK(intervals_copy.contains(1998));
+  CHECK_FALSE(intervals_copy.contains(1999));
+}
@@ -3,6 +3,14 @@
 
 #include "utils_cpp/numpy.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <ranges>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 using namespace utils;
@@ -79,3 +87,226 @@ TEST_CASE("test arange") {
     CHECK(v == std::vector<int>());
   }
 }
+
+TEST_CASE("arange is a random-access view") {
+  static_assert(std::ranges::random_access_range<arange<int>>);
+  static_assert(std::ranges::view<arange<double>>);
+
+  arange odd(1, 10, 2);
+  CHECK(odd.size() == 5);
+  CHECK(odd[4] == 9);
+  CHECK_THROWS_AS(odd[5], std::out_of_range);
+  CHECK(odd.to_vector() == std::vector<int>{1, 3, 5, 7, 9});
+  CHECK(arange(10, 5, 2).size() == 0);
+  CHECK(arange(10, 5, -2).to_vector() == std::vector<int>{10, 8, 6});
+  CHECK(arange<std::uint8_t>(0, 255, 100).size() == 3);
+
+  auto halves = arange{0.0, 1.0, 0.25} |
+                std::views::transform([](double x) { return 2 * x; });
+  CHECK(std::vector<double>(halves.begin(), halves.end()) ==
+        std::vector<double>{0, 0.5, 1, 1.5});
+  CHECK(std::ranges::max(arange{-5, 5}) == 4);
+}
+
+TEST_CASE("npy headers") {
+  CHECK(npy_descr<double>() == "<f8");
+  CHECK(npy_descr<std::uint16_t>() == "<u2");
+  CHECK(npy_descr<std::int8_t>() == "|i1");
+
+  std::string header = npy_header<int>(3, 4);
+  CHECK(header.size() % 64 == 0);
+  CHECK(header.back() == '\n');
+
+  NpyHeader parsed = parse_npy_header(header);
+  CHECK(parsed.descr == "<i4");
+  CHECK_FALSE(parsed.fortran_order);
+  CHECK(parsed.shape == std::vector<std::size_t>{3, 4});
+  CHECK(parsed.data_offset == header.size());
+
+  // A header as numpy writes it for a 1D array.
+  std::string dict =
+      "{'descr': '<f4', 'fortran_order': True, 'shape': (7,), }";
+  std::string v1 = std::string("\x93NUMPY\x01\x00", 8);
+  v1 += static_cast<char>(dict.size());
+  v1 += '\0';
+  parsed = parse_npy_header(v1 + dict);
+  CHECK(parsed.descr == "<f4");
+  CHECK(parsed.fortran_order);
+  CHECK(parsed.shape == std::vector<std::size_t>{7});
+
+  CHECK_THROWS_AS(parse_npy_header("not numpy"), std::runtime_error);
+}
+
+TEST_CASE("save and load npy") {
+  std::string filename = "temporary_matrix.npy";
+  Matrix<double> m(5, 3);
+  for (std::size_t i = 0; i < 5; ++i) {
+    for (std::size_t j = 0; j < 3; ++j) {
+      m(i, j) = static_cast<double>(i) - 0.5 * static_cast<double>(j);
+    }
+  }
+
+  save_npy<double>(filename, m);
+  CHECK(load_npy<double>(filename) == m);
+  CHECK_THROWS_AS(load_npy<float>(filename), std::runtime_error);
+
+  // Views are written in their own row-major order.
+  save_npy<double>(filename, m.view().transposed());
+  CHECK(load_npy<double>(filename) == transpose(m));
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("crc32") {
+  std::string check = "123456789";
+  CHECK(detail::crc32(check.data(), check.size()) == 0xcbf43926);
+  CHECK(detail::crc32(check.data(), 0) == 0);
+
+  // Split anywhere, the running CRC matches the CRC of the whole.
+  std::string text(1000, '\0');
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    text[i] = static_cast<char>(i * 31 + 7);
+  }
+  auto whole = detail::crc32(text.data(), text.size());
+  for (std::size_t split : {0, 1, 7, 8, 500, 999}) {
+    auto first = detail::crc32(text.data(), split);
+    CHECK(detail::crc32(text.data() + split, text.size() - split, first) ==
+          whole);
+  }
+}
+
+TEST_CASE("1D npy files and mapped arrays") {
+  std::string filename = "temporary_vector.npy";
+  std::vector<std::int32_t> values = {3, -1, 4, 1, -5, 9, 2};
+  save_npy(filename, values);
+  CHECK(load_npy_vector<std::int32_t>(filename) == values);
+  CHECK(load_npy<std::int32_t>(filename).shape().first == 7);
+
+  NpyArray array = map_npy(filename);
+  CHECK(array.descr() == "<i4");
+  CHECK(array.shape() == std::vector<std::size_t>{7});
+  CHECK(array.size() == 7);
+  CHECK(array.bytes().size() == 28);
+  auto view = array.values<std::int32_t>();
+  CHECK(std::vector<std::int32_t>(view.begin(), view.end()) == values);
+  CHECK(array.matrix<std::int32_t>().shape() == std::pair<std::size_t,
+                                                          std::size_t>{7, 1});
+  CHECK_THROWS_AS(array.values<std::uint32_t>(), std::runtime_error);
+  std::remove(filename.c_str());
+
+  // The view keeps the file mapped after the array that made it is gone.
+  save_npy<double>(filename, Matrix<double>(2, 3, 1.5));
+  ConstMatrixView<double> m;
+  {
+    NpyArray copy = map_npy(filename);
+    array = copy;
+    m = array.matrix<double>();
+  }
+  CHECK(m.shape() == std::pair<std::size_t, std::size_t>{2, 3});
+  CHECK(m(1, 2) == 1.5);
+  std::remove(filename.c_str());
+
+  // Elements misaligned for their type are copied to aligned memory.
+  std::string image = npy_header<double>({2});
+  double two[2] = {0.25, -8};
+  image.append(reinterpret_cast<const char *>(two), sizeof(two));
+  auto buffer = std::make_shared<std::string>(" " + image);
+  NpyArray shifted(std::string_view(*buffer).substr(1), buffer);
+  CHECK(reinterpret_cast<std::uintptr_t>(shifted.bytes().data()) % 8 == 0);
+  CHECK(shifted.values<double>()[1] == -8);
+  CHECK_THROWS_AS(NpyArray(std::string_view(image).substr(0, image.size() - 1),
+                           nullptr),
+                  std::runtime_error);
+
+  // Unicode strings take 4 bytes per character.
+  std::string strings = detail::npy_header_for("<U3", {2});
+  strings.append(24, '\0');
+  NpyArray unicode(strings, nullptr);
+  CHECK(unicode.bytes().size() == 24);
+  CHECK_THROWS_AS(NpyArray(std::string_view(strings).substr(
+                               0, strings.size() - 4),
+                           nullptr),
+                  std::runtime_error);
+}
+
+TEST_CASE("NpyWriter") {
+  std::string filename = "temporary_stream.npy";
+  {
+    NpyWriter<float> out(filename, {3, 2});
+    std::vector<float> row = {1, 2};
+    for (int i = 0; i < 3; ++i) {
+      CHECK(out.remaining() == static_cast<std::size_t>(6 - 2 * i));
+      out.write(row);
+      row[0] += 10;
+    }
+    CHECK_THROWS_AS(out.write(row), std::runtime_error);
+    out.close();
+  }
+  Matrix<float> m = load_npy<float>(filename);
+  CHECK(m.shape() == std::pair<std::size_t, std::size_t>{3, 2});
+  CHECK(m(2, 0) == 21);
+
+  NpyWriter<float> partial(filename, {4});
+  partial.write(std::vector<float>{1, 2});
+  CHECK_THROWS_AS(partial.close(), std::runtime_error);
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("npz files") {
+  std::string filename = "temporary_arrays.npz";
+  Matrix<double> m(4, 3);
+  for (std::size_t i = 0; i < 4; ++i) {
+    for (std::size_t j = 0; j < 3; ++j) {
+      m(i, j) = static_cast<double>(10 * i + j);
+    }
+  }
+  std::vector<std::uint16_t> ids = {5, 6, 7};
+  {
+    NpzWriter npz(filename);
+    npz.add<double>("m", m);
+    npz.add("ids", ids);
+    npz.add<double>("mt", m.view().transposed());
+    npz.begin_array<std::int8_t>("streamed", {2, 2});
+    CHECK_THROWS_AS(npz.begin_array<std::int8_t>("other", {1}),
+                    std::logic_error);
+    CHECK_THROWS_AS(npz.write(std::span<const int>()), std::logic_error);
+    std::int8_t row[2] = {-1, 2};
+    npz.write<std::int8_t>(row);
+    npz.write<std::int8_t>(row);
+    npz.end_array();
+    CHECK_THROWS_AS(npz.add("ids", ids), std::invalid_argument);
+    npz.add("empty", std::vector<float>{});
+    // The destructor writes the central directory.
+  }
+
+  NpzFile npz(filename);
+  CHECK(npz.size() == 5);
+  CHECK(npz.names() ==
+        std::vector<std::string>{"empty", "ids", "m", "mt", "streamed"});
+  CHECK(npz.contains("ids"));
+  CHECK_FALSE(npz.contains("nothing"));
+  CHECK_THROWS_AS(npz["nothing"], std::out_of_range);
+
+  NpyArray array = npz["m"];
+  CHECK(array.matrix<double>().to_matrix() == m);
+  // Member data is aligned in the file, so it is viewed in place.
+  CHECK(reinterpret_cast<std::uintptr_t>(array.bytes().data()) % 64 == 0);
+  CHECK(npz["mt"].matrix<double>().to_matrix() == transpose(m));
+  auto id_values = npz["ids"].values<std::uint16_t>();
+  CHECK(std::vector<std::uint16_t>(id_values.begin(), id_values.end()) ==
+        ids);
+  auto streamed = npz["streamed"].matrix<std::int8_t>();
+  CHECK(streamed(1, 0) == -1);
+  CHECK(streamed(1, 1) == 2);
+  CHECK(npz["empty"].size() == 0);
+  std::remove(filename.c_str());
+
+  NpzWriter unfinished(filename);
+  unfinished.begin_array<double>("x", {2});
+  unfinished.write(std::span<const double>(&m(0, 0), 1));
+  CHECK_THROWS_AS(unfinished.end_array(), std::logic_error);
+  CHECK_THROWS_AS(unfinished.close(), std::logic_error);
+  std::remove(filename.c_str());
+
+  CHECK_THROWS_AS(NpzFile("temporary_missing.npz"), std::runtime_error);
+}
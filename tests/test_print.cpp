@@ -4,7 +4,13 @@
 #include "utils_cpp/hash.hpp"
 #include "utils_cpp/print.hpp"
 
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <random>
 #include <sstream>
+#include <string>
 
 using utils::operator<<;
 
@@ -195,6 +201,93 @@ TEST_CASE("escape special chars") {
   CHECK(ss.str() == "hello\\nworld\\thello\nworld\t");
 }
 
+TEST_CASE("escape special chars in bulk and per stream") {
+  std::stringstream a, b;
+  a << utils::escape_special_chars(true);
+  b << utils::escape_special_chars(true);
+  a << std::string(1000, 'x') + "\n\t" << std::vector<int>{1, 2};
+  b << "b\n";
+  // Enabling twice, or disabling a stream that does not escape, is harmless.
+  b << utils::escape_special_chars(true) << utils::escape_special_chars(false)
+    << utils::escape_special_chars(false) << "\n";
+  CHECK(a.str() == std::string(1000, 'x') + "\\n\\t[1, 2]");
+  CHECK(b.str() == "b\\n\n");
+}
+
+// What element-by-element operator<< prints, with the flags of 'like'.
+template <typename T>
+std::string reference_print(const std::vector<T> &v, const std::ostream &like) {
+  std::ostringstream os;
+  os.copyfmt(like);
+  os << '[';
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    os << (i == 0 ? "" : ", ") << v[i];
+  }
+  os << ']';
+  return os.str();
+}
+
+TEST_CASE("numbers print as with operator<<") {
+  std::mt19937_64 gen(1);
+  std::vector<double> doubles{0.0,
+                              -0.0,
+                              1.0,
+                              0.1,
+                              1.0 / 3,
+                              123456789.0,
+                              1e-7,
+                              -2.5e300,
+                              std::numeric_limits<double>::infinity(),
+                              std::numeric_limits<double>::denorm_min()};
+  for (int i = 0; i < 1000; ++i) {
+    doubles.push_back(std::ldexp(static_cast<double>(gen() >> 11),
+                                 static_cast<int>(gen() % 200) - 150));
+  }
+  std::vector<float> floats{0.1f, 1e20f, -3.25f};
+  std::vector<std::int64_t> ints{0, -1,
+                                 std::numeric_limits<std::int64_t>::min(),
+                                 std::numeric_limits<std::int64_t>::max()};
+  std::vector<unsigned short> shorts{0, 65535};
+
+  for (int precision : {1, 6, 17}) {
+    std::ostringstream os;
+    os.precision(precision);
+    os << doubles;
+    CHECK(os.str() == reference_print(doubles, os));
+  }
+  std::ostringstream os;
+  os << floats << ints << shorts;
+  CHECK(os.str() == reference_print(floats, os) + reference_print(ints, os) +
+                        reference_print(shorts, os));
+
+  // Other formats take the element-by-element path.
+  std::ostringstream fixed, hex;
+  fixed << std::fixed << std::setprecision(2) << doubles;
+  CHECK(fixed.str() == reference_print(doubles, fixed));
+  hex << std::hex << std::showbase << ints;
+  CHECK(hex.str() == reference_print(ints, hex));
+
+  std::vector<bool> bools{true, false};
+  std::ostringstream b;
+  b << bools;
+  CHECK(b.str() == "[1, 0]");
+}
+
+TEST_CASE("large nested containers") {
+  std::vector<std::vector<double>> rows(100, std::vector<double>(5000, 0.5));
+  rows[99].back() = 2;
+  std::ostringstream os;
+  os << rows;
+  const std::string out = os.str();
+  // The last number is "2" rather than "0.5".
+  CHECK(out.size() == 2 + 99 * 2 + 100 * (2 + 4999 * 2 + 5000 * 3) - 2);
+  CHECK(out.substr(out.size() - 8) == "0.5, 2]]");
+
+  std::ostringstream pretty;
+  pretty << utils::prettyprint(true) << std::vector<std::set<int>>{{1}, {2}};
+  CHECK(pretty.str() == "[\n  {1},\n  {2}\n]");
+}
+
 TEST_CASE("test print tuple") {
 
   std::tuple<int, std::string, std::vector<std::tuple<int, std::string>>> t = {
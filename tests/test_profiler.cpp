@@ -0,0 +1,219 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/profiler.hpp"
+
+#include <future>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+
+void leaf(int n) {
+  ScopedTimer timer("leaf");
+  volatile int sink = 0;
+  for (int i = 0; i < n; ++i) {
+    sink = sink + i;
+  }
+}
+
+void step() {
+  ScopedTimer timer("step");
+  leaf(100);
+  leaf(1000);
+  {
+    ScopedTimer inner("inner");
+    leaf(10);
+  }
+}
+
+} // namespace
+
+TEST_CASE("zones nest by name") {
+  Profiler::reset();
+  for (int i = 0; i < 5; ++i) {
+    step();
+  }
+  auto report = Profiler::report();
+  CHECK(report.name == "root");
+  CHECK(report.count == 0);
+  REQUIRE(report.children.size() == 1);
+
+  const auto *s = report.find("step");
+  REQUIRE(s != nullptr);
+  CHECK(s->count == 5);
+  REQUIRE(s->children.size() == 2);
+  CHECK(s->find("leaf")->count == 10);
+  CHECK(s->find("inner")->count == 5);
+  CHECK(s->find("inner")->find("leaf")->count == 5);
+  CHECK(report.find("leaf") == nullptr);
+
+  const auto *l = s->find("leaf");
+  CHECK(l->min_ns <= l->max_ns);
+  CHECK(l->min_ns <= l->percentile(50));
+  CHECK(l->percentile(50) <= l->percentile(99));
+  CHECK(l->percentile(99) <= l->max_ns);
+  CHECK(l->mean_ns() * 10 == doctest::Approx(l->total_ns));
+  // Children run inside their parent.
+  CHECK(s->find("leaf")->total_ns + s->find("inner")->total_ns <= s->total_ns);
+
+  Profiler::reset();
+  CHECK(Profiler::report().children.empty());
+}
+
+TEST_CASE("percentiles") {
+  ProfileZone zone;
+  for (std::uint64_t ns = 1; ns <= 1000; ++ns) {
+    zone.add(ns * 1000);
+  }
+  CHECK(zone.min_ns == 1000);
+  CHECK(zone.max_ns == 1'000'000);
+  CHECK(zone.percentile(0) == 1000);
+  CHECK(zone.percentile(100) == 1'000'000);
+  CHECK(zone.percentile(50) == doctest::Approx(500'000).epsilon(0.07));
+  CHECK(zone.percentile(90) == doctest::Approx(900'000).epsilon(0.07));
+  CHECK(zone.percentile(99) == doctest::Approx(990'000).epsilon(0.07));
+
+  // Small values have exact buckets.
+  ProfileZone small;
+  for (std::uint64_t ns : {1, 2, 3, 4, 5}) {
+    small.add(ns);
+  }
+  CHECK(small.percentile(60) == 3);
+  CHECK(ProfileZone{}.percentile(50) == 0);
+
+  for (std::size_t i = 0; i < ProfileZone::num_buckets; ++i) {
+    auto middle = static_cast<std::uint64_t>(ProfileZone::bucket_middle(i));
+    CHECK(ProfileZone::bucket(middle) == i);
+  }
+  CHECK(ProfileZone::bucket(~std::uint64_t{0}) ==
+        ProfileZone::num_buckets - 1);
+}
+
+TEST_CASE("threads merge when they exit") {
+  Profiler::reset();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([] {
+      for (int i = 0; i < 50; ++i) {
+        step();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  step();
+
+  auto report = Profiler::report();
+  CHECK(report.find("step")->count == 201);
+  CHECK(report.find("step")->find("leaf")->count == 402);
+  CHECK(report.find("step")->find("inner")->find("leaf")->count == 201);
+}
+
+TEST_CASE("running threads are included") {
+  Profiler::reset();
+  Profiler::record_events(true);
+  std::promise<void> stepped, reset_done, leafed, report_done;
+  std::thread worker([&] {
+    ScopedTimer timer("worker");
+    step();
+    stepped.set_value();
+    reset_done.get_future().wait();
+    leaf(10);
+    leafed.set_value();
+    report_done.get_future().wait();
+  });
+
+  stepped.get_future().wait();
+  auto report = Profiler::report();
+  const auto *open = report.find("worker");
+  REQUIRE(open != nullptr);
+  CHECK(open->count == 0);
+  CHECK(open->find("step")->count == 1);
+  CHECK(open->find("step")->find("leaf")->count == 2);
+  std::stringstream ss;
+  Profiler::chrome_trace(ss);
+  // step, 3 x leaf and inner.
+  CHECK(parse(ss.str())["traceEvents"].as_array_view().size() == 5);
+
+  Profiler::reset();
+  CHECK(Profiler::report().find("worker") == nullptr);
+  reset_done.set_value();
+
+  leafed.get_future().wait();
+  report = Profiler::report();
+  REQUIRE(report.find("worker") != nullptr);
+  CHECK(report.find("worker")->find("step") == nullptr);
+  CHECK(report.find("worker")->find("leaf")->count == 1);
+  report_done.set_value();
+  worker.join();
+  Profiler::record_events(false);
+
+  report = Profiler::report();
+  CHECK(report.find("worker")->count == 1);
+  CHECK(report.find("worker")->find("leaf")->count == 1);
+}
+
+TEST_CASE("tsc clock") {
+  Profiler::reset();
+  Profiler::use_tsc(true);
+  {
+    ScopedTimer timer("sleep");
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  Profiler::use_tsc(false);
+  auto report = Profiler::report();
+  const auto *zone = report.find("sleep");
+  REQUIRE(zone != nullptr);
+  CHECK(zone->total_ns >= 4'000'000);
+  CHECK(zone->total_ns < 1'000'000'000);
+}
+
+TEST_CASE("json and chrome trace") {
+  Profiler::reset();
+  Profiler::record_events(true);
+  step();
+  std::thread([] { leaf(10); }).join();
+  Profiler::record_events(false);
+
+  auto report = Profiler::report();
+  auto json = report.to_json();
+  CHECK(json["name"].get<std::string>() == "root");
+  auto children = json["children"].as_array_view();
+  REQUIRE(children.size() == 2);
+  auto zone = report.find("step");
+  CHECK(json["children"][0]["count"].get<double>() == zone->count);
+  CHECK(json["children"][0]["p50_ns"].get<double>() == zone->percentile(50));
+  CHECK(json["children"][0]["children"].as_array_view().size() == 2);
+
+  std::stringstream ss;
+  Profiler::chrome_trace(ss);
+  auto trace = parse(ss.str());
+  auto events = trace["traceEvents"].as_array_view();
+  // step, 3 x leaf, inner, and the other thread's leaf.
+  REQUIRE(events.size() == 6);
+  std::size_t leaves = 0;
+  double step_start = 0, step_end = 0;
+  for (const auto &event : events) {
+    CHECK(event["ph"].get<std::string>() == "X");
+    CHECK(event["dur"].get<double>() >= 0);
+    if (event["name"].get<std::string>() == "leaf") {
+      ++leaves;
+    }
+    if (event["name"].get<std::string>() == "step") {
+      step_start = event["ts"].get<double>();
+      step_end = step_start + event["dur"].get<double>();
+    }
+  }
+  CHECK(leaves == 4);
+  for (const auto &event : events) {
+    if (event["name"].get<std::string>() == "inner") {
+      CHECK(event["ts"].get<double>() >= step_start);
+      CHECK(event["ts"].get<double>() <= step_end);
+    }
+  }
+}
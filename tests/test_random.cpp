@@ -4,7 +4,16 @@
 #include "utils_cpp/print.hpp"
 #include "utils_cpp/random.hpp"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
 
 TEST_CASE("test basic distributions") {
 
@@ -91,3 +100,292 @@ TEST_CASE("test random choice") {
 
   CHECK(r == "g");
 }
+
+TEST_CASE("engines match their reference outputs") {
+  utils::SplitMix64 splitmix(1234567);
+  for (std::uint64_t expected :
+       {6457827717110365317ULL, 3203168211198807973ULL, 9817491932198370423ULL,
+        4593380528125082431ULL, 16408922859458223821ULL}) {
+    CHECK(splitmix() == expected);
+  }
+
+  utils::Pcg32 pcg(42, 54);
+  for (std::uint32_t expected : {0xa15c02b7u, 0x7b47f409u, 0xba1d3330u,
+                                 0x83d2f293u, 0xbfa4784bu, 0xcbed606eu}) {
+    CHECK(pcg() == expected);
+  }
+
+  // The reference xoshiro256++ step, written out.
+  std::array<std::uint64_t, 4> s = {1, 2, 3, 4};
+  utils::Xoshiro256pp xoshiro(s);
+  for (int i = 0; i < 10; ++i) {
+    std::uint64_t expected = std::rotl(s[0] + s[3], 23) + s[0];
+    std::uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = std::rotl(s[3], 45);
+    CHECK(xoshiro() == expected);
+  }
+}
+
+TEST_CASE("jump-ahead") {
+  utils::Pcg32 stepped(7, 3), jumped(7, 3);
+  for (int i = 0; i < 1000; ++i) {
+    stepped();
+  }
+  jumped.advance(1000);
+  CHECK(stepped == jumped);
+  CHECK(stepped() == jumped());
+
+  // State after 2^128 steps, computed offline as a GF(2) matrix power.
+  utils::Xoshiro256pp gen(1);
+  gen.jump();
+  CHECK(gen.state() ==
+        std::array<std::uint64_t, 4>{
+            6041068758566665709ULL, 17079891032057765830ULL,
+            10826311974758636499ULL, 9563790762025571994ULL});
+
+  auto streams = utils::random_streams(1, 3);
+  REQUIRE(streams.size() == 3);
+  CHECK(streams[0] == utils::Xoshiro256pp(1));
+  CHECK(streams[1] == gen);
+  CHECK(streams[1]() != streams[2]());
+}
+
+TEST_CASE("functions accept any engine") {
+  utils::Xoshiro256pp xoshiro(5);
+  utils::Pcg32 pcg(5);
+  for (int i = 0; i < 1000; ++i) {
+    auto a = utils::random_int(-3, 3, xoshiro);
+    auto b = utils::random_int(std::uint64_t{0}, ~std::uint64_t{0} / 3, pcg);
+    CHECK(a >= -3);
+    CHECK(a <= 3);
+    CHECK(b <= ~std::uint64_t{0} / 3);
+    CHECK(utils::random_double(pcg) <= 1.0);
+  }
+  auto v = utils::shuffled_iota(100, pcg);
+  std::sort(v.begin(), v.end());
+  CHECK(v.front() == 0);
+  CHECK(v.back() == 99);
+}
+
+TEST_CASE("random bits") {
+  utils::Xoshiro256pp gen(9), copy(9);
+  utils::RandomBits bits(gen);
+
+  std::uint64_t word = copy();
+  for (int i = 0; i < 64; ++i) {
+    CHECK(bits() == static_cast<bool>((word >> i) & 1));
+  }
+  // Chunks that straddle draws come out in draw order.
+  std::uint64_t next = copy(), after = copy();
+  CHECK(bits.bits(60) == (next & ((std::uint64_t{1} << 60) - 1)));
+  CHECK(bits.bits(8) == ((next >> 60) | ((after & 0xf) << 4)));
+  CHECK(bits.bits(0) == 0);
+  CHECK_THROWS_AS(bits.bits(65), std::invalid_argument);
+
+  int ones = 0;
+  for (int i = 0; i < 64000; ++i) {
+    ones += bits();
+  }
+  CHECK(ones == doctest::Approx(32000).epsilon(0.02));
+}
+
+TEST_CASE("batched distributions") {
+  utils::Xoshiro256pp gen(11);
+  std::vector<double> u(100000);
+  utils::fill_uniform(std::span(u), gen);
+  double sum = 0;
+  for (double x : u) {
+    CHECK(x >= 0.0);
+    CHECK(x < 1.0);
+    sum += x;
+  }
+  CHECK(sum / static_cast<double>(u.size()) ==
+        doctest::Approx(0.5).epsilon(0.01));
+
+  utils::fill_uniform(std::span(u), -2.0, 2.0, gen);
+  CHECK(*std::min_element(u.begin(), u.end()) >= -2.0);
+  CHECK(*std::max_element(u.begin(), u.end()) < 2.0);
+
+  for (double p : {0.0, 0.1, 0.5, 0.9, 1.0}) {
+    std::vector<std::uint8_t> b(100001);
+    utils::fill_bernoulli(std::span(b), p, gen);
+    double mean = 0;
+    for (auto x : b) {
+      CHECK(x <= 1);
+      mean += x;
+    }
+    mean /= static_cast<double>(b.size());
+    CHECK(mean == doctest::Approx(p).epsilon(0.01));
+  }
+}
+
+TEST_CASE("sampling without replacement") {
+  utils::Xoshiro256pp gen(13);
+  // The first of the small sizes uses Floyd's algorithm, the others a
+  // partial shuffle.
+  for (auto [size, k] : {std::pair<std::size_t, std::size_t>{1000, 5},
+                         {100, 30},
+                         {10, 10},
+                         {7, 0}}) {
+    std::vector<int> first_counts(size), counts(size);
+    const int trials = 20000;
+    for (int trial = 0; trial < trials; ++trial) {
+      auto s = utils::sample_indices_without_replacement(size, k, gen);
+      REQUIRE(s.size() == k);
+      for (std::size_t i : s) {
+        REQUIRE(i < size);
+        ++counts[i];
+      }
+      std::sort(s.begin(), s.end());
+      CHECK(std::adjacent_find(s.begin(), s.end()) == s.end());
+      if (k > 0) {
+        auto again = utils::sample_indices_without_replacement(size, k, gen);
+        ++first_counts[again.front()];
+      }
+    }
+    if (k == 0) {
+      continue;
+    }
+    // Every index is chosen, and comes first, equally often.
+    const double expected = trials * static_cast<double>(k) / size;
+    const double expected_first = static_cast<double>(trials) / size;
+    for (std::size_t i = 0; i < size; ++i) {
+      CHECK(counts[i] == doctest::Approx(expected).epsilon(0.3));
+      if (expected_first >= 200) {
+        CHECK(first_counts[i] == doctest::Approx(expected_first).epsilon(0.3));
+      }
+    }
+  }
+
+  auto big = utils::sample_indices_without_replacement(std::size_t{1} << 60,
+                                                       100, gen);
+  std::sort(big.begin(), big.end());
+  CHECK(std::adjacent_find(big.begin(), big.end()) == big.end());
+  CHECK(big.back() < (std::size_t{1} << 60));
+  CHECK_THROWS_AS(utils::sample_indices_without_replacement(3, 4, gen),
+                  std::invalid_argument);
+
+  std::vector<int> data{1, 2, 3, 4, 5};
+  auto picked = utils::sample_without_replacement(data, 5, gen);
+  std::sort(picked.begin(), picked.end());
+  CHECK(picked == data);
+}
+
+TEST_CASE("sampling with a reusable buffer") {
+  utils::Pcg32 gen(3);
+  std::vector<std::size_t> buffer;
+  std::vector<int> counts(50);
+  for (int trial = 0; trial < 10000; ++trial) {
+    auto s = utils::sample_indices_without_replacement(50, 4, gen, buffer);
+    REQUIRE(s.size() == 4);
+    REQUIRE(s.data() == buffer.data());
+    for (std::size_t i : s) {
+      ++counts[i];
+    }
+  }
+  for (int c : counts) {
+    CHECK(c == doctest::Approx(800).epsilon(0.2));
+  }
+  // The buffer stays a permutation of [0, size).
+  auto sorted = buffer;
+  std::sort(sorted.begin(), sorted.end());
+  for (std::size_t i = 0; i < sorted.size(); ++i) {
+    CHECK(sorted[i] == i);
+  }
+  CHECK(utils::sample_indices_without_replacement(10, 10, gen, buffer)
+            .size() == 10);
+  CHECK(buffer.size() == 10);
+}
+
+TEST_CASE("sorted sampling") {
+  utils::Xoshiro256pp gen(17);
+  // Algorithm A alone, Algorithm D switching to A, and mostly Algorithm D.
+  for (auto [size, k] : {std::pair<std::size_t, std::size_t>{60, 20},
+                         {1000, 40},
+                         {100000, 3},
+                         {5, 5},
+                         {1, 1},
+                         {9, 0}}) {
+    const int trials = 20000;
+    std::vector<int> counts(size);
+    std::vector<int> first(std::min<std::size_t>(size, 8));
+    std::vector<std::size_t> s;
+    for (int trial = 0; trial < trials; ++trial) {
+      s.clear();
+      utils::sample_sorted_indices(size, k, std::back_inserter(s), gen);
+      REQUIRE(s.size() == k);
+      CHECK(std::is_sorted(s.begin(), s.end()));
+      CHECK(std::adjacent_find(s.begin(), s.end()) == s.end());
+      for (std::size_t i : s) {
+        REQUIRE(i < size);
+        ++counts[i];
+      }
+      if (k > 0 && s.front() < first.size()) {
+        ++first[s.front()];
+      }
+    }
+    if (k == 0) {
+      continue;
+    }
+    if (size <= 1000) {
+      const double expected = trials * static_cast<double>(k) / size;
+      for (int c : counts) {
+        CHECK(c == doctest::Approx(expected).epsilon(0.25));
+      }
+    }
+    // The smallest index is i with probability C(size-1-i, k-1) / C(size, k).
+    double p = static_cast<double>(k) / size;
+    for (std::size_t i = 0; i < first.size(); ++i) {
+      if (p * trials > 200) {
+        CHECK(first[i] == doctest::Approx(p * trials).epsilon(0.2));
+      }
+      if (i + 1 < size) {
+        p *= static_cast<double>(size - i - k) / (size - i - 1);
+      }
+    }
+  }
+
+  std::vector<std::size_t> huge;
+  utils::sample_sorted_indices(std::size_t{1} << 50, 1000,
+                               std::back_inserter(huge), gen);
+  CHECK(huge.size() == 1000);
+  CHECK(std::is_sorted(huge.begin(), huge.end()));
+  CHECK(std::adjacent_find(huge.begin(), huge.end()) == huge.end());
+  CHECK(huge.back() < (std::size_t{1} << 50));
+  CHECK_THROWS_AS(utils::sample_sorted_indices(3, 4, huge.begin(), gen),
+                  std::invalid_argument);
+}
+
+TEST_CASE("alias table") {
+  utils::Xoshiro256pp gen(19);
+  std::vector<double> weights{1, 0, 3, 0.5, 5.5};
+  utils::AliasTable table(weights);
+  CHECK(table.size() == 5);
+  std::vector<int> counts(5);
+  const int trials = 100000;
+  for (int i = 0; i < trials; ++i) {
+    ++counts[table(gen)];
+  }
+  CHECK(counts[1] == 0);
+  for (std::size_t i = 0; i < weights.size(); ++i) {
+    CHECK(counts[i] == doctest::Approx(trials * weights[i] / 10).epsilon(0.05));
+  }
+
+  utils::AliasTable single(std::vector<double>{2.0});
+  CHECK(single(gen) == 0);
+
+  CHECK_THROWS_AS(utils::AliasTable(std::vector<double>{}),
+                  std::invalid_argument);
+  CHECK_THROWS_AS(utils::AliasTable(std::vector<double>{1, -1}),
+                  std::invalid_argument);
+  CHECK_THROWS_AS(utils::AliasTable(std::vector<double>{0, 0}),
+                  std::invalid_argument);
+  const double inf = std::numeric_limits<double>::infinity();
+  CHECK_THROWS_AS(utils::AliasTable(std::vector<double>{1, inf}),
+                  std::invalid_argument);
+}
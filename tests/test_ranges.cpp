@@ -0,0 +1,81 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/ranges.hpp"
+
+#include <cstdint>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace utils;
+
+static_assert(std::ranges::random_access_range<LinearView<double>>);
+static_assert(std::ranges::sized_range<LinearView<double>>);
+static_assert(std::ranges::view<LinearView<int>>);
+static_assert(
+    std::ranges::random_access_range<CycleView<std::views::all_t<
+        std::vector<int> &>>>);
+
+TEST_CASE("LinearView") {
+  LinearView<int> v(3, -2, 5);
+  CHECK(v.size() == 5);
+  CHECK(std::vector<int>(v.begin(), v.end()) ==
+        std::vector<int>{3, 1, -1, -3, -5});
+  CHECK(v[4] == -5);
+  CHECK(v.back() == -5);
+  CHECK(*(v.end() - 2) == -3);
+  CHECK(v.end() - v.begin() == 5);
+  CHECK(v.to_vector() == std::vector<int>{3, 1, -1, -3, -5});
+  CHECK(LinearView<int>().empty());
+
+  // Elements are computed from their index, not accumulated.
+  LinearView<double> tenths(0.0, 0.1, 1001);
+  CHECK(tenths[1000] == 0.1 * 1000);
+  auto doubled = tenths | std::views::transform([](double x) { return 2 * x; });
+  CHECK(doubled[10] == 2 * (0.1 * 10));
+  CHECK(std::ranges::distance(doubled) == 1001);
+}
+
+TEST_CASE("fill_linear agrees with LinearView") {
+  for (std::size_t n : {0, 1, 7, 1000}) {
+    LinearView<float> f(-1.5f, 0.37f, n);
+    std::vector<float> out(n + 1, 42.0f);
+    f.copy_to(out);
+    for (std::size_t i = 0; i < n; ++i) {
+      CHECK(out[i] == f[static_cast<std::ptrdiff_t>(i)]);
+    }
+    CHECK(out[n] == 42.0f);
+
+    std::vector<std::uint8_t> bytes(n);
+    fill_linear<std::uint8_t>(bytes, 250, 3);
+    for (std::size_t i = 0; i < n; ++i) {
+      CHECK(bytes[i] == static_cast<std::uint8_t>(250 + 3 * i));
+    }
+  }
+}
+
+TEST_CASE("CycleView") {
+  std::vector<std::string> words = {"a", "b", "c"};
+  CycleView cycle(words, 7);
+  CHECK(cycle.size() == 7);
+  CHECK(std::vector<std::string>(cycle.begin(), cycle.end()) ==
+        std::vector<std::string>{"a", "b", "c", "a", "b", "c", "a"});
+  CHECK(cycle[5] == "c");
+  CHECK(&cycle[3] == &words[0]); // elements are references into the base
+  CHECK(cycle.to_vector() == std::vector<std::string>(cycle.begin(),
+                                                      cycle.end()));
+
+  for (std::size_t size : {0, 1, 2, 3, 100}) {
+    std::vector<int> base = {1, 2, 3};
+    CycleView ints(base, size);
+    std::vector<int> out(size);
+    ints.copy_to(std::span(out));
+    CHECK(out == std::vector<int>(ints.begin(), ints.end()));
+  }
+
+  std::vector<int> empty;
+  CHECK(CycleView(empty, 0).empty());
+  CHECK_THROWS_AS(CycleView(empty, 1), std::invalid_argument);
+}
@@ -0,0 +1,127 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/roaring_bitmap.hpp"
+
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+using utils::RoaringBitmap;
+
+namespace {
+
+std::set<std::uint32_t> random_set(std::mt19937 &rng, std::size_t count,
+                                   std::uint32_t range) {
+  std::uniform_int_distribution<std::uint32_t> dist(0, range - 1);
+  std::set<std::uint32_t> s;
+  while (s.size() < count) {
+    s.insert(dist(rng));
+  }
+  return s;
+}
+
+RoaringBitmap from_set(const std::set<std::uint32_t> &s) {
+  RoaringBitmap r;
+  for (std::uint32_t x : s) {
+    r.add(x);
+  }
+  return r;
+}
+
+std::vector<std::uint32_t> values(const RoaringBitmap &r) {
+  return {r.begin(), r.end()};
+}
+
+} // namespace
+
+TEST_CASE("add, remove, contains and iterate") {
+  RoaringBitmap r;
+  CHECK(r.empty());
+  CHECK(r.begin() == r.end());
+
+  CHECK(r.add(5));
+  CHECK(r.add(70000));
+  CHECK(r.add(1));
+  CHECK_FALSE(r.add(5));
+
+  CHECK(r.cardinality() == 3);
+  CHECK(r.contains(70000));
+  CHECK_FALSE(r.contains(70001));
+  CHECK(values(r) == std::vector<std::uint32_t>{1, 5, 70000});
+
+  CHECK(r.remove(5));
+  CHECK_FALSE(r.remove(5));
+  CHECK(r.remove(70000));
+  CHECK(values(r) == std::vector<std::uint32_t>{1});
+
+  CHECK(*r.lower_bound(0) == 1);
+  CHECK(r.lower_bound(2) == r.end());
+}
+
+TEST_CASE("containers switch between array and bitmap") {
+  RoaringBitmap r;
+  for (std::uint32_t x = 0; x < 10000; ++x) {
+    r.add(2 * x);
+  }
+  CHECK(r.cardinality() == 10000);
+  // 10000 values in one chunk is a bitmap container
+  CHECK(r.memory_bytes() < 10000 * sizeof(std::uint16_t));
+  for (std::uint32_t x = 0; x < 9000; ++x) {
+    r.remove(2 * x);
+  }
+  CHECK(r.cardinality() == 1000);
+  CHECK(*r.begin() == 18000);
+  CHECK(*r.lower_bound(18001) == 18002);
+  // and 1000 values is an array again
+  CHECK(RoaringBitmap(r.to_bitvector(20000)).memory_bytes() < 4096);
+}
+
+TEST_CASE("random sets match std::set") {
+  std::mt19937 rng(1);
+  for (auto [count, range] : {std::pair<std::size_t, std::uint32_t>{100, 300000},
+                              {20000, 200000},
+                              {60000, 70000}}) {
+    auto sa = random_set(rng, count, range);
+    auto sb = random_set(rng, count / 2, range);
+    RoaringBitmap a = from_set(sa), b = from_set(sb);
+
+    CHECK(values(a) == std::vector<std::uint32_t>(sa.begin(), sa.end()));
+
+    std::vector<std::uint32_t> inter, uni;
+    std::set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(),
+                          std::back_inserter(inter));
+    std::set_union(sa.begin(), sa.end(), sb.begin(), sb.end(),
+                   std::back_inserter(uni));
+
+    CHECK(values(a & b) == inter);
+    CHECK(values(a | b) == uni);
+    CHECK(popcount_and(a, b) == inter.size());
+    CHECK((a | b).cardinality() == uni.size());
+
+    RoaringBitmap c = a;
+    c &= b;
+    CHECK(c == (a & b));
+    c |= a;
+    CHECK(c == a);
+
+    std::uint32_t probe = range / 3;
+    auto it = a.lower_bound(probe);
+    auto expected = sa.lower_bound(probe);
+    REQUIRE(expected != sa.end());
+    CHECK(*it == *expected);
+  }
+}
+
+TEST_CASE("round trip through BitVector") {
+  std::mt19937 rng(2);
+  auto s = random_set(rng, 30000, 150000);
+  utils::BitVector bv(150000);
+  for (std::uint32_t x : s) {
+    bv.set(x);
+  }
+  RoaringBitmap r(bv);
+  CHECK(r == from_set(s));
+  CHECK(r.to_bitvector(150000) == bv);
+}
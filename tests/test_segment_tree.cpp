@@ -0,0 +1,131 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/segment_tree.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct min_fn {
+  int operator()(int a, int b) const { return std::min(a, b); }
+};
+
+// Not commutative, to check that queries keep the order.
+struct concat_fn {
+  std::vector<int> operator()(const std::vector<int> &a,
+                              const std::vector<int> &b) const {
+    std::vector<int> out = a;
+    out.insert(out.end(), b.begin(), b.end());
+    return out;
+  }
+};
+
+} // namespace
+
+TEST_CASE("SegmentTree builds from its input and queries with an identity") {
+  std::vector<int> values{5, 3, 8, 6, 1, 9, 2};
+  utils::SegmentTree<int, min_fn> tree(values,
+                                       std::numeric_limits<int>::max());
+  CHECK(tree.query(0, 7) == 1);
+  CHECK(tree.query(0, 3) == 3);
+  CHECK(tree.query(5, 7) == 2);
+  CHECK(tree.query(2, 2) == std::numeric_limits<int>::max());
+
+  tree.modify(4, 10);
+  CHECK(tree.query(0, 7) == 2);
+  CHECK(tree.query(3, 5) == 6);
+
+  std::vector<std::vector<int>> singletons;
+  for (int i = 0; i < 9; ++i) {
+    singletons.push_back({i});
+  }
+  utils::SegmentTree<std::vector<int>, concat_fn> order(singletons);
+  CHECK(order.query(2, 7) == std::vector<int>{2, 3, 4, 5, 6});
+  CHECK(order.query(0, 9) == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8});
+}
+
+TEST_CASE("LazySegmentTree range updates match a plain array") {
+  std::mt19937 rng(4);
+  for (std::size_t n : {1, 2, 7, 64, 100}) {
+    std::uniform_int_distribution<long long> value(-50, 50);
+    std::vector<long long> reference(n);
+    for (auto &v : reference) {
+      v = value(rng);
+    }
+    utils::LazySegmentTree<utils::monoid::Sum<long long>> sum(reference);
+    utils::LazySegmentTree<utils::monoid::Min<long long>> min(reference);
+    utils::LazySegmentTree<utils::monoid::Max<long long>> max(reference);
+
+    std::uniform_int_distribution<std::size_t> index(0, n);
+    for (int step = 0; step < 2000; ++step) {
+      std::size_t l = index(rng), r = index(rng);
+      if (l > r) {
+        std::swap(l, r);
+      }
+      long long x = value(rng);
+      switch (step % 4) {
+      case 0:
+        std::fill(reference.begin() + l, reference.begin() + r, x);
+        sum.assign(l, r, x);
+        min.assign(l, r, x);
+        max.assign(l, r, x);
+        break;
+      case 1:
+        for (std::size_t i = l; i < r; ++i) {
+          reference[i] += x;
+        }
+        sum.add(l, r, x);
+        min.add(l, r, x);
+        max.add(l, r, x);
+        break;
+      case 2:
+        if (l < n) {
+          reference[l] = x;
+          sum.set(l, x);
+          min.set(l, x);
+          max.set(l, x);
+        }
+        break;
+      default: {
+        auto first = reference.begin() + l, last = reference.begin() + r;
+        CHECK(sum.query(l, r) == std::accumulate(first, last, 0LL));
+        if (l < r) {
+          CHECK(min.query(l, r) == *std::min_element(first, last));
+          CHECK(max.query(l, r) == *std::max_element(first, last));
+        }
+        if (l < n) {
+          CHECK(sum.get(l) == reference[l]);
+        }
+      }
+      }
+    }
+    CHECK(sum.all() == std::accumulate(reference.begin(), reference.end(), 0LL));
+  }
+}
+
+TEST_CASE("LazySegmentTree max_right") {
+  // Availability times of 10 qubits, all free at 0.
+  utils::LazySegmentTree<utils::monoid::Max<int>> busy_until(10, 0);
+  busy_until.assign(2, 5, 7);
+  busy_until.add(4, 8, 3);
+  // [0, 0, 7, 7, 10, 3, 3, 3, 0, 0]
+
+  auto free_by = [](int t) { return [t](int busy) { return busy <= t; }; };
+  CHECK(busy_until.max_right(0, free_by(0)) == 2);
+  CHECK(busy_until.max_right(0, free_by(7)) == 4);
+  CHECK(busy_until.max_right(5, free_by(3)) == 10);
+  CHECK(busy_until.max_right(4, free_by(9)) == 4);
+  CHECK(busy_until.max_right(10, free_by(0)) == 10);
+
+  std::vector<int> ones(13, 1);
+  utils::LazySegmentTree<utils::monoid::Sum<int>> prefix(ones);
+  for (int k = 0; k <= 13; ++k) {
+    CHECK(prefix.max_right(0, [k](int s) { return s <= k; }) ==
+          static_cast<std::size_t>(k));
+  }
+}
@@ -0,0 +1,51 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/sparse_table.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct min_fn {
+  int operator()(int a, int b) const { return std::min(a, b); }
+};
+
+struct or_fn {
+  std::uint32_t operator()(std::uint32_t a, std::uint32_t b) const {
+    return a | b;
+  }
+};
+
+} // namespace
+
+TEST_CASE("SparseTable answers every range") {
+  std::mt19937 rng(6);
+  for (std::size_t n : {1, 2, 3, 31, 32, 33, 100}) {
+    std::vector<int> values(n);
+    std::vector<std::uint32_t> bits(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      values[i] = static_cast<int>(rng() % 1000) - 500;
+      bits[i] = std::uint32_t{1} << (rng() % 32);
+    }
+    utils::SparseTable<int, min_fn> min(values);
+    utils::SparseTable<std::uint32_t, or_fn> any(bits);
+    CHECK(min.size() == n);
+
+    bool all_match = true;
+    for (std::size_t l = 0; l < n; ++l) {
+      int expected_min = values[l];
+      std::uint32_t expected_or = 0;
+      for (std::size_t r = l + 1; r <= n; ++r) {
+        expected_min = std::min(expected_min, values[r - 1]);
+        expected_or |= bits[r - 1];
+        all_match = all_match && min.query(l, r) == expected_min &&
+                    any.query(l, r) == expected_or;
+      }
+    }
+    CHECK(all_match);
+  }
+}
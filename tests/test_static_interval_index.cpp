@@ -0,0 +1,80 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include "utils_cpp/static_interval_index.hpp"
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+using intervals_t = std::vector<std::pair<int, int>>;
+
+TEST_CASE("stabbing and overlap queries") {
+  utils::StaticIntervalIndex<int> index(
+      intervals_t{{5, 8}, {0, 3}, {8, 9}, {6, 10}, {0, 3}});
+  CHECK(index.size() == 5);
+
+  intervals_t out;
+  index.stabbing_query(8, out);
+  CHECK(out == intervals_t{{5, 8}, {6, 10}, {8, 9}});
+
+  out.clear();
+  index.stabbing_query(2, out);
+  CHECK(out == intervals_t{{0, 3}, {0, 3}});
+
+  out.clear();
+  index.stabbing_query(4, out);
+  CHECK(out.empty());
+  CHECK_FALSE(index.contains(4));
+  CHECK(index.contains(10));
+  CHECK_FALSE(index.contains(11));
+
+  out.clear();
+  index.overlapping(3, 5, out);
+  CHECK(out == intervals_t{{0, 3}, {0, 3}, {5, 8}});
+
+  utils::StaticIntervalIndex<int> none;
+  CHECK_FALSE(none.contains(0));
+  none.overlapping(0, 100, out);
+  CHECK(out.size() == 3);
+}
+
+TEST_CASE("random intervals against brute force") {
+  std::mt19937 rng(9);
+  std::uniform_int_distribution<int> low_dist(0, 10000), len_dist(0, 200);
+
+  for (std::size_t n : {1, 2, 7, 100, 3000}) {
+    intervals_t intervals;
+    for (std::size_t i = 0; i < n; ++i) {
+      int low = low_dist(rng);
+      intervals.emplace_back(low, low + len_dist(rng));
+    }
+    utils::StaticIntervalIndex<int> index(intervals);
+    std::sort(intervals.begin(), intervals.end());
+
+    for (int q = 0; q < 200; ++q) {
+      int low = low_dist(rng) - 100;
+      int high = low + len_dist(rng) / 4;
+
+      intervals_t expected_stab, expected_overlap;
+      for (auto [a, b] : intervals) {
+        if (a <= low && low <= b) {
+          expected_stab.emplace_back(a, b);
+        }
+        if (a <= high && low <= b) {
+          expected_overlap.emplace_back(a, b);
+        }
+      }
+
+      intervals_t out;
+      index.stabbing_query(low, out);
+      CHECK(out == expected_stab);
+      CHECK(index.contains(low) == !expected_stab.empty());
+
+      out.clear();
+      index.overlapping(low, high, out);
+      CHECK(out == expected_overlap);
+    }
+  }
+}
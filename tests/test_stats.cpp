@@ -0,0 +1,94 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#ifndef UTILS_CPP_ENABLE_STATS
+#define UTILS_CPP_ENABLE_STATS
+#endif
+
+#include "utils_cpp/graph/csr_graph.hpp"
+#include "utils_cpp/graph/library.hpp"
+#include "utils_cpp/graph/pathfinding.hpp"
+#include "utils_cpp/json.hpp"
+#include "utils_cpp/stats.hpp"
+
+#include <sstream>
+#include <thread>
+
+using namespace utils;
+using stats::counter;
+
+TEST_CASE("dijkstra counters") {
+  static_assert(stats::enabled);
+  auto g = gl::grid(10, 10).graph;
+  gl::CsrGraph csr(g);
+
+  SUBCASE("unit weights") {
+    auto before = stats::local_snapshot();
+    gl::dijkstra(csr, 0);
+    auto used = stats::local_snapshot() - before;
+
+    // Every vertex is settled once, and scans all its edges.
+    CHECK(used[counter::vertices_settled] == 100);
+    CHECK(used[counter::edges_scanned] == 2 * boost::num_edges(g));
+    // Each vertex but the source is reached at least once.
+    CHECK(used[counter::edges_relaxed] >= 99);
+    CHECK(used[counter::heap_pushes] == used[counter::edges_relaxed] + 1);
+    CHECK(used[counter::heap_pushes] ==
+          used[counter::vertices_settled] + used[counter::stale_pops]);
+  }
+
+  SUBCASE("astar stops early") {
+    auto before = stats::local_snapshot();
+    gl::PathfindingWorkspace<std::size_t> ws;
+    auto d = gl::astar_early_stopping(
+        csr, 0, 11, [](std::size_t) { return 0; }, ws);
+    auto used = stats::local_snapshot() - before;
+    CHECK(d == 2);
+    CHECK(used[counter::vertices_settled] > 0);
+    CHECK(used[counter::vertices_settled] < 100);
+  }
+
+  SUBCASE("boost searches") {
+    gl::EdgeMap<double, gl::Graph> weights;
+    for (auto e : boost::make_iterator_range(boost::edges(g))) {
+      weights[e] = 1.5;
+    }
+    auto before = stats::local_snapshot();
+    gl::dijkstra(g, 0, weights);
+    auto used = stats::local_snapshot() - before;
+    CHECK(used[counter::vertices_settled] == 100);
+    CHECK(used[counter::heap_pushes] == 100);
+    CHECK(used[counter::edges_scanned] == 2 * boost::num_edges(g));
+  }
+}
+
+TEST_CASE("json counters") {
+  std::string text = R"({"a": [1, 2, 3, 4, 5], "a string longer than the buffer": "x",
+                         "b": {"c": null}})";
+  auto before = stats::local_snapshot();
+  parse(text);
+  auto used = stats::local_snapshot() - before;
+
+  CHECK(used[counter::json_bytes_parsed] == text.size());
+  // Object, array, 5 numbers, string, object, null.
+  CHECK(used[counter::json_values] == 10);
+  // 4 members, 1 long key, array growth to 1, 2, 4 and 8 elements.
+  CHECK(used[counter::json_allocations] == 9);
+}
+
+TEST_CASE("snapshots merge threads") {
+  stats::reset();
+  CHECK(stats::snapshot()[counter::json_values] == 0);
+  std::thread([] { parse("[1, 2]"); }).join();
+  parse("true");
+  auto all = stats::snapshot();
+  CHECK(all[counter::json_values] == 4);
+  CHECK(stats::local_snapshot()[counter::json_values] == 1);
+
+  std::stringstream ss;
+  ss << all;
+  CHECK(ss.str().find("utils_cpp_json_values 4\n") != std::string::npos);
+
+  stats::reset();
+  CHECK(stats::snapshot()[counter::json_values] == 0);
+}
@@ -1,6 +1,12 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <ranges>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "utils_cpp/print.hpp"
@@ -23,6 +29,96 @@ TEST_CASE("split") {
   CHECK_THROWS(utils::split("double  spaced  word", ""));
 }
 
+TEST_CASE("split view") {
+  using views = std::vector<std::string_view>;
+  static_assert(std::ranges::forward_range<utils::SplitView>);
+  static_assert(std::ranges::common_range<utils::SplitView>);
+
+  auto tokens = [](std::string_view strv, std::string_view delimiter) {
+    auto view = utils::split_view(strv, delimiter);
+    return views(view.begin(), view.end());
+  };
+  // The same tokens as split, pointing into the input.
+  for (auto [strv, delimiter] :
+       {std::pair<std::string_view, std::string_view>{"Hello,World", ","},
+        {",a,,b,", ","},
+        {"", ","},
+        {"a::b::::c", "::"},
+        {"  double  spaced\twords\n ", " "},
+        {"tabs\tonly", "\t"},
+        {"   ", " "}}) {
+    auto copied = utils::split(strv, delimiter);
+    auto viewed = tokens(strv, delimiter);
+    REQUIRE(viewed.size() == copied.size());
+    for (std::size_t i = 0; i < viewed.size(); ++i) {
+      CHECK(viewed[i] == copied[i]);
+      CHECK(viewed[i].data() >= strv.data());
+      CHECK(viewed[i].data() + viewed[i].size() <= strv.data() + strv.size());
+    }
+  }
+  CHECK(tokens(",a,,b,", ",") == views{"", "a", "", "b"});
+  CHECK_THROWS(utils::split_view("a", ""));
+
+  utils::DelimiterSet delimiters(" \t\r\n");
+  CHECK(std::ranges::distance(
+            utils::split_any_view("1 2\t3.5\r\n4 5 0.25\n", delimiters)) ==
+        6);
+  auto it = utils::split_any_view("  x\ty ", delimiters).begin();
+  CHECK(*it == "x");
+  CHECK(*++it == "y");
+  CHECK(++it == utils::SplitView::iterator());
+}
+
+TEST_CASE("delimiter set") {
+  CHECK_THROWS_AS(utils::DelimiterSet(""), std::invalid_argument);
+
+  std::mt19937 rng(1);
+  const std::string alphabet = "ab,;\t\n xyz0123456789";
+  for (std::string_view chars : {",", ",\n", ",;\t\n ", "0123456789,;\t"}) {
+    utils::DelimiterSet set(chars);
+    for (int round = 0; round < 200; ++round) {
+      std::string s(rng() % 100, 'a');
+      for (auto &c : s) {
+        // Mostly non-delimiters, so that matches land anywhere in a block.
+        c = rng() % 8 == 0 ? alphabet[rng() % alphabet.size()] : 'a';
+      }
+      std::size_t pos = s.empty() ? 0 : rng() % s.size();
+      auto expected = std::string_view(s).find_first_of(chars, pos);
+      CHECK(set.find(s, pos) == expected);
+      CHECK(set.find_portable(s, pos) == expected);
+    }
+  }
+}
+
+TEST_CASE("parse number") {
+  CHECK(utils::parse_number<int>("42") == 42);
+  CHECK(utils::parse_number<int>("-7") == -7);
+  CHECK(utils::parse_number<std::uint64_t>("18446744073709551615") ==
+        std::numeric_limits<std::uint64_t>::max());
+  CHECK(utils::parse_number<double>("2.5e-3") == 2.5e-3);
+  CHECK(utils::parse_number<double>(".5") == 0.5);
+  CHECK(utils::parse_number<float>("1.5") == 1.5f);
+  CHECK(std::isinf(*utils::parse_number<double>("-inf")));
+
+  CHECK_FALSE(utils::parse_number<int>(""));
+  CHECK_FALSE(utils::parse_number<int>(" 1"));
+  CHECK_FALSE(utils::parse_number<int>("1 "));
+  CHECK_FALSE(utils::parse_number<int>("+1"));
+  CHECK_FALSE(utils::parse_number<int>("1.0"));
+  CHECK_FALSE(utils::parse_number<std::uint8_t>("256"));
+  CHECK_FALSE(utils::parse_number<unsigned>("-1"));
+  CHECK_FALSE(utils::parse_number<double>("1e999"));
+  CHECK_FALSE(utils::parse_number<double>("0x10"));
+
+  // Tokens of an edgelist line, parsed in place.
+  utils::DelimiterSet delimiters(" \t");
+  std::vector<double> fields;
+  for (auto token : utils::split_any_view("3 17\t0.5", delimiters)) {
+    fields.push_back(*utils::parse_number<double>(token));
+  }
+  CHECK(fields == std::vector<double>{3, 17, 0.5});
+}
+
 TEST_CASE("join") {
   CHECK(utils::join(std::vector<std::string>{"Hello", "World"}, ", ") ==
         "Hello, World");
@@ -52,6 +148,12 @@ TEST_CASE("convertible to long double") {
   CHECK_FALSE(utils::convertible_to_double("0.2 "));
   CHECK_FALSE(utils::convertible_to_double("0. 5"));
   CHECK_FALSE(utils::convertible_to_double("02.5"));
+  CHECK_FALSE(utils::convertible_to_double("inf"));
+  CHECK_FALSE(utils::convertible_to_double("nan"));
+  CHECK_FALSE(utils::convertible_to_double("+-1"));
+  CHECK(utils::convertible_to_double("+1.5"));
+  CHECK(utils::convertible_to_double("-0.5"));
+  CHECK(utils::convertible_to_double("1e5"));
 }
 
 TEST_CASE("convertible to long long") {
@@ -0,0 +1,56 @@
+/**********************************************************************
+ * @brief Decodes a binary log written through LOGF and BinaryLogger.
+ * @details Usage: decode_binary_log [--json] <file> [<output>]
+ *Writes text lines (or JSON lines with --json) to <output>, or to stdout.
+ * @author Sam Tonetto
+ * @copyright GNU Public License
+ * @date 2023
+ ***********************************************************************/
+
+#include "utils_cpp/binary_log.hpp"
+
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+  BinaryLogFormat format = BinaryLogFormat::text;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--json") {
+      format = BinaryLogFormat::json;
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (files.empty() || files.size() > 2) {
+    std::cerr << "usage: " << argv[0] << " [--json] <file> [<output>]\n";
+    return 2;
+  }
+
+  std::ifstream in(files[0], std::ios::binary);
+  if (!in) {
+    std::cerr << argv[0] << ": cannot open '" << files[0] << "'\n";
+    return 1;
+  }
+  std::ofstream out_file;
+  if (files.size() == 2) {
+    out_file.open(files[1]);
+    if (!out_file) {
+      std::cerr << argv[0] << ": cannot open '" << files[1] << "'\n";
+      return 1;
+    }
+  }
+  std::ostream &out = files.size() == 2 ? out_file : std::cout;
+
+  try {
+    decode_binary_log(in, out, format);
+  } catch (const std::exception &e) {
+    std::cerr << argv[0] << ": " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}